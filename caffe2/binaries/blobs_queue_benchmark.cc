@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares BlobsQueue and LockFreeBlobsQueue. For every combination of the
+// given producer and consumer counts, the producers push small tensors
+// through the queue as fast as they can and the consumers drain it until it
+// is closed; the benchmark reports the records per second that went through.
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/queue/blobs_queue.h"
+#include "caffe2/queue/lock_free_blobs_queue.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(
+    producers,
+    "1,4,16",
+    "Comma separated numbers of producer threads.");
+CAFFE2_DEFINE_string(
+    consumers,
+    "1,2,8",
+    "Comma separated numbers of consumer threads.");
+CAFFE2_DEFINE_int(capacity, 64, "The capacity of the queue.");
+CAFFE2_DEFINE_int(num_blobs, 2, "The number of blobs per record.");
+CAFFE2_DEFINE_int(
+    records,
+    200000,
+    "The number of records pushed through the queue per run.");
+
+namespace {
+
+std::vector<int> ParseList(const std::string& str) {
+  std::vector<int> values;
+  for (const auto& item : caffe2::split(',', str)) {
+    values.push_back(std::stoi(item));
+  }
+  return values;
+}
+
+std::vector<std::unique_ptr<caffe2::Blob>> MakeRecord() {
+  std::vector<std::unique_ptr<caffe2::Blob>> record;
+  for (int i = 0; i < caffe2::FLAGS_num_blobs; ++i) {
+    record.emplace_back(new caffe2::Blob());
+    auto* tensor = record.back()->GetMutable<caffe2::TensorCPU>();
+    tensor->Resize(16);
+    tensor->mutable_data<float>();
+  }
+  return record;
+}
+
+std::vector<caffe2::Blob*> Pointers(
+    const std::vector<std::unique_ptr<caffe2::Blob>>& record) {
+  std::vector<caffe2::Blob*> pointers;
+  for (const auto& blob : record) {
+    pointers.push_back(blob.get());
+  }
+  return pointers;
+}
+
+template <typename Queue>
+double RunBenchmark(int num_producers, int num_consumers) {
+  caffe2::Workspace ws;
+  auto queue = std::make_shared<Queue>(
+      &ws,
+      "queue",
+      caffe2::FLAGS_capacity,
+      caffe2::FLAGS_num_blobs,
+      false);
+  const int records_per_producer = caffe2::FLAGS_records / num_producers;
+
+  caffe2::Timer timer;
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < num_consumers; ++i) {
+    consumers.emplace_back([&queue]() {
+      auto record = MakeRecord();
+      const auto pointers = Pointers(record);
+      while (queue->blockingRead(pointers)) {
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int i = 0; i < num_producers; ++i) {
+    producers.emplace_back([&queue, records_per_producer]() {
+      auto record = MakeRecord();
+      const auto pointers = Pointers(record);
+      for (int j = 0; j < records_per_producer; ++j) {
+        CAFFE_ENFORCE(queue->blockingWrite(pointers));
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  queue->close();
+  for (auto& consumer : consumers) {
+    consumer.join();
+  }
+  return records_per_producer * num_producers / timer.Seconds();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  CAFFE_ENFORCE_GT(caffe2::FLAGS_records, 0);
+  for (const auto num_producers : ParseList(caffe2::FLAGS_producers)) {
+    for (const auto num_consumers : ParseList(caffe2::FLAGS_consumers)) {
+      const double locked =
+          RunBenchmark<caffe2::BlobsQueue>(num_producers, num_consumers);
+      const double lock_free = RunBenchmark<caffe2::LockFreeBlobsQueue>(
+          num_producers, num_consumers);
+      printf(
+          "producers %3d consumers %3d: BlobsQueue %10.0f records/s, "
+          "LockFreeBlobsQueue %10.0f records/s (%.2fx)\n",
+          num_producers,
+          num_consumers,
+          locked,
+          lock_free,
+          lock_free / locked);
+    }
+  }
+  return 0;
+}
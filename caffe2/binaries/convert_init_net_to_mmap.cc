@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Runs an init net and writes the tensors it creates into an mmap tensor file,
+// which a model can then load with MmapTensorFileInitNet instead of parsing
+// and copying the weights of the init net.
+
+#include "caffe2/core/flags.h"
+#include "caffe2/core/init.h"
+#include "caffe2/core/mmap_tensor_file.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/proto_utils.h"
+
+CAFFE2_DEFINE_string(init_net, "", "The given path to the init protobuffer.");
+CAFFE2_DEFINE_string(output, "", "The path of the mmap tensor file to write.");
+
+namespace caffe2 {
+
+void run() {
+  if (FLAGS_init_net.empty()) {
+    LOG(FATAL) << "No init net specified. Use --init_net=/path/to/net.";
+  }
+  if (FLAGS_output.empty()) {
+    LOG(FATAL) << "No output specified. Use --output=/path/to/file.";
+  }
+  NetDef init_net;
+  CAFFE_ENFORCE(ReadProtoFromFile(FLAGS_init_net, &init_net));
+  Workspace ws;
+  CAFFE_ENFORCE(ws.RunNetOnce(init_net));
+  std::vector<std::pair<string, const TensorCPU*>> tensors;
+  for (const auto& name : ws.Blobs()) {
+    const auto* blob = ws.GetBlob(name);
+    if (!blob->IsType<TensorCPU>()) {
+      LOG(WARNING) << "Skipping " << name << ", which is not a CPU tensor.";
+      continue;
+    }
+    tensors.emplace_back(name, &blob->Get<TensorCPU>());
+  }
+  WriteMmapTensorFile(FLAGS_output, tensors);
+  LOG(INFO) << "Wrote " << tensors.size() << " tensors to " << FLAGS_output;
+}
+}
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  caffe2::run();
+  // This is to allow us to use memory leak checks.
+  google::protobuf::ShutdownProtobufLibrary();
+  return 0;
+}
@@ -18,6 +18,7 @@
 
 #include "caffe2/core/context.h"
 #include "caffe2/core/context_gpu.h"
+#include "caffe2/core/net.h"
 #include "caffe2/core/operator.h"
 
 #define CAFFE2_SKIP_IF_NO_GPU                                      \
@@ -157,9 +158,32 @@ class DummyEmptyOp : public Operator<Context> {
   bool RunOnDevice() final { return true; }
 };
 
+// Accesses its inputs and outputs a few times, as operators usually do.
+template <class Context>
+class DummyInputOutputOp : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  DummyInputOutputOp(const OperatorDef& def, Workspace* ws)
+      : Operator<Context>(def, ws) {}
+
+  bool RunOnDevice() final {
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < InputSize(); ++j) {
+        benchmark::DoNotOptimize(&Input(j));
+      }
+      for (int j = 0; j < OutputSize(); ++j) {
+        benchmark::DoNotOptimize(Output(j));
+      }
+    }
+    return true;
+  }
+};
+
 REGISTER_CPU_OPERATOR(DummyEmpty, DummyEmptyOp<CPUContext>);
 REGISTER_CUDA_OPERATOR(DummyEmpty, DummyEmptyOp<CUDAContext>);
 OPERATOR_SCHEMA(DummyEmpty);
+REGISTER_CPU_OPERATOR(DummyInputOutput, DummyInputOutputOp<CPUContext>);
+OPERATOR_SCHEMA(DummyInputOutput);
 }  // namespace
 
 static void BM_OperatorCreationCPU(benchmark::State& state) {
@@ -187,6 +211,50 @@ static void BM_OperatorCreationCUDA(benchmark::State& state) {
 }
 BENCHMARK(BM_OperatorCreationCUDA);
 
+static void RunSimpleNetOfDummyOps(
+    benchmark::State& state,
+    const string& op_type,
+    bool compiled_plan) {
+  Workspace ws;
+  ws.CreateBlob("X")->GetMutable<TensorCPU>()->Resize(1);
+  NetDef net_def;
+  net_def.set_type("simple");
+  net_def.add_external_input("X");
+  string input = "X";
+  for (int i = 0; i < state.range(0); ++i) {
+    auto* op = net_def.add_op();
+    op->set_type(op_type);
+    op->add_input(input);
+    input = "Y" + caffe2::to_string(i);
+    op->add_output(input);
+  }
+  if (compiled_plan) {
+    auto* arg = net_def.add_arg();
+    arg->set_name("compiled_plan");
+    arg->set_i(1);
+  }
+  auto net = CreateNet(net_def, &ws);
+  CHECK(net->Run());
+  while (state.KeepRunning()) {
+    CHECK(net->Run());
+  }
+}
+
+static void BM_SimpleNetRunCPU(benchmark::State& state) {
+  RunSimpleNetOfDummyOps(state, "DummyEmpty", false);
+}
+BENCHMARK(BM_SimpleNetRunCPU)->Arg(1)->Arg(100);
+
+static void BM_SimpleNetRunCompiledPlanCPU(benchmark::State& state) {
+  RunSimpleNetOfDummyOps(state, "DummyEmpty", true);
+}
+BENCHMARK(BM_SimpleNetRunCompiledPlanCPU)->Arg(1)->Arg(100);
+
+static void BM_SimpleNetRunInputOutputCPU(benchmark::State& state) {
+  RunSimpleNetOfDummyOps(state, "DummyInputOutput", false);
+}
+BENCHMARK(BM_SimpleNetRunInputOutputCPU)->Arg(1)->Arg(100);
+
 static void BM_RawAllocDeallocCPU(benchmark::State& state) {
   while (state.KeepRunning()) {
     // Allocating only 1 byte in order to measure the overhead.
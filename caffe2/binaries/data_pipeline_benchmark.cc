@@ -0,0 +1,350 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Benchmarks the input pipeline of image models stage by stage, to size the
+// reader and decoder threads of a job without trial and error:
+//
+//   read:   --read_threads threads read records from a DBReader into a
+//           BlobsQueue,
+//   decode: --decode_threads threads parse the TensorProtos of each record
+//           and decode its image, as ImageInputOp does, resized to
+//           --scale x --scale and converted to float CHW, into a second
+//           BlobsQueue,
+//   copy:   --copy_threads threads assemble batches of --batch_size images
+//           and copy them to --device.
+//
+// After --seconds the benchmark reports, for every stage, the records per
+// second and how busy its threads were, and, for every queue, its average
+// occupancy and how often it was found empty or full. A stage with busy
+// threads in front of an empty queue is the bottleneck.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "caffe2/core/db.h"
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/queue/blobs_queue.h"
+
+CAFFE2_DEFINE_string(input_db, "", "The input db, as read by ImageInput.");
+CAFFE2_DEFINE_string(input_db_type, "lmdb", "The input db type.");
+CAFFE2_DEFINE_int(read_threads, 1, "The number of threads reading the db.");
+CAFFE2_DEFINE_int(decode_threads, 4, "The number of threads decoding.");
+CAFFE2_DEFINE_int(copy_threads, 1, "The number of threads batching.");
+CAFFE2_DEFINE_int(queue_capacity, 256, "The capacity of both queues.");
+CAFFE2_DEFINE_int(batch_size, 64, "The number of images per batch.");
+CAFFE2_DEFINE_int(scale, 224, "The size images are resized to.");
+CAFFE2_DEFINE_string(
+    device,
+    "CPU",
+    "CPU, or CUDA to also copy the batches to the GPU.");
+CAFFE2_DEFINE_double(seconds, 10, "How long to run the pipeline.");
+
+namespace caffe2 {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct StageStats {
+  const char* name;
+  int threads;
+  std::atomic<int64_t> records{0};
+  // Nanoseconds the threads of the stage spent working, as opposed to
+  // waiting on a queue.
+  std::atomic<int64_t> busy_ns{0};
+};
+
+// Adds the time it lives to a stage's busy time.
+class BusyTimer {
+ public:
+  explicit BusyTimer(std::atomic<int64_t>* busy_ns)
+      : busy_ns_(busy_ns), start_(Clock::now()) {}
+  ~BusyTimer() {
+    *busy_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     Clock::now() - start_)
+                     .count();
+  }
+
+ private:
+  std::atomic<int64_t>* busy_ns_;
+  Clock::time_point start_;
+};
+
+// A BlobsQueue whose occupancy is sampled by a monitor thread.
+struct MonitoredQueue {
+  MonitoredQueue(Workspace* ws, const std::string& name, int num_blobs)
+      : name(name),
+        queue(std::make_shared<BlobsQueue>(
+            ws,
+            name,
+            FLAGS_queue_capacity,
+            num_blobs,
+            true)) {}
+
+  bool write(const std::vector<Blob*>& blobs) {
+    if (!queue->blockingWrite(blobs)) {
+      return false;
+    }
+    ++size;
+    return true;
+  }
+
+  bool read(const std::vector<Blob*>& blobs) {
+    if (!queue->blockingRead(blobs)) {
+      return false;
+    }
+    --size;
+    return true;
+  }
+
+  void sample() {
+    const int64_t current = size;
+    ++samples;
+    sum += current;
+    empty += current <= 0;
+    full += current >= FLAGS_queue_capacity;
+  }
+
+  std::string name;
+  std::shared_ptr<BlobsQueue> queue;
+  std::atomic<int64_t> size{0};
+  int64_t samples{0};
+  int64_t sum{0};
+  int64_t empty{0};
+  int64_t full{0};
+};
+
+void ReadLoop(
+    const db::DBReader* reader,
+    MonitoredQueue* out,
+    StageStats* stats,
+    const std::atomic<bool>* stop) {
+  Blob value;
+  const std::vector<Blob*> blobs{&value};
+  std::string key;
+  while (!*stop) {
+    {
+      BusyTimer timer(&stats->busy_ns);
+      reader->Read(&key, value.GetMutable<std::string>());
+    }
+    if (!out->write(blobs)) {
+      return;
+    }
+    ++stats->records;
+  }
+}
+
+void DecodeLoop(MonitoredQueue* in, MonitoredQueue* out, StageStats* stats) {
+  Blob value;
+  Blob image;
+  Blob label;
+  const std::vector<Blob*> in_blobs{&value};
+  const std::vector<Blob*> out_blobs{&image, &label};
+  TensorProtos protos;
+  while (in->read(in_blobs)) {
+    {
+      BusyTimer timer(&stats->busy_ns);
+      CAFFE_ENFORCE(protos.ParseFromString(value.Get<std::string>()));
+      const auto& image_proto = protos.protos(0);
+      cv::Mat src;
+      if (image_proto.data_type() == TensorProto::STRING) {
+        const auto& encoded = image_proto.string_data(0);
+        src = cv::imdecode(
+            cv::Mat(
+                1,
+                encoded.size(),
+                CV_8UC1,
+                const_cast<char*>(encoded.data())),
+            cv::IMREAD_COLOR);
+      } else {
+        CAFFE_ENFORCE_EQ(image_proto.data_type(), TensorProto::BYTE);
+        const int channels =
+            image_proto.dims_size() == 3 ? image_proto.dims(2) : 1;
+        src = cv::Mat(
+                  image_proto.dims(0),
+                  image_proto.dims(1),
+                  channels == 3 ? CV_8UC3 : CV_8UC1,
+                  const_cast<char*>(image_proto.byte_data().data()))
+                  .clone();
+      }
+      cv::Mat resized;
+      cv::resize(src, resized, cv::Size(FLAGS_scale, FLAGS_scale));
+      const int channels = resized.channels();
+      auto* tensor = image.GetMutable<TensorCPU>();
+      tensor->Resize(channels, FLAGS_scale, FLAGS_scale);
+      auto* data = tensor->mutable_data<float>();
+      for (int h = 0; h < FLAGS_scale; ++h) {
+        const uchar* row = resized.ptr<uchar>(h);
+        for (int w = 0; w < FLAGS_scale; ++w) {
+          for (int c = 0; c < channels; ++c) {
+            data[(c * FLAGS_scale + h) * FLAGS_scale + w] =
+                row[w * channels + c];
+          }
+        }
+      }
+      const auto& label_proto = protos.protos(1);
+      auto* label_tensor = label.GetMutable<TensorCPU>();
+      label_tensor->Resize(1);
+      label_tensor->mutable_data<int>()[0] =
+          label_proto.data_type() == TensorProto::INT32
+          ? label_proto.int32_data(0)
+          : static_cast<int>(label_proto.float_data(0));
+    }
+    if (!out->write(out_blobs)) {
+      return;
+    }
+    ++stats->records;
+  }
+}
+
+void CopyLoop(MonitoredQueue* in, StageStats* stats) {
+  Workspace ws;
+  Blob image;
+  Blob label;
+  const std::vector<Blob*> blobs{&image, &label};
+  auto* batch = ws.CreateBlob("batch")->GetMutable<TensorCPU>();
+  unique_ptr<OperatorBase> copy;
+  if (FLAGS_device == "CUDA") {
+    OperatorDef def;
+    def.set_type("CopyCPUToGPU");
+    def.add_input("batch");
+    def.add_output("batch_gpu");
+    def.mutable_device_option()->set_device_type(CUDA);
+    copy = CreateOperator(def, &ws);
+  }
+  int item = 0;
+  while (in->read(blobs)) {
+    BusyTimer timer(&stats->busy_ns);
+    const auto& tensor = image.Get<TensorCPU>();
+    batch->Resize(
+        FLAGS_batch_size, tensor.dim(0), tensor.dim(1), tensor.dim(2));
+    memcpy(
+        batch->mutable_data<float>() + item * tensor.size(),
+        tensor.data<float>(),
+        tensor.nbytes());
+    ++stats->records;
+    if (++item == FLAGS_batch_size) {
+      if (copy) {
+        CAFFE_ENFORCE(copy->Run());
+      }
+      item = 0;
+    }
+  }
+}
+
+void Report(const StageStats& stats, double seconds) {
+  printf(
+      "stage %-6s threads %3d: %10.1f records/s, threads %5.1f%% busy\n",
+      stats.name,
+      stats.threads,
+      stats.records / seconds,
+      100.0 * stats.busy_ns / 1e9 / seconds / stats.threads);
+}
+
+void Report(const MonitoredQueue& queue) {
+  printf(
+      "queue %-7s: %7.1f of %d records on average, empty %5.1f%%, "
+      "full %5.1f%% of the time\n",
+      queue.name.c_str(),
+      static_cast<double>(queue.sum) / queue.samples,
+      FLAGS_queue_capacity,
+      100.0 * queue.empty / queue.samples,
+      100.0 * queue.full / queue.samples);
+}
+
+void Run() {
+  CAFFE_ENFORCE(!FLAGS_input_db.empty(), "Use --input_db.");
+  CAFFE_ENFORCE(
+      FLAGS_device == "CPU" || FLAGS_device == "CUDA",
+      "Unknown device ",
+      FLAGS_device);
+  db::DBReader reader(FLAGS_input_db_type, FLAGS_input_db);
+  Workspace ws;
+  MonitoredQueue raw(&ws, "raw", 1);
+  MonitoredQueue decoded(&ws, "decoded", 2);
+  StageStats read_stats;
+  read_stats.name = "read";
+  read_stats.threads = FLAGS_read_threads;
+  StageStats decode_stats;
+  decode_stats.name = "decode";
+  decode_stats.threads = FLAGS_decode_threads;
+  StageStats copy_stats;
+  copy_stats.name = "copy";
+  copy_stats.threads = FLAGS_copy_threads;
+
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> readers;
+  std::vector<std::thread> decoders;
+  std::vector<std::thread> copiers;
+  for (int i = 0; i < FLAGS_read_threads; ++i) {
+    readers.emplace_back(ReadLoop, &reader, &raw, &read_stats, &stop);
+  }
+  for (int i = 0; i < FLAGS_decode_threads; ++i) {
+    decoders.emplace_back(DecodeLoop, &raw, &decoded, &decode_stats);
+  }
+  for (int i = 0; i < FLAGS_copy_threads; ++i) {
+    copiers.emplace_back(CopyLoop, &decoded, &copy_stats);
+  }
+
+  Timer timer;
+  while (timer.Seconds() < FLAGS_seconds) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    raw.sample();
+    decoded.sample();
+  }
+  // Report before the stages are stopped and drain the queues.
+  const double seconds = timer.Seconds();
+  Report(read_stats, seconds);
+  Report(decode_stats, seconds);
+  Report(copy_stats, seconds);
+  Report(raw);
+  Report(decoded);
+  printf(
+      "%.1f batches/s of %d images\n",
+      copy_stats.records / seconds / FLAGS_batch_size,
+      FLAGS_batch_size);
+
+  stop = true;
+  raw.queue->close();
+  decoded.queue->close();
+  for (auto* threads : {&readers, &decoders, &copiers}) {
+    for (auto& thread : *threads) {
+      thread.join();
+    }
+  }
+}
+
+} // namespace
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  caffe2::Run();
+  return 0;
+}
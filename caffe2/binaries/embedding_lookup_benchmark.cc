@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures EmbeddingLookup, the kernel behind SparseLengthsSum and
+// SparseLengthsWeightedSum, for every combination of the given table sizes,
+// block sizes and prefetch distances. Every iteration reduces a freshly drawn
+// set of uniformly random indices so that the rows are not already cached
+// from the previous iteration.
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/perfkernels/embedding_lookup.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(
+    table_sizes,
+    "100000,1000000",
+    "Comma separated numbers of rows of the embedding table.");
+CAFFE2_DEFINE_string(
+    block_sizes,
+    "32,64,128",
+    "Comma separated embedding dimensions.");
+CAFFE2_DEFINE_string(
+    prefetch_distances,
+    "0,1,4,8,16,32",
+    "Comma separated prefetch distances, see "
+    "caffe2_embedding_lookup_prefetch_distance.");
+CAFFE2_DEFINE_int(batch_size, 256, "The number of segments per iteration.");
+CAFFE2_DEFINE_int(pooling, 40, "The number of indices per segment.");
+CAFFE2_DEFINE_bool(weighted, false, "If true, benchmark the weighted sum.");
+CAFFE2_DEFINE_int(warmup, 2, "The number of iterations to warm up.");
+CAFFE2_DEFINE_int(iter, 20, "The number of iterations to run.");
+
+namespace {
+
+std::vector<caffe2::TIndex> ParseList(const std::string& str) {
+  std::vector<caffe2::TIndex> values;
+  for (const auto& item : caffe2::split(',', str)) {
+    values.push_back(std::stoll(item));
+  }
+  return values;
+}
+
+void RunBenchmark(
+    caffe2::TIndex table_size,
+    caffe2::TIndex block_size,
+    const std::vector<caffe2::TIndex>& prefetch_distances) {
+  const caffe2::TIndex batch_size = caffe2::FLAGS_batch_size;
+  const caffe2::TIndex index_size = batch_size * caffe2::FLAGS_pooling;
+  const int num_sets = caffe2::FLAGS_warmup + caffe2::FLAGS_iter;
+
+  std::mt19937 gen(1701);
+  std::uniform_real_distribution<float> value_dist(-1.f, 1.f);
+  std::uniform_int_distribution<int64_t> index_dist(0, table_size - 1);
+  std::vector<float> table(table_size * block_size);
+  for (auto& v : table) {
+    v = value_dist(gen);
+  }
+  std::vector<int64_t> indices(num_sets * index_size);
+  for (auto& v : indices) {
+    v = index_dist(gen);
+  }
+  std::vector<float> weights(index_size);
+  for (auto& v : weights) {
+    v = value_dist(gen);
+  }
+  std::vector<int> lengths(batch_size, caffe2::FLAGS_pooling);
+  std::vector<float> out(batch_size * block_size);
+
+  for (const auto distance : prefetch_distances) {
+    caffe2::FLAGS_caffe2_embedding_lookup_prefetch_distance = distance;
+    double seconds = 0;
+    for (int i = 0; i < num_sets; ++i) {
+      caffe2::Timer timer;
+      caffe2::EmbeddingLookup(
+          block_size,
+          batch_size,
+          index_size,
+          table_size,
+          table.data(),
+          indices.data() + i * index_size,
+          lengths.data(),
+          caffe2::FLAGS_weighted ? weights.data() : nullptr,
+          nullptr,
+          false,
+          out.data());
+      if (i >= caffe2::FLAGS_warmup) {
+        seconds += timer.Seconds();
+      }
+    }
+    const double bytes =
+        static_cast<double>(caffe2::FLAGS_iter) * index_size * block_size *
+        sizeof(float);
+    printf(
+        "table_size %10lld block_size %4lld prefetch_distance %3lld: "
+        "%8.3f ms/iter, %7.2f GB/s\n",
+        static_cast<long long>(table_size),
+        static_cast<long long>(block_size),
+        static_cast<long long>(distance),
+        seconds * 1000 / caffe2::FLAGS_iter,
+        bytes / seconds / 1e9);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  CAFFE_ENFORCE_GT(caffe2::FLAGS_iter, 0);
+  const auto prefetch_distances = ParseList(caffe2::FLAGS_prefetch_distances);
+  for (const auto table_size : ParseList(caffe2::FLAGS_table_sizes)) {
+    for (const auto block_size : ParseList(caffe2::FLAGS_block_sizes)) {
+      RunBenchmark(table_size, block_size, prefetch_distances);
+    }
+  }
+  return 0;
+}
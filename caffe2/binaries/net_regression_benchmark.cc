@@ -0,0 +1,237 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times every iteration of a net under a fixed thread and CPU affinity
+// setting and writes the samples as JSON, along with a fingerprint of the
+// machine and the build, so that results of different builds can be
+// compared. It is the runner of caffe2/python/regression_benchmark.py, which
+// keeps the registry of benchmarked models and compares results against a
+// baseline, but it runs any init net and net pair:
+//
+//   net_regression_benchmark --init_net init.pb --net net.pb --iter 50
+//       --cpu_list 0-3 --num_workers 4 --json_output result.json
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/utsname.h>
+#endif
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/net.h"
+#include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(init_net, "", "The init net, run once before timing.");
+CAFFE2_DEFINE_string(net, "", "The net to time.");
+CAFFE2_DEFINE_string(
+    name,
+    "",
+    "The name of the benchmark in the results. Defaults to the net name.");
+CAFFE2_DEFINE_int(warmup, 10, "The number of untimed iterations.");
+CAFFE2_DEFINE_int(iter, 50, "The number of timed iterations.");
+CAFFE2_DEFINE_int(
+    num_workers,
+    -1,
+    "If not negative, overrides the num_workers of the net, the number of "
+    "threads of the DAG and async executors.");
+CAFFE2_DEFINE_string(
+    cpu_list,
+    "",
+    "CPUs the process, and every thread it creates, is pinned to, e.g. "
+    "0-3,8. If empty, the affinity is left alone.");
+CAFFE2_DEFINE_string(
+    json_output,
+    "",
+    "The file the results are written to. If empty, they are printed.");
+
+namespace caffe2 {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<int> ParseCpuList(const string& list) {
+  std::vector<int> cpus;
+  for (const auto& item : split(',', list)) {
+    if (item.empty()) {
+      continue;
+    }
+    const auto range = split('-', item);
+    CAFFE_ENFORCE(range.size() <= 2, "Bad CPU range ", item);
+    const int first = std::stoi(range[0]);
+    const int last = range.size() == 2 ? std::stoi(range[1]) : first;
+    CAFFE_ENFORCE(0 <= first && first <= last, "Bad CPU range ", item);
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// Pins the calling thread, which the threads created from now on inherit.
+// Thread pools are created lazily, when the nets first run, so this pins
+// them as well.
+void PinToCpus(const std::vector<int>& cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CAFFE_ENFORCE_LT(cpu, CPU_SETSIZE);
+    CPU_SET(cpu, &set);
+  }
+  CAFFE_ENFORCE_EQ(
+      sched_setaffinity(0, sizeof(set), &set), 0, "Cannot pin to the CPUs");
+#else
+  CAFFE_THROW("--cpu_list is only supported on Linux");
+#endif
+}
+
+string JsonString(const string& s) {
+  std::stringstream ss;
+  ss << '"';
+  for (unsigned char c : s) {
+    if (c == '"' || c == '\\') {
+      ss << '\\' << c;
+    } else if (c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      ss << escaped;
+    } else {
+      ss << c;
+    }
+  }
+  ss << '"';
+  return ss.str();
+}
+
+string CpuModel() {
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  string line;
+  while (std::getline(cpuinfo, line)) {
+    if (line.compare(0, 10, "model name") == 0) {
+      const auto colon = line.find(':');
+      if (colon != string::npos && colon + 2 <= line.size()) {
+        return line.substr(colon + 2);
+      }
+    }
+  }
+  return "unknown";
+}
+
+// What the timings depend on besides the code: the processor, the kernel,
+// the compiler and the options the build was configured with.
+string Fingerprint() {
+  std::stringstream ss;
+  ss << "{\"cpu_model\": " << JsonString(CpuModel())
+     << ", \"hardware_concurrency\": " << std::thread::hardware_concurrency();
+#ifdef __linux__
+  struct utsname name;
+  if (uname(&name) == 0) {
+    ss << ", \"kernel\": "
+       << JsonString(
+              string(name.sysname) + " " + name.release + " " +
+              name.machine);
+  }
+#endif
+#ifdef __VERSION__
+  ss << ", \"compiler\": " << JsonString(__VERSION__);
+#endif
+  ss << ", \"build_options\": {";
+  bool first = true;
+  for (const auto& option : GetBuildOptions()) {
+    ss << (first ? "" : ", ") << JsonString(option.first) << ": "
+       << JsonString(option.second);
+    first = false;
+  }
+  ss << "}}";
+  return ss.str();
+}
+
+void Run() {
+  CAFFE_ENFORCE(!FLAGS_net.empty(), "--net is required.");
+  CAFFE_ENFORCE_GT(FLAGS_iter, 0);
+  const auto cpus = ParseCpuList(FLAGS_cpu_list);
+  if (!cpus.empty()) {
+    PinToCpus(cpus);
+  }
+
+  Workspace workspace;
+  if (!FLAGS_init_net.empty()) {
+    NetDef init_net;
+    CAFFE_ENFORCE(ReadProtoFromFile(FLAGS_init_net, &init_net));
+    CAFFE_ENFORCE(workspace.RunNetOnce(init_net));
+  }
+  NetDef net_def;
+  CAFFE_ENFORCE(ReadProtoFromFile(FLAGS_net, &net_def));
+  if (FLAGS_num_workers >= 0) {
+    net_def.set_num_workers(FLAGS_num_workers);
+  }
+  NetBase* net = workspace.CreateNet(net_def);
+  CAFFE_ENFORCE(net, "Cannot create the net ", net_def.name());
+
+  for (int i = 0; i < FLAGS_warmup; ++i) {
+    CAFFE_ENFORCE(net->Run());
+  }
+  std::vector<double> samples_ms;
+  for (int i = 0; i < FLAGS_iter; ++i) {
+    const auto start = Clock::now();
+    CAFFE_ENFORCE(net->Run());
+    samples_ms.push_back(
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count());
+  }
+
+  std::stringstream ss;
+  ss.precision(6);
+  ss << std::fixed;
+  ss << "{\"name\": "
+     << JsonString(FLAGS_name.empty() ? net_def.name() : FLAGS_name)
+     << ", \"net_type\": "
+     << JsonString(net_def.has_type() ? net_def.type() : "simple")
+     << ", \"num_workers\": " << net_def.num_workers()
+     << ", \"cpu_list\": " << JsonString(FLAGS_cpu_list)
+     << ", \"warmup\": " << FLAGS_warmup << ", \"samples_ms\": [";
+  for (size_t i = 0; i < samples_ms.size(); ++i) {
+    ss << (i ? ", " : "") << samples_ms[i];
+  }
+  ss << "], \"fingerprint\": " << Fingerprint() << "}\n";
+
+  if (FLAGS_json_output.empty()) {
+    printf("%s", ss.str().c_str());
+  } else {
+    std::ofstream file(FLAGS_json_output);
+    file << ss.str();
+    CAFFE_ENFORCE(file, "Cannot write ", FLAGS_json_output);
+  }
+}
+
+} // namespace
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  caffe2::Run();
+  google::protobuf::ShutdownProtobufLibrary();
+  return 0;
+}
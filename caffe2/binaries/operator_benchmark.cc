@@ -0,0 +1,330 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Benchmarks individual operators for the shapes, types, engines and devices
+// given in a spec, one Google Benchmark per line of the spec. Every benchmark
+// reports the time per run and, for operators with a cost inference
+// function, GFLOP/s and GB/s of memory traffic. The results can be saved with
+//
+//   operator_benchmark --spec=ops.txt
+//       --benchmark_out=ops.json --benchmark_out_format=json
+//
+// and two such files compared with the compare.py script of Google
+// Benchmark to catch regressions between builds.
+//
+// Every non-empty line of the spec that does not start with '#' reads
+//
+//   <type> [engine=<engine>] [device=CPU|CUDA] [outputs=<n>]
+//       input=<dims>[:<type>[:~<max>|:=<value>]] ... [<arg>=<value>] ...
+//
+// where dims are separated by 'x', e.g. 1x64x56x56, and the input type is
+// one of float (the default), int32 and int64. Float inputs are drawn from
+// [-1, 1). Integer inputs are drawn from [0, max) with ~max, or all set to
+// value with =value, e.g. for SparseLengthsSum indices and lengths. The
+// remaining arguments become operator arguments: integers, floats,
+// comma-separated lists of integers or else strings. Without --spec a
+// default set of common operators is benchmarked.
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(
+    spec,
+    "",
+    "File with one operator to benchmark per line, see "
+    "operator_benchmark.cc. If empty, a default set is used.");
+
+namespace caffe2 {
+namespace {
+
+const char kDefaultSpec[] = R"SPEC(
+Conv input=1x64x56x56 input=64x64x3x3 input=64 kernel=3 pad=1
+Conv engine=NNPACK input=1x64x56x56 input=64x64x3x3 input=64 kernel=3 pad=1
+Conv engine=WINOGRAD input=1x64x56x56 input=64x64x3x3 input=64 kernel=3 pad=1
+Conv input=1x256x14x14 input=256x256x1x1 input=256 kernel=1
+Conv engine=DIRECT input=1x256x14x14 input=256x256x1x1 input=256 kernel=1
+FC input=64x1024 input=1024x1024 input=1024
+FC input=1x4096 input=1000x4096 input=1000
+# TT layers of a 1024x1024 FC against dense FCs with as many parameters
+TT input=64x1024 input=1024 input=8448 inp_sizes=4,8,8,4 out_sizes=4,8,8,4 tt_ranks=1,8,8,8,1
+FC input=64x1024 input=8x1024 input=8
+TT input=64x1024 input=1024 input=33280 inp_sizes=4,8,8,4 out_sizes=4,8,8,4 tt_ranks=1,16,16,16,1
+FC input=64x1024 input=32x1024 input=32
+BatchMatMul input=32x128x64 input=32x64x128
+SparseLengthsSum input=1000000x64 input=10240:int64:~1000000 input=256:int32:=40
+SparseLengthsSum input=1000000x128 input=10240:int64:~1000000 input=256:int32:=40
+Softmax input=64x1000
+Softmax input=1024x32
+Relu input=64x1024x32
+Add input=64x1024x32 input=64x1024x32
+Mul input=64x1024x32 input=64x1024x32
+)SPEC";
+
+struct InputSpec {
+  vector<TIndex> dims;
+  TensorProto::DataType data_type{TensorProto::FLOAT};
+  // Integer inputs are drawn from [0, max), or set to value if max is 0.
+  int64_t max{0};
+  int64_t value{0};
+};
+
+struct BenchmarkSpec {
+  string name;
+  OperatorDef def;
+  vector<InputSpec> inputs;
+};
+
+InputSpec ParseInput(const string& str) {
+  InputSpec input;
+  const auto fields = split(':', str);
+  CAFFE_ENFORCE(!fields.empty() && fields.size() <= 3, "Bad input: ", str);
+  for (const auto& dim : split('x', fields[0])) {
+    input.dims.push_back(std::stoll(dim));
+  }
+  if (fields.size() > 1) {
+    if (fields[1] == "float") {
+      input.data_type = TensorProto::FLOAT;
+    } else if (fields[1] == "int32") {
+      input.data_type = TensorProto::INT32;
+    } else if (fields[1] == "int64") {
+      input.data_type = TensorProto::INT64;
+    } else {
+      CAFFE_THROW("Unsupported input type: ", fields[1]);
+    }
+  }
+  if (fields.size() > 2) {
+    CAFFE_ENFORCE(
+        input.data_type != TensorProto::FLOAT,
+        "Only integer inputs take a range: ",
+        str);
+    const auto& range = fields[2];
+    CAFFE_ENFORCE(
+        range.size() > 1 && (range[0] == '~' || range[0] == '='),
+        "Bad input range: ",
+        range);
+    (range[0] == '~' ? input.max : input.value) = std::stoll(range.substr(1));
+  }
+  return input;
+}
+
+void AddParsedArgument(
+    const string& name,
+    const string& value,
+    OperatorDef* def) {
+  std::istringstream int_stream(value);
+  int64_t int_value;
+  if (int_stream >> int_value && int_stream.eof()) {
+    AddArgument(name, int_value, def);
+    return;
+  }
+  std::istringstream float_stream(value);
+  float float_value;
+  if (float_stream >> float_value && float_stream.eof()) {
+    AddArgument(name, float_value, def);
+    return;
+  }
+  if (value.find(',') != string::npos) {
+    vector<int64_t> ints;
+    for (const auto& item : split(',', value)) {
+      ints.push_back(std::stoll(item));
+    }
+    AddArgument(name, ints, def);
+    return;
+  }
+  AddArgument(name, value, def);
+}
+
+BenchmarkSpec ParseSpecLine(const string& line) {
+  vector<string> tokens;
+  std::istringstream stream(line);
+  string token;
+  while (stream >> token) {
+    tokens.push_back(token);
+  }
+  BenchmarkSpec spec;
+  spec.def.set_type(tokens[0]);
+  int num_outputs = 1;
+  string shapes;
+  string args;
+  for (int i = 1; i < tokens.size(); ++i) {
+    const auto pos = tokens[i].find('=');
+    CAFFE_ENFORCE(pos != string::npos, "Expected key=value, got ", tokens[i]);
+    const auto key = tokens[i].substr(0, pos);
+    const auto value = tokens[i].substr(pos + 1);
+    if (key == "engine") {
+      spec.def.set_engine(value);
+    } else if (key == "device") {
+      CAFFE_ENFORCE(value == "CPU" || value == "CUDA", "Bad device: ", value);
+      spec.def.mutable_device_option()->set_device_type(
+          value == "CPU" ? CPU : CUDA);
+    } else if (key == "outputs") {
+      num_outputs = std::stoi(value);
+      args += "/" + tokens[i];
+    } else if (key == "input") {
+      spec.def.add_input("in" + caffe2::to_string(spec.inputs.size()));
+      spec.inputs.push_back(ParseInput(value));
+      shapes += (shapes.empty() ? "" : ",") + value;
+    } else {
+      AddParsedArgument(key, value, &spec.def);
+      args += "/" + tokens[i];
+    }
+  }
+  for (int i = 0; i < num_outputs; ++i) {
+    spec.def.add_output("out" + caffe2::to_string(i));
+  }
+  spec.name = spec.def.type() + "/" +
+      (spec.def.engine().empty() ? "default" : spec.def.engine()) + "/" +
+      (spec.def.device_option().device_type() == CUDA ? "CUDA" : "CPU") + "/" +
+      shapes + args;
+  return spec;
+}
+
+vector<BenchmarkSpec> LoadSpecs() {
+  string text = kDefaultSpec;
+  if (!FLAGS_spec.empty()) {
+    CAFFE_ENFORCE(
+        ReadStringFromFile(FLAGS_spec.c_str(), &text),
+        "Cannot read ",
+        FLAGS_spec);
+  }
+  vector<BenchmarkSpec> specs;
+  for (const auto& line : split('\n', text)) {
+    const auto start = line.find_first_not_of(" \t");
+    if (start == string::npos || line[start] == '#') {
+      continue;
+    }
+    specs.push_back(ParseSpecLine(line));
+  }
+  return specs;
+}
+
+template <typename T>
+void FillInteger(
+    const InputSpec& input,
+    std::mt19937* gen,
+    TensorCPU* tensor) {
+  auto* data = tensor->mutable_data<T>();
+  if (input.max > 0) {
+    std::uniform_int_distribution<int64_t> dist(0, input.max - 1);
+    for (TIndex i = 0; i < tensor->size(); ++i) {
+      data[i] = dist(*gen);
+    }
+  } else {
+    std::fill(data, data + tensor->size(), static_cast<T>(input.value));
+  }
+}
+
+// Creates the inputs of the spec in the workspace, on the device of the
+// operator.
+void CreateInputs(const BenchmarkSpec& spec, Workspace* ws) {
+  std::mt19937 gen(1701);
+  for (int i = 0; i < spec.inputs.size(); ++i) {
+    const auto& input = spec.inputs[i];
+    const auto& name = spec.def.input(i);
+    const bool on_cpu = spec.def.device_option().device_type() == CPU;
+    auto* tensor =
+        ws->CreateBlob(on_cpu ? name : name + "_cpu")->GetMutable<TensorCPU>();
+    tensor->Resize(input.dims);
+    switch (input.data_type) {
+      case TensorProto::FLOAT: {
+        std::uniform_real_distribution<float> dist(-1, 1);
+        auto* data = tensor->mutable_data<float>();
+        for (TIndex j = 0; j < tensor->size(); ++j) {
+          data[j] = dist(gen);
+        }
+        break;
+      }
+      case TensorProto::INT32:
+        FillInteger<int32_t>(input, &gen, tensor);
+        break;
+      default:
+        FillInteger<int64_t>(input, &gen, tensor);
+        break;
+    }
+    if (!on_cpu) {
+      OperatorDef copy;
+      copy.set_type("CopyCPUToGPU");
+      copy.add_input(name + "_cpu");
+      copy.add_output(name);
+      copy.mutable_device_option()->CopyFrom(spec.def.device_option());
+      CAFFE_ENFORCE(CreateOperator(copy, ws)->Run());
+    }
+  }
+}
+
+void RunOperatorBenchmark(benchmark::State& state, const BenchmarkSpec& spec) {
+  Workspace ws;
+  unique_ptr<OperatorBase> op;
+  try {
+    CreateInputs(spec, &ws);
+    op = CreateOperator(spec.def, &ws);
+    // Warm up, which also allocates the outputs.
+    CAFFE_ENFORCE(op->Run(), "Operator failed.");
+  } catch (const std::exception& e) {
+    state.SkipWithError(e.what());
+    return;
+  }
+  if (op->engine() != spec.def.engine()) {
+    // CreateOperator fell back to the default engine.
+    state.SetLabel("engine unavailable");
+  }
+
+  while (state.KeepRunning()) {
+    op->Run();
+  }
+
+  const auto* schema = OpSchemaRegistry::Schema(spec.def.type());
+  if (schema && schema->HasCostInferenceFunction()) {
+    vector<TensorShape> shapes;
+    for (const auto& input : spec.inputs) {
+      shapes.push_back(CreateTensorShape(input.dims, input.data_type));
+    }
+    const auto cost = schema->InferCost(spec.def, shapes);
+    const double iterations = state.iterations();
+    state.counters["GFLOP"] = benchmark::Counter(
+        cost.flops * iterations / 1e9, benchmark::Counter::kIsRate);
+    state.counters["GB"] = benchmark::Counter(
+        (cost.bytes_read + cost.bytes_written) * iterations / 1e9,
+        benchmark::Counter::kIsRate);
+  }
+}
+
+} // namespace
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  // Google Benchmark removes its own flags before Caffe2 parses the rest.
+  benchmark::Initialize(&argc, argv);
+  caffe2::GlobalInit(&argc, &argv);
+  for (const auto& spec : caffe2::LoadSpecs()) {
+    benchmark::RegisterBenchmark(
+        spec.name.c_str(), caffe2::RunOperatorBenchmark, spec)
+        ->Unit(benchmark::kMicrosecond);
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
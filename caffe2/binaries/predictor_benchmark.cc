@@ -0,0 +1,263 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Benchmarks a predictor the way a service uses it. It first measures the
+// cold start: reading the nets, running the init_net that loads the
+// parameters, and the first run. Then, for every concurrency in --threads,
+// that many threads send --requests requests in total, either back to back
+// or, with --qps, at Poisson distributed arrival times. The latency of a
+// request is measured from its arrival, so it includes the time it waited
+// for a busy thread, and is reported as percentiles along with the
+// throughput.
+//
+// With --mode=concurrent the threads share one ConcurrentPredictor, with
+// --mode=replicated every thread gets a Predictor of its own, which costs a
+// copy of the parameters per thread.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/predictor.h"
+#include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(
+    meta_net,
+    "",
+    "MetaNetDef holding the init and predict nets. Alternative to "
+    "--init_net and --predict_net.");
+CAFFE2_DEFINE_string(init_net, "", "The init net, loading the parameters.");
+CAFFE2_DEFINE_string(predict_net, "", "The predict net.");
+CAFFE2_DEFINE_string(
+    input_dims,
+    "",
+    "Dimensions of the float inputs, fed to the first external inputs of "
+    "the predict net, comma separated, with inputs separated by semicolons.");
+CAFFE2_DEFINE_string(
+    threads,
+    "1,2,4,8",
+    "Comma separated numbers of concurrent threads to sweep.");
+CAFFE2_DEFINE_double(
+    qps,
+    0,
+    "Total rate of requests per second, with exponentially distributed "
+    "inter-arrival times. If 0, every thread sends its requests back to "
+    "back.");
+CAFFE2_DEFINE_int(requests, 1000, "Number of requests per concurrency.");
+CAFFE2_DEFINE_int(warmup, 10, "Number of requests per thread to warm up.");
+CAFFE2_DEFINE_string(
+    mode,
+    "concurrent",
+    "concurrent to share a ConcurrentPredictor between the threads, "
+    "replicated for a Predictor per thread.");
+
+namespace caffe2 {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double MillisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+std::vector<std::vector<TIndex>> ParseInputDims() {
+  std::vector<std::vector<TIndex>> inputs;
+  if (FLAGS_input_dims.empty()) {
+    return inputs;
+  }
+  for (const auto& input : split(';', FLAGS_input_dims)) {
+    std::vector<TIndex> dims;
+    for (const auto& dim : split(',', input)) {
+      dims.push_back(std::stoll(dim));
+    }
+    inputs.push_back(dims);
+  }
+  return inputs;
+}
+
+// Owns random inputs for one thread.
+struct Inputs {
+  explicit Inputs(int seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(-1, 1);
+    for (const auto& dims : ParseInputDims()) {
+      tensors.emplace_back(new TensorCPU(dims));
+      auto* data = tensors.back()->mutable_data<float>();
+      for (TIndex i = 0; i < tensors.back()->size(); ++i) {
+        data[i] = dist(gen);
+      }
+      vec.push_back(tensors.back().get());
+    }
+  }
+
+  std::vector<std::unique_ptr<TensorCPU>> tensors;
+  Predictor::TensorVector vec;
+};
+
+struct Nets {
+  NetDef init_net;
+  NetDef predict_net;
+};
+
+Nets LoadNets() {
+  Nets nets;
+  if (!FLAGS_meta_net.empty()) {
+    MetaNetDef meta_net;
+    CAFFE_ENFORCE(ReadProtoFromFile(FLAGS_meta_net, &meta_net));
+    const auto& consts = PredictorConsts::default_instance();
+    bool has_predict_net = false;
+    for (const auto& net : meta_net.nets()) {
+      if (net.key() == consts.global_init_net_type()) {
+        nets.init_net = net.value();
+      } else if (net.key() == consts.predict_net_type()) {
+        nets.predict_net = net.value();
+        has_predict_net = true;
+      }
+    }
+    CAFFE_ENFORCE(has_predict_net, "No predict net in ", FLAGS_meta_net);
+  } else {
+    CAFFE_ENFORCE(
+        !FLAGS_init_net.empty() && !FLAGS_predict_net.empty(),
+        "Use --meta_net, or --init_net and --predict_net.");
+    CAFFE_ENFORCE(ReadProtoFromFile(FLAGS_init_net, &nets.init_net));
+    CAFFE_ENFORCE(ReadProtoFromFile(FLAGS_predict_net, &nets.predict_net));
+  }
+  return nets;
+}
+
+// Runs `requests` requests from `num_threads` threads through run(thread,
+// inputs) and reports their latencies.
+template <typename RunFn>
+void RunLoad(int num_threads, RunFn run) {
+  const int requests_per_thread =
+      std::max(1, (FLAGS_requests + num_threads - 1) / num_threads);
+  std::vector<std::vector<double>> latencies(num_threads);
+  std::vector<std::thread> threads;
+  const auto start = Clock::now();
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      Inputs inputs(t);
+      for (int i = 0; i < FLAGS_warmup; ++i) {
+        CAFFE_ENFORCE(run(t, inputs.vec));
+      }
+      std::mt19937 gen(1701 + t);
+      std::exponential_distribution<double> inter_arrival(
+          FLAGS_qps > 0 ? FLAGS_qps / num_threads : 1);
+      auto arrival = Clock::now();
+      for (int i = 0; i < requests_per_thread; ++i) {
+        if (FLAGS_qps > 0) {
+          arrival += std::chrono::duration_cast<Clock::duration>(
+              std::chrono::duration<double>(inter_arrival(gen)));
+          std::this_thread::sleep_until(arrival);
+        } else {
+          arrival = Clock::now();
+        }
+        CAFFE_ENFORCE(run(t, inputs.vec));
+        latencies[t].push_back(MillisecondsSince(arrival));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const double seconds = MillisecondsSince(start) / 1000;
+
+  std::vector<double> all;
+  for (const auto& thread_latencies : latencies) {
+    all.insert(all.end(), thread_latencies.begin(), thread_latencies.end());
+  }
+  std::sort(all.begin(), all.end());
+  auto percentile = [&](double p) {
+    return all[std::min<size_t>(all.size() - 1, p * all.size())];
+  };
+  // The warmup requests are part of the elapsed time but few enough not to
+  // matter for the throughput.
+  printf(
+      "threads %3d: %9.1f requests/s, latency ms p50 %8.3f p90 %8.3f "
+      "p99 %8.3f p99.9 %8.3f max %8.3f\n",
+      num_threads,
+      all.size() / seconds,
+      percentile(0.5),
+      percentile(0.9),
+      percentile(0.99),
+      percentile(0.999),
+      all.back());
+}
+
+void Run() {
+  CAFFE_ENFORCE(
+      FLAGS_mode == "concurrent" || FLAGS_mode == "replicated",
+      "Unknown mode ",
+      FLAGS_mode);
+  auto start = Clock::now();
+  const auto nets = LoadNets();
+  const double load_ms = MillisecondsSince(start);
+
+  start = Clock::now();
+  ConcurrentPredictor shared(nets.init_net, nets.predict_net);
+  const double init_ms = MillisecondsSince(start);
+
+  Inputs inputs(0);
+  start = Clock::now();
+  ConcurrentPredictor::OutputVector outputs;
+  CAFFE_ENFORCE(shared.run(inputs.vec, &outputs));
+  const double first_run_ms = MillisecondsSince(start);
+  printf(
+      "cold start: %.3f ms reading the nets, %.3f ms running the init net, "
+      "%.3f ms for the first run\n",
+      load_ms,
+      init_ms,
+      first_run_ms);
+
+  for (const auto& item : split(',', FLAGS_threads)) {
+    const int num_threads = std::stoi(item);
+    CAFFE_ENFORCE_GT(num_threads, 0);
+    if (FLAGS_mode == "concurrent") {
+      RunLoad(num_threads, [&](int, const Predictor::TensorVector& in) {
+        ConcurrentPredictor::OutputVector out;
+        return shared.run(in, &out);
+      });
+    } else {
+      std::vector<std::unique_ptr<Predictor>> predictors;
+      for (int t = 0; t < num_threads; ++t) {
+        predictors.emplace_back(
+            new Predictor(nets.init_net, nets.predict_net));
+      }
+      RunLoad(num_threads, [&](int t, const Predictor::TensorVector& in) {
+        Predictor::TensorVector out;
+        return predictors[t]->run(in, &out);
+      });
+    }
+  }
+}
+
+} // namespace
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  caffe2::Run();
+  google::protobuf::ShutdownProtobufLibrary();
+  return 0;
+}
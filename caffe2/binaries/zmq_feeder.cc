@@ -17,22 +17,89 @@
 // This binary provides an easy way to open a zeromq server and feeds data to
 // clients connect to it. It uses the Caffe2 db as the backend, thus allowing
 // one to convert any db-compliant storage to a zeromq service.
+//
+// Several comma-separated server addresses may be given, in which case the
+// records are spread over them, each address being served by its own
+// thread. A ZmqDB can read from all of them at once.
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>  // NOLINT
+#include <utility>
 
 #include "caffe2/core/db.h"
 #include "caffe2/core/init.h"
 #include "caffe2/core/logging.h"
+#include "caffe2/utils/string_utils.h"
 #include "caffe2/utils/zmq_helper.h"
 
-CAFFE2_DEFINE_string(server, "tcp://*:5555", "The server address.");
+CAFFE2_DEFINE_string(
+    server,
+    "tcp://*:5555",
+    "The server address, or a comma-separated list of addresses.");
 CAFFE2_DEFINE_string(input_db, "", "The input db.");
 CAFFE2_DEFINE_string(input_db_type, "", "The input db type.");
+CAFFE2_DEFINE_int(
+    queue_size,
+    64,
+    "The number of records read ahead of the senders.");
 
 using caffe2::db::DB;
 using caffe2::db::Cursor;
 using caffe2::string;
 
+namespace {
+
+// Records read from the db that wait to be sent.
+class RecordQueue {
+ public:
+  explicit RecordQueue(size_t capacity) : capacity_(capacity) {}
+
+  void Push(std::pair<string, string>&& record) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return records_.size() < capacity_; });
+    records_.push_back(std::move(record));
+    not_empty_.notify_one();
+  }
+
+  std::pair<string, string> Pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return !records_.empty(); });
+    auto record = std::move(records_.front());
+    records_.pop_front();
+    not_full_.notify_one();
+    return record;
+  }
+
+ private:
+  const size_t capacity_;
+  std::deque<std::pair<string, string>> records_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_, not_full_;
+};
+
+void Serve(const string& address, RecordQueue* queue) {
+  //  Socket to talk to clients
+  caffe2::ZmqSocket sender(ZMQ_PUSH);
+  sender.Bind(address);
+  LOG(INFO) << "Server created at " << address;
+  while (1) {
+    auto record = queue->Pop();
+    VLOG(1) << "Sending " << record.first;
+    // The messages take over the strings, so zeromq does not copy them.
+    caffe2::ZmqMessage key(std::move(record.first));
+    caffe2::ZmqMessage value(std::move(record.second));
+    sender.SendTillSuccess(&key, ZMQ_SNDMORE);
+    sender.SendTillSuccess(&value, 0);
+  }
+}
+
+} // namespace
+
 int main(int argc, char** argv) {
   caffe2::GlobalInit(&argc, &argv);
+  CAFFE_ENFORCE_GT(caffe2::FLAGS_queue_size, 0, "queue_size must be positive.");
 
   LOG(INFO) << "Opening DB...";
   auto in_db = caffe2::db::CreateDB(
@@ -46,15 +113,15 @@ int main(int argc, char** argv) {
 
   LOG(INFO) << "Starting ZeroMQ server...";
 
-  //  Socket to talk to clients
-  caffe2::ZmqSocket sender(ZMQ_PUSH);
-  sender.Bind(caffe2::FLAGS_server);
-  LOG(INFO) << "Server created at " << caffe2::FLAGS_server;
+  RecordQueue queue(caffe2::FLAGS_queue_size);
+  std::vector<std::thread> senders;
+  for (const auto& address : caffe2::split(',', caffe2::FLAGS_server)) {
+    senders.emplace_back(Serve, address, &queue);
+  }
 
+  // Reading the db overlaps with sending the previous records.
   while (1) {
-    VLOG(1) << "Sending " << cursor->key();
-    sender.SendTillSuccess(cursor->key(), ZMQ_SNDMORE);
-    sender.SendTillSuccess(cursor->value(), 0);
+    queue.Push(std::make_pair(cursor->key(), cursor->value()));
     cursor->Next();
     if (!cursor->Valid()) {
       cursor->SeekToFirst();
@@ -15,6 +15,7 @@
  */
 
 #pragma once
+#include <algorithm>
 #include <unordered_map>
 #include <string>
 #include <ATen/ATen.h>
@@ -47,6 +48,8 @@ class ATenOp : public Operator<Context> {
   ATenOp(const OperatorDef& operator_def, Workspace* ws)
   : Operator<Context>(operator_def, ws) {
     VLOG(2) << "ATen OpDef: " << ProtoDebugString(operator_def) << "\n";
+    aten_inputs_.resize(InputSize());
+    aten_outputs_.resize(OutputSize());
     switch(findImplementation(operator_def)) {
       ${implementations}
       default:
@@ -63,6 +66,19 @@ private:
   std::function<bool()> run_op;
   at::Backend backend() const;
 
+  // An ATen tensor wrapping the memory of an input, reused for as long as
+  // the input keeps the same memory, type and shape.
+  struct WrappedInput {
+    const void* data = nullptr;
+    TypeMeta meta;
+    std::vector<TIndex> dims;
+    at::Tensor tensor;
+  };
+  std::vector<WrappedInput> aten_inputs_;
+  // The ATen tensors the outputs of the last run share their memory with.
+  // Operators with an _out variant write the next outputs into them.
+  std::vector<at::Tensor> aten_outputs_;
+
   TypeMeta typeMetaFor(const at::Tensor & t) {
     return typeMetaFor(t.type().scalarType());
   }
@@ -81,8 +97,21 @@ private:
   at::Type & typeFor(const Tensor<Context> & ten) {
     return at::getType(backend(), atScalarTypeFor(ten.meta()));
   }
-  at::Tensor tensorWrapping(Tensor<Context> & ten) {
-    return typeFor(ten).tensorFromBlob(ten.raw_mutable_data(), ten.dims());
+  at::Tensor tensorWrapping(const Tensor<Context> & ten) {
+    return typeFor(ten).tensorFromBlob(
+        const_cast<void*>(ten.raw_data()), ten.dims());
+  }
+  const at::Tensor & inputWrapping(int i) {
+    const auto & ten = Input(i);
+    auto & wrapped = aten_inputs_[i];
+    if (!wrapped.tensor.defined() || wrapped.data != ten.raw_data() ||
+        wrapped.meta != ten.meta() || wrapped.dims != ten.dims()) {
+      wrapped.tensor = tensorWrapping(ten);
+      wrapped.data = ten.raw_data();
+      wrapped.meta = ten.meta();
+      wrapped.dims = ten.dims();
+    }
+    return wrapped.tensor;
   }
   at::ScalarType atScalarTypeFor(const TypeMeta & meta) {
     #define DEFINE_IF(ctype,aten_name,_) \
@@ -93,12 +122,41 @@ private:
     #undef DEFINE_IF
     CAFFE_THROW("Unknown type meta"); // TODO: improve error message...
   }
-  void assignTo(Tensor<Context> * dst, const at::Tensor & src_) {
+  // Shares the memory of src with output i, unless the output already
+  // shares it, and keeps src for the _out variant of the next run.
+  void assignTo(int i, const at::Tensor & src_) {
     at::Tensor src = src_.contiguous();
+    auto * dst = Output(i);
     auto at_sizes = src.sizes();
-    std::vector<int64_t> dims(at_sizes.begin(),at_sizes.end());
-    dst->Resize(dims);
-    dst->ShareExternalPointer(src.data_ptr(), typeMetaFor(src), 0, deleterFor(src));
+    const auto meta = typeMetaFor(src);
+    if (dst->size() <= 0 || dst->raw_data() != src.data_ptr() ||
+        dst->meta() != meta || size_t(dst->ndim()) != at_sizes.size() ||
+        !std::equal(at_sizes.begin(), at_sizes.end(), dst->dims().begin())) {
+      std::vector<int64_t> dims(at_sizes.begin(),at_sizes.end());
+      dst->Resize(dims);
+      dst->ShareExternalPointer(src.data_ptr(), meta, 0, deleterFor(src));
+    }
+    aten_outputs_[i] = src;
+  }
+  // Whether the _out variant can write output i into the ATen tensor of the
+  // last run: the output still shares its memory, which no input does, as
+  // when the operator runs in place.
+  bool canReuseOutput(int i) {
+    const auto & result = aten_outputs_[i];
+    if (!result.defined()) {
+      return false;
+    }
+    auto * dst = Output(i);
+    if (dst->size() <= 0 || dst->raw_data() != result.data_ptr()) {
+      return false;
+    }
+    for (int j = 0; j < InputSize(); ++j) {
+      const auto & input = Input(j);
+      if (input.size() > 0 && input.raw_data() == result.data_ptr()) {
+        return false;
+      }
+    }
+    return true;
   }
 
   // the AT_FORALL_SCALAR_TYPES macro just gives a 'i' or 'd' argument
@@ -18,7 +18,7 @@ from __future__ import division
 from __future__ import print_function
 from __future__ import unicode_literals
 
-from caffe2.python import core
+from caffe2.python import core, workspace
 from hypothesis import given
 
 import caffe2.python.hypothesis_test_util as hu
@@ -92,6 +92,25 @@ class TestATen(hu.HypothesisTestCase):
 
         self.assertReferenceChecks(gc, op, [], ref)
 
+    def test_rerun(self):
+        # The second runs write into the outputs of the previous ones, which
+        # ATen resizes when the shapes change, except when running in place.
+        net = core.Net("aten_rerun")
+        net.ATen(["X", "Y"], ["Z"], operator="add")
+        net.ATen(["Z", "Y"], ["W"], operator="add")
+        net.ATen(["W", "Y"], ["W"], operator="add")
+        workspace.CreateNet(net)
+        for shape in [(2, 3), (2, 3), (4, 5), (1,)]:
+            X = np.random.randn(*shape).astype(np.float32)
+            Y = np.random.randn(*shape).astype(np.float32)
+            workspace.FeedBlob("X", X)
+            workspace.FeedBlob("Y", Y)
+            workspace.RunNet(net.Proto().name)
+            np.testing.assert_allclose(
+                workspace.FetchBlob("Z"), X + Y, rtol=1e-5, atol=1e-5)
+            np.testing.assert_allclose(
+                workspace.FetchBlob("W"), X + 3 * Y, rtol=1e-5, atol=1e-5)
+
 
 if __name__ == "__main__":
     import unittest
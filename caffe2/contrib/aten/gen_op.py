@@ -55,7 +55,7 @@ def value_is_tensor_type(v):
 
 # for each aten type, how do we handle a return value of that type?
 RETURN_MAP = {
-    'Tensor': 'assignTo(Output(${offset}),${output});',
+    'Tensor': 'assignTo(${offset}, ${output});',
     'Scalar': 'assignTo(Output(${offset}),*inferred_type, ${output});',
     'bool': 'assignToValue<int64_t>(Output(${offset}),${output});',
     'int64_t': 'assignToValue<int64_t>(Output(${offset}),${output});',
@@ -102,6 +102,26 @@ def supports(o):
 
 filtered = [o for o in decls if supports(o)]
 
+
+def out_variant_key(name, arguments):
+    return (name, tuple(sorted(a['name'] for a in arguments)))
+
+
+# the _out variants that write a single result into a given tensor, keyed by
+# the name and the arguments of the function they are a variant of. ATen
+# resizes the result only if needed, so the operator can write the outputs of
+# every run into the tensors of the previous one instead of allocating them.
+out_variants = {}
+for o in decls:
+    if (not o['name'].endswith('_out') or o['inplace'] or
+            'namespace' not in o['method_of']):
+        continue
+    outputs = [a for a in o['arguments'] if a.get('output', False)]
+    inputs = [a for a in o['arguments'] if not a.get('output', False)]
+    if len(outputs) != 1 or not value_is_tensor_type(outputs[0]):
+        continue
+    out_variants[out_variant_key(o['name'][:-len('_out')], inputs)] = o
+
 # template for each potential operator.
 # each operator has an integer 'key' associated with it, and
 # a lambda that defines the operator
@@ -120,6 +140,25 @@ case ${key}: { // ${name}
 } break;
 """)
 
+# same, for operators with an _out variant, which is used once the output of
+# a previous run can be reused
+OUT_OPTION_TEMPLATE = CT("""\
+case ${key}: { // ${name}
+    ${initialization}
+    run_op = [=] {
+        ${statements}
+        if (canReuseOutput(0)) {
+            ${out_invocation};
+            assignTo(0, aten_outputs_[0]);
+        } else {
+            auto the_result = ${invocation};
+            ${assignments}
+        }
+        return true;
+    };
+} break;
+""")
+
 
 def get_output(o, i):
     if len(o['returns']) == 1:
@@ -186,10 +225,9 @@ for o in filtered:
         env['arguments'].append(arg['name'])
         if value_is_tensor_type(arg):
             # load tensor inputs from Caffe2
-            env['statements'].append("auto {}_ = Input({});".format(arg['name'], i))
+            env['statements'].append(
+                "auto {} = inputWrapping({});".format(arg['name'], i))
             i += 1
-            env['statements'].append(CT(
-                "auto ${name} = tensorWrapping(${name}_);").substitute(arg))
             if arg['dynamic_type'] == 'Tensor' and not defined_inferred_type:
                 # first tensor input is used to define the output type.
                 defined_inferred_type = True
@@ -211,6 +249,17 @@ for o in filtered:
         assert('Type' in o['method_of'])
         env['invocation'] = CT('inferred_type->${name}(${arguments})').substitute(env)
 
-    top_env['implementations'].append(OPTION_TEMPLATE.substitute(env))
+    out_variant = None
+    if len(o['returns']) == 1 and value_is_tensor_type(o['returns'][0]):
+        out_variant = out_variants.get(
+            out_variant_key(o['name'], o['arguments']))
+    if out_variant is not None:
+        env['out_invocation'] = 'at::{}({})'.format(
+            out_variant['name'],
+            ', '.join('aten_outputs_[0]' if a.get('output', False)
+                      else a['name'] for a in out_variant['arguments']))
+        top_env['implementations'].append(OUT_OPTION_TEMPLATE.substitute(env))
+    else:
+        top_env['implementations'].append(OPTION_TEMPLATE.substitute(env))
     key += 1
 write("aten_op.h", OP_TEMPLATE.substitute(top_env))
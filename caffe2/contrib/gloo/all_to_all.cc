@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "caffe2/contrib/gloo/all_to_all.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "caffe2/core/logging.h"
+
+#include <gloo/allgather_ring.h>
+
+namespace caffe2 {
+namespace gloo {
+
+AllToAll::AllToAll(const std::shared_ptr<::gloo::Context>& context)
+    : context_(context),
+      counts_(context->size),
+      allCounts_(context->size * context->size) {
+  countsAlgorithm_.reset(new ::gloo::AllgatherRing<int64_t>(
+      context_, {counts_.data()}, allCounts_.data(), counts_.size()));
+}
+
+void AllToAll::reserve(size_t capacity) {
+  const auto size = context_->size;
+  // Double the capacity so that slowly growing messages do not recreate the
+  // buffers on every run.
+  capacity_ = std::max(capacity, 2 * capacity_);
+  sendArea_.resize(capacity_ * size);
+  recvArea_.resize(capacity_ * size);
+  sendBuffers_.clear();
+  recvBuffers_.clear();
+  sendBuffers_.resize(size);
+  recvBuffers_.resize(size);
+  const auto slot = context_->nextSlot();
+  for (auto i = 0; i < size; i++) {
+    if (i == context_->rank) {
+      continue;
+    }
+    auto& pair = context_->getPair(i);
+    sendBuffers_[i] =
+        pair->createSendBuffer(slot, &sendArea_[i * capacity_], capacity_);
+    recvBuffers_[i] =
+        pair->createRecvBuffer(slot, &recvArea_[i * capacity_], capacity_);
+  }
+}
+
+void AllToAll::run(
+    const std::vector<std::vector<char>>& send,
+    std::vector<std::vector<char>>* recv) {
+  const auto size = context_->size;
+  const auto rank = context_->rank;
+  CAFFE_ENFORCE_EQ(send.size(), size);
+  for (auto i = 0; i < size; i++) {
+    counts_[i] = send[i].size();
+  }
+  // A node can only get past this once every node has started the run, so
+  // no peer overwrites the receive area before this node has read it.
+  countsAlgorithm_->run();
+
+  const auto largest =
+      *std::max_element(allCounts_.begin(), allCounts_.end());
+  // Buffers are never empty, a zero byte send would send the whole buffer.
+  if (largest > capacity_ || capacity_ == 0) {
+    reserve(std::max<size_t>(largest, 1));
+  }
+
+  for (auto i = 0; i < size; i++) {
+    if (i == rank) {
+      continue;
+    }
+    if (!send[i].empty()) {
+      std::memcpy(&sendArea_[i * capacity_], send[i].data(), send[i].size());
+    }
+    sendBuffers_[i]->send(0, std::max<size_t>(send[i].size(), 1));
+  }
+
+  recv->resize(size);
+  (*recv)[rank] = send[rank];
+  for (auto i = 0; i < size; i++) {
+    if (i == rank) {
+      continue;
+    }
+    recvBuffers_[i]->waitRecv();
+    const char* data = &recvArea_[i * capacity_];
+    (*recv)[i].assign(data, data + allCounts_[i * size + rank]);
+  }
+  for (auto i = 0; i < size; i++) {
+    if (i != rank) {
+      sendBuffers_[i]->waitSend();
+    }
+  }
+}
+
+} // namespace gloo
+} // namespace caffe2
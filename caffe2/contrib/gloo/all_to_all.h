@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <gloo/algorithm.h>
+#include <gloo/context.h>
+#include <gloo/transport/buffer.h>
+
+namespace caffe2 {
+namespace gloo {
+
+// Exchanges a different number of bytes between every pair of nodes of a
+// common world. Every run first allgathers the byte counts, which also keeps
+// the nodes in lockstep from run to run, and then sends each peer its bytes
+// directly over the pair connecting the two nodes.
+class AllToAll {
+ public:
+  explicit AllToAll(const std::shared_ptr<::gloo::Context>& context);
+
+  // send[i] holds the bytes for node i. On return, (*recv)[i] holds the
+  // bytes node i sent to this node.
+  void run(
+      const std::vector<std::vector<char>>& send,
+      std::vector<std::vector<char>>* recv);
+
+  const std::shared_ptr<::gloo::Context>& context() const {
+    return context_;
+  }
+
+ private:
+  // Grows the per-peer staging areas and recreates the transport buffers.
+  // All nodes agree on the capacity, so they recreate them in the same run.
+  void reserve(size_t capacity);
+
+  std::shared_ptr<::gloo::Context> context_;
+  // Bytes this node sends to every node, and the counts of all nodes, with
+  // the count from node i to node j at i * size + j.
+  std::vector<int64_t> counts_;
+  std::vector<int64_t> allCounts_;
+  std::unique_ptr<::gloo::Algorithm> countsAlgorithm_;
+
+  size_t capacity_{0};
+  std::vector<char> sendArea_;
+  std::vector<char> recvArea_;
+  std::vector<std::unique_ptr<::gloo::transport::Buffer>> sendBuffers_;
+  std::vector<std::unique_ptr<::gloo::transport::Buffer>> recvBuffers_;
+};
+
+} // namespace gloo
+} // namespace caffe2
@@ -16,6 +16,7 @@
 
 #include "allreduce_ops.h"
 
+#include <gloo/allgather_ring.h>
 #include <gloo/allreduce_halving_doubling.h>
 #include <gloo/allreduce_ring.h>
 #include <gloo/allreduce_ring_chunked.h>
@@ -69,9 +70,36 @@ void AllreduceOp<Context>::initializeRingChunked() {
   }
 }
 
+template <>
+void AllreduceBucketOp<CPUContext>::allocateBucket(
+    int r,
+    size_t size,
+    const TypeMeta& meta) {
+  buckets_[r]->Resize(size);
+  buckets_[r]->raw_mutable_data(meta);
+}
+
+template <class Context>
+void AllreduceCompressedOp<Context>::initializeAllgather() {
+  // The messages are opaque bytes, the algorithm only copies them around.
+  this->algorithm_.reset(new ::gloo::AllgatherRing<char>(
+      this->init_.context,
+      {message_.template data<char>()},
+      gathered_.template mutable_data<char>(),
+      message_.size()));
+}
+
 namespace {
 
 REGISTER_CPU_OPERATOR_WITH_ENGINE(Allreduce, GLOO, AllreduceOp<CPUContext>);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    AllreduceBucket,
+    GLOO,
+    AllreduceBucketOp<CPUContext>);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    AllreduceCompressed,
+    GLOO,
+    AllreduceCompressedOp<CPUContext>);
 
 } // namespace
 } // namespace gloo
@@ -20,6 +20,7 @@
 
 #include "caffe2/contrib/gloo/common.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/utils/gradient_compression.h"
 #include "caffe2/utils/math.h"
 
 #include <gloo/algorithm.h>
@@ -30,7 +31,7 @@ namespace caffe2 {
 namespace gloo {
 
 template <class Context>
-class AllreduceOp final : public Operator<Context> {
+class AllreduceOp : public Operator<Context> {
   enum Mode { RING_FULL, RING_CHUNKED, HALVING_DOUBLING };
 
  public:
@@ -58,6 +59,7 @@ class AllreduceOp final : public Operator<Context> {
     update(current_);
     CAFFE_ENFORCE(current_ == init_, "Inputs/outputs have changed");
 
+    pack();
     try {
       algorithm_->run();
     } catch (::gloo::IoException& ioe) {
@@ -69,17 +71,34 @@ class AllreduceOp final : public Operator<Context> {
         throw ioe;
       }
     }
+    unpack();
     return true;
   }
 
  protected:
-  void initialize() {
+  virtual void initialize() {
     Mode mode = HALVING_DOUBLING;
-    auto bytes = Input(1).nbytes();
 
     // Store which inputs/outputs this instance initialized with
     update(init_);
+    verify();
 
+    switch (mode) {
+      case RING_FULL:
+        initializeRingFull();
+        return;
+      case RING_CHUNKED:
+        initializeRingChunked();
+        return;
+      case HALVING_DOUBLING:
+        initializeHalvingDoubling();
+        return;
+    }
+
+    CAFFE_ENFORCE(false, "Unreachable code");
+  }
+
+  virtual void verify() {
     // Verify inputs == ouputs
     CAFFE_ENFORCE_EQ(init_.inputs.size(), init_.outputs.size());
     for (auto i = 0; i < init_.inputs.size(); i++) {
@@ -97,22 +116,13 @@ class AllreduceOp final : public Operator<Context> {
     for (auto i = 2; i < InputSize(); i++) {
       CAFFE_ENFORCE(Input(i).meta() == meta);
     }
-
-    switch (mode) {
-      case RING_FULL:
-        initializeRingFull();
-        return;
-      case RING_CHUNKED:
-        initializeRingChunked();
-        return;
-      case HALVING_DOUBLING:
-        initializeHalvingDoubling();
-        return;
-    }
-
-    CAFFE_ENFORCE(false, "Unreachable code");
   }
 
+  // Hooks around the algorithm run for ops that do not reduce their inputs
+  // in place, see AllreduceBucketOp.
+  virtual void pack() {}
+  virtual void unpack() {}
+
   void initializeHalvingDoubling();
   void initializeRingFull();
   void initializeRingChunked();
@@ -162,7 +172,7 @@ class AllreduceOp final : public Operator<Context> {
     }
   };
 
-  void update(GlooParameters& params) {
+  virtual void update(GlooParameters& params) {
     params.context = OperatorBase::Input<std::shared_ptr<::gloo::Context>>(0);
     params.inputs.resize(InputSize() - 1);
     params.outputs.resize(OutputSize());
@@ -181,5 +191,236 @@ class AllreduceOp final : public Operator<Context> {
   const bool gpu_direct_;
 };
 
+// Allreduces a group of tensors of different sizes with a single Gloo
+// algorithm run. The inputs hold num_replicas copies of the same list of
+// tensors, laid out replica by replica. Every replica's tensors are packed
+// into one contiguous bucket before the run and unpacked again after it, so
+// that many small gradients pay the collective's latency only once.
+template <class Context>
+class AllreduceBucketOp final : public AllreduceOp<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  using typename AllreduceOp<Context>::GlooParameters;
+
+  AllreduceBucketOp(const OperatorDef& operator_def, Workspace* ws)
+      : AllreduceOp<Context>(operator_def, ws),
+        num_replicas_(
+            OperatorBase::GetSingleArgument<int>("num_replicas", 1)) {
+    CAFFE_ENFORCE_GT(num_replicas_, 0);
+    CAFFE_ENFORCE_EQ(
+        (InputSize() - 1) % num_replicas_,
+        0,
+        "Number of inputs must be a multiple of num_replicas");
+    num_tensors_ = (InputSize() - 1) / num_replicas_;
+    for (auto i = 0; i < num_replicas_; i++) {
+      buckets_.emplace_back(new Tensor<Context>());
+    }
+  }
+
+ protected:
+  void verify() override {
+    CAFFE_ENFORCE_EQ(InputSize() - 1, OutputSize());
+    TypeMeta meta = Input(1).meta();
+    for (auto r = 0; r < num_replicas_; r++) {
+      for (auto i = 0; i < num_tensors_; i++) {
+        const auto idx = r * num_tensors_ + i;
+        CAFFE_ENFORCE(
+            Input(idx + 1).raw_data() ==
+                Output(idx)->raw_data(),
+            "AllreduceBucket must run in place");
+        CAFFE_ENFORCE(Input(idx + 1).meta() == meta);
+        CAFFE_ENFORCE_EQ(Input(idx + 1).size(), Input(i + 1).size());
+      }
+    }
+  }
+
+  void update(GlooParameters& params) override {
+    params.context = OperatorBase::Input<std::shared_ptr<::gloo::Context>>(0);
+    params.size = 0;
+    for (auto i = 0; i < num_tensors_; i++) {
+      params.size += Input(i + 1).size();
+    }
+    params.meta = Input(1).meta();
+    params.inputs.resize(num_replicas_);
+    params.outputs.resize(num_replicas_);
+    for (auto r = 0; r < num_replicas_; r++) {
+      allocateBucket(r, params.size, params.meta);
+      params.inputs[r] = buckets_[r]->raw_data();
+      params.outputs[r] = buckets_[r]->raw_mutable_data(params.meta);
+    }
+  }
+
+  void pack() override {
+    // The bucket size only covers the first replica, make sure the others
+    // still match it before copying.
+    verify();
+    copyBuckets(true);
+  }
+
+  void unpack() override {
+    copyBuckets(false);
+  }
+
+  void copyBuckets(bool to_bucket) {
+    const auto itemsize = Input(1).meta().itemsize();
+    for (auto r = 0; r < num_replicas_; r++) {
+      auto* bucket = static_cast<char*>(buckets_[r]->raw_mutable_data());
+      for (auto i = 0; i < num_tensors_; i++) {
+        const auto idx = r * num_tensors_ + i;
+        auto* data = static_cast<char*>(Output(idx)->raw_mutable_data());
+        const auto nbytes = Output(idx)->size() * itemsize;
+        if (to_bucket) {
+          context_.template CopyBytes<Context, Context>(nbytes, data, bucket);
+        } else {
+          context_.template CopyBytes<Context, Context>(nbytes, bucket, data);
+        }
+        bucket += nbytes;
+      }
+    }
+    // The Gloo algorithms do not run on the operator's stream.
+    context_.FinishDeviceComputation();
+  }
+
+  // Sizes the bucket of replica r, placing it on the device of that
+  // replica's tensors.
+  void allocateBucket(int r, size_t size, const TypeMeta& meta);
+
+  int num_replicas_;
+  int num_tensors_;
+  std::vector<std::unique_ptr<Tensor<Context>>> buckets_;
+};
+
+// Allreduces float tensors while sending less than fp32 over the wire. Like
+// Allreduce, the inputs after the common world are the local replicas of one
+// tensor, reduced in place. They are first summed locally in fp32. Without
+// top_k, the local sum is cast to fp16 and reduced with the fp16 Gloo
+// algorithm. With top_k, the last input and output is an error-feedback
+// residual: every node only sends the top_k largest entries of its sum plus
+// residual, as fp16 values unless fp16 is false, and the messages of all nodes
+// are allgathered and summed in fp32. Only registered for CPU.
+template <class Context>
+class AllreduceCompressedOp final : public AllreduceOp<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  using typename AllreduceOp<Context>::GlooParameters;
+
+  AllreduceCompressedOp(const OperatorDef& operator_def, Workspace* ws)
+      : AllreduceOp<Context>(operator_def, ws),
+        top_k_(OperatorBase::GetSingleArgument<int>("top_k", 0)),
+        fp16_(OperatorBase::GetSingleArgument<bool>("fp16", true)),
+        num_replicas_(InputSize() - (top_k_ > 0 ? 2 : 1)) {
+    CAFFE_ENFORCE_GE(top_k_, 0);
+    CAFFE_ENFORCE_GT(num_replicas_, 0);
+  }
+
+ protected:
+  void initialize() override {
+    update(this->init_);
+    verify();
+    if (top_k_ > 0) {
+      initializeAllgather();
+    } else {
+      this->initializeHalvingDoubling();
+    }
+  }
+
+  void verify() override {
+    CAFFE_ENFORCE_EQ(InputSize() - 1, OutputSize());
+    for (auto i = 0; i < num_replicas_; i++) {
+      CAFFE_ENFORCE(
+          Input(i + 1).raw_data() == Output(i)->raw_data(),
+          "AllreduceCompressed must run in place");
+      CAFFE_ENFORCE(Input(i + 1).template IsType<float>());
+      CAFFE_ENFORCE_EQ(Input(i + 1).size(), Input(1).size());
+    }
+  }
+
+  void update(GlooParameters& params) override {
+    params.context = OperatorBase::Input<std::shared_ptr<::gloo::Context>>(0);
+    const int N = Input(1).size();
+    void* buffer = nullptr;
+    if (top_k_ > 0) {
+      const auto k = std::min(top_k_, N);
+      const auto bytes = compression::TopKMessageBytes(k, fp16_);
+      message_.Resize(bytes);
+      buffer = message_.template mutable_data<char>();
+      gathered_.Resize(bytes * params.context->size);
+      params.size = bytes;
+      params.meta = TypeMeta::Make<char>();
+    } else {
+      bucket_.Resize(N);
+      buffer = bucket_.template mutable_data<float16>();
+      params.size = N;
+      params.meta = TypeMeta::Make<float16>();
+    }
+    params.inputs.assign(1, buffer);
+    params.outputs.assign(1, buffer);
+  }
+
+  void pack() override {
+    verify();
+    const int N = Input(1).size();
+    sum_.Resize(N);
+    float* sum = sum_.template mutable_data<float>();
+    context_.template Copy<float, Context, Context>(
+        N, Output(0)->template data<float>(), sum);
+    for (auto i = 1; i < num_replicas_; i++) {
+      math::Add<float, Context>(
+          N, sum, Output(i)->template data<float>(), sum, &context_);
+    }
+    if (top_k_ == 0) {
+      compression::FloatToHalf(
+          N, sum, bucket_.template mutable_data<float16>());
+      return;
+    }
+    auto* residual = Output(num_replicas_);
+    if (residual->size() != N) {
+      residual->Resize(N);
+      math::Set<float, Context>(
+          N, 0.f, residual->template mutable_data<float>(), &context_);
+    }
+    compression::EncodeTopK(
+        N,
+        std::min(top_k_, N),
+        fp16_,
+        sum,
+        residual->template mutable_data<float>(),
+        message_.template mutable_data<char>());
+  }
+
+  void unpack() override {
+    const int N = Input(1).size();
+    float* result = Output(0)->template mutable_data<float>();
+    if (top_k_ == 0) {
+      compression::HalfToFloat(N, bucket_.template data<float16>(), result);
+    } else {
+      math::Set<float, Context>(N, 0.f, result, &context_);
+      const auto* gathered = gathered_.template data<char>();
+      const auto bytes = message_.size();
+      for (auto i = 0; i < gathered_.size() / bytes; i++) {
+        compression::DecodeTopKAccumulate(
+            N, std::min(top_k_, N), fp16_, gathered + i * bytes, result);
+      }
+    }
+    for (auto i = 1; i < num_replicas_; i++) {
+      context_.template Copy<float, Context, Context>(
+          N, result, Output(i)->template mutable_data<float>());
+    }
+  }
+
+  void initializeAllgather();
+
+  const int top_k_;
+  const bool fp16_;
+  const int num_replicas_;
+  // fp32 sum of the local replicas.
+  Tensor<Context> sum_;
+  // fp16 copy of sum_ that is allreduced when top_k is not set.
+  Tensor<Context> bucket_;
+  // This node's top-k message and the messages of all nodes.
+  Tensor<Context> message_;
+  Tensor<Context> gathered_;
+};
+
 } // namespace gloo
 } // namespace caffe2
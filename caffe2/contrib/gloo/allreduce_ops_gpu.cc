@@ -116,9 +116,26 @@ void AllreduceOp<Context>::initializeRingChunked() {
   }
 }
 
+template <>
+void AllreduceBucketOp<CUDAContext>::allocateBucket(
+    int r,
+    size_t size,
+    const TypeMeta& meta) {
+  // Gloo reduces the buckets of all replicas itself, each one has to live on
+  // the same GPU as the tensors it is packed from.
+  DeviceGuard guard(
+      GetGPUIDForPointer(Input(1 + r * num_tensors_).raw_data()));
+  buckets_[r]->Resize(size);
+  buckets_[r]->raw_mutable_data(meta);
+}
+
 namespace {
 
 REGISTER_CUDA_OPERATOR_WITH_ENGINE(Allreduce, GLOO, AllreduceOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR_WITH_ENGINE(
+    AllreduceBucket,
+    GLOO,
+    AllreduceBucketOp<CUDAContext>);
 
 } // namespace
 } // namespace gloo
@@ -43,6 +43,10 @@ void BroadcastOp<Context>::initializeAlgorithm() {
 namespace {
 
 REGISTER_CPU_OPERATOR_WITH_ENGINE(Broadcast, GLOO, BroadcastOp<CPUContext>);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    PipelinedBroadcast,
+    GLOO,
+    PipelinedBroadcastOp);
 
 } // namespace
 } // namespace gloo
@@ -19,6 +19,7 @@
 #include <algorithm>
 
 #include "caffe2/contrib/gloo/common.h"
+#include "caffe2/contrib/gloo/pipelined_broadcast.h"
 #include "caffe2/core/operator.h"
 
 #include <gloo/algorithm.h>
@@ -161,5 +162,69 @@ class BroadcastOp final : public Operator<Context> {
   std::string status_blob_;
 };
 
+// Broadcasts a list of CPU tensors of any sizes and types in a single
+// collective, with a PipelinedBroadcast in chunks of chunk_size_bytes.
+class PipelinedBroadcastOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+
+  PipelinedBroadcastOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        root_(GetSingleArgument<int>("root", 0)),
+        chunkBytes_(GetSingleArgument<int64_t>("chunk_size_bytes", 1 << 22)),
+        ws_(ws),
+        status_blob_(GetSingleArgument<std::string>("status_blob", "")) {
+    CAFFE_ENFORCE_GT(chunkBytes_, 0, "chunk_size_bytes must be positive.");
+    if (status_blob_ != "") {
+      ws_->CreateBlob(status_blob_);
+    }
+  }
+
+  bool RunOnDevice() override {
+    const auto& context =
+        OperatorBase::Input<std::shared_ptr<::gloo::Context>>(0);
+    std::vector<std::pair<void*, size_t>> buffers;
+    for (auto i = 0; i < OutputSize(); i++) {
+      auto* output = Output(i);
+      CAFFE_ENFORCE(
+          output->meta().copy() == nullptr,
+          "Only tensors of fundamental types can be broadcast");
+      buffers.emplace_back(output->raw_mutable_data(), output->nbytes());
+    }
+    std::call_once(once_, [&] {
+      algorithm_.reset(
+          new PipelinedBroadcast(context, buffers, root_, chunkBytes_));
+      buffers_ = buffers;
+    });
+    // The buffers were registered with the transport when first run.
+    CAFFE_ENFORCE(
+        context == algorithm_->context() && buffers == buffers_,
+        "Inputs/outputs have changed");
+
+    try {
+      algorithm_->run();
+    } catch (::gloo::IoException& ioe) {
+      LOG(ERROR) << "Caught gloo IO exception: " << ioe.what();
+      if (status_blob_ != "") {
+        signalFailure(ws_->GetBlob(status_blob_), ioe);
+        return false;
+      } else {
+        throw ioe;
+      }
+    }
+    return true;
+  }
+
+ protected:
+  const int root_;
+  const int64_t chunkBytes_;
+  Workspace* ws_;
+  std::string status_blob_;
+
+  std::once_flag once_;
+  std::unique_ptr<PipelinedBroadcast> algorithm_;
+  std::vector<std::pair<void*, size_t>> buffers_;
+};
+
 } // namespace gloo
 } // namespace caffe2
@@ -0,0 +1,277 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "caffe2/contrib/gloo/common_world_cache.h"
+
+#include <cstring>
+#include <random>
+#include <sstream>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+
+#include <gloo/transport/address.h>
+#include <gloo/transport/pair.h>
+
+namespace caffe2 {
+namespace gloo {
+
+namespace {
+
+// Context made of pairs that were connected elsewhere.
+class ReusedContext : public ::gloo::Context {
+ public:
+  ReusedContext(
+      int rank,
+      int size,
+      std::shared_ptr<::gloo::transport::Device> device,
+      std::vector<std::unique_ptr<::gloo::transport::Pair>> pairs,
+      int slot)
+      : ::gloo::Context(rank, size) {
+    device_ = std::move(device);
+    pairs_ = std::move(pairs);
+    slot_ = slot;
+  }
+};
+
+// What a member announces before connecting: its token, the slot to continue
+// from and, per member, the token of the peer its live pair to it was
+// connected with (0 if there is none).
+struct State {
+  uint64_t token = 0;
+  int slot = 0;
+  std::vector<uint64_t> peerTokens;
+};
+
+std::string serialize(const State& state) {
+  std::ostringstream out;
+  out << state.token << " " << state.slot;
+  for (auto peerToken : state.peerTokens) {
+    out << " " << peerToken;
+  }
+  return out.str();
+}
+
+State deserialize(const std::string& data, size_t size) {
+  std::istringstream in(data);
+  State state;
+  in >> state.token >> state.slot;
+  state.peerTokens.resize(size);
+  for (auto& peerToken : state.peerTokens) {
+    in >> peerToken;
+  }
+  CAFFE_ENFORCE(!in.fail(), "Malformed common world state: ", data);
+  return state;
+}
+
+uint64_t newToken() {
+  static std::mutex mutex;
+  static std::mt19937_64 engine{std::random_device()()};
+  std::lock_guard<std::mutex> guard(mutex);
+  uint64_t token = 0;
+  while (token == 0) {
+    token = engine();
+  }
+  return token;
+}
+
+// Addresses of the new pairs, one length prefixed entry per member.
+std::string serialize(const std::vector<std::vector<char>>& addresses) {
+  std::string out;
+  for (const auto& address : addresses) {
+    const uint32_t length = address.size();
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.append(address.data(), address.size());
+  }
+  return out;
+}
+
+std::vector<char> addressAt(const std::string& data, int index) {
+  size_t offset = 0;
+  for (int i = 0;; i++) {
+    uint32_t length = 0;
+    CAFFE_ENFORCE_LE(offset + sizeof(length), data.size());
+    memcpy(&length, data.data() + offset, sizeof(length));
+    offset += sizeof(length);
+    CAFFE_ENFORCE_LE(offset + length, data.size());
+    if (i == index) {
+      return std::vector<char>(
+          data.data() + offset, data.data() + offset + length);
+    }
+    offset += length;
+  }
+}
+
+} // namespace
+
+CommonWorldCache& CommonWorldCache::get() {
+  static CommonWorldCache cache;
+  return cache;
+}
+
+std::shared_ptr<::gloo::Context> CommonWorldCache::connect(
+    const std::string& name,
+    const std::vector<std::string>& members,
+    int rank,
+    StoreHandler& store,
+    const std::shared_ptr<::gloo::transport::Device>& device,
+    std::chrono::milliseconds timeout) {
+  const int size = members.size();
+  CAFFE_ENFORCE(rank >= 0 && rank < size);
+  const auto& self = members[rank];
+
+  // Take this member's common world out of the cache, it is either reused
+  // or replaced.
+  Entry old;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = entries_.find(self);
+    if (it != entries_.end()) {
+      old = std::move(it->second);
+      entries_.erase(it);
+      for (auto clone = clones_.begin(); clone != clones_.end();) {
+        if (clone->second.existing.lock() == old.context) {
+          clone = clones_.erase(clone);
+        } else {
+          ++clone;
+        }
+      }
+    }
+  }
+
+  State state;
+  state.token = old.context ? old.token : newToken();
+  state.slot = old.context ? old.context->nextSlot() : 0;
+  state.peerTokens.assign(size, 0);
+  std::unordered_map<std::string, int> oldRanks;
+  for (int i = 0; old.context && i < old.members.size(); i++) {
+    if (old.context->getPair(i)) {
+      oldRanks[old.members[i]] = i;
+    }
+  }
+  for (int i = 0; i < size; i++) {
+    auto it = oldRanks.find(members[i]);
+    if (i != rank && it != oldRanks.end()) {
+      state.peerTokens[i] = old.peerTokens[it->second];
+    }
+  }
+
+  auto key = [&](const std::string& kind, int i) {
+    return name + "/" + kind + "_" + caffe2::to_string(i);
+  };
+  std::vector<std::string> keys;
+  for (int i = 0; i < size; i++) {
+    keys.push_back(key("state", i));
+  }
+  store.set(keys[rank], serialize(state));
+  store.wait(keys, timeout);
+  std::vector<State> states;
+  for (const auto& data : store.multiGet(keys, timeout)) {
+    states.push_back(deserialize(data, size));
+  }
+
+  // A pair is kept if both ends hold it from the same earlier connection,
+  // which every member decides the same way from the states.
+  Entry entry;
+  entry.token = state.token;
+  entry.members = members;
+  entry.peerTokens.assign(size, 0);
+  int slot = 0;
+  std::vector<std::unique_ptr<::gloo::transport::Pair>> pairs(size);
+  std::vector<std::vector<char>> addresses(size);
+  std::vector<int> connect;
+  for (int i = 0; i < size; i++) {
+    slot = std::max(slot, states[i].slot);
+    if (i == rank) {
+      continue;
+    }
+    entry.peerTokens[i] = states[i].token;
+    if (state.peerTokens[i] == states[i].token &&
+        states[i].peerTokens[rank] == state.token) {
+      pairs[i] = std::move(old.context->getPair(oldRanks[members[i]]));
+    } else {
+      pairs[i] = device->createPair(timeout);
+      addresses[i] = pairs[i]->address().bytes();
+      connect.push_back(i);
+    }
+  }
+  VLOG(1) << "Common world " << name << " reuses "
+          << size - 1 - connect.size() << " of " << size - 1 << " pairs";
+
+  // The decision is symmetric, so only members that connect new pairs need
+  // each other's addresses.
+  if (!connect.empty()) {
+    store.set(key("addr", rank), serialize(addresses));
+    std::vector<std::string> addrKeys;
+    for (auto i : connect) {
+      addrKeys.push_back(key("addr", i));
+    }
+    store.wait(addrKeys, timeout);
+    auto data = store.multiGet(addrKeys, timeout);
+    for (int j = 0; j < connect.size(); j++) {
+      pairs[connect[j]]->connect(addressAt(data[j], rank));
+    }
+  }
+
+  entry.context = std::make_shared<ReusedContext>(
+      rank, size, device, std::move(pairs), slot);
+  entry.context->setTimeout(timeout);
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    entries_[self] = entry;
+  }
+  return entry.context;
+}
+
+std::shared_ptr<::gloo::Context> CommonWorldCache::findClone(
+    const std::string& name,
+    const std::shared_ptr<::gloo::Context>& existing) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = clones_.find(name);
+  if (it == clones_.end() || it->second.existing.lock() != existing) {
+    return nullptr;
+  }
+  return it->second.clone;
+}
+
+void CommonWorldCache::addClone(
+    const std::string& name,
+    const std::shared_ptr<::gloo::Context>& existing,
+    const std::shared_ptr<::gloo::Context>& clone) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  clones_[name] = Clone{existing, clone};
+}
+
+void CommonWorldCache::erase(const std::shared_ptr<::gloo::Context>& context) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.context == context) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (auto it = clones_.begin(); it != clones_.end();) {
+    if (it->second.clone == context ||
+        it->second.existing.lock() == context) {
+      it = clones_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+} // namespace gloo
+} // namespace caffe2
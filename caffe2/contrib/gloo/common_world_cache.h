@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "caffe2/distributed/store_handler.h"
+
+#include <gloo/context.h>
+#include <gloo/transport/device.h>
+
+namespace caffe2 {
+namespace gloo {
+
+// Process wide cache of the common worlds created by CreateCommonWorld with
+// a member list and by CloneCommonWorld with reuse set, so that running these
+// ops again reuses the connections that are already established.
+//
+// A common world created from a member list is cached under this node's
+// member id. When it is created again, say after a membership change or
+// after the nets were torn down, the members first exchange which pairs they
+// still hold: a pair is kept if both of its ends still hold it from the same
+// earlier connection, and only the other pairs are connected anew. The
+// common world that was cached before is consumed by this: its kept pairs
+// move to the new one and it must not be used any more.
+class CommonWorldCache {
+ public:
+  static CommonWorldCache& get();
+
+  // Rendezvous of member members[rank] with the others through the store,
+  // keeping the healthy pairs of the common world cached for this member.
+  // Keys are prefixed with name, which should be unique per rendezvous.
+  std::shared_ptr<::gloo::Context> connect(
+      const std::string& name,
+      const std::vector<std::string>& members,
+      int rank,
+      StoreHandler& store,
+      const std::shared_ptr<::gloo::transport::Device>& device,
+      std::chrono::milliseconds timeout);
+
+  // Returns the clone made with this name from existing, if any.
+  std::shared_ptr<::gloo::Context> findClone(
+      const std::string& name,
+      const std::shared_ptr<::gloo::Context>& existing);
+
+  void addClone(
+      const std::string& name,
+      const std::shared_ptr<::gloo::Context>& existing,
+      const std::shared_ptr<::gloo::Context>& clone);
+
+  // Forgets about context, e.g. because its connections were closed.
+  void erase(const std::shared_ptr<::gloo::Context>& context);
+
+ private:
+  struct Entry {
+    // Identifies this member's connections, a restarted member has a new
+    // token and none of its old pairs are kept.
+    uint64_t token;
+    std::vector<std::string> members;
+    // Token of every member at the time the pair to it was connected.
+    std::vector<uint64_t> peerTokens;
+    std::shared_ptr<::gloo::Context> context;
+  };
+
+  struct Clone {
+    std::weak_ptr<::gloo::Context> existing;
+    std::shared_ptr<::gloo::Context> clone;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::unordered_map<std::string, Clone> clones_;
+};
+
+} // namespace gloo
+} // namespace caffe2
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "caffe2/contrib/gloo/common.h"
+#include "caffe2/contrib/gloo/common_world_cache.h"
 #include "caffe2/contrib/gloo/store_handler.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/distributed/store_handler.h"
@@ -54,10 +55,17 @@ class CreateCommonWorld final : public Operator<Context> {
         status_blob_(
             OperatorBase::GetSingleArgument<std::string>("status_blob", "")),
         timeout_ms_(OperatorBase::GetSingleArgument<int>("timeout_ms", -1)),
+        members_(OperatorBase::template GetRepeatedArgument<std::string>(
+            "members")),
         ws_(ws) {
     CAFFE_ENFORCE(
         operator_def.has_name(), "CreateCommonWorld operator requires name");
     CAFFE_ENFORCE(rank_ >= 0 && rank_ < size_);
+    if (!members_.empty()) {
+      CAFFE_ENFORCE_EQ(members_.size(), size_, "Expected a member per rank");
+      CAFFE_ENFORCE(
+          !mpi_rendezvous_, "Members are not supported with MPI rendezvous");
+    }
     name_ = operator_def.name();
     if (status_blob_ != "") {
       ws_->CreateBlob(status_blob_);
@@ -96,6 +104,14 @@ class CreateCommonWorld final : public Operator<Context> {
     return context;
   }
 
+  CommonWorld rendezvousWithCache(
+      const std::unique_ptr<StoreHandler>& handler) {
+    auto timeout = timeout_ms_ != -1 ? std::chrono::milliseconds(timeout_ms_)
+                                     : StoreHandler::kDefaultTimeout;
+    return CommonWorldCache::get().connect(
+        name_, members_, rank_, *handler, device_, timeout);
+  }
+
   bool RunOnDevice() override {
     try {
       CommonWorld context;
@@ -105,7 +121,8 @@ class CreateCommonWorld final : public Operator<Context> {
         CAFFE_ENFORCE_EQ(InputSize(), 1, "Expected store handler input");
         const auto& handler =
             OperatorBase::Input<std::unique_ptr<StoreHandler>>(STORE_HANDLER);
-        context = rendezvousWithStore(handler);
+        context = members_.empty() ? rendezvousWithStore(handler)
+                                   : rendezvousWithCache(handler);
       }
 
       // Switch pairs to synchronous mode if configured to do so
@@ -165,6 +182,7 @@ class CreateCommonWorld final : public Operator<Context> {
   const bool mpi_rendezvous_;
   const std::string status_blob_;
   const int timeout_ms_;
+  const std::vector<std::string> members_;
   Workspace* ws_;
 
   std::string name_;
@@ -184,9 +202,12 @@ class CloneCommonWorld final : public Operator<Context> {
   CloneCommonWorld(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
         sync_(OperatorBase::template GetSingleArgument<bool>("sync", false)),
+        reuse_(OperatorBase::template GetSingleArgument<bool>("reuse", false)),
         ws_(ws),
         status_blob_(
             OperatorBase::GetSingleArgument<std::string>("status_blob", "")) {
+    name_ = operator_def.has_name() ? operator_def.name()
+                                    : operator_def.output(0);
     if (status_blob_ != "") {
       ws_->CreateBlob(status_blob_);
     }
@@ -197,6 +218,13 @@ class CloneCommonWorld final : public Operator<Context> {
   bool RunOnDevice() override {
     try {
       auto existing = OperatorBase::Input<CommonWorld>(EXISTING_COMM);
+      if (reuse_) {
+        auto clone = CommonWorldCache::get().findClone(name_, existing);
+        if (clone) {
+          *OperatorBase::Output<CommonWorld>(CLONED_COMM) = std::move(clone);
+          return true;
+        }
+      }
       ::gloo::rendezvous::ContextFactory factory(existing);
       auto clone = factory.makeContext(existing->getDevice());
 
@@ -210,6 +238,9 @@ class CloneCommonWorld final : public Operator<Context> {
         }
       }
 
+      if (reuse_) {
+        CommonWorldCache::get().addClone(name_, existing, clone);
+      }
       *OperatorBase::Output<CommonWorld>(CLONED_COMM) = std::move(clone);
     } catch (::gloo::IoException& ioe) {
       LOG(ERROR) << "Caught gloo IO exception: " << ioe.what();
@@ -229,8 +260,10 @@ class CloneCommonWorld final : public Operator<Context> {
   }
 
   const bool sync_;
+  const bool reuse_;
   Workspace* ws_;
   std::string status_blob_;
+  std::string name_;
 
   INPUT_TAGS(EXISTING_COMM);
   OUTPUT_TAGS(CLONED_COMM);
@@ -252,6 +285,7 @@ class DestroyCommonWorld final : public Operator<CPUContext> {
 
     if (context) {
       LOG(INFO) << "Closing connections: " << cw_name_;
+      CommonWorldCache::get().erase(context);
       context->closeConnections();
     }
     return true;
@@ -376,6 +376,271 @@ class TestCase(hu.HypothesisTestCase):
                     device_option=device_option,
                     tmpdir=tmpdir)
 
+    def _test_allreduce_bucket(self,
+                               comm_rank=None,
+                               comm_size=None,
+                               blob_sizes=None,
+                               num_replicas=None,
+                               tmpdir=None
+                               ):
+        store_handler, common_world = self.create_common_world(
+            comm_rank=comm_rank,
+            comm_size=comm_size,
+            tmpdir=tmpdir)
+
+        blob_sizes = self.synchronize(
+            store_handler,
+            blob_sizes,
+            comm_rank=comm_rank)
+
+        num_replicas = self.synchronize(
+            store_handler,
+            num_replicas,
+            comm_rank=comm_rank)
+
+        # Replica by replica, each replica holding all the blob sizes
+        blobs = []
+        for r in range(num_replicas):
+            for i, blob_size in enumerate(blob_sizes):
+                blob = "blob_{}_{}".format(r, i)
+                value = np.full(
+                    blob_size, comm_rank * num_replicas + r + i, np.float32)
+                workspace.FeedBlob(blob, value)
+                blobs.append(blob)
+
+        net = core.Net("allreduce_bucket")
+        net.AllreduceBucket(
+            [common_world] + blobs,
+            blobs,
+            num_replicas=num_replicas,
+            engine=op_engine)
+
+        workspace.CreateNet(net)
+        workspace.RunNet(net.Name())
+
+        n = comm_size * num_replicas
+        for r in range(num_replicas):
+            for i, blob_size in enumerate(blob_sizes):
+                result = workspace.FetchBlob("blob_{}_{}".format(r, i))
+                self.assertEqual(result.size, blob_size)
+                np.testing.assert_array_equal(
+                    result, n * (n - 1) / 2 + n * i)
+
+        # Run the net a few more times to check the operator
+        # works not just the first time it's called
+        for _tmp in range(4):
+            workspace.RunNet(net.Name())
+
+    @given(comm_size=st.integers(min_value=2, max_value=8),
+           blob_sizes=st.lists(
+               st.integers(min_value=1, max_value=1e4),
+               min_size=1,
+               max_size=8),
+           num_replicas=st.integers(min_value=1, max_value=3),
+           device_option=st.sampled_from([hu.cpu_do]))
+    def test_allreduce_bucket(self, comm_size, blob_sizes, num_replicas,
+                              device_option):
+        TestCase.test_counter += 1
+        if os.getenv('COMM_RANK') is not None:
+            self.run_test_distributed(
+                self._test_allreduce_bucket,
+                blob_sizes=blob_sizes,
+                num_replicas=num_replicas,
+                device_option=device_option)
+        else:
+            with TemporaryDirectory() as tmpdir:
+                self.run_test_locally(
+                    self._test_allreduce_bucket,
+                    comm_size=comm_size,
+                    blob_sizes=blob_sizes,
+                    num_replicas=num_replicas,
+                    device_option=device_option,
+                    tmpdir=tmpdir)
+
+    def _test_allreduce_compressed(self,
+                                   comm_rank=None,
+                                   comm_size=None,
+                                   blob_size=None,
+                                   num_blobs=None,
+                                   top_k=None,
+                                   tmpdir=None
+                                   ):
+        store_handler, common_world = self.create_common_world(
+            comm_rank=comm_rank,
+            comm_size=comm_size,
+            tmpdir=tmpdir)
+
+        blob_size = self.synchronize(
+            store_handler,
+            blob_size,
+            comm_rank=comm_rank)
+
+        num_blobs = self.synchronize(
+            store_handler,
+            num_blobs,
+            comm_rank=comm_rank)
+
+        top_k = self.synchronize(
+            store_handler,
+            top_k,
+            comm_rank=comm_rank)
+
+        # Every node has the same entries as the largest ones, so that they
+        # all send the same top_k entries.
+        blobs = []
+        for i in range(num_blobs):
+            blob = "blob_{}".format(i)
+            value = (comm_rank * num_blobs + i + 1) * \
+                np.arange(1, blob_size + 1, dtype=np.float32)
+            workspace.FeedBlob(blob, value)
+            blobs.append(blob)
+        inputs = [common_world] + blobs
+        outputs = list(blobs)
+        if top_k > 0:
+            workspace.FeedBlob("residual", np.zeros(0, np.float32))
+            inputs.append("residual")
+            outputs.append("residual")
+
+        net = core.Net("allreduce_compressed")
+        net.AllreduceCompressed(
+            inputs,
+            outputs,
+            top_k=top_k,
+            fp16=False,
+            engine=op_engine)
+
+        workspace.CreateNet(net)
+        workspace.RunNet(net.Name())
+
+        n = num_blobs * comm_size
+        expected = n * (n + 1) / 2 * np.arange(1, blob_size + 1)
+        local = (comm_rank * num_blobs * num_blobs +
+                 num_blobs * (num_blobs + 1) / 2) * \
+            np.arange(1, blob_size + 1)
+        k = min(top_k, blob_size)
+        for i in range(num_blobs):
+            result = workspace.FetchBlob(blobs[i])
+            if top_k == 0:
+                # fp16 on the wire
+                np.testing.assert_allclose(result, expected, rtol=1e-2)
+            else:
+                np.testing.assert_array_equal(
+                    result[blob_size - k:], expected[blob_size - k:])
+                np.testing.assert_array_equal(result[:blob_size - k], 0)
+        if top_k > 0:
+            residual = workspace.FetchBlob("residual")
+            np.testing.assert_array_equal(
+                residual[:blob_size - k], local[:blob_size - k])
+            np.testing.assert_array_equal(residual[blob_size - k:], 0)
+
+    @given(comm_size=st.integers(min_value=2, max_value=8),
+           # Keeps the sums within the fp16 range
+           blob_size=st.integers(min_value=1, max_value=100),
+           num_blobs=st.integers(min_value=1, max_value=4),
+           top_k=st.sampled_from([0, 1, 16]),
+           device_option=st.sampled_from([hu.cpu_do]))
+    def test_allreduce_compressed(self, comm_size, blob_size, num_blobs, top_k,
+                                  device_option):
+        TestCase.test_counter += 1
+        if os.getenv('COMM_RANK') is not None:
+            self.run_test_distributed(
+                self._test_allreduce_compressed,
+                blob_size=blob_size,
+                num_blobs=num_blobs,
+                top_k=top_k,
+                device_option=device_option)
+        else:
+            with TemporaryDirectory() as tmpdir:
+                self.run_test_locally(
+                    self._test_allreduce_compressed,
+                    comm_size=comm_size,
+                    blob_size=blob_size,
+                    num_blobs=num_blobs,
+                    top_k=top_k,
+                    device_option=device_option,
+                    tmpdir=tmpdir)
+
+    def _test_sharded_sparse(self,
+                             comm_rank=None,
+                             comm_size=None,
+                             num_rows=None,
+                             num_ids=None,
+                             tmpdir=None
+                             ):
+        store_handler, common_world = self.create_common_world(
+            comm_rank=comm_rank,
+            comm_size=comm_size,
+            tmpdir=tmpdir)
+
+        num_rows = self.synchronize(
+            store_handler,
+            num_rows,
+            comm_rank=comm_rank)
+
+        num_ids = self.synchronize(
+            store_handler,
+            num_ids,
+            comm_rank=comm_rank)
+
+        # Row i of the full table holds i, each node keeps the rows of its
+        # hash shard.
+        dim = 4
+        table = np.tile(
+            np.arange(num_rows, dtype=np.float32).reshape(-1, 1), (1, dim))
+        workspace.FeedBlob("table", table[comm_rank::comm_size])
+        ids = (np.arange(num_ids, dtype=np.int64) * (comm_rank + 1)) % num_rows
+        workspace.FeedBlob("ids", ids)
+        workspace.FeedBlob("grad", np.ones((num_ids, dim), np.float32))
+        workspace.FeedBlob("alpha", np.array([-1.0], np.float32))
+
+        net = core.Net("sharded_sparse")
+        net.ShardedSparseLookup(
+            [common_world, "table", "ids"],
+            ["rows"],
+            engine=op_engine)
+        net.ShardedSparsePush(
+            [common_world, "table", "ids", "grad", "alpha"],
+            ["table"],
+            engine=op_engine)
+
+        workspace.CreateNet(net)
+        workspace.RunNet(net.Name())
+
+        np.testing.assert_array_equal(workspace.FetchBlob("rows"), table[ids])
+        # Every node pushed -1 for each of its ids.
+        counts = np.zeros(num_rows, np.float32)
+        for rank in range(comm_size):
+            np.add.at(
+                counts,
+                (np.arange(num_ids) * (rank + 1)) % num_rows,
+                1)
+        expected = table - counts.reshape(-1, 1)
+        np.testing.assert_array_equal(
+            workspace.FetchBlob("table"), expected[comm_rank::comm_size])
+
+    @given(comm_size=st.integers(min_value=2, max_value=8),
+           num_rows=st.integers(min_value=1, max_value=64),
+           num_ids=st.integers(min_value=0, max_value=32),
+           device_option=st.sampled_from([hu.cpu_do]))
+    def test_sharded_sparse(self, comm_size, num_rows, num_ids,
+                            device_option):
+        TestCase.test_counter += 1
+        if os.getenv('COMM_RANK') is not None:
+            self.run_test_distributed(
+                self._test_sharded_sparse,
+                num_rows=num_rows,
+                num_ids=num_ids,
+                device_option=device_option)
+        else:
+            with TemporaryDirectory() as tmpdir:
+                self.run_test_locally(
+                    self._test_sharded_sparse,
+                    comm_size=comm_size,
+                    num_rows=num_rows,
+                    num_ids=num_ids,
+                    device_option=device_option,
+                    tmpdir=tmpdir)
+
     def _test_barrier(
         self,
         comm_rank=None,
@@ -416,6 +681,60 @@ class TestCase(hu.HypothesisTestCase):
                     device_option=device_option,
                     tmpdir=tmpdir)
 
+    def _test_reuse_common_world(
+        self,
+        comm_rank=None,
+        comm_size=None,
+        tmpdir=None,
+    ):
+        store_handler, _ = self.create_common_world(
+            comm_rank=comm_rank, comm_size=comm_size, tmpdir=tmpdir
+        )
+        members = ["member_{}".format(i) for i in range(comm_size)]
+
+        # The second common world reuses the connections of the first one
+        # and the second clone is the first clone.
+        for i in range(2):
+            common_world = "reused_common_world"
+            workspace.RunOperatorOnce(
+                core.CreateOperator(
+                    "CreateCommonWorld",
+                    [store_handler],
+                    [common_world],
+                    name="reused_common_world_{}".format(i),
+                    size=comm_size,
+                    rank=comm_rank,
+                    members=members,
+                    engine=op_engine))
+            for _tmp in range(2):
+                workspace.RunOperatorOnce(
+                    core.CreateOperator(
+                        "CloneCommonWorld",
+                        [common_world],
+                        ["cloned_common_world"],
+                        reuse=True,
+                        engine=op_engine))
+                for cw in [common_world, "cloned_common_world"]:
+                    workspace.RunOperatorOnce(
+                        core.CreateOperator(
+                            "Barrier", [cw], [], engine=op_engine))
+
+    @given(comm_size=st.integers(min_value=2, max_value=4),
+           device_option=st.sampled_from([hu.cpu_do]))
+    def test_reuse_common_world(self, comm_size, device_option):
+        TestCase.test_counter += 1
+        if os.getenv('COMM_RANK') is not None:
+            self.run_test_distributed(
+                self._test_reuse_common_world,
+                device_option=device_option)
+        else:
+            with TemporaryDirectory() as tmpdir:
+                self.run_test_locally(
+                    self._test_reuse_common_world,
+                    comm_size=comm_size,
+                    device_option=device_option,
+                    tmpdir=tmpdir)
+
     def _test_close_connection(
         self,
         comm_rank=None,
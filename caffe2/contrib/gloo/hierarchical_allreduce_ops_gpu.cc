@@ -0,0 +1,199 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "allreduce_ops.h"
+
+#include "caffe2/contrib/nccl/cuda_nccl_gpu.h"
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/core/logging.h"
+
+#include <gloo/cuda_allreduce_halving_doubling.h>
+#include <gloo/types.h>
+
+namespace caffe2 {
+namespace gloo {
+
+namespace {
+
+// Runs the algorithms of all shards one after the other, so that the op can
+// use the run and error handling of AllreduceOp.
+class ShardedAlgorithm : public ::gloo::Algorithm {
+ public:
+  ShardedAlgorithm(
+      const std::shared_ptr<::gloo::Context>& context,
+      std::vector<std::unique_ptr<::gloo::Algorithm>> shards)
+      : ::gloo::Algorithm(context), shards_(std::move(shards)) {}
+
+  void run() override {
+    for (auto& shard : shards_) {
+      shard->run();
+    }
+  }
+
+ private:
+  std::vector<std::unique_ptr<::gloo::Algorithm>> shards_;
+};
+
+template <typename T>
+std::unique_ptr<::gloo::Algorithm> initializeShardAlgorithm(
+    bool gpu_direct,
+    const std::shared_ptr<::gloo::Context>& context,
+    T* ptr,
+    size_t size) {
+  std::vector<T*> ptrs = {ptr};
+  if (gpu_direct) {
+    if (context->getDevice()->hasGPUDirect()) {
+      return std::unique_ptr<::gloo::Algorithm>(
+          new ::gloo::CudaAllreduceHalvingDoubling<
+              T,
+              ::gloo::CudaDeviceWorkspace<T>>(context, ptrs, size));
+    } else {
+      LOG(WARNING)
+        << "GPUDirect not available; "
+        << "Gloo communication will go through system memory instead.";
+    }
+  }
+  return std::unique_ptr<::gloo::Algorithm>(
+      new ::gloo::CudaAllreduceHalvingDoubling<
+          T,
+          ::gloo::CudaHostWorkspace<T>>(context, ptrs, size));
+}
+
+} // namespace
+
+// Allreduces one tensor per local GPU hierarchically. An NCCL reduce-scatter
+// first leaves every one of the G GPUs with the node's sum of its own 1/G
+// shard, the shards are then allreduced across the nodes with Gloo, and an
+// NCCL allgather finally puts the whole result back on every GPU. Unlike
+// Allreduce, which reduces the full tensor locally before sending it, every
+// GPU only exchanges its own shard with the other nodes.
+class HierarchicalAllreduceOp final : public AllreduceOp<CUDAContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CUDAContext);
+
+  HierarchicalAllreduceOp(const OperatorDef& operator_def, Workspace* ws)
+      : AllreduceOp<CUDAContext>(operator_def, ws),
+        num_gpus_(InputSize() - 1) {
+    for (auto i = 0; i < num_gpus_; i++) {
+      padded_.emplace_back(new TensorCUDA());
+      shards_.emplace_back(new TensorCUDA());
+    }
+  }
+
+ protected:
+  void initialize() override {
+    update(init_);
+    verify();
+
+    // Every GPU keeps a [G, shard] copy of its tensor, padded at the end,
+    // for the reduce-scatter to read and the allgather to write, and the
+    // shard that it reduces with the other nodes. Gloo holds on to the shard
+    // pointers, so they are allocated once here.
+    shard_size_ = (init_.size + num_gpus_ - 1) / num_gpus_;
+    devices_.resize(num_gpus_);
+    std::vector<std::unique_ptr<::gloo::Algorithm>> algorithms;
+    for (auto i = 0; i < num_gpus_; i++) {
+      devices_[i] = GetGPUIDForPointer(Input(i + 1).raw_data());
+      DeviceGuard guard(devices_[i]);
+      padded_[i]->Resize(num_gpus_, shard_size_);
+      padded_[i]->raw_mutable_data(init_.meta);
+      shards_[i]->Resize(shard_size_);
+      void* shard = shards_[i]->raw_mutable_data(init_.meta);
+      if (init_.IsType<float>()) {
+        algorithms.push_back(initializeShardAlgorithm<float>(
+            gpu_direct_,
+            init_.context,
+            static_cast<float*>(shard),
+            shard_size_));
+      } else if (init_.IsType<float16>()) {
+        algorithms.push_back(initializeShardAlgorithm<::gloo::float16>(
+            gpu_direct_,
+            init_.context,
+            static_cast<::gloo::float16*>(shard),
+            shard_size_));
+      } else {
+        CAFFE_ENFORCE(false, "Unhandled type: ", init_.meta.name());
+      }
+    }
+    algorithm_.reset(
+        new ShardedAlgorithm(init_.context, std::move(algorithms)));
+  }
+
+  void pack() override {
+    const auto nbytes = init_.size * init_.meta.itemsize();
+    for (auto i = 0; i < num_gpus_; i++) {
+      // The padding is reduced along with the data but never copied back.
+      context_.CopyBytes<CUDAContext, CUDAContext>(
+          nbytes, Input(i + 1).raw_data(), padded_[i]->raw_mutable_data());
+    }
+    runNCCL(true);
+    // The Gloo algorithms do not run on the operator's stream.
+    context_.FinishDeviceComputation();
+  }
+
+  void unpack() override {
+    runNCCL(false);
+    const auto nbytes = init_.size * init_.meta.itemsize();
+    for (auto i = 0; i < num_gpus_; i++) {
+      context_.CopyBytes<CUDAContext, CUDAContext>(
+          nbytes, padded_[i]->raw_data(), Output(i)->raw_mutable_data());
+    }
+  }
+
+  // Reduce-scatters the padded tensors into the shards, or allgathers the
+  // shards back into the padded tensors.
+  void runNCCL(bool scatter) {
+    nccl::NCCLExecution ex;
+    ex.stream_gpu_id = context_.cuda_gpu_id();
+    ex.stream = context_.cuda_stream();
+    ex.elements.resize(num_gpus_);
+    for (auto i = 0; i < num_gpus_; i++) {
+      auto& el = ex.elements[i];
+      el.src = scatter ? padded_[i].get() : shards_[i].get();
+      el.dst = scatter ? shards_[i].get() : padded_[i].get();
+      el.device = devices_[i];
+    }
+    if (init_.IsType<float>()) {
+      if (scatter) {
+        nccl::NCCL<float>::ReduceScatter(ex);
+      } else {
+        nccl::NCCL<float>::AllGather(ex);
+      }
+    } else {
+      if (scatter) {
+        nccl::NCCL<float16>::ReduceScatter(ex);
+      } else {
+        nccl::NCCL<float16>::AllGather(ex);
+      }
+    }
+  }
+
+  const int num_gpus_;
+  size_t shard_size_{0};
+  std::vector<int> devices_;
+  std::vector<std::unique_ptr<TensorCUDA>> padded_;
+  std::vector<std::unique_ptr<TensorCUDA>> shards_;
+};
+
+namespace {
+
+REGISTER_CUDA_OPERATOR_WITH_ENGINE(
+    HierarchicalAllreduce,
+    GLOO,
+    HierarchicalAllreduceOp);
+
+} // namespace
+} // namespace gloo
+} // namespace caffe2
@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "caffe2/contrib/gloo/pipelined_broadcast.h"
+
+#include <algorithm>
+
+#include "caffe2/core/logging.h"
+
+namespace caffe2 {
+namespace gloo {
+
+PipelinedBroadcast::PipelinedBroadcast(
+    const std::shared_ptr<::gloo::Context>& context,
+    const std::vector<std::pair<void*, size_t>>& buffers,
+    int root,
+    size_t chunkBytes)
+    : context_(context) {
+  const auto size = context_->size;
+  const auto rank = context_->rank;
+  CAFFE_ENFORCE(root >= 0 && root < size, "Invalid root ", root);
+  CAFFE_ENFORCE_GT(chunkBytes, 0);
+  // Position of this node in the chain starting at the root.
+  const auto position = (rank - root + size) % size;
+  const bool hasPrev = position > 0;
+  const bool hasNext = position < size - 1;
+
+  std::vector<char*> chunks;
+  for (const auto& buffer : buffers) {
+    auto* ptr = static_cast<char*>(buffer.first);
+    // Empty buffers have no chunks, a zero byte send would send nothing.
+    for (size_t offset = 0; offset < buffer.second; offset += chunkBytes) {
+      chunks.push_back(ptr + offset);
+      chunkBytes_.push_back(std::min(chunkBytes, buffer.second - offset));
+    }
+  }
+
+  // Every chunk has a slot of its own, used on both links of the node.
+  const auto slot = context_->nextSlot(chunks.size());
+  for (auto i = 0; i < chunks.size(); i++) {
+    if (hasPrev) {
+      auto& pair = context_->getPair((rank - 1 + size) % size);
+      recvBuffers_.push_back(
+          pair->createRecvBuffer(slot + i, chunks[i], chunkBytes_[i]));
+    }
+    if (hasNext) {
+      auto& pair = context_->getPair((rank + 1) % size);
+      sendBuffers_.push_back(
+          pair->createSendBuffer(slot + i, chunks[i], chunkBytes_[i]));
+    }
+  }
+}
+
+void PipelinedBroadcast::run() {
+  for (auto i = 0; i < chunkBytes_.size(); i++) {
+    if (!recvBuffers_.empty()) {
+      recvBuffers_[i]->waitRecv();
+    }
+    if (!sendBuffers_.empty()) {
+      sendBuffers_[i]->send(0, chunkBytes_[i]);
+    }
+  }
+  for (auto& buffer : sendBuffers_) {
+    buffer->waitSend();
+  }
+}
+
+} // namespace gloo
+} // namespace caffe2
@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <gloo/context.h>
+#include <gloo/transport/buffer.h>
+
+namespace caffe2 {
+namespace gloo {
+
+// Broadcasts a list of buffers from the root along a chain of the nodes,
+// root, root + 1, ..., root - 1 (mod size), in chunks. Every node forwards a
+// chunk to the next node as soon as it has received it and then waits for
+// the next chunk, so the chunks of all buffers are in flight on all the links
+// at once: for large buffers, the broadcast takes about as long as sending
+// them over a single link, whatever the number of nodes. The buffers may
+// have different sizes, which must be the same on all nodes.
+class PipelinedBroadcast {
+ public:
+  PipelinedBroadcast(
+      const std::shared_ptr<::gloo::Context>& context,
+      const std::vector<std::pair<void*, size_t>>& buffers,
+      int root,
+      size_t chunkBytes);
+
+  void run();
+
+  const std::shared_ptr<::gloo::Context>& context() const {
+    return context_;
+  }
+
+ private:
+  std::shared_ptr<::gloo::Context> context_;
+  // Bytes of every chunk, in the order they are sent.
+  std::vector<size_t> chunkBytes_;
+  // One per chunk, empty for the root and the last node respectively.
+  std::vector<std::unique_ptr<::gloo::transport::Buffer>> recvBuffers_;
+  std::vector<std::unique_ptr<::gloo::transport::Buffer>> sendBuffers_;
+};
+
+} // namespace gloo
+} // namespace caffe2
@@ -0,0 +1,295 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "caffe2/contrib/gloo/sharded_sparse_ops.h"
+
+#include <cstring>
+#include <unordered_map>
+
+namespace caffe2 {
+namespace gloo {
+
+namespace {
+
+constexpr int kNumTableMutexes = 64;
+
+template <typename T>
+void appendBytes(const T* data, size_t n, std::vector<char>* out) {
+  const auto* bytes = reinterpret_cast<const char*>(data);
+  out->insert(out->end(), bytes, bytes + n * sizeof(T));
+}
+
+} // namespace
+
+std::mutex& tableMutex(const void* table) {
+  static std::mutex mutexes[kNumTableMutexes];
+  return mutexes[std::hash<const void*>()(table) % kNumTableMutexes];
+}
+
+ShardedSparseOpBase::ShardedSparseOpBase(
+    const OperatorDef& operator_def,
+    Workspace* ws)
+    : Operator<CPUContext>(operator_def, ws),
+      hash_(
+          OperatorBase::GetSingleArgument<std::string>("sharding", "hash") ==
+          "hash"),
+      rows_per_shard_(
+          OperatorBase::GetSingleArgument<int64_t>("rows_per_shard", 0)),
+      ws_(ws),
+      status_blob_(
+          OperatorBase::GetSingleArgument<std::string>("status_blob", "")) {
+  const auto sharding =
+      OperatorBase::GetSingleArgument<std::string>("sharding", "hash");
+  CAFFE_ENFORCE(
+      sharding == "hash" || sharding == "range",
+      "Unknown sharding: ",
+      sharding);
+  CAFFE_ENFORCE(
+      hash_ || rows_per_shard_ > 0,
+      "Range sharding needs a positive rows_per_shard");
+  if (status_blob_ != "") {
+    ws_->CreateBlob(status_blob_);
+  }
+}
+
+void ShardedSparseOpBase::initialize() {
+  const auto& context =
+      OperatorBase::Input<std::shared_ptr<::gloo::Context>>(0);
+  std::call_once(once_, [&] { exchange_.reset(new AllToAll(context)); });
+  CAFFE_ENFORCE(context == exchange_->context(), "Context has changed");
+}
+
+template <typename Index>
+void ShardedSparseOpBase::coalesce(const TensorCPU& indices) {
+  const auto size = exchange_->context()->size;
+  const auto* ids = indices.template data<Index>();
+  requests_.assign(size, std::vector<int64_t>());
+  positions_.resize(indices.size());
+  std::unordered_map<Index, std::pair<int, int64_t>> unique;
+  for (auto i = 0; i < indices.size(); i++) {
+    const auto id = ids[i];
+    auto it = unique.find(id);
+    if (it == unique.end()) {
+      CAFFE_ENFORCE_GE(id, 0, "Negative id");
+      int shard;
+      int64_t row;
+      if (hash_) {
+        shard = id % size;
+        row = id / size;
+      } else {
+        shard = id / rows_per_shard_;
+        row = id % rows_per_shard_;
+        CAFFE_ENFORCE_LT(shard, size, "Id ", id, " is out of range");
+      }
+      auto& request = requests_[shard];
+      it = unique.emplace(id, std::make_pair(shard, request.size())).first;
+      request.push_back(row);
+    }
+    positions_[i] = it->second;
+  }
+}
+
+bool ShardedSparseOpBase::handleException(std::exception& ex) {
+  if (status_blob_ != "") {
+    signalFailure(ws_->GetBlob(status_blob_), ex);
+    return false;
+  } else {
+    throw;
+  }
+}
+
+template <typename Index>
+bool ShardedSparseLookupOp::DoRunWithType() {
+  const auto& table = Input(TABLE);
+  const auto& indices = Input(INDICES);
+  CAFFE_ENFORCE_GE(table.ndim(), 1);
+  CAFFE_ENFORCE(
+      table.meta().copy() == nullptr,
+      "Only tables of fundamental types can be sharded");
+  const auto rowBytes = table.size_from_dim(1) * table.itemsize();
+
+  auto dims = indices.dims();
+  dims.insert(dims.end(), table.dims().begin() + 1, table.dims().end());
+  auto* output = Output(0);
+  output->Resize(dims);
+  auto* out = static_cast<char*>(output->raw_mutable_data(table.meta()));
+
+  try {
+    initialize();
+    coalesce<Index>(indices);
+    const auto size = requests_.size();
+
+    // 1. Send every shard the unique local rows needed from it
+    send_.resize(size);
+    for (auto i = 0; i < size; i++) {
+      send_[i].clear();
+      appendBytes(requests_[i].data(), requests_[i].size(), &send_[i]);
+    }
+    exchange_->run(send_, &recv_);
+
+    // 2. Answer the requests other nodes sent for rows of this shard
+    {
+      std::lock_guard<std::mutex> guard(tableMutex(table.raw_data()));
+      const auto* data = static_cast<const char*>(table.raw_data());
+      for (auto i = 0; i < size; i++) {
+        const auto* rows = reinterpret_cast<const int64_t*>(recv_[i].data());
+        const auto n = recv_[i].size() / sizeof(int64_t);
+        send_[i].resize(n * rowBytes);
+        for (auto j = 0; j < n; j++) {
+          CAFFE_ENFORCE_LT(rows[j], table.dim(0), "Row is out of range");
+          std::memcpy(
+              &send_[i][j * rowBytes], data + rows[j] * rowBytes, rowBytes);
+        }
+      }
+    }
+    exchange_->run(send_, &recv_);
+  } catch (::gloo::IoException& ioe) {
+    LOG(ERROR) << "Caught gloo IO exception: " << ioe.what();
+    return handleException(ioe);
+  }
+
+  // 3. Scatter the unique rows back to the positions of the ids
+  for (auto i = 0; i < positions_.size(); i++) {
+    const auto& position = positions_[i];
+    std::memcpy(
+        out + i * rowBytes,
+        recv_[position.first].data() + position.second * rowBytes,
+        rowBytes);
+  }
+  return true;
+}
+
+ShardedSparsePushOp::~ShardedSparsePushOp() {
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+  if (error_) {
+    LOG(ERROR) << "Dropping the failure of the last sharded sparse push";
+  }
+}
+
+void ShardedSparsePushOp::wait() {
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+  if (error_) {
+    auto error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+void ShardedSparsePushOp::push(
+    float* table,
+    int64_t num_rows,
+    int64_t block_size,
+    float alpha) {
+  exchange_->run(send_, &recv_);
+
+  // Every message holds the local rows followed by their gradients.
+  const auto entryBytes = sizeof(int64_t) + block_size * sizeof(float);
+  std::lock_guard<std::mutex> guard(tableMutex(table));
+  for (const auto& message : recv_) {
+    CAFFE_ENFORCE_EQ(message.size() % entryBytes, 0);
+    const auto n = message.size() / entryBytes;
+    const auto* rows = reinterpret_cast<const int64_t*>(message.data());
+    const auto* grads =
+        reinterpret_cast<const float*>(message.data() + n * sizeof(int64_t));
+    for (auto j = 0; j < n; j++) {
+      CAFFE_ENFORCE_LT(rows[j], num_rows, "Row is out of range");
+      float* row = table + rows[j] * block_size;
+      const float* grad = grads + j * block_size;
+      for (auto k = 0; k < block_size; k++) {
+        row[k] += alpha * grad[k];
+      }
+    }
+  }
+}
+
+template <typename Index>
+bool ShardedSparsePushOp::DoRunWithType() {
+  const auto& indices = Input(INDICES);
+  const auto& grad = Input(GRAD);
+  CAFFE_ENFORCE_EQ(
+      &Input(TABLE), Output(0), "ShardedSparsePush must run in place");
+  auto* table = Output(0);
+  CAFFE_ENFORCE_GE(table->ndim(), 1);
+  const auto blockSize = table->size_from_dim(1);
+  CAFFE_ENFORCE_EQ(grad.size(), indices.size() * blockSize);
+  CAFFE_ENFORCE_EQ(Input(ALPHA).size(), 1);
+  const float alpha = Input(ALPHA).template data<float>()[0];
+  const auto* gradData = grad.template data<float>();
+
+  try {
+    // The previous push still uses the exchange and its buffers.
+    wait();
+    initialize();
+    coalesce<Index>(indices);
+    const auto size = requests_.size();
+
+    // Sum the gradients of duplicate ids into one row per unique id
+    std::vector<std::vector<float>> sums(size);
+    for (auto i = 0; i < size; i++) {
+      sums[i].assign(requests_[i].size() * blockSize, 0.f);
+    }
+    for (auto i = 0; i < positions_.size(); i++) {
+      const auto& position = positions_[i];
+      float* sum = &sums[position.first][position.second * blockSize];
+      const float* g = gradData + i * blockSize;
+      for (auto k = 0; k < blockSize; k++) {
+        sum[k] += g[k];
+      }
+    }
+    send_.resize(size);
+    for (auto i = 0; i < size; i++) {
+      send_[i].clear();
+      appendBytes(requests_[i].data(), requests_[i].size(), &send_[i]);
+      appendBytes(sums[i].data(), sums[i].size(), &send_[i]);
+    }
+
+    float* data = table->template mutable_data<float>();
+    const auto numRows = table->dim(0);
+    if (!async_) {
+      push(data, numRows, blockSize, alpha);
+      return true;
+    }
+    worker_ = std::thread([this, data, numRows, blockSize, alpha] {
+      try {
+        push(data, numRows, blockSize, alpha);
+      } catch (...) {
+        error_ = std::current_exception();
+      }
+    });
+  } catch (::gloo::IoException& ioe) {
+    LOG(ERROR) << "Caught gloo IO exception: " << ioe.what();
+    return handleException(ioe);
+  }
+  return true;
+}
+
+namespace {
+
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    ShardedSparseLookup,
+    GLOO,
+    ShardedSparseLookupOp);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    ShardedSparsePush,
+    GLOO,
+    ShardedSparsePushOp);
+
+} // namespace
+} // namespace gloo
+} // namespace caffe2
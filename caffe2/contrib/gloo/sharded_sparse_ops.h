@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "caffe2/contrib/gloo/all_to_all.h"
+#include "caffe2/contrib/gloo/common.h"
+#include "caffe2/core/operator.h"
+
+#include <gloo/common/error.h>
+#include <gloo/context.h>
+
+namespace caffe2 {
+namespace gloo {
+
+// Mutex guarding the rows of a local table shard, shared by the lookups
+// serving rows from it and the pushes updating it in the background.
+std::mutex& tableMutex(const void* table);
+
+// Base of the operators that access an embedding table sharded over the
+// nodes of a common world. Every node holds one shard as its TABLE input.
+// With hash sharding, row id lives on node id % size as local row id / size,
+// the layout Partition with pack_first_input produces. With range sharding,
+// node i holds the rows_per_shard rows starting at row i * rows_per_shard.
+class ShardedSparseOpBase : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+
+  ShardedSparseOpBase(const OperatorDef& operator_def, Workspace* ws);
+
+  virtual ~ShardedSparseOpBase() {}
+
+ protected:
+  // Creates the exchange the first time the op runs, and makes sure the
+  // common world does not change afterwards.
+  void initialize();
+
+  // Coalesces the ids into one list of unique local rows per shard. On
+  // return, requests_[s] holds the rows to ask shard s for, and positions_[i]
+  // the shard of the i-th id and its index into that shard's list.
+  template <typename Index>
+  void coalesce(const TensorCPU& indices);
+
+  bool handleException(std::exception& ex);
+
+  const bool hash_;
+  const int64_t rows_per_shard_;
+  Workspace* ws_;
+  std::string status_blob_;
+
+  std::once_flag once_;
+  std::unique_ptr<AllToAll> exchange_;
+  std::vector<std::vector<int64_t>> requests_;
+  std::vector<std::pair<int, int64_t>> positions_;
+  std::vector<std::vector<char>> send_;
+  std::vector<std::vector<char>> recv_;
+};
+
+// Gathers rows of a sharded embedding table. The ids are coalesced so that
+// every unique row is requested once, the requests are sent to the shards
+// holding the rows in a single exchange, and every node then answers the
+// requests for its own shard in a second one.
+class ShardedSparseLookupOp final : public ShardedSparseOpBase {
+ public:
+  USE_DISPATCH_HELPER;
+
+  using ShardedSparseOpBase::ShardedSparseOpBase;
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename Index>
+  bool DoRunWithType();
+
+ protected:
+  INPUT_TAGS(COMM, TABLE, INDICES);
+};
+
+// Adds alpha times the gradient of the looked up ids to the rows of a sharded
+// float embedding table, updating TABLE in place. The gradients of duplicate
+// ids are summed locally and every shard gets one message with its unique
+// rows. With async, the exchange and the update of the local shard run in
+// the background and the op returns right away; the next run waits for the
+// previous push first. An async push should get its own common world, e.g.
+// from CloneCommonWorld, as it runs concurrently with the other collectives.
+class ShardedSparsePushOp final : public ShardedSparseOpBase {
+ public:
+  USE_DISPATCH_HELPER;
+
+  ShardedSparsePushOp(const OperatorDef& operator_def, Workspace* ws)
+      : ShardedSparseOpBase(operator_def, ws),
+        async_(OperatorBase::GetSingleArgument<bool>("async", false)) {}
+
+  ~ShardedSparsePushOp() override;
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename Index>
+  bool DoRunWithType();
+
+ protected:
+  // Sends the messages in send_ and adds the gradients the other nodes sent
+  // for this node's rows to the table.
+  void push(float* table, int64_t num_rows, int64_t block_size, float alpha);
+
+  // Waits for the background push, rethrowing its failure if any.
+  void wait();
+
+  const bool async_;
+  std::thread worker_;
+  std::exception_ptr error_;
+
+  INPUT_TAGS(COMM, TABLE, INDICES, GRAD, ALPHA);
+};
+
+} // namespace gloo
+} // namespace caffe2
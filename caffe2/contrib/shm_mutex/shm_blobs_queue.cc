@@ -0,0 +1,449 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shm_blobs_queue.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+namespace {
+
+constexpr uint64_t kMagic = 0x63327368626c6f62; // "c2shblob"
+constexpr int kMaxDims = 8;
+constexpr size_t kAlignment = 64;
+
+size_t alignUp(size_t n) {
+  return (n + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Lifecycle of a slot: a writer claims a free slot and copies a record into
+// it, a reader claims the full slot, and the slot is free again once the
+// tensors of the reader are gone.
+enum SlotState : int32_t {
+  kFree = 0,
+  kWriting = 1,
+  kFull = 2,
+  kReading = 3,
+};
+
+struct ShmTensorMeta {
+  int32_t dataType;
+  int32_t ndim;
+  int64_t dims[kMaxDims];
+  uint64_t offset;
+  uint64_t nbytes;
+};
+
+} // namespace
+
+struct ShmQueueHeader {
+  std::atomic<uint64_t> magic;
+  uint64_t capacity;
+  uint64_t numBlobs;
+  uint64_t slotBytes;
+  pthread_mutex_t mutex; // protects everything below and the slot states.
+  pthread_cond_t notEmpty;
+  pthread_cond_t notFull;
+  // Processes that have the queue open, -1 once the last one removed it.
+  int64_t attached;
+  int64_t reader;
+  int64_t writer;
+  int32_t closed;
+};
+
+namespace {
+
+// Holds the mutex of the queue. A process that died while holding it leaves
+// it to the next one, and the queue goes on with the state it left.
+class ShmLock {
+ public:
+  explicit ShmLock(pthread_mutex_t* mutex) : mutex_(mutex) {
+    check(pthread_mutex_lock(mutex_));
+  }
+
+  ~ShmLock() {
+    pthread_mutex_unlock(mutex_);
+  }
+
+  // Returns false if the deadline passed. Waits forever without deadline.
+  bool wait(pthread_cond_t* cond, const struct timespec* deadline) {
+    const int rc = deadline ? pthread_cond_timedwait(cond, mutex_, deadline)
+                            : pthread_cond_wait(cond, mutex_);
+    if (rc == ETIMEDOUT) {
+      return false;
+    }
+    check(rc);
+    return true;
+  }
+
+ private:
+  void check(int rc) {
+    if (rc == EOWNERDEAD) {
+      LOG(WARNING) << "A process died while holding the lock of a shm queue.";
+      pthread_mutex_consistent(mutex_);
+      return;
+    }
+    CAFFE_ENFORCE_EQ(rc, 0, "Locking a shm queue failed: ", strerror(rc));
+  }
+
+  pthread_mutex_t* mutex_;
+};
+
+} // namespace
+
+// The mapping of the shared memory of a queue. Also kept alive by the
+// tensors that point into it.
+class ShmQueueSegment
+    : public std::enable_shared_from_this<ShmQueueSegment> {
+ public:
+  ShmQueueSegment(
+      const std::string& name,
+      size_t capacity,
+      size_t numBlobs,
+      size_t slotBytes);
+  ~ShmQueueSegment();
+
+  ShmQueueHeader* header() {
+    return header_;
+  }
+  int32_t& state(int64_t pos) {
+    return states_[pos % header_->capacity];
+  }
+  ShmTensorMeta* meta(int64_t pos) {
+    return metas_ + (pos % header_->capacity) * header_->numBlobs;
+  }
+  char* data(int64_t pos) {
+    return arena_ + (pos % header_->capacity) * header_->slotBytes;
+  }
+
+  // Gives back the slot at pos once its tensors are gone.
+  void release(int64_t pos);
+
+ private:
+  void initialize(size_t capacity, size_t numBlobs, size_t slotBytes);
+  void map(int fd);
+
+  const std::string name_;
+  size_t size_;
+  ShmQueueHeader* header_{nullptr};
+  int32_t* states_;
+  ShmTensorMeta* metas_;
+  char* arena_;
+};
+
+ShmQueueSegment::ShmQueueSegment(
+    const std::string& name,
+    size_t capacity,
+    size_t numBlobs,
+    size_t slotBytes)
+    : name_(name) {
+  CAFFE_ENFORCE_GT(capacity, 0);
+  CAFFE_ENFORCE_GT(numBlobs, 0);
+  CAFFE_ENFORCE_GT(slotBytes, 0);
+  slotBytes = alignUp(slotBytes);
+  const size_t statesOffset = alignUp(sizeof(ShmQueueHeader));
+  const size_t metasOffset = alignUp(statesOffset + capacity * sizeof(int32_t));
+  const size_t arenaOffset =
+      alignUp(metasOffset + capacity * numBlobs * sizeof(ShmTensorMeta));
+  size_ = arenaOffset + capacity * slotBytes;
+
+  while (true) {
+    int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd != -1) {
+      // We are the creator, the object is all zeroes.
+      const auto rv = ftruncate(fd, size_);
+      CAFFE_ENFORCE(rv != -1, "ftruncate: ", strerror(errno));
+      map(fd);
+      initialize(capacity, numBlobs, slotBytes);
+      break;
+    }
+    CAFFE_ENFORCE(errno == EEXIST, "shm_open failed: ", strerror(errno));
+    fd = shm_open(name_.c_str(), O_RDWR, 0);
+    if (fd == -1) {
+      CAFFE_ENFORCE(errno == ENOENT, "shm_open failed: ", strerror(errno));
+      // Removed in the meantime, create it again.
+      continue;
+    }
+    // Wait for the creator to size the object, mapping it before would
+    // fault on access.
+    struct stat st;
+    while (true) {
+      CAFFE_ENFORCE(fstat(fd, &st) == 0, "fstat: ", strerror(errno));
+      if (st.st_size != 0) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CAFFE_ENFORCE_EQ(
+        st.st_size,
+        size_,
+        "The shm queue ",
+        name_,
+        " exists with different parameters.");
+    map(fd);
+    while (header_->magic.load(std::memory_order_acquire) != kMagic) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bool removed;
+    {
+      ShmLock lock(&header_->mutex);
+      removed = header_->attached < 0;
+      if (!removed) {
+        ++header_->attached;
+      }
+    }
+    if (!removed) {
+      CAFFE_ENFORCE(
+          header_->capacity == capacity && header_->numBlobs == numBlobs &&
+              header_->slotBytes == slotBytes,
+          "The shm queue ",
+          name_,
+          " exists with different parameters.");
+      break;
+    }
+    // The last process is removing it, retry.
+    munmap(header_, size_);
+    header_ = nullptr;
+  }
+  const auto base = reinterpret_cast<char*>(header_);
+  states_ = reinterpret_cast<int32_t*>(base + statesOffset);
+  metas_ = reinterpret_cast<ShmTensorMeta*>(base + metasOffset);
+  arena_ = base + arenaOffset;
+}
+
+void ShmQueueSegment::map(int fd) {
+  void* ptr =
+      mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  const int err = errno;
+  close(fd);
+  CAFFE_ENFORCE(ptr != MAP_FAILED, "mmap: ", strerror(err));
+  header_ = static_cast<ShmQueueHeader*>(ptr);
+}
+
+void ShmQueueSegment::initialize(
+    size_t capacity,
+    size_t numBlobs,
+    size_t slotBytes) {
+  header_->capacity = capacity;
+  header_->numBlobs = numBlobs;
+  header_->slotBytes = slotBytes;
+
+  pthread_mutexattr_t mutexAttr;
+  pthread_mutexattr_init(&mutexAttr);
+  pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST);
+  CAFFE_ENFORCE_EQ(pthread_mutex_init(&header_->mutex, &mutexAttr), 0);
+  pthread_mutexattr_destroy(&mutexAttr);
+
+  pthread_condattr_t condAttr;
+  pthread_condattr_init(&condAttr);
+  pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+  pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+  CAFFE_ENFORCE_EQ(pthread_cond_init(&header_->notEmpty, &condAttr), 0);
+  CAFFE_ENFORCE_EQ(pthread_cond_init(&header_->notFull, &condAttr), 0);
+  pthread_condattr_destroy(&condAttr);
+
+  header_->attached = 1;
+  header_->magic.store(kMagic, std::memory_order_release);
+}
+
+ShmQueueSegment::~ShmQueueSegment() {
+  bool last;
+  {
+    ShmLock lock(&header_->mutex);
+    last = --header_->attached == 0;
+    if (last) {
+      // Processes that opened the object but did not attach yet retry.
+      header_->attached = -1;
+      shm_unlink(name_.c_str());
+    }
+  }
+  munmap(header_, size_);
+}
+
+void ShmQueueSegment::release(int64_t pos) {
+  ShmLock lock(&header_->mutex);
+  state(pos) = kFree;
+  pthread_cond_broadcast(&header_->notFull);
+}
+
+ShmBlobsQueue::ShmBlobsQueue(
+    Workspace* ws,
+    const std::string& shmName,
+    size_t capacity,
+    size_t numBlobs,
+    size_t slotBytes)
+    // The records live in the shared memory, not in blobs of the workspace.
+    : BlobsQueue(ws, shmName, 0, numBlobs, false),
+      segment_(std::make_shared<ShmQueueSegment>(
+          shmName,
+          capacity,
+          numBlobs,
+          slotBytes)) {}
+
+bool ShmBlobsQueue::blockingRead(
+    const std::vector<Blob*>& inputs,
+    float timeout_secs) {
+  CAFFE_ENFORCE_GE(inputs.size(), numBlobs_);
+  auto* header = segment_->header();
+  struct timespec deadline;
+  if (timeout_secs > 0) {
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    const auto nsecs =
+        deadline.tv_nsec + static_cast<int64_t>(timeout_secs * 1e9);
+    deadline.tv_sec += nsecs / 1000000000;
+    deadline.tv_nsec = nsecs % 1000000000;
+  }
+  int64_t pos;
+  {
+    ShmLock lock(&header->mutex);
+    while (segment_->state(header->reader) != kFull) {
+      // Records written before the queue was closed are still read.
+      if (header->closed && header->reader == header->writer) {
+        return false;
+      }
+      if (!lock.wait(
+              &header->notEmpty, timeout_secs > 0 ? &deadline : nullptr)) {
+        LOG(ERROR) << "DequeueBlobs timed out in " << timeout_secs << " secs";
+        return false;
+      }
+    }
+    pos = header->reader++;
+    segment_->state(pos) = kReading;
+  }
+
+  // Owned by the tensors pointing into the slot, which is released when the
+  // last one of them goes away.
+  auto segment = segment_;
+  std::shared_ptr<void> lease(
+      nullptr, [segment, pos](void*) { segment->release(pos); });
+  const auto* metas = segment_->meta(pos);
+  char* data = segment_->data(pos);
+  for (auto i = 0; i < numBlobs_; ++i) {
+    const auto& meta = metas[i];
+    auto* tensor = inputs[i]->GetMutable<TensorCPU>();
+    tensor->Resize(std::vector<TIndex>(meta.dims, meta.dims + meta.ndim));
+    tensor->ShareExternalPointer(
+        data + meta.offset,
+        DataTypeToTypeMeta(
+            static_cast<TensorProto::DataType>(meta.dataType)),
+        meta.nbytes,
+        [lease](void*) {});
+  }
+  return true;
+}
+
+bool ShmBlobsQueue::tryWrite(const std::vector<Blob*>& inputs) {
+  return write(inputs, false);
+}
+
+bool ShmBlobsQueue::blockingWrite(const std::vector<Blob*>& inputs) {
+  return write(inputs, true);
+}
+
+bool ShmBlobsQueue::write(const std::vector<Blob*>& inputs, bool blocking) {
+  CAFFE_ENFORCE_EQ(inputs.size(), numBlobs_);
+  auto* header = segment_->header();
+  std::vector<ShmTensorMeta> metas(numBlobs_);
+  size_t bytes = 0;
+  for (auto i = 0; i < numBlobs_; ++i) {
+    CAFFE_ENFORCE(
+        inputs[i]->IsType<TensorCPU>(),
+        "Only CPU tensors can be written into a shm queue, not ",
+        inputs[i]->TypeName());
+    const auto& tensor = inputs[i]->Get<TensorCPU>();
+    const auto dataType = TypeMetaToDataType(tensor.meta());
+    CAFFE_ENFORCE(
+        dataType != TensorProto_DataType_UNDEFINED &&
+            dataType != TensorProto_DataType_STRING,
+        "Tensors of ",
+        tensor.meta().name(),
+        " can't be written into a shm queue.");
+    CAFFE_ENFORCE_LE(tensor.ndim(), kMaxDims);
+    auto& meta = metas[i];
+    meta.dataType = dataType;
+    meta.ndim = tensor.ndim();
+    std::copy(tensor.dims().begin(), tensor.dims().end(), meta.dims);
+    meta.offset = bytes;
+    meta.nbytes = tensor.nbytes();
+    bytes = alignUp(bytes + meta.nbytes);
+  }
+  CAFFE_ENFORCE_LE(
+      bytes,
+      header->slotBytes,
+      "The record needs ",
+      bytes,
+      " bytes, more than the slots of the shm queue have.");
+
+  int64_t pos;
+  {
+    ShmLock lock(&header->mutex);
+    while (segment_->state(header->writer) != kFree) {
+      if (header->closed || !blocking) {
+        return false;
+      }
+      lock.wait(&header->notFull, nullptr);
+    }
+    if (header->closed) {
+      return false;
+    }
+    pos = header->writer++;
+    segment_->state(pos) = kWriting;
+  }
+
+  // The slot is ours, copy the record without holding the lock.
+  char* data = segment_->data(pos);
+  for (auto i = 0; i < numBlobs_; ++i) {
+    if (metas[i].nbytes > 0) {
+      std::memcpy(
+          data + metas[i].offset,
+          inputs[i]->Get<TensorCPU>().raw_data(),
+          metas[i].nbytes);
+    }
+  }
+  std::copy(metas.begin(), metas.end(), segment_->meta(pos));
+
+  ShmLock lock(&header->mutex);
+  segment_->state(pos) = kFull;
+  pthread_cond_broadcast(&header->notEmpty);
+  return true;
+}
+
+void ShmBlobsQueue::close() {
+  BlobsQueue::close();
+  auto* header = segment_->header();
+  ShmLock lock(&header->mutex);
+  header->closed = 1;
+  pthread_cond_broadcast(&header->notEmpty);
+  pthread_cond_broadcast(&header->notFull);
+}
+
+} // namespace caffe2
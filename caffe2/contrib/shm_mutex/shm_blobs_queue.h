@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <pthread.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "caffe2/queue/blobs_queue.h"
+
+namespace caffe2 {
+
+struct ShmQueueHeader;
+class ShmQueueSegment;
+
+// A BlobsQueue shared by the processes of a host, e.g. a reader process
+// feeding a trainer process, through a POSIX shared memory object.
+//
+// The shared memory holds capacity slots of slot_bytes each. A writer copies
+// the CPU tensors of a record into a free slot, and a reader gets tensors
+// that point straight into the slot, without any copy. The slot is given
+// back once all of these tensors are freed or reallocated, so readers should
+// not keep them around longer than needed. Records are read in the order
+// they were written.
+//
+// The slots are guarded by a process-shared, robust pthread mutex and
+// condition variables, so waiting processes sleep on a futex, and a
+// process that dies while holding the mutex does not block the others.
+//
+// All processes open the queue with the same name and parameters; the
+// first one creates the shared memory, and the last one to go away removes
+// it. close() closes the queue for all of them.
+class ShmBlobsQueue : public BlobsQueue {
+ public:
+  ShmBlobsQueue(
+      Workspace* ws,
+      const std::string& shmName,
+      size_t capacity,
+      size_t numBlobs,
+      size_t slotBytes);
+
+  bool blockingRead(const std::vector<Blob*>& inputs, float timeout_secs = 0.0f)
+      override;
+  bool tryWrite(const std::vector<Blob*>& inputs) override;
+  bool blockingWrite(const std::vector<Blob*>& inputs) override;
+  void close() override;
+
+ private:
+  bool write(const std::vector<Blob*>& inputs, bool blocking);
+
+  std::shared_ptr<ShmQueueSegment> segment_;
+};
+
+} // namespace caffe2
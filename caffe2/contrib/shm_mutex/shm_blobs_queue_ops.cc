@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shm_blobs_queue.h"
+
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+namespace {
+
+class CreateShmBlobsQueueOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  CreateShmBlobsQueueOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        ws_(ws),
+        shmName_(GetSingleArgument<std::string>(
+            "shm_name",
+            "/" + operator_def.output(0))),
+        capacity_(GetSingleArgument<int>("capacity", 1)),
+        numBlobs_(GetSingleArgument<int>("num_blobs", 1)),
+        slotBytes_(GetSingleArgument<int64_t>("slot_bytes", 0)) {
+    CAFFE_ENFORCE_GT(capacity_, 0, "capacity must be positive.");
+    CAFFE_ENFORCE_GT(numBlobs_, 0, "num_blobs must be positive.");
+    CAFFE_ENFORCE_GT(slotBytes_, 0, "slot_bytes is required.");
+  }
+
+  bool RunOnDevice() override {
+    *OperatorBase::Output<std::shared_ptr<BlobsQueue>>(0) =
+        std::make_shared<ShmBlobsQueue>(
+            ws_, shmName_, capacity_, numBlobs_, slotBytes_);
+    return true;
+  }
+
+ private:
+  Workspace* ws_;
+  const std::string shmName_;
+  const int capacity_;
+  const int numBlobs_;
+  const int64_t slotBytes_;
+};
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(CreateShmBlobsQueue, CreateShmBlobsQueueOp);
+
+OPERATOR_SCHEMA(CreateShmBlobsQueue)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Opens a BlobsQueue shared by the processes of a host through POSIX shared
+memory, for instance to feed a trainer process from a reader process. All the
+processes open it with the same arguments. It is used with EnqueueBlobs,
+DequeueBlobs and CloseBlobsQueue like any other queue; closing it closes it
+for all the processes.
+
+Writes copy the CPU tensors of a record into a slot of the shared memory.
+Reads do not copy: the dequeued tensors point into the slot, which is reused
+once they are freed or reallocated, e.g. by the next dequeue into the same
+blobs.
+)DOC")
+    .Arg(
+        "shm_name",
+        "(string) name of the shared memory object, defaults to / followed "
+        "by the name of the output.")
+    .Arg("capacity", "(int, default 1) number of records the queue holds.")
+    .Arg("num_blobs", "(int, default 1) number of blobs of a record.")
+    .Arg("slot_bytes", "(int) bytes of the largest record.")
+    .Output(0, "queue", "The queue.");
+
+SHOULD_NOT_DO_GRADIENT(CreateShmBlobsQueue);
+
+} // namespace caffe2
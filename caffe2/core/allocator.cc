@@ -14,8 +14,14 @@
  * limitations under the License.
  */
 
+#include <atomic>
+#include <cstring>
+#include <vector>
+
 #include "caffe2/core/context.h"
+#include "caffe2/core/init.h"
 #include "caffe2/core/logging.h"
+#include "caffe2/core/static_tracepoint.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/core/typeid.h"
 
@@ -29,10 +35,30 @@ CAFFE2_DEFINE_bool(
     true,
     "If set, do memory zerofilling when allocating on CPU");
 
+CAFFE2_DEFINE_bool(
+    caffe2_cpu_caching_allocator,
+    false,
+    "If set, use the caching CPU allocator, which keeps freed blocks in "
+    "size-class free lists instead of returning them to the system.");
+
+CAFFE2_DEFINE_int64(
+    caffe2_cpu_caching_allocator_max_cached_bytes,
+    1LL << 30,
+    "Maximum number of bytes the caching CPU allocator keeps in its global "
+    "pool.");
+
 namespace caffe2 {
 
 void NoDelete(void*) {}
 
+namespace {
+
+// Allocations from which DefaultCPUAllocator binds the memory to the NUMA node
+// of the allocating thread.
+constexpr size_t kNUMAMoveMinBytes = 1 << 20;
+
+} // namespace
+
 static std::unique_ptr<CPUAllocator> g_cpu_allocator(new DefaultCPUAllocator());
 CPUAllocator* GetCPUAllocator() {
   return g_cpu_allocator.get();
@@ -42,24 +68,325 @@ void SetCPUAllocator(CPUAllocator* alloc) {
   g_cpu_allocator.reset(alloc);
 }
 
+namespace {
+
+void* AlignedAlloc(size_t nbytes) {
+  void* data = nullptr;
+#ifdef __ANDROID__
+  data = memalign(gCaffe2Alignment, nbytes);
+#elif defined(_MSC_VER)
+  data = _aligned_malloc(nbytes, gCaffe2Alignment);
+#else
+  CAFFE_ENFORCE_EQ(posix_memalign(&data, gCaffe2Alignment, nbytes), 0);
+#endif
+  CAFFE_ENFORCE(data);
+  return data;
+}
+
+void AlignedFree(void* data) {
+#ifdef _MSC_VER
+  _aligned_free(data);
+#else
+  free(data);
+#endif
+}
+
+} // namespace
+
+std::pair<void*, MemoryDeleter> DefaultCPUAllocator::New(size_t nbytes) {
+  void* data = AlignedAlloc(nbytes);
+  // Keep large allocations on the node of the allocating thread, which the
+  // net executors bind to the NUMA node of their net. This is done before the
+  // zero fill faults the pages in, so they need no moving. Smaller ones share
+  // pages with other data, and come from per-thread malloc arenas that the
+  // thread binding already places.
+  if (nbytes >= kNUMAMoveMinBytes && IsNUMAEnabled()) {
+    NUMAMove(data, nbytes, GetCurrentNUMANode());
+  }
+  if (FLAGS_caffe2_cpu_allocator_do_zero_fill) {
+    memset(data, 0, nbytes);
+  }
+  CAFFE_SDT(cpu_alloc, data, nbytes);
+  return {data, Delete};
+}
+
+void DefaultCPUAllocator::Delete(void* data) {
+  CAFFE_SDT(cpu_free, data);
+  AlignedFree(data);
+}
+
 MemoryAllocationReporter CPUContext::reporter_;
 
-void MemoryAllocationReporter::New(void* ptr, size_t nbytes) {
+MemoryAllocationReporter* GetCPUMemoryAllocationReporter() {
+  return &CPUContext::reporter_;
+}
+
+void MemoryAllocationReporter::New(
+    void* ptr,
+    size_t nbytes,
+    MemoryDeleter deleter) {
   std::lock_guard<std::mutex> guard(mutex_);
-  size_table_[ptr] = nbytes;
+  size_table_[ptr] = {nbytes, deleter};
   allocated_ += nbytes;
   LOG(INFO) << "Caffe2 alloc " << nbytes << " bytes, total alloc " << allocated_
             << " bytes.";
 }
 
-void MemoryAllocationReporter::Delete(void* ptr) {
+MemoryDeleter MemoryAllocationReporter::Delete(void* ptr) {
   std::lock_guard<std::mutex> guard(mutex_);
   auto it = size_table_.find(ptr);
   CHECK(it != size_table_.end());
-  allocated_ -= it->second;
-  LOG(INFO) << "Caffe2 deleted " << it->second << " bytes, total alloc "
+  allocated_ -= it->second.first;
+  LOG(INFO) << "Caffe2 deleted " << it->second.first << " bytes, total alloc "
             << allocated_ << " bytes.";
+  const MemoryDeleter deleter = it->second.second;
   size_table_.erase(it);
+  return deleter;
+}
+
+void MemoryAllocationReporter::CacheHit(size_t nbytes) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  ++cache_hits_;
+  LOG(INFO) << "Caffe2 cache hit for " << nbytes << " bytes, " << cache_hits_
+            << " hits and " << cache_misses_ << " misses so far.";
+}
+
+void MemoryAllocationReporter::CacheMiss(size_t nbytes) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  ++cache_misses_;
+  LOG(INFO) << "Caffe2 cache miss for " << nbytes << " bytes, " << cache_hits_
+            << " hits and " << cache_misses_ << " misses so far.";
+}
+
+namespace {
+
+// Size classes are powers of two from 2^kMinSizeClassLog2 to
+// 2^kMaxSizeClassLog2 bytes.
+constexpr int kMinSizeClassLog2 = 6;
+constexpr int kMaxSizeClassLog2 = 28;
+constexpr int kNumSizeClasses = kMaxSizeClassLog2 - kMinSizeClassLog2 + 1;
+// Only classes up to 1MB are kept in the per-thread caches, with at most
+// kMaxThreadLocalBlocks blocks per class.
+constexpr int kMaxThreadLocalSizeClass = 20 - kMinSizeClassLog2;
+constexpr size_t kMaxThreadLocalBlocks = 4;
+
+// Every block is prefixed with a header of gCaffe2Alignment bytes so that the
+// deleter can find out the size class of the block it is given.
+struct BlockHeader {
+  int32_t size_class;
+};
+static_assert(
+    sizeof(BlockHeader) <= gCaffe2Alignment,
+    "Block header does not fit the alignment padding.");
+
+int SizeClass(size_t nbytes) {
+  int log2 = kMinSizeClassLog2;
+  while ((size_t(1) << log2) < nbytes) {
+    if (++log2 > kMaxSizeClassLog2) {
+      return -1;
+    }
+  }
+  return log2 - kMinSizeClassLog2;
+}
+
+size_t SizeClassBytes(int size_class) {
+  return size_t(1) << (size_class + kMinSizeClassLog2);
+}
+
+// The block is not zero filled; CachingCPUAllocator::New does it for the
+// bytes asked for.
+void* AllocateBlock(size_t nbytes, int size_class) {
+  void* data = AlignedAlloc(gCaffe2Alignment + nbytes);
+  static_cast<BlockHeader*>(data)->size_class = size_class;
+  return static_cast<char*>(data) + gCaffe2Alignment;
+}
+
+BlockHeader* HeaderOf(void* ptr) {
+  return reinterpret_cast<BlockHeader*>(
+      static_cast<char*>(ptr) - gCaffe2Alignment);
+}
+
+void FreeBlock(void* ptr) {
+  AlignedFree(HeaderOf(ptr));
+}
+
+class GlobalBlockPool {
+ public:
+  bool Pop(int size_class, void** ptr) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto& blocks = blocks_[size_class];
+    if (blocks.empty()) {
+      return false;
+    }
+    *ptr = blocks.back();
+    blocks.pop_back();
+    cached_bytes_ -= SizeClassBytes(size_class);
+    return true;
+  }
+
+  void Push(int size_class, void* ptr) {
+    const size_t nbytes = SizeClassBytes(size_class);
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (cached_bytes_ + nbytes <=
+          FLAGS_caffe2_cpu_caching_allocator_max_cached_bytes) {
+        blocks_[size_class].push_back(ptr);
+        cached_bytes_ += nbytes;
+        return;
+      }
+    }
+    FreeBlock(ptr);
+  }
+
+  void FreeAll() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto& blocks : blocks_) {
+      for (void* ptr : blocks) {
+        FreeBlock(ptr);
+      }
+      blocks.clear();
+    }
+    cached_bytes_ = 0;
+  }
+
+  size_t cached_bytes() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return cached_bytes_;
+  }
+
+  std::atomic<size_t> hits{0};
+  std::atomic<size_t> misses{0};
+
+ private:
+  std::mutex mutex_;
+  std::vector<void*> blocks_[kNumSizeClasses];
+  size_t cached_bytes_ = 0;
+};
+
+GlobalBlockPool& GetGlobalBlockPool() {
+  // Leaked on purpose: tensors may be freed during static destruction.
+  static auto* pool = new GlobalBlockPool();
+  return *pool;
+}
+
+// thread_local objects with destructors are not supported on all Apple
+// platforms, there we only use the global pool.
+#ifndef __APPLE__
+struct ThreadLocalBlockCache {
+  std::vector<void*> blocks[kNumSizeClasses];
+};
+
+// The cache is reached through trivially destructible thread_locals, which
+// stay usable after the thread_local destructors of the thread ran: tensors
+// freed later, such as the ones of static workspaces freed during static
+// destruction, then go to the global pool.
+thread_local ThreadLocalBlockCache* tl_block_cache = nullptr;
+thread_local bool tl_block_cache_destroyed = false;
+
+// Hands the blocks of the thread's cache over to the global pool when the
+// thread exits.
+struct ThreadLocalBlockCacheReleaser {
+  ~ThreadLocalBlockCacheReleaser() {
+    tl_block_cache_destroyed = true;
+    for (int i = 0; i < kNumSizeClasses; ++i) {
+      for (void* ptr : tl_block_cache->blocks[i]) {
+        GetGlobalBlockPool().Push(i, ptr);
+      }
+    }
+    delete tl_block_cache;
+    tl_block_cache = nullptr;
+  }
+};
+
+// Returns nullptr once the cache of the thread is destroyed.
+ThreadLocalBlockCache* GetThreadLocalBlockCache() {
+  if (!tl_block_cache && !tl_block_cache_destroyed) {
+    static thread_local ThreadLocalBlockCacheReleaser releaser;
+    tl_block_cache = new ThreadLocalBlockCache();
+  }
+  return tl_block_cache;
+}
+#endif // __APPLE__
+
+} // namespace
+
+std::pair<void*, MemoryDeleter> CachingCPUAllocator::New(size_t nbytes) {
+  const int size_class = SizeClass(nbytes);
+  auto& pool = GetGlobalBlockPool();
+  void* data = nullptr;
+  if (size_class < 0) {
+    data = AllocateBlock(nbytes, size_class);
+  } else {
+#ifndef __APPLE__
+    auto* cache = GetThreadLocalBlockCache();
+    if (cache && !cache->blocks[size_class].empty()) {
+      data = cache->blocks[size_class].back();
+      cache->blocks[size_class].pop_back();
+    }
+#endif // __APPLE__
+    if (!data) {
+      pool.Pop(size_class, &data);
+    }
+    if (data) {
+      pool.hits++;
+      if (FLAGS_caffe2_report_cpu_memory_usage) {
+        GetCPUMemoryAllocationReporter()->CacheHit(nbytes);
+      }
+    } else {
+      data = AllocateBlock(SizeClassBytes(size_class), size_class);
+      pool.misses++;
+      if (FLAGS_caffe2_report_cpu_memory_usage) {
+        GetCPUMemoryAllocationReporter()->CacheMiss(nbytes);
+      }
+    }
+  }
+  if (FLAGS_caffe2_cpu_allocator_do_zero_fill) {
+    memset(data, 0, nbytes);
+  }
+  CAFFE_SDT(cpu_cached_alloc, data, nbytes, size_class);
+  return {data, Delete};
+}
+
+void CachingCPUAllocator::Delete(void* data) {
+  if (!data) {
+    return;
+  }
+  const int size_class = HeaderOf(data)->size_class;
+  CAFFE_SDT(cpu_cached_free, data, size_class);
+  if (size_class < 0) {
+    FreeBlock(data);
+    return;
+  }
+#ifndef __APPLE__
+  auto* cache = GetThreadLocalBlockCache();
+  if (cache && size_class <= kMaxThreadLocalSizeClass &&
+      cache->blocks[size_class].size() < kMaxThreadLocalBlocks) {
+    cache->blocks[size_class].push_back(data);
+    return;
+  }
+#endif // __APPLE__
+  GetGlobalBlockPool().Push(size_class, data);
+}
+
+void CachingCPUAllocator::FreeCached() {
+  GetGlobalBlockPool().FreeAll();
+}
+
+CachingCPUAllocator::Stats CachingCPUAllocator::GetStats() {
+  auto& pool = GetGlobalBlockPool();
+  return Stats{pool.hits, pool.misses, pool.cached_bytes()};
+}
+
+bool Caffe2SetCPUAllocator(int*, char***) {
+  if (FLAGS_caffe2_cpu_caching_allocator) {
+    VLOG(1) << "Using the caching CPU allocator.";
+    SetCPUAllocator(new CachingCPUAllocator());
+  }
+  return true;
 }
+REGISTER_CAFFE2_INIT_FUNCTION(
+    Caffe2SetCPUAllocator,
+    &Caffe2SetCPUAllocator,
+    "Select the CPU allocator.");
 
 } // namespace caffe2
@@ -17,12 +17,16 @@
 #ifndef CAFFE2_CORE_ALLOCATOR_H_
 #define CAFFE2_CORE_ALLOCATOR_H_
 
+#include <mutex>
 #include <unordered_map>
 
 #include "caffe2/core/logging.h"
+#include "caffe2/core/numa.h"
 
 CAFFE2_DECLARE_bool(caffe2_report_cpu_memory_usage);
 CAFFE2_DECLARE_bool(caffe2_cpu_allocator_do_zero_fill);
+CAFFE2_DECLARE_bool(caffe2_cpu_caching_allocator);
+CAFFE2_DECLARE_int64(caffe2_cpu_caching_allocator_max_cached_bytes);
 
 namespace caffe2 {
 
@@ -46,48 +50,68 @@ struct CPUAllocator {
 // deallocation status
 class MemoryAllocationReporter {
  public:
-  MemoryAllocationReporter() : allocated_(0) {}
-  void New(void* ptr, size_t nbytes);
-  void Delete(void* ptr);
+  MemoryAllocationReporter()
+      : allocated_(0), cache_hits_(0), cache_misses_(0) {}
+  // Records ptr, allocated by an allocator whose deleter is deleter.
+  void New(void* ptr, size_t nbytes, MemoryDeleter deleter);
+  // Forgets ptr and returns the deleter it was recorded with.
+  MemoryDeleter Delete(void* ptr);
+  // Called by caching allocators for every request served from (hit) or
+  // missing in (miss) their cache.
+  void CacheHit(size_t nbytes);
+  void CacheMiss(size_t nbytes);
 
  private:
   std::mutex mutex_;
-  std::unordered_map<void*, size_t> size_table_;
+  std::unordered_map<void*, std::pair<size_t, MemoryDeleter>> size_table_;
   size_t allocated_;
+  size_t cache_hits_;
+  size_t cache_misses_;
 };
 
+// Returns the reporter used by CPUContext.
+MemoryAllocationReporter* GetCPUMemoryAllocationReporter();
+
 struct DefaultCPUAllocator final : CPUAllocator {
   DefaultCPUAllocator() {}
   ~DefaultCPUAllocator() override {}
-  std::pair<void*, MemoryDeleter> New(size_t nbytes) override {
-    void* data = nullptr;
-#ifdef __ANDROID__
-    data = memalign(gCaffe2Alignment, nbytes);
-#elif defined(_MSC_VER)
-    data = _aligned_malloc(nbytes, gCaffe2Alignment);
-#else
-    CAFFE_ENFORCE_EQ(posix_memalign(&data, gCaffe2Alignment, nbytes), 0);
-#endif
-    CAFFE_ENFORCE(data);
-    if (FLAGS_caffe2_cpu_allocator_do_zero_fill) {
-      memset(data, 0, nbytes);
-    }
-    return {data, Delete};
-  }
+  // Defined in allocator.cc, as tracepoints must not live in inline
+  // functions.
+  std::pair<void*, MemoryDeleter> New(size_t nbytes) override;
+  static void Delete(void* data);
 
-#ifdef _MSC_VER
-  static void Delete(void* data) {
-    _aligned_free(data);
-  }
-#else
-  static void Delete(void* data) {
-    free(data);
+  MemoryDeleter GetDeleter() override {
+    return Delete;
   }
-#endif
+};
 
+// A CPU allocator that caches freed blocks in power-of-two size classes
+// instead of returning them to the system, which avoids malloc/free churn for
+// tensors that are re-Resize()d every iteration. Freed blocks first go to a
+// small per-thread cache and then to a global pool holding at most
+// caffe2_cpu_caching_allocator_max_cached_bytes; blocks that do not fit are
+// released. Requests above the largest size class are not cached.
+//
+// The cache is process-wide and shared by all instances, so memory allocated
+// by one instance can be freed through the deleter of any other.
+struct CachingCPUAllocator final : CPUAllocator {
+  struct Stats {
+    size_t hits;
+    size_t misses;
+    size_t cached_bytes;
+  };
+
+  CachingCPUAllocator() {}
+  ~CachingCPUAllocator() override {}
+  std::pair<void*, MemoryDeleter> New(size_t nbytes) override;
   MemoryDeleter GetDeleter() override {
     return Delete;
   }
+  static void Delete(void* data);
+
+  // Releases all blocks held by the global pool back to the system.
+  static void FreeCached();
+  static Stats GetStats();
 };
 
 // Get the CPU Alloctor.
@@ -0,0 +1,733 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/backward_pass.h"
+
+#include <algorithm>
+#include <sstream>
+#include <unordered_set>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Where the gradient of a blob version comes from. A dense gradient is the
+// output idx of the gradient operator op, and a sparse one is made of the
+// output idx of op (the indices) and the output values_idx of values_op (the
+// values). The operators are indices into the gradient operators built so
+// far, or -1 when the gradient is passed through from the gradient of an
+// output, as by Sum, rather than computed by a gradient operator.
+struct GradientGenerator {
+  bool sparse;
+  int op;
+  int idx;
+  int values_op;
+  int values_idx;
+  GradientWrapper gradient;
+};
+
+// The index of the gradient that name is, or is part of, or -1.
+int GetIndexFromGradientList(
+    const vector<GradientWrapper>& gradients,
+    const string& name) {
+  for (int i = 0; i < gradients.size(); ++i) {
+    const auto& g = gradients[i];
+    if (g.IsDense() ? g.dense_ == name
+                    : (g.IsSparse() &&
+                       (g.indices_ == name || g.values_ == name))) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// The version of the last of names that is name, or -1.
+int GetVersion(
+    const google::protobuf::RepeatedPtrField<string>& names,
+    const vector<int>& versions,
+    const string& name) {
+  for (int i = names.size() - 1; i >= 0; --i) {
+    if (names.Get(i) == name) {
+      return versions[i];
+    }
+  }
+  return -1;
+}
+
+template <typename T>
+T& AtVersion(vector<T>* per_version, int version) {
+  if (per_version->size() <= version) {
+    per_version->resize(version + 1);
+  }
+  return (*per_version)[version];
+}
+
+string RemoveSuffix(const string& s, const string& suffix) {
+  if (s.size() >= suffix.size() &&
+      s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0) {
+    return s.substr(0, s.size() - suffix.size());
+  }
+  return s;
+}
+
+class BackwardPassBuilder {
+ public:
+  BackwardPassBuilder(const NetDef& net, const DeviceOption* device_option)
+      : net_(net), device_option_(device_option) {
+    in_versions_.resize(net_.op_size());
+    out_versions_.resize(net_.op_size());
+    for (int i = 0; i < net_.op_size(); ++i) {
+      Play(i);
+    }
+    SanityCheck();
+  }
+
+  BackwardPass Build(const vector<std::pair<string, GradientWrapper>>& ys) {
+    for (const auto& y : ys) {
+      const int version = frontier_[y.first];
+      gradient_frontier_[y.first] = version;
+      AtVersion(&input_usages_[y.first], version).push_back(net_.op_size());
+    }
+    std::unordered_map<string, GradientWrapper> input_to_grad;
+    for (const auto& y : ys) {
+      GradientWrapper g = y.second;
+      if (g.IsEmpty()) {
+        // Autogenerated gradients are dense, and provided for the last
+        // version of the blob.
+        g.dense_ = y.first + "_autogen_grad";
+        gradient_ops_.push_back(MakeOperator(
+            "ConstantFill",
+            {y.first},
+            {g.dense_},
+            {MakeArgument<float>("value", 1.0f)}));
+        AtVersion(&gradient_generators_[y.first], Frontier(y.first))
+            .push_back(Dense(gradient_ops_.size() - 1, 0, g));
+      }
+      input_to_grad[y.first] = g;
+    }
+
+    // Plays the operators backwards. The gradient operators cannot read
+    // versions older than the frontier, as they have been overwritten.
+    for (int i = net_.op_size() - 1; i >= 0; --i) {
+      GenerateGradientsForForwardOp(i, &input_to_grad);
+      DoGradientAccumulation(i, &input_to_grad);
+    }
+
+    BackwardPass backward_pass;
+    backward_pass.gradient_ops = std::move(gradient_ops_);
+    for (auto& entry : input_to_grad) {
+      if (!entry.second.IsEmpty()) {
+        backward_pass.input_to_grad.insert(std::move(entry));
+      }
+    }
+    return backward_pass;
+  }
+
+ private:
+  static GradientGenerator
+  Dense(int op, int idx, const GradientWrapper& gradient) {
+    return GradientGenerator{false, op, idx, -1, 0, gradient};
+  }
+
+  static GradientGenerator Sparse(
+      int indices_op,
+      int indices_idx,
+      int values_op,
+      int values_idx,
+      const GradientWrapper& gradient) {
+    return GradientGenerator{
+        true, indices_op, indices_idx, values_op, values_idx, gradient};
+  }
+
+  // Records the input and output versions of an operator, and updates the
+  // frontier to the versions after it runs.
+  void Play(int op_idx) {
+    const auto& op = net_.op(op_idx);
+    for (const auto& s : op.input()) {
+      const int version = frontier_[s];
+      in_versions_[op_idx].push_back(version);
+      AtVersion(&input_usages_[s], version).push_back(op_idx);
+      in_version_history_[s].emplace_back(op_idx, version);
+    }
+    // A newly created blob starts with version zero.
+    for (const auto& s : op.output()) {
+      auto it = frontier_.find(s);
+      const int version =
+          it == frontier_.end() ? (frontier_[s] = 0) : ++it->second;
+      out_versions_[op_idx].push_back(version);
+      out_version_history_[s].emplace_back(op_idx, version);
+    }
+  }
+
+  // The output of StopGradient has to be used by another operator.
+  void SanityCheck() const {
+    for (const auto& op : net_.op()) {
+      if (op.type() == "StopGradient") {
+        CAFFE_ENFORCE(
+            input_usages_.count(op.output(0)),
+            "StopGradient's output '",
+            op.output(0),
+            "' is orphan.\nYou typically want to specify same input and "
+            "output for\nStopGradient. Op:\n\n",
+            ProtoDebugString(op));
+      }
+    }
+  }
+
+  int Frontier(const string& name) const {
+    auto it = frontier_.find(name);
+    return it == frontier_.end() ? 0 : it->second;
+  }
+
+  int InVersion(int op_idx, const string& name) const {
+    return GetVersion(net_.op(op_idx).input(), in_versions_[op_idx], name);
+  }
+
+  int OutVersion(int op_idx, const string& name) const {
+    return GetVersion(net_.op(op_idx).output(), out_versions_[op_idx], name);
+  }
+
+  string VersionHistory(
+      const string& name,
+      const std::unordered_map<string, vector<std::pair<int, int>>>& history,
+      const string& hint,
+      const string& kind) const {
+    std::stringstream ss;
+    ss << "DEBUG HELP:\n" << hint << "\n== Version history of blob [" << name
+       << "]\n";
+    auto it = history.find(name);
+    if (it != history.end()) {
+      for (const auto& entry : it->second) {
+        ss << kind << " " << entry.second << " <-- "
+           << ProtoDebugString(net_.op(entry.first)) << "\n";
+      }
+    }
+    return ss.str();
+  }
+
+  // Checks that the gradient operators of a forward operator can be carried
+  // out: they read gradients and blobs at the versions of the forward
+  // operator, or blobs the gradient operators before them produce.
+  void CheckGradientOperatorInput(
+      const string& grad_op_input,
+      const vector<GradientWrapper>& g_output,
+      int fwd_op_idx,
+      const std::unordered_set<string>& locally_generated_blobs) const {
+    const auto& forward_op = net_.op(fwd_op_idx);
+    const int original_index =
+        GetIndexFromGradientList(g_output, grad_op_input);
+    if (original_index >= 0) {
+      const string& original_name = forward_op.output(original_index);
+      const int out_version = OutVersion(fwd_op_idx, original_name);
+      auto it = gradient_frontier_.find(original_name);
+      CAFFE_ENFORCE(
+          it != gradient_frontier_.end(),
+          "No gradient frontier for ",
+          original_name);
+      CAFFE_ENFORCE(
+          out_version == it->second,
+          "Gradient name \"",
+          grad_op_input,
+          "\" is expected to correspond to version ",
+          out_version,
+          " of \"",
+          original_name,
+          "\", but currently we have version ",
+          it->second,
+          ".\n\n",
+          VersionHistory(
+              original_name,
+              out_version_history_,
+              "Maybe you use same output blob twice for different ops?",
+              "Version (out)"));
+      return;
+    }
+    const int out_version = OutVersion(fwd_op_idx, grad_op_input);
+    if (out_version >= 0) {
+      CAFFE_ENFORCE(
+          Frontier(grad_op_input) == out_version,
+          "Gradient operator needs output \"",
+          grad_op_input,
+          "\" at version ",
+          out_version,
+          ", but currently we have version ",
+          Frontier(grad_op_input),
+          ".\n\n",
+          VersionHistory(
+              grad_op_input,
+              out_version_history_,
+              "Maybe you use same output blob twice for different ops?",
+              "Version (out)"));
+      return;
+    }
+    const int in_version = InVersion(fwd_op_idx, grad_op_input);
+    if (in_version >= 0) {
+      CAFFE_ENFORCE(
+          Frontier(grad_op_input) == in_version,
+          "Gradient operator needs input \"",
+          grad_op_input,
+          "\" at version ",
+          in_version,
+          ", but currently we have version ",
+          Frontier(grad_op_input),
+          ".\n\n",
+          VersionHistory(
+              grad_op_input,
+              in_version_history_,
+              "Maybe the blob was overwritten by another op?",
+              "version (in)"));
+      return;
+    }
+    CAFFE_ENFORCE(
+        locally_generated_blobs.count(grad_op_input),
+        "Blob name \"",
+        grad_op_input,
+        "\" not in the scope of operator: ",
+        ProtoDebugString(forward_op),
+        "\nand is not generated by any of the local gradient operators.");
+  }
+
+  // Checks the gradient operators of a forward operator, the ones from
+  // first_grad_op on, and updates the gradient generators and the gradient
+  // frontier.
+  void BuildGradientGenerators(
+      int fwd_op_idx,
+      int first_grad_op,
+      const vector<GradientWrapper>& g_output,
+      const vector<GradientWrapper>& g_input) {
+    const auto& forward_op = net_.op(fwd_op_idx);
+    std::unordered_set<string> locally_generated_blobs;
+    // The partial generators of the sparse gradients, of either the indices
+    // or the values, in the order they are found.
+    vector<std::pair<std::pair<string, int>, vector<GradientGenerator>>>
+        sparse_generators;
+
+    for (int k = first_grad_op; k < gradient_ops_.size(); ++k) {
+      const auto& grad_op = gradient_ops_[k];
+      for (const auto& s : grad_op.input()) {
+        CheckGradientOperatorInput(
+            s, g_output, fwd_op_idx, locally_generated_blobs);
+      }
+      for (const auto& s : grad_op.output()) {
+        locally_generated_blobs.insert(s);
+      }
+      for (int i = 0; i < grad_op.output_size(); ++i) {
+        const string& output = grad_op.output(i);
+        const int input_index = GetIndexFromGradientList(g_input, output);
+        if (input_index < 0) {
+          continue;
+        }
+        const string& input_name = forward_op.input(input_index);
+        const int input_version = InVersion(fwd_op_idx, input_name);
+        const auto& g = g_input[input_index];
+        if (!g.IsSparse()) {
+          AtVersion(&gradient_generators_[input_name], input_version)
+              .push_back(Dense(k, i, g));
+          continue;
+        }
+        const auto key = std::make_pair(input_name, input_version);
+        auto it = std::find_if(
+            sparse_generators.begin(),
+            sparse_generators.end(),
+            [&key](const std::pair<
+                   std::pair<string, int>,
+                   vector<GradientGenerator>>& entry) {
+              return entry.first == key;
+            });
+        if (it == sparse_generators.end()) {
+          sparse_generators.emplace_back(key, vector<GradientGenerator>());
+          it = sparse_generators.end() - 1;
+        }
+        it->second.push_back(
+            g.indices_ == output ? Sparse(k, i, -1, 0, g)
+                                 : Sparse(-1, 0, k, i, g));
+      }
+    }
+
+    // Merges the generators of the indices and of the values of the same
+    // sparse gradient.
+    for (const auto& entry : sparse_generators) {
+      const auto& generators = entry.second;
+      GradientGenerator generator = generators[0];
+      if (generators.size() == 2) {
+        const auto& other = generators[1];
+        CAFFE_ENFORCE(generator.op < 0 || other.op < 0);
+        CAFFE_ENFORCE(generator.values_op < 0 || other.values_op < 0);
+        generator.op = std::max(generator.op, other.op);
+        generator.idx += other.idx;
+        generator.values_op = std::max(generator.values_op, other.values_op);
+        generator.values_idx += other.values_idx;
+      } else {
+        CAFFE_ENFORCE_EQ(generators.size(), 1);
+      }
+      AtVersion(
+          &gradient_generators_[entry.first.first], entry.first.second)
+          .push_back(generator);
+    }
+
+    // The gradients of inputs that are passed through from the gradients of
+    // outputs (e.g. by Add, Sum or Sub) are recorded by generators without
+    // operator, so that they are accumulated with the others.
+    for (int i = 0; i < g_input.size(); ++i) {
+      const auto& g = g_input[i];
+      if (g.IsEmpty()) {
+        continue;
+      }
+      const string& input_name = forward_op.input(i);
+      auto& generators = AtVersion(
+          &gradient_generators_[input_name], InVersion(fwd_op_idx, input_name));
+      if (g.IsSparse()) {
+        if (!locally_generated_blobs.count(g.indices_) &&
+            !locally_generated_blobs.count(g.values_)) {
+          generators.push_back(Sparse(-1, 0, -1, 0, g));
+        }
+      } else if (!locally_generated_blobs.count(g.dense_)) {
+        generators.push_back(Dense(-1, 0, g));
+      }
+    }
+
+    for (int i = 0; i < g_input.size(); ++i) {
+      if (!g_input[i].IsEmpty()) {
+        const string& input_name = forward_op.input(i);
+        gradient_frontier_[input_name] = InVersion(fwd_op_idx, input_name);
+      }
+    }
+  }
+
+  void GenerateGradientsForForwardOp(
+      int fwd_op_idx,
+      std::unordered_map<string, GradientWrapper>* input_to_grad) {
+    const auto& forward_op = net_.op(fwd_op_idx);
+    vector<GradientWrapper> g_output;
+    bool has_gradient = forward_op.type() == "ZeroGradient";
+    for (const auto& name : forward_op.output()) {
+      auto it = input_to_grad->find(name);
+      g_output.push_back(
+          it == input_to_grad->end() ? GradientWrapper() : it->second);
+      has_gradient |= !g_output.back().IsEmpty();
+    }
+    if (!has_gradient) {
+      return;
+    }
+
+    GradientOpsMeta meta;
+    try {
+      meta = GetGradientForOp(forward_op, g_output);
+    } catch (const EnforceNotMet& err) {
+      CAFFE_THROW(
+          "Exception when creating the gradient for [",
+          forward_op.type(),
+          "]: ",
+          err.msg(),
+          ".");
+    }
+    const int first_grad_op = gradient_ops_.size();
+    gradient_ops_.insert(
+        gradient_ops_.end(),
+        std::make_move_iterator(meta.ops_.begin()),
+        std::make_move_iterator(meta.ops_.end()));
+    BuildGradientGenerators(
+        fwd_op_idx, first_grad_op, g_output, meta.g_input_);
+
+    // An existing gradient is not overwritten by an empty one, unless the
+    // input is also an output of the operator, and so got a new version.
+    // The updates are applied after all of them are decided, to the map
+    // before this operator.
+    vector<std::pair<string, GradientWrapper>> updates;
+    for (int i = 0; i < forward_op.input_size(); ++i) {
+      const string& name = forward_op.input(i);
+      const auto& grad = meta.g_input_[i];
+      if (!grad.IsEmpty() || !input_to_grad->count(name) ||
+          std::find(
+              forward_op.output().begin(), forward_op.output().end(), name) !=
+              forward_op.output().end()) {
+        updates.emplace_back(name, grad);
+      }
+    }
+    for (auto& update : updates) {
+      (*input_to_grad)[update.first] = std::move(update.second);
+    }
+  }
+
+  // The name of the accumulated gradient: the output of the first generator
+  // with an operator, without the suffix of the indices or the values of a
+  // sparse gradient.
+  string GetSumOpOutputName(
+      const vector<GradientGenerator>& generators,
+      const string& input_name) const {
+    for (const auto& g : generators) {
+      if (!g.sparse) {
+        if (g.op >= 0) {
+          return gradient_ops_[g.op].output(g.idx);
+        }
+        continue;
+      }
+      if (g.op >= 0) {
+        return RemoveSuffix(gradient_ops_[g.op].output(g.idx), "_indices");
+      }
+      if (g.values_op >= 0) {
+        return RemoveSuffix(
+            gradient_ops_[g.values_op].output(g.values_idx), "_values");
+      }
+    }
+    return input_name + "_grad";
+  }
+
+  // Renames output idx of a gradient operator to an intermediate name.
+  string DisambiguateGradOpOutput(int op, int idx, int* cnt) {
+    auto* output = gradient_ops_[op].mutable_output(idx);
+    *output = "_" + *output + "_autosplit_" + caffe2::to_string((*cnt)++);
+    return *output;
+  }
+
+  static void CheckSumOpsConflict(
+      const string& out_base_name,
+      const string& g) {
+    CAFFE_ENFORCE(
+        out_base_name != g,
+        "The gradient output of empty gradient op can not be the same as "
+        "the normal name of the current input gradient.");
+  }
+
+  OperatorDef MakeOperator(
+      const string& type,
+      const vector<string>& inputs,
+      const vector<string>& outputs,
+      const vector<Argument>& args) const {
+    auto op = CreateOperatorDef(type, "", inputs, outputs, args);
+    if (device_option_) {
+      op.mutable_device_option()->CopyFrom(*device_option_);
+    }
+    return op;
+  }
+
+  GradientWrapper MakeDenseSumOps(
+      const vector<GradientGenerator>& generators,
+      const string& out_base_name,
+      vector<OperatorDef>* sum_ops) {
+    vector<string> sum_op_input;
+    int cnt = 0;
+    bool first_grad_op = true;
+    for (const auto& g : generators) {
+      if (g.op >= 0) {
+        if (first_grad_op) {
+          first_grad_op = false;
+          sum_op_input.push_back(gradient_ops_[g.op].output(g.idx));
+        } else {
+          sum_op_input.push_back(DisambiguateGradOpOutput(g.op, g.idx, &cnt));
+        }
+      } else {
+        CheckSumOpsConflict(out_base_name, g.gradient.dense_);
+        sum_op_input.push_back(g.gradient.dense_);
+      }
+    }
+    // Sum works in place only for its first input.
+    auto it =
+        std::find(sum_op_input.begin(), sum_op_input.end(), out_base_name);
+    if (it != sum_op_input.end()) {
+      std::swap(sum_op_input[0], *it);
+    }
+    sum_ops->push_back(
+        MakeOperator("Sum", sum_op_input, {out_base_name}, {}));
+    GradientWrapper sum;
+    sum.dense_ = out_base_name;
+    return sum;
+  }
+
+  // Sums sparse gradients by concatenating their indices and their values,
+  // without deduplicating the indices, which is left to the optimizers.
+  GradientWrapper MakeSparseSumOps(
+      const vector<GradientGenerator>& generators,
+      const string& out_base_name,
+      vector<OperatorDef>* sum_ops) {
+    vector<string> indices_concat_input;
+    vector<string> values_concat_input;
+    int cnt_i = 0;
+    int cnt_v = 0;
+    for (const auto& g : generators) {
+      if (g.op >= 0) {
+        indices_concat_input.push_back(
+            DisambiguateGradOpOutput(g.op, g.idx, &cnt_i));
+      } else {
+        CheckSumOpsConflict(out_base_name, g.gradient.indices_);
+        indices_concat_input.push_back(g.gradient.indices_);
+      }
+      if (g.values_op >= 0) {
+        values_concat_input.push_back(
+            DisambiguateGradOpOutput(g.values_op, g.values_idx, &cnt_v));
+      } else {
+        CheckSumOpsConflict(out_base_name, g.gradient.values_);
+        values_concat_input.push_back(g.gradient.values_);
+      }
+    }
+    GradientWrapper sum;
+    sum.indices_ = out_base_name + "_indices_concat";
+    sum.values_ = out_base_name + "_values_concat";
+    sum_ops->push_back(MakeOperator(
+        "Concat",
+        indices_concat_input,
+        {sum.indices_, out_base_name + "_indices_concat_split"},
+        {MakeArgument<int>("axis", 0)}));
+    sum_ops->push_back(MakeOperator(
+        "Concat",
+        values_concat_input,
+        {sum.values_, out_base_name + "_values_concat_split"},
+        {MakeArgument<int>("axis", 0)}));
+    return sum;
+  }
+
+  GradientWrapper MakeSumOps(
+      const vector<GradientGenerator>& generators,
+      const string& input_name,
+      vector<OperatorDef>* sum_ops) {
+    const string out_base_name = GetSumOpOutputName(generators, input_name);
+    const size_t first_sum_op = sum_ops->size();
+    const auto g = generators[0].sparse
+        ? MakeSparseSumOps(generators, out_base_name, sum_ops)
+        : MakeDenseSumOps(generators, out_base_name, sum_ops);
+    // The device options were checked to be the same, so the sum operators
+    // take the first one.
+    for (const auto& generator : generators) {
+      const int op = generator.sparse && generator.values_op >= 0
+          ? generator.values_op
+          : generator.op;
+      if (op >= 0) {
+        if (gradient_ops_[op].has_device_option()) {
+          for (size_t i = first_sum_op; i < sum_ops->size(); ++i) {
+            (*sum_ops)[i].mutable_device_option()->CopyFrom(
+                gradient_ops_[op].device_option());
+          }
+        }
+        break;
+      }
+    }
+    return g;
+  }
+
+  // Returns whether the gradients of the generators need to be summed.
+  bool VerifyGradientGenerators(
+      const vector<GradientGenerator>& generators) const {
+    for (const auto& g : generators) {
+      CAFFE_ENFORCE(
+          g.sparse == generators[0].sparse,
+          "Automatic aggregation of a mix of sparse and dense gradients is "
+          "not supported yet");
+    }
+    if (generators.size() < 2) {
+      return false;
+    }
+    vector<const DeviceOption*> device_options;
+    for (const auto& g : generators) {
+      if (g.op >= 0) {
+        device_options.push_back(&gradient_ops_[g.op].device_option());
+      }
+      if (g.sparse && g.values_op >= 0) {
+        device_options.push_back(&gradient_ops_[g.values_op].device_option());
+      }
+    }
+    for (const auto* option : device_options) {
+      CAFFE_ENFORCE(
+          option->device_type() == device_options[0]->device_type() &&
+              option->cuda_gpu_id() == device_options[0]->cuda_gpu_id(),
+          "Unexpected behavior: not all grad ops have the same device "
+          "option.");
+    }
+    return true;
+  }
+
+  // Sums the gradients of the inputs of a forward operator that are used by
+  // several operators, once all of them have produced their gradients, that
+  // is at the first of them. The gradients to sum are renamed to
+  // intermediate names, except the first dense one.
+  void DoGradientAccumulation(
+      int fwd_op_idx,
+      std::unordered_map<string, GradientWrapper>* input_to_grad) {
+    const auto& forward_op = net_.op(fwd_op_idx);
+    vector<OperatorDef> sum_ops;
+    vector<std::pair<string, GradientWrapper>> grad_map;
+    for (int i = 0; i < forward_op.input_size(); ++i) {
+      const string& input_name = forward_op.input(i);
+      if (std::find(
+              forward_op.input().begin(),
+              forward_op.input().begin() + i,
+              input_name) != forward_op.input().begin() + i) {
+        continue;
+      }
+      const int input_version = InVersion(fwd_op_idx, input_name);
+      const auto& input_usage =
+          AtVersion(&input_usages_[input_name], input_version);
+      if (input_usage.size() <= 1 || input_usage[0] != fwd_op_idx) {
+        continue;
+      }
+      const auto& generators =
+          AtVersion(&gradient_generators_[input_name], input_version);
+      try {
+        if (!VerifyGradientGenerators(generators)) {
+          continue;
+        }
+      } catch (const EnforceNotMet& err) {
+        CAFFE_THROW(
+            "Gradients for param ''",
+            input_name,
+            "'' failed to verify: ",
+            err.msg());
+      }
+      grad_map.emplace_back(
+          input_name, MakeSumOps(generators, input_name, &sum_ops));
+    }
+    gradient_ops_.insert(
+        gradient_ops_.end(),
+        std::make_move_iterator(sum_ops.begin()),
+        std::make_move_iterator(sum_ops.end()));
+    for (auto& entry : grad_map) {
+      (*input_to_grad)[entry.first] = std::move(entry.second);
+    }
+  }
+
+  const NetDef& net_;
+  const DeviceOption* device_option_;
+  // The versions of the inputs and the outputs of each forward operator.
+  vector<vector<int>> in_versions_;
+  vector<vector<int>> out_versions_;
+  // The current version of every blob, after all the forward operators.
+  std::unordered_map<string, int> frontier_;
+  // For every blob version, the forward operators that read it.
+  std::unordered_map<string, vector<vector<int>>> input_usages_;
+  // The version of every blob that its current gradient is for.
+  std::unordered_map<string, int> gradient_frontier_;
+  // For every blob version, where the parts of its gradient come from.
+  std::unordered_map<string, vector<vector<GradientGenerator>>>
+      gradient_generators_;
+  // The (operator, version) pairs of every blob, for error messages.
+  std::unordered_map<string, vector<std::pair<int, int>>> in_version_history_;
+  std::unordered_map<string, vector<std::pair<int, int>>>
+      out_version_history_;
+  vector<OperatorDef> gradient_ops_;
+};
+
+} // namespace
+
+BackwardPass GetBackwardPass(
+    const NetDef& net,
+    const vector<std::pair<string, GradientWrapper>>& ys,
+    const DeviceOption* device_option) {
+  return BackwardPassBuilder(net, device_option).Build(ys);
+}
+
+} // namespace caffe2
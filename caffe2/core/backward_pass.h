@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_BACKWARD_PASS_H_
+#define CAFFE2_CORE_BACKWARD_PASS_H_
+
+#include <unordered_map>
+#include <utility>
+
+#include "caffe2/core/operator_gradient.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * The gradient operators of a forward pass, and the map from the blobs of the
+ * forward pass to their gradients. Blobs without a gradient are not in the
+ * map.
+ */
+struct BackwardPass {
+  vector<OperatorDef> gradient_ops;
+  std::unordered_map<string, GradientWrapper> input_to_grad;
+};
+
+/**
+ * @brief Builds the backward pass of the operators of a net.
+ *
+ * This is the C++ counterpart of IR.GetBackwardPass in python/core.py, with
+ * the same semantics, so that the gradients of very large nets can be built
+ * without going through python for every operator: gradients may be dense or
+ * sparse, the gradients of a blob version used by several operators are
+ * accumulated by Sum (dense) or Concat (sparse), StopGradient stops them, and
+ * a gradient operator that reads a blob version that has been overwritten is
+ * an error.
+ *
+ * ys are the blobs to compute the derivatives of and their gradients. An empty
+ * gradient is filled with ones by a ConstantFill operator. If device_option is
+ * not null, it is the device option of the operators the builder creates
+ * itself, before they take the one of the gradient operators they sum.
+ *
+ * Only the gradients registered in C++ are used; an operator whose gradient
+ * is needed but not registered is an error.
+ */
+BackwardPass GetBackwardPass(
+    const NetDef& net,
+    const vector<std::pair<string, GradientWrapper>>& ys,
+    const DeviceOption* device_option = nullptr);
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_BACKWARD_PASS_H_
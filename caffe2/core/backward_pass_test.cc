@@ -0,0 +1,264 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/backward_pass.h"
+#include "caffe2/core/operator_gradient.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// The gradient makers of core_gradients_test.py: (in -> out) leads to
+// (out_grad -> in_grad), with the outputs or the inputs of the forward
+// operator as extra inputs for the UseOutput and UseInput variants.
+class GetBackwardPassDirectGradient : public GradientMakerBase {
+  using GradientMakerBase::GradientMakerBase;
+  vector<OperatorDef> GetGradientDefs() override {
+    vector<string> inputs;
+    for (int i = 0; i < def_.output_size(); ++i) {
+      if (def_.type() == "BackwardPassUseOutput") {
+        inputs.push_back(O(i));
+      }
+    }
+    for (int i = 0; i < def_.input_size(); ++i) {
+      if (def_.type() == "BackwardPassUseInput") {
+        inputs.push_back(I(i));
+      }
+    }
+    for (int i = 0; i < def_.output_size(); ++i) {
+      inputs.push_back(GO(i));
+    }
+    vector<string> outputs;
+    for (int i = 0; i < def_.input_size(); ++i) {
+      outputs.push_back(GI(i));
+    }
+    return SingleGradientDef(
+        def_.type() + "Gradient", "", inputs, outputs);
+  }
+};
+REGISTER_GRADIENT(BackwardPassDirect, GetBackwardPassDirectGradient);
+REGISTER_GRADIENT(BackwardPassUseOutput, GetBackwardPassDirectGradient);
+REGISTER_GRADIENT(BackwardPassUseInput, GetBackwardPassDirectGradient);
+
+// (in -> out) leads to (out_grad -> in_grad_indices, in_grad_values).
+class GetBackwardPassSparseGradient : public GradientMakerBase {
+  using GradientMakerBase::GradientMakerBase;
+  vector<OperatorDef> GetGradientDefs() override {
+    return SingleGradientDef(
+        "BackwardPassSparseGradient",
+        "",
+        vector<string>{GO(0)},
+        vector<string>{GI_I(0), GI_V(0)});
+  }
+};
+REGISTER_GRADIENT(BackwardPassSparse, GetBackwardPassSparseGradient);
+
+// The gradient of the output is the gradient of the input, as for Sum.
+class GetBackwardPassPassThroughGradient : public GradientMakerBase {
+  using GradientMakerBase::GradientMakerBase;
+  vector<OperatorDef> GetGradientDefs() override {
+    SetDense(0, GO(0));
+    return vector<OperatorDef>();
+  }
+};
+REGISTER_GRADIENT(
+    BackwardPassPassThrough,
+    GetBackwardPassPassThroughGradient);
+
+NetDef MakeNet(const vector<OperatorDef>& ops) {
+  NetDef net;
+  for (const auto& op : ops) {
+    net.add_op()->CopyFrom(op);
+  }
+  return net;
+}
+
+OperatorDef Op(
+    const string& type,
+    const vector<string>& inputs,
+    const vector<string>& outputs) {
+  return CreateOperatorDef(type, "", inputs, outputs);
+}
+
+GradientWrapper Dense(const string& name) {
+  GradientWrapper g;
+  g.dense_ = name;
+  return g;
+}
+
+void ExpectOps(
+    const vector<OperatorDef>& expected,
+    const vector<OperatorDef>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].type(), actual[i].type());
+    EXPECT_EQ(
+        vector<string>(expected[i].input().begin(), expected[i].input().end()),
+        vector<string>(actual[i].input().begin(), actual[i].input().end()));
+    EXPECT_EQ(
+        vector<string>(
+            expected[i].output().begin(), expected[i].output().end()),
+        vector<string>(actual[i].output().begin(), actual[i].output().end()));
+  }
+}
+
+} // namespace
+
+TEST(BackwardPassTest, Direct) {
+  const auto net = MakeNet({Op("BackwardPassDirect", {"in"}, {"hidden"}),
+                            Op("BackwardPassDirect", {"hidden"}, {"out"})});
+  const auto backward = GetBackwardPass(net, {{"out", Dense("out_grad")}});
+  ExpectOps(
+      {Op("BackwardPassDirectGradient", {"out_grad"}, {"hidden_grad"}),
+       Op("BackwardPassDirectGradient", {"hidden_grad"}, {"in_grad"})},
+      backward.gradient_ops);
+  EXPECT_EQ(3, backward.input_to_grad.size());
+  EXPECT_EQ("in_grad", backward.input_to_grad.at("in").dense_);
+  EXPECT_EQ("hidden_grad", backward.input_to_grad.at("hidden").dense_);
+}
+
+TEST(BackwardPassTest, AutogeneratedGradient) {
+  const auto net = MakeNet({Op("BackwardPassDirect", {"in"}, {"out"})});
+  DeviceOption option;
+  option.set_device_type(CUDA);
+  option.set_cuda_gpu_id(1);
+  const auto backward =
+      GetBackwardPass(net, {{"out", GradientWrapper()}}, &option);
+  ExpectOps(
+      {Op("ConstantFill", {"out"}, {"out_autogen_grad"}),
+       Op("BackwardPassDirectGradient", {"out_autogen_grad"}, {"in_grad"})},
+      backward.gradient_ops);
+  const auto& fill = backward.gradient_ops[0];
+  EXPECT_EQ(1, fill.device_option().cuda_gpu_id());
+  ASSERT_EQ(1, fill.arg_size());
+  EXPECT_EQ("value", fill.arg(0).name());
+  EXPECT_EQ(1.0f, fill.arg(0).f());
+  EXPECT_EQ("out_autogen_grad", backward.input_to_grad.at("out").dense_);
+}
+
+TEST(BackwardPassTest, MultiUseInputIsSummed) {
+  DeviceOption option;
+  option.set_device_type(CUDA);
+  option.set_cuda_gpu_id(1);
+  vector<OperatorDef> ops = {
+      Op("BackwardPassDirect", {"in"}, {"hidden1"}),
+      Op("BackwardPassPassThrough", {"in"}, {"hidden2"}),
+      Op("BackwardPassDirect", {"in"}, {"hidden3"}),
+      Op("BackwardPassDirect", {"hidden1", "hidden2", "hidden3"}, {"out"})};
+  for (auto& op : ops) {
+    op.mutable_device_option()->CopyFrom(option);
+  }
+  const auto backward =
+      GetBackwardPass(MakeNet(ops), {{"out", Dense("out_grad")}});
+  ExpectOps(
+      {Op("BackwardPassDirectGradient",
+          {"out_grad"},
+          {"hidden1_grad", "hidden2_grad", "hidden3_grad"}),
+       Op("BackwardPassDirectGradient", {"hidden3_grad"}, {"in_grad"}),
+       Op("BackwardPassDirectGradient",
+          {"hidden1_grad"},
+          {"_in_grad_autosplit_0"}),
+       Op("Sum",
+          {"in_grad", "hidden2_grad", "_in_grad_autosplit_0"},
+          {"in_grad"})},
+      backward.gradient_ops);
+  EXPECT_EQ(1, backward.gradient_ops[3].device_option().cuda_gpu_id());
+  EXPECT_EQ("in_grad", backward.input_to_grad.at("in").dense_);
+}
+
+TEST(BackwardPassTest, MultiUseSparseInputIsConcatenated) {
+  const auto net = MakeNet({Op("BackwardPassSparse", {"in"}, {"hidden1"}),
+                            Op("BackwardPassSparse", {"in"}, {"hidden2"}),
+                            Op("BackwardPassDirect",
+                               {"hidden1", "hidden2"},
+                               {"out"})});
+  const auto backward = GetBackwardPass(net, {{"out", Dense("out_grad")}});
+  ExpectOps(
+      {Op("BackwardPassDirectGradient",
+          {"out_grad"},
+          {"hidden1_grad", "hidden2_grad"}),
+       Op("BackwardPassSparseGradient",
+          {"hidden2_grad"},
+          {"_in_grad_indices_autosplit_0", "_in_grad_values_autosplit_0"}),
+       Op("BackwardPassSparseGradient",
+          {"hidden1_grad"},
+          {"_in_grad_indices_autosplit_1", "_in_grad_values_autosplit_1"}),
+       Op("Concat",
+          {"_in_grad_indices_autosplit_0", "_in_grad_indices_autosplit_1"},
+          {"in_grad_indices_concat", "in_grad_indices_concat_split"}),
+       Op("Concat",
+          {"_in_grad_values_autosplit_0", "_in_grad_values_autosplit_1"},
+          {"in_grad_values_concat", "in_grad_values_concat_split"})},
+      backward.gradient_ops);
+  const auto& g = backward.input_to_grad.at("in");
+  EXPECT_EQ("in_grad_indices_concat", g.indices_);
+  EXPECT_EQ("in_grad_values_concat", g.values_);
+}
+
+TEST(BackwardPassTest, MixedSparseAndDenseGradientsFail) {
+  const auto net = MakeNet({Op("BackwardPassSparse", {"in"}, {"hidden1"}),
+                            Op("BackwardPassDirect", {"in"}, {"hidden2"}),
+                            Op("BackwardPassDirect",
+                               {"hidden1", "hidden2"},
+                               {"out"})});
+  EXPECT_THROW(
+      GetBackwardPass(net, {{"out", Dense("out_grad")}}), EnforceNotMet);
+}
+
+TEST(BackwardPassTest, StopGradient) {
+  const auto net = MakeNet({Op("BackwardPassDirect", {"in"}, {"hidden"}),
+                            Op("StopGradient", {"hidden"}, {"hidden2"}),
+                            Op("BackwardPassDirect", {"hidden2"}, {"out"})});
+  const auto backward = GetBackwardPass(net, {{"out", Dense("out_grad")}});
+  ExpectOps(
+      {Op("BackwardPassDirectGradient", {"out_grad"}, {"hidden2_grad"})},
+      backward.gradient_ops);
+  EXPECT_EQ(0, backward.input_to_grad.count("in"));
+
+  const auto orphan =
+      MakeNet({Op("BackwardPassDirect", {"in"}, {"hidden"}),
+               Op("StopGradient", {"hidden"}, {"auto_blobx"}),
+               Op("BackwardPassDirect", {"hidden"}, {"out"})});
+  EXPECT_THROW(
+      GetBackwardPass(orphan, {{"out", Dense("out_grad")}}), EnforceNotMet);
+}
+
+TEST(BackwardPassTest, OverwrittenBlobsFail) {
+  const auto use_input =
+      MakeNet({Op("BackwardPassUseInput", {"in"}, {"out"}),
+               Op("BackwardPassDirect", {"in"}, {"in"})});
+  EXPECT_THROW(
+      GetBackwardPass(use_input, {{"out", Dense("out_grad")}}),
+      EnforceNotMet);
+  const auto use_output =
+      MakeNet({Op("BackwardPassUseOutput", {"in"}, {"hidden"}),
+               Op("BackwardPassDirect", {"hidden"}, {"hidden"}),
+               Op("BackwardPassUseOutput", {"hidden"}, {"out"}),
+               Op("BackwardPassDirect", {"out"}, {"sink"})});
+  EXPECT_THROW(
+      GetBackwardPass(use_output, {{"sink", Dense("sink_grad")}}),
+      EnforceNotMet);
+}
+
+TEST(BackwardPassTest, MissingGradientFails) {
+  const auto net = MakeNet({Op("BackwardPassNoSuchOp", {"in"}, {"out"})});
+  EXPECT_THROW(
+      GetBackwardPass(net, {{"out", Dense("out_grad")}}), EnforceNotMet);
+}
+
+} // namespace caffe2
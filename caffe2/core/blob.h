@@ -18,6 +18,7 @@
 #define CAFFE2_CORE_BLOB_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <sstream>
 #include <typeinfo>
 #include <type_traits>
@@ -53,6 +54,7 @@ class Blob {
     other.meta_ = {};
     other.pointer_ = nullptr;
     other.destroy_ = nullptr;
+    ++other.version_;
   }
 
   Blob& operator=(Blob&& other) noexcept {
@@ -62,6 +64,8 @@ class Blob {
     other.meta_ = {};
     other.pointer_ = nullptr;
     other.destroy_ = nullptr;
+    ++version_;
+    ++other.version_;
     return *this;
   }
 
@@ -76,6 +80,13 @@ class Blob {
    */
   inline const TypeMeta& meta() const { return meta_; }
 
+  /**
+   * Returns a number that changes whenever the stored object is replaced, so
+   * that a pointer to it resolved at some version stays valid, and of the
+   * same type, as long as the version does not change.
+   */
+  inline uint64_t version() const { return version_; }
+
   /**
    * Returns a printable typename of the blob.
    */
@@ -136,6 +147,7 @@ class Blob {
     meta_ = TypeMeta::Make<T>();
     pointer_ = static_cast<void*>(allocated);
     destroy_ = &Destroy<T>;
+    ++version_;
     return allocated;
   }
 
@@ -164,6 +176,7 @@ class Blob {
     meta_ = meta;
     pointer_ = static_cast<void*>(allocated);
     destroy_ = nullptr;
+    ++version_;
     return allocated;
   }
 
@@ -177,6 +190,7 @@ class Blob {
     pointer_ = nullptr;
     meta_ = TypeMeta();
     destroy_ = nullptr;
+    ++version_;
   }
 
   /**
@@ -210,6 +224,8 @@ class Blob {
     swap(meta_, rhs.meta_);
     swap(pointer_, rhs.pointer_);
     swap(destroy_, rhs.destroy_);
+    ++version_;
+    ++rhs.version_;
   }
 
   /**
@@ -232,6 +248,7 @@ class Blob {
   TypeMeta meta_;
   void* pointer_ = nullptr;
   DestroyCall destroy_ = nullptr;
+  uint64_t version_ = 0;
 
   DISABLE_COPY_AND_ASSIGN(Blob);
 };
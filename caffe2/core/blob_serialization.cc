@@ -32,10 +32,22 @@ CAFFE2_DEFINE_int(
     16,
     "Maximal number of threads that can be used for tensor serialization");
 
+CAFFE2_DEFINE_int(
+    caffe2_max_tensor_deserializer_threads,
+    16,
+    "Maximal number of threads that Load uses to deserialize blobs");
+
 CAFFE2_DEFINE_bool(
     caffe2_serialize_fp16_as_bytes,
     false,
-    "Serialize FLOAT16 tensors using byte_data field");
+    "Serialize FLOAT16 and BFLOAT16 tensors using byte_data field");
+
+CAFFE2_DEFINE_int64(
+    caffe2_serialize_as_bytes_min_size,
+    1024,
+    "Tensors with at least this many elements are serialized as raw bytes in "
+    "the byte_data field. Set to a negative value to always use the typed "
+    "fields.");
 
 namespace caffe2 {
 /**
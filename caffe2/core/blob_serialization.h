@@ -17,6 +17,7 @@
 #ifndef CAFFE2_CORE_BLOB_SERIALIZATION_H_
 #define CAFFE2_CORE_BLOB_SERIALIZATION_H_
 
+#include <algorithm>
 #include <limits>
 #include <future>
 
@@ -30,8 +31,10 @@
 #include "caffe2/utils/simple_queue.h"
 
 CAFFE2_DECLARE_int(caffe2_tensor_chunk_size);
-CAFFE2_DECLARE_int(caffe2_max_tensor_serializer_threads);
+CAFFE2_DECLARE_int(caffe2_max_tensor_deserializer_threads);
 CAFFE2_DECLARE_bool(caffe2_serialize_fp16_as_bytes);
+CAFFE2_DECLARE_int64(caffe2_serialize_as_bytes_min_size);
+CAFFE2_DECLARE_int(caffe2_max_tensor_serializer_threads);
 
 namespace caffe2 {
 
@@ -112,12 +115,20 @@ inline unique_ptr<BlobDeserializerBase> CreateDeserializer(const string& type) {
  * device_detail field. If you want to specify the device of the deserialized
  * tensor, change the TensorProto's corresponding fields before calling
  * Deserialize.
+ *
+ * A tensor serialized in chunks can also be filled in two steps:
+ * DeserializeHeader sizes and allocates the tensor from any one of its chunks,
+ * after which DeserializeChunk copies the segments in. DeserializeChunk never
+ * touches the shape or the storage of the tensor, so different chunks of the
+ * same tensor can be copied from several threads at once.
  */
 template <class Context>
 class TensorDeserializer : public BlobDeserializerBase {
  public:
   void Deserialize(const BlobProto& proto, Blob* blob) override;
   void Deserialize(const TensorProto& proto, Tensor<Context>* tensor);
+  void DeserializeHeader(const TensorProto& proto, Tensor<Context>* tensor);
+  void DeserializeChunk(const TensorProto& proto, Tensor<Context>* tensor);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -163,6 +174,29 @@ inline void CopyToProtoWithCast(
   }
 }
 
+inline TensorProto::ByteOrder NativeByteOrder() {
+  const int kValue = 1;
+  return reinterpret_cast<const char*>(&kValue)[0] == 1 ? TensorProto::LITTLE
+                                                        : TensorProto::BIG;
+}
+
+// Whether the tensor data is stored as raw bytes in byte_data instead of in
+// the typed repeated fields.
+inline bool SerializeAsBytes(TensorProto::DataType data_type, TIndex size) {
+  if (data_type == TensorProto_DataType_UNDEFINED ||
+      data_type == TensorProto_DataType_BYTE ||
+      data_type == TensorProto_DataType_STRING) {
+    return false;
+  }
+  if ((data_type == TensorProto_DataType_FLOAT16 ||
+       data_type == TensorProto_DataType_BFLOAT16) &&
+      FLAGS_caffe2_serialize_fp16_as_bytes) {
+    return true;
+  }
+  return FLAGS_caffe2_serialize_as_bytes_min_size >= 0 &&
+      size >= FLAGS_caffe2_serialize_as_bytes_min_size;
+}
+
 template <typename SrcType, typename DstType, class Context>
 inline void CopyFromProtoAsIs(
     const size_t size,
@@ -312,6 +346,22 @@ void TensorSerializer<Context>::Serialize(
   proto.set_data_type(data_type);
   StoreDeviceDetail(input, &proto);
 
+  if (detail::SerializeAsBytes(data_type, input.size())) {
+    // The elements are stored as they are laid out in memory, so both saving
+    // and loading are a single copy.
+    const size_t nbytes = chunkSize * input.itemsize();
+    string* byte_data = proto.mutable_byte_data();
+    byte_data->resize(nbytes);
+    this->context_.template CopyBytes<Context, CPUContext>(
+        nbytes,
+        static_cast<const char*>(input.raw_data()) +
+            chunkBegin * input.itemsize(),
+        &(*byte_data)[0]);
+    this->context_.FinishDeviceComputation();
+    proto.set_byte_order(detail::NativeByteOrder());
+    return;
+  }
+
   // A lot of copypaste is error prone. Should we create a macro for this?
   switch (data_type) {
   case TensorProto_DataType_FLOAT:
@@ -383,31 +433,22 @@ void TensorSerializer<Context>::Serialize(
         proto.mutable_int64_data(),
         &this->context_);
     break;
-  case TensorProto_DataType_FLOAT16: {
-    if (FLAGS_caffe2_serialize_fp16_as_bytes) {
-      const int kValue = 1;
-      CAFFE_ENFORCE_EQ(
-          reinterpret_cast<const char*>(&kValue)[0],
-          1,
-          "Serialization of FLOAT16 on big endian platform "
-          "is not written yet.");
-      unique_ptr<char[]> buffer(new char[2 * chunkSize]);
-      this->context_.template Copy<char, Context, CPUContext>(
-          2 * chunkSize,
-          reinterpret_cast<const char*>(
-              input.template data<float16>() + chunkBegin),
-          buffer.get());
-      this->context_.FinishDeviceComputation();
-      proto.set_byte_data(buffer.release(), 2 * chunkSize);
-    } else {
-      detail::CopyToProtoWithCast(
-          chunkSize,
-          reinterpret_cast<const uint16_t*>(input.template data<float16>()) +
-              chunkBegin,
-          proto.mutable_int32_data(),
-          &this->context_);
-    }
-  } break;
+  case TensorProto_DataType_FLOAT16:
+    detail::CopyToProtoWithCast(
+        chunkSize,
+        reinterpret_cast<const uint16_t*>(input.template data<float16>()) +
+            chunkBegin,
+        proto.mutable_int32_data(),
+        &this->context_);
+    break;
+  case TensorProto_DataType_BFLOAT16:
+    detail::CopyToProtoWithCast(
+        chunkSize,
+        reinterpret_cast<const uint16_t*>(input.template data<bfloat16>()) +
+            chunkBegin,
+        proto.mutable_int32_data(),
+        &this->context_);
+    break;
   case TensorProto_DataType_DOUBLE:
     detail::CopyToProtoAsIs(
         chunkSize,
@@ -435,15 +476,38 @@ template <class Context>
 void TensorDeserializer<Context>::Deserialize(
     const TensorProto& proto,
     Tensor<Context>* tensor) {
-  // We create a local context for deserializing. Since Caffe2 contexts are
-  // usually lightweighted, this should not involve too much overhead.
-  Context context(proto.device_detail());
-  context.SwitchToDevice(0);
+  DeserializeHeader(proto, tensor);
+  DeserializeChunk(proto, tensor);
+}
+
+template <class Context>
+void TensorDeserializer<Context>::DeserializeHeader(
+    const TensorProto& proto,
+    Tensor<Context>* tensor) {
   vector<TIndex> dims;
   for (const TIndex d : proto.dims()) {
     dims.push_back(d);
   }
   tensor->Resize(dims);
+  if (proto.data_type() != TensorProto_DataType_UNDEFINED) {
+    tensor->raw_mutable_data(DataTypeToTypeMeta(proto.data_type()));
+  }
+}
+
+template <class Context>
+void TensorDeserializer<Context>::DeserializeChunk(
+    const TensorProto& proto,
+    Tensor<Context>* tensor) {
+  CAFFE_ENFORCE_EQ(
+      proto.dims_size(), tensor->ndim(), "Tensor chunk has wrong dimensions.");
+  for (int i = 0; i < proto.dims_size(); ++i) {
+    CAFFE_ENFORCE_EQ(
+        proto.dims(i), tensor->dim(i), "Tensor chunk has wrong dimensions.");
+  }
+  // We create a local context for deserializing. Since Caffe2 contexts are
+  // usually lightweighted, this should not involve too much overhead.
+  Context context(proto.device_detail());
+  context.SwitchToDevice(0);
 
   int64_t chunkBegin = 0;
   auto chunkEnd = tensor->size();
@@ -461,6 +525,41 @@ void TensorDeserializer<Context>::Deserialize(
       tensor->size());
   auto chunkSize = chunkEnd - chunkBegin;
 
+  if (proto.has_byte_order() ||
+      ((proto.data_type() == TensorProto_DataType_FLOAT16 ||
+        proto.data_type() == TensorProto_DataType_BFLOAT16) &&
+       proto.has_byte_data())) {
+    CAFFE_ENFORCE(
+        proto.data_type() != TensorProto_DataType_STRING &&
+            proto.data_type() != TensorProto_DataType_UNDEFINED,
+        "Cannot deserialize raw bytes of data type ",
+        proto.data_type());
+    CAFFE_ENFORCE(
+        tensor->meta() == DataTypeToTypeMeta(proto.data_type()),
+        "Tensor chunk has wrong data type.");
+    const size_t itemsize = tensor->itemsize();
+    const size_t nbytes = chunkSize * itemsize;
+    CAFFE_ENFORCE_EQ(
+        nbytes, proto.byte_data().size(), "Incorrect proto field size.");
+    char* dst =
+        static_cast<char*>(tensor->raw_mutable_data()) + chunkBegin * itemsize;
+    const auto byte_order =
+        proto.has_byte_order() ? proto.byte_order() : TensorProto::LITTLE;
+    if (byte_order == detail::NativeByteOrder() || itemsize == 1) {
+      context.template CopyBytes<CPUContext, Context>(
+          nbytes, proto.byte_data().data(), dst);
+    } else {
+      string swapped(proto.byte_data());
+      for (size_t i = 0; i < nbytes; i += itemsize) {
+        std::reverse(&swapped[i], &swapped[i] + itemsize);
+      }
+      context.template CopyBytes<CPUContext, Context>(
+          nbytes, swapped.data(), dst);
+    }
+    context.FinishDeviceComputation();
+    return;
+  }
+
   switch (proto.data_type()) {
     case TensorProto_DataType_FLOAT:
       detail::CopyFromProtoAsIs(
@@ -538,31 +637,22 @@ void TensorDeserializer<Context>::Deserialize(
           &context);
       break;
     case TensorProto_DataType_FLOAT16:
-      if (proto.has_byte_data()) {
-        const int kValue = 1;
-        CAFFE_ENFORCE_EQ(
-            reinterpret_cast<const char*>(&kValue)[0],
-            1,
-            "Serialization of FLOAT16 on big endian platform "
-            "is not written yet.");
-        CAFFE_ENFORCE_EQ(
-            2 * chunkSize,
-            proto.byte_data().size(),
-            "Incorrect proto field size.");
-        context.template Copy<float16, Context, CPUContext>(
-            chunkSize,
-            reinterpret_cast<const float16*>(proto.byte_data().data()),
-            tensor->template mutable_data<float16>() + chunkBegin);
-      } else {
-        // Backward compatibility with models which used int32_data field
-        detail::CopyFromProtoWithCast(
-            chunkSize,
-            proto.int32_data(),
-            reinterpret_cast<uint16_t*>(
-                tensor->template mutable_data<float16>()) +
-                chunkBegin,
-            &context);
-      }
+      detail::CopyFromProtoWithCast(
+          chunkSize,
+          proto.int32_data(),
+          reinterpret_cast<uint16_t*>(
+              tensor->template mutable_data<float16>()) +
+              chunkBegin,
+          &context);
+      break;
+    case TensorProto_DataType_BFLOAT16:
+      detail::CopyFromProtoWithCast(
+          chunkSize,
+          proto.int32_data(),
+          reinterpret_cast<uint16_t*>(
+              tensor->template mutable_data<bfloat16>()) +
+              chunkBegin,
+          &context);
       break;
     case TensorProto_DataType_DOUBLE:
       detail::CopyFromProtoAsIs(
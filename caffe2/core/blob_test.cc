@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -28,6 +29,8 @@
 #include "caffe2/core/qtensor.h"
 #include "caffe2/core/qtensor_serialization.h"
 #include "caffe2/core/registry.h"
+#include "caffe2/core/scope_guard.h"
+#include "caffe2/core/stats.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/core/types.h"
 #include "caffe2/core/workspace.h"
@@ -36,6 +39,7 @@
 
 CAFFE2_DEFINE_int64(caffe2_test_big_tensor_size, 100000000, "");
 CAFFE2_DECLARE_int(caffe2_tensor_chunk_size);
+CAFFE2_DECLARE_int(caffe2_max_tensor_deserializer_threads);
 CAFFE2_DECLARE_bool(caffe2_serialize_fp16_as_bytes);
 
 namespace caffe2 {
@@ -455,6 +459,51 @@ TYPED_TEST(TensorCPUTest, MaxKeepOnShrink) {
   FLAGS_caffe2_max_keep_on_shrink_memory = LLONG_MAX;
 }
 
+TEST(TensorTest, GrowthAndShrinkPolicy) {
+  auto old_growth = FLAGS_caffe2_tensor_growth_pct;
+  auto old_fraction = FLAGS_caffe2_tensor_shrink_fraction;
+  auto g = MakeGuard([&]() {
+    FLAGS_caffe2_tensor_growth_pct = old_growth;
+    FLAGS_caffe2_tensor_shrink_fraction = old_fraction;
+  });
+  FLAGS_caffe2_keep_on_shrink = true;
+  FLAGS_caffe2_tensor_growth_pct = 50;
+  FLAGS_caffe2_tensor_shrink_fraction = 0.5;
+  const auto stats = [](const string& name) {
+    return toMap(StatRegistry::get().publish())["tensor/" + name];
+  };
+  const auto allocations = stats("allocations");
+  const auto growths = stats("growth_reallocations");
+  const auto shrinks = stats("shrinks");
+
+  // Only storage that became too small gets headroom.
+  TensorCPU tensor(vector<TIndex>{100});
+  tensor.mutable_data<float>();
+  EXPECT_EQ(tensor.capacity_nbytes(), 100 * sizeof(float));
+  tensor.Resize(120);
+  tensor.mutable_data<float>();
+  EXPECT_EQ(tensor.capacity_nbytes(), 180 * sizeof(float));
+  // Fluctuating sizes below the high-water mark don't reallocate.
+  for (int size : {150, 110, 180, 130}) {
+    tensor.Resize(size);
+    tensor.mutable_data<float>();
+  }
+  EXPECT_EQ(stats("allocations"), allocations + 2);
+  EXPECT_EQ(stats("growth_reallocations"), growths + 1);
+
+  // The storage is released after enough resizes below half its capacity.
+  for (int i = 0; i < FLAGS_caffe2_tensor_shrink_iters - 1; ++i) {
+    tensor.Resize(i % 2 ? 10 : 20);
+    tensor.mutable_data<float>();
+  }
+  EXPECT_EQ(tensor.capacity_nbytes(), 180 * sizeof(float));
+  tensor.Resize(10);
+  EXPECT_EQ(tensor.capacity_nbytes(), 0);
+  tensor.mutable_data<float>();
+  EXPECT_EQ(tensor.capacity_nbytes(), 10 * sizeof(float));
+  EXPECT_EQ(stats("shrinks"), shrinks + 1);
+}
+
 TYPED_TEST(TensorCPUDeathTest, CannotAccessRawDataWhenEmpty) {
   TensorCPU tensor;
   EXPECT_EQ(tensor.ndim(), 0);
@@ -511,6 +560,68 @@ TEST(TensorTest, Tensor64BitDimension) {
   EXPECT_EQ(tensor.size(), large_number * 100);
 }
 
+TEST(TensorTest, TensorVersion) {
+  TensorCPU tensor(vector<TIndex>{2, 3});
+  tensor.mutable_data<float>();
+  const auto version = tensor.version();
+  tensor.data<float>();
+  tensor.raw_data();
+  EXPECT_EQ(tensor.version(), version);
+  tensor.mutable_data<float>();
+  EXPECT_GT(tensor.version(), version);
+
+  TensorCPU other(vector<TIndex>{2, 3});
+  other.mutable_data<float>();
+  const auto shared_version = tensor.version();
+  tensor.ShareData(other);
+  EXPECT_GT(tensor.version(), shared_version);
+}
+
+// Counts the allocations made through the CPU allocator.
+struct CountingCPUAllocator final : CPUAllocator {
+  std::pair<void*, MemoryDeleter> New(size_t nbytes) override {
+    ++allocations;
+    return allocator_.New(nbytes);
+  }
+  MemoryDeleter GetDeleter() override {
+    return allocator_.GetDeleter();
+  }
+
+  static int allocations;
+
+ private:
+  DefaultCPUAllocator allocator_;
+};
+
+int CountingCPUAllocator::allocations = 0;
+
+TEST(TensorTest, SmallTensorStorage) {
+  SetCPUAllocator(new CountingCPUAllocator());
+  auto g = MakeGuard([]() { SetCPUAllocator(new DefaultCPUAllocator()); });
+  CountingCPUAllocator::allocations = 0;
+
+  std::unique_ptr<TensorCPU> scalar(new TensorCPU(vector<TIndex>{}));
+  EXPECT_EQ(scalar->mutable_data<int64_t>()[0], 0);
+  scalar->mutable_data<int64_t>()[0] = 42;
+  TensorCPU shape(vector<TIndex>{kSmallTensorBytes / sizeof(int)});
+  shape.mutable_data<int>();
+  EXPECT_EQ(CountingCPUAllocator::allocations, 0);
+
+  // The storage is shared and outlives the tensor it was allocated for.
+  TensorCPU shared(vector<TIndex>{});
+  shared.ShareData(*scalar);
+  scalar.reset();
+  EXPECT_EQ(shared.data<int64_t>()[0], 42);
+
+  TensorCPU large(vector<TIndex>{kSmallTensorBytes + 1});
+  large.mutable_data<char>();
+  EXPECT_EQ(CountingCPUAllocator::allocations, 1);
+  // Types with constructors always go through the allocator.
+  TensorCPU strings(vector<TIndex>{1});
+  strings.mutable_data<std::string>();
+  EXPECT_EQ(CountingCPUAllocator::allocations, 2);
+}
+
 TEST(TensorDeathTest, CannotCastDownLargeDims) {
   TIndex large_number =
       static_cast<int64_t>(std::numeric_limits<int>::max()) + 1;
@@ -607,7 +718,7 @@ TEST(TensorTest, float16) {
   const TensorProto& tensor_proto = proto.tensor();
   EXPECT_EQ(
       tensor_proto.data_type(), TypeMetaToDataType(TypeMeta::Make<float16>()));
-  if (FLAGS_caffe2_serialize_fp16_as_bytes) {
+  if (detail::SerializeAsBytes(TensorProto_DataType_FLOAT16, kSize)) {
     EXPECT_EQ(tensor_proto.byte_data().size(), 2 * kSize);
     for (int i = 0; i < kSize; ++i) {
       auto value = tensor->mutable_data<float16>()[i].x;
@@ -630,6 +741,48 @@ TEST(TensorTest, float16) {
   }
 }
 
+TEST(TensorTest, bfloat16) {
+  const TIndex kSize = 30000;
+  Blob blob;
+  TensorCPU* tensor = blob.GetMutable<TensorCPU>();
+  tensor->Resize(kSize);
+  for (int i = 0; i < tensor->size(); ++i) {
+    tensor->mutable_data<bfloat16>()[i].x = i * 7;
+  }
+  string serialized = blob.Serialize("test");
+  BlobProto proto;
+  CHECK(proto.ParseFromString(serialized));
+  EXPECT_EQ(proto.tensor().data_type(), TensorProto_DataType_BFLOAT16);
+  Blob new_blob;
+  EXPECT_NO_THROW(new_blob.Deserialize(serialized));
+  const TensorCPU& new_tensor = new_blob.Get<TensorCPU>();
+  EXPECT_TRUE(new_tensor.IsType<bfloat16>());
+  EXPECT_EQ(new_tensor.size(), kSize);
+  for (int i = 0; i < kSize; ++i) {
+    EXPECT_EQ(new_tensor.data<bfloat16>()[i].x, static_cast<uint16_t>(i * 7));
+  }
+}
+
+TEST(TensorTest, BytesSerializationOtherByteOrder) {
+  const std::vector<int> values{1, -2, 0x01020304};
+  TensorProto proto;
+  proto.add_dims(values.size());
+  proto.set_data_type(TensorProto_DataType_INT32);
+  const bool little = detail::NativeByteOrder() == TensorProto::LITTLE;
+  proto.set_byte_order(little ? TensorProto::BIG : TensorProto::LITTLE);
+  for (const int value : values) {
+    string bytes(reinterpret_cast<const char*>(&value), sizeof(int));
+    std::reverse(bytes.begin(), bytes.end());
+    proto.mutable_byte_data()->append(bytes);
+  }
+  TensorCPU tensor;
+  TensorDeserializer<CPUContext>().Deserialize(proto, &tensor);
+  EXPECT_EQ(tensor.size(), values.size());
+  for (int i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(tensor.data<int>()[i], values[i]);
+  }
+}
+
 TEST(QTensorTest, QTensorSerialization) {
   Blob blob;
   QTensor<CPUContext>* qtensor = blob.GetMutable<QTensor<CPUContext>>();
@@ -811,6 +964,48 @@ TYPED_TEST(TypedTensorTest, BigTensorSerialization) {
     }
   }
 }
+
+template <typename TypeParam>
+class TypedBytesSerializationTest : public ::testing::Test {};
+TYPED_TEST_CASE(TypedBytesSerializationTest, TensorDataTypes);
+
+TYPED_TEST(TypedBytesSerializationTest, RoundTrip) {
+  const TIndex kSize = 3000;
+  const int64_t default_min_size = FLAGS_caffe2_serialize_as_bytes_min_size;
+  FLAGS_caffe2_serialize_as_bytes_min_size = kSize;
+  Blob blob;
+  TensorCPU* tensor = blob.GetMutable<TensorCPU>();
+  tensor->Resize(kSize / 3, 3);
+  for (int i = 0; i < kSize; ++i) {
+    tensor->mutable_data<TypeParam>()[i] = static_cast<TypeParam>(i % 100);
+  }
+  std::vector<string> chunks;
+  blob.Serialize(
+      "test",
+      [&](const string& /*key*/, const string& value) {
+        chunks.push_back(value);
+      },
+      kSize / 2);
+  FLAGS_caffe2_serialize_as_bytes_min_size = default_min_size;
+  EXPECT_EQ(chunks.size(), 2);
+
+  TensorCPU new_tensor;
+  TensorDeserializer<CPUContext> deserializer;
+  for (const auto& chunk : chunks) {
+    BlobProto proto;
+    CHECK(proto.ParseFromString(chunk));
+    const TensorProto& tensor_proto = proto.tensor();
+    EXPECT_TRUE(tensor_proto.has_byte_order());
+    EXPECT_EQ(tensor_proto.byte_data().size(), kSize / 2 * sizeof(TypeParam));
+    EXPECT_EQ(tensor_proto.int32_data_size(), 0);
+    deserializer.Deserialize(tensor_proto, &new_tensor);
+  }
+  EXPECT_EQ(new_tensor.dims(), tensor->dims());
+  for (int i = 0; i < kSize; ++i) {
+    EXPECT_EQ(new_tensor.data<TypeParam>()[i], tensor->data<TypeParam>()[i]);
+  }
+}
+
 struct DummyType {
   /* This struct is used to test serialization and deserialization of huge
    * blobs, that are not tensors.
@@ -948,6 +1143,65 @@ TEST(CustomChunkSize, BigTensorSerialization) {
   EXPECT_EQ(counter, 1);
 }
 
+TEST(ParallelLoad, ShuffledTensorChunks) {
+  const int64_t size = 1000;
+  string db_source = (string)std::tmpnam(nullptr);
+  StringMap data;
+  {
+    Blob floats;
+    TensorCPU* float_tensor = floats.GetMutable<TensorCPU>();
+    float_tensor->Resize(10, size / 10);
+    Blob strings;
+    TensorCPU* string_tensor = strings.GetMutable<TensorCPU>();
+    string_tensor->Resize(size);
+    for (int64_t i = 0; i < size; ++i) {
+      float_tensor->mutable_data<float>()[i] = i;
+      string_tensor->mutable_data<string>()[i] = caffe2::to_string(i);
+    }
+    std::mutex mutex;
+    auto acceptor = [&](const std::string& key, const std::string& value) {
+      std::lock_guard<std::mutex> guard(mutex);
+      data.emplace_back(key, value);
+    };
+    floats.Serialize("floats", acceptor, 37);
+    strings.Serialize("strings", acceptor, 101);
+    // Interleave the chunks of both tensors in a different order than they
+    // were written in.
+    std::reverse(data.begin(), data.end());
+    std::random_shuffle(data.begin(), data.end());
+  }
+
+  const int default_num_threads = FLAGS_caffe2_max_tensor_deserializer_threads;
+  for (const int num_threads : {1, 4}) {
+    FLAGS_caffe2_max_tensor_deserializer_threads = num_threads;
+    // The db drops its data when it is closed.
+    VectorDB::registerData(db_source, StringMap(data));
+    DeviceOption option;
+    option.set_device_type(CPU);
+    auto op_def = CreateOperatorDef(
+        "Load",
+        "",
+        std::vector<string>{},
+        std::vector<string>({"floats", "strings"}),
+        std::vector<Argument>{MakeArgument<string>("db_type", "vector_db"),
+                              MakeArgument<string>("db", db_source),
+                              MakeArgument<bool>("absolute_path", true)},
+        option);
+    Workspace ws;
+    auto load_op = CreateOperator(op_def, &ws);
+    EXPECT_TRUE(load_op->Run());
+    const auto& float_tensor = ws.GetBlob("floats")->Get<TensorCPU>();
+    const auto& string_tensor = ws.GetBlob("strings")->Get<TensorCPU>();
+    EXPECT_EQ(float_tensor.dims(), std::vector<TIndex>({10, size / 10}));
+    EXPECT_EQ(string_tensor.size(), size);
+    for (int64_t i = 0; i < size; ++i) {
+      EXPECT_EQ(float_tensor.data<float>()[i], i);
+      EXPECT_EQ(string_tensor.data<string>()[i], caffe2::to_string(i));
+    }
+  }
+  FLAGS_caffe2_max_tensor_deserializer_threads = default_num_threads;
+}
+
 TEST(QTensor, QTensorSizingTest) {
   vector<int> dims(3);
   dims[0] = 2;
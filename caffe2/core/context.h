@@ -25,9 +25,11 @@
 #include "caffe2/core/allocator.h"
 #include "caffe2/core/event.h"
 #include "caffe2/core/logging.h"
+#include "caffe2/core/memory_profiler.h"
 #include "caffe2/core/typeid.h"
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/philox.h"
 
 CAFFE2_DECLARE_bool(caffe2_report_cpu_memory_usage);
 
@@ -109,12 +111,26 @@ class CPUContext final {
     return *random_generator_.get();
   }
 
+  // Counter-based generator with the same seed, for the bulk generation of
+  // random numbers. See utils/philox.h.
+  inline PhiloxGenerator& PhiloxRandGenerator() {
+    if (!philox_generator_.get()) {
+      philox_generator_.reset(new PhiloxGenerator(random_seed_));
+    }
+    return *philox_generator_.get();
+  }
+
   static std::pair<void*, MemoryDeleter> New(size_t nbytes) {
     auto data_and_deleter = GetCPUAllocator()->New(nbytes);
     if (FLAGS_caffe2_report_cpu_memory_usage) {
-      reporter_.New(data_and_deleter.first, nbytes);
+      reporter_.New(
+          data_and_deleter.first, nbytes, data_and_deleter.second);
       data_and_deleter.second = ReportAndDelete;
     }
+    if (FLAGS_caffe2_profile_memory) {
+      data_and_deleter =
+          MemoryProfiler::Get().Track(CPU, 0, data_and_deleter, nbytes);
+    }
     return data_and_deleter;
   }
 
@@ -149,12 +165,16 @@ class CPUContext final {
   // TODO(jiayq): instead of hard-coding a generator, make it more flexible.
   int random_seed_{1701};
   std::unique_ptr<rand_gen_type> random_generator_;
+  std::unique_ptr<PhiloxGenerator> philox_generator_;
   static MemoryAllocationReporter reporter_;
 
  private:
+  friend MemoryAllocationReporter* GetCPUMemoryAllocationReporter();
+
+  // Frees ptr with the deleter of the allocator that allocated it, which may
+  // not be the current one.
   static void ReportAndDelete(void* ptr) {
-    reporter_.Delete(ptr);
-    GetCPUAllocator()->GetDeleter()(ptr);
+    reporter_.Delete(ptr)(ptr);
   }
 };
 
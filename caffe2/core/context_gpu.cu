@@ -17,22 +17,25 @@
 #include <algorithm>
 #include <atomic>
 #include <cstdlib>
+#include <set>
 #include <string>
 #include <unordered_map>
 
 #include "cub/util_allocator.cuh"
 
 #include "caffe2/core/asan.h"
+#include "caffe2/core/blob_stats.h"
 #include "caffe2/core/common_cudnn.h"
 #include "caffe2/core/context_gpu.h"
 #include "caffe2/core/init.h"
 #include "caffe2/core/logging.h"
+#include "caffe2/core/memory_profiler.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/utils/string_utils.h"
 
 CAFFE2_DEFINE_string(caffe2_cuda_memory_pool, "",
               "Sets the memory pool used by caffe2. Possible values are "
-              "none, cnmen and cub.");
+              "none, cnmen, cub and stream.");
 
 // For description of CUB caching allocator configuration, see
 // https://nvlabs.github.io/cub/structcub_1_1_caching_device_allocator.html
@@ -63,6 +66,19 @@ CAFFE2_DEFINE_int(
     128,
     "The threshold in MB on how frequently to report memory changes");
 
+CAFFE2_DEFINE_bool(
+    caffe2_cuda_pinned_memory_caching,
+    false,
+    "If set, the pinned CPU allocator caches freed blocks instead of "
+    "returning them with cudaFreeHost.");
+CAFFE2_DEFINE_int64(
+    caffe2_cuda_pinned_memory_max_cached_bytes,
+    1LL << 30,
+    "Maximum number of bytes the caching pinned CPU allocator keeps in its "
+    "pool.");
+
+CAFFE2_DECLARE_bool(caffe2_cpu_allocator_do_zero_fill);
+
 namespace caffe2 {
 
 CAFFE_KNOWN_TYPE(Tensor<CUDAContext>);
@@ -78,6 +94,9 @@ CudaMemoryPoolType g_cuda_memory_pool_type;
 
 // For cub allocator
 unique_ptr<cub::CachingDeviceAllocator> g_cub_allocator;
+// For the stream memory pool, see CudaStreamMemoryPool below.
+class CudaStreamMemoryPool;
+unique_ptr<CudaStreamMemoryPool> g_stream_memory_pool;
 // an unordered map that holds the map from the cuda memory pointer to the
 // device id that it is allocated from. This is used in the cuda memory pool
 // cases, where we need the device id to carry out the deletion.
@@ -118,6 +137,17 @@ vector<TIndex> GetCUDATensorInfo(
   return dims;
 }
 
+namespace {
+
+struct TensorCUDAStatGetter : BlobStatGetter {
+  size_t sizeBytes(const Blob& blob) const override {
+    return blob.Get<TensorCUDA>().nbytes();
+  }
+};
+REGISTER_BLOB_STAT_GETTER(TensorCUDA, TensorCUDAStatGetter);
+
+} // namespace
+
 ///////////////////////////////////////////////////////////////////////////////
 // A wrapper to allow us to lazily initialize all cuda environments that Caffe
 // uses. This gets done the first time a caffe2::CUDAContext::New() gets called
@@ -197,6 +227,181 @@ static void SetUpCub() {
   VLOG(1) << "Done setting up cub memory pool.";
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// The stream memory pool caches freed blocks per (device, stream). A block is
+// handed out again on the stream it was last used on without any
+// synchronization, since the stream orders the old and the new work. A block
+// cached for another stream of the same device is only reused after the
+// requesting stream waits on an event recorded when the block was freed.
+// All access is guarded by CUDAContext::mutex.
+///////////////////////////////////////////////////////////////////////////////
+class CudaStreamMemoryPool {
+ public:
+  CudaStreamMemoryPool() : stats_(CAFFE2_COMPILE_TIME_MAX_GPUS) {}
+
+  void* Allocate(int device, cudaStream_t stream, size_t nbytes) {
+    const size_t size = RoundUp(nbytes);
+    auto& stats = stats_[device];
+    ++stats.num_allocs;
+    Block* block = TakeCached(device, stream, size);
+    if (block) {
+      ++stats.num_cache_hits;
+      stats.cached_bytes -= block->size;
+    } else {
+      void* ptr = nullptr;
+      cudaError_t error = cudaMalloc(&ptr, size);
+      if (error == cudaErrorMemoryAllocation) {
+        // Give the cached blocks back and try once more.
+        cudaGetLastError();
+        ReleaseCached(device);
+        error = cudaMalloc(&ptr, size);
+      }
+      CUDA_ENFORCE(error);
+      block = new Block{ptr, size, 0, device, stream, nullptr};
+      stats.reserved_bytes += size;
+      stats.peak_reserved_bytes =
+          std::max(stats.peak_reserved_bytes, stats.reserved_bytes);
+    }
+    block->stream = stream;
+    block->requested = nbytes;
+    stats.allocated_bytes += block->size;
+    stats.requested_bytes += nbytes;
+    stats.peak_allocated_bytes =
+        std::max(stats.peak_allocated_bytes, stats.allocated_bytes);
+    live_blocks_[block->ptr] = block;
+    return block->ptr;
+  }
+
+  void Free(void* ptr) {
+    auto it = live_blocks_.find(ptr);
+    CAFFE_ENFORCE(it != live_blocks_.end(), "Pointer not from the pool.");
+    Block* block = it->second;
+    live_blocks_.erase(it);
+    auto& stats = stats_[block->device];
+    stats.allocated_bytes -= block->size;
+    stats.requested_bytes -= block->requested;
+    stats.cached_bytes += block->size;
+    // Marks the point after which the work queued on the block's stream no
+    // longer touches it, for reuse from other streams.
+    DeviceGuard guard(block->device);
+    if (!block->event) {
+      CUDA_ENFORCE(
+          cudaEventCreateWithFlags(&block->event, cudaEventDisableTiming));
+    }
+    if (cudaEventRecord(block->event, block->stream) != cudaSuccess) {
+      // The stream went away with the thread that owned it, wait for the
+      // device instead.
+      cudaGetLastError();
+      CUDA_ENFORCE(cudaDeviceSynchronize());
+      CUDA_ENFORCE(cudaEventRecord(block->event, 0));
+    }
+    free_blocks_[block->device].insert(block);
+  }
+
+  void ReleaseCached(int device) {
+    auto& free_blocks = free_blocks_[device];
+    if (free_blocks.empty()) {
+      return;
+    }
+    DeviceGuard guard(device);
+    for (Block* block : free_blocks) {
+      CUDA_ENFORCE(cudaEventSynchronize(block->event));
+      CUDA_ENFORCE(cudaEventDestroy(block->event));
+      CUDA_ENFORCE(cudaFree(block->ptr));
+      stats_[device].reserved_bytes -= block->size;
+      stats_[device].cached_bytes -= block->size;
+      ++stats_[device].num_releases;
+      delete block;
+    }
+    free_blocks.clear();
+  }
+
+  void ReleaseCached() {
+    for (int device = 0; device < CAFFE2_COMPILE_TIME_MAX_GPUS; ++device) {
+      ReleaseCached(device);
+    }
+  }
+
+  const std::vector<CudaMemoryPoolStats>& stats() const {
+    return stats_;
+  }
+
+ private:
+  struct Block {
+    void* ptr;
+    size_t size;
+    size_t requested;
+    int device;
+    // The stream the block was last allocated for.
+    cudaStream_t stream;
+    // Recorded on stream when the block was freed.
+    cudaEvent_t event;
+  };
+
+  struct BlockLess {
+    bool operator()(const Block* a, const Block* b) const {
+      if (a->size != b->size) {
+        return a->size < b->size;
+      }
+      return a->ptr < b->ptr;
+    }
+  };
+  using BlockSet = std::set<Block*, BlockLess>;
+
+  static size_t RoundUp(size_t nbytes) {
+    constexpr size_t kRound = 512;
+    return std::max(kRound, (nbytes + kRound - 1) / kRound * kRound);
+  }
+
+  // Best fit among the blocks of at most twice the requested size, which
+  // bounds the memory lost to reusing larger blocks. Blocks of the same
+  // stream are preferred, other streams are waited for.
+  Block* TakeCached(int device, cudaStream_t stream, size_t size) {
+    auto& free_blocks = free_blocks_[device];
+    Block key{nullptr, size, 0, device, nullptr, nullptr};
+    Block* other_stream = nullptr;
+    for (auto it = free_blocks.lower_bound(&key);
+         it != free_blocks.end() && (*it)->size <= 2 * size;
+         ++it) {
+      if ((*it)->stream == stream) {
+        Block* block = *it;
+        free_blocks.erase(it);
+        return block;
+      }
+      if (!other_stream) {
+        other_stream = *it;
+      }
+    }
+    if (other_stream) {
+      free_blocks.erase(other_stream);
+      CUDA_ENFORCE(cudaStreamWaitEvent(stream, other_stream->event, 0));
+      ++stats_[device].num_cross_stream_reuses;
+    }
+    return other_stream;
+  }
+
+  std::unordered_map<void*, Block*> live_blocks_;
+  BlockSet free_blocks_[CAFFE2_COMPILE_TIME_MAX_GPUS];
+  std::vector<CudaMemoryPoolStats> stats_;
+};
+
+std::vector<CudaMemoryPoolStats> GetCudaMemoryPoolStats() {
+  std::lock_guard<std::mutex> lock(CUDAContext::mutex());
+  CAFFE_ENFORCE(
+      g_cuda_memory_pool_type == CudaMemoryPoolType::STREAM,
+      "Pass --caffe2_cuda_memory_pool=stream to enable memory pool stats");
+  auto stats = g_stream_memory_pool->stats();
+  stats.resize(NumCudaDevices());
+  return stats;
+}
+
+void ReleaseCachedCudaMemory() {
+  std::lock_guard<std::mutex> lock(CUDAContext::mutex());
+  if (g_cuda_memory_pool_type == CudaMemoryPoolType::STREAM) {
+    g_stream_memory_pool->ReleaseCached();
+  }
+}
+
 static void Caffe2SetCUDAMemoryPool() {
   if (FLAGS_caffe2_cuda_memory_pool == "" ||
       FLAGS_caffe2_cuda_memory_pool == "none") {
@@ -208,6 +413,9 @@ static void Caffe2SetCUDAMemoryPool() {
     // Sets up cub.
     g_cuda_memory_pool_type = CudaMemoryPoolType::CUB;
     SetUpCub();
+  } else if (FLAGS_caffe2_cuda_memory_pool == "stream") {
+    g_cuda_memory_pool_type = CudaMemoryPoolType::STREAM;
+    g_stream_memory_pool.reset(new CudaStreamMemoryPool());
   } else {
     CAFFE_THROW("Unrecognized cuda memory pool type: ",
                 FLAGS_caffe2_cuda_memory_pool);
@@ -230,6 +438,12 @@ void Caffe2UsePinnedCPUAllocator() {
     VLOG(1) << "No GPU present. I won't use pinned allocator then.";
     return;
   }
+  if (FLAGS_caffe2_cuda_pinned_memory_caching) {
+    VLOG(1) << "Caffe2 gpu: setting CPUAllocator to "
+               "CachingPinnedCPUAllocator.";
+    SetCPUAllocator(new CachingPinnedCPUAllocator());
+    return;
+  }
   VLOG(1) << "Caffe2 gpu: setting CPUAllocator to PinnedCPUAllocator.";
   SetCPUAllocator(new PinnedCPUAllocator());
 #endif
@@ -291,6 +505,12 @@ std::vector<long> CUDAContext::MaxMemoryByGpu() {
   return g_max_by_gpu_map;
 }
 
+static thread_local int64_t g_thread_memory_events = 0;
+
+int64_t CUDAContext::ThreadMemoryEvents() {
+  return g_thread_memory_events;
+}
+
 namespace {
 void TrackMemoryAlloc(size_t nbytes) {
   int this_gpu = CaffeCudaGetDevice();
@@ -324,6 +544,7 @@ std::pair<void*, MemoryDeleter> CUDAContext::New(size_t nbytes) {
   // A one-time caffe2 cuda initializer.
   static Caffe2CudaInitializerHelper g_cuda_initializer_;
   void* ptr = nullptr;
+  ++g_thread_memory_events;
 
   if (FLAGS_caffe2_gpu_memory_tracking) {
     TrackMemoryAlloc(nbytes);
@@ -335,7 +556,7 @@ std::pair<void*, MemoryDeleter> CUDAContext::New(size_t nbytes) {
       g_size_map[ptr] = nbytes;
       g_cuda_device_affiliation[ptr] = CaffeCudaGetDevice();
     }
-    return {ptr, Delete};
+    break;
   case CudaMemoryPoolType::CUB:
     CUDA_ENFORCE(g_cub_allocator->DeviceAllocate(&ptr, nbytes));
     g_cuda_device_affiliation[ptr] = CaffeCudaGetDevice();
@@ -344,14 +565,31 @@ std::pair<void*, MemoryDeleter> CUDAContext::New(size_t nbytes) {
     if (FLAGS_caffe2_gpu_memory_tracking) {
       g_size_map[ptr] = nbytes;
     }
-    return {ptr, Delete};
+    break;
+  case CudaMemoryPoolType::STREAM: {
+    const int gpu = CaffeCudaGetDevice();
+    ptr = g_stream_memory_pool->Allocate(
+        gpu,
+        cuda_objects_.GetStream(gpu, cuda_objects_.current_stream_id_),
+        nbytes);
+    g_cuda_device_affiliation[ptr] = gpu;
+    if (FLAGS_caffe2_gpu_memory_tracking) {
+      g_size_map[ptr] = nbytes;
+    }
+    break;
+  }
   }
-  return {nullptr, Delete};
+  if (FLAGS_caffe2_profile_memory) {
+    return MemoryProfiler::Get().Track(
+        CUDA, CaffeCudaGetDevice(), {ptr, Delete}, nbytes);
+  }
+  return {ptr, Delete};
 }
 
 void CUDAContext::Delete(void* ptr) {
   // lock the mutex
   std::lock_guard<std::mutex> lock(CUDAContext::mutex());
+  ++g_thread_memory_events;
 
   if (FLAGS_caffe2_gpu_memory_tracking) {
     auto sz_it = g_size_map.find(ptr);
@@ -391,7 +629,151 @@ void CUDAContext::Delete(void* ptr) {
     g_cuda_device_affiliation.erase(it);
     break;
   }
+  case CudaMemoryPoolType::STREAM:
+    g_stream_memory_pool->Free(ptr);
+    g_cuda_device_affiliation.erase(ptr);
+    break;
   }
 }
 
+namespace {
+
+// Pinned blocks are cached in power-of-two size classes from
+// 2^kMinPinnedSizeClassLog2 to 2^kMaxPinnedSizeClassLog2 bytes.
+constexpr int kMinPinnedSizeClassLog2 = 6;
+constexpr int kMaxPinnedSizeClassLog2 = 28;
+constexpr int kNumPinnedSizeClasses =
+    kMaxPinnedSizeClassLog2 - kMinPinnedSizeClassLog2 + 1;
+
+int PinnedSizeClass(size_t nbytes) {
+  int log2 = kMinPinnedSizeClassLog2;
+  while ((size_t(1) << log2) < nbytes) {
+    if (++log2 > kMaxPinnedSizeClassLog2) {
+      return -1;
+    }
+  }
+  return log2 - kMinPinnedSizeClassLog2;
+}
+
+size_t PinnedSizeClassBytes(int size_class) {
+  return size_t(1) << (size_class + kMinPinnedSizeClassLog2);
+}
+
+class PinnedBlockPool {
+ public:
+  void* Allocate(size_t nbytes) {
+    const int size_class = PinnedSizeClass(nbytes);
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (size_class >= 0 && !free_blocks_[size_class].empty()) {
+        void* data = free_blocks_[size_class].back();
+        free_blocks_[size_class].pop_back();
+        cached_bytes_ -= PinnedSizeClassBytes(size_class);
+        live_blocks_[data] = size_class;
+        ++hits_;
+        return data;
+      }
+      ++misses_;
+    }
+    void* data = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(CUDAContext::mutex());
+      CUDA_ENFORCE(cudaMallocHost(
+          &data,
+          size_class >= 0 ? PinnedSizeClassBytes(size_class) : nbytes));
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    live_blocks_[data] = size_class;
+    return data;
+  }
+
+  // Returns false if the pointer was not allocated by the pool.
+  bool Free(void* data) {
+    int size_class = -1;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      auto it = live_blocks_.find(data);
+      if (it == live_blocks_.end()) {
+        return false;
+      }
+      size_class = it->second;
+      live_blocks_.erase(it);
+      if (size_class >= 0 &&
+          cached_bytes_ + PinnedSizeClassBytes(size_class) <=
+              FLAGS_caffe2_cuda_pinned_memory_max_cached_bytes) {
+        free_blocks_[size_class].push_back(data);
+        cached_bytes_ += PinnedSizeClassBytes(size_class);
+        return true;
+      }
+    }
+    std::lock_guard<std::mutex> lock(CUDAContext::mutex());
+    CUDA_ENFORCE(cudaFreeHost(data));
+    return true;
+  }
+
+  void FreeAll() {
+    std::vector<void*> blocks;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      for (auto& free_blocks : free_blocks_) {
+        blocks.insert(blocks.end(), free_blocks.begin(), free_blocks.end());
+        free_blocks.clear();
+      }
+      cached_bytes_ = 0;
+    }
+    std::lock_guard<std::mutex> lock(CUDAContext::mutex());
+    for (void* data : blocks) {
+      CUDA_ENFORCE(cudaFreeHost(data));
+    }
+  }
+
+  CachingPinnedCPUAllocator::Stats GetStats() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return CachingPinnedCPUAllocator::Stats{hits_, misses_, cached_bytes_};
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<void*, int> live_blocks_;
+  std::vector<void*> free_blocks_[kNumPinnedSizeClasses];
+  size_t cached_bytes_ = 0;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
+PinnedBlockPool& GetPinnedBlockPool() {
+  // Leaked on purpose: tensors may be freed during static destruction.
+  static auto* pool = new PinnedBlockPool();
+  return *pool;
+}
+
+} // namespace
+
+std::pair<void*, MemoryDeleter> CachingPinnedCPUAllocator::New(size_t nbytes) {
+  void* data = GetPinnedBlockPool().Allocate(nbytes);
+  if (FLAGS_caffe2_cpu_allocator_do_zero_fill) {
+    memset(data, 0, nbytes);
+  }
+  return {data, Delete};
+}
+
+void CachingPinnedCPUAllocator::Delete(void* data) {
+  if (!data) {
+    return;
+  }
+  // Memory allocated before the allocator was switched, by the default or
+  // the uncached pinned allocator.
+  if (!GetPinnedBlockPool().Free(data)) {
+    PinnedCPUAllocator::Delete(data);
+  }
+}
+
+void CachingPinnedCPUAllocator::FreeCached() {
+  GetPinnedBlockPool().FreeAll();
+}
+
+CachingPinnedCPUAllocator::Stats CachingPinnedCPUAllocator::GetStats() {
+  return GetPinnedBlockPool().GetStats();
+}
+
 }  // namespace caffe2
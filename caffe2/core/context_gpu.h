@@ -33,6 +33,7 @@ namespace caffe2 {
 enum class CudaMemoryPoolType {
   NONE = 0,
   CUB = 1,
+  STREAM = 2,
 };
 
 /**
@@ -42,6 +43,39 @@ enum class CudaMemoryPoolType {
  */
 CudaMemoryPoolType GetCudaMemoryPoolType();
 
+/**
+ * Statistics of the "stream" memory pool for one device, in bytes.
+ *
+ * reserved_bytes is everything the pool holds from cudaMalloc, split into
+ * allocated_bytes handed out to callers and cached_bytes kept for reuse.
+ * requested_bytes is what the callers asked for, so the gap to
+ * allocated_bytes is lost to rounding and to reusing larger blocks.
+ */
+struct CudaMemoryPoolStats {
+  size_t reserved_bytes = 0;
+  size_t allocated_bytes = 0;
+  size_t requested_bytes = 0;
+  size_t cached_bytes = 0;
+  size_t peak_reserved_bytes = 0;
+  size_t peak_allocated_bytes = 0;
+  size_t num_allocs = 0;
+  size_t num_cache_hits = 0;
+  size_t num_cross_stream_reuses = 0;
+  size_t num_releases = 0;
+};
+
+/**
+ * Returns the statistics of the "stream" memory pool, one entry per device.
+ * Only available when --caffe2_cuda_memory_pool=stream.
+ */
+std::vector<CudaMemoryPoolStats> GetCudaMemoryPoolStats();
+
+/**
+ * Returns all blocks cached by the "stream" memory pool to cudaFree, after
+ * the work queued on them has finished. Does nothing for other pools.
+ */
+void ReleaseCachedCudaMemory();
+
 /**
  * A struct to host thread-local cuda objects.
  *
@@ -131,6 +165,9 @@ class ThreadLocalCUDAObjects {
   vector<cudaStream_t> cuda_streams_[CAFFE2_COMPILE_TIME_MAX_GPUS];
   vector<cublasHandle_t> cublas_handles_[CAFFE2_COMPILE_TIME_MAX_GPUS];
   vector<cudnnHandle_t> cudnn_handles_[CAFFE2_COMPILE_TIME_MAX_GPUS];
+  // The stream id the thread last switched to, which the "stream" memory
+  // pool allocates for.
+  int current_stream_id_ = 0;
 };
 
 class CUDAContext final {
@@ -148,6 +185,7 @@ class CUDAContext final {
 
   inline void SwitchToDevice(int stream_id) {
     set_stream_id(stream_id);
+    cuda_objects_.current_stream_id_ = stream_id;
     CaffeCudaSetDevice(gpu_id_);
   }
   inline void SwitchToDevice() {
@@ -218,6 +256,11 @@ class CUDAContext final {
   static std::vector<long> TotalMemoryByGpu();
   static std::vector<long> MaxMemoryByGpu();
 
+  // Number of New() and Delete() calls made so far by the calling thread.
+  // Comparing two readings tells whether the code in between allocated or
+  // freed GPU memory.
+  static int64_t ThreadMemoryEvents();
+
   template <class SrcContext, class DstContext>
   inline void CopyBytes(size_t nbytes, const void* src, void* dst) {
     CUDA_ENFORCE(cudaMemcpyAsync(
@@ -297,7 +340,6 @@ struct PinnedCPUAllocator final : CPUAllocator {
     return Delete;
   }
 
- private:
   static void Delete(void* data) {
     // Caffe2 uses a lazy way to figure out if one is actually going to use GPUs
     // or not. If a CUDAContext::New() call is made, inside the CUDAContext
@@ -317,6 +359,40 @@ struct PinnedCPUAllocator final : CPUAllocator {
   }
 };
 
+/**
+ * A pinned CPU allocator that keeps freed blocks in power-of-two size classes
+ * instead of handing them back to cudaFreeHost, since cudaMallocHost and
+ * cudaFreeHost are expensive and serialize on the CUDA mutex. The pool holds
+ * at most caffe2_cuda_pinned_memory_max_cached_bytes. It is used instead of
+ * PinnedCPUAllocator when caffe2_cuda_pinned_memory_caching is set.
+ *
+ * Unlike cudaFreeHost, returning a block to the pool does not wait for the
+ * device, so memory must not be freed while an asynchronous copy still reads
+ * from it. The prefetching input ops and the python feeders finish their
+ * copies before releasing the host buffers.
+ */
+struct CachingPinnedCPUAllocator final : CPUAllocator {
+  struct Stats {
+    size_t hits;
+    size_t misses;
+    size_t cached_bytes;
+  };
+
+  CachingPinnedCPUAllocator() {}
+  ~CachingPinnedCPUAllocator() override {}
+  std::pair<void*, MemoryDeleter> New(size_t nbytes) override;
+  MemoryDeleter GetDeleter() override {
+    return Delete;
+  }
+  // Memory that was not allocated by this allocator is released through
+  // PinnedCPUAllocator::Delete.
+  static void Delete(void* data);
+
+  // Releases all blocks held by the pool with cudaFreeHost.
+  static void FreeCached();
+  static Stats GetStats();
+};
+
 // For simplicity, we will typedef Tensor<CPUContext> to TensorCPU.
 typedef Tensor<CUDAContext> TensorCUDA;
 
@@ -46,6 +46,30 @@ TEST(CUDAContextTest, TestAllocDealloc) {
   EXPECT_NE(data.get(), nullptr);
 }
 
+TEST(CachingPinnedCPUAllocatorTest, TestReuse) {
+  if (!HasCudaGPU()) return;
+  CachingPinnedCPUAllocator allocator;
+  auto first = allocator.New(1000);
+  cudaPointerAttributes attr;
+  EXPECT_EQ(cudaPointerGetAttributes(&attr, first.first), cudaSuccess);
+  first.second(first.first);
+  const auto before = CachingPinnedCPUAllocator::GetStats();
+  // Same size class, so the freed block is handed out again.
+  auto second = allocator.New(900);
+  EXPECT_EQ(second.first, first.first);
+  EXPECT_EQ(CachingPinnedCPUAllocator::GetStats().hits, before.hits + 1);
+  second.second(second.first);
+  CachingPinnedCPUAllocator::FreeCached();
+  EXPECT_EQ(CachingPinnedCPUAllocator::GetStats().cached_bytes, 0);
+}
+
+TEST(CachingPinnedCPUAllocatorTest, TestForeignPointer) {
+  if (!HasCudaGPU()) return;
+  // Memory from the default allocator can still be freed.
+  auto data = DefaultCPUAllocator().New(100);
+  CachingPinnedCPUAllocator::Delete(data.first);
+}
+
 TEST(CUDAContextTest, TestSetGetDeviceWithoutCaffeMode) {
   // For a while, set full device control to be true.
   for (int i = 0; i < NumCudaDevices(); ++i) {
@@ -101,6 +125,37 @@ TEST(CUDAContextTest, MemoryPoolAllocateDealloc) {
   }
 }
 
+TEST(CUDAContextTest, StreamMemoryPoolReuse) {
+  if (!HasCudaGPU())
+    return;
+  if (GetCudaMemoryPoolType() != CudaMemoryPoolType::STREAM) {
+    LOG(ERROR) << "Choose the stream memory pool to test it.";
+    return;
+  }
+  const int nbytes = 1048576;
+  CUDAContext context(0);
+  context.SwitchToDevice(0);
+  auto allocated = shared_from_new(CUDAContext::New(nbytes));
+  void* prev_allocated = allocated.get();
+  allocated.reset();
+  auto before = GetCudaMemoryPoolStats()[0];
+  EXPECT_EQ(before.cached_bytes, nbytes);
+  // Another stream of the same device reuses the block after waiting on it.
+  context.SwitchToDevice(1);
+  allocated = shared_from_new(CUDAContext::New(nbytes));
+  EXPECT_EQ(allocated.get(), prev_allocated);
+  auto after = GetCudaMemoryPoolStats()[0];
+  EXPECT_EQ(after.num_cache_hits, before.num_cache_hits + 1);
+  EXPECT_EQ(after.num_cross_stream_reuses, before.num_cross_stream_reuses + 1);
+  EXPECT_EQ(after.allocated_bytes, before.allocated_bytes + nbytes);
+  allocated.reset();
+  ReleaseCachedCudaMemory();
+  auto released = GetCudaMemoryPoolStats()[0];
+  EXPECT_EQ(released.cached_bytes, 0);
+  EXPECT_EQ(released.reserved_bytes, released.allocated_bytes);
+  EXPECT_GE(released.peak_reserved_bytes, nbytes);
+}
+
 cudaStream_t getStreamForHandle(cublasHandle_t handle) {
   cudaStream_t stream = nullptr;
   CUBLAS_ENFORCE(cublasGetStream(handle, &stream));
@@ -15,6 +15,7 @@
  */
 
 #include <random>
+#include <thread>
 
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/core/context.h"
@@ -50,4 +51,51 @@ TEST(CPUContextTest, TestAllocDealloc) {
   dst_data_and_deleter.second(dst_data);
 }
 
+TEST(CachingCPUAllocatorTest, TestReuse) {
+  CachingCPUAllocator allocator;
+  auto first = allocator.New(1000);
+  EXPECT_EQ((reinterpret_cast<size_t>(first.first) % gCaffe2Alignment), 0);
+  first.second(first.first);
+  const auto before = CachingCPUAllocator::GetStats();
+  // Same size class, so the freed block is handed out again.
+  auto second = allocator.New(900);
+  EXPECT_EQ(second.first, first.first);
+  EXPECT_EQ(CachingCPUAllocator::GetStats().hits, before.hits + 1);
+  second.second(second.first);
+}
+
+TEST(CachingCPUAllocatorTest, TestLargeAllocation) {
+  CachingCPUAllocator allocator;
+  const size_t nbytes = (size_t(1) << 28) + 1;
+  auto data = allocator.New(nbytes);
+  EXPECT_NE(data.first, nullptr);
+  EXPECT_EQ((reinterpret_cast<size_t>(data.first) % gCaffe2Alignment), 0);
+  data.second(data.first);
+  CachingCPUAllocator::FreeCached();
+  EXPECT_EQ(CachingCPUAllocator::GetStats().cached_bytes, 0);
+}
+
+TEST(CachingCPUAllocatorTest, TestAllocatorChange) {
+  // With reporting on, memory allocated before the caching allocator was set
+  // is still freed by the default allocator.
+  FLAGS_caffe2_report_cpu_memory_usage = true;
+  auto data = CPUContext::New(100);
+  SetCPUAllocator(new CachingCPUAllocator());
+  data.second(data.first);
+  SetCPUAllocator(new DefaultCPUAllocator());
+  FLAGS_caffe2_report_cpu_memory_usage = false;
+}
+
+TEST(CachingCPUAllocatorTest, TestThreadExit) {
+  // The blocks cached by a thread go to the global pool when it exits.
+  const auto before = CachingCPUAllocator::GetStats();
+  std::thread thread([] {
+    auto data = CachingCPUAllocator().New(1000);
+    data.second(data.first);
+  });
+  thread.join();
+  EXPECT_GE(CachingCPUAllocator::GetStats().cached_bytes,
+            before.cached_bytes + 1000);
+}
+
 }  // namespace caffe2
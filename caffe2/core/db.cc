@@ -16,6 +16,7 @@
 
 #include "caffe2/core/db.h"
 
+#include <algorithm>
 #include <mutex>
 
 #include "caffe2/core/blob_serialization.h"
@@ -30,6 +31,32 @@ namespace db {
 
 CAFFE_DEFINE_REGISTRY(Caffe2DBRegistry, DB, const string&, Mode);
 
+void DB::MultiGet(
+    const vector<string>& keys,
+    vector<string>* values,
+    vector<bool>* found) {
+  values->assign(keys.size(), string());
+  found->assign(keys.size(), false);
+  auto cursor = NewCursor();
+  CAFFE_ENFORCE(
+      cursor->SupportsSeek(), "MultiGet needs a db whose cursors can seek");
+  // Seeking in key order keeps the cursor moving forward.
+  vector<size_t> order(keys.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) {
+    return keys[a] < keys[b];
+  });
+  for (size_t i : order) {
+    cursor->Seek(keys[i]);
+    if (cursor->Valid() && cursor->key() == keys[i]) {
+      (*values)[i] = cursor->value();
+      (*found)[i] = true;
+    }
+  }
+}
+
 // Below, we provide a bare minimum database "minidb" as a reference
 // implementation as well as a portable choice to store data.
 // Note that the MiniDB classes are not exposed via a header file - they should
@@ -185,6 +212,123 @@ class MiniDB : public DB {
 REGISTER_CAFFE2_DB(MiniDB, MiniDB);
 REGISTER_CAFFE2_DB(minidb, MiniDB);
 
+DBReader::DBReader(const DBReaderProto& proto) {
+  if (proto.cursor_positions_size() == 0) {
+    // Saved by a reader that only recorded the key of its single cursor.
+    Open(proto.db_type(), proto.source());
+    if (proto.has_key()) {
+      CAFFE_ENFORCE(cursors_[0]->cursor->SupportsSeek(),
+          "Encountering a proto that needs seeking but the db type "
+          "does not support it.");
+      cursors_[0]->cursor->Seek(proto.key());
+    }
+    return;
+  }
+  Open(
+      proto.db_type(),
+      proto.source(),
+      proto.num_shards(),
+      proto.shard_id(),
+      proto.cursor_positions_size());
+  for (int i = 0; i < cursors_.size(); ++i) {
+    auto* reader_cursor = cursors_[i].get();
+    const auto position = proto.cursor_positions(i);
+    CAFFE_ENFORCE(
+        position >= reader_cursor->begin &&
+            (reader_cursor->end < 0 || position < reader_cursor->end),
+        "Cursor ",
+        i,
+        " was saved at record ",
+        position,
+        ", outside of its range. Has the db changed?");
+    MoveTo(
+        reader_cursor,
+        position,
+        i < proto.cursor_keys_size() ? proto.cursor_keys(i) : "");
+  }
+}
+
+void DBReader::InitializeCursors(
+    const int32_t num_shards,
+    const int32_t shard_id,
+    const int32_t num_cursors) {
+  CAFFE_ENFORCE(num_shards >= 1);
+  CAFFE_ENFORCE(shard_id >= 0);
+  CAFFE_ENFORCE(shard_id < num_shards);
+  CAFFE_ENFORCE(num_cursors >= 1);
+  num_shards_ = num_shards;
+  shard_id_ = shard_id;
+  cursors_.clear();
+  if (num_cursors == 1) {
+    cursors_.emplace_back(new ReaderCursor());
+    cursors_[0]->cursor = db_->NewCursor();
+    SeekToFirst();
+    return;
+  }
+  CAFFE_ENFORCE(
+      db_->SupportsConcurrentCursors(),
+      "A db of type ",
+      db_type_,
+      " can only be read with a single cursor.");
+
+  // Count the records of the shard to split them into ranges, then find the
+  // keys the ranges start at if the cursors can seek to them.
+  auto scan = db_->NewCursor();
+  int64_t num_rows = 0;
+  for (scan->SeekToFirst(); scan->Valid(); scan->Next()) {
+    ++num_rows;
+  }
+  const int64_t num_records = num_rows > shard_id
+      ? (num_rows - shard_id + num_shards - 1) / num_shards
+      : 0;
+  CAFFE_ENFORCE_GE(
+      num_records,
+      num_cursors,
+      "Db shard has less records than the number of cursors.");
+  for (int i = 0; i < num_cursors; ++i) {
+    cursors_.emplace_back(new ReaderCursor());
+    cursors_[i]->begin = i * num_records / num_cursors;
+    cursors_[i]->end = (i + 1) * num_records / num_cursors;
+  }
+  if (scan->SupportsSeek()) {
+    int i = 0;
+    int64_t row = 0;
+    for (scan->SeekToFirst(); scan->Valid() && i < num_cursors;
+         scan->Next(), ++row) {
+      if (row == shard_id + cursors_[i]->begin * num_shards) {
+        cursors_[i++]->begin_key = scan->key();
+      }
+    }
+  }
+  scan.reset();
+  for (auto& reader_cursor : cursors_) {
+    reader_cursor->cursor = db_->NewCursor();
+    MoveToBeginning(reader_cursor.get());
+  }
+}
+
+void DBReader::MoveToBeginning(ReaderCursor* reader_cursor) const {
+  MoveTo(reader_cursor, reader_cursor->begin, reader_cursor->begin_key);
+}
+
+void DBReader::MoveTo(
+    ReaderCursor* reader_cursor,
+    int64_t position,
+    const string& key) const {
+  auto* cursor = reader_cursor->cursor.get();
+  if (!key.empty() && cursor->SupportsSeek()) {
+    cursor->Seek(key);
+  } else {
+    cursor->SeekToFirst();
+    const int64_t row = shard_id_ + position * num_shards_;
+    for (int64_t s = 0; s < row; s++) {
+      cursor->Next();
+      CAFFE_ENFORCE(cursor->Valid(), "Db has less rows than ", row + 1);
+    }
+  }
+  reader_cursor->position = position;
+}
+
 void DBReaderSerializer::Serialize(
     const Blob& blob,
     const string& name,
@@ -195,8 +339,19 @@ void DBReaderSerializer::Serialize(
   proto.set_name(name);
   proto.set_source(reader.source_);
   proto.set_db_type(reader.db_type_);
-  if (reader.cursor() && reader.cursor()->SupportsSeek()) {
-    proto.set_key(reader.cursor()->key());
+  proto.set_num_shards(reader.num_shards_);
+  proto.set_shard_id(reader.shard_id_);
+  for (auto& reader_cursor : reader.cursors_) {
+    std::unique_lock<std::mutex> mutex_lock(reader_cursor->mutex);
+    auto* cursor = reader_cursor->cursor.get();
+    proto.add_cursor_positions(reader_cursor->position);
+    if (cursor->SupportsSeek()) {
+      proto.add_cursor_keys(cursor->Valid() ? cursor->key() : "");
+    }
+  }
+  if (reader.cursors_.size() == 1 && proto.cursor_keys_size() == 1) {
+    // Readers that only know about a single cursor restore from the key.
+    proto.set_key(proto.cursor_keys(0));
   }
   BlobProto blob_proto;
   blob_proto.set_name(name);
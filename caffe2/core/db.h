@@ -17,6 +17,7 @@
 #ifndef CAFFE2_CORE_DB_H_
 #define CAFFE2_CORE_DB_H_
 
+#include <atomic>
 #include <mutex>
 
 #include "caffe2/core/blob_serialization.h"
@@ -111,6 +112,24 @@ class DB {
    * ownership of the pointer.
    */
   virtual std::unique_ptr<Transaction> NewTransaction() = 0;
+  /**
+   * Whether several cursors of the database can be used at the same time,
+   * each from its own thread. This is false by default.
+   */
+  virtual bool SupportsConcurrentCursors() {
+    return false;
+  }
+  /**
+   * Looks up a batch of keys: values[i] is set to the value of keys[i], and
+   * found[i] to whether keys[i] is in the database. The default
+   * implementation seeks a new cursor to the keys in sorted order, so it
+   * needs a cursor that supports seeking; databases with point lookups
+   * override it.
+   */
+  virtual void MultiGet(
+      const vector<string>& keys,
+      vector<string>* values,
+      vector<bool>* found);
 
  protected:
   Mode mode_;
@@ -156,6 +175,16 @@ inline bool DBExists(const string& db_type, const string& full_db_name) {
 
 /**
  * A reader wrapper for DB that also allows us to serialize it.
+ *
+ * By default all reads go through a single cursor behind a mutex. If the db
+ * supports concurrent cursors, the reader can be opened with num_cursors > 1:
+ * the records of its shard are then split into num_cursors contiguous ranges
+ * of about the same size, each read by its own cursor with its own mutex, and
+ * Read() hands the cursors out in turn so that parallel readers do not wait
+ * on each other. Every cursor wraps around within its own range. Setting up
+ * the ranges scans the db when it is opened, and the start of every range is
+ * found with Seek() if the db supports it, or by skipping records from the
+ * first one otherwise.
  */
 class DBReader {
  public:
@@ -167,55 +196,51 @@ class DBReader {
       const string& db_type,
       const string& source,
       const int32_t num_shards = 1,
-      const int32_t shard_id = 0) {
-    Open(db_type, source, num_shards, shard_id);
+      const int32_t shard_id = 0,
+      const int32_t num_cursors = 1) {
+    Open(db_type, source, num_shards, shard_id, num_cursors);
   }
 
-  explicit DBReader(const DBReaderProto& proto) {
-    Open(proto.db_type(), proto.source());
-    if (proto.has_key()) {
-      CAFFE_ENFORCE(cursor_->SupportsSeek(),
-          "Encountering a proto that needs seeking but the db type "
-          "does not support it.");
-      cursor_->Seek(proto.key());
-    }
-    num_shards_ = 1;
-    shard_id_ = 0;
-  }
+  explicit DBReader(const DBReaderProto& proto);
 
   explicit DBReader(std::unique_ptr<DB> db)
       : db_type_("<memory-type>"),
         source_("<memory-source>"),
         db_(std::move(db)) {
     CAFFE_ENFORCE(db_.get(), "Passed null db");
-    cursor_ = db_->NewCursor();
+    num_shards_ = 1;
+    shard_id_ = 0;
+    cursors_.emplace_back(new ReaderCursor());
+    cursors_[0]->cursor = db_->NewCursor();
   }
 
   void Open(
       const string& db_type,
       const string& source,
       const int32_t num_shards = 1,
-      const int32_t shard_id = 0) {
+      const int32_t shard_id = 0,
+      const int32_t num_cursors = 1) {
     // Note(jiayq): resetting is needed when we re-open e.g. leveldb where no
     // concurrent access is allowed.
-    cursor_.reset();
+    cursors_.clear();
     db_.reset();
     db_type_ = db_type;
     source_ = source;
     db_ = CreateDB(db_type_, source_, READ);
     CAFFE_ENFORCE(db_, "Cannot open db: ", source_, " of type ", db_type_);
-    InitializeCursor(num_shards, shard_id);
+    InitializeCursors(num_shards, shard_id, num_cursors);
   }
 
   void Open(
       unique_ptr<DB>&& db,
       const int32_t num_shards = 1,
-      const int32_t shard_id = 0) {
-    cursor_.reset();
+      const int32_t shard_id = 0,
+      const int32_t num_cursors = 1) {
+    cursors_.clear();
     db_.reset();
     db_ = std::move(db);
     CAFFE_ENFORCE(db_.get(), "Passed null db");
-    InitializeCursor(num_shards, shard_id);
+    InitializeCursors(num_shards, shard_id, num_cursors);
   }
 
  public:
@@ -236,28 +261,38 @@ class DBReader {
    * output blob.
    */
   void Read(string* key, string* value) const {
-    CAFFE_ENFORCE(cursor_ != nullptr, "Reader not initialized.");
-    std::unique_lock<std::mutex> mutex_lock(reader_mutex_);
-    *key = cursor_->key();
-    *value = cursor_->value();
+    CAFFE_ENFORCE(!cursors_.empty(), "Reader not initialized.");
+    auto& reader_cursor = cursors_.size() == 1
+        ? *cursors_[0]
+        : *cursors_[next_cursor_++ % cursors_.size()];
+    std::unique_lock<std::mutex> mutex_lock(reader_cursor.mutex);
+    *key = reader_cursor.cursor->key();
+    *value = reader_cursor.cursor->value();
 
     // In sharded mode, each read skips num_shards_ records
     for (int s = 0; s < num_shards_; s++) {
-      cursor_->Next();
-      if (!cursor_->Valid()) {
-        MoveToBeginning();
-        break;
+      reader_cursor.cursor->Next();
+      if (!reader_cursor.cursor->Valid()) {
+        MoveToBeginning(&reader_cursor);
+        return;
       }
     }
+    if (++reader_cursor.position == reader_cursor.end) {
+      MoveToBeginning(&reader_cursor);
+    }
   }
 
   /**
    * @brief Seeks to the first key. Thread safe.
+   *
+   * With several cursors, every cursor goes back to the start of its range.
    */
   void SeekToFirst() const {
-    CAFFE_ENFORCE(cursor_ != nullptr, "Reader not initialized.");
-    std::unique_lock<std::mutex> mutex_lock(reader_mutex_);
-    MoveToBeginning();
+    CAFFE_ENFORCE(!cursors_.empty(), "Reader not initialized.");
+    for (auto& reader_cursor : cursors_) {
+      std::unique_lock<std::mutex> mutex_lock(reader_cursor->mutex);
+      MoveToBeginning(reader_cursor.get());
+    }
   }
 
   /**
@@ -266,38 +301,52 @@ class DBReader {
    * Note that if you directly use the cursor, the read will not be thread
    * safe, because there is no mechanism to stop multiple threads from
    * accessing the same cursor. You should consider using Read() explicitly.
+   * With several cursors, this is the cursor of the first range.
    */
   inline Cursor* cursor() const {
     LOG(ERROR) << "Usually for a DBReader you should use Read() to be "
                   "thread safe. Consider refactoring your code.";
-    return cursor_.get();
+    return cursors_.empty() ? nullptr : cursors_[0]->cursor.get();
   }
 
- private:
-  void InitializeCursor(const int32_t num_shards, const int32_t shard_id) {
-    CAFFE_ENFORCE(num_shards >= 1);
-    CAFFE_ENFORCE(shard_id >= 0);
-    CAFFE_ENFORCE(shard_id < num_shards);
-    num_shards_ = num_shards;
-    shard_id_ = shard_id;
-    cursor_ = db_->NewCursor();
-    SeekToFirst();
+  inline int num_cursors() const {
+    return cursors_.size();
   }
 
-  void MoveToBeginning() const {
-    cursor_->SeekToFirst();
-    for (auto s = 0; s < shard_id_; s++) {
-      cursor_->Next();
-      CAFFE_ENFORCE(
-          cursor_->Valid(), "Db has less rows than shard id: ", s, shard_id_);
-    }
-  }
+ private:
+  // One cursor of the reader, reading the records of the shard numbered
+  // [begin, end), where end is -1 for a cursor reading up to the end of the
+  // db.
+  struct ReaderCursor {
+    unique_ptr<Cursor> cursor;
+    // The mutex protects the cursor and its position.
+    std::mutex mutex;
+    int64_t begin = 0;
+    int64_t end = -1;
+    // Key of record begin, if the db supports seeking.
+    string begin_key;
+    // Number of the record the cursor is at.
+    int64_t position = 0;
+  };
+
+  void InitializeCursors(
+      const int32_t num_shards,
+      const int32_t shard_id,
+      const int32_t num_cursors);
+
+  // Moves the cursor to the start of its range.
+  void MoveToBeginning(ReaderCursor* reader_cursor) const;
+
+  // Moves the cursor to record position of its range, only skipping records
+  // if key is empty or the db does not support seeking.
+  void MoveTo(ReaderCursor* reader_cursor, int64_t position, const string& key)
+      const;
 
   string db_type_;
   string source_;
   unique_ptr<DB> db_;
-  unique_ptr<Cursor> cursor_;
-  mutable std::mutex reader_mutex_;
+  vector<unique_ptr<ReaderCursor>> cursors_;
+  mutable std::atomic<uint64_t> next_cursor_{0};
   uint32_t num_shards_;
   uint32_t shard_id_;
 
@@ -0,0 +1,352 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/engine_tuner.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator_schema.h"
+#include "caffe2/core/timer.h"
+
+namespace caffe2 {
+
+namespace {
+
+// The engine name that selects the default implementation, even when a
+// per-op or global engine preference is set.
+const char kDefaultEngine[] = "DEFAULT";
+
+string NormalizeEngine(const string& engine) {
+  return engine.empty() ? kDefaultEngine : engine;
+}
+
+void AppendArgument(const Argument& arg, string* key) {
+  *key += arg.name() + "=";
+  if (arg.has_f()) {
+    *key += caffe2::to_string(arg.f());
+  }
+  if (arg.has_i()) {
+    *key += caffe2::to_string(arg.i());
+  }
+  if (arg.has_s()) {
+    *key += arg.s();
+  }
+  for (const auto f : arg.floats()) {
+    *key += caffe2::to_string(f) + ",";
+  }
+  for (const auto i : arg.ints()) {
+    *key += caffe2::to_string(i) + ",";
+  }
+  for (const auto& s : arg.strings()) {
+    *key += s + ",";
+  }
+  *key += ";";
+}
+
+// The engines registered for the type and device of def, the default one
+// included, that options allows.
+vector<string> CandidateEngines(
+    const OperatorDef& def,
+    const EngineTunerOptions& options) {
+  const auto device_type = def.device_option().device_type();
+  if (!gDeviceTypeRegistry()->count(device_type)) {
+    return {};
+  }
+  auto* registry = gDeviceTypeRegistry()->at(device_type);
+  vector<string> registered;
+  if (registry->Has(def.type())) {
+    registered.push_back(kDefaultEngine);
+  }
+  const string prefix = def.type() + "_ENGINE_";
+  for (const auto& key : registry->Keys()) {
+    if (key.compare(0, prefix.size(), prefix) == 0 &&
+        key.size() > prefix.size()) {
+      registered.push_back(key.substr(prefix.size()));
+    }
+  }
+  std::sort(registered.begin(), registered.end());
+  if (options.engines.empty()) {
+    return registered;
+  }
+  vector<string> candidates;
+  for (const auto& engine : options.engines) {
+    const auto normalized = NormalizeEngine(engine);
+    if (std::find(registered.begin(), registered.end(), normalized) !=
+            registered.end() &&
+        std::find(candidates.begin(), candidates.end(), normalized) ==
+            candidates.end()) {
+      candidates.push_back(normalized);
+    }
+  }
+  return candidates;
+}
+
+// The average time of a run of def with the given engine in milliseconds, or
+// infinity if the engine cannot be created or fails to run.
+float TimeEngine(
+    const OperatorDef& def,
+    const string& engine,
+    Workspace* ws,
+    const EngineTunerOptions& options) {
+  OperatorDef engine_def(def);
+  engine_def.set_engine(engine);
+  try {
+    auto op = CreateOperator(engine_def, ws);
+    if (op->engine() != engine) {
+      // CreateOperator fell back to another engine.
+      return std::numeric_limits<float>::infinity();
+    }
+    for (int i = 0; i < options.warmup_runs; ++i) {
+      if (!op->Run()) {
+        return std::numeric_limits<float>::infinity();
+      }
+    }
+    Timer timer;
+    for (int i = 0; i < options.main_runs; ++i) {
+      if (!op->Run()) {
+        return std::numeric_limits<float>::infinity();
+      }
+    }
+    return timer.MilliSeconds() / std::max(options.main_runs, 1);
+  } catch (const std::exception& e) {
+    VLOG(1) << "Engine " << engine << " of " << def.type()
+            << " failed: " << e.what();
+    return std::numeric_limits<float>::infinity();
+  }
+}
+
+vector<TensorShape> InputShapes(const OperatorDef& def, Workspace* ws) {
+  vector<TensorShape> shapes;
+  for (const auto& input : def.input()) {
+    const Blob* blob = ws->GetBlob(input);
+    if (blob) {
+      shapes.push_back(GetTensorShapeOfBlob(blob));
+    } else {
+      TensorShape unknown;
+      unknown.set_unknown_shape(true);
+      shapes.push_back(unknown);
+    }
+  }
+  return shapes;
+}
+
+} // namespace
+
+string EngineChoices::Key(
+    const OperatorDef& def,
+    const vector<TensorShape>& shapes) {
+  string key = def.type() + "|" +
+      caffe2::to_string(def.device_option().device_type()) + "|";
+  vector<const Argument*> args;
+  for (const auto& arg : def.arg()) {
+    args.push_back(&arg);
+  }
+  std::sort(
+      args.begin(), args.end(), [](const Argument* a, const Argument* b) {
+        return a->name() < b->name();
+      });
+  for (const auto* arg : args) {
+    AppendArgument(*arg, &key);
+  }
+  for (const auto& shape : shapes) {
+    if (shape.unknown_shape()) {
+      return "";
+    }
+    key += "|";
+    for (const auto d : shape.dims()) {
+      key += caffe2::to_string(d) + ",";
+    }
+  }
+  // The keys are kept one per line, after which a tab separates the engine.
+  if (key.find_first_of("\t\n") != string::npos) {
+    return "";
+  }
+  return key;
+}
+
+bool EngineChoices::Lookup(const string& key, string* engine) const {
+  const auto it = engines_.find(key);
+  if (it == engines_.end()) {
+    return false;
+  }
+  *engine = it->second;
+  return true;
+}
+
+void EngineChoices::Insert(const string& key, const string& engine) {
+  CAFFE_ENFORCE(!key.empty());
+  CAFFE_ENFORCE(
+      key.find_first_of("\t\n") == string::npos,
+      "Engine choice keys cannot hold tabs or newlines: ",
+      key);
+  engines_[key] = NormalizeEngine(engine);
+}
+
+bool EngineChoices::Save(const string& path) const {
+  const string tmp_path =
+      path + ".tmp." + caffe2::to_string(static_cast<int>(getpid()));
+  {
+    std::ofstream file(tmp_path);
+    if (!file) {
+      LOG(WARNING) << "Cannot write engine choices " << tmp_path;
+      return false;
+    }
+    for (const auto& entry : engines_) {
+      file << entry.first << '\t' << entry.second << '\n';
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Cannot replace engine choices " << path;
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool EngineChoices::Load(const string& path) {
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  string line;
+  while (std::getline(file, line)) {
+    const auto tab = line.rfind('\t');
+    if (tab == string::npos || tab == 0 || tab + 1 == line.size()) {
+      continue;
+    }
+    engines_[line.substr(0, tab)] = line.substr(tab + 1);
+  }
+  return true;
+}
+
+int EngineChoices::Apply(NetDef* net, Workspace* ws) const {
+  // The shapes of the blobs as the operators run, starting from the ones in
+  // ws and propagated through the operator schemas.
+  CaffeMap<string, TensorShape> shapes;
+  for (const auto& name : ws->Blobs()) {
+    shapes[name] = GetTensorShapeOfBlob(ws->GetBlob(name));
+  }
+  int num_applied = 0;
+  for (auto& op : *net->mutable_op()) {
+    vector<TensorShape> input_shapes;
+    for (const auto& input : op.input()) {
+      const auto it = shapes.find(input);
+      if (it == shapes.end()) {
+        TensorShape unknown;
+        unknown.set_unknown_shape(true);
+        input_shapes.push_back(unknown);
+      } else {
+        input_shapes.push_back(it->second);
+      }
+    }
+    string engine;
+    if (op.engine().empty() && Lookup(Key(op, input_shapes), &engine)) {
+      op.set_engine(engine);
+      ++num_applied;
+    }
+
+    vector<TensorShape> output_shapes;
+    const auto* schema = OpSchemaRegistry::Schema(op.type());
+    if (schema) {
+      try {
+        output_shapes = schema->InferTensor(op, input_shapes);
+      } catch (const EnforceNotMet&) {
+        output_shapes.clear();
+      }
+    }
+    for (int i = 0; i < op.output_size(); ++i) {
+      if (i < output_shapes.size()) {
+        shapes[op.output(i)] = output_shapes[i];
+      } else {
+        shapes.erase(op.output(i));
+      }
+    }
+  }
+  return num_applied;
+}
+
+PerOpEnginePrefType EngineChoices::PerOpEnginePref() const {
+  // {device_type -> {operator type -> engine, or "" if they differ}}
+  CaffeMap<int, CaffeMap<string, string>> engines;
+  for (const auto& entry : engines_) {
+    const auto type_end = entry.first.find('|');
+    const auto device_end = entry.first.find('|', type_end + 1);
+    CAFFE_ENFORCE(device_end != string::npos, "Bad key ", entry.first);
+    const int device_type = std::atoi(
+        entry.first.substr(type_end + 1, device_end - type_end - 1).c_str());
+    const string type = entry.first.substr(0, type_end);
+    auto& device_engines = engines[device_type];
+    if (!device_engines.count(type)) {
+      device_engines[type] = entry.second;
+    } else if (device_engines[type] != entry.second) {
+      device_engines[type] = "";
+    }
+  }
+  PerOpEnginePrefType pref;
+  for (const auto& device_engines : engines) {
+    for (const auto& type_engine : device_engines.second) {
+      if (!type_engine.second.empty()) {
+        pref[device_engines.first][type_engine.first] = {type_engine.second};
+      }
+    }
+  }
+  return pref;
+}
+
+EngineChoices TuneEngines(
+    const NetDef& net,
+    Workspace* ws,
+    const EngineTunerOptions& options,
+    EngineChoices choices) {
+  CAFFE_ENFORCE_GE(options.warmup_runs, 0);
+  CAFFE_ENFORCE_GT(options.main_runs, 0);
+  for (const auto& def : net.op()) {
+    OperatorDef run_def(def);
+    if (def.engine().empty()) {
+      const auto key = EngineChoices::Key(def, InputShapes(def, ws));
+      const auto candidates = CandidateEngines(def, options);
+      string best_engine;
+      if (!key.empty() && candidates.size() > 1 &&
+          !choices.Lookup(key, &best_engine)) {
+        float best_time = std::numeric_limits<float>::infinity();
+        for (const auto& engine : candidates) {
+          const float time = TimeEngine(def, engine, ws, options);
+          VLOG(1) << def.type() << " with engine " << engine << ": " << time
+                  << " ms";
+          if (time < best_time) {
+            best_time = time;
+            best_engine = engine;
+          }
+        }
+        if (!best_engine.empty()) {
+          choices.Insert(key, best_engine);
+        }
+      }
+      run_def.set_engine(best_engine);
+    }
+    auto op = CreateOperator(run_def, ws);
+    CAFFE_ENFORCE(op->Run(), "Failed to run ", def.type());
+  }
+  return choices;
+}
+
+} // namespace caffe2
@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_ENGINE_TUNER_H_
+#define CAFFE2_CORE_ENGINE_TUNER_H_
+
+#include <string>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * The fastest engine of operators, by operator type, arguments, device type
+ * and input shapes, as measured by TuneEngines on the device the net runs on.
+ * The best engine (e.g. NNPACK or the default CPU implementation) depends on
+ * the SoC, so the choices are meant to be kept in a file on the device:
+ * measured on the first run, and loaded and applied on the later ones.
+ */
+class EngineChoices {
+ public:
+  // The key of an operator whose inputs have the given shapes, or the empty
+  // string if a shape is unknown or the key cannot be kept in a file.
+  static string Key(const OperatorDef& def, const vector<TensorShape>& shapes);
+
+  bool Lookup(const string& key, string* engine) const;
+  void Insert(const string& key, const string& engine);
+  size_t size() const {
+    return engines_.size();
+  }
+
+  // One choice per line: the key, a tab and the engine. Save writes the file
+  // through a rename, so that it is never seen half written; it returns false
+  // if it cannot be written. Load returns false if the file cannot be read.
+  bool Save(const string& path) const;
+  bool Load(const string& path);
+
+  // Sets the engine of the operators of net that have a choice for the shapes
+  // their inputs get when net runs on the blobs of ws, as given by shape
+  // inference. Operators with an engine set already are left alone. Returns
+  // the number of operators whose engine was set.
+  int Apply(NetDef* net, Workspace* ws) const;
+
+  // For the operator types whose choices all have the same engine, that
+  // engine, to be passed to SetPerOpEnginePref so that it applies to the
+  // operators of every net, including the ones created later.
+  PerOpEnginePrefType PerOpEnginePref() const;
+
+ private:
+  CaffeMap<string, string> engines_;
+};
+
+struct EngineTunerOptions {
+  // The engines to try, "" being the default implementation. If empty, every
+  // engine registered for the type and device of an operator is tried.
+  vector<string> engines;
+  int warmup_runs = 2;
+  int main_runs = 10;
+};
+
+/**
+ * @brief Measures the engines of the operators of a net and returns the
+ * fastest one of every operator.
+ *
+ * The operators run in order on the blobs of ws, which must hold the inputs
+ * of the net, e.g. representative inputs and the parameters of a model. For
+ * every operator with more than one engine registered (and allowed by
+ * options), every engine runs warmup_runs times and is then timed over
+ * main_runs, as in snpe_op_benchmark.cc; engines that fail to create or to run
+ * are skipped. Operators that have an engine set, or whose key is in choices
+ * already, are not measured again. The operator then runs once more with the
+ * fastest engine to produce the inputs of the next ones. Operators run several
+ * times, so the blobs of ws are left in no particular state.
+ *
+ * The choices found are added to choices, which is returned.
+ */
+EngineChoices TuneEngines(
+    const NetDef& net,
+    Workspace* ws,
+    const EngineTunerOptions& options = EngineTunerOptions(),
+    EngineChoices choices = EngineChoices());
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_ENGINE_TUNER_H_
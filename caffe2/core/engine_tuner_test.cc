@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/engine_tuner.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Copies its input, after sleeping for sleep_ms.
+template <int sleep_ms>
+class EngineTunerTestOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+
+  bool RunOnDevice() override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+    Output(0)->CopyFrom(Input(0), &context_);
+    return true;
+  }
+};
+
+class EngineTunerBrokenOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+
+  bool RunOnDevice() override {
+    CAFFE_THROW("Broken engine");
+  }
+};
+
+REGISTER_CPU_OPERATOR(EngineTunerTest, EngineTunerTestOp<2>);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    EngineTunerTest,
+    FAST,
+    EngineTunerTestOp<0>);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    EngineTunerTest,
+    BROKEN,
+    EngineTunerBrokenOp);
+OPERATOR_SCHEMA(EngineTunerTest)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .IdenticalTypeAndShape();
+
+NetDef TwoOpNet() {
+  NetDef net;
+  net.add_op()->CopyFrom(
+      CreateOperatorDef("EngineTunerTest", "", {"X"}, {"Y"}));
+  net.add_op()->CopyFrom(
+      CreateOperatorDef("EngineTunerTest", "", {"Y"}, {"Z"}));
+  return net;
+}
+
+void FillInput(Workspace* ws, const vector<TIndex>& dims) {
+  auto* tensor = ws->CreateBlob("X")->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  tensor->mutable_data<float>();
+}
+
+string KeyOf(const OperatorDef& def, const vector<TIndex>& dims) {
+  TensorShape shape;
+  for (const auto d : dims) {
+    shape.add_dims(d);
+  }
+  return EngineChoices::Key(def, {shape});
+}
+
+EngineTunerOptions FastOptions() {
+  EngineTunerOptions options;
+  options.warmup_runs = 1;
+  options.main_runs = 3;
+  return options;
+}
+
+} // namespace
+
+TEST(EngineTunerTest, PicksFastestEngine) {
+  Workspace ws;
+  FillInput(&ws, {2, 3});
+  const auto net = TwoOpNet();
+  const auto choices = TuneEngines(net, &ws, FastOptions());
+  // Both operators have the same key.
+  EXPECT_EQ(1, choices.size());
+  string engine;
+  ASSERT_TRUE(choices.Lookup(KeyOf(net.op(0), {2, 3}), &engine));
+  EXPECT_EQ("FAST", engine);
+  EXPECT_EQ(
+      vector<TIndex>({2, 3}), ws.GetBlob("Z")->Get<TensorCPU>().dims());
+
+  // Only the allowed engines are measured, "" being the default one.
+  auto options = FastOptions();
+  options.engines = {"", "BROKEN"};
+  Workspace ws2;
+  FillInput(&ws2, {4});
+  const auto restricted = TuneEngines(net, &ws2, options, choices);
+  EXPECT_EQ(2, restricted.size());
+  ASSERT_TRUE(restricted.Lookup(KeyOf(net.op(0), {4}), &engine));
+  EXPECT_EQ("DEFAULT", engine);
+}
+
+TEST(EngineTunerTest, KeysDependOnArgumentsAndShapes) {
+  auto def = CreateOperatorDef("EngineTunerTest", "", {"X"}, {"Y"});
+  const auto key = KeyOf(def, {2, 3});
+  EXPECT_NE(key, KeyOf(def, {3, 2}));
+  def.add_arg()->CopyFrom(MakeArgument<int>("kernel", 3));
+  EXPECT_NE(key, KeyOf(def, {2, 3}));
+  TensorShape unknown;
+  unknown.set_unknown_shape(true);
+  EXPECT_EQ("", EngineChoices::Key(def, {unknown}));
+}
+
+TEST(EngineTunerTest, SaveLoadAndApply) {
+  const auto net = TwoOpNet();
+  EngineChoices choices;
+  choices.Insert(KeyOf(net.op(0), {2, 3}), "FAST");
+  const string path = (string)std::tmpnam(nullptr);
+  ASSERT_TRUE(choices.Save(path));
+  EngineChoices loaded;
+  ASSERT_TRUE(loaded.Load(path));
+  std::remove(path.c_str());
+  EXPECT_EQ(1, loaded.size());
+
+  // The shapes of the inputs of the second operator come from the schema of
+  // the first one.
+  Workspace ws;
+  FillInput(&ws, {2, 3});
+  auto applied = net;
+  applied.mutable_op(1)->set_engine("BROKEN");
+  EXPECT_EQ(1, loaded.Apply(&applied, &ws));
+  EXPECT_EQ("FAST", applied.op(0).engine());
+  EXPECT_EQ("BROKEN", applied.op(1).engine());
+
+  Workspace other_shape;
+  FillInput(&other_shape, {4});
+  applied = net;
+  EXPECT_EQ(0, loaded.Apply(&applied, &other_shape));
+  EXPECT_EQ("", applied.op(0).engine());
+
+  auto pref = loaded.PerOpEnginePref();
+  EXPECT_EQ(
+      vector<string>({"FAST"}), pref[CPU]["EngineTunerTest"]);
+  // No single engine for the operators whose shapes disagree.
+  loaded.Insert(KeyOf(net.op(0), {4}), "");
+  EXPECT_EQ(0, loaded.PerOpEnginePref().count(CPU));
+}
+
+} // namespace caffe2
@@ -15,6 +15,10 @@
  */
 
 #include "caffe2/core/event.h"
+
+#include <condition_variable>
+#include <mutex>
+
 #include "caffe2/core/context.h"
 
 namespace caffe2 {
@@ -24,11 +28,98 @@ EventRecordFunction Event::event_recorder_[MaxDeviceTypes];
 EventWaitFunction Event::event_waiter_[MaxDeviceTypes][MaxDeviceTypes];
 EventFinishFunction Event::event_finisher_[MaxDeviceTypes];
 
-// For CPU devices, Event is essentially a no-op since they are all synchronous.
-void EventCreateCPU(const DeviceOption& /* unused */, Event* /* unused */) {}
+namespace {
+
+// CPU operators are synchronous, so their events are finished from the
+// start and Record is a no-op; only asynchronous CPU operators Reset them.
+struct CPUEventWrapper {
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool finished_ = true;
+  std::string err_msg_;
+  std::vector<std::function<void()>> callbacks_;
+};
+
+CPUEventWrapper* GetCPUEventWrapper(const Event* event) {
+  return static_cast<CPUEventWrapper*>(event->event_.get());
+}
+
+CPUEventWrapper* GetCPUEventWrapper(const Event* event, int type) {
+  CAFFE_ENFORCE_EQ(type, CPU, "Only CPU events can be finished explicitly.");
+  return GetCPUEventWrapper(event);
+}
+
+} // namespace
+
+void EventCreateCPU(const DeviceOption& /* unused */, Event* event) {
+  event->event_.reset(new CPUEventWrapper(), [](void* ptr) {
+    delete static_cast<CPUEventWrapper*>(ptr);
+  });
+}
+
 void EventRecordCPU(const void* /* unused */, Event* /* unused */) {}
-void EventWaitCPUCPU(const Event* /* unused */, void* /* unused */) {}
-void EventFinishCPU(const Event* /* unused */) {}
+
+void EventFinishCPU(const Event* event) {
+  auto* wrapper = GetCPUEventWrapper(event);
+  std::unique_lock<std::mutex> lock(wrapper->mutex_);
+  wrapper->cv_.wait(lock, [wrapper] { return wrapper->finished_; });
+}
+
+void EventWaitCPUCPU(const Event* event, void* /* unused */) {
+  EventFinishCPU(event);
+}
+
+void Event::Reset() {
+  auto* wrapper = GetCPUEventWrapper(this, type_);
+  std::lock_guard<std::mutex> lock(wrapper->mutex_);
+  wrapper->finished_ = false;
+  wrapper->err_msg_.clear();
+  wrapper->callbacks_.clear();
+}
+
+void Event::SetFinished(const std::string& err_msg) {
+  auto* wrapper = GetCPUEventWrapper(this, type_);
+  std::vector<std::function<void()>> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(wrapper->mutex_);
+    if (wrapper->finished_) {
+      return;
+    }
+    wrapper->finished_ = true;
+    wrapper->err_msg_ = err_msg;
+    callbacks.swap(wrapper->callbacks_);
+  }
+  wrapper->cv_.notify_all();
+  // A callback may let the owner of the event reset it, so only the local
+  // copy of the callbacks is used from here on.
+  for (const auto& callback : callbacks) {
+    callback();
+  }
+}
+
+bool Event::Query() const {
+  auto* wrapper = GetCPUEventWrapper(this, type_);
+  std::lock_guard<std::mutex> lock(wrapper->mutex_);
+  return wrapper->finished_;
+}
+
+std::string Event::ErrorMessage() const {
+  auto* wrapper = GetCPUEventWrapper(this, type_);
+  std::lock_guard<std::mutex> lock(wrapper->mutex_);
+  return wrapper->err_msg_;
+}
+
+void Event::SetCallback(std::function<void()> callback) {
+  auto* wrapper = GetCPUEventWrapper(this, type_);
+  {
+    std::lock_guard<std::mutex> lock(wrapper->mutex_);
+    if (!wrapper->finished_) {
+      wrapper->callbacks_.push_back(std::move(callback));
+      return;
+    }
+  }
+  callback();
+}
 
 REGISTER_EVENT_CREATE_FUNCTION(CPU, EventCreateCPU);
 REGISTER_EVENT_RECORD_FUNCTION(CPU, EventRecordCPU);
@@ -17,6 +17,8 @@
 #ifndef CAFFE2_CORE_EVENT_H_
 #define CAFFE2_CORE_EVENT_H_
 
+#include <functional>
+
 #include "caffe2/core/common.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/proto/caffe2.pb.h"
@@ -66,6 +68,25 @@ class Event {
     event_finisher_[type_](this);
   }
 
+  // CPU events are finished by Record, which is immediate, or by
+  // SetFinished, which an asynchronous CPU operator calls from any thread
+  // once its work is done (see AsyncCPUOperator). The functions below only
+  // apply to CPU events.
+
+  // Marks the event as not finished, before the asynchronous work starts.
+  void Reset();
+  // Finishes the event, as failed if err_msg is not empty, and runs the
+  // callbacks. Only the first call after Reset has an effect.
+  void SetFinished(const std::string& err_msg = "");
+  // Whether the event is finished.
+  bool Query() const;
+  // The error the event was finished with, empty if it succeeded. Only
+  // meaningful once the event is finished.
+  std::string ErrorMessage() const;
+  // Runs callback once the event is finished, right away if it already is,
+  // on the thread that finishes it. Reset drops the callbacks not run yet.
+  void SetCallback(std::function<void()> callback);
+
   // event_ is going to be accessed by the EventCreate/Record/Wait/Finish
   // functions, but one should not use it outside the own Event functionalities.
   // In the future we may move it to a private member.
@@ -82,8 +82,11 @@ void EventWaitCPUCUDA(const Event* event, void* context) {
   CUDA_ENFORCE(cudaEventSynchronize(wrapper->cuda_event_));
 }
 
-// Waiter is cuda, event is CPU - in this case do nothing as cpu is always sync.
-void EventWaitCUDACPU(const Event* event, void* context) {}
+// Waiter is cuda, event is CPU - the CPU event is finished unless it belongs
+// to an asynchronous CPU operator, which the host then waits for.
+void EventWaitCUDACPU(const Event* event, void* context) {
+  event->Finish();
+}
 REGISTER_EVENT_CREATE_FUNCTION(CUDA, EventCreateCUDA);
 REGISTER_EVENT_RECORD_FUNCTION(CUDA, EventRecordCUDA);
 REGISTER_EVENT_WAIT_FUNCTION(CUDA, CUDA, EventWaitCUDACUDA);
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <thread>
+
 #include <gtest/gtest.h>
 #include "caffe2/core/context.h"
 #include "caffe2/core/event.h"
@@ -38,4 +40,35 @@ TEST(EventCPUTest, EventBasics) {
   event.Wait(CPU, &context);
 }
 
+TEST(EventCPUTest, SetFinished) {
+  DeviceOption device_option;
+  device_option.set_device_type(CPU);
+  Event event(device_option);
+  EXPECT_TRUE(event.Query());
+
+  event.Reset();
+  EXPECT_FALSE(event.Query());
+  int calls = 0;
+  event.SetCallback([&calls]() { ++calls; });
+  EXPECT_EQ(calls, 0);
+
+  std::thread finisher([&event]() { event.SetFinished("failed"); });
+  event.Finish();
+  finisher.join();
+  EXPECT_TRUE(event.Query());
+  EXPECT_EQ(event.ErrorMessage(), "failed");
+  EXPECT_EQ(calls, 1);
+
+  // Only the first SetFinished counts, and a callback set on a finished
+  // event runs right away.
+  event.SetFinished();
+  EXPECT_EQ(event.ErrorMessage(), "failed");
+  event.SetCallback([&calls]() { ++calls; });
+  EXPECT_EQ(calls, 2);
+
+  event.Reset();
+  event.SetFinished();
+  EXPECT_TRUE(event.ErrorMessage().empty());
+}
+
 } // namespace caffe2
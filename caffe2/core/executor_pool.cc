@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/executor_pool.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "caffe2/core/logging.h"
+
+CAFFE2_DEFINE_int(
+    caffe2_executor_pool_size,
+    0,
+    "Number of threads in each per-NUMA-node executor pool shared by nets. "
+    "0 means the number of hardware threads.");
+CAFFE2_DEFINE_bool(
+    caffe2_net_use_executor_pool,
+    false,
+    "If set, DAG nets submit their operator chains to the shared executor "
+    "pool instead of starting their own worker threads. Can be overridden per "
+    "net with the use_executor_pool argument.");
+
+namespace caffe2 {
+
+int ExecutorPoolSize() {
+  if (FLAGS_caffe2_executor_pool_size > 0) {
+    return FLAGS_caffe2_executor_pool_size;
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+TaskThreadPool* GetExecutorPool(int numa_node_id) {
+  static std::mutex pools_mutex;
+  // Intentionally leaked: nets may still be destroyed during static
+  // destruction and must be able to reach their pool.
+  static auto* pools =
+      new std::unordered_map<int, std::unique_ptr<TaskThreadPool>>();
+  CAFFE_ENFORCE_GE(numa_node_id, -1, "Invalid NUMA node id.");
+  std::lock_guard<std::mutex> lock(pools_mutex);
+  auto& pool = (*pools)[numa_node_id];
+  if (!pool) {
+    const int num_threads = ExecutorPoolSize();
+    VLOG(1) << "Creating executor pool for NUMA node " << numa_node_id
+            << " with " << num_threads << " threads.";
+    pool.reset(new TaskThreadPool(num_threads, numa_node_id));
+  }
+  return pool.get();
+}
+
+} // namespace caffe2
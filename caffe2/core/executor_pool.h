@@ -0,0 +1,43 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_EXECUTOR_POOL_H_
+#define CAFFE2_CORE_EXECUTOR_POOL_H_
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/flags.h"
+#include "caffe2/utils/thread_pool.h"
+
+CAFFE2_DECLARE_int(caffe2_executor_pool_size);
+CAFFE2_DECLARE_bool(caffe2_net_use_executor_pool);
+
+namespace caffe2 {
+
+// Returns the process-wide executor pool serving the given NUMA node. The
+// pools are created lazily on first use with caffe2_executor_pool_size
+// threads each, and are shared by all DAG nets (and the threaded RNN executor)
+// that opt in, so that a process with many nets does not end up with one idle
+// set of worker threads per net. The threads of a pool for a non-negative
+// node id are bound to that node; -1 gives a pool that is not bound. The
+// returned pool lives until process exit.
+TaskThreadPool* GetExecutorPool(int numa_node_id = -1);
+
+// Returns the number of threads a pool created by GetExecutorPool() has.
+int ExecutorPoolSize();
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_EXECUTOR_POOL_H_
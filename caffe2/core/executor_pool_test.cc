@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+
+#include <google/protobuf/text_format.h>
+#include <gtest/gtest.h>
+#include "caffe2/core/executor_pool.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+namespace {
+
+std::atomic<int> counter;
+
+class ExecutorPoolTestCountOp final : public OperatorBase {
+ public:
+  using OperatorBase::OperatorBase;
+
+  bool Run(int /* unused */ /*stream_id*/) override {
+    counter.fetch_add(1);
+    return true;
+  }
+};
+
+// Runs the net of the workspace given by the net argument, as operators with
+// nested nets (e.g. Do or If) do.
+class ExecutorPoolTestRunNetOp final : public OperatorBase {
+ public:
+  ExecutorPoolTestRunNetOp(const OperatorDef& operator_def, Workspace* ws)
+      : OperatorBase(operator_def, ws),
+        ws_(ws),
+        net_(OperatorBase::GetSingleArgument<string>("net", "")) {}
+
+  bool Run(int /* unused */ /*stream_id*/) override {
+    return ws_->RunNet(net_);
+  }
+
+ private:
+  Workspace* ws_;
+  const string net_;
+};
+
+REGISTER_CPU_OPERATOR(ExecutorPoolTestCount, ExecutorPoolTestCountOp);
+REGISTER_CPU_OPERATOR(ExecutorPoolTestRunNet, ExecutorPoolTestRunNetOp);
+
+OPERATOR_SCHEMA(ExecutorPoolTestCount)
+    .NumInputs(0, INT_MAX)
+    .NumOutputs(0, INT_MAX);
+OPERATOR_SCHEMA(ExecutorPoolTestRunNet)
+    .NumInputs(0, INT_MAX)
+    .NumOutputs(0, INT_MAX);
+
+NetDef ParseNet(const string& spec) {
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(spec, &net_def));
+  return net_def;
+}
+
+} // namespace
+
+// The chains of nested DAG nets go to the pool the chain of the outer net
+// runs on. With a single pool thread, the thread that waits for the nested
+// net has to run them itself.
+TEST(ExecutorPoolTest, NestedDAGNetsOnSingleThread) {
+  FLAGS_caffe2_executor_pool_size = 1;
+  ASSERT_EQ(1, ExecutorPoolSize());
+
+  const auto inner_spec = R"DOC(
+        type: "dag"
+        external_input: "in"
+        arg {
+          name: "use_executor_pool"
+          i: 1
+        }
+        op {
+          input: "in"
+          output: "a"
+          type: "ExecutorPoolTestCount"
+        }
+        op {
+          input: "in"
+          output: "b"
+          type: "ExecutorPoolTestCount"
+        }
+        op {
+          input: "a"
+          input: "b"
+          output: "c"
+          type: "ExecutorPoolTestCount"
+        }
+)DOC";
+  const auto outer_spec = R"DOC(
+        name: "outer"
+        type: "dag"
+        external_input: "in"
+        arg {
+          name: "use_executor_pool"
+          i: 1
+        }
+        op {
+          input: "in"
+          output: "x"
+          type: "ExecutorPoolTestRunNet"
+          arg {
+            name: "net"
+            s: "inner1"
+          }
+        }
+        op {
+          input: "in"
+          output: "y"
+          type: "ExecutorPoolTestRunNet"
+          arg {
+            name: "net"
+            s: "inner2"
+          }
+        }
+        op {
+          input: "x"
+          input: "y"
+          output: "z"
+          type: "ExecutorPoolTestCount"
+        }
+)DOC";
+
+  Workspace ws;
+  ws.CreateBlob("in");
+  for (const char* name : {"inner1", "inner2"}) {
+    auto inner = ParseNet(inner_spec);
+    inner.set_name(name);
+    ASSERT_NE(nullptr, ws.CreateNet(inner));
+  }
+  std::unique_ptr<NetBase> outer(CreateNet(ParseNet(outer_spec), &ws));
+  for (int i = 0; i < 10; i++) {
+    counter.exchange(0);
+    ASSERT_TRUE(outer->Run());
+    EXPECT_EQ(7, counter.load());
+  }
+}
+
+} // namespace caffe2
@@ -16,6 +16,8 @@
 
 #include "caffe2/core/graph.h"
 
+#include <queue>
+
 #include "caffe2/core/common.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/net.h"
@@ -16,15 +16,48 @@
 
 #include "caffe2/core/memonger.h"
 
+#include <algorithm>
 #include <set>
 #include <unordered_set>
 
+#include "caffe2/core/operator.h"
 #include "caffe2/utils/proto_utils.h"
 #include "google/protobuf/text_format.h"
 
 namespace caffe2 {
 namespace memonger {
 
+namespace {
+
+// Operators run with the zero_copy argument may make their outputs views of
+// their first input, which then has to stay alive as long as any of them.
+// Outputs without a range live until `end`.
+template <typename Ops>
+void ExtendRangesOfViewedInputs(
+    const Ops& ops,
+    int end,
+    std::unordered_map<string, std::pair<int, int>>* ranges) {
+  for (int i = ops.size() - 1; i >= 0; i--) {
+    const auto& op = ops[i];
+    if (op.input_size() == 0 ||
+        !ArgumentHelper::GetSingleArgument<OperatorDef, bool>(
+            op, "zero_copy", false)) {
+      continue;
+    }
+    auto inp = ranges->find(op.input(0));
+    if (inp == ranges->end()) {
+      continue;
+    }
+    for (const auto& outp : op.output()) {
+      auto it = ranges->find(outp);
+      inp->second.second = std::max(
+          inp->second.second, it == ranges->end() ? end : it->second.second);
+    }
+  }
+}
+
+} // namespace
+
 NetDef optimize_inference_net(
     const NetDef& net,
     const std::set<string>& static_blobs) {
@@ -65,6 +98,8 @@ NetDef optimize_inference_net(
     }
   }
 
+  ExtendRangesOfViewedInputs(ops, ops.size(), &ranges);
+
   // Step 2: pass over ops and recycle
   std::vector<std::string> free_blobs;
   std::unordered_map<std::string, std::string> renaming;
@@ -606,5 +641,149 @@ NetDef compute_blob_recycling_for_dag(
       blob_shapes);
 }
 
+StaticMemoryPlan plan_static_memory(
+    const NetDef& net,
+    const CaffeMap<string, std::vector<TIndex>>& input_shapes,
+    const std::set<string>& static_blobs,
+    NetShapeInference* shape_inference) {
+  CAFFE_ENFORCE(
+      net.type() == "" || net.type() == "simple",
+      "Static memory planning needs sequential execution, got net type: ",
+      net.type());
+
+  // Step 1: shapes of every blob the schemas can infer.
+  std::unique_ptr<NetShapeInference> own_inference;
+  if (!shape_inference) {
+    own_inference = caffe2::make_unique<NetShapeInference>(net, 1);
+    shape_inference = own_inference.get();
+  }
+  const auto shapes = shape_inference->Infer(input_shapes);
+  CaffeMap<string, const TensorShape*> shape_of;
+  for (const auto& shape : *shapes) {
+    shape_of[shape.first] = &shape.second;
+  }
+
+  // Step 2: lifetime [first write, last use] of the blobs the net produces.
+  // External outputs have to survive until the end of the net.
+  std::unordered_map<string, std::pair<int, int>> ranges;
+  for (int i = 0; i < net.op_size(); i++) {
+    const auto& op = net.op(i);
+    for (const auto& inp : op.input()) {
+      auto it = ranges.find(inp);
+      if (it != ranges.end()) {
+        it->second.second = i;
+      }
+    }
+    for (const auto& outp : op.output()) {
+      if (static_blobs.count(outp) || input_shapes.count(outp)) {
+        continue;
+      }
+      auto it = ranges.find(outp);
+      if (it == ranges.end()) {
+        ranges[outp] = std::make_pair(i, i);
+      } else {
+        it->second.second = i;
+      }
+    }
+  }
+  for (const auto& outp : net.external_output()) {
+    auto it = ranges.find(outp);
+    if (it != ranges.end()) {
+      it->second.second = net.op_size();
+    }
+  }
+  ExtendRangesOfViewedInputs(net.op(), net.op_size(), &ranges);
+
+  // Step 3: offset assignment on the interval graph. Placing the largest
+  // blobs first and giving each the lowest offset that does not collide with
+  // a live neighbour keeps the arena close to the peak live size.
+  struct Item {
+    string name;
+    std::pair<int, int> range;
+    size_t nbytes;
+  };
+  std::vector<Item> items;
+  StaticMemoryPlan plan;
+  for (const auto& kv : ranges) {
+    auto sit = shape_of.find(kv.first);
+    if (sit == shape_of.end() || sit->second->unknown_shape() ||
+        sit->second->unknown_dims_size() > 0) {
+      VLOG(1) << "Shape of " << kv.first << " unknown, not planning it.";
+      continue;
+    }
+    const TensorShape& shape = *sit->second;
+    StaticMemoryPlan::Slot slot;
+    size_t numel = 1;
+    for (auto d : shape.dims()) {
+      slot.dims.push_back(d);
+      numel *= d;
+    }
+    slot.data_type = shape.data_type();
+    const size_t itemsize = DataTypeToTypeMeta(slot.data_type).itemsize();
+    if (itemsize == 0 || numel == 0) {
+      continue;
+    }
+    slot.nbytes = numel * itemsize;
+    slot.offset = 0;
+    plan.slots[kv.first] = slot;
+    items.push_back({kv.first, kv.second, slot.nbytes});
+  }
+  std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+    return a.nbytes > b.nbytes || (a.nbytes == b.nbytes && a.name < b.name);
+  });
+
+  auto align = [](size_t n) {
+    return (n + gCaffe2Alignment - 1) / gCaffe2Alignment * gCaffe2Alignment;
+  };
+  std::vector<const Item*> placed;
+  for (const auto& item : items) {
+    // Collect the byte ranges of already placed blobs that are alive at the
+    // same time, sorted by offset.
+    std::vector<std::pair<size_t, size_t>> busy;
+    for (const auto* other : placed) {
+      if (other->range.first <= item.range.second &&
+          item.range.first <= other->range.second) {
+        const auto& slot = plan.slots[other->name];
+        busy.emplace_back(slot.offset, slot.offset + align(slot.nbytes));
+      }
+    }
+    std::sort(busy.begin(), busy.end());
+    size_t offset = 0;
+    for (const auto& b : busy) {
+      if (offset + item.nbytes <= b.first) {
+        break;
+      }
+      offset = std::max(offset, b.second);
+    }
+    auto& slot = plan.slots[item.name];
+    slot.offset = offset;
+    plan.arena_nbytes =
+        std::max(plan.arena_nbytes, offset + align(item.nbytes));
+    placed.push_back(&item);
+  }
+
+  LOG(INFO) << "Static memory plan for " << net.name() << ": "
+            << plan.slots.size() << " blobs in an arena of "
+            << plan.arena_nbytes << " bytes";
+  return plan;
+}
+
+void bind_static_memory(
+    const StaticMemoryPlan& plan,
+    const string& arena_blob,
+    Workspace* ws) {
+  auto* arena = ws->CreateBlob(arena_blob)->GetMutable<TensorCPU>();
+  arena->Resize(plan.arena_nbytes);
+  auto* base = static_cast<char*>(
+      arena->raw_mutable_data(TypeMeta::Make<uint8_t>()));
+  for (const auto& kv : plan.slots) {
+    const auto& slot = kv.second;
+    auto* tensor = ws->CreateBlob(kv.first)->GetMutable<TensorCPU>();
+    tensor->Resize(slot.dims);
+    tensor->ShareExternalPointer(
+        base + slot.offset, DataTypeToTypeMeta(slot.data_type), slot.nbytes);
+  }
+}
+
 } // memonger
 } // caffe2
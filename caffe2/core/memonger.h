@@ -17,9 +17,12 @@
 #ifndef CAFFE2_CORE_MEMONGER_H_
 #define CAFFE2_CORE_MEMONGER_H_
 
+#include <map>
+#include <set>
 #include <unordered_set>
 
 #include "caffe2/core/common.h"
+#include "caffe2/core/net_shape_inference.h"
 #include "caffe2/core/workspace.h"
 #include "caffe2/proto/caffe2.pb.h"
 
@@ -39,6 +42,43 @@ NetDef compute_blob_recycling_for_dag(
     const std::unordered_set<string>& dont_share_blob_names,
     const std::unordered_map<string, vector<int>>& blob_shapes);
 
+// Ahead-of-time layout of the activations of an inference net for one set
+// of input shapes. Every planned blob gets a slice of a single arena; blobs
+// whose lifetimes overlap never share bytes.
+struct StaticMemoryPlan {
+  struct Slot {
+    std::vector<TIndex> dims;
+    TensorProto::DataType data_type;
+    size_t offset;
+    size_t nbytes;
+  };
+  size_t arena_nbytes = 0;
+  std::map<string, Slot> slots;
+};
+
+// Infers the shapes of all intermediate blobs of `net` from `input_shapes`
+// using the operator schemas and assigns arena offsets to every blob that is
+// produced by the net and not in `static_blobs`. Lifetimes are measured in op
+// order, so the plan is only valid for nets that execute sequentially. Blobs
+// whose shape cannot be inferred are left out of the plan. If
+// `shape_inference` is given, it must have been created for `net`, and its
+// cached shapes are used.
+StaticMemoryPlan plan_static_memory(
+    const NetDef& net,
+    const CaffeMap<string, std::vector<TIndex>>& input_shapes,
+    const std::set<string>& static_blobs,
+    NetShapeInference* shape_inference = nullptr);
+
+// Allocates the arena as a byte tensor in blob `arena_blob` of `ws` and binds
+// every planned blob to its slice, so that operators running with the planned
+// shapes write into the arena instead of allocating. If an operator later
+// needs a larger or differently typed output, the tensor falls back to its
+// own allocation.
+void bind_static_memory(
+    const StaticMemoryPlan& plan,
+    const string& arena_blob,
+    Workspace* ws);
+
 } // memonger
 } // caffe2
 
@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <google/protobuf/text_format.h>
+#include <gtest/gtest.h>
+#include "caffe2/core/memonger.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+namespace {
+
+const char* kReluChainSpec = R"DOC(
+  name: "relu_chain"
+  external_input: "data"
+  external_output: "c"
+  op {
+    input: "data"
+    output: "a"
+    type: "Relu"
+  }
+  op {
+    input: "a"
+    output: "b"
+    type: "Relu"
+  }
+  op {
+    input: "b"
+    output: "c"
+    type: "Relu"
+  }
+)DOC";
+
+} // namespace
+
+TEST(MemongerTest, StaticMemoryPlanReusesDeadBlobs) {
+  NetDef net_def;
+  CAFFE_ENFORCE(
+      google::protobuf::TextFormat::ParseFromString(kReluChainSpec, &net_def));
+  auto plan = memonger::plan_static_memory(net_def, {{"data", {2, 16}}}, {});
+  ASSERT_EQ(plan.slots.size(), 3);
+  // "a" is dead once "c" is written, so both can live at the same offset,
+  // while "b" overlaps with both of them.
+  EXPECT_EQ(plan.slots["a"].offset, plan.slots["c"].offset);
+  EXPECT_NE(plan.slots["a"].offset, plan.slots["b"].offset);
+  EXPECT_EQ(plan.slots["b"].nbytes, 2 * 16 * sizeof(float));
+  EXPECT_EQ(plan.arena_nbytes, 2 * 2 * 16 * sizeof(float));
+}
+
+TEST(MemongerTest, StaticMemoryBindAndRun) {
+  NetDef net_def;
+  CAFFE_ENFORCE(
+      google::protobuf::TextFormat::ParseFromString(kReluChainSpec, &net_def));
+  Workspace ws;
+  auto* data = ws.CreateBlob("data")->GetMutable<TensorCPU>();
+  data->Resize(2, 16);
+  for (int i = 0; i < data->size(); ++i) {
+    data->mutable_data<float>()[i] = i % 2 ? i : -i;
+  }
+  auto plan = memonger::plan_static_memory(net_def, {{"data", {2, 16}}}, {});
+  memonger::bind_static_memory(plan, "arena", &ws);
+  const auto& arena = ws.GetBlob("arena")->Get<TensorCPU>();
+  const auto* arena_begin = static_cast<const char*>(arena.raw_data());
+
+  auto net = CreateNet(net_def, &ws);
+  ASSERT_TRUE(net->Run());
+  const auto& c = ws.GetBlob("c")->Get<TensorCPU>();
+  EXPECT_EQ(
+      static_cast<const char*>(c.raw_data()),
+      arena_begin + plan.slots["c"].offset);
+  for (int i = 0; i < c.size(); ++i) {
+    EXPECT_EQ(c.data<float>()[i], i % 2 ? i : 0);
+  }
+}
+
+TEST(MemongerTest, ViewsKeepTheirSourceAlive) {
+  NetDef net_def;
+  CAFFE_ENFORCE(
+      google::protobuf::TextFormat::ParseFromString(kReluChainSpec, &net_def));
+  // "b" becomes a view of "a", so "a" has to outlive the read of "b".
+  auto* op = net_def.mutable_op(1);
+  op->set_type("Reshape");
+  op->add_output("old_shape");
+  AddArgument<vector<int>>("shape", {32}, op);
+  AddArgument<int>("zero_copy", 1, op);
+  auto plan = memonger::plan_static_memory(net_def, {{"data", {2, 16}}}, {});
+  EXPECT_NE(plan.slots["a"].offset, plan.slots["c"].offset);
+
+  NetDef optimized = memonger::optimize_inference_net(net_def, {});
+  EXPECT_NE(optimized.op(0).output(0), optimized.op(2).output(0));
+}
+
+} // namespace caffe2
@@ -0,0 +1,261 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/core/memory_profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+
+CAFFE2_DEFINE_bool(
+    caffe2_profile_memory,
+    false,
+    "If set, CPU and GPU allocations are attributed to the operator that "
+    "made them, see MemoryProfiler.");
+CAFFE2_DEFINE_int64(
+    caffe2_profile_memory_max_events,
+    1 << 20,
+    "Maximum number of allocation and free events the memory profiler keeps "
+    "in its timeline.");
+
+namespace caffe2 {
+
+namespace {
+
+// Older iOS toolchains do not support thread_local, __thread is enough for
+// plain pointers.
+#ifdef __APPLE__
+#define CAFFE2_MEMORY_PROFILER_TLS __thread
+#else
+#define CAFFE2_MEMORY_PROFILER_TLS thread_local
+#endif
+
+CAFFE2_MEMORY_PROFILER_TLS const OperatorBase* gCurrentOperator = nullptr;
+CAFFE2_MEMORY_PROFILER_TLS const std::string* gCurrentNet = nullptr;
+
+int DeviceKey(int device_type, int device_id) {
+  return device_type * 1024 + device_id;
+}
+
+std::string OperatorLabel(const OperatorBase* op) {
+  if (!op || !op->has_debug_def()) {
+    return "";
+  }
+  const auto& def = op->debug_def();
+  return def.type() + "/" +
+      (def.name().empty() ? "op" + caffe2::to_string(op->net_position())
+                          : def.name());
+}
+
+std::string DeviceLabel(int device_type, int device_id) {
+  return (device_type == CPU ? "cpu" : "gpu") + caffe2::to_string(device_id);
+}
+
+} // namespace
+
+MemoryProfiler::MemoryProfiler() : start_(std::chrono::steady_clock::now()) {}
+
+MemoryProfiler& MemoryProfiler::Get() {
+  // Leaked so that blocks freed during static destruction can still be
+  // recorded.
+  static MemoryProfiler* profiler = new MemoryProfiler();
+  return *profiler;
+}
+
+int MemoryProfiler::StatsIndex(int device_type, int device_id) {
+  const std::string net = gCurrentNet ? *gCurrentNet : "";
+  const std::string op = OperatorLabel(gCurrentOperator);
+  const std::string key = net + '\0' + op + '\0' +
+      DeviceLabel(device_type, device_id);
+  auto it = stats_index_.find(key);
+  if (it != stats_index_.end()) {
+    return it->second;
+  }
+  const int idx = stats_.size();
+  stats_.push_back(
+      OperatorMemoryStats{net, op, device_type, device_id, 0, 0, 0, 0, 0});
+  stats_index_[key] = idx;
+  return idx;
+}
+
+void MemoryProfiler::AddEvent(
+    int stats_idx,
+    int64_t nbytes,
+    int64_t total_live_bytes) {
+  if (int64_t(events_.size()) >= FLAGS_caffe2_profile_memory_max_events) {
+    ++dropped_events_;
+    return;
+  }
+  const auto time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start_)
+                           .count();
+  events_.push_back(Event{time_us, stats_idx, nbytes, total_live_bytes});
+}
+
+std::pair<void*, MemoryDeleter> MemoryProfiler::Track(
+    int device_type,
+    int device_id,
+    std::pair<void*, MemoryDeleter> data_and_deleter,
+    size_t nbytes) {
+  if (!data_and_deleter.first) {
+    return data_and_deleter;
+  }
+  std::lock_guard<std::mutex> guard(mutex_);
+  const int stats_idx = StatsIndex(device_type, device_id);
+  const int device_key = DeviceKey(device_type, device_id);
+  blocks_[data_and_deleter.first] = Block{
+      data_and_deleter.second, stats_idx, int64_t(nbytes), device_key};
+
+  auto& total = device_live_bytes_[device_key];
+  total += nbytes;
+  auto& total_peak = device_peak_bytes_[device_key];
+  total_peak = std::max(total_peak, total);
+
+  auto& stats = stats_[stats_idx];
+  ++stats.num_allocations;
+  stats.allocated_bytes += nbytes;
+  stats.live_bytes += nbytes;
+  if (stats.live_bytes > stats.peak_live_bytes) {
+    stats.peak_live_bytes = stats.live_bytes;
+    stats.total_bytes_at_peak = total;
+  }
+  AddEvent(stats_idx, nbytes, total);
+  return {data_and_deleter.first, ProfileAndDelete};
+}
+
+void MemoryProfiler::ProfileAndDelete(void* ptr) {
+  auto& profiler = Get();
+  MemoryDeleter deleter = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(profiler.mutex_);
+    auto it = profiler.blocks_.find(ptr);
+    CAFFE_ENFORCE(
+        it != profiler.blocks_.end(),
+        "Pointer was not tracked by the memory profiler.");
+    const auto& block = it->second;
+    deleter = block.deleter;
+    auto& total = profiler.device_live_bytes_[block.device_key];
+    total -= block.nbytes;
+    if (block.stats_idx >= 0) {
+      profiler.stats_[block.stats_idx].live_bytes -= block.nbytes;
+    }
+    profiler.AddEvent(block.stats_idx, -block.nbytes, total);
+    profiler.blocks_.erase(it);
+  }
+  // The original deleter may take locks of its own, e.g. CUDAContext's.
+  deleter(ptr);
+}
+
+std::vector<MemoryProfiler::OperatorMemoryStats> MemoryProfiler::Report()
+    const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return stats_;
+}
+
+std::vector<MemoryProfiler::Event> MemoryProfiler::Timeline() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return events_;
+}
+
+std::string MemoryProfiler::ReportString(int max_rows) const {
+  auto stats = Report();
+  std::sort(
+      stats.begin(),
+      stats.end(),
+      [](const OperatorMemoryStats& a, const OperatorMemoryStats& b) {
+        return a.peak_live_bytes > b.peak_live_bytes;
+      });
+  std::stringstream ss;
+  ss << std::left << std::setw(8) << "device" << std::setw(40) << "net/op"
+     << std::right << std::setw(10) << "allocs" << std::setw(16) << "allocated"
+     << std::setw(16) << "live" << std::setw(16) << "peak" << std::setw(16)
+     << "total@peak" << "\n";
+  for (int i = 0; i < stats.size() && i < max_rows; ++i) {
+    const auto& s = stats[i];
+    ss << std::left << std::setw(8) << DeviceLabel(s.device_type, s.device_id)
+       << std::setw(40) << (s.net + "/" + (s.op.empty() ? "<none>" : s.op))
+       << std::right << std::setw(10) << s.num_allocations << std::setw(16)
+       << s.allocated_bytes << std::setw(16) << s.live_bytes << std::setw(16)
+       << s.peak_live_bytes << std::setw(16) << s.total_bytes_at_peak << "\n";
+  }
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (dropped_events_) {
+    ss << dropped_events_ << " timeline events were dropped.\n";
+  }
+  return ss.str();
+}
+
+std::string MemoryProfiler::TimelineCSV() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  std::stringstream ss;
+  ss << "time_us,net,op,device,nbytes,total_live_bytes\n";
+  for (const auto& event : events_) {
+    ss << event.time_us << ",";
+    if (event.stats_idx >= 0) {
+      const auto& s = stats_[event.stats_idx];
+      ss << s.net << "," << s.op << ","
+         << DeviceLabel(s.device_type, s.device_id);
+    } else {
+      ss << ",,";
+    }
+    ss << "," << event.nbytes << "," << event.total_live_bytes << "\n";
+  }
+  return ss.str();
+}
+
+int64_t MemoryProfiler::total_live_bytes(int device_type, int device_id)
+    const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = device_live_bytes_.find(DeviceKey(device_type, device_id));
+  return it == device_live_bytes_.end() ? 0 : it->second;
+}
+
+int64_t MemoryProfiler::total_peak_bytes(int device_type, int device_id)
+    const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = device_peak_bytes_.find(DeviceKey(device_type, device_id));
+  return it == device_peak_bytes_.end() ? 0 : it->second;
+}
+
+void MemoryProfiler::Reset() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto& block : blocks_) {
+    block.second.stats_idx = -1;
+  }
+  stats_.clear();
+  stats_index_.clear();
+  events_.clear();
+  dropped_events_ = 0;
+  device_peak_bytes_ = device_live_bytes_;
+  start_ = std::chrono::steady_clock::now();
+}
+
+const OperatorBase* MemoryProfiler::SetCurrentOperator(
+    const OperatorBase* op) {
+  std::swap(op, gCurrentOperator);
+  return op;
+}
+
+const std::string* MemoryProfiler::SetCurrentNet(const std::string* net_name) {
+  std::swap(net_name, gCurrentNet);
+  return net_name;
+}
+
+} // namespace caffe2
@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_CORE_MEMORY_PROFILER_H_
+#define CAFFE2_CORE_MEMORY_PROFILER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "caffe2/core/allocator.h"
+#include "caffe2/core/common.h"
+#include "caffe2/core/flags.h"
+
+CAFFE2_DECLARE_bool(caffe2_profile_memory);
+CAFFE2_DECLARE_int64(caffe2_profile_memory_max_events);
+
+namespace caffe2 {
+
+class OperatorBase;
+
+// Attributes the CPU and GPU allocations of the contexts to the operator and
+// net that made them.
+//
+// While caffe2_profile_memory is set, CPUContext::New and CUDAContext::New
+// hand their allocations to Track(), which tags them with the operator and
+// net currently running on the allocating thread. Operator::Run and the net
+// executors publish those through OperatorScope and NetScope. Allocations
+// made outside of any operator, e.g. when feeding blobs, are attributed to an
+// empty operator name.
+//
+// The profiler keeps, for every (net, operator, device), the bytes allocated,
+// the bytes still alive and the peak of the latter, plus a timeline of at
+// most caffe2_profile_memory_max_events allocation and free events. This is
+// what tells which layers are worth handing to memonger or recomputing.
+//
+// The flag should be set before the memory of interest is allocated: blocks
+// allocated while it was off are not tracked when they are freed.
+class MemoryProfiler {
+ public:
+  struct OperatorMemoryStats {
+    std::string net;
+    // "<type>/<name>", with "op<position>" for unnamed operators.
+    std::string op;
+    int device_type;
+    int device_id;
+    int64_t num_allocations;
+    int64_t allocated_bytes;
+    // Bytes allocated by the operator that have not been freed yet, by
+    // whomever.
+    int64_t live_bytes;
+    int64_t peak_live_bytes;
+    // Total live bytes on the device when the operator reached its peak.
+    int64_t total_bytes_at_peak;
+  };
+
+  struct Event {
+    // Microseconds since the profiler was created or last reset.
+    int64_t time_us;
+    // Index into Report(), or -1 for allocations that were made before the
+    // last reset.
+    int stats_idx;
+    // Positive for allocations, negative for frees.
+    int64_t nbytes;
+    // Total live bytes on the device after the event.
+    int64_t total_live_bytes;
+  };
+
+  static MemoryProfiler& Get();
+
+  // Records an allocation and returns it with a deleter that records the
+  // free before calling the original one.
+  std::pair<void*, MemoryDeleter> Track(
+      int device_type,
+      int device_id,
+      std::pair<void*, MemoryDeleter> data_and_deleter,
+      size_t nbytes);
+
+  // Per operator statistics, in order of first allocation.
+  std::vector<OperatorMemoryStats> Report() const;
+  std::vector<Event> Timeline() const;
+  // Human readable table of the operators sorted by peak live bytes.
+  std::string ReportString(int max_rows = 50) const;
+  // Timeline as CSV: time_us,net,op,device,nbytes,total_live_bytes.
+  std::string TimelineCSV() const;
+  int64_t total_live_bytes(int device_type, int device_id) const;
+  int64_t total_peak_bytes(int device_type, int device_id) const;
+  // Forgets all statistics and events. Blocks that are still alive stay in
+  // the device totals until they are freed.
+  void Reset();
+
+  // Publishes the operator running on this thread for as long as it lives.
+  // Costs a flag check when profiling is off.
+  class OperatorScope {
+   public:
+    explicit OperatorScope(const OperatorBase* op)
+        : active_(FLAGS_caffe2_profile_memory) {
+      if (active_) {
+        prev_ = SetCurrentOperator(op);
+      }
+    }
+    ~OperatorScope() {
+      if (active_) {
+        SetCurrentOperator(prev_);
+      }
+    }
+
+   private:
+    bool active_;
+    const OperatorBase* prev_{nullptr};
+  };
+
+  // Publishes the name of the net running on this thread, which has to
+  // outlive the scope.
+  class NetScope {
+   public:
+    explicit NetScope(const std::string& net_name)
+        : active_(FLAGS_caffe2_profile_memory) {
+      if (active_) {
+        prev_ = SetCurrentNet(&net_name);
+      }
+    }
+    ~NetScope() {
+      if (active_) {
+        SetCurrentNet(prev_);
+      }
+    }
+
+   private:
+    bool active_;
+    const std::string* prev_{nullptr};
+  };
+
+  // Set the operator and net of this thread, and return the previous ones.
+  static const OperatorBase* SetCurrentOperator(const OperatorBase* op);
+  static const std::string* SetCurrentNet(const std::string* net_name);
+
+ private:
+  struct Block {
+    MemoryDeleter deleter;
+    int stats_idx;
+    int64_t nbytes;
+    int device_key;
+  };
+
+  MemoryProfiler();
+  static void ProfileAndDelete(void* ptr);
+  int StatsIndex(int device_type, int device_id);
+  void AddEvent(int stats_idx, int64_t nbytes, int64_t total_live_bytes);
+
+  mutable std::mutex mutex_;
+  std::chrono::steady_clock::time_point start_;
+  std::unordered_map<void*, Block> blocks_;
+  std::vector<OperatorMemoryStats> stats_;
+  std::unordered_map<std::string, int> stats_index_;
+  // Live and peak bytes per device, keyed by device_type * 1024 + device_id.
+  std::unordered_map<int, int64_t> device_live_bytes_;
+  std::unordered_map<int, int64_t> device_peak_bytes_;
+  std::vector<Event> events_;
+  int64_t dropped_events_{0};
+
+  DISABLE_COPY_AND_ASSIGN(MemoryProfiler);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_MEMORY_PROFILER_H_
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <google/protobuf/text_format.h>
+#include <gtest/gtest.h>
+#include "caffe2/core/memory_profiler.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/scope_guard.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Allocates a float output of the size given by its argument.
+class MemoryProfilerTestOp final : public Operator<CPUContext> {
+ public:
+  MemoryProfilerTestOp(const OperatorDef& def, Workspace* ws)
+      : Operator<CPUContext>(def, ws),
+        size_(OperatorBase::GetSingleArgument<int>("size", 1)) {}
+
+  bool RunOnDevice() override {
+    auto* output = Output(0);
+    output->Resize(size_);
+    output->mutable_data<float>();
+    return true;
+  }
+
+ private:
+  int size_;
+};
+
+REGISTER_CPU_OPERATOR(MemoryProfilerTest, MemoryProfilerTestOp);
+OPERATOR_SCHEMA(MemoryProfilerTest).NumInputs(0).NumOutputs(1);
+
+const char kNet[] = R"DOC(
+  name: "profiled"
+  type: "simple"
+  op {
+    output: "a" name: "small" type: "MemoryProfilerTest"
+    arg { name: "size" i: 16 }
+  }
+  op {
+    output: "b" type: "MemoryProfilerTest"
+    arg { name: "size" i: 256 }
+  }
+)DOC";
+
+constexpr int64_t kSmallBytes = 16 * sizeof(float);
+constexpr int64_t kBigBytes = 256 * sizeof(float);
+
+const MemoryProfiler::OperatorMemoryStats* FindStats(
+    const std::vector<MemoryProfiler::OperatorMemoryStats>& report,
+    const std::string& op) {
+  for (const auto& stats : report) {
+    if (stats.net == "profiled" && stats.op == op) {
+      return &stats;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+TEST(MemoryProfilerTest, AttributesAllocationsToOperators) {
+  auto old = FLAGS_caffe2_profile_memory;
+  auto g = MakeGuard([&]() { FLAGS_caffe2_profile_memory = old; });
+  FLAGS_caffe2_profile_memory = true;
+  auto& profiler = MemoryProfiler::Get();
+  profiler.Reset();
+
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(kNet, &net_def));
+  {
+    Workspace ws;
+    auto net = CreateNet(net_def, &ws);
+    EXPECT_TRUE(net->Run());
+    // The outputs are reused by the second run.
+    EXPECT_TRUE(net->Run());
+
+    const auto report = profiler.Report();
+    const auto* small = FindStats(report, "MemoryProfilerTest/small");
+    const auto* unnamed = FindStats(report, "MemoryProfilerTest/op1");
+    ASSERT_TRUE(small != nullptr);
+    ASSERT_TRUE(unnamed != nullptr);
+    EXPECT_EQ(small->device_type, CPU);
+    EXPECT_EQ(small->num_allocations, 1);
+    EXPECT_EQ(small->allocated_bytes, kSmallBytes);
+    EXPECT_EQ(small->live_bytes, kSmallBytes);
+    EXPECT_EQ(unnamed->peak_live_bytes, kBigBytes);
+    EXPECT_GE(unnamed->total_bytes_at_peak, kSmallBytes + kBigBytes);
+    EXPECT_GE(profiler.total_live_bytes(CPU, 0), kSmallBytes + kBigBytes);
+  }
+
+  // Destroying the workspace frees the outputs.
+  const auto report = profiler.Report();
+  EXPECT_EQ(FindStats(report, "MemoryProfilerTest/small")->live_bytes, 0);
+  EXPECT_EQ(FindStats(report, "MemoryProfilerTest/op1")->live_bytes, 0);
+  EXPECT_EQ(
+      FindStats(report, "MemoryProfilerTest/op1")->peak_live_bytes,
+      kBigBytes);
+
+  int64_t net_bytes = 0;
+  for (const auto& event : profiler.Timeline()) {
+    if (event.stats_idx >= 0 && report[event.stats_idx].net == "profiled") {
+      net_bytes += event.nbytes;
+    }
+  }
+  EXPECT_EQ(net_bytes, 0);
+  EXPECT_NE(
+      profiler.ReportString().find("profiled/MemoryProfilerTest/op1"),
+      std::string::npos);
+}
+
+TEST(MemoryProfilerTest, NothingIsTrackedWhenDisabled) {
+  auto old = FLAGS_caffe2_profile_memory;
+  auto g = MakeGuard([&]() { FLAGS_caffe2_profile_memory = old; });
+  FLAGS_caffe2_profile_memory = false;
+  auto& profiler = MemoryProfiler::Get();
+  profiler.Reset();
+
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(kNet, &net_def));
+  Workspace ws;
+  auto net = CreateNet(net_def, &ws);
+  EXPECT_TRUE(net->Run());
+  EXPECT_TRUE(profiler.Report().empty());
+  EXPECT_TRUE(profiler.Timeline().empty());
+}
+
+} // namespace caffe2
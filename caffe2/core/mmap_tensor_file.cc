@@ -0,0 +1,262 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/mmap_tensor_file.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "caffe2/core/logging.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+constexpr char kMagic[8] = {'C', '2', 'M', 'M', 'A', 'P', '0', '1'};
+
+size_t AlignUp(size_t size) {
+  return (size + kMmapTensorAlignment - 1) / kMmapTensorAlignment *
+      kMmapTensorAlignment;
+}
+
+template <typename T>
+void AppendPod(const T& value, string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Reads the index at the start of the mapped file, failing on anything that
+// points past its end.
+class IndexReader {
+ public:
+  IndexReader(const char* data, size_t size, const string& filename)
+      : data_(data), size_(size), filename_(filename) {}
+
+  template <typename T>
+  T Read() {
+    T value;
+    ReadBytes(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+  }
+
+  string ReadString() {
+    const auto size = Read<uint64_t>();
+    CAFFE_ENFORCE_LE(size, size_ - pos_, "Corrupted index in ", filename_);
+    string value(data_ + pos_, size);
+    pos_ += size;
+    return value;
+  }
+
+  void ReadBytes(char* out, size_t size) {
+    CAFFE_ENFORCE_LE(size, size_ - pos_, "Corrupted index in ", filename_);
+    memcpy(out, data_ + pos_, size);
+    pos_ += size;
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t pos_ = 0;
+  const string& filename_;
+};
+
+} // namespace
+
+void WriteMmapTensorFile(
+    const string& filename,
+    const std::vector<std::pair<string, const TensorCPU*>>& tensors) {
+  // The data offsets depend on the size of the index, so the index is laid
+  // out twice: once to get its size and once with the final offsets.
+  auto build_index = [&](size_t data_begin) {
+    string index(kMagic, sizeof(kMagic));
+    AppendPod<uint64_t>(tensors.size(), &index);
+    size_t offset = data_begin;
+    for (const auto& named_tensor : tensors) {
+      const auto& tensor = *named_tensor.second;
+      const auto data_type = TypeMetaToDataType(tensor.meta());
+      CAFFE_ENFORCE(
+          data_type != TensorProto_DataType_UNDEFINED &&
+              data_type != TensorProto_DataType_STRING && !tensor.meta().ctor(),
+          "Tensor ",
+          named_tensor.first,
+          " of type ",
+          tensor.meta().name(),
+          " can't be stored in an mmap tensor file");
+      AppendPod<uint64_t>(named_tensor.first.size(), &index);
+      index.append(named_tensor.first);
+      AppendPod<int32_t>(data_type, &index);
+      AppendPod<uint32_t>(tensor.ndim(), &index);
+      for (const auto dim : tensor.dims()) {
+        AppendPod<int64_t>(dim, &index);
+      }
+      AppendPod<uint64_t>(offset, &index);
+      AppendPod<uint64_t>(tensor.nbytes(), &index);
+      offset = AlignUp(offset + tensor.nbytes());
+    }
+    return index;
+  };
+  const string index = build_index(AlignUp(build_index(0).size()));
+
+  std::FILE* file = std::fopen(filename.c_str(), "wb");
+  CAFFE_ENFORCE(file, "Cannot open ", filename, " for writing");
+  bool ok = std::fwrite(index.data(), 1, index.size(), file) == index.size();
+  const char padding[kMmapTensorAlignment] = {0};
+  size_t written = index.size();
+  for (const auto& named_tensor : tensors) {
+    const auto& tensor = *named_tensor.second;
+    const size_t pad = AlignUp(written) - written;
+    ok = ok && std::fwrite(padding, 1, pad, file) == pad;
+    // Written straight from the tensor memory, without an intermediate
+    // serialized copy.
+    ok = ok &&
+        std::fwrite(tensor.raw_data(), 1, tensor.nbytes(), file) ==
+            tensor.nbytes();
+    written += pad + tensor.nbytes();
+  }
+  ok = (std::fclose(file) == 0) && ok;
+  CAFFE_ENFORCE(ok, "Failed to write ", filename);
+}
+
+bool IsMmapTensorFile(const string& filename) {
+  std::FILE* file = std::fopen(filename.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  char magic[sizeof(kMagic)];
+  const bool ok = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+      memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+  std::fclose(file);
+  return ok;
+}
+
+NetDef MmapTensorFileInitNet(const string& filename) {
+  NetDef net;
+  net.set_name("mmap_init");
+  net.add_op()->CopyFrom(CreateOperatorDef(
+      "Load",
+      "",
+      std::vector<string>{},
+      std::vector<string>{},
+      std::vector<Argument>{MakeArgument<string>("db", filename),
+                            MakeArgument<string>("db_type", kMmapTensorFileType),
+                            MakeArgument<int>("absolute_path", 1),
+                            MakeArgument<int>("load_all", 1)}));
+  return net;
+}
+
+std::shared_ptr<MmapTensorFile> MmapTensorFile::Open(const string& filename) {
+#ifdef _WIN32
+  CAFFE_THROW("mmap tensor files are not supported on Windows");
+#else
+  std::shared_ptr<MmapTensorFile> file(new MmapTensorFile());
+  int fd = open(filename.c_str(), O_RDONLY);
+  CAFFE_ENFORCE_NE(fd, -1, "File not found: ", filename);
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    CAFFE_THROW("Cannot stat ", filename);
+  }
+  file->size_ = st.st_size;
+  void* data = MAP_FAILED;
+  if (file->size_ > 0) {
+    data = mmap(
+        nullptr,
+        file->size_,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE,
+        fd,
+        0);
+  }
+  // The mapping keeps its own reference to the file.
+  close(fd);
+  CAFFE_ENFORCE(data != MAP_FAILED, "Cannot map ", filename);
+  file->data_ = static_cast<char*>(data);
+  file->ParseIndex(filename);
+  return file;
+#endif
+}
+
+MmapTensorFile::~MmapTensorFile() {
+#ifndef _WIN32
+  if (data_) {
+    munmap(data_, size_);
+  }
+#endif
+}
+
+void MmapTensorFile::ParseIndex(const string& filename) {
+  IndexReader reader(data_, size_, filename);
+  char magic[sizeof(kMagic)];
+  reader.ReadBytes(magic, sizeof(magic));
+  CAFFE_ENFORCE(
+      memcmp(magic, kMagic, sizeof(kMagic)) == 0,
+      filename,
+      " is not an mmap tensor file");
+  const auto num_entries = reader.Read<uint64_t>();
+  for (uint64_t i = 0; i < num_entries; ++i) {
+    Entry entry;
+    entry.name = reader.ReadString();
+    entry.data_type =
+        static_cast<TensorProto::DataType>(reader.Read<int32_t>());
+    const auto ndim = reader.Read<uint32_t>();
+    for (uint32_t d = 0; d < ndim; ++d) {
+      entry.dims.push_back(reader.Read<int64_t>());
+    }
+    entry.offset = reader.Read<uint64_t>();
+    entry.nbytes = reader.Read<uint64_t>();
+    CAFFE_ENFORCE(
+        TensorProto::DataType_IsValid(entry.data_type),
+        "Invalid data type for ",
+        entry.name,
+        " in ",
+        filename);
+    CAFFE_ENFORCE(
+        entry.offset <= size_ && entry.nbytes <= size_ - entry.offset,
+        "Data of ",
+        entry.name,
+        " is past the end of ",
+        filename,
+        ", the file is probably truncated");
+    entries_.push_back(std::move(entry));
+  }
+}
+
+void MmapTensorFile::ShareData(const Entry& entry, TensorCPU* tensor) {
+  const auto& meta = DataTypeToTypeMeta(entry.data_type);
+  CAFFE_ENFORCE(
+      meta.id() && !meta.ctor(),
+      "Unsupported data type for ",
+      entry.name);
+  tensor->Resize(entry.dims);
+  CAFFE_ENFORCE_EQ(
+      tensor->size() * meta.itemsize(),
+      entry.nbytes,
+      "Size mismatch for ",
+      entry.name);
+  // The deleter only drops the reference, the last tensor unmaps the file.
+  auto self = shared_from_this();
+  tensor->ShareExternalPointer(
+      data_ + entry.offset, meta, entry.nbytes, [self](void* /* unused */) {});
+}
+
+} // namespace caffe2
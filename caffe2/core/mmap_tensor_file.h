@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_MMAP_TENSOR_FILE_H_
+#define CAFFE2_CORE_MMAP_TENSOR_FILE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/types.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+// A single file holding CPU tensors as raw, aligned byte ranges, meant for
+// large read-only tables such as the embeddings of an inference model. The
+// file starts with an index of (name, data type, dims, offset, size) entries
+// followed by the data of each tensor, aligned to kMmapTensorAlignment bytes
+// and in the native byte order. Loading it maps the whole file into memory
+// and makes the tensors point into the mapping, so nothing is deserialized
+// or copied, pages are only read from disk when they are first touched, and
+// processes serving the same file share the pages of the page cache.
+//
+// Save and Load use this format when given db_type "mmap".
+
+constexpr char kMmapTensorFileType[] = "mmap";
+constexpr size_t kMmapTensorAlignment = 64;
+
+// Writes the given tensors, with the names they should be loaded under, into
+// a new file. Only tensors of fundamental types can be written.
+void WriteMmapTensorFile(
+    const string& filename,
+    const std::vector<std::pair<string, const TensorCPU*>>& tensors);
+
+// Returns true if filename can be opened and starts like a file written by
+// WriteMmapTensorFile.
+bool IsMmapTensorFile(const string& filename);
+
+// Returns a net of a single Load op that maps all the tensors of filename into
+// the workspace it runs in. Used as the init net of a model, e.g. on mobile,
+// its weights are paged in from the file on first use and never copied, and
+// only the small graph definition is left to parse from protobuf.
+NetDef MmapTensorFileInitNet(const string& filename);
+
+// A file written by WriteMmapTensorFile, mapped into memory.
+//
+// The mapping is private and copy-on-write: tensors loaded from it can be
+// read by any number of threads and their pages are shared with every other
+// process mapping the same file, and an op that does write into such a tensor
+// only gets a private copy of the pages it modifies, the file itself is never
+// changed.
+class MmapTensorFile : public std::enable_shared_from_this<MmapTensorFile> {
+ public:
+  struct Entry {
+    string name;
+    TensorProto::DataType data_type;
+    std::vector<TIndex> dims;
+    uint64_t offset;
+    uint64_t nbytes;
+  };
+
+  static std::shared_ptr<MmapTensorFile> Open(const string& filename);
+  ~MmapTensorFile();
+
+  const std::vector<Entry>& entries() const {
+    return entries_;
+  }
+
+  // Makes tensor a view of the data of entry. The mapping stays alive as long
+  // as any tensor sharing it, so the file object itself can go away.
+  void ShareData(const Entry& entry, TensorCPU* tensor);
+
+ private:
+  MmapTensorFile() {}
+
+  void ParseIndex(const string& filename);
+
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  std::vector<Entry> entries_;
+
+  DISABLE_COPY_AND_ASSIGN(MmapTensorFile);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_MMAP_TENSOR_FILE_H_
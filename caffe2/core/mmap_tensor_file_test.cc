@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <fstream>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/mmap_tensor_file.h"
+#include "caffe2/core/workspace.h"
+
+namespace caffe2 {
+
+namespace {
+
+template <typename T>
+void FillTensor(TensorCPU* tensor, const std::vector<TIndex>& dims) {
+  tensor->Resize(dims);
+  auto* data = tensor->mutable_data<T>();
+  for (TIndex i = 0; i < tensor->size(); ++i) {
+    data[i] = static_cast<T>(i % 100);
+  }
+}
+
+} // namespace
+
+TEST(MmapTensorFileTest, RoundTrip) {
+  TensorCPU floats, ints, empty, scalar;
+  FillTensor<float>(&floats, {17, 5});
+  FillTensor<int64_t>(&ints, {3});
+  FillTensor<uint8_t>(&empty, {0, 4});
+  FillTensor<double>(&scalar, {});
+  const string filename = (string)std::tmpnam(nullptr);
+  WriteMmapTensorFile(
+      filename,
+      {{"floats", &floats},
+       {"ints", &ints},
+       {"empty", &empty},
+       {"scalar", &scalar}});
+  EXPECT_TRUE(IsMmapTensorFile(filename));
+
+  TensorCPU loaded_floats, loaded_ints, loaded_empty, loaded_scalar;
+  {
+    auto file = MmapTensorFile::Open(filename);
+    ASSERT_EQ(file->entries().size(), 4);
+    EXPECT_EQ(file->entries()[0].name, "floats");
+    for (const auto& entry : file->entries()) {
+      EXPECT_EQ(entry.offset % kMmapTensorAlignment, 0);
+    }
+    file->ShareData(file->entries()[0], &loaded_floats);
+    file->ShareData(file->entries()[1], &loaded_ints);
+    file->ShareData(file->entries()[2], &loaded_empty);
+    file->ShareData(file->entries()[3], &loaded_scalar);
+  }
+  // The tensors keep the mapping alive after the file object is gone.
+  std::remove(filename.c_str());
+  EXPECT_TRUE(loaded_floats.shares_data());
+  EXPECT_EQ(loaded_floats.dims(), floats.dims());
+  for (TIndex i = 0; i < floats.size(); ++i) {
+    EXPECT_EQ(loaded_floats.data<float>()[i], floats.data<float>()[i]);
+  }
+  EXPECT_EQ(loaded_ints.dims(), ints.dims());
+  for (TIndex i = 0; i < ints.size(); ++i) {
+    EXPECT_EQ(loaded_ints.data<int64_t>()[i], ints.data<int64_t>()[i]);
+  }
+  EXPECT_EQ(loaded_empty.dims(), empty.dims());
+  EXPECT_TRUE(loaded_empty.IsType<uint8_t>());
+  EXPECT_EQ(loaded_scalar.ndim(), 0);
+  EXPECT_EQ(loaded_scalar.data<double>()[0], 0);
+
+  // Writes only go to a private copy of the pages.
+  loaded_floats.mutable_data<float>()[0] = 42;
+  EXPECT_EQ(loaded_floats.data<float>()[0], 42);
+}
+
+TEST(MmapTensorFileTest, InitNet) {
+  TensorCPU weights, bias;
+  FillTensor<float>(&weights, {8, 4});
+  FillTensor<float>(&bias, {8});
+  const string filename = (string)std::tmpnam(nullptr);
+  WriteMmapTensorFile(filename, {{"W", &weights}, {"b", &bias}});
+
+  Workspace ws;
+  ASSERT_TRUE(ws.RunNetOnce(MmapTensorFileInitNet(filename)));
+  std::remove(filename.c_str());
+  const auto& loaded_weights = ws.GetBlob("W")->Get<TensorCPU>();
+  const auto& loaded_bias = ws.GetBlob("b")->Get<TensorCPU>();
+  EXPECT_TRUE(loaded_weights.shares_data());
+  EXPECT_EQ(loaded_weights.dims(), weights.dims());
+  for (TIndex i = 0; i < weights.size(); ++i) {
+    EXPECT_EQ(loaded_weights.data<float>()[i], weights.data<float>()[i]);
+  }
+  EXPECT_EQ(loaded_bias.dims(), bias.dims());
+}
+
+TEST(MmapTensorFileTest, RejectsStrings) {
+  TensorCPU strings;
+  strings.Resize(2);
+  strings.mutable_data<std::string>();
+  const string filename = (string)std::tmpnam(nullptr);
+  EXPECT_THROW(
+      WriteMmapTensorFile(filename, {{"strings", &strings}}), EnforceNotMet);
+  std::remove(filename.c_str());
+}
+
+TEST(MmapTensorFileTest, RejectsTruncatedFile) {
+  TensorCPU floats;
+  FillTensor<float>(&floats, {1000});
+  const string filename = (string)std::tmpnam(nullptr);
+  WriteMmapTensorFile(filename, {{"floats", &floats}});
+  {
+    std::ifstream in(filename, std::ios::binary);
+    string content(
+        (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(content.data(), content.size() / 2);
+  }
+  EXPECT_THROW(MmapTensorFile::Open(filename), EnforceNotMet);
+  std::remove(filename.c_str());
+  EXPECT_FALSE(IsMmapTensorFile(filename));
+}
+
+} // namespace caffe2
@@ -17,15 +17,29 @@
 #include "caffe2/core/net.h"
 #include "caffe2/core/net_simple.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
 #include <set>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "caffe2/core/memory_profiler.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/static_tracepoint.h"
+#include "caffe2/core/stats.h"
 #include "caffe2/core/timer.h"
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/utils/proto_utils.h"
 
+CAFFE2_DEFINE_int(
+    caffe2_net_construction_threads,
+    1,
+    "Default number of threads that create the operators of a net, see "
+    "the num_construction_threads net argument.");
+
 namespace caffe2 {
 
 CAFFE_DEFINE_REGISTRY(
@@ -36,14 +50,15 @@ CAFFE_DEFINE_REGISTRY(
 
 NetBase::NetBase(
     const std::shared_ptr<const NetDef>& def,
-    Workspace* /* unused */)
+    Workspace* ws)
     : external_input_(
           def->external_input().begin(),
           def->external_input().end()),
       external_output_(
           def->external_output().begin(),
           def->external_output().end()),
-      name_(def->name()) {
+      name_(def->name()),
+      ws_(ws) {
   // Check that node_name is empty for all ops
   for (const OperatorDef& op : def->op()) {
     if (op.has_device_option()) {
@@ -86,6 +101,16 @@ NetBase::NetBase(
       remaining_output.erase(out);
     }
   }
+  std::set<string> seen_blobs(external_input_.begin(), external_input_.end());
+  seen_blobs.insert(external_output_.begin(), external_output_.end());
+  for (const OperatorDef& op : def->op()) {
+    seen_blobs.insert(op.input().begin(), op.input().end());
+    for (const string& out : op.output()) {
+      if (seen_blobs.insert(out).second) {
+        intermediate_blobs_.push_back(out);
+      }
+    }
+  }
   // Finally, check if all declared outputs are being created.
   CAFFE_ENFORCE(
       remaining_output.size() == 0,
@@ -94,6 +119,48 @@ NetBase::NetBase(
       def->name(),
       ", the first one is ",
       *remaining_output.begin());
+
+  ArgumentHelper arg_helper(*def);
+  thread_pool_options_.chunksPerThread =
+      arg_helper.GetSingleArgument<int>("threadpool_chunks_per_thread", -1);
+  thread_pool_options_.spinNOPs =
+      arg_helper.GetSingleArgument<int>("threadpool_spin_nops", -1);
+}
+
+bool NetBase::Run() {
+  CAFFE_SDT(net_start, name_.c_str(), (void*)this);
+  MemoryProfiler::NetScope memory_scope(name_);
+  ThreadPool::ScopedRunOptions thread_pool_options(thread_pool_options_);
+  cancelled_ = false;
+  if (!RunAsync()) {
+    if (IsCancelled()) {
+      LOG(WARNING) << "Run of net " << name_ << " was cancelled.";
+      FreeIntermediateBlobs();
+    }
+    CAFFE_SDT(net_done, name_.c_str(), (void*)this, false);
+    return false;
+  }
+  for (const Event* event : events_) {
+    event->Finish();
+  }
+  CAFFE_SDT(net_done, name_.c_str(), (void*)this, true);
+  return true;
+}
+
+bool NetBase::IsCancelled() const {
+  return cancelled_ || (parent_op_ && parent_op_->IsCancelled());
+}
+
+void NetBase::FreeIntermediateBlobs() {
+  if (!ws_) {
+    return;
+  }
+  for (const auto& name : intermediate_blobs_) {
+    auto* blob = ws_->GetBlob(name);
+    if (blob && blob->IsType<TensorCPU>()) {
+      blob->GetMutable<TensorCPU>()->FreeMemory();
+    }
+  }
 }
 
 static NetObserverCreator GlobalNetObserverCreator = [](NetBase* net) {
@@ -106,6 +173,105 @@ void SetGlobalNetObserverCreator(NetObserverCreator creator) {
   VLOG(1) << "Have set custom GlobalNetObserverCreator";
 }
 
+namespace {
+
+struct NetConstructionTime {
+  CAFFE_STAT_CTOR(NetConstructionTime);
+  CAFFE_EXPORTED_STAT(net_construction_time_ns);
+};
+
+// Operators with nets as arguments create the nets, and their blobs, in their
+// constructors.
+bool HasNetArguments(const OperatorDef& op_def) {
+  for (const auto& arg : op_def.arg()) {
+    if (arg.has_n() || arg.nets_size() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+vector<unique_ptr<OperatorBase>> CreateOperators(
+    const std::shared_ptr<const NetDef>& net_def,
+    Workspace* ws) {
+  const int num_ops = net_def->op_size();
+  vector<unique_ptr<OperatorBase>> operators(num_ops);
+  auto create = [&](int idx) {
+    const auto& operator_def = net_def->op(idx);
+    VLOG(1) << "Creating operator #" << idx << " " << operator_def.name()
+            << ": " << operator_def.type();
+    if (!operator_def.has_device_option() && net_def->has_device_option()) {
+      // In the case that the operator def does not specify a device option
+      // but the net def has a default option, we copy the device option over
+      // to the operator def.
+      OperatorDef temp_def(operator_def);
+      temp_def.mutable_device_option()->CopyFrom(net_def->device_option());
+      operators[idx] = CreateOperator(temp_def, ws, idx);
+    } else {
+      operators[idx] = CreateOperator(operator_def, ws, idx);
+      operators[idx]->set_debug_def(
+          std::shared_ptr<const OperatorDef>{net_def, &(net_def->op(idx))});
+    }
+  };
+
+  const int num_threads = std::min(
+      ArgumentHelper(*net_def).GetSingleArgument<int>(
+          "num_construction_threads", FLAGS_caffe2_net_construction_threads),
+      num_ops);
+  if (num_threads <= 1) {
+    for (int idx = 0; idx < num_ops; ++idx) {
+      create(idx);
+    }
+    return operators;
+  }
+
+  // Operators find their outputs instead of adding them to the workspace.
+  vector<int> parallel;
+  vector<int> sequential;
+  for (int idx = 0; idx < num_ops; ++idx) {
+    const auto& operator_def = net_def->op(idx);
+    for (const auto& output : operator_def.output()) {
+      ws->CreateBlob(output);
+    }
+    (HasNetArguments(operator_def) ? sequential : parallel).push_back(idx);
+  }
+  std::atomic<int> next{0};
+  std::atomic<bool> failed{false};
+  std::exception_ptr exception;
+  std::mutex exception_mutex;
+  auto worker = [&]() {
+    const int num_parallel = parallel.size();
+    for (int i = next++; i < num_parallel && !failed; i = next++) {
+      try {
+        create(parallel[i]);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(exception_mutex);
+        if (!failed) {
+          exception = std::current_exception();
+          failed = true;
+        }
+      }
+    }
+  };
+  vector<std::thread> threads;
+  for (int i = 0; i < num_threads - 1; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+  for (int idx : sequential) {
+    create(idx);
+  }
+  return operators;
+}
+
 unique_ptr<NetBase> CreateNet(const NetDef& net_def, Workspace* ws) {
   std::shared_ptr<NetDef> tmp_net_def(new NetDef(net_def));
   return CreateNet(tmp_net_def, ws);
@@ -116,6 +282,7 @@ unique_ptr<NetBase> CreateNet(
     Workspace* ws) {
   // In default, we will return a simple network that just runs all operators
   // sequentially.
+  Timer timer;
   unique_ptr<NetBase> net;
   if (!net_def->has_type()) {
     net = std::unique_ptr<NetBase>(new SimpleNet(net_def, ws));
@@ -124,6 +291,18 @@ unique_ptr<NetBase> CreateNet(
   }
   VLOG(1) << "Adding a global observer to a net";
   if (net) {
+    net->construction_secs_ = timer.Seconds();
+    VLOG(1) << "Created net " << net->Name() << " with "
+            << net_def->op_size() << " operators in "
+            << net->construction_secs_ << " seconds";
+    NetConstructionTime stat(net->Name());
+    CAFFE_EVENT(
+        stat,
+        net_construction_time_ns,
+        static_cast<long>(net->construction_secs_ * 1e9));
+    for (auto* op : net->GetOperators()) {
+      op->SetNet(net.get());
+    }
     net->AttachObserver(GlobalNetObserverCreator(net.get()));
   }
   return net;
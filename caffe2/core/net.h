@@ -33,9 +33,12 @@
 #include "caffe2/core/registry.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/core/workspace.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/utils/simple_queue.h"
 
+CAFFE2_DECLARE_int(caffe2_net_construction_threads);
+
 namespace caffe2 {
 
 class NetBase;
@@ -58,15 +61,9 @@ class NetBase : public Observable<NetBase> {
     return events_;
   }
 
-  inline bool Run() {
-    if (!RunAsync()) {
-      return false;
-    }
-    for (const Event* event : events_) {
-      event->Finish();
-    }
-    return true;
-  }
+  // Runs the net and waits for all of its events. Defined in net.cc, as
+  // tracepoints must not live in inline functions.
+  bool Run();
 
   /**
    * Benchmarks a network.
@@ -104,11 +101,57 @@ class NetBase : public Observable<NetBase> {
     return name_;
   }
 
+  // Seconds it took CreateNet to create the net and its operators.
+  float construction_secs() const {
+    return construction_secs_;
+  }
+
+  // Cancels the run in progress, if any; can be called from any thread.
+  // The executors start no more operators, operators that loop, e.g. While
+  // and RecurrentNetwork, stop before their next iteration, and Run()
+  // returns false once the running operators have finished. The CPU tensors
+  // of the blobs that only hold values of a run are then freed, which
+  // returns their memory to the allocator. A Cancel() between runs has no
+  // effect, as Run() clears it when it starts.
+  void Cancel() {
+    cancelled_ = true;
+  }
+
+  // Whether the current run, or the run of the operator that runs this net,
+  // e.g. a While operator, is cancelled.
+  bool IsCancelled() const;
+
+  // Makes this net cancelled along with the net of op, for the nets that
+  // operators run.
+  void SetParentOperator(const OperatorBase* op) {
+    parent_op_ = op;
+  }
+
  protected:
   vector<string> external_input_;
   vector<string> external_output_;
   string name_;
   vector<const Event*> events_;
+  // The threadpool_chunks_per_thread and threadpool_spin_nops arguments of
+  // the net, which Run() applies to the thread pool runs of the calling
+  // thread. Executors that run operators on threads of their own apply them
+  // there too.
+  ThreadPool::RunOptions thread_pool_options_;
+
+ private:
+  // Frees the CPU tensors of intermediate_blobs_ after a cancelled run.
+  void FreeIntermediateBlobs();
+
+  Workspace* ws_;
+  std::atomic<bool> cancelled_{false};
+  const OperatorBase* parent_op_ = nullptr;
+  // Blobs the net writes before it reads them, other than its external
+  // inputs and outputs.
+  vector<string> intermediate_blobs_;
+  float construction_secs_ = 0;
+  friend unique_ptr<NetBase> CreateNet(
+      const std::shared_ptr<const NetDef>& net_def,
+      Workspace* ws);
 
   DISABLE_COPY_AND_ASSIGN(NetBase);
 };
@@ -137,6 +180,22 @@ unique_ptr<NetBase> CreateNet(
 
 void SetGlobalNetObserverCreator(NetObserverCreator creator);
 
+/**
+ * @brief Creates the operators of a net, in order, for the constructors of
+ * nets. Operators without a device option get the one of the net.
+ *
+ * If the num_construction_threads argument of the net, which defaults to
+ * FLAGS_caffe2_net_construction_threads, is more than 1, the operators are
+ * created on that many threads. The outputs of all operators are created
+ * first, so this requires operator constructors not to create other blobs or
+ * otherwise change the workspace. Operators with nets as arguments, e.g.
+ * control flow operators, create nets of their own and are always created
+ * sequentially, after the others.
+ */
+vector<unique_ptr<OperatorBase>> CreateOperators(
+    const std::shared_ptr<const NetDef>& net_def,
+    Workspace* ws);
+
 }  // namespace caffe2
 
 #endif  // CAFFE2_CORE_NET_H_
@@ -16,11 +16,15 @@
 
 #include "caffe2/core/net_async_dag_gpu.h"
 
+#include <algorithm>
+#include <map>
 #include <set>
 #include <stack>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "caffe2/core/memory_profiler.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/static_tracepoint.h"
 #include "caffe2/core/timer.h"
@@ -32,6 +36,11 @@
 #endif
 
 CAFFE2_DEFINE_bool(caffe2_use_nvtx, false, "Use NVTX ranges for profiling");
+CAFFE2_DEFINE_int(
+    caffe2_async_dag_num_streams,
+    1,
+    "Number of streams per device that AsyncDAGNet spreads independent "
+    "chains over");
 
 namespace caffe2 {
 
@@ -85,14 +94,24 @@ class ProfiledRange {
 
 #endif // ifdef CAFFE2_USE_NVTX
 
+std::pair<int, int> DeviceKey(const DeviceOption& option) {
+  return std::make_pair(option.device_type(), option.cuda_gpu_id());
+}
+
 } // namespace
 
 AsyncDAGNet::AsyncDAGNet(
     const std::shared_ptr<const NetDef>& net_def,
     Workspace* ws)
-    : DAGNetBase(net_def, ws) {
+    : DAGNetBase(net_def, ws),
+      num_streams_(FLAGS_caffe2_async_dag_num_streams),
+      crossStreamWaits_(0),
+      sameStreamWaits_(0) {
   VLOG(1) << "Constructing Async DAG Net " << net_def->name();
+  CAFFE_ENFORCE_GE(num_streams_, 1, "Need at least one stream per device");
   eventRecorded_.resize(net_def->op_size());
+  issuingThread_.resize(net_def->op_size());
+  AssignStreams();
 
   // For all chains, their tail should consist the list of events that we are
   // needing for synchronization in the Run() inteface, unless there are other
@@ -108,6 +127,69 @@ AsyncDAGNet::AsyncDAGNet(
           << " chains, final waiting on " << events_.size() << " events";
 }
 
+void AsyncDAGNet::AssignStreams() {
+  streamIds_.assign(operator_nodes_.size(), 0);
+  if (num_streams_ == 1) {
+    return;
+  }
+  // Parents have lower indices than their children, so going over the chain
+  // sources in order visits every parent chain before its children.
+  std::vector<int> sources;
+  for (const auto& chain : execution_chains_) {
+    sources.push_back(chain.first);
+  }
+  std::sort(sources.begin(), sources.end());
+
+  // Sinks whose stream was already taken over by one of their child chains.
+  std::vector<bool> continued(operator_nodes_.size(), false);
+  std::map<std::pair<int, int>, int> nextStream;
+  for (const auto source : sources) {
+    const auto device =
+        DeviceKey(operator_nodes_[source].operator_->device_option());
+    int stream = -1;
+    for (const auto parent : operator_nodes_[source].parents_) {
+      if (!continued[parent] &&
+          DeviceKey(operator_nodes_[parent].operator_->device_option()) ==
+              device) {
+        continued[parent] = true;
+        stream = streamIds_[parent];
+        break;
+      }
+    }
+    if (stream < 0) {
+      int& next = nextStream[device];
+      stream = next;
+      next = (next + 1) % num_streams_;
+    }
+    for (const auto idx : execution_chains_.at(source)) {
+      streamIds_[idx] = stream;
+    }
+  }
+}
+
+bool AsyncDAGNet::SameStream(int op_idx, int other_idx) const {
+  return streamIds_[op_idx] == streamIds_[other_idx] &&
+      issuingThread_[other_idx] == std::this_thread::get_id() &&
+      DeviceKey(operator_nodes_[op_idx].operator_->device_option()) ==
+      DeviceKey(operator_nodes_[other_idx].operator_->device_option());
+}
+
+AsyncDAGNet::StreamStats AsyncDAGNet::LastRunStreamStats() const {
+  StreamStats stats;
+  std::set<std::tuple<std::thread::id, std::pair<int, int>, int>> streams;
+  for (const auto& chain : execution_chains_) {
+    const int sink_idx = chain.second.back();
+    streams.emplace(
+        issuingThread_[sink_idx],
+        DeviceKey(operator_nodes_[sink_idx].operator_->device_option()),
+        streamIds_[sink_idx]);
+  }
+  stats.streams_used = streams.size();
+  stats.cross_stream_waits = crossStreamWaits_;
+  stats.same_stream_waits = sameStreamWaits_;
+  return stats;
+}
+
 bool AsyncDAGNet::RunAt(const std::vector<int>& chain) {
   CAFFE_ENFORCE(!chain.empty(), "Chain should not be empty.");
   const auto source_idx = chain.front();
@@ -122,18 +204,32 @@ bool AsyncDAGNet::RunAt(const std::vector<int>& chain) {
               [this](int p) { return eventRecorded_[p]; }),
       "None of the parent is recorded for an event.");
 
+  const int stream_id = streamIds_[source_idx];
   for (auto source_parent_idx : operator_nodes_[source_idx].parents_) {
+    if (SameStream(source_idx, source_parent_idx)) {
+      ++sameStreamWaits_;
+      continue;
+    }
     ProfiledRange r(
         operator_nodes_[source_parent_idx].operator_->debug_def(), kWaitColor);
     operator_nodes_[source_idx].operator_->Wait(
-        *operator_nodes_[source_parent_idx].operator_);
+        *operator_nodes_[source_parent_idx].operator_, stream_id);
+    ++crossStreamWaits_;
   }
 
   // We've waited on all our parent indices.
+  MemoryProfiler::NetScope memory_scope(name_);
+  const auto& net_name = name_.c_str();
   bool success = true;
   for (auto idx : chain) {
-    ProfiledRange r(operator_nodes_[idx].operator_->debug_def(), kRunColor);
-    success &= operator_nodes_[idx].operator_->RunAsync();
+    const auto& opdef = operator_nodes_[idx].operator_->debug_def();
+    const auto& op = operator_nodes_[idx].operator_.get();
+    const auto& op_name = opdef.name().c_str();
+    const auto& op_type = opdef.type().c_str();
+    ProfiledRange r(opdef, kRunColor);
+    CAFFE_SDT(operator_start_async, net_name, op_name, op_type, op);
+    success &= op->RunAsync(stream_id);
+    CAFFE_SDT(operator_done, net_name, op_name, op_type, op);
   }
 
   // Record an event for the sink of the chain.
@@ -141,8 +237,9 @@ bool AsyncDAGNet::RunAt(const std::vector<int>& chain) {
   {
     ProfiledRange r(
         operator_nodes_[sink_idx].operator_->debug_def(), kRecordColor);
-    operator_nodes_[sink_idx].operator_->Record();
+    operator_nodes_[sink_idx].operator_->Record(stream_id);
   }
+  issuingThread_[sink_idx] = std::this_thread::get_id();
   CAFFE_ENFORCE(
       !eventRecorded_[sink_idx],
       "An event for ",
@@ -155,11 +252,21 @@ bool AsyncDAGNet::RunAt(const std::vector<int>& chain) {
 bool AsyncDAGNet::RunAsync() {
   // Reset the event tracking at each iteration
   eventRecorded_.assign(eventRecorded_.size(), 0);
+  crossStreamWaits_ = 0;
+  sameStreamWaits_ = 0;
 
   const auto result = DAGNetBase::RunAsync();
   return result;
 }
 
+bool AsyncDAGStreamObserver::Stop() {
+  last_ = static_cast<AsyncDAGNet*>(subject_)->LastRunStreamStats();
+  total_streams_used_ += last_.streams_used;
+  total_cross_stream_waits_ += last_.cross_stream_waits;
+  ++iterations_;
+  return true;
+}
+
 REGISTER_NET(async_dag, AsyncDAGNet);
 
 } // namespace caffe2
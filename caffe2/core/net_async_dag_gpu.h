@@ -17,8 +17,12 @@
 #ifndef CAFFE2_CORE_NET_ASYNC_DAG_GPU_H_
 #define CAFFE2_CORE_NET_ASYNC_DAG_GPU_H_
 
+#include <atomic>
+#include <thread>
+
 #include "caffe2/core/common.h"
 #include "caffe2/core/net_dag.h"
+#include "caffe2/core/observer.h"
 #include "caffe2/core/workspace.h"
 #include "caffe2/proto/caffe2.pb.h"
 
@@ -28,10 +32,27 @@ namespace caffe2 {
 // operator for the chain source, then execute each operator. Due to the chain
 // construction mechanism, operators in the same chain implicitly runs on the
 // same stream.
+// Chains are spread over --caffe2_async_dag_num_streams streams per device so
+// that independent branches can run concurrently on the same GPU. A chain
+// keeps the stream of its first parent on the same device that no other
+// chain took over yet, and otherwise gets the next stream of its device in
+// round-robin order. Waiting on a parent that was issued on the same stream is
+// skipped, since the stream already orders the two chains.
 // AsyncDAGNet is only registered in gpu mode, because CPU code is always sync
 // and a CPU only AsyncDAG net is essentially a DAG net.
 class AsyncDAGNet : public DAGNetBase {
  public:
+  // How the chains of the last run were spread over streams.
+  struct StreamStats {
+    // Number of distinct streams chains were issued on. This is the most
+    // kernels of this net that could have run concurrently.
+    int streams_used = 0;
+    // Parent waits turned into cross-stream event waits.
+    int cross_stream_waits = 0;
+    // Parent waits skipped because the parent ran on the same stream.
+    int same_stream_waits = 0;
+  };
+
   AsyncDAGNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws);
   bool SupportsAsync() override {
     return true;
@@ -39,13 +60,65 @@ class AsyncDAGNet : public DAGNetBase {
   bool RunAt(const std::vector<int>& chain) override;
   bool RunAsync() override;
 
+  int num_streams() const {
+    return num_streams_;
+  }
+  // Stream id that the chain containing the given operator is issued on.
+  int stream_id(int op_idx) const {
+    return streamIds_[op_idx];
+  }
+  // Only valid once the run has finished, e.g. in a net observer's Stop().
+  StreamStats LastRunStreamStats() const;
+
  protected:
+  void AssignStreams();
+  bool SameStream(int op_idx, int other_idx) const;
+
   // Tracks whether a given op has had an event recorded in each
   // RunAt() iteration.
   std::vector<int32_t> eventRecorded_;
+  int num_streams_;
+  std::vector<int> streamIds_;
+  // Thread that issued the chain ending at a given op in the current run;
+  // stream ids are per thread, so only chains from the same thread can share
+  // a stream.
+  std::vector<std::thread::id> issuingThread_;
+  std::atomic<int> crossStreamWaits_;
+  std::atomic<int> sameStreamWaits_;
   DISABLE_COPY_AND_ASSIGN(AsyncDAGNet);
 };
 
+// Net observer that accumulates the stream usage of an AsyncDAGNet over runs.
+class AsyncDAGStreamObserver final : public ObserverBase<NetBase> {
+ public:
+  explicit AsyncDAGStreamObserver(AsyncDAGNet* subject)
+      : ObserverBase<NetBase>(subject) {}
+
+  bool Start() override {
+    return true;
+  }
+  bool Stop() override;
+
+  const AsyncDAGNet::StreamStats& last_stats() const {
+    return last_;
+  }
+  float average_streams_used() const {
+    return iterations_ ? float(total_streams_used_) / iterations_ : 0.0f;
+  }
+  float average_cross_stream_waits() const {
+    return iterations_ ? float(total_cross_stream_waits_) / iterations_ : 0.0f;
+  }
+  int iterations() const {
+    return iterations_;
+  }
+
+ private:
+  AsyncDAGNet::StreamStats last_;
+  int64_t total_streams_used_ = 0;
+  int64_t total_cross_stream_waits_ = 0;
+  int iterations_ = 0;
+};
+
 } // namespace caffe2
 
 #endif // CAFFE2_CORE_NET_ASYNC_DAG_GPU_H_
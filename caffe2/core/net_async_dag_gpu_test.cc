@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <mutex>
+
+#include <google/protobuf/text_format.h>
+#include <gtest/gtest.h>
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/net_async_dag_gpu.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/scope_guard.h"
+
+CAFFE2_DECLARE_int(caffe2_async_dag_num_streams);
+
+namespace caffe2 {
+
+namespace {
+
+class AsyncDAGTestCPUOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+  bool RunOnDevice() override {
+    return true;
+  }
+};
+
+std::mutex gStreamsMutex;
+std::map<std::string, cudaStream_t> gStreams;
+
+// Remembers the stream it was run on, keyed by the name of its first output.
+class AsyncDAGTestCUDAOp final : public Operator<CUDAContext> {
+ public:
+  using Operator<CUDAContext>::Operator;
+  bool RunOnDevice() override {
+    std::lock_guard<std::mutex> guard(gStreamsMutex);
+    gStreams[debug_def().output(0)] = context_.cuda_stream();
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(AsyncDAGTest, AsyncDAGTestCPUOp);
+REGISTER_CUDA_OPERATOR(AsyncDAGTest, AsyncDAGTestCUDAOp);
+OPERATOR_SCHEMA(AsyncDAGTest)
+    .NumInputs(0, INT_MAX)
+    .NumOutputs(0, INT_MAX);
+
+// A diamond: "in" feeds two independent branches that are joined by "out".
+const char kDiamondNet[] = R"DOC(
+  name: "diamond"
+  type: "async_dag"
+  num_workers: 1
+  op { output: "in" type: "AsyncDAGTest" }
+  op { input: "in" output: "a" type: "AsyncDAGTest" }
+  op { input: "in" output: "b" type: "AsyncDAGTest" }
+  op { input: "a" input: "b" output: "out" type: "AsyncDAGTest" }
+)DOC";
+
+std::unique_ptr<NetBase> CreateDiamondNet(Workspace* ws, DeviceType type) {
+  NetDef net_def;
+  CAFFE_ENFORCE(
+      google::protobuf::TextFormat::ParseFromString(kDiamondNet, &net_def));
+  net_def.mutable_device_option()->set_device_type(type);
+  return CreateNet(net_def, ws);
+}
+
+} // namespace
+
+TEST(AsyncDAGNetTest, SpreadsBranchesOverStreams) {
+  auto old = FLAGS_caffe2_async_dag_num_streams;
+  auto g = MakeGuard([&]() { FLAGS_caffe2_async_dag_num_streams = old; });
+  FLAGS_caffe2_async_dag_num_streams = 2;
+
+  Workspace ws;
+  auto net = CreateDiamondNet(&ws, CPU);
+  auto* dag = dynamic_cast_if_rtti<AsyncDAGNet*>(net.get());
+  ASSERT_TRUE(dag != nullptr);
+  EXPECT_EQ(dag->num_streams(), 2);
+  // The first branch and the join continue on the stream of their parent,
+  // the second branch gets a stream of its own.
+  EXPECT_EQ(dag->stream_id(0), 0);
+  EXPECT_EQ(dag->stream_id(1), 0);
+  EXPECT_EQ(dag->stream_id(2), 1);
+  EXPECT_EQ(dag->stream_id(3), 0);
+
+  const auto* observer = dynamic_cast_if_rtti<const AsyncDAGStreamObserver*>(
+      net->AttachObserver(caffe2::make_unique<AsyncDAGStreamObserver>(dag)));
+  ASSERT_TRUE(observer != nullptr);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(net->Run());
+  }
+  EXPECT_EQ(observer->iterations(), 3);
+  EXPECT_EQ(observer->last_stats().streams_used, 2);
+  // Only the edges into and out of the second branch cross streams.
+  EXPECT_EQ(observer->last_stats().cross_stream_waits, 2);
+  EXPECT_EQ(observer->last_stats().same_stream_waits, 2);
+  EXPECT_FLOAT_EQ(observer->average_streams_used(), 2);
+}
+
+TEST(AsyncDAGNetTest, SingleStreamByDefault) {
+  Workspace ws;
+  auto net = CreateDiamondNet(&ws, CPU);
+  auto* dag = dynamic_cast_if_rtti<AsyncDAGNet*>(net.get());
+  ASSERT_TRUE(dag != nullptr);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(dag->stream_id(i), 0);
+  }
+  EXPECT_TRUE(net->Run());
+  const auto stats = dag->LastRunStreamStats();
+  EXPECT_EQ(stats.streams_used, 1);
+  EXPECT_EQ(stats.cross_stream_waits, 0);
+}
+
+TEST(AsyncDAGNetTest, BranchesRunOnDifferentCUDAStreams) {
+  if (!HasCudaGPU()) {
+    return;
+  }
+  auto old = FLAGS_caffe2_async_dag_num_streams;
+  auto g = MakeGuard([&]() { FLAGS_caffe2_async_dag_num_streams = old; });
+  FLAGS_caffe2_async_dag_num_streams = 2;
+
+  Workspace ws;
+  auto net = CreateDiamondNet(&ws, CUDA);
+  EXPECT_TRUE(net->Run());
+  std::lock_guard<std::mutex> guard(gStreamsMutex);
+  EXPECT_EQ(gStreams["in"], gStreams["a"]);
+  EXPECT_NE(gStreams["a"], gStreams["b"]);
+  EXPECT_EQ(gStreams["a"], gStreams["out"]);
+}
+
+} // namespace caffe2
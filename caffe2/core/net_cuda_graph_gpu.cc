@@ -0,0 +1,210 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/net_cuda_graph_gpu.h"
+
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+namespace {
+
+template <class TensorType>
+bool GetInputState(const Blob* blob, vector<TIndex>* dims, const void** data) {
+  if (!blob->IsType<TensorType>()) {
+    return false;
+  }
+  const auto& tensor = blob->Get<TensorType>();
+  *dims = tensor.dims();
+  *data = tensor.size() > 0 ? tensor.raw_data() : nullptr;
+  return true;
+}
+
+} // namespace
+
+CUDAGraphNet::CUDAGraphNet(
+    const std::shared_ptr<const NetDef>& net_def,
+    Workspace* ws)
+    : SimpleNet(net_def, ws) {
+#if CUDA_VERSION >= 10010
+  for (const auto& op : operators_) {
+    const auto& option = op->device_option();
+    if (option.device_type() != CUDA) {
+      LOG(WARNING) << "Net " << net_def->name() << " has non-CUDA operator "
+                   << op->debug_def().type() << ", running it eagerly.";
+      capturable_ = false;
+      break;
+    }
+    if (gpu_id_ < 0) {
+      gpu_id_ = option.cuda_gpu_id();
+    } else if (gpu_id_ != option.cuda_gpu_id()) {
+      LOG(WARNING) << "Net " << net_def->name()
+                   << " has operators on several GPUs, running it eagerly.";
+      capturable_ = false;
+      break;
+    }
+  }
+  capturable_ = capturable_ && gpu_id_ >= 0;
+#else
+  LOG(WARNING) << "CUDA graphs need CUDA 10.1 or newer, running net "
+               << net_def->name() << " eagerly.";
+  capturable_ = false;
+#endif
+}
+
+CUDAGraphNet::~CUDAGraphNet() {
+  ResetGraph();
+}
+
+bool CUDAGraphNet::graph_captured() const {
+#if CUDA_VERSION >= 10010
+  return graph_exec_ != nullptr;
+#else
+  return false;
+#endif
+}
+
+bool CUDAGraphNet::RunAsync() {
+  if (capturable_) {
+    vector<InputState> inputs;
+    const bool inputs_valid = CollectInputs(&inputs);
+    const bool same_inputs =
+        inputs_valid && inputs_valid_ && inputs == inputs_;
+    if (same_inputs && graph_captured()) {
+      return Replay();
+    }
+    ResetGraph();
+    inputs_ = std::move(inputs);
+    inputs_valid_ = inputs_valid;
+    // Capturing does not run the kernels, so a captured graph is launched
+    // right away. If the capture failed, the iteration runs eagerly below.
+    if (same_inputs && Capture()) {
+      return Replay();
+    }
+  }
+  return SimpleNet::RunAsync();
+}
+
+bool CUDAGraphNet::CollectInputs(vector<InputState>* inputs) const {
+  inputs->clear();
+  for (const auto& name : external_input_) {
+    const Blob* blob = ws_->GetBlob(name);
+    if (!blob) {
+      return false;
+    }
+    InputState state;
+    state.blob = blob;
+    if (GetInputState<TensorCUDA>(blob, &state.dims, &state.data) ||
+        GetInputState<TensorCPU>(blob, &state.dims, &state.data)) {
+      inputs->push_back(std::move(state));
+    }
+  }
+  return true;
+}
+
+bool CUDAGraphNet::Capture() {
+#if CUDA_VERSION >= 10010
+  DeviceGuard guard(gpu_id_);
+  cudaStream_t stream = CUDAContext::cuda_stream(gpu_id_, 0);
+  CUDA_ENFORCE(
+      cudaStreamBeginCapture(stream, cudaStreamCaptureModeThreadLocal));
+
+  const OperatorBase* rejected = nullptr;
+  std::string reason;
+  for (auto& op : operators_) {
+    const auto memory_events = CUDAContext::ThreadMemoryEvents();
+    bool success = false;
+    try {
+      success = op->RunAsync(0);
+    } catch (const std::exception& e) {
+      reason = e.what();
+    }
+    cudaStreamCaptureStatus status = cudaStreamCaptureStatusNone;
+    if (cudaStreamIsCapturing(stream, &status) != cudaSuccess ||
+        status != cudaStreamCaptureStatusActive) {
+      reason = "it synchronizes with the host";
+    } else if (CUDAContext::ThreadMemoryEvents() != memory_events) {
+      reason = "it allocates or frees GPU memory";
+    } else if (!success && reason.empty()) {
+      reason = "it failed";
+    }
+    if (!reason.empty()) {
+      rejected = op.get();
+      break;
+    }
+  }
+
+  cudaGraph_t graph = nullptr;
+  const cudaError_t end_error = cudaStreamEndCapture(stream, &graph);
+  // Operations rejected during capture leave an error behind, clear it so
+  // that the eager run does not pick it up.
+  cudaGetLastError();
+  if (!rejected && end_error == cudaSuccess) {
+    CUDA_ENFORCE(
+        cudaGraphInstantiate(&graph_exec_, graph, nullptr, nullptr, 0));
+  }
+  if (graph) {
+    CUDA_CHECK(cudaGraphDestroy(graph));
+  }
+  if (!graph_exec_) {
+    if (rejected) {
+      LOG(WARNING) << "Operator " << rejected->debug_def().type() << " ("
+                   << rejected->debug_def().name() << ") of net " << name_
+                   << " cannot be captured in a CUDA graph because " << reason
+                   << ", running the net eagerly.";
+    } else {
+      LOG(WARNING) << "Capturing net " << name_ << " failed with "
+                   << cudaGetErrorString(end_error)
+                   << ", running the net eagerly.";
+    }
+    capturable_ = false;
+    return false;
+  }
+  ++num_captures_;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool CUDAGraphNet::Replay() {
+#if CUDA_VERSION >= 10010
+  StartAllObservers();
+  DeviceGuard guard(gpu_id_);
+  cudaStream_t stream = CUDAContext::cuda_stream(gpu_id_, 0);
+  CUDA_ENFORCE(cudaGraphLaunch(graph_exec_, stream));
+  CUDA_ENFORCE(cudaStreamSynchronize(stream));
+  ++num_replays_;
+  StopAllObservers();
+  return true;
+#else
+  return false;
+#endif
+}
+
+void CUDAGraphNet::ResetGraph() {
+#if CUDA_VERSION >= 10010
+  if (graph_exec_) {
+    DeviceGuard guard(gpu_id_);
+    CUDA_CHECK(cudaGraphExecDestroy(graph_exec_));
+    graph_exec_ = nullptr;
+  }
+#endif
+}
+
+REGISTER_NET(cuda_graph, CUDAGraphNet);
+
+} // namespace caffe2
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_NET_CUDA_GRAPH_GPU_H_
+#define CAFFE2_CORE_NET_CUDA_GRAPH_GPU_H_
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/core/net_simple.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+// A simple net that records the kernels of one iteration into a CUDA graph
+// and replays the graph with a single launch as long as the external inputs
+// keep their shapes and buffers, which removes the per-kernel launch overhead
+// of small GPU nets.
+//
+// An iteration runs eagerly first. When the next run sees the same external
+// inputs, the operators are run once under stream capture instead, and from
+// then on the graph is launched. A change in the shape or data pointer of any
+// external input drops the graph; it is captured again once the new inputs
+// are stable. The captured kernels read and write the buffers the blobs held
+// at capture time, so operators that allocate or free GPU memory per run, or
+// that synchronize with the host (e.g. device to host copies), cannot be
+// captured. Such an operator is detected during capture and the net then
+// falls back to running eagerly for good, as it does when it has CPU
+// operators or spans several GPUs. Needs CUDA 10.1 or newer.
+class CUDAGraphNet : public SimpleNet {
+ public:
+  CUDAGraphNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws);
+  ~CUDAGraphNet() override;
+  bool RunAsync() override;
+
+  // Whether the net may still be captured into a graph.
+  bool capturable() const {
+    return capturable_;
+  }
+  bool graph_captured() const;
+  int64_t num_captures() const {
+    return num_captures_;
+  }
+  int64_t num_replays() const {
+    return num_replays_;
+  }
+
+ protected:
+  struct InputState {
+    const Blob* blob;
+    vector<TIndex> dims;
+    const void* data;
+
+    bool operator==(const InputState& other) const {
+      return blob == other.blob && dims == other.dims && data == other.data;
+    }
+  };
+
+  bool CollectInputs(vector<InputState>* inputs) const;
+  bool Capture();
+  bool Replay();
+  void ResetGraph();
+
+  int gpu_id_ = -1;
+  bool capturable_ = true;
+  // External inputs of the last run, and of the graph if one is captured.
+  vector<InputState> inputs_;
+  bool inputs_valid_ = false;
+  int64_t num_captures_ = 0;
+  int64_t num_replays_ = 0;
+#if CUDA_VERSION >= 10010
+  cudaGraphExec_t graph_exec_ = nullptr;
+#endif
+
+  DISABLE_COPY_AND_ASSIGN(CUDAGraphNet);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_NET_CUDA_GRAPH_GPU_H_
@@ -0,0 +1,166 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <google/protobuf/text_format.h>
+#include <gtest/gtest.h>
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/net_cuda_graph_gpu.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Sets its output to the value argument, with the shape of its input.
+class CUDAGraphTestFillOp final : public Operator<CUDAContext> {
+ public:
+  CUDAGraphTestFillOp(const OperatorDef& def, Workspace* ws)
+      : Operator<CUDAContext>(def, ws),
+        value_(OperatorBase::GetSingleArgument<int>("value", 0)) {}
+
+  bool RunOnDevice() override {
+    auto* output = Output(0);
+    output->ResizeLike(Input(0));
+    CUDA_ENFORCE(cudaMemsetAsync(
+        output->mutable_data<float>(),
+        value_,
+        output->nbytes(),
+        context_.cuda_stream()));
+    return true;
+  }
+
+ private:
+  int value_;
+};
+
+// Waits for its stream, which is not allowed while capturing.
+class CUDAGraphTestSyncOp final : public Operator<CUDAContext> {
+ public:
+  using Operator<CUDAContext>::Operator;
+  bool RunOnDevice() override {
+    context_.FinishDeviceComputation();
+    return true;
+  }
+};
+
+REGISTER_CUDA_OPERATOR(CUDAGraphTestFill, CUDAGraphTestFillOp);
+REGISTER_CUDA_OPERATOR(CUDAGraphTestSync, CUDAGraphTestSyncOp);
+OPERATOR_SCHEMA(CUDAGraphTestFill).NumInputs(1).NumOutputs(1);
+OPERATOR_SCHEMA(CUDAGraphTestSync).NumInputs(0, INT_MAX).NumOutputs(0);
+
+const char kFillNet[] = R"DOC(
+  name: "fill"
+  type: "cuda_graph"
+  external_input: "in"
+  op {
+    input: "in" output: "out" type: "CUDAGraphTestFill"
+    arg { name: "value" i: 0 }
+  }
+)DOC";
+
+CUDAGraphNet* CreateGraphNet(
+    const char* text,
+    Workspace* ws,
+    std::unique_ptr<NetBase>* net) {
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(text, &net_def));
+  net_def.mutable_device_option()->set_device_type(CUDA);
+  *net = CreateNet(net_def, ws);
+  return dynamic_cast_if_rtti<CUDAGraphNet*>(net->get());
+}
+
+void SetInput(Workspace* ws, const vector<TIndex>& dims) {
+  auto* tensor = ws->CreateBlob("in")->GetMutable<TensorCUDA>();
+  tensor->Resize(dims);
+  tensor->mutable_data<float>();
+}
+
+} // namespace
+
+TEST(CUDAGraphNetTest, ReplaysWhileInputsAreUnchanged) {
+  if (!HasCudaGPU()) {
+    return;
+  }
+  Workspace ws;
+  SetInput(&ws, {2, 3});
+  std::unique_ptr<NetBase> net;
+  auto* graph_net = CreateGraphNet(kFillNet, &ws, &net);
+  ASSERT_TRUE(graph_net != nullptr);
+  if (!graph_net->capturable()) {
+    // Built against a CUDA without graph support.
+    return;
+  }
+  // The first run is eager, the second one captures and launches the graph.
+  EXPECT_TRUE(net->Run());
+  EXPECT_FALSE(graph_net->graph_captured());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(net->Run());
+  }
+  EXPECT_TRUE(graph_net->graph_captured());
+  EXPECT_EQ(graph_net->num_captures(), 1);
+  EXPECT_EQ(graph_net->num_replays(), 3);
+  TensorCPU out(ws.GetBlob("out")->Get<TensorCUDA>());
+  EXPECT_EQ(out.dims(), vector<TIndex>({2, 3}));
+  EXPECT_EQ(out.data<float>()[0], 0);
+
+  // A new shape drops the graph until the inputs are stable again.
+  SetInput(&ws, {4, 3});
+  EXPECT_TRUE(net->Run());
+  EXPECT_FALSE(graph_net->graph_captured());
+  EXPECT_TRUE(net->Run());
+  EXPECT_TRUE(graph_net->graph_captured());
+  EXPECT_EQ(graph_net->num_captures(), 2);
+  EXPECT_EQ(ws.GetBlob("out")->Get<TensorCUDA>().dim(0), 4);
+}
+
+TEST(CUDAGraphNetTest, RejectsHostSynchronization) {
+  if (!HasCudaGPU()) {
+    return;
+  }
+  const char kSyncNet[] = R"DOC(
+    name: "sync"
+    type: "cuda_graph"
+    external_input: "in"
+    op { input: "in" output: "out" type: "CUDAGraphTestFill" }
+    op { input: "out" type: "CUDAGraphTestSync" }
+  )DOC";
+  Workspace ws;
+  SetInput(&ws, {2});
+  std::unique_ptr<NetBase> net;
+  auto* graph_net = CreateGraphNet(kSyncNet, &ws, &net);
+  ASSERT_TRUE(graph_net != nullptr);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(net->Run());
+  }
+  EXPECT_FALSE(graph_net->capturable());
+  EXPECT_FALSE(graph_net->graph_captured());
+  EXPECT_EQ(graph_net->num_replays(), 0);
+}
+
+TEST(CUDAGraphNetTest, NetWithoutCUDAOperatorsRunsEagerly) {
+  Workspace ws;
+  NetDef net_def;
+  net_def.set_name("empty");
+  net_def.set_type("cuda_graph");
+  auto net = CreateNet(net_def, &ws);
+  auto* graph_net = dynamic_cast_if_rtti<CUDAGraphNet*>(net.get());
+  ASSERT_TRUE(graph_net != nullptr);
+  EXPECT_FALSE(graph_net->capturable());
+  EXPECT_TRUE(net->Run());
+}
+
+} // namespace caffe2
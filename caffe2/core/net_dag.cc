@@ -21,6 +21,8 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "caffe2/core/memory_profiler.h"
+#include "caffe2/core/numa.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/static_tracepoint.h"
 #include "caffe2/core/timer.h"
@@ -279,32 +281,49 @@ DAGNetBase::ExecutionChains computeChains(
       ".");
   return chains;
 }
+
+// Puts every operator with an asynchronous part in a chain of its own, so
+// that RunChain can start it without blocking on it.
+DAGNetBase::ExecutionChains isolateAsyncOps(
+    const DAGNetBase::ExecutionChains& chains,
+    const std::vector<internal::OperatorNode>& nodes) {
+  DAGNetBase::ExecutionChains result;
+  for (const auto& chain : chains) {
+    std::vector<int> current;
+    for (const auto idx : chain.second) {
+      if (!nodes[idx].operator_->HasAsyncPart()) {
+        current.push_back(idx);
+        continue;
+      }
+      if (!current.empty()) {
+        result[current.front()] = current;
+        current.clear();
+      }
+      result[idx] = {idx};
+    }
+    if (!current.empty()) {
+      result[current.front()] = current;
+    }
+  }
+  return result;
+}
 }
 
 DAGNetBase::DAGNetBase(
     const std::shared_ptr<const NetDef>& net_def,
     Workspace* ws)
-    : NetBase(net_def, ws), operator_nodes_(net_def->op_size()), iter_(0) {
+    : NetBase(net_def, ws),
+      operator_nodes_(net_def->op_size()),
+      stats_(net_def->name()),
+      iter_(0) {
   // Blob creator allows us to track which operator created which blob.
   VLOG(1) << "Constructing DAGNet " << net_def->name();
   std::map<string, int> blob_creator;
   std::map<string, std::set<int>> blob_readers;
-  bool net_def_has_device_option = net_def->has_device_option();
-  // Initialize the operators
+  auto operators = CreateOperators(net_def, ws);
   for (int idx = 0; idx < net_def->op_size(); ++idx) {
     const OperatorDef& op_def = net_def->op(idx);
-    VLOG(1) << "Creating operator #" << idx << ": " << op_def.name() << ": "
-            << op_def.type();
-    if (!op_def.has_device_option() && net_def_has_device_option) {
-      OperatorDef temp_def(op_def);
-      temp_def.mutable_device_option()->CopyFrom(net_def->device_option());
-      operator_nodes_[idx].operator_ = CreateOperator(temp_def, ws, idx);
-    } else {
-      auto op = CreateOperator(op_def, ws, idx);
-      op->set_debug_def(
-          std::shared_ptr<const OperatorDef>{net_def, &(net_def->op(idx))});
-      operator_nodes_[idx].operator_ = std::move(op);
-    }
+    operator_nodes_[idx].operator_ = std::move(operators[idx]);
     // Check the inputs, and set up parents if necessary. This addressese the
     // read after write case.
     auto checkInputs =
@@ -372,9 +391,10 @@ DAGNetBase::DAGNetBase(
     c.erase(std::remove(c.begin(), c.end(), i), c.end());
   }
 
-  execution_chains_ =
-      (FLAGS_caffe2_disable_chaining ? singleChains(operator_nodes_)
-                                     : computeChains(operator_nodes_));
+  execution_chains_ = isolateAsyncOps(
+      FLAGS_caffe2_disable_chaining ? singleChains(operator_nodes_)
+                                    : computeChains(operator_nodes_),
+      operator_nodes_);
 
   // Tag operator nodes that start chains
   for (int i = 0; i < operator_nodes_.size(); ++i) {
@@ -387,6 +407,23 @@ DAGNetBase::DAGNetBase(
     node.runtime_parent_count_ = 0;
   }
 
+  // Chains running any of the priority_op_types are queued ahead of the rest.
+  ArgumentHelper arg_helper(*net_def);
+  const auto priority_op_types =
+      arg_helper.GetRepeatedArgument<std::string>("priority_op_types");
+  if (!priority_op_types.empty()) {
+    const std::unordered_set<std::string> types(
+        priority_op_types.begin(), priority_op_types.end());
+    for (const auto& chain : execution_chains_) {
+      for (const auto idx : chain.second) {
+        if (types.count(net_def->op(idx).type())) {
+          priority_chains_.insert(chain.first);
+          break;
+        }
+      }
+    }
+  }
+
   LOG(INFO) << "Number of parallel execution chains "
             << execution_chains_.size()
             << " Number of operators = " << net_def->op_size();
@@ -410,17 +447,42 @@ DAGNetBase::DAGNetBase(
   }
   num_workers_ = num_workers;
   num_workers_first_iteration_ = num_workers_;
+  if (net_def->has_device_option() &&
+      net_def->device_option().device_type() == CPU) {
+    numa_node_id_ = net_def->device_option().numa_node_id();
+  }
 
   // Option to start only one thread for first iteration.
   // This hack is needed to prevent deadlocks happening with CUDA and
   // concurrent allocations that operators do when run the first time.
-  ArgumentHelper arg_helper(*net_def);
   if (arg_helper.HasArgument("first_iter_only_one_worker")) {
     if (arg_helper.GetSingleArgument<int64_t>(
             "first_iter_only_one_worker", 0)) {
       num_workers_first_iteration_ = 1;
     }
   }
+  if (arg_helper.GetSingleArgument<int>(
+          "use_executor_pool", FLAGS_caffe2_net_use_executor_pool)) {
+    LOG_IF(WARNING, num_workers_first_iteration_ != num_workers_)
+        << "first_iter_only_one_worker has no effect when running on the "
+        << "shared executor pool.";
+    executor_pool_ = GetExecutorPool(numa_node_id_);
+  }
+  priority_ = arg_helper.GetSingleArgument<int>("executor_priority", 0);
+  deadline_ms_ = arg_helper.GetSingleArgument<int>("deadline_ms", 0);
+  CAFFE_ENFORCE_GE(deadline_ms_, 0, "deadline_ms can't be negative.");
+  LOG_IF(
+      WARNING,
+      !executor_pool_ && (priority_ != 0 || deadline_ms_ != 0))
+      << "executor_priority and deadline_ms only have an effect when running "
+      << "on the shared executor pool.";
+}
+
+void DAGNetBase::SetSchedulingParams(int priority, int deadline_ms) {
+  CAFFE_ENFORCE_GE(deadline_ms, 0, "deadline_ms can't be negative.");
+  std::unique_lock<std::mutex> run_lock(run_in_progress_);
+  priority_ = priority;
+  deadline_ms_ = deadline_ms;
 }
 
 DAGNetBase::~DAGNetBase() {
@@ -443,38 +505,60 @@ bool DAGNetBase::RunAsync() {
   remaining_ops_ = operator_nodes_.size();
   success_ = true;
   iter_++;
-  if (!job_queue_) {
-    job_queue_ = caffe2::make_unique<SimpleQueue<int>>();
-  }
-  // Figure out number of workers to start.
-  auto num_workers_to_start = num_workers_ - workers_.size();
-  if (iter_ == 1) {
-    num_workers_to_start = num_workers_first_iteration_;
-  }
-  // Ensure the number of workers matches the defined in case
-  // any of the previously started threads terminated.
-  for (auto i = 0; i < num_workers_to_start; i++) {
-    VLOG(1) << "Start worker #" << workers_.size();
-    workers_.push_back(std::thread(&DAGNetBase::WorkerFunction, this));
+  run_deadline_ = deadline_ms_ > 0
+      ? std::chrono::steady_clock::now() +
+          std::chrono::milliseconds(deadline_ms_)
+      : std::chrono::steady_clock::time_point::max();
+  if (!executor_pool_) {
+    if (!job_queue_) {
+      job_queue_ = caffe2::make_unique<SimpleQueue<int>>();
+    }
+    // Figure out number of workers to start.
+    auto num_workers_to_start = num_workers_ - workers_.size();
+    if (iter_ == 1) {
+      num_workers_to_start = num_workers_first_iteration_;
+    }
+    // Ensure the number of workers matches the defined in case
+    // any of the previously started threads terminated.
+    for (auto i = 0; i < num_workers_to_start; i++) {
+      VLOG(1) << "Start worker #" << workers_.size();
+      workers_.push_back(std::thread(&DAGNetBase::WorkerFunction, this));
+    }
   }
   // Initialize the runtime parent count.
   for (auto& node : operator_nodes_) {
     node.runtime_parent_count_ = node.parents_.size();
   }
-  // Kickstart the job queue.
-  for (auto& value : initial_frontier_) {
-    job_queue_->Push(value);
-  }
-  // Wait for failure or completed execution.
+  // Kickstart the job queue, then wait for failure or completed execution.
+  // Chains handed to the executor pool cannot be joined, so we also wait for
+  // all of them to finish before returning.
   {
     std::unique_lock<std::mutex> mutex_lock(remaining_ops_mutex_);
+    for (auto& value : initial_frontier_) {
+      ScheduleChain(value);
+    }
     for (;;) {
-      if (remaining_ops_ == 0 || !success_) {
+      if ((remaining_ops_ == 0 || !success_) && inflight_chains_ == 0) {
         break;
       }
+      if (executor_pool_ && executor_pool_->inThreadPool()) {
+        // Run from a chain on the pool, e.g. by an operator with a nested
+        // net: this thread runs the queued chains instead of blocking, as
+        // the other pool threads may all be waiting like it.
+        mutex_lock.unlock();
+        const bool ran = executor_pool_->runOneTask();
+        mutex_lock.lock();
+        if (!ran) {
+          cv_.wait_for(mutex_lock, std::chrono::milliseconds(1));
+        }
+        continue;
+      }
       cv_.wait(mutex_lock);
     }
   }
+  if (deadline_ms_ > 0 && std::chrono::steady_clock::now() > run_deadline_) {
+    CAFFE_EVENT(stats_, runs_past_deadline);
+  }
   // Wait for all workers to terminate after failure.
   // If there is a failure, it is unlikely that the net is executed
   // again without modifications. Therefore it's easier to let the
@@ -504,7 +588,44 @@ bool DAGNetBase::RunAsync() {
   return success_;
 }
 
+void DAGNetBase::ScheduleChain(int idx) {
+  if (!executor_pool_) {
+    if (priority_chains_.count(idx)) {
+      job_queue_->PushFront(idx);
+    } else {
+      job_queue_->Push(idx);
+    }
+    return;
+  }
+  inflight_chains_++;
+  const auto queued = std::chrono::steady_clock::now();
+  executor_pool_->runTaskWithPriority(
+      [this, idx, queued]() {
+        CAFFE_EVENT(
+            stats_,
+            executor_pool_queue_time_us,
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - queued)
+                .count());
+        try {
+          RunChain(idx);
+        } catch (const std::exception& e) {
+          LOG(ERROR) << "Exception while running operator chain " << idx
+                     << ": " << e.what();
+          std::unique_lock<std::mutex> mutex_lock(remaining_ops_mutex_);
+          success_ = false;
+        }
+        std::unique_lock<std::mutex> mutex_lock(remaining_ops_mutex_);
+        if (--inflight_chains_ == 0) {
+          cv_.notify_one();
+        }
+      },
+      priority_,
+      run_deadline_);
+}
+
 void DAGNetBase::WorkerFunction() {
+  NUMABind(numa_node_id_);
   // WorkerFunctions() is an infinite loop until there are no more jobs to run.
   while (true) {
     int idx = 0;
@@ -516,73 +637,138 @@ void DAGNetBase::WorkerFunction() {
       return;
     }
 
-    VLOG(1) << "Running operator #" << idx << " "
-            << operator_nodes_[idx].operator_->debug_def().name() << "("
-            << operator_nodes_[idx].operator_->debug_def().type() << ").";
-    CAFFE_ENFORCE(
-        execution_chains_.find(idx) != execution_chains_.end(),
-        "Can't find chain ",
-        idx,
-        ".");
-    const auto& chain = execution_chains_[idx];
-    bool this_success = RunAt(execution_chains_[idx]);
-    if (!this_success) {
-      LOG(ERROR) << "Operator chain failed: "
-                 << ProtoDebugString(
-                        operator_nodes_[idx].operator_->debug_def());
-    }
-
-    // Do book-keeping
-    std::vector<int> chains_to_queue;
-    for (const auto idx : chain) {
-      for (const auto child : operator_nodes_[idx].children_) {
-        const int count = --operator_nodes_[child].runtime_parent_count_;
-        CAFFE_ENFORCE(
-            count >= 0,
-            "Found runtime parent count smaller than zero for ",
-            "operator node ",
-            operator_nodes_[child].operator_->debug_def().name(),
-            "(",
-            operator_nodes_[child].operator_->debug_def().type(),
-            ").");
-
-        if (count != 0) {
-          continue;
-        }
+    if (!RunChain(idx)) {
+      return;
+    }
+  }
+}
 
-        if (operator_nodes_[child].is_chain_start_) {
-          VLOG(2) << "Pushing chain #" << child << " to queue.";
-          chains_to_queue.push_back(child);
-        }
-      }
+bool DAGNetBase::RunChain(int idx) {
+  if (executor_pool_) {
+    // Chains that were already submitted when another chain failed are
+    // skipped.
+    std::unique_lock<std::mutex> mutex_lock(remaining_ops_mutex_);
+    if (!success_) {
+      return false;
+    }
+  }
+
+  VLOG(1) << "Running operator #" << idx << " "
+          << operator_nodes_[idx].operator_->debug_def().name() << "("
+          << operator_nodes_[idx].operator_->debug_def().type() << ").";
+  CAFFE_ENFORCE(
+      execution_chains_.find(idx) != execution_chains_.end(),
+      "Can't find chain ",
+      idx,
+      ".");
+  const auto& chain = execution_chains_[idx];
+  ThreadPool::ScopedRunOptions thread_pool_options(thread_pool_options_);
+  // The chains of a cancelled run fail without running, which ends the run.
+  if (IsCancelled()) {
+    return FinishChain(idx, false);
+  }
+  if (chain.size() == 1 && operator_nodes_[idx].operator_->HasAsyncPart() &&
+      StartsAsyncOps()) {
+    StartAsyncChain(idx);
+    return true;
+  }
+  bool this_success = RunAt(execution_chains_[idx]);
+  if (!this_success && !IsCancelled()) {
+    LOG(ERROR) << "Operator chain failed: "
+               << ProtoDebugString(
+                      operator_nodes_[idx].operator_->debug_def());
+  }
+  return FinishChain(idx, this_success);
+}
+
+void DAGNetBase::StartAsyncChain(int idx) {
+  auto* op = operator_nodes_[idx].operator_.get();
+  // Counted as in flight, so that the run waits for the callback.
+  {
+    std::unique_lock<std::mutex> mutex_lock(remaining_ops_mutex_);
+    inflight_chains_++;
+  }
+  bool started = false;
+  try {
+    started = op->RunAsync();
+  } catch (...) {
+    std::unique_lock<std::mutex> mutex_lock(remaining_ops_mutex_);
+    if (--inflight_chains_ == 0) {
+      cv_.notify_one();
     }
+    throw;
+  }
+  // The operator may already be finished, in which case this runs the
+  // callback right away.
+  op->mutable_event()->SetCallback([this, idx, op, started]() {
+    const bool this_success = started && op->event().ErrorMessage().empty();
+    if (!this_success) {
+      LOG(ERROR) << "Asynchronous operator failed: "
+                 << ProtoDebugString(op->debug_def());
+    }
+    FinishChain(idx, this_success);
+    std::unique_lock<std::mutex> mutex_lock(remaining_ops_mutex_);
+    if (--inflight_chains_ == 0) {
+      cv_.notify_one();
+    }
+  });
+}
 
-    // Notify the caller of Run
-    {
-      std::unique_lock<std::mutex> mutex_lock(remaining_ops_mutex_);
-      remaining_ops_ -= chain.size();
-      CAFFE_ENFORCE(remaining_ops_ >= 0);
-      success_ &= this_success;
-      if (remaining_ops_ == 0 || !success_) {
-        cv_.notify_one();
+bool DAGNetBase::FinishChain(int idx, bool this_success) {
+  const auto& chain = execution_chains_[idx];
+  // Do book-keeping
+  std::vector<int> chains_to_queue;
+  for (const auto idx : chain) {
+    for (const auto child : operator_nodes_[idx].children_) {
+      const int count = --operator_nodes_[child].runtime_parent_count_;
+      CAFFE_ENFORCE(
+          count >= 0,
+          "Found runtime parent count smaller than zero for ",
+          "operator node ",
+          operator_nodes_[child].operator_->debug_def().name(),
+          "(",
+          operator_nodes_[child].operator_->debug_def().type(),
+          ").");
+
+      if (count != 0) {
+        continue;
       }
 
-      // Terminate thread if this or any other operator chain failed.
-      if (!success_) {
-        job_queue_->NoMoreJobs();
-        return;
+      if (operator_nodes_[child].is_chain_start_) {
+        VLOG(2) << "Pushing chain #" << child << " to queue.";
+        chains_to_queue.push_back(child);
       }
+    }
+  }
 
-      // Queue follow up operator chains.
-      // Can't do this inline because it can race with another thread
-      // calling NoMoreJobs(). So the lock needs to be held on push.
-      for (const auto idx : chains_to_queue) {
-        job_queue_->Push(idx);
+  // Notify the caller of Run
+  {
+    std::unique_lock<std::mutex> mutex_lock(remaining_ops_mutex_);
+    remaining_ops_ -= chain.size();
+    CAFFE_ENFORCE(remaining_ops_ >= 0);
+    success_ &= this_success;
+    if (remaining_ops_ == 0 || !success_) {
+      cv_.notify_one();
+    }
+
+    // Terminate thread if this or any other operator chain failed.
+    if (!success_) {
+      if (job_queue_) {
+        job_queue_->NoMoreJobs();
       }
+      return false;
     }
 
-    VLOG(2) << "Finished executing operator #" << idx;
+    // Queue follow up operator chains.
+    // Can't do this inline because it can race with another thread
+    // calling NoMoreJobs(). So the lock needs to be held on push.
+    for (const auto idx : chains_to_queue) {
+      ScheduleChain(idx);
+    }
   }
+
+  VLOG(2) << "Finished executing operator #" << idx;
+  return true;
 }
 
 vector<float> DAGNetBase::TEST_Benchmark(
@@ -623,8 +809,12 @@ vector<float> DAGNetBase::TEST_Benchmark(
 }
 
 bool DAGNet::RunAt(const std::vector<int>& chain) {
+  MemoryProfiler::NetScope memory_scope(name_);
   const auto& net_name = name_.c_str();
   for (const auto i : chain) {
+    if (IsCancelled()) {
+      return false;
+    }
     const auto& opdef = operator_nodes_[i].operator_->debug_def();
     const auto& op = operator_nodes_[i].operator_.get();
 
@@ -18,20 +18,24 @@
 #define CAFFE2_CORE_NET_DAG_H_
 
 #include <atomic>
+#include <chrono>
 #include <climits>
 #include <cstddef>
 #include <thread> // NOLINT
 #include <typeinfo>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "caffe2/core/blob.h"
 #include "caffe2/core/common.h"
+#include "caffe2/core/executor_pool.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/net.h"
 #include "caffe2/core/observer.h"
 #include "caffe2/core/operator_schema.h"
 #include "caffe2/core/registry.h"
+#include "caffe2/core/stats.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/core/workspace.h"
 #include "caffe2/proto/caffe2.pb.h"
@@ -67,6 +71,11 @@ class DAGNetBase : public NetBase {
   // notifies all its children, and for any children that is ready, enqueues
   // it to the job queue.
   void WorkerFunction();
+  // Runs the chain starting at idx, then schedules the chains that became
+  // ready. Returns false if this or any other chain of the run has failed.
+  // A chain made of an operator with an asynchronous part is only started,
+  // if the net StartsAsyncOps(), and finished by the callback of its event.
+  bool RunChain(int idx);
   vector<float> TEST_Benchmark(
       const int warmup_runs,
       const int main_runs,
@@ -84,16 +93,59 @@ class DAGNetBase : public NetBase {
     return op_list;
   }
 
+  // Sets the priority and the deadline, relative to the start of a run, of
+  // the following runs on the shared executor pool, initially given by the
+  // executor_priority and deadline_ms arguments of the net. Waits for the
+  // current run, if any.
+  void SetSchedulingParams(int priority, int deadline_ms);
+
  protected:
   virtual bool RunAt(const std::vector<int>& chain) = 0;
+  // Hands a ready chain to a worker thread or to the shared executor pool.
+  // Must be called with remaining_ops_mutex_ held.
+  void ScheduleChain(int idx);
+  // Whether operators with an asynchronous part, which are alone in their
+  // chain, are started with RunAsync rather than run with RunAt. Nets whose
+  // RunAt does more than Run, e.g. to profile the operators, keep waiting
+  // for them.
+  virtual bool StartsAsyncOps() const {
+    return false;
+  }
+  // Does the book-keeping of a finished chain, see RunChain.
+  bool FinishChain(int idx, bool success);
+  // Starts the asynchronous operator of the chain idx.
+  void StartAsyncChain(int idx);
 
   vector<internal::OperatorNode> operator_nodes_;
   ExecutionChains execution_chains_;
+  // Chains that contain an operator listed in the priority_op_types argument
+  // of the net. When they become ready they are queued ahead of the other
+  // chains, e.g. so that collectives start while backward is still running.
+  std::unordered_set<int> priority_chains_;
   vector<int> initial_frontier_;
   std::unique_ptr<SimpleQueue<int>> job_queue_;
   std::vector<std::thread> workers_;
+  // If set, chains are run on this shared pool instead of workers_.
+  TaskThreadPool* executor_pool_ = nullptr;
+  // Chains submitted to executor_pool_, or asynchronous operators started,
+  // that have not finished yet, guarded by remaining_ops_mutex_.
+  int inflight_chains_ = 0;
+  // On the executor pool, the chains of nets of higher priority are run
+  // first, and at equal priority those of the run with the earliest
+  // deadline. A deadline_ms_ of 0 means no deadline.
+  int priority_ = 0;
+  int deadline_ms_ = 0;
+  std::chrono::steady_clock::time_point run_deadline_;
+  struct SchedulingStats {
+    CAFFE_STAT_CTOR(SchedulingStats);
+    // Time from a chain becoming ready to it starting on the executor pool.
+    CAFFE_AVG_EXPORTED_STAT(executor_pool_queue_time_us);
+    CAFFE_EXPORTED_STAT(runs_past_deadline);
+  } stats_;
   int num_workers_;
   int num_workers_first_iteration_;
+  // NUMA node the workers are bound to, -1 if none.
+  int numa_node_id_ = -1;
   int remaining_ops_;
 
   bool success_;
@@ -111,6 +163,9 @@ class DAGNet : public DAGNetBase {
 
  protected:
   bool RunAt(const std::vector<int>& chain) override;
+  bool StartsAsyncOps() const override {
+    return true;
+  }
   bool SupportsAsync() override {
     return false;
   }
@@ -0,0 +1,225 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/net_dag_ws.h"
+
+#include "caffe2/core/numa.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+DAGWSNet::DAGWSNet(
+    const std::shared_ptr<const NetDef>& net_def,
+    Workspace* ws)
+    : DAGNet(net_def, ws),
+      num_queued_(0),
+      num_sleeping_(0),
+      pending_ops_(0),
+      failed_(false),
+      stop_(false) {
+  for (int i = 0; i < num_workers_; ++i) {
+    queues_.push_back(caffe2::make_unique<WorkerQueue>());
+  }
+}
+
+DAGWSNet::~DAGWSNet() {
+  StopWorkers();
+}
+
+void DAGWSNet::StopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(wakeup_mutex_);
+    stop_ = true;
+  }
+  wakeup_cv_.notify_all();
+  VLOG(1) << "Joining workers.";
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+  for (auto& queue : queues_) {
+    queue->chains.clear();
+  }
+  num_queued_ = 0;
+  stop_ = false;
+}
+
+bool DAGWSNet::RunAsync() {
+  StartAllObservers();
+
+  // Lock run_in_progress_ to prevent concurrent Run()s.
+  std::unique_lock<std::mutex> run_lock(run_in_progress_);
+  VLOG(1) << "Running work stealing DAG net.";
+  pending_ops_ = operator_nodes_.size();
+  failed_ = false;
+  iter_++;
+  // Figure out number of workers to start, see DAGNetBase::RunAsync.
+  auto num_workers_to_start = num_workers_ - workers_.size();
+  if (iter_ == 1) {
+    num_workers_to_start = num_workers_first_iteration_;
+  }
+  for (auto i = 0; i < num_workers_to_start; i++) {
+    VLOG(1) << "Start worker #" << workers_.size();
+    workers_.push_back(
+        std::thread(&DAGWSNet::WorkerFunction, this, workers_.size()));
+  }
+  // Initialize the runtime parent count.
+  for (auto& node : operator_nodes_) {
+    node.runtime_parent_count_ = node.parents_.size();
+  }
+  // Spread the initial frontier over the running workers.
+  for (int i = 0; i < initial_frontier_.size(); ++i) {
+    PushChain(i % workers_.size(), initial_frontier_[i]);
+  }
+  // Wait for failure or completed execution.
+  {
+    std::unique_lock<std::mutex> mutex_lock(remaining_ops_mutex_);
+    cv_.wait(mutex_lock, [this]() { return pending_ops_ == 0 || failed_; });
+  }
+  if (failed_) {
+    // Let the workers terminate and drop whatever was left in the deques, the
+    // next run starts from a clean state.
+    StopWorkers();
+    return false;
+  }
+  VLOG(2) << "All ops finished running.";
+  for (const auto& op : operator_nodes_) {
+    CAFFE_ENFORCE(
+        op.runtime_parent_count_ == 0,
+        "Operator ",
+        op.operator_->debug_def().name(),
+        "(",
+        op.operator_->debug_def().type(),
+        ") has some runtime parents left.");
+  }
+
+  StopAllObservers();
+  return true;
+}
+
+void DAGWSNet::PushChain(int worker_id, int idx) {
+  {
+    auto& queue = *queues_[worker_id];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.chains.push_back(idx);
+    ++num_queued_;
+  }
+  // A sleeping worker increments num_sleeping_ before checking num_queued_
+  // under wakeup_mutex_, so either it sees the chain we just pushed or we see
+  // it sleeping here.
+  if (num_sleeping_ > 0) {
+    { std::lock_guard<std::mutex> lock(wakeup_mutex_); }
+    wakeup_cv_.notify_one();
+  }
+}
+
+bool DAGWSNet::PopLocal(int worker_id, int* idx) {
+  auto& queue = *queues_[worker_id];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.chains.empty()) {
+    return false;
+  }
+  *idx = queue.chains.back();
+  queue.chains.pop_back();
+  --num_queued_;
+  return true;
+}
+
+bool DAGWSNet::Steal(int worker_id, int* idx) {
+  const int num_queues = queues_.size();
+  for (int i = 1; i < num_queues; ++i) {
+    auto& queue = *queues_[(worker_id + i) % num_queues];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.chains.empty()) {
+      *idx = queue.chains.front();
+      queue.chains.pop_front();
+      --num_queued_;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool DAGWSNet::NextChain(int worker_id, int* idx) {
+  while (!stop_) {
+    if (PopLocal(worker_id, idx) || Steal(worker_id, idx)) {
+      return true;
+    }
+    std::unique_lock<std::mutex> lock(wakeup_mutex_);
+    ++num_sleeping_;
+    wakeup_cv_.wait(lock, [this]() { return stop_ || num_queued_ > 0; });
+    --num_sleeping_;
+  }
+  return false;
+}
+
+void DAGWSNet::WorkerFunction(int worker_id) {
+  NUMABind(numa_node_id_);
+  int idx = 0;
+  while (NextChain(worker_id, &idx)) {
+    VLOG(1) << "Worker #" << worker_id << " running operator #" << idx << " "
+            << operator_nodes_[idx].operator_->debug_def().name() << "("
+            << operator_nodes_[idx].operator_->debug_def().type() << ").";
+    CAFFE_ENFORCE(
+        execution_chains_.find(idx) != execution_chains_.end(),
+        "Can't find chain ",
+        idx,
+        ".");
+    const auto& chain = execution_chains_[idx];
+    bool this_success = RunAt(chain);
+    if (!this_success) {
+      LOG_IF(ERROR, !IsCancelled())
+          << "Operator chain failed: "
+          << ProtoDebugString(operator_nodes_[idx].operator_->debug_def());
+      std::lock_guard<std::mutex> mutex_lock(remaining_ops_mutex_);
+      failed_ = true;
+      cv_.notify_one();
+      return;
+    }
+
+    // Newly ready chains go to the back of our own deque so that they are the
+    // next ones we pick up.
+    for (const auto op_idx : chain) {
+      for (const auto child : operator_nodes_[op_idx].children_) {
+        const int count = --operator_nodes_[child].runtime_parent_count_;
+        CAFFE_ENFORCE(
+            count >= 0,
+            "Found runtime parent count smaller than zero for ",
+            "operator node ",
+            operator_nodes_[child].operator_->debug_def().name(),
+            "(",
+            operator_nodes_[child].operator_->debug_def().type(),
+            ").");
+        if (count == 0 && operator_nodes_[child].is_chain_start_) {
+          VLOG(2) << "Pushing chain #" << child << " to worker #" << worker_id;
+          PushChain(worker_id, child);
+        }
+      }
+    }
+
+    // Only the last chain of a run needs to wake up the caller.
+    if ((pending_ops_ -= chain.size()) == 0) {
+      std::lock_guard<std::mutex> mutex_lock(remaining_ops_mutex_);
+      cv_.notify_one();
+    }
+    VLOG(2) << "Finished executing operator #" << idx;
+  }
+}
+
+REGISTER_NET(dag_ws, DAGWSNet);
+
+} // namespace caffe2
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_NET_DAG_WS_H_
+#define CAFFE2_CORE_NET_DAG_WS_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net_dag.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+// A DAG net that schedules execution chains with work stealing instead of a
+// single shared job queue. Every worker owns a deque of ready chains: it pushes
+// the chains that become ready after running one of its own chains to the back
+// of its deque and pops from the back as well, so that the children of a chain
+// tend to run on the same thread while the data they read is still in cache.
+// Idle workers steal from the front of the other workers' deques. The chain
+// computation, observers and benchmarking are shared with DAGNet.
+class DAGWSNet : public DAGNet {
+ public:
+  DAGWSNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws);
+  ~DAGWSNet() override;
+  bool RunAsync() override;
+
+ protected:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<int> chains;
+  };
+
+  void WorkerFunction(int worker_id);
+  // Blocks until a chain is available for the given worker, trying the
+  // worker's own deque first and then stealing from the others. Returns false
+  // once the workers are asked to stop.
+  bool NextChain(int worker_id, int* idx);
+  bool PopLocal(int worker_id, int* idx);
+  bool Steal(int worker_id, int* idx);
+  void PushChain(int worker_id, int idx);
+  void StopWorkers();
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  // Number of chains sitting in the per-worker deques.
+  std::atomic<int> num_queued_;
+  // Number of workers blocked in NextChain() waiting for new chains.
+  std::atomic<int> num_sleeping_;
+  std::atomic<int> pending_ops_;
+  std::atomic<bool> failed_;
+  std::atomic<bool> stop_;
+  std::mutex wakeup_mutex_;
+  std::condition_variable wakeup_cv_;
+
+  DISABLE_COPY_AND_ASSIGN(DAGWSNet);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_NET_DAG_WS_H_
@@ -0,0 +1,432 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/net_pipeline.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "caffe2/core/numa.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+bool SameDevice(const DeviceOption& a, const DeviceOption& b) {
+  return a.device_type() == b.device_type() &&
+      (a.device_type() != CUDA || a.cuda_gpu_id() == b.cuda_gpu_id()) &&
+      a.numa_node_id() == b.numa_node_id();
+}
+
+bool IsDifferentGPU(const DeviceOption& a, const DeviceOption& b) {
+  return a.device_type() == CUDA && b.device_type() == CUDA &&
+      a.cuda_gpu_id() != b.cuda_gpu_id();
+}
+
+// Operators that move blobs between devices themselves, and so read blobs
+// of other devices.
+bool IsCopy(const OperatorDef& op) {
+  static const std::unordered_set<string> kCopyOps = {"Copy",
+                                                      "CopyCPUToGPU",
+                                                      "CopyGPUToCPU",
+                                                      "CopyFromCPUInput",
+                                                      "EnsureCPUOutput"};
+  return kCopyOps.count(op.type());
+}
+
+// The device the outputs of an operator are on.
+DeviceOption OutputDevice(const OperatorDef& op, const DeviceOption& device) {
+  if (op.type() == "CopyGPUToCPU" || op.type() == "EnsureCPUOutput") {
+    return DeviceOption();
+  }
+  return device;
+}
+
+OperatorDef WithDevice(OperatorDef op, const DeviceOption& device) {
+  if (device.has_device_type()) {
+    op.mutable_device_option()->CopyFrom(device);
+  }
+  return op;
+}
+
+} // namespace
+
+string MicroBatchBlobName(const string& name, int micro_batch) {
+  return name + "__micro_batch_" + caffe2::to_string(micro_batch);
+}
+
+PipelinePlan PlanPipeline(const NetDef& net_def) {
+  ArgumentHelper args(net_def);
+  PipelinePlan plan;
+  plan.num_micro_batches = args.GetSingleArgument<int>("num_micro_batches", 1);
+  CAFFE_ENFORCE_GE(plan.num_micro_batches, 1);
+  const auto micro_batch_inputs =
+      args.GetRepeatedArgument<string>("micro_batch_inputs");
+  const auto micro_batch_outputs =
+      args.GetRepeatedArgument<string>("micro_batch_outputs");
+  const auto accumulated_outputs =
+      args.GetRepeatedArgument<string>("accumulated_outputs");
+  auto stage_starts = args.GetRepeatedArgument<int>("stage_starts");
+
+  const int num_ops = net_def.op_size();
+  vector<DeviceOption> devices;
+  for (const auto& op : net_def.op()) {
+    devices.push_back(
+        op.has_device_option() ? op.device_option() : net_def.device_option());
+  }
+  if (stage_starts.empty()) {
+    for (int i = 1; i < num_ops; ++i) {
+      if (!SameDevice(devices[i - 1], devices[i])) {
+        stage_starts.push_back(i);
+      }
+    }
+  }
+  for (int i = 0; i < stage_starts.size(); ++i) {
+    CAFFE_ENFORCE(
+        stage_starts[i] > (i ? stage_starts[i - 1] : 0) &&
+            stage_starts[i] < num_ops,
+        "stage_starts must be increasing operator indices, without 0.");
+  }
+  stage_starts.push_back(num_ops);
+
+  std::unordered_set<string> written;
+  std::unordered_map<string, DeviceOption> writer_devices;
+  for (int i = 0; i < num_ops; ++i) {
+    for (const auto& output : net_def.op(i).output()) {
+      written.insert(output);
+      writer_devices[output] = OutputDevice(net_def.op(i), devices[i]);
+    }
+  }
+  for (const auto& name : micro_batch_outputs) {
+    CAFFE_ENFORCE(written.count(name), "No operator writes ", name);
+  }
+  for (const auto& name : accumulated_outputs) {
+    CAFFE_ENFORCE(written.count(name), "No operator writes ", name);
+  }
+
+  // The device of the last writer of every blob so far. The micro-batches
+  // of an input are on the device of its first reader, which splits it.
+  std::unordered_map<string, DeviceOption> blob_devices;
+  for (const auto& name : micro_batch_inputs) {
+    DeviceOption device = net_def.device_option();
+    for (int i = 0; i < num_ops && !device.has_device_type(); ++i) {
+      const auto& inputs = net_def.op(i).input();
+      if (std::find(inputs.begin(), inputs.end(), name) != inputs.end()) {
+        device = devices[i];
+      }
+    }
+    vector<string> splits;
+    for (int m = 0; m < plan.num_micro_batches; ++m) {
+      splits.push_back(MicroBatchBlobName(name, m));
+    }
+    plan.prologue.push_back(WithDevice(
+        CreateOperatorDef(
+            "Split", "", {name}, splits, {MakeArgument<int>("axis", 0)}),
+        device));
+    blob_devices[name] = device;
+  }
+
+  // Splits the operators into stages, and makes every stage read the blobs
+  // it reads from other GPUs from copies on its own.
+  int copies = 0;
+  for (int s = 0; s < stage_starts.size(); ++s) {
+    const int begin = s ? stage_starts[s - 1] : 0;
+    const int end = stage_starts[s];
+    vector<OperatorDef> copy_ops;
+    vector<OperatorDef> ops;
+    std::unordered_map<string, string> copied;
+    std::unordered_set<string> written_in_stage;
+    for (int i = begin; i < end; ++i) {
+      OperatorDef op = net_def.op(i);
+      if (!IsCopy(op)) {
+        for (int j = 0; j < op.input_size(); ++j) {
+          const string& name = op.input(j);
+          auto it = blob_devices.find(name);
+          if (written_in_stage.count(name) || it == blob_devices.end() ||
+              !IsDifferentGPU(it->second, devices[i])) {
+            continue;
+          }
+          const string key =
+              name + "@" + caffe2::to_string(devices[i].cuda_gpu_id());
+          auto& copy = copied[key];
+          if (copy.empty()) {
+            copy = name + "__pipeline_copy_" + caffe2::to_string(copies++);
+            copy_ops.push_back(WithDevice(
+                CreateOperatorDef("Copy", "", {name}, {copy}), devices[i]));
+          }
+          op.set_input(j, copy);
+        }
+      }
+      for (const auto& output : op.output()) {
+        written_in_stage.insert(output);
+      }
+      ops.push_back(std::move(op));
+    }
+    for (int i = begin; i < end; ++i) {
+      for (const auto& output : net_def.op(i).output()) {
+        blob_devices[output] = OutputDevice(net_def.op(i), devices[i]);
+      }
+    }
+    for (const auto& copy_op : copy_ops) {
+      written.insert(copy_op.output(0));
+    }
+    copy_ops.insert(copy_ops.end(), ops.begin(), ops.end());
+    plan.stages.push_back(std::move(copy_ops));
+  }
+
+  const float scale = 1.0f / plan.num_micro_batches;
+  for (const auto& name : micro_batch_outputs) {
+    vector<string> inputs;
+    for (int m = 0; m < plan.num_micro_batches; ++m) {
+      inputs.push_back(MicroBatchBlobName(name, m));
+    }
+    plan.epilogue.push_back(WithDevice(
+        CreateOperatorDef(
+            "Concat",
+            "",
+            inputs,
+            vector<string>{name, name + "__micro_batch_split"},
+            {MakeArgument<int>("axis", 0)}),
+        writer_devices[name]));
+  }
+  for (const auto& name : accumulated_outputs) {
+    vector<string> inputs;
+    for (int m = 0; m < plan.num_micro_batches; ++m) {
+      inputs.push_back(MicroBatchBlobName(name, m));
+    }
+    const auto& device = writer_devices[name];
+    plan.epilogue.push_back(
+        WithDevice(CreateOperatorDef("Sum", "", inputs, {name}), device));
+    if (plan.num_micro_batches > 1) {
+      plan.epilogue.push_back(WithDevice(
+          CreateOperatorDef(
+              "Scale", "", {name}, {name}, {MakeArgument("scale", scale)}),
+          device));
+    }
+  }
+
+  plan.micro_batch_blobs = micro_batch_inputs;
+  plan.micro_batch_blobs.insert(
+      plan.micro_batch_blobs.end(),
+      micro_batch_outputs.begin(),
+      micro_batch_outputs.end());
+  plan.micro_batch_blobs.insert(
+      plan.micro_batch_blobs.end(),
+      accumulated_outputs.begin(),
+      accumulated_outputs.end());
+  std::unordered_set<string> micro_batch_blobs(
+      plan.micro_batch_blobs.begin(), plan.micro_batch_blobs.end());
+  std::unordered_set<string> shared_blobs;
+  for (const auto& stage : plan.stages) {
+    for (const auto& op : stage) {
+      for (const auto& input : op.input()) {
+        if (!written.count(input) && !micro_batch_blobs.count(input) &&
+            shared_blobs.insert(input).second) {
+          plan.shared_blobs.push_back(input);
+        }
+      }
+    }
+  }
+  return plan;
+}
+
+PipelineNet::PipelineNet(
+    const std::shared_ptr<const NetDef>& net_def,
+    Workspace* ws)
+    : NetBase(net_def, ws), plan_(PlanPipeline(*net_def)) {
+  const int num_micro_batches = plan_.num_micro_batches;
+  for (const auto& op_def : plan_.prologue) {
+    prologue_.push_back(CreateOperator(op_def, ws));
+  }
+  std::unordered_map<string, string> shared;
+  for (const auto& name : plan_.shared_blobs) {
+    CAFFE_ENFORCE(
+        ws->HasBlob(name),
+        "Blob ",
+        name,
+        " is read by net ",
+        net_def->name(),
+        " but neither written by it nor in the workspace.");
+    shared[name] = name;
+  }
+  for (int m = 0; m < num_micro_batches; ++m) {
+    auto forwarded = shared;
+    for (const auto& name : plan_.micro_batch_blobs) {
+      forwarded[name] = MicroBatchBlobName(name, m);
+      ws->CreateBlob(forwarded[name]);
+    }
+    micro_batch_workspaces_.emplace_back(new Workspace(ws, forwarded));
+    auto* micro_batch_ws = micro_batch_workspaces_.back().get();
+    operators_.emplace_back();
+    int net_position = 0;
+    for (const auto& stage : plan_.stages) {
+      operators_.back().emplace_back();
+      for (const auto& op_def : stage) {
+        operators_.back().back().push_back(CreateOperator(
+            op_def.has_device_option() || !net_def->has_device_option()
+                ? op_def
+                : WithDevice(op_def, net_def->device_option()),
+            micro_batch_ws,
+            net_position++));
+      }
+    }
+  }
+  for (const auto& op_def : plan_.epilogue) {
+    epilogue_.push_back(CreateOperator(op_def, ws));
+  }
+
+  done_.resize(plan_.stages.size());
+  for (int s = 0; s < plan_.stages.size(); ++s) {
+    workers_.emplace_back(&PipelineNet::StageWorker, this, s);
+  }
+  VLOG(1) << "Pipeline net " << name_ << " has " << plan_.stages.size()
+          << " stages and " << num_micro_batches << " micro-batches.";
+}
+
+PipelineNet::~PipelineNet() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+vector<OperatorBase*> PipelineNet::GetOperators() const {
+  vector<OperatorBase*> op_list;
+  for (const auto& op : prologue_) {
+    op_list.push_back(op.get());
+  }
+  for (const auto& micro_batch : operators_) {
+    for (const auto& stage : micro_batch) {
+      for (const auto& op : stage) {
+        op_list.push_back(op.get());
+      }
+    }
+  }
+  for (const auto& op : epilogue_) {
+    op_list.push_back(op.get());
+  }
+  return op_list;
+}
+
+bool PipelineNet::RunAsync() {
+  std::lock_guard<std::mutex> run_lock(run_in_progress_);
+  StartAllObservers();
+  for (const auto& op : prologue_) {
+    if (IsCancelled() || !op->Run()) {
+      return false;
+    }
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::fill(done_.begin(), done_.end(), 0);
+    num_finished_stages_ = 0;
+    failed_ = false;
+    ++run_id_;
+    cv_.notify_all();
+    cv_.wait(lock, [this]() { return num_finished_stages_ == done_.size(); });
+    if (failed_) {
+      return false;
+    }
+  }
+  for (const auto& op : epilogue_) {
+    if (IsCancelled() || !op->Run()) {
+      return false;
+    }
+  }
+  StopAllObservers();
+  return true;
+}
+
+void PipelineNet::StageWorker(int stage) {
+  const auto& ops = operators_[0][stage];
+  if (!ops.empty()) {
+    NUMABind(ops[0]->device_option().numa_node_id());
+  }
+  int run_id = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this, run_id]() { return stop_ || run_id_ != run_id; });
+      if (stop_) {
+        return;
+      }
+      run_id = run_id_;
+    }
+    for (int m = 0; m < plan_.num_micro_batches; ++m) {
+      {
+        // The micro-batch has to be through the stage before, and the
+        // stage through the micro-batch before, which it is by now.
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this, stage, m]() {
+          return failed_ || stage == 0 || done_[stage - 1] > m;
+        });
+        if (failed_) {
+          break;
+        }
+      }
+      const bool success = RunStage(stage, m);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (success) {
+          done_[stage] = m + 1;
+        } else {
+          failed_ = true;
+        }
+      }
+      cv_.notify_all();
+      if (!success) {
+        break;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++num_finished_stages_;
+    }
+    cv_.notify_all();
+  }
+}
+
+bool PipelineNet::RunStage(int stage, int micro_batch) {
+  try {
+    for (const auto& op : operators_[micro_batch][stage]) {
+      if (IsCancelled()) {
+        return false;
+      }
+      if (!op->Run()) {
+        LOG(ERROR) << "Operator failed in stage " << stage
+                   << " of micro-batch " << micro_batch << ": "
+                   << ProtoDebugString(op->debug_def());
+        return false;
+      }
+    }
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Exception in stage " << stage << " of micro-batch "
+               << micro_batch << ": " << e.what();
+    return false;
+  }
+  return true;
+}
+
+REGISTER_NET(pipeline, PipelineNet);
+
+} // namespace caffe2
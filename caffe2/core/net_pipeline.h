@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_NET_PIPELINE_H_
+#define CAFFE2_CORE_NET_PIPELINE_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * How a net is run as a pipeline, see PipelineNet.
+ */
+struct PipelinePlan {
+  int num_micro_batches = 1;
+  // The operators of every stage, starting with the copies of the blobs the
+  // stage reads from other GPUs.
+  vector<vector<OperatorDef>> stages;
+  // Splits the micro_batch_inputs into micro-batches, before the stages run.
+  vector<OperatorDef> prologue;
+  // Concatenates the micro_batch_outputs and averages the
+  // accumulated_outputs of the micro-batches, after the stages ran.
+  vector<OperatorDef> epilogue;
+  // The blobs every micro-batch has a blob of its own for in the workspace
+  // of the net, see MicroBatchBlobName.
+  vector<string> micro_batch_blobs;
+  // The blobs the operators read from the workspace of the net as they are,
+  // e.g. the parameters.
+  vector<string> shared_blobs;
+};
+
+// The blob of the workspace of the net that holds the given blob of a
+// micro-batch.
+string MicroBatchBlobName(const string& name, int micro_batch);
+
+PipelinePlan PlanPipeline(const NetDef& net_def);
+
+/**
+ * A net that runs its operators as a pipeline over devices, for models that
+ * do not fit on a single device.
+ *
+ * The operators are split into stages: a new stage starts at every operator
+ * whose device (GPU, or NUMA node) is not the one of the operator before it,
+ * or at the operators given by the stage_starts argument. Every stage runs on
+ * a thread of its own, and so on CUDA streams of its own. A run splits the
+ * micro_batch_inputs along their first dimension into num_micro_batches
+ * micro-batches, which go through the stages in order: while a stage runs a
+ * micro-batch, the stage before it runs the next one. For example, the
+ * forward pass of a micro-batch on a GPU overlaps the backward pass of the
+ * micro-batch before it on the same GPU, as they are different stages.
+ *
+ * Every micro-batch has a workspace of its own for the blobs the operators
+ * write, and reads the other blobs, e.g. the parameters, from the workspace of
+ * the net. So the operators must not update blobs shared by the micro-batches,
+ * e.g. with optimizers; instead, the micro_batch_outputs of the micro-batches
+ * are concatenated, and their accumulated_outputs (e.g. the gradients of the
+ * parameters, or the loss) averaged, into the workspace of the net once all
+ * micro-batches are done. A stage that reads a blob last written on another
+ * GPU reads a copy of it, made at the start of the stage.
+ */
+class PipelineNet : public NetBase {
+ public:
+  PipelineNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws);
+  ~PipelineNet() override;
+
+  bool SupportsAsync() override {
+    return false;
+  }
+
+  bool RunAsync() override;
+
+  vector<OperatorBase*> GetOperators() const override;
+
+  int num_stages() const {
+    return plan_.stages.size();
+  }
+
+ private:
+  void StageWorker(int stage);
+  bool RunStage(int stage, int micro_batch);
+
+  PipelinePlan plan_;
+  vector<unique_ptr<OperatorBase>> prologue_;
+  vector<unique_ptr<OperatorBase>> epilogue_;
+  vector<unique_ptr<Workspace>> micro_batch_workspaces_;
+  // The operators of every stage, for every micro-batch.
+  vector<vector<vector<unique_ptr<OperatorBase>>>> operators_;
+  vector<std::thread> workers_;
+
+  std::mutex run_in_progress_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  // Incremented by every run, which starts the workers.
+  int run_id_ = 0;
+  // The number of micro-batches every stage is done with in the current run.
+  vector<int> done_;
+  int num_finished_stages_ = 0;
+  bool failed_ = false;
+  bool stop_ = false;
+
+  DISABLE_COPY_AND_ASSIGN(PipelineNet);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_NET_PIPELINE_H_
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/net.h"
+#include "caffe2/core/net_pipeline.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+OperatorDef GPUOp(
+    const string& type,
+    const vector<string>& inputs,
+    const vector<string>& outputs,
+    int gpu_id) {
+  auto op = CreateOperatorDef(type, "", inputs, outputs);
+  op.mutable_device_option()->set_device_type(CUDA);
+  op.mutable_device_option()->set_cuda_gpu_id(gpu_id);
+  return op;
+}
+
+vector<string> Inputs(const OperatorDef& op) {
+  return vector<string>(op.input().begin(), op.input().end());
+}
+
+vector<string> Outputs(const OperatorDef& op) {
+  return vector<string>(op.output().begin(), op.output().end());
+}
+
+void FillCPU(Workspace* ws, const string& name, const vector<float>& values) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(values.size(), 1);
+  std::copy(values.begin(), values.end(), tensor->mutable_data<float>());
+}
+
+} // namespace
+
+TEST(PipelineNetTest, PlanSplitsStagesByGPU) {
+  NetDef net_def;
+  net_def.add_op()->CopyFrom(GPUOp("FC", {"X", "W0", "b0"}, {"H"}, 0));
+  net_def.add_op()->CopyFrom(GPUOp("Relu", {"H"}, {"H"}, 0));
+  net_def.add_op()->CopyFrom(GPUOp("FC", {"H", "W1", "b1"}, {"Y"}, 1));
+  net_def.add_op()->CopyFrom(GPUOp("Relu", {"Y"}, {"Y"}, 1));
+  net_def.add_op()->CopyFrom(GPUOp("Add", {"Y", "H"}, {"Z"}, 1));
+  net_def.add_op()->CopyFrom(GPUOp("Sum", {"Z", "H"}, {"L"}, 0));
+  net_def.add_arg()->CopyFrom(MakeArgument<int>("num_micro_batches", 2));
+  net_def.add_arg()->CopyFrom(
+      MakeArgument<vector<string>>("micro_batch_inputs", {"X"}));
+  net_def.add_arg()->CopyFrom(
+      MakeArgument<vector<string>>("micro_batch_outputs", {"Z"}));
+  net_def.add_arg()->CopyFrom(
+      MakeArgument<vector<string>>("accumulated_outputs", {"L"}));
+
+  const auto plan = PlanPipeline(net_def);
+  EXPECT_EQ(2, plan.num_micro_batches);
+  ASSERT_EQ(3, plan.stages.size());
+  EXPECT_EQ(2, plan.stages[0].size());
+
+  // The second stage reads H from a copy, once.
+  const auto& stage = plan.stages[1];
+  ASSERT_EQ(4, stage.size());
+  EXPECT_EQ("Copy", stage[0].type());
+  EXPECT_EQ(vector<string>{"H"}, Inputs(stage[0]));
+  EXPECT_EQ(1, stage[0].device_option().cuda_gpu_id());
+  const string copy = stage[0].output(0);
+  EXPECT_EQ((vector<string>{copy, "W1", "b1"}), Inputs(stage[1]));
+  EXPECT_EQ((vector<string>{"Y", copy}), Inputs(stage[3]));
+
+  // The third stage is back on the GPU H is on, but not Z.
+  ASSERT_EQ(2, plan.stages[2].size());
+  EXPECT_EQ("Copy", plan.stages[2][0].type());
+  EXPECT_EQ(vector<string>{"Z"}, Inputs(plan.stages[2][0]));
+  EXPECT_EQ(0, plan.stages[2][0].device_option().cuda_gpu_id());
+  EXPECT_EQ(
+      (vector<string>{plan.stages[2][0].output(0), "H"}),
+      Inputs(plan.stages[2][1]));
+
+  ASSERT_EQ(1, plan.prologue.size());
+  EXPECT_EQ("Split", plan.prologue[0].type());
+  EXPECT_EQ(
+      (vector<string>{MicroBatchBlobName("X", 0), MicroBatchBlobName("X", 1)}),
+      Outputs(plan.prologue[0]));
+  EXPECT_EQ(0, plan.prologue[0].device_option().cuda_gpu_id());
+
+  ASSERT_EQ(3, plan.epilogue.size());
+  EXPECT_EQ("Concat", plan.epilogue[0].type());
+  EXPECT_EQ("Z", plan.epilogue[0].output(0));
+  EXPECT_EQ(1, plan.epilogue[0].device_option().cuda_gpu_id());
+  EXPECT_EQ("Sum", plan.epilogue[1].type());
+  EXPECT_EQ("Scale", plan.epilogue[2].type());
+  EXPECT_EQ(0, plan.epilogue[2].device_option().cuda_gpu_id());
+
+  EXPECT_EQ(
+      (vector<string>{"W0", "b0", "W1", "b1"}),
+      plan.shared_blobs);
+}
+
+TEST(PipelineNetTest, PlanChecksStageStarts) {
+  NetDef net_def;
+  net_def.add_op()->CopyFrom(CreateOperatorDef("Relu", "", {"X"}, {"Y"}));
+  net_def.add_op()->CopyFrom(CreateOperatorDef("Relu", "", {"Y"}, {"Z"}));
+  net_def.add_arg()->CopyFrom(
+      MakeArgument<vector<int>>("stage_starts", {2}));
+  EXPECT_THROW(PlanPipeline(net_def), EnforceNotMet);
+}
+
+TEST(PipelineNetTest, RunsMicroBatchesThroughStages) {
+  Workspace ws;
+  const int batch_size = 8;
+  vector<float> x(batch_size);
+  for (int i = 0; i < batch_size; ++i) {
+    x[i] = i;
+  }
+  FillCPU(&ws, "X", x);
+
+  NetDef net_def;
+  net_def.set_name("pipeline_test");
+  net_def.set_type("pipeline");
+  net_def.add_op()->CopyFrom(CreateOperatorDef(
+      "Scale", "", {"X"}, {"H"}, {MakeArgument<float>("scale", 2.0f)}));
+  net_def.add_op()->CopyFrom(CreateOperatorDef("Sum", "", {"H", "H"}, {"Y"}));
+  net_def.add_op()->CopyFrom(
+      CreateOperatorDef("SumElements", "", {"Y"}, {"loss"}));
+  net_def.add_arg()->CopyFrom(MakeArgument<int>("num_micro_batches", 4));
+  net_def.add_arg()->CopyFrom(MakeArgument<vector<int>>("stage_starts", {1}));
+  net_def.add_arg()->CopyFrom(
+      MakeArgument<vector<string>>("micro_batch_inputs", {"X"}));
+  net_def.add_arg()->CopyFrom(
+      MakeArgument<vector<string>>("micro_batch_outputs", {"Y"}));
+  net_def.add_arg()->CopyFrom(
+      MakeArgument<vector<string>>("accumulated_outputs", {"loss"}));
+
+  auto net = CreateNet(net_def, &ws);
+  ASSERT_TRUE(net != nullptr);
+  EXPECT_EQ(2, dynamic_cast<PipelineNet*>(net.get())->num_stages());
+  // The blobs the micro-batches write stay in their own workspaces.
+  EXPECT_FALSE(ws.HasBlob("H"));
+
+  for (int run = 0; run < 3; ++run) {
+    ASSERT_TRUE(net->Run());
+    const auto& y = ws.GetBlob("Y")->Get<TensorCPU>();
+    ASSERT_EQ(batch_size, y.dim(0));
+    float sum = 0;
+    for (int i = 0; i < batch_size; ++i) {
+      EXPECT_EQ(4 * x[i], y.data<float>()[i]);
+      sum += 4 * x[i];
+    }
+    const auto& loss = ws.GetBlob("loss")->Get<TensorCPU>();
+    EXPECT_FLOAT_EQ(sum / 4, loss.data<float>()[0]);
+  }
+}
+
+TEST(PipelineNetTest, MissingSharedBlobFails) {
+  Workspace ws;
+  NetDef net_def;
+  net_def.set_type("pipeline");
+  net_def.add_op()->CopyFrom(CreateOperatorDef("Sum", "", {"X", "W"}, {"Y"}));
+  net_def.add_arg()->CopyFrom(
+      MakeArgument<vector<string>>("micro_batch_inputs", {"X"}));
+  FillCPU(&ws, "X", {1});
+  EXPECT_THROW(CreateNet(net_def, &ws), EnforceNotMet);
+}
+
+} // namespace caffe2
@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/net_shape_inference.h"
+
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+NetShapeInference::NetShapeInference(const NetDef& net, size_t max_entries)
+    : max_entries_(max_entries) {
+  CAFFE_ENFORCE_GT(max_entries, 0);
+  nets_.emplace_back(new NetDef(net));
+}
+
+std::shared_ptr<const NetShapeInference::BlobShapes> NetShapeInference::Infer(
+    const InputShapes& input_shapes) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = cache_.begin(); it != cache_.end(); ++it) {
+      if (it->first == input_shapes) {
+        cache_.splice(cache_.begin(), cache_, it);
+        return cache_.front().second;
+      }
+    }
+  }
+
+  const TensorShapes shapes =
+      InferBlobShapesAndTypesFromMap(input_shapes, nets_);
+  ++num_inferences_;
+  auto result = std::make_shared<BlobShapes>();
+  for (const auto& shape : shapes.shapes()) {
+    (*result)[shape.name()] = shape;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_.emplace_front(input_shapes, result);
+  if (cache_.size() > max_entries_) {
+    cache_.pop_back();
+  }
+  return result;
+}
+
+} // namespace caffe2
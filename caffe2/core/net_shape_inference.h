@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_NET_SHAPE_INFERENCE_H_
+#define CAFFE2_CORE_NET_SHAPE_INFERENCE_H_
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+// Whole-net shape and type inference with a cache keyed by input shapes.
+//
+// Propagates the shapes of the given blobs through the operator schemas of a
+// fixed net, like InferBlobShapesAndTypesFromMap. The results for each
+// distinct set of input shapes are kept, up to `max_entries` of them with the
+// least recently used dropped first, so that a net seeing a few recurring
+// input shapes, such as a handful of batch sizes, only runs the inference
+// once per shape. Safe to call from several threads.
+class NetShapeInference {
+ public:
+  using InputShapes = CaffeMap<string, vector<TIndex>>;
+  // Inferred shape and type of every blob the schemas could infer, including
+  // the inputs.
+  using BlobShapes = CaffeMap<string, TensorShape>;
+
+  explicit NetShapeInference(const NetDef& net, size_t max_entries = 8);
+
+  // Returns the shapes for `input_shapes`, which should cover all external
+  // inputs of the net, parameters included. Blobs whose shape cannot be
+  // inferred are missing from the result.
+  std::shared_ptr<const BlobShapes> Infer(const InputShapes& input_shapes);
+
+  // Number of times the inference actually ran, i.e. the cache misses.
+  size_t num_inferences() const {
+    return num_inferences_;
+  }
+
+ private:
+  vector<std::unique_ptr<NetDef>> nets_;
+  const size_t max_entries_;
+  std::mutex mutex_;
+  // Most recently used first.
+  std::list<std::pair<InputShapes, std::shared_ptr<const BlobShapes>>> cache_;
+  std::atomic<size_t> num_inferences_{0};
+
+  DISABLE_COPY_AND_ASSIGN(NetShapeInference);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_NET_SHAPE_INFERENCE_H_
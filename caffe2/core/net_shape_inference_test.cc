@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/net.h"
+#include "caffe2/core/net_shape_inference.h"
+#include "caffe2/core/net_simple.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Doubles the first dimension of its input. Records whether its output was
+// already allocated with the right shape when it started.
+class ShapeInferenceTestOp final : public Operator<CPUContext> {
+ public:
+  ShapeInferenceTestOp(const OperatorDef& def, Workspace* ws)
+      : Operator<CPUContext>(def, ws) {}
+
+  bool RunOnDevice() override {
+    auto dims = Input(0).dims();
+    dims[0] *= 2;
+    auto* output = Output(0);
+    preallocated = output->dims() == dims && output->IsType<float>() &&
+        output->raw_data() != nullptr;
+    output->Resize(dims);
+    output->mutable_data<float>();
+    return true;
+  }
+
+  static bool preallocated;
+};
+
+bool ShapeInferenceTestOp::preallocated = false;
+
+REGISTER_CPU_OPERATOR(ShapeInferenceTest, ShapeInferenceTestOp);
+OPERATOR_SCHEMA(ShapeInferenceTest)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .TensorInferenceFunction(
+        [](const OperatorDef&, const vector<TensorShape>& in) {
+          vector<TensorShape> out(1, in[0]);
+          out[0].set_dims(0, in[0].dims(0) * 2);
+          out[0].set_data_type(TensorProto::FLOAT);
+          return out;
+        });
+
+NetDef CreateNetDef() {
+  NetDef net_def;
+  net_def.add_external_input("in");
+  net_def.add_external_output("out");
+  auto* op = net_def.add_op();
+  op->set_type("ShapeInferenceTest");
+  op->add_input("in");
+  op->add_output("hidden");
+  op = net_def.add_op();
+  op->set_type("ShapeInferenceTest");
+  op->add_input("hidden");
+  op->add_output("out");
+  return net_def;
+}
+} // namespace
+
+TEST(NetShapeInferenceTest, CachesPerInputShapes) {
+  NetShapeInference inference(CreateNetDef(), 2);
+  auto shapes = inference.Infer({{"in", {3, 5}}});
+  EXPECT_EQ(GetDimsVector(shapes->at("hidden")), (vector<TIndex>{6, 5}));
+  EXPECT_EQ(GetDimsVector(shapes->at("out")), (vector<TIndex>{12, 5}));
+  EXPECT_EQ(inference.Infer({{"in", {3, 5}}}), shapes);
+  EXPECT_EQ(inference.num_inferences(), 1);
+
+  inference.Infer({{"in", {4, 5}}});
+  EXPECT_EQ(inference.num_inferences(), 2);
+  EXPECT_EQ(inference.Infer({{"in", {3, 5}}}), shapes);
+  EXPECT_EQ(inference.num_inferences(), 2);
+  // Pushes out the least recently used entry, {4, 5}.
+  inference.Infer({{"in", {1, 5}}});
+  inference.Infer({{"in", {3, 5}}});
+  EXPECT_EQ(inference.num_inferences(), 3);
+  inference.Infer({{"in", {4, 5}}});
+  EXPECT_EQ(inference.num_inferences(), 4);
+}
+
+TEST(NetShapeInferenceTest, SimpleNetPreallocatesInferredOutputs) {
+  NetDef net_def = CreateNetDef();
+  auto* arg = net_def.add_arg();
+  arg->set_name("compiled_plan");
+  arg->set_i(1);
+
+  Workspace ws;
+  auto* in = ws.CreateBlob("in")->GetMutable<TensorCPU>();
+  in->Resize(2, 3);
+  in->mutable_data<float>();
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  auto* simple_net = dynamic_cast<SimpleNet*>(net.get());
+  ASSERT_TRUE(simple_net != nullptr);
+
+  // Even the first run goes through a plan, built from the inferred shapes.
+  ShapeInferenceTestOp::preallocated = false;
+  ASSERT_TRUE(net->Run());
+  EXPECT_TRUE(ShapeInferenceTestOp::preallocated);
+  EXPECT_TRUE(simple_net->HasCompiledPlan());
+  EXPECT_EQ(
+      ws.GetBlob("out")->Get<TensorCPU>().dims(), (vector<TIndex>{8, 3}));
+
+  in->Resize(5, 3);
+  in->mutable_data<float>();
+  ShapeInferenceTestOp::preallocated = false;
+  ASSERT_TRUE(net->Run());
+  EXPECT_TRUE(ShapeInferenceTestOp::preallocated);
+  EXPECT_EQ(
+      ws.GetBlob("out")->Get<TensorCPU>().dims(), (vector<TIndex>{20, 3}));
+}
+
+} // namespace caffe2
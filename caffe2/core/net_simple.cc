@@ -32,37 +32,58 @@ namespace caffe2 {
 SimpleNet::SimpleNet(
     const std::shared_ptr<const NetDef>& net_def,
     Workspace* ws)
-    : NetBase(net_def, ws) {
+    : NetBase(net_def, ws), ws_(ws) {
   VLOG(1) << "Constructing SimpleNet " << net_def->name();
-  const bool net_def_has_device_option = net_def->has_device_option();
-  // Initialize the operators
-  for (int idx = 0; idx < net_def->op_size(); ++idx) {
-    const auto& operator_def = net_def->op(idx);
-    VLOG(1) << "Creating operator " << operator_def.name() << ": "
-            << operator_def.type();
-    std::unique_ptr<OperatorBase> op{nullptr};
-    if (!operator_def.has_device_option() && net_def_has_device_option) {
-      // In the case that the operator def does not specify a device option but
-      // the net def has a default option, we copy the device option over to the
-      // operator def.
-      OperatorDef temp_def(operator_def);
-      temp_def.mutable_device_option()->CopyFrom(net_def->device_option());
-      op = CreateOperator(temp_def, ws, idx);
-    } else {
-      op = CreateOperator(operator_def, ws, idx);
-      op->set_debug_def(
-          std::shared_ptr<const OperatorDef>{net_def, &(net_def->op(idx))});
-    }
-    operators_.emplace_back(std::move(op));
+  operators_ = CreateOperators(net_def, ws);
+
+  ArgumentHelper arg_helper(*net_def);
+  compiled_plan_ = arg_helper.GetSingleArgument<bool>("compiled_plan", false);
+  if (compiled_plan_) {
+    for (const auto& op : operators_) {
+      if (op->device_option().device_type() != CPU) {
+        LOG(WARNING) << "Net " << net_def->name() << " has non-CPU operator "
+                     << op->debug_def().type()
+                     << ", ignoring the compiled_plan argument.";
+        compiled_plan_ = false;
+        break;
+      }
+    }
+  }
+  if (compiled_plan_) {
+    shape_inference_ = caffe2::make_unique<NetShapeInference>(*net_def);
   }
 }
 
 bool SimpleNet::RunAsync() {
   StartAllObservers();
+  bool res;
+  if (plan_valid_ && PlanMatchesInputs()) {
+    res = RunPlan();
+  } else if (compiled_plan_ && BuildPlanFromInference()) {
+    res = RunPlan();
+    if (res) {
+      BuildPlan();
+    }
+  } else {
+    res = RunOperators();
+    if (res && compiled_plan_) {
+      BuildPlan();
+    }
+  }
+  if (!res) {
+    return false;
+  }
+  StopAllObservers();
+  return true;
+}
 
+bool SimpleNet::RunOperators() {
   const auto& net_name = name_.c_str();
   VLOG(1) << "Running net " << name_;
   for (auto& op : operators_) {
+    if (IsCancelled()) {
+      return false;
+    }
     const auto& opdef = op->debug_def();
     const auto& op_ptr = op.get();
     const auto& op_name = opdef.name().c_str();
@@ -76,7 +97,151 @@ bool SimpleNet::RunAsync() {
       return false;
     }
   }
-  StopAllObservers();
+  return true;
+}
+
+bool SimpleNet::RunPlan() {
+  const auto& net_name = name_.c_str();
+  for (auto& step : plan_) {
+    if (IsCancelled()) {
+      return false;
+    }
+    for (int i = 0; i < step.outputs.size(); ++i) {
+      // The blobs themselves outlive the plan, but an earlier operator may
+      // have reset them to another type, so the type is checked every run.
+      Blob* blob = step.outputs[i];
+      if (blob->IsType<TensorCPU>() || blob->meta() == TypeMeta()) {
+        auto* tensor = blob->GetMutable<TensorCPU>();
+        if (tensor->dims() != step.output_dims[i]) {
+          tensor->Resize(step.output_dims[i]);
+        }
+        if (step.output_metas[i] != TypeMeta()) {
+          tensor->raw_mutable_data(step.output_metas[i]);
+        }
+      }
+    }
+    const auto& opdef = step.op->debug_def();
+    const auto& op_ptr = step.op;
+    const auto& op_name = opdef.name().c_str();
+    const auto& op_type = opdef.type().c_str();
+    CAFFE_SDT(operator_start, net_name, op_name, op_type, op_ptr);
+    bool res = step.op->Run();
+    CAFFE_SDT(operator_done, net_name, op_name, op_type, op_ptr);
+    if (!res) {
+      LOG(ERROR) << "Operator failed: " << ProtoDebugString(opdef);
+      // The operator may have left its outputs in any state.
+      plan_valid_ = false;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SimpleNet::PlanMatchesInputs() const {
+  for (int i = 0; i < plan_inputs_.size(); ++i) {
+    const auto* blob = plan_inputs_[i];
+    if (!blob->IsType<TensorCPU>() ||
+        blob->Get<TensorCPU>().dims() != plan_input_dims_[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SimpleNet::BuildPlan() {
+  plan_valid_ = false;
+  plan_inputs_.clear();
+  plan_input_dims_.clear();
+  plan_.clear();
+
+  std::set<const Blob*> external_inputs;
+  for (const auto& name : external_input_) {
+    const Blob* blob = ws_->GetBlob(name);
+    if (!blob) {
+      VLOG(1) << "External input " << name << " of net " << name_
+              << " does not exist, not compiling a plan.";
+      return;
+    }
+    external_inputs.insert(blob);
+    if (blob->IsType<TensorCPU>()) {
+      plan_inputs_.push_back(blob);
+      plan_input_dims_.push_back(blob->Get<TensorCPU>().dims());
+    }
+  }
+
+  for (auto& op : operators_) {
+    PlanStep step;
+    step.op = op.get();
+    const auto& inputs = op->Inputs();
+    const std::set<const Blob*> op_inputs(inputs.begin(), inputs.end());
+    for (Blob* blob : op->Outputs()) {
+      // Outputs that carry state across runs, either in-place outputs or
+      // external inputs of the net, must be left to the operator.
+      if (!blob->IsType<TensorCPU>() || op_inputs.count(blob) ||
+          external_inputs.count(blob)) {
+        continue;
+      }
+      step.outputs.push_back(blob);
+      step.output_dims.push_back(blob->Get<TensorCPU>().dims());
+      step.output_metas.push_back(blob->Get<TensorCPU>().meta());
+    }
+    plan_.push_back(std::move(step));
+  }
+  plan_valid_ = true;
+}
+
+bool SimpleNet::BuildPlanFromInference() {
+  plan_valid_ = false;
+  plan_inputs_.clear();
+  plan_input_dims_.clear();
+  plan_.clear();
+
+  std::set<const Blob*> external_inputs;
+  NetShapeInference::InputShapes input_shapes;
+  for (const auto& name : external_input_) {
+    const Blob* blob = ws_->GetBlob(name);
+    if (!blob) {
+      return false;
+    }
+    external_inputs.insert(blob);
+    if (blob->IsType<TensorCPU>()) {
+      plan_inputs_.push_back(blob);
+      plan_input_dims_.push_back(blob->Get<TensorCPU>().dims());
+      input_shapes[name] = plan_input_dims_.back();
+    }
+  }
+  std::shared_ptr<const NetShapeInference::BlobShapes> shapes;
+  try {
+    shapes = shape_inference_->Infer(input_shapes);
+  } catch (const EnforceNotMet& e) {
+    VLOG(1) << "Shape inference failed for net " << name_ << ": " << e.msg();
+    return false;
+  }
+
+  for (auto& op : operators_) {
+    PlanStep step;
+    step.op = op.get();
+    const auto& inputs = op->Inputs();
+    const std::set<const Blob*> op_inputs(inputs.begin(), inputs.end());
+    const auto& outputs = op->Outputs();
+    for (int i = 0; i < outputs.size(); ++i) {
+      Blob* blob = outputs[i];
+      if ((!blob->IsType<TensorCPU>() && blob->meta() != TypeMeta()) ||
+          op_inputs.count(blob) || external_inputs.count(blob)) {
+        continue;
+      }
+      auto it = shapes->find(op->debug_def().output(i));
+      if (it == shapes->end() || it->second.unknown_shape() ||
+          it->second.unknown_dims_size() > 0) {
+        continue;
+      }
+      step.outputs.push_back(blob);
+      step.output_dims.push_back(GetDimsVector(it->second));
+      step.output_metas.push_back(DataTypeToTypeMeta(it->second.data_type()));
+    }
+    plan_.push_back(std::move(step));
+  }
+  plan_valid_ = true;
   return true;
 }
 
@@ -119,6 +284,7 @@ vector<float> SimpleNet::TEST_Benchmark(
 
   vector<float> time_per_op(operators_.size(), 0);
   vector<uint64_t> flops_per_op(operators_.size(), 0);
+  vector<uint64_t> bytes_per_op(operators_.size(), 0);
   CaffeMap<string, float> time_per_op_type;
   if (run_individual) {
     for (int i = 0; i < main_runs; ++i) {
@@ -129,8 +295,9 @@ vector<float> SimpleNet::TEST_Benchmark(
           auto* schema = OpSchemaRegistry::Schema(op_type);
           if (schema && schema->HasCostInferenceFunction()) {
             vector<TensorShape> shapes = op->InputTensorShapes();
-            flops_per_op[idx] =
-                schema->InferCost(op->debug_def(), shapes).flops;
+            const auto cost = schema->InferCost(op->debug_def(), shapes);
+            flops_per_op[idx] = cost.flops;
+            bytes_per_op[idx] = cost.bytes_read + cost.bytes_written;
           }
         }
         timer.Start();
@@ -157,10 +324,13 @@ vector<float> SimpleNet::TEST_Benchmark(
                : (op->debug_def().output_size() ? op->debug_def().output(0)
                                                 : "NO_OUTPUT"));
       std::stringstream flops_str;
-      if (flops_per_op[idx]) {
-        flops_str << " ("
-                  << to_string(1.0e-6 * flops_per_op[idx] / time_per_op[idx])
-                  << " GFLOPS)";
+      if (flops_per_op[idx] || bytes_per_op[idx]) {
+        // time_per_op sums all the main runs, the cost is per run.
+        const double ms_per_run = time_per_op[idx] / main_runs;
+        flops_str << " (" << to_string(1.0e-6 * flops_per_op[idx] / ms_per_run)
+                  << " GFLOPS, "
+                  << to_string(1.0e-6 * bytes_per_op[idx] / ms_per_run)
+                  << " GB/s)";
       }
       LOG(INFO) << "Operator #" << idx << " (" << print_name << ", " << op_type
                 << ") " << time_per_op[idx] / main_runs << " ms/iter"
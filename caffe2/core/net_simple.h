@@ -22,6 +22,7 @@
 #include "caffe2/core/common.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/net.h"
+#include "caffe2/core/net_shape_inference.h"
 #include "caffe2/core/registry.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/core/workspace.h"
@@ -32,6 +33,19 @@ namespace caffe2 {
 // This is the very basic structure you need to run a network - all it
 // does is simply to run everything in sequence. If you want more fancy control
 // such as a DAG-like execution, check out other better net implementations.
+//
+// With the "compiled_plan" net argument set, a CPU-only SimpleNet caches a
+// flat execution plan after a successful run: the operator pointers, their
+// output blobs and the output shapes seen for the current shapes of the
+// external inputs. Later runs with the same input shapes go through the plan,
+// which pre-sizes the outputs and skips the per-operator bookkeeping of the
+// general path. The first run with new input shapes uses a plan built from
+// the shapes and types the operator schemas infer for them instead, which
+// also allocates the inferred outputs before the operators run, and the plan
+// is rebuilt from the observed shapes afterwards. The inferred shapes are
+// cached per input shapes, so nets alternating between a few shapes only
+// run the inference once per shape. If the inference fails, the run falls
+// back to the general path.
 class SimpleNet : public NetBase {
  public:
   SimpleNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws);
@@ -58,8 +72,39 @@ class SimpleNet : public NetBase {
     return op_list;
   }
 
+  // Whether the next run with unchanged input shapes uses the compiled plan.
+  bool HasCompiledPlan() const {
+    return plan_valid_;
+  }
+
  protected:
+  struct PlanStep {
+    OperatorBase* op;
+    // Outputs that are pre-sized before the operator runs, along with the
+    // shapes they had after the run the plan was built from, or their
+    // inferred shapes. If the type is known the output is allocated as well.
+    vector<Blob*> outputs;
+    vector<vector<TIndex>> output_dims;
+    vector<TypeMeta> output_metas;
+  };
+
+  bool RunOperators();
+  bool RunPlan();
+  void BuildPlan();
+  // Builds the plan from the inferred shapes for the current input shapes.
+  // Returns false if the inference failed.
+  bool BuildPlanFromInference();
+  bool PlanMatchesInputs() const;
+
   vector<unique_ptr<OperatorBase>> operators_;
+  Workspace* ws_;
+
+  bool compiled_plan_ = false;
+  bool plan_valid_ = false;
+  vector<const Blob*> plan_inputs_;
+  vector<vector<TIndex>> plan_input_dims_;
+  vector<PlanStep> plan_;
+  std::unique_ptr<NetShapeInference> shape_inference_;
 
   DISABLE_COPY_AND_ASSIGN(SimpleNet);
 };
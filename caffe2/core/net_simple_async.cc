@@ -34,27 +34,7 @@ AsyncSimpleNet::AsyncSimpleNet(
     Workspace* ws)
     : NetBase(net_def, ws) {
   VLOG(1) << "Constructing AsyncSimpleNet " << net_def->name();
-  const bool net_def_has_device_option = net_def->has_device_option();
-  // Initialize the operators
-  for (int idx = 0; idx < net_def->op_size(); ++idx) {
-    const auto& operator_def = net_def->op(idx);
-    VLOG(1) << "Creating operator " << operator_def.name() << ": "
-            << operator_def.type();
-    std::unique_ptr<OperatorBase> op{nullptr};
-    if (!operator_def.has_device_option() && net_def_has_device_option) {
-      // In the case that the operator def does not specify a device option but
-      // the net def has a default option, we copy the device option over to the
-      // operator def.
-      OperatorDef temp_def(operator_def);
-      temp_def.mutable_device_option()->CopyFrom(net_def->device_option());
-      op = CreateOperator(temp_def, ws, idx);
-    } else {
-      op = CreateOperator(operator_def, ws, idx);
-      op->set_debug_def(
-          std::shared_ptr<const OperatorDef>{net_def, &(net_def->op(idx))});
-    }
-    operators_.emplace_back(std::move(op));
-  }
+  operators_ = CreateOperators(net_def, ws);
   events_ = {&operators_.back()->event()};
 }
 
@@ -64,6 +44,9 @@ bool AsyncSimpleNet::RunAsync() {
   const auto& net_name = name_.c_str();
   VLOG(1) << "Running net " << name_;
   for (auto& op : operators_) {
+    if (IsCancelled()) {
+      return false;
+    }
     const auto& opdef = op->debug_def();
     const auto& op_ptr = op.get();
     const auto& op_name = opdef.name().c_str();
@@ -14,14 +14,19 @@
  * limitations under the License.
  */
 
+#include <chrono>
+#include <thread>
+
 #include <google/protobuf/text_format.h>
 #include <gtest/gtest.h>
 #include "caffe2/core/net.h"
 #include "caffe2/core/net_dag.h"
+#include "caffe2/core/net_simple.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/scope_guard.h"
 
 CAFFE2_DECLARE_bool(caffe2_disable_chaining);
+CAFFE2_DECLARE_int(caffe2_threadpool_chunks_per_thread);
 
 namespace caffe2 {
 
@@ -66,6 +71,66 @@ OPERATOR_SCHEMA(NetTestDummy2)
     .NumOutputs(0, INT_MAX)
     .AllowInplace({{1, 0}});
 
+static std::atomic<bool> async_flag;
+
+// Finishes, from a background thread, once NetTestSetFlag has run, or fails
+// after a few seconds.
+class NetTestWaitFlagOp final : public AsyncCPUOperator {
+ public:
+  NetTestWaitFlagOp(const OperatorDef& operator_def, Workspace* ws)
+      : AsyncCPUOperator(operator_def, ws),
+        fail_(OperatorBase::GetSingleArgument<bool>("fail", false)) {}
+
+  bool RunOnDeviceAsync() override {
+    RunInBackground([this]() {
+      for (int i = 0; i < 1000 && !async_flag.load(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      }
+      return async_flag.load() && !fail_;
+    });
+    return true;
+  }
+
+ private:
+  const bool fail_;
+};
+
+class NetTestSetFlagOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+
+  bool RunOnDevice() override {
+    async_flag.store(true);
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(NetTestWaitFlag, NetTestWaitFlagOp);
+REGISTER_CPU_OPERATOR(NetTestSetFlag, NetTestSetFlagOp);
+
+OPERATOR_SCHEMA(NetTestWaitFlag).NumInputs(0, INT_MAX).NumOutputs(0, INT_MAX);
+OPERATOR_SCHEMA(NetTestSetFlag).NumInputs(0, INT_MAX).NumOutputs(0, INT_MAX);
+
+static NetBase* net_to_cancel = nullptr;
+
+// Fills its output, then cancels net_to_cancel.
+class NetTestCancelOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+
+  bool RunOnDevice() override {
+    auto* output = Output(0);
+    output->Resize(16);
+    output->mutable_data<float>();
+    net_to_cancel->Cancel();
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(NetTestCancel, NetTestCancelOp);
+
+OPERATOR_SCHEMA(NetTestCancel).NumInputs(0, INT_MAX).NumOutputs(1);
+
 unique_ptr<NetBase> CreateNetTestHelper(
     Workspace* ws,
     const vector<string>& input,
@@ -629,4 +694,518 @@ TEST(NetTest, FailingOperator) {
   }
 }
 
+TEST(NetTest, AsyncOperatorDoesNotBlockWorker) {
+  const auto spec = R"DOC(
+        name: "example"
+        type: "dag"
+        num_workers: 1
+        external_input: "in"
+        op {
+          input: "in"
+          output: "waited"
+          type: "NetTestWaitFlag"
+        }
+        op {
+          input: "in"
+          output: "set"
+          type: "NetTestSetFlag"
+        }
+        op {
+          input: "waited"
+          input: "set"
+          output: "out"
+          type: "NetTestDummy"
+        }
+)DOC";
+
+  Workspace ws;
+  ws.CreateBlob("in");
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(spec, &net_def));
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  for (int i = 0; i < 3; i++) {
+    async_flag.store(false);
+    counter.exchange(0);
+    // With a single worker, the flag is only set if the worker does not wait
+    // for NetTestWaitFlag.
+    ASSERT_TRUE(net->Run());
+    ASSERT_EQ(1, counter.load());
+  }
+
+  // A failed asynchronous part fails the run and skips the dependent op.
+  net_def.mutable_op(0)->add_arg()->CopyFrom(MakeArgument<bool>("fail", true));
+  net = CreateNet(net_def, &ws);
+  async_flag.store(false);
+  counter.exchange(0);
+  ASSERT_FALSE(net->Run());
+  ASSERT_EQ(0, counter.load());
+
+  // The simple net waits for the asynchronous part.
+  net_def.set_type("simple");
+  net_def.mutable_op(0)->clear_arg();
+  async_flag.store(true);
+  net = CreateNet(net_def, &ws);
+  counter.exchange(0);
+  ASSERT_TRUE(net->Run());
+  ASSERT_EQ(1, counter.load());
+}
+
+TEST(NetTest, CancelledRun) {
+  const auto spec = R"DOC(
+        name: "example"
+        external_input: "in"
+        op {
+          input: "in"
+          output: "hidden"
+          type: "NetTestCancel"
+        }
+        op {
+          input: "hidden"
+          output: "out"
+          type: "NetTestDummy"
+        }
+)DOC";
+
+  for (const auto& type : {"simple", "dag", "async_simple"}) {
+    Workspace ws;
+    ws.CreateBlob("in");
+    NetDef net_def;
+    CAFFE_ENFORCE(
+        google::protobuf::TextFormat::ParseFromString(spec, &net_def));
+    net_def.set_type(type);
+    std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+    net_to_cancel = net.get();
+    for (int i = 0; i < 2; i++) {
+      counter.exchange(0);
+      ASSERT_FALSE(net->Run()) << type;
+      ASSERT_EQ(0, counter.load()) << type;
+      // The intermediate blob keeps its shape but not its memory.
+      const auto& hidden = ws.GetBlob("hidden")->Get<TensorCPU>();
+      EXPECT_EQ(16, hidden.size()) << type;
+      EXPECT_EQ(0, hidden.capacity_nbytes()) << type;
+    }
+  }
+  net_to_cancel = nullptr;
+}
+
+TEST(NetTest, WorkStealingDAGForkJoin) {
+  const auto spec = R"DOC(
+        name: "example"
+        type: "dag_ws"
+        external_input: "in"
+        op {
+          input: "in"
+          output: "hidden1"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "in"
+          output: "hidden2"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "hidden1"
+          input: "hidden2"
+          output: "out"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "out"
+          output: "out2"
+          type: "NetTestDummy"
+        }
+)DOC";
+  checkChainingAndRun(spec, {{0, {0}}, {1, {1}}, {2, {2, 3}}});
+}
+
+TEST(NetTest, WorkStealingDAGFailingOperator) {
+  const auto spec = R"DOC(
+        name: "example"
+        type: "dag_ws"
+        external_input: "in"
+        op {
+          input: "in"
+          output: "hidden"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "hidden"
+          output: "out"
+          type: "NetTestDummy"
+          arg {
+            name: "fail"
+            i: 1
+          }
+        }
+)DOC";
+
+  Workspace ws;
+  ws.CreateBlob("in");
+
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(spec, &net_def));
+  net_def.set_num_workers(4);
+
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  for (int i = 0; i < 10; i++) {
+    counter.exchange(0);
+    ASSERT_EQ(false, net.get()->Run());
+    ASSERT_EQ(1, counter.load());
+  }
+}
+
+namespace {
+
+std::mutex run_order_mutex;
+std::vector<std::string> run_order;
+
+// Records the order in which the net runs its operators.
+class NetTestRecordOp final : public OperatorBase {
+ public:
+  using OperatorBase::OperatorBase;
+
+  bool Run(int /* unused */ /*stream_id*/) override {
+    std::lock_guard<std::mutex> lock(run_order_mutex);
+    run_order.push_back(debug_def().name());
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(NetTestRecord, NetTestRecordOp);
+REGISTER_CPU_OPERATOR(NetTestRecordPriority, NetTestRecordOp);
+OPERATOR_SCHEMA(NetTestRecord).NumInputs(0, INT_MAX).NumOutputs(0, INT_MAX);
+OPERATOR_SCHEMA(NetTestRecordPriority)
+    .NumInputs(0, INT_MAX)
+    .NumOutputs(0, INT_MAX);
+
+} // namespace
+
+TEST(NetTest, DAGPriorityOpTypes) {
+  const auto spec = R"DOC(
+        name: "example"
+        type: "dag"
+        num_workers: 1
+        external_input: "in"
+        arg {
+          name: "priority_op_types"
+          strings: "NetTestRecordPriority"
+        }
+        op {
+          name: "root"
+          input: "in"
+          output: "hidden"
+          type: "NetTestRecord"
+        }
+        op {
+          name: "a"
+          input: "hidden"
+          output: "out1"
+          type: "NetTestRecord"
+        }
+        op {
+          name: "b"
+          input: "hidden"
+          output: "out2"
+          type: "NetTestRecord"
+        }
+        op {
+          name: "priority"
+          input: "hidden"
+          output: "out3"
+          type: "NetTestRecordPriority"
+        }
+)DOC";
+
+  Workspace ws;
+  ws.CreateBlob("in");
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(spec, &net_def));
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  for (int i = 0; i < 3; i++) {
+    run_order.clear();
+    ASSERT_TRUE(net->Run());
+    ASSERT_EQ(4, run_order.size());
+    EXPECT_EQ("root", run_order[0]);
+    EXPECT_EQ("priority", run_order[1]);
+  }
+}
+
+TEST(NetTest, ExecutorPoolForkJoin) {
+  const auto spec = R"DOC(
+        name: "example"
+        type: "dag"
+        external_input: "in"
+        arg {
+          name: "use_executor_pool"
+          i: 1
+        }
+        op {
+          input: "in"
+          output: "hidden1"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "in"
+          output: "hidden2"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "hidden1"
+          input: "hidden2"
+          output: "out"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "out"
+          output: "out2"
+          type: "NetTestDummy"
+        }
+)DOC";
+  checkChainingAndRun(spec, {{0, {0}}, {1, {1}}, {2, {2, 3}}});
+}
+
+TEST(NetTest, ExecutorPoolFailingOperator) {
+  const auto spec = R"DOC(
+        name: "example"
+        type: "dag"
+        external_input: "in"
+        arg {
+          name: "use_executor_pool"
+          i: 1
+        }
+        op {
+          input: "in"
+          output: "hidden"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "hidden"
+          output: "out"
+          type: "NetTestDummy"
+          arg {
+            name: "fail"
+            i: 1
+          }
+        }
+)DOC";
+
+  Workspace ws;
+  ws.CreateBlob("in");
+
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(spec, &net_def));
+
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  for (int i = 0; i < 10; i++) {
+    counter.exchange(0);
+    ASSERT_EQ(false, net.get()->Run());
+    ASSERT_EQ(1, counter.load());
+  }
+}
+
+TEST(NetTest, ExecutorPoolSchedulingStats) {
+  const auto spec = R"DOC(
+        name: "scheduling_stats_example"
+        type: "dag"
+        external_input: "in"
+        arg {
+          name: "use_executor_pool"
+          i: 1
+        }
+        arg {
+          name: "executor_priority"
+          i: 2
+        }
+        arg {
+          name: "deadline_ms"
+          i: 60000
+        }
+        op {
+          input: "in"
+          output: "hidden1"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "in"
+          output: "hidden2"
+          type: "NetTestDummy"
+        }
+)DOC";
+
+  Workspace ws;
+  ws.CreateBlob("in");
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(spec, &net_def));
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  counter.exchange(0);
+  ASSERT_TRUE(net->Run());
+  dynamic_cast<DAGNetBase*>(net.get())->SetSchedulingParams(-1, 0);
+  ASSERT_TRUE(net->Run());
+  ASSERT_EQ(4, counter.load());
+
+  int64_t chains = -1;
+  int64_t past_deadline = -1;
+  for (const auto& stat : StatRegistry::get().publish()) {
+    if (stat.key ==
+        "scheduling_stats_example/executor_pool_queue_time_us/count") {
+      chains = stat.value;
+    } else if (stat.key == "scheduling_stats_example/runs_past_deadline") {
+      past_deadline = stat.value;
+    }
+  }
+  EXPECT_EQ(4, chains);
+  EXPECT_EQ(0, past_deadline);
+}
+
+TEST(NetTest, SimpleNetCompiledPlan) {
+  const auto spec = R"DOC(
+        name: "example"
+        type: "simple"
+        external_input: "in"
+        op {
+          input: "in"
+          output: "hidden"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "hidden"
+          output: "out"
+          type: "NetTestDummy"
+        }
+        arg {
+          name: "compiled_plan"
+          i: 1
+        }
+)DOC";
+
+  Workspace ws;
+  ws.CreateBlob("in")->GetMutable<TensorCPU>()->Resize(2);
+  ws.CreateBlob("hidden")->GetMutable<TensorCPU>()->Resize(4);
+
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(spec, &net_def));
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  auto* simple_net = dynamic_cast<SimpleNet*>(net.get());
+  ASSERT_TRUE(simple_net != nullptr);
+  EXPECT_FALSE(simple_net->HasCompiledPlan());
+
+  counter.exchange(0);
+  ASSERT_TRUE(net->Run());
+  ASSERT_EQ(2, counter.load());
+  EXPECT_TRUE(simple_net->HasCompiledPlan());
+
+  // The plan restores the output shapes it was built with.
+  auto* hidden = ws.GetBlob("hidden")->GetMutable<TensorCPU>();
+  hidden->Resize(1);
+  ASSERT_TRUE(net->Run());
+  ASSERT_EQ(4, counter.load());
+  EXPECT_EQ(vector<TIndex>{4}, hidden->dims());
+
+  // A new input shape goes through the general path and rebuilds the plan.
+  ws.GetBlob("in")->GetMutable<TensorCPU>()->Resize(3);
+  hidden->Resize(1);
+  ASSERT_TRUE(net->Run());
+  ASSERT_EQ(6, counter.load());
+  EXPECT_EQ(vector<TIndex>{1}, hidden->dims());
+  EXPECT_TRUE(simple_net->HasCompiledPlan());
+}
+
+TEST(NetTest, ParallelOperatorConstruction) {
+  const int kNumOps = 1000;
+  for (const string type : {"simple", "dag", "async_simple"}) {
+    NetDef net_def;
+    net_def.set_type(type);
+    auto* arg = net_def.add_arg();
+    arg->set_name("num_construction_threads");
+    arg->set_i(4);
+    net_def.add_external_input("in");
+    for (int i = 0; i < kNumOps; ++i) {
+      auto* op = net_def.add_op();
+      op->set_type("NetTestDummy");
+      op->set_name(caffe2::to_string(i));
+      op->add_input(i == 0 ? "in" : "x" + caffe2::to_string(i - 1));
+      op->add_output("x" + caffe2::to_string(i));
+    }
+    Workspace ws;
+    ws.CreateBlob("in");
+    std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+    ASSERT_TRUE(net != nullptr);
+    EXPECT_GT(net->construction_secs(), 0);
+    const auto ops = net->GetOperators();
+    ASSERT_EQ(ops.size(), kNumOps);
+    for (int i = 0; i < kNumOps; ++i) {
+      EXPECT_EQ(ops[i]->debug_def().name(), caffe2::to_string(i));
+      EXPECT_EQ(
+          ops[i]->Outputs()[0], ws.GetBlob("x" + caffe2::to_string(i)));
+    }
+    counter.exchange(0);
+    ASSERT_TRUE(net->Run());
+    EXPECT_EQ(counter.load(), kNumOps);
+  }
+}
+
+namespace {
+
+ThreadPool::RunOptions recorded_pool_options;
+
+// Records the thread pool settings it runs with.
+class NetTestRecordPoolOptionsOp final : public OperatorBase {
+ public:
+  using OperatorBase::OperatorBase;
+
+  bool Run(int /* unused */ /*stream_id*/) override {
+    recorded_pool_options = ThreadPool::currentRunOptions();
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(NetTestRecordPoolOptions, NetTestRecordPoolOptionsOp);
+OPERATOR_SCHEMA(NetTestRecordPoolOptions).NumInputs(0).NumOutputs(0);
+
+} // namespace
+
+TEST(NetTest, ThreadPoolSettings) {
+  NetDef net_def;
+  net_def.set_type("simple");
+  net_def.add_op()->set_type("NetTestRecordPoolOptions");
+  auto* arg = net_def.add_arg();
+  arg->set_name("threadpool_chunks_per_thread");
+  arg->set_i(8);
+  arg = net_def.add_arg();
+  arg->set_name("threadpool_spin_nops");
+  arg->set_i(0);
+  Workspace ws;
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  ASSERT_TRUE(net != nullptr);
+  ASSERT_TRUE(net->Run());
+  EXPECT_EQ(8, recorded_pool_options.chunksPerThread);
+  EXPECT_EQ(0, recorded_pool_options.spinNOPs);
+  // The settings only apply during the run, and the pool the nets of the
+  // workspace share keeps its own.
+  EXPECT_EQ(-1, ThreadPool::currentRunOptions().chunksPerThread);
+  EXPECT_EQ(-1, ThreadPool::currentRunOptions().spinNOPs);
+  auto* pool = ws.GetThreadPool();
+  EXPECT_EQ(FLAGS_caffe2_threadpool_chunks_per_thread,
+            pool->getChunksPerThread());
+
+  // Every unit of the range runs once, whichever thread claims its chunk.
+  const size_t kRange = 1000;
+  std::vector<std::atomic<int>> runs(kRange);
+  for (auto& r : runs) {
+    r = 0;
+  }
+  pool->setMinWorkSize(0);
+  {
+    ThreadPool::RunOptions options;
+    options.chunksPerThread = 8;
+    options.spinNOPs = 0;
+    ThreadPool::ScopedRunOptions scope(options);
+    pool->run([&](int, size_t i) { runs[i]++; }, kRange);
+    pool->runChunks([&](int, size_t i) { runs[i]++; }, kRange);
+  }
+  for (const auto& r : runs) {
+    EXPECT_EQ(r.load(), 2);
+  }
+}
+
 } // namespace caffe2
@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/numa.h"
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+
+#ifdef CAFFE2_USE_NUMA
+#include <numa.h>
+#include <numaif.h>
+#include <sched.h>
+#include <unistd.h>
+#endif // CAFFE2_USE_NUMA
+
+CAFFE2_DEFINE_bool(
+    caffe2_cpu_numa_enabled,
+    false,
+    "Use NUMA whenever possible: bind executor threads to the NUMA node of "
+    "their net and place CPU allocations on the node of the allocating "
+    "thread.");
+
+namespace caffe2 {
+
+#ifdef CAFFE2_USE_NUMA
+bool IsNUMAEnabled() {
+  return FLAGS_caffe2_cpu_numa_enabled && numa_available() >= 0;
+}
+
+void NUMABind(int numa_node_id) {
+  if (numa_node_id < 0) {
+    return;
+  }
+  if (!IsNUMAEnabled()) {
+    VLOG(1) << "NUMA is not enabled";
+    return;
+  }
+  CAFFE_ENFORCE(
+      numa_node_id <= numa_max_node(),
+      "NUMA node id ",
+      numa_node_id,
+      " is unavailable");
+
+  auto bm = numa_allocate_nodemask();
+  numa_bitmask_clearall(bm);
+  numa_bitmask_setbit(bm, numa_node_id);
+  numa_bind(bm);
+  numa_bitmask_free(bm);
+}
+
+int GetNUMANode(const void* ptr) {
+  if (!IsNUMAEnabled()) {
+    VLOG(1) << "NUMA is not enabled";
+    return -1;
+  }
+  CAFFE_ENFORCE(ptr);
+
+  int numa_node = -1;
+  CAFFE_ENFORCE(
+      get_mempolicy(
+          &numa_node,
+          nullptr,
+          0,
+          const_cast<void*>(ptr),
+          MPOL_F_NODE | MPOL_F_ADDR) == 0,
+      "Unable to get memory policy");
+  return numa_node;
+}
+
+int GetNumNUMANodes() {
+  if (!IsNUMAEnabled()) {
+    VLOG(1) << "NUMA is not enabled";
+    return -1;
+  }
+
+  return numa_num_configured_nodes();
+}
+
+bool NUMAMove(void* ptr, size_t size, int numa_node_id) {
+  if (numa_node_id < 0) {
+    return false;
+  }
+  if (!IsNUMAEnabled()) {
+    VLOG(1) << "NUMA is not enabled";
+    return false;
+  }
+  CAFFE_ENFORCE(ptr);
+  // Avoid extra dynamic allocation and NUMA api calls
+  CAFFE_ENFORCE(
+      numa_node_id >= 0 &&
+      numa_node_id < static_cast<int>(sizeof(unsigned long) * 8));
+
+  // mbind works on whole pages. The pages the range only partly covers may
+  // hold other data, so they are left alone.
+  const size_t page_size = getpagesize();
+  const size_t start = ((size_t)ptr + page_size - 1) & ~(page_size - 1);
+  const size_t end = ((size_t)ptr + size) & ~(page_size - 1);
+  if (end <= start) {
+    return false;
+  }
+  unsigned long mask = 1UL << numa_node_id;
+  if (mbind(
+          (void*)start,
+          end - start,
+          MPOL_BIND,
+          &mask,
+          sizeof(mask) * 8,
+          MPOL_MF_MOVE) != 0) {
+    LOG(WARNING) << "Could not move " << end - start
+                 << " bytes of memory to NUMA node " << numa_node_id;
+    return false;
+  }
+  return true;
+}
+
+int GetCurrentNUMANode() {
+  if (!IsNUMAEnabled()) {
+    VLOG(1) << "NUMA is not enabled";
+    return -1;
+  }
+
+  auto n = numa_node_of_cpu(sched_getcpu());
+  return n;
+}
+
+#else // CAFFE2_USE_NUMA
+
+bool IsNUMAEnabled() {
+  return false;
+}
+
+void NUMABind(int numa_node_id) {
+  if (numa_node_id >= 0) {
+    VLOG(1) << "NUMA is not enabled";
+  }
+}
+
+int GetNUMANode(const void* ptr) {
+  VLOG(1) << "NUMA is not enabled";
+  return -1;
+}
+
+int GetNumNUMANodes() {
+  VLOG(1) << "NUMA is not enabled";
+  return -1;
+}
+
+bool NUMAMove(void* ptr, size_t size, int numa_node_id) {
+  if (numa_node_id >= 0) {
+    VLOG(1) << "NUMA is not enabled";
+  }
+  return false;
+}
+
+int GetCurrentNUMANode() {
+  VLOG(1) << "NUMA is not enabled";
+  return -1;
+}
+
+#endif // CAFFE2_USE_NUMA
+
+} // namespace caffe2
@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_NUMA_H_
+#define CAFFE2_CORE_NUMA_H_
+
+#include <cstddef>
+
+#include "caffe2/core/flags.h"
+
+CAFFE2_DECLARE_bool(caffe2_cpu_numa_enabled);
+
+namespace caffe2 {
+
+// Whether NUMA support is compiled in, enabled with caffe2_cpu_numa_enabled
+// and available on the host.
+bool IsNUMAEnabled();
+
+// Binds the CPU affinity and memory policy of the calling thread to the given
+// NUMA node. A negative node id is a no-op.
+void NUMABind(int numa_node_id);
+
+// Returns the NUMA node of the page holding ptr, or -1 if unknown.
+int GetNUMANode(const void* ptr);
+
+int GetNumNUMANodes();
+
+// Binds the whole pages within [ptr, ptr + size) to the given NUMA node,
+// moving the ones already faulted in. Returns whether it did; a failure is
+// logged, not thrown.
+bool NUMAMove(void* ptr, size_t size, int numa_node_id);
+
+// Returns the NUMA node the calling thread currently runs on, or -1 if
+// unknown.
+int GetCurrentNUMANode();
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_NUMA_H_
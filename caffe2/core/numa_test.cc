@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/numa.h"
+#include "caffe2/utils/thread_pool.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+TEST(NUMATest, NegativeNodeIsNoOp) {
+  NUMABind(-1);
+  int x = 0;
+  NUMAMove(&x, sizeof(x), -1);
+}
+
+TEST(NUMATest, AllocateOnCurrentNode) {
+  FLAGS_caffe2_cpu_numa_enabled = true;
+  if (!IsNUMAEnabled()) {
+    FLAGS_caffe2_cpu_numa_enabled = false;
+    return;
+  }
+  NUMABind(0);
+  EXPECT_EQ(GetCurrentNUMANode(), 0);
+  auto data_and_deleter = CPUContext::New(1 << 20);
+  EXPECT_EQ(GetNUMANode(data_and_deleter.first), 0);
+  data_and_deleter.second(data_and_deleter.first);
+  FLAGS_caffe2_cpu_numa_enabled = false;
+}
+
+TEST(NUMATest, BoundThreadPool) {
+  FLAGS_caffe2_cpu_numa_enabled = true;
+  if (!IsNUMAEnabled()) {
+    FLAGS_caffe2_cpu_numa_enabled = false;
+    return;
+  }
+  const int last_node = GetNumNUMANodes() - 1;
+  int node = -1;
+  {
+    TaskThreadPool pool(1, last_node);
+    pool.runTaskWithID(
+        [&node](std::size_t) { node = GetCurrentNUMANode(); });
+    pool.waitWorkComplete();
+  }
+  EXPECT_EQ(node, last_node);
+  FLAGS_caffe2_cpu_numa_enabled = false;
+}
+
+} // namespace caffe2
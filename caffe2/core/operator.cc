@@ -27,11 +27,17 @@
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/utils/proto_utils.h"
 #include "caffe2/utils/string_utils.h"
+#include "caffe2/utils/thread_pool.h"
 
 CAFFE2_DEFINE_int(
     caffe2_operator_max_engine_name_length,
     10,
     "Maximum engine name length to be stored");
+CAFFE2_DEFINE_int(
+    caffe2_async_cpu_op_pool_size,
+    16,
+    "Number of threads of the pool on which asynchronous CPU operators run "
+    "their blocking calls, see AsyncCPUOperator::RunInBackground.");
 
 namespace caffe2 {
 
@@ -58,6 +64,8 @@ OperatorBase::OperatorBase(const OperatorDef& operator_def, Workspace* ws)
   for (const string& output_str : operator_def.output()) {
     outputs_.push_back(CHECK_NOTNULL(ws->CreateBlob(output_str)));
   }
+  input_cache_.resize(inputs_.size());
+  output_cache_.resize(outputs_.size());
 }
 
 vector<TensorShape> OperatorBase::InputTensorShapes() {
@@ -602,4 +610,32 @@ std::map<string, std::pair<DeviceOption, DeviceOption>> ValidateTensorDevices(
   return mismatches;
 }
 
+bool AsyncCPUOperator::RunOnDevice() {
+  bool started = false;
+  try {
+    started = RunOnDeviceAsync();
+  } catch (const std::exception& e) {
+    SetFinished(e.what());
+    throw;
+  }
+  if (!started) {
+    SetFinished("The operator failed to start.");
+  }
+  return started;
+}
+
+void AsyncCPUOperator::RunInBackground(std::function<bool()> work) {
+  // The threads mostly wait, so the pool is separate from the executor
+  // pool, and it lives until process exit.
+  static TaskThreadPool* pool =
+      new TaskThreadPool(FLAGS_caffe2_async_cpu_op_pool_size);
+  pool->runTask([this, work]() {
+    try {
+      SetFinished(work() ? "" : "The operator failed.");
+    } catch (const std::exception& e) {
+      SetFinished(e.what());
+    }
+  });
+}
+
 }  // namespace caffe2
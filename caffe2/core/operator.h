@@ -21,11 +21,13 @@
 #include <climits>
 #include <cstddef>
 #include <exception>
+#include <functional>
 #include <typeinfo>
 #include <vector>
 
 #include "caffe2/core/blob.h"
 #include "caffe2/core/common.h"
+#include "caffe2/core/memory_profiler.h"
 #include "caffe2/core/net.h"
 #include "caffe2/core/observer.h"
 #include "caffe2/core/operator_gradient.h"
@@ -76,12 +78,23 @@ class OperatorBase : public Observable<OperatorBase> {
         *operator_def_, name, default_value);
   }
 
-  // Get the inputs and outputs as specific types.
+  // Get the inputs and outputs as specific types. The typed pointers are
+  // cached until the blobs are reset, so that steady-state runs do not check
+  // the types again.
   template <typename T>
   inline const T& Input(int idx) {
     DCHECK_LT(idx, inputs_.size());
+    const Blob* blob = inputs_.at(idx);
+    TypedBlobCache& cache = input_cache_[idx];
+    if (cache.tag == TypeTag<T>() && cache.version == blob->version()) {
+      return *static_cast<const T*>(cache.pointer);
+    }
     try {
-      return inputs_.at(idx)->template Get<T>();
+      const T& input = blob->template Get<T>();
+      cache.tag = TypeTag<T>();
+      cache.version = blob->version();
+      cache.pointer = const_cast<T*>(&input);
+      return input;
     } catch (::caffe2::EnforceNotMet& enf) {
       if (has_debug_def()) {
         enf.AppendMessage(".\nOffending Blob name: ");
@@ -94,7 +107,16 @@ class OperatorBase : public Observable<OperatorBase> {
 
   template <typename T>
   inline T* Output(int idx) {
-    return outputs_.at(idx)->template GetMutable<T>();
+    Blob* blob = outputs_.at(idx);
+    TypedBlobCache& cache = output_cache_[idx];
+    if (cache.tag == TypeTag<T>() && cache.version == blob->version()) {
+      return static_cast<T*>(cache.pointer);
+    }
+    T* output = blob->template GetMutable<T>();
+    cache.tag = TypeTag<T>();
+    cache.version = blob->version();
+    cache.pointer = output;
+    return output;
   }
 
   inline const Blob& InputBlob(int idx) {
@@ -121,15 +143,17 @@ class OperatorBase : public Observable<OperatorBase> {
   inline const vector<Blob*>& Outputs() { return outputs_; }
   vector<TensorShape> InputTensorShapes();
 
-  virtual void WaitEvent(const Event& ev) {
+  // WaitEvent and Record act on the given stream of the operator's device,
+  // which should be the stream the operator is run on with RunAsync.
+  virtual void WaitEvent(const Event& ev, int /*stream_id*/ = 0) {
     CAFFE_NOT_IMPLEMENTED;
   }
 
-  inline void Wait(const OperatorBase& other) {
-    WaitEvent(other.event());
+  inline void Wait(const OperatorBase& other, int stream_id = 0) {
+    WaitEvent(other.event(), stream_id);
   }
 
-  virtual void Record() {
+  virtual void Record(int /*stream_id*/ = 0) {
     CAFFE_NOT_IMPLEMENTED;
   }
 
@@ -145,6 +169,12 @@ class OperatorBase : public Observable<OperatorBase> {
     return Run(stream_id);
   }
 
+  // Whether RunAsync only starts the operator on the CPU, which finishes its
+  // event once it is done, see AsyncCPUOperator.
+  virtual bool HasAsyncPart() const {
+    return false;
+  }
+
   virtual void AddRelatedBlobInfo(EnforceNotMet* err) {
     if (!has_debug_def()) {
       return;
@@ -213,6 +243,30 @@ class OperatorBase : public Observable<OperatorBase> {
     return event_;
   }
 
+  Event* mutable_event() {
+    return &event_;
+  }
+
+  // Whether the run of the net of the operator is cancelled, see
+  // NetBase::Cancel(). Operators that loop check it between iterations.
+  bool IsCancelled() const {
+    return net_ && net_->IsCancelled();
+  }
+
+  // Set by CreateNet to the net that owns the operator.
+  void SetNet(const NetBase* net) {
+    net_ = net;
+  }
+
+  // The stream the operator runs on, and the number of events it waited on
+  // before running. Only meaningful from within the operator's observers.
+  int stream_id() const {
+    return stream_id_;
+  }
+  int num_event_waits() const {
+    return num_event_waits_;
+  }
+
   const std::string& type() {
     CAFFE_ENFORCE(operator_def_.get() != nullptr);
     return operator_def_->type();
@@ -237,11 +291,33 @@ class OperatorBase : public Observable<OperatorBase> {
   vector<const Blob*> inputs_;
   vector<Blob*> outputs_;
 
+  // The object of a blob resolved as the type of tag, valid as long as the
+  // blob stays at version.
+  struct TypedBlobCache {
+    const void* tag = nullptr;
+    uint64_t version = 0;
+    void* pointer = nullptr;
+  };
+  vector<TypedBlobCache> input_cache_;
+  vector<TypedBlobCache> output_cache_;
+
+  // A unique address per type, cheaper to compare than TypeMeta ids, which
+  // are not inlined. A type with several addresses, e.g. across shared
+  // libraries, only misses the cache.
+  template <typename T>
+  static const void* TypeTag() {
+    static const char tag = 0;
+    return &tag;
+  }
+
   int net_position_{kNoNetPositionSet};
+  const NetBase* net_ = nullptr;
 
  protected:
   // An event used by asynchronous execution.
   Event event_;
+  int stream_id_ = 0;
+  int num_event_waits_ = 0;
 
   DISABLE_COPY_AND_ASSIGN(OperatorBase);
 };
@@ -295,13 +371,14 @@ class Operator : public OperatorBase {
     return OperatorBase::template Output<Tensor<Context>>(idx);
   }
 
-  void WaitEvent(const Event& ev) final {
-    context_.SwitchToDevice();
+  void WaitEvent(const Event& ev, int stream_id = 0) final {
+    context_.SwitchToDevice(stream_id);
     context_.WaitEvent(ev);
+    ++num_event_waits_;
   }
 
-  void Record() final {
-    context_.SwitchToDevice();
+  void Record(int stream_id = 0) final {
+    context_.SwitchToDevice(stream_id);
     context_.Record(&event_);
   }
 
@@ -310,16 +387,25 @@ class Operator : public OperatorBase {
   // instead of Run().
   bool Run(int stream_id = 0) final {
     try {
+      MemoryProfiler::OperatorScope memory_scope(this);
+      stream_id_ = stream_id;
       StartAllObservers();
 
       context_.SwitchToDevice(stream_id);
+      if (HasAsyncPart()) {
+        event_.Reset();
+      }
       bool result = RunOnDevice();
+      if (HasAsyncPart()) {
+        result = FinishAsyncPart(result);
+      }
       if (!result) {
         this->RecordLastFailedOpNetPosition();
       }
       context_.FinishDeviceComputation(); // throws on error
 
       StopAllObservers();
+      num_event_waits_ = 0;
 
       return result;
     } catch (EnforceNotMet& err) {
@@ -336,14 +422,29 @@ class Operator : public OperatorBase {
     }
   }
 
+  // Observers see the time it takes to issue the operator, which for an
+  // asynchronous device does not include its execution.
   bool RunAsync(int stream_id = 0) final {
     try {
+      MemoryProfiler::OperatorScope memory_scope(this);
+      stream_id_ = stream_id;
+      StartAllObservers();
+
       context_.SwitchToDevice(stream_id);
+      if (HasAsyncPart()) {
+        event_.Reset();
+      }
       auto result = RunOnDevice();
       if (!result) {
         this->RecordLastFailedOpNetPosition();
       }
-      context_.Record(&event_);
+      // An operator with an asynchronous part finishes its event itself.
+      if (!HasAsyncPart()) {
+        context_.Record(&event_);
+      }
+
+      StopAllObservers();
+      num_event_waits_ = 0;
       return result;
     } catch (EnforceNotMet& err) {
       if (has_debug_def()) {
@@ -362,9 +463,53 @@ class Operator : public OperatorBase {
   virtual bool RunOnDevice() = 0;
 
  protected:
+  // Waits for the asynchronous part of the operator, which has started if
+  // started is true, and returns whether it succeeded.
+  bool FinishAsyncPart(bool started) {
+    event_.Finish();
+    const auto err_msg = event_.ErrorMessage();
+    if (!err_msg.empty()) {
+      LOG(ERROR) << "Asynchronous part of operator "
+                 << (has_debug_def() ? debug_def().type() : "")
+                 << " failed: " << err_msg;
+    }
+    return started && err_msg.empty();
+  }
+
   Context context_;
 };
 
+// A CPU operator whose work finishes after RunAsync returns, e.g. because it
+// waits for I/O, so that the executor can run other operators meanwhile
+// instead of blocking one of its threads. RunOnDeviceAsync starts the work,
+// e.g. with RunInBackground, and the operator calls SetFinished, from any
+// thread, once its outputs are written. Run waits for the work, so these
+// operators also run under the synchronous executors.
+class AsyncCPUOperator : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+
+  bool HasAsyncPart() const final {
+    return true;
+  }
+
+  // Starts the operator. A false return, or an exception, means that it did
+  // not start, and finishes its event.
+  bool RunOnDevice() final;
+
+ protected:
+  virtual bool RunOnDeviceAsync() = 0;
+
+  void SetFinished(const std::string& err_msg = "") {
+    event_.SetFinished(err_msg);
+  }
+
+  // Runs work on a thread pool for blocking calls, sized by
+  // caffe2_async_cpu_op_pool_size, and finishes the operator with its
+  // result.
+  void RunInBackground(std::function<bool()> work);
+};
+
 #define USE_OPERATOR_BASE_FUNCTIONS                                 \
   /* using override */ using OperatorBase::HasArgument;             \
   /* using override */ using OperatorBase::GetSingleArgument;       \
@@ -571,18 +716,24 @@ CAFFE_DECLARE_REGISTRY(
     const OperatorDef&,
     Workspace*);
 #define REGISTER_CPU_OPERATOR_CREATOR(key, ...) \
-  CAFFE_REGISTER_CREATOR(CPUOperatorRegistry, key, __VA_ARGS__)
-#define REGISTER_CPU_OPERATOR(name, ...)                           \
-  extern void CAFFE2_PLEASE_ADD_OPERATOR_SCHEMA_FOR_##name();      \
-  static void CAFFE2_UNUSED CAFFE_ANONYMOUS_VARIABLE_CPU##name() { \
-    CAFFE2_PLEASE_ADD_OPERATOR_SCHEMA_FOR_##name();                \
-  }                                                                \
-  CAFFE_REGISTER_CLASS(CPUOperatorRegistry, name, __VA_ARGS__)
+  CAFFE2_IF_OPERATOR_ENABLED(                   \
+      key, CAFFE_REGISTER_CREATOR(CPUOperatorRegistry, key, __VA_ARGS__))
+#define REGISTER_CPU_OPERATOR(name, ...)                             \
+  CAFFE2_IF_OPERATOR_ENABLED(                                        \
+      name,                                                          \
+      extern void CAFFE2_PLEASE_ADD_OPERATOR_SCHEMA_FOR_##name();    \
+      static void CAFFE2_UNUSED CAFFE_ANONYMOUS_VARIABLE_CPU##name() { \
+        CAFFE2_PLEASE_ADD_OPERATOR_SCHEMA_FOR_##name();              \
+      }                                                              \
+      CAFFE_REGISTER_CLASS(CPUOperatorRegistry, name, __VA_ARGS__))
 #define REGISTER_CPU_OPERATOR_STR(str_name, ...) \
   CAFFE_REGISTER_TYPED_CLASS(CPUOperatorRegistry, str_name, __VA_ARGS__)
 
 #define REGISTER_CPU_OPERATOR_WITH_ENGINE(name, engine, ...) \
-  CAFFE_REGISTER_CLASS(CPUOperatorRegistry, name##_ENGINE_##engine, __VA_ARGS__)
+  CAFFE2_IF_OPERATOR_ENABLED(                                \
+      name,                                                  \
+      CAFFE_REGISTER_CLASS(                                  \
+          CPUOperatorRegistry, name##_ENGINE_##engine, __VA_ARGS__))
 
 CAFFE_DECLARE_REGISTRY(
     CUDAOperatorRegistry,
@@ -590,19 +741,24 @@ CAFFE_DECLARE_REGISTRY(
     const OperatorDef&,
     Workspace*);
 #define REGISTER_CUDA_OPERATOR_CREATOR(key, ...) \
-  CAFFE_REGISTER_CREATOR(CUDAOperatorRegistry, key, __VA_ARGS__)
-#define REGISTER_CUDA_OPERATOR(name, ...)                           \
-  extern void CAFFE2_PLEASE_ADD_OPERATOR_SCHEMA_FOR_##name();       \
-  static void CAFFE2_UNUSED CAFFE_ANONYMOUS_VARIABLE_CUDA##name() { \
-    CAFFE2_PLEASE_ADD_OPERATOR_SCHEMA_FOR_##name();                 \
-  }                                                                 \
-  CAFFE_REGISTER_CLASS(CUDAOperatorRegistry, name, __VA_ARGS__)
+  CAFFE2_IF_OPERATOR_ENABLED(                    \
+      key, CAFFE_REGISTER_CREATOR(CUDAOperatorRegistry, key, __VA_ARGS__))
+#define REGISTER_CUDA_OPERATOR(name, ...)                             \
+  CAFFE2_IF_OPERATOR_ENABLED(                                         \
+      name,                                                           \
+      extern void CAFFE2_PLEASE_ADD_OPERATOR_SCHEMA_FOR_##name();     \
+      static void CAFFE2_UNUSED CAFFE_ANONYMOUS_VARIABLE_CUDA##name() { \
+        CAFFE2_PLEASE_ADD_OPERATOR_SCHEMA_FOR_##name();               \
+      }                                                               \
+      CAFFE_REGISTER_CLASS(CUDAOperatorRegistry, name, __VA_ARGS__))
 #define REGISTER_CUDA_OPERATOR_STR(str_name, ...) \
   CAFFE_REGISTER_TYPED_CLASS(CUDAOperatorRegistry, str_name, __VA_ARGS__)
 
 #define REGISTER_CUDA_OPERATOR_WITH_ENGINE(name, engine, ...) \
-  CAFFE_REGISTER_CLASS(                                       \
-      CUDAOperatorRegistry, name##_ENGINE_##engine, __VA_ARGS__)
+  CAFFE2_IF_OPERATOR_ENABLED(                                 \
+      name,                                                   \
+      CAFFE_REGISTER_CLASS(                                   \
+          CUDAOperatorRegistry, name##_ENGINE_##engine, __VA_ARGS__))
 
 // Macros for cudnn since we use it often
 #define REGISTER_CUDNN_OPERATOR(name, ...) \
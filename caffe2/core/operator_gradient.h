@@ -318,7 +318,8 @@ CAFFE_DECLARE_REGISTRY(
     const vector<GradientWrapper>&);
 
 #define REGISTER_GRADIENT(name, ...) \
-  CAFFE_REGISTER_CLASS(GradientRegistry, name, __VA_ARGS__)
+  CAFFE2_IF_OPERATOR_ENABLED(        \
+      name, CAFFE_REGISTER_CLASS(GradientRegistry, name, __VA_ARGS__))
 #define REGISTER_GRADIENT_STR(str_name, ...) \
   CAFFE_REGISTER_TYPED_CLASS(GradientRegistry, str_name, __VA_ARGS__)
 
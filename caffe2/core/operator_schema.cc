@@ -206,6 +206,11 @@ OpSchema& OpSchema::InputsCanCrossDevices() {
   return *this;
 }
 
+OpSchema& OpSchema::ShapeOnlyInputs(set<int> inputs) {
+  shape_only_inputs_ = std::move(inputs);
+  return *this;
+}
+
 OpSchema& OpSchema::TensorInferenceFunction(
     TensorInferenceFunctionType function) {
   tensor_inference_function_ = function;
@@ -17,6 +17,7 @@
 #ifndef CAFFE2_CORE_OPERATOR_SCHEMA_H_
 #define CAFFE2_CORE_OPERATOR_SCHEMA_H_
 
+#include <algorithm>
 #include <climits>
 #include <functional>
 #include <initializer_list>
@@ -27,6 +28,7 @@
 #include "caffe2/core/common.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/registry.h"
+#include "caffe2/core/types.h"
 #include "caffe2/proto/caffe2.pb.h"
 
 namespace caffe2 {
@@ -184,8 +186,9 @@ class OpSchema {
    * an operator such as FLOPs and total memory use.
    */
   struct Cost {
-    uint64_t flops; // Floating point operations.
-    uint64_t bytes_moved; // Total memory used.
+    uint64_t flops{0}; // Floating point operations.
+    uint64_t bytes_read{0}; // Memory read from the inputs.
+    uint64_t bytes_written{0}; // Memory written to the outputs.
   };
   /**
    * @brief Registers a function that takes in an OperatorDef
@@ -259,6 +262,10 @@ class OpSchema {
   // This op can pass data across devices
   OpSchema& InputsCanCrossDevices();
 
+  // The op reads the shape and type of these inputs but not their data, e.g.
+  // because it overwrites them in place, so GPUFallbackOp does not copy them.
+  OpSchema& ShapeOnlyInputs(set<int> inputs);
+
   /**
    * @brief A function to allow one to get the number of outputs based on the
    * number of inputs, if this schema supports it.
@@ -293,6 +300,15 @@ class OpSchema {
     return num_inputs_outputs_allowed_(x, y);
   }
 
+  bool inplace_allowed(int input_index, int output_index) const {
+    return inplace_allowed_(input_index, output_index) ||
+        inplace_enforced_(input_index, output_index);
+  }
+
+  bool inplace_enforced(int input_index, int output_index) const {
+    return inplace_enforced_(input_index, output_index);
+  }
+
   int inf() const {
     return std::numeric_limits<int>::max();
   }
@@ -315,6 +331,9 @@ class OpSchema {
   bool inputs_can_cross_devices() const {
     return inputs_can_cross_devices_;
   }
+  bool shape_only_input(int input_index) const {
+    return shape_only_inputs_.count(input_index) > 0;
+  }
 
   /**
    * @brief Returns the required device location of inputs and outputs.
@@ -346,6 +365,7 @@ class OpSchema {
   int max_output_ = std::numeric_limits<int>::max();
   bool private_ = false;
   bool inputs_can_cross_devices_ = false;
+  set<int> shape_only_inputs_;
   std::function<bool(int)> num_inputs_allowed_ = [](int) { return true; };
   std::function<bool(int)> num_outputs_allowed_ = [](int) { return true; };
   std::function<bool(int, int)> num_inputs_outputs_allowed_ = [](int, int) {
@@ -449,6 +469,58 @@ inline vector<TIndex> GetDimsVector(const TensorShape& shape) {
   return dims;
 }
 
+// Number of elements of a tensor shape from the given dimension on.
+inline uint64_t nElemFromDim(const TensorShape& X, int dim = 0) {
+  CAFFE_ENFORCE_GE(dim, 0, "Invalid dimension specified");
+  uint64_t nElem = 1;
+  for (int i = dim; i < X.dims_size(); ++i) {
+    nElem *= X.dims(i);
+  }
+  return nElem;
+}
+
+// Number of elements of a tensor shape in the dimensions [start, stop).
+inline uint64_t nElemBetweenDim(const TensorShape& X, int start, int stop) {
+  CAFFE_ENFORCE_GE(start, 0, "Invalid dimension specified");
+  CAFFE_ENFORCE_LE(stop, X.dims_size(), "Invalid dimension specified");
+  uint64_t nElem = 1;
+  for (int i = start; i < stop; ++i) {
+    nElem *= X.dims(i);
+  }
+  return nElem;
+}
+
+// Size in bytes of an element of a tensor shape, and of the whole tensor.
+// Both are 0 if its data type is not known.
+inline uint64_t ItemSize(const TensorShape& X) {
+  if (X.data_type() == TensorProto::UNDEFINED) {
+    return 0;
+  }
+  return DataTypeToTypeMeta(X.data_type()).itemsize();
+}
+
+inline uint64_t nBytes(const TensorShape& X) {
+  return nElemFromDim(X) * ItemSize(X);
+}
+
+// Cost of an operator that reads all its inputs, which are broadcast to the
+// largest of them, and writes an output of that size, doing OpsPerPoint
+// floating point operations per output value.
+template <uint64_t OpsPerPoint>
+OpSchema::Cost PointwiseCostInference(
+    const OperatorDef& /* unused */,
+    const vector<TensorShape>& inputs) {
+  struct OpSchema::Cost c;
+  uint64_t size = 0;
+  for (const auto& X : inputs) {
+    c.bytes_read += nBytes(X);
+    size = std::max(size, nElemFromDim(X));
+  }
+  c.flops = size * OpsPerPoint;
+  c.bytes_written = inputs.empty() ? 0 : size * ItemSize(inputs[0]);
+  return c;
+}
+
 // Helper function for infer op inputs and outputs device information.
 inline std::pair<std::vector<DeviceOption>, std::vector<DeviceOption>>
 InferOpInputOutputDevice(const OperatorDef& op) {
@@ -461,9 +533,44 @@ InferOpInputOutputDevice(const OperatorDef& op) {
 
 } // namespace caffe2
 
+// Selective build: when CAFFE2_USE_OPERATOR_WHITELIST is defined, only the
+// operators for which CAFFE2_OPERATOR_WHITELISTED_<name> is defined to 1 get
+// their schema, implementations and gradient registered. The registration
+// macros of all other operators expand to nothing, so their classes are never
+// instantiated and they leave no static initializers behind. CMake generates
+// these defines into macros.h from the file given as CAFFE2_OPERATOR_WHITELIST.
+// Operators registered by string, with the _STR macros, are always kept.
+#define CAFFE2_ONE_PLACEHOLDER_1 0,
+#define CAFFE2_TAKE_SECOND_ARG(ignored, value, ...) value
+#define CAFFE2_IS_ONE_IMPL2(one_or_junk) \
+  CAFFE2_TAKE_SECOND_ARG(one_or_junk 1, 0, 0)
+#define CAFFE2_IS_ONE_IMPL(x) CAFFE2_IS_ONE_IMPL2(CAFFE2_ONE_PLACEHOLDER_##x)
+// Expands to 1 if x is a macro defined to 1, and to 0 otherwise.
+#define CAFFE2_IS_ONE(x) CAFFE2_IS_ONE_IMPL(x)
+
+#ifdef CAFFE2_USE_OPERATOR_WHITELIST
+#define CAFFE2_OPERATOR_ENABLED(name) \
+  CAFFE2_IS_ONE(CAFFE2_OPERATOR_WHITELISTED_##name)
+#else
+#define CAFFE2_OPERATOR_ENABLED(name) 1
+#endif
+
+#define CAFFE2_IF_OPERATOR_ENABLED_0(...)
+#define CAFFE2_IF_OPERATOR_ENABLED_1(...) __VA_ARGS__
+// Expands to the given tokens only if the operator is registered.
+#define CAFFE2_IF_OPERATOR_ENABLED(name, ...) \
+  CAFFE_CONCATENATE(                          \
+      CAFFE2_IF_OPERATOR_ENABLED_, CAFFE2_OPERATOR_ENABLED(name))(__VA_ARGS__)
+
+// The schema of an operator that is not registered still has to accept the
+// chained setters, which are compiled but never run.
+#define CAFFE2_DISABLED_OPERATOR_SCHEMA(name)       \
+  static OpSchema* CAFFE_ANONYMOUS_VARIABLE(name) = \
+      1 ? nullptr : &OpSchemaRegistry::NewSchema(#name, __FILE__, __LINE__)
+
 #ifndef CAFFE2_NO_OPERATOR_SCHEMA
 
-#define OPERATOR_SCHEMA(name)                            \
+#define CAFFE2_OPERATOR_SCHEMA_1(name)                   \
   void CAFFE2_PLEASE_ADD_OPERATOR_SCHEMA_FOR_##name(){}; \
   static OpSchema* CAFFE_ANONYMOUS_VARIABLE(name) =      \
       &OpSchemaRegistry::NewSchema(#name, __FILE__, __LINE__)
@@ -473,14 +580,17 @@ InferOpInputOutputDevice(const OperatorDef& op) {
 
 #else // CAFFE2_NO_OPERATOR_SCHEMA
 
-#define OPERATOR_SCHEMA(name)                            \
+#define CAFFE2_OPERATOR_SCHEMA_1(name)                   \
   void CAFFE2_PLEASE_ADD_OPERATOR_SCHEMA_FOR_##name(){}; \
-  static OpSchema* CAFFE_ANONYMOUS_VARIABLE(name) =      \
-      1 ? nullptr : &OpSchemaRegistry::NewSchema(#name, __FILE__, __LINE__)
+  CAFFE2_DISABLED_OPERATOR_SCHEMA(name)
 #define OPERATOR_SCHEMA_STR(name)                                  \
   static OpSchema* CAFFE_ANONYMOUS_VARIABLE(schema_registration) = \
       1 ? nullptr : &OpSchemaRegistry::NewSchema(name, __FILE__, __LINE__)
 
 #endif // CAFFE2_NO_OPERATOR_SCHEMA
 
+#define CAFFE2_OPERATOR_SCHEMA_0(name) CAFFE2_DISABLED_OPERATOR_SCHEMA(name)
+#define OPERATOR_SCHEMA(name) \
+  CAFFE_CONCATENATE(CAFFE2_OPERATOR_SCHEMA_, CAFFE2_OPERATOR_ENABLED(name))(name)
+
 #endif // CAFFE2_CORE_OPERATOR_SCHEMA_H_
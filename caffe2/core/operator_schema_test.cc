@@ -292,4 +292,25 @@ TEST(OperatorSchemaTest, TestCostInference) {
   EXPECT_EQ(2000, schema->InferCost(def, shapes).flops);
 }
 
+TEST(OperatorSchemaTest, TestPointwiseCostInference) {
+  OperatorDef def = CreateOperatorDef(
+      "Add", "", vector<string>{"A", "B"}, vector<string>{"C"});
+  vector<TensorShape> shapes{
+      CreateTensorShape(vector<int>{4, 5}, TensorProto::FLOAT),
+      CreateTensorShape(vector<int>{5}, TensorProto::FLOAT)};
+  EXPECT_EQ(nElemFromDim(shapes[0]), 20);
+  EXPECT_EQ(nElemFromDim(shapes[0], 1), 5);
+  EXPECT_EQ(nElemBetweenDim(shapes[0], 0, 1), 4);
+  EXPECT_EQ(nBytes(shapes[0]), 80);
+
+  const auto c = PointwiseCostInference<2>(def, shapes);
+  EXPECT_EQ(c.flops, 40);
+  EXPECT_EQ(c.bytes_read, 100);
+  EXPECT_EQ(c.bytes_written, 80);
+
+  // Shapes of an unknown type have no size.
+  shapes[0].set_data_type(TensorProto::UNDEFINED);
+  EXPECT_EQ(nBytes(shapes[0]), 0);
+}
+
 }  // namespace caffe2
@@ -302,6 +302,39 @@ TEST(OperatorTest, TestOutputValues) {
   EXPECT_EQ(ws.GetBlob("output")->Get<int>(), 5);
 }
 
+TEST(OperatorTest, CachedInputsAndOutputsFollowBlobResets) {
+  Workspace ws;
+  Blob* input = ws.CreateBlob("input");
+  *input->GetMutable<int>() = 1;
+  OperatorDef op_def;
+  op_def.set_type("JustTest");
+  op_def.add_input("input");
+  op_def.add_output("output");
+  unique_ptr<OperatorBase> op(CreateOperator(op_def, &ws));
+  EXPECT_EQ(op->Input<int>(0), 1);
+  EXPECT_EQ(op->Input<int>(0), 1);
+  input->Reset(new int(2));
+  EXPECT_EQ(op->Input<int>(0), 2);
+  input->Reset(new float(3));
+  EXPECT_THROW(op->Input<int>(0), EnforceNotMet);
+  EXPECT_EQ(op->Input<float>(0), 3);
+  Blob other;
+  *other.GetMutable<float>() = 4;
+  input->swap(other);
+  EXPECT_EQ(op->Input<float>(0), 4);
+
+  Blob* output = ws.GetBlob("output");
+  int* output_int = op->Output<int>(0);
+  EXPECT_EQ(output_int, &output->Get<int>());
+  EXPECT_EQ(op->Output<int>(0), output_int);
+  output->Reset();
+  output_int = op->Output<int>(0);
+  EXPECT_EQ(output_int, &output->Get<int>());
+  output->GetMutable<float>();
+  output_int = op->Output<int>(0);
+  EXPECT_EQ(output_int, &output->Get<int>());
+}
+
 NetDef GetNetDefForTest() {
   NetDef net_def;
   OperatorDef op_def;
@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Builds this file as if only WhitelistKeptOp had been whitelisted, see
+// CAFFE2_USE_OPERATOR_WHITELIST in operator_schema.h.
+#define CAFFE2_USE_OPERATOR_WHITELIST
+#define CAFFE2_OPERATOR_WHITELISTED_WhitelistKeptOp 1
+
+#include "caffe2/core/operator.h"
+#include "caffe2/core/operator_gradient.h"
+#include "caffe2/core/operator_schema.h"
+
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+class WhitelistTestOp final : public OperatorBase {
+ public:
+  using OperatorBase::OperatorBase;
+  bool Run(int /* unused */ /*stream_id*/) override {
+    return true;
+  }
+};
+
+// Fails to compile if it gets instantiated.
+template <typename T>
+class WhitelistDroppedTestOp final : public OperatorBase {
+ public:
+  WhitelistDroppedTestOp(const OperatorDef& def, Workspace* ws)
+      : OperatorBase(def, ws) {
+    static_assert(
+        sizeof(T) == 0, "A dropped operator should not be instantiated");
+  }
+  bool Run(int /* unused */ /*stream_id*/) override {
+    return true;
+  }
+};
+
+} // namespace
+
+OPERATOR_SCHEMA(WhitelistKeptOp).NumInputs(0).NumOutputs(0);
+REGISTER_CPU_OPERATOR(WhitelistKeptOp, WhitelistTestOp);
+NO_GRADIENT(WhitelistKeptOp);
+
+OPERATOR_SCHEMA(WhitelistDroppedOp).NumInputs(0).NumOutputs(0);
+REGISTER_CPU_OPERATOR(WhitelistDroppedOp, WhitelistDroppedTestOp<float>);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    WhitelistDroppedOp,
+    ENGINE,
+    WhitelistDroppedTestOp<float>);
+NO_GRADIENT(WhitelistDroppedOp);
+
+TEST(OperatorWhitelistTest, OnlyWhitelistedOperatorsAreRegistered) {
+  EXPECT_EQ(CAFFE2_OPERATOR_ENABLED(WhitelistKeptOp), 1);
+  EXPECT_EQ(CAFFE2_OPERATOR_ENABLED(WhitelistDroppedOp), 0);
+
+  EXPECT_TRUE(CPUOperatorRegistry()->Has("WhitelistKeptOp"));
+  EXPECT_TRUE(GradientRegistry()->Has("WhitelistKeptOp"));
+  EXPECT_FALSE(CPUOperatorRegistry()->Has("WhitelistDroppedOp"));
+  EXPECT_FALSE(
+      CPUOperatorRegistry()->Has("WhitelistDroppedOp_ENGINE_ENGINE"));
+  EXPECT_FALSE(GradientRegistry()->Has("WhitelistDroppedOp"));
+  EXPECT_TRUE(OpSchemaRegistry::Schema("WhitelistDroppedOp") == nullptr);
+#ifndef CAFFE2_NO_OPERATOR_SCHEMA
+  EXPECT_TRUE(OpSchemaRegistry::Schema("WhitelistKeptOp") != nullptr);
+#endif
+}
+
+} // namespace caffe2
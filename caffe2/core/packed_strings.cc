@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/packed_strings.h"
+
+#include "caffe2/core/blob_serialization.h"
+#include "caffe2/core/blob_stats.h"
+
+namespace caffe2 {
+
+CAFFE_KNOWN_TYPE(PackedStrings);
+
+void PackedStrings::Assign(
+    const vector<TIndex>& dims,
+    std::string bytes,
+    vector<TIndex> offsets) {
+  Reset(dims);
+  CAFFE_ENFORCE_EQ(offsets.size(), size_ + 1);
+  CAFFE_ENFORCE_EQ(offsets.front(), 0);
+  CAFFE_ENFORCE_EQ(offsets.back(), bytes.size());
+  for (size_t i = 1; i < offsets.size(); ++i) {
+    CAFFE_ENFORCE_LE(offsets[i - 1], offsets[i], "Offsets must not decrease");
+  }
+  bytes_ = std::move(bytes);
+  offsets_ = std::move(offsets);
+}
+
+void PackedStrings::CopyFrom(const TensorCPU& strings) {
+  const auto* data = strings.data<std::string>();
+  size_t nbytes = 0;
+  for (TIndex i = 0; i < strings.size(); ++i) {
+    nbytes += data[i].size();
+  }
+  Reset(strings.dims(), nbytes);
+  for (TIndex i = 0; i < strings.size(); ++i) {
+    Add(data[i]);
+  }
+}
+
+void PackedStrings::CopyTo(TensorCPU* strings) const {
+  CAFFE_ENFORCE(IsComplete(), "Not all the elements have been added");
+  strings->Resize(dims_);
+  auto* data = strings->mutable_data<std::string>();
+  for (TIndex i = 0; i < size_; ++i) {
+    data[i].assign(this->data(i), length(i));
+  }
+}
+
+namespace {
+
+constexpr auto kPackedStringsBlobType = "PackedStrings";
+
+// A packing is serialized as a BYTE tensor of its dimensions holding the
+// bytes in byte_data, and the offsets in int64_data, so that neither side
+// handles the elements one by one.
+class PackedStringsSerializer : public BlobSerializerBase {
+ public:
+  void Serialize(
+      const Blob& blob,
+      const string& name,
+      SerializationAcceptor acceptor) override {
+    const auto& strings = blob.Get<PackedStrings>();
+    CAFFE_ENFORCE(strings.IsComplete(), "Not all the elements have been added");
+    BlobProto blob_proto;
+    blob_proto.set_name(name);
+    blob_proto.set_type(kPackedStringsBlobType);
+    auto* proto = blob_proto.mutable_tensor();
+    proto->set_name(name);
+    proto->set_data_type(TensorProto_DataType_BYTE);
+    for (const auto d : strings.dims()) {
+      proto->add_dims(d);
+    }
+    proto->set_byte_data(strings.bytes());
+    const auto& offsets = strings.offsets();
+    proto->mutable_int64_data()->Reserve(offsets.size());
+    for (const auto offset : offsets) {
+      proto->add_int64_data(offset);
+    }
+    acceptor(name, blob_proto.SerializeAsString());
+  }
+};
+
+class PackedStringsDeserializer : public BlobDeserializerBase {
+ public:
+  void Deserialize(const BlobProto& blob_proto, Blob* blob) override {
+    const auto& proto = blob_proto.tensor();
+    vector<TIndex> dims(proto.dims().begin(), proto.dims().end());
+    vector<TIndex> offsets(
+        proto.int64_data().begin(), proto.int64_data().end());
+    blob->GetMutable<PackedStrings>()->Assign(
+        dims, proto.byte_data(), std::move(offsets));
+  }
+};
+
+struct PackedStringsStatGetter : BlobStatGetter {
+  size_t sizeBytes(const Blob& blob) const override {
+    const auto& strings = blob.Get<PackedStrings>();
+    return strings.nbytes() + strings.offsets().size() * sizeof(TIndex);
+  }
+};
+REGISTER_BLOB_STAT_GETTER(PackedStrings, PackedStringsStatGetter);
+
+} // namespace
+
+REGISTER_BLOB_SERIALIZER(
+    (TypeMeta::Id<PackedStrings>()),
+    PackedStringsSerializer);
+REGISTER_BLOB_DESERIALIZER(PackedStrings, PackedStringsDeserializer);
+
+} // namespace caffe2
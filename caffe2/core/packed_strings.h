@@ -0,0 +1,166 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_PACKED_STRINGS_H_
+#define CAFFE2_CORE_PACKED_STRINGS_H_
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/tensor.h"
+
+namespace caffe2 {
+
+/**
+ * @brief A tensor of strings stored as one byte buffer and the offsets of
+ * the elements in it.
+ *
+ * A tensor of std::string allocates every element on its own, which for
+ * millions of short strings costs as many heap allocations and scatters the
+ * bytes over the heap. PackedStrings keeps the bytes of all elements back to
+ * back, so building one takes a handful of allocations and reading one walks
+ * memory in order. Elements are appended in order, either in one piece with
+ * Add() or in several with Append() followed by EndElement().
+ *
+ * The elements are read with data() and length(), or copied out with str()
+ * for code that needs std::string. CopyFrom() and CopyTo() convert from and
+ * to a tensor of std::string.
+ */
+class PackedStrings {
+ public:
+  PackedStrings() : dims_(1, 0), offsets_(1, 0) {}
+
+  /**
+   * Removes all elements and sets the dimensions of the elements appended
+   * next. expected_bytes, if known, reserves the byte buffer.
+   */
+  void Reset(const vector<TIndex>& dims, size_t expected_bytes = 0) {
+    dims_ = dims;
+    size_ = 1;
+    for (const auto d : dims_) {
+      size_ *= d;
+    }
+    bytes_.clear();
+    bytes_.reserve(expected_bytes);
+    offsets_.resize(1);
+    offsets_.reserve(size_ + 1);
+  }
+
+  /** Appends bytes to the element being built. */
+  void Append(const char* data, size_t length) {
+    bytes_.append(data, length);
+  }
+
+  /** Ends the element being built. */
+  void EndElement() {
+    DCHECK_LT(offsets_.size(), size_ + 1);
+    offsets_.push_back(bytes_.size());
+  }
+
+  /** Appends a whole element. */
+  void Add(const char* data, size_t length) {
+    Append(data, length);
+    EndElement();
+  }
+
+  void Add(const std::string& str) {
+    Add(str.data(), str.size());
+  }
+
+  /** Whether all the elements of the dimensions have been appended. */
+  bool IsComplete() const {
+    return offsets_.size() == size_ + 1;
+  }
+
+  const vector<TIndex>& dims() const {
+    return dims_;
+  }
+
+  int ndim() const {
+    return dims_.size();
+  }
+
+  TIndex dim(int i) const {
+    return dims_.at(i);
+  }
+
+  TIndex size() const {
+    return size_;
+  }
+
+  /** Total length of the elements. */
+  size_t nbytes() const {
+    return bytes_.size();
+  }
+
+  const char* data(TIndex i) const {
+    DCHECK_LT(i + 1, offsets_.size());
+    return bytes_.data() + offsets_[i];
+  }
+
+  size_t length(TIndex i) const {
+    DCHECK_LT(i + 1, offsets_.size());
+    return offsets_[i + 1] - offsets_[i];
+  }
+
+  /** Copies element i into a std::string. */
+  std::string str(TIndex i) const {
+    return std::string(data(i), length(i));
+  }
+
+  bool EqualTo(TIndex i, const std::string& str) const {
+    return length(i) == str.size() &&
+        std::memcmp(data(i), str.data(), str.size()) == 0;
+  }
+
+  /** The bytes of all the elements, back to back. */
+  const std::string& bytes() const {
+    return bytes_;
+  }
+
+  /** size() + 1 offsets into bytes(), element i spanning [i, i + 1). */
+  const vector<TIndex>& offsets() const {
+    return offsets_;
+  }
+
+  /**
+   * Replaces the elements with the bytes and offsets of another packing,
+   * e.g. a deserialized one.
+   */
+  void Assign(
+      const vector<TIndex>& dims,
+      std::string bytes,
+      vector<TIndex> offsets);
+
+  /** Packs a tensor of std::string. */
+  void CopyFrom(const TensorCPU& strings);
+
+  /** Unpacks into a tensor of std::string of the same dimensions. */
+  void CopyTo(TensorCPU* strings) const;
+
+ private:
+  vector<TIndex> dims_;
+  TIndex size_{0};
+  std::string bytes_;
+  vector<TIndex> offsets_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_PACKED_STRINGS_H_
@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "caffe2/core/blob.h"
+#include "caffe2/core/blob_serialization.h"
+#include "caffe2/core/packed_strings.h"
+
+namespace caffe2 {
+
+TEST(PackedStringsTest, AddAndAppend) {
+  PackedStrings strings;
+  EXPECT_TRUE(strings.IsComplete());
+  strings.Reset({3});
+  strings.Add("abc");
+  strings.Append("de", 2);
+  strings.Append("f", 1);
+  EXPECT_FALSE(strings.IsComplete());
+  strings.EndElement();
+  strings.Add("");
+  EXPECT_TRUE(strings.IsComplete());
+  EXPECT_EQ(strings.size(), 3);
+  EXPECT_EQ(strings.nbytes(), 6);
+  EXPECT_EQ(strings.str(0), "abc");
+  EXPECT_EQ(strings.str(1), "def");
+  EXPECT_EQ(strings.length(2), 0);
+  EXPECT_TRUE(strings.EqualTo(1, "def"));
+  EXPECT_FALSE(strings.EqualTo(1, "de"));
+  EXPECT_EQ(strings.bytes(), "abcdef");
+  EXPECT_EQ(strings.offsets(), vector<TIndex>({0, 3, 6, 6}));
+}
+
+TEST(PackedStringsTest, CopyFromAndTo) {
+  TensorCPU tensor(vector<TIndex>{2, 2});
+  auto* data = tensor.mutable_data<std::string>();
+  data[0] = "x";
+  data[1] = "";
+  data[2] = std::string("a\0b", 3);
+  data[3] = "hello";
+  PackedStrings strings;
+  strings.CopyFrom(tensor);
+  EXPECT_EQ(strings.dims(), vector<TIndex>({2, 2}));
+  EXPECT_EQ(strings.length(2), 3);
+
+  TensorCPU copy;
+  strings.CopyTo(&copy);
+  EXPECT_EQ(copy.dims(), tensor.dims());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(copy.data<std::string>()[i], data[i]);
+  }
+}
+
+TEST(PackedStringsTest, SerializationRoundTrip) {
+  Blob blob;
+  auto* strings = blob.GetMutable<PackedStrings>();
+  strings->Reset({2, 1});
+  strings->Add("first");
+  strings->Add("second");
+  const auto serialized = blob.Serialize("strings");
+
+  Blob loaded;
+  loaded.Deserialize(serialized);
+  ASSERT_TRUE(loaded.IsType<PackedStrings>());
+  const auto& result = loaded.Get<PackedStrings>();
+  EXPECT_EQ(result.dims(), vector<TIndex>({2, 1}));
+  EXPECT_EQ(result.str(0), "first");
+  EXPECT_EQ(result.str(1), "second");
+
+  // An incomplete packing is not serialized.
+  strings->Reset({2});
+  strings->Add("only");
+  EXPECT_THROW(blob.Serialize("strings"), EnforceNotMet);
+}
+
+} // namespace caffe2
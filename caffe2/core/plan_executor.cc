@@ -17,6 +17,7 @@
 #include "caffe2/core/plan_executor.h"
 
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -158,6 +159,71 @@ struct WorkspaceIdInjector {
 const string WorkspaceIdInjector::NODE_ID = "NODE_ID";
 const string WorkspaceIdInjector::GLOBAL_WORKSPACE_ID = "GLOBAL_WORKSPACE_ID";
 
+/**
+ * Runs a job on a fixed set of threads, all at once, every time Run() is
+ * called. The threads are kept between runs and wait on a condition variable,
+ * so that steps with many short iterations don't create threads for each.
+ */
+class ConcurrentRunner {
+ public:
+  ConcurrentRunner(size_t numThreads, std::function<void(int)> job)
+      : job_(std::move(job)) {
+    for (size_t i = 0; i < numThreads; ++i) {
+      threads_.emplace_back([this, i]() { loop(i); });
+    }
+  }
+
+  ~ConcurrentRunner() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      exit_ = true;
+    }
+    startCv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Runs the job on every thread and waits for all of them to finish.
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    pending_ = threads_.size();
+    ++generation_;
+    startCv_.notify_all();
+    doneCv_.wait(lock, [this]() { return pending_ == 0; });
+  }
+
+ private:
+  void loop(int threadId) {
+    int64_t generation = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        startCv_.wait(
+            lock, [&]() { return exit_ || generation_ != generation; });
+        if (exit_) {
+          return;
+        }
+        generation = generation_;
+      }
+      job_(threadId);
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (--pending_ == 0) {
+        doneCv_.notify_one();
+      }
+    }
+  }
+
+  std::function<void(int)> job_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable startCv_;
+  std::condition_variable doneCv_;
+  int64_t generation_{0};
+  size_t pending_{0};
+  bool exit_{false};
+};
+
 struct CompiledExecutionStep;
 
 /**
@@ -400,6 +466,11 @@ bool ExecuteStepRecursive(ExecutionStepWrapper& stepWrapper) {
         (!step.concurrent_substeps() || step.substep().size() <= 1) &&
         (!step.has_num_concurrent_instances() ||
          step.num_concurrent_instances() <= 1);
+    std::mutex exception_mutex;
+    string first_exception;
+    // Threads of the concurrent substeps, created on the first iteration and
+    // kept for the following ones. Each thread runs the same substep.
+    std::unique_ptr<ConcurrentRunner> runner;
     for (int64_t iter = 0; compiledStep->shouldContinue(iter); ++iter) {
       if (sequential) {
         VLOG(1) << "Executing step " << step.name() << " iteration " << iter;
@@ -413,12 +484,9 @@ bool ExecuteStepRecursive(ExecutionStepWrapper& stepWrapper) {
         VLOG(1) << "Executing step " << step.name() << " iteration " << iter
                 << " with " << step.substep().size() << " concurrent substeps";
 
-        std::atomic<int> next_substep{0};
-        std::mutex exception_mutex;
-        string first_exception;
-        auto worker = [&]() {
+        auto worker = [&](int thread_id) {
           auto num_substeps = compiledStep->recurringSubsteps.size();
-          int substep_id = next_substep++ % num_substeps;
+          int substep_id = thread_id % num_substeps;
           if (compiledStep->gotFailure) {
             return;
           }
@@ -444,17 +512,14 @@ bool ExecuteStepRecursive(ExecutionStepWrapper& stepWrapper) {
           }
         };
 
-        std::vector<std::thread> threads;
-        auto numThreads = compiledStep->recurringSubsteps.size();
-        if (step.has_num_concurrent_instances()) {
-          numThreads *= step.num_concurrent_instances();
-        }
-        for (int64_t i = 0; i < numThreads; ++i) {
-          threads.emplace_back(worker);
-        }
-        for (auto& thread : threads) {
-          thread.join();
+        if (!runner) {
+          auto numThreads = compiledStep->recurringSubsteps.size();
+          if (step.has_num_concurrent_instances()) {
+            numThreads *= step.num_concurrent_instances();
+          }
+          runner = caffe2::make_unique<ConcurrentRunner>(numThreads, worker);
         }
+        runner->Run();
         if (compiledStep->gotFailure) {
           LOG(ERROR) << "One of the workers failed.";
           if (first_exception.size()) {
@@ -15,37 +15,46 @@
  */
 
 #include "caffe2/core/predictor.h"
+#include "caffe2/core/types.h"
 
+#include <algorithm>
+#include <cstring>
 #include <unordered_set>
 
 namespace caffe2 {
 
 namespace {
 
-void enforceIsTensor(Workspace* ws, const std::string& name) {
-  auto blob = ws->GetBlob(name);
+// Looks the blob up once and checks that it holds a CPU tensor.
+Blob* getTensorBlob(Workspace* ws, const std::string& name) {
+  auto* blob = ws->GetBlob(name);
   CAFFE_ENFORCE(blob, "Blob does not exist: ", name);
   CAFFE_ENFORCE(
       blob->template IsType<TensorCPU>(), "Blob is not a CPU Tensor: ", name);
+  return blob;
 }
 
 void shareInputTensor(
     Workspace* ws,
     const std::string& name,
     TensorCPU* input) {
-  enforceIsTensor(ws, name);
-  auto* blob = ws->GetBlob(name);
-  CAFFE_ENFORCE(blob, "Blob: ", name, " does not exist");
-  auto* tensor = blob->template GetMutable<TensorCPU>();
+  auto* tensor = getTensorBlob(ws, name)->template GetMutable<TensorCPU>();
   tensor->ResizeLike(*input);
   tensor->ShareData(*input);
 }
 
 TensorCPU* extractOutputTensor(Workspace* ws, const std::string& name) {
-  enforceIsTensor(ws, name);
-  auto* blob = ws->GetBlob(name);
-  CAFFE_ENFORCE(blob, "Blob: ", name, " does not exist");
-  return blob->template GetMutable<TensorCPU>();
+  return getTensorBlob(ws, name)->template GetMutable<TensorCPU>();
+}
+
+// Reads a byte of every page, which maps the pages that are not resident,
+// e.g. of parameters loaded through mmap, without copying them.
+void faultInPages(const void* data, size_t nbytes) {
+  constexpr size_t kPageSize = 4096;
+  const volatile char* bytes = static_cast<const volatile char*>(data);
+  for (size_t i = 0; i < nbytes; i += kPageSize) {
+    (void)bytes[i];
+  }
 }
 
 const NetDef& getNet(const MetaNetDef& def, const std::string& name) {
@@ -92,15 +101,21 @@ Predictor::Predictor(
 
   // real model inputs can be fed later in run* functions
   const auto& initialized_vec = ws_.Blobs();
-  const std::unordered_set<std::string> initialized{initialized_vec.begin(),
-                                                    initialized_vec.end()};
+  parameterNames_.insert(initialized_vec.begin(), initialized_vec.end());
   for (const auto& name : run_net.external_input()) {
-    if (!initialized.count(name)) {
+    if (!parameterNames_.count(name)) {
       auto* blob = ws_.CreateBlob(name);
       blob->template GetMutable<TensorCPU>();
     }
   }
-  CAFFE_ENFORCE(ws_.CreateNet(run_net));
+  net_ = ws_.CreateNet(run_net);
+  CAFFE_ENFORCE(net_);
+  for (const auto& name : run_net.external_input()) {
+    inputBlobs_.push_back(ws_.GetBlob(name));
+  }
+  for (const auto& name : run_net.external_output()) {
+    outputBlobs_.push_back(ws_.CreateBlob(name));
+  }
 }
 
 Predictor::~Predictor() {}
@@ -108,20 +123,159 @@ Predictor::~Predictor() {}
 bool Predictor::run(const TensorVector& inputs, TensorVector* outputs) {
   CAFFE_ENFORCE(inputs.size() <= run_net_.external_input_size());
   for (auto i = 0; i < inputs.size(); ++i) {
-    shareInputTensor(&ws_, run_net_.external_input(i), inputs[i]);
+    auto* blob = inputBlobs_[i];
+    CAFFE_ENFORCE(
+        blob->template IsType<TensorCPU>(),
+        "Blob is not a CPU Tensor: ",
+        run_net_.external_input(i));
+    auto* tensor = blob->template GetMutable<TensorCPU>();
+    tensor->ResizeLike(*inputs[i]);
+    tensor->ShareData(*inputs[i]);
+  }
+  return runNet(outputs);
+}
+
+bool Predictor::run_buffers(
+    const InputBufferVector& inputs,
+    OutputViewVector* outputs) {
+  CAFFE_ENFORCE(inputs.size() <= run_net_.external_input_size());
+  for (auto i = 0; i < inputs.size(); ++i) {
+    const auto& input = inputs[i];
+    auto* blob = inputBlobs_[i];
+    CAFFE_ENFORCE(
+        blob->template IsType<TensorCPU>(),
+        "Blob is not a CPU Tensor: ",
+        run_net_.external_input(i));
+    auto* tensor = blob->template GetMutable<TensorCPU>();
+    tensor->Resize(input.dims);
+    if (input.deleter) {
+      tensor->ShareExternalPointer(input.data, input.meta, 0, input.deleter);
+    } else {
+      tensor->ShareExternalPointer(input.data, input.meta);
+    }
   }
 
-  if (!ws_.RunNet(run_net_.name())) {
+  if (!net_->Run()) {
     return false;
   }
 
-  outputs->resize(run_net_.external_output_size());
+  outputs->resize(outputBlobs_.size());
+  for (auto i = 0; i < outputs->size(); ++i) {
+    (*outputs)[i] = &outputBlobs_[i]->template Get<TensorCPU>();
+  }
+  return true;
+}
+
+bool Predictor::runNet(TensorVector* outputs) {
+  if (!net_->Run()) {
+    return false;
+  }
+
+  outputs->resize(outputBlobs_.size());
   for (auto i = 0; i < outputs->size(); ++i) {
-    (*outputs)[i] = extractOutputTensor(&ws_, run_net_.external_output(i));
+    CAFFE_ENFORCE(
+        outputBlobs_[i]->template IsType<TensorCPU>(),
+        "Blob is not a CPU Tensor: ",
+        run_net_.external_output(i));
+    (*outputs)[i] = outputBlobs_[i]->template GetMutable<TensorCPU>();
+  }
+  return true;
+}
+
+bool Predictor::warmup(const std::vector<TensorVector>& sample_inputs) {
+  for (const auto& name : parameterNames_) {
+    const auto* blob = ws_.GetBlob(name);
+    if (blob && blob->template IsType<TensorCPU>()) {
+      const auto& tensor = blob->template Get<TensorCPU>();
+      if (tensor.size() > 0 && tensor.meta().id() != TypeMeta().id()) {
+        faultInPages(tensor.raw_data(), tensor.nbytes());
+      }
+    }
+  }
+  for (const auto& inputs : sample_inputs) {
+    TensorVector outputs;
+    if (!run(inputs, &outputs)) {
+      return false;
+    }
+    recordAllocations();
   }
   return true;
 }
 
+void Predictor::recordAllocations() {
+  std::unordered_set<std::string> inputs(
+      run_net_.external_input().begin(), run_net_.external_input().end());
+  for (const auto& name : ws_.LocalBlobs()) {
+    if (parameterNames_.count(name) || inputs.count(name)) {
+      continue;
+    }
+    const auto* blob = ws_.GetBlob(name);
+    if (!blob->template IsType<TensorCPU>()) {
+      continue;
+    }
+    const auto& tensor = blob->template Get<TensorCPU>();
+    const auto data_type = TypeMetaToDataType(tensor.meta());
+    if (data_type == TensorProto_DataType_UNDEFINED) {
+      continue;
+    }
+    auto& shape = allocations_[name];
+    if (shape.has_name()) {
+      size_t nbytes = DataTypeToTypeMeta(shape.data_type()).itemsize();
+      for (const auto dim : shape.dims()) {
+        nbytes *= dim;
+      }
+      if (tensor.nbytes() <= nbytes) {
+        continue;
+      }
+    }
+    shape.set_name(name);
+    shape.set_data_type(data_type);
+    shape.clear_dims();
+    for (const auto dim : tensor.dims()) {
+      shape.add_dims(dim);
+    }
+  }
+}
+
+TensorShapes Predictor::allocationSnapshot() const {
+  std::vector<std::string> names;
+  for (const auto& allocation : allocations_) {
+    names.push_back(allocation.first);
+  }
+  std::sort(names.begin(), names.end());
+  TensorShapes snapshot;
+  for (const auto& name : names) {
+    *snapshot.add_shapes() = allocations_.at(name);
+  }
+  return snapshot;
+}
+
+void Predictor::restoreAllocations(const TensorShapes& snapshot) {
+  std::unordered_set<std::string> inputs(
+      run_net_.external_input().begin(), run_net_.external_input().end());
+  for (const auto& shape : snapshot.shapes()) {
+    const auto& name = shape.name();
+    if (name.empty() || parameterNames_.count(name) || inputs.count(name)) {
+      continue;
+    }
+    auto* blob = ws_.CreateBlob(name);
+    if (blob->meta().id() != TypeMeta().id() &&
+        !blob->template IsType<TensorCPU>()) {
+      continue;
+    }
+    const auto& meta = DataTypeToTypeMeta(shape.data_type());
+    auto* tensor = blob->template GetMutable<TensorCPU>();
+    tensor->Resize(
+        std::vector<TIndex>(shape.dims().begin(), shape.dims().end()));
+    void* data = tensor->raw_mutable_data(meta);
+    if (!meta.ctor()) {
+      // Writing the pages maps them, reading them could map the zero page.
+      memset(data, 0, tensor->nbytes());
+    }
+    allocations_[name] = shape;
+  }
+}
+
 bool Predictor::run_map(const TensorMap& inputs, TensorVector* outputs) {
   if (!inputNames_.empty()) {
     CAFFE_ENFORCE_EQ(inputs.size(), inputNames_.size());
@@ -132,15 +286,175 @@ bool Predictor::run_map(const TensorMap& inputs, TensorVector* outputs) {
     }
     shareInputTensor(&ws_, input.first, input.second);
   }
+  return runNet(outputs);
+}
 
-  if (!ws_.RunNet(run_net_.name())) {
-    return false;
+ConcurrentPredictor::ConcurrentPredictor(
+    const MetaNetDef& def,
+    Workspace* parent)
+    : ConcurrentPredictor(
+          getNet(
+              def,
+              PredictorConsts::default_instance().global_init_net_type()),
+          getNet(def, PredictorConsts::default_instance().predict_net_type()),
+          parent) {
+  const auto& inputs =
+      getBlobs(def, PredictorConsts::default_instance().inputs_blob_type());
+  for (const auto& input : inputs) {
+    inputNames_.insert(input);
   }
+}
+
+ConcurrentPredictor::ConcurrentPredictor(
+    const NetDef& init_net,
+    const NetDef& run_net,
+    Workspace* parent)
+    : run_net_(run_net), ws_(parent) {
+  CAFFE_ENFORCE(ws_.RunNetOnce(init_net));
+
+  // The parameters are shared by all callers, so run_net has to treat them
+  // as read-only.
+  for (const auto& op : run_net_.op()) {
+    for (const auto& output : op.output()) {
+      CAFFE_ENFORCE(
+          !ws_.HasBlob(output),
+          "run_net writes to blob ",
+          output,
+          " which is initialized by init_net, this is not supported by "
+          "ConcurrentPredictor.");
+    }
+  }
+  // Create the first session eagerly to validate run_net.
+  releaseSession(acquireSession());
+}
+
+ConcurrentPredictor::~ConcurrentPredictor() {}
+
+std::unique_ptr<ConcurrentPredictor::Session>
+ConcurrentPredictor::acquireSession() {
+  {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    if (!free_sessions_.empty()) {
+      auto session = std::move(free_sessions_.back());
+      free_sessions_.pop_back();
+      return session;
+    }
+  }
+  auto session = caffe2::make_unique<Session>();
+  session->ws =
+      caffe2::make_unique<Workspace>(static_cast<const Workspace*>(&ws_));
+  // real model inputs can be fed later in run* functions
+  for (const auto& name : run_net_.external_input()) {
+    if (!ws_.HasBlob(name)) {
+      auto* blob = session->ws->CreateBlob(name);
+      blob->template GetMutable<TensorCPU>();
+    }
+  }
+  session->net = session->ws->CreateNet(run_net_);
+  CAFFE_ENFORCE(session->net);
+  ++num_sessions_;
+  return session;
+}
+
+void ConcurrentPredictor::releaseSession(std::unique_ptr<Session> session) {
+  std::lock_guard<std::mutex> lock(sessions_mutex_);
+  free_sessions_.push_back(std::move(session));
+}
+
+void ConcurrentPredictor::feedInput(
+    Session* session,
+    const std::string& name,
+    TensorCPU* input) {
+  // Feeding a blob of the shared workspace would race with other callers.
+  CAFFE_ENFORCE(
+      !ws_.HasBlob(name), "Cannot feed blob initialized by init_net: ", name);
+  shareInputTensor(session->ws.get(), name, input);
+}
 
+bool ConcurrentPredictor::runSession(Session* session, OutputVector* outputs) {
+  if (!session->net->Run()) {
+    return false;
+  }
   outputs->resize(run_net_.external_output_size());
   for (auto i = 0; i < outputs->size(); ++i) {
-    (*outputs)[i] = extractOutputTensor(&ws_, run_net_.external_output(i));
+    (*outputs)[i].CopyFrom(
+        *extractOutputTensor(session->ws.get(), run_net_.external_output(i)));
   }
   return true;
 }
+
+ConcurrentPredictor::RunScope::RunScope(ConcurrentPredictor* predictor)
+    : predictor_(predictor) {
+  std::unique_lock<std::mutex> lock(predictor_->epoch_mutex_);
+  predictor_->epoch_cv_.wait(
+      lock, [predictor]() { return !predictor->swapping_; });
+  ++predictor_->active_runs_;
+}
+
+ConcurrentPredictor::RunScope::~RunScope() {
+  std::lock_guard<std::mutex> lock(predictor_->epoch_mutex_);
+  if (--predictor_->active_runs_ == 0) {
+    predictor_->epoch_cv_.notify_all();
+  }
+}
+
+void ConcurrentPredictor::swapParameters(const NetDef& init_net) {
+  {
+    std::unique_lock<std::mutex> lock(epoch_mutex_);
+    epoch_cv_.wait(lock, [this]() { return !swapping_; });
+    swapping_ = true;
+    epoch_cv_.wait(lock, [this]() { return active_runs_ == 0; });
+  }
+  bool success = false;
+  try {
+    success = ws_.RunNetOnce(init_net);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(epoch_mutex_);
+    swapping_ = false;
+    epoch_cv_.notify_all();
+    throw;
+  }
+  {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    free_sessions_.clear();
+  }
+  std::lock_guard<std::mutex> lock(epoch_mutex_);
+  swapping_ = false;
+  ++epoch_;
+  epoch_cv_.notify_all();
+  CAFFE_ENFORCE(success, "Failed to run init_net ", init_net.name());
+}
+
+bool ConcurrentPredictor::run(
+    const TensorVector& inputs,
+    OutputVector* outputs) {
+  CAFFE_ENFORCE(inputs.size() <= run_net_.external_input_size());
+  RunScope scope(this);
+  auto session = acquireSession();
+  for (auto i = 0; i < inputs.size(); ++i) {
+    feedInput(session.get(), run_net_.external_input(i), inputs[i]);
+  }
+  const bool success = runSession(session.get(), outputs);
+  releaseSession(std::move(session));
+  return success;
+}
+
+bool ConcurrentPredictor::run_map(
+    const TensorMap& inputs,
+    OutputVector* outputs) {
+  if (!inputNames_.empty()) {
+    CAFFE_ENFORCE_EQ(inputs.size(), inputNames_.size());
+  }
+  RunScope scope(this);
+  auto session = acquireSession();
+  for (auto input : inputs) {
+    if (!inputNames_.empty()) {
+      CAFFE_ENFORCE_GT(inputNames_.count(input.first), 0);
+    }
+    feedInput(session.get(), input.first, input.second);
+  }
+  const bool success = runSession(session.get(), outputs);
+  releaseSession(std::move(session));
+  return success;
+}
 } // namespace caffe2
@@ -16,6 +16,10 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 #include "caffe2/core/net.h"
 #include "caffe2/core/tensor.h"
@@ -29,6 +33,20 @@ class Predictor {
   using TensorVector = std::vector<TensorCPU*>;
   using TensorMap = std::unordered_map<std::string, TensorCPU*>;
 
+  // A caller owned buffer that is aliased into an input blob without a copy.
+  // If `deleter` is set, it is called with `data` once the blob stops
+  // referencing the buffer, otherwise the caller has to keep the buffer alive
+  // until the next call.
+  struct InputBuffer {
+    void* data;
+    TypeMeta meta;
+    std::vector<TIndex> dims;
+    std::function<void(void*)> deleter;
+  };
+  using InputBufferVector = std::vector<InputBuffer>;
+  // Views of the output tensors, valid until the next run.
+  using OutputViewVector = std::vector<const TensorCPU*>;
+
   // MetaNetDef contains 'init_net', 'run_net', and meta-info
   // The meta-info is used to verify inputs are correctly passed
   Predictor(const MetaNetDef& net, Workspace* parent = nullptr);
@@ -57,6 +75,31 @@ class Predictor {
   // Similar to run, but consumes a map of name to tensor as input
   bool run_map(const TensorMap& inputs, TensorVector* outputs);
 
+  // Similar to run, but the first `inputs.size()` external inputs alias the
+  // given raw buffers, and the outputs are returned as views into the
+  // workspace. Input and output blobs are resolved once at construction.
+  bool run_buffers(const InputBufferVector& inputs, OutputViewVector* outputs);
+
+  // Gets the predictor to its steady-state latency before it serves: faults
+  // in the pages of the parameters, then runs `run_net` once on every set of
+  // sample inputs, which should cover the shapes that will be served. The
+  // runs allocate the intermediate blobs and fill the per-shape caches of the
+  // operators, such as the cuDNN algorithms (which persist across processes
+  // with --caffe2_cudnn_algo_cache_file). The largest allocation of every
+  // blob is recorded for allocationSnapshot.
+  // Returns true on success
+  bool warmup(const std::vector<TensorVector>& sample_inputs);
+
+  // The shapes and types of the largest CPU tensors the blobs written by
+  // `run_net` held during warmup, to be saved and passed to
+  // restoreAllocations by the next process that loads the same model.
+  TensorShapes allocationSnapshot() const;
+
+  // Allocates the tensors of a snapshot and faults in their pages, so that
+  // the first run does not allocate. Blobs that are parameters or inputs, or
+  // that hold anything but a CPU tensor, are left alone.
+  void restoreAllocations(const TensorShapes& snapshot);
+
   const NetDef& def() const {
     return run_net_;
   };
@@ -66,8 +109,117 @@ class Predictor {
   };
 
  private:
+  bool runNet(TensorVector* outputs);
+  void recordAllocations();
+
+  NetDef run_net_;
+  Workspace ws_;
+  std::unordered_set<std::string> inputNames_;
+  NetBase* net_;
+  // Blobs of run_net's external inputs and outputs, in declaration order.
+  std::vector<Blob*> inputBlobs_;
+  std::vector<Blob*> outputBlobs_;
+  // Blobs of the workspace once `init_net` ran, and the largest tensors of
+  // the other blobs seen by warmup or restoreAllocations.
+  std::unordered_set<std::string> parameterNames_;
+  std::unordered_map<std::string, TensorShape> allocations_;
+};
+
+// A predictor that can be called from many threads at once. The `init_net`
+// parameters are materialized once in a shared workspace that is only read
+// afterwards; each concurrent call checks out a child workspace that holds
+// its own instance of `run_net` and its activations. Child workspaces are
+// created lazily and recycled across calls, so the number of activation
+// copies is bounded by the peak number of concurrent callers.
+//
+// `run_net` must not write to any blob produced by `init_net`.
+//
+// The parameters can be replaced in place with swapParameters, which waits
+// for the calls in flight to finish on the old parameters and holds back new
+// calls until the new parameters are loaded.
+class ConcurrentPredictor {
+ public:
+  using TensorVector = Predictor::TensorVector;
+  using TensorMap = Predictor::TensorMap;
+  using OutputVector = std::vector<TensorCPU>;
+
+  ConcurrentPredictor(const MetaNetDef& net, Workspace* parent = nullptr);
+
+  ConcurrentPredictor(
+      const NetDef& init_net,
+      const NetDef& run_net,
+      Workspace* parent = nullptr);
+  ~ConcurrentPredictor();
+
+  // Same contract as Predictor::run, except that the outputs are copied
+  // into `outputs` since the child workspace is handed to another caller
+  // once this returns.
+  bool run(const TensorVector& inputs, OutputVector* outputs);
+
+  bool run_map(const TensorMap& inputs, OutputVector* outputs);
+
+  // Runs `init_net` on the shared workspace to load new parameters, once no
+  // call is in flight. Operators that write into an existing blob of the same
+  // shape, such as the fillers or Load, reuse its memory, so the parameters
+  // are replaced one tensor at a time without holding two copies of the
+  // model. The idle sessions are dropped afterwards, as their operators may
+  // have cached state derived from the old parameters.
+  void swapParameters(const NetDef& init_net);
+
+  // Number of completed swapParameters calls.
+  size_t epoch() const {
+    return epoch_;
+  }
+
+  const NetDef& def() const {
+    return run_net_;
+  };
+
+  // The shared workspace holding the parameters.
+  Workspace* ws() {
+    return &ws_;
+  };
+
+  // Number of child workspaces created so far.
+  size_t num_sessions() const {
+    return num_sessions_;
+  }
+
+ private:
+  struct Session {
+    std::unique_ptr<Workspace> ws;
+    NetBase* net;
+  };
+
+  // Registers a call in flight for its lifetime, once no swapParameters is
+  // running.
+  class RunScope {
+   public:
+    explicit RunScope(ConcurrentPredictor* predictor);
+    ~RunScope();
+
+   private:
+    ConcurrentPredictor* predictor_;
+  };
+  std::unique_ptr<Session> acquireSession();
+  void releaseSession(std::unique_ptr<Session> session);
+  void feedInput(
+      Session* session,
+      const std::string& name,
+      TensorCPU* input);
+  bool runSession(Session* session, OutputVector* outputs);
+
   NetDef run_net_;
   Workspace ws_;
   std::unordered_set<std::string> inputNames_;
+  std::mutex sessions_mutex_;
+  std::vector<std::unique_ptr<Session>> free_sessions_;
+  std::atomic<size_t> num_sessions_{0};
+  // Reader-writer gate between the calls and swapParameters.
+  std::mutex epoch_mutex_;
+  std::condition_variable epoch_cv_;
+  int active_runs_{0};
+  bool swapping_{false};
+  std::atomic<size_t> epoch_{0};
 };
 }
@@ -0,0 +1,369 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/predictor_host.h"
+
+#include <unordered_set>
+
+namespace caffe2 {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Whether two requests can be concatenated into the same batch.
+bool sameShapes(
+    const PredictorHost::TensorList& a,
+    const PredictorHost::TensorList& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (auto i = 0; i < a.size(); ++i) {
+    if (a[i].meta() != b[i].meta() || a[i].ndim() != b[i].ndim()) {
+      return false;
+    }
+    for (auto d = 1; d < a[i].ndim(); ++d) {
+      if (a[i].dim(d) != b[i].dim(d)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Copies `rows` rows of `src` starting at `src_row` into `dst` starting at
+// `dst_row`.
+void copyRows(
+    const TensorCPU& src,
+    TIndex src_row,
+    TIndex rows,
+    TensorCPU* dst,
+    TIndex dst_row,
+    CPUContext* context) {
+  const auto row_size = src.size_from_dim(1);
+  const auto itemsize = src.meta().itemsize();
+  context->template CopyItems<CPUContext, CPUContext>(
+      src.meta(),
+      rows * row_size,
+      static_cast<const char*>(src.raw_data()) +
+          src_row * row_size * itemsize,
+      static_cast<char*>(dst->raw_mutable_data(src.meta())) +
+          dst_row * row_size * itemsize);
+}
+} // namespace
+
+PredictorHost::PredictorHost(int num_workers) {
+  CAFFE_ENFORCE_GT(num_workers, 0);
+  for (int i = 0; i < num_workers; ++i) {
+    workers_.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+PredictorHost::~PredictorHost() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  while (!models_.empty()) {
+    models_.pop_back();
+  }
+}
+
+void PredictorHost::addModel(
+    const std::string& name,
+    const NetDef& init_net,
+    const NetDef& run_net,
+    const ModelOptions& options,
+    const std::string& base_model) {
+  CAFFE_ENFORCE_GT(options.max_batch_size, 0);
+  Model* base = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CAFFE_ENFORCE(!model_map_.count(name), "Model already exists: ", name);
+    if (!base_model.empty()) {
+      auto it = model_map_.find(base_model);
+      CAFFE_ENFORCE(it != model_map_.end(), "Model not found: ", base_model);
+      base = it->second;
+      // Keeps the base model from being swapped while this one is set up.
+      ++base->num_derived;
+    }
+  }
+
+  auto model = caffe2::make_unique<Model>();
+  model->name = name;
+  model->options = options;
+  model->has_base = base != nullptr;
+  const Workspace* base_params = base ? base->params.get() : nullptr;
+  model->params = caffe2::make_unique<Workspace>(base_params);
+  // Create the outputs of init_net locally first, as running it would
+  // otherwise write to the base model's blobs of the same name.
+  for (const auto& op : init_net.op()) {
+    for (const auto& output : op.output()) {
+      model->params->CreateLocalBlob(output);
+    }
+  }
+  try {
+    CAFFE_ENFORCE(model->params->RunNetOnce(init_net));
+    model->predictor = caffe2::make_unique<ConcurrentPredictor>(
+        NetDef(), run_net, model->params.get());
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (base) {
+      --base->num_derived;
+    }
+    throw;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (model_map_.count(name)) {
+    if (base) {
+      --base->num_derived;
+    }
+    CAFFE_THROW("Model already exists: ", name);
+  }
+  model_map_[name] = model.get();
+  models_.push_back(std::move(model));
+}
+
+void PredictorHost::swapModel(const std::string& name, const NetDef& init_net) {
+  Model* model = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = model_map_.find(name);
+    CAFFE_ENFORCE(it != model_map_.end(), "Model not found: ", name);
+    model = it->second;
+    CAFFE_ENFORCE_EQ(
+        model->num_derived,
+        0,
+        "Cannot swap model ",
+        name,
+        " as other models share its parameters");
+  }
+  if (model->has_base) {
+    const auto local = model->params->LocalBlobs();
+    const std::unordered_set<std::string> own(local.begin(), local.end());
+    for (const auto& op : init_net.op()) {
+      for (const auto& output : op.output()) {
+        CAFFE_ENFORCE(
+            own.count(output),
+            "Cannot swap blob ",
+            output,
+            " of model ",
+            name,
+            " which is shared with its base model");
+      }
+    }
+  }
+  model->predictor->swapParameters(init_net);
+}
+
+std::future<PredictorHost::TensorList> PredictorHost::enqueue(
+    const std::string& model,
+    TensorList inputs) {
+  CAFFE_ENFORCE(!inputs.empty(), "No inputs given");
+  for (const auto& input : inputs) {
+    CAFFE_ENFORCE_GT(input.ndim(), 0, "Inputs need a batch dimension");
+    CAFFE_ENFORCE_EQ(
+        input.dim(0),
+        inputs[0].dim(0),
+        "Inputs have different batch sizes");
+  }
+  Request request;
+  request.rows = inputs[0].dim(0);
+  request.inputs = std::move(inputs);
+  request.enqueued = Clock::now();
+  auto future = request.outputs.get_future();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = model_map_.find(model);
+    CAFFE_ENFORCE(it != model_map_.end(), "Model not found: ", model);
+    it->second->queued_rows += request.rows;
+    it->second->queue.push_back(std::move(request));
+  }
+  cv_.notify_one();
+  return future;
+}
+
+bool PredictorHost::run(
+    const std::string& model,
+    const TensorList& inputs,
+    TensorList* outputs) {
+  auto future = enqueue(model, inputs);
+  try {
+    *outputs = future.get();
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Batch of model " << model << " failed: " << e.what();
+    return false;
+  }
+  return true;
+}
+
+void PredictorHost::workerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    auto wake = Clock::time_point::max();
+    auto* model = nextReadyModel(&wake);
+    if (!model) {
+      if (stop_ && !hasQueuedRequests()) {
+        return;
+      }
+      if (wake == Clock::time_point::max()) {
+        cv_.wait(lock);
+      } else {
+        cv_.wait_until(lock, wake);
+      }
+      continue;
+    }
+    auto batch = takeBatch(model);
+    model->running = true;
+    lock.unlock();
+    runBatch(model, &batch);
+    lock.lock();
+    model->running = false;
+    // The model may have filled up another batch in the meantime.
+    cv_.notify_all();
+  }
+}
+
+PredictorHost::Model* PredictorHost::nextReadyModel(Clock::time_point* wake) {
+  const auto now = Clock::now();
+  Model* next = nullptr;
+  for (const auto& model : models_) {
+    // Batches of the same model run one after the other, so that a batch
+    // is not cut short while the previous one is still running.
+    if (model->running || model->queue.empty()) {
+      continue;
+    }
+    const auto oldest = model->queue.front().enqueued;
+    const auto deadline = oldest + model->options.max_batch_delay;
+    if (!stop_ && model->queued_rows < model->options.max_batch_size &&
+        deadline > now) {
+      *wake = std::min(*wake, deadline);
+      continue;
+    }
+    if (!next || model->options.priority > next->options.priority ||
+        (model->options.priority == next->options.priority &&
+         oldest < next->queue.front().enqueued)) {
+      next = model.get();
+    }
+  }
+  return next;
+}
+
+bool PredictorHost::hasQueuedRequests() const {
+  for (const auto& model : models_) {
+    if (!model->queue.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<PredictorHost::Request> PredictorHost::takeBatch(Model* model) {
+  std::vector<Request> batch;
+  TIndex rows = 0;
+  auto& queue = model->queue;
+  while (!queue.empty()) {
+    auto& request = queue.front();
+    if (!batch.empty() &&
+        (rows + request.rows > model->options.max_batch_size ||
+         !sameShapes(request.inputs, batch.front().inputs))) {
+      break;
+    }
+    rows += request.rows;
+    model->queued_rows -= request.rows;
+    batch.push_back(std::move(request));
+    queue.pop_front();
+  }
+  return batch;
+}
+
+void PredictorHost::runBatch(Model* model, std::vector<Request>* batch) {
+  std::vector<TensorList> outputs(batch->size());
+  try {
+    CPUContext context;
+    const auto& first = batch->front().inputs;
+    TensorList inputs;
+    ConcurrentPredictor::TensorVector input_ptrs;
+    if (batch->size() == 1) {
+      for (const auto& input : first) {
+        input_ptrs.push_back(const_cast<TensorCPU*>(&input));
+      }
+    } else {
+      TIndex rows = 0;
+      for (const auto& request : *batch) {
+        rows += request.rows;
+      }
+      inputs.resize(first.size());
+      for (auto i = 0; i < first.size(); ++i) {
+        auto dims = first[i].dims();
+        dims[0] = rows;
+        inputs[i].Resize(dims);
+        TIndex row = 0;
+        for (const auto& request : *batch) {
+          copyRows(
+              request.inputs[i], 0, request.rows, &inputs[i], row, &context);
+          row += request.rows;
+        }
+        input_ptrs.push_back(&inputs[i]);
+      }
+    }
+
+    TensorList batch_outputs;
+    CAFFE_ENFORCE(
+        model->predictor->run(input_ptrs, &batch_outputs),
+        "Failed to run model ",
+        model->name);
+    ++num_batches_;
+
+    if (batch->size() == 1) {
+      outputs[0] = std::move(batch_outputs);
+    } else {
+      for (const auto& output : batch_outputs) {
+        CAFFE_ENFORCE(
+            output.ndim() > 0 && output.dim(0) == inputs[0].dim(0),
+            "Output of model ",
+            model->name,
+            " is not batched along its first dimension");
+      }
+      TIndex row = 0;
+      for (auto r = 0; r < batch->size(); ++r) {
+        const auto rows = (*batch)[r].rows;
+        outputs[r].resize(batch_outputs.size());
+        for (auto i = 0; i < batch_outputs.size(); ++i) {
+          auto dims = batch_outputs[i].dims();
+          dims[0] = rows;
+          outputs[r][i].Resize(dims);
+          copyRows(batch_outputs[i], row, rows, &outputs[r][i], 0, &context);
+        }
+        row += rows;
+      }
+    }
+  } catch (...) {
+    for (auto& request : *batch) {
+      request.outputs.set_exception(std::current_exception());
+    }
+    return;
+  }
+  for (auto r = 0; r < batch->size(); ++r) {
+    (*batch)[r].outputs.set_value(std::move(outputs[r]));
+  }
+}
+} // namespace caffe2
@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "caffe2/core/predictor.h"
+
+namespace caffe2 {
+
+// Serves several models from a pool of worker threads, batching requests.
+//
+// Requests are queued per model. A model is ready once its queued requests
+// add up to `max_batch_size` rows (the first dimension of the inputs), or
+// once its oldest request has waited for `max_batch_delay`. A free worker
+// then concatenates the queued inputs along the first dimension, runs them
+// as one batch and splits the outputs back by rows, so every external
+// output of `run_net` has to be batched along its first dimension. Among
+// ready models the one with the highest `priority` goes first, and the one
+// with the oldest request among models of equal priority.
+//
+// A model can be added on top of a base model, in which case its `init_net`
+// only needs to create the parameters that differ from the base model. The
+// other parameters are shared with the base model instead of being copied.
+class PredictorHost {
+ public:
+  using TensorList = std::vector<TensorCPU>;
+
+  struct ModelOptions {
+    ModelOptions() : max_batch_size(1), max_batch_delay(0), priority(0) {}
+
+    // Maximum number of rows run in a single batch. A single request with
+    // more rows is still run, on its own.
+    TIndex max_batch_size;
+    // How long the oldest request waits for the batch to fill up.
+    std::chrono::microseconds max_batch_delay;
+    int priority;
+  };
+
+  explicit PredictorHost(int num_workers = 1);
+  // Finishes the queued requests before returning.
+  ~PredictorHost();
+
+  // Runs `init_net` and prepares `run_net` to serve requests as `name`. If
+  // `base_model` is given, the blobs created by `init_net` hide the ones of
+  // the base model with the same name, and all other parameters of the base
+  // model are visible to `run_net`. As with ConcurrentPredictor, `run_net`
+  // must not write to any parameter.
+  void addModel(
+      const std::string& name,
+      const NetDef& init_net,
+      const NetDef& run_net,
+      const ModelOptions& options = ModelOptions(),
+      const std::string& base_model = "");
+
+  // Loads new parameters for `name` in place, see
+  // ConcurrentPredictor::swapParameters. Batches of the model that are
+  // running finish on the old parameters, and the next ones wait for the new
+  // ones. A model that is the base of other models cannot be swapped, and a
+  // model with a base model can only replace the blobs its own `init_net`
+  // created.
+  void swapModel(const std::string& name, const NetDef& init_net);
+
+  // Queues the inputs, which are fed to the first external inputs of the
+  // model's `run_net`. The future holds the outputs, or the exception that
+  // made the batch fail.
+  std::future<TensorList> enqueue(const std::string& model, TensorList inputs);
+
+  // Blocking version of enqueue. Returns false if the batch failed.
+  bool run(
+      const std::string& model,
+      const TensorList& inputs,
+      TensorList* outputs);
+
+  // Number of batches run so far.
+  size_t num_batches() const {
+    return num_batches_;
+  }
+
+ private:
+  struct Request {
+    TensorList inputs;
+    TIndex rows;
+    std::chrono::steady_clock::time_point enqueued;
+    std::promise<TensorList> outputs;
+  };
+
+  struct Model {
+    std::string name;
+    ModelOptions options;
+    // The blobs created by init_net, on top of the base model's.
+    std::unique_ptr<Workspace> params;
+    std::unique_ptr<ConcurrentPredictor> predictor;
+    bool has_base = false;
+    int num_derived = 0;
+    std::deque<Request> queue;
+    TIndex queued_rows = 0;
+    bool running = false;
+  };
+
+  void workerLoop();
+  // Returns the model whose batch should run next, or nullptr if there is
+  // none yet, in which case `wake` is set to the earliest batch deadline.
+  Model* nextReadyModel(std::chrono::steady_clock::time_point* wake);
+  // Whether any model has requests left, which on shutdown may be behind a
+  // running batch of the same model.
+  bool hasQueuedRequests() const;
+  std::vector<Request> takeBatch(Model* model);
+  void runBatch(Model* model, std::vector<Request>* batch);
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+  // Models in the order they were added, so that they are destroyed before
+  // their base models.
+  std::vector<std::unique_ptr<Model>> models_;
+  std::unordered_map<std::string, Model*> model_map_;
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> num_batches_{0};
+};
+}
@@ -0,0 +1,203 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <google/protobuf/text_format.h>
+#include "caffe2/core/predictor_host.h"
+
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+const char* predictSpec = R"DOC(
+        name: "predict"
+        type: "dag"
+        external_input: "data"
+        external_input: "W"
+        external_input: "b"
+        external_output: "y"
+        op {
+          input: "data"
+          input: "W"
+          input: "b"
+          output: "y"
+          type: "FC"
+        }
+)DOC";
+
+const char* initSpec = R"DOC(
+        name: "init"
+        type: "dag"
+        op {
+          type: "ConstantFill"
+          output: "W"
+          arg {
+            name: "shape"
+            ints: 10
+            ints: 4
+          }
+          arg {
+            name: "value"
+            f: 2.0
+          }
+        }
+        op {
+          type: "ConstantFill"
+          output: "b"
+          arg {
+            name: "shape"
+            ints: 10
+          }
+          arg {
+            name: "value"
+            f: 2.0
+          }
+        }
+)DOC";
+
+// Only replaces the bias of the model above.
+const char* deltaInitSpec = R"DOC(
+        name: "delta_init"
+        type: "dag"
+        op {
+          type: "ConstantFill"
+          output: "b"
+          arg {
+            name: "shape"
+            ints: 10
+          }
+          arg {
+            name: "value"
+            f: 5.0
+          }
+        }
+)DOC";
+
+NetDef parseNetDef(const std::string& value) {
+  NetDef def;
+  CAFFE_ENFORCE(
+      google::protobuf::TextFormat::ParseFromString(value, &def),
+      "Failed to parse NetDef with value: ",
+      value);
+  return def;
+};
+
+// A {rows, 4} input whose row r is filled with r + offset.
+PredictorHost::TensorList makeInput(int rows, float offset) {
+  PredictorHost::TensorList inputs(1);
+  inputs[0].Resize(rows, 4);
+  auto* data = inputs[0].mutable_data<float>();
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      data[r * 4 + c] = r + offset;
+    }
+  }
+  return inputs;
+}
+}
+
+TEST(PredictorHostTest, BatchesRequests) {
+  PredictorHost host;
+  PredictorHost::ModelOptions options;
+  options.max_batch_size = 4;
+  // Long enough for all requests to make it into the same batch.
+  options.max_batch_delay = std::chrono::seconds(10);
+  host.addModel(
+      "fc", parseNetDef(initSpec), parseNetDef(predictSpec), options);
+
+  std::vector<std::future<PredictorHost::TensorList>> futures;
+  futures.push_back(host.enqueue("fc", makeInput(1, 1)));
+  futures.push_back(host.enqueue("fc", makeInput(2, 2)));
+  futures.push_back(host.enqueue("fc", makeInput(1, 3)));
+  const int rows[] = {1, 2, 1};
+  const float offsets[] = {1, 2, 3};
+  for (int i = 0; i < futures.size(); ++i) {
+    auto outputs = futures[i].get();
+    ASSERT_EQ(outputs.size(), 1);
+    ASSERT_EQ(outputs[0].ndim(), 2);
+    EXPECT_EQ(outputs[0].dim(0), rows[i]);
+    EXPECT_EQ(outputs[0].dim(1), 10);
+    for (int r = 0; r < rows[i]; ++r) {
+      // 4 inputs of r + offset times a weight of 2, plus a bias of 2.
+      EXPECT_FLOAT_EQ(
+          outputs[0].data<float>()[r * 10], 8 * (r + offsets[i]) + 2);
+    }
+  }
+  EXPECT_EQ(host.num_batches(), 1);
+}
+
+TEST(PredictorHostTest, RunsAfterDeadline) {
+  PredictorHost host(2);
+  PredictorHost::ModelOptions options;
+  options.max_batch_size = 100;
+  options.max_batch_delay = std::chrono::milliseconds(1);
+  host.addModel(
+      "fc", parseNetDef(initSpec), parseNetDef(predictSpec), options);
+  PredictorHost::TensorList outputs;
+  EXPECT_TRUE(host.run("fc", makeInput(3, 0), &outputs));
+  ASSERT_EQ(outputs.size(), 1);
+  EXPECT_EQ(outputs[0].dim(0), 3);
+  EXPECT_FLOAT_EQ(outputs[0].data<float>()[20], 8 * 2 + 2);
+}
+
+TEST(PredictorHostTest, SharesParametersWithBaseModel) {
+  PredictorHost host;
+  host.addModel("base", parseNetDef(initSpec), parseNetDef(predictSpec));
+  host.addModel(
+      "delta",
+      parseNetDef(deltaInitSpec),
+      parseNetDef(predictSpec),
+      PredictorHost::ModelOptions(),
+      "base");
+
+  PredictorHost::TensorList base_outputs;
+  PredictorHost::TensorList delta_outputs;
+  EXPECT_TRUE(host.run("base", makeInput(1, 1), &base_outputs));
+  EXPECT_TRUE(host.run("delta", makeInput(1, 1), &delta_outputs));
+  EXPECT_FLOAT_EQ(base_outputs[0].data<float>()[0], 8 + 2);
+  EXPECT_FLOAT_EQ(delta_outputs[0].data<float>()[0], 8 + 5);
+}
+
+TEST(PredictorHostTest, SwapsModel) {
+  PredictorHost host;
+  host.addModel("base", parseNetDef(initSpec), parseNetDef(predictSpec));
+  host.addModel(
+      "delta",
+      parseNetDef(deltaInitSpec),
+      parseNetDef(predictSpec),
+      PredictorHost::ModelOptions(),
+      "base");
+  // Other models share the parameters of the base model.
+  EXPECT_THROW(host.swapModel("base", parseNetDef(initSpec)), EnforceNotMet);
+  EXPECT_THROW(host.swapModel("delta", parseNetDef(initSpec)), EnforceNotMet);
+
+  auto newDeltaInit = parseNetDef(deltaInitSpec);
+  newDeltaInit.mutable_op(0)->mutable_arg(1)->set_f(7.0);
+  host.swapModel("delta", newDeltaInit);
+  PredictorHost::TensorList base_outputs;
+  PredictorHost::TensorList delta_outputs;
+  EXPECT_TRUE(host.run("base", makeInput(1, 1), &base_outputs));
+  EXPECT_TRUE(host.run("delta", makeInput(1, 1), &delta_outputs));
+  EXPECT_FLOAT_EQ(base_outputs[0].data<float>()[0], 8 + 2);
+  EXPECT_FLOAT_EQ(delta_outputs[0].data<float>()[0], 8 + 7);
+}
+
+TEST(PredictorHostTest, UnknownModel) {
+  PredictorHost host;
+  EXPECT_THROW(host.enqueue("missing", makeInput(1, 0)), EnforceNotMet);
+}
+} // namespace caffe2
@@ -22,6 +22,7 @@
 #include "caffe2/utils/math.h"
 
 #include <gtest/gtest.h>
+#include <thread>
 
 namespace caffe2 {
 
@@ -214,6 +215,61 @@ TEST_F(PredictorTest, SimpleBatchSizedMapInput) {
   EXPECT_NEAR(output.front()->data<float>()[4], 0.1209, 1E-4);
 }
 
+TEST_F(PredictorTest, SimpleBatchSizedBufferInput) {
+  auto inputData = randomTensor({1, 4}, ctx_.get());
+  auto* tensor = inputData->template GetMutable<TensorCPU>();
+  bool deleted = false;
+  Predictor::InputBufferVector input{{tensor->raw_mutable_data(),
+                                      tensor->meta(),
+                                      tensor->dims(),
+                                      [&deleted](void*) { deleted = true; }}};
+  Predictor::OutputViewVector output;
+  EXPECT_TRUE(p_->run_buffers(input, &output));
+  EXPECT_EQ(output.size(), 1);
+  EXPECT_TRUE(output.front()->dims().size() == 2);
+  EXPECT_TRUE(output.front()->dim(0) == 1);
+  EXPECT_TRUE(output.front()->dim(1) == 10);
+  EXPECT_NEAR(output.front()->data<float>()[4], 0.1209, 1E-4);
+  EXPECT_FALSE(deleted);
+  // Rebinding the input releases the previous buffer.
+  input[0].deleter = nullptr;
+  EXPECT_TRUE(p_->run_buffers(input, &output));
+  EXPECT_TRUE(deleted);
+}
+
+TEST_F(PredictorTest, WarmupAllocationSnapshot) {
+  auto small = randomTensor({1, 4}, ctx_.get());
+  auto large = randomTensor({8, 4}, ctx_.get());
+  EXPECT_TRUE(p_->warmup({{large->template GetMutable<TensorCPU>()},
+                          {small->template GetMutable<TensorCPU>()}}));
+  // Only the output is allocated by the net, at its largest shape.
+  auto snapshot = p_->allocationSnapshot();
+  ASSERT_EQ(snapshot.shapes_size(), 1);
+  EXPECT_EQ(snapshot.shapes(0).name(), "y");
+  EXPECT_EQ(snapshot.shapes(0).data_type(), TensorProto::FLOAT);
+  EXPECT_EQ(
+      std::vector<TIndex>(
+          snapshot.shapes(0).dims().begin(), snapshot.shapes(0).dims().end()),
+      std::vector<TIndex>({8, 10}));
+
+  // A parameter in the snapshot is left alone.
+  auto* w = snapshot.add_shapes();
+  w->set_name("W");
+  w->add_dims(3);
+  Predictor p(parseNetDef(initSpec), parseNetDef(predictSpec));
+  p.restoreAllocations(snapshot);
+  EXPECT_EQ(p.ws()->GetBlob("W")->Get<TensorCPU>().size(), 40);
+  const auto& y = p.ws()->GetBlob("y")->Get<TensorCPU>();
+  EXPECT_EQ(y.size(), 80);
+  const void* data = y.raw_data();
+
+  Predictor::TensorVector input{large->template GetMutable<TensorCPU>()};
+  Predictor::TensorVector output;
+  EXPECT_TRUE(p.run(input, &output));
+  EXPECT_EQ(output.front()->raw_data(), data);
+  EXPECT_EQ(p.allocationSnapshot().shapes_size(), 1);
+}
+
 class PredictorMetaNetDefTest : public testing::Test {
  public:
   void SetUp() override {
@@ -239,4 +295,63 @@ TEST_F(PredictorMetaNetDefTest, SimpleMetaNetDefInitializer) {
   EXPECT_TRUE(output.front()->dim(1) == 10);
   EXPECT_NEAR(output.front()->data<float>()[4], 0.1209, 1E-4);
 }
+TEST(ConcurrentPredictorTest, MultiThreadedRun) {
+  DeviceOption op;
+  op.set_random_seed(1701);
+  CPUContext ctx(op);
+  ConcurrentPredictor p(parseNetDef(initSpec), parseNetDef(predictSpec));
+  auto inputData = randomTensor({1, 4}, &ctx);
+
+  const int kNumThreads = 4;
+  std::vector<std::thread> threads;
+  std::atomic<int> num_ok(0);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 10; ++j) {
+        ConcurrentPredictor::TensorVector input{
+            inputData->template GetMutable<TensorCPU>()};
+        ConcurrentPredictor::OutputVector output;
+        if (p.run(input, &output) && output.size() == 1 &&
+            output.front().dim(1) == 10 &&
+            std::abs(output.front().data<float>()[4] - 0.1209) < 1E-4) {
+          num_ok++;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(num_ok.load(), kNumThreads * 10);
+  EXPECT_GE(p.num_sessions(), 1);
+  EXPECT_LE(p.num_sessions(), kNumThreads);
+}
+
+TEST(ConcurrentPredictorTest, SwapParameters) {
+  DeviceOption op;
+  op.set_random_seed(1701);
+  CPUContext ctx(op);
+  ConcurrentPredictor p(parseNetDef(initSpec), parseNetDef(predictSpec));
+  auto inputData = randomTensor({1, 4}, &ctx);
+  ConcurrentPredictor::TensorVector input{
+      inputData->template GetMutable<TensorCPU>()};
+  ConcurrentPredictor::OutputVector before;
+  EXPECT_TRUE(p.run(input, &before));
+  const auto* weights = p.ws()->GetBlob("W")->Get<TensorCPU>().raw_data();
+
+  // Same parameters with the bias raised by one.
+  auto newInit = parseNetDef(initSpec);
+  newInit.mutable_op(1)->mutable_arg(1)->set_f(3.0);
+  p.swapParameters(newInit);
+  EXPECT_EQ(p.epoch(), 1);
+  // The parameters are overwritten in place.
+  EXPECT_EQ(p.ws()->GetBlob("W")->Get<TensorCPU>().raw_data(), weights);
+
+  ConcurrentPredictor::OutputVector after;
+  EXPECT_TRUE(p.run(input, &after));
+  EXPECT_NEAR(after.front().data<float>()[4], 1.1209, 1E-4);
+  EXPECT_NEAR(
+      after.front().data<float>()[4], before.front().data<float>()[4] + 1,
+      1E-4);
+}
 } // namespace caffe2
@@ -22,6 +22,7 @@
 #define CAFFE2_CORE_REGISTRY_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <functional>
@@ -43,6 +44,18 @@ inline void PrintOffendingKey(const string& key) {
   printf("Offending key: %s.\n", key.c_str());
 }
 
+// Lazy registrations are only made with string literal keys, see Registry.
+template <typename KeyType>
+inline KeyType KeyFromLiteral(const char* key) {
+  printf("Lazy registration of key %s into a non-string registry.\n", key);
+  std::exit(1);
+}
+
+template <>
+inline string KeyFromLiteral(const char* key) {
+  return key;
+}
+
 /**
  * @brief A template class that allows one to register classes by keys.
  *
@@ -52,38 +65,60 @@ inline void PrintOffendingKey(const string& key) {
  * You should most likely not use the Registry class explicitly, but use the
  * helper macros below to declare specific registries as well as registering
  * objects.
+ *
+ * Registrations made by CAFFE_REGISTER_CLASS and CAFFE_REGISTER_CREATOR with a
+ * plain function are lazy: at static initialization time their registerers
+ * only link themselves into a list, without allocating, and the whole list is
+ * added to the registry on its first lookup. This keeps the thousands of
+ * operators and gradients registered in a build from slowing down process
+ * startup. Registering a key twice is then only detected on that lookup.
  */
 template <class SrcType, class ObjectType, class... Args>
 class Registry {
  public:
   typedef std::function<std::unique_ptr<ObjectType> (Args ...)> Creator;
+  typedef std::unique_ptr<ObjectType> (*CreatorFunction)(Args...);
 
-  Registry() : registry_() {}
+  // A lazy registration. It is stored in the static registerer that made it
+  // and is trivially destructible, so it stays valid until the program ends.
+  struct LazyEntry {
+    const char* key;
+    CreatorFunction creator;
+    // Computes the help message, may be null.
+    const char* (*help_msg)();
+    LazyEntry* next;
+  };
+
+  Registry() : registry_(), lazy_entries_(nullptr) {}
 
   void Register(const SrcType& key, Creator creator) {
-    // The if statement below is essentially the same as the following line:
-    // CHECK_EQ(registry_.count(key), 0) << "Key " << key
-    //                                   << " registered twice.";
-    // However, CHECK_EQ depends on google logging, and since registration is
-    // carried out at static initialization time, we do not want to have an
-    // explicit dependency on glog's initialization function.
     std::lock_guard<std::mutex> lock(register_mutex_);
-    if (registry_.count(key) != 0) {
-      printf("Key already registered.\n");
-      PrintOffendingKey(key);
-      std::exit(1);
-    }
-    registry_[key] = creator;
+    RegisterLocked(key, creator);
   }
 
   void Register(const SrcType& key, Creator creator, const string& help_msg) {
-    Register(key, creator);
+    std::lock_guard<std::mutex> lock(register_mutex_);
+    RegisterLocked(key, creator);
     help_message_[key] = help_msg;
   }
 
-  inline bool Has(const SrcType& key) { return (registry_.count(key) != 0); }
+  void RegisterLazily(LazyEntry* entry) {
+    entry->next = lazy_entries_.load(std::memory_order_relaxed);
+    while (!lazy_entries_.compare_exchange_weak(
+        entry->next,
+        entry,
+        std::memory_order_release,
+        std::memory_order_relaxed)) {
+    }
+  }
+
+  inline bool Has(const SrcType& key) {
+    AddLazyEntries();
+    return (registry_.count(key) != 0);
+  }
 
   unique_ptr<ObjectType> Create(const SrcType& key, Args ... args) {
+    AddLazyEntries();
     if (registry_.count(key) == 0) {
       // Returns nullptr if the key is not registered.
       return nullptr;
@@ -95,6 +130,7 @@ class Registry {
    * Returns the keys currently registered as a vector.
    */
   vector<SrcType> Keys() {
+    AddLazyEntries();
     vector<SrcType> keys;
     for (const auto& it : registry_) {
       keys.push_back(it.first);
@@ -103,10 +139,12 @@ class Registry {
   }
 
   const CaffeMap<SrcType, string>& HelpMessage() const {
+    AddLazyEntries();
     return help_message_;
   }
 
   const char* HelpMessage(const SrcType& key) const {
+    AddLazyEntries();
     auto it = help_message_.find(key);
     if (it == help_message_.end()) {
       return nullptr;
@@ -115,9 +153,52 @@ class Registry {
   }
 
  private:
-  CaffeMap<SrcType, Creator> registry_;
-  CaffeMap<SrcType, string> help_message_;
-  std::mutex register_mutex_;
+  void RegisterLocked(const SrcType& key, Creator creator) const {
+    // The if statement below is essentially the same as the following line:
+    // CHECK_EQ(registry_.count(key), 0) << "Key " << key
+    //                                   << " registered twice.";
+    // However, CHECK_EQ depends on google logging, and since registration is
+    // carried out at static initialization time, we do not want to have an
+    // explicit dependency on glog's initialization function.
+    if (registry_.count(key) != 0) {
+      printf("Key already registered.\n");
+      PrintOffendingKey(key);
+      std::exit(1);
+    }
+    registry_[key] = creator;
+  }
+
+  // Adds the pending lazy entries to the registry. Lookups only see an empty
+  // list once all of its entries were added.
+  void AddLazyEntries() const {
+    LazyEntry* head = lazy_entries_.load(std::memory_order_acquire);
+    if (head == nullptr) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(register_mutex_);
+    head = lazy_entries_.load(std::memory_order_acquire);
+    LazyEntry* added = nullptr;
+    // Entries registered in the meantime, e.g. by a library being loaded, go
+    // in front of the ones added so far, in which case this runs again.
+    while (head != added) {
+      for (LazyEntry* entry = head; entry != added; entry = entry->next) {
+        const SrcType key = KeyFromLiteral<SrcType>(entry->key);
+        RegisterLocked(key, entry->creator);
+        help_message_[key] = entry->help_msg ? entry->help_msg() : "";
+      }
+      added = head;
+      if (lazy_entries_.compare_exchange_strong(
+              head, nullptr, std::memory_order_acq_rel)) {
+        break;
+      }
+    }
+  }
+
+  // Mutable because lookups add the lazy entries.
+  mutable CaffeMap<SrcType, Creator> registry_;
+  mutable CaffeMap<SrcType, string> help_message_;
+  mutable std::mutex register_mutex_;
+  mutable std::atomic<LazyEntry*> lazy_entries_;
 
   DISABLE_COPY_AND_ASSIGN(Registry);
 };
@@ -125,13 +206,25 @@ class Registry {
 template <class SrcType, class ObjectType, class... Args>
 class Registerer {
  public:
+  typedef Registry<SrcType, ObjectType, Args...> RegistryType;
+
   Registerer(const SrcType& key,
-             Registry<SrcType, ObjectType, Args...>* registry,
-             typename Registry<SrcType, ObjectType, Args...>::Creator creator,
+             RegistryType* registry,
+             typename RegistryType::Creator creator,
              const string& help_msg="") {
     registry->Register(key, creator, help_msg);
   }
 
+  // Registers lazily, see Registry.
+  Registerer(
+      const char* key,
+      RegistryType* registry,
+      typename RegistryType::CreatorFunction creator,
+      const char* (*help_msg)() = nullptr)
+      : entry_{key, creator, help_msg, nullptr} {
+    registry->RegisterLazily(&entry_);
+  }
+
   template <class DerivedType>
   static unique_ptr<ObjectType> DefaultCreator(Args ... args) {
     // TODO(jiayq): old versions of NVCC does not handle make_unique well
@@ -140,6 +233,9 @@ class Registerer {
     // return make_unique<DerivedType>(args...);
     return std::unique_ptr<ObjectType>(new DerivedType(args...));
   }
+
+ private:
+  typename RegistryType::LazyEntry entry_{};
 };
 
 /**
@@ -206,8 +302,14 @@ class Registerer {
 #define CAFFE_REGISTER_CREATOR(RegistryName, key, ...) \
   CAFFE_REGISTER_TYPED_CREATOR(RegistryName, #key, __VA_ARGS__)
 
-#define CAFFE_REGISTER_CLASS(RegistryName, key, ...) \
-  CAFFE_REGISTER_TYPED_CLASS(RegistryName, #key, __VA_ARGS__)
+#define CAFFE_REGISTER_CLASS(RegistryName, key, ...)                         \
+  namespace {                                                                 \
+  static Registerer##RegistryName CAFFE_ANONYMOUS_VARIABLE(g_##RegistryName)( \
+      #key,                                                                   \
+      RegistryName(),                                                         \
+      Registerer##RegistryName::DefaultCreator<__VA_ARGS__>,                  \
+      &TypeMeta::Name<__VA_ARGS__>);                                          \
+  }
 
 }  // namespace caffe2
 #endif  // CAFFE2_CORE_REGISTRY_H_
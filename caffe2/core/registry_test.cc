@@ -58,5 +58,26 @@ TEST(RegistryTest, CanRunCreator) {
 TEST(RegistryTest, ReturnNullOnNonExistingCreator) {
   EXPECT_EQ(FooRegistry()->Create("Non-existing bar", 1), nullptr);
 }
+
+TEST(RegistryTest, HelpMessageOfLazyRegistration) {
+  const char* help = FooRegistry()->HelpMessage("Bar");
+  ASSERT_TRUE(help != nullptr);
+  EXPECT_NE(string(help).find("Bar"), string::npos);
+}
+
+TEST(RegistryTest, RegisterAfterLookup) {
+  EXPECT_FALSE(FooRegistry()->Has("LateBar"));
+  static RegistererFooRegistry late_bar(
+      "LateBar", FooRegistry(), RegistererFooRegistry::DefaultCreator<Bar>);
+  EXPECT_TRUE(FooRegistry()->Has("LateBar"));
+  unique_ptr<Foo> bar(FooRegistry()->Create("LateBar", 1));
+  EXPECT_TRUE(bar != nullptr);
+  // Keys that are not string literals are registered right away.
+  static RegistererFooRegistry string_bar(
+      string("StringBar"),
+      FooRegistry(),
+      RegistererFooRegistry::DefaultCreator<Bar>);
+  EXPECT_TRUE(FooRegistry()->Has("StringBar"));
+}
 }
 }  // namespace caffe2
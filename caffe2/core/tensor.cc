@@ -18,6 +18,7 @@
 
 #include "caffe2/core/blob_stats.h"
 #include "caffe2/core/flags.h"
+#include "caffe2/core/stats.h"
 
 CAFFE2_DEFINE_bool(
     caffe2_keep_on_shrink,
@@ -30,10 +31,81 @@ CAFFE2_DEFINE_int64(
     "The maximum memory in bytes to keep on shrink, if the difference between "
     "tensor sizes is bigger than this then tensor will be reset.");
 
+CAFFE2_DEFINE_int(
+    caffe2_tensor_growth_pct,
+    0,
+    "When a tensor outgrows its storage, allocate this many percent more "
+    "than needed.");
+
+CAFFE2_DEFINE_double(
+    caffe2_tensor_shrink_fraction,
+    0,
+    "If positive, a tensor releases the storage it kept on shrink once it was "
+    "resized caffe2_tensor_shrink_iters times in a row to less than this "
+    "fraction of its capacity.");
+
+CAFFE2_DEFINE_int(
+    caffe2_tensor_shrink_iters,
+    100,
+    "See caffe2_tensor_shrink_fraction.");
+
+CAFFE2_DEFINE_bool(
+    caffe2_small_tensor_storage,
+    true,
+    "If set, CPU tensors of fundamental types of at most 64 bytes are "
+    "allocated in one block with their reference count instead of through "
+    "the CPU allocator.");
+
 namespace caffe2 {
 // declaring it here instead of context.cc because tensor.h includes context.h
 CAFFE_KNOWN_TYPE(Tensor<CPUContext>);
 
+namespace {
+// Aligned like malloc, which is enough for any fundamental type.
+struct SmallTensorStorage {
+  std::max_align_t data[kSmallTensorBytes / sizeof(std::max_align_t)];
+};
+} // namespace
+
+namespace {
+struct TensorAllocationStats {
+  CAFFE_STAT_CTOR(TensorAllocationStats);
+  CAFFE_EXPORTED_STAT(allocations);
+  CAFFE_EXPORTED_STAT(growth_reallocations);
+  CAFFE_EXPORTED_STAT(shrinks);
+};
+
+TensorAllocationStats& GetTensorAllocationStats() {
+  static TensorAllocationStats stats("tensor");
+  return stats;
+}
+} // namespace
+
+void ReportTensorAllocation(bool growth) {
+  auto& stats = GetTensorAllocationStats();
+  CAFFE_EVENT(stats, allocations);
+  if (growth) {
+    CAFFE_EVENT(stats, growth_reallocations);
+  }
+}
+
+void ReportTensorShrink() {
+  auto& stats = GetTensorAllocationStats();
+  CAFFE_EVENT(stats, shrinks);
+}
+
+template <>
+std::shared_ptr<void> NewSmallTensorData<CPUContext>(size_t nbytes) {
+  // Memory reporting and profiling track the allocations of the context.
+  if (!FLAGS_caffe2_small_tensor_storage || nbytes > kSmallTensorBytes ||
+      FLAGS_caffe2_report_cpu_memory_usage || FLAGS_caffe2_profile_memory) {
+    return nullptr;
+  }
+  // Value-initialized, so zero-filled like the default allocator does.
+  auto storage = std::make_shared<SmallTensorStorage>();
+  return std::shared_ptr<void>(storage, storage->data);
+}
+
 TensorPrinter::TensorPrinter(
     const std::string& tensor_name,
     const std::string& file_name,
@@ -41,8 +41,56 @@ CAFFE2_DECLARE_bool(caffe2_keep_on_shrink);
 // is larger than this flag in bytes.
 CAFFE2_DECLARE_int64(caffe2_max_keep_on_shrink_memory);
 
+// When a tensor outgrows its storage, the new storage is allocated this many
+// percent larger than needed, so that tensors whose size fluctuates, e.g. with
+// the batch size, settle on their high-water mark after few reallocations.
+CAFFE2_DECLARE_int(caffe2_tensor_growth_pct);
+
+// If positive, a tensor that keeps its storage on shrink releases it once it
+// was resized caffe2_tensor_shrink_iters times in a row to less than this
+// fraction of its capacity.
+CAFFE2_DECLARE_double(caffe2_tensor_shrink_fraction);
+CAFFE2_DECLARE_int(caffe2_tensor_shrink_iters);
+
+// If set, small CPU tensors of fundamental types are allocated in one block
+// with their reference count, see NewSmallTensorData().
+CAFFE2_DECLARE_bool(caffe2_small_tensor_storage);
+
 namespace caffe2 {
 
+// The largest tensor, in bytes, that NewSmallTensorData() allocates.
+constexpr size_t kSmallTensorBytes = 64;
+
+/**
+ * Allocates the storage of a tensor of fundamental type of at most
+ * kSmallTensorBytes bytes together with its reference count, with a single
+ * allocation instead of one from the allocator of the context and one for the
+ * control block of the shared_ptr. Scalars and shapes, such as iteration
+ * counters, losses and the outputs of Shape, are allocated this way. Returns
+ * null if the tensor is too large or the context does not support it, in
+ * which case the context allocator is used.
+ */
+template <class Context>
+inline std::shared_ptr<void> NewSmallTensorData(size_t /*nbytes*/) {
+  return nullptr;
+}
+
+template <>
+std::shared_ptr<void> NewSmallTensorData<CPUContext>(size_t nbytes);
+
+// Exported as the tensor/allocations, tensor/growth_reallocations and
+// tensor/shrinks stats. Growth reallocations are the allocations that replace
+// storage that became too small. Allocations are only counted while
+// caffe2_tensor_growth_pct or caffe2_tensor_shrink_fraction is set, the
+// policies these stats are there to tune.
+void ReportTensorAllocation(bool growth);
+void ReportTensorShrink();
+
+inline bool TensorAllocationStatsEnabled() {
+  return FLAGS_caffe2_tensor_growth_pct > 0 ||
+      FLAGS_caffe2_tensor_shrink_fraction > 0;
+}
+
 /**
  * A utility function to convert vector<int> to vector<TIndex>.
  */
@@ -295,14 +343,17 @@ class Tensor {
    * is deleted and new memory will be allocated next time you call
    * mutable_data(). However, if the shape is different but the total number of
    * items is the same, the underlying storage is kept.
+   *
+   * See caffe2_tensor_growth_pct and caffe2_tensor_shrink_fraction for how
+   * storage is grown and kept.
    */
   template <typename... Ts>
   void Resize(Ts... dim_source) {
     bool size_changed = SetDims(dim_source...);
+    int64_t new_size = size_ * meta_.itemsize();
     if (size_changed) {
       // If needed, we will free the data. the next mutable_data() call
       // will create the data storage.
-      int64_t new_size = size_ * meta_.itemsize();
       bool reset_tensor = false;
       if (reserved_) {
         // If tensor is reserved then don't claim its memeory unless capacity_
@@ -314,9 +365,15 @@ class Tensor {
       }
 
       if (reset_tensor) {
+        grow_storage_ = capacity_ > 0 && capacity_ < new_size;
         FreeMemory();
+        return;
       }
     }
+    if (UnderusedForShrinkIters(new_size)) {
+      ReportTensorShrink();
+      FreeMemory();
+    }
   }
 
   /**
@@ -365,6 +422,7 @@ class Tensor {
   inline void FreeMemory() {
     data_.reset();
     capacity_ = 0;
+    underused_resizes_ = 0;
     // If reserved is true and we changed tensor memory then it is fine
     // to switch it to false, if Resize is called from Reserve and it triggers
     // FreeMemory() then reserved_ will be set to true at end of Reserve()
@@ -395,6 +453,10 @@ class Tensor {
     std::swap(shares_data_, other.shares_data_);
     std::swap(capacity_, other.capacity_);
     std::swap(reserved_, other.reserved_);
+    std::swap(grow_storage_, other.grow_storage_);
+    std::swap(underused_resizes_, other.underused_resizes_);
+    ++version_;
+    ++other.version_;
   }
 
   /**
@@ -425,6 +487,38 @@ class Tensor {
     data_ = src.data_;
     capacity_ = src.capacity_;
     shares_data_ = true;
+    ++version_;
+  }
+
+  /**
+   * @brief Makes this tensor a view of a contiguous range of src's storage.
+   *
+   * The view starts `offset` items into src and holds as many items as this
+   * tensor, whose shape has to be set already and fit in src. It keeps the
+   * storage alive, even after src frees or reallocates it, and writes through
+   * either tensor are seen by the other.
+   */
+  void ShareDataSlice(const Tensor& src, TIndex offset) {
+    meta_ = src.meta();
+    CAFFE_ENFORCE_WITH_CALLER(
+        offset >= 0 && offset + size_ <= src.size_,
+        "View of ",
+        size_,
+        " items at offset ",
+        offset,
+        " does not fit in ",
+        src.size_,
+        " items.");
+    CAFFE_ENFORCE_WITH_CALLER(
+        src.data_.get() || src.size_ == 0,
+        "Source tensor has no content and has size > 0");
+    const size_t offset_bytes = offset * meta_.itemsize();
+    data_ = std::shared_ptr<void>(
+        src.data_, static_cast<char*>(src.data_.get()) + offset_bytes);
+    // Growing the view reallocates rather than writing past its range.
+    capacity_ = size_ * meta_.itemsize();
+    shares_data_ = true;
+    ++version_;
   }
 
   /**
@@ -471,12 +565,23 @@ class Tensor {
       capacity_ = nbytes();
     }
     shares_data_ = true;
+    ++version_;
   }
 
   bool shares_data() const {
     return shares_data_;
   }
 
+  /**
+   * Returns a reference to the underlying storage, which keeps it alive after
+   * the tensor frees or reallocates it, e.g. for views of the data held
+   * outside of the tensor. Storage shared with ShareExternalPointer without a
+   * deleter is not owned by the tensor, and is not kept alive.
+   */
+  std::shared_ptr<void> shared_data() const {
+    return data_;
+  }
+
   /**
    * Returns a const raw void* pointer of the underlying storage. mutable_data()
    * or raw_mutable_data() must have been called prior to this function call.
@@ -486,6 +591,17 @@ class Tensor {
     return data_.get();
   }
 
+  /**
+   * Returns a counter that changes whenever the content of the tensor may have
+   * been modified through it, i.e. on every mutable access and on sharing.
+   * Operators that keep state derived from an input, e.g. packed weights,
+   * can compare it to skip recomputing the state. Writes through another
+   * tensor that shares the same data are not seen.
+   */
+  inline uint64_t version() const {
+    return version_;
+  }
+
   /**
    * Returns a typed pointer of the underlying storage. mutable_data() or
    * raw_mutable_data() must have been called prior to this function call, and
@@ -520,6 +636,7 @@ class Tensor {
    * and a new storage will be created.
    */
   inline void* raw_mutable_data(const TypeMeta& meta) {
+    ++version_;
     // For 0-size tensors it's fine to return any pointer (including nullptr)
     if (meta_ == meta && (data_.get() || size_ == 0)) {
       return data_.get();
@@ -553,12 +670,25 @@ class Tensor {
               deleter(ptr);
             });
         meta_.ctor()(data_.get(), size_);
+        capacity_ = size_ * meta_.itemsize();
       } else {
-        // For fundamental type, new and delete is easier.
-        auto ptr_and_deleter = Context::New(size_ * meta_.itemsize());
-        data_.reset(ptr_and_deleter.first, ptr_and_deleter.second);
+        // For fundamental type, new and delete is easier. Storage that
+        // replaces a too small one gets some headroom.
+        size_t nbytes = size_ * meta_.itemsize();
+        if (grow_storage_) {
+          nbytes += nbytes * FLAGS_caffe2_tensor_growth_pct / 100;
+        }
+        data_ = NewSmallTensorData<Context>(nbytes);
+        if (!data_) {
+          auto ptr_and_deleter = Context::New(nbytes);
+          data_.reset(ptr_and_deleter.first, ptr_and_deleter.second);
+        }
+        capacity_ = nbytes;
       }
-      capacity_ = size_ * meta_.itemsize();
+      if (TensorAllocationStatsEnabled()) {
+        ReportTensorAllocation(grow_storage_);
+      }
+      grow_storage_ = false;
       return data_.get();
     }
   }
@@ -589,6 +719,7 @@ class Tensor {
    template <typename T>
     inline T* mutable_data() {
       if ((size_ == 0 || data_.get()) && IsType<T>()) {
+        ++version_;
         return static_cast<T*>(data_.get());
       }
       return static_cast<T*>(raw_mutable_data(TypeMeta::Make<T>()));
@@ -696,9 +827,28 @@ class Tensor {
   bool shares_data_ = false;
   size_t capacity_ = 0;
   bool reserved_ = false;
+  // Set when the storage was freed for being too small.
+  bool grow_storage_ = false;
+  int underused_resizes_ = 0;
+  uint64_t version_ = 0;
   // In case of chunk load we store how much data was already loaded
 
  private:
+  // Counts the consecutive resizes to less than caffe2_tensor_shrink_fraction
+  // of the capacity, and returns true once there were
+  // caffe2_tensor_shrink_iters of them.
+  bool UnderusedForShrinkIters(int64_t new_size) {
+    if (FLAGS_caffe2_tensor_shrink_fraction <= 0 || reserved_ ||
+        capacity_ == 0) {
+      return false;
+    }
+    if (new_size >= capacity_ * FLAGS_caffe2_tensor_shrink_fraction) {
+      underused_resizes_ = 0;
+      return false;
+    }
+    return ++underused_resizes_ >= FLAGS_caffe2_tensor_shrink_iters;
+  }
+
   template <
       typename T,
       typename = typename std::enable_if<std::is_integral<T>::value>::type>
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_TEST_UTILS_H_
+#define CAFFE2_CORE_TEST_UTILS_H_
+
+#include <algorithm>
+
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/workspace.h"
+
+// Helpers to set up the input blobs of CPU operator tests.
+
+namespace caffe2 {
+
+// Creates the CPU tensor name in ws with shape dims, without allocating its
+// data, and returns it.
+inline TensorCPU*
+AddTensor(Workspace* ws, const string& name, const vector<TIndex>& dims) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  return tensor;
+}
+
+// Same as AddTensor(ws, name, dims), with the data set to values.
+template <typename T>
+TensorCPU* AddTensor(
+    Workspace* ws,
+    const string& name,
+    const vector<TIndex>& dims,
+    const vector<T>& values) {
+  auto* tensor = AddTensor(ws, name, dims);
+  CAFFE_ENFORCE_EQ(tensor->size(), values.size());
+  std::copy(values.begin(), values.end(), tensor->mutable_data<T>());
+  return tensor;
+}
+
+// Same as AddTensor(ws, name, dims), with every float set to value.
+inline TensorCPU* FillTensor(
+    Workspace* ws,
+    const string& name,
+    const vector<TIndex>& dims,
+    float value) {
+  auto* tensor = AddTensor(ws, name, dims);
+  std::fill_n(tensor->mutable_data<float>(), tensor->size(), value);
+  return tensor;
+}
+
+// Same as AddTensor(ws, name, dims), with float i set to fn(i).
+template <typename F>
+TensorCPU* FillTensorWith(
+    Workspace* ws,
+    const string& name,
+    const vector<TIndex>& dims,
+    const F& fn) {
+  auto* tensor = AddTensor(ws, name, dims);
+  auto* data = tensor->mutable_data<float>();
+  for (TIndex i = 0; i < tensor->size(); ++i) {
+    data[i] = fn(i);
+  }
+  return tensor;
+}
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_TEST_UTILS_H_
@@ -34,6 +34,7 @@ CAFFE_KNOWN_TYPE(uint16_t);
 CAFFE_KNOWN_TYPE(int16_t);
 CAFFE_KNOWN_TYPE(int64_t);
 CAFFE_KNOWN_TYPE(float16);
+CAFFE_KNOWN_TYPE(bfloat16);
 CAFFE_KNOWN_TYPE(double);
 CAFFE_KNOWN_TYPE(char);
 CAFFE_KNOWN_TYPE(std::unique_ptr<std::mutex>);
@@ -68,6 +69,7 @@ TensorProto::DataType TypeMetaToDataType(const TypeMeta& meta) {
     {TypeMeta::Id<int64_t>(), TensorProto_DataType_INT64},
     {TypeMeta::Id<float16>(), TensorProto_DataType_FLOAT16},
     {TypeMeta::Id<double>(), TensorProto_DataType_DOUBLE},
+    {TypeMeta::Id<bfloat16>(), TensorProto_DataType_BFLOAT16},
   };
   const auto it = data_type_map.find(meta.id());
   return (it == data_type_map.end()
@@ -87,6 +89,7 @@ const TypeMeta& DataTypeToTypeMeta(const TensorProto::DataType& dt) {
       {TensorProto_DataType_INT64, TypeMeta::Make<int64_t>()},
       {TensorProto_DataType_FLOAT16, TypeMeta::Make<float16>()},
       {TensorProto_DataType_DOUBLE, TypeMeta::Make<double>()},
+      {TensorProto_DataType_BFLOAT16, TypeMeta::Make<bfloat16>()},
   };
   const auto it = type_meta_map.find(dt);
   if (it == type_meta_map.end()) {
@@ -68,6 +68,13 @@ static_assert(sizeof(unsigned short) == 2,
 namespace caffe2 {
 typedef struct CAFFE2_ALIGNED(2) __f16 { uint16_t x; } float16;
 
+// Brain floating point: the upper 16 bits of a float, so it has the range of
+// float with 8 bits of mantissa. Used on CPU to halve the memory and bandwidth
+// of embeddings and activations, with the math done in float.
+struct CAFFE2_ALIGNED(2) bfloat16 {
+  uint16_t x;
+};
+
 // Helpers to avoid using typeinfo with -rtti
 template <typename T>
 bool fp16_type() {
@@ -81,6 +88,9 @@ namespace std {
 template<>
 struct is_fundamental<caffe2::__f16> : std::integral_constant<bool, true> {
 };
+template <>
+struct is_fundamental<caffe2::bfloat16> : std::integral_constant<bool, true> {
+};
 }  // namespace std
 
 #endif  // CAFFE2_CORE_TYPES_H_
@@ -20,6 +20,7 @@
 #include <ctime>
 #include <mutex>
 
+#include "caffe2/core/blob_stats.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/net.h"
 #include "caffe2/core/operator.h"
@@ -31,6 +32,11 @@ CAFFE2_DEFINE_bool(
     caffe2_print_blob_sizes_at_exit,
     false,
     "If true, workspace destructor will print all blob shapes");
+CAFFE2_DEFINE_int(
+    caffe2_run_once_cache_size,
+    0,
+    "If positive, the number of nets and of operators that RunNetOnce and "
+    "RunOperatorOnce keep per workspace to reuse them.");
 
 namespace caffe2 {
 
@@ -88,6 +94,45 @@ void Workspace::PrintBlobSizes() {
   LOG(INFO) << "Total;;" << cumtotal << ";100%";
 }
 
+WorkspaceMemoryReport Workspace::MemoryReport() const {
+  WorkspaceMemoryReport report;
+  for (const auto& entry : blob_map_) {
+    const Blob& blob = *entry.second;
+    BlobMemoryInfo info;
+    info.name = entry.first;
+    info.type = blob.TypeName();
+    info.used_bytes = BlobStat::sizeBytes(blob);
+    info.capacity_bytes = info.used_bytes;
+    info.device = "cpu";
+    TensorInfoCall tensor_info = GetTensorInfoFunction(blob.meta().id());
+    if (tensor_info) {
+      size_t capacity = 0;
+      DeviceOption device;
+      tensor_info(blob.GetRaw(), &info.shares_data, &capacity, &device);
+      // The characters of strings are not part of the tensor capacity.
+      info.capacity_bytes = std::max(capacity, info.used_bytes);
+      if (device.device_type() == CUDA) {
+        info.device = "cuda:" + caffe2::to_string(device.cuda_gpu_id());
+      }
+    }
+    auto& totals = report.devices[info.device];
+    totals.used_bytes += info.used_bytes;
+    totals.capacity_bytes += info.capacity_bytes;
+    if (!info.shares_data) {
+      totals.exclusive_bytes += info.capacity_bytes;
+    }
+    ++totals.num_blobs;
+    report.blobs.push_back(std::move(info));
+  }
+  std::sort(
+      report.blobs.begin(),
+      report.blobs.end(),
+      [](const BlobMemoryInfo& a, const BlobMemoryInfo& b) {
+        return a.capacity_bytes > b.capacity_bytes;
+      });
+  return report;
+}
+
 vector<string> Workspace::LocalBlobs() const {
   vector<string> names;
   names.reserve(blob_map_.size());
@@ -126,19 +171,26 @@ Blob* Workspace::CreateBlob(const string& name) {
             << "(blob " << forwarded_blobs_[name].second << "). Skipping.";
   } else {
     VLOG(1) << "Creating blob " << name;
-    blob_map_[name] = unique_ptr<Blob>(new Blob());
+    return AddLocalBlob(name);
   }
   return GetBlob(name);
 }
 
 Blob* Workspace::CreateLocalBlob(const string& name) {
-  if (blob_map_.count(name)) {
+  auto* blob = FindLocalBlob(name);
+  if (blob) {
     VLOG(1) << "Blob " << name << " already exists. Skipping.";
-  } else {
-    VLOG(1) << "Creating blob " << name;
-    blob_map_[name] = unique_ptr<Blob>(new Blob());
+    return blob;
   }
-  return GetBlob(name);
+  VLOG(1) << "Creating blob " << name;
+  return AddLocalBlob(name);
+}
+
+Blob* Workspace::AddLocalBlob(const string& name) {
+  auto& blob = blob_map_[name];
+  blob.reset(new Blob());
+  local_blobs_[InternBlobName(name)] = blob.get();
+  return blob.get();
 }
 
 bool Workspace::RemoveBlob(const string& name) {
@@ -146,6 +198,14 @@ bool Workspace::RemoveBlob(const string& name) {
   if (it != blob_map_.end()) {
     VLOG(1) << "Removing blob " << name << " from this workspace.";
     blob_map_.erase(it);
+    auto id_it = blob_ids_.find(name);
+    const BlobId id = id_it->second;
+    local_blobs_[id] = nullptr;
+    if (!pinned_blob_ids_[id]) {
+      blob_names_[id] = nullptr;
+      blob_ids_.erase(id_it);
+      free_blob_ids_.push_back(id);
+    }
     return true;
   }
 
@@ -155,8 +215,8 @@ bool Workspace::RemoveBlob(const string& name) {
 }
 
 const Blob* Workspace::GetBlob(const string& name) const {
-  if (blob_map_.count(name)) {
-    return blob_map_.at(name).get();
+  if (auto* blob = FindLocalBlob(name)) {
+    return blob;
   } else if (forwarded_blobs_.count(name)) {
     const auto parent_ws = forwarded_blobs_.at(name).first;
     const auto& parent_name = forwarded_blobs_.at(name).second;
@@ -204,6 +264,53 @@ Blob* Workspace::GetBlob(const string& name) {
   return const_cast<Blob*>(static_cast<const Workspace*>(this)->GetBlob(name));
 }
 
+Workspace::BlobId Workspace::InternBlobName(const string& name) {
+  auto it = blob_ids_.find(name);
+  if (it != blob_ids_.end()) {
+    return it->second;
+  }
+  BlobId id;
+  if (!free_blob_ids_.empty()) {
+    id = free_blob_ids_.back();
+    free_blob_ids_.pop_back();
+  } else {
+    id = blob_names_.size();
+    blob_names_.push_back(nullptr);
+    local_blobs_.push_back(nullptr);
+    pinned_blob_ids_.push_back(false);
+  }
+  it = blob_ids_.emplace(name, id).first;
+  blob_names_[id] = &it->first;
+  return id;
+}
+
+Workspace::BlobId Workspace::GetBlobId(const string& name) {
+  const BlobId id = InternBlobName(name);
+  pinned_blob_ids_[id] = true;
+  return id;
+}
+
+const string& Workspace::GetBlobName(BlobId id) const {
+  CAFFE_ENFORCE(
+      id >= 0 && id < static_cast<BlobId>(blob_names_.size()) &&
+          blob_names_[id],
+      "Invalid blob id ",
+      id);
+  return *blob_names_[id];
+}
+
+const Blob* Workspace::GetBlob(BlobId id) const {
+  const auto& name = GetBlobName(id);
+  if (auto* blob = local_blobs_[id]) {
+    return blob;
+  }
+  return GetBlob(name);
+}
+
+Blob* Workspace::GetBlob(BlobId id) {
+  return const_cast<Blob*>(static_cast<const Workspace*>(this)->GetBlob(id));
+}
+
 NetBase* Workspace::CreateNet(const NetDef& net_def, bool overwrite) {
   std::shared_ptr<NetDef> tmp_net_def(new NetDef(net_def));
   return CreateNet(tmp_net_def, overwrite);
@@ -263,8 +370,80 @@ bool Workspace::RunNet(const string& name) {
   return net_map_[name]->Run();
 }
 
+namespace {
+
+// Operators with nets as arguments, e.g. control flow operators, create
+// nets whose blobs are not checked when they are reused, so they are not
+// cached.
+bool CanReuse(const OperatorDef& op_def) {
+  for (const auto& arg : op_def.arg()) {
+    if (arg.has_n() || arg.nets_size() > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void AppendBlobNames(const OperatorDef& op_def, vector<string>* names) {
+  names->insert(names->end(), op_def.input().begin(), op_def.input().end());
+  names->insert(names->end(), op_def.output().begin(), op_def.output().end());
+}
+
+} // namespace
+
+template <class T>
+std::shared_ptr<T> Workspace::TakeRunOnce(
+    RunOnceCache<T>* cache,
+    const string& key) {
+  RunOnceEntry<T> entry;
+  {
+    std::lock_guard<std::mutex> guard(run_once_mutex_);
+    auto it = cache->find(key);
+    if (it == cache->end()) {
+      return nullptr;
+    }
+    entry = std::move(it->second);
+    cache->erase(it);
+  }
+  // Operators hold on to the blobs they were created with.
+  for (const auto& blob : entry.blobs) {
+    if (GetBlob(blob.first) != blob.second) {
+      return nullptr;
+    }
+  }
+  return entry.object;
+}
+
+template <class T>
+void Workspace::PutRunOnce(
+    RunOnceCache<T>* cache,
+    const string& key,
+    std::shared_ptr<T> object,
+    const vector<string>& blob_names) {
+  RunOnceEntry<T> entry;
+  entry.object = std::move(object);
+  for (const auto& name : blob_names) {
+    entry.blobs.emplace_back(name, GetBlob(name));
+  }
+  std::lock_guard<std::mutex> guard(run_once_mutex_);
+  if (cache->size() >=
+      static_cast<size_t>(FLAGS_caffe2_run_once_cache_size)) {
+    cache->clear();
+  }
+  (*cache)[key] = std::move(entry);
+}
+
 bool Workspace::RunOperatorOnce(const OperatorDef& op_def) {
-  std::unique_ptr<OperatorBase> op(CreateOperator(op_def, this));
+  const bool reuse = FLAGS_caffe2_run_once_cache_size > 0 && CanReuse(op_def);
+  string key;
+  std::shared_ptr<OperatorBase> op;
+  if (reuse) {
+    key = op_def.SerializeAsString();
+    op = TakeRunOnce(&run_once_ops_, key);
+  }
+  if (!op) {
+    op = CreateOperator(op_def, this);
+  }
   if (op.get() == nullptr) {
     LOG(ERROR) << "Cannot create operator of type " << op_def.type();
     return false;
@@ -273,10 +452,27 @@ bool Workspace::RunOperatorOnce(const OperatorDef& op_def) {
     LOG(ERROR) << "Error when running operator " << op_def.type();
     return false;
   }
+  if (reuse) {
+    vector<string> blob_names;
+    AppendBlobNames(op_def, &blob_names);
+    PutRunOnce(&run_once_ops_, key, std::move(op), blob_names);
+  }
   return true;
 }
 bool Workspace::RunNetOnce(const NetDef& net_def) {
-  std::unique_ptr<NetBase> net(caffe2::CreateNet(net_def, this));
+  bool reuse = FLAGS_caffe2_run_once_cache_size > 0;
+  for (const auto& op_def : net_def.op()) {
+    reuse = reuse && CanReuse(op_def);
+  }
+  string key;
+  std::shared_ptr<NetBase> net;
+  if (reuse) {
+    key = net_def.SerializeAsString();
+    net = TakeRunOnce(&run_once_nets_, key);
+  }
+  if (!net) {
+    net = caffe2::CreateNet(net_def, this);
+  }
   if (net == nullptr) {
     CAFFE_THROW(
         "Could not create net: " + net_def.name() + " of type " +
@@ -286,6 +482,13 @@ bool Workspace::RunNetOnce(const NetDef& net_def) {
     LOG(ERROR) << "Error when running network " << net_def.name();
     return false;
   }
+  if (reuse) {
+    vector<string> blob_names;
+    for (const auto& op_def : net_def.op()) {
+      AppendBlobNames(op_def, &blob_names);
+    }
+    PutRunOnce(&run_once_nets_, key, std::move(net), blob_names);
+  }
   return true;
 }
 
@@ -293,7 +496,6 @@ bool Workspace::RunPlan(const PlanDef& plan, ShouldContinue shouldContinue) {
   return RunPlanOnWorkspace(this, plan, shouldContinue);
 }
 
-#if CAFFE2_MOBILE
 ThreadPool* Workspace::GetThreadPool() {
   std::lock_guard<std::mutex> guard(thread_pool_creation_mutex_);
   if (!thread_pool_) {
@@ -301,6 +503,5 @@ ThreadPool* Workspace::GetThreadPool() {
   }
   return thread_pool_.get();
 }
-#endif // CAFFE2_MOBILE
 
 } // namespace caffe2
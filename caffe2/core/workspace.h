@@ -26,8 +26,10 @@
 
 #include <climits>
 #include <cstddef>
+#include <map>
 #include <mutex>
 #include <typeinfo>
+#include <unordered_map>
 #include <vector>
 
 #include "caffe2/core/blob.h"
@@ -35,16 +37,49 @@
 #include "caffe2/core/net.h"
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/utils/signal_handler.h"
-#if CAFFE2_MOBILE
 #include "caffe2/utils/threadpool/ThreadPool.h"
-#endif // CAFFE2_MOBILE
 
 CAFFE2_DECLARE_bool(caffe2_print_blob_sizes_at_exit);
+CAFFE2_DECLARE_int(caffe2_run_once_cache_size);
 
 namespace caffe2 {
 
 class NetBase;
 
+/**
+ * Memory held by a blob. Tensors report it through their TensorInfoCall;
+ * other blob types through BlobStat, if they register a BlobStatGetter.
+ */
+struct BlobMemoryInfo {
+  string name;
+  string type;
+  // "cpu" or "cuda:<gpu id>".
+  string device;
+  // Bytes of the current content, including the characters of strings.
+  size_t used_bytes = 0;
+  // Bytes allocated, above used_bytes for a tensor that was reserved or
+  // shrunk.
+  size_t capacity_bytes = 0;
+  // Whether the memory belongs to another tensor or to an external pointer,
+  // in which case it is not counted in the exclusive bytes.
+  bool shares_data = false;
+};
+
+struct DeviceMemoryTotals {
+  size_t used_bytes = 0;
+  size_t capacity_bytes = 0;
+  // Capacity of the blobs that own their memory.
+  size_t exclusive_bytes = 0;
+  size_t num_blobs = 0;
+};
+
+struct WorkspaceMemoryReport {
+  // Sorted by decreasing capacity.
+  vector<BlobMemoryInfo> blobs;
+  // Keyed by device.
+  std::map<string, DeviceMemoryTotals> devices;
+};
+
 struct StopOnSignal {
   StopOnSignal()
       : handler_(std::make_shared<SignalHandler>(
@@ -157,7 +192,7 @@ class Workspace {
   inline bool HasBlob(const string& name) const {
     // First, check the local workspace,
     // Then, check the forwarding map, then the parent workspace
-    if (blob_map_.count(name)) {
+    if (FindLocalBlob(name)) {
       return true;
     } else if (forwarded_blobs_.count(name)) {
       const auto parent_ws = forwarded_blobs_.at(name).first;
@@ -171,6 +206,12 @@ class Workspace {
 
   void PrintBlobSizes();
 
+  /**
+   * Returns the memory held by the blobs of this workspace, not including
+   * those of a shared workspace.
+   */
+  WorkspaceMemoryReport MemoryReport() const;
+
   /**
    * Creates a blob of the given name. The pointer to the blob is returned, but
    * the workspace keeps ownership of the pointer. If a blob of the given name
@@ -202,6 +243,27 @@ class Workspace {
    */
   Blob* GetBlob(const string& name);
 
+  typedef int BlobId;
+  /**
+   * Returns the id of the given blob name, assigning a new one if the name has
+   * none yet. The blob itself does not need to exist. Ids returned here are
+   * stable for the lifetime of the workspace, also when the blob is removed
+   * and created again, so callers can resolve a name once and then use
+   * GetBlob(BlobId), which skips the string comparisons of a lookup by name.
+   * Like CreateBlob(), this must not be called concurrently with other calls.
+   */
+  BlobId GetBlobId(const string& name);
+  /**
+   * Returns the name the given id was assigned to.
+   */
+  const string& GetBlobName(BlobId id) const;
+  /**
+   * Gets the blob with the given id, resolved like GetBlob(const string&). If
+   * the blob does not exist, a nullptr is returned.
+   */
+  const Blob* GetBlob(BlobId id) const;
+  Blob* GetBlob(BlobId id);
+
   /**
    * Creates a network with the given NetDef, and returns the pointer to the
    * network. If there is anything wrong during the creation of the network, a
@@ -248,20 +310,24 @@ class Workspace {
   bool RunPlan(const PlanDef& plan_def,
                ShouldContinue should_continue = StopOnSignal{});
 
-#if CAFFE2_MOBILE
   /*
    * Returns a CPU threadpool instace for parallel execution of
    * work. The threadpool is created lazily; if no operators use it,
    * then no threadpool will be created.
    */
   ThreadPool* GetThreadPool();
-#endif
 
   // RunOperatorOnce and RunNetOnce runs an operator or net once. The difference
   // between RunNet and RunNetOnce lies in the fact that RunNet allows you to
   // have a persistent net object, while RunNetOnce creates a net and discards
   // it on the fly - this may make things like database read and random number
   // generators repeat the same thing over multiple calls.
+  //
+  // If FLAGS_caffe2_run_once_cache_size is positive, the nets and operators
+  // are kept instead, and reused when run again with the same def while the
+  // blobs they refer to are the same, which skips their creation. Reused
+  // operators keep their state, so that e.g. readers and random number
+  // generators continue where they left off.
   bool RunOperatorOnce(const OperatorDef& op_def);
   bool RunNetOnce(const NetDef& net_def);
 
@@ -269,16 +335,58 @@ class Workspace {
   std::atomic<int> last_failed_op_net_position;
 
  private:
+  // A net or operator kept by RunNetOnce or RunOperatorOnce, with the blobs it
+  // was created with, keyed by its serialized def. Held by a shared_ptr, which
+  // unlike unique_ptr can be destroyed where OperatorBase is incomplete.
+  template <class T>
+  struct RunOnceEntry {
+    std::shared_ptr<T> object;
+    vector<std::pair<string, const Blob*>> blobs;
+  };
+  template <class T>
+  using RunOnceCache = std::unordered_map<string, RunOnceEntry<T>>;
+
+  // Takes the entry out of the cache, so that concurrent calls with the same
+  // def don't share it. Returns null if there is none or if its blobs changed.
+  template <class T>
+  std::shared_ptr<T> TakeRunOnce(RunOnceCache<T>* cache, const string& key);
+  template <class T>
+  void PutRunOnce(
+      RunOnceCache<T>* cache,
+      const string& key,
+      std::shared_ptr<T> object,
+      const vector<string>& blob_names);
+
+  inline Blob* FindLocalBlob(const string& name) const {
+    auto it = blob_ids_.find(name);
+    return it == blob_ids_.end() ? nullptr : local_blobs_[it->second];
+  }
+  Blob* AddLocalBlob(const string& name);
+  BlobId InternBlobName(const string& name);
+
   BlobMap blob_map_;
+  // Interned blob names. The names of local blobs are always interned, so
+  // that looking them up by name is a hash lookup. local_blobs_ holds the
+  // local blob of each id, or nullptr if there is none. The ids of names
+  // that were never passed to GetBlobId() are released with their blob, and
+  // reused from free_blob_ids_, so that workspaces that create and remove
+  // blobs of many different names don't grow.
+  std::unordered_map<string, BlobId> blob_ids_;
+  vector<const string*> blob_names_;
+  vector<Blob*> local_blobs_;
+  vector<bool> pinned_blob_ids_;
+  vector<BlobId> free_blob_ids_;
   NetMap net_map_;
   const string root_folder_;
   const Workspace* shared_;
   std::unordered_map<string, std::pair<const Workspace*, string>>
       forwarded_blobs_;
-#if CAFFE2_MOBILE
   std::unique_ptr<ThreadPool> thread_pool_;
   std::mutex thread_pool_creation_mutex_;
-#endif // CAFFE2_MOBILE
+  // Declared after the blobs, so that the nets and operators go first.
+  RunOnceCache<NetBase> run_once_nets_;
+  RunOnceCache<OperatorBase> run_once_ops_;
+  std::mutex run_once_mutex_;
 
   DISABLE_COPY_AND_ASSIGN(Workspace);
 };
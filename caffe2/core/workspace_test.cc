@@ -17,6 +17,7 @@
 #include <iostream>
 
 #include "caffe2/core/operator.h"
+#include "caffe2/core/scope_guard.h"
 #include <gtest/gtest.h>
 
 
@@ -26,6 +27,23 @@ class WorkspaceTestFoo {};
 
 CAFFE_KNOWN_TYPE(WorkspaceTestFoo);
 
+// Sets its output to the number of times it ran.
+class WorkspaceTestCountOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+  bool RunOnDevice() override {
+    Output(0)->Resize(1);
+    Output(0)->mutable_data<int>()[0] = ++count_;
+    return true;
+  }
+
+ private:
+  int count_ = 0;
+};
+
+REGISTER_CPU_OPERATOR(WorkspaceTestCount, WorkspaceTestCountOp);
+OPERATOR_SCHEMA(WorkspaceTestCount).NumInputs(0).NumOutputs(1);
+
 TEST(WorkspaceTest, BlobAccess) {
   Workspace ws;
 
@@ -131,4 +149,133 @@ TEST(WorkspaceTest, BlobMapping) {
   }
 }
 
+TEST(WorkspaceTest, BlobIds) {
+  Workspace parent;
+  Blob* shared_blob = parent.CreateBlob("shared");
+  Workspace ws(&parent);
+  const auto id = ws.GetBlobId("a");
+  EXPECT_EQ(ws.GetBlobId("a"), id);
+  EXPECT_EQ(ws.GetBlobName(id), "a");
+  // Ids can be assigned before the blob exists, and survive its removal.
+  EXPECT_TRUE(ws.GetBlob(id) == nullptr);
+  Blob* blob = ws.CreateBlob("a");
+  EXPECT_EQ(ws.GetBlob(id), blob);
+  EXPECT_TRUE(ws.RemoveBlob("a"));
+  EXPECT_TRUE(ws.GetBlob(id) == nullptr);
+  EXPECT_FALSE(ws.HasBlob("a"));
+  blob = ws.CreateBlob("a");
+  EXPECT_EQ(ws.GetBlobId("a"), id);
+  EXPECT_EQ(ws.GetBlob(id), blob);
+  EXPECT_EQ(ws.GetBlob("a"), blob);
+
+  // Ids of blobs from the shared workspace resolve through it, until a local
+  // blob hides them.
+  const auto shared_id = ws.GetBlobId("shared");
+  EXPECT_NE(shared_id, id);
+  EXPECT_EQ(ws.GetBlob(shared_id), shared_blob);
+  Blob* local_blob = ws.CreateLocalBlob("shared");
+  EXPECT_NE(local_blob, shared_blob);
+  EXPECT_EQ(ws.GetBlob(shared_id), local_blob);
+  EXPECT_THROW(ws.GetBlobName(shared_id + 1), EnforceNotMet);
+}
+
+TEST(WorkspaceTest, RemovedBlobNamesAreReleased) {
+  Workspace ws;
+  const auto id = ws.GetBlobId("kept");
+  // Blobs of ever new names reuse the ids of the removed ones, which are
+  // never handed out.
+  for (int i = 0; i < 100; ++i) {
+    const string name = "tmp_" + caffe2::to_string(i);
+    ws.CreateBlob(name);
+    EXPECT_TRUE(ws.RemoveBlob(name));
+    EXPECT_FALSE(ws.HasBlob(name));
+  }
+  EXPECT_THROW(ws.GetBlobName(id + 1), EnforceNotMet);
+  EXPECT_THROW(ws.GetBlobName(id + 2), EnforceNotMet);
+  Blob* blob = ws.CreateBlob("tmp_0");
+  EXPECT_EQ(ws.GetBlob("tmp_0"), blob);
+  EXPECT_EQ(ws.GetBlobName(ws.GetBlobId("tmp_0")), "tmp_0");
+  EXPECT_EQ(ws.GetBlobName(id), "kept");
+}
+
+TEST(WorkspaceTest, RunOnceReusesNetsAndOperators) {
+  auto old = FLAGS_caffe2_run_once_cache_size;
+  auto g = MakeGuard([&]() { FLAGS_caffe2_run_once_cache_size = old; });
+  auto count = [](const Workspace& ws) {
+    return ws.GetBlob("count")->Get<TensorCPU>().data<int>()[0];
+  };
+  OperatorDef op_def;
+  op_def.set_type("WorkspaceTestCount");
+  op_def.add_output("count");
+  NetDef net_def;
+  net_def.set_name("count");
+  *net_def.add_op() = op_def;
+
+  Workspace ws;
+  FLAGS_caffe2_run_once_cache_size = 0;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(ws.RunOperatorOnce(op_def));
+    EXPECT_EQ(count(ws), 1);
+    EXPECT_TRUE(ws.RunNetOnce(net_def));
+    EXPECT_EQ(count(ws), 1);
+  }
+
+  FLAGS_caffe2_run_once_cache_size = 4;
+  for (int i = 1; i <= 3; ++i) {
+    EXPECT_TRUE(ws.RunOperatorOnce(op_def));
+    EXPECT_EQ(count(ws), i);
+  }
+  for (int i = 1; i <= 3; ++i) {
+    EXPECT_TRUE(ws.RunNetOnce(net_def));
+    EXPECT_EQ(count(ws), i);
+  }
+  // Another def gets an operator of its own.
+  op_def.set_name("other");
+  EXPECT_TRUE(ws.RunOperatorOnce(op_def));
+  EXPECT_EQ(count(ws), 1);
+}
+
+TEST(WorkspaceTest, MemoryReport) {
+  Workspace ws;
+  auto* reserved = ws.CreateBlob("reserved")->GetMutable<TensorCPU>();
+  reserved->Resize(10);
+  reserved->mutable_data<float>();
+  CPUContext context;
+  reserved->Reserve(std::vector<TIndex>{100}, &context);
+  auto* shared = ws.CreateBlob("shared")->GetMutable<TensorCPU>();
+  shared->ResizeLike(*reserved);
+  shared->ShareData(*reserved);
+  auto* strings = ws.CreateBlob("strings")->GetMutable<TensorCPU>();
+  strings->Resize(2);
+  strings->mutable_data<std::string>()[0] = "abc";
+  ws.CreateBlob("foo")->GetMutable<WorkspaceTestFoo>();
+
+  const auto report = ws.MemoryReport();
+  ASSERT_EQ(report.blobs.size(), 4);
+  std::map<string, BlobMemoryInfo> blobs;
+  for (const auto& info : report.blobs) {
+    blobs[info.name] = info;
+  }
+  EXPECT_EQ(report.blobs[0].name, "reserved");
+  EXPECT_EQ(blobs["reserved"].used_bytes, 10 * sizeof(float));
+  EXPECT_EQ(blobs["reserved"].capacity_bytes, 100 * sizeof(float));
+  EXPECT_FALSE(blobs["reserved"].shares_data);
+  EXPECT_TRUE(blobs["shared"].shares_data);
+  EXPECT_EQ(
+      blobs["strings"].used_bytes, 2 * sizeof(std::string) + 3);
+  EXPECT_EQ(blobs["foo"].used_bytes, 0);
+  EXPECT_EQ(blobs["foo"].device, "cpu");
+
+  ASSERT_EQ(report.devices.size(), 1);
+  const auto& cpu = report.devices.at("cpu");
+  EXPECT_EQ(cpu.num_blobs, 4);
+  EXPECT_EQ(
+      cpu.capacity_bytes,
+      blobs["reserved"].capacity_bytes + blobs["shared"].capacity_bytes +
+          blobs["strings"].capacity_bytes);
+  EXPECT_EQ(
+      cpu.exclusive_bytes,
+      cpu.capacity_bytes - blobs["shared"].capacity_bytes);
+}
+
 }  // namespace caffe2
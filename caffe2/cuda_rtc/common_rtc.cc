@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/cuda_rtc/common_rtc.h"
+
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+#include "caffe2/core/flags.h"
+
+CAFFE2_DEFINE_string(
+    caffe2_cuda_rtc_cache_dir,
+    "",
+    "If set, the directory where the kernels compiled by the NVRTC operators "
+    "are kept, so that later processes load them instead of compiling them "
+    "again. The directory must exist. Compiled kernels are always kept in "
+    "memory for the life of the process.");
+
+namespace caffe2 {
+
+namespace {
+
+// 64-bit FNV-1a, which unlike std::hash is the same in every build, so it
+// can name the files of the on-disk cache.
+uint64_t Fingerprint(const string& s) {
+  uint64_t h = 14695981039346656037ULL;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+// Returns the options and the architecture the kernels of the current
+// device are compiled with, and the NVRTC version, which together with the
+// source determine the compiled kernel.
+string CompileSettings(vector<string>* options) {
+  const auto& prop = GetDeviceProperty(CaffeCudaGetDevice());
+  std::stringstream arch;
+  arch << prop.major << prop.minor;
+  options->push_back("--gpu-architecture=compute_" + arch.str());
+  options->push_back("--use_fast_math");
+  int major, minor;
+  NVRTC_CHECK(nvrtcVersion(&major, &minor));
+  std::stringstream ss;
+  ss << "nvrtc " << major << "." << minor << " sm_" << arch.str();
+  for (const auto& option : *options) {
+    ss << " " << option;
+  }
+  return ss.str();
+}
+
+string CompileToPTX(const string& src, const vector<string>& options) {
+  nvrtcProgram prog;
+  NVRTC_CHECK(
+      nvrtcCreateProgram(&prog, src.c_str(), nullptr, 0, nullptr, nullptr));
+  vector<const char*> nvrtc_opts;
+  for (const auto& option : options) {
+    nvrtc_opts.push_back(option.c_str());
+  }
+  nvrtcResult compile_result =
+      nvrtcCompileProgram(prog, nvrtc_opts.size(), nvrtc_opts.data());
+  if (compile_result != NVRTC_SUCCESS) {
+    size_t log_size;
+    NVRTC_CHECK(nvrtcGetProgramLogSize(prog, &log_size));
+    vector<char> nvrtc_log(log_size);
+    NVRTC_CHECK(nvrtcGetProgramLog(prog, nvrtc_log.data()));
+    LOG(FATAL) << "Compilation failure for nvrtc("
+               << nvrtcGetErrorString(compile_result) << "): \n"
+               << nvrtc_log.data();
+  }
+  size_t ptx_size;
+  NVRTC_CHECK(nvrtcGetPTXSize(prog, &ptx_size));
+  string ptx(ptx_size, '\0');
+  NVRTC_CHECK(nvrtcGetPTX(prog, &ptx[0]));
+  NVRTC_CHECK(nvrtcDestroyProgram(&prog));
+  return ptx;
+}
+
+// Assembles the PTX into a cubin for the device of the current context, so
+// that loading the kernel does not JIT compile it.
+string AssembleCubin(const string& ptx) {
+  CUlinkState state;
+  CUDA_DRIVERAPI_ENFORCE(cuLinkCreate(0, nullptr, nullptr, &state));
+  void* cubin;
+  size_t cubin_size;
+  CUresult result = cuLinkAddData(
+      state,
+      CU_JIT_INPUT_PTX,
+      const_cast<char*>(ptx.c_str()),
+      ptx.size(),
+      "rtc_kernel",
+      0,
+      nullptr,
+      nullptr);
+  if (result == CUDA_SUCCESS) {
+    result = cuLinkComplete(state, &cubin, &cubin_size);
+  }
+  string image;
+  if (result == CUDA_SUCCESS) {
+    // The cubin is owned by the link state.
+    image.assign(static_cast<const char*>(cubin), cubin_size);
+  }
+  CUDA_DRIVERAPI_ENFORCE(cuLinkDestroy(state));
+  CUDA_DRIVERAPI_ENFORCE(result);
+  return image;
+}
+
+// A cache file holds the key followed by a null character and the cubin, so
+// that a fingerprint collision or a truncated file is detected.
+string CacheFile(const string& key) {
+  char name[32];
+  snprintf(
+      name,
+      sizeof(name),
+      "%016llx.cubin",
+      static_cast<unsigned long long>(Fingerprint(key)));
+  return FLAGS_caffe2_cuda_rtc_cache_dir + "/" + name;
+}
+
+bool ReadCacheFile(const string& key, string* image) {
+  std::ifstream file(CacheFile(key), std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  string contents(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (contents.size() <= key.size() || contents.compare(0, key.size(), key) ||
+      contents[key.size()] != '\0') {
+    return false;
+  }
+  image->assign(contents, key.size() + 1, string::npos);
+  return true;
+}
+
+void WriteCacheFile(const string& key, const string& image) {
+  // Written to a file of this process and renamed, so that concurrent
+  // processes never read a partial file.
+  const string path = CacheFile(key);
+  const string tmp = path + "." + caffe2::to_string(getpid());
+  {
+    std::ofstream file(tmp, std::ios::binary);
+    file.write(key.c_str(), key.size() + 1);
+    file.write(image.data(), image.size());
+    if (!file) {
+      LOG(WARNING) << "Cannot write the NVRTC cache file " << tmp;
+      std::remove(tmp.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp.c_str(), path.c_str())) {
+    LOG(WARNING) << "Cannot write the NVRTC cache file " << path;
+    std::remove(tmp.c_str());
+  }
+}
+
+} // namespace
+
+string CudaRTCCompile(const string& src) {
+  static std::mutex mutex;
+  static std::unordered_map<string, string> cache;
+
+  vector<string> options;
+  const string key = CompileSettings(&options) + "\n" + src;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+      return it->second;
+    }
+  }
+  string image;
+  const bool use_disk = !FLAGS_caffe2_cuda_rtc_cache_dir.empty();
+  if (use_disk && ReadCacheFile(key, &image)) {
+    VLOG(1) << "Loaded the NVRTC kernel from " << CacheFile(key);
+  } else {
+    image = AssembleCubin(CompileToPTX(src, options));
+    if (use_disk) {
+      WriteCacheFile(key, image);
+    }
+  }
+  std::lock_guard<std::mutex> guard(mutex);
+  return cache.emplace(key, std::move(image)).first->second;
+}
+
+} // namespace caffe2
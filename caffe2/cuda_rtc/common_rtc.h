@@ -23,6 +23,8 @@
 #include <cuda.h>
 #include <nvrtc.h>
 
+#include "caffe2/core/common_gpu.h"
+
 #define NVRTC_CHECK(condition)                                                 \
   do {                                                                         \
     nvrtcResult result = condition;                                            \
@@ -34,6 +36,13 @@
 
 namespace caffe2 {
 
+// Returns the cubin of the kernel source for the device of the current
+// context, compiled with NVRTC unless it is already in the kernel cache.
+// The cache is keyed by the source, the architecture of the device and the
+// version of NVRTC. Every CudaRTCFunction loads its own module, so kernel
+// names need not be unique, and a fixed name lets the cache hit.
+std::string CudaRTCCompile(const std::string& src);
+
 template <typename Derived>
 class CudaRTCFunction {
  public:
@@ -53,37 +62,15 @@ class CudaRTCFunction {
     string name = static_cast<Derived*>(this)->KernelName(args...);
     VLOG(1) << "function name: " << name;
     VLOG(1) << "function src:\n" << src;
-    // Actually do the compiling.
-    nvrtcProgram prog;
-    NVRTC_CHECK(nvrtcCreateProgram(
-        &prog, src.c_str(), nullptr, 0, nullptr, nullptr));
-    // Compile the program.
-    // TODO(Yangqing): how to find the current gpu architecture instead of hard
-    // coding it?
-    const char *nvrtc_opts[] = {"--gpu-architecture=compute_35",
-                                "--use_fast_math"};
-    nvrtcResult compile_result = nvrtcCompileProgram(
-        prog, 2, nvrtc_opts);
-    if (compile_result != NVRTC_SUCCESS) {
-      size_t log_size;
-      NVRTC_CHECK(nvrtcGetProgramLogSize(prog, &log_size));
-      vector<char> nvrtc_log(log_size);
-      NVRTC_CHECK(nvrtcGetProgramLog(prog, nvrtc_log.data()));
-      LOG(FATAL) << "Compilation failure for nvrtc("
-                 << nvrtcGetErrorString(compile_result) << "): \n"
-                 << nvrtc_log.data();
-    }
-    size_t ptx_size;
-    NVRTC_CHECK(nvrtcGetPTXSize(prog, &ptx_size));
-    vector<char> nvrtc_ptx(ptx_size);
-    NVRTC_CHECK(nvrtcGetPTX(prog, nvrtc_ptx.data()));
-    NVRTC_CHECK(nvrtcDestroyProgram(&prog));
+    // Compiled kernels are shared by the whole process and, if
+    // --caffe2_cuda_rtc_cache_dir is set, by later processes.
+    string cubin = CudaRTCCompile(src);
     // After compilation, load the module.
     if (module_loaded_) {
       CUDA_DRIVERAPI_ENFORCE(cuModuleUnload(module_));
     }
     CUDA_DRIVERAPI_ENFORCE(
-        cuModuleLoadDataEx(&module_, nvrtc_ptx.data(), 0, 0, 0));
+        cuModuleLoadDataEx(&module_, cubin.data(), 0, 0, 0));
     module_loaded_ = true;
     CUDA_DRIVERAPI_ENFORCE(
         cuModuleGetFunction(&kernel_, module_, name.c_str()));
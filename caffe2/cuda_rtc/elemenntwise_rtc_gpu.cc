@@ -24,7 +24,8 @@ namespace {
 class ElementwiseRTCFunction
     : public CudaRTCFunction<ElementwiseRTCFunction> {
  public:
-  ElementwiseRTCFunction() : CudaRTCFunction(), name_(GetUniqueName()) {}
+  ElementwiseRTCFunction()
+      : CudaRTCFunction(), name_("caffe2_elementwise_rtc_kernel") {}
 
   template <typename... Args>
   string KernelName(Args... /*args*/) {
@@ -117,7 +117,8 @@ __global__ void %s(
 
 class MaxPoolRTCFunction : public CudaRTCFunction<MaxPoolRTCFunction> {
  public:
-  MaxPoolRTCFunction() : CudaRTCFunction(), name_(GetUniqueName()) {}
+  MaxPoolRTCFunction()
+      : CudaRTCFunction(), name_("caffe2_max_pool_rtc_kernel") {}
 
   template <typename... Args>
   string KernelName(Args... /*args*/) {
@@ -134,7 +135,8 @@ class MaxPoolRTCFunction : public CudaRTCFunction<MaxPoolRTCFunction> {
 class MaxPoolGradientRTCFunction
     : public CudaRTCFunction<MaxPoolGradientRTCFunction> {
  public:
-  MaxPoolGradientRTCFunction() : CudaRTCFunction(), name_(GetUniqueName()) {}
+  MaxPoolGradientRTCFunction()
+      : CudaRTCFunction(), name_("caffe2_max_pool_gradient_rtc_kernel") {}
 
   template <typename... Args>
   string KernelName(Args... /*args*/) {
@@ -0,0 +1,505 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <mutex>
+
+#include "caffe2/core/db.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/utils/string_utils.h"
+
+namespace caffe2 {
+namespace db {
+
+// ColumnDB stores records whose values are serialized TensorProtos, typically
+// one TensorProto per field of a dataset, column by column. The records are
+// grouped into blocks, and every column of a block is compressed with zlib on
+// its own, so that a reader only reads and decompresses the fields it asks
+// for. A reader selects fields with a source of the form "path?fields=0,2",
+// the values it returns then only hold those TensorProtos in that order.
+// Cursors decode the next blocks in the background while the current one is
+// being read.
+//
+// File layout, with integers in host byte order:
+//   kMagic
+//   blocks, each made of
+//     uint32 number of records, uint32 number of columns,
+//     uint64 compressed size and uint64 raw size of every column,
+//     the compressed columns, the keys first and then one column per field.
+//     A raw column is the uint32 size of every entry followed by the entries.
+//   block index: uint64 number of blocks, then the uint64 offset and uint64
+//     number of records of every block
+//   uint64 offset of the block index, kMagic
+namespace {
+
+constexpr char kMagic[8] = {'C', '2', 'C', 'O', 'L', 'D', 'B', '1'};
+// Raw size of the columns of a block after which it is written out
+constexpr size_t kBlockBytes = 1 << 22;
+// Number of blocks a cursor decodes ahead of the current one
+constexpr int kPrefetchBlocks = 2;
+
+struct BlockInfo {
+  uint64_t offset;
+  uint64_t numRecords;
+};
+
+void ParseSource(
+    const string& source,
+    string* path,
+    std::vector<int>* fields) {
+  const auto pos = source.find("?fields=");
+  *path = source.substr(0, pos);
+  fields->clear();
+  if (pos != string::npos) {
+    for (const auto& field : split(',', source.substr(pos + 8))) {
+      fields->push_back(std::stoi(field));
+      CAFFE_ENFORCE_GE(fields->back(), 0, "Invalid field in ", source);
+    }
+  }
+}
+
+void ReadAt(int fd, uint64_t offset, size_t size, void* dst) {
+  char* ptr = static_cast<char*>(dst);
+  while (size > 0) {
+    const auto numRead = pread(fd, ptr, size, offset);
+    CAFFE_ENFORCE_GT(
+        numRead, 0, "Error reading ColumnDB: ", std::strerror(errno));
+    ptr += numRead;
+    offset += numRead;
+    size -= numRead;
+  }
+}
+
+void WriteAll(int fd, const void* src, size_t size) {
+  const char* ptr = static_cast<const char*>(src);
+  while (size > 0) {
+    const auto numWritten = write(fd, ptr, size);
+    CAFFE_ENFORCE_GT(
+        numWritten, 0, "Error writing ColumnDB: ", std::strerror(errno));
+    ptr += numWritten;
+    size -= numWritten;
+  }
+}
+
+template <typename T>
+void Append(string* out, T value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T Extract(const char* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+// Reads the block index, returns the offset it starts at.
+uint64_t ReadIndex(int fd, std::vector<BlockInfo>* blocks) {
+  const auto fileSize = lseek(fd, 0, SEEK_END);
+  const size_t trailerSize = sizeof(uint64_t) + sizeof(kMagic);
+  CAFFE_ENFORCE_GE(
+      fileSize, sizeof(kMagic) + sizeof(uint64_t) + trailerSize,
+      "Not a ColumnDB file.");
+  char trailer[sizeof(uint64_t) + sizeof(kMagic)];
+  ReadAt(fd, fileSize - trailerSize, trailerSize, trailer);
+  CAFFE_ENFORCE(
+      std::memcmp(trailer + sizeof(uint64_t), kMagic, sizeof(kMagic)) == 0,
+      "Not a ColumnDB file or it was not closed properly.");
+  const uint64_t indexOffset = Extract<uint64_t>(trailer);
+
+  uint64_t numBlocks;
+  ReadAt(fd, indexOffset, sizeof(numBlocks), &numBlocks);
+  blocks->resize(numBlocks);
+  if (numBlocks > 0) {
+    ReadAt(
+        fd,
+        indexOffset + sizeof(numBlocks),
+        numBlocks * sizeof(BlockInfo),
+        blocks->data());
+  }
+  return indexOffset;
+}
+
+string Compress(const string& raw) {
+  uLongf size = compressBound(raw.size());
+  string compressed(size, '\0');
+  CAFFE_ENFORCE_EQ(
+      compress2(
+          reinterpret_cast<Bytef*>(&compressed[0]),
+          &size,
+          reinterpret_cast<const Bytef*>(raw.data()),
+          raw.size(),
+          Z_DEFAULT_COMPRESSION),
+      Z_OK);
+  compressed.resize(size);
+  return compressed;
+}
+
+// One decompressed column of a block
+struct Column {
+  string data;
+  // start of every entry in data, and the end of the last one
+  std::vector<uint64_t> offsets;
+
+  void Decode(const string& compressed, uint64_t rawSize, uint32_t numRecords) {
+    data.resize(rawSize);
+    uLongf size = rawSize;
+    CAFFE_ENFORCE_EQ(
+        uncompress(
+            reinterpret_cast<Bytef*>(&data[0]),
+            &size,
+            reinterpret_cast<const Bytef*>(compressed.data()),
+            compressed.size()),
+        Z_OK,
+        "Corrupted ColumnDB block.");
+    CAFFE_ENFORCE_EQ(size, rawSize, "Corrupted ColumnDB block.");
+    offsets.resize(numRecords + 1);
+    offsets[0] = numRecords * sizeof(uint32_t);
+    for (uint32_t i = 0; i < numRecords; ++i) {
+      offsets[i + 1] = offsets[i] +
+          Extract<uint32_t>(data.data() + i * sizeof(uint32_t));
+    }
+    CAFFE_ENFORCE_EQ(offsets.back(), rawSize, "Corrupted ColumnDB block.");
+  }
+
+  const char* entry(size_t i) const {
+    return data.data() + offsets[i];
+  }
+  size_t entrySize(size_t i) const {
+    return offsets[i + 1] - offsets[i];
+  }
+};
+
+struct DecodedBlock {
+  uint32_t numRecords;
+  Column keys;
+  // the selected fields, or all of them
+  std::vector<Column> fields;
+};
+
+// Reads and decompresses the keys and the given fields of a block.
+std::unique_ptr<DecodedBlock> LoadBlock(
+    int fd,
+    const BlockInfo& info,
+    const std::vector<int>& fields) {
+  uint32_t counts[2];
+  ReadAt(fd, info.offset, sizeof(counts), counts);
+  const uint32_t numRecords = counts[0];
+  const uint32_t numColumns = counts[1];
+  std::vector<uint64_t> sizes(2 * numColumns);
+  ReadAt(
+      fd, info.offset + sizeof(counts), sizes.size() * sizeof(uint64_t),
+      sizes.data());
+  std::vector<uint64_t> columnOffsets(numColumns);
+  uint64_t offset =
+      info.offset + sizeof(counts) + sizes.size() * sizeof(uint64_t);
+  for (uint32_t c = 0; c < numColumns; ++c) {
+    columnOffsets[c] = offset;
+    offset += sizes[2 * c];
+  }
+
+  auto decode = [&](uint32_t c, Column* column) {
+    string compressed(sizes[2 * c], '\0');
+    ReadAt(fd, columnOffsets[c], compressed.size(), &compressed[0]);
+    column->Decode(compressed, sizes[2 * c + 1], numRecords);
+  };
+
+  std::unique_ptr<DecodedBlock> block(new DecodedBlock());
+  block->numRecords = numRecords;
+  decode(0, &block->keys);
+  if (fields.empty()) {
+    block->fields.resize(numColumns - 1);
+    for (uint32_t c = 1; c < numColumns; ++c) {
+      decode(c, &block->fields[c - 1]);
+    }
+  } else {
+    block->fields.resize(fields.size());
+    for (int i = 0; i < fields.size(); ++i) {
+      CAFFE_ENFORCE_LT(
+          fields[i] + 1, numColumns, "ColumnDB has no field ", fields[i]);
+      decode(fields[i] + 1, &block->fields[i]);
+    }
+  }
+  return block;
+}
+
+} // namespace
+
+class ColumnDBCursor : public Cursor {
+ public:
+  ColumnDBCursor(
+      const string& path,
+      const std::vector<BlockInfo>* blocks,
+      const std::vector<int>& fields)
+      : blocks_(blocks), fields_(fields) {
+    fd_ = open(path.c_str(), O_RDONLY);
+    CAFFE_ENFORCE_GE(
+        fd_, 0, "Cannot open ColumnDB ", path, ": ", std::strerror(errno));
+    SeekToFirst();
+  }
+  ~ColumnDBCursor() {
+    // The pending blocks read from fd_.
+    pending_.clear();
+    close(fd_);
+  }
+
+  void Seek(const string& /*key*/) override {
+    CAFFE_THROW("ColumnDB does not support seeking.");
+  }
+
+  void SeekToFirst() override {
+    pending_.clear();
+    nextBlock_ = 0;
+    LoadNextBlock();
+  }
+
+  void Next() override {
+    if (++record_ >= block_->numRecords) {
+      LoadNextBlock();
+    }
+  }
+
+  string key() override {
+    return string(block_->keys.entry(record_), block_->keys.entrySize(record_));
+  }
+
+  // The record is reassembled in the wire format of TensorProtos, whose
+  // only field is the repeated TensorProto protos = 1.
+  string value() override {
+    string value;
+    for (const auto& field : block_->fields) {
+      const size_t size = field.entrySize(record_);
+      value.push_back('\x0a');
+      for (size_t rest = size; ; rest >>= 7) {
+        if (rest < 0x80) {
+          value.push_back(static_cast<char>(rest));
+          break;
+        }
+        value.push_back(static_cast<char>((rest & 0x7f) | 0x80));
+      }
+      value.append(field.entry(record_), size);
+    }
+    return value;
+  }
+
+  bool Valid() override {
+    return block_ != nullptr;
+  }
+
+ private:
+  // Moves to the first record of the next block, keeping up to
+  // kPrefetchBlocks blocks after it decoding in the background.
+  void LoadNextBlock() {
+    record_ = 0;
+    while (pending_.size() < kPrefetchBlocks + 1 &&
+           nextBlock_ < blocks_->size()) {
+      const BlockInfo info = (*blocks_)[nextBlock_++];
+      pending_.push_back(std::async(
+          std::launch::async, LoadBlock, fd_, info, std::cref(fields_)));
+    }
+    if (pending_.empty()) {
+      block_.reset();
+      return;
+    }
+    block_ = pending_.front().get();
+    pending_.pop_front();
+  }
+
+  int fd_;
+  const std::vector<BlockInfo>* blocks_;
+  const std::vector<int> fields_;
+  size_t nextBlock_{0};
+  std::deque<std::future<std::unique_ptr<DecodedBlock>>> pending_;
+  std::unique_ptr<DecodedBlock> block_;
+  size_t record_{0};
+};
+
+class ColumnDB;
+
+class ColumnDBTransaction : public Transaction {
+ public:
+  explicit ColumnDBTransaction(ColumnDB* db) : db_(db) {}
+  ~ColumnDBTransaction() {
+    Commit();
+  }
+
+  void Put(const string& key, const string& value) override {
+    TensorProtos protos;
+    CAFFE_ENFORCE(
+        protos.ParseFromString(value),
+        "ColumnDB values must be serialized TensorProtos.");
+    if (numRecords_ == 0) {
+      columns_.clear();
+      columns_.resize(protos.protos_size() + 1);
+      rawBytes_ = 0;
+    }
+    CAFFE_ENFORCE_EQ(
+        protos.protos_size() + 1,
+        columns_.size(),
+        "All the records of a ColumnDB block must have the same fields.");
+    AddEntry(&columns_[0], key);
+    for (int i = 0; i < protos.protos_size(); ++i) {
+      AddEntry(&columns_[i + 1], protos.protos(i).SerializeAsString());
+    }
+    ++numRecords_;
+    if (rawBytes_ >= kBlockBytes) {
+      Commit();
+    }
+  }
+
+  void Commit() override;
+
+ private:
+  struct RawColumn {
+    std::vector<uint32_t> sizes;
+    string data;
+  };
+
+  void AddEntry(RawColumn* column, const string& entry) {
+    column->sizes.push_back(entry.size());
+    column->data.append(entry);
+    rawBytes_ += entry.size() + sizeof(uint32_t);
+  }
+
+  ColumnDB* db_;
+  std::vector<RawColumn> columns_;
+  uint32_t numRecords_{0};
+  size_t rawBytes_{0};
+
+  DISABLE_COPY_AND_ASSIGN(ColumnDBTransaction);
+};
+
+class ColumnDB : public DB {
+ public:
+  ColumnDB(const string& source, Mode mode) : DB(source, mode) {
+    ParseSource(source, &path_, &fields_);
+    if (mode == NEW) {
+      fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    } else {
+      fd_ = open(path_.c_str(), mode == READ ? O_RDONLY : O_RDWR);
+    }
+    CAFFE_ENFORCE_GE(
+        fd_, 0, "Cannot open ColumnDB ", path_, ": ", std::strerror(errno));
+    if (mode == NEW) {
+      WriteAll(fd_, kMagic, sizeof(kMagic));
+      end_ = sizeof(kMagic);
+    } else {
+      end_ = ReadIndex(fd_, &blocks_);
+    }
+    if (mode == WRITE) {
+      // New blocks go over the index, which is written again on Close().
+      CAFFE_ENFORCE_EQ(ftruncate(fd_, end_), 0, std::strerror(errno));
+      CAFFE_ENFORCE_EQ(lseek(fd_, end_, SEEK_SET), end_);
+    }
+    LOG(INFO) << "Opened columndb " << path_;
+  }
+  ~ColumnDB() {
+    Close();
+  }
+
+  void Close() override {
+    if (fd_ < 0) {
+      return;
+    }
+    if (mode_ == NEW || mode_ == WRITE) {
+      string index;
+      Append<uint64_t>(&index, blocks_.size());
+      for (const auto& info : blocks_) {
+        Append<uint64_t>(&index, info.offset);
+        Append<uint64_t>(&index, info.numRecords);
+      }
+      Append<uint64_t>(&index, end_);
+      index.append(kMagic, sizeof(kMagic));
+      WriteAll(fd_, index.data(), index.size());
+    }
+    close(fd_);
+    fd_ = -1;
+  }
+
+  unique_ptr<Cursor> NewCursor() override {
+    CAFFE_ENFORCE_EQ(mode_, READ, "ColumnDB cursors need the READ mode.");
+    return make_unique<ColumnDBCursor>(path_, &blocks_, fields_);
+  }
+  unique_ptr<Transaction> NewTransaction() override {
+    CAFFE_ENFORCE_NE(mode_, READ, "ColumnDB transactions need a write mode.");
+    return make_unique<ColumnDBTransaction>(this);
+  }
+  // Every cursor reads the file through its own descriptor.
+  bool SupportsConcurrentCursors() override {
+    return true;
+  }
+
+  // Appends a block made of the given raw columns.
+  void WriteBlock(uint32_t numRecords, const std::vector<string>& rawColumns) {
+    std::vector<string> compressed;
+    string header;
+    Append<uint32_t>(&header, numRecords);
+    Append<uint32_t>(&header, rawColumns.size());
+    for (const auto& raw : rawColumns) {
+      compressed.push_back(Compress(raw));
+      Append<uint64_t>(&header, compressed.back().size());
+      Append<uint64_t>(&header, raw.size());
+    }
+    std::lock_guard<std::mutex> guard(writeMutex_);
+    blocks_.push_back({end_, numRecords});
+    WriteAll(fd_, header.data(), header.size());
+    end_ += header.size();
+    for (const auto& column : compressed) {
+      WriteAll(fd_, column.data(), column.size());
+      end_ += column.size();
+    }
+  }
+
+ private:
+  string path_;
+  std::vector<int> fields_;
+  int fd_;
+  std::vector<BlockInfo> blocks_;
+  // end of the last block
+  uint64_t end_;
+  std::mutex writeMutex_;
+};
+
+void ColumnDBTransaction::Commit() {
+  if (numRecords_ == 0) {
+    return;
+  }
+  std::vector<string> rawColumns(columns_.size());
+  for (int c = 0; c < columns_.size(); ++c) {
+    const auto& column = columns_[c];
+    rawColumns[c].reserve(
+        column.sizes.size() * sizeof(uint32_t) + column.data.size());
+    rawColumns[c].append(
+        reinterpret_cast<const char*>(column.sizes.data()),
+        column.sizes.size() * sizeof(uint32_t));
+    rawColumns[c].append(column.data);
+  }
+  db_->WriteBlock(numRecords_, rawColumns);
+  numRecords_ = 0;
+  columns_.clear();
+}
+
+REGISTER_CAFFE2_DB(ColumnDB, ColumnDB);
+REGISTER_CAFFE2_DB(columndb, ColumnDB);
+
+} // namespace db
+} // namespace caffe2
@@ -19,7 +19,19 @@
 namespace caffe2 {
 REGISTER_CPU_OPERATOR(CreateDB, CreateDBOp<CPUContext>);
 
-OPERATOR_SCHEMA(CreateDB).NumInputs(0).NumOutputs(1);
+OPERATOR_SCHEMA(CreateDB)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .Arg("db_type", "(string, default leveldb) type of the db to read.")
+    .Arg("db", "(string) source of the db to read.")
+    .Arg("num_shards", "(int, default 1) number of shards of the db.")
+    .Arg("shard_id", "(int, default 0) the shard this reader reads.")
+    .Arg(
+        "num_cursors",
+        "(int, default 1) number of cursors the records of the shard are "
+        "split between, so that concurrent reads do not wait for each other. "
+        "Needs a db that supports concurrent cursors, like leveldb, lmdb or "
+        "rocksdb.");
 
 NO_GRADIENT(CreateDB);
 }  // namespace caffe2
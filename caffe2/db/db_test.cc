@@ -212,5 +212,153 @@ TEST(DBReaderShardedTest, Reader) {
   EXPECT_EQ(value, "05");
 }
 
+static void ExpectReads(const DBReader& reader, const vector<string>& keys) {
+  string key;
+  string value;
+  for (const auto& expected : keys) {
+    reader.Read(&key, &value);
+    EXPECT_EQ(key, expected);
+    EXPECT_EQ(value, expected);
+  }
+}
+
+static void DBReaderMultiCursorTestWrapper(const string& db_type) {
+  std::string name = std::tmpnam(nullptr);
+  ASSERT_TRUE(CreateAndFill(db_type, name));
+  // The ten records are split into [00, 03), [03, 06) and [06, 10), and the
+  // reads go to the three cursors in turn.
+  std::unique_ptr<DBReader> reader(new DBReader(db_type, name, 1, 0, 3));
+  EXPECT_EQ(reader->num_cursors(), 3);
+  ExpectReads(
+      *reader,
+      {"00", "03", "06", "01", "04", "07", "02", "05", "08", "00", "03", "09"});
+
+  // Every cursor keeps its position through serialization.
+  reader->SeekToFirst();
+  ExpectReads(*reader, {"00", "03", "06", "01"});
+  Blob reader_blob;
+  reader_blob.Reset(reader.release());
+  std::string str = reader_blob.Serialize("saved_reader");
+  reader_blob.Reset();
+  BlobProto blob_proto;
+  CHECK(blob_proto.ParseFromString(str));
+  DBReaderProto proto;
+  CHECK(proto.ParseFromString(blob_proto.content()));
+  EXPECT_EQ(proto.cursor_positions_size(), 3);
+  EXPECT_NO_THROW(reader_blob.Deserialize(str));
+  const DBReader& new_reader = reader_blob.Get<DBReader>();
+  EXPECT_EQ(new_reader.num_cursors(), 3);
+  ExpectReads(new_reader, {"02", "04", "07", "00", "05", "08"});
+
+  // The records of a shard are split between the cursors.
+  std::unique_ptr<DBReader> sharded(new DBReader(db_type, name, 2, 1, 2));
+  ExpectReads(*sharded, {"01", "05", "03", "07", "01", "09", "03", "05"});
+}
+
+TEST(DBReaderMultiCursorTest, LevelDB) {
+  DBReaderMultiCursorTestWrapper("leveldb");
+}
+
+TEST(DBReaderMultiCursorTest, LMDB) {
+  DBReaderMultiCursorTestWrapper("lmdb");
+}
+
+TEST(DBReaderMultiCursorTest, RejectsSingleCursorDB) {
+  std::string name = std::tmpnam(nullptr);
+  ASSERT_TRUE(CreateAndFill("minidb", name));
+  EXPECT_THROW(DBReader("minidb", name, 1, 0, 2), EnforceNotMet);
+}
+
+static string ColumnDBKey(int i) {
+  std::stringstream ss;
+  ss << std::setw(2) << std::setfill('0') << i;
+  return ss.str();
+}
+
+static string ColumnDBRecord(int i) {
+  TensorProtos protos;
+  for (int field = 0; field < 3; ++field) {
+    auto* proto = protos.add_protos();
+    proto->set_data_type(TensorProto::INT32);
+    proto->add_dims(field + 1);
+    for (int j = 0; j <= field; ++j) {
+      proto->add_int32_data(i * 10 + field);
+    }
+  }
+  return protos.SerializeAsString();
+}
+
+static void ExpectColumnDBRecords(const string& source, int num_records) {
+  std::unique_ptr<DB> db(CreateDB("columndb", source, READ));
+  std::unique_ptr<Cursor> cursor(db->NewCursor());
+  for (int pass = 0; pass < 2; ++pass) {
+    cursor->SeekToFirst();
+    for (int i = 0; i < num_records; ++i) {
+      ASSERT_TRUE(cursor->Valid());
+      EXPECT_EQ(cursor->key(), ColumnDBKey(i));
+      EXPECT_EQ(cursor->value(), ColumnDBRecord(i));
+      cursor->Next();
+    }
+    EXPECT_FALSE(cursor->Valid());
+  }
+}
+
+TEST(ColumnDBTest, ReadWrite) {
+  std::string name = std::tmpnam(nullptr);
+  {
+    std::unique_ptr<DB> db(CreateDB("columndb", name, NEW));
+    std::unique_ptr<Transaction> trans(db->NewTransaction());
+    for (int i = 0; i < 25; ++i) {
+      trans->Put(ColumnDBKey(i), ColumnDBRecord(i));
+      // Every commit ends a block.
+      if (i % 7 == 6) {
+        trans->Commit();
+      }
+    }
+    EXPECT_THROW(trans->Put("bad", "\xff\xff"), EnforceNotMet);
+  }
+  ExpectColumnDBRecords(name, 25);
+
+  // Appending keeps the existing blocks.
+  {
+    std::unique_ptr<DB> db(CreateDB("columndb", name, WRITE));
+    std::unique_ptr<Transaction> trans(db->NewTransaction());
+    for (int i = 25; i < 30; ++i) {
+      trans->Put(ColumnDBKey(i), ColumnDBRecord(i));
+    }
+  }
+  ExpectColumnDBRecords(name, 30);
+
+  // Only the selected fields are returned, in the selected order.
+  std::unique_ptr<DB> db(CreateDB("columndb", name + "?fields=2,0", READ));
+  std::unique_ptr<Cursor> cursor(db->NewCursor());
+  for (int i = 0; i < 30; ++i, cursor->Next()) {
+    ASSERT_TRUE(cursor->Valid());
+    TensorProtos protos;
+    ASSERT_TRUE(protos.ParseFromString(cursor->value()));
+    ASSERT_EQ(protos.protos_size(), 2);
+    EXPECT_EQ(protos.protos(0).int32_data_size(), 3);
+    EXPECT_EQ(protos.protos(0).int32_data(0), i * 10 + 2);
+    EXPECT_EQ(protos.protos(1).int32_data_size(), 1);
+    EXPECT_EQ(protos.protos(1).int32_data(0), i * 10);
+  }
+  EXPECT_FALSE(cursor->Valid());
+  EXPECT_THROW(
+      CreateDB("columndb", name + "?fields=3", READ)->NewCursor(),
+      EnforceNotMet);
+
+  // Cursors can read concurrently.
+  std::unique_ptr<DBReader> reader(new DBReader("columndb", name, 1, 0, 3));
+  std::set<string> keys;
+  string key;
+  string value;
+  for (int i = 0; i < 30; ++i) {
+    reader->Read(&key, &value);
+    keys.insert(key);
+  }
+  EXPECT_EQ(keys.size(), 30);
+  std::remove(name.c_str());
+}
+
 }  // namespace db
 }  // namespace caffe2
@@ -95,6 +95,9 @@ class LevelDB : public DB {
   unique_ptr<Transaction> NewTransaction() override {
     return make_unique<LevelDBTransaction>(db_.get());
   }
+  bool SupportsConcurrentCursors() override {
+    return true;
+  }
 
  private:
   std::unique_ptr<leveldb::DB> db_;
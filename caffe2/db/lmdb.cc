@@ -149,6 +149,15 @@ class LMDB : public DB {
   unique_ptr<Transaction> NewTransaction() override {
     return make_unique<LMDBTransaction>(mdb_env_);
   }
+  // Read transactions are not tied to threads when reading (MDB_NOTLS), so
+  // every cursor can be used from its own thread.
+  bool SupportsConcurrentCursors() override {
+    return mode_ == READ;
+  }
+  void MultiGet(
+      const vector<string>& keys,
+      vector<string>* values,
+      vector<bool>* found) override;
 
  private:
   MDB_env* mdb_env_;
@@ -182,6 +191,35 @@ void LMDBTransaction::Put(const string& key, const string& value) {
   MDB_CHECK(mdb_put(mdb_txn_, mdb_dbi_, &mdb_key, &mdb_value, 0));
 }
 
+void LMDB::MultiGet(
+    const vector<string>& keys,
+    vector<string>* values,
+    vector<bool>* found) {
+  values->assign(keys.size(), string());
+  found->assign(keys.size(), false);
+  // A read transaction of its own sees the writes committed so far, unlike
+  // the one of a cursor that was opened earlier.
+  MDB_txn* mdb_txn;
+  MDB_dbi mdb_dbi;
+  MDB_CHECK(mdb_txn_begin(mdb_env_, NULL, MDB_RDONLY, &mdb_txn));
+  int mdb_status = mdb_dbi_open(mdb_txn, NULL, 0, &mdb_dbi);
+  for (size_t i = 0; i < keys.size() && mdb_status == MDB_SUCCESS; ++i) {
+    MDB_val mdb_key, mdb_value;
+    mdb_key.mv_data = const_cast<char*>(keys[i].data());
+    mdb_key.mv_size = keys[i].size();
+    mdb_status = mdb_get(mdb_txn, mdb_dbi, &mdb_key, &mdb_value);
+    if (mdb_status == MDB_NOTFOUND) {
+      mdb_status = MDB_SUCCESS;
+    } else if (mdb_status == MDB_SUCCESS) {
+      (*values)[i].assign(
+          static_cast<const char*>(mdb_value.mv_data), mdb_value.mv_size);
+      (*found)[i] = true;
+    }
+  }
+  mdb_txn_abort(mdb_txn);
+  MDB_CHECK(mdb_status);
+}
+
 REGISTER_CAFFE2_DB(LMDB, LMDB);
 REGISTER_CAFFE2_DB(lmdb, LMDB);
 
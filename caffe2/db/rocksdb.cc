@@ -100,6 +100,26 @@ class RocksDB : public DB {
   unique_ptr<Transaction> NewTransaction() override {
     return make_unique<RocksDBTransaction>(db_.get());
   }
+  bool SupportsConcurrentCursors() override {
+    return true;
+  }
+  void MultiGet(
+      const vector<string>& keys,
+      vector<string>* values,
+      vector<bool>* found) override {
+    std::vector<rocksdb::Slice> slices(keys.begin(), keys.end());
+    auto statuses = db_->MultiGet(rocksdb::ReadOptions(), slices, values);
+    found->assign(keys.size(), false);
+    for (size_t i = 0; i < statuses.size(); ++i) {
+      if (statuses[i].IsNotFound()) {
+        continue;
+      }
+      CAFFE_ENFORCE(
+          statuses[i].ok(),
+          "Failed to read from rocksdb: " + statuses[i].ToString());
+      (*found)[i] = true;
+    }
+  }
 
  private:
   std::unique_ptr<rocksdb::DB> db_;
@@ -14,38 +14,56 @@
  * limitations under the License.
  */
 
-#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <thread>  // NOLINT
 
 #include "caffe2/core/db.h"
 #include "caffe2/utils/zmq_helper.h"
 #include "caffe2/core/logging.h"
+#include "caffe2/utils/string_utils.h"
 
 namespace caffe2 {
 namespace db {
 
+// Reads key-value pairs pushed by one or more feeders. The source is a
+// comma-separated list of addresses; each of them gets its own socket and
+// receiving thread, and the cursor returns the pairs in the order they
+// arrive.
 class ZmqDBCursor : public Cursor {
  public:
   explicit ZmqDBCursor(const string& source)
-      : source_(source), socket_(ZMQ_PULL),
-        prefetched_(false), finalize_(false) {
-    socket_.Connect(source_);
-    // Start prefetching thread.
-    prefetch_thread_.reset(
-        new std::thread([this] { this->Prefetch(); }));
+      : sources_(split(',', source)), finalize_(false) {
+    CAFFE_ENFORCE(!source.empty(), "ZeroMQ DB needs a source address.");
+    for (const auto& address : sources_) {
+      sockets_.emplace_back(new ZmqSocket(ZMQ_PULL));
+      // Wake up regularly so that the threads notice when to quit.
+      sockets_.back()->SetOption(ZMQ_RCVTIMEO, kReceiveTimeoutMs);
+      sockets_.back()->Connect(address);
+    }
+    // Each socket is only used by its thread from now on.
+    for (auto& socket : sockets_) {
+      ZmqSocket* ptr = socket.get();
+      prefetch_threads_.emplace_back([this, ptr] { this->Prefetch(ptr); });
+    }
     // obtain the first value.
     Next();
   }
 
   ~ZmqDBCursor() {
-    finalize_ = true;
-    prefetched_ = false;
-    producer_.notify_one();
-    // Wait for the prefetch thread to finish elegantly.
-    prefetch_thread_->join();
-    socket_.Disconnect(source_);
+    {
+      std::lock_guard<std::mutex> lock(prefetch_access_mutex_);
+      finalize_ = true;
+    }
+    producer_.notify_all();
+    // Wait for the prefetch threads to finish elegantly.
+    for (auto& thread : prefetch_threads_) {
+      thread.join();
+    }
+    for (int i = 0; i < sources_.size(); ++i) {
+      sockets_[i]->Disconnect(sources_[i]);
+    }
   }
 
   void Seek(const string& /*key*/) override { /* do nothing */
@@ -55,49 +73,70 @@ class ZmqDBCursor : public Cursor {
 
   void Next() override {
     std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
-    while (!prefetched_) consumer_.wait(lock);
-    key_ = prefetch_key_;
-    value_ = prefetch_value_;
-    prefetched_ = false;
+    consumer_.wait(lock, [this] { return !prefetched_.empty(); });
+    key_ = std::move(prefetched_.front().first);
+    value_ = std::move(prefetched_.front().second);
+    prefetched_.pop_front();
     producer_.notify_one();
   }
 
-  string key() override { return key_; }
-  string value() override { return value_; }
+  // The strings are built straight from the received messages, which is
+  // the only copy of the data on the way from the socket.
+  string key() override {
+    return string(static_cast<char*>(key_->data()), key_->size());
+  }
+  string value() override {
+    return string(static_cast<char*>(value_->data()), value_->size());
+  }
   bool Valid() override { return true; }
 
  private:
-
-  void Prefetch() {
-    while (!finalize_) {
-      std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
-      while (prefetched_) producer_.wait(lock);
-      if (finalize_) {
-        return;
+  using MessagePair = std::pair<unique_ptr<ZmqMessage>, unique_ptr<ZmqMessage>>;
+
+  static constexpr int kReceiveTimeoutMs = 100;
+  // Pairs that may wait in the queue for each source.
+  static constexpr int kPrefetchPerSource = 4;
+
+  void Prefetch(ZmqSocket* socket) {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
+        producer_.wait(lock, [this] {
+          return finalize_ ||
+              prefetched_.size() < kPrefetchPerSource * sources_.size();
+        });
+        if (finalize_) {
+          return;
+        }
       }
-      ZmqMessage msg;
-      socket_.RecvTillSuccess(&msg);
-      prefetch_key_.assign(static_cast<char*>(msg.data()), msg.size());
-      socket_.RecvTillSuccess(&msg);
-      prefetch_value_.assign(static_cast<char*>(msg.data()), msg.size());
-      prefetched_ = true;
+      // Receive without holding the lock, so that the other sources and the
+      // consumer are not held up.
+      MessagePair pair(make_unique<ZmqMessage>(), make_unique<ZmqMessage>());
+      while (socket->Recv(pair.first.get()) < 0) {
+        std::lock_guard<std::mutex> lock(prefetch_access_mutex_);
+        if (finalize_) {
+          return;
+        }
+      }
+      // The parts of a multi-part message arrive together.
+      socket->RecvTillSuccess(pair.second.get());
+      std::lock_guard<std::mutex> lock(prefetch_access_mutex_);
+      prefetched_.push_back(std::move(pair));
       consumer_.notify_one();
     }
   }
 
-  string source_;
-  ZmqSocket socket_;
-  string key_;
-  string value_;
-  string prefetch_key_;
-  string prefetch_value_;
+  vector<string> sources_;
+  vector<unique_ptr<ZmqSocket>> sockets_;
+  unique_ptr<ZmqMessage> key_;
+  unique_ptr<ZmqMessage> value_;
 
-  unique_ptr<std::thread> prefetch_thread_;
+  vector<std::thread> prefetch_threads_;
   std::mutex prefetch_access_mutex_;
   std::condition_variable producer_, consumer_;
-  std::atomic<bool> prefetched_;
-  // finalize_ is used to tell the prefetcher to quit.
-  std::atomic<bool> finalize_;
+  std::deque<MessagePair> prefetched_;
+  // finalize_ is used to tell the prefetchers to quit.
+  bool finalize_;
 };
 
 class ZmqDB : public DB {
@@ -23,6 +23,13 @@
 #include <stdlib.h>
 #include <sys/stat.h>
 
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <iostream>
@@ -65,9 +72,29 @@ FileStoreHandler::FileStoreHandler(
   if (ret == -1) {
     CHECK_EQ(errno, EEXIST) << "mkdir: " << strerror(errno);
   }
+#if defined(__linux__)
+  // Lets wait() sleep on inotify events for the store directory rather than
+  // a fixed interval, so a set() on the same host wakes the waiters right
+  // away. inotify does not see the changes other hosts make on shared
+  // filesystems (such as NFS), so wait() still checks the keys every 10ms.
+  // The watch lives as long as the handler: closing an inotify instance can
+  // take milliseconds.
+  notifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (notifyFd_ != -1 &&
+      inotify_add_watch(notifyFd_, basePath_.c_str(), IN_MOVED_TO) == -1) {
+    close(notifyFd_);
+    notifyFd_ = -1;
+  }
+#endif
 }
 
-FileStoreHandler::~FileStoreHandler() {}
+FileStoreHandler::~FileStoreHandler() {
+#if defined(__linux__)
+  if (notifyFd_ != -1) {
+    close(notifyFd_);
+  }
+#endif
+}
 
 std::string FileStoreHandler::realPath(const std::string& path) {
 #if defined(_MSC_VER)
@@ -160,15 +187,36 @@ bool FileStoreHandler::check(const std::vector<std::string>& names) {
 void FileStoreHandler::wait(
     const std::vector<std::string>& names,
     const std::chrono::milliseconds& timeout) {
-  // Not using inotify because it doesn't work on many
-  // shared filesystems (such as NFS).
   const auto start = std::chrono::steady_clock::now();
-  while (!check(names)) {
-    const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+  // Only check the keys that have not shown up yet.
+  std::vector<std::string> pending(names);
+  while (true) {
+    pending.erase(
+        std::remove_if(
+            pending.begin(),
+            pending.end(),
+            [this](const std::string& name) { return check({name}); }),
+        pending.end());
+    if (pending.empty()) {
+      return;
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - start);
     if (timeout != kNoTimeout && elapsed > timeout) {
-      STORE_HANDLER_TIMEOUT("Wait timeout for name(s): ", Join(" ", names));
+      STORE_HANDLER_TIMEOUT("Wait timeout for name(s): ", Join(" ", pending));
     }
+#if defined(__linux__)
+    if (notifyFd_ != -1) {
+      struct pollfd pfd = {notifyFd_, POLLIN, 0};
+      if (poll(&pfd, 1, 10) > 0) {
+        // Drain the events, the keys are checked again anyway.
+        std::array<char, 4096> buf;
+        while (read(notifyFd_, buf.data(), buf.size()) > 0) {
+        }
+      }
+      continue;
+    }
+#endif
     /* sleep override */
     std::this_thread::sleep_for(std::chrono::milliseconds(10));
   }
@@ -39,6 +39,8 @@ class FileStoreHandler : public StoreHandler {
 
  protected:
   std::string basePath_;
+  // inotify instance watching basePath_, or -1 when not available.
+  int notifyFd_{-1};
 
   std::string realPath(const std::string& path);
 
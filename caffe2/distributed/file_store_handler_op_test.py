@@ -70,3 +70,6 @@ class TestFileStoreHandlerOp(TestCase):
 
     def test_set_get(self):
         StoreOpsTests.test_set_get(self.create_store_handler)
+
+    def test_multi_get(self):
+        StoreOpsTests.test_multi_get(self.create_store_handler)
@@ -18,8 +18,10 @@
 
 #include <caffe2/core/logging.h>
 
+#include <poll.h>
+
+#include <algorithm>
 #include <chrono>
-#include <thread>
 #include <vector>
 
 namespace caffe2 {
@@ -39,6 +41,9 @@ RedisStoreHandler::RedisStoreHandler(
 }
 
 RedisStoreHandler::~RedisStoreHandler() {
+  if (subscriber_ != nullptr) {
+    redisFree(subscriber_);
+  }
   redisFree(redis_);
 }
 
@@ -46,6 +51,47 @@ std::string RedisStoreHandler::compoundKey(const std::string& name) {
   return prefix_ + name;
 }
 
+std::string RedisStoreHandler::channel() {
+  // Channels do not share the key namespace, so this does not clash with
+  // any key under the prefix.
+  return prefix_ + "__set__";
+}
+
+void RedisStoreHandler::subscribe() {
+  struct timeval tv = {
+      .tv_sec = 5, .tv_usec = 0,
+  };
+  subscriber_ = redisConnectWithTimeout(host_.c_str(), port_, tv);
+  CAFFE_ENFORCE_NE(subscriber_, (redisContext*)nullptr);
+  CAFFE_ENFORCE_EQ(subscriber_->err, 0, subscriber_->errstr);
+  auto ch = channel();
+  void* ptr = redisCommand(
+      subscriber_, "SUBSCRIBE %b", ch.c_str(), (size_t)ch.size());
+  CAFFE_ENFORCE_NE(ptr, (void*)nullptr, subscriber_->errstr);
+  freeReplyObject(ptr);
+}
+
+void RedisStoreHandler::awaitNotification(int timeout_ms) {
+  // Replies that hiredis already read off the socket would not wake poll().
+  void* ptr = nullptr;
+  bool notified = false;
+  while (redisGetReplyFromReader(subscriber_, &ptr) == REDIS_OK &&
+         ptr != nullptr) {
+    freeReplyObject(ptr);
+    ptr = nullptr;
+    notified = true;
+  }
+  if (notified) {
+    return;
+  }
+  struct pollfd pfd = {subscriber_->fd, POLLIN, 0};
+  if (poll(&pfd, 1, timeout_ms) > 0) {
+    CAFFE_ENFORCE_EQ(
+        redisGetReply(subscriber_, &ptr), REDIS_OK, subscriber_->errstr);
+    freeReplyObject(ptr);
+  }
+}
+
 void RedisStoreHandler::set(const std::string& name, const std::string& data) {
   auto key = compoundKey(name);
   void* ptr = redisCommand(
@@ -65,6 +111,19 @@ void RedisStoreHandler::set(const std::string& name, const std::string& data) {
       name,
       " was already set",
       " (perhaps you reused a run ID you have used before?)");
+  freeReplyObject(ptr);
+
+  // Wake up the handlers waiting for keys
+  auto ch = channel();
+  ptr = redisCommand(
+      redis_,
+      "PUBLISH %b %b",
+      ch.c_str(),
+      (size_t)ch.size(),
+      name.c_str(),
+      (size_t)name.size());
+  CAFFE_ENFORCE_NE(ptr, (void*)nullptr, redis_->errstr);
+  freeReplyObject(ptr);
 }
 
 std::string RedisStoreHandler::get(const std::string& name) {
@@ -79,6 +138,43 @@ std::string RedisStoreHandler::get(const std::string& name) {
   return std::string(reply->str, reply->len);
 }
 
+std::vector<std::string> RedisStoreHandler::multiGet(
+    const std::vector<std::string>& names,
+    const std::chrono::milliseconds& timeout) {
+  std::vector<std::string> result;
+  if (names.empty()) {
+    return result;
+  }
+  wait(names, timeout);
+
+  // Fetch all keys in a single round trip
+  std::vector<std::string> args;
+  args.push_back("MGET");
+  for (const auto& name : names) {
+    args.push_back(compoundKey(name));
+  }
+  std::vector<const char*> argv;
+  std::vector<size_t> argvlen;
+  for (const auto& arg : args) {
+    argv.push_back(arg.c_str());
+    argvlen.push_back(arg.length());
+  }
+  void* ptr =
+      redisCommandArgv(redis_, argv.size(), argv.data(), argvlen.data());
+  CAFFE_ENFORCE_NE(ptr, (void*)nullptr, redis_->errstr);
+  redisReply* reply = static_cast<redisReply*>(ptr);
+  CAFFE_ENFORCE_EQ(reply->type, REDIS_REPLY_ARRAY);
+  CAFFE_ENFORCE_EQ(reply->elements, names.size());
+  result.reserve(names.size());
+  for (size_t i = 0; i < reply->elements; i++) {
+    const auto* element = reply->element[i];
+    CAFFE_ENFORCE_EQ(element->type, REDIS_REPLY_STRING);
+    result.emplace_back(element->str, element->len);
+  }
+  freeReplyObject(ptr);
+  return result;
+}
+
 int64_t RedisStoreHandler::add(const std::string& name, int64_t value) {
   auto key = compoundKey(name);
   void* ptr = redisCommand(
@@ -114,19 +210,24 @@ bool RedisStoreHandler::check(const std::vector<std::string>& names) {
 void RedisStoreHandler::wait(
     const std::vector<std::string>& names,
     const std::chrono::milliseconds& timeout) {
-  // Simple approach: poll...
-  // Complex approach: use pub/sub.
-  // Polling is fine for the typical rendezvous use case, as it is
-  // only done at initialization time and  not at run time.
+  // Sleep until set() announces a new key, subscribing before the first
+  // check so that no announcement can be missed. Keys set by handlers that
+  // do not announce them are still picked up by checking every 100ms.
+  if (subscriber_ == nullptr) {
+    subscribe();
+  }
   const auto start = std::chrono::steady_clock::now();
   while (!check(names)) {
-    const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - start);
     if (timeout != kNoTimeout && elapsed > timeout) {
       STORE_HANDLER_TIMEOUT("Wait timeout for name(s): ", Join(" ", names));
     }
-    /* sleep override */
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto wait_ms = 100;
+    if (timeout != kNoTimeout) {
+      wait_ms = std::min<int64_t>(wait_ms, (timeout - elapsed).count() + 1);
+    }
+    awaitNotification(wait_ms);
   }
 }
 }
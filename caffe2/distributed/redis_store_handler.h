@@ -35,6 +35,10 @@ class RedisStoreHandler : public StoreHandler {
 
   virtual std::string get(const std::string& name) override;
 
+  virtual std::vector<std::string> multiGet(
+      const std::vector<std::string>& names,
+      const std::chrono::milliseconds& timeout = kDefaultTimeout) override;
+
   virtual int64_t add(const std::string& name, int64_t value) override;
 
   virtual bool check(const std::vector<std::string>& names) override;
@@ -49,8 +53,19 @@ class RedisStoreHandler : public StoreHandler {
   std::string prefix_;
 
   redisContext* redis_;
+  // Connection subscribed to the channel set() announces new keys on, so
+  // that wait() can sleep until a key is set instead of polling. A
+  // subscribed connection cannot send other commands, hence the second one.
+  redisContext* subscriber_{nullptr};
 
   std::string compoundKey(const std::string& name);
+
+  std::string channel();
+
+  void subscribe();
+
+  // Waits for a new key announcement for at most timeout_ms milliseconds.
+  void awaitNotification(int timeout_ms);
 };
 
 } // namespace caffe2
@@ -51,3 +51,9 @@ class TestRedisStoreHandlerOp(TestCase):
 
     def test_set_get(self):
         StoreOpsTests.test_set_get(self.create_store_handler)
+
+    def test_multi_get(self):
+        StoreOpsTests.test_multi_get(self.create_store_handler)
+
+    def test_elastic_rendezvous(self):
+        StoreOpsTests.test_elastic_rendezvous(self.create_store_handler)
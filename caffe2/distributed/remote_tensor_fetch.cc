@@ -0,0 +1,211 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "caffe2/distributed/remote_tensor_fetch.h"
+
+#include <cstring>
+
+#include "caffe2/core/types.h"
+#include "caffe2/utils/string_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// How often the server checks whether it was stopped.
+constexpr int kServerPollMs = 100;
+
+void DeleteTensor(void* /* data */, void* hint) {
+  delete static_cast<TensorCPU*>(hint);
+}
+
+} // namespace
+
+TensorFetchServer::TensorFetchServer(
+    std::shared_ptr<BlobsQueue> queue,
+    const string& address)
+    : queue_(std::move(queue)), address_(address), socket_(ZMQ_ROUTER) {
+  CAFFE_ENFORCE(queue_);
+  socket_.SetOption(ZMQ_RCVTIMEO, kServerPollMs);
+  // Replies to clients that went away are dropped.
+  socket_.SetOption(ZMQ_LINGER, 0);
+  socket_.Bind(address_);
+  // The socket is only used by the thread from now on.
+  thread_ = std::thread([this] { Serve(); });
+}
+
+TensorFetchServer::~TensorFetchServer() {
+  stop_ = true;
+  // Wakes up the thread if it waits for a batch.
+  queue_->close();
+  thread_.join();
+  socket_.Unbind(address_);
+}
+
+void TensorFetchServer::Serve() {
+  std::vector<Blob> blobs(queue_->getNumBlobs());
+  std::vector<Blob*> inputs;
+  for (auto& blob : blobs) {
+    inputs.push_back(&blob);
+  }
+  std::vector<Blob> no_blobs;
+  bool closed = false;
+  while (!stop_) {
+    // A request is the identity of the client, prepended by the ROUTER
+    // socket, and an empty frame.
+    ZmqMessage identity;
+    if (socket_.Recv(&identity) < 0) {
+      continue;
+    }
+    ZmqMessage request;
+    socket_.RecvTillSuccess(&request);
+    try {
+      closed = closed || !queue_->blockingRead(inputs);
+      Reply(&identity, closed ? &no_blobs : &blobs);
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "Tensor fetch server at " << address_
+                 << " failed: " << e.what();
+      // Clients get the end of the data from now on.
+      closed = true;
+      queue_->close();
+      Reply(&identity, &no_blobs);
+    }
+  }
+}
+
+void TensorFetchServer::Reply(ZmqMessage* identity, std::vector<Blob>* blobs) {
+  TensorShapes header;
+  std::vector<std::unique_ptr<ZmqMessage>> data;
+  for (auto& blob : *blobs) {
+    CAFFE_ENFORCE(
+        blob.IsType<TensorCPU>(),
+        "Only CPU tensors can be sent, not ",
+        blob.TypeName());
+    // The message takes over the buffer of the tensor. The blob gets an
+    // empty tensor, which goes back into the queue on the next read.
+    std::unique_ptr<TensorCPU> tensor(new TensorCPU());
+    tensor->swap(*blob.GetMutable<TensorCPU>());
+    const auto data_type = TypeMetaToDataType(tensor->meta());
+    CAFFE_ENFORCE(
+        data_type != TensorProto_DataType_UNDEFINED &&
+            data_type != TensorProto_DataType_STRING,
+        "Tensors of ",
+        tensor->meta().name(),
+        " can't be sent.");
+    auto* shape = header.add_shapes();
+    shape->set_data_type(data_type);
+    for (const auto d : tensor->dims()) {
+      shape->add_dims(d);
+    }
+    if (tensor->nbytes() == 0) {
+      data.emplace_back(new ZmqMessage());
+    } else {
+      const size_t nbytes = tensor->nbytes();
+      void* ptr = tensor->raw_mutable_data(tensor->meta());
+      data.emplace_back(
+          new ZmqMessage(ptr, nbytes, DeleteTensor, tensor.release()));
+    }
+  }
+  ZmqMessage header_msg(header.SerializeAsString());
+  socket_.SendTillSuccess(identity, ZMQ_SNDMORE);
+  socket_.SendTillSuccess(&header_msg, data.empty() ? 0 : ZMQ_SNDMORE);
+  for (int i = 0; i < data.size(); ++i) {
+    socket_.SendTillSuccess(
+        data[i].get(), i + 1 < data.size() ? ZMQ_SNDMORE : 0);
+  }
+}
+
+RemoteTensorFetcher::RemoteTensorFetcher(
+    int worker_id,
+    const ArgumentHelper& args)
+    : socket_(ZMQ_DEALER),
+      timeout_secs_(
+          args.GetSingleArgument<float>("fetch_timeout_secs", 0.0f)) {
+  const auto servers =
+      split(',', args.GetSingleArgument<string>("fetch_servers", ""));
+  CAFFE_ENFORCE(
+      !servers.empty() && !servers[0].empty(), "fetch_servers is required.");
+  const int outstanding =
+      args.GetSingleArgument<int>("fetch_outstanding", 2);
+  CAFFE_ENFORCE_GE(outstanding, 1, "fetch_outstanding must be positive.");
+  if (timeout_secs_ > 0) {
+    socket_.SetOption(ZMQ_RCVTIMEO, static_cast<int>(timeout_secs_ * 1000));
+  }
+  // Requests to a server that went away are dropped.
+  socket_.SetOption(ZMQ_LINGER, 0);
+  socket_.Connect(servers[worker_id % servers.size()]);
+  for (int i = 0; i < outstanding; ++i) {
+    Request();
+  }
+}
+
+void RemoteTensorFetcher::Request() {
+  ZmqMessage request;
+  socket_.SendTillSuccess(&request, 0);
+}
+
+void RemoteTensorFetcher::Receive(ZmqMessage* msg) {
+  if (timeout_secs_ > 0) {
+    CAFFE_ENFORCE_GE(
+        socket_.Recv(msg),
+        0,
+        "No batch from the tensor fetch server in ",
+        timeout_secs_,
+        " seconds.");
+  } else {
+    socket_.RecvTillSuccess(msg);
+  }
+}
+
+bool RemoteTensorFetcher::Fetch(const std::vector<Blob*>& outputs) {
+  if (done_) {
+    return false;
+  }
+  ZmqMessage header_msg;
+  Receive(&header_msg);
+  TensorShapes header;
+  CAFFE_ENFORCE(
+      header.ParseFromArray(header_msg.data(), header_msg.size()),
+      "Invalid reply from the tensor fetch server.");
+  if (header.shapes_size() == 0) {
+    done_ = true;
+    return false;
+  }
+  CAFFE_ENFORCE_EQ(
+      header.shapes_size(),
+      outputs.size(),
+      "The server sends batches of a different number of blobs.");
+  for (int i = 0; i < outputs.size(); ++i) {
+    const auto& shape = header.shapes(i);
+    ZmqMessage data;
+    Receive(&data);
+    auto* tensor = outputs[i]->GetMutable<TensorCPU>();
+    tensor->Resize(
+        std::vector<TIndex>(shape.dims().begin(), shape.dims().end()));
+    void* ptr =
+        tensor->raw_mutable_data(DataTypeToTypeMeta(shape.data_type()));
+    CAFFE_ENFORCE_EQ(data.size(), tensor->nbytes());
+    if (data.size() > 0) {
+      std::memcpy(ptr, data.data(), data.size());
+    }
+  }
+  // Replaces the request that was just served.
+  Request();
+  return true;
+}
+
+REGISTER_DATA_FETCHER(RemoteTensorFetch, RemoteTensorFetcher);
+
+} // namespace caffe2
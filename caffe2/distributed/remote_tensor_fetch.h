@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "caffe2/queue/blobs_queue.h"
+#include "caffe2/queue/data_workers.h"
+#include "caffe2/utils/zmq_helper.h"
+
+namespace caffe2 {
+
+// Serving the batches of a BlobsQueue to data workers on other hosts.
+//
+// A reader host runs a TensorFetchServer over the queue its readers write
+// into. A trainer runs data workers with the "RemoteTensorFetch" fetcher,
+// each of which keeps several fetch requests in flight, so that batches are
+// sent while the previous ones are being used.
+//
+// A reply is a header with the TensorShapes of the batch, followed by the
+// raw data of each tensor. The tensors are sent without being copied; on the
+// receiving side they are copied once out of the zmq buffers, into tensors of
+// the CPU allocator, which allocates pinned memory once the process uses
+// CUDA. A header without shapes means that the queue was closed.
+
+// Replies to fetch requests with the batches read from a queue, on a thread
+// of its own. The server closes the queue when it is destroyed.
+class TensorFetchServer {
+ public:
+  TensorFetchServer(std::shared_ptr<BlobsQueue> queue, const string& address);
+  ~TensorFetchServer();
+
+ private:
+  void Serve();
+  // Sends the batch in blobs, or the end of the data if blobs is empty.
+  void Reply(ZmqMessage* identity, std::vector<Blob>* blobs);
+
+  std::shared_ptr<BlobsQueue> queue_;
+  const string address_;
+  ZmqSocket socket_;
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+
+// Fetches batches from TensorFetchServers. Worker i connects to the i-th of
+// the comma-separated "fetch_servers", modulo their number.
+//
+// Arguments, those of CreateDataWorkers:
+//   fetch_servers: the addresses of the servers.
+//   fetch_outstanding (default 2): requests kept in flight.
+//   fetch_timeout_secs (default 0): time after which a fetch fails, 0 to
+//     wait forever.
+class RemoteTensorFetcher final : public DataFetcherBase {
+ public:
+  RemoteTensorFetcher(int worker_id, const ArgumentHelper& args);
+
+  bool Fetch(const std::vector<Blob*>& outputs) override;
+
+ private:
+  void Request();
+  void Receive(ZmqMessage* msg);
+
+  ZmqSocket socket_;
+  const float timeout_secs_;
+  bool done_{false};
+};
+
+} // namespace caffe2
@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "caffe2/distributed/remote_tensor_fetch.h"
+
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+using TensorFetchServerPtr = std::unique_ptr<TensorFetchServer>;
+CAFFE_KNOWN_TYPE(TensorFetchServerPtr);
+
+namespace {
+
+class CreateTensorFetchServerOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  CreateTensorFetchServerOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        address_(GetSingleArgument<std::string>("address", "")) {
+    CAFFE_ENFORCE(!address_.empty(), "address is required.");
+  }
+
+  bool RunOnDevice() override {
+    const auto& queue =
+        OperatorBase::Input<std::shared_ptr<BlobsQueue>>(0);
+    auto* server = OperatorBase::Output<TensorFetchServerPtr>(0);
+    // Unbinds the address of a previous server first.
+    server->reset();
+    server->reset(new TensorFetchServer(queue, address_));
+    return true;
+  }
+
+ private:
+  std::string address_;
+};
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(CreateTensorFetchServer, CreateTensorFetchServerOp);
+
+OPERATOR_SCHEMA(CreateTensorFetchServer)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Serves the batches of a BlobsQueue to data workers on other hosts, which are
+created by CreateDataWorkers with fetcher "RemoteTensorFetch" and the address
+of the server in fetch_servers. Each request of a worker is answered with the
+next batch of the queue, whose tensors are sent without being copied; once
+the queue is closed, the workers get the end of the data. The server runs on
+a thread of its own until the output blob is destroyed, which closes the
+queue.
+)DOC")
+    .Arg(
+        "address",
+        "(string) zmq address the server binds to, e.g. tcp://*:5556.")
+    .Input(0, "queue", "The queue of CPU tensors to serve.")
+    .Output(0, "server", "The server.");
+
+SHOULD_NOT_DO_GRADIENT(CreateTensorFetchServer);
+
+} // namespace caffe2
@@ -30,6 +30,18 @@ StoreHandler::~StoreHandler() {
   // symbols for this abstract class.
 }
 
+std::vector<std::string> StoreHandler::multiGet(
+    const std::vector<std::string>& names,
+    const std::chrono::milliseconds& timeout) {
+  wait(names, timeout);
+  std::vector<std::string> result;
+  result.reserve(names.size());
+  for (const auto& name : names) {
+    result.push_back(get(name));
+  }
+  return result;
+}
+
 CAFFE_KNOWN_TYPE(std::unique_ptr<StoreHandler>);
 
 } // namespace caffe2
@@ -46,6 +46,17 @@ class StoreHandler {
    */
   virtual std::string get(const std::string& name) = 0;
 
+  /*
+   * Get the data for several keys at once.
+   * The call waits until all keys are stored and returns their data in the
+   * order of the names. Stores that can fetch many keys in one request
+   * should override it; by default it waits for all keys and gets them one
+   * by one.
+   */
+  virtual std::vector<std::string> multiGet(
+      const std::vector<std::string>& names,
+      const std::chrono::milliseconds& timeout = kDefaultTimeout);
+
   /*
    * Does an atomic add operation on the key and returns the latest updated
    * value.
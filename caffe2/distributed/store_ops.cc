@@ -16,11 +16,72 @@
 
 #include "store_ops.h"
 
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <thread>
+
 namespace caffe2 {
 
 constexpr auto kBlobName = "blob_name";
 constexpr auto kAddValue = "add_value";
 
+namespace {
+
+constexpr auto kPollInterval = std::chrono::milliseconds(10);
+
+// View of a store handler in which every key is prefixed, so that the common
+// worlds of different generations of an elastic job do not share keys. The
+// wrapped handler must outlive it.
+class PrefixStoreHandler : public StoreHandler {
+ public:
+  PrefixStoreHandler(const std::string& prefix, StoreHandler& handler)
+      : prefix_(prefix), handler_(handler) {}
+
+  void set(const std::string& name, const std::string& data) override {
+    handler_.set(prefix_ + name, data);
+  }
+
+  std::string get(const std::string& name) override {
+    return handler_.get(prefix_ + name);
+  }
+
+  std::vector<std::string> multiGet(
+      const std::vector<std::string>& names,
+      const std::chrono::milliseconds& timeout) override {
+    return handler_.multiGet(prefixed(names), timeout);
+  }
+
+  int64_t add(const std::string& name, int64_t value) override {
+    return handler_.add(prefix_ + name, value);
+  }
+
+  bool check(const std::vector<std::string>& names) override {
+    return handler_.check(prefixed(names));
+  }
+
+  void wait(
+      const std::vector<std::string>& names,
+      const std::chrono::milliseconds& timeout) override {
+    handler_.wait(prefixed(names), timeout);
+  }
+
+ private:
+  std::vector<std::string> prefixed(const std::vector<std::string>& names) {
+    std::vector<std::string> result;
+    result.reserve(names.size());
+    for (const auto& name : names) {
+      result.push_back(prefix_ + name);
+    }
+    return result;
+  }
+
+  const std::string prefix_;
+  StoreHandler& handler_;
+};
+
+} // namespace
+
 StoreSetOp::StoreSetOp(const OperatorDef& operator_def, Workspace* ws)
     : Operator<CPUContext>(operator_def, ws),
       blobName_(
@@ -49,30 +110,51 @@ is the data in that blob. The key can be overridden by specifying the
     .Input(1, "data", "data blob");
 
 StoreGetOp::StoreGetOp(const OperatorDef& operator_def, Workspace* ws)
-    : Operator<CPUContext>(operator_def, ws),
+    : AsyncCPUOperator(operator_def, ws),
       blobName_(GetSingleArgument<std::string>(
           kBlobName,
-          operator_def.output(DATA))) {}
+          operator_def.output(DATA))) {
+  CAFFE_ENFORCE(
+      OutputSize() == 1 || !HasArgument(kBlobName),
+      "blob_name can only be given for a single output");
+  for (const auto& output : operator_def.output()) {
+    blobNames_.push_back(output);
+  }
+}
 
-bool StoreGetOp::RunOnDevice() {
+bool StoreGetOp::RunOnDeviceAsync() {
   // Get from store and deserialize
   auto* handler =
       OperatorBase::Input<std::unique_ptr<StoreHandler>>(HANDLER).get();
-  OperatorBase::Outputs()[DATA]->Deserialize(handler->get(blobName_));
+  RunInBackground([this, handler]() {
+    if (OutputSize() == 1) {
+      OperatorBase::Outputs()[DATA]->Deserialize(handler->get(blobName_));
+      return true;
+    }
+    // Let the store fetch all keys together
+    const auto values = handler->multiGet(blobNames_);
+    for (int i = 0; i < OutputSize(); ++i) {
+      OperatorBase::Outputs()[i]->Deserialize(values[i]);
+    }
+    return true;
+  });
   return true;
 }
 
 REGISTER_CPU_OPERATOR(StoreGet, StoreGetOp);
 OPERATOR_SCHEMA(StoreGet)
     .NumInputs(1)
-    .NumOutputs(1)
+    .NumOutputs(1, INT_MAX)
     .SetDoc(R"DOC(
-Get a blob from a store. The key is the output blob's name. The key
-can be overridden by specifying the 'blob_name' argument.
+Get blobs from a store. The keys are the output blobs' names. With a single
+output, the key can be overridden by specifying the 'blob_name' argument.
+Several outputs are fetched together, in a single request for stores that
+support it. The request runs in the background, so that a DAG net runs other
+operators while it waits.
 )DOC")
     .Arg("blob_name", "alternative key for the blob (optional)")
     .Input(0, "handler", "unique_ptr<StoreHandler>")
-    .Output(0, "data", "data blob");
+    .Output(0, "data", "data blob(s)");
 
 StoreAddOp::StoreAddOp(const OperatorDef& operator_def, Workspace* ws)
     : Operator<CPUContext>(operator_def, ws),
@@ -105,24 +187,25 @@ returns the resulting counter value.
     .Output(0, "value", "the current value of the counter");
 
 StoreWaitOp::StoreWaitOp(const OperatorDef& operator_def, Workspace* ws)
-    : Operator<CPUContext>(operator_def, ws),
+    : AsyncCPUOperator(operator_def, ws),
       blobNames_(GetRepeatedArgument<std::string>(kBlobName)) {}
 
-bool StoreWaitOp::RunOnDevice() {
+bool StoreWaitOp::RunOnDeviceAsync() {
   auto* handler =
       OperatorBase::Input<std::unique_ptr<StoreHandler>>(HANDLER).get();
+  std::vector<std::string> blobNames = blobNames_;
   if (InputSize() == 2 && Input(1).IsType<std::string>()) {
     CAFFE_ENFORCE(
         blobNames_.empty(), "cannot specify both argument and input blob");
-    std::vector<std::string> blobNames;
     auto* namesPtr = Input(1).data<std::string>();
     for (int i = 0; i < Input(1).size(); ++i) {
       blobNames.push_back(namesPtr[i]);
     }
-    handler->wait(blobNames);
-  } else {
-    handler->wait(blobNames_);
   }
+  RunInBackground([handler, blobNames]() {
+    handler->wait(blobNames);
+    return true;
+  });
   return true;
 }
 
@@ -137,4 +220,193 @@ either as an input blob with blob names or as an argument.
     .Arg("blob_names", "names of the blobs to wait for (optional)")
     .Input(0, "handler", "unique_ptr<StoreHandler>")
     .Input(1, "names", "names of the blobs to wait for (optional)");
+
+ElasticRendezvousOp::ElasticRendezvousOp(
+    const OperatorDef& operator_def,
+    Workspace* ws)
+    : Operator<CPUContext>(operator_def, ws),
+      prefix_(GetSingleArgument<std::string>("prefix", "elastic")),
+      minSize_(GetSingleArgument<int>("min_size", 1)),
+      maxSize_(GetSingleArgument<int>("max_size", 0)),
+      settle_(GetSingleArgument<int>("settle_ms", 1000)),
+      timeout_(GetSingleArgument<int>(
+          "timeout_ms",
+          StoreHandler::kDefaultTimeout.count())) {
+  CAFFE_ENFORCE_GE(minSize_, 1, "min_size must be positive");
+  if (maxSize_ == 0) {
+    maxSize_ = std::numeric_limits<int>::max();
+  }
+  CAFFE_ENFORCE_GE(maxSize_, minSize_, "max_size must be at least min_size");
+}
+
+std::string ElasticRendezvousOp::key(
+    int64_t generation,
+    const std::string& name) const {
+  return MakeString(prefix_, "/", generation, "/", name);
+}
+
+// Makes sure the current generation is at least the given one. The counter
+// only moves past a generation once, however many workers ask for it.
+void ElasticRendezvousOp::requestGeneration(
+    StoreHandler* handler,
+    int64_t generation) const {
+  const auto generationKey = prefix_ + "/generation";
+  if (handler->add(key(generation - 1, "next"), 1) == 1) {
+    handler->add(generationKey, 1);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  while (handler->add(generationKey, 0) < generation) {
+    if (std::chrono::steady_clock::now() - start > timeout_) {
+      STORE_HANDLER_TIMEOUT("Wait timeout for generation ", generation);
+    }
+    std::this_thread::sleep_for(kPollInterval);
+  }
+}
+
+// Returns false if the generation was formed without this worker.
+bool ElasticRendezvousOp::join(
+    StoreHandler* handler,
+    int64_t generation,
+    int64_t lastGeneration,
+    int* size,
+    int* rank) const {
+  const auto joinedKey = key(generation, "joined");
+  const auto sizeKey = key(generation, "size");
+  const int64_t index = handler->add(joinedKey, 1) - 1;
+  if (index == 0) {
+    // The first worker to join closes the generation once it is full, or
+    // once enough workers joined and no more showed up for a while.
+    const auto start = std::chrono::steady_clock::now();
+    while (true) {
+      const auto joined = handler->add(joinedKey, 0);
+      const auto elapsed = std::chrono::steady_clock::now() - start;
+      if (joined >= maxSize_ || (joined >= minSize_ && elapsed >= settle_)) {
+        handler->set(
+            sizeKey, caffe2::to_string(std::min<int64_t>(joined, maxSize_)));
+        break;
+      }
+      if (elapsed > timeout_) {
+        STORE_HANDLER_TIMEOUT(
+            "Only ",
+            joined,
+            " of at least ",
+            minSize_,
+            " workers joined generation ",
+            generation);
+      }
+      std::this_thread::sleep_for(kPollInterval);
+    }
+  }
+  handler->wait({sizeKey}, settle_ + timeout_);
+  *size = std::stoi(handler->get(sizeKey));
+  if (index >= *size) {
+    return false;
+  }
+
+  // Give rank 0 to a worker with the most recent training state, so that
+  // broadcasting from rank 0 resumes from it, and keep the join order
+  // otherwise.
+  handler->set(
+      key(generation, MakeString("member/", index)),
+      caffe2::to_string(lastGeneration));
+  std::vector<std::string> memberKeys;
+  for (int i = 0; i < *size; ++i) {
+    memberKeys.push_back(key(generation, MakeString("member/", i)));
+  }
+  const auto members = handler->multiGet(memberKeys, timeout_);
+  std::vector<int64_t> memberGenerations;
+  for (const auto& member : members) {
+    memberGenerations.push_back(std::stoll(member));
+  }
+  std::vector<int> order(*size);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return memberGenerations[a] > memberGenerations[b];
+  });
+  *rank = std::find(order.begin(), order.end(), index) - order.begin();
+  return true;
+}
+
+bool ElasticRendezvousOp::RunOnDevice() {
+  auto* handler =
+      OperatorBase::Input<std::unique_ptr<StoreHandler>>(HANDLER).get();
+  int64_t lastGeneration = -1;
+  if (InputSize() > LAST_GENERATION) {
+    CAFFE_ENFORCE_EQ(Input(LAST_GENERATION).size(), 1);
+    lastGeneration = Input(LAST_GENERATION).data<int64_t>()[0];
+  }
+
+  // Workers of the last generation need a new one; workers that are new to
+  // the job join the current one, unless it was already formed.
+  int64_t generation = handler->add(prefix_ + "/generation", 0);
+  if (generation <= lastGeneration) {
+    requestGeneration(handler, lastGeneration + 1);
+    generation = handler->add(prefix_ + "/generation", 0);
+  }
+  int size = 0;
+  int rank = 0;
+  while (!join(handler, generation, lastGeneration, &size, &rank)) {
+    requestGeneration(handler, generation + 1);
+    generation = handler->add(prefix_ + "/generation", 0);
+  }
+  LOG(INFO) << "Joined generation " << generation << " of " << prefix_
+            << " as rank " << rank << " of " << size;
+
+  Output(GENERATION)->Resize(1);
+  Output(GENERATION)->mutable_data<int64_t>()[0] = generation;
+  Output(SIZE)->Resize(1);
+  Output(SIZE)->mutable_data<int>()[0] = size;
+  Output(RANK)->Resize(1);
+  Output(RANK)->mutable_data<int>()[0] = rank;
+  if (OutputSize() > GENERATION_HANDLER) {
+    *OperatorBase::Output<std::unique_ptr<StoreHandler>>(GENERATION_HANDLER) =
+        caffe2::make_unique<PrefixStoreHandler>(
+            MakeString(prefix_, "/", generation, "/world/"), *handler);
+  }
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(ElasticRendezvous, ElasticRendezvousOp);
+OPERATOR_SCHEMA(ElasticRendezvous)
+    .NumInputs(1, 2)
+    .NumOutputs(3, 4)
+    .SetDoc(R"DOC(
+Forms a generation of the workers of an elastic job through a store, so
+that the job can go on with a different number of workers when some of
+them fail or new ones show up.
+
+Generations are numbered from 0 by a counter in the store. A worker that
+took part in the last generation passes its number and joins the next one;
+a new worker joins the current generation, or the next one if the current
+one was already formed. The first worker to join a generation closes it as
+soon as max_size workers joined, or after waiting settle_ms for more once
+min_size workers joined. Workers that join a closed generation ask for the
+next one, which the members of the running generation can watch for by
+reading the counter, a StoreAdd of 0 on '<prefix>/generation', and form
+with them.
+
+Rank 0 goes to a worker with the most recent last generation, that is with
+the most recent training state, so that parameters can be broadcast from
+rank 0 to the workers that joined. The store must support add, which the
+file store does not.
+)DOC")
+    .Arg("prefix", "prefix of the keys of the job (optional, default: elastic)")
+    .Arg("min_size", "number of workers to wait for (optional, default: 1)")
+    .Arg("max_size", "maximum number of workers (optional, default: no limit)")
+    .Arg("settle_ms", "time to wait for more workers (optional, default: 1s)")
+    .Arg("timeout_ms", "timeout to wait for workers (optional, default: 30s)")
+    .Input(0, "handler", "unique_ptr<StoreHandler>")
+    .Input(
+        1,
+        "last_generation",
+        "generation this worker last took part in, -1 if none (optional)")
+    .Output(0, "generation", "generation that was formed")
+    .Output(1, "size", "number of workers of the generation")
+    .Output(2, "rank", "rank of this worker in the generation")
+    .Output(
+        3,
+        "generation_handler",
+        "unique_ptr<StoreHandler> with the keys of the generation, to create "
+        "its common worlds with; the input handler must outlive it "
+        "(optional)");
 }
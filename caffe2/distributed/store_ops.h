@@ -20,6 +20,8 @@
 
 #include <caffe2/core/operator.h>
 
+#include <chrono>
+
 namespace caffe2 {
 
 class StoreSetOp final : public Operator<CPUContext> {
@@ -33,13 +35,16 @@ class StoreSetOp final : public Operator<CPUContext> {
   INPUT_TAGS(HANDLER, DATA);
 };
 
-class StoreGetOp final : public Operator<CPUContext> {
+// StoreGet and StoreWait block on the store, so they run asynchronously and
+// do not hold up a thread of the executor while they wait.
+class StoreGetOp final : public AsyncCPUOperator {
  public:
   StoreGetOp(const OperatorDef& operator_def, Workspace* ws);
-  bool RunOnDevice() override;
+  bool RunOnDeviceAsync() override;
 
  private:
   std::string blobName_;
+  std::vector<std::string> blobNames_;
 
   INPUT_TAGS(HANDLER);
   OUTPUT_TAGS(DATA);
@@ -58,14 +63,39 @@ class StoreAddOp final : public Operator<CPUContext> {
   OUTPUT_TAGS(VALUE);
 };
 
-class StoreWaitOp final : public Operator<CPUContext> {
+class StoreWaitOp final : public AsyncCPUOperator {
  public:
   StoreWaitOp(const OperatorDef& operator_def, Workspace* ws);
-  bool RunOnDevice() override;
+  bool RunOnDeviceAsync() override;
 
  private:
   std::vector<std::string> blobNames_;
 
   INPUT_TAGS(HANDLER);
 };
+
+class ElasticRendezvousOp final : public Operator<CPUContext> {
+ public:
+  ElasticRendezvousOp(const OperatorDef& operator_def, Workspace* ws);
+  bool RunOnDevice() override;
+
+ private:
+  std::string key(int64_t generation, const std::string& name) const;
+  void requestGeneration(StoreHandler* handler, int64_t generation) const;
+  bool join(
+      StoreHandler* handler,
+      int64_t generation,
+      int64_t lastGeneration,
+      int* size,
+      int* rank) const;
+
+  std::string prefix_;
+  int minSize_;
+  int maxSize_;
+  std::chrono::milliseconds settle_;
+  std::chrono::milliseconds timeout_;
+
+  INPUT_TAGS(HANDLER, LAST_GENERATION);
+  OUTPUT_TAGS(GENERATION, SIZE, RANK, GENERATION_HANDLER);
+};
 }
@@ -82,3 +82,102 @@ class StoreOpsTests(object):
         # Raise first error we find, if any
         if not queue.empty():
             raise queue.get()
+
+    @classmethod
+    def _test_multi_get(cls, queue, create_store_handler_fn, index, num_procs):
+        store_handler = create_store_handler_fn()
+
+        # Every process sets its own blob and then gets everybody's at once.
+        blob = "blob_{}".format(index)
+        workspace.FeedBlob(blob, np.full(1, index, np.float32))
+        workspace.RunOperatorOnce(
+            core.CreateOperator(
+                "StoreSet",
+                [store_handler, blob],
+                []))
+
+        outputs = ["blob_{}".format(i) for i in range(num_procs)]
+        workspace.RunOperatorOnce(
+            core.CreateOperator(
+                "StoreGet",
+                [store_handler],
+                outputs))
+
+        try:
+            for i, output in enumerate(outputs):
+                np.testing.assert_array_equal(workspace.FetchBlob(output), i)
+        except AssertionError as err:
+            queue.put(err)
+
+        workspace.ResetWorkspace()
+
+    @classmethod
+    def test_multi_get(cls, create_store_handler_fn):
+        queue = Queue()
+
+        num_procs = 4
+        procs = []
+        for index in range(num_procs):
+            proc = Process(
+                target=cls._test_multi_get,
+                args=(queue, create_store_handler_fn, index, num_procs, ))
+            proc.start()
+            procs.append(proc)
+
+        for proc in procs:
+            proc.join()
+
+        if not queue.empty():
+            raise queue.get()
+
+    @classmethod
+    def _test_elastic_rendezvous(
+            cls, queue, create_store_handler_fn, last_generation, num_procs):
+        store_handler = create_store_handler_fn()
+        workspace.FeedBlob(
+            "last_generation", np.full(1, last_generation, np.int64))
+        workspace.RunOperatorOnce(
+            core.CreateOperator(
+                "ElasticRendezvous",
+                [store_handler, "last_generation"],
+                ["generation", "size", "rank"],
+                min_size=num_procs,
+                max_size=num_procs))
+        queue.put((
+            last_generation,
+            workspace.FetchBlob("generation")[0],
+            workspace.FetchBlob("size")[0],
+            workspace.FetchBlob("rank")[0]))
+        workspace.ResetWorkspace()
+
+    @classmethod
+    def test_elastic_rendezvous(cls, create_store_handler_fn):
+        num_procs = 4
+        # New workers form generation 0; then all but one of them and a new
+        # worker form generation 1, in which rank 0 has training state.
+        for generation, last_generations in [
+            (0, [-1] * num_procs),
+            (1, [0] * (num_procs - 1) + [-1]),
+        ]:
+            queue = Queue()
+            procs = []
+            for last_generation in last_generations:
+                proc = Process(
+                    target=cls._test_elastic_rendezvous,
+                    args=(queue, create_store_handler_fn, last_generation,
+                          num_procs, ))
+                proc.start()
+                procs.append(proc)
+            for proc in procs:
+                proc.join()
+
+            results = [queue.get() for _ in procs]
+            ranks = set()
+            for last_generation, result_generation, size, rank in results:
+                np.testing.assert_equal(result_generation, generation)
+                np.testing.assert_equal(size, num_procs)
+                if rank == 0:
+                    np.testing.assert_equal(
+                        last_generation, max(last_generations))
+                ranks.add(rank)
+            np.testing.assert_equal(sorted(ranks), list(range(num_procs)))
@@ -102,8 +102,14 @@ The dimension of the output image will always be cropxcrop
     .Arg("use_caffe_datum", "1 if the input is in Caffe format. Defaults to 0")
     .Arg("use_gpu_transform", "1 if GPU acceleration should be used."
          " Defaults to 0. Can only be 1 in a CUDAContext")
+    .Arg("use_gpu_resize", "With use_gpu_transform, 1 to also resize and crop "
+         "the decoded images on the GPU using bilinear sampling. Only used "
+         "with no scale jittering. Defaults to 0")
     .Arg("decode_threads", "Number of CPU decode/transform threads."
          " Defaults to 4")
+    .Arg("reduced_decode", "1 to decode JPEG images at 1/2, 1/4 or 1/8 of "
+         "their size when their shorter side stays at least scale. Only used "
+         "with scale and no scale jittering, needs OpenCV 3.2. Defaults to 0")
     .Arg("output_type", "If gpu_transform, can set to FLOAT or FLOAT16.")
     .Arg("db", "Name of the database (if not passed as input)")
     .Arg("db_type", "Type of database (if not passed as input)."
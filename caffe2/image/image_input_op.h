@@ -31,6 +31,13 @@
 #include "caffe2/operators/prefetch_op.h"
 #include "caffe2/image/transform_gpu.h"
 
+// OpenCV can have libjpeg decode at 1/2, 1/4 or 1/8 of the full size through
+// DCT scaling since 3.2.
+#if !defined(CV_VERSION_EPOCH) && \
+    (CV_VERSION_MAJOR > 3 || (CV_VERSION_MAJOR == 3 && CV_VERSION_MINOR >= 2))
+#define CAFFE2_IMAGE_REDUCED_DECODE
+#endif
+
 namespace caffe2 {
 
 class CUDAContext;
@@ -61,7 +68,6 @@ class ImageInputOp final
  public:
   using OperatorBase::OutputSize;
   using PrefetchOperator<Context>::context_;
-  using PrefetchOperator<Context>::prefetch_thread_;
   explicit ImageInputOp(const OperatorDef& operator_def,
                                     Workspace* ws);
   ~ImageInputOp() {
@@ -85,17 +91,24 @@ class ImageInputOp final
   // to be privatized per launch.
   using PerImageArg = struct {
     BoundingBox bounding_params;
+    // Size the image is resized to when the resize is left to the GPU
+    int scaled_height;
+    int scaled_width;
   };
 
   bool GetImageAndLabelAndInfoFromDBValue(
       const string& value, cv::Mat* img, PerImageArg& info, int item_id,
       std::mt19937* randgen);
+  cv::Mat DecodeImage(const char* data, int size, const PerImageArg& info);
   void DecodeAndTransform(
       const std::string& value, float *image_data, int item_id,
       const int channels, std::size_t thread_index);
   void DecodeAndTransposeOnly(
       const std::string& value, uint8_t *image_data, int item_id,
       const int channels, std::size_t thread_index);
+  void DecodeOnly(
+      const std::string& value, int item_id, std::size_t thread_index);
+  void PackDecodedImages(const int channels);
 
   unique_ptr<db::DBReader> owned_reader_;
   const db::DBReader* reader_;
@@ -105,6 +118,11 @@ class ImageInputOp final
   vector<TensorCPU> prefetched_additional_outputs_;
   Tensor<Context> prefetched_image_on_device_;
   Tensor<Context> prefetched_label_on_device_;
+  // Decoded images and their crop parameters for the GPU resize path
+  std::vector<cv::Mat> decoded_images_;
+  std::vector<ResizeCropParams> resize_params_;
+  TensorCPU prefetched_resize_params_;
+  Tensor<Context> prefetched_resize_params_on_device_;
   vector<Tensor<Context>> prefetched_additional_outputs_on_device_;
   // Default parameters for images
   PerImageArg default_arg_;
@@ -138,6 +156,10 @@ class ImageInputOp final
   bool use_caffe_datum_;
   bool gpu_transform_;
   bool mean_std_copied_ = false;
+  // Leave the resize and crop to the GPU transform
+  bool gpu_resize_;
+  // Decode JPEGs at a reduced size when they are scaled down to scale_ anyway
+  bool reduced_decode_;
 
   // thread pool for parse + decode
   int num_decode_threads_;
@@ -204,6 +226,10 @@ ImageInputOp<Context>::ImageInputOp(
       gpu_transform_(OperatorBase::template GetSingleArgument<int>(
           "use_gpu_transform",
           0)),
+      gpu_resize_(
+          OperatorBase::template GetSingleArgument<int>("use_gpu_resize", 0)),
+      reduced_decode_(
+          OperatorBase::template GetSingleArgument<int>("reduced_decode", 0)),
       num_decode_threads_(
           OperatorBase::template GetSingleArgument<int>("decode_threads", 4)),
       thread_pool_(std::make_shared<TaskThreadPool>(num_decode_threads_)),
@@ -239,6 +265,8 @@ ImageInputOp<Context>::ImageInputOp(
     OperatorBase::template GetSingleArgument<int>("bounding_height", -1),
     OperatorBase::template GetSingleArgument<int>("bounding_width", -1),
   };
+  default_arg_.scaled_height = -1;
+  default_arg_.scaled_width = -1;
 
   if (operator_def.input_size() == 0) {
     LOG(ERROR) << "You are using an old ImageInputOp format that creates "
@@ -313,6 +341,31 @@ ImageInputOp<Context>::ImageInputOp(
     default_arg_.bounding_params.valid = true;
   }
 
+  if (reduced_decode_ &&
+      (scale_ <= 0 || scale_jitter_type_ != NO_SCALE_JITTER)) {
+    // With minsize or scale jittering the crop can be taken from the image at
+    // its original size, which a reduced decode would change.
+    LOG(WARNING) << "reduced_decode is only used with scale and no scale "
+                    "jittering, ignoring it.";
+    reduced_decode_ = false;
+  }
+  if (gpu_resize_) {
+    CAFFE_ENFORCE(
+        gpu_transform_, "use_gpu_resize requires use_gpu_transform.");
+    CAFFE_ENFORCE_EQ(
+        scale_jitter_type_,
+        NO_SCALE_JITTER,
+        "use_gpu_resize does not support scale jittering.");
+    decoded_images_.resize(batch_size_);
+    resize_params_.resize(batch_size_);
+  }
+#ifndef CAFFE2_IMAGE_REDUCED_DECODE
+  if (reduced_decode_) {
+    LOG(WARNING) << "reduced_decode needs OpenCV 3.2 or newer, ignoring it.";
+    reduced_decode_ = false;
+  }
+#endif
+
   if (mean_.size() == 1) {
     // We are going to extend to 3 using the first value
     mean_.resize(3, mean_[0]);
@@ -323,6 +376,9 @@ ImageInputOp<Context>::ImageInputOp(
   LOG(INFO) << "    Using " << num_decode_threads_ << " CPU threads;";
   if (gpu_transform_) {
     LOG(INFO) << "    Performing transformation on GPU";
+    if (gpu_resize_) {
+      LOG(INFO) << "    Performing resizing and cropping on GPU";
+    }
   }
   LOG(INFO) << "    Outputting in batches of " << batch_size_ << " images;";
   LOG(INFO) << "    Treating input image as "
@@ -341,6 +397,9 @@ ImageInputOp<Context>::ImageInputOp(
   if (scale_ > 0 && !random_scaling_) {
     LOG(INFO) << "    Scaling image to " << scale_
               << (warp_ ? " with " : " without ") << "warping;";
+    if (reduced_decode_) {
+      LOG(INFO) << "    Decoding JPEG images at a reduced size when possible;";
+    }
   } else {
     if (random_scaling_) {
       // randomly set min_size_ for each image
@@ -436,6 +495,79 @@ bool RandomSizedCropping(
   return inception_scale_jitter;
 }
 
+// Reads the size of a JPEG image from its frame header without decoding it.
+// Returns false if the data is not a JPEG image.
+inline bool GetJpegSize(const char* data, int size, int* height, int* width) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+  if (size < 4 || bytes[0] != 0xFF || bytes[1] != 0xD8) {
+    return false;
+  }
+  int pos = 2;
+  while (pos + 4 <= size) {
+    if (bytes[pos] != 0xFF) {
+      return false;
+    }
+    const uint8_t marker = bytes[pos + 1];
+    if (marker == 0xFF) {
+      // Fill byte.
+      ++pos;
+      continue;
+    }
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD9)) {
+      // Markers without a segment.
+      pos += 2;
+      continue;
+    }
+    const int length = (bytes[pos + 2] << 8) | bytes[pos + 3];
+    // Start of frame markers, other than DHT, JPG and DAC which share the
+    // range.
+    if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 &&
+        marker != 0xC8 && marker != 0xCC) {
+      if (pos + 9 > size) {
+        return false;
+      }
+      *height = (bytes[pos + 5] << 8) | bytes[pos + 6];
+      *width = (bytes[pos + 7] << 8) | bytes[pos + 8];
+      return *height > 0 && *width > 0;
+    }
+    pos += 2 + length;
+  }
+  return false;
+}
+
+template <class Context>
+cv::Mat ImageInputOp<Context>::DecodeImage(
+    const char* data,
+    int size,
+    const PerImageArg& info) {
+  int flags = color_ ? CV_LOAD_IMAGE_COLOR : CV_LOAD_IMAGE_GRAYSCALE;
+#ifdef CAFFE2_IMAGE_REDUCED_DECODE
+  // The image is going to be resized so that its shorter side is scale_, so
+  // it can be decoded at the smallest scale that keeps that side at least as
+  // long. Bounding boxes are in full size coordinates, so images with one are
+  // always decoded at full size.
+  int height = 0;
+  int width = 0;
+  if (reduced_decode_ && !info.bounding_params.valid &&
+      GetJpegSize(data, size, &height, &width)) {
+    const int shorter_side = std::min(height, width);
+    if (shorter_side >= 8 * scale_) {
+      flags = color_ ? cv::IMREAD_REDUCED_COLOR_8
+                     : cv::IMREAD_REDUCED_GRAYSCALE_8;
+    } else if (shorter_side >= 4 * scale_) {
+      flags = color_ ? cv::IMREAD_REDUCED_COLOR_4
+                     : cv::IMREAD_REDUCED_GRAYSCALE_4;
+    } else if (shorter_side >= 2 * scale_) {
+      flags = color_ ? cv::IMREAD_REDUCED_COLOR_2
+                     : cv::IMREAD_REDUCED_GRAYSCALE_2;
+    }
+  }
+#endif
+  // We use a cv::Mat to wrap the encoded data so we do not need a copy.
+  return cv::imdecode(
+      cv::Mat(1, size, CV_8UC1, const_cast<char*>(data)), flags);
+}
+
 template <class Context>
 bool ImageInputOp<Context>::GetImageAndLabelAndInfoFromDBValue(
     const string& value,
@@ -460,13 +592,7 @@ bool ImageInputOp<Context>::GetImageAndLabelAndInfoFromDBValue(
     prefetched_label_.mutable_data<int>()[item_id] = datum.label();
     if (datum.encoded()) {
       // encoded image in datum.
-      src = cv::imdecode(
-          cv::Mat(
-              1,
-              datum.data().size(),
-              CV_8UC1,
-              const_cast<char*>(datum.data().data())),
-          color_ ? CV_LOAD_IMAGE_COLOR : CV_LOAD_IMAGE_GRAYSCALE);
+      src = DecodeImage(datum.data().data(), datum.data().size(), info);
     } else {
       // Raw image in datum.
       CAFFE_ENFORCE(datum.channels() == 3 || datum.channels() == 1);
@@ -522,15 +648,8 @@ bool ImageInputOp<Context>::GetImageAndLabelAndInfoFromDBValue(
       // encoded image string.
       DCHECK_EQ(image_proto.string_data_size(), 1);
       const string& encoded_image_str = image_proto.string_data(0);
-      int encoded_size = encoded_image_str.size();
-      // We use a cv::Mat to wrap the encoded str so we do not need a copy.
-      src = cv::imdecode(
-          cv::Mat(
-              1,
-              &encoded_size,
-              CV_8UC1,
-              const_cast<char*>(encoded_image_str.data())),
-          color_ ? CV_LOAD_IMAGE_COLOR : CV_LOAD_IMAGE_GRAYSCALE);
+      src = DecodeImage(
+          encoded_image_str.data(), encoded_image_str.size(), info);
     } else if (image_proto.data_type() == TensorProto::BYTE) {
       // raw image content.
       int src_c = (image_proto.dims_size() == 3) ? image_proto.dims(2) : 1;
@@ -721,6 +840,8 @@ bool ImageInputOp<Context>::GetImageAndLabelAndInfoFromDBValue(
         scaled_width =
             static_cast<float>(img->cols) * scale_to_use / img->rows;
       }
+      info.scaled_height = img->rows;
+      info.scaled_width = img->cols;
       if ((scale_ > 0 &&
            (scaled_height != img->rows || scaled_width != img->cols))
           || (scaled_height > img->rows || scaled_width > img->cols)) {
@@ -730,14 +851,20 @@ bool ImageInputOp<Context>::GetImageAndLabelAndInfoFromDBValue(
         LOG(INFO) << "Scaling to " << scaled_width << " x " << scaled_height
                   << " From " << img->cols << " x " << img->rows;
         */
-        cv::resize(
-            *img,
-            scaled_img,
-            cv::Size(scaled_width, scaled_height),
-            0,
-            0,
-            cv::INTER_AREA);
-        *img = scaled_img;
+        if (gpu_resize_) {
+          // The GPU samples the crop from the image at its decoded size.
+          info.scaled_height = scaled_height;
+          info.scaled_width = scaled_width;
+        } else {
+          cv::resize(
+              *img,
+              scaled_img,
+              cv::Size(scaled_width, scaled_height),
+              0,
+              0,
+              cv::INTER_AREA);
+          *img = scaled_img;
+        }
       }
   }
   // TODO(Yangqing): return false if any error happens.
@@ -904,6 +1031,48 @@ void ColorNormalization(
   }
 }
 
+// Crops, optionally mirrors and normalizes the image in a single pass. Every
+// output row is crop * channels contiguous values, computed in one flat loop
+// against per-row copies of the mean and inverse std so that it vectorizes.
+template <class Context>
+void CropMirrorNormalizeImage(
+    const cv::Mat& scaled_img,
+    const int channels,
+    float* image_data,
+    const int crop,
+    const int height_offset,
+    const int width_offset,
+    const bool mirror_image,
+    const std::vector<float>& mean,
+    const std::vector<float>& std) {
+  const int row_size = crop * channels;
+  std::vector<float> row_mean(row_size);
+  std::vector<float> row_std(row_size);
+  for (int i = 0; i < row_size; ++i) {
+    row_mean[i] = mean[i % channels];
+    row_std[i] = std[i % channels];
+  }
+  std::vector<uint8_t> mirrored_row(mirror_image ? row_size : 0);
+  for (int h = 0; h < crop; ++h) {
+    const uint8_t* src =
+        scaled_img.ptr(height_offset + h) + width_offset * channels;
+    if (mirror_image) {
+      for (int w = 0; w < crop; ++w) {
+        for (int c = 0; c < channels; ++c) {
+          mirrored_row[w * channels + c] = src[(crop - 1 - w) * channels + c];
+        }
+      }
+      src = mirrored_row.data();
+    }
+    float* dst = image_data + h * row_size;
+    const float* m = row_mean.data();
+    const float* sd = row_std.data();
+    for (int i = 0; i < row_size; ++i) {
+      dst[i] = (static_cast<float>(src[i]) - m[i]) * sd[i];
+    }
+  }
+}
+
 // Factored out image transformation
 template <class Context>
 void TransformImage(
@@ -942,8 +1111,27 @@ void TransformImage(
       std::uniform_int_distribution<>(0, scaled_img.rows - crop)(*randgen);
   }
 
+  const bool mirror_image =
+      !is_test && mirror && (*mirror_this_image)(*randgen);
+  const bool jitter = channels == 3 && !is_test &&
+      (color_jitter || color_lighting);
+  if (!jitter) {
+    // Without color jittering, the normalization can be folded into the copy.
+    CropMirrorNormalizeImage<Context>(
+        scaled_img,
+        channels,
+        image_data,
+        crop,
+        height_offset,
+        width_offset,
+        mirror_image,
+        mean,
+        std);
+    return;
+  }
+
   float* image_data_ptr = image_data;
-  if (!is_test && mirror && (*mirror_this_image)(*randgen)) {
+  if (mirror_image) {
     // Copy mirrored image.
     for (int h = height_offset; h < height_offset + crop; ++h) {
       for (int w = width_offset + crop - 1; w >= width_offset; --w) {
@@ -1074,6 +1262,73 @@ void ImageInputOp<Context>::DecodeAndTransposeOnly(
                               randgen, &mirror_this_image, is_test_);
 }
 
+// Decode only, keeping the image at its decoded size and drawing the crop
+// the same way CropTransposeImage does so that the GPU can sample it.
+template <class Context>
+void ImageInputOp<Context>::DecodeOnly(
+    const std::string& value, int item_id, std::size_t thread_index) {
+
+  CAFFE_ENFORCE((int)thread_index < num_decode_threads_);
+
+  std::bernoulli_distribution mirror_this_image(0.5f);
+  std::mt19937* randgen = &(randgen_per_thread_[thread_index]);
+
+  cv::Mat& img = decoded_images_[item_id];
+  PerImageArg info;
+  CHECK(GetImageAndLabelAndInfoFromDBValue(value, &img, info, item_id,
+    randgen));
+  CAFFE_ENFORCE_GE(
+      info.scaled_height, crop_, "Image height must be bigger than crop.");
+  CAFFE_ENFORCE_GE(
+      info.scaled_width, crop_, "Image width must be bigger than crop.");
+
+  ResizeCropParams& params = resize_params_[item_id];
+  params.height = img.rows;
+  params.width = img.cols;
+  params.scaled_height = info.scaled_height;
+  params.scaled_width = info.scaled_width;
+  if (is_test_) {
+    params.width_offset = (info.scaled_width - crop_) / 2;
+    params.height_offset = (info.scaled_height - crop_) / 2;
+  } else {
+    params.width_offset =
+      std::uniform_int_distribution<>(0, info.scaled_width - crop_)(*randgen);
+    params.height_offset =
+      std::uniform_int_distribution<>(0, info.scaled_height - crop_)(*randgen);
+  }
+  params.mirror = mirror_ && mirror_this_image(*randgen);
+}
+
+// Copy the decoded images back to back into prefetched_image_, so that the
+// batch goes to the device in a single copy.
+template <class Context>
+void ImageInputOp<Context>::PackDecodedImages(const int channels) {
+  int64_t total = 0;
+  for (int item_id = 0; item_id < batch_size_; ++item_id) {
+    resize_params_[item_id].offset = total;
+    total += decoded_images_[item_id].total() * channels;
+  }
+  prefetched_image_.Resize(TIndex(total));
+  uint8_t* packed = prefetched_image_.mutable_data<uint8_t>();
+  for (int item_id = 0; item_id < batch_size_; ++item_id) {
+    const cv::Mat& img = decoded_images_[item_id];
+    // A bounding box leaves the image as a view into the decoded one.
+    const int row_size = img.cols * channels;
+    uint8_t* dst = packed + resize_params_[item_id].offset;
+    for (int h = 0; h < img.rows; ++h) {
+      memcpy(dst + h * row_size, img.ptr(h), row_size);
+    }
+    decoded_images_[item_id].release();
+  }
+
+  prefetched_resize_params_.Resize(
+      TIndex(batch_size_ * sizeof(ResizeCropParams)));
+  memcpy(
+      prefetched_resize_params_.mutable_data<uint8_t>(),
+      resize_params_.data(),
+      batch_size_ * sizeof(ResizeCropParams));
+}
+
 
 template <class Context>
 bool ImageInputOp<Context>::Prefetch() {
@@ -1100,7 +1355,9 @@ bool ImageInputOp<Context>::Prefetch() {
     cv::Mat img;
 
     // read data
-    reader_->Read(&key, &value);
+    CAFFE_DURATION(this->stats_, prefetch_read_ns) {
+      reader_->Read(&key, &value);
+    }
 
     // determine label type based on first item
     if( item_id == 0 ) {
@@ -1139,7 +1396,14 @@ bool ImageInputOp<Context>::Prefetch() {
 
     // launch into thread pool for processing
     // TODO: support color jitter and color lighting in gpu_transform
-    if (gpu_transform_) {
+    if (gpu_resize_) {
+      thread_pool_->runTaskWithID(std::bind(
+          &ImageInputOp<Context>::DecodeOnly,
+          this,
+          std::string(value),
+          item_id,
+          std::placeholders::_1));
+    } else if (gpu_transform_) {
       // output of decode will still be int8
       uint8_t* image_data = prefetched_image_.mutable_data<uint8_t>() +
           crop_ * crop_ * channels * item_id;
@@ -1165,12 +1429,19 @@ bool ImageInputOp<Context>::Prefetch() {
     }
   }
   thread_pool_->waitWorkComplete();
+  if (gpu_resize_) {
+    PackDecodedImages(channels);
+  }
 
   // If the context is not CPUContext, we will need to do a copy in the
   // prefetch function as well.
   if (!std::is_same<Context, CPUContext>::value) {
     prefetched_image_on_device_.CopyFrom(prefetched_image_, &context_);
     prefetched_label_on_device_.CopyFrom(prefetched_label_, &context_);
+    if (gpu_resize_) {
+      prefetched_resize_params_on_device_.CopyFrom(
+          prefetched_resize_params_, &context_);
+    }
 
     for (int i = 0; i < prefetched_additional_outputs_on_device_.size(); ++i) {
       prefetched_additional_outputs_on_device_[i].CopyFrom(
@@ -1215,7 +1486,22 @@ bool ImageInputOp<Context>::CopyPrefetched() {
         mean_std_copied_ = true;
       }
       // GPU transform kernel allows explicitly setting output type
-      if (output_type_ == TensorProto_DataType_FLOAT) {
+      if (gpu_resize_) {
+        const int channels = color_ ? 3 : 1;
+        if (output_type_ == TensorProto_DataType_FLOAT) {
+          ResizeCropTransformOnGPU<float, Context>(
+              prefetched_image_on_device_, prefetched_resize_params_on_device_,
+              batch_size_, channels, crop_, image_output, mean_gpu_, std_gpu_,
+              &context_);
+        } else if (output_type_ == TensorProto_DataType_FLOAT16) {
+          ResizeCropTransformOnGPU<float16, Context>(
+              prefetched_image_on_device_, prefetched_resize_params_on_device_,
+              batch_size_, channels, crop_, image_output, mean_gpu_, std_gpu_,
+              &context_);
+        } else {
+          return false;
+        }
+      } else if (output_type_ == TensorProto_DataType_FLOAT) {
         TransformOnGPU<uint8_t,float,Context>(prefetched_image_on_device_,
                                               image_output, mean_gpu_,
                                               std_gpu_, &context_);
@@ -62,6 +62,54 @@ __global__ void transform_kernel(
   }
 }
 
+// input in (uint8, HWC) images of varying size, output in (T, NCHW) crops.
+// The crop is sampled bilinearly from the image as if it had been resized to
+// the scaled size first, which is exact when no resize is needed.
+template <typename Out>
+__global__ void resize_crop_transform_kernel(
+    const int C,
+    const int crop,
+    const ResizeCropParams* params,
+    const float* mean,
+    const float* std,
+    const uint8_t* in,
+    Out* out) {
+  const int n = blockIdx.x;
+  const ResizeCropParams p = params[n];
+
+  const uint8_t* input_ptr = &in[p.offset];
+  Out* output_ptr = &out[n*C*crop*crop];
+
+  const float scale_h = static_cast<float>(p.height) / p.scaled_height;
+  const float scale_w = static_cast<float>(p.width) / p.scaled_width;
+
+  for (int h=threadIdx.y; h < crop; h += blockDim.y) {
+    float src_h = (h + p.height_offset + 0.5f) * scale_h - 0.5f;
+    src_h = fminf(fmaxf(src_h, 0.f), p.height - 1);
+    const int h0 = static_cast<int>(src_h);
+    const int h1 = min(h0 + 1, p.height - 1);
+    const float dh = src_h - h0;
+    for (int w=threadIdx.x; w < crop; w += blockDim.x) {
+      const int crop_w = p.mirror ? crop - 1 - w : w;
+      float src_w = (crop_w + p.width_offset + 0.5f) * scale_w - 0.5f;
+      src_w = fminf(fmaxf(src_w, 0.f), p.width - 1);
+      const int w0 = static_cast<int>(src_w);
+      const int w1 = min(w0 + 1, p.width - 1);
+      const float dw = src_w - w0;
+      for (int c=0; c < C; ++c) {
+        const float v00 = input_ptr[(h0*p.width + w0)*C + c];
+        const float v01 = input_ptr[(h0*p.width + w1)*C + c];
+        const float v10 = input_ptr[(h1*p.width + w0)*C + c];
+        const float v11 = input_ptr[(h1*p.width + w1)*C + c];
+        const float v = (1.f - dh) * ((1.f - dw) * v00 + dw * v01) +
+            dh * ((1.f - dw) * v10 + dw * v11);
+        output_ptr[c*crop*crop + h*crop + w] =
+            convert::To<float,Out>((v - mean[c]) * std[c]);
+      }
+    }
+  }
+}
+
 }
 
 template <typename T_IN, typename T_OUT, class Context>
@@ -96,4 +144,32 @@ template bool TransformOnGPU<uint8_t, float16, CUDAContext>(Tensor<CUDAContext>&
                                                             Tensor<CUDAContext>& std,
                                                             CUDAContext *context);
 
+template <typename T_OUT, class Context>
+bool ResizeCropTransformOnGPU(Tensor<Context>& X, Tensor<Context>& params,
+                              int N, int C, int crop, Tensor<Context>* Y,
+                              Tensor<Context>& mean, Tensor<Context>& std,
+                              Context* context) {
+  CAFFE_ENFORCE_EQ(params.nbytes(), N * sizeof(ResizeCropParams));
+  Y->Resize(std::vector<int>{N, C, crop, crop});
+
+  const auto* resize_params =
+      reinterpret_cast<const ResizeCropParams*>(params.raw_data());
+  resize_crop_transform_kernel<
+    T_OUT><<<N, dim3(16, 16), 0, context->cuda_stream()>>>(
+      C, crop, resize_params, mean.template data<float>(),
+      std.template data<float>(), X.template data<uint8_t>(),
+      Y->template mutable_data<T_OUT>());
+  return true;
+}
+
+template bool ResizeCropTransformOnGPU<float, CUDAContext>(
+    Tensor<CUDAContext>& X, Tensor<CUDAContext>& params, int N, int C,
+    int crop, Tensor<CUDAContext>* Y, Tensor<CUDAContext>& mean,
+    Tensor<CUDAContext>& std, CUDAContext* context);
+
+template bool ResizeCropTransformOnGPU<float16, CUDAContext>(
+    Tensor<CUDAContext>& X, Tensor<CUDAContext>& params, int N, int C,
+    int crop, Tensor<CUDAContext>* Y, Tensor<CUDAContext>& mean,
+    Tensor<CUDAContext>& std, CUDAContext* context);
+
 }  // namespace caffe2
@@ -51,6 +51,29 @@ bool TransformOnGPU(Tensor<Context>& X, Tensor<Context>* Y,
                     Tensor<Context>& mean, Tensor<Context>& std,
                     Context* context);
 
+// Where a decoded image sits in a packed batch and how to sample its crop.
+// The crop is taken at (height_offset, width_offset) from the image resized
+// to scaled_height x scaled_width, so the image itself is never resized.
+struct ResizeCropParams {
+  int64_t offset;
+  int height;
+  int width;
+  int scaled_height;
+  int scaled_width;
+  int height_offset;
+  int width_offset;
+  int mirror;
+};
+
+// Resizes, crops, mirrors and normalizes N decoded images in one pass. X holds
+// the uint8 HWC images back to back as described by params, a uint8 tensor of
+// N ResizeCropParams. Y is resized to N x C x crop x crop.
+template <typename T_OUT, class Context>
+bool ResizeCropTransformOnGPU(Tensor<Context>& X, Tensor<Context>& params,
+                              int N, int C, int crop, Tensor<Context>* Y,
+                              Tensor<Context>& mean, Tensor<Context>& std,
+                              Context* context);
+
 }  // namespace caffe2
 
 #endif
@@ -24,12 +24,22 @@
 namespace caffe2 {
 namespace mkl {
 
+// fusion_type of ConvFusion: what is applied to the convolution output.
+enum FusionType {
+  FUSION_UNKNOWN = 0,
+  FUSION_CONV_RELU = 1,
+  FUSION_CONV_SUM = 2,
+  FUSION_CONV_SUM_RELU = 3,
+};
+
 template <typename T>
 class MKLConvOp final : public ConvPoolOpBase<MKLContext> {
  public:
   USE_CONV_POOL_BASE_FUNCTIONS(MKLContext);
   MKLConvOp(const OperatorDef& operator_def, Workspace* ws)
-      : ConvPoolOpBase<MKLContext>(operator_def, ws) {
+      : ConvPoolOpBase<MKLContext>(operator_def, ws),
+        fusion_type_(static_cast<FusionType>(
+            OperatorBase::GetSingleArgument<int>("fusion_type", 0))) {
     OPERATOR_NEEDS_FEATURE(
         dilation_h() == 1 && dilation_w() == 1, "Dilation not supported.");
     OPERATOR_NEEDS_FEATURE(
@@ -37,6 +47,9 @@ class MKLConvOp final : public ConvPoolOpBase<MKLContext> {
         "Uneven padding not supported.");
     OPERATOR_NEEDS_FEATURE(
         order_ == StorageOrder::NCHW, "Only NCHW order supported.");
+    if (HasSum()) {
+      CAFFE_ENFORCE_EQ(InputSize(), 4, "Fusing a sum needs X, W, b and S.");
+    }
   }
   ~MKLConvOp() {}
 
@@ -61,6 +74,11 @@ class MKLConvOp final : public ConvPoolOpBase<MKLContext> {
         : OperatorBase::Input<MKLMemory<float>>(BIAS);
 
     MKLMemory<float>* Y = OperatorBase::Output<MKLMemory<float>>(0);
+    if (HasSum()) {
+      CAFFE_ENFORCE(
+          Y != &OperatorBase::Input<MKLMemory<float>>(SUMMAND),
+          "ConvFusion cannot write its output in place of the summand.");
+    }
     CAFFE_ENFORCE(4 == X.ndim());
     const int N = X.dim32(0), C = X.dim32(1), H = X.dim32(2), W = X.dim32(3);
     CAFFE_ENFORCE(4 == filter.ndim());
@@ -131,6 +149,19 @@ class MKLConvOp final : public ConvPoolOpBase<MKLContext> {
       input_layout_.Reset(primitive_, dnnResourceSrc);
       filter_layout_.Reset(primitive_, dnnResourceFilter);
       bias_layout_.Reset(primitive_, dnnResourceBias);
+      if (HasSum()) {
+        conv_buffer_.Reset(dummy_output.dims(), primitive_, dnnResourceDst);
+        sum_primitive_.Reset(
+            dnnSumCreate<float>,
+            nullptr,
+            2,
+            buffer_.layout(),
+            sum_coefficients_);
+      }
+      if (HasRelu()) {
+        relu_primitive_.Reset(
+            dnnReLUCreateForward<T>, nullptr, buffer_.layout(), 0.f);
+      }
     }
 
     // Try to share from the output: this allows us to avoid unnecessary copy
@@ -164,9 +195,28 @@ class MKLConvOp final : public ConvPoolOpBase<MKLContext> {
     resources_[dnnResourceSrc] = X_view.get(); // X.buffer();
     resources_[dnnResourceFilter] = filter_view.get();
     resources_[dnnResourceBias] = bias_view.get();
-    resources_[dnnResourceDst] = buffer_.buffer();
+    resources_[dnnResourceDst] =
+        HasSum() ? conv_buffer_.buffer() : buffer_.buffer();
 
     MKLDNN_SAFE_CALL(mkl::dnnExecute<T>(primitive_, resources_));
+    // The fused steps run on the convolution output while it is still in
+    // the convolution's layout, the summand is converted to it if needed.
+    if (HasSum()) {
+      std::shared_ptr<void> S_view =
+          OperatorBase::Input<MKLMemory<float>>(SUMMAND).View(
+              buffer_.layout(), primitive_, dnnResourceDst);
+      void* sum_resources[dnnResourceNumber] = {0};
+      sum_resources[dnnResourceMultipleSrc] = conv_buffer_.buffer();
+      sum_resources[dnnResourceMultipleSrc + 1] = S_view.get();
+      sum_resources[dnnResourceDst] = buffer_.buffer();
+      MKLDNN_SAFE_CALL(mkl::dnnExecute<T>(sum_primitive_, sum_resources));
+    }
+    if (HasRelu()) {
+      void* relu_resources[dnnResourceNumber] = {0};
+      relu_resources[dnnResourceSrc] = buffer_.buffer();
+      relu_resources[dnnResourceDst] = buffer_.buffer();
+      MKLDNN_SAFE_CALL(mkl::dnnExecute<T>(relu_primitive_, relu_resources));
+    }
     buffer_.CopyTo(Y, primitive_, dnnResourceDst);
     return true;
   }
@@ -176,8 +226,18 @@ class MKLConvOp final : public ConvPoolOpBase<MKLContext> {
   }
 
  private:
-  // Input: X, W, b
+  bool HasSum() const {
+    return fusion_type_ == FUSION_CONV_SUM ||
+        fusion_type_ == FUSION_CONV_SUM_RELU;
+  }
+  bool HasRelu() const {
+    return fusion_type_ == FUSION_CONV_RELU ||
+        fusion_type_ == FUSION_CONV_SUM_RELU;
+  }
+
+  // Input: X, W, b, and S for the fused sum
   // Output: Y
+  const FusionType fusion_type_;
   std::unique_ptr<MKLMemory<T>> zero_bias_;
   vector<TIndex> cached_input_dims_;
   vector<TIndex> cached_filter_dims_;
@@ -187,13 +247,35 @@ class MKLConvOp final : public ConvPoolOpBase<MKLContext> {
   LayoutWrapper<T> bias_layout_;
   MKLMemory<T> buffer_;
   void* resources_[dnnResourceNumber] = {0};
-  INPUT_TAGS(INPUT, FILTER, BIAS);
+  // Only used by ConvFusion.
+  MKLMemory<T> conv_buffer_;
+  PrimitiveWrapper<T> sum_primitive_;
+  PrimitiveWrapper<T> relu_primitive_;
+  float sum_coefficients_[2] = {1, 1};
+  INPUT_TAGS(INPUT, FILTER, BIAS, SUMMAND);
 };
 
 } // namespace mkl
 
 
 REGISTER_MKL_OPERATOR(Conv, mkl::MKLConvOp<float>);
+REGISTER_MKL_OPERATOR(ConvFusion, mkl::MKLConvOp<float>);
+
+OPERATOR_SCHEMA(ConvFusion)
+    .NumInputs(2, 4)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Convolution fused with the operators that follow it, as produced by the MKL
+graph rewrite: Conv then Relu (fusion_type 1), Conv then Sum with S
+(fusion_type 2), or Conv, Sum with S, then Relu (fusion_type 3). Takes the
+arguments of Conv, and is only implemented for MKL in NCHW order.
+)DOC")
+    .Arg("fusion_type", "Which operators are fused, see above.")
+    .Input(0, "X", "Input data blob, NCHW.")
+    .Input(1, "filter", "The filter blob.")
+    .Input(2, "bias", "The bias blob, required when a sum is fused.")
+    .Input(3, "S", "Added to the convolution output, for fusion_type 2, 3.")
+    .Output(0, "Y", "Output data blob, it may not be S.");
 
 }  // namespace caffe2
 
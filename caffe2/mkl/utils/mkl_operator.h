@@ -76,13 +76,13 @@ class MKLOperator : public OperatorBase {
   // Waits for a previous event. Note that to properly wait and run
   // asynchronously, WaitEvent, RunAsync and Record should all be executed
   // on the same CPU thread.
-  void WaitEvent(const Event& ev) final {
-    context_.SwitchToDevice();
+  void WaitEvent(const Event& ev, int stream_id = 0) final {
+    context_.SwitchToDevice(stream_id);
     context_.WaitEvent(ev);
   }
 
-  void Record() final {
-    context_.SwitchToDevice();
+  void Record(int stream_id = 0) final {
+    context_.SwitchToDevice(stream_id);
     context_.Record(&event_);
   }
 
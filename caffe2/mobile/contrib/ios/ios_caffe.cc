@@ -16,17 +16,19 @@
 
 
 #include "ios_caffe.h"
+#include "caffe2/core/mmap_tensor_file.h"
 #include "caffe2/core/predictor.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/mobile/contrib/ios/ios_caffe_predictor.h"
 
-Caffe2IOSPredictor* MakeCaffe2Predictor(const std::string& init_net_str,
-                                        const std::string& predict_net_str,
-                                        bool disableMultithreadProcessing,
-                                        bool allowMetalOperators,
-                                        std::string& errorMessage) {
-  caffe2::NetDef init_net, predict_net;
-  init_net.ParseFromString(init_net_str);
+namespace {
+
+Caffe2IOSPredictor* MakeCaffe2PredictorFromInitNet(const caffe2::NetDef& init_net,
+                                                   const std::string& predict_net_str,
+                                                   bool disableMultithreadProcessing,
+                                                   bool allowMetalOperators,
+                                                   std::string& errorMessage) {
+  caffe2::NetDef predict_net;
   predict_net.ParseFromString(predict_net_str);
 
   Caffe2IOSPredictor* predictor = NULL;
@@ -45,6 +47,31 @@ Caffe2IOSPredictor* MakeCaffe2Predictor(const std::string& init_net_str,
   return predictor;
 }
 
+} // namespace
+
+Caffe2IOSPredictor* MakeCaffe2Predictor(const std::string& init_net_str,
+                                        const std::string& predict_net_str,
+                                        bool disableMultithreadProcessing,
+                                        bool allowMetalOperators,
+                                        std::string& errorMessage) {
+  caffe2::NetDef init_net;
+  init_net.ParseFromString(init_net_str);
+  return MakeCaffe2PredictorFromInitNet(
+      init_net, predict_net_str, disableMultithreadProcessing, allowMetalOperators, errorMessage);
+}
+
+Caffe2IOSPredictor* MakeCaffe2PredictorFromMmapFile(const std::string& weights_path,
+                                                    const std::string& predict_net_str,
+                                                    bool disableMultithreadProcessing,
+                                                    bool allowMetalOperators,
+                                                    std::string& errorMessage) {
+  return MakeCaffe2PredictorFromInitNet(caffe2::MmapTensorFileInitNet(weights_path),
+                                        predict_net_str,
+                                        disableMultithreadProcessing,
+                                        allowMetalOperators,
+                                        errorMessage);
+}
+
 void GenerateStylizedImage(std::vector<float>& originalImage,
                            const std::string& init_net_str,
                            const std::string& predict_net_str,
@@ -30,6 +30,14 @@ IOS_CAFFE_EXPORT Caffe2IOSPredictor* MakeCaffe2Predictor(const std::string& init
                                                          bool disableMultithreadProcessing,
                                                          bool allowMetalOperators,
                                                          std::string& errorMessage);
+// Like MakeCaffe2Predictor, but the weights are mapped from an mmap tensor file (see
+// caffe2/core/mmap_tensor_file.h) instead of being parsed and copied out of an init net.
+IOS_CAFFE_EXPORT Caffe2IOSPredictor* MakeCaffe2PredictorFromMmapFile(
+    const std::string& weights_path,
+    const std::string& predict_net_str,
+    bool disableMultithreadProcessing,
+    bool allowMetalOperators,
+    std::string& errorMessage);
 IOS_CAFFE_EXPORT void GenerateStylizedImage(std::vector<float>& originalImage,
                                             const std::string& init_net_str,
                                             const std::string& predict_net_str,
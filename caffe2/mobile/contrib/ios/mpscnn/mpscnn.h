@@ -17,6 +17,7 @@
 
 #pragma once
 #include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
 
 namespace caffe2 {
 static constexpr const char* kMPSCNNReadCountArg = "__mpscnn_read_count__";
@@ -35,4 +36,22 @@ NetDef rewriteForMetal(const NetDef& net);
 NetDef runMPSCNNFusion(const NetDef& net);
 void dumpDef(const NetDef& d);
 void mpscnnRecordExecutionFinish();
+
+// Sums the GPU execution time of the MPSCNN command buffers committed while the observed net runs.
+// The command buffers are tracked globally, so nets running concurrently are not told apart.
+// Requires iOS 10.3 for the GPU timestamps, and reports 0 before that.
+class MPSCNNGPUTimeObserver final : public ObserverBase<NetBase> {
+ public:
+  explicit MPSCNNGPUTimeObserver(NetBase* subject);
+  ~MPSCNNGPUTimeObserver();
+
+  bool Start() override;
+  bool Stop() override;
+
+  // The GPU time of the last run, in milliseconds.
+  double getGPUTimeMs() const { return gpuTimeMs_; }
+
+ private:
+  double gpuTimeMs_{0};
+};
 } // namespace caffe2
@@ -37,25 +37,22 @@ namespace caffe2 {
 namespace {
 auto divRoundUp(uint x, uint y) -> uint { return (x + y - 1) / y; }
 
+MPSImageDescriptor* imageDescriptor(int n, int height, int width, int channels) {
+  return [MPSImageDescriptor
+      imageDescriptorWithChannelFormat:MPSImageFeatureChannelFormatFloat16
+                                 width:width
+                                height:height
+                       featureChannels:channels
+                        numberOfImages:n
+                                 usage:MTLTextureUsageShaderRead | MTLTextureUsageShaderWrite];
+}
+
 MPSTemporaryImage* createTemporaryImage(const OperatorBase* op,
                                         id<MTLCommandBuffer> commandBuffer,
-                                        int n,
-                                        int height,
-                                        int width,
-                                        int channels,
+                                        MPSImageDescriptor* descriptor,
                                         size_t output_idx = 0) {
-
-  auto* image = [MPSTemporaryImage
-      temporaryImageWithCommandBuffer:commandBuffer
-                      imageDescriptor:
-                          [MPSImageDescriptor
-                              imageDescriptorWithChannelFormat:MPSImageFeatureChannelFormatFloat16
-                                                         width:width
-                                                        height:height
-                                               featureChannels:channels
-                                                numberOfImages:n
-                                                         usage:MTLTextureUsageShaderRead |
-                                                               MTLTextureUsageShaderWrite]];
+  auto* image = [MPSTemporaryImage temporaryImageWithCommandBuffer:commandBuffer
+                                                   imageDescriptor:descriptor];
   // We'll try to look at the per-output_idx read-count argument, otherwise, we'll use the
   // operator-global default.
   const auto& readCounts = op->GetRepeatedArgument<int>(kMPSCNNReadCountArg);
@@ -67,18 +64,18 @@ MPSTemporaryImage* createTemporaryImage(const OperatorBase* op,
 }
 
 MPSImage* createStaticImage(int n, int height, int width, int channels) {
-  return [[MPSImage alloc]
-       initWithDevice:getMPSCNNContext().device
-      imageDescriptor:[MPSImageDescriptor
-                          imageDescriptorWithChannelFormat:MPSImageFeatureChannelFormatFloat16
-                                                     width:width
-                                                    height:height
-                                           featureChannels:channels
-                                            numberOfImages:n
-                                                     usage:MTLTextureUsageShaderRead |
-                                                           MTLTextureUsageShaderWrite]];
+  return [[MPSImage alloc] initWithDevice:getMPSCNNContext().device
+                          imageDescriptor:imageDescriptor(n, height, width, channels)];
 }
 
+// Shared by the wrappers of all the images encoded on one command buffer, so that the temporary
+// images of a whole inference can be prefetched in one allocation the next time it runs.
+struct CommandBufferPlan {
+  // The operator that started the command buffer.
+  const void* op;
+  NSMutableArray<MPSImageDescriptor*>* temporaryImageDescriptors;
+};
+
 class MPSImageWrapper {
  public:
   MPSImageWrapper() {}
@@ -100,8 +97,12 @@ class MPSImageWrapper {
      * synchronize(commit) it since it won't be used in the future.
      */
     bool passOnCb = parent != nullptr && parent->isTemporaryImage_;
-    commandBuffer_ =
-        passOnCb ? parent->commandBuffer_ : [getMPSCNNContext().commandQueue commandBuffer];
+    if (passOnCb) {
+      commandBuffer_ = parent->commandBuffer_;
+      plan_ = parent->plan_;
+    } else {
+      startCommandBuffer(op);
+    }
 
     bool commitInputCb = parent != nullptr && !parent->isTemporaryImage_;
     if (commitInputCb) {
@@ -113,7 +114,9 @@ class MPSImageWrapper {
                             ? isTemporaryImages.at(output_idx)
                             : op->GetSingleArgument<int>(kMPSCNNOutputIsTempImageArg, 1);
     if (isTemporaryImage_) {
-      image_ = createTemporaryImage(op, commandBuffer_, n, height, width, channels, output_idx);
+      auto* descriptor = imageDescriptor(n, height, width, channels);
+      image_ = createTemporaryImage(op, commandBuffer_, descriptor, output_idx);
+      [plan_->temporaryImageDescriptors addObject:descriptor];
     } else {
       image_ = createStaticImage(n, height, width, channels);
     }
@@ -133,6 +136,13 @@ class MPSImageWrapper {
   void synchronize() {
     // commit the command buffer if it is notEnqueued
     if (commandBuffer_ != nullptr && commandBuffer_.status == 0) {
+      auto& ctx = getMPSCNNContext();
+      if (plan_) {
+        ctx.setTemporaryImageDescriptors(plan_->op, [plan_->temporaryImageDescriptors copy]);
+      }
+      if (ctx.numGPUTimeObservers > 0) {
+        ctx.trackCommandBuffer(commandBuffer_);
+      }
       [commandBuffer_ commit];
     }
   }
@@ -146,12 +156,26 @@ class MPSImageWrapper {
     output->GetMutable<MPSImageWrapper>()->image_ = image_;
     output->GetMutable<MPSImageWrapper>()->commandBuffer_ = commandBuffer_;
     output->GetMutable<MPSImageWrapper>()->isTemporaryImage_ = isTemporaryImage_;
+    output->GetMutable<MPSImageWrapper>()->plan_ = plan_;
   }
 
  private:
+  void startCommandBuffer(const OperatorBase* op) {
+    auto& ctx = getMPSCNNContext();
+    commandBuffer_ = [ctx.commandQueue commandBuffer];
+    NSArray<MPSImageDescriptor*>* descriptors = ctx.getTemporaryImageDescriptors(op);
+    if (descriptors.count > 0) {
+      [MPSTemporaryImage prefetchStorageWithCommandBuffer:commandBuffer_
+                                      imageDescriptorList:descriptors];
+    }
+    plan_ = std::make_shared<CommandBufferPlan>(
+        CommandBufferPlan{op, [NSMutableArray arrayWithCapacity:descriptors.count]});
+  }
+
   MPSImage* image_{nullptr};
   id<MTLCommandBuffer> commandBuffer_{nullptr};
   bool isTemporaryImage_ = true;
+  std::shared_ptr<CommandBufferPlan> plan_;
 };
 
 NSString* kernelFor(const MPSImage* X, NSString* arrayKernel, NSString* nonArrayKernel) {
@@ -341,7 +365,7 @@ class CopyFromMPSCNNOp final : public Operator<CPUContext> {
       [encoder endEncoding];
       Wrapper(i).markRead();
     }
-    [cb0 commit];
+    Wrapper(0).synchronize();
     [cb0 waitUntilCompleted];
 
     for (auto i = 0; i < Inputs().size(); ++i) {
@@ -518,7 +542,7 @@ class MPSCNNBRGNCHWCToPackedInt8BGRAStylizerDeprocessOp final : public Operator<
     [encoder endEncoding];
     inputWrapper.markRead();
 
-    [commandBuffer commit];
+    inputWrapper.synchronize();
     [commandBuffer waitUntilCompleted];
 
     Output(0)->Resize(1, X.height, X.width, 4);
@@ -1314,7 +1338,9 @@ class MPSCNNConvTransposeOp final : public ConvTransposeUnpoolBase<CPUContext> {
             << X.numberOfImages;
 
     auto gemmed = createTemporaryImage(
-        this, commandBuffer, X.numberOfImages, X.height, X.width, output_channels * kH * kW);
+        this,
+        commandBuffer,
+        imageDescriptor(X.numberOfImages, X.height, X.width, output_channels * kH * kW));
     {
       caffe2::Timer gt;
       [conv_ encodeToCommandBuffer:commandBuffer sourceImage:X destinationImage:gemmed];
@@ -2140,6 +2166,32 @@ OPERATOR_SCHEMA(MPSCNNResizeNearest).NumInputs(1).NumOutputs(1);
 }
 
 CAFFE_KNOWN_TYPE(MPSImageWrapper);
+
+MPSCNNGPUTimeObserver::MPSCNNGPUTimeObserver(NetBase* subject)
+    : ObserverBase<NetBase>(subject) {
+  getMPSCNNContext().numGPUTimeObservers += 1;
+}
+
+MPSCNNGPUTimeObserver::~MPSCNNGPUTimeObserver() { getMPSCNNContext().numGPUTimeObservers -= 1; }
+
+bool MPSCNNGPUTimeObserver::Start() {
+  // Drop the command buffers of earlier runs.
+  getMPSCNNContext().takeTrackedCommandBuffers();
+  return true;
+}
+
+bool MPSCNNGPUTimeObserver::Stop() {
+  gpuTimeMs_ = 0;
+  for (id<MTLCommandBuffer> commandBuffer : getMPSCNNContext().takeTrackedCommandBuffers()) {
+    [commandBuffer waitUntilCompleted];
+    if (commandBuffer.status == MTLCommandBufferStatusCompleted &&
+        [commandBuffer respondsToSelector:@selector(GPUStartTime)]) {
+      gpuTimeMs_ += (commandBuffer.GPUEndTime - commandBuffer.GPUStartTime) * 1000;
+    }
+  }
+  VLOG(2) << "MPSCNN GPU time: " << gpuTimeMs_;
+  return true;
+}
 } // namespace caffe2
 
 #endif
@@ -20,12 +20,15 @@
 #import <Metal/MTLBuffer.h>
 #import <Metal/MTLDevice.h>
 #import <Metal/MTLLibrary.h>
+#import <MetalPerformanceShaders/MetalPerformanceShaders.h>
 
 #include <array>
+#include <atomic>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace caffe2 {
 
@@ -39,9 +42,25 @@ struct MPSCNNContext {
   id<MTLComputePipelineState> getSpecializedPipelineState(NSString* kernel,
                                                           const std::vector<ushort>& constants);
 
+  // The temporary images allocated on the last command buffer started by the given operator.
+  // They are prefetched on the next command buffer it starts, so MPS can place all of them in a
+  // single allocation, aliasing the images whose read counts do not overlap.
+  NSArray<MPSImageDescriptor*>* getTemporaryImageDescriptors(const void* op);
+  void setTemporaryImageDescriptors(const void* op, NSArray<MPSImageDescriptor*>* descriptors);
+
+  // Command buffers committed while an MPSCNNGPUTimeObserver is attached are tracked, so that
+  // their GPU time can be summed once they completed.
+  void trackCommandBuffer(id<MTLCommandBuffer> commandBuffer);
+  std::vector<id<MTLCommandBuffer>> takeTrackedCommandBuffers();
+  std::atomic<int> numGPUTimeObservers{0};
+
  private:
   std::mutex pipelineCacheMutex_;
   std::unordered_map<std::string, id<MTLComputePipelineState>> pipelineCache_;
+  std::mutex temporaryImagesMutex_;
+  std::unordered_map<const void*, NSArray<MPSImageDescriptor*>*> temporaryImageDescriptors_;
+  std::mutex trackedCommandBuffersMutex_;
+  std::vector<id<MTLCommandBuffer>> trackedCommandBuffers_;
 };
 
 // get the singleton instance.
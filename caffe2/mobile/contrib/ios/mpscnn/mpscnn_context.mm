@@ -113,6 +113,30 @@ id<MTLComputePipelineState> MPSCNNContext::getSpecializedPipelineState(
   pipelineCache_[kernelStr] = state;
   return state;
 }
+
+NSArray<MPSImageDescriptor*>* MPSCNNContext::getTemporaryImageDescriptors(const void* op) {
+  std::lock_guard<std::mutex> g(temporaryImagesMutex_);
+  auto it = temporaryImageDescriptors_.find(op);
+  return it == temporaryImageDescriptors_.end() ? nil : it->second;
+}
+
+void MPSCNNContext::setTemporaryImageDescriptors(const void* op,
+                                                 NSArray<MPSImageDescriptor*>* descriptors) {
+  std::lock_guard<std::mutex> g(temporaryImagesMutex_);
+  temporaryImageDescriptors_[op] = descriptors;
+}
+
+void MPSCNNContext::trackCommandBuffer(id<MTLCommandBuffer> commandBuffer) {
+  std::lock_guard<std::mutex> g(trackedCommandBuffersMutex_);
+  trackedCommandBuffers_.push_back(commandBuffer);
+}
+
+std::vector<id<MTLCommandBuffer>> MPSCNNContext::takeTrackedCommandBuffers() {
+  std::lock_guard<std::mutex> g(trackedCommandBuffersMutex_);
+  std::vector<id<MTLCommandBuffer>> commandBuffers;
+  commandBuffers.swap(trackedCommandBuffers_);
+  return commandBuffers;
+}
 }
 
 #endif
@@ -287,15 +287,31 @@ NetDef annotateDefWithReadCounts(const NetDef& net) {
   annotatedNet.CopyFrom(net);
   for (auto i = 0; i < annotatedNet.op_size(); ++i) {
     auto* op = annotatedNet.mutable_op(i);
-    // TODO - relax this? CAFFE_ENFORCE_EQ(op->output_size(), 1);
-    const auto& blob = op->output(0);
-    const size_t readCount = readCounts[i][blob];
-    if (readCount > 1) {
-      auto* arg = op->add_arg();
-      arg->set_name(kMPSCNNReadCountArg);
-      arg->set_i(readCount);
-      LOG(INFO) << "Op: " << i << ", ty: " << op->type() << ", blob: " << blob
-                << ", read count: " << readCount;
+    // Every output gets its own read count, so that each temporary image is released as soon as
+    // its last reader ran and MPS can alias its storage with the images allocated after it.
+    // Outputs that are never read still need a read count of one to be written.
+    std::vector<size_t> outputReadCounts;
+    bool hasMultipleReads = false;
+    for (const auto& blob : op->output()) {
+      const size_t readCount = std::max<size_t>(readCounts[i][blob], 1);
+      outputReadCounts.push_back(readCount);
+      hasMultipleReads |= readCount > 1;
+      if (readCount > 1) {
+        LOG(INFO) << "Op: " << i << ", ty: " << op->type() << ", blob: " << blob
+                  << ", read count: " << readCount;
+      }
+    }
+    if (!hasMultipleReads) {
+      continue;
+    }
+    auto* arg = op->add_arg();
+    arg->set_name(kMPSCNNReadCountArg);
+    if (outputReadCounts.size() == 1) {
+      arg->set_i(outputReadCounts[0]);
+    } else {
+      for (const auto readCount : outputReadCounts) {
+        arg->add_ints(readCount);
+      }
     }
   }
   return annotatedNet;
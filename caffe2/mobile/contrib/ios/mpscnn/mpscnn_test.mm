@@ -2710,6 +2710,37 @@ void testMPSCNN() {
     CHECK_EQ(rc(3), 1);
   }
 
+  {
+    LOG(INFO) << "MPSCNNReadCount Multiple Outputs Test";
+    NetDef netdef;
+    {
+      auto& op = *(netdef.add_op());
+      op.add_input("X_cpu");
+      op.add_output("X_mtl");
+      op.add_output("Z_mtl");
+    }
+
+    {
+      auto& op = *(netdef.add_op());
+      op.add_input("X_mtl");
+      op.add_input("Z_mtl");
+      op.add_output("Y");
+    }
+
+    {
+      auto& op = *(netdef.add_op());
+      op.add_input("X_mtl");
+      op.add_output("W");
+    }
+    netdef = annotateDefWithReadCounts(netdef);
+    auto* arg = GetMutableArgument("__mpscnn_read_count__", false, netdef.mutable_op(0));
+    CHECK(arg);
+    CHECK_EQ(arg->ints_size(), 2);
+    CHECK_EQ(arg->ints(0), 2);
+    CHECK_EQ(arg->ints(1), 1);
+    CHECK(!GetMutableArgument("__mpscnn_read_count__", false, netdef.mutable_op(1)));
+  }
+
   {
     for (const auto& computeOp : std::vector<std::string>{"FC", "Conv"}) {
       LOG(INFO) << "MPSCNNRewriteForMetal Fusion/Copy Test";
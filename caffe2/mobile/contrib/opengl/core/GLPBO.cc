@@ -19,6 +19,8 @@
 
 #include "caffe2/core/logging.h"
 
+#include <algorithm>
+
 GLPBO::~GLPBO() {
   if (pboId != 0) {
     gl_log(GL_LOG, "deleting PBO buffer %d\n", pboId);
@@ -30,10 +32,43 @@ GLPBO::~GLPBO() {
     glDeleteFramebuffers(1, &pboFrameBuffer);
     pboFrameBuffer = 0;
   }
+  for (int i = 0; i < 2; i++) {
+    if (uploadPboIds[i] != 0) {
+      glDeleteBuffers(1, &uploadPboIds[i]);
+      uploadPboIds[i] = 0;
+    }
+  }
+  for (auto& read : pendingReads) {
+    glDeleteSync(read.fence);
+    glDeleteBuffers(1, &read.pboId);
+  }
+  pendingReads.clear();
+  for (auto& pbo : freeReadPbos) {
+    glDeleteBuffers(1, &pbo.first);
+  }
+  freeReadPbos.clear();
 }
 
 GLPBO* GLPBO::pboContext = NULL;
 
+void GLPBO::bindFramebuffer(GLuint _textureId) {
+  if (pboFrameBuffer == 0) {
+    glGenFramebuffers(1, &pboFrameBuffer);
+    gl_log(GL_VERBOSE, "created PBO frame buffer %d\n", pboFrameBuffer);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, pboFrameBuffer);
+
+  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _textureId, 0);
+
+  int fbs = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (fbs != GL_FRAMEBUFFER_COMPLETE) {
+    std::stringstream errmsg;
+    errmsg << ": Frame buffer incomplete: " << fbs;
+    throw std::runtime_error(errmsg.str());
+  }
+}
+
 GLPBO* GLPBO::getContext() {
   if (pboContext == NULL) {
     pboContext = new GLPBO();
@@ -56,21 +91,7 @@ void GLPBO::mapTextureData(GLuint _textureId,
   GLint defaultFramebuffer = 0;
   glGetIntegerv(GL_FRAMEBUFFER_BINDING, &defaultFramebuffer);
 
-  if (pboFrameBuffer == 0) {
-    glGenFramebuffers(1, &pboFrameBuffer);
-    gl_log(GL_VERBOSE, "created PBO frame buffer %d\n", pboFrameBuffer);
-  }
-
-  glBindFramebuffer(GL_FRAMEBUFFER, pboFrameBuffer);
-
-  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _textureId, 0);
-
-  int fbs = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-  if (fbs != GL_FRAMEBUFFER_COMPLETE) {
-    std::stringstream errmsg;
-    errmsg << ": Frame buffer incomplete: " << fbs;
-    throw std::runtime_error(errmsg.str());
-  }
+  bindFramebuffer(_textureId);
 
   if (pboId == 0) {
     glGenBuffers(1, &pboId);
@@ -107,3 +128,124 @@ void GLPBO::mapTextureData(GLuint _textureId,
   // Bind to the default FrameBuffer
   glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebuffer);
 }
+
+void GLPBO::loadTextureData(GLuint _textureId,
+                            GLsizei _width,
+                            GLsizei _height,
+                            GLsizei _channels,
+                            const GLTexture::Type& _type,
+                            std::function<void(void* buffer,
+                                               size_t width,
+                                               size_t height,
+                                               size_t stride,
+                                               size_t channels,
+                                               const GLTexture::Type& type)> process) {
+  GLuint& uploadPboId = uploadPboIds[uploadIndex];
+  GLuint& uploadPboSize = uploadPboSizes[uploadIndex];
+  uploadIndex = 1 - uploadIndex;
+
+  if (uploadPboId == 0) {
+    glGenBuffers(1, &uploadPboId);
+    gl_log(GL_VERBOSE, "created upload PBO buffer %d\n", uploadPboId);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadPboId);
+
+  size_t buffer_size = _width * _height * _channels * _type.dataSize();
+
+  // Respecifying the storage lets the driver hand out new memory if the
+  // previous upload from this buffer is still in flight.
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, std::max<size_t>(buffer_size, uploadPboSize), NULL, GL_STREAM_DRAW);
+  uploadPboSize = std::max<size_t>(buffer_size, uploadPboSize);
+
+  void* ptr = glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, buffer_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!ptr) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    std::stringstream errmsg;
+    errmsg << ": glMapBufferRange using upload PBO incomplete";
+    throw std::runtime_error(errmsg.str());
+  }
+  process(ptr, _width, _height, _width, _channels, _type);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  // Sources the texture data from the bound buffer, at offset 0.
+  glBindTexture(GL_TEXTURE_2D, _textureId);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, _type.format, _type.type, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void GLPBO::startReadTextureData(GLuint _textureId,
+                                 GLsizei _width,
+                                 GLsizei _height,
+                                 GLsizei _stride,
+                                 GLsizei _channels,
+                                 const GLTexture::Type& _type) {
+  GLint defaultFramebuffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &defaultFramebuffer);
+
+  bindFramebuffer(_textureId);
+
+  PendingRead read{0, 0, 0, _width, _height, _stride, _channels, &_type};
+  if (!freeReadPbos.empty()) {
+    read.pboId = freeReadPbos.back().first;
+    read.pboSize = freeReadPbos.back().second;
+    freeReadPbos.pop_back();
+  } else {
+    glGenBuffers(1, &read.pboId);
+    gl_log(GL_VERBOSE, "created readback PBO buffer %d\n", read.pboId);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, read.pboId);
+
+  size_t buffer_size = _stride * _height * _channels * _type.dataSize();
+  if (buffer_size > read.pboSize) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, buffer_size, NULL, GL_STREAM_READ);
+    read.pboSize = buffer_size;
+  }
+
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glReadPixels(0, 0, _stride, _height, _type.format, _type.type, 0);
+  read.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  pendingReads.push_back(read);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebuffer);
+}
+
+bool GLPBO::finishReadTextureData(std::function<void(const void* buffer,
+                                                     size_t width,
+                                                     size_t height,
+                                                     size_t stride,
+                                                     size_t channels,
+                                                     const GLTexture::Type& type)> process) {
+  if (pendingReads.empty()) {
+    return false;
+  }
+  PendingRead read = pendingReads.front();
+  pendingReads.pop_front();
+
+  // The first wait flushes the commands, so that the fence is signaled
+  // eventually.
+  GLenum status = glClientWaitSync(read.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+  glDeleteSync(read.fence);
+  if (status == GL_WAIT_FAILED) {
+    glDeleteBuffers(1, &read.pboId);
+    throw std::runtime_error(": glClientWaitSync failed on PBO readback");
+  }
+
+  size_t buffer_size = read.stride * read.height * read.channels * read.type->dataSize();
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, read.pboId);
+  const void* ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer_size, GL_MAP_READ_BIT);
+  if (!ptr) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glDeleteBuffers(1, &read.pboId);
+    std::stringstream errmsg;
+    errmsg << ": glMapBufferRange using PBO incomplete";
+    throw std::runtime_error(errmsg.str());
+  }
+  process(ptr, read.width, read.height, read.stride, read.channels, *read.type);
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  freeReadPbos.push_back({read.pboId, read.pboSize});
+  return true;
+}
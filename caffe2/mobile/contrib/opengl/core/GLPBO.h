@@ -18,17 +18,42 @@
 #pragma once
 
 #include "GLTexture.h"
+#include <deque>
 #include <functional>
+#include <vector>
 
 class GLPBO {
   GLuint pboId = 0;
   GLuint pboSize = 0;
   GLuint pboFrameBuffer = 0;
 
+  // Unpack buffers that uploads alternate between, so that filling the
+  // buffer of the next upload does not wait for the previous one.
+  GLuint uploadPboIds[2] = {0, 0};
+  GLuint uploadPboSizes[2] = {0, 0};
+  int uploadIndex = 0;
+
+  // A readback that has been issued but not mapped yet.
+  struct PendingRead {
+    GLuint pboId;
+    GLuint pboSize;
+    GLsync fence;
+    GLsizei width;
+    GLsizei height;
+    GLsizei stride;
+    GLsizei channels;
+    const GLTexture::Type* type;
+  };
+  std::deque<PendingRead> pendingReads;
+  // Pack buffers of finished readbacks, kept for the next ones.
+  std::vector<std::pair<GLuint, GLuint>> freeReadPbos;
+
   ~GLPBO();
 
   static GLPBO* pboContext;
 
+  void bindFramebuffer(GLuint _textureId);
+
  public:
   void mapTextureData(GLuint _textureId,
                       GLsizei _width,
@@ -43,5 +68,40 @@ class GLPBO {
                                          size_t channels,
                                          const GLTexture::Type& type)> process);
 
+  // Uploads the data process writes into a pixel buffer to the texture. The
+  // copy to the texture is done by the GL pipeline, and the next upload uses
+  // the other buffer, so neither waits for the GPU.
+  void loadTextureData(GLuint _textureId,
+                       GLsizei _width,
+                       GLsizei _height,
+                       GLsizei _channels,
+                       const GLTexture::Type& type,
+                       std::function<void(void* buffer,
+                                          size_t width,
+                                          size_t height,
+                                          size_t stride,
+                                          size_t channels,
+                                          const GLTexture::Type& type)> process);
+
+  // Queues a readback of the texture into a pixel buffer, fenced so that it
+  // completes in the background while the GL pipeline goes on.
+  void startReadTextureData(GLuint _textureId,
+                            GLsizei _width,
+                            GLsizei _height,
+                            GLsizei _stride,
+                            GLsizei _channels,
+                            const GLTexture::Type& type);
+
+  // Waits for the oldest queued readback and passes its data to process.
+  // Returns false if there is none.
+  bool finishReadTextureData(std::function<void(const void* buffer,
+                                                size_t width,
+                                                size_t height,
+                                                size_t stride,
+                                                size_t channels,
+                                                const GLTexture::Type& type)> process);
+
+  size_t pendingReadCount() const { return pendingReads.size(); }
+
   static GLPBO* getContext();
 };
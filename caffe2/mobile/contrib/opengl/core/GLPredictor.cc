@@ -17,6 +17,7 @@
 
 #include "GLPredictor.h"
 #include "GLContext.h"
+#include "GLPBO.h"
 #include "rewrite_net.h"
 #include <vector>
 
@@ -74,6 +75,55 @@ bool GLPredictor::run(std::vector<GLImageVector<T>*>& inputs,
   return true;
 }
 
+template <class T>
+bool GLPredictor::runAsync(std::vector<GLImageVector<T>*>& inputs) {
+  std::vector<const GLImageVector<T>*> outputs;
+  if (!run(inputs, &outputs)) {
+    return false;
+  }
+
+  std::vector<OutputSlice> slices;
+  for (auto i = 0; i < outputs.size(); ++i) {
+    for (auto j = 0; j < outputs[i]->size(); ++j) {
+      const GLImage<T>* image = (*outputs[i])[j];
+      for (auto k = 0; k < image->slices; ++k) {
+        image->textures[k]->start_read();
+        slices.push_back({i, j, k});
+      }
+    }
+  }
+  pendingRuns_.push_back(std::move(slices));
+  return true;
+}
+
+bool GLPredictor::fetchOutputs(std::function<void(int output,
+                                                  int image,
+                                                  int slice,
+                                                  const void* buffer,
+                                                  size_t width,
+                                                  size_t height,
+                                                  size_t stride,
+                                                  size_t channels,
+                                                  const GLTexture::Type& type)> process) {
+  if (pendingRuns_.empty()) {
+    return false;
+  }
+  const auto slices = std::move(pendingRuns_.front());
+  pendingRuns_.pop_front();
+  for (const auto& s : slices) {
+    GLPBO::getContext()->finishReadTextureData([&](const void* buffer,
+                                                   size_t width,
+                                                   size_t height,
+                                                   size_t stride,
+                                                   size_t channels,
+                                                   const GLTexture::Type& type) {
+      process(s.output, s.image, s.slice, buffer, width, height, stride, channels, type);
+    });
+  }
+  return true;
+}
+
 template bool GLPredictor::run(std::vector<GLImageVector<uint8_t>*>& inputs,
                                std::vector<const GLImageVector<uint8_t>*>* outputs);
+template bool GLPredictor::runAsync(std::vector<GLImageVector<uint8_t>*>& inputs);
 } // namespace caffe2
@@ -21,6 +21,8 @@
 #include "caffe2/core/net.h"
 #include "caffe2/core/predictor.h"
 
+#include <deque>
+
 namespace caffe2 {
 class GLPredictor : public Predictor {
  public:
@@ -32,6 +34,37 @@ class GLPredictor : public Predictor {
   template <class T>
   bool run(std::vector<GLImageVector<T>*>& inputs, std::vector<const GLImageVector<T>*>* outputs);
 
+  // Like run(), but instead of returning the output textures, queues fenced
+  // readbacks of all their slices into pixel buffers and returns without
+  // waiting for the GPU. The data is handed out by fetchOutputs(), so that
+  // the inputs of frame N + 1 can be uploaded and submitted while frame N is
+  // computed and read back.
+  template <class T>
+  bool runAsync(std::vector<GLImageVector<T>*>& inputs);
+
+  // Waits for the readbacks of the oldest runAsync() and passes each slice of
+  // its outputs to process, in order. Returns false if no run is in flight.
+  // The readbacks of all predictors share one queue, so runs of several
+  // predictors must be fetched in the order they were started.
+  bool fetchOutputs(std::function<void(int output,
+                                       int image,
+                                       int slice,
+                                       const void* buffer,
+                                       size_t width,
+                                       size_t height,
+                                       size_t stride,
+                                       size_t channels,
+                                       const GLTexture::Type& type)> process);
+
   ~GLPredictor();
+
+ private:
+  struct OutputSlice {
+    int output;
+    int image;
+    int slice;
+  };
+  // The output slices of each runAsync() whose readbacks are in flight.
+  std::deque<std::vector<OutputSlice>> pendingRuns_;
 };
 } // namespace caffe2
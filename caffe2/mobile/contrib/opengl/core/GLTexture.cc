@@ -64,20 +64,13 @@ void GLTexture::map_load(std::function<void(void* buffer,
                                             size_t stride,
                                             size_t channels,
                                             const Type& type)> process) const {
-  const int alignment = 32; // 4 * _type.dataSize();
-  void* buffer = nullptr;
-  size_t buffer_size = _width * _height * _channels * _type.dataSize();
-
-#ifdef __ANDROID__
-  buffer = (void*)memalign(alignment, buffer_size);
-#else
-  posix_memalign((void**)&buffer, alignment, buffer_size);
-#endif
-  CAFFE_ENFORCE(buffer);
+  GLPBO* pbo = GLPBO::getContext();
+  pbo->loadTextureData(_textureId, _width, _height, _channels, _type, process);
+}
 
-  process(buffer, _width, _height, _width, _channels, _type);
-  loadData(buffer);
-  free(buffer);
+void GLTexture::start_read() const {
+  GLPBO* pbo = GLPBO::getContext();
+  pbo->startReadTextureData(_textureId, _width, _height, _stride, _channels, _type);
 }
 
 void GLTexture::loadData(const void* pixels) const {
@@ -117,5 +117,9 @@ class GLTexture {
                                            size_t channels,
                                            const Type& type)> process) const;
 
+  // Queues a readback of the texture that does not wait for the GPU. The
+  // data is passed on by GLPBO::finishReadTextureData().
+  void start_read() const;
+
   void loadData(const void* pixels) const;
 };
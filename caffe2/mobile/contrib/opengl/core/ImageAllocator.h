@@ -18,6 +18,7 @@
 #pragma once
 
 #include "GLImageAllocator.h"
+#include "caffe2/core/blob.h"
 
 namespace caffe2 {
 
@@ -59,5 +60,30 @@ class ImageAllocator {
     return glImageAllocator->newImage(
         num_images, width, height, channels, tile_x, tile_y, textureAllocator);
   }
+
+  // Returns the image the output blob already holds if it has the given
+  // geometry, so that its textures can be rendered to again instead of being
+  // reallocated on every run, or nullptr otherwise. The image is not reused
+  // if the blob is also the input, or if it is the padded output of the last
+  // operator.
+  GLImageVector<T>* reusableImage(Blob* output,
+                                  const Blob* input,
+                                  int num_images,
+                                  int width,
+                                  int height,
+                                  int channels,
+                                  int tile_x,
+                                  int tile_y,
+                                  bool is_output) {
+    if (output == input || is_output || !output->template IsType<GLImageVector<T>>()) {
+      return nullptr;
+    }
+    auto* image = output->template GetMutable<GLImageVector<T>>();
+    if (image->size() == num_images && image->width() == width && image->height() == height &&
+        image->channels() == channels && image->tile_x() == tile_x && image->tile_y() == tile_y) {
+      return image;
+    }
+    return nullptr;
+  }
 };
 } // namespace caffe2
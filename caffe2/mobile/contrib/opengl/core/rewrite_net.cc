@@ -18,6 +18,7 @@
 #include "rewrite_net.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/utils/proto_utils.h"
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -202,7 +203,10 @@ static bool tryFuseAdjacentOps(const OperatorDef& currentOp,
       {{"OpenGLInstanceNorm", "OpenGLPRelu"}, "OpenGLInstanceNormPRelu"},
       {{"OpenGLConv", "OpenGLPRelu"}, "OpenGLConvPRelu"},
       {{"OpenGLConv", "OpenGLRelu"}, "OpenGLConvRelu"},
-      {{"OpenGLConvTranspose", "OpenGLPRelu"}, "OpenGLConvTransposePRelu"}};
+      {{"OpenGLConv", "OpenGLSigmoid"}, "OpenGLConvSigmoid"},
+      {{"OpenGLConvTranspose", "OpenGLPRelu"}, "OpenGLConvTransposePRelu"},
+      {{"OpenGLConvTranspose", "OpenGLRelu"}, "OpenGLConvTransposeRelu"},
+      {{"OpenGLConvTranspose", "OpenGLSigmoid"}, "OpenGLConvTransposeSigmoid"}};
   auto it = fusionOpportunities.find({currentOp.type(), nextOp.type()});
   if (it == fusionOpportunities.end()) {
     return false;
@@ -254,6 +258,80 @@ static NetDef runOpenGLFusion(const NetDef& def, std::unordered_set<std::string>
   return mdef;
 }
 
+static bool isOpenGLOp(const OperatorDef& op) {
+  return op.type().find("OpenGL") == 0 || op.type() == "CopyToOpenGL" ||
+         op.type() == "CopyFromOpenGL";
+}
+
+// Renames the intermediate blobs of the OpenGL operators so that a blob whose
+// last reader has run is written again by a later operator, instead of every
+// output keeping its textures alive for the lifetime of the workspace. Blobs
+// are eligible if they are written once, by an OpenGL operator, only read by
+// OpenGL operators, and are not external inputs or outputs of the net.
+// Together with the operators rendering to the image a blob already holds if
+// its geometry matches, this pools the textures of the net by liveness.
+static NetDef runOpenGLTextureReuse(const NetDef& def) {
+  std::unordered_map<std::string, int> writes;
+  std::unordered_map<std::string, int> lastUse;
+  std::unordered_set<std::string> ineligible(
+      def.external_input().begin(), def.external_input().end());
+  ineligible.insert(def.external_output().begin(), def.external_output().end());
+  for (auto i = 0; i < def.op_size(); i++) {
+    const auto& op = def.op(i);
+    for (const auto& input : op.input()) {
+      if (!isOpenGLOp(op) || !writes.count(input)) {
+        ineligible.insert(input);
+      }
+      lastUse[input] = i;
+    }
+    for (const auto& output : op.output()) {
+      if (!isOpenGLOp(op) || op.type() == "CopyFromOpenGL" || writes[output]++ > 0) {
+        ineligible.insert(output);
+      }
+      lastUse[output] = std::max(lastUse[output], i);
+    }
+  }
+
+  NetDef mdef;
+  mdef.CopyFrom(def);
+  std::unordered_map<std::string, std::string> names;
+  std::vector<std::string> freeNames;
+  for (auto i = 0; i < mdef.op_size(); i++) {
+    auto* op = mdef.mutable_op(i);
+    std::vector<std::string> dying;
+    for (auto j = 0; j < op->input_size(); j++) {
+      const auto input = op->input(j);
+      if (names.count(input)) {
+        op->set_input(j, names[input]);
+        if (lastUse[input] == i &&
+            std::find(dying.begin(), dying.end(), names[input]) == dying.end()) {
+          dying.push_back(names[input]);
+        }
+      }
+    }
+    for (auto j = 0; j < op->output_size(); j++) {
+      const auto output = op->output(j);
+      if (ineligible.count(output)) {
+        continue;
+      }
+      if (!freeNames.empty()) {
+        names[output] = freeNames.back();
+        freeNames.pop_back();
+        op->set_output(j, names[output]);
+      } else {
+        names[output] = output;
+      }
+      if (lastUse[output] == i) {
+        dying.push_back(names[output]);
+      }
+    }
+    // Freed after the outputs are assigned, so that no operator writes the
+    // blob it reads.
+    freeNames.insert(freeNames.end(), dying.begin(), dying.end());
+  }
+  return mdef;
+}
+
 void dumpDefForOpenGL(const NetDef& d) {
   for (const auto& op : d.op()) {
     LOG(INFO) << op.input(0) << " -> " << op.type() << " -> " << op.output(0);
@@ -274,7 +352,11 @@ void dumpDefForOpenGL(const NetDef& d) {
 //  }
 //}
 
-NetDef rewritePredictNetForOpenGL(const NetDef& predictNet, bool useTextureInput, bool useTiling, bool runFusion) {
+NetDef rewritePredictNetForOpenGL(const NetDef& predictNet,
+                                  bool useTextureInput,
+                                  bool useTiling,
+                                  bool runFusion,
+                                  bool reuseTextures) {
   CAFFE_ENFORCE_GE(predictNet.op_size(), 1);
   NetDef net;
   net.CopyFrom(predictNet);
@@ -356,6 +438,10 @@ NetDef rewritePredictNetForOpenGL(const NetDef& predictNet, bool useTextureInput
     net = insertInputOutputCopyOps(net, openGLOps);
   }
 
+  if (reuseTextures) {
+    net = runOpenGLTextureReuse(net);
+  }
+
   return net;
 }
 
@@ -364,10 +450,12 @@ bool tryConvertToOpenGL(const NetDef& initNet,
                         NetDef* glPredictNet,
                         bool useTextureInput,
                         bool useTiling,
-                        bool runFusion) {
+                        bool runFusion,
+                        bool reuseTextures) {
   try {
     // Throws if unsupported operators are found.
-    *glPredictNet = rewritePredictNetForOpenGL(predictNet, useTextureInput, useTiling, runFusion);
+    *glPredictNet = rewritePredictNetForOpenGL(
+        predictNet, useTextureInput, useTiling, runFusion, reuseTextures);
     dumpDefForOpenGL(*glPredictNet);
     // Throws if unsupported parameters are found.
     Workspace ws;
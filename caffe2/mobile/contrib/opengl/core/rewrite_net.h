@@ -25,12 +25,14 @@ bool tryConvertToOpenGL(const NetDef& initNet,
                         NetDef* glPredictNet,
                         bool useTextureInput = false,
                         bool useTiling       = false,
-                        bool runFusion       = true);
+                        bool runFusion       = true,
+                        bool reuseTextures   = true);
 
 // Exposed for testing
 NetDef rewritePredictNetForOpenGL(const NetDef& predictNet,
                                   bool useTextureInput = false,
                                   bool useTiling       = false,
-                                  bool runFusion       = true);
+                                  bool runFusion       = true,
+                                  bool reuseTextures   = true);
 void dumpDefForOpenGL(const NetDef& net);
 } // namespace caffe2
@@ -75,6 +75,9 @@ in highp vec2 v_texCoord;
   #define IN_BOUNDS(p, p0, p1) (all(greaterThanEqual(p, p0)) && all(lessThan(p, p1)))
 #endif
 
+// Applies the fused sigmoid, if any, to an output value
+#define ACTIVATE(v) (fuseSigmoid ? vec4(1.0) / (vec4(1.0) + exp(-(v))) : (v))
+
 #if TILED_CONVOLUTION
 // Tiled convolution
 const ivec2 inputTileSize = ivec2(INPUT_TILE_WIDTH, INPUT_TILE_HEIGHT);
@@ -83,6 +86,7 @@ const ivec2 outputTileSize = ivec2(OUTPUT_TILE_WIDTH, OUTPUT_TILE_HEIGHT);
 uniform ivec2 outputSize;
 uniform bool accumulate;
 uniform bool fusePRelu;
+uniform bool fuseSigmoid;
 
 uniform ivec2 inputTileRange;
 
@@ -215,7 +219,7 @@ void main() {
   vec4 preluValue = (tileNum % 2 == 0) ? unpackHalf4x16(scale[tileNum/2].xy) : unpackHalf4x16(scale[tileNum/2].zw);
 
   vec4 o0 = fusePRelu ? mix(value * preluValue, value, vec4(greaterThan(value, vec4(0)))) : value;
-  outputData0 = TEXTURE_STORE(o0);
+  outputData0 = TEXTURE_STORE(ACTIVATE(o0));
 }
 
 #else
@@ -225,6 +229,7 @@ void main() {
 uniform ivec2 outputSize;
 uniform bool accumulate;
 uniform bool fusePRelu;
+uniform bool fuseSigmoid;
 
 TEXTURE_INPUT(inputData[INPUT_BATCH_SIZE]);
 TEXTURE_INPUT(previousData[OUTPUT_BATCH_SIZE]);
@@ -343,22 +348,22 @@ void main() {
   vec4 prev0 = TEXTURE_LOAD(previousData[0], texelCoord);
   vec4 value = sum[0] + (accumulate ? prev0: unpackHalf4x16(bias[0].xy));
   vec4 o0 = fusePRelu ? mix(value * unpackHalf4x16(scale[0].xy), value, vec4(greaterThan(value, vec4(0)))) : value;
-  outputData0 = TEXTURE_STORE(o0);
+  outputData0 = TEXTURE_STORE(ACTIVATE(o0));
 #if OUTPUT_BATCH_SIZE > 1
   vec4 prev1 = TEXTURE_LOAD(previousData[1], texelCoord);
   value = sum[1] + (accumulate ? prev1 : unpackHalf4x16(bias[0].zw));
   vec4 o1 = fusePRelu ? mix(value * unpackHalf4x16(scale[0].zw), value, vec4(greaterThan(value, vec4(0)))) : value;
-  outputData1 = TEXTURE_STORE(o1);
+  outputData1 = TEXTURE_STORE(ACTIVATE(o1));
 #if OUTPUT_BATCH_SIZE > 2
   vec4 prev2 = TEXTURE_LOAD(previousData[2], texelCoord);
   value = sum[2] + (accumulate ? prev2 : unpackHalf4x16(bias[1].xy));
   vec4 o2 = fusePRelu ? mix(value * unpackHalf4x16(scale[1].xy), value, vec4(greaterThan(value, vec4(0)))) : value;
-  outputData2 = TEXTURE_STORE(o2);
+  outputData2 = TEXTURE_STORE(ACTIVATE(o2));
 #if OUTPUT_BATCH_SIZE > 3
   vec4 prev3 = TEXTURE_LOAD(previousData[3], texelCoord);
   value = sum[3] + (accumulate ? prev3: unpackHalf4x16(bias[1].zw));
   vec4 o3 = fusePRelu ? mix(value * unpackHalf4x16(scale[1].zw), value, vec4(greaterThan(value, vec4(0)))) : value;
-  outputData3 = TEXTURE_STORE(o3);
+  outputData3 = TEXTURE_STORE(ACTIVATE(o3));
 #endif
 #endif
 #endif
@@ -560,6 +565,9 @@ void GLConvolution::run_batched_conv(
                   fusePRelu->location,
                   prelu_scale != nullptr &&
                       (is == input_slices - input_batch_size));
+              glUniform1i(
+                  fuseSigmoid->location,
+                  fuse_sigmoid && (is == input_slices - input_batch_size));
             },
             output_image->texture_width,
             output_image->texture_height);
@@ -662,6 +670,9 @@ void GLConvolution::run_tiled_conv(
             glUniform1i(
                 fusePRelu->location,
                 prelu_scale != nullptr && (ib == input_tile_batch_size - 1));
+            glUniform1i(
+                fuseSigmoid->location,
+                fuse_sigmoid && (ib == input_tile_batch_size - 1));
           },
           output_image->texture_width,
           output_image->texture_height);
@@ -733,7 +744,7 @@ static void computeBatchSizes(
 #endif
 }
 
-template <class T, bool fusePRelu, bool fuseRelu>
+template <class T, bool fusePRelu, bool fuseRelu, bool fuseSigmoid = false>
 class OpenGLConvOp final : public ConvPoolOpBase<CPUContext>, ImageAllocator<T> {
  public:
   USE_OPERATOR_BASE_FUNCTIONS;
@@ -822,7 +833,9 @@ class OpenGLConvOp final : public ConvPoolOpBase<CPUContext>, ImageAllocator<T>
 
     int is_last = GetSingleArgument<int>("is_last", 0);
 
-    GLImageVector<T>* output = ImageAllocator<T>::newImage(
+    GLImageVector<T>* output = ImageAllocator<T>::reusableImage(
+        Outputs()[0],
+        Inputs()[INPUT],
         num_images,
         output_width,
         output_height,
@@ -830,6 +843,17 @@ class OpenGLConvOp final : public ConvPoolOpBase<CPUContext>, ImageAllocator<T>
         output_tile_x,
         output_tile_y,
         is_last);
+    const bool reused = output != nullptr;
+    if (!reused) {
+      output = ImageAllocator<T>::newImage(
+          num_images,
+          output_width,
+          output_height,
+          output_channels,
+          output_tile_x,
+          output_tile_y,
+          is_last);
+    }
 
     // TODO: figure out the dilation business
     GLConvolution::descriptor geometry{input_channels,
@@ -882,12 +906,15 @@ class OpenGLConvOp final : public ConvPoolOpBase<CPUContext>, ImageAllocator<T>
                                    output_tile_chunk_size,
                                    input_tile_batch_size,
                                    output_tile_batch_size,
-                                   tiling));
+                                   tiling,
+                                   fuseSigmoid));
     }
 
     conv->convolution(input, *output);
 
-    Outputs()[0]->Reset(output);
+    if (!reused) {
+      Outputs()[0]->Reset(output);
+    }
 
     return true;
   }
@@ -907,7 +934,12 @@ OPERATOR_SCHEMA(OpenGLConvPRelu).NumInputs(4).NumOutputs(1);
 REGISTER_CPU_OPERATOR(OpenGLConvRelu, OpenGLConvOp<float16_t, false, true>);
 OPERATOR_SCHEMA(OpenGLConvRelu).NumInputs(3).NumOutputs(1);
 
-template <class T, bool fusePRelu, bool fuseRelu>
+REGISTER_CPU_OPERATOR(
+    OpenGLConvSigmoid,
+    OpenGLConvOp<float16_t, false, false, true>);
+OPERATOR_SCHEMA(OpenGLConvSigmoid).NumInputs(3).NumOutputs(1);
+
+template <class T, bool fusePRelu, bool fuseRelu, bool fuseSigmoid = false>
 class OpenGLConvTransposeOp final : public ConvTransposeUnpoolBase<CPUContext>, ImageAllocator<T> {
  public:
   USE_OPERATOR_BASE_FUNCTIONS;
@@ -996,7 +1028,9 @@ class OpenGLConvTransposeOp final : public ConvTransposeUnpoolBase<CPUContext>,
 
     int is_last = GetSingleArgument<int>("is_last", 0);
 
-    GLImageVector<T>* output = ImageAllocator<T>::newImage(
+    GLImageVector<T>* output = ImageAllocator<T>::reusableImage(
+        Outputs()[0],
+        Inputs()[INPUT],
         num_images,
         output_width,
         output_height,
@@ -1004,6 +1038,17 @@ class OpenGLConvTransposeOp final : public ConvTransposeUnpoolBase<CPUContext>,
         output_tile_x,
         output_tile_y,
         is_last);
+    const bool reused = output != nullptr;
+    if (!reused) {
+      output = ImageAllocator<T>::newImage(
+          num_images,
+          output_width,
+          output_height,
+          output_channels,
+          output_tile_x,
+          output_tile_y,
+          is_last);
+    }
 
     // TODO: figure out the adj business
     GLConvolution::descriptor geometry{input_channels,
@@ -1057,12 +1102,15 @@ class OpenGLConvTransposeOp final : public ConvTransposeUnpoolBase<CPUContext>,
                                    output_tile_chunk_size,
                                    input_tile_batch_size,
                                    output_tile_batch_size,
-                                   tiling));
+                                   tiling,
+                                   fuseSigmoid));
     }
 
     conv->convolution(input, *output);
 
-    Outputs()[0]->Reset(output);
+    if (!reused) {
+      Outputs()[0]->Reset(output);
+    }
 
     return true;
   }
@@ -1081,4 +1129,9 @@ OPERATOR_SCHEMA(OpenGLConvTransposePRelu).NumInputs(4).NumOutputs(1);
 
 REGISTER_CPU_OPERATOR(OpenGLConvTransposeRelu, OpenGLConvTransposeOp<float16_t, false, true>);
 OPERATOR_SCHEMA(OpenGLConvTransposeRelu).NumInputs(3).NumOutputs(1);
+
+REGISTER_CPU_OPERATOR(
+    OpenGLConvTransposeSigmoid,
+    OpenGLConvTransposeOp<float16_t, false, false, true>);
+OPERATOR_SCHEMA(OpenGLConvTransposeSigmoid).NumInputs(3).NumOutputs(1);
 } // namespace caffe2
@@ -47,6 +47,7 @@ class GLConvolution : public GLFilter {
   binding* outputSize;
   binding* accumulate;
   binding* fusePRelu;
+  binding* fuseSigmoid;
   binding* kernel_block[MaxInputBatchSize];
   binding* bias_block;
   binding* prelu_scale_block;
@@ -63,6 +64,7 @@ class GLConvolution : public GLFilter {
   const int input_tile_batch_size;
   const int output_tile_batch_size;
   const bool tiling;
+  const bool fuse_sigmoid;
 
   static const char* fragment_shader;
 
@@ -80,7 +82,8 @@ class GLConvolution : public GLFilter {
       int _output_tile_chunk_size = 1,
       int _input_tile_batch_size = 1,
       int _output_tile_batch_size = 1,
-      bool _tiling = false)
+      bool _tiling = false,
+      bool _fuse_sigmoid = false)
       : GLFilter(
             "GLConvolution",
             vertex_shader,
@@ -146,7 +149,8 @@ class GLConvolution : public GLFilter {
         output_tile_chunk_size(_output_tile_chunk_size),
         input_tile_batch_size(_input_tile_batch_size),
         output_tile_batch_size(_output_tile_batch_size),
-        tiling(_tiling) {}
+        tiling(_tiling),
+        fuse_sigmoid(_fuse_sigmoid) {}
 
   ~GLConvolution() {}
 
@@ -188,6 +192,7 @@ class GLConvolution : public GLFilter {
     std::vector<binding*> bindings({BINDING(outputSize),
                                     BINDING(accumulate),
                                     BINDING(fusePRelu),
+                                    BINDING(fuseSigmoid),
                                     BINDING(inputTileRange)});
 
     for (int i = 0; i < input_batch_size; i++) {
@@ -238,13 +238,25 @@ class OpenGLPReluOp final : public Operator<CPUContext>, ImageAllocator<T> {
       CAFFE_ENFORCE_EQ(input.slices(), 1, "Input needs to be tiled in a single texture");
     }
 
-    GLImageVector<T>* output = ImageAllocator<T>::newImage(num_images,
-                                                           output_width,
-                                                           output_height,
-                                                           output_channels,
-                                                           output_tile_x,
-                                                           output_tile_y,
-                                                           is_last);
+    GLImageVector<T>* output = ImageAllocator<T>::reusableImage(Outputs()[0],
+                                                                Inputs()[0],
+                                                                num_images,
+                                                                output_width,
+                                                                output_height,
+                                                                output_channels,
+                                                                output_tile_x,
+                                                                output_tile_y,
+                                                                is_last);
+    const bool reused = output != nullptr;
+    if (!reused) {
+      output = ImageAllocator<T>::newImage(num_images,
+                                           output_width,
+                                           output_height,
+                                           output_channels,
+                                           output_tile_x,
+                                           output_tile_y,
+                                           is_last);
+    }
 
     const auto* scale = reluType == GLPRelu::PRelu ? &Input(1) : nullptr;
 
@@ -264,7 +276,9 @@ class OpenGLPReluOp final : public Operator<CPUContext>, ImageAllocator<T> {
 
     _prelu->prelu(input, *output, reluType);
 
-    Outputs()[0]->Reset(output);
+    if (!reused) {
+      Outputs()[0]->Reset(output);
+    }
 
     return true;
   }
@@ -116,8 +116,21 @@ class OpenGLSigmoidOp final : public Operator<CPUContext>, ImageAllocator<T> {
 
     int is_last = OperatorBase::GetSingleArgument<int>("is_last", 0);
 
-    GLImageVector<T>* output = ImageAllocator<T>::newImage(
-        num_images, output_width, output_height, output_channels, is_last);
+    GLImageVector<T>* output = ImageAllocator<T>::reusableImage(
+        Outputs()[0],
+        Inputs()[0],
+        num_images,
+        output_width,
+        output_height,
+        output_channels,
+        1,
+        1,
+        is_last);
+    const bool reused = output != nullptr;
+    if (!reused) {
+      output = ImageAllocator<T>::newImage(
+          num_images, output_width, output_height, output_channels, is_last);
+    }
 
     if (!_sigmoid) {
       _sigmoid.reset(new GLSigmoid(opType));
@@ -125,7 +138,9 @@ class OpenGLSigmoidOp final : public Operator<CPUContext>, ImageAllocator<T> {
 
     _sigmoid->sigmoid(input, *output);
 
-    Outputs()[0]->Reset(output);
+    if (!reused) {
+      Outputs()[0]->Reset(output);
+    }
 
     return true;
   }
@@ -246,7 +246,9 @@ typedef enum {
   ConvPRelu,
   ConvTransposePRelu,
   ConvRelu,
-  ConvTransposeRelu
+  ConvTransposeRelu,
+  ConvSigmoid,
+  ConvTransposeSigmoid
 } PoolOp;
 
 const char* glPoolOperationName[] = {"OpenGLAveragePool",
@@ -256,7 +258,9 @@ const char* glPoolOperationName[] = {"OpenGLAveragePool",
                                      "OpenGLConvPRelu",
                                      "OpenGLConvTransposePRelu",
                                      "OpenGLConvRelu",
-                                     "OpenGLConvTransposeRelu"};
+                                     "OpenGLConvTransposeRelu",
+                                     "OpenGLConvSigmoid",
+                                     "OpenGLConvTransposeSigmoid"};
 
 const char* cpuPoolOperationName[] = {"AveragePool",
                                       "MaxPool",
@@ -265,6 +269,8 @@ const char* cpuPoolOperationName[] = {"AveragePool",
                                       "Conv",
                                       "ConvTranspose",
                                       "Conv",
+                                      "ConvTranspose",
+                                      "Conv",
                                       "ConvTranspose"};
 
 void testOpenGLConv(int N,
@@ -317,7 +323,8 @@ void testOpenGLConv(int N,
 
   if (poolOp != AveragePool && poolOp != MaxPool) {
     auto* t = ws.CreateBlob("W")->GetMutable<TensorCPU>();
-    if (poolOp != ConvTranspose && poolOp != ConvTransposePRelu && poolOp != ConvTransposeRelu) {
+    if (poolOp != ConvTranspose && poolOp != ConvTransposePRelu && poolOp != ConvTransposeRelu &&
+        poolOp != ConvTransposeSigmoid) {
       t->Resize(K, C, kernel_h, kernel_w);
     } else {
       t->Resize(C, K, kernel_h, kernel_w);
@@ -532,6 +539,11 @@ void testOpenGLConv(int N,
       arg.set_name("order");
       arg.set_s("NCHW");
     }
+  } else if (poolOp == ConvSigmoid || poolOp == ConvTransposeSigmoid) {
+    auto& op = *(netdef.add_op());
+    op.set_type("Sigmoid");
+    op.add_input("Y_ref");
+    op.add_output("Y_ref");
   }
 
   ws.RunNetOnce(netdef);
@@ -2556,6 +2568,8 @@ void testOpenGL() {
       testOpenGLConv(1, channel, 10, 10, channel, 3, 3, 0, 1, ConvTransposePRelu, 0.1 * channel / 8, true, 1, 1, tile_x, tile_y, true);
       testOpenGLConv(1, channel, 10, 10, channel, 3, 3, 0, 1, ConvRelu, 0.1 * channel / 8, true, 1, 1, tile_x, tile_y, true);
       testOpenGLConv(1, channel, 10, 10, channel, 3, 3, 0, 1, ConvTransposeRelu, 0.1 * channel / 8, true, 1, 1, tile_x, tile_y, true);
+      testOpenGLConv(1, channel, 10, 10, channel, 3, 3, 0, 1, ConvSigmoid, 0.1 * channel / 8, true, 1, 1, tile_x, tile_y, true);
+      testOpenGLConv(1, channel, 10, 10, channel, 3, 3, 0, 1, ConvTransposeSigmoid, 0.1 * channel / 8, true, 1, 1, tile_x, tile_y, true);
 
       testOpenGLPRelu(1, channel, 13, 4, channel, tile_x, tile_y, 0.1);
       testOpenGLRelu(1, channel, 4, 17, tile_x, tile_y, 0.1);
@@ -2745,6 +2759,16 @@ void testOpenGL() {
     testOpenGLConv(1, 16, 1280, 720, 16, 3, 3, 0, 1, ConvTransposeRelu, 4, true, 4, 4);
     testOpenGLConv(1, 16, 1280, 720, 16, 3, 3, 0, 1, ConvTransposeRelu, 4, true, 1, 1);
 
+    LOG(INFO) << "Test OpenGL ConvSigmoid";
+    testOpenGLConv(1, 4, 6, 6, 4, 3, 3, 0, 1, ConvSigmoid, 0.1, true, 1, 1);
+    testOpenGLConv(1, 8, 6, 6, 8, 3, 3, 0, 1, ConvSigmoid, 0.1, true, 2, 2);
+    testOpenGLConv(1, 16, 16, 16, 16, 3, 3, 0, 1, ConvSigmoid, 0.1, true, 4, 4);
+
+    LOG(INFO) << "Test OpenGL ConvTransposeSigmoid";
+    testOpenGLConv(1, 4, 6, 6, 4, 3, 3, 0, 1, ConvTransposeSigmoid, 0.1, true, 1, 1);
+    testOpenGLConv(1, 8, 6, 6, 8, 3, 3, 0, 1, ConvTransposeSigmoid, 0.1, true, 2, 2);
+    testOpenGLConv(1, 16, 16, 16, 16, 3, 3, 0, 1, ConvTransposeSigmoid, 0.1, true, 4, 4);
+
     LOG(INFO) << "Test OpenGL PRelu";
     testOpenGLPRelu(1, 4, 16, 16, 4, 1, 1, 0.1);
     testOpenGLPRelu(1, 16, 16, 16, 1, 1, 1, 0.1);
@@ -35,14 +35,34 @@ OPERATOR_SCHEMA(MPIAllreduce)
   .NumInputs(2)
   .NumOutputs(1)
   .AllowInplace({{1, 0}});
+OPERATOR_SCHEMA(MPIAllreduceCompressed)
+  .NumInputs(2, 3)
+  .NumOutputs(1, 2)
+  .AllowInplace({{1, 0}})
+  .EnforceInplace({{2, 1}})
+  .SetDoc(R"DOC(
+Sums a float tensor over all nodes like MPIAllreduce, but compresses what is
+sent: fp16 chunks on a ring, or with top_k only the k largest entries of each
+node, with an error-feedback residual. Results are accumulated in fp32.
+)DOC")
+  .Input(0, "comm_world", "The MPI common world.")
+  .Input(1, "X", "The float tensor to be allreduced.")
+  .Input(2, "residual", "Values held back by earlier top-k calls, top_k only.")
+  .Output(0, "Y", "The allreduced tensor, same on all nodes.")
+  .Output(1, "residual", "In-place as input 2.")
+  .Arg("fp16", "(bool, default true) send values as fp16.")
+  .Arg("top_k", "(int, default 0) if positive, only send this many entries.");
 OPERATOR_SCHEMA(MPISendTensor);
-OPERATOR_SCHEMA(MPIReceiveTensor);
+OPERATOR_SCHEMA(MPIReceiveTensor).ShapeOnlyInputs({1});
 
 REGISTER_CPU_OPERATOR(MPICreateCommonWorld, MPICreateCommonWorldOp<CPUContext>);
 REGISTER_CPU_OPERATOR(MPIBroadcast, MPIBroadcastOp<CPUContext>);
 REGISTER_CPU_OPERATOR(MPIReduce, MPIReduceOp<float, CPUContext>);
 REGISTER_CPU_OPERATOR(MPIAllgather, MPIAllgatherOp<float, CPUContext>);
 REGISTER_CPU_OPERATOR(MPIAllreduce, MPIAllreduceOp<float, CPUContext>);
+REGISTER_CPU_OPERATOR(
+    MPIAllreduceCompressed,
+    MPIAllreduceCompressedOp<CPUContext>);
 REGISTER_CPU_OPERATOR(MPISendTensor, MPISendTensorOp<CPUContext>);
 REGISTER_CPU_OPERATOR(MPIReceiveTensor, MPIReceiveTensorOp<CPUContext>);
 
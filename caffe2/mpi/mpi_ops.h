@@ -21,6 +21,8 @@
 
 #include "caffe2/core/operator.h"
 #include "caffe2/mpi/mpi_common.h"
+#include "caffe2/utils/gradient_compression.h"
+#include "caffe2/utils/math.h"
 
 namespace caffe2 {
 
@@ -160,6 +162,151 @@ class MPIAllreduceOp final : public Operator<Context> {
   }
 };
 
+// MPIAllreduceCompressedOp sums a float tensor over all nodes while sending
+// less than fp32 over the wire. The sum is accumulated in fp32 on every node.
+// With top_k == 0 it runs a ring reduce-scatter followed by a ring allgather
+// that sends fp16 chunks. With top_k > 0 every node only sends the k largest
+// entries of its tensor plus the error-feedback residual (input and output 1),
+// and keeps what it did not send in the residual for the next call.
+template <class Context>
+class MPIAllreduceCompressedOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MPIAllreduceCompressedOp(const OperatorDef& def, Workspace* ws)
+      : Operator<Context>(def, ws),
+        OP_SINGLE_ARG(bool, "fp16", fp16_, true),
+        OP_SINGLE_ARG(int, "top_k", top_k_, 0) {
+    CAFFE_ENFORCE_GE(top_k_, 0);
+    CAFFE_ENFORCE(
+        top_k_ == 0 || (def.input_size() == 3 && def.output_size() == 2),
+        "top_k needs the residual as input and output 1");
+  }
+
+  bool RunOnDevice() override {
+    MPI_Comm comm = OperatorBase::Input<MPICommonWorldWrapper>(0).comm();
+    auto& input = Input(1);
+    auto* output = Output(0);
+    const int N = input.size();
+    if (top_k_ > 0) {
+      // The residual is updated in place.
+      auto* residual = Output(1);
+      if (residual->size() != N) {
+        // First call: nothing has been held back yet.
+        residual->ResizeLike(input);
+        math::Set<float, Context>(
+            N, 0.f, residual->template mutable_data<float>(), &context_);
+      }
+      allreduceTopK(comm, input, output, residual);
+    } else {
+      if (output != &input) {
+        output->CopyFrom(input, &context_);
+      }
+      allreduceHalf(comm, output);
+    }
+    return true;
+  }
+
+ protected:
+  void allreduceHalf(MPI_Comm comm, Tensor<Context>* output) {
+    const int size = MPICommSize(comm);
+    const int rank = MPICommRank(comm);
+    float* acc = output->template mutable_data<float>();
+    const int N = output->size();
+    if (size == 1) {
+      return;
+    }
+    // Chunk c covers [c * chunk, min(N, (c + 1) * chunk)).
+    const int chunk = (N + size - 1) / size;
+    auto begin = [&](int c) { return std::min(N, c * chunk); };
+    auto count = [&](int c) { return begin(c + 1) - begin(c); };
+    send_.resize(chunk);
+    recv_.resize(chunk);
+    const int left = (rank + size - 1) % size;
+    const int right = (rank + 1) % size;
+    auto exchange = [&](int send_chunk, int recv_chunk) {
+      compression::FloatToHalf(
+          count(send_chunk), acc + begin(send_chunk), send_.data());
+      MPI_CHECK(MPI_Sendrecv(
+          send_.data(),
+          count(send_chunk) * sizeof(float16),
+          MPI_BYTE,
+          right,
+          0,
+          recv_.data(),
+          count(recv_chunk) * sizeof(float16),
+          MPI_BYTE,
+          left,
+          0,
+          comm,
+          MPI_STATUS_IGNORE));
+    };
+    // Reduce-scatter: after size - 1 steps this node holds the full sum of
+    // chunk rank + 1.
+    for (int step = 0; step < size - 1; ++step) {
+      const int send_chunk = (rank - step + size) % size;
+      const int recv_chunk = (rank - step - 1 + size) % size;
+      exchange(send_chunk, recv_chunk);
+      compression::HalfAccumulate(
+          count(recv_chunk), recv_.data(), acc + begin(recv_chunk));
+    }
+    // Round the owned chunk the same way the other nodes will see it, so that
+    // all nodes end up with identical results.
+    const int owned = (rank + 1) % size;
+    compression::FloatToHalf(count(owned), acc + begin(owned), send_.data());
+    compression::HalfToFloat(count(owned), send_.data(), acc + begin(owned));
+    // Allgather of the reduced chunks.
+    for (int step = 0; step < size - 1; ++step) {
+      const int send_chunk = (rank + 1 - step + size) % size;
+      const int recv_chunk = (rank - step + size) % size;
+      exchange(send_chunk, recv_chunk);
+      compression::HalfToFloat(
+          count(recv_chunk), recv_.data(), acc + begin(recv_chunk));
+    }
+  }
+
+  void allreduceTopK(
+      MPI_Comm comm,
+      const Tensor<Context>& input,
+      Tensor<Context>* output,
+      Tensor<Context>* residual) {
+    const int size = MPICommSize(comm);
+    const int N = input.size();
+    const int k = std::min(top_k_, N);
+    const size_t bytes = compression::TopKMessageBytes(k, fp16_);
+    message_.resize(bytes);
+    compression::EncodeTopK(
+        N,
+        k,
+        fp16_,
+        input.template data<float>(),
+        residual->template mutable_data<float>(),
+        message_.data());
+    gathered_.resize(bytes * size);
+    MPI_CHECK(MPI_Allgather(
+        message_.data(),
+        bytes,
+        MPI_BYTE,
+        gathered_.data(),
+        bytes,
+        MPI_BYTE,
+        comm));
+    output->ResizeLike(input);
+    float* acc = output->template mutable_data<float>();
+    math::Set<float, Context>(N, 0.f, acc, &context_);
+    for (int i = 0; i < size; ++i) {
+      compression::DecodeTopKAccumulate(
+          N, k, fp16_, gathered_.data() + i * bytes, acc);
+    }
+  }
+
+  bool fp16_;
+  int top_k_;
+  std::vector<float16> send_;
+  std::vector<float16> recv_;
+  std::vector<char> message_;
+  std::vector<char> gathered_;
+};
+
 template <class Context>
 class MPISendTensorOp final : public Operator<Context> {
  public:
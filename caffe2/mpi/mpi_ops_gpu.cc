@@ -99,4 +99,9 @@ REGISTER_CUDA_OPERATOR(
     GPUFallbackOp<MPIAllreduceOp<float, CPUContext>>);
 #endif
 
+// Compression runs on the host, the GPU tensors are copied over.
+REGISTER_CUDA_OPERATOR(
+    MPIAllreduceCompressed,
+    GPUFallbackOp<MPIAllreduceCompressedOp<CPUContext>>);
+
 }  // namespace caffe2
@@ -316,6 +316,88 @@ TEST(MPITest, TestInPlaceMPIAllreduce) {
   }
 }
 
+const char kMPIAllreduceCompressedNet[] = R"NET(
+  name: "allreduce_compressed"
+  op {
+    output: "comm"
+    type: "MPICreateCommonWorld"
+  }
+  op {
+    output: "X"
+    type: "ConstantFill"
+    arg {
+      name: "shape"
+      ints: 10
+    }
+    arg {
+      name: "value"
+      f: 0.0
+    }
+  }
+  op {
+    input: "comm"
+    input: "X"
+    output: "X_half"
+    type: "MPIAllreduceCompressed"
+  }
+  op {
+    input: "comm"
+    input: "X"
+    input: "residual"
+    output: "X_top_k"
+    output: "residual"
+    type: "MPIAllreduceCompressed"
+    arg {
+      name: "top_k"
+      i: 3
+    }
+  }
+)NET";
+
+TEST(MPITest, TestMPIAllreduceCompressed) {
+  NetDef net_def;
+  CHECK(google::protobuf::TextFormat::ParseFromString(
+      string(kMPIAllreduceCompressedNet), &net_def));
+  // Let's set the network's constant fill value to be the mpi rank.
+  auto* arg = net_def.mutable_op(1)->mutable_arg(1);
+  CAFFE_ENFORCE_EQ(arg->name(), "value");
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  arg->set_f(rank);
+  int size;
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  Workspace ws;
+  // The residual starts out empty and is zero-filled by the first run.
+  ws.CreateBlob("residual");
+  unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  EXPECT_NE(nullptr, net.get());
+  EXPECT_TRUE(net->Run());
+  // Small integers are exact in fp16.
+  int expected_result = size * (size - 1) / 2;
+  auto& X_half = ws.GetBlob("X_half")->Get<TensorCPU>();
+  EXPECT_EQ(X_half.size(), 10);
+  for (int i = 0; i < X_half.size(); ++i) {
+    EXPECT_EQ(X_half.data<float>()[i], expected_result);
+  }
+  // Only 3 entries are sent, the rest is held back in the residual.
+  auto& X_top_k = ws.GetBlob("X_top_k")->Get<TensorCPU>();
+  auto& residual = ws.GetBlob("residual")->Get<TensorCPU>();
+  EXPECT_EQ(X_top_k.size(), 10);
+  int num_sent = 0;
+  for (int i = 0; i < X_top_k.size(); ++i) {
+    const bool sent = X_top_k.data<float>()[i] != 0;
+    if (sent) {
+      num_sent++;
+      EXPECT_EQ(X_top_k.data<float>()[i], expected_result);
+    }
+    EXPECT_EQ(residual.data<float>()[i], sent ? 0 : rank);
+  }
+  if (size > 1) {
+    EXPECT_EQ(num_sent, 3);
+  }
+}
+
 }  // namespace caffe2
 
 
@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/observers/activation_range_observer.h"
+
+#include <algorithm>
+
+#include "caffe2/core/tensor.h"
+#include "caffe2/operators/int8_quantization.h"
+
+namespace caffe2 {
+
+ActivationRangeObserver::ActivationRangeObserver(NetBase* subject)
+    : ObserverBase<NetBase>(subject) {
+  for (auto* op : subject->GetOperators()) {
+    const auto* observer =
+        op->AttachObserver(caffe2::make_unique<OperatorObserver>(op));
+    CAFFE_ENFORCE(observer != nullptr);
+    operator_observers_.push_back(
+        dynamic_cast_if_rtti<const OperatorObserver*>(observer));
+  }
+}
+
+std::map<std::string, std::pair<float, float>>
+ActivationRangeObserver::ranges() const {
+  std::map<std::string, std::pair<float, float>> merged;
+  for (const auto* observer : operator_observers_) {
+    for (const auto& it : observer->ranges()) {
+      auto inserted = merged.insert(it);
+      if (!inserted.second) {
+        auto& range = inserted.first->second;
+        range.first = std::min(range.first, it.second.first);
+        range.second = std::max(range.second, it.second.second);
+      }
+    }
+  }
+  return merged;
+}
+
+bool ActivationRangeObserver::OperatorObserver::Start() {
+  const auto& def = subject_->debug_def();
+  const auto& inputs = subject_->Inputs();
+  for (int i = 0; i < inputs.size(); ++i) {
+    if (!inputs[i]->IsType<TensorCPU>()) {
+      continue;
+    }
+    const auto& tensor = inputs[i]->Get<TensorCPU>();
+    if (!tensor.IsType<float>() || tensor.size() == 0) {
+      continue;
+    }
+    float min, max;
+    FindMinMax(tensor.data<float>(), tensor.size(), &min, &max);
+    auto inserted = ranges_.emplace(def.input(i), std::make_pair(min, max));
+    if (!inserted.second) {
+      auto& range = inserted.first->second;
+      range.first = std::min(range.first, min);
+      range.second = std::max(range.second, max);
+    }
+  }
+  return true;
+}
+
+} // namespace caffe2
@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OBSERVERS_ACTIVATION_RANGE_OBSERVER_H_
+#define CAFFE2_OBSERVERS_ACTIVATION_RANGE_OBSERVER_H_
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+// Records the range of the float CPU tensors that the operators of a net read,
+// over all the runs it observes. This is the calibration step of the INT8
+// engine: the recorded range of the first input of a Conv or FC becomes its
+// in_min and in_max arguments, see python/int8_calibration.py.
+class ActivationRangeObserver final : public ObserverBase<NetBase> {
+ public:
+  explicit ActivationRangeObserver(NetBase* subject);
+
+  // Blob name to (min, max).
+  std::map<std::string, std::pair<float, float>> ranges() const;
+
+ private:
+  // Each operator keeps its own ranges so that operators running in parallel
+  // do not contend, they are only merged when the ranges are read.
+  class OperatorObserver final : public ObserverBase<OperatorBase> {
+   public:
+    explicit OperatorObserver(OperatorBase* subject)
+        : ObserverBase<OperatorBase>(subject) {}
+
+    // Inputs are read before the operator runs, in case it works in place.
+    bool Start() override;
+    bool Stop() override {
+      return true;
+    }
+
+    const std::map<std::string, std::pair<float, float>>& ranges() const {
+      return ranges_;
+    }
+
+   private:
+    std::map<std::string, std::pair<float, float>> ranges_;
+  };
+
+  vector<const OperatorObserver*> operator_observers_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OBSERVERS_ACTIVATION_RANGE_OBSERVER_H_
@@ -0,0 +1,219 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/observers/cpu_time_observer.h"
+
+#include <time.h>
+#include <chrono>
+
+#include "caffe2/core/flags.h"
+#include "caffe2/core/init.h"
+
+CAFFE2_DEFINE_int(
+    caffe2_cpu_time_sample_rate,
+    0,
+    "If positive, attaches a CpuTimeObserver accounting one run in this many "
+    "to every net.");
+
+namespace caffe2 {
+
+namespace {
+
+bool registerGlobalCpuTimeObserverCreator(
+    int* /*pargc*/,
+    char*** /*pargv*/) {
+  if (FLAGS_caffe2_cpu_time_sample_rate > 0) {
+    SetGlobalNetObserverCreator([](NetBase* subject) {
+      return caffe2::make_unique<CpuTimeObserver>(
+          subject, FLAGS_caffe2_cpu_time_sample_rate);
+    });
+  }
+  return true;
+}
+
+#ifdef CLOCK_THREAD_CPUTIME_ID
+int64_t ClockNanos(clockid_t clock) {
+  timespec ts;
+  if (clock_gettime(clock, &ts) != 0) {
+    return 0;
+  }
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+// Index of the calling thread among the threads that asked for one.
+int ThreadIndex() {
+  static std::atomic<int> num_threads{0};
+  thread_local int index = num_threads++;
+  return index;
+}
+
+} // namespace
+
+REGISTER_CAFFE2_INIT_FUNCTION(
+    registerGlobalCpuTimeObserverCreator,
+    &registerGlobalCpuTimeObserverCreator,
+    "Attaches a CpuTimeObserver to every net if "
+    "--caffe2_cpu_time_sample_rate is set");
+
+constexpr int CpuTimeObserver::kMaxThreads;
+
+int64_t MonotonicNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int64_t ThreadCpuNanos() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  return ClockNanos(CLOCK_THREAD_CPUTIME_ID);
+#else
+  return 0;
+#endif
+}
+
+int64_t ProcessCpuNanos() {
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+  return ClockNanos(CLOCK_PROCESS_CPUTIME_ID);
+#else
+  return 0;
+#endif
+}
+
+CpuTimeObserver::ThreadSlot::ThreadSlot(const std::string& prefix)
+    : busy_ns(StatRegistry::get().add(prefix + "busy_ns")),
+      cpu_ns(StatRegistry::get().add(prefix + "cpu_ns")),
+      idle_ns(StatRegistry::get().add(prefix + "idle_ns")) {}
+
+CpuTimeObserver::CpuTimeObserver(NetBase* subject, int sample_rate)
+    : ObserverBase<NetBase>(subject),
+      sample_rate_(sample_rate),
+      prefix_(subject->Name() + "/"),
+      net_runs_(StatRegistry::get().add(prefix_ + "runs")),
+      net_wall_ns_(StatRegistry::get().add(prefix_ + "wall_ns")),
+      net_cpu_ns_(StatRegistry::get().add(prefix_ + "process_cpu_ns")),
+      slots_(new std::array<std::atomic<ThreadSlot*>, kMaxThreads>()) {
+  CAFFE_ENFORCE_GT(sample_rate_, 0);
+  for (auto& slot : *slots_) {
+    slot.store(nullptr);
+  }
+  const auto& ops = subject->GetOperators();
+  for (int i = 0; i < ops.size(); ++i) {
+    const auto& def = ops[i]->debug_def();
+    const auto name =
+        def.name().empty() ? "op" + caffe2::to_string(i) : def.name();
+    CAFFE_ENFORCE(
+        ops[i]->AttachObserver(caffe2::make_unique<OperatorObserver>(
+            ops[i], prefix_ + def.type() + "/" + name + "/", this)) !=
+        nullptr);
+  }
+}
+
+CpuTimeObserver::ThreadSlot* CpuTimeObserver::CurrentThreadSlot() {
+  const int index = std::min(ThreadIndex(), kMaxThreads - 1);
+  auto& slot = (*slots_)[index];
+  auto* value = slot.load(std::memory_order_acquire);
+  if (!value) {
+    std::lock_guard<std::mutex> guard(slots_mutex_);
+    value = slot.load(std::memory_order_acquire);
+    if (!value) {
+      owned_slots_.emplace_back(new ThreadSlot(
+          prefix_ + "thread" + caffe2::to_string(index) + "/"));
+      value = owned_slots_.back().get();
+      slot.store(value, std::memory_order_release);
+    }
+  }
+  return value;
+}
+
+bool CpuTimeObserver::Start() {
+  const int64_t run = runs_++;
+  if (run % sample_rate_ != 0) {
+    sampled_run_ = -1;
+    return true;
+  }
+  ++sampled_runs_;
+  run_start_ns_ = MonotonicNanos();
+  run_start_cpu_ns_ = ProcessCpuNanos();
+  sampled_run_ = run;
+  return true;
+}
+
+bool CpuTimeObserver::Stop() {
+  const int64_t run = sampled_run_;
+  if (run < 0) {
+    return true;
+  }
+  const int64_t stop_ns = MonotonicNanos();
+  net_runs_->increment(1);
+  net_wall_ns_->increment(stop_ns - run_start_ns_);
+  net_cpu_ns_->increment(ProcessCpuNanos() - run_start_cpu_ns_);
+  // The threads are idle from their last operator to the end of the run.
+  std::lock_guard<std::mutex> guard(slots_mutex_);
+  for (const auto& slot : owned_slots_) {
+    if (slot->run == run) {
+      slot->idle_ns->increment(stop_ns - slot->last_stop_ns);
+    }
+  }
+  return true;
+}
+
+CpuTimeObserver::OperatorObserver::OperatorObserver(
+    OperatorBase* subject,
+    const std::string& prefix,
+    CpuTimeObserver* net_observer)
+    : ObserverBase<OperatorBase>(subject),
+      net_observer_(net_observer),
+      runs_(StatRegistry::get().add(prefix + "runs")),
+      wall_ns_(StatRegistry::get().add(prefix + "wall_ns")),
+      cpu_ns_(StatRegistry::get().add(prefix + "cpu_ns")) {}
+
+bool CpuTimeObserver::OperatorObserver::Start() {
+  const int64_t run = net_observer_->sampled_run_;
+  timing_ = run >= 0;
+  if (!timing_) {
+    return true;
+  }
+  start_ns_ = MonotonicNanos();
+  start_cpu_ns_ = ThreadCpuNanos();
+  auto* slot = net_observer_->CurrentThreadSlot();
+  const int64_t idle_since = slot->run == run
+      ? slot->last_stop_ns.load()
+      : net_observer_->run_start_ns_;
+  slot->idle_ns->increment(std::max<int64_t>(0, start_ns_ - idle_since));
+  return true;
+}
+
+bool CpuTimeObserver::OperatorObserver::Stop() {
+  if (!timing_) {
+    return true;
+  }
+  timing_ = false;
+  const int64_t stop_ns = MonotonicNanos();
+  const int64_t wall_ns = stop_ns - start_ns_;
+  const int64_t cpu_ns = ThreadCpuNanos() - start_cpu_ns_;
+  runs_->increment(1);
+  wall_ns_->increment(wall_ns);
+  cpu_ns_->increment(cpu_ns);
+  auto* slot = net_observer_->CurrentThreadSlot();
+  slot->busy_ns->increment(wall_ns);
+  slot->cpu_ns->increment(cpu_ns);
+  slot->last_stop_ns = stop_ns;
+  slot->run = net_observer_->sampled_run_.load();
+  return true;
+}
+
+} // namespace caffe2
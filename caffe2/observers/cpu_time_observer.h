@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OBSERVERS_CPU_TIME_OBSERVER_H_
+#define CAFFE2_OBSERVERS_CPU_TIME_OBSERVER_H_
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+
+namespace caffe2 {
+
+// Nanoseconds of the monotonic clock, and of CPU time of the calling thread
+// and of the process. The CPU times are 0 where the clocks are not
+// available.
+int64_t MonotonicNanos();
+int64_t ThreadCpuNanos();
+int64_t ProcessCpuNanos();
+
+// Accounts the wall and CPU time of the operators of a net, and the time the
+// threads that run them are busy or idle, in StatRegistry counters:
+//
+//   <net>/runs, <net>/wall_ns, <net>/process_cpu_ns
+//     The runs, their wall time and the CPU time of the whole process
+//     during them, so process_cpu_ns / wall_ns is the number of cores used.
+//   <net>/<op type>/<op name>/runs, wall_ns, cpu_ns
+//     Every operator, named as in LatencyHistogramObserver. cpu_ns is the
+//     CPU time of the thread the operator ran on, so wall_ns - cpu_ns is the
+//     time it waited: on locks, on I/O, on the workers of an intra-op thread
+//     pool, or preempted.
+//   <net>/thread<i>/busy_ns, cpu_ns, idle_ns
+//     Every thread that ran operators of the net, numbered in the order the
+//     threads of the process were first seen by any CpuTimeObserver. busy_ns
+//     is the time in operators, cpu_ns the CPU time in them, and idle_ns the
+//     time between the start of a run, or the end of the previous operator,
+//     and the start of an operator: for the workers of a DAGNet, the time
+//     waiting on the job queue. On a shared executor pool idle_ns includes
+//     the time spent running other nets.
+//
+// Only one run in sample_rate is accounted; the others cost a branch per
+// operator. An accounted operator reads the clocks four times, and updates
+// counters that belong to it or to its thread, so it never contends with
+// operators on other threads. Setting --caffe2_cpu_time_sample_rate
+// attaches the observer to every net created afterwards.
+class CpuTimeObserver final : public ObserverBase<NetBase> {
+ public:
+  explicit CpuTimeObserver(NetBase* subject, int sample_rate = 1);
+
+  bool Start() override;
+  bool Stop() override;
+
+  int64_t sampled_runs() const {
+    return sampled_runs_;
+  }
+
+  // Threads beyond this many share the counters of the last one.
+  static constexpr int kMaxThreads = 1024;
+
+ private:
+  // The counters of a thread, made the first time it runs an operator.
+  struct ThreadSlot {
+    explicit ThreadSlot(const std::string& prefix);
+
+    StatValue* busy_ns;
+    StatValue* cpu_ns;
+    StatValue* idle_ns;
+    // End of the last operator of the run numbered run, if the thread ran
+    // one in it.
+    std::atomic<int64_t> run{-1};
+    std::atomic<int64_t> last_stop_ns{0};
+  };
+
+  class OperatorObserver final : public ObserverBase<OperatorBase> {
+   public:
+    OperatorObserver(
+        OperatorBase* subject,
+        const std::string& prefix,
+        CpuTimeObserver* net_observer);
+
+    bool Start() override;
+    bool Stop() override;
+
+   private:
+    CpuTimeObserver* net_observer_;
+    StatValue* runs_;
+    StatValue* wall_ns_;
+    StatValue* cpu_ns_;
+    bool timing_ = false;
+    int64_t start_ns_ = 0;
+    int64_t start_cpu_ns_ = 0;
+  };
+
+  ThreadSlot* CurrentThreadSlot();
+
+  const int sample_rate_;
+  const std::string prefix_;
+  int64_t runs_ = 0;
+  int64_t sampled_runs_ = 0;
+  // Number of the current run if it is accounted, -1 otherwise.
+  std::atomic<int64_t> sampled_run_{-1};
+  int64_t run_start_ns_ = 0;
+  int64_t run_start_cpu_ns_ = 0;
+  StatValue* net_runs_;
+  StatValue* net_wall_ns_;
+  StatValue* net_cpu_ns_;
+  std::unique_ptr<std::array<std::atomic<ThreadSlot*>, kMaxThreads>> slots_;
+  std::vector<std::unique_ptr<ThreadSlot>> owned_slots_;
+  std::mutex slots_mutex_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OBSERVERS_CPU_TIME_OBSERVER_H_
@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/observers/cpu_time_observer.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+namespace caffe2 {
+
+namespace {
+
+// Sleeps for ms milliseconds, then spins for spin_ms.
+class CpuTimeTestOp final : public Operator<CPUContext> {
+ public:
+  CpuTimeTestOp(const OperatorDef& def, Workspace* ws)
+      : Operator<CPUContext>(def, ws),
+        ms_(OperatorBase::GetSingleArgument<int>("ms", 0)),
+        spin_ms_(OperatorBase::GetSingleArgument<int>("spin_ms", 0)) {}
+
+  bool RunOnDevice() override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms_));
+    const auto end = MonotonicNanos() + spin_ms_ * 1000000LL;
+    while (MonotonicNanos() < end) {
+    }
+    return true;
+  }
+
+ private:
+  int ms_;
+  int spin_ms_;
+};
+
+REGISTER_CPU_OPERATOR(CpuTimeTest, CpuTimeTestOp);
+OPERATOR_SCHEMA(CpuTimeTest).NumInputs(0, INT_MAX).NumOutputs(0, INT_MAX);
+
+} // namespace
+
+TEST(CpuTimeObserverTest, OperatorAndThreadTimes) {
+  if (ThreadCpuNanos() == 0) {
+    return;
+  }
+  NetDef net_def;
+  net_def.set_name("cpu_time_test");
+  net_def.set_type("dag");
+  net_def.set_num_workers(2);
+  // Two independent operators, then one that depends on both.
+  for (const auto& name : {"a", "b", "c"}) {
+    auto* op = net_def.add_op();
+    op->set_type("CpuTimeTest");
+    op->set_name(name);
+    op->add_arg()->CopyFrom(MakeArgument("ms", 10));
+    op->add_arg()->CopyFrom(MakeArgument("spin_ms", 10));
+    if (std::string(name) == "c") {
+      op->add_input("a_out");
+      op->add_input("b_out");
+    } else {
+      op->add_output(std::string(name) + "_out");
+    }
+  }
+  Workspace ws;
+  auto net = CreateNet(net_def, &ws);
+  const auto* ob = dynamic_cast_if_rtti<const CpuTimeObserver*>(
+      net->AttachObserver(caffe2::make_unique<CpuTimeObserver>(net.get(), 2)));
+  ASSERT_TRUE(ob != nullptr);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(net->Run());
+  }
+  EXPECT_EQ(ob->sampled_runs(), 2);
+
+  auto stats = toMap(StatRegistry::get().publish());
+  const int64_t kMs = 1000000;
+  EXPECT_EQ(stats["cpu_time_test/runs"], 2);
+  EXPECT_GE(stats["cpu_time_test/wall_ns"], 2 * 40 * kMs);
+  for (const auto& name : {"a", "b", "c"}) {
+    const auto prefix = std::string("cpu_time_test/CpuTimeTest/") + name;
+    EXPECT_EQ(stats[prefix + "/runs"], 2);
+    // The time asleep is not CPU time. The time spinning is, as long as the
+    // thread is not preempted.
+    EXPECT_GE(stats[prefix + "/wall_ns"], 2 * 20 * kMs);
+    EXPECT_GT(stats[prefix + "/cpu_ns"], 0);
+    EXPECT_LE(
+        stats[prefix + "/cpu_ns"], stats[prefix + "/wall_ns"] - 2 * 10 * kMs);
+  }
+  // Every sampled run keeps the workers busy for three operators, and the
+  // busy and idle times of each worker add up to the wall time of the runs.
+  int64_t busy = 0;
+  int threads = 0;
+  for (const auto& it : stats) {
+    const auto& key = it.first;
+    if (key.find("cpu_time_test/thread") != 0 ||
+        key.find("/busy_ns") == std::string::npos) {
+      continue;
+    }
+    const auto thread = key.substr(0, key.size() - strlen("busy_ns"));
+    busy += it.second;
+    ++threads;
+    EXPECT_LE(
+        it.second + stats[thread + "idle_ns"], stats["cpu_time_test/wall_ns"]);
+    EXPECT_GE(
+        it.second + stats[thread + "idle_ns"],
+        stats["cpu_time_test/wall_ns"] / 2);
+  }
+  EXPECT_GE(threads, 1);
+  EXPECT_LE(threads, 2);
+  EXPECT_GE(busy, 2 * 3 * 20 * kMs);
+}
+
+} // namespace caffe2
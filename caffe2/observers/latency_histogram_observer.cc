@@ -0,0 +1,214 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/observers/latency_histogram_observer.h"
+
+#include "caffe2/core/flags.h"
+#include "caffe2/core/init.h"
+
+CAFFE2_DEFINE_int(
+    caffe2_latency_histogram_sample_rate,
+    0,
+    "If positive, attaches a LatencyHistogramObserver timing one run in "
+    "this many to every net.");
+
+namespace caffe2 {
+
+namespace {
+
+const char kLatencyKey[] = "latency_us/";
+
+bool registerGlobalLatencyHistogramObserverCreator(
+    int* /*pargc*/,
+    char*** /*pargv*/) {
+  if (FLAGS_caffe2_latency_histogram_sample_rate > 0) {
+    SetGlobalNetObserverCreator([](NetBase* subject) {
+      return caffe2::make_unique<LatencyHistogramObserver>(
+          subject, FLAGS_caffe2_latency_histogram_sample_rate);
+    });
+  }
+  return true;
+}
+
+} // namespace
+
+REGISTER_CAFFE2_INIT_FUNCTION(
+    registerGlobalLatencyHistogramObserverCreator,
+    &registerGlobalLatencyHistogramObserverCreator,
+    "Attaches a LatencyHistogramObserver to every net if "
+    "--caffe2_latency_histogram_sample_rate is set");
+
+constexpr int LatencyHistogram::kSubBucketBits;
+constexpr int LatencyHistogram::kSubBuckets;
+constexpr int LatencyHistogram::kNumBuckets;
+
+LatencyHistogram::LatencyHistogram(const std::string& prefix)
+    : prefix_(prefix + kLatencyKey) {
+  for (auto& bucket : buckets_) {
+    bucket.store(nullptr);
+  }
+}
+
+void LatencyHistogram::Add(uint64_t micros) {
+  auto& bucket = buckets_[BucketIndex(micros)];
+  auto* value = bucket.load(std::memory_order_acquire);
+  if (!value) {
+    // Concurrent registrations of the same name get the same counter.
+    value = StatRegistry::get().add(
+        prefix_ + caffe2::to_string(BucketLowerBound(&bucket - &buckets_[0])));
+    bucket.store(value, std::memory_order_release);
+  }
+  value->increment(1);
+}
+
+std::array<int64_t, LatencyHistogram::kNumBuckets> LatencyHistogram::counts()
+    const {
+  std::array<int64_t, kNumBuckets> counts;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    const auto* value = buckets_[i].load(std::memory_order_acquire);
+    counts[i] = value ? value->get() : 0;
+  }
+  return counts;
+}
+
+int LatencyHistogram::BucketIndex(uint64_t micros) {
+  if (micros < kSubBuckets) {
+    return micros;
+  }
+  int exponent = kSubBucketBits;
+  while (micros >> (exponent + 1)) {
+    ++exponent;
+  }
+  const int index = (exponent - kSubBucketBits + 1) * kSubBuckets +
+      ((micros >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+  return std::min(index, kNumBuckets - 1);
+}
+
+uint64_t LatencyHistogram::BucketLowerBound(int index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  const int group = index / kSubBuckets;
+  return static_cast<uint64_t>(kSubBuckets + index % kSubBuckets)
+      << (group - 1);
+}
+
+double LatencyHistogram::Percentile(
+    const std::array<int64_t, kNumBuckets>& counts,
+    double p) {
+  int64_t total = 0;
+  for (auto count : counts) {
+    total += count;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const double rank = p * total;
+  int64_t below = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    if (counts[i] && below + counts[i] >= rank) {
+      const double width = i + 1 < kNumBuckets
+          ? BucketLowerBound(i + 1) - BucketLowerBound(i)
+          : 1;
+      return BucketLowerBound(i) + width * (rank - below) / counts[i];
+    }
+    below += counts[i];
+  }
+  return BucketLowerBound(kNumBuckets - 1);
+}
+
+double LatencyHistogram::Percentile(
+    const ExportedStatMap& stats,
+    const std::string& prefix,
+    double p) {
+  std::array<int64_t, kNumBuckets> counts{};
+  const std::string key = std::string("/") + kLatencyKey;
+  for (const auto& it : stats) {
+    const auto& name = it.first;
+    if (name.compare(0, prefix.size(), prefix) != 0) {
+      continue;
+    }
+    const auto pos = name.rfind(key);
+    if (pos == std::string::npos || pos + 1 < prefix.size()) {
+      continue;
+    }
+    const auto bound = std::stoull(name.substr(pos + key.size()));
+    counts[BucketIndex(bound)] += it.second;
+  }
+  return Percentile(counts, p);
+}
+
+LatencyHistogramObserver::LatencyHistogramObserver(
+    NetBase* subject,
+    int sample_rate)
+    : ObserverBase<NetBase>(subject), sample_rate_(sample_rate) {
+  CAFFE_ENFORCE_GT(sample_rate_, 0);
+  const auto& ops = subject->GetOperators();
+  for (int i = 0; i < ops.size(); ++i) {
+    const auto& def = ops[i]->debug_def();
+    const auto name =
+        def.name().empty() ? "op" + caffe2::to_string(i) : def.name();
+    const auto* observer =
+        ops[i]->AttachObserver(caffe2::make_unique<OperatorObserver>(
+            ops[i],
+            subject->Name() + "/" + def.type() + "/" + name + "/",
+            &sampled_));
+    CAFFE_ENFORCE(observer != nullptr);
+    operator_observers_.emplace(
+        def.type(), dynamic_cast_if_rtti<const OperatorObserver*>(observer));
+  }
+}
+
+bool LatencyHistogramObserver::Start() {
+  sampled_ = runs_++ % sample_rate_ == 0;
+  if (sampled_) {
+    ++sampled_runs_;
+  }
+  return true;
+}
+
+double LatencyHistogramObserver::percentile(
+    const std::string& op_type,
+    double p) const {
+  std::array<int64_t, LatencyHistogram::kNumBuckets> counts{};
+  const auto range = operator_observers_.equal_range(op_type);
+  for (auto it = range.first; it != range.second; ++it) {
+    const auto op_counts = it->second->histogram().counts();
+    for (int i = 0; i < counts.size(); ++i) {
+      counts[i] += op_counts[i];
+    }
+  }
+  return LatencyHistogram::Percentile(counts, p);
+}
+
+bool LatencyHistogramObserver::OperatorObserver::Start() {
+  timing_ = *sampled_;
+  if (timing_) {
+    timer_.Start();
+  }
+  return true;
+}
+
+bool LatencyHistogramObserver::OperatorObserver::Stop() {
+  if (timing_) {
+    histogram_.Add(static_cast<uint64_t>(timer_.MicroSeconds()));
+    timing_ = false;
+  }
+  return true;
+}
+
+} // namespace caffe2
@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_OBSERVERS_LATENCY_HISTOGRAM_OBSERVER_H_
+#define CAFFE2_OBSERVERS_LATENCY_HISTOGRAM_OBSERVER_H_
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <string>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/core/timer.h"
+
+namespace caffe2 {
+
+// A log-linear histogram of microsecond latencies kept in StatRegistry
+// counters: every power of two is split in kSubBuckets linear buckets, so the
+// relative error of a percentile is at most 1 / kSubBuckets. Bucket i is
+// exported as "<prefix>latency_us/<lower bound of bucket i>" and is only
+// registered the first time a value falls into it. Add() does not lock, so
+// the histogram can be published at any time while it is being filled.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 2;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  // Covers latencies up to 2^32 us, larger ones go to the last bucket.
+  static constexpr int kNumBuckets = kSubBuckets * 31;
+
+  explicit LatencyHistogram(const std::string& prefix);
+
+  void Add(uint64_t micros);
+  std::array<int64_t, kNumBuckets> counts() const;
+
+  static int BucketIndex(uint64_t micros);
+  static uint64_t BucketLowerBound(int index);
+  // Returns the latency below which the fraction p of the counted values
+  // fall, interpolated within its bucket, or 0 if nothing was counted.
+  static double Percentile(
+      const std::array<int64_t, kNumBuckets>& counts,
+      double p);
+  // Same, over the counters of all the histograms exported under prefix.
+  static double Percentile(
+      const ExportedStatMap& stats,
+      const std::string& prefix,
+      double p);
+
+ private:
+  std::string prefix_;
+  std::array<std::atomic<StatValue*>, kNumBuckets> buckets_;
+};
+
+// Records the latency of every operator of a net in one LatencyHistogram per
+// operator, exported as "<net>/<op type>/<op name>/latency_us/...", where the
+// name is the name of the OperatorDef or "op<index>" if it has none. Only one
+// run in sample_rate is timed, the others cost a branch per operator.
+//
+// Each operator writes to its own histogram, so operators that run in
+// parallel never contend; histograms of the same type are merged when read.
+// Setting --caffe2_latency_histogram_sample_rate attaches the observer to
+// every net created afterwards.
+class LatencyHistogramObserver final : public ObserverBase<NetBase> {
+ public:
+  explicit LatencyHistogramObserver(NetBase* subject, int sample_rate = 1);
+
+  bool Start() override;
+  bool Stop() override {
+    return true;
+  }
+
+  // Percentile of the latencies of the operators of the given type, in
+  // microseconds, since the counters were last reset.
+  double percentile(const std::string& op_type, double p) const;
+  int64_t sampled_runs() const {
+    return sampled_runs_;
+  }
+
+ private:
+  class OperatorObserver final : public ObserverBase<OperatorBase> {
+   public:
+    OperatorObserver(
+        OperatorBase* subject,
+        const std::string& prefix,
+        const bool* sampled)
+        : ObserverBase<OperatorBase>(subject),
+          histogram_(prefix),
+          sampled_(sampled) {}
+
+    bool Start() override;
+    bool Stop() override;
+
+    const LatencyHistogram& histogram() const {
+      return histogram_;
+    }
+
+   private:
+    LatencyHistogram histogram_;
+    const bool* sampled_;
+    bool timing_ = false;
+    Timer timer_;
+  };
+
+  const int sample_rate_;
+  int64_t runs_ = 0;
+  int64_t sampled_runs_ = 0;
+  bool sampled_ = false;
+  std::multimap<std::string, const OperatorObserver*> operator_observers_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OBSERVERS_LATENCY_HISTOGRAM_OBSERVER_H_
@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/observers/latency_histogram_observer.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+namespace caffe2 {
+
+namespace {
+
+class LatencyHistogramTestSleepOp final : public Operator<CPUContext> {
+ public:
+  LatencyHistogramTestSleepOp(const OperatorDef& def, Workspace* ws)
+      : Operator<CPUContext>(def, ws),
+        ms_(OperatorBase::GetSingleArgument<int>("ms", 0)) {}
+
+  bool RunOnDevice() override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms_));
+    return true;
+  }
+
+ private:
+  int ms_;
+};
+
+REGISTER_CPU_OPERATOR(LatencyHistogramTestSleep, LatencyHistogramTestSleepOp);
+OPERATOR_SCHEMA(LatencyHistogramTestSleep)
+    .NumInputs(0, INT_MAX)
+    .NumOutputs(0, INT_MAX);
+
+} // namespace
+
+TEST(LatencyHistogramTest, Buckets) {
+  for (uint64_t v = 0; v < (1 << 16); ++v) {
+    const int i = LatencyHistogram::BucketIndex(v);
+    EXPECT_LE(LatencyHistogram::BucketLowerBound(i), v);
+    EXPECT_GT(LatencyHistogram::BucketLowerBound(i + 1), v);
+  }
+  EXPECT_EQ(
+      LatencyHistogram::BucketIndex(uint64_t(1) << 40),
+      LatencyHistogram::kNumBuckets - 1);
+
+  std::array<int64_t, LatencyHistogram::kNumBuckets> counts{};
+  counts[LatencyHistogram::BucketIndex(100)] = 99;
+  counts[LatencyHistogram::BucketIndex(10000)] = 1;
+  EXPECT_NEAR(LatencyHistogram::Percentile(counts, 0.5), 100, 25);
+  EXPECT_NEAR(LatencyHistogram::Percentile(counts, 1.0), 10000, 2500);
+}
+
+TEST(LatencyHistogramObserverTest, SampledPercentiles) {
+  NetDef net_def;
+  net_def.set_name("latency_histogram_test");
+  for (int ms : {1, 20}) {
+    auto* op = net_def.add_op();
+    op->set_type("LatencyHistogramTestSleep");
+    op->set_name("sleep" + caffe2::to_string(ms));
+    op->add_arg()->CopyFrom(MakeArgument("ms", ms));
+  }
+  Workspace ws;
+  auto net = CreateNet(net_def, &ws);
+  const auto* ob = dynamic_cast_if_rtti<const LatencyHistogramObserver*>(
+      net->AttachObserver(
+          caffe2::make_unique<LatencyHistogramObserver>(net.get(), 2)));
+  ASSERT_TRUE(ob != nullptr);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(net->Run());
+  }
+  EXPECT_EQ(ob->sampled_runs(), 2);
+  // The type merges the instances: half of the samples are ~1ms, half ~20ms.
+  // Percentiles are only accurate to a bucket, which is within 25%.
+  EXPECT_GE(ob->percentile("LatencyHistogramTestSleep", 0.25), 750);
+  EXPECT_LT(ob->percentile("LatencyHistogramTestSleep", 0.25), 15000);
+  EXPECT_GE(ob->percentile("LatencyHistogramTestSleep", 1.0), 20000);
+
+  const auto stats = toMap(StatRegistry::get().publish());
+  EXPECT_GE(
+      LatencyHistogram::Percentile(
+          stats, "latency_histogram_test/LatencyHistogramTestSleep/sleep20/",
+          0.5),
+      15000);
+  int64_t count = 0;
+  for (const auto& it : stats) {
+    if (it.first.find("latency_histogram_test/") == 0) {
+      count += it.second;
+    }
+  }
+  EXPECT_EQ(count, 4);
+}
+
+} // namespace caffe2
@@ -35,8 +35,69 @@ bool TimeObserverBase<NetBase>::Stop() {
   return true;
 }
 
+namespace {
+
+// Appends the number of inputs of op and the type and dimensions of each of
+// them to key, which is much cheaper than building the TensorShapes the cost
+// is inferred from.
+void AppendInputShapes(const OperatorBase& op, vector<TIndex>* key) {
+  key->push_back(op.Inputs().size());
+  for (const Blob* blob : op.Inputs()) {
+    if (blob->IsType<TensorCPU>()) {
+      const auto& tensor = blob->Get<TensorCPU>();
+      key->push_back(tensor.meta().id());
+      key->push_back(tensor.ndim());
+      key->insert(key->end(), tensor.dims().begin(), tensor.dims().end());
+      continue;
+    }
+    key->push_back(blob->meta().id());
+    TypeCall type_fun = GetTypeCallFunction(blob->meta().id());
+    if (type_fun) {
+      key->push_back(type_fun(blob->GetRaw()).id());
+    }
+    TensorInfoCall tensor_info_fun = GetTensorInfoFunction(blob->meta().id());
+    if (tensor_info_fun) {
+      bool shares_data;
+      size_t capacity;
+      DeviceOption device;
+      const auto dims =
+          tensor_info_fun(blob->GetRaw(), &shares_data, &capacity, &device);
+      key->push_back(dims.size());
+      key->insert(key->end(), dims.begin(), dims.end());
+    }
+  }
+}
+
+} // namespace
+
 template <>
 bool TimeObserverBase<OperatorBase>::Start() {
+  if (!schema_resolved_) {
+    const auto* schema = OpSchemaRegistry::Schema(subject_->debug_def().type());
+    if (schema && schema->HasCostInferenceFunction()) {
+      schema_ = schema;
+    }
+    schema_resolved_ = true;
+  }
+  if (schema_) {
+    vector<TIndex> inputs;
+    AppendInputShapes(*subject_, &inputs);
+    if (inputs != cost_inputs_) {
+      cost_inputs_ = std::move(inputs);
+      cost_flops_ = 0;
+      cost_bytes_ = 0;
+      try {
+        const auto cost = schema_->InferCost(
+            subject_->debug_def(), subject_->InputTensorShapes());
+        cost_flops_ = cost.flops;
+        cost_bytes_ = cost.bytes_read + cost.bytes_written;
+      } catch (const std::exception& e) {
+        VLOG(1) << "Cannot infer the cost of the operator: " << e.what();
+      }
+    }
+    total_flops_ += cost_flops_;
+    total_bytes_ += cost_bytes_;
+  }
   start_time_ = timer_.MilliSeconds();
   ++iterations_;
   return true;
@@ -47,7 +108,8 @@ bool TimeObserverBase<OperatorBase>::Stop() {
   double current_run = timer_.MilliSeconds() - start_time_;
   total_time_ += current_run;
   VLOG(1) << "This operator iteration took " << current_run
-          << " ms to complete.\n";
+          << " ms to complete, averaging " << average_gflops()
+          << " GFLOP/s and " << average_gbps() << " GB/s.\n";
   return true;
 }
 
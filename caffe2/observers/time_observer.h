@@ -34,6 +34,14 @@ class TimeObserverBase : public ObserverBase<T> {
   inline float average_time() const {
     return total_time_ / iterations_;
   }
+  // Achieved throughput, from the cost the OpSchema of an operator infers
+  // for its inputs. 0 for nets and for operators without cost inference.
+  inline float average_gflops() const {
+    return total_time_ > 0 ? 1e-6f * total_flops_ / total_time_ : 0.0f;
+  }
+  inline float average_gbps() const {
+    return total_time_ > 0 ? 1e-6f * total_bytes_ / total_time_ : 0.0f;
+  }
   ~TimeObserverBase() {}
 
   bool Start() override;
@@ -44,6 +52,15 @@ class TimeObserverBase : public ObserverBase<T> {
   float start_time_ = 0.0f;
   float total_time_ = 0.0f;
   int iterations_ = 0;
+  uint64_t total_flops_ = 0;
+  uint64_t total_bytes_ = 0;
+  // The cost of an operator run, inferred again only when the types or
+  // shapes of its inputs, summarized in cost_inputs_, change.
+  const OpSchema* schema_ = nullptr;
+  bool schema_resolved_ = false;
+  vector<TIndex> cost_inputs_;
+  uint64_t cost_flops_ = 0;
+  uint64_t cost_bytes_ = 0;
 };
 
 template <class T>
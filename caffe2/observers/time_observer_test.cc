@@ -48,6 +48,35 @@ OPERATOR_SCHEMA(SleepOp)
     .NumOutputs(0, INT_MAX)
     .AllowInplace({{0, 0}, {1, 1}});
 
+// Counts the inferences of its cost, which is one flop per input element.
+int cost_inferences = 0;
+
+class TimeObserverTestCostOp final : public OperatorBase {
+ public:
+  using OperatorBase::OperatorBase;
+  bool Run(int /* unused */) override {
+    StartAllObservers();
+    StopAllObservers();
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(TimeObserverTestCost, TimeObserverTestCostOp);
+
+OPERATOR_SCHEMA(TimeObserverTestCost)
+    .NumInputs(1)
+    .NumOutputs(0)
+    .CostInferenceFunction(
+        [](const OperatorDef& /* unused */, const vector<TensorShape>& in) {
+          ++cost_inferences;
+          OpSchema::Cost cost;
+          cost.flops = 1;
+          for (const auto d : in[0].dims()) {
+            cost.flops *= d;
+          }
+          return cost;
+        });
+
 unique_ptr<NetBase> CreateNetTestHelper(Workspace* ws) {
   NetDef net_def;
   {
@@ -87,4 +116,32 @@ TEST(TimeObserverTest, Test3Seconds) {
   CAFFE_ENFORCE(ob->average_time() > 6000);
   CAFFE_ENFORCE(ob->average_time() < 6500);
 }
+
+TEST(TimeObserverTest, InfersCostWhenInputShapesChange) {
+  Workspace ws;
+  auto* input = ws.CreateBlob("in")->GetMutable<TensorCPU>();
+  input->Resize(2, 3);
+  input->mutable_data<float>();
+  OperatorDef def;
+  def.set_type("TimeObserverTestCost");
+  def.add_input("in");
+  auto op = CreateOperator(def, &ws);
+  const auto* ob = dynamic_cast_if_rtti<const TimeObserver<OperatorBase>*>(
+      op->AttachObserver(make_unique<TimeObserver<OperatorBase>>(op.get())));
+  CAFFE_ENFORCE(ob);
+  cost_inferences = 0;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(op->Run());
+  }
+  EXPECT_EQ(cost_inferences, 1);
+  input->Resize(4, 3);
+  input->mutable_data<float>();
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(op->Run());
+  }
+  EXPECT_EQ(cost_inferences, 2);
+  input->mutable_data<int>();
+  EXPECT_TRUE(op->Run());
+  EXPECT_EQ(cost_inferences, 3);
+}
 }
@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/observers/tracing_observer.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace caffe2 {
+
+namespace {
+
+std::string JsonEscape(const std::string& str) {
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+} // namespace
+
+TracingObserver::TracingObserver(
+    NetBase* subject,
+    size_t capacity,
+    float slow_run_ms,
+    const std::string& dump_dir)
+    : ObserverBase<NetBase>(subject),
+      origin_(std::chrono::steady_clock::now()),
+      capacity_(capacity),
+      slow_run_ms_(slow_run_ms),
+      dump_dir_(dump_dir) {
+  CAFFE_ENFORCE_GT(capacity_, 0);
+  ring_.reserve(capacity_);
+  const auto& ops = subject->GetOperators();
+  for (int i = 0; i < ops.size(); ++i) {
+    const auto& def = ops[i]->debug_def();
+    op_names_.push_back(
+        def.name().empty() ? def.type() + "_" + caffe2::to_string(i)
+                           : def.name());
+    op_types_.push_back(def.type());
+    const auto* observer = ops[i]->AttachObserver(
+        caffe2::make_unique<OperatorObserver>(ops[i], this, i));
+    CAFFE_ENFORCE(observer != nullptr);
+  }
+}
+
+int64_t TracingObserver::NowMicros() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - origin_)
+      .count();
+}
+
+void TracingObserver::Add(const TraceEvent& event) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (ring_.size() < capacity_) {
+    ring_.push_back(event);
+  } else {
+    ring_[next_ % capacity_] = event;
+  }
+  ++next_;
+}
+
+bool TracingObserver::Start() {
+  run_start_us_ = NowMicros();
+  return true;
+}
+
+bool TracingObserver::Stop() {
+  TraceEvent event;
+  event.op_idx = -1;
+  event.thread = std::this_thread::get_id();
+  event.stream_id = 0;
+  event.num_event_waits = 0;
+  event.start_us = run_start_us_;
+  event.duration_us = NowMicros() - run_start_us_;
+  Add(event);
+  ++runs_;
+  if (slow_run_ms_ > 0 && event.duration_us > slow_run_ms_ * 1000) {
+    ++slow_runs_;
+    const auto path = dump_dir_ + "/" + subject_->Name() + "_" +
+        caffe2::to_string(runs_) + ".json";
+    LOG(WARNING) << "Run " << runs_ << " of net " << subject_->Name()
+                 << " took " << event.duration_us / 1000.0
+                 << " ms, dumping its trace to " << path;
+    DumpTrace(path);
+  }
+  return true;
+}
+
+std::vector<TracingObserver::TraceEvent> TracingObserver::events() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (next_ <= capacity_) {
+    return ring_;
+  }
+  std::vector<TraceEvent> events;
+  events.reserve(capacity_);
+  for (size_t i = 0; i < capacity_; ++i) {
+    events.push_back(ring_[(next_ + i) % capacity_]);
+  }
+  return events;
+}
+
+std::string TracingObserver::TraceJson() const {
+  // Chrome wants small integer thread ids.
+  std::map<std::thread::id, int> tids;
+  std::ostringstream json;
+  json << "{\"traceEvents\":[";
+  bool first = true;
+  for (const auto& event : events()) {
+    const int tid = tids.emplace(event.thread, tids.size()).first->second;
+    const bool is_net = event.op_idx < 0;
+    json << (first ? "" : ",") << "\n{\"name\":\""
+         << JsonEscape(is_net ? subject_->Name() : op_names_[event.op_idx])
+         << "\",\"cat\":\""
+         << JsonEscape(is_net ? "net" : op_types_[event.op_idx])
+         << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+         << ",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us;
+    if (!is_net) {
+      json << ",\"args\":{\"op_idx\":" << event.op_idx
+           << ",\"stream\":" << event.stream_id
+           << ",\"event_waits\":" << event.num_event_waits << "}";
+    }
+    json << "}";
+    first = false;
+  }
+  json << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return json.str();
+}
+
+void TracingObserver::DumpTrace(const std::string& path) const {
+  std::ofstream file(path);
+  CAFFE_ENFORCE(file.good(), "Cannot open ", path);
+  file << TraceJson();
+}
+
+bool TracingObserver::OperatorObserver::Start() {
+  start_us_ = tracer_->NowMicros();
+  return true;
+}
+
+bool TracingObserver::OperatorObserver::Stop() {
+  TraceEvent event;
+  event.op_idx = idx_;
+  event.thread = std::this_thread::get_id();
+  event.stream_id = subject_->stream_id();
+  event.num_event_waits = subject_->num_event_waits();
+  event.start_us = start_us_;
+  event.duration_us = tracer_->NowMicros() - start_us_;
+  tracer_->Add(event);
+  return true;
+}
+
+} // namespace caffe2
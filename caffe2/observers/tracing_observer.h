@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_OBSERVERS_TRACING_OBSERVER_H_
+#define CAFFE2_OBSERVERS_TRACING_OBSERVER_H_
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+// Records a timeline of the runs of a net, whatever its executor, and dumps
+// it in the Chrome trace event format (chrome://tracing, Perfetto).
+//
+// Every run of the net and of each of its operators becomes one event with
+// its start, duration and worker thread, plus the stream the operator was
+// issued on and the number of events it waited on first. Events go into a
+// ring buffer that keeps the last `capacity` of them. The trace can be
+// dumped at any time with TraceJson() or DumpTrace(), and is dumped
+// automatically to "<dump_dir>/<net>_<run>.json" after every run slower than
+// slow_run_ms if that is positive, to catch scheduling stalls as they happen.
+//
+// For asynchronous executors the operator events cover the time it took to
+// issue the operator, not its execution on the device.
+class TracingObserver final : public ObserverBase<NetBase> {
+ public:
+  struct TraceEvent {
+    // Operator index, or -1 for the net itself.
+    int op_idx;
+    std::thread::id thread;
+    int stream_id;
+    int num_event_waits;
+    // Microseconds since the observer was created.
+    int64_t start_us;
+    int64_t duration_us;
+  };
+
+  explicit TracingObserver(
+      NetBase* subject,
+      size_t capacity = 1 << 16,
+      float slow_run_ms = 0,
+      const std::string& dump_dir = ".");
+
+  bool Start() override;
+  bool Stop() override;
+
+  // The recorded events, oldest first.
+  std::vector<TraceEvent> events() const;
+  std::string TraceJson() const;
+  void DumpTrace(const std::string& path) const;
+
+  int64_t slow_runs() const {
+    return slow_runs_;
+  }
+
+ private:
+  class OperatorObserver final : public ObserverBase<OperatorBase> {
+   public:
+    OperatorObserver(OperatorBase* subject, TracingObserver* tracer, int idx)
+        : ObserverBase<OperatorBase>(subject), tracer_(tracer), idx_(idx) {}
+
+    bool Start() override;
+    bool Stop() override;
+
+   private:
+    TracingObserver* tracer_;
+    const int idx_;
+    int64_t start_us_ = 0;
+  };
+
+  int64_t NowMicros() const;
+  void Add(const TraceEvent& event);
+
+  const std::chrono::steady_clock::time_point origin_;
+  const size_t capacity_;
+  const float slow_run_ms_;
+  const std::string dump_dir_;
+  std::vector<std::string> op_names_;
+  std::vector<std::string> op_types_;
+
+  mutable std::mutex mutex_;
+  std::vector<TraceEvent> ring_;
+  // Total number of events added, the next one goes to next_ % capacity_.
+  size_t next_ = 0;
+
+  int64_t runs_ = 0;
+  int64_t slow_runs_ = 0;
+  int64_t run_start_us_ = 0;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OBSERVERS_TRACING_OBSERVER_H_
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/observers/tracing_observer.h"
+
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+class TracingTestOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+  bool RunOnDevice() override {
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(TracingTest, TracingTestOp);
+OPERATOR_SCHEMA(TracingTest).NumInputs(0, INT_MAX).NumOutputs(0, INT_MAX);
+
+std::unique_ptr<NetBase> CreateTracingTestNet(
+    Workspace* ws,
+    const std::string& type) {
+  NetDef net_def;
+  net_def.set_name("tracing_test");
+  net_def.set_type(type);
+  net_def.set_num_workers(2);
+  auto* op = net_def.add_op();
+  op->set_type("TracingTest");
+  op->set_name("first");
+  op->add_output("a");
+  op = net_def.add_op();
+  op->set_type("TracingTest");
+  op->add_input("a");
+  op->add_output("b");
+  return CreateNet(net_def, ws);
+}
+
+} // namespace
+
+TEST(TracingObserverTest, RecordsAllExecutors) {
+  for (const auto& type : {"simple", "dag", "async_simple"}) {
+    Workspace ws;
+    auto net = CreateTracingTestNet(&ws, type);
+    const auto* ob = dynamic_cast_if_rtti<const TracingObserver*>(
+        net->AttachObserver(caffe2::make_unique<TracingObserver>(net.get())));
+    ASSERT_TRUE(ob != nullptr);
+    EXPECT_TRUE(net->Run());
+    EXPECT_TRUE(net->Run());
+
+    const auto events = ob->events();
+    // Two operators and the net itself per run.
+    ASSERT_EQ(events.size(), 6) << type;
+    EXPECT_EQ(events[0].op_idx, 0);
+    EXPECT_EQ(events[1].op_idx, 1);
+    EXPECT_EQ(events[2].op_idx, -1);
+    EXPECT_LE(events[2].start_us, events[0].start_us);
+
+    const auto json = ob->TraceJson();
+    EXPECT_NE(json.find("\"name\":\"first\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"TracingTest_1\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"tracing_test\""), std::string::npos);
+  }
+}
+
+TEST(TracingObserverTest, KeepsTheLastEvents) {
+  Workspace ws;
+  auto net = CreateTracingTestNet(&ws, "simple");
+  const auto* ob = dynamic_cast_if_rtti<const TracingObserver*>(
+      net->AttachObserver(
+          caffe2::make_unique<TracingObserver>(net.get(), 4)));
+  ASSERT_TRUE(ob != nullptr);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(net->Run());
+  }
+  const auto events = ob->events();
+  // Events are added when they end, the net one after its operators.
+  ASSERT_EQ(events.size(), 4);
+  EXPECT_EQ(events[0].op_idx, -1);
+  EXPECT_EQ(events[1].op_idx, 0);
+  EXPECT_EQ(events[2].op_idx, 1);
+  EXPECT_EQ(events[3].op_idx, -1);
+  EXPECT_LE(events[3].start_us, events[1].start_us);
+}
+
+} // namespace caffe2
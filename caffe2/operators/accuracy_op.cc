@@ -16,6 +16,8 @@
 
 #include "caffe2/operators/accuracy_op.h"
 
+#include "caffe2/utils/run_chunks.h"
+
 namespace caffe2 {
 
 template <>
@@ -32,26 +34,39 @@ bool AccuracyOp<float, CPUContext>::RunOnDevice() {
   const auto* Xdata = X.data<float>();
   const auto* labelData = label.data<int>();
   const int top_k = top_k_;
-  int correct = 0;
 
   // it's equivalent to using a stable sorting algorithm to sort the
   // classes (with their predictions as key) and then check whether
   // the label is within the first top_k slots.
-  for (int i = 0; i < N; ++i) {
-    auto label_i = labelData[i];
-    auto label_pred = Xdata[i * D + label_i];
-    int ngt = 1;
-    for (int j = 0; j < D; ++j) {
-      auto pred = Xdata[i * D + j];
-      if ((pred > label_pred) || (pred == label_pred && j < label_i)) {
-        if (++ngt > top_k) {
-          break;
+  auto count_correct = [&](int begin, int end) {
+    int correct = 0;
+    for (int i = begin; i < end; ++i) {
+      auto label_i = labelData[i];
+      auto label_pred = Xdata[i * D + label_i];
+      int ngt = 1;
+      for (int j = 0; j < D; ++j) {
+        auto pred = Xdata[i * D + j];
+        if ((pred > label_pred) || (pred == label_pred && j < label_i)) {
+          if (++ngt > top_k) {
+            break;
+          }
         }
       }
+      if (ngt <= top_k) {
+        ++correct;
+      }
     }
-    if (ngt <= top_k) {
-      ++correct;
-    }
+    return correct;
+  };
+
+  const int num_chunks = NumChunks(num_threads_, N, D);
+  vector<int> chunk_correct(num_chunks);
+  RunChunks(ws_, num_chunks, N, [&](int chunk, TIndex begin, TIndex end) {
+    chunk_correct[chunk] = count_correct(begin, end);
+  });
+  int correct = 0;
+  for (const auto c : chunk_correct) {
+    correct += c;
   }
   CAFFE_ENFORCE_LE(correct, N);
   *(Y->mutable_data<float>()) = static_cast<float>(correct) / N;
@@ -77,6 +92,10 @@ classes, it is considered a correct prediction.
       "top_k",
       "Count as correct by comparing the true label to the top k scoring "
       "classes (default 1: only compare to the top scoring class i.e. argmax)")
+  .Arg(
+      "num_threads",
+      "(int, default 1) Number of threads of the workspace pool to split "
+      "the examples over.")
   .Input(0, "predictions", "2-D tensor (Tensor<float>) of size "
          "(num_batches x num_classes) containing scores")
   .Input(1, "labels", "1-D tensor (Tensor<int>) of size (num_batches) having "
@@ -28,12 +28,18 @@ class AccuracyOp final : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   AccuracyOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        top_k_(OperatorBase::GetSingleArgument<int>("top_k", 1)) {}
-        
+        top_k_(OperatorBase::GetSingleArgument<int>("top_k", 1)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+
   bool RunOnDevice() override;
 
  protected:
-  int top_k_; 
+  int top_k_;
+  int num_threads_;
+  Workspace* ws_;
   INPUT_TAGS(PREDICTION, LABEL);
 };
 
@@ -0,0 +1,231 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/alias_sampling_ops.h"
+
+#include <cmath>
+#include <numeric>
+
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Builds the alias table of n weights with Vose's algorithm, the aliases
+// being offset by first. A table whose weights are all zero keeps every
+// column, as it is never sampled.
+template <typename T>
+void BuildAliasTable(
+    const T* weights,
+    int n,
+    int first,
+    float* prob,
+    int* alias) {
+  const double sum = std::accumulate(weights, weights + n, 0.0);
+  for (int i = 0; i < n; ++i) {
+    prob[i] = 1;
+    alias[i] = first + i;
+  }
+  if (sum <= 0) {
+    return;
+  }
+  std::vector<double> scaled(n);
+  std::vector<int> small;
+  std::vector<int> large;
+  for (int i = 0; i < n; ++i) {
+    scaled[i] = weights[i] * n / sum;
+    (scaled[i] < 1 ? small : large).push_back(i);
+  }
+  while (!small.empty() && !large.empty()) {
+    const int s = small.back();
+    small.pop_back();
+    const int l = large.back();
+    prob[s] = scaled[s];
+    alias[s] = first + l;
+    scaled[l] -= 1 - scaled[s];
+    if (scaled[l] < 1) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // The columns left over keep themselves: their scaled weights are 1 up to
+  // the rounding errors.
+}
+
+} // namespace
+
+int AliasTable::Update(const float* weights, int size) {
+  CAFFE_ENFORCE_GT(size, 0, "Cannot sample from no weights.");
+  const int num_blocks = (size + kBlockSize - 1) / kBlockSize;
+  const bool rebuild = size != size_;
+
+  // Checks the weights of the blocks that changed before updating anything.
+  std::vector<int> changed;
+  double total = 0;
+  for (int b = 0; b < num_blocks; ++b) {
+    const int first = b * kBlockSize;
+    const int last = std::min(size, first + kBlockSize);
+    if (!rebuild &&
+        std::equal(weights + first, weights + last, weights_.begin() + first)) {
+      total += block_sums_[b];
+      continue;
+    }
+    for (int i = first; i < last; ++i) {
+      CAFFE_ENFORCE(
+          weights[i] >= 0 && std::isfinite(weights[i]),
+          "Weights must be non-negative, got ",
+          weights[i],
+          " at ",
+          i);
+      total += weights[i];
+    }
+    changed.push_back(b);
+  }
+  CAFFE_ENFORCE_GT(total, 0, "The weights must not all be zero.");
+
+  if (rebuild) {
+    size_ = size;
+    weights_.assign(num_blocks * kBlockSize, 0);
+    block_sums_.resize(num_blocks);
+    block_prob_.resize(num_blocks);
+    block_alias_.resize(num_blocks);
+    prob_.resize(num_blocks * kBlockSize);
+    alias_.resize(num_blocks * kBlockSize);
+  }
+  for (const int b : changed) {
+    const int first = b * kBlockSize;
+    const int last = std::min(size, first + kBlockSize);
+    std::copy(weights + first, weights + last, weights_.begin() + first);
+    block_sums_[b] = std::accumulate(
+        weights_.begin() + first, weights_.begin() + last, 0.0);
+    BuildAliasTable(
+        weights_.data() + first,
+        kBlockSize,
+        first,
+        prob_.data() + first,
+        alias_.data() + first);
+  }
+  if (!changed.empty()) {
+    BuildAliasTable(
+        block_sums_.data(),
+        num_blocks,
+        0,
+        block_prob_.data(),
+        block_alias_.data());
+  }
+  return changed.size();
+}
+
+template <>
+bool AliasTableOp<CPUContext>::RunOnDevice() {
+  auto& weights = Input(0);
+  CAFFE_ENFORCE_EQ(weights.ndim(), 1, "The weights must be a 1-D tensor.");
+  auto* table = OperatorBase::Output<AliasTable>(0);
+  const int rebuilt = table->Update(weights.data<float>(), weights.size());
+  VLOG(2) << "Rebuilt " << rebuilt << " blocks of the alias table.";
+  return true;
+}
+
+template <>
+bool AliasSampleOp<CPUContext>::RunOnDevice() {
+  const auto& table = OperatorBase::Input<AliasTable>(0);
+  CAFFE_ENFORCE_GT(table.size(), 0, "The alias table was not built.");
+  auto* indices = Output(0);
+  indices->Resize(num_samples_);
+  int* indices_data = indices->mutable_data<int>();
+
+  // Four uniform numbers per sample, all drawn at once.
+  uniform_.resize(4 * num_samples_);
+  if (num_samples_ > 0) {
+    math::RandUniform<float, CPUContext>(
+        uniform_.size(), 0.0f, 1.0f, uniform_.data(), &context_);
+  }
+  for (int i = 0; i < num_samples_; ++i) {
+    indices_data[i] = table.Sample(uniform_.data() + 4 * i);
+  }
+
+  if (OutputSize() == 2) {
+    CAFFE_ENFORCE_EQ(
+        InputSize(), 2, "The sampled values need the sampling values.");
+    auto& values = Input(1);
+    CAFFE_ENFORCE_EQ(
+        values.size(),
+        table.size(),
+        "There must be as many sampling values as weights.");
+    const float* values_data = values.data<float>();
+    auto* sampled_values = Output(1);
+    sampled_values->Resize(num_samples_);
+    float* sampled_values_data = sampled_values->mutable_data<float>();
+    for (int i = 0; i < num_samples_; ++i) {
+      sampled_values_data[i] = values_data[indices_data[i]];
+    }
+  }
+  return true;
+}
+
+CAFFE_KNOWN_TYPE(AliasTable);
+
+REGISTER_CPU_OPERATOR(AliasTable, AliasTableOp<CPUContext>);
+REGISTER_CPU_OPERATOR(AliasSample, AliasSampleOp<CPUContext>);
+
+OPERATOR_SCHEMA(AliasTable)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Builds an alias table for AliasSample, which samples the indices of the
+weights with probability proportional to their weight in O(1) per sample,
+where WeightedSample searches the cumulative sum of the weights of every row.
+
+The table is meant to be built once for weights that many calls sample from,
+such as a negative sampling distribution. If the output already holds a table
+for as many weights, only the parts of the table for blocks of 256 weights
+that changed are rebuilt, so that updating a few weights is cheap.
+)DOC")
+    .Input(
+        0,
+        "sampling_weights",
+        "A 1-D Tensor<float> of non-negative weights, not all zero.")
+    .Output(0, "alias_table", "The alias table of the weights.");
+
+OPERATOR_SCHEMA(AliasSample)
+    .NumInputs(1, 2)
+    .NumOutputs(1, 2)
+    .SetDoc(R"DOC(
+Draws num_samples indices independently from the distribution of the weights
+of an alias table built by AliasTable, with probability weight[i] /
+sum(weights) for index i.
+)DOC")
+    .Arg("num_samples", "The number of indices to sample. Defaults to 1.")
+    .Input(0, "alias_table", "The alias table built by AliasTable.")
+    .Input(
+        1,
+        "sampling_values",
+        "An optional 1-D Tensor<float> of values, one per weight, to return "
+        "the values of the sampled indices of.")
+    .Output(
+        0,
+        "sampled_indexes",
+        "A 1-D Tensor<int> of the num_samples sampled indices.")
+    .Output(
+        1,
+        "sampled_values",
+        "A 1-D Tensor<float> of the sampling values of the sampled indices.");
+
+SHOULD_NOT_DO_GRADIENT(AliasTable);
+SHOULD_NOT_DO_GRADIENT(AliasSample);
+
+} // namespace caffe2
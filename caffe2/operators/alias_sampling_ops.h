@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_ALIAS_SAMPLING_OPS_H_
+#define CAFFE2_OPERATORS_ALIAS_SAMPLING_OPS_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+// Samples the indices i of a vector of weights with probability
+// weights[i] / sum(weights) in O(1), by Walker's alias method: every column
+// of the table keeps itself with probability prob and is replaced by its
+// alias otherwise.
+//
+// So that the table can be updated when only a few weights change, the
+// weights are split into blocks of kBlockSize, the last one padded with zero
+// weights. There is an alias table over the blocks, weighted by their sums,
+// and one within every block. An update only rebuilds the tables of the
+// blocks whose weights changed, and the one over the blocks.
+class AliasTable {
+ public:
+  static constexpr int kBlockSize = 256;
+
+  // Builds the table for the weights, or updates it if it was built for as
+  // many weights. Returns the number of blocks whose table was rebuilt.
+  int Update(const float* weights, int size);
+
+  int size() const {
+    return size_;
+  }
+
+  // The index that four uniform numbers in [0, 1) choose.
+  inline int Sample(const float* uniform) const {
+    const int num_blocks = block_prob_.size();
+    int block = std::min(int(uniform[0] * num_blocks), num_blocks - 1);
+    if (uniform[1] >= block_prob_[block]) {
+      block = block_alias_[block];
+    }
+    const int column = block * kBlockSize +
+        std::min(int(uniform[2] * kBlockSize), kBlockSize - 1);
+    return uniform[3] < prob_[column] ? column : alias_[column];
+  }
+
+ private:
+  int size_ = 0;
+  // The weights the table was built for, padded to whole blocks.
+  std::vector<float> weights_;
+  std::vector<double> block_sums_;
+  std::vector<float> block_prob_;
+  std::vector<int> block_alias_;
+  // The columns of the tables of all blocks, with the aliases as indices
+  // into the weights.
+  std::vector<float> prob_;
+  std::vector<int> alias_;
+};
+
+template <class Context>
+class AliasTableOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(AliasTableOp);
+
+  bool RunOnDevice() override;
+};
+
+template <class Context>
+class AliasSampleOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  AliasSampleOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_samples_(OperatorBase::GetSingleArgument<int>("num_samples", 1)) {
+    CAFFE_ENFORCE_GE(num_samples_, 0, "num_samples must be non-negative.");
+  }
+
+  bool RunOnDevice() override;
+
+ private:
+  int num_samples_;
+  std::vector<float> uniform_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_ALIAS_SAMPLING_OPS_H_
@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <random>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/alias_sampling_ops.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+void FeedWeights(Workspace* ws, const vector<float>& weights) {
+  auto* tensor = ws->CreateBlob("weights")->GetMutable<TensorCPU>();
+  tensor->Resize(weights.size());
+  std::copy(weights.begin(), weights.end(), tensor->mutable_data<float>());
+}
+
+// The frequencies of the indices of num_samples samples of the table.
+vector<double> Frequencies(Workspace* ws, int size, int num_samples) {
+  EXPECT_TRUE(ws->RunOperatorOnce(CreateOperatorDef(
+      "AliasSample",
+      "",
+      {"table"},
+      {"samples"},
+      {MakeArgument("num_samples", num_samples)})));
+  const auto& samples = ws->GetBlob("samples")->Get<TensorCPU>();
+  EXPECT_EQ(samples.size(), num_samples);
+  vector<double> frequencies(size);
+  for (int i = 0; i < num_samples; ++i) {
+    const int index = samples.data<int>()[i];
+    EXPECT_TRUE(0 <= index && index < size);
+    frequencies[index] += 1.0 / num_samples;
+  }
+  return frequencies;
+}
+
+} // namespace
+
+TEST(AliasSamplingTest, SamplesProportionallyToWeights) {
+  Workspace ws;
+  // Several blocks, the last one partial, and weights of zero.
+  const int size = 2 * AliasTable::kBlockSize + 10;
+  vector<float> weights(size);
+  double sum = 0;
+  for (int i = 0; i < size; ++i) {
+    weights[i] = i % 5 == 0 ? 0 : i % 7 + 1;
+    sum += weights[i];
+  }
+  FeedWeights(&ws, weights);
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("AliasTable", "", {"weights"}, {"table"})));
+
+  const int num_samples = 1000000;
+  const auto frequencies = Frequencies(&ws, size, num_samples);
+  for (int i = 0; i < size; ++i) {
+    if (weights[i] == 0) {
+      EXPECT_EQ(frequencies[i], 0) << i;
+    } else {
+      EXPECT_NEAR(frequencies[i], weights[i] / sum, 5e-4) << i;
+    }
+  }
+
+  // Updating a weight of the last block only rebuilds that block.
+  weights[size - 1] = 1000;
+  sum += 1000 - (size - 1) % 7 - 1;
+  auto* table = ws.GetBlob("table")->GetMutable<AliasTable>();
+  EXPECT_EQ(table->Update(weights.data(), size), 1);
+  EXPECT_EQ(table->Update(weights.data(), size), 0);
+  const auto updated = Frequencies(&ws, size, num_samples);
+  EXPECT_NEAR(updated[size - 1], 1000 / sum, 2e-3);
+  EXPECT_NEAR(updated[1], weights[1] / sum, 5e-4);
+
+  // The updated table is the one built from scratch.
+  AliasTable fresh;
+  EXPECT_EQ(fresh.Update(weights.data(), size), 3);
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> uniform(0, 1);
+  for (int i = 0; i < 1000; ++i) {
+    const float u[4] = {uniform(rng), uniform(rng), uniform(rng), uniform(rng)};
+    EXPECT_EQ(fresh.Sample(u), table->Sample(u));
+  }
+}
+
+TEST(AliasSamplingTest, SampledValues) {
+  Workspace ws;
+  FeedWeights(&ws, {0, 1, 0});
+  auto* values = ws.CreateBlob("values")->GetMutable<TensorCPU>();
+  values->Resize(3);
+  for (int i = 0; i < 3; ++i) {
+    values->mutable_data<float>()[i] = 10 * i;
+  }
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("AliasTable", "", {"weights"}, {"table"})));
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "AliasSample",
+      "",
+      {"table", "values"},
+      {"samples", "sampled_values"},
+      {MakeArgument("num_samples", 5)})));
+  const auto& sampled = ws.GetBlob("sampled_values")->Get<TensorCPU>();
+  ASSERT_EQ(sampled.size(), 5);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(ws.GetBlob("samples")->Get<TensorCPU>().data<int>()[i], 1);
+    EXPECT_EQ(sampled.data<float>()[i], 10);
+  }
+}
+
+TEST(AliasSamplingTest, InvalidWeights) {
+  AliasTable table;
+  const vector<float> zeros(10, 0);
+  EXPECT_THROW(table.Update(zeros.data(), zeros.size()), EnforceNotMet);
+  const vector<float> negative = {1, -1};
+  EXPECT_THROW(table.Update(negative.data(), negative.size()), EnforceNotMet);
+  EXPECT_EQ(table.size(), 0);
+}
+
+} // namespace caffe2
@@ -18,9 +18,54 @@
 
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/perfkernels/dense_normalization.h"
+#include "caffe2/utils/run_chunks.h"
 
 namespace caffe2 {
 
+template <>
+template <>
+bool BatchBoxCoxOp<CPUContext>::DoRunWithType<float>() {
+  auto& data = Input(DATA);
+  auto& lambda1 = Input(LAMBDA1);
+  auto& lambda2 = Input(LAMBDA2);
+  CAFFE_ENFORCE_GE(data.ndim(), 1);
+  const TIndex N = data.dim(0);
+  const TIndex D = data.size_from_dim(1);
+
+  auto* output = Output(0);
+  output->ResizeLike(Input(DATA));
+  float* output_ptr = output->mutable_data<float>();
+
+  if (data.size() <= 0) {
+    return true;
+  }
+
+  CAFFE_ENFORCE_EQ(lambda1.size(), D);
+  CAFFE_ENFORCE_EQ(lambda2.size(), D);
+
+  const float* data_ptr = data.data<float>();
+  const float* lambda1_ptr = lambda1.data<float>();
+  const float* lambda2_ptr = lambda2.data<float>();
+  RunColumnChunks(
+      ws_,
+      num_threads_,
+      N,
+      D,
+      [&](TIndex row_begin, TIndex row_end, TIndex col_begin, TIndex col_end) {
+        const TIndex offset = row_begin * D + col_begin;
+        box_cox(
+            row_end - row_begin,
+            col_end - col_begin,
+            D,
+            data_ptr + offset,
+            lambda1_ptr + col_begin,
+            lambda2_ptr + col_begin,
+            output_ptr + offset);
+      });
+  return true;
+}
+
 template <>
 template <typename T>
 bool BatchBoxCoxOp<CPUContext>::DoRunWithType() {
@@ -67,6 +112,116 @@ bool BatchBoxCoxOp<CPUContext>::DoRunWithType() {
   return true;
 }
 
+BatchBoxCoxPiecewiseLinearOp::BatchBoxCoxPiecewiseLinearOp(
+    const OperatorDef& operator_def,
+    Workspace* ws)
+    : Operator<CPUContext>(operator_def, ws),
+      num_threads_(GetSingleArgument<int>("num_threads", 1)),
+      ws_(ws),
+      bounds_from_arg_(GetRepeatedArgument<float>("bounds")),
+      slopes_from_arg_(GetRepeatedArgument<float>("slopes")),
+      intercepts_from_arg_(GetRepeatedArgument<float>("intercepts")) {
+  CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  const int num_params_from_arg = !bounds_from_arg_.empty() +
+      !slopes_from_arg_.empty() + !intercepts_from_arg_.empty();
+  CAFFE_ENFORCE(
+      num_params_from_arg == 0 || num_params_from_arg == 3,
+      "bounds, slopes, intercepts must be all set or all not set");
+}
+
+bool BatchBoxCoxPiecewiseLinearOp::RunOnDevice() {
+  auto& data = Input(DATA);
+  auto& lambda1 = Input(LAMBDA1);
+  auto& lambda2 = Input(LAMBDA2);
+  CAFFE_ENFORCE_GE(data.ndim(), 1);
+  const TIndex N = data.dim(0);
+  const TIndex D = data.size_from_dim(1);
+  CAFFE_ENFORCE_EQ(lambda1.size(), D);
+  CAFFE_ENFORCE_EQ(lambda2.size(), D);
+
+  const float* bounds;
+  const float* slopes;
+  const float* intercepts;
+  TIndex num_bounds;
+  TIndex num_slopes;
+  TIndex num_intercepts;
+  if (!bounds_from_arg_.empty()) {
+    CAFFE_ENFORCE_EQ(InputSize(), 3);
+    bounds = bounds_from_arg_.data();
+    slopes = slopes_from_arg_.data();
+    intercepts = intercepts_from_arg_.data();
+    num_bounds = bounds_from_arg_.size();
+    num_slopes = slopes_from_arg_.size();
+    num_intercepts = intercepts_from_arg_.size();
+  } else {
+    CAFFE_ENFORCE_EQ(InputSize(), 6);
+    bounds = Input(BOUNDS).data<float>();
+    slopes = Input(SLOPES).data<float>();
+    intercepts = Input(INTERCEPTS).data<float>();
+    num_bounds = Input(BOUNDS).size();
+    num_slopes = Input(SLOPES).size();
+    num_intercepts = Input(INTERCEPTS).size();
+  }
+  CAFFE_ENFORCE_EQ(num_slopes, num_intercepts);
+  CAFFE_ENFORCE_EQ(
+      num_bounds - num_slopes, D, "There must be one group per column");
+  CAFFE_ENFORCE_GT(num_slopes, 0);
+  CAFFE_ENFORCE_EQ(num_slopes % D, 0);
+  const TIndex P = num_slopes / D;
+
+  // Interleaves the groups, so that the parameters of consecutive columns
+  // are loaded together. Parameters from args are interleaved only once.
+  if (bounds_from_arg_.empty() || bounds_.size() != num_bounds) {
+    bounds_.resize(num_bounds);
+    slopes_.resize(num_slopes);
+    intercepts_.resize(num_intercepts);
+    for (TIndex j = 0; j < D; ++j) {
+      CAFFE_ENFORCE(
+          std::is_sorted(bounds + j * (P + 1), bounds + (j + 1) * (P + 1)),
+          "bounds must be sorted for each group");
+      for (TIndex k = 0; k <= P; ++k) {
+        bounds_[k * D + j] = bounds[j * (P + 1) + k];
+      }
+      for (TIndex k = 0; k < P; ++k) {
+        slopes_[k * D + j] = slopes[j * P + k];
+        intercepts_[k * D + j] = intercepts[j * P + k];
+      }
+    }
+  }
+
+  auto* output = Output(0);
+  output->ResizeLike(data);
+  float* output_ptr = output->mutable_data<float>();
+  if (data.size() <= 0) {
+    return true;
+  }
+  const float* data_ptr = data.data<float>();
+  const float* lambda1_ptr = lambda1.data<float>();
+  const float* lambda2_ptr = lambda2.data<float>();
+  RunColumnChunks(
+      ws_,
+      num_threads_,
+      N,
+      D,
+      [&](TIndex row_begin, TIndex row_end, TIndex col_begin, TIndex col_end) {
+        const TIndex offset = row_begin * D + col_begin;
+        box_cox_piecewise_linear(
+            row_end - row_begin,
+            col_end - col_begin,
+            D,
+            data_ptr + offset,
+            lambda1_ptr + col_begin,
+            lambda2_ptr + col_begin,
+            P,
+            D,
+            bounds_.data() + col_begin,
+            slopes_.data() + col_begin,
+            intercepts_.data() + col_begin,
+            output_ptr + offset);
+      });
+  return true;
+}
+
 namespace {
 
 REGISTER_CPU_OPERATOR(BatchBoxCox, BatchBoxCoxOp<CPUContext>);
@@ -84,11 +239,49 @@ the transform of each column `x` of the input `data`:
     ((x + lambda2)^lambda1 - 1)/lambda1, if lambda1 != 0
 
 )DOC")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool float inputs are "
+        "split over, by blocks of columns. Defaults to 1.")
     .Input(0, "data", "input float or double N * D matrix")
     .Input(1, "lambda1", "tensor of size D with the same type as data")
     .Input(2, "lambda2", "tensor of size D with the same type as data")
     .Output(0, "output", "output matrix that applied box-cox transform");
 
 GRADIENT_NOT_IMPLEMENTED_YET(BatchBoxCox);
+
+REGISTER_CPU_OPERATOR(BatchBoxCoxPiecewiseLinear, BatchBoxCoxPiecewiseLinearOp);
+OPERATOR_SCHEMA(BatchBoxCoxPiecewiseLinear)
+    .NumInputs({3, 6})
+    .NumOutputs(1)
+    .IdenticalTypeAndShapeOfInput(0)
+    .AllowInplace({{0, 0}})
+    .SetDoc(R"DOC(
+BatchBoxCox followed by PiecewiseLinearTransform, in one pass over the float
+N * D matrix `data`: each column is box-cox transformed with its `lambda1`
+and `lambda2`, and the result is transformed by the piecewise linear
+function of the column. The piecewise linear functions are given as for
+PiecewiseLinearTransform, one group per column, either by the `bounds`,
+`slopes` and `intercepts` args or by the inputs 3 to 5.
+)DOC")
+    .Arg(
+        "bounds",
+        "1-D vector of size (D x (pieces+1)), the bounds of the pieces of "
+        "each column, as in PiecewiseLinearTransform.")
+    .Arg("slopes", "1-D vector of size (D x pieces).")
+    .Arg("intercepts", "1-D vector of size (D x pieces).")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the input is split "
+        "over, by blocks of columns. Defaults to 1.")
+    .Input(0, "data", "input float N * D matrix")
+    .Input(1, "lambda1", "tensor of size D")
+    .Input(2, "lambda2", "tensor of size D")
+    .Input(3, "bounds (optional)", "See bounds in Arg.")
+    .Input(4, "slopes (optional)", "See slopes in Arg.")
+    .Input(5, "intercepts (optional)", "See intercepts in Arg.")
+    .Output(0, "output", "the transformed matrix");
+
+SHOULD_NOT_DO_GRADIENT(BatchBoxCoxPiecewiseLinear);
 }
 }
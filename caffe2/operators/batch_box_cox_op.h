@@ -29,7 +29,11 @@ class BatchBoxCoxOp final : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   BatchBoxCoxOp(const OperatorDef& operator_def, Workspace* ws)
-      : Operator<Context>(operator_def, ws) {}
+      : Operator<Context>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
 
   bool RunOnDevice() override {
     return DispatchHelper<TensorTypes<float, double>>::call(this, Input(DATA));
@@ -39,9 +43,34 @@ class BatchBoxCoxOp final : public Operator<Context> {
   bool DoRunWithType();
 
  protected:
+  int num_threads_;
+  Workspace* ws_;
   INPUT_TAGS(DATA, LAMBDA1, LAMBDA2);
 };
 
+// PiecewiseLinearTransform(BatchBoxCox(data)), in one pass over the data.
+// The piecewise linear functions are given as for PiecewiseLinearTransform,
+// by args or by the inputs 3 to 5.
+class BatchBoxCoxPiecewiseLinearOp final : public Operator<CPUContext> {
+ public:
+  BatchBoxCoxPiecewiseLinearOp(const OperatorDef& operator_def, Workspace* ws);
+
+  bool RunOnDevice() override;
+
+ private:
+  int num_threads_;
+  Workspace* ws_;
+  vector<float> bounds_from_arg_;
+  vector<float> slopes_from_arg_;
+  vector<float> intercepts_from_arg_;
+  // The parameters with the columns interleaved, see piecewise_linear in
+  // perfkernels/dense_normalization.h.
+  vector<float> bounds_;
+  vector<float> slopes_;
+  vector<float> intercepts_;
+  INPUT_TAGS(DATA, LAMBDA1, LAMBDA2, BOUNDS, SLOPES, INTERCEPTS);
+};
+
 } // namespace caffe2
 
 #endif // CAFFE_OPERATORS_BATCH_BOX_COX_OPS_H_
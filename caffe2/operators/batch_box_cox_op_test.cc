@@ -0,0 +1,215 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+void SetTensor(
+    Workspace* ws,
+    const string& name,
+    const vector<TIndex>& dims,
+    const vector<float>& values) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  std::copy(values.begin(), values.end(), tensor->mutable_data<float>());
+}
+
+vector<float> GetTensor(Workspace* ws, const string& name) {
+  const auto& tensor = ws->GetBlob(name)->Get<TensorCPU>();
+  return vector<float>(
+      tensor.data<float>(), tensor.data<float>() + tensor.size());
+}
+
+float BoxCoxReference(float x, float lambda1, float lambda2) {
+  const double v = std::max(double(x) + lambda2, 1e-6);
+  return lambda1 == 0 ? std::log(v) : (std::pow(v, lambda1) - 1) / lambda1;
+}
+
+// The piecewise linear function of a group, as in PiecewiseLinearTransform.
+float PiecewiseLinearReference(
+    float x,
+    int P,
+    const float* bounds,
+    const float* slopes,
+    const float* intercepts) {
+  if (x <= bounds[0]) {
+    return slopes[0] * bounds[0] + intercepts[0];
+  }
+  if (x >= bounds[P]) {
+    return slopes[P - 1] * bounds[P] + intercepts[P - 1];
+  }
+  const int k = std::lower_bound(bounds, bounds + P + 1, x) - bounds - 1;
+  return slopes[k] * x + intercepts[k];
+}
+
+// An N x D input with every value of lambda1 in [-1, 2], and continuous
+// piecewise linear functions of P pieces over the range of the Box-Cox
+// transforms, so that tiny differences of the transforms stay tiny.
+struct Inputs {
+  Inputs(int N, int D, int P) : N(N), D(D), P(P) {
+    for (int i = 0; i < N * D; ++i) {
+      data.push_back((i * 37 % 101) * 0.1f - 1);
+    }
+    for (int j = 0; j < D; ++j) {
+      lambda1.push_back(j % 4 == 0 ? 0 : (j % 7) * 0.5f - 1);
+      lambda2.push_back(1.5f + (j % 3));
+      float value = 0;
+      for (int k = 0; k <= P; ++k) {
+        bounds.push_back(-1 + (4.0f * k + (k % 2) * (j % 5) * 0.4f) / P);
+      }
+      for (int k = 0; k < P; ++k) {
+        const float* b = &bounds[j * (P + 1) + k];
+        const float slope = ((j + k) % 5) * 0.5f - 1;
+        slopes.push_back(slope);
+        intercepts.push_back(value - slope * b[0]);
+        value += slope * (b[1] - b[0]);
+      }
+    }
+  }
+
+  float BoxCox(int i, int j) const {
+    return BoxCoxReference(data[i * D + j], lambda1[j], lambda2[j]);
+  }
+
+  float PiecewiseLinear(float x, int j) const {
+    return PiecewiseLinearReference(
+        x,
+        P,
+        &bounds[j * (P + 1)],
+        &slopes[j * P],
+        &intercepts[j * P]);
+  }
+
+  void Set(Workspace* ws) const {
+    SetTensor(ws, "data", {N, D}, data);
+    SetTensor(ws, "lambda1", {D}, lambda1);
+    SetTensor(ws, "lambda2", {D}, lambda2);
+    SetTensor(ws, "bounds", {TIndex(bounds.size())}, bounds);
+    SetTensor(ws, "slopes", {TIndex(slopes.size())}, slopes);
+    SetTensor(ws, "intercepts", {TIndex(intercepts.size())}, intercepts);
+  }
+
+  int N, D, P;
+  vector<float> data, lambda1, lambda2, bounds, slopes, intercepts;
+};
+
+void ExpectNear(float expected, float actual) {
+  EXPECT_NEAR(expected, actual, 1e-4 * std::max(1.0f, std::abs(expected)));
+}
+
+// The shapes cover tails of fewer than 8 columns, both ways to split over
+// threads, by columns and by rows, and pieces found both by linear and by
+// binary search.
+const vector<std::tuple<int, int, int>> kShapes = {
+    std::make_tuple(3, 13, 3),
+    std::make_tuple(1000, 100, 5),
+    std::make_tuple(2000, 37, 24)};
+
+} // namespace
+
+TEST(BatchBoxCoxTest, MatchesReference) {
+  for (const auto& shape : kShapes) {
+    const Inputs inputs(
+        std::get<0>(shape), std::get<1>(shape), std::get<2>(shape));
+    for (int num_threads : {1, 4}) {
+      Workspace ws;
+      inputs.Set(&ws);
+      EXPECT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+          "BatchBoxCox",
+          "",
+          {"data", "lambda1", "lambda2"},
+          {"output"},
+          {MakeArgument<int>("num_threads", num_threads)})));
+      const auto output = GetTensor(&ws, "output");
+      for (int i = 0; i < inputs.N; ++i) {
+        for (int j = 0; j < inputs.D; ++j) {
+          ExpectNear(inputs.BoxCox(i, j), output[i * inputs.D + j]);
+        }
+      }
+    }
+  }
+}
+
+TEST(BatchBoxCoxTest, PiecewiseLinearTransformMatchesReference) {
+  for (const auto& shape : kShapes) {
+    const Inputs inputs(
+        std::get<0>(shape), std::get<1>(shape), std::get<2>(shape));
+    for (int num_threads : {1, 4}) {
+      Workspace ws;
+      inputs.Set(&ws);
+      // The params from args are interleaved once, and reused by the
+      // second run.
+      unique_ptr<OperatorBase> op(CreateOperator(
+          CreateOperatorDef(
+              "PiecewiseLinearTransform",
+              "",
+              {"data"},
+              {"output"},
+              {MakeArgument<vector<float>>("bounds", inputs.bounds),
+               MakeArgument<vector<float>>("slopes", inputs.slopes),
+               MakeArgument<vector<float>>("intercepts", inputs.intercepts),
+               MakeArgument<int>("num_threads", num_threads)}),
+          &ws));
+      for (int iter = 0; iter < 2; ++iter) {
+        EXPECT_TRUE(op->Run());
+        const auto output = GetTensor(&ws, "output");
+        for (int i = 0; i < inputs.N; ++i) {
+          for (int j = 0; j < inputs.D; ++j) {
+            ExpectNear(
+                inputs.PiecewiseLinear(inputs.data[i * inputs.D + j], j),
+                output[i * inputs.D + j]);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(BatchBoxCoxTest, FusedMatchesReference) {
+  for (const auto& shape : kShapes) {
+    const Inputs inputs(
+        std::get<0>(shape), std::get<1>(shape), std::get<2>(shape));
+    for (int num_threads : {1, 4}) {
+      Workspace ws;
+      inputs.Set(&ws);
+      EXPECT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+          "BatchBoxCoxPiecewiseLinear",
+          "",
+          {"data", "lambda1", "lambda2", "bounds", "slopes", "intercepts"},
+          {"output"},
+          {MakeArgument<int>("num_threads", num_threads)})));
+      const auto output = GetTensor(&ws, "output");
+      for (int i = 0; i < inputs.N; ++i) {
+        for (int j = 0; j < inputs.D; ++j) {
+          ExpectNear(
+              inputs.PiecewiseLinear(inputs.BoxCox(i, j), j),
+              output[i * inputs.D + j]);
+        }
+      }
+    }
+  }
+}
+
+} // namespace caffe2
@@ -16,8 +16,89 @@
 
 #include "caffe2/operators/batch_gather_ops.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "caffe2/utils/run_chunks.h"
+
 namespace caffe2 {
 
+template <>
+template <typename TInd>
+bool BatchGatherOp<CPUContext>::DoRunWithType() {
+  auto& data = Input(DATA);
+  auto& indices = Input(INDICES);
+  auto* output = Output(0);
+
+  CAFFE_ENFORCE_GE(data.ndim(), 2, "DATA should be at least 2-D");
+
+  vector<TIndex> shape;
+  shape.push_back(data.dim(0));
+  shape.insert(shape.end(), indices.dims().begin(), indices.dims().end());
+  shape.insert(shape.end(), data.dims().begin() + 2, data.dims().end());
+  output->Resize(shape);
+
+  const TIndex M = data.dim(0);
+  const TIndex N = indices.size();
+  const TIndex block_size = data.size_from_dim(2);
+  const size_t block_bytesize = block_size * data.meta().itemsize();
+  const size_t data_batch_bytesize =
+      data.size_from_dim(1) * data.meta().itemsize();
+  const size_t gathered_batch_bytesize = N * block_bytesize;
+  const TInd* idxs = indices.template data<TInd>();
+  for (TIndex i = 0; i < N; ++i) {
+    CAFFE_ENFORCE(
+        0 <= idxs[i] && idxs[i] < data.dim(1),
+        "INDICES element is out of DATA bounds, id=",
+        idxs[i],
+        " data_dim=",
+        data.dim(1));
+  }
+  const auto& meta = data.meta();
+  auto src_base = static_cast<const char*>(data.raw_data());
+  auto out = static_cast<char*>(output->raw_mutable_data(meta));
+
+  // Gathers the output rows [begin, end) of all batches, with a single copy
+  // for every span of consecutive indices, while prefetching the row
+  // kPrefetchDistance indices ahead.
+  constexpr TIndex kPrefetchDistance = 8;
+  auto gather = [&](TIndex begin, TIndex end) {
+    for (TIndex row = begin; row < end;) {
+      const TIndex batch = row / N;
+      const TIndex i = row % N;
+      const TIndex span_end = std::min(N, i + end - row);
+      TIndex span = 1;
+      while (i + span < span_end && idxs[i + span] == idxs[i] + span) {
+        ++span;
+      }
+      const char* batch_src = src_base + batch * data_batch_bytesize;
+#ifdef __GNUC__
+      if (i + span + kPrefetchDistance < span_end) {
+        __builtin_prefetch(
+            batch_src + idxs[i + span + kPrefetchDistance] * block_bytesize,
+            0,
+            1);
+      }
+#endif // __GNUC__
+      const char* src = batch_src + idxs[i] * block_bytesize;
+      char* dst = out + batch * gathered_batch_bytesize + i * block_bytesize;
+      if (meta.copy()) {
+        meta.copy()(src, dst, span * block_size);
+      } else {
+        memcpy(dst, src, span * block_bytesize);
+      }
+      row += span;
+    }
+  };
+  RunChunks(
+      ws_,
+      num_threads_,
+      M * N,
+      block_size,
+      [&](int /* unused */, TIndex begin, TIndex end) { gather(begin, end); });
+  return true;
+}
+
 REGISTER_CPU_OPERATOR(BatchGather, BatchGatherOp<CPUContext>);
 REGISTER_CPU_OPERATOR(BatchGatherGradient, BatchGatherGradientOp<CPUContext>);
 
@@ -64,6 +145,10 @@ Example:
 )DOC")
     .Input(0, "DATA", "Tensor of rank r >= 2.")
     .Input(1, "INDICES", "Tensor of int32/int64 indices, of any rank q.")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the gathered rows are "
+        "split over on CPU. Defaults to 1.")
     .Output(0, "OUTPUT", "Tensor of rank (q - 1) + (r - 1).");
 
 OPERATOR_SCHEMA(BatchGatherGradient).NumInputs(3).NumOutputs(1);
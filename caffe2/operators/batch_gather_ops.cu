@@ -21,29 +21,67 @@
 
 namespace caffe2 {
 
-template <typename T_INDEX, typename TData>
+constexpr int kBatchGatherWarpSize = 32;
+constexpr int kBatchGatherWarpsPerBlock = 8;
+
+// Copies every gathered row of block_size values of T with a warp, whose
+// lanes copy consecutive values, so that the row is read and written with
+// coalesced accesses. T is the widest type the rows are aligned to, so that
+// a float row of a multiple of 4 values is copied with float4 accesses.
+template <typename T_INDEX, typename T>
 __global__ void BatchGatherKernel(
-    const TData* src_base,
-    TData* out,
-    const T_INDEX* indices,
+    const T* __restrict__ src_base,
+    T* __restrict__ out,
+    const T_INDEX* __restrict__ indices,
     const int M,
     const int N,
     const int data_batch_size,
     const int gathered_batch_size,
     const int block_size) {
-  const int begin_idx = blockIdx.x * blockDim.x + threadIdx.x;
-  const int num_items = M * N * block_size;
-  for (int s = begin_idx; s < num_items; s += blockDim.x * gridDim.x) {
-    const int k = s % block_size;
-    const int j = s / block_size % N;
-    const int i = s / block_size / N;
-    const T_INDEX idx = indices[j];
-    const float* src_offset = src_base + i * data_batch_size + idx * block_size;
-    float* dst_offset = out + i * gathered_batch_size + j * block_size;
-    dst_offset[k] = src_offset[k];
+  const int num_rows = M * N;
+  for (int row = blockIdx.x * blockDim.y + threadIdx.y; row < num_rows;
+       row += gridDim.x * blockDim.y) {
+    const int i = row / N;
+    const int j = row % N;
+    const T* src = src_base + static_cast<int64_t>(i) * data_batch_size +
+        static_cast<int64_t>(indices[j]) * block_size;
+    T* dst = out + static_cast<int64_t>(i) * gathered_batch_size +
+        static_cast<int64_t>(j) * block_size;
+    for (int k = threadIdx.x; k < block_size; k += blockDim.x) {
+      dst[k] = src[k];
+    }
   }
 }
 
+template <typename T_INDEX, typename T>
+void BatchGather(
+    const void* src_base,
+    void* out,
+    const T_INDEX* indices,
+    const int M,
+    const int N,
+    const size_t data_batch_bytesize,
+    const size_t block_bytesize,
+    CUDAContext* context) {
+  const int num_rows = M * N;
+  const int num_blocks = std::min(
+      (num_rows + kBatchGatherWarpsPerBlock - 1) / kBatchGatherWarpsPerBlock,
+      CAFFE_MAXIMUM_NUM_BLOCKS);
+  BatchGatherKernel<<<
+      num_blocks,
+      dim3(kBatchGatherWarpSize, kBatchGatherWarpsPerBlock),
+      0,
+      context->cuda_stream()>>>(
+      static_cast<const T*>(src_base),
+      static_cast<T*>(out),
+      indices,
+      M,
+      N,
+      data_batch_bytesize / sizeof(T),
+      N * block_bytesize / sizeof(T),
+      block_bytesize / sizeof(T));
+}
+
 template <>
 bool BatchGatherOp<CUDAContext>::RunOnDevice() {
   return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
@@ -63,28 +101,61 @@ bool BatchGatherOp<CUDAContext>::DoRunWithType() {
   shape.insert(shape.end(), data.dims().begin() + 2, data.dims().end());
   output->Resize(shape);
 
-  const int block_size = data.size_from_dim(2);
+  const int M = data.dim32(0);
   const int N = indices.size();
-  const auto data_batch_size = data.size_from_dim(1);
-  const auto gathered_batch_size = N * data.size_from_dim(2);
+  const size_t block_bytesize = data.size_from_dim(2) * data.meta().itemsize();
+  const size_t data_batch_bytesize =
+      data.size_from_dim(1) * data.meta().itemsize();
   const TInd* idxs = indices.template data<TInd>();
-  auto src_base = static_cast<const float*>(data.raw_data());
-  auto out = static_cast<float*>(output->raw_mutable_data(data.meta()));
-  const int M = data.dim32(0);
+  const void* src_base = data.raw_data();
+  void* out = output->raw_mutable_data(data.meta());
+  if (M * N == 0 || block_bytesize == 0) {
+    return true;
+  }
 
-  BatchGatherKernel<<<
-      std::min(M, CAFFE_MAXIMUM_NUM_BLOCKS),
-      std::min(N * block_size, CAFFE_CUDA_NUM_THREADS),
-      0,
-      context_.cuda_stream()>>>(
-      src_base,
-      out,
-      idxs,
-      M,
-      N,
-      data_batch_size,
-      gathered_batch_size,
-      block_size);
+  // The tensors are allocated aligned, so the rows are aligned to the
+  // largest power of two their size is a multiple of.
+  if (block_bytesize % sizeof(float4) == 0) {
+    BatchGather<TInd, float4>(
+        src_base,
+        out,
+        idxs,
+        M,
+        N,
+        data_batch_bytesize,
+        block_bytesize,
+        &context_);
+  } else if (block_bytesize % sizeof(float2) == 0) {
+    BatchGather<TInd, float2>(
+        src_base,
+        out,
+        idxs,
+        M,
+        N,
+        data_batch_bytesize,
+        block_bytesize,
+        &context_);
+  } else if (block_bytesize % sizeof(float) == 0) {
+    BatchGather<TInd, float>(
+        src_base,
+        out,
+        idxs,
+        M,
+        N,
+        data_batch_bytesize,
+        block_bytesize,
+        &context_);
+  } else {
+    BatchGather<TInd, char>(
+        src_base,
+        out,
+        idxs,
+        M,
+        N,
+        data_batch_bytesize,
+        block_bytesize,
+        &context_);
+  }
   return true;
 }
 
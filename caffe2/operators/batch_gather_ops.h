@@ -27,7 +27,12 @@ template <class Context>
 class BatchGatherOp final : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(BatchGatherOp)
+  BatchGatherOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
 
   bool RunOnDevice() override {
     return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
@@ -35,49 +40,13 @@ class BatchGatherOp final : public Operator<Context> {
   }
 
   template <typename TInd>
-  bool DoRunWithType() {
-    auto& data = Input(DATA);
-    auto& indices = Input(INDICES);
-    auto* output = Output(0);
-
-    CAFFE_ENFORCE_GE(data.ndim(), 2, "DATA should be at least 2-D");
-
-    vector<TIndex> shape;
-    shape.push_back(data.dim(0));
-    shape.insert(shape.end(), indices.dims().begin(), indices.dims().end());
-    shape.insert(shape.end(), data.dims().begin() + 2, data.dims().end());
-    output->Resize(shape);
-
-    auto block_size = data.size_from_dim(2);
-    auto block_bytesize = block_size * data.meta().itemsize();
-    auto N = indices.size();
-    auto data_batch_bytesize = data.size_from_dim(1) * data.meta().itemsize();
-    auto gathered_batch_bytesize =
-        N * data.size_from_dim(2) * data.meta().itemsize();
-    const TInd* idxs = indices.template data<TInd>();
-    auto src_base = static_cast<const char*>(data.raw_data());
-    auto out = static_cast<char*>(output->raw_mutable_data(data.meta()));
-
-    for (auto batch = 0; batch < data.dim(0); ++batch) {
-      for (auto i = 0; i < N; ++i) {
-        auto idx = idxs[i];
-        CAFFE_ENFORCE(
-            0 <= idx && idx < data.dim(1),
-            "INDICES element is out of DATA bounds, id=",
-            idx,
-            " data_dim=",
-            data.dim(1));
-        auto src =
-            src_base + idx * block_bytesize + batch * data_batch_bytesize;
-        auto dst = out + i * block_bytesize + batch * gathered_batch_bytesize;
-        context_.template CopyItems<Context, Context>(
-            data.meta(), block_size, src, dst);
-      }
-    }
-    return true;
-  }
+  bool DoRunWithType();
 
   INPUT_TAGS(DATA, INDICES);
+
+ protected:
+  int num_threads_;
+  Workspace* ws_;
 };
 
 template <class Context>
@@ -38,32 +38,66 @@ Batch Matrix multiplication Yi = Ai * Bi, where A has shape (dim0, dim1, ... M,
          "trans_b",
          "Pass 1 to transpose the last two dimensions of B before "
          "doing multiplication")
+    .Arg(
+         "broadcast",
+         "Pass 1 to allow A and B to have a different number of batch "
+         "dimensions. The batch dimensions of the input with fewer of them "
+         "must match the trailing batch dimensions of the other one, and its "
+         "matrices are reused across the leading ones, e.g. A of shape "
+         "(B, H, M, K) times B of shape (H, K, N).")
+    .Arg(
+         "num_threads",
+         "(int, default 1) number of threads of the workspace pool to spread "
+         "the batch over, on CPU.")
     .TensorInferenceFunction([](const OperatorDef &def,
                                 const vector<TensorShape> &in) {
-      const auto ndim = in[0].dims_size();
-      CAFFE_ENFORCE_GE(ndim, 2);
+      const auto a_ndim = in[0].dims_size();
+      const auto b_ndim = in[1].dims_size();
+      CAFFE_ENFORCE_GE(a_ndim, 2);
+      CAFFE_ENFORCE_GE(b_ndim, 2);
       ArgumentHelper helper(def);
       int a_dim0;
       int b_dim1;
       if (helper.GetSingleArgument<int>("trans_a", 0)) {
-        a_dim0 = in[0].dims(ndim - 1);
+        a_dim0 = in[0].dims(a_ndim - 1);
       } else {
-        a_dim0 = in[0].dims(ndim - 2);
+        a_dim0 = in[0].dims(a_ndim - 2);
       }
 
       if (helper.GetSingleArgument<int>("trans_b", 0)) {
-        b_dim1 = in[1].dims(ndim - 2);
+        b_dim1 = in[1].dims(b_ndim - 2);
       } else {
-        b_dim1 = in[1].dims(ndim - 1);
+        b_dim1 = in[1].dims(b_ndim - 1);
       }
 
-      auto output_dims =
-          vector<TIndex>{in[0].dims().begin(), in[0].dims().end()};
+      const auto& big = a_ndim >= b_ndim ? in[0] : in[1];
+      const auto ndim = big.dims_size();
+      auto output_dims = vector<TIndex>{big.dims().begin(), big.dims().end()};
       output_dims[ndim - 2] = a_dim0;
       output_dims[ndim - 1] = b_dim1;
 
       return vector<TensorShape>{
           CreateTensorShape(vector<TIndex>{output_dims}, in[0].data_type())};
+    })
+    .CostInferenceFunction([](const OperatorDef& def,
+                              const vector<TensorShape>& in) {
+      struct OpSchema::Cost c;
+      const auto a_ndim = in[0].dims_size();
+      const auto b_ndim = in[1].dims_size();
+      CAFFE_ENFORCE_GE(a_ndim, 2);
+      CAFFE_ENFORCE_GE(b_ndim, 2);
+      ArgumentHelper helper(def);
+      const bool trans_a = helper.GetSingleArgument<int>("trans_a", 0);
+      const bool trans_b = helper.GetSingleArgument<int>("trans_b", 0);
+      const auto& big = a_ndim >= b_ndim ? in[0] : in[1];
+      const uint64_t batch = nElemBetweenDim(big, 0, big.dims_size() - 2);
+      const uint64_t M = in[0].dims(trans_a ? a_ndim - 1 : a_ndim - 2);
+      const uint64_t K = in[0].dims(trans_a ? a_ndim - 2 : a_ndim - 1);
+      const uint64_t N = in[1].dims(trans_b ? b_ndim - 2 : b_ndim - 1);
+      c.flops = 2 * batch * M * N * K;
+      c.bytes_read = nBytes(in[0]) + nBytes(in[1]);
+      c.bytes_written = batch * M * N * ItemSize(in[0]);
+      return c;
     });
 
 class GetBatchMatMulGradient : public GradientMakerBase {
@@ -97,11 +131,22 @@ class GetBatchMatMulGradient : public GradientMakerBase {
       trans_both_arg.push_back(MakeArgument<int>("use_scratch", 1));
     }
 
+    const bool broadcast =
+        ArgumentHelper::HasArgument(Def(), "broadcast") &&
+        GetArgument(Def(), "broadcast").i();
+    if (broadcast) {
+      for (auto* args :
+           {&no_trans_arg, &trans_a_arg, &trans_b_arg, &trans_both_arg}) {
+        args->push_back(MakeArgument<int>("broadcast", 1));
+      }
+    }
+
+    vector<OperatorDef> grad_ops;
     if (trans_a) {
       if (trans_b) {
         // A'B':
         // dA = B'G', dB = G'A'
-        return vector<OperatorDef>{
+        grad_ops = vector<OperatorDef>{
             CreateOperatorDef(
                 "BatchMatMul",
                 "",
@@ -117,7 +162,7 @@ class GetBatchMatMulGradient : public GradientMakerBase {
       } else {
         // A'B:
         // dA = BG', dB = AG
-        return vector<OperatorDef>{
+        grad_ops = vector<OperatorDef>{
             CreateOperatorDef(
                 "BatchMatMul",
                 "",
@@ -135,7 +180,7 @@ class GetBatchMatMulGradient : public GradientMakerBase {
       if (trans_b) {
         // AB':
         // dA = GB, dB = G'A
-        return vector<OperatorDef>{
+        grad_ops = vector<OperatorDef>{
             CreateOperatorDef(
                 "BatchMatMul",
                 "",
@@ -151,7 +196,7 @@ class GetBatchMatMulGradient : public GradientMakerBase {
       } else {
         // AB:
         // dA = GB', dB = A'G
-        return vector<OperatorDef>{
+        grad_ops = vector<OperatorDef>{
             CreateOperatorDef(
                 "BatchMatMul",
                 "",
@@ -166,6 +211,20 @@ class GetBatchMatMulGradient : public GradientMakerBase {
                 trans_a_arg)};
       }
     }
+
+    if (broadcast) {
+      // The gradient of the input with fewer batch dimensions comes out with
+      // the batch dimensions of the other one, and is summed back over them.
+      for (int k = 0; k < 2; ++k) {
+        grad_ops[k].set_output(0, GI(k) + "_autogen_pre_red");
+        grad_ops.push_back(CreateOperatorDef(
+            "SumReduceLike",
+            "",
+            vector<string>{GI(k) + "_autogen_pre_red", I(k)},
+            vector<string>{GI(k)}));
+      }
+    }
+    return grad_ops;
   }
 
   bool CopyArguments() const override {
@@ -17,9 +17,13 @@
 #ifndef CAFFE2_OPERATORS_MATMUL_OP_H_
 #define CAFFE2_OPERATORS_MATMUL_OP_H_
 
+#include <algorithm>
+#include <type_traits>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
@@ -31,7 +35,11 @@ class BatchMatMulOp final : public Operator<Context> {
       : Operator<Context>(operator_def, ws),
         trans_a_(OperatorBase::GetSingleArgument<int>("trans_a", 0)),
         trans_b_(OperatorBase::GetSingleArgument<int>("trans_b", 0)),
-        use_scratch_(OperatorBase::GetSingleArgument<int>("use_scratch", 0)) {
+        broadcast_(OperatorBase::GetSingleArgument<int>("broadcast", 0)),
+        use_scratch_(OperatorBase::GetSingleArgument<int>("use_scratch", 0)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
     if (use_scratch_)
       scratch_ = std::make_shared<Tensor<Context> >();
   }
@@ -47,33 +55,43 @@ class BatchMatMulOp final : public Operator<Context> {
     const auto& B = Input(1);
     auto* Y = Output(0);
 
-    CAFFE_ENFORCE_EQ(A.ndim(), B.ndim());
-    auto ndim = A.ndim();
-    CAFFE_ENFORCE_GE(ndim, 2);
-    for (int axis = 0; axis < (ndim - 2); ++axis) {
+    const int a_ndim = A.ndim();
+    const int b_ndim = B.ndim();
+    CAFFE_ENFORCE_GE(a_ndim, 2);
+    CAFFE_ENFORCE_GE(b_ndim, 2);
+    if (!broadcast_) {
+      CAFFE_ENFORCE_EQ(a_ndim, b_ndim);
+    }
+    // With broadcasting, the batch dims of the input with fewer of them must
+    // be the trailing batch dims of the other one, as for SumReduceLike.
+    const auto& big = a_ndim >= b_ndim ? A : B;
+    const auto& small = a_ndim >= b_ndim ? B : A;
+    const int ndim = big.ndim();
+    const int offset = big.ndim() - small.ndim();
+    for (int axis = 0; axis < small.ndim() - 2; ++axis) {
       CAFFE_ENFORCE_EQ(
-          A.dim32(axis),
-          B.dim32(axis),
+          big.dim32(axis + offset),
+          small.dim32(axis),
           "Every axis of A and B should match except for the last two. Axis No",
-          axis);
+          axis + offset);
     }
 
     int a_dim0, a_dim1, b_dim0, b_dim1;
 
     if (trans_a_) {
-      a_dim0 = A.dim32(ndim - 1);
-      a_dim1 = A.dim32(ndim - 2);
+      a_dim0 = A.dim32(a_ndim - 1);
+      a_dim1 = A.dim32(a_ndim - 2);
     } else {
-      a_dim0 = A.dim32(ndim - 2);
-      a_dim1 = A.dim32(ndim - 1);
+      a_dim0 = A.dim32(a_ndim - 2);
+      a_dim1 = A.dim32(a_ndim - 1);
     }
 
     if (trans_b_) {
-      b_dim0 = B.dim32(ndim - 1);
-      b_dim1 = B.dim32(ndim - 2);
+      b_dim0 = B.dim32(b_ndim - 1);
+      b_dim1 = B.dim32(b_ndim - 2);
     } else {
-      b_dim0 = B.dim32(ndim - 2);
-      b_dim1 = B.dim32(ndim - 1);
+      b_dim0 = B.dim32(b_ndim - 2);
+      b_dim1 = B.dim32(b_ndim - 1);
     }
 
     // Error checking
@@ -89,44 +107,79 @@ class BatchMatMulOp final : public Operator<Context> {
         " ",
         b_dim1);
 
-    auto y_dims = A.dims();
+    auto y_dims = big.dims();
     y_dims[ndim - 2] = a_dim0;
     y_dims[ndim - 1] = b_dim1;
     Y->Resize(y_dims);
 
-    const auto batches = A.size_to_dim(ndim - 2);
+    const auto batches = big.size_to_dim(ndim - 2);
     if (!batches) {
       Y->template mutable_data<T>(); // create output tensor
       return true;
     }
-
-    // Y = A * B
-    math::GemmBatched<T, Context, Engine>(
-        trans_a_ ? CblasTrans : CblasNoTrans,
-        trans_b_ ? CblasTrans : CblasNoTrans,
-        A.size(),
-        batches,
-        B.size(),
-        batches,
-        a_dim0, // M
-        b_dim1, // N
-        a_dim1, // K
-        1,
-        A.template data<T>(),
-        B.template data<T>(),
-        0,
-        Y->template mutable_data<T>(),
-        &context_,
-        use_scratch_ ? scratch_.get() : nullptr);
+    // The input with fewer batch dims is reused every inner_batches matrices.
+    const auto inner_batches = small.size_to_dim(small.ndim() - 2);
+    const bool a_repeats = A.ndim() < ndim;
+    const bool b_repeats = B.ndim() < ndim;
+    const auto a_matrix = A.size_from_dim(a_ndim - 2);
+    const auto b_matrix = B.size_from_dim(b_ndim - 2);
+    const auto y_matrix = a_dim0 * b_dim1;
+    const T* a_data = A.template data<T>();
+    const T* b_data = B.template data<T>();
+    T* y_data = Y->template mutable_data<T>();
+
+    // Y = A * B for the output matrices [begin, end), one GemmBatched call
+    // per run of matrices that are contiguous in both inputs.
+    auto run = [&](TIndex begin, TIndex end) {
+      for (TIndex i = begin; i < end;) {
+        const TIndex inner = i % inner_batches;
+        const TIndex count = std::min(end - i, inner_batches - inner);
+        math::GemmBatched<T, Context, Engine>(
+            trans_a_ ? CblasTrans : CblasNoTrans,
+            trans_b_ ? CblasTrans : CblasNoTrans,
+            count * a_matrix,
+            count,
+            count * b_matrix,
+            count,
+            a_dim0, // M
+            b_dim1, // N
+            a_dim1, // K
+            1,
+            a_data + (a_repeats ? inner : i) * a_matrix,
+            b_data + (b_repeats ? inner : i) * b_matrix,
+            0,
+            y_data + i * y_matrix,
+            &context_,
+            use_scratch_ ? scratch_.get() : nullptr);
+        i += count;
+      }
+    };
+    // Only the CPU implementation spreads the batch over threads.
+    const TIndex num_chunks = std::is_same<Context, CPUContext>::value
+        ? std::min<TIndex>(num_threads_, batches)
+        : 1;
+    if (num_chunks <= 1) {
+      run(0, batches);
+    } else {
+      ws_->GetThreadPool()->runChunks(
+          [&](int /* unused */, size_t c) {
+            run(c * batches / num_chunks, (c + 1) * batches / num_chunks);
+          },
+          num_chunks);
+    }
     return true;
   }
 
  protected:
   bool trans_a_;
   bool trans_b_;
+  bool broadcast_;
 
   bool use_scratch_;
   std::shared_ptr<Tensor<Context> > scratch_;
+
+  const int num_threads_;
+  Workspace* ws_;
 };
 
 } // namespace caffe2
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+void FillInput(Workspace* ws, const string& name, const vector<TIndex>& dims) {
+  FillTensorWith(ws, name, dims, [](TIndex i) { return (i * 7 % 11) - 5; });
+}
+
+// Runs BatchMatMul on A of shape a_dims and B of shape b_dims and checks it
+// against a naive product, the input with fewer batch dims being repeated
+// over the leading ones of the other.
+void CheckBatchMatMul(
+    const vector<TIndex>& a_dims,
+    const vector<TIndex>& b_dims,
+    bool trans_a,
+    bool trans_b,
+    int num_threads) {
+  Workspace ws;
+  FillInput(&ws, "A", a_dims);
+  FillInput(&ws, "B", b_dims);
+  OperatorDef def = CreateOperatorDef(
+      "BatchMatMul",
+      "",
+      {"A", "B"},
+      {"Y"},
+      {MakeArgument<int>("trans_a", trans_a),
+       MakeArgument<int>("trans_b", trans_b),
+       MakeArgument<int>("broadcast", 1),
+       MakeArgument<int>("num_threads", num_threads)});
+  auto op = CreateOperator(def, &ws);
+  ASSERT_TRUE(op->Run());
+  const auto& A = ws.GetBlob("A")->Get<TensorCPU>();
+  const auto& B = ws.GetBlob("B")->Get<TensorCPU>();
+  const auto& Y = ws.GetBlob("Y")->Get<TensorCPU>();
+
+  const int a_ndim = a_dims.size();
+  const int b_ndim = b_dims.size();
+  const int M = a_dims[trans_a ? a_ndim - 1 : a_ndim - 2];
+  const int K = a_dims[trans_a ? a_ndim - 2 : a_ndim - 1];
+  const int N = b_dims[trans_b ? b_ndim - 2 : b_ndim - 1];
+  const auto& y_dims = a_ndim >= b_ndim ? a_dims : b_dims;
+  ASSERT_EQ(Y.ndim(), y_dims.size());
+  EXPECT_EQ(Y.dim(Y.ndim() - 2), M);
+  EXPECT_EQ(Y.dim(Y.ndim() - 1), N);
+  const int a_batches = A.size() / (M * K);
+  const int b_batches = B.size() / (K * N);
+  const int batches = Y.size() / (M * N);
+  for (int b = 0; b < batches; ++b) {
+    const float* a = A.data<float>() + (b % a_batches) * M * K;
+    const float* bm = B.data<float>() + (b % b_batches) * K * N;
+    const float* y = Y.data<float>() + b * M * N;
+    for (int i = 0; i < M; ++i) {
+      for (int j = 0; j < N; ++j) {
+        float sum = 0;
+        for (int k = 0; k < K; ++k) {
+          sum += (trans_a ? a[k * M + i] : a[i * K + k]) *
+              (trans_b ? bm[j * K + k] : bm[k * N + j]);
+        }
+        ASSERT_EQ(y[i * N + j], sum) << b << " " << i << " " << j;
+      }
+    }
+  }
+}
+
+} // namespace
+
+TEST(BatchMatMulOpTest, SameBatchDims) {
+  for (int num_threads : {1, 3}) {
+    CheckBatchMatMul({5, 3, 4}, {5, 4, 2}, false, false, num_threads);
+    CheckBatchMatMul({2, 3, 4, 3}, {2, 3, 2, 4}, true, true, num_threads);
+  }
+}
+
+TEST(BatchMatMulOpTest, Broadcast) {
+  for (int num_threads : {1, 3}) {
+    CheckBatchMatMul({4, 3, 2, 5}, {3, 5, 6}, false, false, num_threads);
+    CheckBatchMatMul({3, 5, 2}, {4, 3, 6, 5}, true, true, num_threads);
+    CheckBatchMatMul({7, 2, 5}, {5, 3}, false, false, num_threads);
+  }
+}
+
+TEST(BatchMatMulOpTest, BroadcastGradientIsReduced) {
+  OperatorDef def = CreateOperatorDef(
+      "BatchMatMul",
+      "",
+      {"A", "B"},
+      {"Y"},
+      {MakeArgument<int>("broadcast", 1)});
+  vector<GradientWrapper> g_output(1);
+  g_output[0].dense_ = "Y_grad";
+  const auto meta = GetGradientForOp(def, g_output);
+  ASSERT_EQ(meta.ops_.size(), 4);
+  EXPECT_EQ(meta.ops_[2].type(), "SumReduceLike");
+  EXPECT_EQ(meta.ops_[2].output(0), "A_grad");
+  EXPECT_EQ(meta.ops_[3].type(), "SumReduceLike");
+  EXPECT_EQ(meta.ops_[3].output(0), "B_grad");
+
+  Workspace ws;
+  FillInput(&ws, "A", {4, 3, 2, 5});
+  FillInput(&ws, "B", {3, 5, 6});
+  FillInput(&ws, "Y_grad", {4, 3, 2, 6});
+  for (const auto& op_def : meta.ops_) {
+    ASSERT_TRUE(ws.RunOperatorOnce(op_def));
+  }
+  EXPECT_EQ(
+      ws.GetBlob("A_grad")->Get<TensorCPU>().dims(),
+      vector<TIndex>({4, 3, 2, 5}));
+  EXPECT_EQ(
+      ws.GetBlob("B_grad")->Get<TensorCPU>().dims(), vector<TIndex>({3, 5, 6}));
+}
+
+} // namespace caffe2
@@ -0,0 +1,246 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/beam_search_step_op.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+#include "caffe2/perfkernels/transcendental.h"
+#include "caffe2/perfkernels/vector_ops.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Orders (score, candidate) pairs so that the top of a priority queue is the
+// worst candidate kept: lowest score, then highest index.
+struct CandidateCmp {
+  bool operator()(
+      const std::pair<float, TIndex>& lhs,
+      const std::pair<float, TIndex>& rhs) {
+    return (
+        lhs.first > rhs.first ||
+        (lhs.first == rhs.first && lhs.second < rhs.second));
+  }
+};
+
+} // namespace
+
+template <>
+void BeamSearchStepOp<CPUContext>::ReorderState(
+    const TensorCPU& state,
+    const int* prev_index,
+    TensorCPU* output) {
+  CAFFE_ENFORCE_GE(state.ndim(), 1);
+  const TIndex num_rows = state.dim(0);
+  const TIndex row_size = state.size_from_dim(1);
+  const auto& meta = state.meta();
+  const size_t row_bytes = row_size * meta.itemsize();
+  auto dims = state.dims();
+  dims[0] = beam_size_;
+
+  if (output != &state) {
+    output->Resize(dims);
+    char* dst = static_cast<char*>(output->raw_mutable_data(meta));
+    const char* src = static_cast<const char*>(state.raw_data());
+    for (int j = 0; j < beam_size_; ++j) {
+      context_.CopyItems<CPUContext, CPUContext>(
+          meta,
+          row_size,
+          src + prev_index[j] * row_bytes,
+          dst + j * row_bytes);
+    }
+    return;
+  }
+
+  if (num_rows != beam_size_) {
+    // The number of hypotheses changes, typically on the first step.
+    state_buffer_.CopyFrom(state, &context_);
+    ReorderState(state_buffer_, prev_index, output);
+    return;
+  }
+
+  // In place, hypotheses that continue from the same row are not touched,
+  // and only the rows that are read after being overwritten are saved.
+  vector<int> saved_row(num_rows, -1);
+  int num_saved = 0;
+  for (int j = 0; j < beam_size_; ++j) {
+    const int source = prev_index[j];
+    if (source != j && prev_index[source] != source &&
+        saved_row[source] < 0) {
+      saved_row[source] = num_saved++;
+    }
+  }
+  char* data = static_cast<char*>(output->raw_mutable_data(meta));
+  char* saved = nullptr;
+  if (num_saved > 0) {
+    state_buffer_.Resize(num_saved, row_size);
+    saved = static_cast<char*>(state_buffer_.raw_mutable_data(meta));
+    for (int i = 0; i < num_rows; ++i) {
+      if (saved_row[i] >= 0) {
+        context_.CopyItems<CPUContext, CPUContext>(
+            meta,
+            row_size,
+            data + i * row_bytes,
+            saved + saved_row[i] * row_bytes);
+      }
+    }
+  }
+  for (int j = 0; j < beam_size_; ++j) {
+    const int source = prev_index[j];
+    if (source == j) {
+      continue;
+    }
+    const char* src = saved_row[source] >= 0
+        ? saved + saved_row[source] * row_bytes
+        : data + source * row_bytes;
+    context_.CopyItems<CPUContext, CPUContext>(
+        meta, row_size, src, data + j * row_bytes);
+  }
+}
+
+template <>
+bool BeamSearchStepOp<CPUContext>::RunOnDevice() {
+  const auto& X = Input(0);
+  const auto& scores_prev = Input(1);
+  CAFFE_ENFORCE_EQ(X.ndim(), 2);
+  const int num_hypos = X.dim32(0);
+  const int V = X.dim32(1);
+  CAFFE_ENFORCE_EQ(scores_prev.size(), num_hypos);
+  CAFFE_ENFORCE_LE(
+      beam_size_,
+      static_cast<TIndex>(num_hypos) * V,
+      "beam_size should not be greater than the number of candidates");
+
+  exp_buffer_.resize(V);
+  const size_t k = beam_size_;
+  std::priority_queue<
+      std::pair<float, TIndex>,
+      std::vector<std::pair<float, TIndex>>,
+      CandidateCmp>
+      PQ;
+  for (int i = 0; i < num_hypos; ++i) {
+    const float* x = X.data<float>() + static_cast<TIndex>(i) * V;
+    // Score of token v is base + x[v], with the log-softmax normalizer of the
+    // row folded into base.
+    float base = scores_prev.data<float>()[i];
+    if (log_softmax_) {
+      const float row_max = *std::max_element(x, x + V);
+      for (int v = 0; v < V; ++v) {
+        exp_buffer_[v] = x[v] - row_max;
+      }
+      vector_exp(V, exp_buffer_.data(), exp_buffer_.data());
+      base -= row_max + std::log(vector_sum(V, exp_buffer_.data()));
+    }
+    for (int v = 0; v < V; ++v) {
+      const float score = base + x[v];
+      if (PQ.size() < k || score > PQ.top().first) {
+        PQ.push(std::make_pair(score, static_cast<TIndex>(i) * V + v));
+        if (PQ.size() > k) {
+          PQ.pop();
+        }
+      }
+    }
+  }
+
+  auto* scores = Output(0);
+  auto* tokens = Output(1);
+  auto* prev_index = Output(2);
+  scores->Resize(beam_size_);
+  tokens->Resize(beam_size_);
+  prev_index->Resize(beam_size_);
+  float* scores_data = scores->mutable_data<float>();
+  int* tokens_data = tokens->mutable_data<int>();
+  int* prev_index_data = prev_index->mutable_data<int>();
+  for (int j = beam_size_ - 1; j >= 0; --j) {
+    const auto& top = PQ.top();
+    scores_data[j] = top.first;
+    tokens_data[j] = top.second % V;
+    prev_index_data[j] = top.second / V;
+    PQ.pop();
+  }
+
+  for (int i = 2; i < InputSize(); ++i) {
+    ReorderState(Input(i), prev_index_data, Output(i + 1));
+  }
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(BeamSearchStep, BeamSearchStepOp<CPUContext>);
+
+OPERATOR_SCHEMA(BeamSearchStep)
+    .NumInputs(2, INT_MAX)
+    .NumOutputs(3, INT_MAX)
+    .NumInputsOutputs([](int in, int out) { return out - 3 == in - 2; })
+    .AllowInplace([](int in, int out) { return in >= 2 && out == in + 1; })
+    .TensorInferenceFunction([](const OperatorDef& def,
+                                const vector<TensorShape>& in) {
+      ArgumentHelper helper(def);
+      const int beam_size = helper.GetSingleArgument<int>("beam_size", -1);
+      vector<TensorShape> out(3);
+      out[0] = CreateTensorShape(vector<int>{beam_size}, TensorProto::FLOAT);
+      out[1] = CreateTensorShape(vector<int>{beam_size}, TensorProto::INT32);
+      out[2] = CreateTensorShape(vector<int>{beam_size}, TensorProto::INT32);
+      for (int i = 2; i < in.size(); ++i) {
+        out.push_back(in[i]);
+        out.back().set_dims(0, beam_size);
+      }
+      return out;
+    })
+    .SetDoc(R"DOC(
+One step of beam search decoding. Each of the current hypotheses, the rows of
+X, is extended by every token of the vocabulary, scored by the score of the
+hypothesis plus the log-softmax of its row of X, and the beam_size best
+extensions over all hypotheses are kept. Equivalent to LogSoftmax, a broadcast
+Add of the previous scores and a TopK over the flattened scores, without
+storing the scores of all the extensions.
+
+The remaining inputs are recurrent states whose first dimension indexes the
+hypotheses. They are reordered to follow the hypotheses that were kept, into
+the corresponding outputs. When run in-place, only the rows of hypotheses
+that were not extended from the same row are written. On the first step
+there may be a single hypothesis, which the states are expanded from.
+
+Given two extensions with the same score, the one of the lower hypothesis and
+then the lower token appears first.
+    )DOC")
+    .Arg("beam_size", "Number of hypotheses to keep")
+    .Arg(
+        "log_softmax",
+        "Whether X holds logits to normalize (default), or log-probabilities")
+    .Input(
+        0,
+        "X",
+        "Logits, or log-probabilities, of the next token for every hypothesis, "
+        "of shape [num_hypotheses, vocab_size]")
+    .Input(
+        1,
+        "scores_prev",
+        "Accumulated log-probability of every hypothesis, of size "
+        "num_hypotheses")
+    .Output(0, "scores", "Scores of the kept hypotheses, in decreasing order")
+    .Output(1, "tokens", "Last token of each kept hypothesis, int32")
+    .Output(
+        2,
+        "prev_index",
+        "Index of the hypothesis each kept hypothesis extends, int32");
+
+SHOULD_NOT_DO_GRADIENT(BeamSearchStep);
+
+} // namespace caffe2
@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_BEAM_SEARCH_STEP_OP_H_
+#define CAFFE2_OPERATORS_BEAM_SEARCH_STEP_OP_H_
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+// One step of beam search decoding: extends each of the current hypotheses
+// by every token, keeps the beam_size best of them and reorders the
+// recurrent states to follow the hypotheses they were extended from.
+template <class Context>
+class BeamSearchStepOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+
+  BeamSearchStepOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        OP_SINGLE_ARG(int, "beam_size", beam_size_, -1),
+        OP_SINGLE_ARG(bool, "log_softmax", log_softmax_, true) {
+    CAFFE_ENFORCE(beam_size_ >= 1, "beam_size argument must be >= 1");
+  }
+
+  bool RunOnDevice() override;
+
+ protected:
+  void ReorderState(
+      const Tensor<Context>& state,
+      const int* prev_index,
+      Tensor<Context>* output);
+
+  int beam_size_;
+  bool log_softmax_;
+  // exp(x - max) of one row of the input.
+  vector<float> exp_buffer_;
+  // Rows of a state that are overwritten while still needed.
+  Tensor<Context> state_buffer_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_BEAM_SEARCH_STEP_OP_H_
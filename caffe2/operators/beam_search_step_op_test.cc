@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Checks one step against a brute force search over all extensions, and that
+// the state follows the hypotheses, either in-place or not.
+void CheckBeamSearchStep(int num_hypos, int V, int beam_size, bool inplace) {
+  Workspace ws;
+  auto* X = AddTensor(&ws, "X", {num_hypos, V});
+  auto* scores_prev = AddTensor(&ws, "scores_prev", {num_hypos});
+  auto* state = AddTensor(&ws, "state", {num_hypos, 3});
+  for (int i = 0; i < X->size(); ++i) {
+    X->mutable_data<float>()[i] = (i * 37 % 101) * 0.05f - (i % 3);
+  }
+  for (int i = 0; i < num_hypos; ++i) {
+    scores_prev->mutable_data<float>()[i] = -0.5f * (i % 2);
+    for (int j = 0; j < 3; ++j) {
+      state->mutable_data<float>()[i * 3 + j] = i * 10 + j;
+    }
+  }
+
+  // (score, hypothesis, token), best first.
+  vector<std::tuple<float, int, int>> expected;
+  for (int i = 0; i < num_hypos; ++i) {
+    const float* x = X->data<float>() + i * V;
+    float sum = 0;
+    for (int v = 0; v < V; ++v) {
+      sum += std::exp(x[v]);
+    }
+    for (int v = 0; v < V; ++v) {
+      expected.emplace_back(
+          -(scores_prev->data<float>()[i] + x[v] - std::log(sum)), i, v);
+    }
+  }
+  std::sort(expected.begin(), expected.end());
+
+  const string state_out = inplace ? "state" : "state_out";
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "BeamSearchStep",
+      "",
+      {"X", "scores_prev", "state"},
+      {"scores", "tokens", "prev_index", state_out},
+      {MakeArgument("beam_size", beam_size)})));
+
+  const auto& scores = ws.GetBlob("scores")->Get<TensorCPU>();
+  const auto& tokens = ws.GetBlob("tokens")->Get<TensorCPU>();
+  const auto& prev_index = ws.GetBlob("prev_index")->Get<TensorCPU>();
+  const auto& new_state = ws.GetBlob(state_out)->Get<TensorCPU>();
+  ASSERT_EQ(scores.size(), beam_size);
+  EXPECT_EQ(new_state.dims(), vector<TIndex>({beam_size, 3}));
+  for (int j = 0; j < beam_size; ++j) {
+    EXPECT_NEAR(scores.data<float>()[j], -std::get<0>(expected[j]), 1e-5);
+    EXPECT_EQ(prev_index.data<int>()[j], std::get<1>(expected[j])) << j;
+    EXPECT_EQ(tokens.data<int>()[j], std::get<2>(expected[j])) << j;
+    for (int c = 0; c < 3; ++c) {
+      EXPECT_EQ(
+          new_state.data<float>()[j * 3 + c],
+          prev_index.data<int>()[j] * 10 + c);
+    }
+  }
+}
+
+} // namespace
+
+TEST(BeamSearchStepOpTest, MatchesExhaustiveSearch) {
+  CheckBeamSearchStep(1, 10, 4, false);
+  CheckBeamSearchStep(4, 10, 4, false);
+  CheckBeamSearchStep(5, 3, 5, false);
+}
+
+TEST(BeamSearchStepOpTest, ReordersStateInPlace) {
+  CheckBeamSearchStep(1, 10, 4, true);
+  CheckBeamSearchStep(4, 10, 4, true);
+  CheckBeamSearchStep(5, 3, 5, true);
+  CheckBeamSearchStep(6, 2, 6, true);
+}
+
+} // namespace caffe2
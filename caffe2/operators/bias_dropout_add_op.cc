@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/operators/bias_dropout_add_op.h"
+
+namespace caffe2 {
+
+template <>
+bool BiasDropoutAddOp<float, CPUContext>::RunOnDevice() {
+  const auto& X = Input(0);
+  const auto& bias = Input(1);
+  const auto& residual = Input(2);
+  auto* Y = Output(0);
+  CAFFE_ENFORCE_GE(X.ndim(), 1);
+  CAFFE_ENFORCE(
+      residual.dims() == X.dims(),
+      "The residual has to have the shape of X: ",
+      residual.dims(),
+      " vs ",
+      X.dims());
+  const int D = X.dim32(X.ndim() - 1);
+  CAFFE_ENFORCE_EQ(bias.size(), D);
+  const int N = D > 0 ? X.size() / D : 0;
+  Y->ResizeLike(X);
+
+  const float* Xdata = X.data<float>();
+  const float* bias_data = bias.data<float>();
+  const float* residual_data = residual.data<float>();
+  float* Ydata = Y->mutable_data<float>();
+  if (is_test_) {
+    for (int i = 0; i < N; ++i) {
+      for (int j = 0; j < D; ++j) {
+        const int k = i * D + j;
+        Ydata[k] = residual_data[k] + Xdata[k] + bias_data[j];
+      }
+    }
+    return true;
+  }
+
+  const float scale = 1. / (1. - ratio_);
+  auto* mask = Output(1);
+  mask->ResizeLike(X);
+  bool* mask_data = mask->mutable_data<bool>();
+  // mask=true means keep, and mask=false means not keep, so we will
+  // generate probability depending on 1-ratio.
+  context_.PhiloxRandGenerator().Bernoulli(X.size(), 1. - ratio_, mask_data);
+  for (int i = 0; i < N; ++i) {
+    for (int j = 0; j < D; ++j) {
+      const int k = i * D + j;
+      Ydata[k] = residual_data[k] +
+          (Xdata[k] + bias_data[j]) * scale * mask_data[k];
+    }
+  }
+  return true;
+}
+
+template <>
+bool BiasDropoutAddGradientOp<float, CPUContext>::RunOnDevice() {
+  const auto& dY = Input(0);
+  auto* dX = Output(0);
+  auto* dbias = Output(1);
+  CAFFE_ENFORCE_GE(dY.ndim(), 1);
+  const int D = dY.dim32(dY.ndim() - 1);
+  const int N = D > 0 ? dY.size() / D : 0;
+  dX->ResizeLike(dY);
+  dbias->Resize(D);
+
+  const float* dYdata = dY.data<float>();
+  float* dXdata = dX->mutable_data<float>();
+  float* dbias_data = dbias->mutable_data<float>();
+  math::Set<float, CPUContext>(D, 0.f, dbias_data, &context_);
+  const bool* mask_data = nullptr;
+  if (!is_test_) {
+    const auto& mask = Input(1);
+    CAFFE_ENFORCE_EQ(dY.size(), mask.size());
+    mask_data = mask.data<bool>();
+  }
+  const float scale = is_test_ ? 1. : 1. / (1. - ratio_);
+  for (int i = 0; i < N; ++i) {
+    for (int j = 0; j < D; ++j) {
+      const int k = i * D + j;
+      const float dx = mask_data ? dYdata[k] * mask_data[k] * scale : dYdata[k];
+      dXdata[k] = dx;
+      dbias_data[j] += dx;
+    }
+  }
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(BiasDropoutAdd, BiasDropoutAddOp<float, CPUContext>);
+REGISTER_CPU_OPERATOR(
+    BiasDropoutAddGradient,
+    BiasDropoutAddGradientOp<float, CPUContext>);
+
+OPERATOR_SCHEMA(BiasDropoutAdd)
+    .NumInputs(3)
+    .NumOutputs(1, 2)
+    .AllowInplace({{0, 0}, {2, 0}})
+    .TensorInferenceFunction([](const OperatorDef& def,
+                                const vector<TensorShape>& in) {
+      vector<TensorShape> out;
+      ArgumentHelper argsHelper(def);
+      out.push_back(in[0]);
+      auto output_mask = !argsHelper.GetSingleArgument<bool>("is_test", 0);
+      if (output_mask) {
+        out.push_back(in[0]);
+        out[1].set_data_type(TensorProto_DataType_BOOL);
+      }
+      return out;
+    })
+    .SetDoc(R"DOC(
+Computes Y = residual + Dropout(X + bias), with the bias broadcast along the
+last dimension of X, in a single pass instead of the three of Add, Dropout
+and Sum. This is the sequence that follows the attention and feed-forward
+projections of a transformer block. As with Dropout, the scaling is done in
+the training phase and the mask is only produced when not in test mode.
+)DOC")
+    .Arg("ratio", "(float, default 0.5) the ratio of random dropout")
+    .ArgIsTest(
+        "(int) if nonzero, run in test mode where "
+        "Y = residual + X + bias.")
+    .Input(0, "X", "The input data, of shape (..., D).")
+    .Input(1, "bias", "The bias, of shape (D).")
+    .Input(2, "residual", "Added to the result, of the shape of X.")
+    .Output(0, "Y", "The output.")
+    .Output(
+        1,
+        "mask",
+        "The output mask. If is_test is nonzero, this output is not filled.");
+
+OPERATOR_SCHEMA(BiasDropoutAddGradient)
+    .NumInputs(1, 2)
+    .NumOutputs(2)
+    .AllowInplace({{0, 0}});
+
+class GetBiasDropoutAddGradient : public GradientMakerBase {
+  using GradientMakerBase::GradientMakerBase;
+  vector<OperatorDef> GetGradientDefs() override {
+    ArgumentHelper argshelper(def_);
+    auto is_test = argshelper.GetSingleArgument<bool>("is_test", 0);
+    SetDense(2, GO(0));
+    return SingleGradientDef(
+        "BiasDropoutAddGradient",
+        "",
+        is_test ? vector<string>{GO(0)} : vector<string>{GO(0), O(1)},
+        vector<string>{GI(0), GI(1)});
+  }
+};
+REGISTER_GRADIENT(BiasDropoutAdd, GetBiasDropoutAddGradient);
+} // namespace caffe2
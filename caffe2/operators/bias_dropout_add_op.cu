@@ -0,0 +1,193 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cub/block/block_reduce.cuh>
+
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/operators/bias_dropout_add_op.h"
+
+namespace caffe2 {
+
+namespace {
+__global__ void BiasAddResidualKernel(
+    const int N,
+    const int D,
+    const float* Xdata,
+    const float* bias,
+    const float* residual,
+    float* Ydata) {
+  CUDA_1D_KERNEL_LOOP(i, N * D) {
+    Ydata[i] = residual[i] + Xdata[i] + bias[i % D];
+  }
+}
+
+__global__ void BiasDropoutAddKernel(
+    const int N,
+    const int D,
+    const float ratio,
+    const float* Xdata,
+    const float* bias,
+    const float* residual,
+    const float* uniform,
+    float* Ydata,
+    bool* maskdata) {
+  const float scale = 1. / (1. - ratio);
+  CUDA_1D_KERNEL_LOOP(i, N * D) {
+    const bool keep = uniform[i] > ratio;
+    maskdata[i] = keep;
+    Ydata[i] = residual[i] + (Xdata[i] + bias[i % D]) * scale * keep;
+  }
+}
+} // namespace
+
+template <>
+bool BiasDropoutAddOp<float, CUDAContext>::RunOnDevice() {
+  const auto& X = Input(0);
+  const auto& bias = Input(1);
+  const auto& residual = Input(2);
+  auto* Y = Output(0);
+  CAFFE_ENFORCE_GE(X.ndim(), 1);
+  CAFFE_ENFORCE(
+      residual.dims() == X.dims(),
+      "The residual has to have the shape of X: ",
+      residual.dims(),
+      " vs ",
+      X.dims());
+  const int D = X.dim32(X.ndim() - 1);
+  CAFFE_ENFORCE_EQ(bias.size(), D);
+  const int N = D > 0 ? X.size() / D : 0;
+  Y->ResizeLike(X);
+  if (is_test_) {
+    BiasAddResidualKernel<<<
+        CAFFE_GET_BLOCKS(X.size()),
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context_.cuda_stream()>>>(
+        N,
+        D,
+        X.data<float>(),
+        bias.data<float>(),
+        residual.data<float>(),
+        Y->mutable_data<float>());
+    return true;
+  }
+
+  // Y may be X or the residual, so the random numbers get their own buffer.
+  auto* mask = Output(1);
+  mask->ResizeLike(X);
+  uniform_.ResizeLike(X);
+  if (X.size() > 0) {
+    CURAND_ENFORCE(curandGenerateUniform(
+        context_.curand_generator(),
+        uniform_.mutable_data<float>(),
+        X.size()));
+  }
+  BiasDropoutAddKernel<<<
+      CAFFE_GET_BLOCKS(X.size()),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context_.cuda_stream()>>>(
+      N,
+      D,
+      ratio_,
+      X.data<float>(),
+      bias.data<float>(),
+      residual.data<float>(),
+      uniform_.data<float>(),
+      Y->mutable_data<float>(),
+      mask->mutable_data<bool>());
+  return true;
+}
+
+namespace {
+__global__ void BiasDropoutAddGradientKernel(
+    const int N,
+    const float* dYdata,
+    const bool* maskdata,
+    const float scale,
+    float* dXdata) {
+  CUDA_1D_KERNEL_LOOP(i, N) {
+    dXdata[i] = maskdata ? dYdata[i] * maskdata[i] * scale : dYdata[i];
+  }
+}
+
+// One block per column: dbias[j] = sum_i dX[i, j]
+__global__ void ColumnSumKernel(
+    const int N,
+    const int D,
+    const float* dXdata,
+    float* dbias) {
+  typedef cub::BlockReduce<float, CAFFE_CUDA_NUM_THREADS> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage temp_storage;
+
+  for (int j = blockIdx.x; j < D; j += gridDim.x) {
+    float sum = 0;
+    for (int i = threadIdx.x; i < N; i += blockDim.x) {
+      sum += dXdata[i * D + j];
+    }
+    sum = BlockReduce(temp_storage).Sum(sum);
+    if (threadIdx.x == 0) {
+      dbias[j] = sum;
+    }
+    __syncthreads();
+  }
+}
+} // namespace
+
+template <>
+bool BiasDropoutAddGradientOp<float, CUDAContext>::RunOnDevice() {
+  const auto& dY = Input(0);
+  auto* dX = Output(0);
+  auto* dbias = Output(1);
+  CAFFE_ENFORCE_GE(dY.ndim(), 1);
+  const int D = dY.dim32(dY.ndim() - 1);
+  const int N = D > 0 ? dY.size() / D : 0;
+  dX->ResizeLike(dY);
+  dbias->Resize(D);
+  if (D == 0) {
+    dX->mutable_data<float>();
+    dbias->mutable_data<float>();
+    return true;
+  }
+
+  const bool* mask_data = nullptr;
+  if (!is_test_) {
+    const auto& mask = Input(1);
+    CAFFE_ENFORCE_EQ(dY.size(), mask.size());
+    mask_data = mask.data<bool>();
+  }
+  const float scale = is_test_ ? 1. : 1. / (1. - ratio_);
+  BiasDropoutAddGradientKernel<<<
+      CAFFE_GET_BLOCKS(dY.size()),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context_.cuda_stream()>>>(
+      dY.size(), dY.data<float>(), mask_data, scale, dX->mutable_data<float>());
+  ColumnSumKernel<<<
+      std::min(D, CAFFE_MAXIMUM_NUM_BLOCKS),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context_.cuda_stream()>>>(
+      N, D, dX->data<float>(), dbias->mutable_data<float>());
+  return true;
+}
+
+REGISTER_CUDA_OPERATOR(BiasDropoutAdd, BiasDropoutAddOp<float, CUDAContext>);
+REGISTER_CUDA_OPERATOR(
+    BiasDropoutAddGradient,
+    BiasDropoutAddGradientOp<float, CUDAContext>);
+} // namespace caffe2
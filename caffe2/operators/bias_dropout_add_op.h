@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_OPERATORS_BIAS_DROPOUT_ADD_OP_H_
+#define CAFFE2_OPERATORS_BIAS_DROPOUT_ADD_OP_H_
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// Y = residual + Dropout(X + bias) in a single pass over the data, as found
+// after the projections of a transformer block.
+template <typename T, class Context>
+class BiasDropoutAddOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  BiasDropoutAddOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        ratio_(OperatorBase::GetSingleArgument<float>("ratio", 0.5)),
+        is_test_(
+            OperatorBase::GetSingleArgument<int>(OpSchema::Arg_IsTest, 0)) {
+    CAFFE_ENFORCE_GE(ratio_, 0);
+    CAFFE_ENFORCE_LT(ratio_, 1);
+  }
+
+  bool RunOnDevice() override;
+
+ protected:
+  float ratio_;
+  bool is_test_;
+  // Uniform random numbers the mask is drawn from, on GPU.
+  Tensor<Context> uniform_;
+  // Input: X, bias, residual; Output: Y, mask.
+};
+
+template <typename T, class Context>
+class BiasDropoutAddGradientOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  BiasDropoutAddGradientOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        ratio_(OperatorBase::GetSingleArgument<float>("ratio", 0.5)),
+        is_test_(
+            OperatorBase::GetSingleArgument<int>(OpSchema::Arg_IsTest, 0)) {
+    CAFFE_ENFORCE_GE(ratio_, 0);
+    CAFFE_ENFORCE_LT(ratio_, 1);
+  }
+
+  bool RunOnDevice() override;
+
+ protected:
+  float ratio_;
+  bool is_test_;
+  // Input: dY, mask; Output: dX, dbias. The gradient of the residual is dY.
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_BIAS_DROPOUT_ADD_OP_H_
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+TensorCPU* AddInput(Workspace* ws, const string& name, vector<TIndex> dims) {
+  return FillTensorWith(
+      ws, name, dims, [](TIndex i) { return (i * 7 % 11) * 0.25f - 1; });
+}
+
+const TensorCPU& GetTensor(const Workspace& ws, const string& name) {
+  return ws.GetBlob(name)->Get<TensorCPU>();
+}
+
+} // namespace
+
+TEST(BiasDropoutAddTest, TestMode) {
+  Workspace ws;
+  const auto* X = AddInput(&ws, "X", {4, 3});
+  const auto* bias = AddInput(&ws, "bias", {3});
+  const auto* residual = AddInput(&ws, "residual", {4, 3});
+  // In-place on the residual.
+  auto def = CreateOperatorDef(
+      "BiasDropoutAdd",
+      "",
+      {"X", "bias", "residual"},
+      {"residual"},
+      {MakeArgument<int>("is_test", 1)});
+  vector<float> expected;
+  for (int i = 0; i < X->size(); ++i) {
+    expected.push_back(
+        residual->data<float>()[i] + X->data<float>()[i] +
+        bias->data<float>()[i % 3]);
+  }
+  ASSERT_TRUE(CreateOperator(def, &ws)->Run());
+  const auto& Y = GetTensor(ws, "residual");
+  for (int i = 0; i < Y.size(); ++i) {
+    EXPECT_FLOAT_EQ(Y.data<float>()[i], expected[i]);
+  }
+}
+
+TEST(BiasDropoutAddTest, TrainingAndGradient) {
+  Workspace ws;
+  const int N = 50;
+  const int D = 4;
+  const float ratio = 0.3;
+  const auto* X = AddInput(&ws, "X", {N, D});
+  const auto* bias = AddInput(&ws, "bias", {D});
+  const auto* residual = AddInput(&ws, "residual", {N, D});
+  auto def = CreateOperatorDef(
+      "BiasDropoutAdd",
+      "",
+      {"X", "bias", "residual"},
+      {"Y", "mask"},
+      {MakeArgument<float>("ratio", ratio), MakeArgument<int>("is_test", 0)});
+  ASSERT_TRUE(CreateOperator(def, &ws)->Run());
+  const auto& Y = GetTensor(ws, "Y");
+  const auto& mask = GetTensor(ws, "mask");
+  const float scale = 1 / (1 - ratio);
+  int kept = 0;
+  for (int i = 0; i < N * D; ++i) {
+    const bool keep = mask.data<bool>()[i];
+    kept += keep;
+    const float x = X->data<float>()[i] + bias->data<float>()[i % D];
+    EXPECT_FLOAT_EQ(
+        Y.data<float>()[i], residual->data<float>()[i] + keep * scale * x);
+  }
+  EXPECT_GT(kept, 0);
+  EXPECT_LT(kept, N * D);
+
+  auto* dY = AddInput(&ws, "Y_grad", {N, D});
+  vector<GradientWrapper> g_output(1);
+  g_output[0].dense_ = "Y_grad";
+  GradientOpsMeta meta = GetGradientForOp(def, g_output);
+  ASSERT_EQ(meta.ops_.size(), 1);
+  EXPECT_EQ(meta.g_input_[2].dense_, "Y_grad");
+  ASSERT_TRUE(CreateOperator(meta.ops_[0], &ws)->Run());
+  const auto& dX = GetTensor(ws, meta.g_input_[0].dense_);
+  const auto& dbias = GetTensor(ws, meta.g_input_[1].dense_);
+  vector<float> expected_dbias(D);
+  for (int i = 0; i < N * D; ++i) {
+    const float dx = dY->data<float>()[i] * mask.data<bool>()[i] * scale;
+    EXPECT_FLOAT_EQ(dX.data<float>()[i], dx);
+    expected_dbias[i % D] += dx;
+  }
+  ASSERT_EQ(dbias.size(), D);
+  for (int j = 0; j < D; ++j) {
+    EXPECT_NEAR(dbias.data<float>()[j], expected_dbias[j], 1e-4);
+  }
+}
+
+} // namespace caffe2
@@ -16,20 +16,116 @@
 
 #include "caffe2/operators/cast_op.h"
 
+#include "caffe2/perfkernels/type_conversion.h"
+
 namespace caffe2 {
 
+namespace {
+
+// float16 and bfloat16 have no conversions of their own, values of these
+// types are converted through float.
+template <typename T>
+inline T Widen(T x) {
+  return x;
+}
+
+inline float Widen(float16 x) {
+  return convert::To<float16, float>(x);
+}
+
+inline float Widen(bfloat16 x) {
+  return convert::To<bfloat16, float>(x);
+}
+
+template <typename DstType>
+struct Narrow {
+  template <typename T>
+  static DstType From(T x) {
+    return static_cast<DstType>(x);
+  }
+};
+
+template <>
+struct Narrow<float16> {
+  template <typename T>
+  static float16 From(T x) {
+    return convert::To<float, float16>(static_cast<float>(x));
+  }
+};
+
+template <>
+struct Narrow<bfloat16> {
+  template <typename T>
+  static bfloat16 From(T x) {
+    return convert::To<float, bfloat16>(static_cast<float>(x));
+  }
+};
+
+// Elementwise conversion of N values. The conversions the perfkernels provide
+// are vectorized.
+template <typename DstType, typename SrcType>
+struct CastKernel {
+  static void Run(TIndex N, const SrcType* x, DstType* y) {
+    for (TIndex i = 0; i < N; ++i) {
+      y[i] = Narrow<DstType>::From(Widen(x[i]));
+    }
+  }
+};
+
+template <>
+struct CastKernel<float16, float> {
+  static void Run(TIndex N, const float* x, float16* y) {
+    float_to_float16(N, x, y);
+  }
+};
+
+template <>
+struct CastKernel<float, float16> {
+  static void Run(TIndex N, const float16* x, float* y) {
+    float16_to_float(N, x, y);
+  }
+};
+
+template <>
+struct CastKernel<bfloat16, float> {
+  static void Run(TIndex N, const float* x, bfloat16* y) {
+    float_to_bfloat16(N, x, y);
+  }
+};
+
+template <>
+struct CastKernel<float, bfloat16> {
+  static void Run(TIndex N, const bfloat16* x, float* y) {
+    bfloat16_to_float(N, x, y);
+  }
+};
+
+template <>
+struct CastKernel<float, int32_t> {
+  static void Run(TIndex N, const int32_t* x, float* y) {
+    int32_to_float(N, x, y);
+  }
+};
+
+template <>
+struct CastKernel<int32_t, float> {
+  static void Run(TIndex N, const float* x, int32_t* y) {
+    float_to_int32(N, x, y);
+  }
+};
+
+} // namespace
+
 template <>
 template <typename DstType, typename SrcType>
 bool CastOp<CPUContext>::DoRunWithType() {
   auto& input = Input(0);
   auto* output = Output(0);
   output->ResizeLike(input);
-  const auto* data = input.template data<SrcType>();
-  auto* out = output->template mutable_data<DstType>();
-  auto N = input.size();
-  for (TIndex i = 0; i < N; ++i) {
-    out[i] = static_cast<DstType>(data[i]);
-  }
+  CastKernel<DstType, SrcType>::Run(
+      input.size(),
+      input.template data<SrcType>(),
+      output->template mutable_data<DstType>());
   return true;
 }
 
@@ -68,12 +164,15 @@ void CastOp<CPUContext>::SetBody(TensorProto_DataType to) {
       body_ = &CastOp<CPUContext>::DoRunWithDstType<int64_t>;
       break;
     case TensorProto_DataType_FLOAT16:
-      CAFFE_THROW("Casting to and from float16 on CPU is not supported yet");
-      // break;
+      body_ = &CastOp<CPUContext>::DoRunWithDstType<float16>;
+      break;
     case TensorProto_DataType_DOUBLE:
       //body_ = &CastOp::DoRunIncFp16WithDstType<double>;
       body_ = &CastOp<CPUContext>::DoRunWithDstType<double>;
       break;
+    case TensorProto_DataType_BFLOAT16:
+      body_ = &CastOp<CPUContext>::DoRunWithDstType<bfloat16>;
+      break;
     case TensorProto_DataType_UNDEFINED:
       CAFFE_THROW("Cast op must have 'to' argument of type DataType");
       // break;
@@ -95,7 +194,9 @@ bool CastOp<CPUContext>::DoRunWithDstType() {
           uint16_t,
           int16_t,
           int64_t,
-          double>,
+          float16,
+          double,
+          bfloat16>,
       DstType>::call(this, Input(0));
 }
 
@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/type_conversion.h"
+#include "caffe2/utils/conversions.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Values covering normals, fp16 subnormals, overflow to infinity and ties,
+// in a count that leaves tails after the SIMD blocks.
+std::vector<float> TestValues() {
+  std::vector<float> values = {0.0f,
+                               -0.0f,
+                               1.0f,
+                               -2.5f,
+                               65504.0f,
+                               70000.0f,
+                               -1e9f,
+                               1e-6f,
+                               -3e-8f,
+                               1.0f + 1.0f / 2048,
+                               1.0f + 3.0f / 2048,
+                               std::numeric_limits<float>::infinity()};
+  for (int i = 0; i < 25; ++i) {
+    values.push_back(std::sin(i * 0.37f) * std::pow(10.0f, i % 9 - 4));
+  }
+  return values;
+}
+
+} // namespace
+
+TEST(CastOpTest, FloatToFloat16AndBack) {
+  const auto values = TestValues();
+  Workspace ws;
+  auto* x = ws.CreateBlob("x")->GetMutable<TensorCPU>();
+  x->Resize(values.size());
+  std::copy(values.begin(), values.end(), x->mutable_data<float>());
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "Cast",
+      "",
+      {"x"},
+      {"half"},
+      {MakeArgument<int>("to", TensorProto_DataType_FLOAT16)})));
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("HalfToFloat", "", {"half"}, {"y"})));
+  const auto& half = ws.GetBlob("half")->Get<TensorCPU>();
+  const auto& y = ws.GetBlob("y")->Get<TensorCPU>();
+  ASSERT_EQ(y.size(), values.size());
+  for (int i = 0; i < values.size(); ++i) {
+    const float16 expected = convert::To<float, float16>(values[i]);
+    EXPECT_EQ(half.data<float16>()[i].x, expected.x) << values[i];
+    EXPECT_EQ(y.data<float>()[i], (convert::To<float16, float>(expected)));
+  }
+}
+
+TEST(CastOpTest, Float16ToInt) {
+  Workspace ws;
+  auto* x = ws.CreateBlob("x")->GetMutable<TensorCPU>();
+  x->Resize(3);
+  const float values[] = {-2.75f, 0.5f, 1000.0f};
+  for (int i = 0; i < 3; ++i) {
+    x->mutable_data<float16>()[i] = convert::To<float, float16>(values[i]);
+  }
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "Cast",
+      "",
+      {"x"},
+      {"y"},
+      {MakeArgument<int>("to", TensorProto_DataType_INT32)})));
+  const auto& y = ws.GetBlob("y")->Get<TensorCPU>();
+  EXPECT_EQ(y.data<int>()[0], -2);
+  EXPECT_EQ(y.data<int>()[1], 0);
+  EXPECT_EQ(y.data<int>()[2], 1000);
+}
+
+TEST(CastOpTest, IntAndFloat) {
+  std::vector<int32_t> ints;
+  std::vector<float> floats;
+  for (int i = 0; i < 37; ++i) {
+    ints.push_back((i - 18) * 123457);
+    floats.push_back((i - 18) * 1234.567f);
+  }
+  std::vector<float> int_to_float(ints.size());
+  int32_to_float(ints.size(), ints.data(), int_to_float.data());
+  std::vector<int32_t> float_to_int(floats.size());
+  float_to_int32(floats.size(), floats.data(), float_to_int.data());
+  for (int i = 0; i < ints.size(); ++i) {
+    EXPECT_EQ(int_to_float[i], static_cast<float>(ints[i]));
+    EXPECT_EQ(float_to_int[i], static_cast<int32_t>(floats[i]));
+  }
+}
+
+TEST(CastOpTest, BFloat16) {
+  auto values = TestValues();
+  values.push_back(std::numeric_limits<float>::quiet_NaN());
+  Workspace ws;
+  auto* x = ws.CreateBlob("x")->GetMutable<TensorCPU>();
+  x->Resize(values.size());
+  std::copy(values.begin(), values.end(), x->mutable_data<float>());
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "Cast",
+      "",
+      {"x"},
+      {"bf16"},
+      {MakeArgument<int>("to", TensorProto_DataType_BFLOAT16)})));
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "Cast",
+      "",
+      {"bf16"},
+      {"y"},
+      {MakeArgument<int>("to", TensorProto_DataType_FLOAT)})));
+  const auto& bf16 = ws.GetBlob("bf16")->Get<TensorCPU>();
+  const auto& y = ws.GetBlob("y")->Get<TensorCPU>();
+  ASSERT_TRUE(bf16.IsType<bfloat16>());
+  for (int i = 0; i < values.size(); ++i) {
+    const float unpacked = y.data<float>()[i];
+    if (std::isnan(values[i])) {
+      EXPECT_TRUE(std::isnan(unpacked));
+      continue;
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &values[i], sizeof(bits));
+    // Round to nearest even on the 16 dropped bits.
+    const uint32_t expected =
+        (bits + 0x7fff + ((bits >> 16) & 1)) & 0xffff0000u;
+    uint32_t result;
+    std::memcpy(&result, &unpacked, sizeof(result));
+    EXPECT_EQ(result, expected) << values[i];
+    EXPECT_EQ(bf16.data<bfloat16>()[i].x, expected >> 16);
+  }
+}
+
+} // namespace caffe2
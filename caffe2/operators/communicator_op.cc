@@ -24,11 +24,22 @@ OPERATOR_SCHEMA(CreateCommonWorld)
     .NumOutputs(1)
     .SetDoc(R"DOC(
 Creates a common world for communication operators.
+
+If members is given, the common world is cached in the process under this
+node's member id and creating it again reuses the connections to the members
+that are still there: the members first tell each other through the key/value
+handler which connections they hold, a connection is kept if both of its ends
+still hold it and only the others are established anew. The common world that
+was created before for this member must not be used any more afterwards.
 )DOC")
     .Input(0, "kv_handler", "Key/value handler for rendezvous (optional).")
     .Output(0, "comm_world", "A common world for collective operations.")
     .Arg("size", "(int) size of the common world.")
-    .Arg("rank", "(int) rank of this node in the common world.");
+    .Arg("rank", "(int) rank of this node in the common world.")
+    .Arg(
+        "members",
+        "(list of string, optional) stable id of every member in rank order, "
+        "enables reusing the connections of an earlier common world.");
 
 OPERATOR_SCHEMA(CloneCommonWorld)
     .NumInputs(1)
@@ -37,7 +48,11 @@ OPERATOR_SCHEMA(CloneCommonWorld)
 Clones existing common world.
 )DOC")
     .Input(0, "existing_comm_world", "Existing common world to clone.")
-    .Output(0, "comm_world", "A common world for collective operations.");
+    .Output(0, "comm_world", "A common world for collective operations.")
+    .Arg(
+        "reuse",
+        "(bool, default false) return the clone this operator made of the "
+        "same existing common world before, if any. All members must agree.");
 
 OPERATOR_SCHEMA(DestroyCommonWorld)
     .NumInputs(1)
@@ -62,6 +77,28 @@ on each node should have been pre-created with the same shape and data type.
     .Output(0, "X", "In-place as input 1.")
     .Arg("root", "(int, default 0) the root to run broadcast from.");
 
+OPERATOR_SCHEMA(PipelinedBroadcast)
+    .NumInputsOutputs([](int in, int out) {
+      return in >= 2 && out == (in - 1);
+    })
+    .EnforceInplace([](int in, int out) { return (in - 1) == out; })
+    .SetDoc(R"DOC(
+Broadcasts a list of CPU tensors from the root node to every other node in a
+single collective. Unlike Broadcast, the tensors are different blobs, e.g. all
+the parameters of a model, and may have different shapes and types. They are
+sent in chunks along a chain of the nodes, each node forwarding a chunk as
+soon as it has it, so that large broadcasts run close to the bandwidth of a
+single link. The tensors on each node should have been pre-created with the
+same shapes and data types.
+)DOC")
+    .Input(0, "comm_world", "The common world.")
+    .Input(1, "X", "The tensors to be broadcasted.")
+    .Output(0, "X", "In-place as the inputs after comm_world.")
+    .Arg("root", "(int, default 0) the root to run broadcast from.")
+    .Arg(
+        "chunk_size_bytes",
+        "(int, default 4MB) size of the chunks the tensors are sent in.");
+
 OPERATOR_SCHEMA(Reduce)
     .NumInputs(2)
     .NumOutputs(1)
@@ -90,6 +127,102 @@ Does an allreduce operation among the nodes. Currently only Sum is supported.
     .Input(1, "X", "A tensor to be allreduced.")
     .Output(0, "Y", "The allreduced tensor, same on all nodes.");
 
+OPERATOR_SCHEMA(AllreduceBucket)
+    .NumInputsOutputs([](int in, int out) {
+      return in >= 2 && out == (in - 1);
+    })
+    .EnforceInplace([](int in, int out) { return (in - 1) == out; })
+    .InputsCanCrossDevices()
+    .SetDoc(R"DOC(
+Allreduces a list of tensors of possibly different sizes in a single
+collective, by packing them into one contiguous buffer per replica. The inputs
+after the common world are num_replicas copies of the same list of tensors,
+given replica by replica; each copy is reduced in place, like Allreduce does
+for its inputs. Currently only Sum is supported.
+)DOC")
+    .Input(0, "comm_world", "The common world.")
+    .Input(1, "X", "The tensors to be allreduced.")
+    .Output(0, "Y", "In-place as the inputs after comm_world.")
+    .Arg(
+        "num_replicas",
+        "(int, default 1) number of local copies of the tensor list.");
+
+OPERATOR_SCHEMA(AllreduceCompressed)
+    .NumInputsOutputs([](int in, int out) {
+      return in >= 2 && out == (in - 1);
+    })
+    .EnforceInplace([](int in, int out) { return (in - 1) == out; })
+    .SetDoc(R"DOC(
+Does a float Sum allreduce among the nodes like Allreduce, but compresses what
+is sent over the wire. The local replicas are summed in fp32 first. Without
+top_k the sum is sent as fp16. With top_k only the top_k largest entries of
+each node are sent, and what is left out is kept in an error-feedback
+residual, passed as the last input, that is added back on the next run.
+)DOC")
+    .Input(0, "comm_world", "The common world.")
+    .Input(1, "X", "A float tensor to be allreduced, and its local replicas.")
+    .Output(0, "Y", "In-place as the inputs after comm_world.")
+    .Arg("top_k", "(int, default 0) if positive, only send this many entries.")
+    .Arg("fp16", "(bool, default true) send the top_k values as fp16.");
+
+OPERATOR_SCHEMA(HierarchicalAllreduce)
+    .NumInputsOutputs([](int in, int out) {
+      return in >= 2 && out == (in - 1);
+    })
+    .EnforceInplace([](int in, int out) { return (in - 1) == out; })
+    .IdenticalTypeAndShapeOfInput(0)
+    .InputsCanCrossDevices()
+    .SetDoc(R"DOC(
+Does a Sum allreduce of one tensor per local GPU among the nodes, like
+Allreduce, in three steps: a reduce-scatter within the node leaves every GPU
+with the node's sum of its shard of the tensor, each shard is allreduced
+across the nodes, and an allgather within the node puts the result back on
+every GPU. Only the shards, 1/G of the tensor for G local GPUs, are sent to the
+other nodes from each GPU.
+)DOC")
+    .Input(0, "comm_world", "The common world.")
+    .Input(1, "X", "A tensor to be allreduced, one per local GPU.")
+    .Output(0, "Y", "In-place as the inputs after comm_world.");
+
+OPERATOR_SCHEMA(ShardedSparseLookup)
+    .NumInputs(3)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Gathers rows of an embedding table whose rows are sharded over the nodes of
+the common world, like Gather does for a local table. Every node passes its
+own shard. With hash sharding, row id lives on node id % size as local row
+id / size, the layout Partition with pack_first_input produces; with range
+sharding, node i holds the rows_per_shard rows starting at i * rows_per_shard.
+Duplicate ids are requested once, with one request per shard.
+)DOC")
+    .Input(0, "comm_world", "The common world.")
+    .Input(1, "TABLE", "The shard of the table held by this node.")
+    .Input(2, "INDICES", "int32 or int64 ids of the rows to gather.")
+    .Output(0, "OUTPUT", "The rows, of shape INDICES.dims + TABLE.dims[1:].")
+    .Arg("sharding", "(string, default \"hash\") \"hash\" or \"range\".")
+    .Arg("rows_per_shard", "(int) rows per shard for range sharding.");
+
+OPERATOR_SCHEMA(ShardedSparsePush)
+    .NumInputs(5)
+    .NumOutputs(1)
+    .EnforceInplace({{1, 0}})
+    .SetDoc(R"DOC(
+Adds ALPHA times GRAD to the rows of a float embedding table sharded like
+for ShardedSparseLookup, updating every node's shard in place. The gradients
+of duplicate ids are summed before they are sent. With async, the op returns
+before the update is sent and applied, and the next run waits for it; give
+async pushes their own common world.
+)DOC")
+    .Input(0, "comm_world", "The common world.")
+    .Input(1, "TABLE", "The shard of the table held by this node.")
+    .Input(2, "INDICES", "int32 or int64 ids of the rows to update.")
+    .Input(3, "GRAD", "Gradient rows, of shape INDICES.dims + TABLE.dims[1:].")
+    .Input(4, "ALPHA", "Scalar multiplier, e.g. the negative learning rate.")
+    .Output(0, "TABLE", "In-place as TABLE.")
+    .Arg("sharding", "(string, default \"hash\") \"hash\" or \"range\".")
+    .Arg("rows_per_shard", "(int) rows per shard for range sharding.")
+    .Arg("async", "(bool, default false) push in the background.");
+
 OPERATOR_SCHEMA(Allgather)
     .NumInputs(2)
     .NumOutputs(1)
@@ -181,9 +314,15 @@ SHOULD_NOT_DO_GRADIENT(CreateCommonWorld);
 SHOULD_NOT_DO_GRADIENT(CloneCommonWorld);
 SHOULD_NOT_DO_GRADIENT(DestroyCommonWorld);
 SHOULD_NOT_DO_GRADIENT(Broadcast);
+SHOULD_NOT_DO_GRADIENT(PipelinedBroadcast);
 SHOULD_NOT_DO_GRADIENT(Reduce);
 SHOULD_NOT_DO_GRADIENT(Allgather);
 SHOULD_NOT_DO_GRADIENT(Allreduce);
+SHOULD_NOT_DO_GRADIENT(AllreduceBucket);
+SHOULD_NOT_DO_GRADIENT(AllreduceCompressed);
+SHOULD_NOT_DO_GRADIENT(HierarchicalAllreduce);
+SHOULD_NOT_DO_GRADIENT(ShardedSparseLookup);
+SHOULD_NOT_DO_GRADIENT(ShardedSparsePush);
 SHOULD_NOT_DO_GRADIENT(Barrier);
 SHOULD_NOT_DO_GRADIENT(SendTensor);
 SHOULD_NOT_DO_GRADIENT(ReceiveTensor);
@@ -193,9 +332,18 @@ REGISTER_CPU_OPERATOR(CreateCommonWorld, NoDefaultEngineOp<CPUContext>);
 REGISTER_CPU_OPERATOR(CloneCommonWorld, NoDefaultEngineOp<CPUContext>);
 REGISTER_CPU_OPERATOR(DestroyCommonWorld, NoDefaultEngineOp<CPUContext>);
 REGISTER_CPU_OPERATOR(Broadcast, NoDefaultEngineOp<CPUContext>);
+REGISTER_CPU_OPERATOR(PipelinedBroadcast, NoDefaultEngineOp<CPUContext>);
 REGISTER_CPU_OPERATOR(Reduce, NoDefaultEngineOp<CPUContext>);
 REGISTER_CPU_OPERATOR(Allgather, NoDefaultEngineOp<CPUContext>);
 REGISTER_CPU_OPERATOR(Allreduce, NoDefaultEngineOp<CPUContext>);
+REGISTER_CPU_OPERATOR(AllreduceBucket, NoDefaultEngineOp<CPUContext>);
+REGISTER_CPU_OPERATOR(
+    AllreduceCompressed,
+    NoDefaultEngineOp<CPUContext>);
+REGISTER_CPU_OPERATOR(
+    ShardedSparseLookup,
+    NoDefaultEngineOp<CPUContext>);
+REGISTER_CPU_OPERATOR(ShardedSparsePush, NoDefaultEngineOp<CPUContext>);
 REGISTER_CPU_OPERATOR(Barrier, NoDefaultEngineOp<CPUContext>);
 REGISTER_CPU_OPERATOR(SendTensor, NoDefaultEngineOp<CPUContext>);
 REGISTER_CPU_OPERATOR(ReceiveTensor, NoDefaultEngineOp<CPUContext>);
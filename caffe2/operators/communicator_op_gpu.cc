@@ -26,6 +26,10 @@ REGISTER_CUDA_OPERATOR(Broadcast, NoDefaultEngineOp<CUDAContext>);
 REGISTER_CUDA_OPERATOR(Reduce, NoDefaultEngineOp<CUDAContext>);
 REGISTER_CUDA_OPERATOR(Allgather, NoDefaultEngineOp<CUDAContext>);
 REGISTER_CUDA_OPERATOR(Allreduce, NoDefaultEngineOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(AllreduceBucket, NoDefaultEngineOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(
+    HierarchicalAllreduce,
+    NoDefaultEngineOp<CUDAContext>);
 REGISTER_CUDA_OPERATOR(SendTensor, NoDefaultEngineOp<CUDAContext>);
 REGISTER_CUDA_OPERATOR(ReceiveTensor, NoDefaultEngineOp<CUDAContext>);
 
@@ -16,7 +16,119 @@
 
 #include "caffe2/operators/concat_split_op.h"
 
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
 namespace caffe2 {
+
+namespace {
+
+// Fewer bytes than this per thread are not worth the dispatch overhead.
+constexpr size_t kMinBytesPerThread = 1 << 18;
+// Copies larger than this, about the last level cache of a server CPU,
+// bypass the cache when storing.
+constexpr size_t kStreamingCopyBytes = 32 << 20;
+
+void CopyBytes(char* dst, const char* src, size_t n, bool streaming) {
+#ifdef __SSE2__
+  if (streaming && n >= 256) {
+    const size_t head = (16 - reinterpret_cast<uintptr_t>(dst) % 16) % 16;
+    memcpy(dst, src, head);
+    size_t i = head;
+    for (; i + 16 <= n; i += 16) {
+      _mm_stream_si128(
+          reinterpret_cast<__m128i*>(dst + i),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+    }
+    memcpy(dst + i, src + i, n - i);
+    return;
+  }
+#endif
+  memcpy(dst, src, n);
+}
+
+} // namespace
+
+template <>
+void CopySlices<CPUContext>(
+    const vector<SliceCopy>& copies,
+    const TypeMeta& meta,
+    int num_threads,
+    Workspace* ws,
+    CPUContext* context) {
+  const size_t itemsize = meta.itemsize();
+  size_t total = 0;
+  for (const auto& c : copies) {
+    total += size_t(c.rows) * c.cols * itemsize;
+  }
+  const int num_chunks =
+      std::min<size_t>(num_threads, total / kMinBytesPerThread);
+  if (meta.copy() || (num_chunks <= 1 && total < kStreamingCopyBytes)) {
+    for (const auto& c : copies) {
+      math::CopyMatrix<CPUContext>(
+          itemsize,
+          c.rows,
+          c.cols,
+          c.src,
+          c.src_ld,
+          c.dst,
+          c.dst_ld,
+          context,
+          meta.copy());
+    }
+    return;
+  }
+
+  // Copies the bytes [begin, end) of the concatenation of all the copies,
+  // each seen as its rows one after the other.
+  const bool streaming = total >= kStreamingCopyBytes;
+  auto copy_range = [&](size_t begin, size_t end) {
+    size_t base = 0;
+    for (const auto& c : copies) {
+      const size_t row_bytes = c.cols * itemsize;
+      const size_t bytes = c.rows * row_bytes;
+      size_t b = std::max(begin, base) - base;
+      const size_t e = std::min(end, base + bytes) - base;
+      while (b < e) {
+        const size_t row = b / row_bytes;
+        const size_t col = b % row_bytes;
+        const size_t n = std::min(e - b, row_bytes - col);
+        CopyBytes(
+            c.dst + row * c.dst_ld * itemsize + col,
+            c.src + row * c.src_ld * itemsize + col,
+            n,
+            streaming);
+        b += n;
+      }
+      base += bytes;
+      if (base >= end) {
+        break;
+      }
+    }
+#ifdef __SSE2__
+    if (streaming) {
+      // Orders the non-temporal stores before the results are read.
+      _mm_sfence();
+    }
+#endif
+  };
+  if (num_chunks <= 1) {
+    copy_range(0, total);
+    return;
+  }
+  ws->GetThreadPool()->runChunks(
+      [&](int /* unused */, size_t c) {
+        copy_range(c * total / num_chunks, (c + 1) * total / num_chunks);
+      },
+      num_chunks);
+}
+
 REGISTER_CPU_OPERATOR(Split, SplitOp<CPUContext>);
 REGISTER_CPU_OPERATOR(Concat, ConcatOp<CPUContext>);
 OPERATOR_SCHEMA(Split)
@@ -27,6 +139,16 @@ OPERATOR_SCHEMA(Split)
     .Arg("axis", "Which axis to split on")
     .Arg("split", "length of each output")
     .Arg("order", "Either NHWC or NCWH, will split on C axis, defaults to NCHW")
+    .Arg(
+        "zero_copy",
+        "(bool, default false) If the split is along the outermost axis, or "
+        "all axes before it have size 1, make the outputs share the input "
+        "storage instead of copying it. Writes to the outputs then change "
+        "the input.")
+    .Arg(
+        "num_threads",
+        "(int, default 1) Number of threads of the workspace pool to copy "
+        "with on CPU.")
     .SetDoc(R"DOC(Split a tensor into a list of tensors, along the specified
     'axis'. The lengths of the split can be specified using argument 'axis' or
     optional second input blob to the operator. Otherwise, the tensor is split
@@ -41,6 +163,10 @@ OPERATOR_SCHEMA(Concat)
         "add_axis",
         "Pass 1 to add the axis specified in arg 'axis' to all "
         "input tensors")
+    .Arg(
+        "num_threads",
+        "(int, default 1) Number of threads of the workspace pool to copy "
+        "with on CPU.")
     .TensorInferenceFunction([](const OperatorDef& def,
                                 const vector<TensorShape>& in) {
       ArgumentHelper helper(def);
@@ -39,13 +39,60 @@ inline int GetDimFromOrderString(const string& str) {
 }
 } // namespace
 
+// A strided copy done by Concat or Split: rows of cols items, from rows
+// src_ld items apart to rows dst_ld items apart.
+struct SliceCopy {
+  const char* src;
+  int src_ld;
+  char* dst;
+  int dst_ld;
+  int rows;
+  int cols;
+};
+
+// Does the copies of Concat and Split. The CPU version cuts the bytes to
+// copy into num_threads equal ranges, run on the workspace thread pool, and
+// uses non-temporal stores when the copies are larger than the last level
+// cache, since the destination would not stay cached anyway.
+template <class Context>
+void CopySlices(
+    const vector<SliceCopy>& copies,
+    const TypeMeta& meta,
+    int /* num_threads */,
+    Workspace* /* ws */,
+    Context* context) {
+  for (const auto& c : copies) {
+    math::CopyMatrix<Context>(
+        meta.itemsize(),
+        c.rows,
+        c.cols,
+        c.src,
+        c.src_ld,
+        c.dst,
+        c.dst_ld,
+        context,
+        meta.copy());
+  }
+}
+
+template <>
+void CopySlices<CPUContext>(
+    const vector<SliceCopy>& copies,
+    const TypeMeta& meta,
+    int num_threads,
+    Workspace* ws,
+    CPUContext* context);
+
 template <class Context>
 class SplitOp final : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   SplitOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        split_(OperatorBase::GetRepeatedArgument<int>("split")) {
+        split_(OperatorBase::GetRepeatedArgument<int>("split")),
+        zero_copy_(OperatorBase::GetSingleArgument<bool>("zero_copy", false)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
     CAFFE_ENFORCE(
       !(OperatorBase::HasArgument("axis") && OperatorBase::HasArgument("order")),
         "You shouldn't specify both the dim to split, and the order "
@@ -60,6 +107,7 @@ class SplitOp final : public Operator<Context> {
       add_axis_ = 0;
     }
     CAFFE_ENFORCE_GE(axis_, 0);
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
   }
 
   bool RunOnDevice() override;
@@ -68,6 +116,9 @@ class SplitOp final : public Operator<Context> {
   int axis_;
   int add_axis_;
   vector<int> split_;
+  bool zero_copy_;
+  int num_threads_;
+  Workspace* ws_;
   // Input: X, optionally split
   // The split tensor is stored in CPU.
 };
@@ -77,7 +128,9 @@ class ConcatOp final : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   ConcatOp(const OperatorDef& operator_def, Workspace* ws)
-      : Operator<Context>(operator_def, ws) {
+      : Operator<Context>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
     CAFFE_ENFORCE(
       !(OperatorBase::HasArgument("axis") && OperatorBase::HasArgument("order")),
         "You shouldn't specify both the dim to concat, and the order "
@@ -91,6 +144,7 @@ class ConcatOp final : public Operator<Context> {
       add_axis_ = 0;
     }
     CAFFE_ENFORCE_GE(axis_, 0);
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
   }
 
   bool RunOnDevice() override;
@@ -98,6 +152,8 @@ class ConcatOp final : public Operator<Context> {
  protected:
   int axis_;
   int add_axis_;
+  int num_threads_;
+  Workspace* ws_;
   // Input: a number of tensors. Output: Y, split
   // The split are stored in CPU.
 };
@@ -155,6 +211,10 @@ bool SplitOp<Context>::RunOnDevice() {
   if (add_axis_) {
     output_dims.erase(output_dims.begin() + axis_);
   }
+  // With a single slice before the axis, every output is a contiguous part
+  // of the input, which zero_copy makes a view of instead of copying.
+  const bool share = zero_copy_ && before == 1;
+  vector<SliceCopy> copies;
   size_t input_offset = 0;
   for (int i = 0; i < OutputSize(); ++i) {
     auto* output = Output(i);
@@ -163,18 +223,25 @@ bool SplitOp<Context>::RunOnDevice() {
       output_dims[axis_] = axis_data[i];
     }
     output->Resize(output_dims);
-    math::CopyMatrix<Context>(
-        input.itemsize(),
-        before,
-        axis_dim * after,
-        static_cast<const char*>(input.raw_data()) + input_offset,
-        input.dim32(axis_) * after,
-        output->raw_mutable_data(input.meta()),
-        axis_dim * after,
-        &context_,
-        input.meta().copy());
+    const char* src = static_cast<const char*>(input.raw_data()) + input_offset;
+    if (share) {
+      output->ShareDataSlice(input, input_offset / input.itemsize());
+    } else {
+      if (zero_copy_ && output->shares_data()) {
+        // Do not write into an input shared on a previous run.
+        output->FreeMemory();
+      }
+      copies.push_back(SliceCopy{
+          src,
+          input.dim32(axis_) * after,
+          static_cast<char*>(output->raw_mutable_data(input.meta())),
+          axis_dim * after,
+          before,
+          axis_dim * after});
+    }
     input_offset += axis_dim * after * input.itemsize();
   }
+  CopySlices(copies, input.meta(), num_threads_, ws_, &context_);
   return true;
 }
 
@@ -247,23 +314,22 @@ bool ConcatOp<Context>::RunOnDevice() {
     output_dims[axis_] = output_channels;
   }
   output->Resize(output_dims);
+  vector<SliceCopy> copies;
   size_t output_offset = 0;
   for (int i = 0; i < InputSize(); ++i) {
     auto& input = Input(i);
     auto axis_dim = add_axis_ ? 1 : input.dim32(axis_);
-    math::CopyMatrix<Context>(
-        input.itemsize(),
-        before,
-        axis_dim * after,
-        input.raw_data(),
+    copies.push_back(SliceCopy{
+        static_cast<const char*>(input.raw_data()),
         axis_dim * after,
         static_cast<char*>(output->raw_mutable_data(input_zero.meta())) +
             output_offset,
         output_channels * after,
-        &context_,
-        input_zero.meta().copy());
+        before,
+        axis_dim * after});
     output_offset += axis_dim * after * input.itemsize();
   }
+  CopySlices(copies, input_zero.meta(), num_threads_, ws_, &context_);
   return true;
 }
 
@@ -66,6 +66,10 @@ std::function<void(OpSchema&)> ConvDocGenerator(const char* dim) {
         "convolution. The output dimensions are functions of the kernel size, "
         "stride size, and pad lengths."
         "");
+    schema.Arg(
+        "fused_relu",
+        "(bool) default to false; apply Relu to the output (CPU only), "
+        "as set up by the OperatorFusion transform.");
   };
 }
 REGISTER_CPU_OPERATOR(Conv, ConvOp<float, CPUContext>);
@@ -73,6 +77,8 @@ REGISTER_CPU_OPERATOR(Conv, ConvOp<float, CPUContext>);
 OPERATOR_SCHEMA(Conv)
     .NumInputs(2, 3)
     .NumOutputs(1)
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForConv))
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForConv)
     .FillUsing(ConvDocGenerator(""));
 
@@ -81,6 +87,8 @@ REGISTER_CPU_OPERATOR(Conv1D, ConvOp<float, CPUContext>);
 OPERATOR_SCHEMA(Conv1D)
     .NumInputs(2, 3)
     .NumOutputs(1)
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForConv))
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForConv)
     .FillUsing(ConvDocGenerator("1D "));
 
@@ -99,6 +107,8 @@ REGISTER_CPU_OPERATOR(Conv3D, ConvOp<float, CPUContext>);
 OPERATOR_SCHEMA(Conv3D)
     .NumInputs(2, 3)
     .NumOutputs(1)
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForConv))
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForConv)
     .FillUsing(ConvDocGenerator("3D "));
 
@@ -31,12 +31,17 @@ class ConvOp final : public ConvPoolOpBase<Context> {
  public:
   USE_CONV_POOL_BASE_FUNCTIONS(Context);
   ConvOp(const OperatorDef& operator_def, Workspace* ws)
-      : ConvPoolOpBase<Context>(operator_def, ws) {
+      : ConvPoolOpBase<Context>(operator_def, ws),
+        fused_relu_(
+            OperatorBase::GetSingleArgument<bool>("fused_relu", false)) {
     // Since this is the default convolution implementation, we will
     // use CAFFE_ENFORCE instead of OPERATOR_NEEDS_FEATURE.
     CAFFE_ENFORCE(
         group_ == 1 || order_ == StorageOrder::NCHW,
         "Group convolution only supports NCHW order right now.");
+    CAFFE_ENFORCE(
+        !fused_relu_ || (std::is_same<Context, CPUContext>::value),
+        "fused_relu is only supported on CPU.");
 
     // Create shared buffer mutex in the constructor
     // to avoid race-condition in DAGNet.
@@ -54,6 +59,8 @@ class ConvOp final : public ConvPoolOpBase<Context> {
   Tensor<Context> bias_multiplier_;
   Tensor<Context> img_shape_device_;
   Tensor<Context> col_buffer_shape_device_;
+  // Apply Relu to each output image right after computing it.
+  const bool fused_relu_;
   // Input: X, W, b
   // Output: Y
   INPUT_TAGS(INPUT, FILTER, BIAS);
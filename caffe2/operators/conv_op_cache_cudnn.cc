@@ -17,12 +17,117 @@
 #include "caffe2/operators/conv_op_cache_cudnn.h"
 
 #include <cudnn.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 
+#include "caffe2/core/common_gpu.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/tensor.h"
 
+CAFFE2_DEFINE_string(
+    caffe2_cudnn_algo_cache_file,
+    "",
+    "If set, the cuDNN convolution algorithms found by exhaustive search are "
+    "kept in this file and reused by later runs and other processes.");
+CAFFE2_DEFINE_bool(
+    caffe2_cudnn_exhaustive_search,
+    false,
+    "If set, all cuDNN convolutions that are not deterministic and have no "
+    "forced algorithm use exhaustive search, as if exhaustive_search was set. "
+    "Combined with --caffe2_cudnn_algo_cache_file, the search only runs for "
+    "shapes missing from the file.");
+
 namespace caffe2 {
 
+std::string CudnnAlgoCacheKeyPrefix(int gpu_id) {
+  return std::string(GetDeviceProperty(gpu_id).name) + "|cudnn" +
+      caffe2::to_string(cudnnGetVersion());
+}
+
+PersistentAlgorithmsCache& PersistentAlgorithmsCache::Get() {
+  // Leaked on purpose, ops may be destroyed during static destruction.
+  static auto* cache =
+      new PersistentAlgorithmsCache(FLAGS_caffe2_cudnn_algo_cache_file);
+  return *cache;
+}
+
+PersistentAlgorithmsCache::PersistentAlgorithmsCache(const std::string& path) {
+  Reset(path);
+}
+
+void PersistentAlgorithmsCache::Reset(const std::string& path) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  path_ = path;
+  algos_.clear();
+  if (!path_.empty()) {
+    LoadLocked();
+  }
+}
+
+bool PersistentAlgorithmsCache::Lookup(const std::string& key, int* algo) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = algos_.find(key);
+  if (it == algos_.end()) {
+    // Another process may have searched the shape in the meantime.
+    LoadLocked();
+    it = algos_.find(key);
+    if (it == algos_.end()) {
+      return false;
+    }
+  }
+  *algo = it->second;
+  return true;
+}
+
+void PersistentAlgorithmsCache::Insert(const std::string& key, int algo) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  // Merge with the entries other processes added since the last load.
+  LoadLocked();
+  algos_[key] = algo;
+  SaveLocked();
+}
+
+// One entry per line: the key, a tab and the algorithm.
+void PersistentAlgorithmsCache::LoadLocked() {
+  std::ifstream file(path_);
+  if (!file) {
+    return;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    const auto tab = line.rfind('\t');
+    if (tab == std::string::npos) {
+      continue;
+    }
+    std::istringstream algo(line.substr(tab + 1));
+    int value = 0;
+    if (algo >> value) {
+      algos_[line.substr(0, tab)] = value;
+    }
+  }
+}
+
+void PersistentAlgorithmsCache::SaveLocked() {
+  const std::string tmp_path =
+      path_ + ".tmp." + caffe2::to_string(static_cast<int>(getpid()));
+  {
+    std::ofstream file(tmp_path);
+    if (!file) {
+      LOG(WARNING) << "Cannot write cuDNN algorithm cache " << tmp_path;
+      return;
+    }
+    for (const auto& entry : algos_) {
+      file << entry.first << '\t' << entry.second << '\n';
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+    LOG(WARNING) << "Cannot replace cuDNN algorithm cache " << path_;
+    std::remove(tmp_path.c_str());
+  }
+}
+
 template class AlgorithmsCache<cudnnConvolutionFwdAlgo_t>;
 template class AlgorithmsCache<cudnnConvolutionBwdFilterAlgo_t>;
 template class AlgorithmsCache<cudnnConvolutionBwdDataAlgo_t>;
@@ -18,13 +18,65 @@
 #define CAFFE2_OPERATORS_CONV_OP_CACHE_H_
 
 #include <functional>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "caffe2/core/flags.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/tensor.h"
 
+CAFFE2_DECLARE_string(caffe2_cudnn_algo_cache_file);
+CAFFE2_DECLARE_bool(caffe2_cudnn_exhaustive_search);
+
 namespace caffe2 {
+
+// A process-wide cache of algorithm choices that is kept in the file given by
+// --caffe2_cudnn_algo_cache_file, so that the exhaustive search for a shape
+// only runs once across restarts. Keys are strings that callers build from
+// everything the choice depends on (GPU model, cuDNN version, convolution
+// parameters and shapes). The file is read on first use and re-read on a
+// miss to pick up entries of other processes. New entries are merged with
+// the file contents and written back through a rename, so processes sharing
+// the file never see it half written.
+class PersistentAlgorithmsCache {
+ public:
+  static PersistentAlgorithmsCache& Get();
+
+  bool enabled() const {
+    return !path_.empty();
+  }
+  bool Lookup(const std::string& key, int* algo);
+  void Insert(const std::string& key, int algo);
+
+  // Used by tests to point the cache at another file.
+  void Reset(const std::string& path);
+
+ private:
+  explicit PersistentAlgorithmsCache(const std::string& path);
+  // Both expect mutex_ to be held.
+  void LoadLocked();
+  void SaveLocked();
+
+  std::mutex mutex_;
+  std::string path_;
+  std::unordered_map<std::string, int> algos_;
+};
+
+// Prefix of the persistent keys, identifies the model of GPU gpu_id and the
+// cuDNN version.
+std::string CudnnAlgoCacheKeyPrefix(int gpu_id);
+
+// Appends a '|' and the comma separated values to a persistent key.
+template <typename T>
+void AppendToAlgoCacheKey(std::string* key, const std::vector<T>& values) {
+  *key += "|";
+  for (const auto& value : values) {
+    *key += caffe2::to_string(value) + ",";
+  }
+}
+
 template <typename T>
 class AlgorithmsCache {
  public:
@@ -33,6 +85,14 @@ class AlgorithmsCache {
       const std::vector<TIndex>& desc,
       std::function<T()> generatingFunc);
 
+  // Like the above, but also consults the persistent cache under
+  // persistent_key followed by the shapes, if the persistent cache is enabled.
+  T getAlgorithm(
+      const std::vector<TIndex>& bottom,
+      const std::vector<TIndex>& desc,
+      const std::string& persistent_key,
+      std::function<T()> generatingFunc);
+
  private:
   std::unordered_map<int64_t, T> hash_;
 };
@@ -66,5 +126,30 @@ T AlgorithmsCache<T>::getAlgorithm(
 
   return hash_[seed];
 }
+
+template <typename T>
+T AlgorithmsCache<T>::getAlgorithm(
+    const std::vector<TIndex>& vec1,
+    const std::vector<TIndex>& vec2,
+    const std::string& persistent_key,
+    std::function<T()> generatingFunc) {
+  auto& persistent = PersistentAlgorithmsCache::Get();
+  if (!persistent.enabled()) {
+    return getAlgorithm(vec1, vec2, generatingFunc);
+  }
+  return getAlgorithm(vec1, vec2, [&]() {
+    std::string key = persistent_key;
+    AppendToAlgoCacheKey(&key, vec1);
+    AppendToAlgoCacheKey(&key, vec2);
+    int algo = 0;
+    if (persistent.Lookup(key, &algo)) {
+      VLOG(1) << "Found algorithm " << algo << " for " << key;
+      return static_cast<T>(algo);
+    }
+    T value = generatingFunc();
+    persistent.Insert(key, static_cast<int>(value));
+    return value;
+  });
+}
 }
 #endif
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <cstdio>
 #include <vector>
 
 #include "caffe2/core/context_gpu.h"
@@ -61,4 +62,38 @@ TEST(AlgorithmsCacheTest, KeysDifferIfOneVectorIsEmpty) {
   EXPECT_EQ(res2, 10);
 }
 
+TEST(AlgorithmsCacheTest, PersistsAcrossCaches) {
+  const std::string path = std::string(std::tmpnam(nullptr));
+  auto& persistent = PersistentAlgorithmsCache::Get();
+  persistent.Reset(path);
+  {
+    AlgorithmsCache<int> cache;
+    EXPECT_EQ(
+        cache.getAlgorithm(
+            std::vector<TIndex>(1, 3), std::vector<TIndex>(1), "conv", []() {
+              return 5;
+            }),
+        5);
+  }
+  // A fresh cache, as after a restart, finds the entry in the file without
+  // searching again.
+  persistent.Reset(path);
+  AlgorithmsCache<int> cache;
+  EXPECT_EQ(
+      cache.getAlgorithm(
+          std::vector<TIndex>(1, 3), std::vector<TIndex>(1), "conv", []() {
+            return 10;
+          }),
+      5);
+  // Other keys still search.
+  EXPECT_EQ(
+      cache.getAlgorithm(
+          std::vector<TIndex>(1, 3), std::vector<TIndex>(1), "conv2", []() {
+            return 10;
+          }),
+      10);
+  persistent.Reset("");
+  std::remove(path.c_str());
+}
+
 } // namespace caffe2
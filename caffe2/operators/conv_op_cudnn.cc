@@ -87,6 +87,8 @@ class CudnnConvOpBase : public ConvPoolOpBase<CUDAContext> {
     CHECK(!deterministic_ || !exhaustive_search_);
     CAFFE_ENFORCE(group_ > 0);
     CAFFE_ENFORCE(!deterministic_ || !exhaustive_search_);
+    exhaustive_search_ |=
+        FLAGS_caffe2_cudnn_exhaustive_search && !deterministic_;
     for (int i = 0; i < kernel_.size(); ++i) {
       OPERATOR_NEEDS_FEATURE(
           pads_[i] == pads_[kernel_.size() + i],
@@ -214,6 +216,23 @@ class CudnnConvOpBase : public ConvPoolOpBase<CUDAContext> {
     }
   }
 
+  // Identifies an algorithm search of this op for the persistent cache, the
+  // cache adds the input and filter shapes.
+  std::string AlgoCacheKey(
+      const char* kind,
+      const TypeMeta& data_type,
+      const TypeMeta& math_type) const {
+    std::string key = CudnnAlgoCacheKeyPrefix(context_.cuda_gpu_id()) + "|" +
+        kind + "|" + data_type.name() + "|" + math_type.name() + "|" +
+        caffe2::to_string(order_) + "|" + caffe2::to_string(group_) + "|" +
+        caffe2::to_string(enable_tensor_core_) + "|" +
+        caffe2::to_string(cudnn_ws_nbytes_limit_);
+    AppendToAlgoCacheKey(&key, stride_);
+    AppendToAlgoCacheKey(&key, pads_);
+    AppendToAlgoCacheKey(&key, dilation_);
+    return key;
+  }
+
   vector<TIndex> cudnn_input_dims_;
   vector<TIndex> cudnn_filter_dims_;
 
@@ -506,7 +525,9 @@ bool CudnnConvOp::DoRunWithType() {
     } else if (deterministic_) {
       algo_ = CUDNN_CONVOLUTION_FWD_ALGO_IMPLICIT_PRECOMP_GEMM;
     } else if (exhaustive_search_) {
-      algo_ = algo_cache_.getAlgorithm(X.dims(), filter.dims(), [&]() {
+      const auto key =
+          AlgoCacheKey("fwd", TypeMeta::Make<T_X>(), TypeMeta::Make<MATH>());
+      algo_ = algo_cache_.getAlgorithm(X.dims(), filter.dims(), key, [&]() {
         VLOG(1) << "CUDNN Convolution: doing exhaustive search.";
         // When we do an exhaustive search, we will ignore the workspace size
         // limit and simply go for the fastest algorithm. If you happen to run
@@ -873,8 +894,10 @@ bool CudnnConvGradientOp::DoRunWithType() {
     } else if (deterministic_) {
       bwd_filter_algo_ = CUDNN_CONVOLUTION_BWD_FILTER_ALGO_1;
     } else if (exhaustive_search_) {
-      bwd_filter_algo_ =
-          filter_algo_cache_.getAlgorithm(X.dims(), filter.dims(), [&]() {
+      const auto key = AlgoCacheKey(
+          "bwd_filter", TypeMeta::Make<T_X>(), TypeMeta::Make<MATH>());
+      bwd_filter_algo_ = filter_algo_cache_.getAlgorithm(
+          X.dims(), filter.dims(), key, [&]() {
             VLOG(1) << "CUDNN Convolution bwd: doing filter exhaustive search.";
             // When we do an exhaustive search, we will ignore the workspace
             // size
@@ -929,8 +952,10 @@ bool CudnnConvGradientOp::DoRunWithType() {
       } else if (deterministic_) {
         bwd_data_algo_ = CUDNN_CONVOLUTION_BWD_DATA_ALGO_1;
       } else if (exhaustive_search_) {
-        bwd_data_algo_ =
-            data_algo_cache_.getAlgorithm(X.dims(), filter.dims(), [&]() {
+        const auto key = AlgoCacheKey(
+            "bwd_data", TypeMeta::Make<T_X>(), TypeMeta::Make<MATH>());
+        bwd_data_algo_ = data_algo_cache_.getAlgorithm(
+            X.dims(), filter.dims(), key, [&]() {
               VLOG(1) << "CUDNN Convolution bwd: doing data exhaustive search.";
               int returned_algo_count;
 
@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/conv_op_depthwise.h"
+
+#include "caffe2/perfkernels/depthwise_conv.h"
+
+namespace caffe2 {
+
+namespace {
+
+void DepthwiseConvPlane(
+    int H,
+    int W,
+    int out_h,
+    int out_w,
+    int kernel_h,
+    int kernel_w,
+    int stride_h,
+    int stride_w,
+    int dilation_h,
+    int dilation_w,
+    int pad_t,
+    int pad_l,
+    const float* X,
+    const float* filter,
+    float bias,
+    float* Y) {
+  for (int oh = 0; oh < out_h; ++oh) {
+    for (int ow = 0; ow < out_w; ++ow) {
+      float sum = bias;
+      for (int kh = 0; kh < kernel_h; ++kh) {
+        const int ih = oh * stride_h - pad_t + kh * dilation_h;
+        if (ih < 0 || ih >= H) {
+          continue;
+        }
+        for (int kw = 0; kw < kernel_w; ++kw) {
+          const int iw = ow * stride_w - pad_l + kw * dilation_w;
+          if (iw >= 0 && iw < W) {
+            sum += filter[kh * kernel_w + kw] * X[ih * W + iw];
+          }
+        }
+      }
+      Y[oh * out_w + ow] = sum;
+    }
+  }
+}
+
+} // namespace
+
+template <>
+void DepthwiseConv2DNCHW<CPUContext>(
+    int N,
+    int C,
+    int multiplier,
+    int H,
+    int W,
+    int out_h,
+    int out_w,
+    int kernel_h,
+    int kernel_w,
+    int stride_h,
+    int stride_w,
+    int dilation_h,
+    int dilation_w,
+    int pad_t,
+    int pad_l,
+    const float* X,
+    const float* filter,
+    const float* bias,
+    float* Y,
+    CPUContext* /* context */) {
+  // The common 3x3 cases have vectorized kernels.
+  const bool is_3x3 = kernel_h == 3 && kernel_w == 3 && dilation_h == 1 &&
+      dilation_w == 1 && stride_h == stride_w && stride_h <= 2;
+  const int M = C * multiplier;
+  for (int n = 0; n < N; ++n) {
+    for (int m = 0; m < M; ++m) {
+      const float* Xplane = X + (n * C + m / multiplier) * H * W;
+      const float* Wplane = filter + m * kernel_h * kernel_w;
+      const float b = bias ? bias[m] : 0.f;
+      float* Yplane = Y + (n * M + m) * out_h * out_w;
+      if (is_3x3) {
+        depthwise_conv_3x3_plane(
+            H,
+            W,
+            out_h,
+            out_w,
+            stride_h,
+            pad_t,
+            pad_l,
+            Xplane,
+            Wplane,
+            b,
+            Yplane);
+      } else {
+        DepthwiseConvPlane(
+            H,
+            W,
+            out_h,
+            out_w,
+            kernel_h,
+            kernel_w,
+            stride_h,
+            stride_w,
+            dilation_h,
+            dilation_w,
+            pad_t,
+            pad_l,
+            Xplane,
+            Wplane,
+            b,
+            Yplane);
+      }
+    }
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/operators/conv_op_depthwise.h"
+
+namespace caffe2 {
+
+namespace {
+
+// One thread per output element, in NCHW order, so that consecutive threads
+// read consecutive input columns.
+template <int kKernelH, int kKernelW>
+__global__ void DepthwiseConv2DKernel(
+    const int nthreads,
+    const int C,
+    const int multiplier,
+    const int H,
+    const int W,
+    const int out_h,
+    const int out_w,
+    const int runtime_kernel_h,
+    const int runtime_kernel_w,
+    const int stride_h,
+    const int stride_w,
+    const int dilation_h,
+    const int dilation_w,
+    const int pad_t,
+    const int pad_l,
+    const float* X,
+    const float* filter,
+    const float* bias,
+    float* Y) {
+  // The kernel size is known at compile time for the common 3x3 case, which
+  // lets the compiler unroll the loops.
+  const int kernel_h = kKernelH > 0 ? kKernelH : runtime_kernel_h;
+  const int kernel_w = kKernelW > 0 ? kKernelW : runtime_kernel_w;
+  CUDA_1D_KERNEL_LOOP(index, nthreads) {
+    const int ow = index % out_w;
+    const int oh = (index / out_w) % out_h;
+    const int m = (index / out_w / out_h) % (C * multiplier);
+    const int n = index / out_w / out_h / (C * multiplier);
+    const float* Xplane = X + (n * C + m / multiplier) * H * W;
+    const float* Wplane = filter + m * kernel_h * kernel_w;
+    float sum = bias ? bias[m] : 0.f;
+#pragma unroll
+    for (int kh = 0; kh < kernel_h; ++kh) {
+      const int ih = oh * stride_h - pad_t + kh * dilation_h;
+#pragma unroll
+      for (int kw = 0; kw < kernel_w; ++kw) {
+        const int iw = ow * stride_w - pad_l + kw * dilation_w;
+        if (ih >= 0 && ih < H && iw >= 0 && iw < W) {
+#if __CUDA_ARCH__ >= 350
+          sum += __ldg(Wplane + kh * kernel_w + kw) *
+              __ldg(Xplane + ih * W + iw);
+#else
+          sum += Wplane[kh * kernel_w + kw] * Xplane[ih * W + iw];
+#endif
+        }
+      }
+    }
+    Y[index] = sum;
+  }
+}
+
+} // namespace
+
+template <>
+void DepthwiseConv2DNCHW<CUDAContext>(
+    int N,
+    int C,
+    int multiplier,
+    int H,
+    int W,
+    int out_h,
+    int out_w,
+    int kernel_h,
+    int kernel_w,
+    int stride_h,
+    int stride_w,
+    int dilation_h,
+    int dilation_w,
+    int pad_t,
+    int pad_l,
+    const float* X,
+    const float* filter,
+    const float* bias,
+    float* Y,
+    CUDAContext* context) {
+  const int size = N * C * multiplier * out_h * out_w;
+  if (size == 0) {
+    return;
+  }
+  auto* kernel = kernel_h == 3 && kernel_w == 3
+      ? DepthwiseConv2DKernel<3, 3>
+      : DepthwiseConv2DKernel<0, 0>;
+  kernel<<<
+      CAFFE_GET_BLOCKS(size),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(
+      size,
+      C,
+      multiplier,
+      H,
+      W,
+      out_h,
+      out_w,
+      kernel_h,
+      kernel_w,
+      stride_h,
+      stride_w,
+      dilation_h,
+      dilation_w,
+      pad_t,
+      pad_l,
+      X,
+      filter,
+      bias,
+      Y);
+}
+
+} // namespace caffe2
@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_CONV_OP_DEPTHWISE_H_
+#define CAFFE2_OPERATORS_CONV_OP_DEPTHWISE_H_
+
+#include "caffe2/core/context.h"
+
+namespace caffe2 {
+
+// Depthwise 2D convolution in NCHW order, i.e. a grouped convolution with one
+// input channel per group: output channel c * multiplier + j is input
+// channel c convolved with filter c * multiplier + j, of shape
+// (C * multiplier, 1, kernel_h, kernel_w). bias may be null. Running it
+// directly avoids an im2col and a tiny GEMM per channel.
+template <class Context>
+void DepthwiseConv2DNCHW(
+    int N,
+    int C,
+    int multiplier,
+    int H,
+    int W,
+    int out_h,
+    int out_w,
+    int kernel_h,
+    int kernel_w,
+    int stride_h,
+    int stride_w,
+    int dilation_h,
+    int dilation_w,
+    int pad_t,
+    int pad_l,
+    const float* X,
+    const float* filter,
+    const float* bias,
+    float* Y,
+    Context* context);
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_CONV_OP_DEPTHWISE_H_
@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/conv_pool_op_base.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// 1x1 stride 1 convolution without padding, which is a plain matrix product
+// over the image and needs no im2col: W * X per image in NCHW, and X * W^T
+// over the whole batch in NHWC. Other configurations fall back to the default
+// engine.
+class Direct1x1ConvOp final : public ConvPoolOpBase<CPUContext> {
+ public:
+  USE_CONV_POOL_BASE_FUNCTIONS(CPUContext);
+  Direct1x1ConvOp(const OperatorDef& operator_def, Workspace* ws)
+      : ConvPoolOpBase<CPUContext>(operator_def, ws) {
+    OPERATOR_NEEDS_FEATURE(
+        kernel_.size() == 2 && kernel_h() == 1 && kernel_w() == 1,
+        "The direct engine only supports 1x1 kernels.");
+    OPERATOR_NEEDS_FEATURE(
+        stride_h() == 1 && stride_w() == 1,
+        "The direct engine needs stride 1.");
+    OPERATOR_NEEDS_FEATURE(
+        pad_t() == 0 && pad_l() == 0 && pad_b() == 0 && pad_r() == 0,
+        "The direct engine does not pad.");
+    OPERATOR_NEEDS_FEATURE(
+        group_ == 1 || order_ == StorageOrder::NCHW,
+        "Group convolution only supports NCHW order.");
+  }
+
+  bool RunOnDeviceWithOrderNCHW() override {
+    const auto& X = Input(INPUT);
+    const auto& filter = Input(FILTER);
+    auto* Y = Output(0);
+    CAFFE_ENFORCE_EQ(X.ndim(), 4);
+    CAFFE_ENFORCE_EQ(filter.ndim(), 4);
+    const int N = X.dim32(0), C = X.dim32(1);
+    const int HW = X.dim32(2) * X.dim32(3);
+    const int M = filter.dim32(0);
+    CAFFE_ENFORCE_EQ(filter.dim32(1) * group_, C);
+    CAFFE_ENFORCE_EQ(M % group_, 0);
+    ConvPoolOpBase<CPUContext>::SetOutputSize(X, Y, M);
+    const int Cg = C / group_, Mg = M / group_;
+    const float* Xdata = X.data<float>();
+    const float* Wdata = filter.data<float>();
+    float* Ydata = Y->mutable_data<float>();
+    for (int image_id = 0; image_id < N; ++image_id) {
+      for (int g = 0; g < group_; ++g) {
+        math::Gemm<float, CPUContext>(
+            CblasNoTrans,
+            CblasNoTrans,
+            Mg,
+            HW,
+            Cg,
+            1,
+            Wdata + g * Mg * Cg,
+            Xdata + (image_id * C + g * Cg) * HW,
+            0,
+            Ydata + (image_id * M + g * Mg) * HW,
+            &context_);
+      }
+      if (InputSize() == 3) {
+        const float* bias = BiasData(M);
+        for (int oc = 0; oc < M; ++oc) {
+          float* Yc = Ydata + (image_id * M + oc) * HW;
+          for (int i = 0; i < HW; ++i) {
+            Yc[i] += bias[oc];
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  bool RunOnDeviceWithOrderNHWC() override {
+    const auto& X = Input(INPUT);
+    const auto& filter = Input(FILTER);
+    auto* Y = Output(0);
+    CAFFE_ENFORCE_EQ(X.ndim(), 4);
+    CAFFE_ENFORCE_EQ(filter.ndim(), 4);
+    const int C = X.dim32(3);
+    const int pixels = X.size() / C;
+    const int M = filter.dim32(0);
+    CAFFE_ENFORCE_EQ(filter.dim32(3), C);
+    ConvPoolOpBase<CPUContext>::SetOutputSize(X, Y, M);
+    float* Ydata = Y->mutable_data<float>();
+    math::Gemm<float, CPUContext>(
+        CblasNoTrans,
+        CblasTrans,
+        pixels,
+        M,
+        C,
+        1,
+        X.data<float>(),
+        filter.data<float>(),
+        0,
+        Ydata,
+        &context_);
+    if (InputSize() == 3) {
+      const float* bias = BiasData(M);
+      for (int p = 0; p < pixels; ++p) {
+        for (int oc = 0; oc < M; ++oc) {
+          Ydata[p * M + oc] += bias[oc];
+        }
+      }
+    }
+    return true;
+  }
+
+ private:
+  const float* BiasData(int M) {
+    const auto& bias = Input(BIAS);
+    CAFFE_ENFORCE_EQ(bias.ndim(), 1);
+    CAFFE_ENFORCE_EQ(bias.dim32(0), M);
+    return bias.data<float>();
+  }
+
+  INPUT_TAGS(INPUT, FILTER, BIAS);
+};
+
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv, DIRECT, Direct1x1ConvOp);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv2D, DIRECT, Direct1x1ConvOp);
+
+} // namespace caffe2
@@ -23,7 +23,9 @@
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/operators/conv_op.h"
+#include "caffe2/operators/conv_op_depthwise.h"
 #include "caffe2/operators/conv_pool_op_base.h"
+#include "caffe2/operators/relu_op.h"
 #include "caffe2/utils/math.h"
 
 namespace caffe2 {
@@ -61,11 +63,53 @@ bool ConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
   const int input_image_size = this->GetDimsSize(X);
   const int output_image_size = this->GetDimsSize(*Y);
 
+  // Depthwise convolutions, with one input channel per group, are computed
+  // directly rather than as a tiny GEMM per channel.
+  if (kernel_.size() == 2 && group_ > 1 && group_ == C) {
+    const T* bias_data = nullptr;
+    if (InputSize() == 3) {
+      auto& bias = Input(BIAS);
+      CAFFE_ENFORCE(bias.ndim() == 1);
+      CAFFE_ENFORCE(bias.dim32(0) == M);
+      bias_data = bias.template data<T>();
+    }
+    T* Ydata = Y->template mutable_data<T>();
+    DepthwiseConv2DNCHW<Context>(
+        N,
+        C,
+        M / C,
+        input_dims[0],
+        input_dims[1],
+        output_dims[0],
+        output_dims[1],
+        kernel_h(),
+        kernel_w(),
+        stride_h(),
+        stride_w(),
+        dilation_h(),
+        dilation_w(),
+        pad_t(),
+        pad_l(),
+        X.template data<T>(),
+        filter.template data<T>(),
+        bias_data,
+        Ydata,
+        &context_);
+    if (fused_relu_) {
+      FusedReluInPlace<T, Context>(Y->size(), Ydata, &context_);
+    }
+    return true;
+  }
+
+  // Other 2D grouped convolutions unfold all the channels of an image at
+  // once and multiply every group in a single batched GEMM.
+  const bool batched_groups = kernel_.size() == 2 && group_ > 1;
+
   vector<int> img_shape;
   img_shape.assign(X.dims().begin() + 1, X.dims().end());
 
   vector<int> buffer_shape;
-  buffer_shape.push_back(C / group_ * kernel_dims_size);
+  buffer_shape.push_back((batched_groups ? C : C / group_) * kernel_dims_size);
   buffer_shape.insert(
       buffer_shape.end(), output_dims.begin(), output_dims.end());
 
@@ -123,53 +167,91 @@ bool ConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
     T* col_buffer_data = col_buffer->template mutable_data<T>();
     // Im2col, followed by gemm.
     for (int image_id = 0; image_id < N; ++image_id) {
-      for (int group_id = 0; group_id < group_; ++group_id) {
-        if (kernel_.size() == 2) {
-          math::Im2col<T, Context, StorageOrder::NCHW>(
-              Xdata + group_id * input_offset,
-              C / group_,
-              input_dims[0],
-              input_dims[1],
-              kernel_h(),
-              kernel_w(),
-              dilation_h(),
-              dilation_w(),
-              pad_t(),
-              pad_l(),
-              pad_b(),
-              pad_r(),
-              stride_h(),
-              stride_w(),
-              col_buffer_data,
-              &context_);
-        } else {
-          math::Im2colNd<T, Context, StorageOrder::NCHW>(
-              Xdata + group_id * input_offset,
-              img_shape_device_.template data<int>(),
-              col_buffer_shape_device_.template data<int>(),
-              C * input_image_size,
-              col_buffer_size,
-              kernel_device_.template data<int>(),
-              stride_device_.template data<int>(),
-              dilation_device_.template data<int>(),
-              pads_device_.template data<int>(),
-              kernel_.size(),
-              col_buffer_data,
-              &context_);
-        }
-        // Weight term
-        math::Gemm<T, Context>(
+      if (batched_groups) {
+        math::Im2col<T, Context, StorageOrder::NCHW>(
+            Xdata,
+            C,
+            input_dims[0],
+            input_dims[1],
+            kernel_h(),
+            kernel_w(),
+            dilation_h(),
+            dilation_w(),
+            pad_t(),
+            pad_l(),
+            pad_b(),
+            pad_r(),
+            stride_h(),
+            stride_w(),
+            col_buffer_data,
+            &context_);
+        // The col buffer rows of a group are contiguous, as are its filters
+        // and output channels.
+        math::GemmBatched<T, Context>(
             CblasNoTrans,
             CblasNoTrans,
+            filter.size(),
+            group_,
+            col_buffer_size * group_,
+            group_,
             M / group_,
             output_image_size,
             kernel_dim,
             1,
-            filter.template data<T>() + group_id * filter_offset,
+            filter.template data<T>(),
             col_buffer_data,
             0,
-            Ydata + group_id * output_offset,
+            Ydata,
             &context_);
+      } else {
+        for (int group_id = 0; group_id < group_; ++group_id) {
+          if (kernel_.size() == 2) {
+            math::Im2col<T, Context, StorageOrder::NCHW>(
+                Xdata + group_id * input_offset,
+                C / group_,
+                input_dims[0],
+                input_dims[1],
+                kernel_h(),
+                kernel_w(),
+                dilation_h(),
+                dilation_w(),
+                pad_t(),
+                pad_l(),
+                pad_b(),
+                pad_r(),
+                stride_h(),
+                stride_w(),
+                col_buffer_data,
+                &context_);
+          } else {
+            math::Im2colNd<T, Context, StorageOrder::NCHW>(
+                Xdata + group_id * input_offset,
+                img_shape_device_.template data<int>(),
+                col_buffer_shape_device_.template data<int>(),
+                C * input_image_size,
+                col_buffer_size,
+                kernel_device_.template data<int>(),
+                stride_device_.template data<int>(),
+                dilation_device_.template data<int>(),
+                pads_device_.template data<int>(),
+                kernel_.size(),
+                col_buffer_data,
+                &context_);
+          }
+          // Weight term
+          math::Gemm<T, Context>(
+              CblasNoTrans,
+              CblasNoTrans,
+              M / group_,
+              output_image_size,
+              kernel_dim,
+              1,
+              filter.template data<T>() + group_id * filter_offset,
+              col_buffer_data,
+              0,
+              Ydata + group_id * output_offset,
+              &context_);
+        }
       }
       if (InputSize() == 3) {
         // Bias term can be carried out outside the group definition
@@ -188,16 +270,15 @@ bool ConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
             Ydata,
             &context_);
       }
+      if (fused_relu_) {
+        FusedReluInPlace<T, Context>(output_offset * group_, Ydata, &context_);
+      }
       Xdata += input_offset * group_;
       Ydata += output_offset * group_;
     }
   };
 
-  if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
-    runWithSharedBuffer<Context>(ws_, f);
-  } else {
-    f(&col_buffer_);
-  }
+  runWithColBuffer<Context>(ws_, shared_buffer_, &col_buffer_, f);
   return true;
 }
 
@@ -276,6 +357,9 @@ bool ConvOp<T, Context>::RunOnDeviceWithOrderNHWC() {
           Ydata,
           &context_);
     }
+    if (fused_relu_) {
+      FusedReluInPlace<T, Context>(Y->size(), Ydata, &context_);
+    }
   } else {
     if (InputSize() == 3) {
       auto& bias = Input(BIAS);
@@ -342,15 +426,14 @@ bool ConvOp<T, Context>::RunOnDeviceWithOrderNHWC() {
               Ydata,
               &context_);
         }
+        if (fused_relu_) {
+          FusedReluInPlace<T, Context>(output_offset, Ydata, &context_);
+        }
         Xdata += input_offset;
         Ydata += output_offset;
       }
     };
-    if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
-      runWithSharedBuffer<Context>(ws_, f);
-    } else {
-      f(&col_buffer_);
-    }
+    runWithColBuffer<Context>(ws_, shared_buffer_, &col_buffer_, f);
   }
   return true;
 }
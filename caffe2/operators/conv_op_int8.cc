@@ -0,0 +1,221 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/conv_pool_op_base.h"
+#include "caffe2/operators/int8_quantization.h"
+#include "caffe2/operators/relu_op.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// 2D convolution with int8 weights and uint8 activations, see
+// int8_quantization.h. Like the FC of this engine it takes and produces the
+// fp32 tensors of the regular Conv. Configurations it does not handle fall
+// back to the default fp32 operator. The product of each image is spread over
+// num_threads threads of the workspace thread pool.
+class Int8ConvOp final : public ConvPoolOpBase<CPUContext> {
+ public:
+  USE_CONV_POOL_BASE_FUNCTIONS(CPUContext);
+  Int8ConvOp(const OperatorDef& operator_def, Workspace* ws)
+      : ConvPoolOpBase<CPUContext>(operator_def, ws),
+        fused_relu_(OperatorBase::GetSingleArgument<bool>("fused_relu", false)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        range_(*this) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+    OPERATOR_NEEDS_FEATURE(group_ == 1, "Group convolution not supported yet.");
+    OPERATOR_NEEDS_FEATURE(
+        kernel_.size() == 2, "Only 2D convolution is supported.");
+  }
+
+  bool RunOnDeviceWithOrderNCHW() override {
+    const auto& X = Input(INPUT);
+    const auto& filter = Input(FILTER);
+    auto* Y = Output(0);
+    CAFFE_ENFORCE_EQ(X.ndim(), 4);
+    CAFFE_ENFORCE_EQ(filter.ndim(), 4);
+    const int N = X.dim32(0), C = X.dim32(1), H = X.dim32(2), W = X.dim32(3);
+    const int M = filter.dim32(0);
+    CAFFE_ENFORCE_EQ(filter.dim32(1), C);
+    CAFFE_ENFORCE_EQ(filter.dim32(2), kernel_h());
+    CAFFE_ENFORCE_EQ(filter.dim32(3), kernel_w());
+    ConvPoolOpBase<CPUContext>::SetOutputSize(X, Y, M);
+    const int kernel_dim = C * kernel_h() * kernel_w();
+    const int output_image_size = Y->dim32(2) * Y->dim32(3);
+
+    const auto params = Prepare(X, filter, M, output_image_size, kernel_dim);
+    const float* Xdata = X.data<float>();
+    float* Ydata = Y->mutable_data<float>();
+    col_buffer_.Resize(kernel_dim, output_image_size);
+    float* col = col_buffer_.mutable_data<float>();
+    col_t_q_.resize(col_buffer_.size());
+    for (int image_id = 0; image_id < N; ++image_id) {
+      math::Im2col<float, CPUContext, StorageOrder::NCHW>(
+          Xdata + image_id * C * H * W,
+          C,
+          H,
+          W,
+          kernel_h(),
+          kernel_w(),
+          dilation_h(),
+          dilation_w(),
+          pad_t(),
+          pad_l(),
+          pad_b(),
+          pad_r(),
+          stride_h(),
+          stride_w(),
+          col,
+          &context_);
+      // The gemm wants the patches as rows, so transpose after quantizing.
+      QuantizeUint8(col, col_buffer_.size(), params, col_t_q_.data());
+      for (int k = 0; k < kernel_dim; ++k) {
+        for (int p = 0; p < output_image_size; ++p) {
+          col_q_[p * kernel_dim + k] = col_t_q_[k * output_image_size + p];
+        }
+      }
+      RunGemm(
+          params,
+          output_image_size,
+          M,
+          kernel_dim,
+          Ydata + image_id * M * output_image_size,
+          1,
+          output_image_size);
+    }
+    return true;
+  }
+
+  bool RunOnDeviceWithOrderNHWC() override {
+    const auto& X = Input(INPUT);
+    const auto& filter = Input(FILTER);
+    auto* Y = Output(0);
+    CAFFE_ENFORCE_EQ(X.ndim(), 4);
+    CAFFE_ENFORCE_EQ(filter.ndim(), 4);
+    const int N = X.dim32(0), H = X.dim32(1), W = X.dim32(2), C = X.dim32(3);
+    const int M = filter.dim32(0);
+    CAFFE_ENFORCE_EQ(filter.dim32(1), kernel_h());
+    CAFFE_ENFORCE_EQ(filter.dim32(2), kernel_w());
+    CAFFE_ENFORCE_EQ(filter.dim32(3), C);
+    ConvPoolOpBase<CPUContext>::SetOutputSize(X, Y, M);
+    const int kernel_dim = kernel_h() * kernel_w() * C;
+    const int output_image_size = Y->dim32(1) * Y->dim32(2);
+
+    const auto params = Prepare(X, filter, M, output_image_size, kernel_dim);
+    const float* Xdata = X.data<float>();
+    float* Ydata = Y->mutable_data<float>();
+    col_buffer_.Resize(output_image_size, kernel_dim);
+    float* col = col_buffer_.mutable_data<float>();
+    for (int image_id = 0; image_id < N; ++image_id) {
+      math::Im2col<float, CPUContext, StorageOrder::NHWC>(
+          Xdata + image_id * H * W * C,
+          C,
+          H,
+          W,
+          kernel_h(),
+          kernel_w(),
+          dilation_h(),
+          dilation_w(),
+          pad_t(),
+          pad_l(),
+          pad_b(),
+          pad_r(),
+          stride_h(),
+          stride_w(),
+          col,
+          &context_);
+      QuantizeUint8(col, col_buffer_.size(), params, col_q_.data());
+      RunGemm(
+          params,
+          output_image_size,
+          M,
+          kernel_dim,
+          Ydata + image_id * output_image_size * M,
+          M,
+          1);
+    }
+    return true;
+  }
+
+ private:
+  // Quantizes the filter if needed, sizes the buffers and returns the
+  // activation parameters, which are shared by all images of the batch.
+  Int8QuantizationParams Prepare(
+      const TensorCPU& X,
+      const TensorCPU& filter,
+      int M,
+      int output_image_size,
+      int kernel_dim) {
+    if (InputSize() == 3) {
+      CAFFE_ENFORCE_EQ(Input(BIAS).ndim(), 1);
+      CAFFE_ENFORCE_EQ(Input(BIAS).dim32(0), M);
+    }
+    weights_.Pack(filter, M);
+    col_q_.resize(output_image_size * kernel_dim);
+    acc_.resize(output_image_size * M);
+    return range_.Params(X.data<float>(), X.size());
+  }
+
+  void RunGemm(
+      const Int8QuantizationParams& params,
+      int output_image_size,
+      int M,
+      int kernel_dim,
+      float* Ydata,
+      int ldy,
+      int incy) {
+    Int8GemmNT(
+        output_image_size,
+        M,
+        kernel_dim,
+        col_q_.data(),
+        weights_.data(),
+        acc_.data(),
+        num_threads_,
+        num_threads_ > 1 ? ws_->GetThreadPool() : nullptr);
+    Int8AccumulatorsToFloat(
+        output_image_size,
+        M,
+        acc_.data(),
+        params,
+        weights_,
+        InputSize() == 3 ? Input(BIAS).data<float>() : nullptr,
+        Ydata,
+        ldy,
+        incy);
+    if (fused_relu_) {
+      FusedReluInPlace<float, CPUContext>(
+          output_image_size * M, Ydata, &context_);
+    }
+  }
+
+  const bool fused_relu_;
+  const int num_threads_;
+  Int8ActivationRange range_;
+  Int8PackedWeights weights_;
+  TensorCPU col_buffer_;
+  vector<std::uint8_t> col_q_;
+  // The quantized NCHW patches before they are transposed.
+  vector<std::uint8_t> col_t_q_;
+  vector<std::int32_t> acc_;
+  INPUT_TAGS(INPUT, FILTER, BIAS);
+};
+
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv, INT8, Int8ConvOp);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv2D, INT8, Int8ConvOp);
+
+} // namespace caffe2
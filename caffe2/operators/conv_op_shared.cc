@@ -47,4 +47,19 @@ void runWithSharedBuffer(
       ws->GetBlob("__CAFFE2_SHARED_CONV_BUFFER_CPU__")->GetMutable<TensorCPU>();
   f(buffer);
 }
+
+template <>
+void runWithThreadLocalBuffer(
+    Workspace* ws,
+    std::function<void(Tensor<CPUContext>* buffer)> f) {
+// thread_local objects with destructors are not supported on all Apple
+// platforms, there we only use the workspace buffer.
+#ifndef __APPLE__
+  (void)ws;
+  static thread_local TensorCPU buffer;
+  f(&buffer);
+#else
+  runWithSharedBuffer<CPUContext>(ws, f);
+#endif // __APPLE__
+}
 }
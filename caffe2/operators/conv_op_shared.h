@@ -18,11 +18,28 @@
 #define CAFFE2_OPERATORS_CONV_OP_SHARED_H_
 
 #include "caffe2/core/context.h"
+#include "caffe2/core/flags.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/core/workspace.h"
 
+CAFFE2_DECLARE_bool(caffe2_force_shared_col_buffer);
+
 namespace caffe2 {
 
+/**
+ * Values of the shared_buffer argument of the convolution operators. The
+ * workspace buffer is shared by all the operators of the workspace and
+ * serializes them with a mutex, the per-thread buffer is shared by the
+ * operators that run on the same thread, so concurrent DAGNet workers never
+ * wait on each other. Either buffer grows to the largest requirement of its
+ * users and is then reused.
+ */
+enum SharedColBuffer {
+  kOwnColBuffer = 0,
+  kWorkspaceColBuffer = 1,
+  kThreadLocalColBuffer = 2,
+};
+
 /**
  * Creates a mutex and shared buffer in the workspace.
  * Not thread-safe, must be called from the constructor.
@@ -38,6 +55,35 @@ template <typename Context>
 void runWithSharedBuffer(
     Workspace* ws,
     std::function<void(Tensor<Context>* buffer)> f);
+
+/**
+ * Thread-safe, runs f with a buffer owned by the calling thread. Falls back
+ * to the shared buffer of the workspace where per-thread buffers are not
+ * supported.
+ */
+template <typename Context>
+void runWithThreadLocalBuffer(
+    Workspace* ws,
+    std::function<void(Tensor<Context>* buffer)> f);
+
+/**
+ * Runs f with the col buffer selected by the shared_buffer argument of an
+ * operator, or with the buffer of the operator itself.
+ */
+template <typename Context>
+void runWithColBuffer(
+    Workspace* ws,
+    int shared_buffer,
+    Tensor<Context>* own_buffer,
+    std::function<void(Tensor<Context>* buffer)> f) {
+  if (shared_buffer == kThreadLocalColBuffer) {
+    runWithThreadLocalBuffer<Context>(ws, f);
+  } else if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer) {
+    runWithSharedBuffer<Context>(ws, f);
+  } else {
+    f(own_buffer);
+  }
+}
 } // namespace caffe2
 
 #endif // CAFFE2_OPERATORS_CONV_OP_SHARED_H_
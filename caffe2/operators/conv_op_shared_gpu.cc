@@ -40,4 +40,13 @@ void runWithSharedBuffer(
                      ->GetMutable<TensorCUDA>();
   f(buffer);
 }
+
+template <>
+void runWithThreadLocalBuffer(
+    Workspace* ws,
+    std::function<void(Tensor<CUDAContext>* buffer)> f) {
+  // A buffer kept per host thread could be on the wrong device, so the CUDA
+  // operators use the workspace buffer instead.
+  runWithSharedBuffer<CUDAContext>(ws, f);
+}
 }
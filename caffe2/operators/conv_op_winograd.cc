@@ -0,0 +1,243 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/conv_pool_op_base.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+// The F(4x4, 3x3) Winograd transforms of Lavin & Gray, "Fast Algorithms for
+// Convolutional Neural Networks": a 6x6 input tile d and a 3x3 filter g give
+// the 4x4 output tile A^T [(G g G^T) .* (B^T d B)] A.
+constexpr int kTile = 6;
+constexpr int kOut = 4;
+constexpr int kTileSize = kTile * kTile;
+
+const float kBT[kTile][kTile] = {
+    {4, 0, -5, 0, 1, 0},
+    {0, -4, -4, 1, 1, 0},
+    {0, 4, -4, -1, 1, 0},
+    {0, -2, -1, 2, 1, 0},
+    {0, 2, -1, -2, 1, 0},
+    {0, 4, 0, -5, 0, 1}};
+
+const float kG[kTile][3] = {
+    {1.f / 4, 0, 0},
+    {-1.f / 6, -1.f / 6, -1.f / 6},
+    {-1.f / 6, 1.f / 6, -1.f / 6},
+    {1.f / 24, 1.f / 12, 1.f / 6},
+    {1.f / 24, -1.f / 12, 1.f / 6},
+    {0, 0, 1}};
+
+const float kAT[kOut][kTile] = {
+    {1, 1, 1, 1, 1, 0},
+    {0, 1, -1, 2, -2, 0},
+    {0, 1, 1, 4, 4, 0},
+    {0, 1, -1, 8, -8, 1}};
+
+// out = L * in * L^T, with L of size R x S and in of size S x S.
+template <int R, int S>
+inline void Sandwich(const float (&L)[R][S], const float* in, float* out) {
+  float tmp[R][S];
+  for (int i = 0; i < R; ++i) {
+    for (int j = 0; j < S; ++j) {
+      float sum = 0;
+      for (int k = 0; k < S; ++k) {
+        sum += L[i][k] * in[k * S + j];
+      }
+      tmp[i][j] = sum;
+    }
+  }
+  for (int i = 0; i < R; ++i) {
+    for (int j = 0; j < R; ++j) {
+      float sum = 0;
+      for (int k = 0; k < S; ++k) {
+        sum += tmp[i][k] * L[j][k];
+      }
+      out[i * R + j] = sum;
+    }
+  }
+}
+
+} // namespace
+
+// 3x3 stride 1 convolution with the Winograd F(4x4, 3x3) algorithm, which
+// needs 36 multiplications per 4x4 output tile and input channel where direct
+// convolution needs 144, and no im2col buffer. The transformed filter is
+// cached until the filter tensor changes. Other configurations fall back to
+// the default engine.
+class WinogradConvOp final : public ConvPoolOpBase<CPUContext> {
+ public:
+  USE_CONV_POOL_BASE_FUNCTIONS(CPUContext);
+  WinogradConvOp(const OperatorDef& operator_def, Workspace* ws)
+      : ConvPoolOpBase<CPUContext>(operator_def, ws) {
+    OPERATOR_NEEDS_FEATURE(
+        order_ == StorageOrder::NCHW, "Winograd only supports NCHW.");
+    OPERATOR_NEEDS_FEATURE(group_ == 1, "Group convolution not supported.");
+    OPERATOR_NEEDS_FEATURE(
+        kernel_.size() == 2 && kernel_h() == 3 && kernel_w() == 3,
+        "Winograd only supports 3x3 kernels.");
+    OPERATOR_NEEDS_FEATURE(
+        stride_h() == 1 && stride_w() == 1, "Winograd needs stride 1.");
+    OPERATOR_NEEDS_FEATURE(
+        dilation_h() == 1 && dilation_w() == 1, "Winograd needs dilation 1.");
+  }
+
+  bool RunOnDeviceWithOrderNCHW() override {
+    const auto& X = Input(INPUT);
+    const auto& filter = Input(FILTER);
+    auto* Y = Output(0);
+    CAFFE_ENFORCE_EQ(X.ndim(), 4);
+    CAFFE_ENFORCE_EQ(filter.ndim(), 4);
+    const int N = X.dim32(0), C = X.dim32(1), H = X.dim32(2), W = X.dim32(3);
+    const int M = filter.dim32(0);
+    CAFFE_ENFORCE_EQ(filter.dim32(1), C);
+    CAFFE_ENFORCE_EQ(filter.dim32(2), 3);
+    CAFFE_ENFORCE_EQ(filter.dim32(3), 3);
+    const float* bias = nullptr;
+    if (InputSize() == 3) {
+      CAFFE_ENFORCE_EQ(Input(BIAS).ndim(), 1);
+      CAFFE_ENFORCE_EQ(Input(BIAS).dim32(0), M);
+      bias = Input(BIAS).data<float>();
+    }
+    ConvPoolOpBase<CPUContext>::SetOutputSize(X, Y, M);
+    const int OH = Y->dim32(2), OW = Y->dim32(3);
+    const int tiles_h = (OH + kOut - 1) / kOut;
+    const int tiles_w = (OW + kOut - 1) / kOut;
+    const int T = tiles_h * tiles_w;
+
+    TransformFilter(filter, M, C);
+    input_transform_.Resize(kTileSize, C, T);
+    products_.Resize(kTileSize, M, T);
+    float* V = input_transform_.mutable_data<float>();
+    float* P = products_.mutable_data<float>();
+    const float* U = filter_transform_.data<float>();
+    const float* Xdata = X.data<float>();
+    float* Ydata = Y->mutable_data<float>();
+
+    float d[kTileSize];
+    float v[kTileSize];
+    float m[kTileSize];
+    float y[kOut * kOut];
+    for (int image_id = 0; image_id < N; ++image_id) {
+      const float* Ximg = Xdata + image_id * C * H * W;
+      float* Yimg = Ydata + image_id * M * OH * OW;
+      // V[e][c][t] = (B^T d B)[e] for the tile t of channel c.
+      for (int c = 0; c < C; ++c) {
+        const float* Xc = Ximg + c * H * W;
+        for (int th = 0; th < tiles_h; ++th) {
+          for (int tw = 0; tw < tiles_w; ++tw) {
+            const int h0 = th * kOut - pad_t();
+            const int w0 = tw * kOut - pad_l();
+            for (int i = 0; i < kTile; ++i) {
+              for (int j = 0; j < kTile; ++j) {
+                const int h = h0 + i, w = w0 + j;
+                d[i * kTile + j] = (h >= 0 && h < H && w >= 0 && w < W)
+                    ? Xc[h * W + w]
+                    : 0.f;
+              }
+            }
+            Sandwich(kBT, d, v);
+            const int t = th * tiles_w + tw;
+            for (int e = 0; e < kTileSize; ++e) {
+              V[(e * C + c) * T + t] = v[e];
+            }
+          }
+        }
+      }
+      // The elementwise products summed over channels are 36 GEMMs.
+      for (int e = 0; e < kTileSize; ++e) {
+        math::Gemm<float, CPUContext>(
+            CblasNoTrans,
+            CblasNoTrans,
+            M,
+            T,
+            C,
+            1,
+            U + e * M * C,
+            V + e * C * T,
+            0,
+            P + e * M * T,
+            &context_);
+      }
+      for (int oc = 0; oc < M; ++oc) {
+        float* Yc = Yimg + oc * OH * OW;
+        const float b = bias ? bias[oc] : 0.f;
+        for (int th = 0; th < tiles_h; ++th) {
+          for (int tw = 0; tw < tiles_w; ++tw) {
+            const int t = th * tiles_w + tw;
+            for (int e = 0; e < kTileSize; ++e) {
+              m[e] = P[(e * M + oc) * T + t];
+            }
+            Sandwich(kAT, m, y);
+            for (int i = 0; i < kOut && th * kOut + i < OH; ++i) {
+              for (int j = 0; j < kOut && tw * kOut + j < OW; ++j) {
+                Yc[(th * kOut + i) * OW + tw * kOut + j] = y[i * kOut + j] + b;
+              }
+            }
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  bool RunOnDeviceWithOrderNHWC() override {
+    CAFFE_THROW("Winograd only supports NCHW.");
+  }
+
+ private:
+  // U[e][m][c] = (G g G^T)[e] for the filter g of output m and input c.
+  void TransformFilter(const TensorCPU& filter, int M, int C) {
+    if (&filter == filter_source_ && filter.raw_data() == filter_data_ &&
+        filter.version() == filter_version_ &&
+        filter_transform_.size() == kTileSize * M * C) {
+      return;
+    }
+    filter_transform_.Resize(kTileSize, M, C);
+    float* U = filter_transform_.mutable_data<float>();
+    const float* g = filter.data<float>();
+    float u[kTileSize];
+    for (int oc = 0; oc < M; ++oc) {
+      for (int c = 0; c < C; ++c) {
+        Sandwich(kG, g + (oc * C + c) * 9, u);
+        for (int e = 0; e < kTileSize; ++e) {
+          U[(e * M + oc) * C + c] = u[e];
+        }
+      }
+    }
+    filter_source_ = &filter;
+    filter_data_ = filter.raw_data();
+    filter_version_ = filter.version();
+  }
+
+  TensorCPU filter_transform_;
+  TensorCPU input_transform_;
+  TensorCPU products_;
+  const TensorCPU* filter_source_ = nullptr;
+  const void* filter_data_ = nullptr;
+  uint64_t filter_version_ = 0;
+  INPUT_TAGS(INPUT, FILTER, BIAS);
+};
+
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv, WINOGRAD, WinogradConvOp);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv2D, WINOGRAD, WinogradConvOp);
+
+} // namespace caffe2
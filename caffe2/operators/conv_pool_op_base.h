@@ -376,37 +376,18 @@ class ConvPoolOpBase : public Operator<Context> {
   static struct OpSchema::Cost CostInferenceForConv(
       const OperatorDef& def,
       const vector<TensorShape>& inputs) {
+    CAFFE_ENFORCE_GE(inputs.size(), 2, "Conv requires at least 2 inputs");
     struct OpSchema::Cost c;
-    const TensorShape X = inputs[0];
-    const TensorShape W = inputs[1];
-
-    ArgumentHelper helper(def);
-    const auto order =
-        StringToStorageOrder(helper.GetSingleArgument<string>("order", "NCHW"));
-
-    unsigned long long X_h;
-    unsigned long long X_w;
-    unsigned long long kernel_h;
-    unsigned long long kernel_w;
-    unsigned long long in_channels;
-    unsigned long long out_channels;
-    if (order == StorageOrder::NHWC) {
-      X_h = X.dims(1);
-      X_w = X.dims(2);
-      kernel_h = W.dims(1);
-      kernel_w = W.dims(2);
-      in_channels = W.dims(3);
-      out_channels = W.dims(0);
-    } else {
-      X_h = X.dims(2);
-      X_w = X.dims(3);
-      kernel_h = W.dims(2);
-      kernel_w = W.dims(3);
-      in_channels = W.dims(1);
-      out_channels = W.dims(0);
-    }
-    c.flops = (X_h - kernel_h + 1) * (X_w - kernel_w + 1) * kernel_w *
-        kernel_h * in_channels * out_channels * 2;
+    const TensorShape& X = inputs[0];
+    const TensorShape& W = inputs[1];
+    const TensorShape Y = TensorInferenceForConv(def, inputs)[0];
+    // Every output value is the dot product of a filter, whatever the order
+    // and the group, plus the bias if there is one.
+    c.flops = nElemFromDim(Y) *
+        (2 * nElemFromDim(W, 1) + (inputs.size() > 2 ? 1 : 0));
+    c.bytes_read = nBytes(X) + nBytes(W) +
+        (inputs.size() > 2 ? nBytes(inputs[2]) : 0);
+    c.bytes_written = nBytes(Y);
     return c;
   }
 
@@ -423,7 +404,7 @@ class ConvPoolOpBase : public Operator<Context> {
     vector<int> pads = helper.GetRepeatedArgument<int>("pads");
     vector<int> kernel = helper.GetRepeatedArgument<int>("kernels");
     vector<int> strides = helper.GetRepeatedArgument<int>("strides");
-    vector<int> dilations = helper.GetRepeatedArgument<int>("dilation");
+    vector<int> dilations = helper.GetRepeatedArgument<int>("dilations");
 
     if (helper.HasArgument("pad")) {
       pads.resize(4, helper.GetSingleArgument<int>("pad", 0));
@@ -453,11 +434,11 @@ class ConvPoolOpBase : public Operator<Context> {
     }
 
     if (helper.HasArgument("dilation")) {
-      strides.resize(2, helper.GetSingleArgument<int>("dilation", 1));
+      dilations.resize(2, helper.GetSingleArgument<int>("dilation", 1));
     } else if (
         helper.HasArgument("dilation_h") && helper.HasArgument("dilation_w")) {
-      strides.push_back(helper.GetSingleArgument<int>("dilation_h", 1));
-      strides.push_back(helper.GetSingleArgument<int>("dilation_w", 1));
+      dilations.push_back(helper.GetSingleArgument<int>("dilation_h", 1));
+      dilations.push_back(helper.GetSingleArgument<int>("dilation_w", 1));
     }
 
     auto check_and_set_default_value = [](
@@ -534,7 +515,7 @@ protected:
 
  int group_;
  StorageOrder order_;
- bool shared_buffer_;
+ int shared_buffer_;
  Workspace* ws_;
 
  static inline void ComputeSizeAndPad(
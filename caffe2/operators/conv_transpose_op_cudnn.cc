@@ -62,6 +62,8 @@ class CudnnConvTransposeOpBase : public ConvTransposeUnpoolBase<CUDAContext> {
             OperatorBase::GetSingleArgument<int>("deterministic", 0)),
         cudnn_state_(OperatorBase::GetSingleArgument<int>("cudnn_state", 0)) {
     CAFFE_ENFORCE(!deterministic_ || !exhaustive_search_);
+    exhaustive_search_ |=
+        FLAGS_caffe2_cudnn_exhaustive_search && !deterministic_;
     CUDNN_ENFORCE(cudnnCreateTensorDescriptor(&bottom_desc_));
     CUDNN_ENFORCE(cudnnCreateFilterDescriptor(&filter_desc_));
     if (InputSize() == 3) {
@@ -82,6 +84,19 @@ class CudnnConvTransposeOpBase : public ConvTransposeUnpoolBase<CUDAContext> {
   }
 
  protected:
+  // Identifies an algorithm search of this op for the persistent cache, the
+  // cache adds the input and filter shapes.
+  std::string AlgoCacheKey(const char* kind, const TypeMeta& type) const {
+    std::string key = CudnnAlgoCacheKeyPrefix(context_.cuda_gpu_id()) +
+        "|transpose_" + kind + "|" + type.name() + "|" +
+        caffe2::to_string(order_) + "|" +
+        caffe2::to_string(cudnn_ws_nbytes_limit_);
+    AppendToAlgoCacheKey(&key, stride_);
+    AppendToAlgoCacheKey(&key, pads_);
+    AppendToAlgoCacheKey(&key, adj_);
+    return key;
+  }
+
   vector<TIndex> cudnn_input_dims_;
   vector<TIndex> cudnn_filter_dims_;
 
@@ -283,8 +298,11 @@ bool CudnnConvTransposeOp<T>::RunOnDevice() {
     if (deterministic_) {
       bwd_data_algo_ = CUDNN_CONVOLUTION_BWD_DATA_ALGO_1;
     } else if (exhaustive_search_) {
-      bwd_data_algo_ =
-          data_algo_cache_.getAlgorithm(X.dims(), filter.dims(), [&]() {
+      bwd_data_algo_ = data_algo_cache_.getAlgorithm(
+          X.dims(),
+          filter.dims(),
+          AlgoCacheKey("bwd_data", TypeMeta::Make<T>()),
+          [&]() {
             int returned_algo_count;
             std::array<
                 cudnnConvolutionBwdDataAlgoPerf_t,
@@ -507,8 +525,11 @@ bool CudnnConvTransposeGradientOp<T>::RunOnDevice() {
       algo_ = CUDNN_CONVOLUTION_FWD_ALGO_IMPLICIT_PRECOMP_GEMM;
       bwd_filter_algo_ = CUDNN_CONVOLUTION_BWD_FILTER_ALGO_1;
     } else if (exhaustive_search_) {
-      bwd_filter_algo_ =
-          filter_algo_cache_.getAlgorithm(X.dims(), filter.dims(), [&]() {
+      bwd_filter_algo_ = filter_algo_cache_.getAlgorithm(
+          X.dims(),
+          filter.dims(),
+          AlgoCacheKey("bwd_filter", TypeMeta::Make<T>()),
+          [&]() {
 
             LOG(INFO) << "CUDNN Convolution bwd: doing exhaustive search.";
             // When we do an exhaustive search, we will ignore the workspace
@@ -543,7 +564,11 @@ bool CudnnConvTransposeGradientOp<T>::RunOnDevice() {
             return filter_perf_stat[0].algo;
           });
 
-      algo_ = forward_algo_cache_.getAlgorithm(X.dims(), filter.dims(), [&]() {
+      algo_ = forward_algo_cache_.getAlgorithm(
+          X.dims(),
+          filter.dims(),
+          AlgoCacheKey("fwd", TypeMeta::Make<T>()),
+          [&]() {
         int returned_algo_count;
         std::array<cudnnConvolutionFwdAlgoPerf_t, kNUM_CUDNN_FWD_ALGS>
             fwd_perf_stat;
@@ -146,11 +146,7 @@ bool ConvTransposeOp<T, Context>::RunOnDeviceWithOrderNCHW() {
       Ydata += Y->size() / Y->dim32(0);
     }
   };
-  if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
-    runWithSharedBuffer<Context>(ws_, f);
-  } else {
-    f(&col_buffer_);
-  }
+  runWithColBuffer<Context>(ws_, shared_buffer_, &col_buffer_, f);
   return true;
 }
 
@@ -254,11 +250,7 @@ bool ConvTransposeOp<T, Context>::RunOnDeviceWithOrderNHWC() {
       Ydata += Y->size() / Y->dim32(0);
     }
   };
-  if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
-    runWithSharedBuffer<Context>(ws_, f);
-  } else {
-    f(&col_buffer_);
-  }
+  runWithColBuffer<Context>(ws_, shared_buffer_, &col_buffer_, f);
   return true;
 }
 
@@ -693,11 +693,7 @@ bool ConvTransposeMobileOp<T, Context>::RunOnDeviceWithOrderNCHW() {
       Ydata += Y->size() / Y->dim32(0);
     }
   };
-  if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
-    runWithSharedBuffer<Context>(ws_, f);
-  } else {
-    f(&threadBuffer_);
-  }
+  runWithColBuffer<Context>(ws_, shared_buffer_, &threadBuffer_, f);
 
   return true;
 }
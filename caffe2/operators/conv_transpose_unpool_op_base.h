@@ -233,7 +233,7 @@ class ConvTransposeUnpoolBase : public Operator<Context> {
   vector<int> pads_;
   vector<int> adj_;
   StorageOrder order_;
-  bool shared_buffer_;
+  int shared_buffer_;
   Workspace* ws_;
 
   // Accessors for 2D conv params.
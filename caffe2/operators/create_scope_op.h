@@ -17,6 +17,8 @@
 #ifndef CAFFE2_OPERATORS_CREATE_SCOPE_OP_H_
 #define CAFFE2_OPERATORS_CREATE_SCOPE_OP_H_
 
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -34,15 +36,25 @@ namespace detail {
 
 /*
  * Keeps track of forward and backward gradient workspaces in stack,
- * reuses previously created workspaces, non-thread safe
+ * reuses previously created workspaces, non-thread safe.
+ *
+ * Every set of blob bindings is identified by an id from newBindingsId(),
+ * so that a workspace reused across iterations and runs only gets the
+ * bindings of a given operator added, and checked, the first time.
  */
 class WorkspaceStack {
  public:
   explicit WorkspaceStack() : parent_ws_(nullptr), top_(-1) {}
 
+  static size_t newBindingsId() {
+    static std::atomic<size_t> next_id{0};
+    return next_id++;
+  }
+
   std::shared_ptr<Workspace> pushForwardWorkspace(
       Workspace* parent_ws,
-      const std::unordered_map<std::string, std::string>& blob_bindings) {
+      const std::unordered_map<std::string, std::string>& blob_bindings,
+      size_t bindings_id) {
     checkStack();
     if (FLAGS_caffe2_workspace_stack_debug) {
       if (parent_ws_) {
@@ -60,13 +72,15 @@ class WorkspaceStack {
     if (top_ == workspaces_.size() - 1) {
       workspaces_.push_back(
           std::make_shared<Workspace>(parent_ws, blob_bindings));
+      mapped_bindings_.emplace_back(1, bindings_id);
     }
     return workspaces_[++top_];
   }
 
   std::shared_ptr<Workspace> popGradientWorkspace(
       Workspace* parent_ws,
-      const std::unordered_map<std::string, std::string>& grad_blob_bindings) {
+      const std::unordered_map<std::string, std::string>& grad_blob_bindings,
+      size_t bindings_id) {
     checkStack();
     if (FLAGS_caffe2_workspace_stack_debug) {
       if (parent_ws_) {
@@ -84,20 +98,19 @@ class WorkspaceStack {
     if (top_ < 0) {
       return nullptr;
     }
-    auto& grad_workspace = workspaces_[top_];
-    grad_workspace->AddBlobMapping(parent_ws, grad_blob_bindings);
-    --top_;
-    return grad_workspace;
+    addBlobMapping(parent_ws, grad_blob_bindings, bindings_id);
+    return workspaces_[top_--];
   }
 
   std::shared_ptr<Workspace> reuseLastForwardWorkspace(
       Workspace* parent_ws,
-      const std::unordered_map<std::string, std::string>& blob_bindings) {
+      const std::unordered_map<std::string, std::string>& blob_bindings,
+      size_t bindings_id) {
     checkStack();
     if (top_ < 0) {
       return nullptr;
     }
-    workspaces_[top_]->AddBlobMapping(parent_ws, blob_bindings);
+    addBlobMapping(parent_ws, blob_bindings, bindings_id);
     return workspaces_[top_];
   }
 
@@ -116,6 +129,17 @@ class WorkspaceStack {
         (int)workspaces_.size(), top_, "Corrupted workspaces stack");
   }
 
+  void addBlobMapping(
+      Workspace* parent_ws,
+      const std::unordered_map<std::string, std::string>& blob_bindings,
+      size_t bindings_id) {
+    auto& mapped = mapped_bindings_[top_];
+    if (std::find(mapped.begin(), mapped.end(), bindings_id) == mapped.end()) {
+      workspaces_[top_]->AddBlobMapping(parent_ws, blob_bindings);
+      mapped.push_back(bindings_id);
+    }
+  }
+
   void checkBindingsMatch(
       const std::unordered_map<std::string, std::string>& bindings,
       const std::unordered_map<std::string, std::string>& test_bindings) const {
@@ -136,6 +160,8 @@ class WorkspaceStack {
   Workspace* parent_ws_;
   int top_;
   std::vector<std::shared_ptr<Workspace>> workspaces_;
+  // Ids of the blob bindings already added to each of the workspaces.
+  std::vector<std::vector<size_t>> mapped_bindings_;
 };
 }
 
@@ -34,7 +34,17 @@ sizes are specified in the Input docs for this operator. As is expected, the
 filter is convolved with a subset of the image using the deformed kernel as
 specified by offsets blob and the bias is added; this is done throughout the
 image data and the output is computed.
+
+The sampled columns are unfolded a tile of output positions at a time, where a
+tile may span several images of the batch, so that no per-image column buffer
+of the whole output is materialized; each tile is multiplied by the filter
+with one GEMM per group.
   )DOC")
+    .Arg(
+        "tile_size",
+        "Number of output positions, counted across the batch, unfolded and "
+        "multiplied at a time. If 0 (default), the largest tile whose column "
+        "buffer fits in 1M elements.")
     .Input(
         0,
         "X",
@@ -354,6 +354,122 @@ void DeformConvOpBase<DType, Context>::DeformableIm2col(
           data_col);
 }
 
+/*!
+ * \brief deformable_im2col gpu kernel for a tile of output positions that
+ * may span several images of the batch, see DeformableIm2colTile.
+ */
+template <typename DType>
+__global__ void deformable_im2col_tile_gpu_kernel(
+    const int n,
+    const DType* data_im,
+    const DType* data_offset,
+    const int channels,
+    const int height,
+    const int width,
+    const int kernel_h,
+    const int kernel_w,
+    const int pad_h,
+    const int pad_w,
+    const int stride_h,
+    const int stride_w,
+    const int dilation_h,
+    const int dilation_w,
+    const int channel_per_deformable_group,
+    const int height_col,
+    const int width_col,
+    const int start,
+    const int count,
+    DType* data_col) {
+  CUDA_1D_KERNEL_LOOP(index, n) {
+    // Consecutive threads handle consecutive positions of a channel, and
+    // write consecutive columns.
+    const int t = index % count;
+    const int c_im = index / count;
+    const int position = start + t;
+    const int w_col = position % width_col;
+    const int h_col = (position / width_col) % height_col;
+    const int image_id = position / width_col / height_col;
+
+    const int deformable_group_index = c_im / channel_per_deformable_group;
+    const int deformable_groups = channels / channel_per_deformable_group;
+
+    const int h_in = h_col * stride_h - pad_h;
+    const int w_in = w_col * stride_w - pad_w;
+    DType* data_col_ptr = data_col + c_im * kernel_h * kernel_w * count + t;
+    const DType* data_im_ptr =
+        data_im + ((image_id * channels + c_im) * height + h_in) * width + w_in;
+    const DType* data_offset_ptr = data_offset +
+        (image_id * deformable_groups + deformable_group_index) * 2 *
+            kernel_h * kernel_w * height_col * width_col;
+
+    for (int i = 0; i < kernel_h; ++i) {
+      for (int j = 0; j < kernel_w; ++j) {
+        const int data_offset_h_ptr =
+            ((2 * (i * kernel_w + j)) * height_col + h_col) * width_col + w_col;
+        const int data_offset_w_ptr =
+            ((2 * (i * kernel_w + j) + 1) * height_col + h_col) * width_col +
+            w_col;
+        const DType offset_h = data_offset_ptr[data_offset_h_ptr];
+        const DType offset_w = data_offset_ptr[data_offset_w_ptr];
+        DType val = static_cast<DType>(0);
+        const DType h_im = h_in + i * dilation_h + offset_h;
+        const DType w_im = w_in + j * dilation_w + offset_w;
+        if (h_im >= 0 && w_im >= 0 && h_im < height && w_im < width) {
+          const DType map_h = i * dilation_h + offset_h;
+          const DType map_w = j * dilation_w + offset_w;
+          const int cur_height = height - h_in;
+          const int cur_width = width - w_in;
+          val = deformable_im2col_bilinear(
+              data_im_ptr, width, cur_height, cur_width, map_h, map_w);
+        }
+        *data_col_ptr = val;
+        data_col_ptr += count;
+      }
+    }
+  }
+}
+
+template <typename DType, typename Context>
+void DeformConvOpBase<DType, Context>::DeformableIm2colTile(
+    const DType* data_im,
+    const DType* data_offset,
+    const std::vector<TIndex>& im_shape,
+    const int height_col,
+    const int width_col,
+    const int start,
+    const int count,
+    DType* data_col) {
+  CAFFE_ENFORCE_EQ(pad_t(), pad_b());
+  CAFFE_ENFORCE_EQ(pad_l(), pad_r());
+  const int channels = im_shape[1];
+  const int num_kernels = channels * count;
+  deformable_im2col_tile_gpu_kernel<DType>
+      <<<CAFFE_GET_BLOCKS(num_kernels),
+         CAFFE_CUDA_NUM_THREADS,
+         0,
+         context_.cuda_stream()>>>(
+          num_kernels,
+          data_im,
+          data_offset,
+          channels,
+          im_shape[2],
+          im_shape[3],
+          kernel_h(),
+          kernel_w(),
+          pad_t(),
+          pad_l(),
+          stride_h(),
+          stride_w(),
+          dilation_h(),
+          dilation_w(),
+          channels / deformable_group_,
+          height_col,
+          width_col,
+          start,
+          count,
+          data_col);
+}
+
 /*!
  * \brief deformable_col2im gpu kernel.
  * \brief DO NOT call this directly. Use wrapper function deformable_col2im()
@@ -43,6 +43,18 @@ class DeformConvOpBase : public ConvPoolOpBase<Context> {
       const std::vector<TIndex>& im_shape,
       const std::vector<TIndex>& col_shape,
       T* data_col);
+  // Unfolds the output positions [start, start + count) of the whole batch,
+  // numbered image by image, into the count columns of data_col, which has
+  // channels * kernel_h * kernel_w rows.
+  void DeformableIm2colTile(
+      const T* data_im,
+      const T* data_offset,
+      const std::vector<TIndex>& im_shape,
+      const int height_col,
+      const int width_col,
+      const int start,
+      const int count,
+      T* data_col);
   void DeformableCol2im(
       const T* data_col,
       const T* data_offset,
@@ -60,11 +72,12 @@ class DeformConvOpBase : public ConvPoolOpBase<Context> {
  protected:
   int deformable_group_;
 
-#define USE_DEFORMABLE_CONV_BASE_FUNCTIONS(T, Context)   \
-  USE_CONV_POOL_BASE_FUNCTIONS(Context);                 \
-  using DeformConvOpBase<T, Context>::deformable_group_; \
-  using DeformConvOpBase<T, Context>::DeformableIm2col;  \
-  using DeformConvOpBase<T, Context>::DeformableCol2im;  \
+#define USE_DEFORMABLE_CONV_BASE_FUNCTIONS(T, Context)      \
+  USE_CONV_POOL_BASE_FUNCTIONS(Context);                    \
+  using DeformConvOpBase<T, Context>::deformable_group_;    \
+  using DeformConvOpBase<T, Context>::DeformableIm2col;     \
+  using DeformConvOpBase<T, Context>::DeformableIm2colTile; \
+  using DeformConvOpBase<T, Context>::DeformableCol2im;     \
   using DeformConvOpBase<T, Context>::DeformableCol2imCoord
 };
 
@@ -74,7 +87,9 @@ class DeformConvOp final : public DeformConvOpBase<T, Context> {
   USE_DEFORMABLE_CONV_BASE_FUNCTIONS(T, Context);
 
   DeformConvOp(const OperatorDef& operator_def, Workspace* ws)
-      : DeformConvOpBase<T, Context>(operator_def, ws) {
+      : DeformConvOpBase<T, Context>(operator_def, ws),
+        tile_size_(OperatorBase::GetSingleArgument<int>("tile_size", 0)) {
+    CAFFE_ENFORCE_GE(tile_size_, 0);
     // Create shared buffer mutex in the constructor
     // to avoid race-condition in DAGNet.
     if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
@@ -86,10 +101,14 @@ class DeformConvOp final : public DeformConvOpBase<T, Context> {
   bool RunOnDeviceWithOrderNCHW() override;
 
  private:
+  // Output positions unfolded at a time; if 0, as many as fit in a col
+  // buffer of kDefaultColBufferSize elements.
+  const int tile_size_;
+  static constexpr int kDefaultColBufferSize = 1 << 20;
   Tensor<Context> col_buffer_;
+  // Output of a tile that spans several images, before it is scattered
+  Tensor<Context> tile_output_;
   Tensor<Context> bias_multiplier_;
-  Tensor<Context> img_shape_device_;
-  Tensor<Context> col_buffer_shape_device_;
   // Input: X, o, W, b
   // Output: Y
   INPUT_TAGS(INPUT, OFFSET, FILTER, BIAS);
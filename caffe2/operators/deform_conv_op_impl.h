@@ -18,6 +18,8 @@
 #ifndef CAFFE2_OPERATORS_DEFORM_CONV_OP_IMPL_H_
 #define CAFFE2_OPERATORS_DEFORM_CONV_OP_IMPL_H_
 
+#include <algorithm>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/flags.h"
 #include "caffe2/core/logging.h"
@@ -100,30 +102,23 @@ bool DeformConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
 
   ConvPoolOpBase<Context>::SetOutputSize(X, Y, filter.dim32(0));
 
-  const vector<int> input_dims = GetDims(X);
   const vector<int> output_dims = GetDims(*Y);
-  const int input_image_size = this->GetDimsSize(X);
   const int output_image_size = this->GetDimsSize(*Y);
 
-  vector<int> img_shape;
-  img_shape.assign(X.dims().begin() + 1, X.dims().end());
-
-  vector<int> buffer_shape;
-  buffer_shape.push_back(C / group_ * kernel_dims_size);
-  buffer_shape.insert(
-      buffer_shape.end(), output_dims.begin(), output_dims.end());
+  // The output positions of the whole batch are unfolded a tile at a time,
+  // so the col buffer is bounded by the tile rather than by the output
+  // area, and small images are batched into one GEMM. Its rows are the C
+  // channels times the kernel positions, a contiguous block per group.
+  const int col_rows = C * kernel_dims_size;
+  const int total_positions = N * output_image_size;
+  int tile = tile_size_ > 0 ? tile_size_
+                            : std::max(1, kDefaultColBufferSize / col_rows);
+  tile = std::min(tile, total_positions);
 
   // The dimension of each kernel
   const int kernel_dim = C / group_ * kernel_dims_size;
-  // The offset corresponding to a single input image, and a single output
-  // image.
-  const int input_offset = C / group_ * input_image_size;
-  const int output_offset = M / group_ * output_image_size;
-  const int offset_offset = offset.size() / offset.dim32(0);
   const int filter_offset = filter.size() / group_;
 
-  // The col buffer is stored in CHW order as well - kernel_dim, and the height
-  // and width.
   const T* Xdata = X.template data<T>();
   const T* offset_data = offset.template data<T>();
 
@@ -150,32 +145,71 @@ bool DeformConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
   }
 
   auto f = [&](Tensor<Context>* col_buffer) {
-    col_buffer->Resize(buffer_shape);
+    col_buffer->Resize(vector<TIndex>{col_rows, tile});
     T* col_buffer_data = col_buffer->template mutable_data<T>();
-    // Im2col, followed by gemm.
-    for (int image_id = 0; image_id < N; ++image_id) {
+    for (int start = 0; start < total_positions; start += tile) {
+      const int count = std::min(tile, total_positions - start);
+      DeformableIm2colTile(
+          Xdata,
+          offset_data,
+          X.dims(),
+          output_dims[0],
+          output_dims[1],
+          start,
+          count,
+          col_buffer_data);
+
+      // A tile inside of one image is multiplied straight into the output,
+      // one that spans images into a buffer that is scattered afterwards.
+      const int image_id = start / output_image_size;
+      const int first = start % output_image_size;
+      const bool one_image = first + count <= output_image_size;
+      T* tile_data;
+      int ld;
+      if (one_image) {
+        tile_data = Ydata + image_id * M * output_image_size + first;
+        ld = output_image_size;
+      } else {
+        tile_output_.Resize(M, count);
+        tile_data = tile_output_.template mutable_data<T>();
+        ld = count;
+      }
       for (int group_id = 0; group_id < group_; ++group_id) {
-        DeformableIm2col(
-            Xdata + group_id * input_offset,
-            offset_data,
-            X.dims(),
-            col_buffer->dims(),
-            col_buffer_data);
-        // Weight term
-        math::Gemm<T, Context>(
+        math::GemmEx<T, Context>(
             CblasNoTrans,
             CblasNoTrans,
             M / group_,
-            output_image_size,
+            count,
             kernel_dim,
             1,
             filter.template data<T>() + group_id * filter_offset,
-            col_buffer_data,
+            kernel_dim,
+            col_buffer_data + group_id * kernel_dim * count,
+            count,
             0,
-            Ydata + group_id * output_offset,
+            tile_data + group_id * (M / group_) * ld,
+            ld,
             &context_);
       }
-      if (bias_data) {
+      for (int done = 0; !one_image && done < count;) {
+        const int position = start + done;
+        const int image_start = position % output_image_size;
+        const int length =
+            std::min(count - done, output_image_size - image_start);
+        math::CopyMatrix<Context>(
+            sizeof(T),
+            M,
+            length,
+            tile_data + done,
+            count,
+            Ydata + (position - image_start) * M + image_start,
+            output_image_size,
+            &context_);
+        done += length;
+      }
+    }
+    if (bias_data) {
+      for (int image_id = 0; image_id < N; ++image_id) {
         math::Gemm<T, Context>(
             CblasNoTrans,
             CblasNoTrans,
@@ -186,20 +220,13 @@ bool DeformConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
             bias_data,
             bias_multiplier_.template data<T>(),
             1,
-            Ydata,
+            Ydata + image_id * M * output_image_size,
             &context_);
       }
-      Xdata += input_offset * group_;
-      Ydata += output_offset * group_;
-      offset_data += offset_offset;
     }
   };
 
-  if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
-    runWithSharedBuffer<Context>(ws_, f);
-  } else {
-    f(&col_buffer_);
-  }
+  runWithColBuffer<Context>(ws_, shared_buffer_, &col_buffer_, f);
   return true;
 }
 
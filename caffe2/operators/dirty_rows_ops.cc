@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <vector>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/core/tensor.h"
+
+namespace caffe2 {
+namespace {
+
+// Marks the rows of a parameter that a sparse update touches, so that an
+// incremental checkpoint only has to write those.
+class MarkDirtyRowsOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  MarkDirtyRowsOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    const auto& indices = Input(INDICES);
+    const auto& param = Input(PARAM);
+    auto* dirty = Output(DIRTY);
+    CAFFE_ENFORCE_GE(param.ndim(), 1);
+    const TIndex rows = param.dim(0);
+    if (dirty->ndim() != 1 || dirty->dim(0) != rows) {
+      // The marks of the existing rows are kept, the new rows start unmarked.
+      std::vector<char> old;
+      if (dirty->size() > 0) {
+        const bool* old_flags = dirty->data<bool>();
+        old.assign(
+            old_flags, old_flags + std::min<TIndex>(dirty->size(), rows));
+      }
+      dirty->Resize(rows);
+      bool* flags = dirty->mutable_data<bool>();
+      std::fill(flags, flags + rows, false);
+      std::copy(old.begin(), old.end(), flags);
+    }
+    bool* flags = dirty->mutable_data<bool>();
+    const IndexType* idx = indices.template data<IndexType>();
+    for (TIndex i = 0; i < indices.size(); ++i) {
+      CAFFE_ENFORCE(
+          0 <= idx[i] && idx[i] < rows,
+          "Index ",
+          i,
+          " is out of bounds: ",
+          idx[i],
+          ", range 0 to ",
+          rows);
+      flags[idx[i]] = true;
+    }
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(DIRTY_IN, INDICES, PARAM);
+  OUTPUT_TAGS(DIRTY);
+};
+
+// Copies the rows marked in DIRTY out of PARAM, along with their ids, and
+// clears the marks. The copy is a snapshot of the changed rows that can be
+// written out while the training keeps updating PARAM.
+class GatherDirtyRowsOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  GatherDirtyRowsOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    const auto& param = Input(PARAM);
+    const auto& dirty = Input(DIRTY_IN);
+    auto* row_ids = Output(ROW_IDS);
+    auto* rows = Output(ROWS);
+    CAFFE_ENFORCE_GE(param.ndim(), 1);
+    const TIndex num_rows = param.dim(0);
+    CAFFE_ENFORCE_LE(
+        dirty.size(),
+        num_rows,
+        "DIRTY has more rows than PARAM, it does not belong to it");
+
+    const bool* flags = dirty.size() > 0 ? dirty.data<bool>() : nullptr;
+    const TIndex num_dirty = std::count(flags, flags + dirty.size(), true);
+    row_ids->Resize(num_dirty);
+    auto shape = param.dims();
+    shape[0] = num_dirty;
+    rows->Resize(shape);
+    auto* ids = row_ids->mutable_data<int64_t>();
+    auto* dst = static_cast<char*>(rows->raw_mutable_data(param.meta()));
+    const auto* src = static_cast<const char*>(param.raw_data());
+    const TIndex block_size = param.size_from_dim(1);
+    const TIndex block_bytesize = block_size * param.itemsize();
+
+    // Runs of consecutive dirty rows are copied at once.
+    TIndex k = 0;
+    for (TIndex i = 0; i < dirty.size();) {
+      if (!flags[i]) {
+        ++i;
+        continue;
+      }
+      TIndex end = i + 1;
+      while (end < dirty.size() && flags[end]) {
+        ++end;
+      }
+      context_.CopyItems<CPUContext, CPUContext>(
+          param.meta(),
+          (end - i) * block_size,
+          src + i * block_bytesize,
+          dst + k * block_bytesize);
+      for (; i < end; ++i) {
+        ids[k++] = i;
+      }
+    }
+
+    if (OutputSize() > DIRTY && dirty.size() > 0) {
+      bool* out_flags = Output(DIRTY)->mutable_data<bool>();
+      std::fill(out_flags, out_flags + dirty.size(), false);
+    }
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(PARAM, DIRTY_IN);
+  OUTPUT_TAGS(ROW_IDS, ROWS, DIRTY);
+};
+
+REGISTER_CPU_OPERATOR(MarkDirtyRows, MarkDirtyRowsOp);
+REGISTER_CPU_OPERATOR(GatherDirtyRows, GatherDirtyRowsOp);
+
+OPERATOR_SCHEMA(MarkDirtyRows)
+    .NumInputs(3)
+    .NumOutputs(1)
+    .EnforceInplace({{0, 0}})
+    .SetDoc(R"DOC(
+Marks the rows INDICES of PARAM as changed in the boolean vector DIRTY. Meant
+to run next to a sparse optimizer update of PARAM, so that GatherDirtyRows can
+later copy out only the rows that changed since the last checkpoint.
+
+DIRTY is resized to the number of rows of PARAM when it does not match it, the
+marks of the existing rows are kept and the new rows start unmarked. It can be
+initialized to an empty tensor.
+)DOC")
+    .Input(0, "DIRTY", "Boolean vector with one mark per row of PARAM")
+    .Input(1, "INDICES", "int32 or int64 row indices that were updated")
+    .Input(2, "PARAM", "The parameter the rows belong to")
+    .Output(0, "DIRTY", "Same as the input, with INDICES marked");
+
+OPERATOR_SCHEMA(GatherDirtyRows)
+    .NumInputs(2)
+    .NumOutputs(2, 3)
+    .EnforceInplace({{1, 2}})
+    .SetDoc(R"DOC(
+Copies the rows of PARAM that are marked in DIRTY into ROWS, and their
+indices into ROW_IDS. When the DIRTY output is given, the marks are cleared,
+so that the next call only returns the rows changed after this one.
+
+ROW_IDS and ROWS make up a delta on top of an earlier snapshot of PARAM,
+which can be saved with Save and merged back with ScatterAssign after
+loading the snapshot. Since ROWS is a copy, it can be saved while PARAM keeps
+being trained.
+)DOC")
+    .Input(0, "PARAM", "The parameter to take the rows from")
+    .Input(1, "DIRTY", "Boolean vector of the marked rows, see MarkDirtyRows")
+    .Output(0, "ROW_IDS", "int64 vector of the indices of the marked rows")
+    .Output(1, "ROWS", "The marked rows of PARAM")
+    .Output(2, "DIRTY", "(Optional) DIRTY with all the marks cleared");
+
+SHOULD_NOT_DO_GRADIENT(MarkDirtyRows);
+SHOULD_NOT_DO_GRADIENT(GatherDirtyRows);
+
+} // namespace
+} // namespace caffe2
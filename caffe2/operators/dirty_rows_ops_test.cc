@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+void FillParam(Workspace* ws, const string& name, int rows, float offset) {
+  auto* param = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  param->Resize(rows, 4);
+  for (int i = 0; i < param->size(); ++i) {
+    param->mutable_data<float>()[i] = i + offset;
+  }
+}
+
+void MarkRows(Workspace* ws, const vector<int64_t>& rows) {
+  auto* indices = ws->CreateBlob("indices")->GetMutable<TensorCPU>();
+  indices->Resize(rows.size());
+  std::copy(rows.begin(), rows.end(), indices->mutable_data<int64_t>());
+  ASSERT_TRUE(ws->RunOperatorOnce(CreateOperatorDef(
+      "MarkDirtyRows", "", {"dirty", "indices", "param"}, {"dirty"})));
+}
+
+} // namespace
+
+TEST(DirtyRowsTest, DeltaRestoresChangedRows) {
+  Workspace ws;
+  FillParam(&ws, "param", 10, 0);
+  ws.CreateBlob("dirty")->GetMutable<TensorCPU>()->Resize(0);
+  MarkRows(&ws, {7, 2, 3, 7});
+  EXPECT_EQ(ws.GetBlob("dirty")->Get<TensorCPU>().size(), 10);
+
+  // The rows changed since the base snapshot are copied out with their ids.
+  FillParam(&ws, "base", 10, 0);
+  FillParam(&ws, "param", 10, 100);
+  const auto gather = CreateOperatorDef(
+      "GatherDirtyRows",
+      "",
+      {"param", "dirty"},
+      {"row_ids", "rows", "dirty"});
+  ASSERT_TRUE(ws.RunOperatorOnce(gather));
+  const auto& row_ids = ws.GetBlob("row_ids")->Get<TensorCPU>();
+  const auto& rows = ws.GetBlob("rows")->Get<TensorCPU>();
+  ASSERT_EQ(row_ids.size(), 3);
+  EXPECT_EQ(row_ids.data<int64_t>()[0], 2);
+  EXPECT_EQ(row_ids.data<int64_t>()[1], 3);
+  EXPECT_EQ(row_ids.data<int64_t>()[2], 7);
+  EXPECT_EQ(rows.dims(), vector<TIndex>({3, 4}));
+  EXPECT_EQ(rows.data<float>()[4], 112);
+
+  // Merging the delta into the base gives the changed rows back.
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "ScatterAssign", "", {"base", "row_ids", "rows"}, {"base"})));
+  const auto& base = ws.GetBlob("base")->Get<TensorCPU>();
+  for (int i = 0; i < base.size(); ++i) {
+    const int row = i / 4;
+    const bool changed = row == 2 || row == 3 || row == 7;
+    EXPECT_EQ(base.data<float>()[i], i + (changed ? 100 : 0));
+  }
+
+  // The marks were cleared, and survive the parameter growing.
+  ASSERT_TRUE(ws.RunOperatorOnce(gather));
+  EXPECT_EQ(ws.GetBlob("row_ids")->Get<TensorCPU>().size(), 0);
+  MarkRows(&ws, {1});
+  FillParam(&ws, "param", 12, 0);
+  MarkRows(&ws, {11});
+  ASSERT_TRUE(ws.RunOperatorOnce(gather));
+  const auto& grown_ids = ws.GetBlob("row_ids")->Get<TensorCPU>();
+  ASSERT_EQ(grown_ids.size(), 2);
+  EXPECT_EQ(grown_ids.data<int64_t>()[0], 1);
+  EXPECT_EQ(grown_ids.data<int64_t>()[1], 11);
+}
+
+} // namespace caffe2
@@ -17,6 +17,7 @@
 #ifndef CAFFE2_OPERATORS_DO_OP_H_
 #define CAFFE2_OPERATORS_DO_OP_H_
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -25,6 +26,7 @@
 #include "caffe2/core/context.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/operators/create_scope_op.h"
 #include "caffe2/proto/caffe2.pb.h"
 
 namespace caffe2 {
@@ -37,7 +39,9 @@ class DoOp final : public Operator<Context> {
     CAFFE_ENFORCE(
         this->template HasSingleArgumentOfType<NetDef>("net"),
         "net must be specified in Do operator");
-    net_def_ = this->template GetSingleArgument<NetDef>("net", NetDef());
+    net_def_ = std::make_shared<const NetDef>(
+        this->template GetSingleArgument<NetDef>("net", NetDef()));
+    bindings_id_ = detail::WorkspaceStack::newBindingsId();
     is_gradient_op_ = operator_def.is_gradient_op();
     reuse_workspace_ =
         this->template GetSingleArgument<bool>("reuse_workspace", false);
@@ -148,10 +152,19 @@ class DoOp final : public Operator<Context> {
   }
 
   std::unordered_map<std::string, std::string> blob_bindings_;
+  size_t bindings_id_;
   bool is_gradient_op_;
   bool reuse_workspace_;
-  NetDef net_def_;
+  std::shared_ptr<const NetDef> net_def_;
   Workspace* parent_ws_;
+  // Subnet instantiated in each of the workspaces of the scope, so that
+  // iterations reusing a workspace skip the lookup of the net by name. The
+  // weak pointer tells whether the workspace is still the one the net was
+  // created in.
+  std::unordered_map<
+      Workspace*,
+      std::pair<std::weak_ptr<Workspace>, NetBase*>>
+      nets_;
 };
 
 } // namespace caffe2
@@ -31,17 +31,15 @@ bool DropoutOp<float, CPUContext>::RunOnDevice() {
     return true;
   } else {
     float scale = 1. / (1. - ratio_);
-    // mask=true means keep, and mask=false means not keep, so we will
-    // generate probability depending on 1-ratio.
-    std::bernoulli_distribution dist(1. - ratio_);
     const float* Xdata = X.data<float>();
     float* Ydata = Y->mutable_data<float>();
     auto mask = Output(1);
     mask->Resize(X.dims());
     bool* mask_data = mask->mutable_data<bool>();
-    auto& gen = context_.RandGenerator();
+    // mask=true means keep, and mask=false means not keep, so we will
+    // generate probability depending on 1-ratio.
+    context_.PhiloxRandGenerator().Bernoulli(X.size(), 1. - ratio_, mask_data);
     for (int i = 0; i < X.size(); ++i) {
-      mask_data[i] = dist(gen);
       Ydata[i] = Xdata[i] * scale * mask_data[i];
     }
     return true;
@@ -23,8 +23,11 @@
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/run_chunks.h"
 
+#include <algorithm>
 #include <tuple>
+#include <type_traits>
 
 namespace caffe2 {
 
@@ -149,6 +152,12 @@ std::tuple<size_t, size_t, size_t> calculate_broadcast_sizes(
   return std::make_tuple(pre, n, post);
 }
 
+// How B is broadcast to A, in terms of calculate_broadcast_sizes: kRow when
+// post is 1, i.e. B is added to every row of a (pre, n) matrix as a bias,
+// and kChannel when B has one value per block of post elements, like a
+// per-channel scale in NCHW order.
+enum class BroadcastPattern { kSameShape, kScalar, kRow, kChannel };
+
 /**
  * Performs a binary operation (e.g. +, - or /) with optional broadcast support.
  *
@@ -181,7 +190,11 @@ class BinaryElementwiseOp : public Operator<Context> {
         OP_SINGLE_ARG(int, "axis", axis_, -1),
         OP_SINGLE_ARG(string, "axis_str", axis_str_, ""),
         OP_SINGLE_ARG(string, "order", order_, "NCHW"),
+        OP_SINGLE_ARG(int, "num_threads", num_threads_, 1),
+        ws_(ws),
+        pattern_(BroadcastPattern::kSameShape),
         functor_() {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
     // Figure out the correct axis to use.
     if (enable_broadcast_) {
       if (axis_ != -1) {
@@ -233,27 +246,111 @@ class BinaryElementwiseOp : public Operator<Context> {
           A.dims(),
           B.dims(),
           "Dimension mismatch - did you forget to set broadcast=1?");
-      functor_.template Run<false>(A.size(), Adata, Bdata, Cdata, &context_);
-    } else if (B.size() == 1) {
-      functor_.template Run<true>(A.size(), Adata, Bdata, Cdata, &context_);
+    } else if (A.dims() != a_dims_ || B.dims() != b_dims_) {
+      UpdateBroadcastPattern(A, B);
+    }
+    // The CUDA functors launch a kernel per call, so only the CPU ones are
+    // split over threads.
+    const int max_chunks =
+        std::is_same<Context, CPUContext>::value ? num_threads_ : 1;
+    switch (pattern_) {
+      case BroadcastPattern::kSameShape:
+        RunChunks(
+            ws_, max_chunks, A.size(), 1, [&](int, TIndex begin, TIndex end) {
+              functor_.template Run<false>(
+                  end - begin,
+                  Adata + begin,
+                  Bdata + begin,
+                  Cdata + begin,
+                  &context_);
+            });
+        break;
+      case BroadcastPattern::kScalar:
+        RunChunks(
+            ws_, max_chunks, A.size(), 1, [&](int, TIndex begin, TIndex end) {
+              functor_.template Run<true>(
+                  end - begin, Adata + begin, Bdata, Cdata + begin, &context_);
+            });
+        break;
+      case BroadcastPattern::kRow:
+        RunChunks(
+            ws_, max_chunks, pre_, n_, [&](int, TIndex begin, TIndex end) {
+              functor_.RunWithBroadcast(
+                  Adata + begin * n_,
+                  Bdata,
+                  Cdata + begin * n_,
+                  end - begin,
+                  n_,
+                  &context_);
+            });
+        break;
+      case BroadcastPattern::kChannel:
+        // Split over the pre * n blocks rather than the pre rows, so that a
+        // batch of one is split too.
+        RunChunks(
+            ws_,
+            max_chunks,
+            pre_ * n_,
+            post_,
+            [&](int, TIndex begin, TIndex end) {
+              if (end - begin == pre_ * n_) {
+                functor_.RunWithBroadcast2(
+                    Adata, Bdata, Cdata, pre_, n_, post_, &context_);
+                return;
+              }
+              for (TIndex i = begin / n_; i * n_ < end; ++i) {
+                const TIndex j_begin = std::max<TIndex>(begin - i * n_, 0);
+                const TIndex j_end = std::min<TIndex>(end - i * n_, n_);
+                const TIndex offset = (i * n_ + j_begin) * post_;
+                functor_.RunWithBroadcast2(
+                    Adata + offset,
+                    Bdata + j_begin,
+                    Cdata + offset,
+                    1,
+                    j_end - j_begin,
+                    post_,
+                    &context_);
+              }
+            });
+        break;
+    }
+    return true;
+  }
+
+ private:
+  // Resolves the broadcast pattern, which is kept until the shapes change.
+  void UpdateBroadcastPattern(
+      const Tensor<Context>& A,
+      const Tensor<Context>& B) {
+    if (B.size() == 1) {
+      pattern_ = BroadcastPattern::kScalar;
+    } else if (A.dims() == B.dims() && axis_ <= 0) {
+      pattern_ = BroadcastPattern::kSameShape;
     } else {
       size_t pre, n, post;
       std::tie(pre, n, post) = calculate_broadcast_sizes(A, B, axis_);
-      if (post == 1) {
-        functor_.RunWithBroadcast(Adata, Bdata, Cdata, pre, n, &context_);
-      } else {
-        functor_.RunWithBroadcast2(
-            Adata, Bdata, Cdata, pre, n, post, &context_);
-      }
+      pattern_ =
+          post == 1 ? BroadcastPattern::kRow : BroadcastPattern::kChannel;
+      pre_ = pre;
+      n_ = n;
+      post_ = post;
     }
-    return true;
+    a_dims_ = A.dims();
+    b_dims_ = B.dims();
   }
 
- private:
   bool enable_broadcast_;
   int axis_;
   string axis_str_;
   string order_;
+  int num_threads_;
+  Workspace* ws_;
+  BroadcastPattern pattern_;
+  TIndex pre_ = 1;
+  TIndex n_ = 1;
+  TIndex post_ = 1;
+  vector<TIndex> a_dims_;
+  vector<TIndex> b_dims_;
   Functor functor_;
 };
 
@@ -428,10 +525,9 @@ bool DivGradientOp<Context>::RunOnDevice() {
         size_t n,                                                            \
         size_t post,                                                         \
         CPUContext*) {                                                       \
-      for (int i = 0; i < pre; ++i) {                                        \
-        EigenArrayMap<R>(out + i * n * post, post, n) = eigen_op(            \
-            (ConstEigenArrayMap<T>(a + i * n * post, post, n).rowwise()),    \
-            (Eigen::Map<const Eigen::Array<T, 1, Eigen::Dynamic>>(b, n)));   \
+      for (size_t i = 0; i < pre * n; ++i) {                                 \
+        EigenVectorArrayMap<R>(out + i * post, post) = eigen_op(             \
+            (ConstEigenVectorArrayMap<T>(a + i * post, post)), (b[i % n]));  \
       }                                                                      \
     }                                                                        \
   };                                                                         \
@@ -51,6 +51,10 @@ Performs element-wise binary {name} (with limited broadcast support).
     schema.Arg(
         "axis",
         "If set, defines the broadcast dimensions. See doc for details.");
+    schema.Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the CPU "
+        "implementation splits the elements over (Default: 1).");
     schema.Input(
         0,
         "A",
@@ -67,24 +71,28 @@ Performs element-wise binary {name} (with limited broadcast support).
 OPERATOR_SCHEMA(Add)
     .NumInputs(2)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<1>)
     .AllowInplace({{0, 0}, {1, 0}})
     .IdenticalTypeAndShapeOfInput(0)
     .FillUsing(MathDocGenerator("addition"));
 OPERATOR_SCHEMA(Sub)
     .NumInputs(2)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<1>)
     .AllowInplace({{0, 0}, {1, 0}})
     .IdenticalTypeAndShapeOfInput(0)
     .FillUsing(MathDocGenerator("subtraction"));
 OPERATOR_SCHEMA(Mul)
     .NumInputs(2)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<1>)
     .AllowInplace({{0, 0}, {1, 0}})
     .IdenticalTypeAndShapeOfInput(0)
     .FillUsing(MathDocGenerator("multiplication"));
 OPERATOR_SCHEMA(Div)
     .NumInputs(2)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<1>)
     .AllowInplace({{0, 0}})
     .IdenticalTypeAndShapeOfInput(0)
     .FillUsing(MathDocGenerator("division"));
@@ -296,6 +304,10 @@ Performs element-wise {desc} comparison `{name}` (with limited broadcast support
     schema.Arg(
         "axis",
         "If set, defines the broadcast dimensions. See doc for details.");
+    schema.Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the CPU "
+        "implementation splits the elements over (Default: 1).");
     schema.Input(
         0,
         "A",
@@ -333,6 +345,10 @@ Both input operands should be of type `bool`.
     schema.Arg(
         "axis",
         "If set, defines the broadcast dimensions. See doc for details.");
+    schema.Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the CPU "
+        "implementation splits the elements over (Default: 1).");
     schema.Input(0, "A", "First operand.");
     schema.Input(
         1,
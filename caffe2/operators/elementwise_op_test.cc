@@ -17,6 +17,7 @@
 #include "caffe2/operators/elementwise_op_test.h"
 
 #include "caffe2/core/flags.h"
+#include "caffe2/utils/proto_utils.h"
 
 CAFFE2_DECLARE_string(caffe_test_root);
 
@@ -52,3 +53,66 @@ TEST(ElementwiseTest, Not) {
 TEST(ElementwiseTest, EQ) {
   elementwiseEQ<caffe2::CPUContext>();
 }
+
+namespace {
+
+void FillFloats(
+    caffe2::Workspace* ws,
+    const std::string& name,
+    const std::vector<caffe2::TIndex>& shape) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<caffe2::TensorCPU>();
+  tensor->Resize(shape);
+  auto* data = tensor->mutable_data<float>();
+  for (caffe2::TIndex i = 0; i < tensor->size(); ++i) {
+    data[i] = (i % 97) * 0.25f - 3;
+  }
+}
+
+} // namespace
+
+// The threaded kernels of every broadcast pattern match the reference, also
+// when the shapes of an existing op change between runs.
+TEST(ElementwiseTest, BroadcastPatternsOnThreads) {
+  caffe2::Workspace ws;
+  ws.GetThreadPool();
+  const caffe2::TIndex C = 24, HW = 1 << 12;
+  auto def = DefineOperator<caffe2::CPUContext>("Mul");
+  caffe2::AddArgument("broadcast", 1, &def);
+  caffe2::AddArgument("num_threads", 4, &def);
+  FillFloats(&ws, "X", {1, C, HW});
+  FillFloats(&ws, "Y", {C, 1});
+  auto op = caffe2::CreateOperator(def, &ws);
+
+  // Maps every element of X to the element of Y it is multiplied by.
+  auto check = [&](std::function<caffe2::TIndex(caffe2::TIndex)> y_index) {
+    ASSERT_TRUE(op->Run());
+    const auto& X = ws.GetBlob("X")->Get<caffe2::TensorCPU>();
+    const auto& Y = ws.GetBlob("Y")->Get<caffe2::TensorCPU>();
+    const auto& Z = ws.GetBlob("Z")->Get<caffe2::TensorCPU>();
+    ASSERT_EQ(Z.dims(), X.dims());
+    for (caffe2::TIndex i = 0; i < X.size(); ++i) {
+      ASSERT_EQ(
+          Z.data<float>()[i],
+          X.data<float>()[i] * Y.data<float>()[y_index(i)])
+          << i;
+    }
+  };
+
+  // Per-channel scale of a batch of one.
+  check([&](caffe2::TIndex i) { return i / HW; });
+  // Row vector bias.
+  FillFloats(&ws, "X", {HW, C});
+  FillFloats(&ws, "Y", {C});
+  check([&](caffe2::TIndex i) { return i % C; });
+  // Scalar and same shape.
+  FillFloats(&ws, "Y", {1});
+  check([&](caffe2::TIndex) { return 0; });
+  FillFloats(&ws, "Y", {HW, C});
+  check([&](caffe2::TIndex i) { return i; });
+  // Broadcast over the middle axis.
+  FillFloats(&ws, "X", {3, C, HW / 4});
+  FillFloats(&ws, "Y", {C});
+  caffe2::AddArgument("axis", 1, &def);
+  op = caffe2::CreateOperator(def, &ws);
+  check([&](caffe2::TIndex i) { return i / (HW / 4) % C; });
+}
@@ -0,0 +1,561 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/embedding_cache_ops.h"
+
+#include <algorithm>
+
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+namespace {
+// Ids copied from the table per lock of the fill thread.
+const size_t kFillBatch = 64;
+} // namespace
+
+EmbeddingCache::EmbeddingCache(
+    const std::string& name,
+    TensorCPU* table,
+    TIndex capacity)
+    : table_(table),
+      numRows_(table->ndim() > 0 ? table->dim(0) : 0),
+      blockSize_(table->size_from_dim(1)),
+      capacity_(capacity),
+      stats_(name) {
+  CAFFE_ENFORCE_GE(table->ndim(), 1, "The table needs at least one dim");
+  CAFFE_ENFORCE(table->IsType<float>(), "The table must be float");
+  CAFFE_ENFORCE_GT(capacity, 0);
+  rows_.resize(capacity * blockSize_);
+  slotIds_.resize(capacity);
+  dirty_.resize(capacity, 0);
+  lruPos_.resize(capacity);
+  fillThread_ = std::thread([this] { fillLoop(); });
+}
+
+EmbeddingCache::~EmbeddingCache() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    stop_ = true;
+  }
+  fillCv_.notify_all();
+  fillThread_.join();
+}
+
+TIndex EmbeddingCache::size() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return slots_.size();
+}
+
+void EmbeddingCache::checkTable() {
+  CAFFE_ENFORCE(
+      table_->ndim() > 0 && table_->dim(0) == numRows_ &&
+          table_->size_from_dim(1) == blockSize_,
+      "The table of the embedding cache was resized");
+}
+
+void EmbeddingCache::checkIndex(TIndex i, int64_t id) {
+  CAFFE_ENFORCE(
+      0 <= id && id < numRows_,
+      "Index ",
+      i,
+      " is out of bounds: ",
+      id,
+      ", range 0 to ",
+      numRows_);
+}
+
+float* EmbeddingCache::lookup(int64_t id) {
+  CAFFE_EVENT(stats_, cache_lookups);
+  auto it = slots_.find(id);
+  if (it == slots_.end()) {
+    CAFFE_EVENT(stats_, cache_misses);
+    queueFill(id);
+    return nullptr;
+  }
+  CAFFE_EVENT(stats_, cache_hits);
+  lru_.splice(lru_.begin(), lru_, lruPos_[it->second]);
+  return slotRow(it->second);
+}
+
+void EmbeddingCache::queueFill(int64_t id) {
+  if (pending_.insert(id).second) {
+    fillQueue_.push_back(id);
+  }
+}
+
+int EmbeddingCache::takeSlot() {
+  int slot;
+  if (lru_.size() < capacity_) {
+    slot = lru_.size();
+  } else {
+    slot = lru_.back();
+    lru_.pop_back();
+    if (dirty_[slot]) {
+      writeBack(slot);
+    }
+    slots_.erase(slotIds_[slot]);
+    CAFFE_EVENT(stats_, cache_evictions);
+  }
+  lru_.push_front(slot);
+  lruPos_[slot] = lru_.begin();
+  return slot;
+}
+
+void EmbeddingCache::writeBack(int slot) {
+  const float* src = slotRow(slot);
+  std::copy(src, src + blockSize_, tableRow(slotIds_[slot]));
+  dirty_[slot] = 0;
+  CAFFE_EVENT(stats_, cache_writebacks);
+}
+
+void EmbeddingCache::fillLoop() {
+  std::vector<int64_t> ids;
+  std::vector<float> buffer;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    fillCv_.wait(lock, [this] { return stop_ || !fillQueue_.empty(); });
+    if (stop_) {
+      return;
+    }
+    ids.clear();
+    while (!fillQueue_.empty() && ids.size() < kFillBatch) {
+      ids.push_back(fillQueue_.front());
+      fillQueue_.pop_front();
+    }
+    filling_ += ids.size();
+
+    // The table may be slow to read, e.g. when it is mapped from a file, so
+    // the rows are copied without holding the lock.
+    lock.unlock();
+    buffer.resize(ids.size() * blockSize_);
+    for (size_t i = 0; i < ids.size(); ++i) {
+      const float* src = tableRow(ids[i]);
+      std::copy(src, src + blockSize_, buffer.data() + i * blockSize_);
+    }
+    lock.lock();
+
+    for (size_t i = 0; i < ids.size(); ++i) {
+      // Skips the ids whose table row was written meanwhile.
+      if (pending_.erase(ids[i]) == 0 || slots_.count(ids[i])) {
+        continue;
+      }
+      const int slot = takeSlot();
+      slotIds_[slot] = ids[i];
+      slots_[ids[i]] = slot;
+      const float* src = buffer.data() + i * blockSize_;
+      std::copy(src, src + blockSize_, slotRow(slot));
+    }
+    filling_ -= ids.size();
+    filledCv_.notify_all();
+  }
+}
+
+template <typename IndexType>
+void EmbeddingCache::lengthsSum(
+    const IndexType* indices,
+    TIndex numIndices,
+    const int* lengths,
+    TIndex numSegments,
+    float* output) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  checkTable();
+  const size_t queued = fillQueue_.size();
+  std::fill(output, output + numSegments * blockSize_, 0.0f);
+  TIndex pos = 0;
+  for (TIndex s = 0; s < numSegments; ++s) {
+    CAFFE_ENFORCE_LE(
+        pos + lengths[s], numIndices, "The lengths do not match INDICES");
+    float* out = output + s * blockSize_;
+    for (int j = 0; j < lengths[s]; ++j, ++pos) {
+      checkIndex(pos, indices[pos]);
+      const float* row = lookup(indices[pos]);
+      if (!row) {
+        row = tableRow(indices[pos]);
+      }
+      for (TIndex k = 0; k < blockSize_; ++k) {
+        out[k] += row[k];
+      }
+    }
+  }
+  CAFFE_ENFORCE_EQ(pos, numIndices, "The lengths do not match INDICES");
+  const bool notify = fillQueue_.size() > queued;
+  lock.unlock();
+  if (notify) {
+    fillCv_.notify_one();
+  }
+}
+
+template <typename IndexType>
+void EmbeddingCache::gather(
+    const IndexType* indices,
+    TIndex numIndices,
+    float* output) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  checkTable();
+  const size_t queued = fillQueue_.size();
+  for (TIndex i = 0; i < numIndices; ++i) {
+    checkIndex(i, indices[i]);
+    const float* row = lookup(indices[i]);
+    if (!row) {
+      row = tableRow(indices[i]);
+    }
+    std::copy(row, row + blockSize_, output + i * blockSize_);
+  }
+  const bool notify = fillQueue_.size() > queued;
+  lock.unlock();
+  if (notify) {
+    fillCv_.notify_one();
+  }
+}
+
+template <typename IndexType>
+void EmbeddingCache::scatterAssign(
+    const IndexType* indices,
+    TIndex numIndices,
+    const float* rows) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  checkTable();
+  for (TIndex i = 0; i < numIndices; ++i) {
+    checkIndex(i, indices[i]);
+    const float* src = rows + i * blockSize_;
+    auto it = slots_.find(indices[i]);
+    if (it == slots_.end()) {
+      std::copy(src, src + blockSize_, tableRow(indices[i]));
+      pending_.erase(indices[i]);
+      continue;
+    }
+    const int slot = it->second;
+    std::copy(src, src + blockSize_, slotRow(slot));
+    dirty_[slot] = 1;
+    lru_.splice(lru_.begin(), lru_, lruPos_[slot]);
+  }
+}
+
+template <typename IndexType>
+void EmbeddingCache::prefetch(
+    const IndexType* indices,
+    TIndex numIndices,
+    bool wait) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  checkTable();
+  for (TIndex i = 0; i < numIndices; ++i) {
+    checkIndex(i, indices[i]);
+    if (!slots_.count(indices[i])) {
+      queueFill(indices[i]);
+    }
+  }
+  if (!fillQueue_.empty()) {
+    fillCv_.notify_one();
+  }
+  if (wait) {
+    filledCv_.wait(
+        lock, [this] { return fillQueue_.empty() && filling_ == 0; });
+  }
+}
+
+void EmbeddingCache::flush() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  checkTable();
+  for (const auto& entry : slots_) {
+    if (dirty_[entry.second]) {
+      writeBack(entry.second);
+    }
+  }
+}
+
+#define INSTANTIATE_EMBEDDING_CACHE(IndexType)                             \
+  template void EmbeddingCache::lengthsSum<IndexType>(                     \
+      const IndexType*, TIndex, const int*, TIndex, float*);               \
+  template void EmbeddingCache::gather<IndexType>(                         \
+      const IndexType*, TIndex, float*);                                   \
+  template void EmbeddingCache::scatterAssign<IndexType>(                  \
+      const IndexType*, TIndex, const float*);                             \
+  template void EmbeddingCache::prefetch<IndexType>(                       \
+      const IndexType*, TIndex, bool);
+INSTANTIATE_EMBEDDING_CACHE(int32_t)
+INSTANTIATE_EMBEDDING_CACHE(int64_t)
+#undef INSTANTIATE_EMBEDDING_CACHE
+
+using EmbeddingCachePtr = std::shared_ptr<EmbeddingCache>;
+CAFFE_KNOWN_TYPE(EmbeddingCachePtr);
+
+namespace {
+
+class CreateEmbeddingCacheOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  CreateEmbeddingCacheOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        // The cache writes rows back, so it needs the table as mutable.
+        table_(ws->GetBlob(operator_def.input(0))),
+        name_(operator_def.output(0)),
+        capacity_(OperatorBase::GetSingleArgument<int64_t>("capacity", 0)) {
+    CAFFE_ENFORCE_GT(capacity_, 0, "capacity must be given");
+  }
+
+  bool RunOnDevice() override {
+    *OperatorBase::Output<EmbeddingCachePtr>(0) =
+        std::make_shared<EmbeddingCache>(
+            name_, table_->GetMutable<TensorCPU>(), capacity_);
+    return true;
+  }
+
+ private:
+  Blob* table_;
+  const std::string name_;
+  const int64_t capacity_;
+};
+
+EmbeddingCache* GetCache(OperatorBase* op) {
+  auto* cache = op->Input<EmbeddingCachePtr>(0).get();
+  CAFFE_ENFORCE(cache, "The embedding cache was not created");
+  return cache;
+}
+
+class SparseLengthsSumCachedOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  SparseLengthsSumCachedOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    auto* cache = GetCache(this);
+    const auto& indices = Input(INDICES);
+    const auto& lengths = Input(LENGTHS);
+    CAFFE_ENFORCE_EQ(indices.ndim(), 1, "INDICES must be a vector");
+    CAFFE_ENFORCE_EQ(lengths.ndim(), 1, "LENGTHS must be a vector");
+    auto* output = Output(0);
+    output->Resize(lengths.dim(0), cache->blockSize());
+    cache->lengthsSum(
+        indices.template data<IndexType>(),
+        indices.size(),
+        lengths.template data<int>(),
+        lengths.dim(0),
+        output->template mutable_data<float>());
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(CACHE, INDICES, LENGTHS);
+};
+
+class EmbeddingCacheGatherOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  EmbeddingCacheGatherOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    auto* cache = GetCache(this);
+    const auto& indices = Input(INDICES);
+    CAFFE_ENFORCE_EQ(indices.ndim(), 1, "INDICES must be a vector");
+    auto* output = Output(0);
+    output->Resize(indices.size(), cache->blockSize());
+    cache->gather(
+        indices.template data<IndexType>(),
+        indices.size(),
+        output->template mutable_data<float>());
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(CACHE, INDICES);
+};
+
+class EmbeddingCacheScatterAssignOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  EmbeddingCacheScatterAssignOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    auto* cache = GetCache(this);
+    const auto& indices = Input(INDICES);
+    const auto& rows = Input(ROWS);
+    CAFFE_ENFORCE_EQ(indices.ndim(), 1, "INDICES must be a vector");
+    CAFFE_ENFORCE(rows.IsType<float>(), "ROWS must be float");
+    CAFFE_ENFORCE_EQ(
+        rows.size(),
+        indices.size() * cache->blockSize(),
+        "ROWS must have one row of the table per index");
+    cache->scatterAssign(
+        indices.template data<IndexType>(),
+        indices.size(),
+        rows.template data<float>());
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(CACHE, INDICES, ROWS);
+};
+
+class EmbeddingCachePrefetchOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  EmbeddingCachePrefetchOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        wait_(OperatorBase::GetSingleArgument<bool>("wait", false)) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    auto* cache = GetCache(this);
+    const auto& indices = Input(INDICES);
+    CAFFE_ENFORCE_EQ(indices.ndim(), 1, "INDICES must be a vector");
+    cache->prefetch(
+        indices.template data<IndexType>(), indices.size(), wait_);
+    return true;
+  }
+
+ private:
+  const bool wait_;
+  INPUT_TAGS(CACHE, INDICES);
+};
+
+class EmbeddingCacheFlushOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  EmbeddingCacheFlushOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    GetCache(this)->flush();
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(CreateEmbeddingCache, CreateEmbeddingCacheOp);
+REGISTER_CPU_OPERATOR(SparseLengthsSumCached, SparseLengthsSumCachedOp);
+REGISTER_CPU_OPERATOR(EmbeddingCacheGather, EmbeddingCacheGatherOp);
+REGISTER_CPU_OPERATOR(
+    EmbeddingCacheScatterAssign,
+    EmbeddingCacheScatterAssignOp);
+REGISTER_CPU_OPERATOR(EmbeddingCachePrefetch, EmbeddingCachePrefetchOp);
+REGISTER_CPU_OPERATOR(EmbeddingCacheFlush, EmbeddingCacheFlushOp);
+
+OPERATOR_SCHEMA(CreateEmbeddingCache)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Creates a cache of the most recently used rows of a large float table, for
+tables that are too large for fast memory, e.g. ones mapped from a file with
+LoadMmapTensor, when a small part of the rows serves most of the lookups.
+
+Lookups through the cache that miss read the row from the table and queue it
+to be filled by a background thread, so they never wait for the fill. The
+least recently used row is evicted when the cache is full. Rows written with
+EmbeddingCacheScatterAssign are only written back to the table on eviction
+or by EmbeddingCacheFlush, which must run before the table is saved.
+
+The hit rate is exported through the stats of the cache, named after the
+output blob: cache_lookups, cache_hits, cache_misses, cache_evictions and
+cache_writebacks.
+
+TABLE must outlive the cache and must not be resized while it exists.
+)DOC")
+    .Arg("capacity", "Number of rows of the table to keep in the cache")
+    .Input(0, "TABLE", "Float tensor, the rows of which are cached")
+    .Output(0, "CACHE", "The embedding cache");
+
+OPERATOR_SCHEMA(SparseLengthsSumCached)
+    .NumInputs(3)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Same as SparseLengthsSum on the table of CACHE, with the rows read through
+the cache. The rows that miss are queued to be filled into the cache.
+)DOC")
+    .Input(0, "CACHE", "The embedding cache, see CreateEmbeddingCache")
+    .Input(1, "INDICES", "int32 or int64 row indices into the table")
+    .Input(2, "LENGTHS", "Number of indices in each segment")
+    .Output(0, "OUTPUT", "The sum of the rows of each segment");
+
+OPERATOR_SCHEMA(EmbeddingCacheGather)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Same as Gather on the table of CACHE, with the rows read through the cache.
+Used with EmbeddingCacheScatterAssign to run a sparse optimizer on the rows
+of a cached table.
+)DOC")
+    .Input(0, "CACHE", "The embedding cache, see CreateEmbeddingCache")
+    .Input(1, "INDICES", "int32 or int64 row indices into the table")
+    .Output(0, "ROWS", "The rows of the table");
+
+OPERATOR_SCHEMA(EmbeddingCacheScatterAssign)
+    .NumInputs(3)
+    .NumOutputs(0, 1)
+    .EnforceInplace({{0, 0}})
+    .SetDoc(R"DOC(
+Same as ScatterAssign on the table of CACHE. The rows that are cached are
+only written to the cache and marked dirty, the others are written to the
+table.
+)DOC")
+    .Input(0, "CACHE", "The embedding cache, see CreateEmbeddingCache")
+    .Input(1, "INDICES", "int32 or int64 row indices into the table")
+    .Input(2, "ROWS", "The new rows, one per index")
+    .Output(0, "CACHE", "(Optional) The embedding cache, in place");
+
+OPERATOR_SCHEMA(EmbeddingCachePrefetch)
+    .NumInputs(2)
+    .NumOutputs(0)
+    .SetDoc(R"DOC(
+Queues the rows of INDICES that are not cached to be filled into the cache,
+e.g. for the next batch while the current one runs.
+)DOC")
+    .Arg("wait", "If set, waits for all the queued fills to be done")
+    .Input(0, "CACHE", "The embedding cache, see CreateEmbeddingCache")
+    .Input(1, "INDICES", "int32 or int64 row indices into the table");
+
+OPERATOR_SCHEMA(EmbeddingCacheFlush)
+    .NumInputs(1)
+    .NumOutputs(0, 1)
+    .EnforceInplace({{0, 0}})
+    .SetDoc("Writes the dirty rows of the cache back to its table.")
+    .Input(0, "CACHE", "The embedding cache, see CreateEmbeddingCache")
+    .Output(0, "CACHE", "(Optional) The embedding cache, in place");
+
+SHOULD_NOT_DO_GRADIENT(CreateEmbeddingCache);
+SHOULD_NOT_DO_GRADIENT(SparseLengthsSumCached);
+SHOULD_NOT_DO_GRADIENT(EmbeddingCacheGather);
+SHOULD_NOT_DO_GRADIENT(EmbeddingCacheScatterAssign);
+SHOULD_NOT_DO_GRADIENT(EmbeddingCachePrefetch);
+SHOULD_NOT_DO_GRADIENT(EmbeddingCacheFlush);
+
+} // namespace
+} // namespace caffe2
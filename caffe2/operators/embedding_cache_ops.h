@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "caffe2/core/stats.h"
+#include "caffe2/core/tensor.h"
+
+namespace caffe2 {
+
+// Keeps the most recently used rows of a large float table, e.g. one mapped
+// from a file with LoadMmapTensor, in a fixed number of slots in memory.
+// Lookups that miss read the row from the table and queue it to be copied
+// into the cache by a background thread, so that a miss never waits for the
+// fill. Rows written through the cache are only written back to the table
+// when they are evicted or on flush().
+//
+// The table tensor is not owned: it must outlive the cache and must not be
+// resized while the cache exists.
+class EmbeddingCache {
+ public:
+  EmbeddingCache(const std::string& name, TensorCPU* table, TIndex capacity);
+  ~EmbeddingCache();
+
+  TIndex blockSize() const {
+    return blockSize_;
+  }
+  TIndex numRows() const {
+    return numRows_;
+  }
+  TIndex size();
+
+  // Sums the rows of every segment into output, which must have
+  // lengths.size() * blockSize() floats.
+  template <typename IndexType>
+  void lengthsSum(
+      const IndexType* indices,
+      TIndex numIndices,
+      const int* lengths,
+      TIndex numSegments,
+      float* output);
+
+  // Copies the rows into output, numIndices * blockSize() floats.
+  template <typename IndexType>
+  void gather(const IndexType* indices, TIndex numIndices, float* output);
+
+  // Writes the rows, into the cache for the cached ones and into the table
+  // for the others.
+  template <typename IndexType>
+  void scatterAssign(
+      const IndexType* indices,
+      TIndex numIndices,
+      const float* rows);
+
+  // Queues the rows that are not cached to be filled. If wait is set, only
+  // returns once all the queued fills are done.
+  template <typename IndexType>
+  void prefetch(const IndexType* indices, TIndex numIndices, bool wait);
+
+  // Writes all the dirty rows back to the table.
+  void flush();
+
+ private:
+  void checkTable();
+  void checkIndex(TIndex i, int64_t id);
+  // Returns the cached row of id, marking it as the most recently used, or
+  // nullptr after queueing id to be filled. mutex_ must be held.
+  float* lookup(int64_t id);
+  void queueFill(int64_t id);
+  float* tableRow(int64_t id) {
+    return table_->mutable_data<float>() + id * blockSize_;
+  }
+  float* slotRow(int slot) {
+    return rows_.data() + slot * blockSize_;
+  }
+  // Returns a free slot, evicting the least recently used row if needed.
+  int takeSlot();
+  void writeBack(int slot);
+  void fillLoop();
+
+  TensorCPU* table_;
+  const TIndex numRows_;
+  const TIndex blockSize_;
+  const TIndex capacity_;
+
+  std::mutex mutex_; // protects all the members below.
+  std::condition_variable fillCv_;
+  std::condition_variable filledCv_;
+  std::vector<float> rows_;
+  std::vector<int64_t> slotIds_;
+  std::vector<char> dirty_;
+  std::unordered_map<int64_t, int> slots_;
+  // Used slots, the most recently used first.
+  std::list<int> lru_;
+  std::vector<std::list<int>::iterator> lruPos_;
+  // Ids queued or being filled. A write to the table of a pending id drops
+  // it from here, so that the fill of the stale row is discarded.
+  std::unordered_set<int64_t> pending_;
+  std::deque<int64_t> fillQueue_;
+  size_t filling_{0};
+  bool stop_{false};
+
+  struct EmbeddingCacheStats {
+    CAFFE_STAT_CTOR(EmbeddingCacheStats);
+    CAFFE_EXPORTED_STAT(cache_lookups);
+    CAFFE_EXPORTED_STAT(cache_hits);
+    CAFFE_EXPORTED_STAT(cache_misses);
+    CAFFE_EXPORTED_STAT(cache_evictions);
+    CAFFE_EXPORTED_STAT(cache_writebacks);
+  } stats_;
+
+  std::thread fillThread_;
+};
+
+} // namespace caffe2
@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+const int kRows = 100;
+const int kBlockSize = 4;
+
+void FillTable(Workspace* ws) {
+  auto* table = ws->CreateBlob("table")->GetMutable<TensorCPU>();
+  table->Resize(kRows, kBlockSize);
+  for (int i = 0; i < table->size(); ++i) {
+    table->mutable_data<float>()[i] = i;
+  }
+}
+
+void SetIndices(
+    Workspace* ws,
+    const vector<int64_t>& ids,
+    const string& name = "indices") {
+  auto* indices = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  indices->Resize(ids.size());
+  std::copy(ids.begin(), ids.end(), indices->mutable_data<int64_t>());
+}
+
+void Prefetch(Workspace* ws, const vector<int64_t>& ids) {
+  SetIndices(ws, ids, "prefetch_ids");
+  ASSERT_TRUE(ws->RunOperatorOnce(CreateOperatorDef(
+      "EmbeddingCachePrefetch",
+      "",
+      {"cache", "prefetch_ids"},
+      {},
+      {MakeArgument<bool>("wait", true)})));
+}
+
+const float* TableRow(Workspace* ws, int id) {
+  return ws->GetBlob("table")->Get<TensorCPU>().data<float>() +
+      id * kBlockSize;
+}
+
+std::map<std::string, int64_t> PublishStats() {
+  std::map<std::string, int64_t> stats;
+  for (const auto& stat : StatRegistry::get().publish(true)) {
+    stats[stat.key] = stat.value;
+  }
+  return stats;
+}
+
+} // namespace
+
+TEST(EmbeddingCacheTest, LengthsSumMatchesTable) {
+  Workspace ws;
+  FillTable(&ws);
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "CreateEmbeddingCache",
+      "",
+      {"table"},
+      {"cache"},
+      {MakeArgument<int64_t>("capacity", 8)})));
+  PublishStats();
+
+  SetIndices(&ws, {3, 5, 3, 99, 0, 5});
+  auto* lengths = ws.CreateBlob("lengths")->GetMutable<TensorCPU>();
+  lengths->Resize(3);
+  lengths->mutable_data<int>()[0] = 2;
+  lengths->mutable_data<int>()[1] = 0;
+  lengths->mutable_data<int>()[2] = 4;
+  const auto lookup = CreateOperatorDef(
+      "SparseLengthsSumCached",
+      "",
+      {"cache", "indices", "lengths"},
+      {"cached_sum"});
+  ASSERT_TRUE(ws.RunOperatorOnce(lookup));
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "SparseLengthsSum", "", {"table", "indices", "lengths"}, {"sum"})));
+  const auto& sum = ws.GetBlob("sum")->Get<TensorCPU>();
+  const auto check = [&]() {
+    const auto& cached_sum = ws.GetBlob("cached_sum")->Get<TensorCPU>();
+    ASSERT_EQ(cached_sum.dims(), sum.dims());
+    for (int i = 0; i < sum.size(); ++i) {
+      EXPECT_EQ(cached_sum.data<float>()[i], sum.data<float>()[i]);
+    }
+  };
+  check();
+
+  // The misses are filled, after which the same lookup only hits.
+  Prefetch(&ws, {});
+  ASSERT_TRUE(ws.RunOperatorOnce(lookup));
+  check();
+  auto stats = PublishStats();
+  EXPECT_EQ(stats["cache/cache_lookups"], 12);
+  EXPECT_EQ(stats["cache/cache_misses"], 6);
+  EXPECT_EQ(stats["cache/cache_hits"], 6);
+  EXPECT_EQ(stats["cache/cache_evictions"], 0);
+}
+
+TEST(EmbeddingCacheTest, WritesBackUpdatedRows) {
+  Workspace ws;
+  FillTable(&ws);
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "CreateEmbeddingCache",
+      "",
+      {"table"},
+      {"cache"},
+      {MakeArgument<int64_t>("capacity", 2)})));
+  Prefetch(&ws, {1, 2});
+  PublishStats();
+
+  // Row 1 is cached and row 7 is not: adds 1000 to both of them.
+  SetIndices(&ws, {1, 7});
+  auto* rows = ws.CreateBlob("rows")->GetMutable<TensorCPU>();
+  rows->Resize(2, kBlockSize);
+  for (int i = 0; i < rows->size(); ++i) {
+    rows->mutable_data<float>()[i] =
+        1000 + (i < kBlockSize ? 1 : 7) * kBlockSize + i % kBlockSize;
+  }
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "EmbeddingCacheScatterAssign",
+      "",
+      {"cache", "indices", "rows"},
+      {"cache"})));
+  EXPECT_EQ(TableRow(&ws, 1)[0], 1 * kBlockSize);
+  EXPECT_EQ(TableRow(&ws, 7)[0], 1000 + 7 * kBlockSize);
+
+  // Reads go through the cache.
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "EmbeddingCacheGather", "", {"cache", "indices"}, {"read"})));
+  const auto& read = ws.GetBlob("read")->Get<TensorCPU>();
+  EXPECT_EQ(read.data<float>()[0], 1000 + 1 * kBlockSize);
+  EXPECT_EQ(read.data<float>()[kBlockSize], 1000 + 7 * kBlockSize);
+  // The miss of row 7 evicts row 2, which was not written.
+  Prefetch(&ws, {});
+
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("EmbeddingCacheFlush", "", {"cache"}, {"cache"})));
+  EXPECT_EQ(TableRow(&ws, 1)[0], 1000 + 1 * kBlockSize);
+
+  // Row 1 is dirty again and gets written back when it is evicted, after
+  // row 7.
+  SetIndices(&ws, {1});
+  rows->Resize(1, kBlockSize);
+  rows->mutable_data<float>()[0] = -1;
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "EmbeddingCacheScatterAssign", "", {"cache", "indices", "rows"}, {})));
+  EXPECT_NE(TableRow(&ws, 1)[0], -1);
+  Prefetch(&ws, {10, 11, 12});
+  EXPECT_EQ(TableRow(&ws, 1)[0], -1);
+  auto stats = PublishStats();
+  EXPECT_EQ(stats["cache/cache_writebacks"], 2);
+  EXPECT_EQ(stats["cache/cache_evictions"], 4);
+}
+
+} // namespace caffe2
@@ -72,6 +72,10 @@ Dimension indices in `dims` are as seen in the output tensor. For example:
 
 If the same blob is provided in input and output, the operation is copy-free.
 )DOC")
+    .Arg(
+        "zero_copy",
+        "(bool, default false) Make the output a view of the input instead "
+        "of a copy. Writes to the output then change the input.")
     .Input(0, "data", "Original tensor")
     .Output(0, "expanded", "Reshaped tensor with same data as input.");
 
@@ -85,6 +89,10 @@ Takes a  parameter `dims` with a list of dimension to squeeze.
 If the same blob is provided in input and output, the operation is copy-free.
 This is the exact inverse operation of ExpandDims given the same `dims` arg.
 )DOC")
+    .Arg(
+        "zero_copy",
+        "(bool, default false) Make the output a view of the input instead "
+        "of a copy. Writes to the output then change the input.")
     .Input(0, "data", "Tensors with at least max(dims) dimensions.")
     .Output(0, "squeezed", "Reshaped tensor with same data as input.")
     .TensorInferenceFunction([](const OperatorDef& def,
@@ -28,7 +28,8 @@ class ExpandDimsOp : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   ExpandDimsOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        dims_(OperatorBase::GetRepeatedArgument<int>("dims")) {
+        dims_(OperatorBase::GetRepeatedArgument<int>("dims")),
+        zero_copy_(OperatorBase::GetSingleArgument<bool>("zero_copy", false)) {
     auto originalSize = dims_.size();
     CAFFE_ENFORCE(originalSize > 0, "Parameter `dims` must be provided.");
     std::sort(dims_.begin(), dims_.end());
@@ -42,7 +43,12 @@ class ExpandDimsOp : public Operator<Context> {
   bool RunOnDevice() override {
     auto& input = Input(0);
     auto* output = Output(0);
-    output->CopyFrom(input, &context_);
+    if (zero_copy_) {
+      output->ResizeLike(input);
+      output->ShareData(input);
+    } else {
+      output->CopyFrom(input, &context_);
+    }
     if (dims_.empty()) {
       return true;
     }
@@ -63,6 +69,7 @@ class ExpandDimsOp : public Operator<Context> {
 
  private:
   vector<int> dims_;
+  bool zero_copy_;
 };
 
 template <class Context>
@@ -71,7 +78,8 @@ class SqueezeOp : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   SqueezeOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        dims_(OperatorBase::GetRepeatedArgument<int>("dims")) {
+        dims_(OperatorBase::GetRepeatedArgument<int>("dims")),
+        zero_copy_(OperatorBase::GetSingleArgument<bool>("zero_copy", false)) {
     auto originalSize = dims_.size();
     CAFFE_ENFORCE(originalSize > 0, "Parameter `dims` must be provided.");
 
@@ -86,7 +94,12 @@ class SqueezeOp : public Operator<Context> {
   bool RunOnDevice() override {
     auto& input = Input(0);
     auto* output = Output(0);
-    output->CopyFrom(input, &context_);
+    if (zero_copy_) {
+      output->ResizeLike(input);
+      output->ShareData(input);
+    } else {
+      output->CopyFrom(input, &context_);
+    }
 
     CAFFE_ENFORCE_GT(
         input.ndim(),
@@ -126,6 +139,7 @@ class SqueezeOp : public Operator<Context> {
 
  private:
   vector<int> dims_;
+  bool zero_copy_;
 
  public:
   DISABLE_COPY_AND_ASSIGN(SqueezeOp);
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/fold_spatial_bn_op.h"
+
+namespace caffe2 {
+
+template <>
+bool FoldSpatialBNOp<CPUContext>::RunOnDevice() {
+  const bool has_bias = InputSize() == 6;
+  const auto& filter = Input(0);
+  const auto& scale = Input(InputSize() - 4);
+  const auto& bn_bias = Input(InputSize() - 3);
+  const auto& mean = Input(InputSize() - 2);
+  const auto& var = Input(InputSize() - 1);
+  CAFFE_ENFORCE_GE(filter.ndim(), 1);
+  const int M = filter.dim32(0);
+  const int K = filter.size() / M;
+  CAFFE_ENFORCE_EQ(scale.size(), M);
+  CAFFE_ENFORCE_EQ(bn_bias.size(), M);
+  CAFFE_ENFORCE_EQ(mean.size(), M);
+  CAFFE_ENFORCE_EQ(var.size(), M);
+
+  auto* folded_filter = Output(0);
+  auto* folded_bias = Output(1);
+  folded_filter->ResizeLike(filter);
+  folded_bias->Resize(M);
+
+  // y = (conv(x, W) + b - mean) * scale / sqrt(var + epsilon) + bn_bias
+  // is conv(x, W * alpha) + (b - mean) * alpha + bn_bias, with
+  // alpha = scale / sqrt(var + epsilon) per output channel.
+  ConstEigenVectorArrayMap<float> scale_arr(scale.data<float>(), M);
+  ConstEigenVectorArrayMap<float> var_arr(var.data<float>(), M);
+  const EigenVectorArrayMap<float>::PlainObject alpha =
+      scale_arr * (var_arr + epsilon_).rsqrt();
+
+  // The output channel is the outermost dimension of the filter in both NCHW
+  // and NHWC, so each column below holds the weights of one output channel.
+  EigenArrayMap<float>(folded_filter->mutable_data<float>(), K, M) =
+      ConstEigenArrayMap<float>(filter.data<float>(), K, M).rowwise() *
+      alpha.transpose();
+
+  EigenVectorArrayMap<float> folded_bias_arr(
+      folded_bias->mutable_data<float>(), M);
+  folded_bias_arr = -ConstEigenVectorArrayMap<float>(mean.data<float>(), M);
+  if (has_bias) {
+    const auto& bias = Input(1);
+    CAFFE_ENFORCE_EQ(bias.size(), M);
+    folded_bias_arr += ConstEigenVectorArrayMap<float>(bias.data<float>(), M);
+  }
+  folded_bias_arr = folded_bias_arr * alpha +
+      ConstEigenVectorArrayMap<float>(bn_bias.data<float>(), M);
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(FoldSpatialBN, FoldSpatialBNOp<CPUContext>);
+
+OPERATOR_SCHEMA(FoldSpatialBN)
+    .NumInputs(5, 6)
+    .NumOutputs(2)
+    .TensorInferenceFunction([](const OperatorDef& def,
+                                const vector<TensorShape>& in) {
+      vector<TensorShape> out(2);
+      out[0] = in[0];
+      out[1] = CreateTensorShape(
+          vector<TIndex>{in[0].dims(0)}, in[0].data_type());
+      return out;
+    })
+    .SetDoc(R"DOC(
+Folds the parameters of an inference-time SpatialBN into the filter and bias
+of the convolution feeding it, so that the convolution with the folded
+parameters computes the normalized output in a single pass.
+
+The inputs are the convolution filter (output channels first), the optional
+1D convolution bias, and the scale, bias, running mean and running variance
+of the SpatialBN, each of size M, the number of output channels. The folding
+is done on every run, which costs one pass over the convolution weights. The
+operator is inserted by the OperatorFusion transform.
+)DOC")
+    .Arg("epsilon", "The epsilon of the SpatialBN, default 1e-5.")
+    .Output(0, "folded_filter", "The filter with the SpatialBN folded in.")
+    .Output(1, "folded_bias", "The 1D bias with the SpatialBN folded in.");
+
+SHOULD_NOT_DO_GRADIENT(FoldSpatialBN);
+
+} // namespace caffe2
@@ -0,0 +1,47 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_FOLD_SPATIAL_BN_OP_H_
+#define CAFFE2_OPERATORS_FOLD_SPATIAL_BN_OP_H_
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// Folds an inference-time SpatialBN into the filter and bias of the
+// convolution that feeds it, so that the convolution writes the normalized
+// output directly.
+template <class Context>
+class FoldSpatialBNOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  FoldSpatialBNOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5)) {
+    CAFFE_ENFORCE_GT(epsilon_, 0);
+  }
+
+  bool RunOnDevice() override;
+
+ protected:
+  float epsilon_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_FOLD_SPATIAL_BN_OP_H_
@@ -45,6 +45,22 @@ OPERATOR_SCHEMA(FC)
       out[0] = CreateTensorShape(y_shape, in[0].data_type());
       return out;
     })
+    .CostInferenceFunction([](const OperatorDef& def,
+                              const vector<TensorShape>& in) {
+      struct OpSchema::Cost c;
+      ArgumentHelper helper(def);
+      const int axis = canonical_axis_index_(
+          helper.GetSingleArgument<int32_t>("axis", 1), in[0].dims_size());
+      const int axis_w = canonical_axis_index_(
+          helper.GetSingleArgument<int32_t>("axis_w", 1), in[1].dims_size());
+      const uint64_t M = nElemBetweenDim(in[0], 0, axis);
+      const uint64_t K = nElemFromDim(in[0], axis);
+      const uint64_t N = nElemBetweenDim(in[1], 0, axis_w);
+      c.flops = M * N * (2 * K + 1);
+      c.bytes_read = nBytes(in[0]) + nBytes(in[1]) + nBytes(in[2]);
+      c.bytes_written = M * N * ItemSize(in[0]);
+      return c;
+    })
     .SetDoc(R"DOC(
     Computes the result of passing an input vector X into a fully
     connected layer with 2D weight matrix W and 1D bias vector b. That is,
@@ -78,6 +94,10 @@ OPERATOR_SCHEMA(FC)
         "defaults to one because the 0th axis most likely describes "
         "the batch_size")
     .Arg("float16_compute", "Whether to use float-16 compute kernel")
+    .Arg(
+        "fused_relu",
+        "(bool) default to false; apply Relu to the output (CPU only), "
+        "as set up by the OperatorFusion transform.")
     .Input(
         0,
         "X",
@@ -19,6 +19,7 @@
 
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/operators/relu_op.h"
 #include "caffe2/utils/conversions.h"
 #include "caffe2/utils/math.h"
 
@@ -34,7 +35,13 @@ class FullyConnectedOp final : public Operator<Context> {
         axis_(OperatorBase::GetSingleArgument<int32_t>("axis", 1)),
         axis_w_(OperatorBase::GetSingleArgument<int32_t>("axis_w", 1)),
         float16_compute_(
-            OperatorBase::GetSingleArgument<bool>("float16_compute", false)) {}
+            OperatorBase::GetSingleArgument<bool>("float16_compute", false)),
+        fused_relu_(
+            OperatorBase::GetSingleArgument<bool>("fused_relu", false)) {
+    CAFFE_ENFORCE(
+        !fused_relu_ || (std::is_same<Context, CPUContext>::value),
+        "fused_relu is only supported on CPU.");
+  }
   ~FullyConnectedOp() {}
 
   template <
@@ -138,6 +145,10 @@ class FullyConnectedOp final : public Operator<Context> {
         Y->template mutable_data<T_Y>(),
         &context_,
         math_type);
+    if (fused_relu_) {
+      FusedReluInPlace<T_Y, Context>(
+          Y->size(), Y->template mutable_data<T_Y>(), &context_);
+    }
     return true;
   }
 
@@ -159,6 +170,8 @@ class FullyConnectedOp final : public Operator<Context> {
   Tensor<Context> bias_multiplier_;
 
   bool float16_compute_;
+  // Apply Relu to Y right after adding the bias.
+  bool fused_relu_;
 };
 
 template <class Context, class Engine = DefaultEngine>
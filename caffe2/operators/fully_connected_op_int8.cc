@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/int8_quantization.h"
+#include "caffe2/operators/relu_op.h"
+
+namespace caffe2 {
+
+// FC with int8 weights and uint8 activations, see int8_quantization.h. The
+// inputs and outputs are the fp32 tensors of the regular FC, so the operator
+// can be selected with the INT8 engine, e.g. through
+// SetGlobalEnginePref({{CPU, {"INT8"}}}), without changing the net. Large
+// products are spread over num_threads threads of the workspace thread pool.
+class Int8FullyConnectedOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  Int8FullyConnectedOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        axis_(OperatorBase::GetSingleArgument<int32_t>("axis", 1)),
+        axis_w_(OperatorBase::GetSingleArgument<int32_t>("axis_w", 1)),
+        fused_relu_(OperatorBase::GetSingleArgument<bool>("fused_relu", false)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        range_(*this),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+
+  bool RunOnDevice() override {
+    const auto& X = Input(0);
+    const auto& W = Input(1);
+    const auto& b = Input(2);
+    auto* Y = Output(0);
+    CAFFE_ENFORCE(b.ndim() == 1, b.ndim());
+    const auto canonical_axis = X.canonical_axis_index(axis_);
+    const int M = X.size_to_dim(canonical_axis);
+    const int K = X.size_from_dim(canonical_axis);
+    const int N = W.size_to_dim(W.canonical_axis_index(axis_w_));
+    CAFFE_ENFORCE_EQ(
+        K, W.size() / N, "Dimension mismatch: ", X.dims(), " ", W.dims());
+    CAFFE_ENFORCE_EQ(N, b.size());
+
+    auto Y_shape = X.dims();
+    Y_shape.resize(canonical_axis + 1);
+    Y_shape[canonical_axis] = N;
+    Y->Resize(Y_shape);
+    float* Ydata = Y->mutable_data<float>();
+    if (X.size() == 0) {
+      return true;
+    }
+
+    const auto params = range_.Params(X.data<float>(), X.size());
+    X_q_.resize(X.size());
+    QuantizeUint8(X.data<float>(), X.size(), params, X_q_.data());
+    weights_.Pack(W, N);
+    acc_.resize(M * N);
+    Int8GemmNT(
+        M,
+        N,
+        K,
+        X_q_.data(),
+        weights_.data(),
+        acc_.data(),
+        num_threads_,
+        num_threads_ > 1 ? ws_->GetThreadPool() : nullptr);
+    Int8AccumulatorsToFloat(
+        M, N, acc_.data(), params, weights_, b.data<float>(), Ydata, N, 1);
+    if (fused_relu_) {
+      FusedReluInPlace<float, CPUContext>(Y->size(), Ydata, &context_);
+    }
+    return true;
+  }
+
+ private:
+  size_t axis_;
+  size_t axis_w_;
+  const bool fused_relu_;
+  const int num_threads_;
+  Int8ActivationRange range_;
+  Workspace* ws_;
+  Int8PackedWeights weights_;
+  vector<std::uint8_t> X_q_;
+  vector<std::int32_t> acc_;
+};
+
+REGISTER_CPU_OPERATOR_WITH_ENGINE(FC, INT8, Int8FullyConnectedOp);
+
+} // namespace caffe2
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/relu_op.h"
+#include "caffe2/perfkernels/packed_gemm.h"
+
+namespace caffe2 {
+
+// FC that packs its weights into the panel layout of perfkernels/packed_gemm.h
+// once and reuses them for as long as the weight tensor is unchanged, i.e.
+// until its data, shape or version() changes. Unlike the MKL PACKED engine
+// this needs no MKL and is correct when the weights are updated, it just
+// repacks. Select it with engine "PREPACK", typically for small batch
+// inference where math::Gemm spends most of its time repacking W.
+class PrePackedFullyConnectedOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  PrePackedFullyConnectedOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        axis_(OperatorBase::GetSingleArgument<int32_t>("axis", 1)),
+        axis_w_(OperatorBase::GetSingleArgument<int32_t>("axis_w", 1)),
+        fused_relu_(
+            OperatorBase::GetSingleArgument<bool>("fused_relu", false)) {}
+
+  bool RunOnDevice() override {
+    const auto& X = Input(0);
+    const auto& W = Input(1);
+    const auto& b = Input(2);
+    auto* Y = Output(0);
+    CAFFE_ENFORCE(b.ndim() == 1, b.ndim());
+    const auto canonical_axis = X.canonical_axis_index(axis_);
+    const int M = X.size_to_dim(canonical_axis);
+    const int K = X.size_from_dim(canonical_axis);
+    const int N = W.size_to_dim(W.canonical_axis_index(axis_w_));
+    CAFFE_ENFORCE_EQ(
+        K, W.size() / N, "Dimension mismatch: ", X.dims(), " ", W.dims());
+    CAFFE_ENFORCE_EQ(N, b.size());
+
+    auto Y_shape = X.dims();
+    Y_shape.resize(canonical_axis + 1);
+    Y_shape[canonical_axis] = N;
+    Y->Resize(Y_shape);
+    float* Ydata = Y->mutable_data<float>();
+    if (X.size() == 0) {
+      return true;
+    }
+
+    if (&W != packed_source_ || W.raw_data() != packed_data_ ||
+        W.version() != packed_version_ || W.dims() != packed_dims_) {
+      packed_.resize(packed_gemm_packed_size(N, K));
+      packed_gemm_pack(N, K, W.data<float>(), packed_.data());
+      packed_source_ = &W;
+      packed_data_ = W.raw_data();
+      packed_version_ = W.version();
+      packed_dims_ = W.dims();
+    }
+    packed_gemm(
+        M, N, K, X.data<float>(), packed_.data(), b.data<float>(), Ydata);
+    if (fused_relu_) {
+      FusedReluInPlace<float, CPUContext>(Y->size(), Ydata, &context_);
+    }
+    return true;
+  }
+
+ private:
+  size_t axis_;
+  size_t axis_w_;
+  const bool fused_relu_;
+  vector<float> packed_;
+  const TensorCPU* packed_source_ = nullptr;
+  const void* packed_data_ = nullptr;
+  uint64_t packed_version_ = 0;
+  vector<TIndex> packed_dims_;
+};
+
+REGISTER_CPU_OPERATOR_WITH_ENGINE(FC, PREPACK, PrePackedFullyConnectedOp);
+
+} // namespace caffe2
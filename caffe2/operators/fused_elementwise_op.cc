@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/fused_elementwise_op.h"
+
+namespace caffe2 {
+
+namespace {
+
+bool ParseOpcode(
+    const string& name,
+    FusedElementwiseOp<CPUContext>::Opcode* opcode,
+    bool* binary) {
+  using Opcode = FusedElementwiseOp<CPUContext>::Opcode;
+  static const std::map<string, std::pair<Opcode, bool>> kOpcodes = {
+      {"Add", {Opcode::ADD, true}},
+      {"Sub", {Opcode::SUB, true}},
+      {"Mul", {Opcode::MUL, true}},
+      {"Div", {Opcode::DIV, true}},
+      {"Sigmoid", {Opcode::SIGMOID, false}},
+      {"Tanh", {Opcode::TANH, false}},
+      {"Relu", {Opcode::RELU, false}},
+      {"Clip", {Opcode::CLIP, false}},
+      {"Scale", {Opcode::SCALE, false}},
+  };
+  auto it = kOpcodes.find(name);
+  if (it == kOpcodes.end()) {
+    return false;
+  }
+  *opcode = it->second.first;
+  *binary = it->second.second;
+  return true;
+}
+
+} // namespace
+
+template <>
+FusedElementwiseOp<CPUContext>::FusedElementwiseOp(
+    const OperatorDef& operator_def,
+    Workspace* ws)
+    : Operator<CPUContext>(operator_def, ws) {
+  const auto ops = OperatorBase::GetRepeatedArgument<string>("ops");
+  const auto operands = OperatorBase::GetRepeatedArgument<int>("operands");
+  const auto params = OperatorBase::GetRepeatedArgument<float>("params");
+  CAFFE_ENFORCE_GT(ops.size(), 0, "The program must not be empty.");
+  CAFFE_ENFORCE_EQ(operands.size(), 2 * ops.size());
+  CAFFE_ENFORCE_EQ(params.size(), 2 * ops.size());
+
+  for (int i = 0; i < ops.size(); ++i) {
+    Instruction inst;
+    bool binary = false;
+    CAFFE_ENFORCE(
+        ParseOpcode(ops[i], &inst.opcode, &binary),
+        "Unsupported elementwise operator ",
+        ops[i]);
+    inst.a = operands[2 * i];
+    inst.b = operands[2 * i + 1];
+    inst.p0 = params[2 * i];
+    inst.p1 = params[2 * i + 1];
+    // Only registers written before this instruction can be read.
+    const int num_registers = InputSize() + i;
+    CAFFE_ENFORCE(inst.a >= 0 && inst.a < num_registers);
+    CAFFE_ENFORCE(!binary || (inst.b >= 0 && inst.b < num_registers));
+    program_.push_back(inst);
+  }
+  registers_.resize(program_.size() * kBlockSize);
+}
+
+template <>
+void FusedElementwiseOp<CPUContext>::RunBlock(
+    const vector<const float*>& inputs,
+    float* output,
+    int n) {
+  const int num_inputs = inputs.size();
+  auto reg = [&](int r) -> const float* {
+    return r < num_inputs ? inputs[r]
+                          : registers_.data() + (r - num_inputs) * kBlockSize;
+  };
+  for (int i = 0; i < program_.size(); ++i) {
+    const auto& inst = program_[i];
+    float* out =
+        i + 1 == program_.size() ? output : registers_.data() + i * kBlockSize;
+    EigenVectorArrayMap<float> y(out, n);
+    ConstEigenVectorArrayMap<float> a(reg(inst.a), n);
+    switch (inst.opcode) {
+      case Opcode::ADD:
+        y = a + ConstEigenVectorArrayMap<float>(reg(inst.b), n);
+        break;
+      case Opcode::SUB:
+        y = a - ConstEigenVectorArrayMap<float>(reg(inst.b), n);
+        break;
+      case Opcode::MUL:
+        y = a * ConstEigenVectorArrayMap<float>(reg(inst.b), n);
+        break;
+      case Opcode::DIV:
+        y = a / ConstEigenVectorArrayMap<float>(reg(inst.b), n);
+        break;
+      case Opcode::SIGMOID:
+        y = 1.f / (1.f + (-a).exp());
+        break;
+      case Opcode::TANH:
+        y = 1.f - 2.f * ((a * 2.f).exp() + 1.f).inverse();
+        break;
+      case Opcode::RELU:
+        y = a.cwiseMax(0.f);
+        break;
+      case Opcode::CLIP:
+        y = a.cwiseMax(inst.p0).cwiseMin(inst.p1);
+        break;
+      case Opcode::SCALE:
+        y = a * inst.p0;
+        break;
+    }
+  }
+}
+
+template <>
+bool FusedElementwiseOp<CPUContext>::RunOnDevice() {
+  const auto& X = Input(0);
+  for (int i = 1; i < InputSize(); ++i) {
+    CAFFE_ENFORCE(
+        Input(i).dims() == X.dims(),
+        "All inputs must have the same shape, input ",
+        i,
+        " has shape ",
+        Input(i).dims(),
+        " instead of ",
+        X.dims());
+  }
+  auto* Y = Output(0);
+  Y->ResizeLike(X);
+  vector<const float*> inputs(InputSize());
+  for (int i = 0; i < InputSize(); ++i) {
+    inputs[i] = Input(i).template data<float>();
+  }
+  float* Ydata = Y->template mutable_data<float>();
+
+  const TIndex N = X.size();
+  vector<const float*> block_inputs(InputSize());
+  for (TIndex start = 0; start < N; start += kBlockSize) {
+    const int n = std::min<TIndex>(kBlockSize, N - start);
+    for (int i = 0; i < InputSize(); ++i) {
+      block_inputs[i] = inputs[i] + start;
+    }
+    RunBlock(block_inputs, Ydata + start, n);
+  }
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(FusedElementwise, FusedElementwiseOp<CPUContext>);
+
+OPERATOR_SCHEMA(FusedElementwise)
+    .NumInputs(1, INT_MAX)
+    .NumOutputs(1)
+    .AllowInplace([](int /*in*/, int /*out*/) { return true; })
+    .IdenticalTypeAndShapeOfInput(0)
+    .SetDoc(R"DOC(
+Evaluates a chain of float elementwise operators over inputs of identical
+shape in a single pass over memory, instead of one pass per operator. It is
+created by the ElementwiseFusion transform.
+
+The chain is a program over registers: registers 0 to (number of inputs - 1)
+hold the inputs, and the i-th instruction writes register
+(number of inputs + i). The last instruction produces the output.
+)DOC")
+    .Arg(
+        "ops",
+        "(list of strings) The operator of each instruction, one of Add, Sub, "
+        "Mul, Div, Sigmoid, Tanh, Relu, Clip and Scale.")
+    .Arg(
+        "operands",
+        "(list of ints) Two register operands per instruction, the second one "
+        "is ignored by unary operators.")
+    .Arg(
+        "params",
+        "(list of floats) Two parameters per instruction: min and max for "
+        "Clip, the scale for Scale, ignored otherwise.")
+    .Output(0, "Y", "The output of the last instruction.");
+
+SHOULD_NOT_DO_GRADIENT(FusedElementwise);
+
+} // namespace caffe2
@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_FUSED_ELEMENTWISE_OP_H_
+#define CAFFE2_OPERATORS_FUSED_ELEMENTWISE_OP_H_
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// Evaluates a chain of elementwise operators in a single pass over memory. The
+// chain is given as a program of instructions over registers: registers
+// 0 .. InputSize() - 1 hold the inputs, and instruction i writes register
+// InputSize() + i. The last instruction produces the output. The program is
+// run over blocks of kBlockSize elements, so that the intermediate registers
+// stay in L1 cache, and each instruction is a vectorized Eigen expression over
+// the block.
+template <class Context>
+class FusedElementwiseOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  FusedElementwiseOp(const OperatorDef& operator_def, Workspace* ws);
+
+  bool RunOnDevice() override;
+
+  enum class Opcode { ADD, SUB, MUL, DIV, SIGMOID, TANH, RELU, CLIP, SCALE };
+
+  struct Instruction {
+    Opcode opcode;
+    int a;
+    int b;
+    float p0;
+    float p1;
+  };
+
+  static constexpr int kBlockSize = 256;
+
+ protected:
+  void RunBlock(const vector<const float*>& inputs, float* output, int n);
+
+  vector<Instruction> program_;
+  // Block buffers of the intermediate registers.
+  vector<float> registers_;
+};
+
+template <class Context>
+constexpr int FusedElementwiseOp<Context>::kBlockSize;
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_FUSED_ELEMENTWISE_OP_H_
@@ -0,0 +1,266 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "caffe2/operators/fused_rnn_op.h"
+
+namespace caffe2 {
+
+namespace {
+
+using EArray = EigenVectorArrayMap<float>;
+using ConstEArray = ConstEigenVectorArrayMap<float>;
+
+// Same as LSTMUnit, but with Eigen's vectorized float activations and
+// sigmoid(x) computed as (tanh(x / 2) + 1) / 2.
+void LSTMGates(
+    int N,
+    int D,
+    int t,
+    const float* H_prev,
+    const float* C_prev,
+    const float* gates,
+    const int32_t* seqLengths,
+    bool drop_states,
+    float forget_bias,
+    float* C,
+    float* H) {
+  for (int n = 0; n < N; n++) {
+    EArray h(H + n * D, D);
+    EArray c(C + n * D, D);
+    if (t >= seqLengths[n]) {
+      if (drop_states) {
+        h.setZero();
+        c.setZero();
+      } else {
+        h = ConstEArray(H_prev + n * D, D);
+        c = ConstEArray(C_prev + n * D, D);
+      }
+      continue;
+    }
+    const float* x = gates + n * 4 * D;
+    ConstEArray x_i(x, D);
+    ConstEArray x_f(x + D, D);
+    ConstEArray x_o(x + 2 * D, D);
+    ConstEArray x_g(x + 3 * D, D);
+    c = (((x_f + forget_bias) * 0.5f).tanh() * 0.5f + 0.5f) *
+            ConstEArray(C_prev + n * D, D) +
+        ((x_i * 0.5f).tanh() * 0.5f + 0.5f) * x_g.tanh();
+    h = ((x_o * 0.5f).tanh() * 0.5f + 0.5f) * c.tanh();
+  }
+}
+
+// Same as GRUUnit, with the same activations as LSTMGates().
+void GRUGates(
+    int N,
+    int D,
+    int t,
+    const float* H_prev,
+    const float* gates,
+    const int32_t* seqLengths,
+    bool drop_states,
+    float* H) {
+  for (int n = 0; n < N; n++) {
+    EArray h(H + n * D, D);
+    ConstEArray h_prev(H_prev + n * D, D);
+    if (t >= seqLengths[n]) {
+      if (drop_states) {
+        h.setZero();
+      } else {
+        h = h_prev;
+      }
+      continue;
+    }
+    const float* x = gates + n * 3 * D;
+    ConstEArray x_u(x + D, D);
+    ConstEArray x_o(x + 2 * D, D);
+    auto u = (x_u * 0.5f).tanh() * 0.5f + 0.5f;
+    h = h_prev * u + x_o.tanh() * (1.0f - u);
+  }
+}
+
+} // namespace
+
+bool FusedLSTMOp::RunOnDevice() {
+  const auto& X = Input(INPUT);
+  CAFFE_ENFORCE_EQ(X.ndim(), 3);
+  const auto T = X.dim32(0);
+  const auto N = X.dim32(1);
+  const auto& hidden_init = Input(HIDDEN_INIT);
+  const auto& cell_init = Input(CELL_INIT);
+  CAFFE_ENFORCE_EQ(hidden_init.ndim(), 3);
+  const auto D = hidden_init.dim32(2);
+  CAFFE_ENFORCE_EQ(hidden_init.size(), N * D);
+  CAFFE_ENFORCE_EQ(cell_init.size(), N * D);
+  const auto& gates_w = Input(GATES_W);
+  CAFFE_ENFORCE_EQ(Input(I2H_W).dim32(0), 4 * D);
+  CAFFE_ENFORCE_EQ(gates_w.dim32(0), 4 * D);
+  CAFFE_ENFORCE_EQ(gates_w.dim32(1), D);
+
+  ProjectInput(X, Input(I2H_W), {&Input(I2H_B), &Input(GATES_B)});
+  const auto* seqLengths = SeqLengths(SEQ_LENGTHS, T, N);
+
+  auto* hidden_all = Output(HIDDEN_ALL);
+  hidden_all->Resize(T, N, D);
+  cell_.Resize(2, N, D);
+  const auto* H_prev = hidden_init.data<float>();
+  const auto* C_prev = cell_init.data<float>();
+  for (int t = 0; t < T; t++) {
+    auto* gates = gates_.mutable_data<float>() + t * N * 4 * D;
+    auto* H = hidden_all->mutable_data<float>() + t * N * D;
+    auto* C = cell_.mutable_data<float>() + (t % 2) * N * D;
+    AddRecurrent(N, D, 4 * D, H_prev, gates_w.data<float>(), gates, 4 * D);
+    LSTMGates(
+        N,
+        D,
+        t,
+        H_prev,
+        C_prev,
+        gates,
+        seqLengths,
+        drop_states_,
+        forget_bias_,
+        C,
+        H);
+    H_prev = H;
+    C_prev = C;
+  }
+  OutputLastState(HIDDEN_LAST, N, D, H_prev);
+  OutputLastState(CELL_LAST, N, D, C_prev);
+  return true;
+}
+
+bool FusedGRUOp::RunOnDevice() {
+  const auto& X = Input(INPUT);
+  CAFFE_ENFORCE_EQ(X.ndim(), 3);
+  const auto T = X.dim32(0);
+  const auto N = X.dim32(1);
+  const auto& hidden_init = Input(HIDDEN_INIT);
+  CAFFE_ENFORCE_EQ(hidden_init.ndim(), 3);
+  const auto D = hidden_init.dim32(2);
+  CAFFE_ENFORCE_EQ(hidden_init.size(), N * D);
+  const auto& gates_w = Input(GATES_W);
+  const auto& output_w = Input(OUTPUT_W);
+  CAFFE_ENFORCE_EQ(Input(I2H_W).dim32(0), 3 * D);
+  CAFFE_ENFORCE_EQ(gates_w.dim32(0), 2 * D);
+  CAFFE_ENFORCE_EQ(gates_w.dim32(1), D);
+  CAFFE_ENFORCE_EQ(output_w.dim32(0), D);
+  CAFFE_ENFORCE_EQ(output_w.dim32(1), D);
+  CAFFE_ENFORCE_EQ(Input(GATES_B).size(), 2 * D);
+  CAFFE_ENFORCE_EQ(Input(OUTPUT_B).size(), D);
+
+  // The recurrent biases of the reset, update and output gates can be
+  // added to the input projection as well.
+  recurrent_bias_.Resize(3 * D);
+  context_.template Copy<float, CPUContext, CPUContext>(
+      2 * D,
+      Input(GATES_B).data<float>(),
+      recurrent_bias_.mutable_data<float>());
+  context_.template Copy<float, CPUContext, CPUContext>(
+      D,
+      Input(OUTPUT_B).data<float>(),
+      recurrent_bias_.mutable_data<float>() + 2 * D);
+  ProjectInput(X, Input(I2H_W), {&Input(I2H_B), &recurrent_bias_});
+  const auto* seqLengths = SeqLengths(SEQ_LENGTHS, T, N);
+
+  auto* hidden_all = Output(HIDDEN_ALL);
+  hidden_all->Resize(T, N, D);
+  reset_hidden_.Resize(N, D);
+  auto* reset_hidden = reset_hidden_.mutable_data<float>();
+  const auto* H_prev = hidden_init.data<float>();
+  for (int t = 0; t < T; t++) {
+    auto* gates = gates_.mutable_data<float>() + t * N * 3 * D;
+    auto* H = hidden_all->mutable_data<float>() + t * N * D;
+    AddRecurrent(N, D, 2 * D, H_prev, gates_w.data<float>(), gates, 3 * D);
+    // The output gate sees the hidden state scaled by the reset gate.
+    for (int n = 0; n < N; n++) {
+      EArray(reset_hidden + n * D, D) =
+          ((ConstEArray(gates + n * 3 * D, D) * 0.5f).tanh() * 0.5f + 0.5f) *
+          ConstEArray(H_prev + n * D, D);
+    }
+    AddRecurrent(
+        N, D, D, reset_hidden, output_w.data<float>(), gates + 2 * D, 3 * D);
+    GRUGates(N, D, t, H_prev, gates, seqLengths, drop_states_, H);
+    H_prev = H;
+  }
+  OutputLastState(HIDDEN_LAST, N, D, H_prev);
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(FusedLSTM, FusedLSTMOp);
+OPERATOR_SCHEMA(FusedLSTM)
+    .NumInputs(7, 8)
+    .NumOutputs(1, 3)
+    .SetDoc(R"DOC(
+Runs a single LSTM layer over a whole sequence on CPU, computing what a
+RecurrentNetwork with an LSTMCell step net computes in forward-only mode.
+
+The input is projected for all timesteps with one GEMM. Then each timestep
+only adds hidden_{t-1} * gates_w^T to its gates and applies the LSTMUnit
+activations, so nothing is dispatched per timestep. The weights have the
+layout of the i2h and gates_t FC parameters of LSTMCell, with the gates in
+the order input, forget, output, cell.
+)DOC")
+    .Arg("forget_bias", "Bias term to add in while calculating forget gate")
+    .Arg(
+        "drop_states",
+        "Bool to determine if hidden and cell states are zeroes or passed "
+        "along for timesteps past the given sequence_length.")
+    .Input(0, "input", "Input sequence of shape (T, N, I).")
+    .Input(1, "hidden_init", "Initial hidden state of shape (1, N, D).")
+    .Input(2, "cell_init", "Initial cell state of shape (1, N, D).")
+    .Input(3, "i2h_w", "Input projection weights of shape (4D, I).")
+    .Input(4, "i2h_b", "Input projection bias of shape (4D).")
+    .Input(5, "gates_w", "Recurrent weights of shape (4D, D).")
+    .Input(6, "gates_b", "Recurrent bias of shape (4D).")
+    .Input(7, "seq_lengths", "Optional int32 sequence lengths of shape (N).")
+    .Output(0, "hidden_all", "Hidden states of all timesteps, (T, N, D).")
+    .Output(1, "hidden_last", "Hidden state after the last timestep.")
+    .Output(2, "cell_last", "Cell state after the last timestep.");
+
+REGISTER_CPU_OPERATOR(FusedGRU, FusedGRUOp);
+OPERATOR_SCHEMA(FusedGRU)
+    .NumInputs(8, 9)
+    .NumOutputs(1, 2)
+    .SetDoc(R"DOC(
+Runs a single GRU layer over a whole sequence on CPU, computing what a
+RecurrentNetwork with a GRUCell step net computes in forward-only mode.
+
+The input is projected for all timesteps with one GEMM. Then each timestep
+adds hidden_{t-1} * gates_w^T to the reset and update gates, scales
+hidden_{t-1} by the reset gate, adds that times output_w^T to the output
+gate and applies the GRUUnit activations. gates_w and gates_b are the
+reset_gate_t parameters of GRUCell followed by the update_gate_t ones,
+output_w and output_b are the output_gate_t parameters.
+)DOC")
+    .Arg(
+        "drop_states",
+        "Bool to determine if hidden state is zeroes or passed "
+        "along for timesteps past the given sequence_length.")
+    .Input(0, "input", "Input sequence of shape (T, N, I).")
+    .Input(1, "hidden_init", "Initial hidden state of shape (1, N, D).")
+    .Input(2, "i2h_w", "Input projection weights of shape (3D, I).")
+    .Input(3, "i2h_b", "Input projection bias of shape (3D).")
+    .Input(4, "gates_w", "Reset and update gate weights of shape (2D, D).")
+    .Input(5, "gates_b", "Reset and update gate bias of shape (2D).")
+    .Input(6, "output_w", "Output gate weights of shape (D, D).")
+    .Input(7, "output_b", "Output gate bias of shape (D).")
+    .Input(8, "seq_lengths", "Optional int32 sequence lengths of shape (N).")
+    .Output(0, "hidden_all", "Hidden states of all timesteps, (T, N, D).")
+    .Output(1, "hidden_last", "Hidden state after the last timestep.");
+
+SHOULD_NOT_DO_GRADIENT(FusedLSTM);
+SHOULD_NOT_DO_GRADIENT(FusedGRU);
+
+} // namespace caffe2
@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CAFFE2_OPERATORS_FUSED_RNN_OP_H_
+#define CAFFE2_OPERATORS_FUSED_RNN_OP_H_
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// Shared part of the fused single layer RNN operators. They compute what a
+// RecurrentNetwork of FC, Sum and LSTMUnit / GRUUnit ops computes for one
+// layer, but project the input of all timesteps with one GEMM up front and
+// then only run the recurrent GEMM and the gate math per timestep, without
+// dispatching any ops and with the recurrent weights staying in cache.
+class FusedRNNOpBase : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  FusedRNNOpBase(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        drop_states_(
+            OperatorBase::GetSingleArgument<bool>("drop_states", false)) {}
+
+ protected:
+  // Sets gates_ (T x N x G) to X (T x N x I) times W (G x I) transposed
+  // plus the sum of the biases, each of size G.
+  void ProjectInput(
+      const TensorCPU& X,
+      const TensorCPU& W,
+      const std::vector<const TensorCPU*>& biases) {
+    const auto T = X.dim32(0);
+    const auto N = X.dim32(1);
+    const auto I = X.dim32(2);
+    const auto G = W.dim32(0);
+    CAFFE_ENFORCE_EQ(W.dim32(1), I);
+    gates_.Resize(T, N, G);
+    bias_.Resize(G);
+    math::Set<float, CPUContext>(
+        G, 0, bias_.mutable_data<float>(), &context_);
+    for (const auto* b : biases) {
+      CAFFE_ENFORCE_EQ(b->size(), G);
+      math::Add<float, CPUContext>(
+          G,
+          bias_.data<float>(),
+          b->data<float>(),
+          bias_.mutable_data<float>(),
+          &context_);
+    }
+    math::Gemm<float, CPUContext>(
+        CblasNoTrans,
+        CblasTrans,
+        T * N,
+        G,
+        I,
+        1,
+        X.data<float>(),
+        W.data<float>(),
+        0,
+        gates_.mutable_data<float>(),
+        &context_);
+    math::AddToRow<float, CPUContext>(
+        T * N, G, bias_.data<float>(), gates_.mutable_data<float>(), &context_);
+  }
+
+  // Adds H (N x D) times W (K x D) transposed to the first K columns of
+  // gates, a N x ldc row major matrix.
+  void AddRecurrent(
+      int N,
+      int D,
+      int K,
+      const float* H,
+      const float* W,
+      float* gates,
+      int ldc) {
+    math::GemmEx<float, CPUContext>(
+        CblasNoTrans,
+        CblasTrans,
+        N,
+        K,
+        D,
+        1,
+        H,
+        D,
+        W,
+        D,
+        1,
+        gates,
+        ldc,
+        &context_);
+  }
+
+  // Sequence lengths of the batch, all T if the input is not given.
+  const int32_t* SeqLengths(int idx, int T, int N) {
+    if (InputSize() > idx) {
+      CAFFE_ENFORCE_EQ(Input(idx).size(), N);
+      return Input(idx).template data<int32_t>();
+    }
+    seq_lengths_.Resize(N);
+    math::Set<int32_t, CPUContext>(
+        N, T, seq_lengths_.mutable_data<int32_t>(), &context_);
+    return seq_lengths_.data<int32_t>();
+  }
+
+  // Shapes the optional last state output and copies the state into it.
+  void OutputLastState(int idx, int N, int D, const float* state) {
+    if (OutputSize() > idx) {
+      auto* out = Output(idx);
+      out->Resize(1, N, D);
+      context_.template Copy<float, CPUContext, CPUContext>(
+          N * D, state, out->template mutable_data<float>());
+    }
+  }
+
+  const bool drop_states_;
+  TensorCPU gates_;
+  TensorCPU bias_;
+  TensorCPU seq_lengths_;
+};
+
+class FusedLSTMOp final : public FusedRNNOpBase {
+ public:
+  FusedLSTMOp(const OperatorDef& operator_def, Workspace* ws)
+      : FusedRNNOpBase(operator_def, ws),
+        forget_bias_(OperatorBase::GetSingleArgument<float>(
+            "forget_bias", 0.0)) {}
+
+  bool RunOnDevice() override;
+
+ protected:
+  INPUT_TAGS(
+      INPUT,
+      HIDDEN_INIT,
+      CELL_INIT,
+      I2H_W,
+      I2H_B,
+      GATES_W,
+      GATES_B,
+      SEQ_LENGTHS);
+  OUTPUT_TAGS(HIDDEN_ALL, HIDDEN_LAST, CELL_LAST);
+
+ private:
+  const float forget_bias_;
+  TensorCPU cell_;
+};
+
+class FusedGRUOp final : public FusedRNNOpBase {
+ public:
+  FusedGRUOp(const OperatorDef& operator_def, Workspace* ws)
+      : FusedRNNOpBase(operator_def, ws) {}
+
+  bool RunOnDevice() override;
+
+ protected:
+  INPUT_TAGS(
+      INPUT,
+      HIDDEN_INIT,
+      I2H_W,
+      I2H_B,
+      GATES_W,
+      GATES_B,
+      OUTPUT_W,
+      OUTPUT_B,
+      SEQ_LENGTHS);
+  OUTPUT_TAGS(HIDDEN_ALL, HIDDEN_LAST);
+
+ private:
+  TensorCPU recurrent_bias_;
+  TensorCPU reset_hidden_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_FUSED_RNN_OP_H_
@@ -64,6 +64,10 @@ Example:
         "Last dimention represents a range in the format (start, lengths)")
     .Output(0, "OUTPUT", "1-D tensor of size sum of range lengths")
     .Arg("lengths", "Expected lengths for ranges")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the examples are "
+        "split over. Defaults to 1.")
     .TensorInferenceFunction([](const OperatorDef& def,
                                 const vector<TensorShape>& in) {
       ArgumentHelper helper(def);
@@ -25,7 +25,10 @@
 #include "caffe2/core/operator.h"
 #include "caffe2/core/types.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/run_chunks.h"
 
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <utility>
 
@@ -36,11 +39,14 @@ class GatherRangesToDenseOp final : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   GatherRangesToDenseOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        lengths_(OperatorBase::GetRepeatedArgument<int>("lengths")) {
+        lengths_(OperatorBase::GetRepeatedArgument<int>("lengths")),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
     CAFFE_ENFORCE_GT(lengths_.size(), 0, "There has to be at least one length");
     for (auto length : lengths_) {
       CAFFE_ENFORCE_GT(length, 0, "Each length should be positive");
     }
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
   }
 
   bool RunOnDevice() override {
@@ -67,42 +73,81 @@ class GatherRangesToDenseOp final : public Operator<Context> {
 
     auto* rawData = static_cast<const char*>(data.raw_data());
     auto* rangesData = ranges.template data<Index>();
-    int rangesDataOffset = 0;
-    auto itemsize = data.meta().itemsize();
+    const auto& meta = data.meta();
+    const auto itemsize = meta.itemsize();
+    const int numOutputs = OutputSize();
+
+    // Checks all the ranges first, so that the copies cannot fail.
+    for (TIndex k = 0; k < ranges.size(); k += 2) {
+      auto rangeStart = rangesData[k];
+      auto rangeLength = rangesData[k + 1];
+      if (rangeLength == 0) {
+        continue;
+      }
+      const int j = k / 2 % numOutputs;
+      CAFFE_ENFORCE_EQ(
+          rangeLength,
+          lengths_[j],
+          "Range lengths missmatch for output #",
+          j);
+      CAFFE_ENFORCE(
+          0 <= rangeStart && rangeStart + rangeLength <= data.size(),
+          "Range is out of DATA bounds for output #",
+          j);
+    }
 
     auto batchSize = ranges.dim(0);
     vector<TIndex> outputDims{batchSize, 0};
     vector<char*> outputRawData;
-    for (int i = 0; i < OutputSize(); ++i) {
+    TIndex outputRowSize = 0;
+    for (int i = 0; i < numOutputs; ++i) {
       auto* output = Output(i);
       outputDims[1] = lengths_[i];
       output->Resize(outputDims);
-      char* ptr = static_cast<char*>(output->raw_mutable_data(data.meta()));
-      memset(ptr, 0, output->nbytes());
-      outputRawData.push_back(ptr);
+      outputRawData.push_back(
+          static_cast<char*>(output->raw_mutable_data(meta)));
+      outputRowSize += lengths_[i];
     }
 
-    for (int i = 0; i < batchSize; ++i) {
-      for (int j = 0; j < OutputSize(); ++j) {
-        auto rangeStart = rangesData[rangesDataOffset++];
-        auto rangeLength = rangesData[rangesDataOffset++];
+    // Gathers the examples [begin, end), while prefetching the range
+    // kPrefetchDistance ranges ahead.
+    constexpr TIndex kPrefetchDistance = 8;
+    auto gather = [&](TIndex begin, TIndex end) {
+      const TIndex rangesEnd = end * numOutputs;
+      for (TIndex k = begin * numOutputs; k < rangesEnd; ++k) {
+        const TIndex i = k / numOutputs;
+        const int j = k % numOutputs;
+#ifdef __GNUC__
+        if (k + kPrefetchDistance < rangesEnd) {
+          __builtin_prefetch(
+              rawData + rangesData[2 * (k + kPrefetchDistance)] * itemsize,
+              0,
+              1);
+        }
+#endif // __GNUC__
+        char* dst = outputRawData[j] + i * itemsize * lengths_[j];
+        auto rangeLength = rangesData[2 * k + 1];
         if (rangeLength == 0) {
           // empty range, will be filled with zeros
+          memset(dst, 0, itemsize * lengths_[j]);
           continue;
         }
-        CAFFE_ENFORCE_EQ(
-            rangeLength,
-            lengths_[j],
-            "Range lengths missmatch for output #",
-            j);
-        context_.template CopyItems<Context, Context>(
-            data.meta(),
-            rangeLength,
-            rawData + rangeStart * itemsize,
-            outputRawData[j] + i * itemsize * lengths_[j]);
+        const char* src = rawData + rangesData[2 * k] * itemsize;
+        if (meta.copy()) {
+          meta.copy()(src, dst, rangeLength);
+        } else {
+          memcpy(dst, src, rangeLength * itemsize);
+        }
       }
-    }
-    CAFFE_ENFORCE_EQ(rangesDataOffset, ranges.size());
+    };
+    RunChunks(
+        ws_,
+        num_threads_,
+        batchSize,
+        outputRowSize,
+        [&](int /* unused */, TIndex begin, TIndex end) {
+          gather(begin, end);
+        });
 
     return true;
   }
@@ -111,6 +156,8 @@ class GatherRangesToDenseOp final : public Operator<Context> {
 
  private:
   vector<int> lengths_;
+  int num_threads_;
+  Workspace* ws_;
 };
 
 } // namespace caffe2
@@ -16,71 +16,33 @@
 
 #include "caffe2/operators/h_softmax_op.h"
 
+#include <algorithm>
 #include <queue>
 #include <stack>
 
-namespace caffe2 {
-
-template <>
-float HSoftmaxOp<float, CPUContext>::RunForwardSingle(const float* X,
-  const float* W, const float* b, int target, float* int_output,
-  const float* bias_multiplier, int dim_out, int dim_in,
-  int& int_output_offset) {
-
-  // W * x
-  float* fc_output_data = int_output + int_output_offset;
-
-  math::Gemm<float, CPUContext>(CblasNoTrans, CblasTrans, 1, dim_out, dim_in, 1,
-    X, W, 0, fc_output_data, &context_);
-  math::Gemv<float, CPUContext>(CblasNoTrans, dim_out, 1, 1,
-    b, bias_multiplier, 1, fc_output_data, &context_);
-
-  int_output_offset += dim_out;
-
-  //Softmax
-  float* softmax_output_data = int_output + int_output_offset;
+#include "caffe2/operators/softmax_shared.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
-  if (scale_.size() != 1) {
-    scale_.Resize(1);
-  }
-  if (sum_multiplier_.size() != dim_out) {
-    sum_multiplier_.Resize(dim_out);
-    math::Set<float, CPUContext>(dim_out, 1.f,
-      sum_multiplier_.mutable_data<float>(), &context_);
-  }
-  math::RowwiseMax<float, CPUContext>(1, dim_out, fc_output_data,
-    scale_.mutable_data<float>(), &context_);
-
-  // Put the intermediate result X - max(X) into Y
-  context_.template Copy<float, CPUContext, CPUContext>(dim_out, fc_output_data,
-    softmax_output_data);
-  // Subtract the scale
-  math::Gemv<float, CPUContext>(CblasNoTrans, dim_out, 1, -1,
-    sum_multiplier_.data<float>(), scale_.data<float>(), 1, softmax_output_data,
-    &context_);
-
-  // Exponentiation
-  math::Exp<float, CPUContext>(dim_out, softmax_output_data,
-    softmax_output_data, &context_);
-  math::Gemv<float, CPUContext>(CblasNoTrans, 1, dim_out, 1,
-    softmax_output_data, sum_multiplier_.data<float>(), 0,
-    scale_.mutable_data<float>(), &context_);
-
-  // Do division
-  const float scale = *scale_.data<float>();
-  for (int j = 0; j < dim_out; ++j) {
-    softmax_output_data[j] /= scale;
-  }
+namespace caffe2 {
 
-  int_output_offset += dim_out;
+namespace {
 
-  if (target < 0) {
-    return -1;
+// Copies the rows of X of the examples of `samples` into `rows`, one after
+// the other.
+void GatherRows(
+    const vector<int>& samples,
+    const float* X,
+    int K,
+    Tensor<CPUContext>* rows) {
+  rows->Resize(samples.size(), K);
+  float* rows_data = rows->mutable_data<float>();
+  for (size_t i = 0; i < samples.size(); ++i) {
+    std::copy(X + samples[i] * K, X + (samples[i] + 1) * K, rows_data + i * K);
   }
-  //Return cross entropy loss
-  return -log(std::max(softmax_output_data[target], kLOG_THRESHOLD()));
 }
 
+} // namespace
+
 // Implementation for the CPU context.
 template <>
 bool HSoftmaxOp<float, CPUContext>::RunOnDevice() {
@@ -106,11 +68,9 @@ bool HSoftmaxOp<float, CPUContext>::RunOnDevice() {
   math::Set<float, CPUContext>(M, 0.f, Ydata, &context_);
   const auto* labeldata = label.data<int>();
 
-  auto hierarchy = getHierarchyForLabels(M, labeldata, hierarchy_all_map_);
-  int int_output_size = getIntermediateOutputSize(labeldata, M, hierarchy);
+  int int_output_size = GroupByNode(labeldata, M);
   intermediate_output->Resize(int_output_size);
   float * int_output_data = intermediate_output->mutable_data<float>();
-  int int_output_offset = 0;
 
   if (bias_multiplier_.size() != M) {
     bias_multiplier_.Resize(M);
@@ -118,91 +78,50 @@ bool HSoftmaxOp<float, CPUContext>::RunOnDevice() {
         bias_multiplier_.mutable_data<float>(), &context_);
   }
 
-  for (int sample = 0; sample < M; ++sample) {
-    int word_id = labeldata[sample];
-    const PathProto& path = hierarchy[word_id];
-    for (const PathNodeProto& node : path.path_nodes()) {
-      //Offset of node's weight matrix in W
-      int w_offset = node.index();
-      //Number of output dimensions in node's weight matrix
-      int w_length = node.length();
-      int target = node.target();
-      //Adding log probabilities
-      Ydata[sample] += RunForwardSingle(X.data<float>() + sample*K,
-        W.data<float>() + w_offset*K, b.data<float>() + w_offset, target,
-        int_output_data, bias_multiplier_.data<float>()+sample, w_length, K,
-        int_output_offset);
+  for (int g = 0; g < num_node_groups_; ++g) {
+    const NodeGroup& group = node_groups_[g];
+    const int num_samples = group.samples.size();
+    const int dim_out = group.w_length;
+    GatherRows(group.samples, X.data<float>(), K, &node_input_);
+    node_fc_.Resize(num_samples, dim_out);
+    node_softmax_.Resize(num_samples, dim_out);
+    float* fc_data = node_fc_.mutable_data<float>();
+    float* softmax_data = node_softmax_.mutable_data<float>();
+
+    // X * W' + b for all the examples going through the node
+    math::Gemm<float, CPUContext>(CblasNoTrans, CblasTrans, num_samples,
+      dim_out, K, 1, node_input_.data<float>(),
+      W.data<float>() + group.w_offset * K, 0, fc_data, &context_);
+    math::Gemm<float, CPUContext>(CblasNoTrans, CblasNoTrans, num_samples,
+      dim_out, 1, 1, bias_multiplier_.data<float>(),
+      b.data<float>() + group.w_offset, 1, fc_data, &context_);
+
+    //Softmax
+    scale_.Resize(num_samples);
+    rowmax_.Resize(num_samples);
+    if (sum_multiplier_.size() < dim_out) {
+      sum_multiplier_.Resize(dim_out);
+      math::Set<float, CPUContext>(dim_out, 1.f,
+        sum_multiplier_.mutable_data<float>(), &context_);
+    }
+    SoftmaxCPU(context_, num_samples, dim_out, fc_data, softmax_data,
+      scale_.mutable_data<float>(), sum_multiplier_.data<float>(), false,
+      rowmax_.mutable_data<float>());
+
+    for (int i = 0; i < num_samples; ++i) {
+      float* int_output = int_output_data + group.output_offsets[i];
+      const float* softmax_row = softmax_data + i * dim_out;
+      std::copy(fc_data + i * dim_out, fc_data + (i + 1) * dim_out,
+        int_output);
+      std::copy(softmax_row, softmax_row + dim_out, int_output + dim_out);
+      //Adding log probabilities, the cross entropy loss of the node
+      Ydata[group.samples[i]] -= log(std::max(
+          softmax_row[group.targets[i]], kLOG_THRESHOLD()));
     }
   }
   return true;
 }
 
-template <>
-void HSoftmaxGradientOp<float, CPUContext>::RunBackwardSingle(const float* X,
-  const float* dY, const float* W, int target,
-  const float* int_output, float* dX, float* dW, float* db, float* dint_output,
-  int dim_in, int dim_out, int& int_output_offset) {
-
-  //Cross entropy
-  // dX_entropy is the dX for the cross entropy layer
-  float* dX_entropy = dint_output + int_output_offset - dim_out;
-  // X_entropy is the X for the cross entropy layer and Y for the softmax layer
-  const float* X_entropy = int_output + int_output_offset - dim_out;
-
-  math::Set<float, CPUContext>(dim_out, 0.f, dX_entropy, &context_);
-  dX_entropy[target] = - (*dY) / std::max(X_entropy[target], kLOG_THRESHOLD());
-
-  int_output_offset -= dim_out;
-
-  //Softmax
-  if (scale_.size() != 1) {
-    scale_.Resize(1);
-  }
-  float* scaledata = scale_.mutable_data<float>();
-
-  if (sum_multiplier_.size() != dim_out) {
-    sum_multiplier_.Resize(dim_out);
-    math::Set<float, CPUContext>(dim_out, 1.f,
-      sum_multiplier_.mutable_data<float>(), &context_);
-  }
-
-  float* dX_softmax = dint_output + int_output_offset - dim_out;
-  context_.Copy<float, CPUContext, CPUContext>(dim_out, dX_entropy, dX_softmax);
-
-  math::Dot<float, CPUContext>(dim_out, X_entropy, dX_entropy, scaledata,
-    &context_);
-  math::Gemv<float, CPUContext>(CblasTrans, 1, dim_out, -1,
-    sum_multiplier_.data<float>(), scaledata , 1, dX_softmax, &context_);
-  math::Mul<float, CPUContext>(dim_out, dX_softmax, X_entropy, dX_softmax,
-    &context_);
-
-  int_output_offset -= dim_out;
-
-  //FC
-  if (bias_multiplier_.size() != 1) {
-    // If the helper bias multiplier has not been created, reshape and fill
-    // it with 1
-    bias_multiplier_.Resize(1);
-    math::Set<float, CPUContext>(1, static_cast<float>(1),
-        bias_multiplier_.template mutable_data<float>(), &context_);
-  }
-
-  // Compute dW and add incrementally
-  // dW = dW + dX_softmax'*X
-  math::Gemm<float, CPUContext>(CblasTrans, CblasNoTrans, dim_out, dim_in, 1, 1,
-    dX_softmax, X, 1, dW, &context_);
-
-  // Compute dB and add incrementally
-  // db = db + dX_softmax*bias_multiplier_
-  math::Gemv<float, CPUContext>(CblasTrans, 1, dim_out, 1, dX_softmax,
-    bias_multiplier_.template data<float>(), 1, db, &context_);
-
-  // Compute dX and add incrementally
-  // dX = dX + W'dX_softmax
-  math::Gemv<float, CPUContext>(CblasTrans, dim_out, dim_in,
-    1, W, dX_softmax, 1, dX, &context_);
-}
-
 // Implementation for the CPU context.
 template <>
 bool HSoftmaxGradientOp<float, CPUContext>::RunOnDevice() {
@@ -237,24 +156,71 @@ bool HSoftmaxGradientOp<float, CPUContext>::RunOnDevice() {
   // Input feature dimension
   int K = X.size() / M;
   const auto* labeldata = label.data<int>();
+  const float* int_output_data = intermediate_output.data<float>();
+  const float* dYdata = dY.data<float>();
+
+  CAFFE_ENFORCE_EQ(
+      GroupByNode(labeldata, M),
+      intermediate_output.size(),
+      "intermediate_output does not match the labels.");
+
+  if (bias_multiplier_.size() != M) {
+    bias_multiplier_.Resize(M);
+    math::Set<float, CPUContext>(M, static_cast<float>(1),
+        bias_multiplier_.mutable_data<float>(), &context_);
+  }
 
-  auto hierarchy = getHierarchyForLabels(M, labeldata, hierarchy_all_map_);
-  int output_offset = getIntermediateOutputSize(labeldata, M, hierarchy);
-
-  //Traverse backward to access intermediate_output generated by HSoftmaxOp
-  // sequentially in reverse order
-  for (int sample = M-1; sample >= 0; sample--) {
-    int word_id = labeldata[sample];
-    PathProto path = hierarchy[word_id];
-    for (auto node = path.path_nodes().rbegin();
-      node != path.path_nodes().rend(); node++) {
-      int w_offset = node->index();
-      int w_length = node->length();
-      int target = node->target();
-      RunBackwardSingle(X.data<float>() + sample*K, dY.data<float>() + sample,
-        W.data<float>() + w_offset*K, target, intermediate_output.data<float>(),
-        dX_data + sample*K, dW_data + w_offset*K, db_data + w_offset,
-        dOutput_data, K, w_length, output_offset);
+  for (int g = 0; g < num_node_groups_; ++g) {
+    const NodeGroup& group = node_groups_[g];
+    const int num_samples = group.samples.size();
+    const int dim_out = group.w_length;
+    // Gradient of the FC output of each example of the node
+    node_fc_.Resize(num_samples, dim_out);
+    float* dfc_data = node_fc_.mutable_data<float>();
+
+    for (int i = 0; i < num_samples; ++i) {
+      const int target = group.targets[i];
+      // X_entropy is the X for the cross entropy layer and Y for the softmax
+      // layer, dX_entropy is its gradient.
+      const float* X_entropy =
+          int_output_data + group.output_offsets[i] + dim_out;
+      float* dX_entropy = dOutput_data + group.output_offsets[i] + dim_out;
+      float* dX_softmax = dOutput_data + group.output_offsets[i];
+
+      //Cross entropy
+      dX_entropy[target] = -dYdata[group.samples[i]] /
+          std::max(X_entropy[target], kLOG_THRESHOLD());
+
+      //Softmax
+      // dX_softmax = (dX_entropy - <dX_entropy, X_entropy>) * X_entropy, and
+      // dX_entropy is zero but for the target.
+      const float dot = dX_entropy[target] * X_entropy[target];
+      for (int j = 0; j < dim_out; ++j) {
+        dX_softmax[j] = (dX_entropy[j] - dot) * X_entropy[j];
+      }
+      std::copy(dX_softmax, dX_softmax + dim_out, dfc_data + i * dim_out);
+    }
+
+    //FC
+    GatherRows(group.samples, X.data<float>(), K, &node_input_);
+    // dW = dW + dX_softmax'*X
+    math::Gemm<float, CPUContext>(CblasTrans, CblasNoTrans, dim_out, K,
+      num_samples, 1, dfc_data, node_input_.data<float>(), 1,
+      dW_data + group.w_offset * K, &context_);
+    // db = db + dX_softmax'*bias_multiplier_
+    math::Gemv<float, CPUContext>(CblasTrans, num_samples, dim_out, 1,
+      dfc_data, bias_multiplier_.data<float>(), 1,
+      db_data + group.w_offset, &context_);
+    // dX = dX + dX_softmax*W, computed for the rows of the node and then
+    // added to the rows of their examples
+    node_softmax_.Resize(num_samples, K);
+    float* dX_rows = node_softmax_.mutable_data<float>();
+    math::Gemm<float, CPUContext>(CblasNoTrans, CblasNoTrans, num_samples, K,
+      dim_out, 1, dfc_data, W.data<float>() + group.w_offset * K, 0, dX_rows,
+      &context_);
+    for (int i = 0; i < num_samples; ++i) {
+      math::Axpy<float, CPUContext>(K, 1.f, dX_rows + i * K,
+        dX_data + group.samples[i] * K, &context_);
     }
   }
   return true;
@@ -271,26 +237,35 @@ bool HSoftmaxSearchOp<float, CPUContext>::pruning(
     const NodeProto& src_node,
     NodeProto& dst_node,
     float parent_score,
-    float beam) {
+    float beam,
+    int depth,
+    SearchScratch* scratch,
+    CPUContext* context) {
   int w_length = src_node.children_size() + src_node.word_ids_size();
-  Tensor<CPUContext> intermediate_data;
-  intermediate_data.Resize(2 * w_length);
-  float* int_output_data = intermediate_data.template mutable_data<float>();
-  int int_output_offset = 0;
   int w_offset = src_node.offset();
+  if (scratch->scores.size() <= static_cast<size_t>(depth)) {
+    scratch->fc.resize(depth + 1);
+    scratch->scores.resize(depth + 1);
+  }
+  if (scratch->sum_multiplier.size() < static_cast<size_t>(w_length)) {
+    scratch->sum_multiplier.resize(w_length, 1.f);
+  }
+  auto& fc_output = scratch->fc[depth];
+  auto& softmax_output = scratch->scores[depth];
+  fc_output.resize(w_length);
+  softmax_output.resize(w_length);
+  float* softmax_output_data = softmax_output.data();
+
+  // W * x + b
+  math::Gemv<float, CPUContext>(CblasNoTrans, w_length, K, 1,
+    W + w_offset * K, X + K * sample, 0, fc_output.data(), context);
+  math::Axpy<float, CPUContext>(w_length, 1.f, b + w_offset, fc_output.data(),
+    context);
+  float scale;
+  float rowmax;
+  SoftmaxCPU(*context, 1, w_length, fc_output.data(), softmax_output_data,
+    &scale, scratch->sum_multiplier.data(), false, &rowmax);
 
-  RunForwardSingle(
-      X + K * sample,
-      W + w_offset * K,
-      b + w_offset,
-      -1,
-      int_output_data,
-      bias_multiplier_.template data<float>() + sample,
-      w_length,
-      K,
-      int_output_offset);
-
-  float* softmax_output_data = int_output_data + w_length;
   // real probabilities
   for (int i = 0; i < w_length; i++) {
     softmax_output_data[i] =
@@ -318,7 +293,10 @@ bool HSoftmaxSearchOp<float, CPUContext>::pruning(
           src_node.children(i),
           *dst_node.mutable_children(idx),
           softmax_output_data[i],
-          beam);
+          beam,
+          depth + 1,
+          scratch,
+          context);
     }
   }
 
@@ -369,61 +347,72 @@ bool HSoftmaxSearchOp<float, CPUContext>::RunOnDevice() {
   // Sum of output dimensions of all hierarchy nodes
   int N = W.dim32(0);
   CAFFE_ENFORCE(N == b.dim32(0), "mismatch between Weight and Bias.");
+  CAFFE_ENFORCE(
+      tree_.root_node().has_offset(),
+      "HSM Search require the field offset in NodeProte");
+  CAFFE_ENFORCE(
+      tree_.root_node().has_name(),
+      "HSM Search require the field name in NodeProte");
   Y_names->Resize(M, top_n_);
   Y_scores->Resize(M, top_n_);
+  auto* y_names_data = Y_names->mutable_data<string>();
+  auto* y_scores_data = Y_scores->mutable_data<float>();
+
+  // The examples are searched independently, in contiguous chunks running in
+  // parallel.
+  const int num_chunks = std::max(1, std::min(num_threads_, M));
+  auto search_chunk = [&](int chunk) {
+    CPUContext context;
+    SearchScratch scratch;
+    for (int sample = chunk * M / num_chunks;
+         sample < (chunk + 1) * M / num_chunks;
+         ++sample) {
+      NodeProto dst_node;
+      dst_node.set_offset(tree_.root_node().offset());
+      dst_node.set_name(tree_.root_node().name());
 
-  if (bias_multiplier_.size() != M) {
-    bias_multiplier_.Resize(M);
-    math::Set<float, CPUContext>(
-        M,
-        static_cast<float>(1),
-        bias_multiplier_.mutable_data<float>(),
-        &context_);
-  }
-
-  for (int sample = 0; sample < M; ++sample) {
-    CAFFE_ENFORCE(
-        tree_.root_node().has_offset(),
-        "HSM Search require the field offset in NodeProte");
-    CAFFE_ENFORCE(
-        tree_.root_node().has_name(),
-        "HSM Search require the field name in NodeProte");
-
-    NodeProto dst_node;
-    dst_node.set_offset(tree_.root_node().offset());
-    dst_node.set_name(tree_.root_node().name());
-
-    pruning(
-        X.data<float>(),
-        sample,
-        K,
-        W.data<float>(),
-        b.data<float>(),
-        tree_.root_node(),
-        dst_node,
-        0,
-        beam_);
-
-    std::vector<std::pair<string, float>> info;
-    extractNodes(dst_node, info);
-    // saving the results for each sample.
-    std::partial_sort(
-        info.begin(),
-        info.begin() + (top_n_ < info.size() ? top_n_ : info.size() - 1),
-        info.end(),
-        [&](std::pair<string, float> a, std::pair<string, float> b) {
-          return a.second < b.second;
-        });
-    auto* y_name_data = Y_names->mutable_data<string>() + sample * top_n_;
-    auto* y_score_data = Y_scores->mutable_data<float>() + sample * top_n_;
-    for (int i = 0; i < top_n_; i++) {
-      if (i < info.size()) {
-        y_name_data[i] = info[i].first;
-        y_score_data[i] = info[i].second;
-      } else {
-        y_score_data[i] = 0;
+      pruning(
+          X.data<float>(),
+          sample,
+          K,
+          W.data<float>(),
+          b.data<float>(),
+          tree_.root_node(),
+          dst_node,
+          0,
+          beam_,
+          0,
+          &scratch,
+          &context);
+
+      std::vector<std::pair<string, float>> info;
+      extractNodes(dst_node, info);
+      // saving the results for each sample.
+      std::partial_sort(
+          info.begin(),
+          info.begin() + (top_n_ < info.size() ? top_n_ : info.size() - 1),
+          info.end(),
+          [&](std::pair<string, float> a, std::pair<string, float> b) {
+            return a.second < b.second;
+          });
+      auto* y_name_data = y_names_data + sample * top_n_;
+      auto* y_score_data = y_scores_data + sample * top_n_;
+      for (int i = 0; i < top_n_; i++) {
+        if (i < info.size()) {
+          y_name_data[i] = info[i].first;
+          y_score_data[i] = info[i].second;
+        } else {
+          y_score_data[i] = 0;
+        }
       }
     }
+  };
+  if (num_chunks == 1) {
+    search_chunk(0);
+  } else {
+    ws_->GetThreadPool()->runChunks(
+        [&](int /* unused */, size_t chunk) { search_chunk(chunk); },
+        num_chunks);
   }
 
   return true;
@@ -577,6 +566,9 @@ The operator returns a 1-D tensor holding the computed log probability of the
 target class and a 2-D tensor of intermediate outputs (from the weight matrix
 and softmax from each step in the path from root to target class) which will be
 used by the gradient operator to compute gradients for all samples in the batch.
+
+The examples of the batch going through the same node of the hierarchy are
+computed together, with one matrix multiplication per node.
 )DOC")
   .Arg("hierarchy", "Serialized HierarchyProto string containing list of "
   "vocabulary words and their paths from root of hierarchy to the leaf")
@@ -627,6 +619,10 @@ OPERATOR_SCHEMA(HSoftmaxSearch)
         "only children, whose score is smaller than parent's score puls beam, "
         "will be propagated. ")
     .Arg("topN", "Number of nodes in outputs")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool searching the "
+        "examples of the batch in parallel, 1 by default.")
     .Input(0, "X", "Input data from previous layer")
     .Input(1, "W", "The matrix trained from Softmax Ops")
     .Input(2, "b", "The bias traiend from Softmax Ops")
@@ -47,38 +47,67 @@ class HSoftmaxOpBase : public Operator<Context> {
   static constexpr T kLOG_THRESHOLD() {
     return 1e-20;
   }
-  static std::unordered_map<int, PathProto> getHierarchyForLabels(
-      int M,
-      const int* labels,
-      const std::unordered_map<int, PathProto>& hierarchy_all_map) {
-    std::unordered_map<int, PathProto> hierarchy_map;
-    std::set<int> label_set = std::set<int>(labels, labels + M);
-    for (const auto& label : label_set) {
-      auto search = hierarchy_all_map.find(label);
-      CAFFE_ENFORCE(search != hierarchy_all_map.end(), "incorrect label.");
-      hierarchy_map.emplace(search->first, search->second);
+
+  // The examples of a batch whose path goes through one node of the
+  // hierarchy. The FC and softmax of the node are computed for all of them
+  // with a single GEMM instead of once per example.
+  struct NodeGroup {
+    int w_offset;
+    int w_length;
+    vector<int> samples;
+    vector<int> targets;
+    // Where the FC output of each example for this node starts in the
+    // intermediate output.
+    vector<int> output_offsets;
+  };
+  // Groups the (example, node) pairs of the batch by node into
+  // node_groups_, in order of first visit, and returns the size of the
+  // intermediate output. Its layout does not depend on the grouping: for each
+  // example, for each node of its path, the FC output followed by the softmax
+  // output.
+  int GroupByNode(const int* labels, int M) {
+    for (int g = 0; g < num_node_groups_; ++g) {
+      node_groups_[g].samples.clear();
+      node_groups_[g].targets.clear();
+      node_groups_[g].output_offsets.clear();
     }
-    return hierarchy_map;
-  }
-  int getIntermediateOutputSize(
-      const int* labels,
-      int M,
-      std::unordered_map<int, PathProto>& hierarchy) const {
+    num_node_groups_ = 0;
+    group_of_node_.clear();
     int size = 0;
-    for (int label = 0; label < M; ++label) {
-      int word_id = labels[label];
-      const auto& path = hierarchy[word_id];
-      size += std::accumulate(
-          path.path_nodes().begin(),
-          path.path_nodes().end(),
-          0,
-          // Output of FC + Output of Softmax
-          [](int sz, PathNodeProto node) {
-            return sz + 2 * node.length();
-          });
+    for (int sample = 0; sample < M; ++sample) {
+      auto search = hierarchy_all_map_.find(labels[sample]);
+      CAFFE_ENFORCE(search != hierarchy_all_map_.end(), "incorrect label.");
+      for (const PathNodeProto& node : search->second.path_nodes()) {
+        auto inserted = group_of_node_.emplace(node.index(), num_node_groups_);
+        if (inserted.second) {
+          if (node_groups_.size() == static_cast<size_t>(num_node_groups_)) {
+            node_groups_.emplace_back();
+          }
+          node_groups_[num_node_groups_].w_offset = node.index();
+          node_groups_[num_node_groups_].w_length = node.length();
+          ++num_node_groups_;
+        }
+        auto& group = node_groups_[inserted.first->second];
+        group.samples.push_back(sample);
+        group.targets.push_back(node.target());
+        group.output_offsets.push_back(size);
+        // Output of FC + Output of Softmax
+        size += 2 * node.length();
+      }
     }
     return size;
   }
+
+  // Reused across runs, only the first num_node_groups_ are valid.
+  vector<NodeGroup> node_groups_;
+  int num_node_groups_ = 0;
+  std::unordered_map<int, int> group_of_node_;
+  // Inputs, FC and softmax outputs, or gradients, of the examples of a
+  // group, one row per example.
+  Tensor<Context> node_input_;
+  Tensor<Context> node_fc_;
+  Tensor<Context> node_softmax_;
+  Tensor<Context> rowmax_;
 };
 
 template <typename T, class Context>
@@ -88,18 +117,6 @@ class HSoftmaxOp : public HSoftmaxOpBase<T, Context> {
   using HSoftmaxOpBase<T, Context>::HSoftmaxOpBase;
 
   bool RunOnDevice() override;
-
- protected:
-  float RunForwardSingle(
-      const float* X,
-      const float* W,
-      const float* b,
-      int target,
-      float* output,
-      const float* bias_multiplier,
-      int w_length,
-      int K,
-      int& output_offset);
 };
 
 template <typename T, class Context>
@@ -108,21 +125,6 @@ class HSoftmaxGradientOp final : public HSoftmaxOpBase<T, Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   using HSoftmaxOpBase<T, Context>::HSoftmaxOpBase;
   bool RunOnDevice() override;
-
- private:
-  void RunBackwardSingle(
-      const float* X,
-      const float* dY,
-      const float* W,
-      int target,
-      const float* int_output,
-      float* dX,
-      float* dW,
-      float* db,
-      float* dOutput,
-      int dim_in,
-      int w_length,
-      int& output_offset);
 };
 
 template <typename T, class Context>
@@ -132,15 +134,28 @@ class HSoftmaxSearchOp final : public HSoftmaxOp<T, Context> {
   HSoftmaxSearchOp(const OperatorDef& operator_def, Workspace* ws)
       : HSoftmaxOp<T, Context>(operator_def, ws),
         top_n_(OperatorBase::GetSingleArgument<int>("topN", 5)),
-        beam_(OperatorBase::GetSingleArgument<float>("beam", 0.01)) {
+        beam_(OperatorBase::GetSingleArgument<float>("beam", 0.01)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
     CAFFE_ENFORCE(tree_.ParseFromString(
         OperatorBase::GetSingleArgument<string>("tree", "")));
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
   }
   bool RunOnDevice() override;
 
  private:
+  // Buffers of the search of one thread. The scores of a node are still
+  // needed after its children are visited, so there is one buffer per depth.
+  struct SearchScratch {
+    vector<vector<float>> fc;
+    vector<vector<float>> scores;
+    vector<float> sum_multiplier;
+  };
+
   int top_n_;
   float beam_;
+  int num_threads_;
+  Workspace* ws_;
   TreeProto tree_;
   bool pruning(
       const float* X,
@@ -151,7 +166,10 @@ class HSoftmaxSearchOp final : public HSoftmaxOp<T, Context> {
       const NodeProto& src_node,
       NodeProto& dst_node,
       float parent_score,
-      float beam);
+      float beam,
+      int depth,
+      SearchScratch* scratch,
+      CPUContext* context);
   bool extractNodes(
       const NodeProto& node,
       std::vector<std::pair<string, float>>& info);
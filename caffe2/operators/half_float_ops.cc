@@ -16,7 +16,33 @@
 
 #include "caffe2/operators/half_float_ops.h"
 
+#include "caffe2/perfkernels/type_conversion.h"
+
 namespace caffe2 {
+
+template <>
+bool FloatToHalfOp<CPUContext>::RunOnDevice() {
+  auto& X = Input(0);
+  auto* Y = Output(0);
+  Y->ResizeLike(X);
+  float_to_float16(
+      X.size(), X.template data<float>(), Y->template mutable_data<float16>());
+  return true;
+}
+
+template <>
+bool HalfToFloatOp<CPUContext>::RunOnDevice() {
+  auto& X = Input(0);
+  auto* Y = Output(0);
+  Y->ResizeLike(X);
+  float16_to_float(
+      X.size(), X.template data<float16>(), Y->template mutable_data<float>());
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(FloatToHalf, FloatToHalfOp<CPUContext>);
+REGISTER_CPU_OPERATOR(HalfToFloat, HalfToFloatOp<CPUContext>);
+
 OPERATOR_SCHEMA(FloatToHalf)
     .NumInputs(1)
     .NumOutputs(1)
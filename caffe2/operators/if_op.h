@@ -35,12 +35,14 @@ class IfOp final : public Operator<Context> {
         this->template GetSingleArgument<NetDef>("then_net", NetDef());
     then_net_ = CreateNet(then_net_def, ws);
     CAFFE_ENFORCE(then_net_, "Failed to initialize then subnet");
+    then_net_->SetParentOperator(this);
 
     if (this->template HasSingleArgumentOfType<NetDef>("else_net")) {
       auto else_net_def =
           this->template GetSingleArgument<NetDef>("else_net", NetDef());
       else_net_ = CreateNet(else_net_def, ws);
       CAFFE_ENFORCE(else_net_, "Failed to initialize else subnet");
+      else_net_->SetParentOperator(this);
     }
   }
 
@@ -19,6 +19,7 @@
 
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/index_hash.h"
 
 namespace caffe2 {
 
@@ -53,25 +54,11 @@ class IndexHashOp : public Operator<Context> {
     auto* indices_data = indices.template data<T>();
     auto* hashed_indices_data = hashed_indices->template mutable_data<T>();
 
-    for (auto i = 0; i < N; i++) {
-      hashed_indices_data[i] = hash(indices_data[i]);
-    }
+    index_hash(N, indices_data, seed_, modulo_, hashed_indices_data);
 
     return true;
   }
 
- protected:
-  template <typename T>
-  T hash(T id) {
-    int8_t* bytes = (int8_t*)&id;
-    T hashed = seed_ * 0xDEADBEEF;
-    for (int i = 0; i < sizeof(T) / sizeof(int8_t); i++) {
-      hashed = hashed * 65537 + bytes[i];
-    }
-    hashed = (modulo_ + hashed % modulo_) % modulo_;
-    return hashed;
-  }
-
  private:
   INPUT_TAGS(INDICES);
   OUTPUT_TAGS(HASHED_INDICES);
@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/index_hash.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Runs IndexHash on ids that have every byte in use, negative ones included,
+// and compares with the scalar hash. The sizes leave tails after the SIMD
+// blocks.
+template <typename T>
+void CheckIndexHash(int64_t seed, int64_t modulo) {
+  for (int n : {1, 7, 37}) {
+    Workspace ws;
+    auto* ids = ws.CreateBlob("ids")->GetMutable<TensorCPU>();
+    ids->Resize(n);
+    T* data = ids->mutable_data<T>();
+    uint64_t x = 88172645463325252ULL;
+    for (int i = 0; i < n; ++i) {
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+      data[i] = static_cast<T>(x);
+    }
+    auto def = CreateOperatorDef(
+        "IndexHash",
+        "",
+        {"ids"},
+        {"hashed"},
+        {MakeArgument<int64_t>("seed", seed),
+         MakeArgument<int64_t>("modulo", modulo)});
+    ASSERT_TRUE(ws.RunOperatorOnce(def));
+    const auto& hashed = ws.GetBlob("hashed")->Get<TensorCPU>();
+    ASSERT_EQ(hashed.size(), n);
+    for (int i = 0; i < n; ++i) {
+      EXPECT_EQ(hashed.data<T>()[i], IndexHash(data[i], seed, modulo));
+      EXPECT_GE(hashed.data<T>()[i], 0);
+      EXPECT_LT(hashed.data<T>()[i], modulo);
+    }
+  }
+}
+
+} // namespace
+
+TEST(IndexHashTest, MatchesScalarHash) {
+  for (int64_t modulo : {1, 1000, 1024, 2147483647}) {
+    CheckIndexHash<int32_t>(0, modulo);
+    CheckIndexHash<int32_t>(-17, modulo);
+    CheckIndexHash<int64_t>(0, modulo);
+    CheckIndexHash<int64_t>(123456789, modulo);
+  }
+  CheckIndexHash<int64_t>(5, int64_t(1) << 40);
+  CheckIndexHash<int64_t>(5, (int64_t(1) << 40) + 3);
+}
+
+} // namespace caffe2
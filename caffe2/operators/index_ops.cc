@@ -14,14 +14,18 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <atomic>
+#include <cstring>
+#include <functional>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <sstream>
-#include <unordered_map>
 #include <vector>
 #include "caffe2/core/blob_serialization.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/packed_strings.h"
 #include "caffe2/core/tensor.h"
 
 namespace caffe2 {
@@ -52,39 +56,208 @@ struct IndexBase {
   const TypeMeta& Type() const { return meta_; }
 
   TIndexValue Size() {
-    std::lock_guard<std::mutex> guard(dictMutex_);
     return nextId_;
   }
 
  protected:
+  // Reserves the next id, failing once max_elements is reached.
+  TIndexValue NewId() {
+    TIndexValue id = nextId_;
+    do {
+      if (id >= maxElements_) {
+        CAFFE_THROW("Dict max size reached");
+      }
+    } while (!nextId_.compare_exchange_weak(id, id + 1));
+    return id;
+  }
+
   int64_t maxElements_;
   TypeMeta meta_;
-  TIndexValue nextId_{1}; // guarded by dictMutex_
+  std::atomic<TIndexValue> nextId_{1};
   std::atomic<bool> frozen_{false};
-  std::mutex dictMutex_;
 };
 
+namespace {
+
+// Number of keys hashed and prefetched ahead of their lookups.
+constexpr size_t kIndexPrefetchBlock = 16;
+
+// std::hash is the identity for integers on common standard libraries, which
+// makes sequential ids collide in the low bits, so its result is mixed with
+// the finalizer of MurmurHash3. The top bits pick the shard and the low bits
+// the slot.
+inline uint64_t IndexHashMix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+template <typename T>
+inline uint64_t IndexHash(const T& key) {
+  return IndexHashMix(std::hash<T>()(key));
+}
+
+// A string key that is not a std::string, e.g. an element of PackedStrings,
+// looked up in an index of std::string without copying it.
+struct StringKey {
+  const char* data;
+  size_t length;
+
+  bool operator==(const std::string& other) const {
+    return length == other.size() &&
+        std::memcmp(data, other.data(), length) == 0;
+  }
+
+  explicit operator std::string() const {
+    return std::string(data, length);
+  }
+};
+
+inline bool operator==(const std::string& a, const StringKey& b) {
+  return b == a;
+}
+
+// Strings are hashed from their bytes, so that a std::string and a
+// StringKey of the same bytes land in the same slot.
+inline uint64_t IndexHash(const char* data, size_t length) {
+  // 64-bit FNV-1a.
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 1099511628211ULL;
+  }
+  return IndexHashMix(h);
+}
+
+template <>
+inline uint64_t IndexHash<std::string>(const std::string& key) {
+  return IndexHash(key.data(), key.size());
+}
+
+inline uint64_t IndexHash(const StringKey& key) {
+  return IndexHash(key.data, key.length);
+}
+
+// Open-addressing hash table with linear probing, from keys to ids. Keys
+// and ids are stored in flat arrays, id 0 marking an empty slot, and the
+// table is kept at most half full.
+template <typename T>
+struct IndexShard {
+  std::mutex mutex;
+  std::vector<T> keys;
+  std::vector<TIndexValue> ids;
+  size_t size{0};
+
+  // Returns the slot holding key, or the empty slot where it belongs.
+  template <typename K>
+  size_t Find(const K& key, uint64_t hash) const {
+    const size_t mask = ids.size() - 1;
+    size_t slot = hash & mask;
+    while (ids[slot] != 0 && !(keys[slot] == key)) {
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  template <typename K>
+  TIndexValue Lookup(const K& key, uint64_t hash) const {
+    return ids.empty() ? 0 : ids[Find(key, hash)];
+  }
+
+  template <typename K>
+  void Insert(const K& key, uint64_t hash, TIndexValue id) {
+    if ((size + 1) * 2 > ids.size()) {
+      Rehash(std::max<size_t>(16, ids.size() * 2));
+    }
+    const auto slot = Find(key, hash);
+    keys[slot] = static_cast<T>(key);
+    ids[slot] = id;
+    ++size;
+  }
+
+  void Prefetch(uint64_t hash) const {
+#ifdef __GNUC__
+    if (!ids.empty()) {
+      const size_t slot = hash & (ids.size() - 1);
+      __builtin_prefetch(&ids[slot]);
+      __builtin_prefetch(&keys[slot]);
+    }
+#endif
+  }
+
+ private:
+  void Rehash(size_t capacity) {
+    std::vector<T> oldKeys(capacity);
+    std::vector<TIndexValue> oldIds(capacity, 0);
+    oldKeys.swap(keys);
+    oldIds.swap(ids);
+    for (size_t i = 0; i < oldIds.size(); ++i) {
+      if (oldIds[i] != 0) {
+        const auto slot = Find(oldKeys[i], IndexHash(oldKeys[i]));
+        keys[slot] = std::move(oldKeys[i]);
+        ids[slot] = oldIds[i];
+      }
+    }
+  }
+};
+
+} // namespace
+
+// The keys are split into shards by hash, each with its own lock, so that
+// concurrent IndexGet calls only contend when they insert into the same
+// shard. Once frozen, lookups take no lock at all.
 template<typename T>
 struct Index: IndexBase {
   explicit Index(TIndexValue maxElements)
     : IndexBase(maxElements, TypeMeta::Make<T>()) {}
 
   void Get(const T* keys, TIndexValue* values, size_t numKeys) {
-    if (frozen_) {
-      FrozenGet(keys, values, numKeys);
-      return;
-    }
-    std::lock_guard<std::mutex> lock(dictMutex_);
-    for (int i = 0; i < numKeys; ++i) {
-      auto it = dict_.find(keys[i]);
-      if (it != dict_.end()) {
-        values[i] = it->second;
-      } else if (nextId_ < maxElements_) {
-        auto newValue = nextId_++;
-        dict_.insert({keys[i], newValue});
-        values[i] = newValue;
-      } else {
-        CAFFE_THROW("Dict max size reached");
+    Get([keys](size_t i) -> const T& { return keys[i]; }, values, numKeys);
+  }
+
+  // Looks up the elements of PackedStrings in an index of std::string; only
+  // the keys inserted are copied.
+  void Get(const PackedStrings& keys, TIndexValue* values) {
+    Get(
+        [&keys](size_t i) { return StringKey{keys.data(i), keys.length(i)}; },
+        values,
+        keys.size());
+  }
+
+  // key(i) returns the ith key, a T or a key comparable with T.
+  template <typename KeyFn>
+  void Get(const KeyFn& key, TIndexValue* values, size_t numKeys) {
+    uint64_t hashes[kIndexPrefetchBlock];
+    for (size_t begin = 0; begin < numKeys; begin += kIndexPrefetchBlock) {
+      const auto end = std::min(numKeys, begin + kIndexPrefetchBlock);
+      for (auto i = begin; i < end; ++i) {
+        hashes[i - begin] = IndexHash(key(i));
+      }
+      if (frozen_) {
+        // Nothing is inserted anymore, so the tables can be read and
+        // prefetched without locking.
+        for (auto i = begin; i < end; ++i) {
+          shard(hashes[i - begin]).Prefetch(hashes[i - begin]);
+        }
+        for (auto i = begin; i < end; ++i) {
+          const auto hash = hashes[i - begin];
+          values[i] = shard(hash).Lookup(key(i), hash);
+        }
+        continue;
+      }
+      for (auto i = begin; i < end; ++i) {
+        const auto hash = hashes[i - begin];
+        auto& s = shard(hash);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto value = s.Lookup(key(i), hash);
+        if (value == 0) {
+          value = NewId();
+          s.Insert(key(i), hash, value);
+        }
+        values[i] = value;
       }
     }
   }
@@ -93,17 +266,24 @@ struct Index: IndexBase {
     CAFFE_ENFORCE(
         numKeys <= maxElements_,
         "Cannot load index: Tensor is larger than max_elements.");
-    decltype(dict_) dict;
+    std::unique_ptr<IndexShard<T>[]> shards(new IndexShard<T>[kNumShards]);
     for (int i = 0; i < numKeys; ++i) {
+      const auto hash = IndexHash(keys[i]);
+      auto& s = shards[hash >> (64 - kShardBits)];
       CAFFE_ENFORCE(
-          dict.insert({keys[i], i + 1}).second,
+          s.Lookup(keys[i], hash) == 0,
           "Repeated elements found: cannot load into dictionary.");
+      s.Insert(keys[i], hash, i + 1);
     }
     // assume no `get` is inflight while this happens
     {
-      std::lock_guard<std::mutex> lock(dictMutex_);
+      auto locks = LockAll();
       // let the old dict get destructed outside of the lock
-      dict_.swap(dict);
+      for (int i = 0; i < kNumShards; ++i) {
+        shards_[i].keys.swap(shards[i].keys);
+        shards_[i].ids.swap(shards[i].ids);
+        std::swap(shards_[i].size, shards[i].size);
+      }
       nextId_ = numKeys + 1;
     }
     return true;
@@ -111,24 +291,38 @@ struct Index: IndexBase {
 
   template<typename Ctx>
   bool Store(Tensor<Ctx>* out) {
-    std::lock_guard<std::mutex> lock(dictMutex_);
+    auto locks = LockAll();
     out->Resize(nextId_ - 1);
     auto outData = out->template mutable_data<T>();
-    for (const auto& entry : dict_) {
-      outData[entry.second - 1] = entry.first;
+    for (int i = 0; i < kNumShards; ++i) {
+      const auto& s = shards_[i];
+      for (size_t slot = 0; slot < s.ids.size(); ++slot) {
+        if (s.ids[slot] != 0) {
+          outData[s.ids[slot] - 1] = s.keys[slot];
+        }
+      }
     }
     return true;
   }
 
  private:
-  void FrozenGet(const T* keys, TIndexValue* values, size_t numKeys) {
-    for (int i = 0; i < numKeys; ++i) {
-      auto it = dict_.find(keys[i]);
-      values[i] = it != dict_.end() ? it->second : 0;
+  static constexpr int kShardBits = 6;
+  static constexpr int kNumShards = 1 << kShardBits;
+
+  IndexShard<T>& shard(uint64_t hash) {
+    return shards_[hash >> (64 - kShardBits)];
+  }
+
+  std::vector<std::unique_lock<std::mutex>> LockAll() {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(kNumShards);
+    for (int i = 0; i < kNumShards; ++i) {
+      locks.emplace_back(shards_[i].mutex);
     }
+    return locks;
   }
 
-  std::unordered_map<T, TIndexValue> dict_;
+  IndexShard<T> shards_[kNumShards];
 };
 
 // TODO(azzolini): support sizes larger than int32
@@ -157,6 +351,16 @@ class IndexGetOp: public Operator<CPUContext> {
    : Operator(operator_def, ws) {}
 
   bool RunOnDevice() override {
+    if (OperatorBase::InputIsType<PackedStrings>(1)) {
+      auto& base = OperatorBase::Input<std::unique_ptr<IndexBase>>(0);
+      auto* dict = dynamic_cast_if_rtti<Index<std::string>*>(base.get());
+      CAFFE_ENFORCE(dict, "Wrong dictionary type given input keys.");
+      const auto& keys = OperatorBase::Input<PackedStrings>(1);
+      auto* values = Output(0);
+      values->Resize(keys.dims());
+      dict->Get(keys, values->mutable_data<TIndexValue>());
+      return true;
+    }
     return DispatchHelper<IndexKeyTypes>::call(this, Input(1));
   }
   template <typename T>
@@ -297,7 +501,10 @@ entries are given index 0. Otherwise, new entries are added into the index.
 If an insert is necessary but max_elements has been reached, fail.
 )DOC")
   .Input(0, "handle", "Pointer to an Index instance.")
-  .Input(1, "keys", "Tensor of keys to be looked up.")
+  .Input(
+      1,
+      "keys",
+      "Tensor of keys to be looked up, or PackedStrings for a string index.")
   .Output(0, "indices", "Indices for each of the keys.");
 
 OPERATOR_SCHEMA(IndexFreeze)
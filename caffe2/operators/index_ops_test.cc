@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <thread>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/blob_serialization.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/packed_strings.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+void SetKeys(Workspace* ws, const string& name, const vector<int64_t>& keys) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(keys.size());
+  std::copy(keys.begin(), keys.end(), tensor->mutable_data<int64_t>());
+}
+
+void RunIndexGet(
+    Workspace* ws,
+    const vector<int64_t>& keys,
+    const string& out) {
+  SetKeys(ws, out + "_keys", keys);
+  ASSERT_TRUE(ws->RunOperatorOnce(
+      CreateOperatorDef("IndexGet", "", {"index", out + "_keys"}, {out})));
+}
+
+const int64_t* Ids(Workspace* ws, const string& name) {
+  return ws->GetBlob(name)->Get<TensorCPU>().data<int64_t>();
+}
+
+} // namespace
+
+TEST(IndexOpsTest, ConcurrentGetAssignsUniqueIds) {
+  Workspace ws;
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("LongIndexCreate", "", {}, {"index"})));
+  // Every thread looks up the same keys, in a different order.
+  const int kThreads = 8;
+  const int kKeys = 20000;
+  vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    vector<int64_t> keys(kKeys);
+    for (int i = 0; i < kKeys; ++i) {
+      keys[i] = ((i + t * 997) % kKeys) * 1000003;
+    }
+    SetKeys(&ws, "ids" + caffe2::to_string(t) + "_keys", keys);
+    // Workspace is not thread safe, so the outputs are created up front.
+    ws.CreateBlob("ids" + caffe2::to_string(t));
+  }
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&ws, t]() {
+      const auto name = "ids" + caffe2::to_string(t);
+      EXPECT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+          "IndexGet", "", {"index", name + "_keys"}, {name})));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_TRUE(
+      ws.RunOperatorOnce(CreateOperatorDef("IndexSize", "", {"index"}, {"n"})));
+  EXPECT_EQ(*Ids(&ws, "n"), kKeys + 1);
+  // The same key got the same id in every thread, and ids are 1..kKeys.
+  vector<int64_t> id_of(kKeys);
+  vector<bool> seen(kKeys + 1, false);
+  for (int i = 0; i < kKeys; ++i) {
+    id_of[i] = Ids(&ws, "ids0")[i];
+    ASSERT_GE(id_of[i], 1);
+    ASSERT_LE(id_of[i], kKeys);
+    EXPECT_FALSE(seen[id_of[i]]);
+    seen[id_of[i]] = true;
+  }
+  for (int t = 1; t < kThreads; ++t) {
+    const auto* ids = Ids(&ws, "ids" + caffe2::to_string(t));
+    for (int i = 0; i < kKeys; ++i) {
+      ASSERT_EQ(ids[i], id_of[(i + t * 997) % kKeys]);
+    }
+  }
+}
+
+TEST(IndexOpsTest, StoreLoadAndSerialize) {
+  Workspace ws;
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "LongIndexCreate",
+      "",
+      {},
+      {"index"},
+      {MakeArgument<int>("max_elements", 6)})));
+  RunIndexGet(&ws, {7, 3, 7, 9, 12, 3}, "ids");
+  const vector<int64_t> expected = {1, 2, 1, 3, 4, 2};
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(Ids(&ws, "ids")[i], expected[i]);
+  }
+  // Only the ids 1 to 5 fit.
+  RunIndexGet(&ws, {20}, "more");
+  EXPECT_EQ(Ids(&ws, "more")[0], 5);
+  SetKeys(&ws, "full_keys", {21});
+  EXPECT_THROW(
+      ws.RunOperatorOnce(
+          CreateOperatorDef("IndexGet", "", {"index", "full_keys"}, {"x"})),
+      EnforceNotMet);
+
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("IndexStore", "", {"index"}, {"stored"})));
+  const auto& stored = ws.GetBlob("stored")->Get<TensorCPU>();
+  EXPECT_EQ(
+      vector<int64_t>(
+          stored.data<int64_t>(), stored.data<int64_t>() + stored.size()),
+      vector<int64_t>({7, 3, 9, 12, 20}));
+
+  // A frozen copy made through serialization keeps the ids and returns 0 for
+  // unknown keys.
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("IndexFreeze", "", {"index"}, {"index"})));
+  const auto serialized = ws.GetBlob("index")->Serialize("index");
+  Workspace ws2;
+  ws2.CreateBlob("index")->Deserialize(serialized);
+  RunIndexGet(&ws2, {12, 5, 7}, "ids");
+  EXPECT_EQ(Ids(&ws2, "ids")[0], 4);
+  EXPECT_EQ(Ids(&ws2, "ids")[1], 0);
+  EXPECT_EQ(Ids(&ws2, "ids")[2], 1);
+
+  // Loading replaces the content of the index.
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("LongIndexCreate", "", {}, {"index"})));
+  SetKeys(&ws, "items", {5, 6, 5});
+  EXPECT_THROW(
+      ws.RunOperatorOnce(
+          CreateOperatorDef("IndexLoad", "", {"index", "items"}, {"index"})),
+      EnforceNotMet);
+  SetKeys(&ws, "items", {5, 6, 8});
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("IndexLoad", "", {"index", "items"}, {"index"})));
+  RunIndexGet(&ws, {8, 6, 100}, "loaded");
+  EXPECT_EQ(Ids(&ws, "loaded")[0], 3);
+  EXPECT_EQ(Ids(&ws, "loaded")[1], 2);
+  EXPECT_EQ(Ids(&ws, "loaded")[2], 4);
+}
+
+TEST(IndexOpsTest, StringKeysAndPackedStrings) {
+  Workspace ws;
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("StringIndexCreate", "", {}, {"index"})));
+  const vector<std::string> keys = {"b", "a", "b", "", "c"};
+  auto* tensor = ws.CreateBlob("keys")->GetMutable<TensorCPU>();
+  tensor->Resize(keys.size());
+  std::copy(keys.begin(), keys.end(), tensor->mutable_data<std::string>());
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("IndexGet", "", {"index", "keys"}, {"ids"})));
+  const vector<int64_t> expected = {1, 2, 1, 3, 4};
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(Ids(&ws, "ids")[i], expected[i]);
+  }
+
+  // Packed keys find the ids of the same strings, and add new ones.
+  auto* packed = ws.CreateBlob("packed")->GetMutable<PackedStrings>();
+  packed->Reset({4});
+  for (const auto& key : {"c", "d", "", "b"}) {
+    packed->Add(key);
+  }
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("IndexGet", "", {"index", "packed"}, {"packed_ids"})));
+  const auto& ids = ws.GetBlob("packed_ids")->Get<TensorCPU>();
+  EXPECT_EQ(ids.dims(), vector<TIndex>({4}));
+  EXPECT_EQ(Ids(&ws, "packed_ids")[0], 4);
+  EXPECT_EQ(Ids(&ws, "packed_ids")[1], 5);
+  EXPECT_EQ(Ids(&ws, "packed_ids")[2], 3);
+  EXPECT_EQ(Ids(&ws, "packed_ids")[3], 1);
+}
+
+} // namespace caffe2
@@ -15,6 +15,7 @@
  */
 
 #include "caffe2/operators/instance_norm_op.h"
+#include "caffe2/utils/run_chunks.h"
 
 namespace caffe2 {
 
@@ -40,32 +41,49 @@ bool InstanceNormOp<T, Context>::RunOnDeviceWithOrderNHWC() {
   inv_stdev->Resize(N, C);
   ConstEigenVectorArrayMap<T> scale(Input(SCALE).template data<T>(), C);
   ConstEigenVectorArrayMap<T> bias(Input(BIAS).template data<T>(), C);
-  for (int n = 0; n < N; ++n) {
-    ConstEigenArrayMap<T> Xmat(X.template data<T>() + offset * n, C, H * W);
-    EigenArrayMap<T> Ymat(Y->template mutable_data<T>() + offset * n, C, H * W);
-    EigenVectorArrayMap<T> mean_arr(
-        mean->template mutable_data<T>() + n * C, C);
-    EigenVectorArrayMap<T> inv_stdev_arr(
-        inv_stdev->template mutable_data<T>() + n * C, C);
+  const auto* Xdata = X.template data<T>();
+  auto* Ydata = Y->template mutable_data<T>();
+  auto* mean_data = mean->template mutable_data<T>();
+  auto* inv_stdev_data = inv_stdev->template mutable_data<T>();
+
+  // A chunk of planes covers a range of channels of one or more images;
+  // every image is normalized for a block of channels at once.
+  RunChunks(
+      ws_, num_threads_, N * C, H * W, [&](int, TIndex begin, TIndex end) {
+        for (TIndex i = begin; i < end;) {
+          const int n = i / C;
+          const int c = i % C;
+          const int channels = std::min<TIndex>(C - c, end - i);
+          i += channels;
+          ConstEigenArrayMap<T> Ximage(Xdata + offset * n, C, H * W);
+          EigenArrayMap<T> Yimage(Ydata + offset * n, C, H * W);
+          const auto Xmat = Ximage.block(c, 0, channels, H * W);
+          auto Ymat = Yimage.block(c, 0, channels, H * W);
+          EigenVectorArrayMap<T> mean_arr(mean_data + n * C + c, channels);
+          EigenVectorArrayMap<T> inv_stdev_arr(
+              inv_stdev_data + n * C + c, channels);
 
-    // The following effectively does the row wise mean computation:
-    //   mean_arr = Xmat.rowwise().mean();
-    // but manually vectorizes over columns.
-    mean_arr = Xmat.col(0);
-    for (int i = 1; i < H * W; ++i) {
-      mean_arr += Xmat.col(i);
-    }
-    mean_arr *= 1. / (H * W);
-    Ymat = Xmat.colwise() - mean_arr;
-    // The following effectively does row wise squared norm computation,
-    // but manually vectorizes over columns similar to the mean case.
-    inv_stdev_arr = Ymat.col(0) * Ymat.col(0);
-    for (int i = 1; i < H * W; ++i) {
-      inv_stdev_arr += Ymat.col(i) * Ymat.col(i);
-    }
-    inv_stdev_arr = (inv_stdev_arr / (H * W) + epsilon_).sqrt().inverse();
-    Ymat = (Ymat.colwise() * (inv_stdev_arr * scale)).colwise() + bias;
-  }
+          // The following effectively does the row wise mean computation:
+          //   mean_arr = Xmat.rowwise().mean();
+          // but manually vectorizes over columns.
+          mean_arr = Xmat.col(0);
+          for (int j = 1; j < H * W; ++j) {
+            mean_arr += Xmat.col(j);
+          }
+          mean_arr *= 1. / (H * W);
+          Ymat = Xmat.colwise() - mean_arr;
+          // The following effectively does row wise squared norm computation,
+          // but manually vectorizes over columns similar to the mean case.
+          inv_stdev_arr = Ymat.col(0) * Ymat.col(0);
+          for (int j = 1; j < H * W; ++j) {
+            inv_stdev_arr += Ymat.col(j) * Ymat.col(j);
+          }
+          inv_stdev_arr = (inv_stdev_arr / (H * W) + epsilon_).sqrt().inverse();
+          Ymat = (Ymat.colwise() * (inv_stdev_arr * scale.segment(c, channels)))
+                     .colwise() +
+              bias.segment(c, channels);
+        }
+      });
   return true;
 }
 
@@ -92,19 +110,24 @@ bool InstanceNormOp<T, Context>::RunOnDeviceWithOrderNCHW() {
   auto* mean_data = mean->template mutable_data<T>();
   auto* inv_stdev_data = inv_stdev->template mutable_data<T>();
 
-  // TODO: benchmark parallelization strategies.
-  for (auto i = 0; i < N * C; ++i) {
-    ConstEigenVectorArrayMap<T> Xi(Xdata + H * W * i, H * W);
-    const T Xi_mean = Xi.mean();
-    const T squared_norm = (Xi - Xi_mean).matrix().squaredNorm();
-    const T inv_stdev = 1.0 / std::sqrt(squared_norm / (H * W) + epsilon_);
-    mean_data[i] = Xi_mean;
-    inv_stdev_data[i] = inv_stdev;
-    EigenVectorArrayMap<T> Yi(Ydata + H * W * i, H * W);
-    const T channel_scale = inv_stdev * scale_data[i % C];
-    const T channel_shift = bias_data[i % C] - Xi_mean * channel_scale;
-    Yi = Xi * channel_scale + channel_shift;
-  }
+  // Every plane is normalized on its own, from its own statistics, so the
+  // planes are split over the threads.
+  RunChunks(
+      ws_, num_threads_, N * C, H * W, [&](int, TIndex begin, TIndex end) {
+        for (auto i = begin; i < end; ++i) {
+          ConstEigenVectorArrayMap<T> Xi(Xdata + H * W * i, H * W);
+          const T Xi_mean = Xi.mean();
+          const T squared_norm = (Xi - Xi_mean).matrix().squaredNorm();
+          const T inv_stdev =
+              1.0 / std::sqrt(squared_norm / (H * W) + epsilon_);
+          mean_data[i] = Xi_mean;
+          inv_stdev_data[i] = inv_stdev;
+          EigenVectorArrayMap<T> Yi(Ydata + H * W * i, H * W);
+          const T channel_scale = inv_stdev * scale_data[i % C];
+          const T channel_shift = bias_data[i % C] - Xi_mean * channel_scale;
+          Yi = Xi * channel_scale + channel_shift;
+        }
+      });
 
   return true;
 }
@@ -132,6 +155,10 @@ computation.
 )DOC")
     .Arg("epsilon", "The epsilon value to use to avoid division by zero.")
     .Arg("order", "A StorageOrder string.")
+    .Arg(
+        "num_threads",
+        "(int, default 1) Number of threads of the workspace pool the CPU "
+        "implementation splits the (N, C) planes over.")
     .Input(
         0,
         "input",
@@ -31,8 +31,11 @@ class InstanceNormOp : public Operator<Context> {
       : Operator<Context>(operator_def, ws),
         epsilon_(OperatorBase::GetSingleArgument<T>("epsilon", 1e-5)),
         order_(StringToStorageOrder(
-            OperatorBase::GetSingleArgument<string>("order", "NCHW"))) {
+            OperatorBase::GetSingleArgument<string>("order", "NCHW"))),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
     CAFFE_ENFORCE(epsilon_ >= 0, "Must pass a nonnegative epsilon.");
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
   }
   ~InstanceNormOp() {}
 
@@ -54,6 +57,8 @@ class InstanceNormOp : public Operator<Context> {
   // parameters
   T epsilon_;
   StorageOrder order_;
+  int num_threads_;
+  Workspace* ws_;
 
   // temp results that get passed to the gradient, but are otherwise stored here
   Tensor<Context> mean_;
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/int8_quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "caffe2/perfkernels/int8_gemm.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
+namespace caffe2 {
+
+Int8QuantizationParams ChooseInt8QuantizationParams(float min, float max) {
+  min = std::min(min, 0.f);
+  max = std::max(max, 0.f);
+  Int8QuantizationParams params;
+  if (max == min) {
+    return params;
+  }
+  params.scale = (max - min) / 255;
+  params.zero_point = std::min(
+      255, std::max(0, static_cast<int>(std::nearbyint(-min / params.scale))));
+  return params;
+}
+
+void FindMinMax(const float* x, TIndex N, float* min, float* max) {
+  float lo = std::numeric_limits<float>::max();
+  float hi = std::numeric_limits<float>::lowest();
+  for (TIndex i = 0; i < N; ++i) {
+    lo = std::min(lo, x[i]);
+    hi = std::max(hi, x[i]);
+  }
+  *min = N ? lo : 0;
+  *max = N ? hi : 0;
+}
+
+void QuantizeUint8(
+    const float* x,
+    TIndex N,
+    const Int8QuantizationParams& params,
+    std::uint8_t* q) {
+  const float inv_scale = 1 / params.scale;
+  for (TIndex i = 0; i < N; ++i) {
+    const float v = std::nearbyint(x[i] * inv_scale) + params.zero_point;
+    q[i] = static_cast<std::uint8_t>(std::min(255.f, std::max(0.f, v)));
+  }
+}
+
+void DequantizeUint8(
+    const std::uint8_t* q,
+    TIndex N,
+    const Int8QuantizationParams& params,
+    float* x) {
+  for (TIndex i = 0; i < N; ++i) {
+    x[i] = params.scale * (static_cast<std::int32_t>(q[i]) - params.zero_point);
+  }
+}
+
+Int8QuantizationParams Int8ActivationRange::Params(const float* x, TIndex N)
+    const {
+  if (calibrated_) {
+    return ChooseInt8QuantizationParams(min_, max_);
+  }
+  float min, max;
+  FindMinMax(x, N, &min, &max);
+  return ChooseInt8QuantizationParams(min, max);
+}
+
+void Int8PackedWeights::Pack(const TensorCPU& W, int N) {
+  const void* source = W.raw_data();
+  if (source == source_ && W.version() == source_version_ &&
+      W.dims() == source_dims_) {
+    return;
+  }
+  CAFFE_ENFORCE_GT(N, 0);
+  CAFFE_ENFORCE_EQ(W.size() % N, 0);
+  const int K = W.size() / N;
+  const float* w = W.data<float>();
+  data_.resize(W.size());
+  scales_.resize(N);
+  row_sums_.resize(N);
+  for (int n = 0; n < N; ++n) {
+    const float* row = w + n * K;
+    float max_abs = 0;
+    for (int k = 0; k < K; ++k) {
+      max_abs = std::max(max_abs, std::abs(row[k]));
+    }
+    const float scale = max_abs > 0 ? max_abs / 127 : 1;
+    std::int32_t sum = 0;
+    for (int k = 0; k < K; ++k) {
+      const float v = std::min(127.f, std::nearbyint(row[k] / scale));
+      data_[n * K + k] = static_cast<std::int8_t>(std::max(-127.f, v));
+      sum += data_[n * K + k];
+    }
+    scales_[n] = scale;
+    row_sums_[n] = sum;
+  }
+  source_ = source;
+  source_version_ = W.version();
+  source_dims_ = W.dims();
+}
+
+namespace {
+// Below this many multiply-adds the work is not worth waking up the pool.
+constexpr TIndex kMinParallelInt8GemmSize = 1 << 16;
+} // namespace
+
+void Int8GemmNT(
+    int M,
+    int N,
+    int K,
+    const std::uint8_t* A,
+    const std::int8_t* B,
+    std::int32_t* acc,
+    int num_threads,
+    ThreadPool* pool) {
+  if (!pool || num_threads <= 1 ||
+      static_cast<TIndex>(M) * N * K < kMinParallelInt8GemmSize) {
+    int8_gemm_nt(M, N, K, A, B, acc, N);
+    return;
+  }
+  const bool split_rows = M >= num_threads;
+  const int size = split_rows ? M : N;
+  const int num_chunks = std::min(num_threads, size);
+  const int chunk = (size + num_chunks - 1) / num_chunks;
+  pool->runChunks(
+      [&](int /* unused */, size_t i) {
+        const int begin = i * chunk;
+        const int end = std::min(size, begin + chunk);
+        if (begin >= end) {
+          return;
+        }
+        if (split_rows) {
+          int8_gemm_nt(
+              end - begin, N, K, A + begin * K, B, acc + begin * N, N);
+        } else {
+          int8_gemm_nt(M, end - begin, K, A, B + begin * K, acc + begin, N);
+        }
+      },
+      num_chunks);
+}
+
+void Int8AccumulatorsToFloat(
+    int M,
+    int N,
+    const std::int32_t* acc,
+    const Int8QuantizationParams& x_params,
+    const Int8PackedWeights& weights,
+    const float* bias,
+    float* Y,
+    int ldy,
+    int incy) {
+  const float* w_scales = weights.scales();
+  const std::int32_t* row_sums = weights.row_sums();
+  for (int m = 0; m < M; ++m) {
+    for (int n = 0; n < N; ++n) {
+      const std::int32_t v =
+          acc[m * N + n] - x_params.zero_point * row_sums[n];
+      Y[m * ldy + n * incy] =
+          x_params.scale * w_scales[n] * v + (bias ? bias[n] : 0.f);
+    }
+  }
+}
+
+} // namespace caffe2
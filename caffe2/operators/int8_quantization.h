@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_INT8_QUANTIZATION_H_
+#define CAFFE2_OPERATORS_INT8_QUANTIZATION_H_
+
+#include <cstdint>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/core/tensor.h"
+
+namespace caffe2 {
+
+// Shared pieces of the INT8 engine for Conv and FC on CPU. Activations are
+// quantized to uint8 with a per-tensor affine mapping
+//   x = scale * (q - zero_point)
+// and weights to int8 in [-127, 127] with a symmetric scale per output
+// channel. The products are accumulated in int32 by int8_gemm_nt and turned
+// back into fp32 with Int8AccumulatorsToFloat, so the operators remain drop in
+// replacements for their fp32 counterparts.
+struct Int8QuantizationParams {
+  float scale = 1;
+  std::int32_t zero_point = 0;
+};
+
+// Chooses parameters that cover [min, max]. The range is widened to include
+// zero so that zero, which is what the convolution pads with, is exact.
+Int8QuantizationParams ChooseInt8QuantizationParams(float min, float max);
+
+void FindMinMax(const float* x, TIndex N, float* min, float* max);
+
+void QuantizeUint8(
+    const float* x,
+    TIndex N,
+    const Int8QuantizationParams& params,
+    std::uint8_t* q);
+
+void DequantizeUint8(
+    const std::uint8_t* q,
+    TIndex N,
+    const Int8QuantizationParams& params,
+    float* x);
+
+// The activation parameters of an int8 operator. The range comes from the
+// "in_min" and "in_max" arguments that calibration writes into the operator,
+// see python/int8_calibration.py. Uncalibrated operators use the range of the
+// current input instead, which costs a pass over it.
+class Int8ActivationRange {
+ public:
+  explicit Int8ActivationRange(const OperatorBase& op)
+      : calibrated_(op.HasArgument("in_min") && op.HasArgument("in_max")),
+        min_(op.GetSingleArgument<float>("in_min", 0)),
+        max_(op.GetSingleArgument<float>("in_max", 0)) {
+    CAFFE_ENFORCE_LE(min_, max_);
+  }
+
+  Int8QuantizationParams Params(const float* x, TIndex N) const;
+
+  bool calibrated() const {
+    return calibrated_;
+  }
+
+ private:
+  bool calibrated_;
+  float min_;
+  float max_;
+};
+
+// Weights quantized row by row, for an [N, K] matrix whose rows are the output
+// channels. The packed copy is only redone when the weight tensor points to a
+// different buffer or shape, or its version() changed.
+class Int8PackedWeights {
+ public:
+  void Pack(const TensorCPU& W, int N);
+
+  const std::int8_t* data() const {
+    return data_.data();
+  }
+  // The scale of each row.
+  const float* scales() const {
+    return scales_.data();
+  }
+  // The sum of the quantized values of each row, which folds the activation
+  // zero point out of the integer product.
+  const std::int32_t* row_sums() const {
+    return row_sums_.data();
+  }
+
+ private:
+  const void* source_ = nullptr;
+  uint64_t source_version_ = 0;
+  vector<TIndex> source_dims_;
+  vector<std::int8_t> data_;
+  vector<float> scales_;
+  vector<std::int32_t> row_sums_;
+};
+
+class ThreadPool;
+
+// acc = A * B^T with int8_gemm_nt, spread over up to num_threads threads of
+// pool, which may be null. The rows of A are split between the threads, or
+// the rows of B when A has fewer rows than threads, as for an FC on a single
+// example. Small products run on the calling thread.
+void Int8GemmNT(
+    int M,
+    int N,
+    int K,
+    const std::uint8_t* A,
+    const std::int8_t* B,
+    std::int32_t* acc,
+    int num_threads,
+    ThreadPool* pool);
+
+// Y[m * ldy + n * incy] =
+//     x_params.scale * weights.scales()[n] *
+//         (acc[m * N + n] - x_params.zero_point * weights.row_sums()[n]) +
+//     bias[n]
+// bias may be null. ldy and incy allow writing the output transposed.
+void Int8AccumulatorsToFloat(
+    int M,
+    int N,
+    const std::int32_t* acc,
+    const Int8QuantizationParams& x_params,
+    const Int8PackedWeights& weights,
+    const float* bias,
+    float* Y,
+    int ldy,
+    int incy);
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_INT8_QUANTIZATION_H_
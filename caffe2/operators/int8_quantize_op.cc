@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/int8_quantization.h"
+
+namespace caffe2 {
+
+namespace {
+
+class Int8QuantizeOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  Int8QuantizeOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws), range_(*this) {}
+
+  bool RunOnDevice() override {
+    const auto& X = Input(0);
+    auto* Q = Output(0);
+    auto* scale = Output(1);
+    auto* zero_point = Output(2);
+    const auto params = range_.Params(X.data<float>(), X.size());
+    Q->ResizeLike(X);
+    QuantizeUint8(
+        X.data<float>(), X.size(), params, Q->mutable_data<std::uint8_t>());
+    scale->Resize(1);
+    scale->mutable_data<float>()[0] = params.scale;
+    zero_point->Resize(1);
+    zero_point->mutable_data<int32_t>()[0] = params.zero_point;
+    return true;
+  }
+
+ private:
+  Int8ActivationRange range_;
+};
+
+class Int8DequantizeOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  using Operator<CPUContext>::Operator;
+
+  bool RunOnDevice() override {
+    const auto& Q = Input(0);
+    CAFFE_ENFORCE_EQ(Input(1).size(), 1);
+    CAFFE_ENFORCE_EQ(Input(2).size(), 1);
+    Int8QuantizationParams params;
+    params.scale = Input(1).data<float>()[0];
+    params.zero_point = Input(2).data<int32_t>()[0];
+    auto* X = Output(0);
+    X->ResizeLike(Q);
+    DequantizeUint8(
+        Q.data<std::uint8_t>(), Q.size(), params, X->mutable_data<float>());
+    return true;
+  }
+};
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(Int8Quantize, Int8QuantizeOp);
+REGISTER_CPU_OPERATOR(Int8Dequantize, Int8DequantizeOp);
+
+OPERATOR_SCHEMA(Int8Quantize)
+    .NumInputs(1)
+    .NumOutputs(3)
+    .SetDoc(R"DOC(
+Quantizes a float tensor to uint8 with the affine mapping
+X = scale * (Q - zero_point) used by the INT8 engine of Conv and FC. The range
+is taken from the in_min and in_max arguments if both are given, and from the
+input otherwise. Zero is always representable exactly.
+)DOC")
+    .Arg("in_min", "(float) Lower end of the calibrated range of X.")
+    .Arg("in_max", "(float) Upper end of the calibrated range of X.")
+    .Input(0, "X", "Float tensor to quantize.")
+    .Output(0, "Q", "uint8 tensor of the shape of X.")
+    .Output(1, "scale", "float tensor of size 1.")
+    .Output(2, "zero_point", "int32 tensor of size 1.");
+
+OPERATOR_SCHEMA(Int8Dequantize)
+    .NumInputs(3)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+The inverse of Int8Quantize, computes X = scale * (Q - zero_point).
+)DOC")
+    .Input(0, "Q", "uint8 tensor.")
+    .Input(1, "scale", "float tensor of size 1.")
+    .Input(2, "zero_point", "int32 tensor of size 1.")
+    .Output(0, "X", "Float tensor of the shape of Q.");
+
+NO_GRADIENT(Int8Quantize);
+NO_GRADIENT(Int8Dequantize);
+
+} // namespace caffe2
@@ -0,0 +1,275 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include "caffe2/core/db.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+// An embedding table whose rows are stored in a key-value db, e.g. rocksdb
+// or lmdb, keyed by row id, so that it can be larger than memory. Rows that
+// were never written read as zeros.
+class KVEmbeddingTable {
+ public:
+  KVEmbeddingTable(std::unique_ptr<db::DB> db, TIndex blockSize)
+      : db_(std::move(db)), blockSize_(blockSize) {
+    CAFFE_ENFORCE(db_);
+    CAFFE_ENFORCE_GT(blockSize_, 0);
+  }
+
+  TIndex blockSize() const {
+    return blockSize_;
+  }
+
+  template <typename IndexType>
+  void lookup(
+      const IndexType* ids,
+      TIndex numIds,
+      float* rows,
+      bool* found) {
+    vector<string> keys(numIds);
+    for (TIndex i = 0; i < numIds; ++i) {
+      keys[i] = key(ids[i]);
+    }
+    vector<string> values;
+    vector<bool> exists;
+    {
+      std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+      if (!db_->SupportsConcurrentCursors()) {
+        lock.lock();
+      }
+      db_->MultiGet(keys, &values, &exists);
+    }
+    const size_t rowBytes = blockSize_ * sizeof(float);
+    for (TIndex i = 0; i < numIds; ++i) {
+      float* row = rows + i * blockSize_;
+      if (!exists[i]) {
+        std::fill(row, row + blockSize_, 0.0f);
+      } else {
+        CAFFE_ENFORCE_EQ(
+            values[i].size(),
+            rowBytes,
+            "Row ",
+            ids[i],
+            " does not have ",
+            blockSize_,
+            " floats");
+        memcpy(row, values[i].data(), rowBytes);
+      }
+      if (found) {
+        found[i] = exists[i];
+      }
+    }
+  }
+
+  template <typename IndexType>
+  void write(const IndexType* ids, TIndex numIds, const float* rows) {
+    const size_t rowBytes = blockSize_ * sizeof(float);
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto transaction = db_->NewTransaction();
+    for (TIndex i = 0; i < numIds; ++i) {
+      transaction->Put(
+          key(ids[i]),
+          string(reinterpret_cast<const char*>(rows + i * blockSize_),
+                 rowBytes));
+    }
+    transaction->Commit();
+  }
+
+ private:
+  // Big-endian, so that the keys sort like the ids.
+  static string key(int64_t id) {
+    CAFFE_ENFORCE_GE(id, 0, "Row ids must not be negative");
+    string k(sizeof(id), '\0');
+    for (int i = sizeof(id) - 1; i >= 0; --i) {
+      k[i] = static_cast<char>(id & 0xff);
+      id >>= 8;
+    }
+    return k;
+  }
+
+  std::unique_ptr<db::DB> db_;
+  const TIndex blockSize_;
+  std::mutex mutex_;
+};
+
+using KVEmbeddingTablePtr = std::shared_ptr<KVEmbeddingTable>;
+CAFFE_KNOWN_TYPE(KVEmbeddingTablePtr);
+
+namespace {
+
+class CreateKVEmbeddingTableOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  CreateKVEmbeddingTableOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        db_name_(OperatorBase::GetSingleArgument<string>("db", "")),
+        db_type_(OperatorBase::GetSingleArgument<string>("db_type", "")),
+        block_size_(OperatorBase::GetSingleArgument<int>("block_size", 0)),
+        mode_(
+            OperatorBase::GetSingleArgument<bool>("read_only", false)
+                ? db::READ
+                : OperatorBase::GetSingleArgument<bool>("create", false)
+                    ? db::NEW
+                    : db::WRITE) {
+    CAFFE_ENFORCE(db_name_.size(), "Must specify a db name.");
+    CAFFE_ENFORCE(db_type_.size(), "Must specify a db type.");
+    CAFFE_ENFORCE_GT(block_size_, 0, "Must specify block_size.");
+  }
+
+  bool RunOnDevice() override {
+    auto db = db::CreateDB(db_type_, db_name_, mode_);
+    CAFFE_ENFORCE(db, "Cannot open db ", db_name_, " of type ", db_type_);
+    *OperatorBase::Output<KVEmbeddingTablePtr>(0) =
+        std::make_shared<KVEmbeddingTable>(std::move(db), block_size_);
+    return true;
+  }
+
+ private:
+  const string db_name_;
+  const string db_type_;
+  const int block_size_;
+  const db::Mode mode_;
+};
+
+class KVEmbeddingLookupOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  KVEmbeddingLookupOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    auto& table = OperatorBase::Input<KVEmbeddingTablePtr>(TABLE);
+    CAFFE_ENFORCE(table, "The table was not created");
+    const auto& indices = Input(INDICES);
+    CAFFE_ENFORCE_EQ(indices.ndim(), 1, "INDICES must be a vector");
+    auto* rows = Output(ROWS);
+    rows->Resize(indices.size(), table->blockSize());
+    bool* found = nullptr;
+    if (OutputSize() > FOUND) {
+      Output(FOUND)->Resize(indices.size());
+      found = Output(FOUND)->template mutable_data<bool>();
+    }
+    table->lookup(
+        indices.template data<IndexType>(),
+        indices.size(),
+        rows->template mutable_data<float>(),
+        found);
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(TABLE, INDICES);
+  OUTPUT_TAGS(ROWS, FOUND);
+};
+
+class KVEmbeddingWriteOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  KVEmbeddingWriteOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    auto& table = OperatorBase::Input<KVEmbeddingTablePtr>(TABLE);
+    CAFFE_ENFORCE(table, "The table was not created");
+    const auto& indices = Input(INDICES);
+    const auto& rows = Input(ROWS);
+    CAFFE_ENFORCE_EQ(indices.ndim(), 1, "INDICES must be a vector");
+    CAFFE_ENFORCE(rows.IsType<float>(), "ROWS must be float");
+    CAFFE_ENFORCE_EQ(
+        rows.size(),
+        indices.size() * table->blockSize(),
+        "ROWS must have one row of the table per index");
+    table->write(
+        indices.template data<IndexType>(),
+        indices.size(),
+        rows.template data<float>());
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(TABLE, INDICES, ROWS);
+};
+
+REGISTER_CPU_OPERATOR(CreateKVEmbeddingTable, CreateKVEmbeddingTableOp);
+REGISTER_CPU_OPERATOR(KVEmbeddingLookup, KVEmbeddingLookupOp);
+REGISTER_CPU_OPERATOR(KVEmbeddingWrite, KVEmbeddingWriteOp);
+
+OPERATOR_SCHEMA(CreateKVEmbeddingTable)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Opens an embedding table whose float rows are stored in a db, e.g. rocksdb
+or lmdb, keyed by row id, so that the table can be larger than memory. The
+rows are read with KVEmbeddingLookup, which fetches a whole batch with one
+multi-get, and written with KVEmbeddingWrite, which writes a batch in one
+transaction. Rows that were never written read as zeros.
+
+A sparse optimizer runs on the rows of a batch in between, e.g. a lookup of
+the unique indices, the update of the looked up rows and a write back of
+them.
+)DOC")
+    .Arg("db", "Name of the db")
+    .Arg("db_type", "Type of the db, e.g. rocksdb or lmdb")
+    .Arg("block_size", "Number of floats in a row")
+    .Arg("read_only", "(bool, default false) Open the db read only")
+    .Arg("create", "(bool, default false) Create a new db")
+    .Output(0, "TABLE", "The embedding table");
+
+OPERATOR_SCHEMA(KVEmbeddingLookup)
+    .NumInputs(2)
+    .NumOutputs(1, 2)
+    .SetDoc("Reads the rows INDICES of an embedding table from its db.")
+    .Input(0, "TABLE", "The table, see CreateKVEmbeddingTable")
+    .Input(1, "INDICES", "int32 or int64 row ids")
+    .Output(0, "ROWS", "The rows, zeros for the ones never written")
+    .Output(1, "FOUND", "(Optional) Whether each row is in the db");
+
+OPERATOR_SCHEMA(KVEmbeddingWrite)
+    .NumInputs(3)
+    .NumOutputs(0, 1)
+    .EnforceInplace({{0, 0}})
+    .SetDoc(R"DOC(
+Writes the rows INDICES of an embedding table to its db, in one transaction.
+)DOC")
+    .Input(0, "TABLE", "The table, see CreateKVEmbeddingTable")
+    .Input(1, "INDICES", "int32 or int64 row ids")
+    .Input(2, "ROWS", "The new rows, one per index")
+    .Output(0, "TABLE", "(Optional) The table, in place");
+
+SHOULD_NOT_DO_GRADIENT(CreateKVEmbeddingTable);
+SHOULD_NOT_DO_GRADIENT(KVEmbeddingLookup);
+SHOULD_NOT_DO_GRADIENT(KVEmbeddingWrite);
+
+} // namespace
+} // namespace caffe2
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/db.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// A sorted in-memory db, named by its source, which only has what the
+// default DB::MultiGet needs.
+std::map<string, std::map<string, string>> gTestDBs;
+
+class TestDBCursor : public db::Cursor {
+ public:
+  explicit TestDBCursor(std::map<string, string>* data)
+      : data_(data), it_(data->begin()) {}
+  void Seek(const string& key) override {
+    it_ = data_->lower_bound(key);
+  }
+  bool SupportsSeek() override {
+    return true;
+  }
+  void SeekToFirst() override {
+    it_ = data_->begin();
+  }
+  void Next() override {
+    ++it_;
+  }
+  string key() override {
+    return it_->first;
+  }
+  string value() override {
+    return it_->second;
+  }
+  bool Valid() override {
+    return it_ != data_->end();
+  }
+
+ private:
+  std::map<string, string>* data_;
+  std::map<string, string>::iterator it_;
+};
+
+class TestDBTransaction : public db::Transaction {
+ public:
+  explicit TestDBTransaction(std::map<string, string>* data) : data_(data) {}
+  void Put(const string& key, const string& value) override {
+    (*data_)[key] = value;
+  }
+  void Commit() override {}
+
+ private:
+  std::map<string, string>* data_;
+};
+
+class TestDB : public db::DB {
+ public:
+  TestDB(const string& source, db::Mode mode)
+      : db::DB(source, mode), data_(&gTestDBs[source]) {}
+  void Close() override {}
+  std::unique_ptr<db::Cursor> NewCursor() override {
+    return make_unique<TestDBCursor>(data_);
+  }
+  std::unique_ptr<db::Transaction> NewTransaction() override {
+    return make_unique<TestDBTransaction>(data_);
+  }
+
+ private:
+  std::map<string, string>* data_;
+};
+
+} // namespace
+
+namespace db {
+REGISTER_CAFFE2_DB(KVEmbeddingTestDB, TestDB);
+} // namespace db
+
+namespace {
+
+void SetTensor(Workspace* ws, const string& name, const vector<int64_t>& v) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(v.size());
+  std::copy(v.begin(), v.end(), tensor->mutable_data<int64_t>());
+}
+
+} // namespace
+
+TEST(KVEmbeddingTableTest, WriteThenLookup) {
+  Workspace ws;
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "CreateKVEmbeddingTable",
+      "",
+      {},
+      {"table"},
+      {MakeArgument<string>("db", "write_then_lookup"),
+       MakeArgument<string>("db_type", "KVEmbeddingTestDB"),
+       MakeArgument<int>("block_size", 3)})));
+
+  // Ids on both sides of a byte boundary, to check the key order.
+  SetTensor(&ws, "indices", {256, 7, 1});
+  auto* rows = ws.CreateBlob("rows")->GetMutable<TensorCPU>();
+  rows->Resize(3, 3);
+  for (int i = 0; i < rows->size(); ++i) {
+    rows->mutable_data<float>()[i] = i;
+  }
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "KVEmbeddingWrite", "", {"table", "indices", "rows"}, {"table"})));
+
+  SetTensor(&ws, "lookup_ids", {1, 5, 256, 7, 1});
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "KVEmbeddingLookup",
+      "",
+      {"table", "lookup_ids"},
+      {"looked_up", "found"})));
+  const auto& looked_up = ws.GetBlob("looked_up")->Get<TensorCPU>();
+  const auto& found = ws.GetBlob("found")->Get<TensorCPU>();
+  ASSERT_EQ(looked_up.dims(), vector<TIndex>({5, 3}));
+  // Position of each looked up row in rows, or -1 if it was not written.
+  const vector<int> source = {2, -1, 0, 1, 2};
+  for (int i = 0; i < source.size(); ++i) {
+    EXPECT_EQ(found.data<bool>()[i], source[i] >= 0);
+    for (int k = 0; k < 3; ++k) {
+      EXPECT_EQ(
+          looked_up.data<float>()[i * 3 + k],
+          source[i] >= 0 ? source[i] * 3 + k : 0);
+    }
+  }
+  EXPECT_EQ(gTestDBs["write_then_lookup"].size(), 3);
+}
+
+} // namespace caffe2
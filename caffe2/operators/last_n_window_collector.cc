@@ -35,19 +35,40 @@ class LastNWindowCollectorOp : public Operator<Context> {
   }
 
   bool RunOnDevice() override {
+    // Only the slots of the new rows are claimed under the mutex, the rows
+    // are copied after releasing it. The buffer is allocated for all
+    // num_to_collect rows when it is first written and never moves after
+    // that, so concurrent producers copy into disjoint slots, unless more
+    // than num_to_collect rows are being appended at once.
+    vector<Chunk> chunks;
     if (InputSize() > MUTEX) {
       auto& mutex = OperatorBase::Input<std::unique_ptr<std::mutex>>(MUTEX);
       std::lock_guard<std::mutex> guard(*mutex);
-      return collect();
+      claim(&chunks);
     } else {
-      return collect();
+      claim(&chunks);
     }
+    const auto& input = Input(DATA);
+    for (const auto& chunk : chunks) {
+      context_.template CopyItems<Context, Context>(
+          input.meta(), chunk.num_items, chunk.src, chunk.dst);
+    }
+    return true;
   }
 
  private:
+  // A run of consecutive input rows that goes to consecutive slots.
+  struct Chunk {
+    const void* src;
+    void* dst;
+    TIndex num_items;
+  };
+
   const int32_t numToCollect_;
 
-  bool collect() {
+  // Claims the slots of the new rows: grows the buffer, advances the cursor
+  // and the number of visited rows, and returns the copies to do.
+  void claim(vector<Chunk>* chunks) {
     auto* output = Output(LAST_N);
     const auto& input = Input(DATA);
 
@@ -73,6 +94,10 @@ class LastNWindowCollectorOp : public Operator<Context> {
     }
 
     dims[0] = numToCollect_;
+    // IMPORTANT: Force the output to have the right type before reserving,
+    // so that the whole window is allocated at once and the later Resize
+    // calls never reallocate it
+    output->raw_mutable_data(input.meta());
     output->Reserve(dims, &context_);
 
     if (num_entries == 0) {
@@ -80,7 +105,7 @@ class LastNWindowCollectorOp : public Operator<Context> {
         // Get both shape and meta
         output->CopyFrom(input, &context_);
       }
-      return true;
+      return;
     }
 
     auto num_to_copy = std::min<int32_t>(num_entries, numToCollect_);
@@ -103,32 +128,26 @@ class LastNWindowCollectorOp : public Operator<Context> {
 
     if (num_entries > numToCollect_) {
       // just copy the last N rows
-      context_.template CopyItems<Context, Context>(
-          input.meta(),
-          num_to_copy * block_size,
-          input_data + (num_entries - numToCollect_) * block_bytesize,
-          output_data);
+      chunks->push_back(
+          {input_data + (num_entries - numToCollect_) * block_bytesize,
+           output_data,
+           num_to_copy * block_size});
       *next_data = 0;
-      return true;
+      return;
     }
     auto start = *next_data;
-    auto first_chunk_size =
-        std::min<size_t>(num_to_copy + start, numToCollect_) - start;
-    context_.template CopyItems<Context, Context>(
-        input.meta(),
-        first_chunk_size * block_size,
-        input_data,
-        output_data + start * block_bytesize);
-
-    context_.template CopyItems<Context, Context>(
-        input.meta(),
-        (num_to_copy - first_chunk_size) * block_size,
-        input_data + first_chunk_size * block_bytesize,
-        output_data);
+    const TIndex first_chunk_size =
+        std::min<TIndex>(num_to_copy + start, numToCollect_) - start;
+    chunks->push_back({input_data,
+                       output_data + start * block_bytesize,
+                       first_chunk_size * block_size});
+    if (num_to_copy > first_chunk_size) {
+      chunks->push_back({input_data + first_chunk_size * block_bytesize,
+                         output_data,
+                         (num_to_copy - first_chunk_size) * block_size});
+    }
 
     *next_data = (start + num_to_copy) % numToCollect_;
-
-    return true;
   }
 
   INPUT_TAGS(LAST_N_IN, NEXT_IN, DATA, MUTEX, NUM_VISITED_IN);
@@ -168,7 +187,10 @@ input rows and keeping the last N rows seen as input. So for instance:
 A possible output would be
 [[6,7],[7,8],[8,9],[9,10],[10,11],[11,12]]
 
-This is not thread safe unless a mutex is given.
+This is not thread safe unless a mutex is given. The buffer is allocated for
+all num_to_collect rows on the first call, and with a mutex, only the slots of
+the new rows are claimed while holding it, so that several producers can copy
+their rows at the same time.
 )DOC")
     .Arg(
         "num_to_collect",
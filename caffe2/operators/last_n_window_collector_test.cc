@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+void InitCollector(Workspace* ws) {
+  auto* last_n = ws->CreateBlob("last_n")->GetMutable<TensorCPU>();
+  last_n->Resize(0, 2);
+  last_n->mutable_data<float>();
+  auto* next = ws->CreateBlob("next")->GetMutable<TensorCPU>();
+  next->Resize(vector<TIndex>{});
+  next->mutable_data<int32_t>()[0] = 0;
+  ASSERT_TRUE(ws->RunOperatorOnce(
+      CreateOperatorDef("CreateMutex", "", {}, {"mutex"})));
+}
+
+OperatorDef CollectorDef(const string& data, int num_to_collect) {
+  return CreateOperatorDef(
+      "LastNWindowCollector",
+      "",
+      {"last_n", "next", data, "mutex"},
+      {"last_n", "next"},
+      {MakeArgument("num_to_collect", num_to_collect)});
+}
+
+// Creates a [rows, 2] batch whose rows are (first + i, first + i).
+void FeedBatch(Workspace* ws, const string& name, int first, int rows) {
+  auto* data = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  data->Resize(rows, 2);
+  for (int i = 0; i < 2 * rows; ++i) {
+    data->mutable_data<float>()[i] = first + i / 2;
+  }
+}
+
+vector<float> CollectedRows(const Workspace& ws) {
+  const auto& last_n = ws.GetBlob("last_n")->Get<TensorCPU>();
+  vector<float> rows;
+  for (int i = 0; i < last_n.dim(0); ++i) {
+    EXPECT_EQ(last_n.data<float>()[2 * i], last_n.data<float>()[2 * i + 1]);
+    rows.push_back(last_n.data<float>()[2 * i]);
+  }
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
+} // namespace
+
+TEST(LastNWindowCollectorTest, KeepsTheLastRows) {
+  Workspace ws;
+  InitCollector(&ws);
+  const auto def = CollectorDef("data", 6);
+  FeedBatch(&ws, "data", 1, 4);
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+  EXPECT_EQ(CollectedRows(ws), vector<float>({1, 2, 3, 4}));
+  FeedBatch(&ws, "data", 5, 3);
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+  FeedBatch(&ws, "data", 8, 4);
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+  EXPECT_EQ(CollectedRows(ws), vector<float>({6, 7, 8, 9, 10, 11}));
+  FeedBatch(&ws, "data", 12, 20);
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+  EXPECT_EQ(CollectedRows(ws), vector<float>({26, 27, 28, 29, 30, 31}));
+}
+
+TEST(LastNWindowCollectorTest, ConcurrentProducers) {
+  constexpr int kThreads = 4;
+  constexpr int kBatches = 50;
+  constexpr int kRows = 10;
+  Workspace ws;
+  InitCollector(&ws);
+  for (int t = 0; t < kThreads; ++t) {
+    FeedBatch(&ws, "data" + caffe2::to_string(t), 0, kRows);
+  }
+  vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    const string data = "data" + caffe2::to_string(t);
+    threads.emplace_back([&ws, data, t]() {
+      auto op = CreateOperator(CollectorDef(data, kThreads * kRows), &ws);
+      for (int b = 0; b < kBatches; ++b) {
+        auto* batch = ws.GetBlob(data)->GetMutable<TensorCPU>();
+        for (int i = 0; i < 2 * kRows; ++i) {
+          batch->mutable_data<float>()[i] =
+              (t * kBatches + b) * kRows + i / 2;
+        }
+        EXPECT_TRUE(op->Run());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // The window is exactly as large as one batch of every producer, the rows
+  // must be whole and distinct.
+  auto rows = CollectedRows(ws);
+  ASSERT_EQ(rows.size(), kThreads * kRows);
+  EXPECT_EQ(std::unique(rows.begin(), rows.end()) - rows.begin(), rows.size());
+  EXPECT_EQ(ws.GetBlob("next")->Get<TensorCPU>().data<int32_t>()[0], 0);
+}
+
+} // namespace caffe2
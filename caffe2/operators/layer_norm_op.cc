@@ -18,16 +18,6 @@
 
 namespace caffe2 {
 
-namespace {
-template <typename T>
-using EigenMatrixMapRowMajor = Eigen::Map<
-    Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>;
-
-template <typename T>
-using ConstEigenMatrixMapRowMajor = Eigen::Map<
-    const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>;
-} // namespace
-
 template <>
 template <>
 bool LayerNormOp<CPUContext>::DoRunWithType<float>() {
@@ -49,26 +39,30 @@ bool LayerNormOp<CPUContext>::DoRunWithType<float>() {
   mean->Resize(stats_dims);
   stdev->Resize(stats_dims);
 
-  auto input_map = ConstEigenMatrixMapRowMajor<float>(
-      input.template data<float>(), left, right);
-  auto mean_map = EigenMatrixMapRowMajor<float>(
-      mean->template mutable_data<float>(), left, 1);
-  auto stdev_map = EigenMatrixMapRowMajor<float>(
-      stdev->template mutable_data<float>(), left, 1);
-  auto output_map = EigenMatrixMapRowMajor<float>(
-      output->template mutable_data<float>(), left, right);
-
-  auto sqr = [](float f) { return f * f; };
-  auto add_ep = [this](float f) { return f + epsilon_; };
-  auto fsqrt = [](float f) { return std::sqrt(f); };
-  // Calculate row-wise statistics
-  mean_map = input_map.rowwise().mean();
-  stdev_map =
-      (input_map.unaryExpr(sqr).rowwise().mean() - mean_map.unaryExpr(sqr))
-          .unaryExpr(add_ep)
-          .unaryExpr(fsqrt);
-  output_map = (input_map - mean_map.replicate(1, right))
-                   .cwiseQuotient(stdev_map.replicate(1, right));
+  const float* input_data = input.template data<float>();
+  float* output_data = output->template mutable_data<float>();
+  float* mean_data = mean->template mutable_data<float>();
+  float* stdev_data = stdev->template mutable_data<float>();
+  for (int i = 0; i < left; ++i) {
+    const float* x = input_data + i * right;
+    // Welford's algorithm: the row-wise statistics in a single pass, without
+    // the cancellation of E(x^2) - E(x)^2.
+    float mu = 0;
+    float m2 = 0;
+    for (int j = 0; j < right; ++j) {
+      const float delta = x[j] - mu;
+      mu += delta / (j + 1);
+      m2 += delta * (x[j] - mu);
+    }
+    const float sigma = std::sqrt(m2 / right + epsilon_);
+    mean_data[i] = mu;
+    stdev_data[i] = sigma;
+    const float inv_sigma = 1.0f / sigma;
+    float* y = output_data + i * right;
+    for (int j = 0; j < right; ++j) {
+      y[j] = (x[j] - mu) * inv_sigma;
+    }
+  }
 
   return true;
 }
@@ -79,7 +73,6 @@ template <>
 template <>
 bool LayerNormGradientOp<CPUContext>::DoRunWithType<float>() {
   const auto& dout = Input(0);
-  const auto& norm_outputs = Input(1);
   const auto& means = Input(2);
   const auto& stdev = Input(3);
   const auto& norm_inputs = Input(4);
@@ -91,58 +84,32 @@ bool LayerNormGradientOp<CPUContext>::DoRunWithType<float>() {
 
   ginput->ResizeLike(norm_inputs);
 
-  auto dout_map = ConstEigenMatrixMapRowMajor<float>(
-      dout.template data<float>(), left, right);
-  auto means_map =
-      ConstEigenMatrixMapRowMajor<float>(means.template data<float>(), left, 1);
-  auto stdev_map =
-      ConstEigenMatrixMapRowMajor<float>(stdev.template data<float>(), left, 1);
-  auto norm_inputs_map = ConstEigenMatrixMapRowMajor<float>(
-      norm_inputs.template data<float>(), left, right);
-  auto ginput_map = EigenMatrixMapRowMajor<float>(
-      ginput->template mutable_data<float>(), left, right);
-
-  // Helper functors
-  auto sqr = [](float f) { return f * f; };
-  auto recip = [](float f) { return 1.0f / f; };
-  auto neg_recip = [](float f) { return -1.0f / f; };
-
-  // Gradients - output block
-  // -1 / (stdev + epsilon)^2 * \sum_j^D x_ij - mean * dout
-  // First part: -1 / (stdev + epsilon)^2
-  auto dstdev_end_0 = stdev_map.unaryExpr(sqr).unaryExpr(neg_recip);
-  // Second part: \sum_j^D x_ij - mean * dout
-  auto dstdev_end_1 = (norm_inputs_map - means_map.replicate(1, right))
-                          .cwiseProduct(dout_map)
-                          .rowwise()
-                          .sum();
-  auto dstdev_end = dstdev_end_0.cwiseProduct(dstdev_end_1);
-  // \sum_j^D -dout * 1/(std+epsilon)
-  auto dmean_end = stdev_map.unaryExpr(neg_recip)
-                       .replicate(1, right)
-                       .cwiseProduct(dout_map)
-                       .rowwise()
-                       .sum();
-  // 1.0 / (stdev + epsilon) * dout
-  auto dx_end =
-      stdev_map.unaryExpr(recip).replicate(1, right).cwiseProduct(dout_map);
-
-  // Gradients - standard deviation block
-  // -1.0*(mean / stdev) * dstdev_end
-  auto dmean_stdev = stdev_map.unaryExpr(neg_recip)
-                         .cwiseProduct(means_map)
-                         .replicate(1, right)
-                         .cwiseProduct(dstdev_end);
-  // (mean / (D*stdev)) * dstdev
-  auto dx_stdev = (1.0f / right) *
-      norm_inputs_map.cwiseQuotient(stdev_map.replicate(1, right))
-          .cwiseProduct(dstdev_end.replicate(1, right));
-
-  // Gradients - mean block
-  auto dmean = dmean_end + dmean_stdev;
-  auto dx_mean = (1.0f / right) * dmean.replicate(1, right);
-
-  ginput_map = dx_end + dx_stdev + dx_mean;
+  const float* dout_data = dout.template data<float>();
+  const float* means_data = means.template data<float>();
+  const float* stdev_data = stdev.template data<float>();
+  const float* norm_inputs_data = norm_inputs.template data<float>();
+  float* ginput_data = ginput->template mutable_data<float>();
+  for (int i = 0; i < left; ++i) {
+    const float* dy = dout_data + i * right;
+    const float* x = norm_inputs_data + i * right;
+    const float mu = means_data[i];
+    const float sigma = stdev_data[i];
+    // With xhat = (x - mean) / stdev,
+    // dx = (dy - mean(dy) - xhat * mean(dy * xhat)) / stdev
+    float sum_dy = 0;
+    float sum_dy_x = 0;
+    for (int j = 0; j < right; ++j) {
+      sum_dy += dy[j];
+      sum_dy_x += dy[j] * (x[j] - mu);
+    }
+    const float inv_sigma = 1.0f / sigma;
+    const float dmean = sum_dy / right;
+    const float dvar = sum_dy_x * inv_sigma * inv_sigma / right;
+    float* dx = ginput_data + i * right;
+    for (int j = 0; j < right; ++j) {
+      dx[j] = (dy[j] - dmean - (x[j] - mu) * dvar) * inv_sigma;
+    }
+  }
 
   return true;
 }
@@ -196,7 +163,8 @@ Computes layer normalization as described in https://arxiv.org/pdf/1607.06450.pd
 Given an input vector x \in [a_0, a_1, ...,a_{k-1}, a_k, ..., a_{n-1}],
 this op treats dimensions a_k through a_{n-1} as feature vectors. For each
 feature vector, the op contains the mean and standard deviation. Then,
-it returns the normalized values (with restdev_mapct to the feature vector).
+it returns the normalized values (with respect to the feature vector).
+The statistics are computed in a single pass with Welford's algorithm.
 
 Note that this op does not contain the scale an bias terms described in the
 paper. Simply follow this op with an FC op to add those. Concretely, this op
@@ -14,84 +14,133 @@
  * limitations under the License.
  */
 
+
 #include "caffe2/operators/layer_norm_op.h"
 
-#include <cub/cub.cuh>
+#include <cub/block/block_reduce.cuh>
 
 #include "caffe2/core/context_gpu.h"
-#include "caffe2/utils/math.h"
 
 namespace caffe2 {
 
 namespace {
-template <typename T>
-struct SqrTransform {
-  inline __host__ __device__ T operator()(const T v) const {
-    return v * v;
-  }
+
+// Running statistics of Welford's algorithm.
+struct WelfordData {
+  float mean;
+  float m2;
+  float count;
 };
 
-// X = X - Y^2
-__global__ void sqrtXMinusYSquaredKernel(
-    const int N,
-    float* x,
-    const float* y,
-    const float epsilon) {
-  CUDA_1D_KERNEL_LOOP(i, N) {
-    x[i] = sqrtf(x[i] - y[i] * y[i] + epsilon);
+struct WelfordReduce {
+  inline __device__ WelfordData
+  operator()(const WelfordData& a, const WelfordData& b) const {
+    const float count = a.count + b.count;
+    if (count == 0) {
+      return a;
+    }
+    const float delta = b.mean - a.mean;
+    const float ratio = b.count / count;
+    return WelfordData{a.mean + delta * ratio,
+                       a.m2 + b.m2 + delta * delta * a.count * ratio,
+                       count};
   }
-}
+};
 
-// out[i, j] = (X[i, j] - mu[i]) / sigma[i]
-__global__ void normalizeKernel(
-    const int row_dim,
-    const int N,
+// One block per row: the statistics of the row in a single pass over it,
+// then the normalized row.
+__global__ void LayerNormForwardKernel(
+    const int left,
+    const int right,
+    const float epsilon,
     const float* x,
-    const float* mu,
-    const float* sigma,
+    float* mean,
+    float* stdev,
     float* out) {
-  CUDA_1D_KERNEL_LOOP(i, N) {
-    out[i] = (x[i] - mu[i / row_dim]) / (sigma[i / row_dim]);
+  typedef cub::BlockReduce<WelfordData, CAFFE_CUDA_NUM_THREADS> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage temp_storage;
+  __shared__ float row_mean;
+  __shared__ float row_inv_stdev;
+
+  for (int i = blockIdx.x; i < left; i += gridDim.x) {
+    const float* x_row = x + i * right;
+    WelfordData data{0, 0, 0};
+    for (int j = threadIdx.x; j < right; j += blockDim.x) {
+      data.count += 1;
+      const float delta = x_row[j] - data.mean;
+      data.mean += delta / data.count;
+      data.m2 += delta * (x_row[j] - data.mean);
+    }
+    data = BlockReduce(temp_storage).Reduce(data, WelfordReduce());
+    if (threadIdx.x == 0) {
+      const float sigma = sqrtf(data.m2 / right + epsilon);
+      mean[i] = data.mean;
+      stdev[i] = sigma;
+      row_mean = data.mean;
+      row_inv_stdev = 1.0f / sigma;
+    }
+    __syncthreads();
+    float* out_row = out + i * right;
+    for (int j = threadIdx.x; j < right; j += blockDim.x) {
+      out_row[j] = (x_row[j] - row_mean) * row_inv_stdev;
+    }
+    __syncthreads();
   }
 }
 
-template <typename InputIterator_t>
-void allocScratchAndReduce(
-    InputIterator_t input,
-    float* output,
-    int num_segments,
-    int* seg_indices,
-    Tensor<CUDAContext>* scratch,
-    cudaStream_t stream) {
-  size_t temp_storage_bytes;
-  cub::DeviceSegmentedReduce::Sum(
-      nullptr, // To retrieve required temporary storage size
-      temp_storage_bytes, // size_t &temp_storage_bytes
-      input, // InputIteratorT d_i
-      output, // OutputIteratorT d_out
-      num_segments, // int num_segments
-      seg_indices, // int *d_begin_offsets
-      seg_indices + 1, // int *d_end_offsets
-      stream // cudaStream_t stream=0
-      );
-  size_t temp_storage_floats = temp_storage_bytes / sizeof(float) +
-      (temp_storage_bytes % sizeof(float) ? 1 : 0);
-  scratch->Resize(vector<size_t>{temp_storage_floats});
+struct GradientSums {
+  float dy;
+  float dy_x;
+};
 
-  cub::DeviceSegmentedReduce::Sum(
-      scratch->mutable_data<float>(), // To retrieve required temporary storage
-                                      // size
-      temp_storage_bytes, // size_t &temp_storage_bytes
-      input, // InputIteratorT d_i
-      output, // OutputIteratorT d_out
-      num_segments, // int num_segments
-      seg_indices, // int *d_begin_offsets
-      seg_indices + 1, // int *d_end_offsets
-      stream // cudaStream_t stream=0
-      );
+struct GradientSumsReduce {
+  inline __device__ GradientSums
+  operator()(const GradientSums& a, const GradientSums& b) const {
+    return GradientSums{a.dy + b.dy, a.dy_x + b.dy_x};
+  }
+};
+
+// One block per row. With xhat = (x - mean) / stdev,
+// dx = (dy - mean(dy) - xhat * mean(dy * xhat)) / stdev
+__global__ void LayerNormBackwardKernel(
+    const int left,
+    const int right,
+    const float* dy,
+    const float* x,
+    const float* mean,
+    const float* stdev,
+    float* dx) {
+  typedef cub::BlockReduce<GradientSums, CAFFE_CUDA_NUM_THREADS> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage temp_storage;
+  __shared__ float row_dmean;
+  __shared__ float row_dvar;
+
+  for (int i = blockIdx.x; i < left; i += gridDim.x) {
+    const float* dy_row = dy + i * right;
+    const float* x_row = x + i * right;
+    const float mu = mean[i];
+    const float inv_sigma = 1.0f / stdev[i];
+    GradientSums sums{0, 0};
+    for (int j = threadIdx.x; j < right; j += blockDim.x) {
+      sums.dy += dy_row[j];
+      sums.dy_x += dy_row[j] * (x_row[j] - mu);
+    }
+    sums = BlockReduce(temp_storage).Reduce(sums, GradientSumsReduce());
+    if (threadIdx.x == 0) {
+      row_dmean = sums.dy / right;
+      row_dvar = sums.dy_x * inv_sigma * inv_sigma / right;
+    }
+    __syncthreads();
+    float* dx_row = dx + i * right;
+    for (int j = threadIdx.x; j < right; j += blockDim.x) {
+      dx_row[j] =
+          (dy_row[j] - row_dmean - (x_row[j] - mu) * row_dvar) * inv_sigma;
+    }
+    __syncthreads();
+  }
 }
 
-} //  namespace
+} // namespace
 
 template <>
 template <>
@@ -113,90 +162,24 @@ bool LayerNormOp<CUDAContext>::DoRunWithType<float>() {
   stats_dims.push_back(1);
   mean->Resize(stats_dims);
   stdev->Resize(stats_dims);
-
-  std::vector<int> segs(left + 1);
-  std::iota(segs.begin(), segs.end(), 0);
-  std::transform(
-      segs.begin(),
-      segs.end(),
-      segs.begin(),
-      std::bind1st(std::multiplies<int>(), right));
-
-  seg_indices_.Resize(vector<size_t>{segs.size()});
-  context_.CopyBytes<CPUContext, CUDAContext>(
-      sizeof(int) * segs.size(),
-      static_cast<void*>(segs.data()),
-      static_cast<void*>(seg_indices_.mutable_data<int>()));
-
-  if (right == 1) {
-    mean->CopyFrom(input);
-    mean->Resize(stats_dims);
-    math::Set<float, CUDAContext>(
-        left, std::sqrt(epsilon_), stdev->mutable_data<float>(), &context_);
-  } else {
-    // Calculate row-wise means
-    // First stage: sum up feature vectors
-    allocScratchAndReduce(
-        input.data<float>(),
-        mean->mutable_data<float>(),
-        left,
-        seg_indices_.mutable_data<int>(),
-        &scratch_,
-        context_.cuda_stream());
-
-    // Second stage: Normalize by feature vector dim
-    math::Scale<float, CUDAContext>(
-        left,
-        1.0f / right,
-        mean->mutable_data<float>(),
-        mean->mutable_data<float>(),
-        &context_);
-
-    // Calculate row-wise standard deviation
-
-    // First stage: sum up row-wise squared values
-    SqrTransform<float> transform;
-    cub::TransformInputIterator<float, SqrTransform<float>, const float*> it(
-        input.data<float>(), transform);
-    allocScratchAndReduce(
-        it,
-        stdev->mutable_data<float>(),
-        left,
-        seg_indices_.mutable_data<int>(),
-        &scratch_,
-        context_.cuda_stream());
-
-    // Second stage: Normalize by feature vector dim
-    math::Scale<float, CUDAContext>(
-        left,
-        1.0f / right,
-        stdev->mutable_data<float>(),
-        stdev->mutable_data<float>(),
-        &context_);
-
-    // stddev = sqrt(E(x^2) - E(x)^2 + epsilon)
-    sqrtXMinusYSquaredKernel<<<
-        CAFFE_GET_BLOCKS(left),
-        CAFFE_CUDA_NUM_THREADS,
-        0,
-        context_.cuda_stream()>>>(
-        left,
-        stdev->mutable_data<float>(),
-        mean->mutable_data<float>(),
-        epsilon_);
+  if (left == 0) {
+    mean->mutable_data<float>();
+    stdev->mutable_data<float>();
+    output->mutable_data<float>();
+    return true;
   }
 
-  // out[i, j] = (in[i,j] - mu[i]) / (sigma[i])
-  normalizeKernel<<<
-      CAFFE_GET_BLOCKS(left),
+  LayerNormForwardKernel<<<
+      std::min(left, CAFFE_MAXIMUM_NUM_BLOCKS),
       CAFFE_CUDA_NUM_THREADS,
       0,
       context_.cuda_stream()>>>(
+      left,
       right,
-      left * right,
+      epsilon_,
       input.data<float>(),
-      mean->data<float>(),
-      stdev->data<float>(),
+      mean->mutable_data<float>(),
+      stdev->mutable_data<float>(),
       output->mutable_data<float>());
 
   return true;
@@ -204,178 +187,36 @@ bool LayerNormOp<CUDAContext>::DoRunWithType<float>() {
 
 REGISTER_CUDA_OPERATOR(LayerNorm, LayerNormOp<CUDAContext>);
 
-namespace {
-// x : [N, D]
-// y : [N, 1]
-// z : [N, D]
-// (x - broadcast(y)) * z
-__global__ void zTimesXminusYbroadcast(
-    int N,
-    int D,
-    const float* x,
-    const float* y,
-    const float* z,
-    float* out) {
-  CUDA_1D_KERNEL_LOOP(i, N * D) {
-    out[i] = (x[i] - y[i / D]) * z[i];
-  }
-}
-
-__global__ void normalizeByNegStdev(
-    int N,
-    bool var,
-    const float* x,
-    const float* stdev,
-    float* out) {
-  if (var) {
-    CUDA_1D_KERNEL_LOOP(i, N) {
-      out[i] = (-1.0f * x[i]) / (stdev[i] * stdev[i]);
-    }
-  } else {
-    CUDA_1D_KERNEL_LOOP(i, N) {
-      out[i] = (-1.0f * x[i]) / (stdev[i]);
-    }
-  }
-}
-
-__global__ void gradientMegaKernel(
-    int N,
-    int D,
-    const float* stdev,
-    const float* X,
-    const float* dstdev,
-    const float* dmean,
-    const float* dout,
-    float* out) {
-  CUDA_1D_KERNEL_LOOP(i, N * D) {
-    out[i] = 1.0f / stdev[i / D] * dout[i] +
-        X[i] / (D * stdev[i / D]) * dstdev[i / D] + 1.0f / D * dmean[i / D];
-  }
-}
-
-#define PRINT(X, N, D) printTensor<<<1, 1, 0, context_.cuda_stream()>>>(X, N, D)
-
-} // namespace
-
 template <>
 template <>
 bool LayerNormGradientOp<CUDAContext>::DoRunWithType<float>() {
   const auto& dout = Input(0);
-  const auto& norm_outputs = Input(1);
   const auto& means = Input(2);
   const auto& stdev = Input(3);
   const auto& norm_inputs = Input(4);
   auto* ginput = Output(0);
 
   const auto canonical_axis = norm_inputs.canonical_axis_index(axis_);
-  const unsigned long left = norm_inputs.size_to_dim(canonical_axis);
-  const unsigned long right = norm_inputs.size_from_dim(canonical_axis);
+  const int left = norm_inputs.size_to_dim(canonical_axis);
+  const int right = norm_inputs.size_from_dim(canonical_axis);
 
   ginput->ResizeLike(norm_inputs);
-  std::vector<TIndex> stats_dims(
-      norm_inputs.dims().begin(), norm_inputs.dims().begin() + canonical_axis);
-  stats_dims.push_back(1);
-  dmean_.Resize(stats_dims);
-  dstdev_.Resize(stats_dims);
-  gscratch_.Resize(std::vector<size_t>{left, right});
-
-  std::vector<int> segs(left + 1);
-  std::iota(segs.begin(), segs.end(), 0);
-  std::transform(
-      segs.begin(),
-      segs.end(),
-      segs.begin(),
-      std::bind1st(std::multiplies<int>(), right));
-
-  seg_indices_.Resize(vector<size_t>{segs.size()});
-  context_.CopyBytes<CPUContext, CUDAContext>(
-      sizeof(int) * segs.size(),
-      static_cast<void*>(segs.data()),
-      static_cast<void*>(seg_indices_.mutable_data<int>()));
+  if (left == 0) {
+    ginput->mutable_data<float>();
+    return true;
+  }
 
-  // Calculate gradient of the standard deviation
-  // temp1 = (x - mean) * dout
-  zTimesXminusYbroadcast<<<
-      CAFFE_GET_BLOCKS(left * right),
+  LayerNormBackwardKernel<<<
+      std::min(left, CAFFE_MAXIMUM_NUM_BLOCKS),
       CAFFE_CUDA_NUM_THREADS,
       0,
       context_.cuda_stream()>>>(
       left,
       right,
-      norm_inputs.data<float>(),
-      means.data<float>(),
-      dout.data<float>(),
-      gscratch_.mutable_data<float>());
-
-  dstdev_.Resize(vector<size_t>{left, 1});
-  // dstdev = reduce(temp1)
-  allocScratchAndReduce(
-      gscratch_.data<float>(),
-      dstdev_.mutable_data<float>(),
-      left,
-      seg_indices_.mutable_data<int>(),
-      &scratch_,
-      context_.cuda_stream());
-  // dstdev = -dstdev / sqrt(stdev)
-  normalizeByNegStdev<<<
-      CAFFE_GET_BLOCKS(left),
-      CAFFE_CUDA_NUM_THREADS,
-      0,
-      context_.cuda_stream()>>>(
-      left,
-      true,
-      dstdev_.data<float>(),
-      stdev.data<float>(),
-      dstdev_.mutable_data<float>());
-
-  // Calculate gradient of the mean
-  // dmean = reduce(dout)
-  allocScratchAndReduce(
       dout.data<float>(),
-      dmean_.mutable_data<float>(),
-      left,
-      seg_indices_.mutable_data<int>(),
-      &scratch_,
-      context_.cuda_stream());
-  // mean * stdev
-  math::Mul(
-      left,
+      norm_inputs.data<float>(),
       means.data<float>(),
-      dstdev_.data<float>(),
-      gscratch_.mutable_data<float>(),
-      &context_);
-  // [\sum dout] + mean * stdev
-  math::Add(
-      left,
-      dmean_.data<float>(),
-      gscratch_.data<float>(),
-      dmean_.mutable_data<float>(),
-      &context_);
-  // -1 / std * [[\sum dout] + mean * stdev]
-  normalizeByNegStdev<<<
-      CAFFE_GET_BLOCKS(left),
-      CAFFE_CUDA_NUM_THREADS,
-      0,
-      context_.cuda_stream()>>>(
-      left,
-      false,
-      dmean_.data<float>(),
-      stdev.data<float>(),
-      dmean_.mutable_data<float>());
-
-  // Calculate gradient of input
-  gradientMegaKernel<<<
-      CAFFE_GET_BLOCKS(left),
-      CAFFE_CUDA_NUM_THREADS,
-      0,
-      context_.cuda_stream()>>>(
-      left,
-      right,
       stdev.data<float>(),
-      norm_inputs.data<float>(),
-      dstdev_.data<float>(),
-      dmean_.data<float>(),
-      dout.data<float>(),
       ginput->mutable_data<float>());
 
   return true;
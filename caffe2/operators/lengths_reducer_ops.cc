@@ -27,12 +27,63 @@ namespace caffe2 {
 
 REGISTER_CPU_OPERATOR_STR(
     "SparseLengthsSum",
-    CPUSparseLengthsReductionOp<float, TensorTypes<float, float16>, 0, 0>);
+    CPUSparseLengthsReductionOp<
+        float,
+        TensorTypes<float, float16, bfloat16>,
+        0,
+        0>);
 REGISTER_CPU_OPERATOR_STR(
     "SparseLengthsWeightedSum",
-    CPUSparseLengthsReductionOp<float, TensorTypes<float, float16>, 1, 0>);
+    CPUSparseLengthsReductionOp<
+        float,
+        TensorTypes<float, float16, bfloat16>,
+        1,
+        0>);
 REGISTER_CPU_OPERATOR_STR(
     "SparseLengthsMean",
-    CPUSparseLengthsReductionOp<float, TensorTypes<float, float16>, 0, 1>);
+    CPUSparseLengthsReductionOp<
+        float,
+        TensorTypes<float, float16, bfloat16>,
+        0,
+        1>);
+
+REGISTER_CPU_OPERATOR(
+    MultiTableSparseLengthsSum,
+    CPUMultiTableSparseLengthsSumOp);
+
+OPERATOR_SCHEMA(MultiTableSparseLengthsSum)
+    .NumInputs([](int n) { return n > 0 && n % 3 == 0; })
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Computes SparseLengthsSum for several embedding tables in one operator. The
+inputs are N (DATA, INDICES, LENGTHS) triples, one per table, with the same
+meaning as in SparseLengthsSum. All LENGTHS vectors must have the same size M,
+i.e. every table is pooled over the same segments. The output is an M x
+(D_1 + ... + D_N) matrix where D_i is the row size of the i-th DATA, holding
+the pooled results of the tables side by side, which is the same as running
+SparseLengthsSum on every table and concatenating the results along axis 1.
+
+DATA can be float, float16 or bfloat16 and INDICES int32 or int64,
+independently for every table. With num_threads > 1 different tables are pooled in parallel.
+)DOC")
+    .Arg(
+        "num_threads",
+        "Number of threads the tables are split over. The tables are divided "
+        "into up to num_threads contiguous groups with about the same number "
+        "of INDICES and the groups run on the workspace thread pool. "
+        "Defaults to 1.")
+    .Input(0, "DATA_1", "Embedding table of the first table")
+    .Input(1, "INDICES_1", "Integer vector of row indices into DATA_1")
+    .Input(
+        2,
+        "LENGTHS_1",
+        "Vector of segment lengths for INDICES_1, sums to the size of "
+        "INDICES_1. Followed by the triples of the remaining tables.")
+    .Output(
+        0,
+        "OUTPUT",
+        "M x (D_1 + ... + D_N) matrix of the per-table segment sums");
+
+NO_GRADIENT(MultiTableSparseLengthsSum);
 
 } // namespace caffe2
@@ -15,9 +15,15 @@
  */
 
 #pragma once
+
+#include <algorithm>
+#include <vector>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/perfkernels/embedding_lookup.h"
+#include "caffe2/utils/math.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
@@ -32,15 +38,18 @@ class CPUSparseLengthsReductionOp : public Operator<CPUContext> {
  public:
   USE_OPERATOR_FUNCTIONS(CPUContext);
   CPUSparseLengthsReductionOp(const OperatorDef& operator_def, Workspace* ws)
-      : Operator<CPUContext>(operator_def, ws) {
+      : Operator<CPUContext>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
     static_assert(
         !(USE_WEIGHT & USE_MEAN), "Cannot both specify weight and mean.");
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
   }
 
   ~CPUSparseLengthsReductionOp() {}
 
-  // Currently, we support float and float16 inputs for input data type, and
-  // int32_t and int64_t for the index type.
+  // Currently, we support float, float16 and bfloat16 inputs for input data
+  // type, and int32_t and int64_t for the index type.
 
   bool RunOnDevice() override {
     return DispatchHelper<InputTypes>::call(this, Input(DATA));
@@ -86,23 +95,76 @@ class CPUSparseLengthsReductionOp : public Operator<CPUContext> {
       in_weight = weightInput.template data<T>();
     }
 
-    // delegate work to perfkernel that branches based on architecture
-    EmbeddingLookup(
-        D,
-        M,
+    // Reduces the segments [segment_begin, segment_end), whose indices are
+    // [index_begin, index_end).
+    auto reduce = [&](TIndex segment_begin,
+                      TIndex segment_end,
+                      TIndex index_begin,
+                      TIndex index_end) {
+      // delegate work to perfkernel that branches based on architecture
+      EmbeddingLookup(
+          D,
+          segment_end - segment_begin,
+          index_end - index_begin,
+          N,
+          in_data,
+          indices + index_begin,
+          lengths + segment_begin,
+          in_weight ? in_weight + index_begin : nullptr,
+          nullptr, // scale_bias is only used in SparseLengths8BitsRowwiseOp
+          USE_MEAN,
+          out_data + segment_begin * D);
+    };
+
+    const TIndex num_chunks = std::min<TIndex>(
+        std::min<TIndex>(num_threads_, M), indices_size / kMinIndicesPerChunk);
+    if (num_chunks <= 1) {
+      reduce(0, M, 0, indices_size);
+      return true;
+    }
+
+    // Split the segments into chunks that hold roughly the same number of
+    // indices, using the running sum of the lengths.
+    std::vector<TIndex> segment_starts(num_chunks + 1, M);
+    std::vector<TIndex> index_starts(num_chunks + 1, indices_size);
+    segment_starts[0] = 0;
+    index_starts[0] = 0;
+    TIndex chunk = 1;
+    TIndex total = 0;
+    for (TIndex i = 0; i < M; ++i) {
+      if (chunk < num_chunks && total >= chunk * indices_size / num_chunks) {
+        segment_starts[chunk] = i;
+        index_starts[chunk] = total;
+        ++chunk;
+      }
+      CAFFE_ENFORCE_GE(lengths[i], 0, "LENGTHS must be non-negative");
+      total += lengths[i];
+    }
+    CAFFE_ENFORCE_EQ(
+        total,
         indices_size,
-        N,
-        in_data,
-        indices,
-        lengths,
-        in_weight,
-        nullptr, // scale_bias field is only used in SparseLengths8BitsRowwiseOp
-        USE_MEAN,
-        out_data);
+        "Your input seems to be incorrect: the sum of lengths values should be "
+        "the size of the indices tensor, but it appears not.");
+
+    ws_->GetThreadPool()->runChunks(
+        [&](int /* unused */, size_t c) {
+          reduce(
+              segment_starts[c],
+              segment_starts[c + 1],
+              index_starts[c],
+              index_starts[c + 1]);
+        },
+        num_chunks);
     return true;
   }
 
  private:
+  // Fewer indices than this per thread are not worth the dispatch overhead.
+  static constexpr TIndex kMinIndicesPerChunk = 512;
+
+  const int num_threads_;
+  Workspace* ws_;
+
   enum {
     DATA = 0, // Data input.
     WEIGHT = 1, // Weight input used in SparseLengthsWeightedSum
@@ -113,4 +175,173 @@ class CPUSparseLengthsReductionOp : public Operator<CPUContext> {
   };
 };
 
+// SparseLengthsSum over several tables at once. The inputs are (DATA,
+// INDICES, LENGTHS) triples that all have the same number of segments, and the
+// per-table results are written side by side into a single output, as if they
+// had been concatenated along axis 1.
+class CPUMultiTableSparseLengthsSumOp : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  CPUMultiTableSparseLengthsSumOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GT(InputSize(), 0);
+    CAFFE_ENFORCE_EQ(
+        InputSize() % 3, 0, "Inputs must be (DATA, INDICES, LENGTHS) triples");
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+
+  bool RunOnDevice() override {
+    const int num_tables = InputSize() / 3;
+    const TIndex M = Input(LENGTHS).dim(0);
+    column_offsets_.resize(num_tables + 1);
+    column_offsets_[0] = 0;
+    // Number of indices of the tables before the current one.
+    std::vector<TIndex> index_offsets(num_tables + 1, 0);
+    for (int t = 0; t < num_tables; ++t) {
+      const auto& data = Input(3 * t + DATA);
+      const auto& indices = Input(3 * t + INDICES);
+      const auto& lengths = Input(3 * t + LENGTHS);
+      CAFFE_ENFORCE_GE(data.ndim(), 1, "DATA of table ", t, " is a scalar");
+      CAFFE_ENFORCE_EQ(
+          1, indices.ndim(), "INDICES of table ", t, " must be a vector");
+      CAFFE_ENFORCE_EQ(
+          1, lengths.ndim(), "LENGTHS of table ", t, " must be a vector");
+      CAFFE_ENFORCE_EQ(
+          M,
+          lengths.dim(0),
+          "All tables must have the same number of segments, table ",
+          t,
+          " differs");
+      column_offsets_[t + 1] = column_offsets_[t] + data.size_from_dim(1);
+      index_offsets[t + 1] = index_offsets[t] + indices.size();
+    }
+
+    auto* output = Output(0);
+    output->Resize(M, column_offsets_[num_tables]);
+    float* out_data = output->template mutable_data<float>();
+
+    // Balance the tables over the threads by their number of indices.
+    const TIndex total_indices = index_offsets[num_tables];
+    const int num_chunks = std::min<TIndex>(
+        std::min<TIndex>(num_threads_, num_tables),
+        std::max<TIndex>(total_indices / kMinIndicesPerChunk, 1));
+    std::vector<int> table_starts(num_chunks + 1, num_tables);
+    table_starts[0] = 0;
+    int chunk = 1;
+    for (int t = 0; t < num_tables && chunk < num_chunks; ++t) {
+      if (index_offsets[t] >= chunk * total_indices / num_chunks && t > 0) {
+        table_starts[chunk++] = t;
+      }
+    }
+    scratch_.resize(num_chunks);
+    auto reduce_chunk = [&](size_t c) {
+      for (int t = table_starts[c]; t < table_starts[c + 1]; ++t) {
+        ReduceTable(t, out_data, &scratch_[c]);
+      }
+    };
+    if (num_chunks == 1) {
+      reduce_chunk(0);
+    } else {
+      ws_->GetThreadPool()->runChunks(
+          [&](int /* unused */, size_t c) { reduce_chunk(c); }, num_chunks);
+    }
+    return true;
+  }
+
+ private:
+  void ReduceTable(int table, float* out_data, std::vector<float>* scratch) {
+    const auto& data = Input(3 * table + DATA);
+    const auto& indices = Input(3 * table + INDICES);
+    if (data.IsType<float>()) {
+      ReduceTableWithType<float>(table, out_data, scratch, indices);
+    } else if (data.IsType<float16>()) {
+      ReduceTableWithType<float16>(table, out_data, scratch, indices);
+    } else if (data.IsType<bfloat16>()) {
+      ReduceTableWithType<bfloat16>(table, out_data, scratch, indices);
+    } else {
+      CAFFE_THROW(
+          "Unsupported DATA type of table ", table, ": ", data.meta().name());
+    }
+  }
+
+  template <typename InType>
+  void ReduceTableWithType(
+      int table,
+      float* out_data,
+      std::vector<float>* scratch,
+      const TensorCPU& indices) {
+    if (indices.IsType<int32_t>()) {
+      ReduceTableWithType2<InType, int32_t>(table, out_data, scratch);
+    } else if (indices.IsType<int64_t>()) {
+      ReduceTableWithType2<InType, int64_t>(table, out_data, scratch);
+    } else {
+      CAFFE_THROW(
+          "Unsupported INDICES type of table ",
+          table,
+          ": ",
+          indices.meta().name());
+    }
+  }
+
+  template <typename InType, typename IndexType>
+  void ReduceTableWithType2(
+      int table,
+      float* out_data,
+      std::vector<float>* scratch) {
+    const auto& data = Input(3 * table + DATA);
+    const auto& indices = Input(3 * table + INDICES);
+    const auto& lengths = Input(3 * table + LENGTHS);
+    const TIndex M = lengths.dim(0);
+    const TIndex D = data.size_from_dim(1);
+    const TIndex width = column_offsets_.back();
+
+    // The kernel writes contiguous rows, so tables that only fill part of an
+    // output row are reduced into the scratch buffer first.
+    float* out = out_data;
+    if (D != width) {
+      scratch->resize(M * D);
+      out = scratch->data();
+    }
+    EmbeddingLookup(
+        D,
+        M,
+        indices.size(),
+        data.dim(0),
+        data.template data<InType>(),
+        indices.template data<IndexType>(),
+        lengths.template data<int>(),
+        nullptr,
+        nullptr,
+        false,
+        out);
+    if (D != width) {
+      math::CopyMatrix<CPUContext>(
+          sizeof(float),
+          M,
+          D,
+          out,
+          D,
+          out_data + column_offsets_[table],
+          width,
+          &context_);
+    }
+  }
+
+  // Fewer indices than this per thread are not worth the dispatch overhead.
+  static constexpr TIndex kMinIndicesPerChunk = 512;
+
+  enum { DATA = 0, INDICES = 1, LENGTHS = 2 };
+
+  const int num_threads_;
+  Workspace* ws_;
+  // Column of the output at which each table starts, plus the output width.
+  std::vector<TIndex> column_offsets_;
+  // Per chunk buffers for the tables that do not fill whole output rows.
+  std::vector<std::vector<float>> scratch_;
+};
+
 } // namespace caffe2
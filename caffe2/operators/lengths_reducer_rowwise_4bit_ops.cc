@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/lengths_reducer_rowwise_4bit_ops.h"
+
+namespace caffe2 {
+
+REGISTER_CPU_OPERATOR(
+    FloatToRowwiseQuantized4Bits,
+    FloatToRowwiseQuantized4BitsOp<CPUContext>);
+REGISTER_CPU_OPERATOR(
+    Rowwise4BitQuantizedToFloat,
+    Rowwise4BitQuantizedToFloatOp<CPUContext>);
+REGISTER_CPU_OPERATOR(
+    SparseLengthsSum4BitsRowwise,
+    SparseLengths4BitsRowwiseOp<CPUContext>);
+REGISTER_CPU_OPERATOR(
+    SparseLengthsWeightedSum4BitsRowwise,
+    SparseLengths4BitsRowwiseOp<CPUContext, 1>);
+REGISTER_CPU_OPERATOR(
+    SparseLengthsMean4BitsRowwise,
+    SparseLengths4BitsRowwiseOp<CPUContext, 0, 1>);
+
+OPERATOR_SCHEMA(FloatToRowwiseQuantized4Bits)
+    .NumInputs(1)
+    .NumOutputs(2)
+    .SetDoc(R"DOC(
+Like FloatToRowwiseQuantized8Bits, but quantizes every row of the input,
+reshaped to a matrix, to 16 levels between its min and max and packs two
+values per byte, the even column in the low nibble. The rows must have an even
+number of columns; the packed output has half as many.
+)DOC")
+    .Input(0, "input", "input")
+    .Output(0, "quantized_input", "uint8 matrix of packed 4-bit values")
+    .Output(
+        1,
+        "scale_bias",
+        "Matrix of floats, each row r_i of which stores a pair "
+        "s_i, b_i");
+
+OPERATOR_SCHEMA(Rowwise4BitQuantizedToFloat)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Restores the float matrix from the output of FloatToRowwiseQuantized4Bits,
+computing q_ij * s_i + b_i for every 4-bit value q_ij.
+)DOC")
+    .Input(0, "quantized_input", "uint8 matrix of packed 4-bit values")
+    .Input(1, "scale_bias", "Matrix of floats, scale and bias of each row")
+    .Output(0, "output", "output");
+
+OPERATOR_SCHEMA(SparseLengthsSum4BitsRowwise)
+    .NumInputs(4)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Variation of SparseLengthsSum where DATA is stored with 4 bits per value, see
+FloatToRowwiseQuantized4Bits.
+)DOC")
+    .Input(0, "DATA", "uint8 matrix of packed 4-bit values")
+    .Input(1, "INDICES", "Integer vector of the rows of DATA to aggregate")
+    .Input(2, "LENGTHS", "Vector of segment lengths summing to len(INDICES)")
+    .Input(3, "scale_bias", "Matrix of floats, scale and bias of each row")
+    .Output(0, "output", "output");
+
+OPERATOR_SCHEMA(SparseLengthsWeightedSum4BitsRowwise)
+    .NumInputs(5)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Variation of SparseLengthsWeightedSum where DATA is stored with 4 bits per
+value, see FloatToRowwiseQuantized4Bits.
+)DOC")
+    .Input(0, "DATA", "uint8 matrix of packed 4-bit values")
+    .Input(1, "SCALARS", "Scalar multipliers, one per entry of INDICES")
+    .Input(2, "INDICES", "Integer vector of the rows of DATA to aggregate")
+    .Input(3, "LENGTHS", "Vector of segment lengths summing to len(INDICES)")
+    .Input(4, "scale_bias", "Matrix of floats, scale and bias of each row")
+    .Output(0, "output", "output");
+
+OPERATOR_SCHEMA(SparseLengthsMean4BitsRowwise)
+    .NumInputs(4)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Variation of SparseLengthsMean where DATA is stored with 4 bits per value, see
+FloatToRowwiseQuantized4Bits.
+)DOC")
+    .Input(0, "DATA", "uint8 matrix of packed 4-bit values")
+    .Input(1, "INDICES", "Integer vector of the rows of DATA to aggregate")
+    .Input(2, "LENGTHS", "Vector of segment lengths summing to len(INDICES)")
+    .Input(3, "scale_bias", "Matrix of floats, scale and bias of each row")
+    .Output(0, "output", "output");
+
+NO_GRADIENT(FloatToRowwiseQuantized4Bits);
+NO_GRADIENT(Rowwise4BitQuantizedToFloat);
+NO_GRADIENT(SparseLengthsSum4BitsRowwise);
+NO_GRADIENT(SparseLengthsWeightedSum4BitsRowwise);
+NO_GRADIENT(SparseLengthsMean4BitsRowwise);
+
+} // namespace caffe2
@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_LENGTHS_REDUCER_ROWWISE_4BIT_OPS_H_
+#define CAFFE2_OPERATORS_LENGTHS_REDUCER_ROWWISE_4BIT_OPS_H_
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/lengths_reducer_rowwise_8bit_ops.h"
+
+namespace caffe2 {
+
+// The 4-bit counterparts of the 8-bit row-wise quantization operators. Each
+// row is quantized to 16 levels between its min and max, and two values are
+// packed per byte, the even column in the low nibble. The rows must therefore
+// have an even number of columns, and the packed tensor has half as many.
+
+template <class Context>
+class FloatToRowwiseQuantized4BitsOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(FloatToRowwiseQuantized4BitsOp);
+
+  bool RunOnDevice() override {
+    auto& input = Input(DATA_FLOAT);
+    auto* output = Output(DATA_UINT8);
+    auto* scale_bias = Output(SCALE_BIAS);
+    CAFFE_ENFORCE_GE(input.ndim(), 2);
+    const TIndex n_blocks = input.dim(0);
+    const TIndex block_size = input.size_from_dim(1);
+    CAFFE_ENFORCE_EQ(
+        block_size % 2, 0, "4-bit quantization needs an even row size");
+    output->Resize(n_blocks, block_size / 2);
+    scale_bias->Resize(n_blocks, 2);
+    const float* input_data = input.template data<float>();
+    auto* output_data = output->template mutable_data<uint8_t>();
+    float* scale_bias_data = scale_bias->template mutable_data<float>();
+    row_.resize(block_size);
+    for (TIndex i = 0; i < n_blocks; ++i) {
+      QuantizeRowwise<Rowwise4BitLevels>(
+          input_data + i * block_size,
+          block_size,
+          row_.data(),
+          scale_bias_data + 2 * i,
+          nullptr);
+      uint8_t* out = output_data + i * block_size / 2;
+      for (TIndex j = 0; j < block_size / 2; ++j) {
+        out[j] = row_[2 * j] | (row_[2 * j + 1] << 4);
+      }
+    }
+    return true;
+  }
+
+ private:
+  vector<uint8_t> row_;
+  INPUT_TAGS(DATA_FLOAT);
+  OUTPUT_TAGS(DATA_UINT8, SCALE_BIAS);
+};
+
+template <class Context>
+class Rowwise4BitQuantizedToFloatOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(Rowwise4BitQuantizedToFloatOp);
+
+  bool RunOnDevice() override {
+    auto& input = Input(DATA_UINT8);
+    auto& scale_bias = Input(SCALE_BIAS);
+    auto* output = Output(DATA_FLOAT);
+    CAFFE_ENFORCE_EQ(2, input.ndim(), "packed data has to be a matrix");
+    CAFFE_ENFORCE_EQ(2, scale_bias.ndim(), "scale_bias has to be matrix");
+    CAFFE_ENFORCE_EQ(input.dim(0), scale_bias.dim(0));
+    CAFFE_ENFORCE_EQ(2, scale_bias.dim(1));
+    const TIndex n_blocks = input.dim(0);
+    const TIndex packed_size = input.dim(1);
+    output->Resize(n_blocks, 2 * packed_size);
+    const uint8_t* input_data = input.template data<uint8_t>();
+    const float* scale_bias_data = scale_bias.template data<float>();
+    float* output_data = output->template mutable_data<float>();
+    for (TIndex i = 0; i < n_blocks; ++i) {
+      const uint8_t* in = input_data + i * packed_size;
+      const float scale = scale_bias_data[2 * i];
+      const float bias = scale_bias_data[2 * i + 1];
+      float* out = output_data + i * 2 * packed_size;
+      for (TIndex j = 0; j < packed_size; ++j) {
+        out[2 * j] = (in[j] & 0xf) * scale + bias;
+        out[2 * j + 1] = (in[j] >> 4) * scale + bias;
+      }
+    }
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(DATA_UINT8, SCALE_BIAS);
+  OUTPUT_TAGS(DATA_FLOAT);
+};
+
+template <class Context, bool USE_WEIGHTS = 0, bool USE_MEAN = 0>
+class SparseLengths4BitsRowwiseOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(SparseLengths4BitsRowwiseOp);
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    auto& data = Input(DATA);
+    auto& indices_input = Input(INDICES);
+    auto& lengths_input = Input(LENGTHS);
+    auto& scale_bias = Input(SCALE_BIAS);
+    auto* output = Output(0);
+    CAFFE_ENFORCE_EQ(2, data.ndim(), "packed data has to be a matrix");
+    CAFFE_ENFORCE_EQ(1, indices_input.ndim(), "INDICES must be a vector");
+    CAFFE_ENFORCE_EQ(1, lengths_input.ndim(), "LENGTHS must be a vector");
+    CAFFE_ENFORCE_EQ(2, scale_bias.ndim(), "scale_bias has to be matrix");
+    CAFFE_ENFORCE_EQ(data.dim(0), scale_bias.dim(0));
+    CAFFE_ENFORCE_EQ(2, scale_bias.dim(1));
+
+    const TIndex rows = data.dim(0);
+    const TIndex packed_size = data.dim(1);
+    const TIndex num_segments = lengths_input.dim(0);
+    output->Resize(num_segments, 2 * packed_size);
+    const uint8_t* data_ptr = data.template data<uint8_t>();
+    const float* scale_bias_data = scale_bias.template data<float>();
+    const IndexType* indices = indices_input.template data<IndexType>();
+    const int* lengths = lengths_input.template data<int>();
+    const float* weights =
+        USE_WEIGHTS ? Input(WEIGHTS).template data<float>() : nullptr;
+    float* out = output->template mutable_data<float>();
+    std::fill(out, out + output->size(), 0.0f);
+
+    TIndex current = 0;
+    for (TIndex s = 0; s < num_segments; ++s) {
+      float* out_row = out + s * 2 * packed_size;
+      CAFFE_ENFORCE_LE(current + lengths[s], indices_input.size());
+      for (int k = 0; k < lengths[s]; ++k, ++current) {
+        const IndexType idx = indices[current];
+        CAFFE_ENFORCE(
+            0 <= idx && idx < rows,
+            "Index ",
+            current,
+            " is out of bounds: ",
+            idx,
+            ", range 0 to ",
+            rows);
+        float w = weights ? weights[current] : 1.0f;
+        if (USE_MEAN && lengths[s]) {
+          w /= lengths[s];
+        }
+        const float scale = w * scale_bias_data[2 * idx];
+        const float bias = w * scale_bias_data[2 * idx + 1];
+        const uint8_t* in = data_ptr + idx * packed_size;
+        for (TIndex j = 0; j < packed_size; ++j) {
+          out_row[2 * j] += (in[j] & 0xf) * scale + bias;
+          out_row[2 * j + 1] += (in[j] >> 4) * scale + bias;
+        }
+      }
+    }
+    CAFFE_ENFORCE_EQ(
+        current, indices_input.size(), "LENGTHS must sum to the INDICES size");
+    return true;
+  }
+
+  enum {
+    DATA = 0,
+    WEIGHTS = 1,
+    INDICES = 1 + USE_WEIGHTS,
+    LENGTHS = 2 + USE_WEIGHTS,
+    SCALE_BIAS = 3 + USE_WEIGHTS
+  };
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_LENGTHS_REDUCER_ROWWISE_4BIT_OPS_H_
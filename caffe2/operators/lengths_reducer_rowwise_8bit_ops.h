@@ -19,6 +19,11 @@
 #define CAFFE2_OPERATORS_LENGTHS_REDUCER_ROWWISE_8bits_OP_H_
 // SparseLengthsSum8bits
 
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <type_traits>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
@@ -32,6 +37,54 @@ namespace {
 const float kEqualityThreshold = 1e-10;
 }
 
+// Quantizes one row of N floats like FloatToRowwiseQuantized8Bits, writing the
+// (scale, bias) pair of the row to scale_bias. With a random generator, values
+// are rounded stochastically, up with a probability equal to their fractional
+// part, so that repeated requantization of a row that is being trained stays
+// unbiased instead of drifting towards the nearest level.
+template <typename Levels>
+inline void QuantizeRowwise(
+    const float* in,
+    size_t N,
+    std::uint8_t* out,
+    float* scale_bias,
+    std::mt19937* rng) {
+  float min_element = N ? in[0] : 0;
+  float max_element = min_element;
+  for (size_t j = 1; j < N; ++j) {
+    min_element = std::min(min_element, in[j]);
+    max_element = std::max(max_element, in[j]);
+  }
+  scale_bias[1] = min_element;
+  if (max_element - min_element < kEqualityThreshold) {
+    scale_bias[0] = 1.0f;
+    std::fill(out, out + N, 0);
+    return;
+  }
+  scale_bias[0] = (max_element - min_element) / Levels::value;
+  const float inv_scale = 1.0f / scale_bias[0];
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  for (size_t j = 0; j < N; ++j) {
+    const float v = (in[j] - min_element) * inv_scale;
+    const float q = rng ? std::floor(v + uniform(*rng)) : std::round(v);
+    out[j] = static_cast<std::uint8_t>(
+        std::min<float>(Levels::value, std::max(0.0f, q)));
+  }
+}
+
+inline void DequantizeRowwise(
+    const std::uint8_t* in,
+    size_t N,
+    const float* scale_bias,
+    float* out) {
+  for (size_t j = 0; j < N; ++j) {
+    out[j] = in[j] * scale_bias[0] + scale_bias[1];
+  }
+}
+
+using Rowwise8BitLevels = std::integral_constant<int, 255>;
+using Rowwise4BitLevels = std::integral_constant<int, 15>;
+
 template <
     class Context,
     bool USE_WEIGHTS = 0,
@@ -16,6 +16,8 @@
 
 #include "caffe2/operators/lengths_top_k_op.h"
 
+#include <queue>
+
 namespace caffe2 {
 
 template <typename T, class Context>
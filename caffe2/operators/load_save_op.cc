@@ -25,6 +25,74 @@ void LoadOp<CPUContext>::SetCurrentDevice(BlobProto* proto) {
   }
 }
 
+CAFFE_KNOWN_TYPE(AsyncSaveHandle);
+
+void WriteSaveSnapshot(
+    const SaveSnapshot& snapshot,
+    const string& db_type,
+    const string& db_name) {
+  if (db_type == kMmapTensorFileType) {
+    std::vector<std::pair<string, const TensorCPU*>> tensors;
+    for (const auto& tensor : snapshot.tensors) {
+      tensors.emplace_back(tensor.first, &tensor.second->Get<TensorCPU>());
+    }
+    WriteMmapTensorFile(db_name, tensors);
+    return;
+  }
+  std::unique_ptr<DB> out_db(
+      caffe2::db::CreateDB(db_type, db_name, caffe2::db::NEW));
+  CAFFE_ENFORCE(out_db.get(), "Cannot open db for writing: ", db_name);
+  BlobSerializerBase::SerializationAcceptor acceptor = [&](
+      const std::string& blobName, const std::string& data) {
+    // transaction should take care of locking
+    auto transaction = out_db->NewTransaction();
+    transaction->Put(blobName, data);
+    transaction->Commit();
+  };
+  for (const auto& serialized : snapshot.serialized) {
+    acceptor(serialized.first, serialized.second);
+  }
+  for (const auto& tensor : snapshot.tensors) {
+    tensor.second->Serialize(tensor.first, acceptor);
+  }
+  out_db->Close();
+}
+
+namespace {
+
+// Waits for, or polls, a Save started with async=1.
+class WaitAsyncSaveOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  WaitAsyncSaveOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        block_(OperatorBase::GetSingleArgument<int>("block", 1)) {}
+
+  bool RunOnDevice() override {
+    // The handle is not const: waiting consumes the result of the save.
+    auto* handle = OperatorBase::Output<AsyncSaveHandle>(0);
+    CAFFE_ENFORCE(
+        handle == &OperatorBase::Input<AsyncSaveHandle>(0),
+        "WaitAsyncSave has to run in place on the handle.");
+    const bool done = block_ || handle->Done();
+    if (done) {
+      handle->Wait();
+    }
+    if (OutputSize() > 1) {
+      auto* done_tensor = Output(1);
+      done_tensor->Resize();
+      *done_tensor->mutable_data<bool>() = done;
+    }
+    return true;
+  }
+
+ private:
+  bool block_;
+};
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(WaitAsyncSave, WaitAsyncSaveOp);
 REGISTER_CPU_OPERATOR(DBExists, DBExistsOp<CPUContext>);
 REGISTER_CPU_OPERATOR(Load, LoadOp<CPUContext>);
 REGISTER_CPU_OPERATOR(Save, SaveOp<CPUContext>);
@@ -57,6 +125,12 @@ entries with the outputs.
 If an input is passed, then it is assumed that that input blob is a
 DBReader to load from, and we ignore the db and db_type arguments.
 
+With db_type "mmap" the db is a single file written by Save with the same
+db_type. It is mapped into memory copy-on-write and the loaded CPU tensors
+point into the mapping instead of being deserialized, so loading takes no time
+and no extra memory regardless of the model size, and processes loading the
+same file share its pages.
+
 )DOC")
     .Arg(
         "absolute_path",
@@ -96,11 +170,22 @@ DBReader to load from, and we ignore the db and db_type arguments.
 
 OPERATOR_SCHEMA(Save)
     .NumInputs(1, INT_MAX)
-    .NumOutputs(0)
+    .NumOutputs(0, 1)
     .SetDoc(R"DOC(
 The Save operator saves a set of blobs to a db. It takes [1, infinity) number
 of inputs and has no output. The contents of the inputs are written into the
 db specified by the arguments.
+
+With db_type "mmap" the inputs, which have to be CPU tensors of fundamental
+types, are written as raw aligned byte ranges into a single file that Load can
+map into memory, see caffe2/core/mmap_tensor_file.h.
+
+With async=1 the op only takes a snapshot of the inputs, copying the CPU
+tensors, and writes it to the db on a background thread, so that the net can
+go on changing the inputs while they are written. Such a Save has one output,
+a handle to pass to WaitAsyncSave, which waits for the save to finish, or
+polls it. A save started through a handle that is still busy first waits for
+the previous one.
 )DOC")
     .Arg(
         "absolute_path",
@@ -117,7 +202,26 @@ db specified by the arguments.
         "(list of strings) if set, used instead of original "
         "blob names. Must be the same length as number of blobs.")
     .Arg("db", "(string) the path to the db to load.")
-    .Arg("db_type", "(string) the type of the db.");
+    .Arg("db_type", "(string) the type of the db.")
+    .Arg(
+        "async",
+        "(int, default 0) if set, write a snapshot of the inputs in the "
+        "background, see above.")
+    .Output(0, "handle", "(Only with async=1) handle of the running save");
+
+OPERATOR_SCHEMA(WaitAsyncSave)
+    .NumInputs(1)
+    .NumOutputs(1, 2)
+    .EnforceInplace({{0, 0}})
+    .SetDoc(R"DOC(
+Waits for a Save started with async=1 to finish, and fails if the save
+failed. With block=0 it only checks whether the save is done, and waits for
+it, to report its errors, only if it is.
+)DOC")
+    .Arg("block", "(int, default 1) whether to wait for the save")
+    .Input(0, "handle", "The handle output by Save")
+    .Output(0, "handle", "Same as the input")
+    .Output(1, "done", "(Optional) scalar bool, whether the save is done");
 
 OPERATOR_SCHEMA(Checkpoint)
     .NumInputs(1, INT_MAX)
@@ -149,6 +253,7 @@ OPERATOR_SCHEMA(Snapshot);
 NO_GRADIENT(Load);
 SHOULD_NOT_DO_GRADIENT(DBExists);
 SHOULD_NOT_DO_GRADIENT(Save);
+SHOULD_NOT_DO_GRADIENT(WaitAsyncSave);
 SHOULD_NOT_DO_GRADIENT(Checkpoint);
 SHOULD_NOT_DO_GRADIENT(Snapshot);
 }  // namespace caffe2
@@ -17,17 +17,27 @@
 #ifndef CAFFE2_OPERATORS_LOAD_SAVE_OP_H_
 #define CAFFE2_OPERATORS_LOAD_SAVE_OP_H_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <exception>
+#include <functional>
+#include <future>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <unordered_set>
 
 #include "caffe2/core/blob_serialization.h"
 #include "caffe2/core/context.h"
 #include "caffe2/core/db.h"
 #include "caffe2/core/logging.h"
+#include "caffe2/core/mmap_tensor_file.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/utils/math.h"
 #include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/simple_queue.h"
 
 namespace caffe2 {
 
@@ -71,7 +81,11 @@ class DBExistsOp final : public Operator<Context> {
     output->Resize();
     bool* exists = output->template mutable_data<bool>();
 
-    *exists = caffe2::db::DBExists(db_type_, full_db_name);
+    if (db_type_ == kMmapTensorFileType) {
+      *exists = IsMmapTensorFile(full_db_name);
+    } else {
+      *exists = caffe2::db::DBExists(db_type_, full_db_name);
+    }
     return true;
   }
 
@@ -137,6 +151,9 @@ class LoadOp final : public Operator<Context> {
     if (InputSize() == 1) {
       const db::DBReader& reader = OperatorBase::Input<db::DBReader>(0);
       extract(reader.cursor());
+    } else if (db_type_ == kMmapTensorFileType) {
+      extractMmap(
+          absolute_path_ ? db_name_ : (ws_->RootFolder() + "/" + db_name_));
     } else {
       string full_db_name =
           absolute_path_ ? db_name_ : (ws_->RootFolder() + "/" + db_name_);
@@ -162,21 +179,11 @@ class LoadOp final : public Operator<Context> {
   void extractAll(Cursor* cursor) {
     CAFFE_ENFORCE(cursor, "cursor is not valid");
     std::unordered_map<string, BlobState> blob_states;
-    int loaded_blobs = 0;
-    for (; cursor->Valid(); cursor->Next()) {
-      const auto key = buildBlobNameFromDbKey(cursor->key());
-      BlobProto proto;
-      CAFFE_ENFORCE(
-          proto.ParseFromString(cursor->value()), "Couldn't parse Proto");
-      if (!keep_device_) {
-        // If we are not keeping the device as the one specified in the
-        // proto, we will set the current device.
-        SetCurrentDevice(&proto);
-      }
-
-      Blob* blob = ws_->CreateBlob(key);
-      ProcessBlob(blob, proto, &blob_states, key, &loaded_blobs);
-    }
+    const int loaded_blobs = loadFromCursor(
+        cursor,
+        [this](const string& key) { return ws_->CreateBlob(key); },
+        -1,
+        &blob_states);
 
     VLOG(1) << "Loaded " << loaded_blobs << " from db";
     validateBlobStates(blob_states);
@@ -185,42 +192,252 @@ class LoadOp final : public Operator<Context> {
   void extractFrom(Cursor* cursor, const vector<Blob*>& outputs) {
     CAFFE_ENFORCE(cursor);
     std::unordered_map<string, BlobState> blob_states;
+    const int loaded_blobs = loadFromCursor(
+        cursor,
+        [this, &outputs](const string& key) -> Blob* {
+          if (!output_indices_.count(key)) {
+            VLOG(1) << "Key " << key << " not used. Skipping.";
+            return nullptr;
+          }
+          VLOG(2) << "Deserializing blob " << key;
+          return outputs.at(output_indices_[key]);
+        },
+        OutputSize(),
+        &blob_states);
+
+    validateBlobStates(blob_states);
+    VLOG(1) << "Fully loaded " << blob_states.size() << " blobs";
+
+    if (loaded_blobs != OutputSize()) {
+      if (allow_incomplete_ && loaded_blobs < OutputSize()) {
+        VLOG(1) << "Loaded " << loaded_blobs << " blobs out of " << OutputSize()
+                << " blobs from db.";
+        return;
+      }
+      for (const string& output_name : this->debug_def().output()) {
+        if (blob_states.count(output_name) == 0) {
+          LOG(ERROR) << "Failed to load blob: " << output_name;
+        }
+      }
+      CAFFE_THROW(
+          "Expected to load ",
+          OutputSize(),
+          " blobs, got ",
+          loaded_blobs,
+          " only.\n");
+    }
+  }
+
+  // Deserializes the cursor entries into the blobs returned by blob_for_key,
+  // which returns nullptr for the keys to skip. Stops reading once
+  // max_blobs blobs are complete, unless max_blobs is negative. Returns the
+  // number of complete blobs.
+  //
+  // With more than one deserializer thread, this thread only reads from the
+  // cursor while worker threads parse the values and copy them into their
+  // blobs, so reading and decoding overlap. The chunks of a CPU tensor are
+  // copied straight into the tensor, which is sized by its first chunk, and
+  // different chunks of the same tensor are copied in parallel.
+  int loadFromCursor(
+      Cursor* cursor,
+      const std::function<Blob*(const string&)>& blob_for_key,
+      int max_blobs,
+      std::unordered_map<string, BlobState>* blob_states) {
     int loaded_blobs = 0;
-    for (; cursor->Valid(); cursor->Next()) {
-      const auto key = buildBlobNameFromDbKey(cursor->key());
-      if (!output_indices_.count(key)) {
-        VLOG(1) << "Key " << key << " not used. Skipping.";
-      } else {
-        VLOG(2) << "Deserializing blob " << key;
+#ifndef __ANDROID__
+    // SetCurrentDevice of the GPU op reads the current device of the calling
+    // thread, so only the CPU op decodes on worker threads.
+    const int num_threads = std::is_same<Context, CPUContext>::value
+        ? FLAGS_caffe2_max_tensor_deserializer_threads
+        : 1;
+#else
+    // Since Android does not have std::future, we will always do sync mode
+    const int num_threads = 1;
+#endif
+    if (num_threads <= 1) {
+      for (; cursor->Valid(); cursor->Next()) {
+        const auto key = buildBlobNameFromDbKey(cursor->key());
+        Blob* blob = blob_for_key(key);
+        if (!blob) {
+          continue;
+        }
         BlobProto proto;
-        CAFFE_ENFORCE(proto.ParseFromString(cursor->value()));
+        CAFFE_ENFORCE(
+            proto.ParseFromString(cursor->value()), "Couldn't parse Proto");
         if (!keep_device_) {
           // If we are not keeping the device as the one specified in the
           // proto, we will set the current device.
           SetCurrentDevice(&proto);
         }
-        auto blobIndex = output_indices_[key];
-        Blob* blob = outputs.at(blobIndex);
-        ProcessBlob(blob, proto, &blob_states, key, &loaded_blobs);
-
-        if (loaded_blobs == OutputSize()) {
+        ProcessBlob(blob, proto, blob_states, key, &loaded_blobs);
+        if (loaded_blobs == max_blobs) {
           VLOG(1) << "Read all required blobs";
           break;
         }
       }
+      return loaded_blobs;
+    }
+#ifndef __ANDROID__
+    // Protects blob_states, loaded_blobs and the blobs themselves, except for
+    // the tensor data being copied by DeserializeChunk.
+    std::mutex state_mutex;
+    // Bounds the number of values read but not yet decoded.
+    const int max_pending = 2 * num_threads;
+    int num_pending = 0;
+    std::mutex pending_mutex;
+    std::condition_variable pending_cv;
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    SimpleQueue<std::shared_ptr<PendingBlob>> queue;
+
+    auto fail = [&]() {
+      std::lock_guard<std::mutex> lock(state_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      failed = true;
+    };
+    auto worker = [&]() {
+      std::shared_ptr<PendingBlob> pending;
+      while (queue.Pop(&pending)) {
+        // After a failure the remaining values are drained without decoding
+        // them, so that the reading thread never blocks.
+        if (!failed) {
+          try {
+            decodeBlob(*pending, &state_mutex, blob_states, &loaded_blobs);
+          } catch (...) {
+            fail();
+          }
+        }
+        pending.reset();
+        {
+          std::lock_guard<std::mutex> lock(pending_mutex);
+          --num_pending;
+        }
+        pending_cv.notify_one();
+      }
+    };
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < num_threads; ++i) {
+      futures.emplace_back(std::async(std::launch::async, worker));
+    }
+    try {
+      for (; cursor->Valid() && !failed; cursor->Next()) {
+        const auto key = buildBlobNameFromDbKey(cursor->key());
+        Blob* blob = blob_for_key(key);
+        if (!blob) {
+          continue;
+        }
+        {
+          std::lock_guard<std::mutex> lock(state_mutex);
+          if (loaded_blobs == max_blobs) {
+            VLOG(1) << "Read all required blobs";
+            break;
+          }
+        }
+        {
+          std::unique_lock<std::mutex> lock(pending_mutex);
+          pending_cv.wait(lock, [&]() { return num_pending < max_pending; });
+          ++num_pending;
+        }
+        queue.Push(std::make_shared<PendingBlob>(key, blob, cursor->value()));
+      }
+    } catch (...) {
+      fail();
+    }
+    queue.NoMoreJobs();
+    for (auto& future : futures) {
+      future.get();
+    }
+    if (error) {
+      std::rethrow_exception(error);
     }
+#endif
+    return loaded_blobs;
+  }
 
-    validateBlobStates(blob_states);
-    VLOG(1) << "Fully loaded " << blob_states.size() << " blobs";
+#ifndef __ANDROID__
+  struct PendingBlob {
+    PendingBlob(const string& key, Blob* blob, string&& value)
+        : key(key), blob(blob), value(std::move(value)) {}
+    string key;
+    Blob* blob;
+    string value;
+  };
+
+  // Parses and deserializes one value read by loadFromCursor. Only the copy
+  // of CPU tensor data runs outside of state_mutex.
+  void decodeBlob(
+      const PendingBlob& pending,
+      std::mutex* state_mutex,
+      std::unordered_map<string, BlobState>* blob_states,
+      int* loaded_blobs) {
+    BlobProto proto;
+    CAFFE_ENFORCE(proto.ParseFromString(pending.value), "Couldn't parse Proto");
+    if (!keep_device_) {
+      SetCurrentDevice(&proto);
+    }
+    if (proto.type() != kTensorBlobType || !proto.has_tensor() ||
+        proto.has_content_num_chunks() ||
+        proto.tensor().device_detail().device_type() != CPU) {
+      std::lock_guard<std::mutex> lock(*state_mutex);
+      ProcessBlob(pending.blob, proto, blob_states, pending.key, loaded_blobs);
+      return;
+    }
+    TensorDeserializer<CPUContext> deserializer;
+    Blob* blob = pending.blob;
+    TensorCPU* tensor = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(*state_mutex);
+      if (blob_states->count(pending.key) == 0) {
+        blob->Reset();
+        tensor = blob->GetMutable<TensorCPU>();
+        deserializer.DeserializeHeader(proto.tensor(), tensor);
+      } else {
+        CAFFE_ENFORCE(
+            blob->IsType<TensorCPU>(),
+            "Tensor chunks on different devices: ",
+            pending.key);
+        tensor = blob->GetMutable<TensorCPU>();
+      }
+      updateBlobState(proto, blob_states, pending.key, loaded_blobs);
+    }
+    deserializer.DeserializeChunk(proto.tensor(), tensor);
+  }
+#endif
 
-    if (loaded_blobs != OutputSize()) {
-      if (allow_incomplete_ && loaded_blobs < OutputSize()) {
-        VLOG(1) << "Loaded " << loaded_blobs << " blobs out of " << OutputSize()
-                << " blobs from db.";
+  // Maps an mmap tensor file and points the loaded tensors into it, no tensor
+  // data is copied.
+  void extractMmap(const string& filename) {
+    CAFFE_ENFORCE(
+        (std::is_same<Context, CPUContext>::value),
+        "mmap tensor files can only be loaded on CPU");
+    auto file = MmapTensorFile::Open(filename);
+    std::set<string> loaded;
+    for (const auto& entry : file->entries()) {
+      const auto key = buildBlobNameFromDbKey(entry.name);
+      Blob* blob = nullptr;
+      if (load_all_) {
+        blob = ws_->CreateBlob(key);
+      } else if (output_indices_.count(key)) {
+        blob = OperatorBase::Outputs().at(output_indices_[key]);
+      } else {
+        VLOG(1) << "Key " << key << " not used. Skipping.";
+        continue;
+      }
+      CAFFE_ENFORCE(loaded.insert(key).second, "Blob duplicated: ", key);
+      // Drop whatever the blob held so that the tensor only shares the map.
+      blob->Reset();
+      file->ShareData(entry, blob->template GetMutable<TensorCPU>());
+    }
+    VLOG(1) << "Mapped " << loaded.size() << " blobs from " << filename;
+
+    if (!load_all_ && loaded.size() != OutputSize()) {
+      if (allow_incomplete_) {
         return;
       }
       for (const string& output_name : this->debug_def().output()) {
-        if (blob_states.count(output_name) == 0) {
+        if (loaded.count(output_name) == 0) {
           LOG(ERROR) << "Failed to load blob: " << output_name;
         }
       }
@@ -228,7 +445,7 @@ class LoadOp final : public Operator<Context> {
           "Expected to load ",
           OutputSize(),
           " blobs, got ",
-          loaded_blobs,
+          loaded.size(),
           " only.\n");
     }
   }
@@ -264,6 +481,15 @@ class LoadOp final : public Operator<Context> {
       blob->Reset();
     }
     blob->Deserialize(proto);
+    updateBlobState(proto, blob_states_ptr, key, loaded_blobs);
+  }
+
+  void updateBlobState(
+      const BlobProto& proto,
+      std::unordered_map<string, BlobState>* blob_states_ptr,
+      const string& key,
+      int* loaded_blobs) {
+    auto& blob_states = *blob_states_ptr;
     if (proto.has_content_num_chunks()) {
       if (!blob_states.count(key)) {
         blob_states[key] = BlobState(proto.content_num_chunks());
@@ -367,6 +593,45 @@ class LoadOp final : public Operator<Context> {
   std::vector<std::string> blob_names_;
 };
 
+// The contents of the inputs of an async Save, taken when the op runs. CPU
+// tensors are copied, other blobs are serialized right away.
+struct SaveSnapshot {
+  std::vector<std::pair<string, std::unique_ptr<Blob>>> tensors;
+  std::vector<std::pair<string, string>> serialized;
+};
+
+// Writes a snapshot to the db, see SaveOp.
+void WriteSaveSnapshot(
+    const SaveSnapshot& snapshot,
+    const string& db_type,
+    const string& db_name);
+
+// Tracks a Save running in the background, see the async argument of Save.
+// The handle waits for the save when it is destroyed.
+class AsyncSaveHandle {
+ public:
+  // Waits for the previous save, if any, and runs fn in the background.
+  void Start(std::function<void()> fn) {
+    Wait();
+    future_ = std::async(std::launch::async, std::move(fn));
+  }
+
+  // Blocks until the save is done, and rethrows its error if it failed.
+  void Wait() {
+    if (future_.valid()) {
+      future_.get();
+    }
+  }
+
+  bool Done() const {
+    return !future_.valid() ||
+        future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+ private:
+  std::future<void> future_;
+};
+
 template <class Context>
 class SaveOp final : public Operator<Context> {
  public:
@@ -381,9 +646,14 @@ class SaveOp final : public Operator<Context> {
         db_name_(OperatorBase::GetSingleArgument<string>("db", "")),
         db_type_(OperatorBase::GetSingleArgument<string>("db_type", "")),
         blob_names_(
-            OperatorBase::GetRepeatedArgument<string>("blob_name_overrides")) {
+            OperatorBase::GetRepeatedArgument<string>("blob_name_overrides")),
+        async_(OperatorBase::GetSingleArgument<int>("async", 0)) {
     CAFFE_ENFORCE_GT(db_name_.size(), 0, "Must specify a db name.");
     CAFFE_ENFORCE_GT(db_type_.size(), 0, "Must specify a db type.");
+    CAFFE_ENFORCE_EQ(
+        OutputSize(),
+        async_ ? 1 : 0,
+        "An async Save has a single output, the handle of the save.");
     CAFFE_ENFORCE(
         blob_names_.empty() ||
             blob_names_.size() == OperatorBase::Inputs().size(),
@@ -418,6 +688,14 @@ class SaveOp final : public Operator<Context> {
   bool RunOnDevice() override {
     string full_db_name =
         absolute_path_ ? db_name_ : (ws_->RootFolder() + "/" + db_name_);
+    if (async_) {
+      saveAsync(full_db_name);
+      return true;
+    }
+    if (db_type_ == kMmapTensorFileType) {
+      saveMmap(full_db_name);
+      return true;
+    }
     std::unique_ptr<DB> out_db(
         caffe2::db::CreateDB(db_type_, full_db_name, caffe2::db::NEW));
     CAFFE_ENFORCE(out_db.get(), "Cannot open db for writing: ", full_db_name);
@@ -441,12 +719,66 @@ class SaveOp final : public Operator<Context> {
   }
 
  private:
+  void saveMmap(const string& filename) {
+    std::vector<std::pair<string, const TensorCPU*>> tensors;
+    const vector<const Blob*>& inputs = OperatorBase::Inputs();
+    for (int i = 0; i < inputs.size(); ++i) {
+      CAFFE_ENFORCE(
+          inputs[i]->template IsType<TensorCPU>(),
+          "Only CPU tensors can be saved to an mmap tensor file, got ",
+          inputs[i]->TypeName(),
+          " for ",
+          blob_names_[i]);
+      tensors.emplace_back(
+          blob_names_[i], &inputs[i]->template Get<TensorCPU>());
+    }
+    WriteMmapTensorFile(filename, tensors);
+  }
+
+  // Snapshots the inputs and writes the snapshot on a background thread, so
+  // that the inputs can be changed as soon as the op returns. Only the
+  // copies of CPU tensors are made on the calling thread, their
+  // serialization happens in the background.
+  void saveAsync(const string& full_db_name) {
+    auto snapshot = std::make_shared<SaveSnapshot>();
+    std::mutex mutex;
+    BlobSerializerBase::SerializationAcceptor acceptor = [&](
+        const std::string& blobName, const std::string& data) {
+      std::lock_guard<std::mutex> guard(mutex);
+      snapshot->serialized.emplace_back(blobName, data);
+    };
+    const vector<const Blob*>& inputs = OperatorBase::Inputs();
+    for (int i = 0; i < inputs.size(); ++i) {
+      if (inputs[i]->template IsType<TensorCPU>()) {
+        std::unique_ptr<Blob> copy(new Blob());
+        copy->template GetMutable<TensorCPU>()->CopyFrom(
+            inputs[i]->template Get<TensorCPU>());
+        snapshot->tensors.emplace_back(blob_names_[i], std::move(copy));
+      } else {
+        CAFFE_ENFORCE_NE(
+            db_type_,
+            kMmapTensorFileType,
+            "Only CPU tensors can be saved to an mmap tensor file, got ",
+            inputs[i]->TypeName(),
+            " for ",
+            blob_names_[i]);
+        inputs[i]->Serialize(blob_names_[i], acceptor);
+      }
+    }
+    const string db_type = db_type_;
+    OperatorBase::Output<AsyncSaveHandle>(0)->Start(
+        [snapshot, db_type, full_db_name]() {
+          WriteSaveSnapshot(*snapshot, db_type, full_db_name);
+        });
+  }
+
   Workspace* ws_;
   bool absolute_path_;
   string strip_prefix_;
   string db_name_;
   string db_type_;
   std::vector<std::string> blob_names_;
+  bool async_;
 };
 
 template <typename... Ts>
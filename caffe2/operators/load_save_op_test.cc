@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+string TempDBName(const string& name) {
+  return string(std::getenv("TMPDIR") ? std::getenv("TMPDIR") : "/tmp") +
+      "/load_save_op_test_" + name;
+}
+
+} // namespace
+
+TEST(LoadSaveOpTest, AsyncSaveWritesTheSnapshot) {
+  const string db = TempDBName("async");
+  Workspace ws;
+  auto* x = ws.CreateBlob("x")->GetMutable<TensorCPU>();
+  x->Resize(1000);
+  for (int i = 0; i < x->size(); ++i) {
+    x->mutable_data<float>()[i] = i;
+  }
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "Save",
+      "",
+      {"x"},
+      {"handle"},
+      {MakeArgument("db", db),
+       MakeArgument<string>("db_type", "minidb"),
+       MakeArgument("absolute_path", 1),
+       MakeArgument("async", 1)})));
+  // The save is not affected by changes made after the op returned.
+  for (int i = 0; i < x->size(); ++i) {
+    x->mutable_data<float>()[i] = -1;
+  }
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "WaitAsyncSave",
+      "",
+      {"handle"},
+      {"handle", "done"},
+      {MakeArgument("block", 0)})));
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("WaitAsyncSave", "", {"handle"}, {"handle", "done"})));
+  EXPECT_TRUE(ws.GetBlob("done")->Get<TensorCPU>().data<bool>()[0]);
+
+  Workspace load_ws;
+  ASSERT_TRUE(load_ws.RunOperatorOnce(CreateOperatorDef(
+      "Load",
+      "",
+      {},
+      {"x"},
+      {MakeArgument("db", db),
+       MakeArgument<string>("db_type", "minidb"),
+       MakeArgument("absolute_path", 1)})));
+  const auto& y = load_ws.GetBlob("x")->Get<TensorCPU>();
+  ASSERT_EQ(y.size(), 1000);
+  for (int i = 0; i < y.size(); ++i) {
+    EXPECT_EQ(y.data<float>()[i], i);
+  }
+  std::remove(db.c_str());
+}
+
+TEST(LoadSaveOpTest, AsyncSaveErrorsSurfaceOnWait) {
+  Workspace ws;
+  ws.CreateBlob("x")->GetMutable<TensorCPU>()->Resize(4);
+  ws.GetBlob("x")->GetMutable<TensorCPU>()->mutable_data<float>();
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "Save",
+      "",
+      {"x"},
+      {"handle"},
+      {MakeArgument<string>("db", "/nonexistent/dir/db"),
+       MakeArgument<string>("db_type", "minidb"),
+       MakeArgument("absolute_path", 1),
+       MakeArgument("async", 1)})));
+  EXPECT_THROW(
+      ws.RunOperatorOnce(
+          CreateOperatorDef("WaitAsyncSave", "", {"handle"}, {"handle"})),
+      EnforceNotMet);
+}
+
+} // namespace caffe2
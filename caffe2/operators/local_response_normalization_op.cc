@@ -18,6 +18,32 @@
 
 namespace caffe2 {
 
+namespace {
+
+// Y = X * scale^(-beta). The common betas avoid the scalar pow: 0.75 in
+// particular, the AlexNet / GoogLeNet setting, becomes two square roots.
+void ScaleByInversePower(
+    const int size,
+    const float* X,
+    const float* scale,
+    const float beta,
+    float* Y) {
+  ConstEigenVectorArrayMap<float> X_arr(X, size);
+  ConstEigenVectorArrayMap<float> scale_arr(scale, size);
+  EigenVectorArrayMap<float> Y_arr(Y, size);
+  if (beta == 0.75f) {
+    Y_arr = X_arr / (scale_arr.sqrt() * scale_arr.sqrt().sqrt());
+  } else if (beta == 0.5f) {
+    Y_arr = X_arr / scale_arr.sqrt();
+  } else if (beta == 1.f) {
+    Y_arr = X_arr / scale_arr;
+  } else {
+    Y_arr = X_arr * scale_arr.pow(-beta);
+  }
+}
+
+} // namespace
+
 template<>
 bool LRNOp<float, CPUContext>::RunOnDeviceWithOrderNCHW() {
   // Note(Yangqing): this one is copied from my Caffe implementation.
@@ -43,10 +69,9 @@ bool LRNOp<float, CPUContext>::RunOnDeviceWithOrderNCHW() {
   scale_->ResizeLike(X);
   float* scale_data = scale_->mutable_data<float>();
   math::Set<float, CPUContext>(X.size(), bias_, scale_data, &context_);
-  TensorCPU padded_square(
-      vector<TIndex>{C + size_ - 1, H, W});
-  float* padded_square_data = padded_square.mutable_data<float>();
-  math::Set<float, CPUContext>(padded_square.size(), 0., padded_square_data,
+  padded_square_.Resize(C + size_ - 1, H, W);
+  float* padded_square_data = padded_square_.mutable_data<float>();
+  math::Set<float, CPUContext>(padded_square_.size(), 0., padded_square_data,
                                &context_);
   const float alpha_over_size = alpha_ / size_;
   // go through the images
@@ -76,9 +101,7 @@ bool LRNOp<float, CPUContext>::RunOnDeviceWithOrderNCHW() {
           this_scale_slice, &context_);
     }
   }
-  math::Powx<float, CPUContext>(
-      X.size(), scale_data, -beta_, Ydata, &context_);
-  math::Mul<float, CPUContext>(X.size(), Ydata, Xdata, Ydata, &context_);
+  ScaleByInversePower(X.size(), Xdata, scale_data, beta_, Ydata);
   return true;
 }
 
@@ -108,30 +131,32 @@ bool LRNOp<float, CPUContext>::RunOnDeviceWithOrderNHWC() {
   scale_->ResizeLike(X);
   float* scale_data = scale_->mutable_data<float>();
 
-  TensorCPU padded_square(vector<TIndex>(1, C + size_ - 1));
-  float* padded_square_data = padded_square.mutable_data<float>();
-  math::Set<float, CPUContext>(padded_square.size(), 0., padded_square_data,
+  padded_square_.Resize(C + size_ - 1);
+  float* padded_square_data = padded_square_.mutable_data<float>();
+  math::Set<float, CPUContext>(padded_square_.size(), 0., padded_square_data,
                                &context_);
   const float alpha_over_size = alpha_ / size_;
 
+  // The window of each channel is summed as size_ shifted passes over the
+  // padded row rather than as a running sum, so that every pass is a
+  // contiguous loop across the channels.
   for (int n = 0; n < num_rows; ++n) {
+    const float* x = Xdata + n * C;
+    float* scale_row = scale_data + n * C;
     for (int c = 0; c < C; ++c) {
-      padded_square_data[c + pre_pad_] =
-          Xdata[n * C + c] * Xdata[n * C + c] * alpha_over_size;
-    }
-    float accum_scale = 0.;
-    for (int i = 0; i < size_ - 1; ++i) {
-      accum_scale += padded_square_data[i];
+      padded_square_data[c + pre_pad_] = x[c] * x[c] * alpha_over_size;
     }
     for (int c = 0; c < C; ++c) {
-      accum_scale += padded_square_data[c + size_ - 1];
-      scale_data[n * C + c] = bias_ + accum_scale;
-      accum_scale -= padded_square_data[c];
+      scale_row[c] = bias_;
+    }
+    for (int i = 0; i < size_; ++i) {
+      const float* shifted = padded_square_data + i;
+      for (int c = 0; c < C; ++c) {
+        scale_row[c] += shifted[c];
+      }
     }
   }
-  math::Powx<float, CPUContext>(
-      X.size(), scale_data, -beta_, Ydata, &context_);
-  math::Mul<float, CPUContext>(X.size(), Ydata, Xdata, Ydata, &context_);
+  ScaleByInversePower(X.size(), Xdata, scale_data, beta_, Ydata);
   return true;
 }
 
@@ -84,6 +84,8 @@ class LRNOp final : public LRNOpBase<T, Context> {
   OUTPUT_TAGS(OUTPUT, SCALE);
   Tensor<Context>* scale_ = nullptr;
   Tensor<Context> local_scale_tensor_;
+  // Squared input padded with zeros on both channel ends; kept across runs.
+  Tensor<Context> padded_square_;
 };
 
 template <typename T, class Context>
@@ -16,7 +16,144 @@
 
 #include "lstm_unit_op.h"
 
+#include <algorithm>
+#include <vector>
+
+#include "caffe2/perfkernels/transcendental.h"
+
 namespace caffe2 {
+namespace detail {
+
+namespace {
+
+// Writes sigmoid of the i, f and o gates to act[0, 3D) and tanh of the g gate
+// to act[3D, 4D).
+void LSTMActivations(
+    int D,
+    const float* X,
+    const float forget_bias,
+    float* act) {
+  std::copy(X, X + 3 * D, act);
+  for (int d = 0; d < D; ++d) {
+    act[D + d] += forget_bias;
+  }
+  vector_sigmoid(3 * D, act, act);
+  vector_tanh(D, X + 3 * D, act + 3 * D);
+}
+
+} // namespace
+
+template <>
+void LSTMUnit<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* H_prev,
+    const float* C_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    bool drop_states,
+    float* C,
+    float* H,
+    const float forget_bias,
+    CPUContext* /*context*/) {
+  std::vector<float> act(4 * D);
+  for (int n = 0; n < N; ++n) {
+    if (t >= seqLengths[n]) {
+      if (drop_states) {
+        std::fill(H, H + D, 0.0f);
+        std::fill(C, C + D, 0.0f);
+      } else {
+        std::copy(H_prev, H_prev + D, H);
+        std::copy(C_prev, C_prev + D, C);
+      }
+    } else {
+      LSTMActivations(D, X, forget_bias, act.data());
+      const float* i = act.data();
+      const float* f = i + D;
+      const float* o = i + 2 * D;
+      const float* g = i + 3 * D;
+      for (int d = 0; d < D; ++d) {
+        C[d] = f[d] * C_prev[d] + i[d] * g[d];
+      }
+      vector_tanh(D, C, H);
+      for (int d = 0; d < D; ++d) {
+        H[d] *= o[d];
+      }
+    }
+    H_prev += D;
+    C_prev += D;
+    X += 4 * D;
+    C += D;
+    H += D;
+  }
+}
+
+template <>
+void LSTMUnitGradient<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* C_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    const float* C,
+    const float* /*H*/,
+    const float* C_diff,
+    const float* H_diff,
+    bool drop_states,
+    float* H_prev_diff,
+    float* C_prev_diff,
+    float* X_diff,
+    const float forget_bias,
+    CPUContext* /*context*/) {
+  std::vector<float> act(5 * D);
+  for (int n = 0; n < N; ++n) {
+    float* i_diff = X_diff;
+    float* f_diff = X_diff + D;
+    float* o_diff = X_diff + 2 * D;
+    float* g_diff = X_diff + 3 * D;
+    if (t >= seqLengths[n]) {
+      if (drop_states) {
+        std::fill(H_prev_diff, H_prev_diff + D, 0.0f);
+        std::fill(C_prev_diff, C_prev_diff + D, 0.0f);
+      } else {
+        std::copy(H_diff, H_diff + D, H_prev_diff);
+        std::copy(C_diff, C_diff + D, C_prev_diff);
+      }
+      std::fill(X_diff, X_diff + 4 * D, 0.0f);
+    } else {
+      LSTMActivations(D, X, forget_bias, act.data());
+      const float* i = act.data();
+      const float* f = i + D;
+      const float* o = i + 2 * D;
+      const float* g = i + 3 * D;
+      float* tanh_c = act.data() + 4 * D;
+      vector_tanh(D, C, tanh_c);
+      for (int d = 0; d < D; ++d) {
+        const float c_term_diff =
+            C_diff[d] + H_diff[d] * o[d] * (1 - tanh_c[d] * tanh_c[d]);
+        C_prev_diff[d] = c_term_diff * f[d];
+        H_prev_diff[d] = 0; // not used in 'valid' case
+        i_diff[d] = c_term_diff * g[d] * i[d] * (1 - i[d]);
+        f_diff[d] = c_term_diff * C_prev[d] * f[d] * (1 - f[d]);
+        o_diff[d] = H_diff[d] * tanh_c[d] * o[d] * (1 - o[d]);
+        g_diff[d] = c_term_diff * i[d] * (1 - g[d] * g[d]);
+      }
+    }
+    C_prev += D;
+    X += 4 * D;
+    C += D;
+    C_diff += D;
+    H_diff += D;
+    X_diff += 4 * D;
+    H_prev_diff += D;
+    C_prev_diff += D;
+  }
+}
+
+} // namespace detail
+
 REGISTER_CPU_OPERATOR(LSTMUnit, LSTMUnitOp<CPUContext>);
 OPERATOR_SCHEMA(LSTMUnit)
     .NumInputs(5)
@@ -148,6 +148,42 @@ void LSTMUnitGradient(
     C_prev_diff += D;
   }
 }
+
+// The float CPU versions compute the activations of a whole row at a time
+// through the perfkernels, see lstm_unit_op.cc.
+template <>
+void LSTMUnit<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* H_prev,
+    const float* C_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    bool drop_states,
+    float* C,
+    float* H,
+    const float forget_bias,
+    CPUContext* context);
+
+template <>
+void LSTMUnitGradient<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* C_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    const float* C,
+    const float* H,
+    const float* C_diff,
+    const float* H_diff,
+    bool drop_states,
+    float* H_prev_diff,
+    float* C_prev_diff,
+    float* X_diff,
+    const float forget_bias,
+    CPUContext* context);
 } // namespace detail
 
 template <typename Context>
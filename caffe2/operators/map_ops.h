@@ -21,13 +21,14 @@
 #include <iterator>
 #include <string>
 #include <typeinfo>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "caffe2/core/blob_serialization.h"
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/utils/flat_hash_map.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
@@ -48,10 +49,10 @@ struct TypeNameTraits<int32_t> {
 
 template <typename KEY_T, typename VALUE_T>
 struct MapTypeTraits {
-  using MapType = std::unordered_map<KEY_T, VALUE_T>;
+  using MapType = FlatHashMap<KEY_T, VALUE_T>;
   static string MapTypeName() {
-    return string("(std::unordered_map<") + TypeNameTraits<KEY_T>::name + ", " +
-        TypeNameTraits<VALUE_T>::name + ">)";
+    return string("(caffe2::FlatHashMap<") + TypeNameTraits<KEY_T>::name +
+        ", " + TypeNameTraits<VALUE_T>::name + ">)";
   }
 };
 
@@ -143,6 +144,7 @@ class KeyValueToMapOp final : public Operator<Context> {
     auto* value_data = value_input.template data<VALUE_T>();
 
     auto* map_data = OperatorBase::Output<MapType>(MAP);
+    map_data->reserve(map_data->size() + key_input.size());
 
     for (int i = 0; i < key_input.size(); ++i) {
       map_data->emplace(key_data[i], value_data[i]);
@@ -205,6 +207,72 @@ class MapToKeyValueOp final : public Operator<Context> {
   OUTPUT_TAGS(KEYS, VALUES);
 };
 
+template <class Context>
+class MapLookupOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MapLookupOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        default_value_(
+            OperatorBase::GetSingleArgument<int64_t>("default_value", -1)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<
+        MapType64To64,
+        MapType64To32,
+        MapType32To32,
+        MapType32To64>>::call(this, OperatorBase::InputBlob(MAP));
+  }
+
+  template <typename MAP_T>
+  bool DoRunWithType() {
+    using key_type = typename MAP_T::key_type;
+    using mapped_type = typename MAP_T::mapped_type;
+    const auto& map_data = OperatorBase::Input<MAP_T>(MAP);
+    const auto& keys = Input(KEYS);
+    CAFFE_ENFORCE(
+        keys.template IsType<key_type>(),
+        "Keys must be of the key type of the map");
+    auto* values = Output(VALUES);
+    values->ResizeLike(keys);
+    const auto* key_data = keys.template data<key_type>();
+    auto* value_data = values->template mutable_data<mapped_type>();
+    const TIndex n = keys.size();
+    const mapped_type default_value = default_value_;
+
+    const TIndex num_chunks =
+        std::min<TIndex>(num_threads_, n / kMinKeysPerThread);
+    if (num_chunks <= 1) {
+      map_data.lookup(key_data, n, value_data, default_value);
+      return true;
+    }
+    ws_->GetThreadPool()->runChunks(
+        [&](int /* unused */, size_t c) {
+          const TIndex begin = c * n / num_chunks;
+          const TIndex end = (c + 1) * n / num_chunks;
+          map_data.lookup(
+              key_data + begin, end - begin, value_data + begin, default_value);
+        },
+        num_chunks);
+    return true;
+  }
+
+  INPUT_TAGS(MAP, KEYS);
+  OUTPUT_TAGS(VALUES);
+
+ private:
+  // Below this many keys per thread, splitting the lookups does not pay off.
+  static constexpr TIndex kMinKeysPerThread = 4096;
+
+  int64_t default_value_;
+  int num_threads_;
+  Workspace* ws_;
+};
+
 template <typename KEY_T, typename VALUE_T>
 class MapSerializer : public BlobSerializerBase {
  public:
@@ -263,6 +331,8 @@ class MapDeserializer : public BlobDeserializerBase {
     auto* value_data = value_tensor.data<VALUE_T>();
 
     auto* map_ptr = blob->template GetMutable<MapType>();
+    map_ptr->clear();
+    map_ptr->reserve(key_tensor.size());
     for (int i = 0; i < key_tensor.size(); ++i) {
       map_ptr->emplace(key_data[i], value_data[i]);
     }
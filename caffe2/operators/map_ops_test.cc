@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/map_ops.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+template <typename T>
+void SetTensor(Workspace* ws, const string& name, const vector<T>& data) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(data.size());
+  std::copy(data.begin(), data.end(), tensor->mutable_data<T>());
+}
+
+} // namespace
+
+TEST(MapOpsTest, LookupWithThreads) {
+  Workspace ws;
+  const int kSize = 50000;
+  vector<int64_t> keys(kSize);
+  vector<int32_t> values(kSize);
+  for (int i = 0; i < kSize; ++i) {
+    keys[i] = int64_t(i) * 1000003;
+    values[i] = i;
+  }
+  SetTensor(&ws, "keys", keys);
+  SetTensor(&ws, "values", values);
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("KeyValueToMap", "", {"keys", "values"}, {"map"})));
+  EXPECT_EQ(ws.GetBlob("map")->Get<MapType64To32>().size(), kSize);
+
+  vector<int64_t> queries(kSize);
+  for (int i = 0; i < kSize; ++i) {
+    queries[i] = i % 2 ? keys[kSize - 1 - i] : keys[i] + 1;
+  }
+  SetTensor(&ws, "queries", queries);
+  for (int num_threads : {1, 4}) {
+    ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+        "MapLookup",
+        "",
+        {"map", "queries"},
+        {"found"},
+        {MakeArgument<int64_t>("default_value", -7),
+         MakeArgument<int>("num_threads", num_threads)})));
+    const auto& found = ws.GetBlob("found")->Get<TensorCPU>();
+    ASSERT_EQ(found.size(), kSize);
+    for (int i = 0; i < kSize; ++i) {
+      ASSERT_EQ(found.data<int32_t>()[i], i % 2 ? kSize - 1 - i : -7) << i;
+    }
+  }
+}
+
+TEST(MapOpsTest, SerializationRoundTrip) {
+  Workspace ws;
+  SetTensor<int32_t>(&ws, "keys", {5, 1, 9});
+  SetTensor<int64_t>(&ws, "values", {50, 10, 90});
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("KeyValueToMap", "", {"keys", "values"}, {"map"})));
+  auto serialized = ws.GetBlob("map")->Serialize("map");
+
+  Blob blob;
+  blob.Deserialize(serialized);
+  const auto& map = blob.Get<MapType32To64>();
+  EXPECT_EQ(map.size(), 3);
+  EXPECT_EQ(map.find(9)->second, 90);
+  EXPECT_EQ(map.count(2), 0);
+
+  // Blobs saved when maps were std::unordered_map still load.
+  BlobProto proto;
+  ASSERT_TRUE(proto.ParseFromString(serialized));
+  proto.set_type("(std::unordered_map<int32_t, int64_t>)");
+  Blob legacy;
+  legacy.Deserialize(proto.SerializeAsString());
+  EXPECT_EQ(legacy.Get<MapType32To64>().find(5)->second, 50);
+}
+
+} // namespace caffe2
@@ -18,9 +18,59 @@
 
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/utils/run_chunks.h"
 
 namespace caffe2 {
 
+void OneHotLookup::Build(TIndex D, const int32_t* lens, const int64_t* vals) {
+  TIndex output_dim = 0;
+  for (TIndex j = 0; j < D; j++) {
+    output_dim += lens[j];
+  }
+  columns_.resize(D);
+  table_.clear();
+  sorted_.clear();
+  next_.assign(output_dim, -1);
+  TIndex p = 0;
+  for (TIndex j = 0; j < D; j++) {
+    const int64_t* column_vals = vals + p;
+    const TIndex len = lens[j];
+    Column& column = columns_[j];
+    column.min_value = len > 0
+        ? *std::min_element(column_vals, column_vals + len)
+        : 0;
+    const uint64_t range = len > 0
+        ? uint64_t(*std::max_element(column_vals, column_vals + len)) -
+            uint64_t(column.min_value) + 1
+        : 0;
+    column.dense = range <= kMinDenseSize || range <= kMaxDenseRatio * len;
+    if (column.dense) {
+      column.size = range;
+      column.begin = table_.size();
+      table_.resize(table_.size() + range, -1);
+      // Backwards, so that every value chains its positions in order.
+      for (TIndex t = len - 1; t >= 0; t--) {
+        int& first = table_[column.begin + column_vals[t] - column.min_value];
+        next_[p + t] = first;
+        first = p + t;
+      }
+    } else {
+      column.size = len;
+      column.begin = sorted_.size();
+      for (TIndex t = 0; t < len; t++) {
+        sorted_.emplace_back(column_vals[t], p + t);
+      }
+      std::sort(sorted_.begin() + column.begin, sorted_.end());
+      for (TIndex t = column.begin; t + 1 < sorted_.size(); t++) {
+        if (sorted_[t].first == sorted_[t + 1].first) {
+          next_[sorted_[t].second] = sorted_[t + 1].second;
+        }
+      }
+    }
+    p += len;
+  }
+}
+
 template <>
 template <typename T>
 bool BatchOneHotOp<CPUContext>::DoRunWithType() {
@@ -45,21 +95,31 @@ bool BatchOneHotOp<CPUContext>::DoRunWithType() {
   const auto* input_data = input.template data<T>();
   const auto* vals_data = vals.template data<T>();
   auto* output_data = output->template mutable_data<T>();
-  // eigen is column-major
-  auto input_m = ConstEigenMatrixMap<T>(input_data, D, N);
-  auto output_m = EigenMatrixMap<T>(output_data, output_dim, N);
 
-  // `p` is the column position in output_data, that points to the next
-  // column to be filled.
-  TIndex p = 0;
-  // one-hot encoding for each example.
-  for (TIndex j = 0; j < D; j++) {
-    for (TIndex t = 0; t < lens_data[j]; t++) {
-      output_m.row(p) =
-          input_m.row(j).cwiseEqual(vals_data[p]).template cast<T>();
-      p++;
-    }
+  if (lookup_lens_.size() != D || lookup_vals_.size() != output_dim ||
+      !std::equal(lens_data, lens_data + D, lookup_lens_.begin()) ||
+      !std::equal(vals_data, vals_data + output_dim, lookup_vals_.begin())) {
+    lookup_lens_.assign(lens_data, lens_data + D);
+    lookup_vals_.assign(vals_data, vals_data + output_dim);
+    lookup_.Build(D, lookup_lens_.data(), lookup_vals_.data());
   }
+
+  // One-hot encoding for each example, in chunks of examples of at least
+  // kMinElementsPerChunk outputs.
+  auto encode = [&](int /* unused */, TIndex begin, TIndex end) {
+    std::fill(
+        output_data + begin * output_dim, output_data + end * output_dim, 0);
+    for (TIndex i = begin; i < end; i++) {
+      T* output_row = output_data + i * output_dim;
+      for (TIndex j = 0; j < D; j++) {
+        for (int p = lookup_.Find(j, input_data[i * D + j]); p != -1;
+             p = lookup_.Next(p)) {
+          output_row[p] = 1;
+        }
+      }
+    }
+  };
+  RunChunks(ws_, num_threads_, N, std::max<TIndex>(output_dim, D), encode);
   return true;
 }
 
@@ -220,6 +280,10 @@ output = [[1, 0, 0, 1, 0], [0, 1, 1, 0, 0], [1, 0, 0, 0, 1]]
 )DOC")
     .Input(0, "data", "input tensor matrix")
     .Input(1, "lengths", "the size is the same as the width of the `data`")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the examples are "
+        "split over. Defaults to 1.")
     .Input(2, "values", "one hot encoding dictionary values")
     .Output(
         0,
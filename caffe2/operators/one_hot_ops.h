@@ -17,6 +17,11 @@
 #ifndef CAFFE_OPERATORS_ONE_HOT_OPS_H_
 #define CAFFE_OPERATORS_ONE_HOT_OPS_H_
 
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
@@ -24,6 +29,52 @@
 
 namespace caffe2 {
 
+// Maps the values of the columns of BatchOneHot to their positions in the
+// output row: by a direct table over the range of the values of a column
+// when it is at most kMaxDenseRatio times their number, and otherwise by a
+// binary search of the sorted values.
+class OneHotLookup {
+ public:
+  // Builds the lookup of the D columns, with lens[j] values each.
+  void Build(TIndex D, const int32_t* lens, const int64_t* vals);
+
+  // The first position of value in column j, or -1. The positions of a value
+  // repeated in a column are chained by Next.
+  inline int Find(TIndex j, int64_t value) const {
+    const Column& column = columns_[j];
+    const uint64_t delta = uint64_t(value) - uint64_t(column.min_value);
+    if (column.dense) {
+      return delta < column.size ? table_[column.begin + delta] : -1;
+    }
+    const auto begin = sorted_.begin() + column.begin;
+    const auto end = begin + column.size;
+    const auto it = std::lower_bound(
+        begin, end, std::make_pair(value, std::numeric_limits<int>::min()));
+    return it != end && it->first == value ? it->second : -1;
+  }
+
+  inline int Next(int position) const {
+    return next_[position];
+  }
+
+ private:
+  static constexpr uint64_t kMaxDenseRatio = 4;
+  static constexpr uint64_t kMinDenseSize = 64;
+
+  struct Column {
+    bool dense;
+    int64_t min_value;
+    // The range of the table, or the number of sorted values, starting at
+    // begin in table_ or in sorted_.
+    uint64_t size;
+    uint64_t begin;
+  };
+  std::vector<Column> columns_;
+  std::vector<int> table_;
+  std::vector<std::pair<int64_t, int>> sorted_;
+  std::vector<int> next_;
+};
+
 template <class Context>
 class OneHotOp final : public Operator<Context> {
  public:
@@ -72,7 +123,11 @@ class BatchOneHotOp final : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   BatchOneHotOp(const OperatorDef& operator_def, Workspace* ws)
-      : Operator<Context>(operator_def, ws) {}
+      : Operator<Context>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
 
   bool RunOnDevice() override {
     return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(this, Input(X));
@@ -82,6 +137,13 @@ class BatchOneHotOp final : public Operator<Context> {
   bool DoRunWithType();
 
  protected:
+  int num_threads_;
+  Workspace* ws_;
+  // The lengths and values the lookup was built for. They are usually
+  // constant, so that it is built once.
+  std::vector<int32_t> lookup_lens_;
+  std::vector<int64_t> lookup_vals_;
+  OneHotLookup lookup_;
   INPUT_TAGS(X, LENS, VALS);
   OUTPUT_TAGS(ONE_HOT);
 };
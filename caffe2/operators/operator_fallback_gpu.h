@@ -51,6 +51,9 @@ namespace caffe2 {
  * the CPU, you can do
  *     REGISTER_CUDA_OPERATOR(MyMagic,
  *                            GPUFallbackOp<MyMagicOp, SkipIndices<0>>);
+ *
+ * Inputs that the schema of the op lists in ShapeOnlyInputs are given to the
+ * CPU op with their shape and type but without copying their data.
  */
 template <class CPUOp, typename SkipOutputCopy = SkipIndices<>>
 class GPUFallbackOp final : public Operator<CUDAContext> {
@@ -73,15 +76,56 @@ class GPUFallbackOp final : public Operator<CUDAContext> {
       local_output_blobs_.push_back(local_ws_.GetBlob(name));
       CHECK_NOTNULL(local_output_blobs_.back());
     }
+    const OpSchema* schema = OpSchemaRegistry::Schema(def.type());
+    for (int i = 0; i < def.input_size(); ++i) {
+      copy_input_.push_back(!schema || !schema->shape_only_input(i));
+    }
   }
 
   bool RunOnDevice() override {
-    bool need_sync = false;
+    // All the GPU inputs are staged in one buffer, which is pinned memory
+    // once CUDA is in use, so that the copies are asynchronous and only
+    // synchronized once. Inputs that the op only reads the shape of get
+    // their space in the buffer but are not copied.
+    auto round_to_alignment = [](size_t bytes) -> size_t {
+      return ((bytes + gCaffe2Alignment - 1) / gCaffe2Alignment) *
+          gCaffe2Alignment;
+    };
+    size_t staging_bytes = 0;
+    for (int i = 0; i < InputSize(); ++i) {
+      if (OperatorBase::InputIsType<TensorCUDA>(i)) {
+        staging_bytes += round_to_alignment(Input(i).nbytes());
+      }
+    }
+    const size_t staged_bytes = std::max<TIndex>(staging_.size(), 0);
+    if (staging_bytes > staged_bytes && output_copies_pending_) {
+      // Growing the buffer frees it, and the previous outputs may still be
+      // copied from it.
+      context_.FinishDeviceComputation();
+      output_copies_pending_ = false;
+    }
+    char* staging = nullptr;
+    if (staging_bytes > 0) {
+      staging_.Resize(std::max(staging_bytes, staged_bytes));
+      staging = reinterpret_cast<char*>(staging_.mutable_data<uint8_t>());
+    }
+
+    bool need_sync = output_copies_pending_;
     for (int i = 0; i < InputSize(); ++i) {
       if (OperatorBase::InputIsType<TensorCUDA>(i)) {
-        local_input_blobs_[i]->template GetMutable<TensorCPU>()->CopyFrom(
-            Input(i), &context_);
-        need_sync = true;
+        const auto& input = Input(i);
+        auto* local = local_input_blobs_[i]->template GetMutable<TensorCPU>();
+        local->Resize(input.dims());
+        local->ShareExternalPointer(
+            staging, input.meta(), round_to_alignment(input.nbytes()));
+        if (copy_input_[i]) {
+          context_.CopyBytes<CUDAContext, CPUContext>(
+              input.nbytes(), input.raw_data(), staging);
+          need_sync = true;
+        } else {
+          VLOG(1) << "Input " << i << " is shape only. Skipping copy.";
+        }
+        staging += round_to_alignment(input.nbytes());
       } else {
         VLOG(1) << "Input " << i << " is not TensorCUDA. Skipping copy.";
         // Note(jiayq): This removes a const but conceptually
@@ -93,16 +137,20 @@ class GPUFallbackOp final : public Operator<CUDAContext> {
       }
     }
 
-    // Sync to make sure copies are done.
+    // Sync to make sure the input copies are done, and that the previous
+    // output copies no longer read the outputs the base op writes.
     if (need_sync) {
       context_.FinishDeviceComputation();
     }
+    output_copies_pending_ = false;
 
     if (!base_op_->Run()) {
       LOG(ERROR) << "Base op run failed in GPUFallbackOp. Def: "
                  << ProtoDebugString(this->debug_def());
       return false;
     }
+    // The output copies are asynchronous, and are waited for by the next
+    // run before the base op writes its outputs again.
     for (int i = 0; i < OutputSize(); ++i) {
       if (SkipOutputCopy::Contains(i)) {
         VLOG(1) << "Copy output: index " << i << " skipped.";
@@ -114,6 +162,7 @@ class GPUFallbackOp final : public Operator<CUDAContext> {
           "output type who needs copying.");
       Output(i)->CopyFrom(
           local_output_blobs_[i]->template Get<TensorCPU>(), &context_);
+      output_copies_pending_ = true;
     }
     return true;
   }
@@ -123,6 +172,10 @@ class GPUFallbackOp final : public Operator<CUDAContext> {
   vector<Blob*> local_input_blobs_;
   vector<Blob*> local_output_blobs_;
   std::unique_ptr<CPUOp> base_op_;
+  // Whether the data of each input is copied, see OpSchema::ShapeOnlyInputs.
+  vector<bool> copy_input_;
+  TensorCPU staging_;
+  bool output_copies_pending_ = false;
 };
 
 } // namespace caffe2
@@ -48,6 +48,27 @@ REGISTER_CPU_OPERATOR(IncrementByOne, IncrementByOneOp);
 REGISTER_CUDA_OPERATOR(IncrementByOne,
                        GPUFallbackOp<IncrementByOneOp>);
 
+// Fills its output, in place, with the index of every element.
+class FillWithIndexOp final : public Operator<CPUContext> {
+ public:
+  FillWithIndexOp(const OperatorDef& def, Workspace* ws)
+      : Operator<CPUContext>(def, ws) {}
+  bool RunOnDevice() {
+    auto* out = Output(0);
+    float* out_data = out->template mutable_data<float>();
+    for (int i = 0; i < out->size(); ++i) {
+      out_data[i] = i;
+    }
+    return true;
+  }
+};
+
+OPERATOR_SCHEMA(FillWithIndex)
+    .NumInputs(1).NumOutputs(1).EnforceInplace({{0, 0}}).ShapeOnlyInputs({0});
+
+REGISTER_CPU_OPERATOR(FillWithIndex, FillWithIndexOp);
+REGISTER_CUDA_OPERATOR(FillWithIndex, GPUFallbackOp<FillWithIndexOp>);
+
 TEST(OperatorFallbackTest, IncrementByOneOp) {
   OperatorDef op_def = CreateOperatorDef(
       "IncrementByOne", "", vector<string>{"X"},
@@ -95,4 +116,28 @@ TEST(OperatorFallbackTest, GPUIncrementByOneOp) {
   }
 }
 
+TEST(OperatorFallbackTest, GPUShapeOnlyInput) {
+  if (!HasCudaGPU()) return;
+  OperatorDef op_def = CreateOperatorDef(
+      "FillWithIndex", "", vector<string>{"X"}, vector<string>{"X"});
+  op_def.mutable_device_option()->set_device_type(CUDA);
+  Workspace ws;
+  TensorCPU source_tensor(vector<TIndex>{2, 3});
+  for (int i = 0; i < 6; ++i) {
+    source_tensor.mutable_data<float>()[i] = -1;
+  }
+  ws.CreateBlob("X")->GetMutable<TensorCUDA>()->CopyFrom(source_tensor);
+  unique_ptr<OperatorBase> op(CreateOperator(op_def, &ws));
+  EXPECT_TRUE(op.get() != nullptr);
+  // The second run reuses the staging buffer.
+  EXPECT_TRUE(op->Run());
+  EXPECT_TRUE(op->Run());
+  const TensorCUDA& output = ws.GetBlob("X")->Get<TensorCUDA>();
+  TensorCPU output_cpu(output);
+  EXPECT_EQ(output.dims(), vector<TIndex>({2, 3}));
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(output_cpu.data<float>()[i], i);
+  }
+}
+
 }  // namespace caffe2
@@ -28,21 +28,37 @@ namespace caffe2 {
 template <typename T, class Context>
 class NHWC2NCHWOp final : public Operator<Context> {
  public:
-  USE_SIMPLE_CTOR_DTOR(NHWC2NCHWOp);
   USE_OPERATOR_CONTEXT_FUNCTIONS;
+  NHWC2NCHWOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
   bool RunOnDevice() override;
 
  protected:
+  // Only used by the CPU implementation.
+  const int num_threads_;
+  Workspace* ws_;
 };
 
 template <typename T, class Context>
 class NCHW2NHWCOp final : public Operator<Context> {
  public:
-  USE_SIMPLE_CTOR_DTOR(NCHW2NHWCOp);
   USE_OPERATOR_CONTEXT_FUNCTIONS;
+  NCHW2NHWCOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
   bool RunOnDevice() override;
 
  protected:
+  // Only used by the CPU implementation.
+  const int num_threads_;
+  Workspace* ws_;
 };
 
 } // namespace caffe2
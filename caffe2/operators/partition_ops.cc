@@ -69,6 +69,11 @@ X_0_part_0, X_1_part_0, ..., X_N-1_part_0, X_0_part_1, ..., X_N-1_part_K-1
         "pack_first_input",
         "(int, default 0) If set, the operator transforms "
         "the first tensor values as floor(X_ij / num_partitions)")
+    .Arg(
+        "num_threads",
+        "(int, default 1) Number of threads of the workspace pool that count "
+        "and scatter contiguous chunks of the elements in parallel. The "
+        "result does not depend on it.")
     .Input(
         0,
         "input",
@@ -110,6 +115,11 @@ X_0_part_0, X_1_part_0, ..., X_N-1_part_0, X_0_part_1, ..., X_N-1_part_K-1
         "pack_first_input",
         "(int, default 0) If set, the operator transforms "
         "the first tensor values as floor(X_ij / num_partitions)")
+    .Arg(
+        "num_threads",
+        "(int, default 1) Number of threads of the workspace pool that count "
+        "and scatter contiguous chunks of the elements in parallel. The "
+        "result does not depend on it.")
     .Input(
         0,
         "input",
@@ -17,8 +17,12 @@
 #ifndef CAFFE2_OPERATORS_PARTITION_OPS_H_
 #define CAFFE2_OPERATORS_PARTITION_OPS_H_
 
+#include <algorithm>
+#include <cstring>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/utils/run_chunks.h"
 
 namespace caffe2 {
 
@@ -123,9 +127,20 @@ class PartitionOpBase : public Operator<CPUContext> {
 
   PartitionOpBase(const OperatorDef& operator_def, Workspace* ws)
       : Operator<CPUContext>(operator_def, ws),
-        OP_SINGLE_ARG(int, "pack_first_input", pack_first_input_, 0) {}
+        OP_SINGLE_ARG(int, "pack_first_input", pack_first_input_, 0),
+        OP_SINGLE_ARG(int, "num_threads", num_threads_, 1),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
 
  protected:
+  // A counting sort of the elements of the main input by shard, stable so
+  // the elements of a shard keep their order. The elements are cut into
+  // contiguous chunks, processed in parallel: each chunk counts its elements
+  // per shard, the counts are turned into per chunk write offsets, and each
+  // chunk then scatters its elements, along with the matching blocks of the
+  // other inputs, at its offsets. The shard of every element is kept in
+  // shards_ for LengthsPartition.
   template <typename Index>
   void ApplyPartition(bool skipFirstArgument) {
     CAFFE_ENFORCE_EQ(
@@ -140,10 +155,27 @@ class PartitionOpBase : public Operator<CPUContext> {
     auto& main_input = Input(mainInputIndex);
     TIndex size = main_input.size();
     const Index* data = main_input.template data<Index>();
-    counts_.assign(partitions, 0);
-    for (TIndex p = 0; p < size; p++) {
-      int shard = moduloPartition(data[p], partitions);
-      ++counts_[shard];
+    const int num_chunks = NumChunks(num_threads_, size, 1, kMinItemsPerChunk);
+
+    shards_.resize(size);
+    // counts_[c * partitions + j] is the number of elements of chunk c in
+    // shard j, and then where chunk c starts writing in shard j.
+    counts_.assign(num_chunks * partitions, 0);
+    RunChunks(ws_, num_chunks, size, [&](int c, TIndex begin, TIndex end) {
+      TIndex* counts = counts_.data() + c * partitions;
+      for (TIndex p = begin; p < end; p++) {
+        int shard = moduloPartition(data[p], partitions);
+        shards_[p] = shard;
+        ++counts[shard];
+      }
+    });
+    vector<TIndex> shard_sizes(partitions, 0);
+    for (TIndex c = 0; c < num_chunks; ++c) {
+      for (int j = 0; j < partitions; ++j) {
+        const TIndex count = counts_[c * partitions + j];
+        counts_[c * partitions + j] = shard_sizes[j];
+        shard_sizes[j] += count;
+      }
     }
 
     raw_datas_.resize(inputSize);
@@ -179,39 +211,50 @@ class PartitionOpBase : public Operator<CPUContext> {
       for (int j = 0; j < partitions; ++j) {
         int out_idx = i + j * inputSize;
         auto output = Output(out_idx);
-        shape[0] = counts_[j];
+        shape[0] = shard_sizes[j];
         output->Resize(shape);
         out_datas_[out_idx] = output->raw_mutable_data(input.meta());
       }
     }
 
-    counts_.assign(partitions, 0);
-    for (TIndex p = 0; p < size; p++) {
-      int shard = moduloPartition(data[p], partitions);
-      TIndex idx = counts_[shard]++;
-
-      // special case first input
-      static_cast<Index*>(out_datas_[shard * inputSize + mainInputIndex])[idx] =
-          pack_first_input_ ? ((data[p] - shard) / partitions) : data[p];
-
-      int baseIndex = shard * inputSize;
-      for (int i = mainInputIndex + 1; i < inputSize; ++i) {
-        auto bs = block_sizes_[i];
-        auto meta = metas_[i];
-        // special case for small bs?
-        context_.template CopyItems<CPUContext, CPUContext>(
-            meta,
-            bs,
-            static_cast<const char*>(raw_datas_[i]) + p * bs * meta.itemsize(),
-            static_cast<char*>(out_datas_[baseIndex + i]) +
-                idx * bs * meta.itemsize());
+    RunChunks(ws_, num_chunks, size, [&](int c, TIndex begin, TIndex end) {
+      TIndex* offsets = counts_.data() + c * partitions;
+      for (TIndex p = begin; p < end; p++) {
+        int shard = shards_[p];
+        TIndex idx = offsets[shard]++;
+
+        // special case first input
+        static_cast<Index*>(
+            out_datas_[shard * inputSize + mainInputIndex])[idx] =
+            pack_first_input_ ? ((data[p] - shard) / partitions) : data[p];
+
+        int baseIndex = shard * inputSize;
+        for (int i = mainInputIndex + 1; i < inputSize; ++i) {
+          auto bs = block_sizes_[i];
+          const auto& meta = metas_[i];
+          const char* src = static_cast<const char*>(raw_datas_[i]) +
+              p * bs * meta.itemsize();
+          char* dst = static_cast<char*>(out_datas_[baseIndex + i]) +
+              idx * bs * meta.itemsize();
+          if (meta.copy()) {
+            meta.copy()(src, dst, bs);
+          } else {
+            memcpy(dst, src, bs * meta.itemsize());
+          }
+        }
       }
-    }
+    });
   }
 
+  // Fewer elements than this per thread are not worth the dispatch overhead.
+  static constexpr TIndex kMinItemsPerChunk = 4096;
+
   bool pack_first_input_;
+  int num_threads_;
+  Workspace* ws_;
 
   // use member fields to reuse memory
+  vector<int> shards_;
   vector<TIndex> counts_;
   vector<TIndex> block_sizes_;
   vector<TypeMeta> metas_;
@@ -270,7 +313,6 @@ class LengthsPartitionOp : public PartitionOpBase {
     // Compute lengths after sharding
     auto& main_input = Input(1);
     TIndex size = main_input.size();
-    const Index* data = main_input.template data<Index>();
 
     auto& length_input = Input(0);
     TIndex elements = length_input.size();
@@ -290,14 +332,14 @@ class LengthsPartitionOp : public PartitionOpBase {
         total_length == size,
         "Total length is not matching to the number of elements");
 
+    // The shards were computed by ApplyPartition.
     int index = 0;
     for (int i = 0; i < elements; ++i) {
       for (int j = 0; j < partitions; ++j) {
         out_length_[j][i] = 0;
       }
       for (int j = 0; j < lengths_data[i]; ++j, ++index) {
-        int shard = moduloPartition(data[index], partitions);
-        ++out_length_[shard][i];
+        ++out_length_[shards_[index]][i];
       }
     }
     return true;
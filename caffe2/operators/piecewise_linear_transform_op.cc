@@ -16,8 +16,71 @@
 
 #include "caffe2/operators/piecewise_linear_transform_op.h"
 
+#include "caffe2/perfkernels/dense_normalization.h"
+#include "caffe2/utils/run_chunks.h"
+
 namespace caffe2 {
 
+template <>
+bool PiecewiseLinearTransformOp<float, CPUContext>::TransformGeneral() {
+  auto& X = Input(0);
+  auto* Y = Output(0);
+  CAFFE_ENFORCE_EQ(X.ndim(), 2);
+  const TIndex N = X.dim(0);
+  const TIndex M = X.dim(1);
+  Y->ResizeLike(X);
+  const float* Xdata = X.data<float>();
+  float* Ydata = Y->mutable_data<float>();
+
+  const float* bounds;
+  const float* slopes;
+  const float* intercepts;
+  TIndex num_func_per_group;
+  TIndex num_group;
+  GetTransParamData(
+      &bounds, &slopes, &intercepts, &num_func_per_group, &num_group);
+  CAFFE_ENFORCE_EQ(num_group, M);
+
+  // Interleaves the groups, so that the parameters of consecutive columns
+  // are loaded together. Parameters from args are interleaved only once.
+  const TIndex P = num_func_per_group;
+  if (!transform_param_from_arg_ || interleaved_slopes_.empty()) {
+    interleaved_bounds_.resize(M * (P + 1));
+    interleaved_slopes_.resize(M * P);
+    interleaved_intercepts_.resize(M * P);
+    for (TIndex j = 0; j < M; ++j) {
+      for (TIndex k = 0; k <= P; ++k) {
+        interleaved_bounds_[k * M + j] = bounds[j * (P + 1) + k];
+      }
+      for (TIndex k = 0; k < P; ++k) {
+        interleaved_slopes_[k * M + j] = slopes[j * P + k];
+        interleaved_intercepts_[k * M + j] = intercepts[j * P + k];
+      }
+    }
+  }
+
+  RunColumnChunks(
+      ws_,
+      num_threads_,
+      N,
+      M,
+      [&](TIndex row_begin, TIndex row_end, TIndex col_begin, TIndex col_end) {
+        const TIndex offset = row_begin * M + col_begin;
+        piecewise_linear(
+            row_end - row_begin,
+            col_end - col_begin,
+            M,
+            Xdata + offset,
+            P,
+            M,
+            interleaved_bounds_.data() + col_begin,
+            interleaved_slopes_.data() + col_begin,
+            interleaved_intercepts_.data() + col_begin,
+            Ydata + offset);
+      });
+  return true;
+}
+
 REGISTER_CPU_OPERATOR(
     PiecewiseLinearTransform,
     PiecewiseLinearTransformOp<float, CPUContext>);
@@ -70,6 +133,11 @@ bound.
         "first column is negative predictions and second column is positive "
         "and negative + positive = 1. We just need one group of piecewise "
         "linear functions for the positive predictions.")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the predictions are "
+        "split over, by blocks of columns, when binary is false. Defaults "
+        "to 1.")
     .Input(
         0,
         "predictions",
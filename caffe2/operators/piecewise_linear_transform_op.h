@@ -28,8 +28,11 @@ class PiecewiseLinearTransformOp final : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
 
   PiecewiseLinearTransformOp(const OperatorDef& operator_def, Workspace* ws)
-      : Operator<Context>(operator_def, ws) {
+      : Operator<Context>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
     binary_ = OperatorBase::GetSingleArgument<bool>("binary", false);
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
 
     // Retrieve transform params (i.e., the linear functions).
     bounds_from_arg_ = OperatorBase::GetRepeatedArgument<T>("bounds");
@@ -146,6 +149,7 @@ class PiecewiseLinearTransformOp final : public Operator<Context> {
         num_bounds, num_slopes, num_intercepts, num_func_per_group, num_group);
   }
 
+  // Specialized for float on CPU, see piecewise_linear_transform_op.cc.
   bool TransformGeneral() {
     auto& X = Input(0);
     auto* Y = Output(0);
@@ -254,6 +258,14 @@ class PiecewiseLinearTransformOp final : public Operator<Context> {
   Tensor<Context> slopes_device_;
   bool gpu_copied_ = false;
 
+  int num_threads_;
+  Workspace* ws_;
+  // The parameters with the groups interleaved, for the CPU float
+  // implementation, see piecewise_linear in perfkernels/dense_normalization.h.
+  vector<T> interleaved_bounds_;
+  vector<T> interleaved_slopes_;
+  vector<T> interleaved_intercepts_;
+
   // If true, the piecewise linear functions are passed through args,
   // otherwise, they are passed through Input blobs.
   bool transform_param_from_arg_;
@@ -342,10 +342,31 @@ class AveragePool {
     y_data += x_data;
   }
 
+  // y_data[i] += x_data[i * stride] for the n outputs.
+  static void
+  process(const int n, const int stride, const T* x_data, T* y_data) {
+    if (stride == 1) {
+      EigenVectorArrayMap<T>(y_data, n) +=
+          ConstEigenVectorArrayMap<T>(x_data, n);
+      return;
+    }
+    for (int i = 0; i < n; ++i) {
+      y_data[i] += x_data[i * stride];
+    }
+  }
+
   static void finalize(const int size, T& y_data) {
     y_data /= size;
   }
 
+  static void finalize(const int n, const int size, T* y_data) {
+    EigenVectorArrayMap<T>(y_data, n) /= static_cast<T>(size);
+  }
+
+  static T reduce(const int size, const T* x_data) {
+    return ConstEigenVectorArrayMap<T>(x_data, size).sum() / size;
+  }
+
   static void
   finalize(const int size, const int col, EigenMatrixMap<float>& y_mat) {
     y_mat.col(col) /= size;
@@ -417,8 +438,27 @@ class MaxPool {
     }
   }
 
+  // y_data[i] = max(y_data[i], x_data[i * stride]) for the n outputs.
+  static void
+  process(const int n, const int stride, const T* x_data, T* y_data) {
+    if (stride == 1) {
+      EigenVectorArrayMap<T> y_arr(y_data, n);
+      y_arr = y_arr.max(ConstEigenVectorArrayMap<T>(x_data, n));
+      return;
+    }
+    for (int i = 0; i < n; ++i) {
+      y_data[i] = std::max(y_data[i], x_data[i * stride]);
+    }
+  }
+
   static void finalize(const int /*size*/, T& /*y_data*/) {}
 
+  static void finalize(const int /*n*/, const int /*size*/, T* /*y_data*/) {}
+
+  static T reduce(const int size, const T* x_data) {
+    return ConstEigenVectorArrayMap<T>(x_data, size).maxCoeff();
+  }
+
   static void finalize(
       const int /*size*/,
       const int /*col*/,
@@ -469,6 +509,156 @@ class MaxPool {
   }
 };
 
+namespace {
+
+struct Pool2DParams {
+  int height;
+  int width;
+  int pooled_height;
+  int pooled_width;
+  int kernel_h;
+  int kernel_w;
+  int stride_h;
+  int stride_w;
+  int pad_t;
+  int pad_l;
+};
+
+// The range [begin, end) of the outputs along one dimension whose window lies
+// inside the input, and needs no clipping.
+void InteriorRange(
+    int size,
+    int pooled_size,
+    int kernel,
+    int stride,
+    int pad,
+    int* begin,
+    int* end) {
+  *begin = min((pad + stride - 1) / stride, pooled_size);
+  *end = *begin;
+  if (size + pad >= kernel) {
+    *end = max(*begin, min((size + pad - kernel) / stride + 1, pooled_size));
+  }
+}
+
+// 2D pooling of one NCHW plane. Every output row is computed at once for the
+// columns whose window lies inside the input: the kernel_w shifted views of
+// each input row of the window are combined with the output row, so that the
+// inner loops run over the output columns without bounds checks and
+// vectorize across the width. Only the few border columns clip their window.
+// kKernelW and kStrideW fix the kernel width and stride for the common
+// configurations, 0 means they are read from the parameters.
+template <typename PoolType, int kKernelW, int kStrideW>
+void RunPool2DPlaneNCHW(const Pool2DParams& p, const float* X, float* Y) {
+  const int kernel_w = kKernelW > 0 ? kKernelW : p.kernel_w;
+  const int stride_w = kStrideW > 0 ? kStrideW : p.stride_w;
+  int pw_begin, pw_end;
+  InteriorRange(
+      p.width, p.pooled_width, kernel_w, stride_w, p.pad_l, &pw_begin, &pw_end);
+  const int interior = pw_end - pw_begin;
+  for (int ph = 0; ph < p.pooled_height; ++ph) {
+    int hstart = ph * p.stride_h - p.pad_t;
+    int hend = min(hstart + p.kernel_h, p.height);
+    hstart = max(hstart, 0);
+    float* Yrow = Y + ph * p.pooled_width;
+
+    if (interior > 0) {
+      std::fill(Yrow + pw_begin, Yrow + pw_end, PoolType::initialize());
+      for (int h = hstart; h < hend; ++h) {
+        const float* Xrow = X + h * p.width + pw_begin * stride_w - p.pad_l;
+        for (int w = 0; w < kernel_w; ++w) {
+          PoolType::process(interior, stride_w, Xrow + w, Yrow + pw_begin);
+        }
+      }
+      PoolType::finalize(
+          interior, (hend - hstart) * kernel_w, Yrow + pw_begin);
+    }
+
+    auto pool_border = [&](int pw) {
+      int wstart = pw * stride_w - p.pad_l;
+      int wend = min(wstart + kernel_w, p.width);
+      wstart = max(wstart, 0);
+      float Yh = PoolType::initialize();
+      for (int h = hstart; h < hend; ++h) {
+        for (int w = wstart; w < wend; ++w) {
+          PoolType::process(X[h * p.width + w], Yh);
+        }
+      }
+      PoolType::finalize((hend - hstart) * (wend - wstart), Yh);
+      Yrow[pw] = Yh;
+    };
+    for (int pw = 0; pw < pw_begin; ++pw) {
+      pool_border(pw);
+    }
+    for (int pw = pw_end; pw < p.pooled_width; ++pw) {
+      pool_border(pw);
+    }
+  }
+}
+
+template <typename PoolType>
+void RunPool2DNCHW(
+    const Pool2DParams& p,
+    int num_planes,
+    const float* X,
+    float* Y) {
+  const int input_size = p.height * p.width;
+  const int output_size = p.pooled_height * p.pooled_width;
+  // Global pooling, each plane is reduced to a single value.
+  if (output_size == 1 && p.pad_t == 0 && p.pad_l == 0 &&
+      p.kernel_h >= p.height && p.kernel_w >= p.width) {
+    for (int i = 0; i < num_planes; ++i) {
+      Y[i] = PoolType::reduce(input_size, X + i * input_size);
+    }
+    return;
+  }
+  auto* run_plane = &RunPool2DPlaneNCHW<PoolType, 0, 0>;
+  if (p.kernel_w == 2 && p.stride_w == 2) {
+    run_plane = &RunPool2DPlaneNCHW<PoolType, 2, 2>;
+  } else if (p.kernel_w == 3 && p.stride_w == 2) {
+    run_plane = &RunPool2DPlaneNCHW<PoolType, 3, 2>;
+  } else if (p.kernel_w == 3 && p.stride_w == 1) {
+    run_plane = &RunPool2DPlaneNCHW<PoolType, 3, 1>;
+  }
+  for (int i = 0; i < num_planes; ++i) {
+    run_plane(p, X + i * input_size, Y + i * output_size);
+  }
+}
+
+// 2D pooling of one NHWC image. The pixels of a window are combined a whole
+// pixel at a time, so that the inner loop runs over the contiguous channels
+// and vectorizes across them.
+template <typename PoolType>
+void RunPool2DImageNHWC(
+    const Pool2DParams& p,
+    int channels,
+    const float* X,
+    float* Y) {
+  for (int ph = 0; ph < p.pooled_height; ++ph) {
+    int hstart = ph * p.stride_h - p.pad_t;
+    int hend = min(hstart + p.kernel_h, p.height);
+    hstart = max(hstart, 0);
+    for (int pw = 0; pw < p.pooled_width; ++pw) {
+      int wstart = pw * p.stride_w - p.pad_l;
+      int wend = min(wstart + p.kernel_w, p.width);
+      wstart = max(wstart, 0);
+      float* Ypixel = Y + (ph * p.pooled_width + pw) * channels;
+      EigenVectorArrayMap<float>(Ypixel, channels)
+          .setConstant(PoolType::initialize());
+      for (int h = hstart; h < hend; ++h) {
+        for (int w = wstart; w < wend; ++w) {
+          PoolType::process(
+              channels, 1, X + (h * p.width + w) * channels, Ypixel);
+        }
+      }
+      PoolType::finalize(
+          channels, (hend - hstart) * (wend - wstart), Ypixel);
+    }
+  }
+}
+
+} // namespace
+
 template <typename T, class Context, typename PoolType>
 bool PoolOp<T, Context, PoolType>::RunOnDeviceWithOrderNCHW() {
   auto& X = Input(0);
@@ -532,33 +722,20 @@ bool PoolOp<T, Context, PoolType>::RunOnDeviceWithOrderNCHW() {
       }
       break;
     case 2:
-      for (int n = 0; n < X.dim32(0); ++n) {
-        for (int c = 0; c < channels; ++c) {
-          for (int ph = 0; ph < pooled_height; ++ph) {
-            int hstart = ph * stride_h() - pad_t();
-            int hend = min(hstart + kernel_h(), height);
-            hstart = max(hstart, 0);
-            for (int pw = 0; pw < pooled_width; ++pw) {
-              int wstart = pw * stride_w() - pad_l();
-              int wend = min(wstart + kernel_w(), width);
-              wstart = max(wstart, 0);
-              const int pool_index = ph * pooled_width + pw;
-              T Yh = PoolType::initialize();
-              for (int h = hstart; h < hend; ++h) {
-                for (int w = wstart; w < wend; ++w) {
-                  const int input_index = h * width + w;
-                  PoolType::process(Xdata[input_index], Yh);
-                }
-              }
-              PoolType::finalize((hend - hstart) * (wend - wstart), Yh);
-              Ydata[pool_index] = Yh;
-            }
-          }
-          // Do offset.
-          Xdata += height * width;
-          Ydata += pooled_height * pooled_width;
-        }
-      }
+      RunPool2DNCHW<PoolType>(
+          {height,
+           width,
+           pooled_height,
+           pooled_width,
+           kernel_h(),
+           kernel_w(),
+           stride_h(),
+           stride_w(),
+           pad_t(),
+           pad_l()},
+          X.dim32(0) * channels,
+          Xdata,
+          Ydata);
       break;
     case 3:
       for (int n = 0; n < X.dim32(0); ++n) {
@@ -640,29 +817,27 @@ bool PoolOp<T, Context, PoolType>::RunOnDeviceWithOrderNHWC() {
         }
       }
       break;
-    case 2:
+    case 2: {
+      const Pool2DParams params{height,
+                                width,
+                                pooled_height,
+                                pooled_width,
+                                kernel_h(),
+                                kernel_w(),
+                                stride_h(),
+                                stride_w(),
+                                pad_t(),
+                                pad_l()};
       for (int n = 0; n < X.dim32(0); ++n) {
-        for (int ph = 0; ph < pooled_height; ++ph) {
-          int hstart = ph * stride_h() - pad_t();
-          int hend = min(hstart + kernel_h(), height);
-          hstart = max(hstart, 0);
-          for (int pw = 0; pw < pooled_width; ++pw) {
-            int wstart = pw * stride_w() - pad_l();
-            int wend = min(wstart + kernel_w(), width);
-            wstart = max(wstart, 0);
-            const int y_col = (n * pooled_height + ph) * pooled_width + pw;
-            Ymat.col(y_col).setConstant(PoolType::initialize());
-            for (int h = hstart; h < hend; ++h) {
-              for (int w = wstart; w < wend; ++w) {
-                const int x_col = (n * height + h) * width + w;
-                PoolType::process(x_col, y_col, Xmat, Ymat);
-              }
-            }
-            PoolType::finalize((hend - hstart) * (wend - wstart), y_col, Ymat);
-          }
-        }
+        RunPool2DImageNHWC<PoolType>(
+            params,
+            channels,
+            X.template data<float>() + n * height * width * channels,
+            Y->template mutable_data<float>() +
+                n * pooled_height * pooled_width * channels);
       }
       break;
+    }
     case 3:
       for (int n = 0; n < X.dim32(0); ++n) {
         for (int ph = 0; ph < pooled_height; ++ph) {
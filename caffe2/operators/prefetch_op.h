@@ -20,19 +20,34 @@
 #include <condition_variable>
 #include <mutex>
 #include <thread> // NOLINT
+#include <vector>
 
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
 
 namespace caffe2 {
 
-// PrefetchOperator is an operator that prefetches the next batch. It should
+// PrefetchOperator is an operator that prefetches the next batches. It should
 // almost always be used to read things from disk, so I am setting the input to
 // zero blobs.
 //
 // For any operator that is derived from PrefetchOperator, it should
 // explicitly call the Finalize() function in its destructor, so that the
-// prefetching thread is properly destructed.
+// prefetching threads are properly destructed.
+//
+// By default a single background thread fills a single buffer, and the next
+// batch is only fetched once the previous one has been copied out. Derived
+// classes that keep their prefetched data in several numbered buffers override
+// SupportsPrefetchBuffers(), PrefetchBuffer() and CopyPrefetchedBuffer(); the
+// "prefetch_depth" argument then sets how many batches are kept ready ahead of
+// Run(), and "num_prefetch_threads" how many of them are filled concurrently.
+// Batches are still handed out in the order in which they were started.
+//
+// The time spent filling buffers, copying them out and waiting for them is
+// exported through the stats registry, under the operator name (or its first
+// output if the operator has no name). Derived classes add the read and
+// decode stages of their Prefetch with CAFFE_DURATION on stats_.
 
 // Note: We inherit from OperatorBase since we control the
 // synchronization properties of this operator ourselves (we inform
@@ -44,60 +59,83 @@ class PrefetchOperator : public OperatorBase {
   PrefetchOperator(const OperatorDef& operator_def, Workspace* ws)
       : OperatorBase(operator_def, ws),
         context_(operator_def.device_option()),
-        prefetched_(false),
-        prefetch_success_(true),
-        finalize_(false) {
+        prefetch_depth_(
+            OperatorBase::GetSingleArgument<int>("prefetch_depth", 1)),
+        num_prefetch_threads_(
+            OperatorBase::GetSingleArgument<int>("num_prefetch_threads", 1)),
+        buffers_(prefetch_depth_),
+        finalize_(false),
+        stats_(StatsName(operator_def)) {
+    CAFFE_ENFORCE_GE(prefetch_depth_, 1, "prefetch_depth must be positive.");
+    CAFFE_ENFORCE_GE(
+        num_prefetch_threads_, 1, "num_prefetch_threads must be positive.");
+    CAFFE_ENFORCE_LE(
+        num_prefetch_threads_,
+        prefetch_depth_,
+        "Every prefetch thread needs a buffer of its own.");
     context_.SwitchToDevice(0);
   }
 
   virtual ~PrefetchOperator() noexcept {
-    CHECK(finalize_ || !prefetch_thread_.get()) <<
+    CHECK(finalize_ || prefetch_threads_.empty()) <<
         "YOU MADE A PROGRAMING ERROR: derived class of PrefetchOperator "
         "should call Finalize() in its destructor so the prefetching "
-        "thread is joined. ";
+        "threads are joined. ";
   }
 
   void Finalize() {
-    if (prefetch_thread_.get()) {
-      {
-        std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
-        while (!prefetched_)
-          consumer_.wait(lock);
-        finalize_ = true;
-        prefetched_ = false;
-      }
-      producer_.notify_one();
-      prefetch_thread_->join();
-      prefetch_thread_.reset();
-    } else {
-      // If we never initialized the prefetch thread, just set
-      // finalize anyway.
+    {
+      std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
       finalize_ = true;
     }
+    producer_.notify_all();
+    // Buffers that are being filled are completed before the threads quit.
+    for (auto& thread : prefetch_threads_) {
+      thread.join();
+    }
+    prefetch_threads_.clear();
   }
 
   bool Run(int /* unused */ /*stream_id*/) override {
-    // Note(jiayq): We only start the prefetch_thread at the Run() function
-    // instead of in the constructor, because the prefetch_thread needs to start
-    // after all derived classes' constructors finish.
-    if (!prefetch_thread_) {
-      prefetch_thread_.reset(
-          new std::thread([this] { this->PrefetchWorker(); }));
+    // Note(jiayq): We only start the prefetch threads at the Run() function
+    // instead of in the constructor, because the prefetch threads need to
+    // start after all derived classes' constructors finish.
+    if (prefetch_threads_.empty()) {
+      CAFFE_ENFORCE(
+          prefetch_depth_ == 1 || SupportsPrefetchBuffers(),
+          "This operator only supports prefetch_depth 1.");
+      for (int i = 0; i < num_prefetch_threads_; ++i) {
+        prefetch_threads_.emplace_back([this] { this->PrefetchWorker(); });
+      }
     }
     context_.SwitchToDevice(0);
-    std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
-    while (!prefetched_)
-      consumer_.wait(lock);
-    if (!prefetch_success_) {
-      LOG(ERROR) << "Prefetching failed.";
-      return false;
+    const int buffer = next_copy_ % prefetch_depth_;
+    {
+      std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
+      CAFFE_DURATION(stats_, prefetch_wait_ns) {
+        consumer_.wait(lock, [&] { return buffers_[buffer].ready; });
+      }
+      if (!buffers_[buffer].success) {
+        LOG(ERROR) << "Prefetching failed.";
+        return false;
+      }
     }
-    if (!CopyPrefetched()) {
+    // The producers leave a ready buffer alone until next_copy_ moves past
+    // it, so it can be copied out without holding the lock.
+    bool copy_success = false;
+    CAFFE_DURATION(stats_, prefetch_copy_ns) {
+      copy_success = CopyPrefetchedBuffer(buffer);
+    }
+    if (!copy_success) {
       LOG(ERROR) << "Error when copying prefetched data.";
       return false;
     }
-    prefetched_ = false;
     context_.FinishDeviceComputation();
+    {
+      std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
+      buffers_[buffer].ready = false;
+      ++next_copy_;
+    }
     producer_.notify_one();
     return true;
   }
@@ -105,42 +143,99 @@ class PrefetchOperator : public OperatorBase {
   void PrefetchWorker() {
     context_.SwitchToDevice();
     std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
-    while (prefetched_)
-      producer_.wait(lock);
-    while (!finalize_) {
+    while (true) {
+      producer_.wait(lock, [this] {
+        return finalize_ || next_fill_ - next_copy_ < prefetch_depth_;
+      });
+      if (finalize_) {
+        return;
+      }
+      const int buffer = next_fill_++ % prefetch_depth_;
+      lock.unlock();
+      bool success = false;
       // We will need to run a FinishDeviceComputation() call because the
       // prefetcher thread and the main thread are potentially using different
       // streams (like on GPU).
       try {
-        prefetch_success_ = Prefetch();
+        CAFFE_DURATION(stats_, prefetch_fill_ns) {
+          success = PrefetchBuffer(buffer);
+        }
         context_.FinishDeviceComputation();
       } catch (const std::exception& e) {
         // TODO: propagate exception_ptr to the caller side
         LOG(ERROR) << "Prefetching error " << e.what();
-        prefetch_success_ = false;
+        success = false;
       }
-      prefetched_ = true;
+      CAFFE_EVENT(stats_, prefetch_batches);
+      lock.lock();
+      buffers_[buffer].success = success;
+      buffers_[buffer].ready = true;
       consumer_.notify_one();
-      while (prefetched_)
-        producer_.wait(lock);
     }
   }
 
   // You will need to implement this instead of the Run function.
-  virtual bool Prefetch() = 0;
-  virtual bool CopyPrefetched() = 0;
+  virtual bool Prefetch() {
+    CAFFE_THROW("Prefetch() or PrefetchBuffer() must be implemented.");
+  }
+  virtual bool CopyPrefetched() {
+    CAFFE_THROW(
+        "CopyPrefetched() or CopyPrefetchedBuffer() must be implemented.");
+  }
+
+  // Multi-buffer versions of Prefetch and CopyPrefetched. PrefetchBuffer can
+  // be called for different buffers from several threads at once, and
+  // concurrently with CopyPrefetchedBuffer on another buffer.
+  virtual bool SupportsPrefetchBuffers() const {
+    return false;
+  }
+  virtual bool PrefetchBuffer(int /* unused */ /*buffer*/) {
+    return Prefetch();
+  }
+  virtual bool CopyPrefetchedBuffer(int /* unused */ /*buffer*/) {
+    return CopyPrefetched();
+  }
 
  protected:
+  struct PrefetchStats {
+    CAFFE_STAT_CTOR(PrefetchStats);
+    CAFFE_EXPORTED_STAT(prefetch_batches);
+    CAFFE_EXPORTED_STAT(prefetch_fill_ns);
+    CAFFE_EXPORTED_STAT(prefetch_read_ns);
+    CAFFE_EXPORTED_STAT(prefetch_decode_ns);
+    CAFFE_EXPORTED_STAT(prefetch_copy_ns);
+    CAFFE_EXPORTED_STAT(prefetch_wait_ns);
+  };
+
+  struct PrefetchBufferState {
+    // ready is set once the buffer is filled, and cleared when it is copied.
+    bool ready = false;
+    bool success = true;
+  };
+
+  static std::string StatsName(const OperatorDef& operator_def) {
+    if (!operator_def.name().empty()) {
+      return operator_def.name();
+    }
+    return operator_def.output_size() > 0 ? operator_def.output(0)
+                                          : operator_def.type();
+  }
+
   Context context_;
+  const int prefetch_depth_;
+  const int num_prefetch_threads_;
   std::mutex prefetch_access_mutex_;
   std::condition_variable producer_, consumer_;
-  // prefetched_ is used to tell the operator that it is done.
-  std::atomic<bool> prefetched_;
-  // prefetch_success_ is used to see if prefetching failed or not.
-  std::atomic<bool> prefetch_success_;
-  // finalize_ is used to tell the prefetcher to quit.
-  std::atomic<bool> finalize_;
-  unique_ptr<std::thread> prefetch_thread_;
+  // All of the following are protected by prefetch_access_mutex_. Batch n is
+  // kept in buffer n % prefetch_depth_; next_fill_ is the next batch to be
+  // started by a prefetch thread and next_copy_ the next one Run() returns.
+  std::vector<PrefetchBufferState> buffers_;
+  int64_t next_fill_ = 0;
+  int64_t next_copy_ = 0;
+  // finalize_ is used to tell the prefetchers to quit.
+  bool finalize_;
+  std::vector<std::thread> prefetch_threads_;
+  PrefetchStats stats_;
 };
 
 } // namespace caffe2
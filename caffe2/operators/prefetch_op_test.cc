@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/db.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/core/workspace.h"
+
+namespace caffe2 {
+using namespace ::caffe2::db;
+namespace {
+
+// A DB whose source is the number of records; record i holds a single int
+// tensor with value i.
+class CountingCursor : public db::Cursor {
+ public:
+  explicit CountingCursor(int size) : size_(size) {}
+  void Seek(const string& /* unused */) override {}
+  void SeekToFirst() override {
+    pos_ = 0;
+  }
+  void Next() override {
+    ++pos_;
+  }
+  string key() override {
+    return caffe2::to_string(pos_);
+  }
+  string value() override {
+    TensorProtos protos;
+    auto* proto = protos.add_protos();
+    proto->set_data_type(TensorProto::INT32);
+    proto->add_dims(1);
+    proto->add_int32_data(pos_);
+    return protos.SerializeAsString();
+  }
+  bool Valid() override {
+    return pos_ < size_;
+  }
+
+ private:
+  const int size_;
+  int pos_ = 0;
+};
+
+class CountingDB : public db::DB {
+ public:
+  CountingDB(const string& source, db::Mode mode)
+      : DB(source, mode), size_(std::stoi(source)) {}
+  void Close() override {}
+  std::unique_ptr<db::Cursor> NewCursor() override {
+    return make_unique<CountingCursor>(size_);
+  }
+  std::unique_ptr<db::Transaction> NewTransaction() override {
+    CAFFE_THROW("Not implemented");
+  }
+
+ private:
+  const int size_;
+};
+
+REGISTER_CAFFE2_DB(prefetch_counting_db, CountingDB);
+
+// Runs TensorProtosDBInput on a DB of numRecords records and returns the
+// values of numBatches consecutive batches.
+std::vector<int> readBatches(
+    int numRecords,
+    int numBatches,
+    int batchSize,
+    int prefetchDepth,
+    int numPrefetchThreads) {
+  Workspace ws;
+  ws.CreateBlob("db")->GetMutable<db::DBReader>()->Open(
+      "prefetch_counting_db", caffe2::to_string(numRecords), 1, 0);
+
+  OperatorDef def;
+  def.set_name("input");
+  def.set_type("TensorProtosDBInput");
+  def.add_input("db");
+  def.add_output("batch");
+  auto addArg = [&](const string& name, int value) {
+    auto* arg = def.add_arg();
+    arg->set_name(name);
+    arg->set_i(value);
+  };
+  addArg("batch_size", batchSize);
+  addArg("prefetch_depth", prefetchDepth);
+  addArg("num_prefetch_threads", numPrefetchThreads);
+  auto op = CreateOperator(def, &ws);
+
+  std::vector<int> values;
+  for (int i = 0; i < numBatches; ++i) {
+    EXPECT_TRUE(op->Run());
+    const auto& batch = ws.GetBlob("batch")->Get<TensorCPU>();
+    EXPECT_EQ(batch.dims(), std::vector<TIndex>({batchSize, 1}));
+    values.insert(
+        values.end(), batch.data<int>(), batch.data<int>() + batch.size());
+  }
+  return values;
+}
+
+TEST(PrefetchOperatorTest, DeepPrefetchKeepsOrder) {
+  std::vector<int> expected(40);
+  for (int i = 0; i < expected.size(); ++i) {
+    expected[i] = i % 20;
+  }
+  EXPECT_EQ(readBatches(20, 10, 4, 1, 1), expected);
+  EXPECT_EQ(readBatches(20, 10, 4, 3, 1), expected);
+}
+
+TEST(PrefetchOperatorTest, ParallelPrefetchReadsEveryRecord) {
+  // Five batches of four records read every record of the DB exactly once,
+  // whichever thread read it.
+  auto values = readBatches(20, 5, 4, 4, 3);
+  std::sort(values.begin(), values.end());
+  std::vector<int> expected(20);
+  for (int i = 0; i < expected.size(); ++i) {
+    expected[i] = i;
+  }
+  EXPECT_EQ(values, expected);
+}
+
+TEST(PrefetchOperatorTest, ExportsStageTimings) {
+  StatRegistry::get().publish(true /* reset */);
+  readBatches(20, 3, 4, 2, 2);
+  ExportedStatList stats;
+  StatRegistry::get().publish(stats);
+  std::map<string, int64_t> values;
+  for (const auto& stat : stats) {
+    values[stat.key] = stat.value;
+  }
+  // At least the three batches that were returned and one more were filled.
+  EXPECT_GE(values["input/prefetch_batches"], 4);
+  for (const auto* stage : {"fill", "read", "decode", "copy"}) {
+    EXPECT_GT(values[string("input/prefetch_") + stage + "_ns"], 0) << stage;
+  }
+}
+
+TEST(PrefetchOperatorTest, RejectsMoreThreadsThanBuffers) {
+  Workspace ws;
+  OperatorDef def;
+  def.set_type("TensorProtosDBInput");
+  def.add_input("db");
+  def.add_output("batch");
+  auto* arg = def.add_arg();
+  arg->set_name("num_prefetch_threads");
+  arg->set_i(2);
+  EXPECT_THROW(CreateOperator(def, &ws), EnforceNotMet);
+}
+
+} // namespace
+} // namespace caffe2
@@ -18,6 +18,7 @@
 
 #include "caffe2/utils/cpu_neon.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/run_chunks.h"
 
 namespace caffe2 {
 
@@ -108,6 +109,53 @@ void runNeonPrelu(float* out, const float* in, int size, float w) {
 }
 #endif // __ARM_NEON__
 
+namespace {
+
+void runPrelu(float* out, const float* in, int size, float w) {
+#ifdef __ARM_NEON__
+  runNeonPrelu(out, in, size, w);
+#else
+  ConstEigenVectorMap<float> Xvec(in, size);
+  EigenVectorMap<float>(out, size) =
+      Xvec.cwiseMax(0.f) + Xvec.cwiseMin(0.f) * w;
+#endif // __ARM_NEON__
+}
+
+// Sets dX to dY where X > 0 and to w * dY elsewhere, and returns the sum of
+// dY * X where X <= 0, the gradient of w, in a single pass. The sum is kept
+// in kLanes independent partial sums so that the loop vectorizes.
+float runPreluGradient(
+    float* dX,
+    const float* dY,
+    const float* X,
+    int size,
+    float w) {
+  constexpr int kLanes = 8;
+  float partial[kLanes] = {0};
+  int i = 0;
+  for (; i + kLanes <= size; i += kLanes) {
+    for (int j = 0; j < kLanes; ++j) {
+      const float x = X[i + j];
+      const float dy = dY[i + j];
+      dX[i + j] = x > 0 ? dy : dy * w;
+      partial[j] += x > 0 ? 0.f : dy * x;
+    }
+  }
+  float sum = 0;
+  for (; i < size; ++i) {
+    const float x = X[i];
+    const float dy = dY[i];
+    dX[i] = x > 0 ? dy : dy * w;
+    sum += x > 0 ? 0.f : dy * x;
+  }
+  for (int j = 0; j < kLanes; ++j) {
+    sum += partial[j];
+  }
+  return sum;
+}
+
+} // namespace
+
 template <>
 bool PReluOp<float, CPUContext>::RunOnDevice() {
   const auto& X = Input(0);
@@ -126,14 +174,11 @@ bool PReluOp<float, CPUContext>::RunOnDevice() {
   }
 
   if (C_shared) {
-#ifdef __ARM_NEON__
     // The function is completely pointwise
-    runNeonPrelu(Ydata, Xdata, X.size(), Wdata[0]);
-#else
-    ConstEigenVectorMap<float> Xvec(Xdata, X.size());
-    EigenVectorMap<float> Yvec(Ydata, Y->size());
-    Yvec = Xvec.cwiseMax(0.f) + Xvec.cwiseMin(0.f) * Wdata[0];
-#endif // __ARM_NEON__
+    RunChunks(
+        ws_, num_threads_, X.size(), 1, [&](int, TIndex begin, TIndex end) {
+          runPrelu(Ydata + begin, Xdata + begin, end - begin, Wdata[0]);
+        });
     return true;
   }
 
@@ -142,36 +187,26 @@ bool PReluOp<float, CPUContext>::RunOnDevice() {
     case StorageOrder::NCHW: {
       const auto N = X.dim(0);
       const auto dim = X.size_from_dim(2);
-
-#ifdef __ARM_NEON__
-      // Pointwise for each channel
-      for (int n = 0; n < N; ++n) {
-        for (int c = 0; c < C; ++c) {
-          runNeonPrelu(Ydata + (n * C + c) * dim,
-                       Xdata + (n * C + c) * dim,
-                       dim, Wdata[c]);
-        }
-      }
-#else
-      int nc = 0;
-      for (int n = 0; n < N; ++n) {
-        for (int c = 0; c < C; ++c) {
-          ConstEigenVectorMap<float> Xvec(Xdata + nc * dim, dim);
-          EigenVectorMap<float>(Ydata + nc * dim, dim) =
-              Xvec.cwiseMax(0.f) + Xvec.cwiseMin(0.f) * Wdata[c];
-          nc++;
-        }
-      }
-#endif
+      // Pointwise for each (N, C) plane
+      RunChunks(
+          ws_, num_threads_, N * C, dim, [&](int, TIndex begin, TIndex end) {
+            for (auto nc = begin; nc < end; ++nc) {
+              runPrelu(
+                  Ydata + nc * dim, Xdata + nc * dim, dim, Wdata[nc % C]);
+            }
+          });
       break;
     }
     case StorageOrder::NHWC: {
       // Lay out matrix as (NHW, C) and multiply by C
       const auto NHW = X.size() / C;
-      ConstEigenArrayMap<float> Xmat(Xdata, C, NHW);
       ConstEigenVectorArrayMap<float> Wvec(Wdata, C);
-      EigenArrayMap<float> Ymat(Ydata, C, NHW);
-      Ymat = (Xmat > 0).select(Xmat, Xmat.colwise() * Wvec);
+      RunChunks(
+          ws_, num_threads_, NHW, C, [&](int, TIndex begin, TIndex end) {
+            ConstEigenArrayMap<float> Xmat(Xdata + begin * C, C, end - begin);
+            EigenArrayMap<float> Ymat(Ydata + begin * C, C, end - begin);
+            Ymat = (Xmat > 0).select(Xmat, Xmat.colwise() * Wvec);
+          });
       break;
     }
     default:
@@ -198,66 +233,87 @@ bool PReluGradientOp<float, CPUContext>::RunOnDevice() {
   const auto C = order_ == StorageOrder::NCHW ? X.dim(1) : X.dim(X.ndim() - 1);
   const auto C_shared = (W.size() == 1);
 
-  const float* Ydata = Y.data<float>();
   const float* dYdata = dY.data<float>();
   const float* Xdata = X.data<float>();
   const float* Wdata = W.data<float>();
   float* dXdata = dX->mutable_data<float>();
   float* dWdata = dW->mutable_data<float>();
 
+  // dX and dW are computed in the same pass over X and dY. Every chunk sums
+  // its own part of dW, and the parts are added up at the end.
+  if (C_shared) {
+    vector<float> partial(num_threads_, 0.f);
+    RunChunks(
+        ws_,
+        num_threads_,
+        X.size(),
+        1,
+        [&](int chunk, TIndex begin, TIndex end) {
+          partial[chunk] = runPreluGradient(
+              dXdata + begin,
+              dYdata + begin,
+              Xdata + begin,
+              end - begin,
+              Wdata[0]);
+        });
+    dWdata[0] = 0;
+    for (const auto v : partial) {
+      dWdata[0] += v;
+    }
+    return true;
+  }
+
   // non-shared case.
   switch (order_) {
     case StorageOrder::NCHW: {
+      const auto N = X.dim(0);
       const auto dim = X.size_from_dim(2);
-      const auto div_factor = C_shared ? C : 1;
-      for (auto c = 0; c < W.size(); ++c) {
-        dWdata[c] = 0;
-      }
-
-      for (int i = 0; i < Y.size(); ++i) {
-        if (Xdata[i] <= 0) {
-          int c = (i / dim) % C / div_factor;
-          dWdata[c] += dYdata[i] * Xdata[i];
-        }
-      }
-
-      for (int i = 0; i < Y.size(); ++i) {
-        if (Xdata[i] > 0) {
-          dXdata[i] = dYdata[i];
-        } else {
-          int c = (i / dim) % C / div_factor;
-          dXdata[i] = Wdata[c] * dYdata[i];
-        }
-      }
+      // Every chunk owns a range of channels of all the images.
+      RunChunks(
+          ws_,
+          num_threads_,
+          C,
+          N * dim,
+          [&](int /* unused */, TIndex begin, TIndex end) {
+            for (auto c = begin; c < end; ++c) {
+              float sum = 0;
+              for (int n = 0; n < N; ++n) {
+                const auto offset = (n * C + c) * dim;
+                sum += runPreluGradient(
+                    dXdata + offset,
+                    dYdata + offset,
+                    Xdata + offset,
+                    dim,
+                    Wdata[c]);
+              }
+              dWdata[c] = sum;
+            }
+          });
       break;
     }
     case StorageOrder::NHWC: {
       const auto NHW = X.size() / C;
-      ConstEigenVectorArrayMap<float> Wvec(Wdata, W.size());
-      EigenVectorArrayMap<float> dWvec(dWdata, dW->size());
-
-      ConstEigenArrayMap<float> Ymat(Ydata, C, NHW);
-      ConstEigenArrayMap<float> dYmat(dYdata, C, NHW);
-      ConstEigenArrayMap<float> Xmat(Xdata, C, NHW);
-      EigenArrayMap<float> dXmat(dXdata, C, NHW);
-
-      if (C_shared) {
-        dXmat = (Xmat > 0).select(dYmat, dYmat * Wdata[0]);
-        dWdata[0] =
-            (Xmat > 0)
-                .select(
-                    Xmat.cwiseMin(0.0f), // zero gradients on the 'if' path.
-                    dYmat * Xmat)
-                .sum();
-      } else {
-        dXmat = (Xmat > 0).select(dYmat, dYmat.colwise() * Wvec);
-        dWvec = (Xmat > 0)
-                    .select(
-                        Xmat.cwiseMin(0.0f), // zero gradients on the 'if' path.
-                        dYmat * Xmat)
-                    .rowwise()
-                    .sum();
-      }
+      vector<float> partial(num_threads_ * C, 0.f);
+      RunChunks(
+          ws_,
+          num_threads_,
+          NHW,
+          C,
+          [&](int chunk, TIndex begin, TIndex end) {
+            float* dWpartial = partial.data() + chunk * C;
+            for (auto i = begin * C; i < end * C; i += C) {
+              for (int c = 0; c < C; ++c) {
+                const float x = Xdata[i + c];
+                const float dy = dYdata[i + c];
+                dXdata[i + c] = x > 0 ? dy : dy * Wdata[c];
+                dWpartial[c] += x > 0 ? 0.f : dy * x;
+              }
+            }
+          });
+      EigenVectorArrayMap<float> dWvec(dWdata, C);
+      dWvec = ConstEigenArrayMap<float>(partial.data(), C, num_threads_)
+                  .rowwise()
+                  .sum();
       break;
     }
     default:
@@ -289,6 +345,10 @@ output data (Tensor<T>) where the function `f(x) = slope * x for x < 0`,
         "Slope",
         "1D slope tensor. If `Slope` is of size 1, the value is shared"
         "across different channels")
+    .Arg(
+        "num_threads",
+        "(int, default 1) Number of threads of the workspace pool the CPU "
+        "implementation splits the input over.")
     .Output(0, "Y", "1D input tensor");
 
 // Input: Y, dY, output: dX
@@ -28,7 +28,11 @@ class PReluOp final : public Operator<Context> {
   PReluOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
         order_(StringToStorageOrder(
-            OperatorBase::GetSingleArgument<string>("order", "NCHW"))) {}
+            OperatorBase::GetSingleArgument<string>("order", "NCHW"))),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
 
   USE_OPERATOR_CONTEXT_FUNCTIONS;
 
@@ -36,6 +40,8 @@ class PReluOp final : public Operator<Context> {
 
  protected:
   StorageOrder order_;
+  int num_threads_;
+  Workspace* ws_;
 };
 
 template <typename T, class Context>
@@ -44,13 +50,19 @@ class PReluGradientOp final : public Operator<Context> {
   PReluGradientOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
         order_(StringToStorageOrder(
-            OperatorBase::GetSingleArgument<string>("order", "NCHW"))) {}
+            OperatorBase::GetSingleArgument<string>("order", "NCHW"))),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
   USE_OPERATOR_CONTEXT_FUNCTIONS;
 
   bool RunOnDevice() override;
 
  protected:
   StorageOrder order_;
+  int num_threads_;
+  Workspace* ws_;
 };
 
 } // namespace caffe2
@@ -16,6 +16,8 @@
 
 #include "caffe2/operators/recurrent_network_executor.h"
 
+#include <algorithm>
+
 #include "caffe2/core/timer.h"
 
 namespace caffe2 {
@@ -33,6 +35,16 @@ std::unique_ptr<RecurrentNetworkExecutorBase> createRNNExecutor<CPUContext>(
     exec->setNumThreads(num_threads);
     LOG(INFO) << "Set num threads: " << num_threads;
   }
+  int max_parallel_timesteps = rnn_args.GetSingleArgument<int>(
+      "rnn_executor.max_parallel_timesteps", -1);
+  if (max_parallel_timesteps > 0) {
+    exec->SetMaxParallelTimesteps(max_parallel_timesteps);
+  }
+  if (rnn_args.GetSingleArgument<int>(
+          "rnn_executor.use_executor_pool",
+          FLAGS_caffe2_net_use_executor_pool)) {
+    exec->setExecutorPool(GetExecutorPool());
+  }
   exec->debug_ = rnn_args.GetSingleArgument<int>("rnn_executor_debug", 0);
   return std::unique_ptr<RecurrentNetworkExecutorBase>(exec);
 }
@@ -40,14 +52,14 @@ std::unique_ptr<RecurrentNetworkExecutorBase> createRNNExecutor<CPUContext>(
 bool ThreadedRecurrentNetworkExecutor::Run(int T) {
   CAFFE_ENFORCE(timestep_ops_.size() >= T);
   countdown_ = T * timestep_ops_[0].size();
-  finished_timesteps_ = 0;
+  ResetTimesteps(T);
 
   // Frontier
   CHECK(job_queue_.size() == 0);
 
   for (auto& rnn_op : timestep_ops_[0]) {
     if (rnn_op.frontier) {
-      job_queue_.Push(OpJob(0, rnn_op.order, T, 1));
+      ScheduleJob(OpJob(0, rnn_op.order, T, 1));
     }
   }
 
@@ -58,14 +70,14 @@ bool ThreadedRecurrentNetworkExecutor::Run(int T) {
 bool ThreadedRecurrentNetworkExecutor::RunBackwards(int T) {
   CAFFE_ENFORCE(timestep_ops_.size() >= T);
   countdown_ = T * timestep_ops_[0].size();
-  finished_timesteps_ = 0;
+  ResetTimesteps(T);
 
   // Frontier
   CHECK(job_queue_.size() == 0);
 
   for (auto& rnn_op : timestep_ops_[T - 1]) {
     if (rnn_op.frontier) {
-      job_queue_.Push(OpJob(T - 1, rnn_op.order, T, -1));
+      ScheduleJob(OpJob(T - 1, rnn_op.order, T, -1));
     }
   }
 
@@ -124,10 +136,14 @@ void ThreadedRecurrentNetworkExecutor::RunOp(OpJob job, int thread_id) {
     }
 
     if (proc_inputs == num_req_inputs || num_req_inputs == 0) {
-      job_queue_.Push(OpJob(t, depidx, job.T, job.direction));
+      ScheduleJob(OpJob(t, depidx, job.T, job.direction));
     }
   }
 
+  if (max_parallel_timesteps_ > 0) {
+    FinishJob(job);
+  }
+
   if (countdown_.fetch_sub(1) == 1) {
     CAFFE_ENFORCE_EQ(0, job_queue_.size());
     std::unique_lock<std::mutex> lk(countdown_mtx_);
@@ -135,6 +151,100 @@ void ThreadedRecurrentNetworkExecutor::RunOp(OpJob job, int thread_id) {
   }
 }
 
+void ThreadedRecurrentNetworkExecutor::ScheduleJob(OpJob job) {
+  if (!executor_pool_) {
+    job_queue_.Push(job);
+    return;
+  }
+  inflight_jobs_.fetch_add(1);
+  executor_pool_->runTask([this, job]() {
+    if (!failed_) {
+      ProcessJob(job, -1);
+    }
+    if (inflight_jobs_.fetch_sub(1) == 1) {
+      std::unique_lock<std::mutex> lk(countdown_mtx_);
+      cv_.notify_all();
+    }
+  });
+}
+
+void ThreadedRecurrentNetworkExecutor::ResetTimesteps(int T) {
+  finished_timesteps_ = 0;
+  deferred_jobs_.clear();
+  if (max_parallel_timesteps_ <= 0) {
+    return;
+  }
+  pending_timestep_ops_.reset(new std::atomic<int>[T]);
+  for (int t = 0; t < T; t++) {
+    pending_timestep_ops_[t] = timestep_ops_[0].size();
+  }
+}
+
+bool ThreadedRecurrentNetworkExecutor::AdmitJob(const OpJob& job) {
+  int t = job.forward() ? job.timestep : job.T - 1 - job.timestep;
+  if (t < finished_timesteps_ + max_parallel_timesteps_) {
+    return true;
+  }
+  // Check again under the lock, FinishJob() might have just advanced the
+  // finished timesteps without seeing this job.
+  std::lock_guard<std::mutex> lk(deferred_mtx_);
+  if (t < finished_timesteps_ + max_parallel_timesteps_) {
+    return true;
+  }
+  deferred_jobs_.push_back(job);
+  return false;
+}
+
+void ThreadedRecurrentNetworkExecutor::FinishJob(const OpJob& job) {
+  int t = job.forward() ? job.timestep : job.T - 1 - job.timestep;
+  if (pending_timestep_ops_[t].fetch_sub(1) != 1) {
+    return;
+  }
+  std::vector<OpJob> ready;
+  {
+    std::lock_guard<std::mutex> lk(deferred_mtx_);
+    int finished = finished_timesteps_;
+    while (finished < job.T && pending_timestep_ops_[finished] == 0) {
+      finished++;
+    }
+    finished_timesteps_ = finished;
+    auto it = std::partition(
+        deferred_jobs_.begin(), deferred_jobs_.end(), [&](const OpJob& j) {
+          int s = j.forward() ? j.timestep : j.T - 1 - j.timestep;
+          return s >= finished + max_parallel_timesteps_;
+        });
+    ready.assign(it, deferred_jobs_.end());
+    deferred_jobs_.erase(it, deferred_jobs_.end());
+  }
+  for (auto& ready_job : ready) {
+    ScheduleJob(ready_job);
+  }
+}
+
+bool ThreadedRecurrentNetworkExecutor::ProcessJob(OpJob job, int thread_id) {
+  // Check for limited timestep parallelism. Jobs of timesteps too far
+  // ahead are parked until enough of the earlier timesteps finished, so a
+  // layer can run ahead of the layers above it only by a bounded number of
+  // timesteps.
+  if (max_parallel_timesteps_ > 0 && !AdmitJob(job)) {
+    return true;
+  }
+
+  try {
+    RunOp(job, thread_id);
+  } catch (::caffe2::EnforceNotMet& enf) {
+    std::unique_lock<std::mutex> lk(countdown_mtx_);
+    LOG(ERROR) << "Crash at thread " << thread_id << " timestep "
+               << job.timestep << " op:"
+               << ProtoDebugString(step_net_def_.op(job.op_idx)) << enf.what();
+    job_queue_.NoMoreJobs();
+    failed_ = true;
+    cv_.notify_one();
+    return false;
+  }
+  return true;
+}
+
 void ThreadedRecurrentNetworkExecutor::WorkerFunction() {
   size_t num_jobs = 0;
   static std::atomic<int> seq(0);
@@ -145,34 +255,10 @@ void ThreadedRecurrentNetworkExecutor::WorkerFunction() {
     if (!job_queue_.Pop(&job)) {
       break;
     }
-
-    // Check for limited timestep parallelism
-    if (max_parallel_timesteps_ > 0) {
-      int t = (job.direction == 1 ? job.timestep : job.T - job.timestep + 1);
-      if (t - finished_timesteps_ >= max_parallel_timesteps_) {
-        // Return to queue
-        job_queue_.Push(job);
-        continue;
-      }
-    }
-
-    try {
-      RunOp(job, id);
-      if (job.op_idx == timestep_ops_template_.size() - 1) {
-        finished_timesteps_.fetch_add(1);
-      }
-      num_jobs++;
-    } catch (::caffe2::EnforceNotMet& enf) {
-      std::unique_lock<std::mutex> lk(countdown_mtx_);
-      LOG(ERROR) << "Crash at thread " << id << " timestep " << job.timestep
-                 << " op:"
-                 << ProtoDebugString(step_net_def_.op(job.op_idx))
-                 << enf.what();
-      job_queue_.NoMoreJobs();
-      failed_ = true;
-      cv_.notify_one();
+    if (!ProcessJob(job, id)) {
       return;
     }
+    num_jobs++;
   }
   VLOG(1) << "Worker exiting, did run: " << num_jobs << " jobs";
 }
@@ -182,7 +268,7 @@ void ThreadedRecurrentNetworkExecutor::_Exec() {
 
   // Start threads if not started
   std::unique_lock<std::mutex> lk(countdown_mtx_);
-  while (workers_.size() < num_threads_) {
+  while (!executor_pool_ && workers_.size() < num_threads_) {
     VLOG(1) << "Start RNN worker " << workers_.size() << " / " << num_threads_;
     workers_.push_back(
         std::thread(&ThreadedRecurrentNetworkExecutor::WorkerFunction, this));
@@ -191,6 +277,18 @@ void ThreadedRecurrentNetworkExecutor::_Exec() {
   // Wait until threads finish.
   Timer t;
   while (!failed_ && countdown_ > 0) {
+    if (executor_pool_ && executor_pool_->inThreadPool()) {
+      // Run from a task on the pool, e.g. by a nested net: this thread runs
+      // the queued jobs instead of blocking, as the other pool threads may
+      // all be waiting like it.
+      lk.unlock();
+      const bool ran = executor_pool_->runOneTask();
+      lk.lock();
+      if (!ran) {
+        cv_.wait_for(lk, std::chrono::milliseconds(1));
+      }
+      continue;
+    }
     cv_.wait_for(lk, std::chrono::seconds(30), [&] {
       // Log if we are still running, so that we catch deadlocks.. there
       // should not be any deadlocks, but...
@@ -18,10 +18,13 @@
 #define CAFFE2_OPERATORS_RECURRENT_NETWORK_EXECUTOR_H_
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include <unordered_set>
 #include <vector>
 
 #include "caffe2/core/context.h"
+#include "caffe2/core/executor_pool.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/timer.h"
@@ -136,10 +139,19 @@ class RecurrentNetworkExecutorBase {
     }
   }
 
+  /**
+   * Limits the number of timesteps that have ops running or waiting to run
+   * at any time, values <= 0 mean no limit. In forward-only mode this is
+   * also the number of step workspaces that are cycled over.
+   */
   void SetMaxParallelTimesteps(int p) {
     max_parallel_timesteps_ = p;
   }
 
+  int MaxParallelTimesteps() const {
+    return max_parallel_timesteps_;
+  }
+
  private:
   // Utility method to check if any of the op inputs or control inputs
   // contain given blob 'input'
@@ -333,16 +345,19 @@ class RecurrentNetworkExecutorBase {
         }
       }
     }
-    // Find ops that have no recurrent inputs, and bind them
-    // to the last op of the timestep. If there is only one op
-    // in the step net, then it will depend on itself. Note that
-    // we do not increase the dynamic input counter.
+    // Find ops that have no inputs from other ops, and bind them to
+    // themselves so that they are scheduled for the next timestep as soon
+    // as they ran for this one. Binding them to the last op of the timestep
+    // instead would make e.g. the input of the first layer of a stacked RNN
+    // wait for the last layer, and so prevent the wavefront execution where
+    // a layer runs timestep t+1 while the layer above still runs timestep t.
+    // Note that we do not increase the dynamic input counter.
     for (auto& rnn_op : timestep_ops_template_) {
       if (rnn_op.num_dynamic_inputs == 0 && rnn_op.num_recurrent_inputs == 0) {
         if (rnn_op.link_op && this->ignoreLinkDependencies()) {
           continue;
         }
-        timestep_ops_template_.back().dependencies.push_back(rnn_op.order);
+        rnn_op.dependencies.push_back(rnn_op.order);
       }
     }
 
@@ -434,6 +449,19 @@ class ThreadedRecurrentNetworkExecutor : public RecurrentNetworkExecutorBase {
     for (auto& worker : workers_) {
       worker.join();
     }
+    // Jobs on the shared pool cannot be joined, wait for them instead.
+    std::unique_lock<std::mutex> lk(countdown_mtx_);
+    while (inflight_jobs_ > 0) {
+      if (executor_pool_->inThreadPool()) {
+        lk.unlock();
+        const bool ran = executor_pool_->runOneTask();
+        lk.lock();
+        if (ran) {
+          continue;
+        }
+      }
+      cv_.wait_for(lk, std::chrono::milliseconds(1));
+    }
   }
 
   bool Run(int T) override;
@@ -448,6 +476,11 @@ class ThreadedRecurrentNetworkExecutor : public RecurrentNetworkExecutorBase {
     num_threads_ = n;
   }
 
+  // Runs the jobs on the given shared pool instead of starting own workers.
+  void setExecutorPool(TaskThreadPool* pool) {
+    executor_pool_ = pool;
+  }
+
  private:
   void _ExecRange(int from, int to);
 
@@ -455,12 +488,34 @@ class ThreadedRecurrentNetworkExecutor : public RecurrentNetworkExecutorBase {
 
   void WorkerFunction();
 
+  // Runs a single job, returns false if it failed.
+  bool ProcessJob(OpJob job, int thread_id);
+
+  void ScheduleJob(OpJob job);
+
   void RunOp(OpJob job, int thread_id);
 
+  void ResetTimesteps(int T);
+
+  // Returns false and parks the job if its timestep is too far ahead of the
+  // timesteps that finished, see SetMaxParallelTimesteps().
+  bool AdmitJob(const OpJob& job);
+
+  // Counts a finished op of the timestep of job and schedules the parked
+  // jobs that may run once the timestep finished.
+  void FinishJob(const OpJob& job);
+
   SimpleQueue<OpJob> job_queue_;
+  TaskThreadPool* executor_pool_ = nullptr;
+  std::atomic<int> inflight_jobs_{0};
   std::atomic<int> countdown_;
   std::atomic<bool> failed_;
+  // Length of the prefix of timesteps, in execution order, whose ops all
+  // finished. Only tracked with limited timestep parallelism.
   std::atomic<int> finished_timesteps_;
+  std::unique_ptr<std::atomic<int>[]> pending_timestep_ops_;
+  std::mutex deferred_mtx_;
+  std::vector<OpJob> deferred_jobs_;
   int num_ops_;
   std::mutex countdown_mtx_;
   std::condition_variable cv_;
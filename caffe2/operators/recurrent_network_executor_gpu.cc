@@ -33,6 +33,11 @@ std::unique_ptr<RecurrentNetworkExecutorBase> createRNNExecutor<CUDAContext>(
     exec->setMaxStreams(max_streams);
     LOG(INFO) << "Set max streams:" << max_streams;
   }
+  int max_parallel_timesteps = arg_helper.GetSingleArgument<int>(
+      "rnn_executor.max_parallel_timesteps", -1);
+  if (max_parallel_timesteps > 0) {
+    exec->SetMaxParallelTimesteps(max_parallel_timesteps);
+  }
   std::unique_ptr<RecurrentNetworkExecutorBase> ptr(exec);
   return ptr;
 }
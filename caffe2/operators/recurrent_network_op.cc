@@ -15,6 +15,9 @@
  */
 
 #include "recurrent_network_op.h"
+
+#include <algorithm>
+
 #include "caffe2/core/workspace.h"
 #include "caffe2/utils/proto_utils.h"
 
@@ -53,7 +56,26 @@ dynamic_rnn, Theano scan, etc).
 
 See the usage examples for a flavor of how to use it.
 
-)DOC");
+)DOC")
+    .Arg(
+        "checkpoint_interval",
+        "(int, default 1) With a backward pass, keep the step workspace of "
+        "only every k-th timestep and recompute the forward activations of "
+        "the others in RecurrentNetworkGradient. Lowers the number of live "
+        "step workspaces from T to about T / k + k for one extra forward "
+        "step per recomputed timestep. The step net has to be deterministic "
+        "for the recomputed activations to match the forward pass.")
+    .Arg(
+        "batch_sizes",
+        "(string, optional) Name of a CPU int32 blob with the number of "
+        "sequences still running at each timestep, non-increasing and "
+        "starting at the batch size, for a batch sorted by decreasing "
+        "length. The step net then only runs on those rows. Once a sequence "
+        "ends its recurrent states keep their last value, so the outputs at "
+        "the padded timesteps have to be masked out of the loss. Blobs of "
+        "the step net that are not linked must not depend on the number of "
+        "rows. The blob has to be an input of the operator as well, for the "
+        "dependencies, and the RNN executor is not used with it.");
 
 REGISTER_CPU_OPERATOR(
     RecurrentNetworkGradient,
@@ -74,7 +96,7 @@ REGISTER_CPU_OPERATOR(
     rnn_internal_apply_link,
     RNNApplyLinkOp<CPUContext>);
 OPERATOR_SCHEMA(rnn_internal_apply_link)
-    .NumInputs(2)
+    .NumInputs(2, 3)
     .NumOutputs(2)
     .EnforceInplace({{1, 1}})
     .Private()
@@ -168,13 +190,22 @@ void AddApplyLinkOps(
     const vector<Link>& links,
     std::string timestep,
     const DeviceOption& device_option,
-    NetDef* netdef) {
+    NetDef* netdef,
+    const std::string& batchSizes) {
   std::vector<OperatorDef> ops;
   for (auto& link : links) {
     OperatorDef opdef;
     opdef.set_type("rnn_internal_apply_link");
     opdef.add_input(timestep);
     opdef.add_input(link.external);
+    if (!batchSizes.empty()) {
+      opdef.add_input(batchSizes);
+      if (link.carry != 0) {
+        Argument* carry_arg = opdef.add_arg();
+        carry_arg->set_name("carry");
+        carry_arg->set_i(link.carry);
+      }
+    }
     opdef.add_output(link.internal);
     opdef.add_output(link.external);
     opdef.mutable_device_option()->CopyFrom(device_option);
@@ -205,10 +236,44 @@ void AddApplyLinkOps(
     netdef->add_external_input(link.internal);
     netdef->add_external_input(link.external);
   }
+  if (!batchSizes.empty()) {
+    netdef->add_external_input(batchSizes);
+  }
 
   detail::PrependOps(ops, netdef);
 }
 
+void SetLinkCarry(
+    const std::vector<std::string>& externals,
+    int32_t carry,
+    std::vector<Link>* links) {
+  for (auto& link : *links) {
+    if (link.offset == 1 && link.window == 1 &&
+        std::find(externals.begin(), externals.end(), link.external) !=
+            externals.end()) {
+      link.carry = carry;
+    }
+  }
+}
+
+void ValidateBatchSizes(
+    const Tensor<CPUContext>& batchSizes,
+    int32_t seqLen,
+    int32_t batchSize) {
+  CAFFE_ENFORCE_EQ(batchSizes.size(), seqLen, "One batch size per timestep");
+  const int32_t* sizes = batchSizes.data<int32_t>();
+  for (int32_t t = 0; t < seqLen; ++t) {
+    CAFFE_ENFORCE_LE(
+        sizes[t],
+        t == 0 ? batchSize : sizes[t - 1],
+        "Batch sizes must start at the batch size and not increase");
+    CAFFE_ENFORCE_GE(sizes[t], 1, "Empty timestep ", t);
+  }
+  if (seqLen > 0) {
+    CAFFE_ENFORCE_EQ(sizes[0], batchSize);
+  }
+}
+
 void extractLinks(
     OperatorBase* op,
     const std::string& internalArg,
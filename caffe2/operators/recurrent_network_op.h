@@ -59,10 +59,18 @@ struct Link {
   std::string external;
   int32_t offset{0};
   int32_t window{1};
+  // With batch sizes, -1 copies the rows of the sequences that have already
+  // ended from the previous timestep on forward, and 1 copies their gradient
+  // from the next timestep on backward. See RNNApplyLinkOp.
+  int32_t carry{0};
 };
 
 struct ScratchWorkspaces {
   std::vector<std::shared_ptr<Workspace>> stepWorkspaces;
+  // With checkpoint_interval k > 1, only every k-th timestep keeps its own
+  // workspace in stepWorkspaces. The timesteps in between run in these k - 1
+  // workspaces, which are reused by every segment of k timesteps.
+  std::vector<std::shared_ptr<Workspace>> recomputeWorkspaces;
   std::shared_ptr<Workspace> sharedBlobsWs = nullptr;
 };
 
@@ -171,7 +179,27 @@ void AddApplyLinkOps(
     const vector<Link>& links,
     std::string timestep,
     const DeviceOption& device_option,
-    NetDef* netdef);
+    NetDef* netdef,
+    const std::string& batchSizes = "");
+
+// Sets `carry` on the links that write timestep t + 1 of one of `externals`.
+void SetLinkCarry(
+    const std::vector<std::string>& externals,
+    int32_t carry,
+    std::vector<Link>* links);
+
+// Checks that `batchSizes` holds the number of sequences still running at
+// each of the `seqLen` timesteps, starting with `batchSize`.
+void ValidateBatchSizes(
+    const Tensor<CPUContext>& batchSizes,
+    int32_t seqLen,
+    int32_t batchSize);
+
+inline int GetCheckpointInterval(OperatorBase* op) {
+  const int interval = op->GetSingleArgument<int>("checkpoint_interval", 1);
+  CAFFE_ENFORCE_GE(interval, 1, "checkpoint_interval must be positive");
+  return interval;
+}
 
 void extractLinks(
     OperatorBase* op,
@@ -196,7 +224,11 @@ class RecurrentNetworkOp final : public Operator<Context> {
             false)),
         timestep_(OperatorBase::template GetSingleArgument<std::string>(
             "timestep",
-            "timestep")) {
+            "timestep")),
+        checkpointInterval_(detail::GetCheckpointInterval(this)),
+        batchSizes_(OperatorBase::template GetSingleArgument<std::string>(
+            "batch_sizes",
+            "")) {
     CAFFE_ENFORCE(ws);
 
     stepNetDef_ = detail::extractNetDef(operator_def, "step_net");
@@ -204,12 +236,24 @@ class RecurrentNetworkOp final : public Operator<Context> {
     recurrentInputs_ = constructRecurrentInputs(operator_def, sharedWs_);
     links_ = constructLinks();
     aliases_ = constructAliases();
+    if (!batchSizes_.empty()) {
+      detail::SetLinkCarry(
+          OperatorBase::GetRepeatedArgument<std::string>("recurrent_states"),
+          -1,
+          &links_);
+    }
 
     stepNetDef_.add_external_input(timestep_);
     detail::AddApplyLinkOps(
-        links_, timestep_, operator_def.device_option(), &stepNetDef_);
-
-    if (FLAGS_caffe2_rnn_executor && enable_rnn_executor_) {
+        links_,
+        timestep_,
+        operator_def.device_option(),
+        &stepNetDef_,
+        batchSizes_);
+
+    // The executor does not know about the shrinking batch.
+    if (FLAGS_caffe2_rnn_executor && enable_rnn_executor_ &&
+        batchSizes_.empty()) {
       VLOG(1) << "Use RecurrentNetworkExecutor";
       auto recurrent_map = detail::GetRecurrentMapping(links_, false /* backward */);
       rnnExecutor_ =
@@ -303,6 +347,14 @@ class RecurrentNetworkOp final : public Operator<Context> {
   bool DoRunWithType() {
     const auto seqLen = Input(0).dim32(0);
     const auto batchSize = Input(0).dim32(1);
+    if (!batchSizes_.empty()) {
+      auto* batchSizesBlob = sharedWs_->GetBlob(batchSizes_);
+      CAFFE_ENFORCE(batchSizesBlob, "Missing batch sizes ", batchSizes_);
+      detail::ValidateBatchSizes(
+          batchSizesBlob->template Get<Tensor<CPUContext>>(),
+          seqLen,
+          batchSize);
+    }
     for (const auto& ri : recurrentInputs_) {
       detail::initializeRecurrentInput<T, Context>(
           ri, seqLen, batchSize, sharedWs_, &context_);
@@ -335,10 +387,25 @@ class RecurrentNetworkOp final : public Operator<Context> {
       stepWorkspaces.resize(seqLen);
     }
 
+    // Checkpointing only matters when there is a backward pass to keep the
+    // activations for.
+    const int checkpointInterval = has_backward_pass ? checkpointInterval_ : 1;
+    std::vector<std::shared_ptr<Workspace>>& recomputeWorkspaces =
+        scratch->recomputeWorkspaces;
+    if (recomputeWorkspaces.size() < checkpointInterval - 1) {
+      recomputeWorkspaces.resize(checkpointInterval - 1);
+    }
+
     // In forward-only mode, we cycle over workspaces. This limits the amount
     // of parallelism over timesteps that the RNNExecutor provides. So with
-    // RNN executor we use more workspaces to get better perf.
-    int num_workspaces_on_fwd_only = rnnExecutor_ ? 4 : 2;
+    // RNN executor we use more workspaces to get better perf, as many as
+    // the timesteps it is configured to run in parallel if that is set.
+    int num_workspaces_on_fwd_only = 2;
+    if (rnnExecutor_) {
+      int max_parallel_timesteps = rnnExecutor_->MaxParallelTimesteps();
+      num_workspaces_on_fwd_only =
+          max_parallel_timesteps > 0 ? std::max(2, max_parallel_timesteps) : 4;
+    }
 
     if (!has_backward_pass && stepWorkspaces.size() < num_workspaces_on_fwd_only) {
       // Use alternating stepWorkspaces when forward_only=True.
@@ -348,9 +415,15 @@ class RecurrentNetworkOp final : public Operator<Context> {
     }
 
     for (auto t = 0; t < seqLen; ++t) {
+      if (OperatorBase::IsCancelled()) {
+        return false;
+      }
       auto& currentStepWorkspace =
-          (has_backward_pass ? stepWorkspaces[t] :
-              stepWorkspaces[t % num_workspaces_on_fwd_only]);
+          (!has_backward_pass
+               ? stepWorkspaces[t % num_workspaces_on_fwd_only]
+               : (t % checkpointInterval == 0
+                      ? stepWorkspaces[t]
+                      : recomputeWorkspaces[t % checkpointInterval - 1]));
       if (!currentStepWorkspace) {
         currentStepWorkspace = std::make_shared<Workspace>(sharedBlobsWs.get());
       }
@@ -359,6 +432,9 @@ class RecurrentNetworkOp final : public Operator<Context> {
         if (!has_backward_pass) {
           // Need to limit timestep parallelism because we cycle over workspaces
           rnnExecutor_->SetMaxParallelTimesteps(num_workspaces_on_fwd_only);
+        } else if (checkpointInterval > 1) {
+          // Timesteps t and t + checkpointInterval share a workspace
+          rnnExecutor_->SetMaxParallelTimesteps(checkpointInterval);
         }
         rnnExecutor_->EnsureTimestepInitialized(t, currentStepWorkspace.get());
       } else {
@@ -375,6 +451,9 @@ class RecurrentNetworkOp final : public Operator<Context> {
     }
 
     if (rnnExecutor_) {
+      if (OperatorBase::IsCancelled()) {
+        return false;
+      }
       rnnExecutor_->Run(seqLen);
     }
 
@@ -399,6 +478,8 @@ class RecurrentNetworkOp final : public Operator<Context> {
   std::vector<detail::OffsetAlias> aliases_;
   std::vector<detail::RecurrentInput> recurrentInputs_;
   std::string timestep_;
+  int checkpointInterval_;
+  std::string batchSizes_;
 };
 
 template <class Context>
@@ -415,7 +496,11 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
             "timestep",
             "timestep")),
         gradInputs_(OperatorBase::template GetRepeatedArgument<int32_t>(
-            "outputs_with_grads")) {
+            "outputs_with_grads")),
+        checkpointInterval_(detail::GetCheckpointInterval(this)),
+        batchSizes_(OperatorBase::template GetSingleArgument<std::string>(
+            "batch_sizes",
+            "")) {
     CAFFE_ENFORCE(ws);
 
     stepNetDef_ = detail::extractNetDef(operator_def, "backward_step_net");
@@ -425,6 +510,13 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
     recurrentGradients_ = constructRecurrentGradients(operator_def);
     recurrentInputIds_ = OperatorBase::template GetRepeatedArgument<int32_t>(
         "initial_recurrent_state_ids");
+    if (!batchSizes_.empty()) {
+      std::vector<std::string> grads;
+      for (const auto& rg : recurrentGradients_) {
+        grads.push_back(rg.grad);
+      }
+      detail::SetLinkCarry(grads, 1, &links_);
+    }
 
     /* Add operators to the backward step net to handle accumulation of
        gradients over timesteps
@@ -433,10 +525,20 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
 
     AddGradientInputAccumulationOps(operator_def);
     detail::AddApplyLinkOps(
-        links_, timestep_, operator_def.device_option(), &stepNetDef_);
+        links_,
+        timestep_,
+        operator_def.device_option(),
+        &stepNetDef_,
+        batchSizes_);
     AddParamGradientAccumulationOps(operator_def);
 
-    if (FLAGS_caffe2_rnn_executor && enable_rnn_executor_) {
+    if (checkpointInterval_ > 1) {
+      // Recomputing a segment has to finish before its backward steps start,
+      // so the backward pass runs the step nets one timestep at a time.
+      InitializeRecompute(operator_def);
+    } else if (
+        FLAGS_caffe2_rnn_executor && enable_rnn_executor_ &&
+        batchSizes_.empty()) {
       InitializeExecutor(operator_def);
     }
   }
@@ -568,6 +670,91 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
       stepNetDef_, recurrent_map, timestep_, ArgumentHelper(operator_def));
   }
 
+  void InitializeRecompute(const OperatorDef& operator_def) {
+    VLOG(1) << "Recompute forward activations every " << checkpointInterval_
+            << " timesteps";
+    recomputeNetDef_ = detail::extractNetDef(operator_def, "step_net");
+    recomputeNetDef_.add_external_input(timestep_);
+    std::vector<detail::Link> forwardLinks;
+    detail::extractLinks(
+        this,
+        "link_internal",
+        "link_external",
+        "link_offset",
+        "link_window",
+        &forwardLinks);
+    if (!batchSizes_.empty()) {
+      detail::SetLinkCarry(
+          OperatorBase::GetRepeatedArgument<std::string>("recurrent_states"),
+          -1,
+          &forwardLinks);
+    }
+    detail::AddApplyLinkOps(
+        forwardLinks,
+        timestep_,
+        operator_def.device_option(),
+        &recomputeNetDef_,
+        batchSizes_);
+    recomputeNetDef_.set_type("simple");
+    if (stepNetDef_.type() == "rnn") {
+      stepNetDef_.set_type("simple");
+    }
+  }
+
+  void RunStepNet(const NetDef& netDef, Workspace* ws, int32_t t) {
+    detail::UpdateTimestepBlob(ws, timestep_, t);
+    auto* stepNet = ws->GetNet(netDef.name());
+    if (stepNet == nullptr) {
+      stepNet = ws->CreateNet(netDef);
+    }
+    CAFFE_ENFORCE(stepNet);
+    stepNet->RunAsync();
+  }
+
+  /**
+    * Backward pass for checkpoint_interval k > 1. The forward pass kept the
+    * workspaces of the timesteps that are a multiple of k. Segments of k
+    * timesteps are processed from the last one: first the forward step net
+    * is rerun for the timesteps of the segment that were not kept, and then
+    * the backward step net goes over the segment in reverse. The recurrent
+    * states are stored for all timesteps in the shared workspace, so each
+    * recomputed timestep reads the same inputs as it did on forward.
+    * Returns false if the run is cancelled.
+    */
+  bool RunCheckpointedBackward(
+      int32_t seqLen,
+      const detail::ScratchWorkspaces& scratch) {
+    const auto& stepWorkspaces = scratch.stepWorkspaces;
+    const auto& recomputeWorkspaces = scratch.recomputeWorkspaces;
+    CAFFE_ENFORCE_GE(recomputeWorkspaces.size(), checkpointInterval_ - 1);
+    auto workspaceAt = [&](int32_t t) {
+      const int32_t pos = t % checkpointInterval_;
+      Workspace* ws = pos == 0 ? stepWorkspaces[t].get()
+                               : recomputeWorkspaces[pos - 1].get();
+      CAFFE_ENFORCE(ws, "No forward workspace for timestep ", t);
+      return ws;
+    };
+    const int32_t lastStart =
+        ((seqLen - 1) / checkpointInterval_) * checkpointInterval_;
+    for (int32_t start = lastStart; start >= 0;
+         start -= checkpointInterval_) {
+      if (OperatorBase::IsCancelled()) {
+        return false;
+      }
+      const int32_t end = std::min(start + checkpointInterval_, seqLen);
+      // The forward pass left the last segment in the recompute workspaces.
+      if (start != lastStart) {
+        for (int32_t t = start + 1; t < end; ++t) {
+          RunStepNet(recomputeNetDef_, workspaceAt(t), t);
+        }
+      }
+      for (int32_t t = end - 1; t >= start; --t) {
+        RunStepNet(stepNetDef_, workspaceAt(t), t);
+      }
+    }
+    return true;
+  }
+
   void AddGradientInputAccumulationOps(const OperatorDef& operator_def) {
     /**
       * Add ops to the step net to accumulate input gradients.
@@ -657,6 +844,14 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
     Workspace& sharedBlobsWs = *scratch.sharedBlobsWs.get();
 
     const auto batchSize = Input(0).dim32(1);
+    if (!batchSizes_.empty()) {
+      auto* batchSizesBlob = sharedWs_->GetBlob(batchSizes_);
+      CAFFE_ENFORCE(batchSizesBlob, "Missing batch sizes ", batchSizes_);
+      detail::ValidateBatchSizes(
+          batchSizesBlob->template Get<Tensor<CPUContext>>(),
+          seqLen,
+          batchSize);
+    }
     for (auto& param : params_) {
       auto pBlob = sharedWs_->GetBlob(param.param);
       CAFFE_ENFORCE(pBlob);
@@ -710,6 +905,14 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
       auto* g = pGradientBlob->template GetMutable<Tensor<Context>>();
       g->ResizeLike(Input(gradientInputIndex));
       g->template mutable_data<T>();
+      if (!batchSizes_.empty()) {
+        // The step net only writes the rows of the running sequences.
+        math::Set<T, Context>(
+            g->size(),
+            convert::To<float, T>(0.0),
+            g->template mutable_data<T>(),
+            &context_);
+      }
     }
 
     auto accumulateFinalInputGradients = [&]() {
@@ -750,21 +953,33 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
     if (stepWorkspaces.size() > 0) {
       CreateSharedBlobs(stepWorkspaces[0], &sharedBlobsWs);
     }
-    for (int32_t t = seqLen - 1; t >= 0; --t) {
-      if (rnnExecutor_) {
-        rnnExecutor_->EnsureTimestepInitialized(t, stepWorkspaces[t].get());
-      } else {
-        auto* stepNet = stepWorkspaces[t].get()->GetNet(stepNetDef_.name());
-        if (stepNet == nullptr) {
-          stepNet = stepWorkspaces[t].get()->CreateNet(stepNetDef_);
+    if (checkpointInterval_ > 1) {
+      if (!RunCheckpointedBackward(seqLen, scratch)) {
+        return false;
+      }
+    } else {
+      for (int32_t t = seqLen - 1; t >= 0; --t) {
+        if (OperatorBase::IsCancelled()) {
+          return false;
+        }
+        if (rnnExecutor_) {
+          rnnExecutor_->EnsureTimestepInitialized(t, stepWorkspaces[t].get());
+        } else {
+          auto* stepNet = stepWorkspaces[t].get()->GetNet(stepNetDef_.name());
+          if (stepNet == nullptr) {
+            stepNet = stepWorkspaces[t].get()->CreateNet(stepNetDef_);
+          }
+          CAFFE_ENFORCE(stepNet);
+          stepNet->RunAsync();
         }
-        CAFFE_ENFORCE(stepNet);
-        stepNet->RunAsync();
       }
-    }
 
-    if (rnnExecutor_) {
-      rnnExecutor_->RunBackwards(seqLen);
+      if (rnnExecutor_) {
+        if (OperatorBase::IsCancelled()) {
+          return false;
+        }
+        rnnExecutor_->RunBackwards(seqLen);
+      }
     }
 
     CAFFE_ENFORCE_EQ(recurrentInputIds_.size(), recurrentGradients_.size());
@@ -832,6 +1047,10 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
   const int numSequences_{1};
   std::vector<int32_t> recurrentInputIds_;
   std::vector<int32_t> gradInputs_;
+  int checkpointInterval_;
+  std::string batchSizes_;
+  // Forward step net used to recompute activations with checkpoint_interval
+  NetDef recomputeNetDef_;
 };
 
 template <class Context>
@@ -878,13 +1097,23 @@ class AccumulateInputGradientOp : public Operator<Context> {
   int offset_;
 };
 
+/**
+ * Shares timesteps [t + offset, t + offset + window) of the external blob as
+ * the internal blob of the step net. With the optional batch sizes input,
+ * the number of sequences still running at each timestep, only the rows of
+ * the running sequences are shared, and for `carry` links the rows of the
+ * sequences that have already ended are copied over from the neighbouring
+ * timestep, so that their recurrent states, and the gradients of those,
+ * keep the values they had at the end of the sequence.
+ */
 template <class Context>
 class RNNApplyLinkOp : public Operator<Context> {
  public:
   RNNApplyLinkOp(const OperatorDef& def, Workspace* ws)
       : Operator<Context>(def, ws),
         offset_(OperatorBase::GetSingleArgument<int>("offset", -1)),
-        window_(OperatorBase::GetSingleArgument<int>("window", -1)) {
+        window_(OperatorBase::GetSingleArgument<int>("window", -1)),
+        carry_(OperatorBase::GetSingleArgument<int>("carry", 0)) {
     CAFFE_ENFORCE(offset_ >= 0, "offset not set");
     CAFFE_ENFORCE(window_ >= 0, "window not set");
   }
@@ -904,11 +1133,36 @@ class RNNApplyLinkOp : public Operator<Context> {
 
     CAFFE_ENFORCE_GT(external.size(), 0);
     const TIndex externalTimestepSize = external.size() / external.dim(0);
-    auto* externalData = external_out->template mutable_data<T>() +
-        (t + offset_) * externalTimestepSize;
+    const auto slot = t + offset_;
+    auto* externalData =
+        external_out->template mutable_data<T>() + slot * externalTimestepSize;
     auto internalDims = external_out->dims();
     internalDims[0] = window_;
 
+    if (InputSize() == 3 && window_ == 1 && external.ndim() >= 3) {
+      const auto& batchSizes = OperatorBase::Input<Tensor<CPUContext>>(2);
+      const int32_t* sizes = batchSizes.template data<int32_t>();
+      const TIndex rowSize = externalTimestepSize / external.dim(1);
+      const TIndex running = sizes[t];
+      // Rows [running, batch) of the slot come from the neighbouring one.
+      const TIndex from = carry_ < 0 ? slot - 1 : slot + 1;
+      const TIndex ended = carry_ < 0 ? running
+          : (t + 1 < batchSizes.size() ? sizes[t + 1] : external.dim(1));
+      if (carry_ != 0 && from >= 0 && from < external.dim(0) &&
+          ended < external.dim(1)) {
+        const TIndex rowsSize = (external.dim(1) - ended) * rowSize;
+        context_.template Copy<T, Context, Context>(
+            rowsSize,
+            external_out->template data<T>() + from * externalTimestepSize +
+                ended * rowSize,
+            externalData + ended * rowSize);
+      }
+      internalDims[1] = running;
+      internal_out->Resize(internalDims);
+      internal_out->ShareExternalPointer(externalData, running * rowSize);
+      return true;
+    }
+
     internal_out->Resize(internalDims);
     internal_out->ShareExternalPointer(
         externalData, externalTimestepSize * window_);
@@ -922,6 +1176,7 @@ class RNNApplyLinkOp : public Operator<Context> {
  private:
   int offset_;
   int window_;
+  int carry_;
 };
 
 } // namespace caffe2
@@ -22,6 +22,7 @@
 
 #include "caffe2/core/context.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/perfkernels/vector_ops.h"
 #include "caffe2/utils/math.h"
 #include "caffe2/utils/proto_utils.h"
 
@@ -789,9 +790,7 @@ class MaxReducer<T, CPUContext> : public BaseReducer {
         meta.first_dim,
         "MaxReducer implemented only for front dimensions reduction");
     if (current_size_ > 0) {
-      EigenVectorMap<T> output_vec(out_, meta.block_size);
-      output_vec =
-          output_vec.cwiseMax(ConstEigenVectorMap<T>(in, meta.block_size));
+      Max(meta.block_size, in, out_);
     } else {
       memcpy(out_, in, sizeof(T) * meta.block_size);
     }
@@ -799,6 +798,16 @@ class MaxReducer<T, CPUContext> : public BaseReducer {
   }
 
  private:
+  template <typename U>
+  static void Max(TIndex N, const U* in, U* out) {
+    EigenVectorMap<U> output_vec(out, N);
+    output_vec = output_vec.cwiseMax(ConstEigenVectorMap<U>(in, N));
+  }
+
+  static void Max(TIndex N, const float* in, float* out) {
+    vector_max(N, in, out);
+  }
+
   T* out_;
   int current_size_;
 };
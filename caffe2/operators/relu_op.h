@@ -21,9 +21,27 @@
 #include "caffe2/core/context.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
 
 namespace caffe2 {
 
+// Applies Relu in place on the output of an operator that fuses a trailing
+// Relu (see the fused_relu argument of Conv and FC), while the data is still
+// hot in cache. Only float on CPU is supported.
+template <typename T, class Context>
+inline void FusedReluInPlace(const int N, T* /*data*/, Context* /*context*/) {
+  CAFFE_THROW("Fused Relu is only supported for float on CPU.");
+}
+
+template <>
+inline void FusedReluInPlace<float, CPUContext>(
+    const int N,
+    float* data,
+    CPUContext* /*context*/) {
+  EigenVectorArrayMap<float> arr(data, N);
+  arr = arr.cwiseMax(0.f);
+}
+
 template <typename T, class Context>
 class ReluOp final : public Operator<Context> {
  public:
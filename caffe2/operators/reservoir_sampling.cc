@@ -126,6 +126,10 @@ class ReservoirSamplingOp final : public Operator<Context> {
       }
     }
 
+    // The slots of the rows are picked first, and the rows are then copied
+    // in runs of consecutive rows going to consecutive slots, so that the
+    // append phase is a single copy per batch.
+    std::vector<int64_t> positions(num_entries, -1);
     for (int i = 0; i < num_entries; ++i) {
       if (object_id_data && object_to_pos_map &&
           !eligible_object_ids.count(object_id_data[i])) {
@@ -155,12 +159,7 @@ class ReservoirSamplingOp final : public Operator<Context> {
         CAFFE_ENFORCE_GE(*num_visited, numToCollect_);
       } else {
         // replace
-        context_.template CopyItems<Context, Context>(
-            input.meta(),
-            block_size,
-            input_data + i * block_bytesize,
-            output_data + pos * block_bytesize);
-
+        positions[i] = pos;
         if (object_id_data && pos_to_object_data && object_to_pos_map) {
           auto old_oid = pos_to_object_data[pos];
           auto new_oid = object_id_data[i];
@@ -172,6 +171,23 @@ class ReservoirSamplingOp final : public Operator<Context> {
 
       ++(*num_visited);
     }
+
+    for (int i = 0; i < num_entries;) {
+      if (positions[i] < 0) {
+        ++i;
+        continue;
+      }
+      int end = i + 1;
+      while (end < num_entries && positions[end] == positions[end - 1] + 1) {
+        ++end;
+      }
+      context_.template CopyItems<Context, Context>(
+          input.meta(),
+          (end - i) * block_size,
+          input_data + i * block_bytesize,
+          output_data + positions[i] * block_bytesize);
+      i = end;
+    }
     // Sanity check
     CAFFE_ENFORCE_EQ(*num_visited, start_num_visited + num_new_entries);
     return true;
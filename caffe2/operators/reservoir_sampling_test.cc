@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Creates a [rows, 3] batch whose rows are all equal to first + i.
+void FeedBatch(Workspace* ws, int first, int rows) {
+  auto* data = ws->CreateBlob("data")->GetMutable<TensorCPU>();
+  data->Resize(rows, 3);
+  for (int i = 0; i < 3 * rows; ++i) {
+    data->mutable_data<int>()[i] = first + i / 3;
+  }
+}
+
+} // namespace
+
+TEST(ReservoirSamplingTest, AppendsThenReplacesWholeRows) {
+  Workspace ws;
+  auto* reservoir = ws.CreateBlob("reservoir")->GetMutable<TensorCPU>();
+  reservoir->Resize(0, 3);
+  reservoir->mutable_data<int>();
+  auto* num_visited = ws.CreateBlob("num_visited")->GetMutable<TensorCPU>();
+  num_visited->Resize(1);
+  num_visited->mutable_data<int64_t>()[0] = 0;
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("CreateMutex", "", {}, {"mutex"})));
+  const auto def = CreateOperatorDef(
+      "ReservoirSampling",
+      "",
+      {"reservoir", "num_visited", "data", "mutex"},
+      {"reservoir", "num_visited"},
+      {MakeArgument("num_to_collect", 100)});
+
+  // The first rows are appended in order.
+  FeedBatch(&ws, 0, 60);
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+  const auto& out = ws.GetBlob("reservoir")->Get<TensorCPU>();
+  ASSERT_EQ(out.dims(), vector<TIndex>({60, 3}));
+  for (int i = 0; i < 60; ++i) {
+    EXPECT_EQ(out.data<int>()[3 * i], i);
+  }
+  // The next batch fills the reservoir and starts replacing rows.
+  FeedBatch(&ws, 60, 60);
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+  ASSERT_EQ(out.dims(), vector<TIndex>({100, 3}));
+
+  for (int b = 0; b < 20; ++b) {
+    FeedBatch(&ws, 120 + b * 50, 50);
+    ASSERT_TRUE(ws.RunOperatorOnce(def));
+  }
+  EXPECT_EQ(
+      ws.GetBlob("num_visited")->Get<TensorCPU>().data<int64_t>()[0], 1120);
+  ASSERT_EQ(out.dims(), vector<TIndex>({100, 3}));
+  vector<int> rows;
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(out.data<int>()[3 * i], out.data<int>()[3 * i + 1]);
+    EXPECT_EQ(out.data<int>()[3 * i], out.data<int>()[3 * i + 2]);
+    rows.push_back(out.data<int>()[3 * i]);
+  }
+  std::sort(rows.begin(), rows.end());
+  EXPECT_EQ(std::unique(rows.begin(), rows.end()), rows.end());
+  EXPECT_LT(rows.back(), 1120);
+  // Most of the rows have been replaced by later ones.
+  EXPECT_GT(rows.back(), 120);
+}
+
+} // namespace caffe2
@@ -132,6 +132,10 @@ could also be 0, in which case the actual dimension value is going to be copied
 from the input tensor.
 )DOC")
     .Arg("shape", "New shape")
+    .Arg(
+        "zero_copy",
+        "(bool, default false) Make the output a view of the input instead "
+        "of a copy. Writes to the output then change the input.")
     .Input(0, "data", "An input tensor.")
     .Input(1, "new_shape", "New shape.")
     .Output(0, "reshaped", "Reshaped data.")
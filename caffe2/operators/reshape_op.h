@@ -31,7 +31,9 @@ class ReshapeOp : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   ReshapeOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        new_shape_(OperatorBase::GetRepeatedArgument<int64_t>("shape")) {}
+        new_shape_(OperatorBase::GetRepeatedArgument<int64_t>("shape")),
+        zero_copy_(OperatorBase::GetSingleArgument<bool>("zero_copy", false)) {
+  }
 
   bool RunOnDevice() override {
     if (InputSize() == 2) {
@@ -122,7 +124,9 @@ class ReshapeOp : public Operator<Context> {
 
     auto* output = Output(0);
     output->Resize(actual_new_shape);
-    if (output != &input) {
+    if (output != &input && zero_copy_) {
+      output->ShareData(input);
+    } else if (output != &input) {
       // If we are not doing in-place computation, a copy is needed.
       context_.template CopyItems<Context, Context>(
           input.meta(),
@@ -136,6 +140,7 @@ class ReshapeOp : public Operator<Context> {
 
  private:
   vector<int64_t> new_shape_;
+  bool zero_copy_;
 };
 
 } // namespace caffe2
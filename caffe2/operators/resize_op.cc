@@ -92,14 +92,27 @@ bool ResizeNearestOp<float, CPUContext>::RunOnDevice() {
     return true;
   }
 
+  // The source column of every output column is computed once, and an
+  // output row with the same source row as the previous one is a copy of it.
+  vector<int> in_xs(output_width);
+  for (int x = 0; x < output_width; ++x) {
+    in_xs[x] = std::min((int)(x / width_scale_), (input_width - 1));
+  }
   for (int n = 0; n < batch_size; ++n) {
     for (int c = 0; c < num_channels; ++c) {
+      int prev_in_y = -1;
       for (int y = 0; y < output_height; ++y) {
         const int in_y = std::min((int)(y / height_scale_), (input_height - 1));
+        float* Yrow = Ydata + output_width * y;
+        if (in_y == prev_in_y) {
+          std::copy(Yrow - output_width, Yrow, Yrow);
+          continue;
+        }
+        const float* Xrow = Xdata + input_width * in_y;
         for (int x = 0; x < output_width; ++x) {
-          const int in_x = std::min((int)(x / width_scale_), (input_width - 1));
-          Ydata[output_width * y + x] = Xdata[input_width * in_y + in_x];
+          Yrow[x] = Xrow[in_xs[x]];
         }
+        prev_in_y = in_y;
       }
       Xdata += input_height * input_width;
       Ydata += output_width * output_height;
@@ -151,9 +164,150 @@ bool ResizeNearestGradientOp<float, CPUContext>::RunOnDevice() {
   return true;
 }
 
+namespace {
+
+// The two source positions of an output position along one axis and the
+// weight of the second one; the output samples the input at its centers.
+struct BilinearTap {
+  int lo;
+  int hi;
+  float weight;
+};
+
+vector<BilinearTap> BilinearTaps(int input_size, int output_size, float scale) {
+  vector<BilinearTap> taps(output_size);
+  for (int i = 0; i < output_size; ++i) {
+    const float src = std::max((i + 0.5f) / scale - 0.5f, 0.f);
+    BilinearTap& tap = taps[i];
+    tap.lo = std::min(static_cast<int>(src), input_size - 1);
+    tap.hi = std::min(tap.lo + 1, input_size - 1);
+    tap.weight = tap.lo == tap.hi ? 0.f : src - tap.lo;
+  }
+  return taps;
+}
+
+} // namespace
+
+template <>
+bool ResizeBilinearOp<float, CPUContext>::RunOnDevice() {
+  const auto& X = Input(0);
+  auto* Y = Output(0);
+
+  CAFFE_ENFORCE_EQ(4, X.ndim());
+  const int batch_size = X.dim32(0),
+            num_channels = X.dim32(1),
+            input_height = X.dim32(2),
+            input_width = X.dim32(3);
+  const int output_width = input_width * width_scale_;
+  const int output_height = input_height * height_scale_;
+  Y->Resize(batch_size, num_channels, output_height, output_width);
+  if (Y->size() == 0) {
+    Y->mutable_data<float>();
+    return true;
+  }
+
+  const auto x_taps = BilinearTaps(input_width, output_width, width_scale_);
+  const auto y_taps = BilinearTaps(input_height, output_height, height_scale_);
+  const float* Xdata = X.data<float>();
+  float* Ydata = Y->mutable_data<float>();
+
+  // Every input row is interpolated horizontally at most once, into one of
+  // two row buffers, and every output row blends two buffers, which is a
+  // vectorized axpby.
+  rows_.Resize(2, output_width);
+  float* rows[2] = {rows_.mutable_data<float>(),
+                    rows_.mutable_data<float>() + output_width};
+  for (int n = 0; n < batch_size; ++n) {
+    for (int c = 0; c < num_channels; ++c) {
+      int row_ids[2] = {-1, -1};
+      for (int y = 0; y < output_height; ++y) {
+        const BilinearTap& y_tap = y_taps[y];
+        const int needed[2] = {y_tap.lo, y_tap.hi};
+        if (row_ids[0] != needed[0] && row_ids[1] == needed[0]) {
+          std::swap(rows[0], rows[1]);
+          std::swap(row_ids[0], row_ids[1]);
+        }
+        for (int k = 0; k < 2; ++k) {
+          if (row_ids[k] == needed[k]) {
+            continue;
+          }
+          const float* Xrow = Xdata + input_width * needed[k];
+          for (int x = 0; x < output_width; ++x) {
+            const BilinearTap& x_tap = x_taps[x];
+            rows[k][x] = Xrow[x_tap.lo] +
+                x_tap.weight * (Xrow[x_tap.hi] - Xrow[x_tap.lo]);
+          }
+          row_ids[k] = needed[k];
+        }
+        EigenVectorArrayMap<float>(Ydata + output_width * y, output_width) =
+            ConstEigenVectorArrayMap<float>(rows[0], output_width) *
+                (1.f - y_tap.weight) +
+            ConstEigenVectorArrayMap<float>(rows[1], output_width) *
+                y_tap.weight;
+      }
+      Xdata += input_height * input_width;
+      Ydata += output_width * output_height;
+    }
+  }
+
+  return true;
+}
+
+template <>
+bool ResizeBilinearGradientOp<float, CPUContext>::RunOnDevice() {
+  const auto& dY = Input(0);
+  const auto& X = Input(1);
+  auto* dX = Output(0);
+
+  CAFFE_ENFORCE_EQ(4, dY.ndim());
+  CAFFE_ENFORCE_EQ(4, X.ndim());
+  const int batch_size = dY.dim32(0),
+            num_channels = dY.dim32(1),
+            output_height = dY.dim32(2),
+            output_width = dY.dim32(3);
+  const int input_height = X.dim32(2);
+  const int input_width = X.dim32(3);
+  dX->Resize(batch_size, num_channels, input_height, input_width);
+  math::Set<float, CPUContext>(
+      dX->size(), 0.0f, dX->mutable_data<float>(), &context_);
+
+  const auto x_taps = BilinearTaps(input_width, output_width, width_scale_);
+  const auto y_taps = BilinearTaps(input_height, output_height, height_scale_);
+  const float* dYdata = dY.data<float>();
+  float* dXdata = dX->mutable_data<float>();
+
+  for (int n = 0; n < batch_size; ++n) {
+    for (int c = 0; c < num_channels; ++c) {
+      for (int y = 0; y < output_height; ++y) {
+        const BilinearTap& y_tap = y_taps[y];
+        float* lo_row = dXdata + input_width * y_tap.lo;
+        float* hi_row = dXdata + input_width * y_tap.hi;
+        const float* dYrow = dYdata + output_width * y;
+        for (int x = 0; x < output_width; ++x) {
+          const BilinearTap& x_tap = x_taps[x];
+          const float lo = dYrow[x] * (1.f - y_tap.weight);
+          const float hi = dYrow[x] * y_tap.weight;
+          lo_row[x_tap.lo] += lo * (1.f - x_tap.weight);
+          lo_row[x_tap.hi] += lo * x_tap.weight;
+          hi_row[x_tap.lo] += hi * (1.f - x_tap.weight);
+          hi_row[x_tap.hi] += hi * x_tap.weight;
+        }
+      }
+      dYdata += output_height * output_width;
+      dXdata += input_height * input_width;
+    }
+  }
+
+  return true;
+}
+
 REGISTER_CPU_OPERATOR(ResizeNearest, ResizeNearestOp<float, CPUContext>);
 REGISTER_CPU_OPERATOR(ResizeNearestGradient,
                       ResizeNearestGradientOp<float, CPUContext>);
+REGISTER_CPU_OPERATOR(ResizeBilinear, ResizeBilinearOp<float, CPUContext>);
+REGISTER_CPU_OPERATOR(
+    ResizeBilinearGradient,
+    ResizeBilinearGradientOp<float, CPUContext>);
 
 // Input: X, output: Y
 OPERATOR_SCHEMA(ResizeNearest)
@@ -189,4 +343,40 @@ class GetResizeNearestGradient : public GradientMakerBase {
 };
 REGISTER_GRADIENT(ResizeNearest, GetResizeNearestGradient);
 
+// Input: X, output: Y
+OPERATOR_SCHEMA(ResizeBilinear)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .Arg("width_scale", "Scale along width dimension")
+    .Arg("height_scale", "Scale along height dimension")
+    .SetDoc(R"DOC(
+Resizes the spatial dimensions of the NCHW input using bilinear
+interpolation. The size of the output is computed as for ResizeNearest:
+output_width = floor(input_width * width_scale) and
+output_height = floor(input_height * height_scale). The output pixel (y, x)
+samples the input at ((y + 0.5) / height_scale - 0.5,
+(x + 0.5) / width_scale - 0.5), clamped to the input.
+)DOC")
+    .Input(0, "X", "4D input tensor in NCHW order")
+    .Output(0, "Y", "4D output tensor in NCHW order");
+
+// Input: dY, X, output: dX
+OPERATOR_SCHEMA(ResizeBilinearGradient)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .Arg("width_scale", "Scale along width dimension")
+    .Arg("height_scale", "Scale along height dimension");
+
+class GetResizeBilinearGradient : public GradientMakerBase {
+  using GradientMakerBase::GradientMakerBase;
+  vector<OperatorDef> GetGradientDefs() override {
+    return SingleGradientDef(
+        "ResizeBilinearGradient",
+        "",
+        vector<string>{GO(0), I(0)},
+        vector<string>{GI(0)});
+  }
+};
+REGISTER_GRADIENT(ResizeBilinear, GetResizeBilinearGradient);
+
 } // namespace caffe2
@@ -84,6 +84,78 @@ __global__ void NearestNeighborGradientKernel(
   }
 }
 
+// Returns the two source positions of the output position i along one axis
+// and the weight of the second one, as BilinearTaps of resize_op.cc does.
+__device__ float BilinearTap(
+    const int i,
+    const int input_size,
+    const float scale,
+    int* lo,
+    int* hi) {
+  const float src = fmaxf((i + 0.5f) / scale - 0.5f, 0.f);
+  *lo = min(static_cast<int>(src), input_size - 1);
+  *hi = min(*lo + 1, input_size - 1);
+  return *lo == *hi ? 0.f : src - *lo;
+}
+
+__global__ void BilinearKernel(
+    const int size,
+    const int input_height,
+    const int input_width,
+    const int output_height,
+    const int output_width,
+    const float height_scale,
+    const float width_scale,
+    const float* X,
+    float* Y) {
+  CUDA_1D_KERNEL_LOOP(index, size) {
+    const int x = index % output_width;
+    const int y = (index / output_width) % output_height;
+    const int plane = index / output_width / output_height;
+
+    int y_lo, y_hi, x_lo, x_hi;
+    const float ly = BilinearTap(y, input_height, height_scale, &y_lo, &y_hi);
+    const float lx = BilinearTap(x, input_width, width_scale, &x_lo, &x_hi);
+    const float* Xplane = X + plane * input_height * input_width;
+    const float* lo_row = Xplane + y_lo * input_width;
+    const float* hi_row = Xplane + y_hi * input_width;
+    const float top = lo_row[x_lo] + lx * (lo_row[x_hi] - lo_row[x_lo]);
+    const float bottom = hi_row[x_lo] + lx * (hi_row[x_hi] - hi_row[x_lo]);
+    Y[index] = top + ly * (bottom - top);
+  }
+}
+
+__global__ void BilinearGradientKernel(
+    const int size,
+    const int input_height,
+    const int input_width,
+    const int output_height,
+    const int output_width,
+    const float height_scale,
+    const float width_scale,
+    const float* dY,
+    float* dX) {
+  CUDA_1D_KERNEL_LOOP(index, size) {
+    const int x = index % output_width;
+    const int y = (index / output_width) % output_height;
+    const int plane = index / output_width / output_height;
+
+    int y_lo, y_hi, x_lo, x_hi;
+    const float ly = BilinearTap(y, input_height, height_scale, &y_lo, &y_hi);
+    const float lx = BilinearTap(x, input_width, width_scale, &x_lo, &x_hi);
+    float* dXplane = dX + plane * input_height * input_width;
+#if __CUDA_ARCH__ >= 350
+    const float g = __ldg(dY + index);
+#else
+    const float g = dY[index];
+#endif
+    atomicAdd(dXplane + y_lo * input_width + x_lo, g * (1 - ly) * (1 - lx));
+    atomicAdd(dXplane + y_lo * input_width + x_hi, g * (1 - ly) * lx);
+    atomicAdd(dXplane + y_hi * input_width + x_lo, g * ly * (1 - lx));
+    atomicAdd(dXplane + y_hi * input_width + x_hi, g * ly * lx);
+  }
+}
+
 } // namespace
 
 template <>
@@ -155,8 +227,85 @@ bool ResizeNearestGradientOp<float, CUDAContext>::RunOnDevice() {
   return true;
 }
 
+template <>
+bool ResizeBilinearOp<float, CUDAContext>::RunOnDevice() {
+  const auto& X = Input(0);
+  auto* Y = Output(0);
+
+  CAFFE_ENFORCE_EQ(4, X.ndim());
+  const int batch_size = X.dim32(0), num_channels = X.dim32(1),
+            input_height = X.dim32(2), input_width = X.dim32(3);
+  const int output_width = input_width * width_scale_;
+  const int output_height = input_height * height_scale_;
+  Y->Resize(batch_size, num_channels, output_height, output_width);
+  float* Ydata = Y->mutable_data<float>();
+
+  const auto size = Y->size();
+  if (size == 0) {
+    return true;
+  }
+  BilinearKernel<<<
+      CAFFE_GET_BLOCKS(size),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context_.cuda_stream()>>>(
+      size,
+      input_height,
+      input_width,
+      output_height,
+      output_width,
+      height_scale_,
+      width_scale_,
+      X.data<float>(),
+      Ydata);
+
+  return true;
+}
+
+template <>
+bool ResizeBilinearGradientOp<float, CUDAContext>::RunOnDevice() {
+  const auto& dY = Input(0);
+  const auto& X = Input(1);
+  auto* dX = Output(0);
+
+  CAFFE_ENFORCE_EQ(4, dY.ndim());
+  CAFFE_ENFORCE_EQ(4, X.ndim());
+  const int batch_size = dY.dim32(0), num_channels = dY.dim32(1),
+            output_height = dY.dim32(2), output_width = dY.dim32(3);
+  const int input_height = X.dim32(2);
+  const int input_width = X.dim32(3);
+  dX->Resize(batch_size, num_channels, input_height, input_width);
+  math::Set<float, CUDAContext>(
+      dX->size(), 0.0f, dX->mutable_data<float>(), &context_);
+
+  const auto size = dY.size();
+  if (size == 0) {
+    return true;
+  }
+  BilinearGradientKernel<<<
+      CAFFE_GET_BLOCKS(size),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context_.cuda_stream()>>>(
+      size,
+      input_height,
+      input_width,
+      output_height,
+      output_width,
+      height_scale_,
+      width_scale_,
+      dY.data<float>(),
+      dX->mutable_data<float>());
+
+  return true;
+}
+
 REGISTER_CUDA_OPERATOR(ResizeNearest, ResizeNearestOp<float, CUDAContext>);
 REGISTER_CUDA_OPERATOR(
     ResizeNearestGradient,
     ResizeNearestGradientOp<float, CUDAContext>);
+REGISTER_CUDA_OPERATOR(ResizeBilinear, ResizeBilinearOp<float, CUDAContext>);
+REGISTER_CUDA_OPERATOR(
+    ResizeBilinearGradient,
+    ResizeBilinearGradientOp<float, CUDAContext>);
 } // namespace caffe2
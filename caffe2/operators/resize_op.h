@@ -68,4 +68,50 @@ class ResizeNearestGradientOp final : public Operator<Context> {
   T height_scale_;
 };
 
+// Resizes the spatial dimensions of NCHW input with bilinear interpolation,
+// sampling the input at the centers of the output pixels.
+template <typename T, class Context>
+class ResizeBilinearOp final : public Operator<Context> {
+ public:
+  ResizeBilinearOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        width_scale_(static_cast<T>(
+            OperatorBase::GetSingleArgument<float>("width_scale", 1))),
+        height_scale_(static_cast<T>(
+            OperatorBase::GetSingleArgument<float>("height_scale", 1))) {
+    CAFFE_ENFORCE_GT(width_scale_, 0);
+    CAFFE_ENFORCE_GT(height_scale_, 0);
+  }
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+
+  bool RunOnDevice() override;
+
+ protected:
+  T width_scale_;
+  T height_scale_;
+  // Horizontally interpolated input rows, reused by consecutive output rows
+  Tensor<Context> rows_;
+};
+
+template <typename T, class Context>
+class ResizeBilinearGradientOp final : public Operator<Context> {
+ public:
+  ResizeBilinearGradientOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        width_scale_(static_cast<T>(
+            OperatorBase::GetSingleArgument<float>("width_scale", 1))),
+        height_scale_(static_cast<T>(
+            OperatorBase::GetSingleArgument<float>("height_scale", 1))) {
+    CAFFE_ENFORCE_GT(width_scale_, 0);
+    CAFFE_ENFORCE_GT(height_scale_, 0);
+  }
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+
+  bool RunOnDevice() override;
+
+ protected:
+  T width_scale_;
+  T height_scale_;
+};
+
 } // namespace caffe2
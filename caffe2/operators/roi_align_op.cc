@@ -0,0 +1,375 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "roi_align_op.h"
+
+#include "caffe2/utils/run_chunks.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace caffe2 {
+
+namespace {
+
+// The four input positions, h * width + w, around a sampling point and
+// their bilinear weights. Points outside of the input have zero weights.
+struct BilinearSample {
+  int pos[4];
+  float w[4];
+};
+
+BilinearSample MakeSample(int height, int width, float y, float x) {
+  BilinearSample s = {{0, 0, 0, 0}, {0, 0, 0, 0}};
+  if (y < -1.0 || y > height || x < -1.0 || x > width) {
+    return s;
+  }
+  y = std::max(y, 0.f);
+  x = std::max(x, 0.f);
+  int y_low = static_cast<int>(y);
+  int x_low = static_cast<int>(x);
+  int y_high, x_high;
+  if (y_low >= height - 1) {
+    y_high = y_low = height - 1;
+    y = y_low;
+  } else {
+    y_high = y_low + 1;
+  }
+  if (x_low >= width - 1) {
+    x_high = x_low = width - 1;
+    x = x_low;
+  } else {
+    x_high = x_low + 1;
+  }
+  const float ly = y - y_low;
+  const float lx = x - x_low;
+  const float hy = 1. - ly;
+  const float hx = 1. - lx;
+  s.pos[0] = y_low * width + x_low;
+  s.pos[1] = y_low * width + x_high;
+  s.pos[2] = y_high * width + x_low;
+  s.pos[3] = y_high * width + x_high;
+  s.w[0] = hy * hx;
+  s.w[1] = hy * lx;
+  s.w[2] = ly * hx;
+  s.w[3] = ly * lx;
+  return s;
+}
+
+// The geometry of a RoI, [batch_index x1 y1 x2 y2] or [x1 y1 x2 y2] for a
+// batch of one image.
+struct RoIGeometry {
+  int batch_index;
+  float start_h;
+  float start_w;
+  float bin_h;
+  float bin_w;
+  int grid_h;
+  int grid_w;
+};
+
+RoIGeometry GetRoIGeometry(
+    const float* roi,
+    int roi_cols,
+    float spatial_scale,
+    int pooled_height,
+    int pooled_width,
+    int sampling_ratio) {
+  RoIGeometry g;
+  g.batch_index = roi_cols == 5 ? static_cast<int>(roi[0]) : 0;
+  const float* box = roi + roi_cols - 4;
+  g.start_w = box[0] * spatial_scale;
+  g.start_h = box[1] * spatial_scale;
+  // Force malformed RoIs to be 1x1
+  const float roi_w = std::max(box[2] * spatial_scale - g.start_w, 1.f);
+  const float roi_h = std::max(box[3] * spatial_scale - g.start_h, 1.f);
+  g.bin_h = roi_h / pooled_height;
+  g.bin_w = roi_w / pooled_width;
+  g.grid_h = sampling_ratio > 0 ? sampling_ratio
+                                : static_cast<int>(std::ceil(g.bin_h));
+  g.grid_w = sampling_ratio > 0 ? sampling_ratio
+                                : static_cast<int>(std::ceil(g.bin_w));
+  return g;
+}
+
+// Appends the samples of every bin of the RoI, in bin order, grid_h *
+// grid_w per bin. They are the same for all channels, so they are computed
+// once per RoI.
+void MakeSamples(
+    const RoIGeometry& g,
+    int height,
+    int width,
+    int pooled_height,
+    int pooled_width,
+    vector<BilinearSample>* samples) {
+  samples->clear();
+  samples->reserve(pooled_height * pooled_width * g.grid_h * g.grid_w);
+  for (int ph = 0; ph < pooled_height; ++ph) {
+    for (int pw = 0; pw < pooled_width; ++pw) {
+      for (int iy = 0; iy < g.grid_h; ++iy) {
+        const float y =
+            g.start_h + ph * g.bin_h + (iy + .5f) * g.bin_h / g.grid_h;
+        for (int ix = 0; ix < g.grid_w; ++ix) {
+          const float x =
+              g.start_w + pw * g.bin_w + (ix + .5f) * g.bin_w / g.grid_w;
+          samples->push_back(MakeSample(height, width, y, x));
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+
+template <>
+bool RoIAlignOp<float, CPUContext>::RunOnDevice() {
+  const auto& X = Input(0); // Input data to pool
+  const auto& R = Input(1); // RoIs
+  auto* Y = Output(0); // RoI pooled data
+
+  CAFFE_ENFORCE_EQ(X.ndim(), 4);
+  CAFFE_ENFORCE_EQ(R.ndim(), 2);
+  const int roi_cols = R.dim32(1);
+  CAFFE_ENFORCE(
+      roi_cols == 4 || roi_cols == 5, "RoIs must have 4 or 5 columns");
+
+  const bool nchw = order_ == StorageOrder::NCHW;
+  const int batch_size = X.dim32(0);
+  const int channels = X.dim32(nchw ? 1 : 3);
+  const int height = X.dim32(nchw ? 2 : 1);
+  const int width = X.dim32(nchw ? 3 : 2);
+  const int num_rois = R.dim32(0);
+  if (nchw) {
+    Y->Resize(num_rois, channels, pooled_height_, pooled_width_);
+  } else {
+    Y->Resize(num_rois, pooled_height_, pooled_width_, channels);
+  }
+
+  const float* Xdata = X.data<float>();
+  const float* rois = R.data<float>();
+  float* Ydata = Y->mutable_data<float>();
+  const int image_size = height * width;
+  const int pooled_size = pooled_height_ * pooled_width_;
+
+  auto align_rois = [&](int /* unused */, int begin, int end) {
+    vector<BilinearSample> samples;
+    for (int n = begin; n < end; ++n) {
+      const auto g = GetRoIGeometry(
+          rois + n * roi_cols,
+          roi_cols,
+          spatial_scale_,
+          pooled_height_,
+          pooled_width_,
+          sampling_ratio_);
+      CAFFE_ENFORCE_GE(g.batch_index, 0);
+      CAFFE_ENFORCE_LT(g.batch_index, batch_size);
+      MakeSamples(g, height, width, pooled_height_, pooled_width_, &samples);
+      const int grid_size = g.grid_h * g.grid_w;
+      const float scale = 1.f / std::max(grid_size, 1);
+      const float* batch_data = Xdata + g.batch_index * channels * image_size;
+      float* y = Ydata + n * channels * pooled_size;
+
+      if (nchw) {
+        for (int c = 0; c < channels; ++c) {
+          const float* channel_data = batch_data + c * image_size;
+          const BilinearSample* s = samples.data();
+          for (int bin = 0; bin < pooled_size; ++bin) {
+            float sum = 0;
+            for (int i = 0; i < grid_size; ++i, ++s) {
+              sum += s->w[0] * channel_data[s->pos[0]] +
+                  s->w[1] * channel_data[s->pos[1]] +
+                  s->w[2] * channel_data[s->pos[2]] +
+                  s->w[3] * channel_data[s->pos[3]];
+            }
+            y[c * pooled_size + bin] = sum * scale;
+          }
+        }
+        continue;
+      }
+
+      // In NHWC order every sample interpolates all the channels at once,
+      // from four contiguous vectors of the input.
+      const BilinearSample* s = samples.data();
+      for (int bin = 0; bin < pooled_size; ++bin) {
+        EigenVectorArrayMap<float> out(y + bin * channels, channels);
+        out.setZero();
+        for (int i = 0; i < grid_size; ++i, ++s) {
+          for (int k = 0; k < 4; ++k) {
+            if (s->w[k] != 0) {
+              out += s->w[k] *
+                  ConstEigenVectorArrayMap<float>(
+                         batch_data + s->pos[k] * channels, channels);
+            }
+          }
+        }
+        out *= scale;
+      }
+    }
+  };
+  // The RoIs are independent, so they are split evenly over the threads.
+  RunChunks(ws_, std::min(num_threads_, num_rois), num_rois, align_rois);
+  return true;
+}
+
+template <>
+bool RoIAlignGradientOp<float, CPUContext>::RunOnDevice() {
+  const auto& X = Input(0); // Input data to pool
+  const auto& R = Input(1); // RoIs
+  const auto& dY = Input(2); // Gradient of net w.r.t. output of "forward" op
+  auto* dX = Output(0); // Gradient of net w.r.t. input to "forward" op
+
+  CAFFE_ENFORCE_EQ(X.ndim(), 4);
+  CAFFE_ENFORCE_EQ(R.ndim(), 2);
+  const int roi_cols = R.dim32(1);
+  CAFFE_ENFORCE(
+      roi_cols == 4 || roi_cols == 5, "RoIs must have 4 or 5 columns");
+  const int batch_size = X.dim32(0);
+  const int channels = X.dim32(1);
+  const int height = X.dim32(2);
+  const int width = X.dim32(3);
+  const int num_rois = R.dim32(0);
+  const int image_size = height * width;
+  const int pooled_size = pooled_height_ * pooled_width_;
+  CAFFE_ENFORCE_EQ(dY.size(), num_rois * channels * pooled_size);
+
+  dX->ResizeLike(X);
+  float* dXdata = dX->mutable_data<float>();
+  std::fill(dXdata, dXdata + dX->size(), 0.f);
+  const float* rois = R.data<float>();
+  const float* dYdata = dY.data<float>();
+
+  vector<BilinearSample> samples;
+  for (int n = 0; n < num_rois; ++n) {
+    const auto g = GetRoIGeometry(
+        rois + n * roi_cols,
+        roi_cols,
+        spatial_scale_,
+        pooled_height_,
+        pooled_width_,
+        sampling_ratio_);
+    CAFFE_ENFORCE_GE(g.batch_index, 0);
+    CAFFE_ENFORCE_LT(g.batch_index, batch_size);
+    MakeSamples(g, height, width, pooled_height_, pooled_width_, &samples);
+    const int grid_size = g.grid_h * g.grid_w;
+    const float scale = 1.f / std::max(grid_size, 1);
+    float* batch_diff = dXdata + g.batch_index * channels * image_size;
+    const float* dy = dYdata + n * channels * pooled_size;
+    for (int c = 0; c < channels; ++c) {
+      float* channel_diff = batch_diff + c * image_size;
+      const BilinearSample* s = samples.data();
+      for (int bin = 0; bin < pooled_size; ++bin) {
+        const float g_bin = dy[c * pooled_size + bin] * scale;
+        for (int i = 0; i < grid_size; ++i, ++s) {
+          for (int k = 0; k < 4; ++k) {
+            channel_diff[s->pos[k]] += s->w[k] * g_bin;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(RoIAlign, RoIAlignOp<float, CPUContext>);
+REGISTER_CPU_OPERATOR(RoIAlignGradient, RoIAlignGradientOp<float, CPUContext>);
+
+OPERATOR_SCHEMA(RoIAlign)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .TensorInferenceFunction([](const OperatorDef& def,
+                                const vector<TensorShape>& in) {
+      ArgumentHelper helper(def);
+      const StorageOrder order = StringToStorageOrder(
+          helper.GetSingleArgument<string>("order", "NCHW"));
+      const TensorShape& X = in[0];
+      const int num_channels =
+          (order == StorageOrder::NCHW ? X.dims(1) : X.dims(3));
+      const int num_rois = in[1].dims(0);
+      const int pooled_height = helper.GetSingleArgument<int>("pooled_h", 1);
+      const int pooled_width = helper.GetSingleArgument<int>("pooled_w", 1);
+      return vector<TensorShape>({CreateTensorShape(
+          order == StorageOrder::NCHW
+              ? vector<int>(
+                    {num_rois, num_channels, pooled_height, pooled_width})
+              : vector<int>(
+                    {num_rois, pooled_height, pooled_width, num_channels}),
+          X.data_type())});
+    })
+    .SetDoc(R"DOC(
+Region of Interest (RoI) align operation as used in Mask R-CNN. Every RoI is
+divided into pooled_h x pooled_w bins without rounding its coordinates, and
+every bin is the average of the input, bilinearly interpolated at the points
+of a regular grid of sampling_ratio x sampling_ratio points in the bin.
+
+Both NCHW and NHWC orders are supported; the gradient only supports NCHW. On
+CPU the interpolation weights of a RoI are computed once for all channels,
+in NHWC order every sampling point interpolates all channels with vector
+operations, and the RoIs can be split over several threads with
+'num_threads'.
+)DOC")
+    .Arg("order", "A StorageOrder string (Default: \"NCHW\").")
+    .Arg("pooled_h", "The pooled output height (Default: 1).")
+    .Arg("pooled_w", "The pooled output width (Default: 1).")
+    .Arg(
+        "spatial_scale",
+        "Multiplicative spatial scale factor to translate RoI coords from "
+        "their input scale to the scale used when pooling (Default: 1.0).")
+    .Arg(
+        "sampling_ratio",
+        "Number of sampling points per bin along each axis. If not positive, "
+        "ceil(roi_size / pooled_size) for every RoI (Default: -1).")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the CPU "
+        "implementation runs on (Default: 1).")
+    .Input(0, "X", "The input 4-D tensor of data, in NCHW or NHWC order.")
+    .Input(
+        1,
+        "rois",
+        "RoIs (Regions of Interest) to pool over. A 2-D tensor of shape "
+        "(num_rois, 5) given as [[batch_id, x1, y1, x2, y2], ...], or of "
+        "shape (num_rois, 4) for a batch of one image.")
+    .Output(
+        0,
+        "Y",
+        "RoI pooled output 4-D tensor of shape "
+        "(num_rois, channels, pooled_h, pooled_w), or "
+        "(num_rois, pooled_h, pooled_w, channels) in NHWC order.");
+
+// Input: X, rois, dY (aka "gradOutput")
+// Output: dX (aka "gradInput")
+OPERATOR_SCHEMA(RoIAlignGradient)
+    .NumInputs(3)
+    .NumOutputs(1)
+    .Input(0, "X", "The input of RoIAlign, in NCHW order.")
+    .Input(1, "rois", "The RoIs of RoIAlign.")
+    .Input(2, "dY", "Gradient of the output of RoIAlign.")
+    .Output(0, "dX", "Gradient of X.");
+
+class GetRoIAlignGradient : public GradientMakerBase {
+  using GradientMakerBase::GradientMakerBase;
+  vector<OperatorDef> GetGradientDefs() override {
+    return SingleGradientDef(
+        "RoIAlignGradient",
+        "",
+        vector<string>{I(0), I(1), GO(0)},
+        vector<string>{GI(0)});
+  }
+};
+
+REGISTER_GRADIENT(RoIAlign, GetRoIAlignGradient);
+
+} // namespace caffe2
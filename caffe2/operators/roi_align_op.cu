@@ -0,0 +1,323 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/context_gpu.h"
+#include "roi_align_op.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Computes the four positions around (y, x), h * width + w, and their
+// bilinear weights, which are zero outside of the input.
+template <typename T>
+__device__ void BilinearWeights(
+    const int height,
+    const int width,
+    T y,
+    T x,
+    int* pos,
+    T* w) {
+  if (y < -1.0 || y > height || x < -1.0 || x > width) {
+    pos[0] = pos[1] = pos[2] = pos[3] = 0;
+    w[0] = w[1] = w[2] = w[3] = 0;
+    return;
+  }
+  y = max(y, T(0));
+  x = max(x, T(0));
+  int y_low = static_cast<int>(y);
+  int x_low = static_cast<int>(x);
+  int y_high, x_high;
+  if (y_low >= height - 1) {
+    y_high = y_low = height - 1;
+    y = y_low;
+  } else {
+    y_high = y_low + 1;
+  }
+  if (x_low >= width - 1) {
+    x_high = x_low = width - 1;
+    x = x_low;
+  } else {
+    x_high = x_low + 1;
+  }
+  const T ly = y - y_low;
+  const T lx = x - x_low;
+  const T hy = 1. - ly;
+  const T hx = 1. - lx;
+  pos[0] = y_low * width + x_low;
+  pos[1] = y_low * width + x_high;
+  pos[2] = y_high * width + x_low;
+  pos[3] = y_high * width + x_high;
+  w[0] = hy * hx;
+  w[1] = hy * lx;
+  w[2] = ly * hx;
+  w[3] = ly * lx;
+}
+
+// Reads the RoI n, [batch_index x1 y1 x2 y2] or [x1 y1 x2 y2], and returns
+// its batch index, start, bin size and sampling grid.
+template <typename T>
+__device__ int RoIGeometry(
+    const T* rois,
+    const int roi_cols,
+    const int n,
+    const T spatial_scale,
+    const int pooled_height,
+    const int pooled_width,
+    const int sampling_ratio,
+    T* start_h,
+    T* start_w,
+    T* bin_h,
+    T* bin_w,
+    int* grid_h,
+    int* grid_w) {
+  const T* roi = rois + n * roi_cols;
+  const int batch_index = roi_cols == 5 ? static_cast<int>(roi[0]) : 0;
+  const T* box = roi + roi_cols - 4;
+  *start_w = box[0] * spatial_scale;
+  *start_h = box[1] * spatial_scale;
+  // Force malformed RoIs to be 1x1
+  const T roi_w = max(box[2] * spatial_scale - *start_w, T(1));
+  const T roi_h = max(box[3] * spatial_scale - *start_h, T(1));
+  *bin_h = roi_h / pooled_height;
+  *bin_w = roi_w / pooled_width;
+  *grid_h = sampling_ratio > 0 ? sampling_ratio : ceil(*bin_h);
+  *grid_w = sampling_ratio > 0 ? sampling_ratio : ceil(*bin_w);
+  return batch_index;
+}
+
+// In NHWC order the threads of consecutive channels of a bin read
+// consecutive inputs.
+template <typename T, bool kNHWC>
+__global__ void RoIAlignForward(
+    const int nthreads,
+    const T* bottom_data,
+    const T spatial_scale,
+    const int channels,
+    const int height,
+    const int width,
+    const int pooled_height,
+    const int pooled_width,
+    const int sampling_ratio,
+    const T* bottom_rois,
+    const int roi_cols,
+    T* top_data) {
+  CUDA_1D_KERNEL_LOOP(index, nthreads) {
+    // (n, c, ph, pw) is an element in the pooled output
+    int c, ph, pw, n;
+    if (kNHWC) {
+      c = index % channels;
+      pw = (index / channels) % pooled_width;
+      ph = (index / channels / pooled_width) % pooled_height;
+      n = index / channels / pooled_width / pooled_height;
+    } else {
+      pw = index % pooled_width;
+      ph = (index / pooled_width) % pooled_height;
+      c = (index / pooled_width / pooled_height) % channels;
+      n = index / pooled_width / pooled_height / channels;
+    }
+
+    T start_h, start_w, bin_h, bin_w;
+    int grid_h, grid_w;
+    const int batch_index = RoIGeometry(
+        bottom_rois,
+        roi_cols,
+        n,
+        spatial_scale,
+        pooled_height,
+        pooled_width,
+        sampling_ratio,
+        &start_h,
+        &start_w,
+        &bin_h,
+        &bin_w,
+        &grid_h,
+        &grid_w);
+    const T* offset_bottom_data = kNHWC
+        ? bottom_data + batch_index * height * width * channels + c
+        : bottom_data + (batch_index * channels + c) * height * width;
+    const int stride = kNHWC ? channels : 1;
+
+    T sum = 0;
+    int pos[4];
+    T w[4];
+    for (int iy = 0; iy < grid_h; ++iy) {
+      const T y = start_h + ph * bin_h + (iy + .5f) * bin_h / grid_h;
+      for (int ix = 0; ix < grid_w; ++ix) {
+        const T x = start_w + pw * bin_w + (ix + .5f) * bin_w / grid_w;
+        BilinearWeights(height, width, y, x, pos, w);
+        for (int k = 0; k < 4; ++k) {
+          sum += w[k] * offset_bottom_data[pos[k] * stride];
+        }
+      }
+    }
+    top_data[index] = sum / max(grid_h * grid_w, 1);
+  }
+}
+
+template <typename T>
+__global__ void RoIAlignBackward(
+    const int nthreads,
+    const T* top_diff,
+    const T spatial_scale,
+    const int channels,
+    const int height,
+    const int width,
+    const int pooled_height,
+    const int pooled_width,
+    const int sampling_ratio,
+    T* bottom_diff,
+    const T* bottom_rois,
+    const int roi_cols) {
+  CUDA_1D_KERNEL_LOOP(index, nthreads) {
+    // (n, c, ph, pw) is an element in the pooled output
+    int pw = index % pooled_width;
+    int ph = (index / pooled_width) % pooled_height;
+    int c = (index / pooled_width / pooled_height) % channels;
+    int n = index / pooled_width / pooled_height / channels;
+
+    T start_h, start_w, bin_h, bin_w;
+    int grid_h, grid_w;
+    const int batch_index = RoIGeometry(
+        bottom_rois,
+        roi_cols,
+        n,
+        spatial_scale,
+        pooled_height,
+        pooled_width,
+        sampling_ratio,
+        &start_h,
+        &start_w,
+        &bin_h,
+        &bin_w,
+        &grid_h,
+        &grid_w);
+    T* offset_bottom_diff =
+        bottom_diff + (batch_index * channels + c) * height * width;
+    const T g = top_diff[index] / max(grid_h * grid_w, 1);
+
+    int pos[4];
+    T w[4];
+    for (int iy = 0; iy < grid_h; ++iy) {
+      const T y = start_h + ph * bin_h + (iy + .5f) * bin_h / grid_h;
+      for (int ix = 0; ix < grid_w; ++ix) {
+        const T x = start_w + pw * bin_w + (ix + .5f) * bin_w / grid_w;
+        BilinearWeights(height, width, y, x, pos, w);
+        for (int k = 0; k < 4; ++k) {
+          if (w[k] != 0) {
+            atomicAdd(offset_bottom_diff + pos[k], w[k] * g);
+          }
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+
+template <>
+bool RoIAlignOp<float, CUDAContext>::RunOnDevice() {
+  auto& X = Input(0); // Input data to pool
+  auto& R = Input(1); // RoIs
+  auto* Y = Output(0); // RoI pooled data
+
+  CAFFE_ENFORCE_EQ(X.ndim(), 4);
+  CAFFE_ENFORCE_EQ(R.ndim(), 2);
+  const int roi_cols = R.dim32(1);
+  CAFFE_ENFORCE(
+      roi_cols == 4 || roi_cols == 5, "RoIs must have 4 or 5 columns");
+  const bool nchw = order_ == StorageOrder::NCHW;
+  const int channels = X.dim32(nchw ? 1 : 3);
+  const int height = X.dim32(nchw ? 2 : 1);
+  const int width = X.dim32(nchw ? 3 : 2);
+  if (nchw) {
+    Y->Resize(R.dim32(0), channels, pooled_height_, pooled_width_);
+  } else {
+    Y->Resize(R.dim32(0), pooled_height_, pooled_width_, channels);
+  }
+  // mutable_data is needed to allocate the output, even without rois.
+  float* top_data = Y->mutable_data<float>();
+  const int output_size = Y->size();
+  if (output_size == 0) {
+    return true;
+  }
+  auto* kernel = nchw ? RoIAlignForward<float, false>
+                      : RoIAlignForward<float, true>;
+  kernel<<<
+      CAFFE_GET_BLOCKS(output_size),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context_.cuda_stream()>>>(
+      output_size,
+      X.data<float>(),
+      spatial_scale_,
+      channels,
+      height,
+      width,
+      pooled_height_,
+      pooled_width_,
+      sampling_ratio_,
+      R.data<float>(),
+      roi_cols,
+      top_data);
+  return true;
+}
+
+template <>
+bool RoIAlignGradientOp<float, CUDAContext>::RunOnDevice() {
+  auto& X = Input(0); // Input data to pool
+  auto& R = Input(1); // RoIs
+  auto& dY = Input(2); // Gradient of net w.r.t. output of "forward" op
+  auto* dX = Output(0); // Gradient of net w.r.t. input to "forward" op
+
+  CAFFE_ENFORCE_EQ(X.ndim(), 4);
+  CAFFE_ENFORCE_EQ(R.ndim(), 2);
+  const int roi_cols = R.dim32(1);
+  CAFFE_ENFORCE(
+      roi_cols == 4 || roi_cols == 5, "RoIs must have 4 or 5 columns");
+
+  dX->ResizeLike(X);
+  // Must zero-out dX before accumulating gradients
+  math::Set<float, CUDAContext>(
+      dX->size(), 0.f, dX->mutable_data<float>(), &context_);
+  if (dY.size() > 0) { // Handle possibly empty gradient if there were no rois
+    RoIAlignBackward<float><<<
+        CAFFE_GET_BLOCKS(dY.size()),
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context_.cuda_stream()>>>(
+        dY.size(),
+        dY.data<float>(),
+        spatial_scale_,
+        X.dim32(1),
+        X.dim32(2),
+        X.dim32(3),
+        pooled_height_,
+        pooled_width_,
+        sampling_ratio_,
+        dX->mutable_data<float>(),
+        R.data<float>(),
+        roi_cols);
+  }
+  return true;
+}
+
+REGISTER_CUDA_OPERATOR(RoIAlign, RoIAlignOp<float, CUDAContext>);
+REGISTER_CUDA_OPERATOR(
+    RoIAlignGradient,
+    RoIAlignGradientOp<float, CUDAContext>);
+
+} // namespace caffe2
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ROI_ALIGN_OP_H_
+#define ROI_ALIGN_OP_H_
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// Average pools every RoI into pooled_h x pooled_w bins, each the mean of
+// bilinearly interpolated samples of the input on a regular grid, as in
+// Mask R-CNN. The RoI coordinates are not rounded.
+template <typename T, class Context>
+class RoIAlignOp final : public Operator<Context> {
+ public:
+  RoIAlignOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        order_(StringToStorageOrder(
+            OperatorBase::GetSingleArgument<string>("order", "NCHW"))),
+        spatial_scale_(
+            OperatorBase::GetSingleArgument<float>("spatial_scale", 1.)),
+        pooled_height_(OperatorBase::GetSingleArgument<int>("pooled_h", 1)),
+        pooled_width_(OperatorBase::GetSingleArgument<int>("pooled_w", 1)),
+        sampling_ratio_(
+            OperatorBase::GetSingleArgument<int>("sampling_ratio", -1)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GT(spatial_scale_, 0);
+    CAFFE_ENFORCE_GT(pooled_height_, 0);
+    CAFFE_ENFORCE_GT(pooled_width_, 0);
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+
+  bool RunOnDevice() override;
+
+ protected:
+  StorageOrder order_;
+  float spatial_scale_;
+  int pooled_height_;
+  int pooled_width_;
+  // Samples per bin along each axis; if not positive, ceil(roi_size /
+  // pooled_size) for each RoI.
+  int sampling_ratio_;
+  int num_threads_;
+  Workspace* ws_;
+};
+
+template <typename T, class Context>
+class RoIAlignGradientOp final : public Operator<Context> {
+ public:
+  RoIAlignGradientOp(const OperatorDef& def, Workspace* ws)
+      : Operator<Context>(def, ws),
+        spatial_scale_(
+            OperatorBase::GetSingleArgument<float>("spatial_scale", 1.)),
+        pooled_height_(OperatorBase::GetSingleArgument<int>("pooled_h", 1)),
+        pooled_width_(OperatorBase::GetSingleArgument<int>("pooled_w", 1)),
+        sampling_ratio_(
+            OperatorBase::GetSingleArgument<int>("sampling_ratio", -1)) {
+    CAFFE_ENFORCE_GT(spatial_scale_, 0);
+    CAFFE_ENFORCE_GT(pooled_height_, 0);
+    CAFFE_ENFORCE_GT(pooled_width_, 0);
+    CAFFE_ENFORCE_EQ(
+        StringToStorageOrder(
+            OperatorBase::GetSingleArgument<string>("order", "NCHW")),
+        StorageOrder::NCHW,
+        "The gradient of RoIAlign only supports NCHW order.");
+  }
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+
+  bool RunOnDevice() override;
+
+ protected:
+  float spatial_scale_;
+  int pooled_height_;
+  int pooled_width_;
+  int sampling_ratio_;
+};
+
+} // namespace caffe2
+
+#endif // ROI_ALIGN_OP_H_
@@ -0,0 +1,171 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+void SetTensor(
+    Workspace* ws,
+    const string& name,
+    const vector<TIndex>& dims,
+    const vector<float>& values) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  std::copy(values.begin(), values.end(), tensor->mutable_data<float>());
+}
+
+template <typename T>
+vector<T> GetTensor(Workspace* ws, const string& name) {
+  const auto& tensor = ws->GetBlob(name)->Get<TensorCPU>();
+  return vector<T>(tensor.data<T>(), tensor.data<T>() + tensor.size());
+}
+
+// Fills X, of shape (2, 3, 5, 6) in NCHW order, and its NHWC transpose
+// X_nhwc, and a few RoIs, some of them partly outside of the image.
+void FillInputs(Workspace* ws) {
+  const int N = 2, C = 3, H = 5, W = 6;
+  vector<float> nchw(N * C * H * W), nhwc(N * C * H * W);
+  for (int n = 0; n < N; ++n) {
+    for (int c = 0; c < C; ++c) {
+      for (int h = 0; h < H; ++h) {
+        for (int w = 0; w < W; ++w) {
+          const float value = (n * 7 + c * 3 + h * 5 + w * 11) % 13 - 6.5f;
+          nchw[((n * C + c) * H + h) * W + w] = value;
+          nhwc[((n * H + h) * W + w) * C + c] = value;
+        }
+      }
+    }
+  }
+  SetTensor(ws, "X", {N, C, H, W}, nchw);
+  SetTensor(ws, "X_nhwc", {N, H, W, C}, nhwc);
+  SetTensor(
+      ws,
+      "R",
+      {4, 5},
+      {0, 0, 0, 5, 4, 1, 1.5, 0.5, 4.2, 3.7, 1, -2, -1, 3, 2, 0, 4, 3, 9, 8});
+}
+
+// Returns the NCHW transpose of the NHWC output of op_type and checks that
+// it does not depend on the number of threads.
+vector<float> RunNHWC(Workspace* ws, const string& op_type) {
+  vector<float> first;
+  for (int num_threads : {1, 3}) {
+    EXPECT_TRUE(ws->RunOperatorOnce(CreateOperatorDef(
+        op_type,
+        "",
+        {"X_nhwc", "R"},
+        {"Y_nhwc"},
+        {MakeArgument<string>("order", "NHWC"),
+         MakeArgument<int>("pooled_h", 2),
+         MakeArgument<int>("pooled_w", 3),
+         MakeArgument<float>("spatial_scale", 0.9f),
+         MakeArgument<int>("num_threads", num_threads),
+         MakeArgument<int>(OpSchema::Arg_IsTest, 1)})));
+    auto y = GetTensor<float>(ws, "Y_nhwc");
+    if (first.empty()) {
+      first = y;
+    } else {
+      EXPECT_EQ(first, y);
+    }
+  }
+  const int R = 4, C = 3, P = 6;
+  vector<float> transposed(first.size());
+  for (int r = 0; r < R; ++r) {
+    for (int p = 0; p < P; ++p) {
+      for (int c = 0; c < C; ++c) {
+        transposed[(r * C + c) * P + p] = first[(r * P + p) * C + c];
+      }
+    }
+  }
+  return transposed;
+}
+
+vector<float> RunNCHW(Workspace* ws, const string& op_type) {
+  EXPECT_TRUE(ws->RunOperatorOnce(CreateOperatorDef(
+      op_type,
+      "",
+      {"X", "R"},
+      {"Y"},
+      {MakeArgument<int>("pooled_h", 2),
+       MakeArgument<int>("pooled_w", 3),
+       MakeArgument<float>("spatial_scale", 0.9f),
+       MakeArgument<int>("num_threads", 2),
+       MakeArgument<int>(OpSchema::Arg_IsTest, 1)})));
+  return GetTensor<float>(ws, "Y");
+}
+
+} // namespace
+
+TEST(RoIPoolOpTest, NHWCMatchesNCHW) {
+  Workspace ws;
+  FillInputs(&ws);
+  const auto nchw = RunNCHW(&ws, "RoIPool");
+  const auto nhwc = RunNHWC(&ws, "RoIPool");
+  ASSERT_EQ(nchw.size(), 4 * 3 * 2 * 3);
+  EXPECT_EQ(nchw, nhwc);
+}
+
+TEST(RoIAlignOpTest, NHWCMatchesNCHW) {
+  Workspace ws;
+  FillInputs(&ws);
+  const auto nchw = RunNCHW(&ws, "RoIAlign");
+  const auto nhwc = RunNHWC(&ws, "RoIAlign");
+  ASSERT_EQ(nchw.size(), nhwc.size());
+  for (int i = 0; i < nchw.size(); ++i) {
+    EXPECT_NEAR(nchw[i], nhwc[i], 1e-5) << i;
+  }
+}
+
+TEST(RoIAlignOpTest, ConstantInputAndGradient) {
+  Workspace ws;
+  SetTensor(&ws, "X", {1, 2, 8, 8}, vector<float>(128, 3.f));
+  // Two RoIs well inside of the image, without batch index.
+  SetTensor(&ws, "R", {2, 4}, {1, 1, 5, 6, 2.5, 0.5, 7, 3});
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "RoIAlign",
+      "",
+      {"X", "R"},
+      {"Y"},
+      {MakeArgument<int>("pooled_h", 2),
+       MakeArgument<int>("pooled_w", 2),
+       MakeArgument<int>("sampling_ratio", 2)})));
+  for (float y : GetTensor<float>(&ws, "Y")) {
+    EXPECT_NEAR(y, 3.f, 1e-5);
+  }
+
+  // Every bin spreads its gradient over the input with weights summing to 1.
+  SetTensor(&ws, "dY", {2, 2, 2, 2}, vector<float>(16, 0.5f));
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "RoIAlignGradient",
+      "",
+      {"X", "R", "dY"},
+      {"dX"},
+      {MakeArgument<int>("pooled_h", 2),
+       MakeArgument<int>("pooled_w", 2),
+       MakeArgument<int>("sampling_ratio", 2)})));
+  float sum = 0;
+  for (float g : GetTensor<float>(&ws, "dX")) {
+    sum += g;
+  }
+  EXPECT_NEAR(sum, 8.f, 1e-4);
+}
+
+} // namespace caffe2
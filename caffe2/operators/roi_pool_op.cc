@@ -16,6 +16,9 @@
 
 #include "roi_pool_op.h"
 
+#include "caffe2/utils/run_chunks.h"
+
+#include <algorithm>
 #include <cfloat>
 
 namespace caffe2 {
@@ -23,6 +26,127 @@ namespace caffe2 {
 using std::max;
 using std::min;
 
+namespace {
+
+// Max pools the RoI roi = [batch_index x1 y1 x2 y2] of X into Y, and its
+// argmaxes into A unless it is null. Y and A point to the output of the RoI,
+// of shape (channels, pooled_height, pooled_width) in NCHW order and
+// (pooled_height, pooled_width, channels) in NHWC order. The argmaxes are
+// the positions h * width + w of the maxima in their channel, or -1 for
+// empty bins, in either order.
+void RoIPoolOne(
+    const float* X,
+    const float* roi,
+    StorageOrder order,
+    int batch_size,
+    int channels,
+    int height,
+    int width,
+    int pooled_height,
+    int pooled_width,
+    float spatial_scale,
+    float* Y,
+    int* A) {
+  int roi_batch_id = roi[0];
+  int roi_start_w = round(roi[1] * spatial_scale);
+  int roi_start_h = round(roi[2] * spatial_scale);
+  int roi_end_w = round(roi[3] * spatial_scale);
+  int roi_end_h = round(roi[4] * spatial_scale);
+  CAFFE_ENFORCE_GE(roi_batch_id, 0);
+  CAFFE_ENFORCE_LT(roi_batch_id, batch_size);
+
+  // Force malformed ROIs to be 1x1
+  int roi_height = max(roi_end_h - roi_start_h + 1, 1);
+  int roi_width = max(roi_end_w - roi_start_w + 1, 1);
+
+  const float bin_size_h =
+      static_cast<float>(roi_height) / static_cast<float>(pooled_height);
+  const float bin_size_w =
+      static_cast<float>(roi_width) / static_cast<float>(pooled_width);
+
+  const int image_size = height * width;
+  const float* batch_data = X + roi_batch_id * channels * image_size;
+  const int pooled_size = pooled_height * pooled_width;
+
+  for (int ph = 0; ph < pooled_height; ++ph) {
+    for (int pw = 0; pw < pooled_width; ++pw) {
+      // Compute pooling region for this output unit:
+      //  start (included) = floor(ph * roi_height / pooled_height_)
+      //  end (excluded) = ceil((ph + 1) * roi_height / pooled_height_)
+      int hstart =
+          static_cast<int>(floor(static_cast<float>(ph) * bin_size_h));
+      int wstart =
+          static_cast<int>(floor(static_cast<float>(pw) * bin_size_w));
+      int hend =
+          static_cast<int>(ceil(static_cast<float>(ph + 1) * bin_size_h));
+      int wend =
+          static_cast<int>(ceil(static_cast<float>(pw + 1) * bin_size_w));
+
+      // Add roi offsets and clip to input boundaries
+      hstart = min(max(hstart + roi_start_h, 0), height);
+      hend = min(max(hend + roi_start_h, 0), height);
+      wstart = min(max(wstart + roi_start_w, 0), width);
+      wend = min(max(wend + roi_start_w, 0), width);
+
+      // Define an empty pooling region to be zero. If nothing is pooled,
+      // argmax = -1 causes nothing to be backprop'd.
+      const bool is_empty = (hend <= hstart) || (wend <= wstart);
+      const int pool_index = ph * pooled_width + pw;
+
+      if (order == StorageOrder::NCHW) {
+        for (int c = 0; c < channels; ++c) {
+          const float* channel_data = batch_data + c * image_size;
+          float maxval = is_empty ? 0 : -FLT_MAX;
+          int maxidx = -1;
+          for (int h = hstart; h < hend; ++h) {
+            for (int w = wstart; w < wend; ++w) {
+              const int index = h * width + w;
+              if (channel_data[index] > maxval) {
+                maxval = channel_data[index];
+                maxidx = index;
+              }
+            }
+          }
+          Y[c * pooled_size + pool_index] = maxval;
+          if (A) {
+            A[c * pooled_size + pool_index] = maxidx;
+          }
+        }
+        continue;
+      }
+
+      // In NHWC order the channels of a position are contiguous, so every
+      // position updates the maxima of all channels at once.
+      float* y = Y + pool_index * channels;
+      int* a = A ? A + pool_index * channels : nullptr;
+      std::fill(y, y + channels, is_empty ? 0 : -FLT_MAX);
+      if (a) {
+        std::fill(a, a + channels, -1);
+      }
+      for (int h = hstart; h < hend; ++h) {
+        for (int w = wstart; w < wend; ++w) {
+          const int index = h * width + w;
+          const float* x = batch_data + index * channels;
+          if (a) {
+            for (int c = 0; c < channels; ++c) {
+              if (x[c] > y[c]) {
+                y[c] = x[c];
+                a[c] = index;
+              }
+            }
+          } else {
+            for (int c = 0; c < channels; ++c) {
+              y[c] = max(y[c], x[c]);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+
 template <>
 bool RoIPoolOp<float, CPUContext>::RunOnDevice() {
   const auto& X = Input(0); // Input data to pool
@@ -31,16 +155,22 @@ bool RoIPoolOp<float, CPUContext>::RunOnDevice() {
   auto* A = is_test_ ? nullptr : Output(1); // argmaxes
 
   // Each ROI is of the form [batch_index x1 y1 x2 y2]
+  CAFFE_ENFORCE_EQ(X.ndim(), 4);
+  CAFFE_ENFORCE_EQ(R.ndim(), 2);
   CAFFE_ENFORCE_EQ(R.dim32(1), 5);
 
-  // TODO: Handle the storage_order properly to get the NCWH.
-  int batch_size = X.dim32(0);
-  int channels = X.dim32(1);
-  int height = X.dim32(2);
-  int width = X.dim32(3);
-  int num_rois = R.dim32(0);
+  const bool nchw = order_ == StorageOrder::NCHW;
+  const int batch_size = X.dim32(0);
+  const int channels = X.dim32(nchw ? 1 : 3);
+  const int height = X.dim32(nchw ? 2 : 1);
+  const int width = X.dim32(nchw ? 3 : 2);
+  const int num_rois = R.dim32(0);
 
-  Y->Resize(num_rois, channels, pooled_height_, pooled_width_);
+  if (nchw) {
+    Y->Resize(num_rois, channels, pooled_height_, pooled_width_);
+  } else {
+    Y->Resize(num_rois, pooled_height_, pooled_width_, channels);
+  }
   if (!is_test_) {
     A->Resize(Y->dims());
   }
@@ -49,82 +179,28 @@ bool RoIPoolOp<float, CPUContext>::RunOnDevice() {
   const float* rois = R.data<float>();
   float* Ydata = Y->mutable_data<float>();
   int* argmax_data = is_test_ ? nullptr : A->mutable_data<int>();
+  const int roi_output_size = channels * pooled_height_ * pooled_width_;
 
   // For each ROI R = [batch_index x1 y1 x2 y2]: max pool over R
-  for (int n = 0; n < num_rois; ++n) {
-    int roi_batch_id = rois[0];
-    int roi_start_w = round(rois[1] * spatial_scale_);
-    int roi_start_h = round(rois[2] * spatial_scale_);
-    int roi_end_w = round(rois[3] * spatial_scale_);
-    int roi_end_h = round(rois[4] * spatial_scale_);
-    CAFFE_ENFORCE_GE(roi_batch_id, 0);
-    CAFFE_ENFORCE_LT(roi_batch_id, batch_size);
-
-    // Force malformed ROIs to be 1x1
-    int roi_height = max(roi_end_h - roi_start_h + 1, 1);
-    int roi_width = max(roi_end_w - roi_start_w + 1, 1);
-
-    const float bin_size_h =
-        static_cast<float>(roi_height) / static_cast<float>(pooled_height_);
-    const float bin_size_w =
-        static_cast<float>(roi_width) / static_cast<float>(pooled_width_);
-
-    const float* batch_data = Xdata + roi_batch_id * X.size_from_dim(1);
-
-    for (int c = 0; c < channels; ++c) {
-      for (int ph = 0; ph < pooled_height_; ++ph) {
-        for (int pw = 0; pw < pooled_width_; ++pw) {
-          // Compute pooling region for this output unit:
-          //  start (included) = floor(ph * roi_height / pooled_height_)
-          //  end (excluded) = ceil((ph + 1) * roi_height / pooled_height_)
-          int hstart =
-              static_cast<int>(floor(static_cast<float>(ph) * bin_size_h));
-          int wstart =
-              static_cast<int>(floor(static_cast<float>(pw) * bin_size_w));
-          int hend =
-              static_cast<int>(ceil(static_cast<float>(ph + 1) * bin_size_h));
-          int wend =
-              static_cast<int>(ceil(static_cast<float>(pw + 1) * bin_size_w));
-
-          // Add roi offsets and clip to input boundaries
-          hstart = min(max(hstart + roi_start_h, 0), height);
-          hend = min(max(hend + roi_start_h, 0), height);
-          wstart = min(max(wstart + roi_start_w, 0), width);
-          wend = min(max(wend + roi_start_w, 0), width);
-
-          const int pool_index = ph * pooled_width_ + pw;
-
-          // Define an empty pooling region to be zero
-          bool is_empty = (hend <= hstart) || (wend <= wstart);
-          Ydata[pool_index] = is_empty ? 0 : -FLT_MAX;
-          if (!is_test_) {
-            // If nothing is pooled, argmax = -1 causes nothing to be backprop'd
-            argmax_data[pool_index] = -1;
-          }
-
-          for (int h = hstart; h < hend; ++h) {
-            for (int w = wstart; w < wend; ++w) {
-              const int index = h * width + w;
-              if (batch_data[index] > Ydata[pool_index]) {
-                Ydata[pool_index] = batch_data[index];
-                if (!is_test_) {
-                  argmax_data[pool_index] = index;
-                }
-              }
-            }
-          }
-        }
-      }
-      // Increment all data pointers by one channel
-      batch_data += X.size_from_dim(2);
-      Ydata += Y->size_from_dim(2);
-      if (!is_test_) {
-        argmax_data += A->size_from_dim(2);
-      }
+  auto pool_rois = [&](int /* unused */, int begin, int end) {
+    for (int n = begin; n < end; ++n) {
+      RoIPoolOne(
+          Xdata,
+          rois + n * 5,
+          order_,
+          batch_size,
+          channels,
+          height,
+          width,
+          pooled_height_,
+          pooled_width_,
+          spatial_scale_,
+          Ydata + n * roi_output_size,
+          argmax_data ? argmax_data + n * roi_output_size : nullptr);
     }
-    // Increment ROI data pointer
-    rois += R.size_from_dim(1);
-  }
+  };
+  // The RoIs are independent, so they are split evenly over the threads.
+  RunChunks(ws_, min(num_threads_, num_rois), num_rois, pool_rois);
 
   return true;
 }
@@ -151,7 +227,11 @@ OPERATOR_SCHEMA(RoIPool)
       const int pooled_height = helper.GetSingleArgument<int>("pooled_h", 1);
       const int pooled_width = helper.GetSingleArgument<int>("pooled_w", 1);
       TensorShape Y = CreateTensorShape(
-          vector<int>({num_rois, num_channels, pooled_height, pooled_width}),
+          order == StorageOrder::NCHW
+              ? vector<int>(
+                    {num_rois, num_channels, pooled_height, pooled_width})
+              : vector<int>(
+                    {num_rois, pooled_height, pooled_width, num_channels}),
           X.data_type());
 
       bool is_test = helper.GetSingleArgument<int>(OpSchema::Arg_IsTest, 0);
@@ -169,6 +249,9 @@ Depending on the mode, there are multiple output cases:
 
   Output case #1: Y, argmaxes (train mode)
   Output case #2: Y           (test mode)
+
+Both NCHW and NHWC orders are supported; the gradient only supports NCHW.
+On CPU the RoIs can be split over several threads with 'num_threads'.
 )DOC")
     .Arg(
         "is_test",
@@ -176,6 +259,10 @@ Depending on the mode, there are multiple output cases:
         "gradient computation). Only one output tensor is produced. "
         "(Default: false).")
     .Arg("order", "A StorageOrder string (Default: \"NCHW\").")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the CPU "
+        "implementation runs on (Default: 1).")
     .Arg("pooled_h", "The pooled output height (Default: 1).")
     .Arg("pooled_w", "The pooled output width (Default: 1).")
     .Arg(
@@ -185,7 +272,7 @@ Depending on the mode, there are multiple output cases:
     .Input(
         0,
         "X",
-        "The input 4-D tensor of data. Only NCHW order is currently supported.")
+        "The input 4-D tensor of data, in NCHW or NHWC order.")
     .Input(
         1,
         "rois",
@@ -195,7 +282,8 @@ Depending on the mode, there are multiple output cases:
         0,
         "Y",
         "RoI pooled output 4-D tensor of shape "
-        "(num_rois, channels, pooled_h, pooled_w).")
+        "(num_rois, channels, pooled_h, pooled_w), or "
+        "(num_rois, pooled_h, pooled_w, channels) in NHWC order.")
     .Output(
         1,
         "argmaxes",
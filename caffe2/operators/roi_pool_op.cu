@@ -31,7 +31,9 @@ inline __device__ float gpu_atomic_add(const float val, float* address) {
   return atomicAdd(address, val);
 }
 
-template <typename T>
+// In NHWC order the threads of consecutive channels of a bin read
+// consecutive inputs. The argmaxes are h * width + w in either order.
+template <typename T, bool kNHWC>
 __global__ void ROIPoolForward(
     const int nthreads,
     const T* bottom_data,
@@ -46,10 +48,18 @@ __global__ void ROIPoolForward(
     int* argmax_data) {
   CUDA_1D_KERNEL_LOOP(index, nthreads) {
     // (n, c, ph, pw) is an element in the pooled output
-    int pw = index % pooled_width;
-    int ph = (index / pooled_width) % pooled_height;
-    int c = (index / pooled_width / pooled_height) % channels;
-    int n = index / pooled_width / pooled_height / channels;
+    int c, ph, pw, n;
+    if (kNHWC) {
+      c = index % channels;
+      pw = (index / channels) % pooled_width;
+      ph = (index / channels / pooled_width) % pooled_height;
+      n = index / channels / pooled_width / pooled_height;
+    } else {
+      pw = index % pooled_width;
+      ph = (index / pooled_width) % pooled_height;
+      c = (index / pooled_width / pooled_height) % channels;
+      n = index / pooled_width / pooled_height / channels;
+    }
 
     const T* offset_bottom_rois = bottom_rois + n * 5;
     int roi_batch_ind = offset_bottom_rois[0];
@@ -80,13 +90,16 @@ __global__ void ROIPoolForward(
     T maxval = is_empty ? 0 : -FLT_MAX;
     // If nothing is pooled, argmax = -1 causes nothing to be backprop'd
     int maxidx = -1;
-    const T* offset_bottom_data =
-        bottom_data + (roi_batch_ind * channels + c) * height * width;
+    const T* offset_bottom_data = kNHWC
+        ? bottom_data + roi_batch_ind * height * width * channels + c
+        : bottom_data + (roi_batch_ind * channels + c) * height * width;
+    const int stride = kNHWC ? channels : 1;
     for (int h = hstart; h < hend; ++h) {
       for (int w = wstart; w < wend; ++w) {
         int bottom_index = h * width + w;
-        if (offset_bottom_data[bottom_index] > maxval) {
-          maxval = offset_bottom_data[bottom_index];
+        const T value = offset_bottom_data[bottom_index * stride];
+        if (value > maxval) {
+          maxval = value;
           maxidx = bottom_index;
         }
       }
@@ -145,25 +158,29 @@ bool RoIPoolOp<float, CUDAContext>::RunOnDevice() {
   auto* Y = Output(0); // RoI pooled data
   auto* A = is_test_ ? nullptr : Output(1); // argmaxes
 
-  // Handle empty rois
-  if (R.size() == 0) {
-    Y->Resize(0, X.dim32(1), pooled_height_, pooled_width_);
-    // mutable_data calls are needed to allocate the tensors
-    Y->mutable_data<float>();
-    if (!is_test_) {
-      A->Resize(Y->dims());
-      A->mutable_data<int>();
-    }
-    return true;
+  const bool nchw = order_ == StorageOrder::NCHW;
+  const int channels = X.dim32(nchw ? 1 : 3);
+  const int height = X.dim32(nchw ? 2 : 1);
+  const int width = X.dim32(nchw ? 3 : 2);
+  if (nchw) {
+    Y->Resize(R.dim32(0), channels, pooled_height_, pooled_width_);
+  } else {
+    Y->Resize(R.dim32(0), pooled_height_, pooled_width_, channels);
   }
-
-  Y->Resize(R.dim32(0), X.dim32(1), pooled_height_, pooled_width_);
   if (!is_test_) {
     A->Resize(Y->dims());
   }
-  int output_size = Y->size();
+  // mutable_data calls are needed to allocate the tensors, even without
+  // rois.
+  float* top_data = Y->mutable_data<float>();
   int* argmax_data = is_test_ ? nullptr : A->mutable_data<int>();
-  ROIPoolForward<float><<<
+  const int output_size = Y->size();
+  if (output_size == 0) {
+    return true;
+  }
+  auto* kernel = nchw ? ROIPoolForward<float, false>
+                      : ROIPoolForward<float, true>;
+  kernel<<<
       CAFFE_GET_BLOCKS(output_size),
       CAFFE_CUDA_NUM_THREADS,
       0,
@@ -171,13 +188,13 @@ bool RoIPoolOp<float, CUDAContext>::RunOnDevice() {
       output_size,
       X.data<float>(),
       spatial_scale_,
-      X.dim32(1),
-      X.dim32(2),
-      X.dim32(3),
+      channels,
+      height,
+      width,
       pooled_height_,
       pooled_width_,
       R.data<float>(),
-      Y->mutable_data<float>(),
+      top_data,
       argmax_data);
   return true;
 }
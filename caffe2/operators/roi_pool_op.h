@@ -35,15 +35,16 @@ class RoIPoolOp final : public Operator<Context> {
         pooled_height_(OperatorBase::GetSingleArgument<int>("pooled_h", 1)),
         pooled_width_(OperatorBase::GetSingleArgument<int>("pooled_w", 1)),
         spatial_scale_(
-            OperatorBase::GetSingleArgument<float>("spatial_scale", 1.)) {
+            OperatorBase::GetSingleArgument<float>("spatial_scale", 1.)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
     CAFFE_ENFORCE(
         (is_test_ && OutputSize() == 1) || (!is_test_ && OutputSize() == 2),
         "Output size mismatch.");
     CAFFE_ENFORCE_GT(spatial_scale_, 0);
     CAFFE_ENFORCE_GT(pooled_height_, 0);
     CAFFE_ENFORCE_GT(pooled_width_, 0);
-    CAFFE_ENFORCE_EQ(
-        order_, StorageOrder::NCHW, "Only NCHW order is supported right now.");
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
   }
   USE_OPERATOR_CONTEXT_FUNCTIONS;
 
@@ -55,6 +56,8 @@ class RoIPoolOp final : public Operator<Context> {
   int pooled_height_;
   int pooled_width_;
   float spatial_scale_;
+  int num_threads_;
+  Workspace* ws_;
 };
 
 template <typename T, class Context>
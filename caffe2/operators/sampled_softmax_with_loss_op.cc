@@ -0,0 +1,413 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/sampled_softmax_with_loss_op.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "caffe2/operators/softmax_shared.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+constexpr float kLogThreshold = 1e-20;
+
+} // namespace
+
+SampledSoftmaxWithLossOp::SampledSoftmaxWithLossOp(
+    const OperatorDef& operator_def,
+    Workspace* ws)
+    : Operator<CPUContext>(operator_def, ws),
+      num_sampled_(OperatorBase::GetSingleArgument<int>("num_sampled", 0)),
+      distortion_(OperatorBase::GetSingleArgument<float>("distortion", 1.)),
+      remove_accidental_hits_(OperatorBase::GetSingleArgument<bool>(
+          "remove_accidental_hits",
+          true)),
+      scale_(OperatorBase::GetSingleArgument<float>("scale", 1.)) {
+  CAFFE_ENFORCE_GT(num_sampled_, 0, "num_sampled must be positive.");
+  const auto sampler =
+      OperatorBase::GetSingleArgument<string>("sampler", "log_uniform");
+  CAFFE_ENFORCE(
+      sampler == "log_uniform" || sampler == "unigram",
+      "Unknown sampler ",
+      sampler);
+  unigram_ = sampler == "unigram";
+  CAFFE_ENFORCE(
+      !unigram_ || InputSize() > UNIGRAM_COUNTS,
+      "The unigram sampler needs the unigram counts input.");
+}
+
+void SampledSoftmaxWithLossOp::SampleClasses(int num_classes, int* sampled) {
+  auto& generator = context_.RandGenerator();
+  if (unigram_) {
+    for (int i = 0; i < num_sampled_; ++i) {
+      sampled[i] = unigram_distribution_(generator);
+    }
+    return;
+  }
+  // floor(exp(u * log(V + 1))) - 1, for u uniform in [0, 1), is class k with
+  // probability log((k + 2) / (k + 1)) / log(V + 1).
+  std::uniform_real_distribution<double> uniform(0, 1);
+  const double log_range = std::log1p(num_classes);
+  for (int i = 0; i < num_sampled_; ++i) {
+    const int k = static_cast<int>(std::exp(uniform(generator) * log_range));
+    sampled[i] = std::min(k - 1, num_classes - 1);
+  }
+}
+
+float SampledSoftmaxWithLossOp::SamplingProbability(int k, int num_classes)
+    const {
+  if (unigram_) {
+    return unigram_probabilities_[k];
+  }
+  return (std::log1p(k + 1) - std::log1p(k)) / std::log1p(num_classes);
+}
+
+bool SampledSoftmaxWithLossOp::RunOnDevice() {
+  const auto& X = Input(INPUT);
+  const auto& W = Input(WEIGHT);
+  const auto& b = Input(BIAS);
+  const auto& labels = Input(LABELS);
+  auto* P = Output(0);
+  auto* avg_loss = Output(1);
+  auto* sampled_ids = Output(2);
+
+  CAFFE_ENFORCE_EQ(X.ndim(), 2, "X must be a matrix");
+  CAFFE_ENFORCE_EQ(W.ndim(), 2, "W must be a matrix");
+  const int N = X.dim32(0);
+  const int D = X.dim32(1);
+  const int V = W.dim32(0);
+  const int S = num_sampled_;
+  CAFFE_ENFORCE_EQ(W.dim32(1), D, "W must have as many columns as X");
+  CAFFE_ENFORCE_EQ(b.size(), V, "b must have one entry per class");
+  CAFFE_ENFORCE_EQ(labels.size(), N, "labels must have one entry per row");
+
+  if (unigram_ && unigram_probabilities_.empty()) {
+    const auto& counts = Input(UNIGRAM_COUNTS);
+    CAFFE_ENFORCE_EQ(counts.size(), V, "One unigram count per class needed");
+    vector<double> weights(V);
+    for (int k = 0; k < V; ++k) {
+      weights[k] = std::pow(counts.data<float>()[k], distortion_);
+    }
+    unigram_distribution_ =
+        std::discrete_distribution<int>(weights.begin(), weights.end());
+    unigram_probabilities_ = unigram_distribution_.probabilities();
+  }
+  CAFFE_ENFORCE(
+      !unigram_ || unigram_probabilities_.size() == static_cast<size_t>(V),
+      "The number of classes changed since the first run.");
+
+  // The true classes, then the sampled ones.
+  sampled_ids->Resize(N + S);
+  int* ids = sampled_ids->mutable_data<int>();
+  const int* label_data = labels.data<int>();
+  for (int i = 0; i < N; ++i) {
+    CAFFE_ENFORCE(
+        label_data[i] >= 0 && label_data[i] < V,
+        "Label ",
+        label_data[i],
+        " is not in [0, ",
+        V,
+        ")");
+    ids[i] = label_data[i];
+  }
+  SampleClasses(V, ids + N);
+
+  const float* Xdata = X.data<float>();
+  const float* Wdata = W.data<float>();
+  const float* bdata = b.data<float>();
+  sampled_weights_.Resize(S, D);
+  float* sampled_weights = sampled_weights_.mutable_data<float>();
+  sampled_bias_.resize(S);
+  for (int s = 0; s < S; ++s) {
+    const int k = ids[N + s];
+    std::copy(Wdata + k * D, Wdata + (k + 1) * D, sampled_weights + s * D);
+    sampled_bias_[s] = bdata[k] -
+        std::log(std::max(S * SamplingProbability(k, V), kLogThreshold));
+  }
+
+  // Row i holds the logit of the true class of example i, then the logits of
+  // the sampled classes.
+  logits_.Resize(N, S + 1);
+  float* logits = logits_.mutable_data<float>();
+  math::GemmEx<float, CPUContext>(
+      CblasNoTrans,
+      CblasTrans,
+      N,
+      S,
+      D,
+      1,
+      Xdata,
+      D,
+      sampled_weights,
+      D,
+      0,
+      logits + 1,
+      S + 1,
+      &context_);
+  for (int i = 0; i < N; ++i) {
+    const int label = ids[i];
+    float* row = logits + i * (S + 1);
+    math::Dot<float, CPUContext>(
+        D, Xdata + i * D, Wdata + label * D, row, &context_);
+    row[0] += bdata[label] -
+        std::log(std::max(S * SamplingProbability(label, V), kLogThreshold));
+    for (int s = 0; s < S; ++s) {
+      row[s + 1] += sampled_bias_[s];
+      // A sampled class that is the true one would be pushed down as well.
+      if (remove_accidental_hits_ && ids[N + s] == label) {
+        row[s + 1] = std::numeric_limits<float>::lowest();
+      }
+    }
+  }
+
+  P->Resize(N, S + 1);
+  float* Pdata = P->mutable_data<float>();
+  if (sum_multiplier_.size() != S + 1) {
+    sum_multiplier_.Resize(S + 1);
+    math::Set<float, CPUContext>(
+        S + 1, 1.f, sum_multiplier_.mutable_data<float>(), &context_);
+  }
+  scale_buffer_.Resize(N);
+  rowmax_.Resize(N);
+  SoftmaxCPU(
+      context_,
+      N,
+      S + 1,
+      logits,
+      Pdata,
+      scale_buffer_.mutable_data<float>(),
+      sum_multiplier_.data<float>(),
+      false,
+      rowmax_.mutable_data<float>());
+
+  float loss_sum = 0;
+  for (int i = 0; i < N; ++i) {
+    loss_sum -= std::log(std::max(Pdata[i * (S + 1)], kLogThreshold));
+  }
+  avg_loss->Resize(vector<TIndex>());
+  avg_loss->mutable_data<float>()[0] = N > 0 ? loss_sum * scale_ / N : 0;
+  return true;
+}
+
+bool SampledSoftmaxWithLossGradientOp::RunOnDevice() {
+  const auto& X = Input(INPUT);
+  const auto& W = Input(WEIGHT);
+  const auto& P = Input(SOFTMAX);
+  const auto& sampled_ids = Input(SAMPLED_IDS);
+  const auto& d_avg_loss = Input(LOSS_GRAD);
+  auto* dX = Output(0);
+  auto* dW = Output(1);
+  auto* db = Output(2);
+
+  const int N = X.dim32(0);
+  const int D = X.dim32(1);
+  CAFFE_ENFORCE_EQ(P.ndim(), 2);
+  CAFFE_ENFORCE_EQ(P.dim32(0), N);
+  const int S = P.dim32(1) - 1;
+  CAFFE_ENFORCE_EQ(sampled_ids.size(), N + S);
+  dX->ResizeLike(X);
+  dW->Resize(N + S, D);
+  db->Resize(N + S);
+
+  const float* Xdata = X.data<float>();
+  const float* Wdata = W.data<float>();
+  const float* Pdata = P.data<float>();
+  const int* ids = sampled_ids.data<int>();
+  float* dXdata = dX->mutable_data<float>();
+  float* dWdata = dW->mutable_data<float>();
+  float* dbdata = db->mutable_data<float>();
+  // The gradient of the logits is alpha * (P - 1) for the true classes and
+  // alpha * P for the sampled ones.
+  const float alpha = N > 0 ? scale_ * d_avg_loss.data<float>()[0] / N : 0;
+
+  sampled_weights_.Resize(S, D);
+  float* sampled_weights = sampled_weights_.mutable_data<float>();
+  for (int s = 0; s < S; ++s) {
+    const int k = ids[N + s];
+    std::copy(Wdata + k * D, Wdata + (k + 1) * D, sampled_weights + s * D);
+  }
+
+  // dX = dlogits * [W_true; W_sampled]
+  math::GemmEx<float, CPUContext>(
+      CblasNoTrans,
+      CblasNoTrans,
+      N,
+      D,
+      S,
+      alpha,
+      Pdata + 1,
+      S + 1,
+      sampled_weights,
+      D,
+      0,
+      dXdata,
+      D,
+      &context_);
+  // The rows of dW and db of the true classes
+  for (int i = 0; i < N; ++i) {
+    const float dlogit = alpha * (Pdata[i * (S + 1)] - 1);
+    math::Axpy<float, CPUContext>(
+        D, dlogit, Wdata + ids[i] * D, dXdata + i * D, &context_);
+    math::Scale<float, CPUContext>(
+        D, dlogit, Xdata + i * D, dWdata + i * D, &context_);
+    dbdata[i] = dlogit;
+  }
+  // and of the sampled classes, dW = dlogits' * X
+  math::GemmEx<float, CPUContext>(
+      CblasTrans,
+      CblasNoTrans,
+      S,
+      D,
+      N,
+      alpha,
+      Pdata + 1,
+      S + 1,
+      Xdata,
+      D,
+      0,
+      dWdata + N * D,
+      D,
+      &context_);
+  float* sampled_db = dbdata + N;
+  std::fill(sampled_db, sampled_db + S, 0.f);
+  for (int i = 0; i < N; ++i) {
+    for (int s = 0; s < S; ++s) {
+      sampled_db[s] += alpha * Pdata[i * (S + 1) + s + 1];
+    }
+  }
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(SampledSoftmaxWithLoss, SampledSoftmaxWithLossOp);
+REGISTER_CPU_OPERATOR(
+    SampledSoftmaxWithLossGradient,
+    SampledSoftmaxWithLossGradientOp);
+
+OPERATOR_SCHEMA(SampledSoftmaxWithLoss)
+    .NumInputs(4, 5)
+    .NumOutputs(3)
+    .TensorInferenceFunction(
+        [](const OperatorDef& def, const vector<TensorShape>& in) {
+          ArgumentHelper helper(def);
+          const int num_sampled =
+              helper.GetSingleArgument<int>("num_sampled", 0);
+          const int N = in[0].dims(0);
+          vector<TensorShape> out(3);
+          out[0] = CreateTensorShape(
+              vector<int>{N, num_sampled + 1}, TensorProto::FLOAT);
+          out[1] = CreateTensorShape(vector<int>{}, TensorProto::FLOAT);
+          out[2] = CreateTensorShape(
+              vector<int>{N + num_sampled}, TensorProto::INT32);
+          return out;
+        })
+    .SetDoc(R"DOC(
+Sampled softmax cross entropy loss, an approximation of FC followed by
+SoftmaxWithLoss for a large number of classes V. Instead of the logits of all
+the classes, each example only gets the logit of its true class and the logits
+of num_sampled classes drawn at every run and shared by the whole batch, so
+that only 1 + num_sampled rows of W are read per example:
+
+  logit(k) = X * W[k]' + b[k] - log(num_sampled * Q(k))
+
+where Q(k) is the probability of drawing class k, either log-uniform (Zipfian,
+for classes sorted by decreasing frequency) or proportional to given unigram
+counts. The loss is the average over the batch of the softmax cross entropy of
+the true class.
+
+The gradients of W and b are sparse: their rows are those of the classes in
+sampled_ids, the true class of each example followed by the sampled classes,
+so they can be applied with SparseAdagrad or the other sparse optimizers.
+Rows may be repeated, e.g. when several examples share their true class.
+)DOC")
+    .Arg("num_sampled", "Number of classes sampled per run, required")
+    .Arg(
+        "sampler",
+        "'log_uniform' (default) or 'unigram'; the latter needs the "
+        "unigram_counts input")
+    .Arg(
+        "distortion",
+        "The unigram counts are raised to this power before sampling, 1 by "
+        "default")
+    .Arg(
+        "remove_accidental_hits",
+        "Whether a sampled class equal to the true class of an example is "
+        "left out of the softmax of that example, true by default")
+    .Arg("scale", "Multiplier of the loss, 1 by default")
+    .Input(0, "X", "N x D input")
+    .Input(1, "W", "V x D weights, as for FC")
+    .Input(2, "b", "Bias vector of size V")
+    .Input(3, "labels", "int32 vector of the N true classes")
+    .Input(
+        4,
+        "unigram_counts",
+        "Optional vector of V counts for the unigram sampler, read at the "
+        "first run only")
+    .Output(
+        0,
+        "softmax",
+        "N x (1 + num_sampled) probabilities, of the true class first")
+    .Output(1, "loss", "Average loss")
+    .Output(
+        2,
+        "sampled_ids",
+        "int32 vector of the N true classes followed by the num_sampled "
+        "sampled ones, the indices of the sparse gradients of W and b");
+
+OPERATOR_SCHEMA(SampledSoftmaxWithLossGradient)
+    .NumInputs(5)
+    .NumOutputs(3)
+    .Input(0, "X", "X of SampledSoftmaxWithLoss")
+    .Input(1, "W", "W of SampledSoftmaxWithLoss")
+    .Input(2, "softmax", "softmax output of SampledSoftmaxWithLoss")
+    .Input(3, "sampled_ids", "sampled_ids output of SampledSoftmaxWithLoss")
+    .Input(4, "d_loss", "Gradient of the loss")
+    .Output(0, "dX", "Gradient of X")
+    .Output(
+        1,
+        "dW_values",
+        "(N + num_sampled) x D values of the sparse gradient of W, whose "
+        "indices are sampled_ids")
+    .Output(
+        2,
+        "db_values",
+        "N + num_sampled values of the sparse gradient of b, whose indices "
+        "are sampled_ids");
+
+namespace {
+
+class GetSampledSoftmaxWithLossGradient : public GradientMakerBase {
+  using GradientMakerBase::GradientMakerBase;
+  vector<OperatorDef> GetGradientDefs() override {
+    SetSparse(1, O(2), GI_V(1));
+    SetSparse(2, O(2), GI_V(2));
+    return SingleGradientDef(
+        "SampledSoftmaxWithLossGradient",
+        "",
+        vector<string>{I(0), I(1), O(0), O(2), GO(1)},
+        vector<string>{GI(0), GI_V(1), GI_V(2)});
+  }
+};
+
+} // namespace
+
+REGISTER_GRADIENT(SampledSoftmaxWithLoss, GetSampledSoftmaxWithLossGradient);
+
+} // namespace caffe2
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_SAMPLED_SOFTMAX_WITH_LOSS_OP_H_
+#define CAFFE2_OPERATORS_SAMPLED_SOFTMAX_WITH_LOSS_OP_H_
+
+#include <random>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+// Softmax cross entropy over the true class of each example and a set of
+// num_sampled negative classes shared by the whole batch, instead of over all
+// the V classes. The logits are those of an FC with V x D weights W and bias
+// b, but only the rows of the true and sampled classes are read, so the cost
+// is O(N * num_sampled * D) instead of O(N * V * D). The logit of class k is
+// corrected by -log(num_sampled * Q(k)), Q being the sampling distribution,
+// so that the loss is an unbiased estimate of the full softmax one.
+class SampledSoftmaxWithLossOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  SampledSoftmaxWithLossOp(const OperatorDef& operator_def, Workspace* ws);
+
+  bool RunOnDevice() override;
+
+ private:
+  // Samples num_sampled classes out of num_classes into sampled.
+  void SampleClasses(int num_classes, int* sampled);
+  // Probability of class k under the sampling distribution.
+  float SamplingProbability(int k, int num_classes) const;
+
+  INPUT_TAGS(INPUT, WEIGHT, BIAS, LABELS, UNIGRAM_COUNTS);
+
+  int num_sampled_;
+  bool unigram_;
+  float distortion_;
+  bool remove_accidental_hits_;
+  float scale_;
+  // Built from UNIGRAM_COUNTS at the first run.
+  std::discrete_distribution<int> unigram_distribution_;
+  vector<double> unigram_probabilities_;
+  // b[k] - log(num_sampled * Q(k)) for the sampled classes.
+  vector<float> sampled_bias_;
+  Tensor<CPUContext> sampled_weights_;
+  Tensor<CPUContext> logits_;
+  Tensor<CPUContext> scale_buffer_;
+  Tensor<CPUContext> rowmax_;
+  Tensor<CPUContext> sum_multiplier_;
+};
+
+class SampledSoftmaxWithLossGradientOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  SampledSoftmaxWithLossGradientOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        scale_(OperatorBase::GetSingleArgument<float>("scale", 1.)) {}
+
+  bool RunOnDevice() override;
+
+ private:
+  INPUT_TAGS(INPUT, WEIGHT, SOFTMAX, SAMPLED_IDS, LOSS_GRAD);
+
+  float scale_;
+  Tensor<CPUContext> sampled_weights_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_SAMPLED_SOFTMAX_WITH_LOSS_OP_H_
@@ -0,0 +1,199 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+constexpr int kRows = 16;
+constexpr int kDim = 8;
+constexpr int kClasses = 50;
+constexpr int kSampled = 10;
+
+void FillInputs(Workspace* ws) {
+  auto* X = AddTensor(ws, "X", {kRows, kDim});
+  for (int i = 0; i < X->size(); ++i) {
+    X->mutable_data<float>()[i] = ((i * 7) % 13) * 0.1f - 0.6f;
+  }
+  auto* W = AddTensor(ws, "W", {kClasses, kDim});
+  for (int i = 0; i < W->size(); ++i) {
+    W->mutable_data<float>()[i] = ((i * 5) % 11) * 0.1f - 0.5f;
+  }
+  auto* b = AddTensor(ws, "b", {kClasses});
+  for (int i = 0; i < kClasses; ++i) {
+    b->mutable_data<float>()[i] = (i % 3) * 0.2f;
+  }
+  auto* labels = AddTensor(ws, "labels", {kRows});
+  for (int i = 0; i < kRows; ++i) {
+    labels->mutable_data<int>()[i] = (i * 3) % 7;
+  }
+}
+
+double LogUniformProbability(int k) {
+  return std::log((k + 2.0) / (k + 1.0)) / std::log(kClasses + 1.0);
+}
+
+// Draws num_sampled classes in a single run and returns how often each class
+// came up.
+vector<double> SampleFrequencies(
+    Workspace* ws,
+    int num_sampled,
+    const vector<Argument>& args) {
+  vector<Argument> all_args = args;
+  all_args.push_back(MakeArgument<int>("num_sampled", num_sampled));
+  vector<string> inputs{"X", "W", "b", "labels"};
+  if (ws->HasBlob("counts")) {
+    inputs.push_back("counts");
+  }
+  EXPECT_TRUE(ws->RunOperatorOnce(CreateOperatorDef(
+      "SampledSoftmaxWithLoss",
+      "",
+      inputs,
+      {"softmax", "loss", "sampled_ids"},
+      all_args)));
+  const auto& ids = ws->GetBlob("sampled_ids")->Get<TensorCPU>();
+  vector<double> frequencies(kClasses, 0);
+  for (int s = kRows; s < ids.size(); ++s) {
+    frequencies[ids.data<int>()[s]] += 1.0 / num_sampled;
+  }
+  return frequencies;
+}
+
+} // namespace
+
+TEST(SampledSoftmaxWithLossTest, LossAndGradient) {
+  Workspace ws;
+  FillInputs(&ws);
+  const auto def = CreateOperatorDef(
+      "SampledSoftmaxWithLoss",
+      "",
+      {"X", "W", "b", "labels"},
+      {"softmax", "loss", "sampled_ids"},
+      {MakeArgument<int>("num_sampled", kSampled)});
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+  AddTensor(&ws, "loss_grad", {})->mutable_data<float>()[0] = 2;
+  vector<GradientWrapper> g_output(3);
+  g_output[1].dense_ = "loss_grad";
+  const auto meta = GetGradientForOp(def, g_output);
+  EXPECT_EQ(meta.g_input_[1].indices_, "sampled_ids");
+  EXPECT_EQ(meta.g_input_[2].indices_, "sampled_ids");
+  for (const auto& grad_def : meta.ops_) {
+    ASSERT_TRUE(ws.RunOperatorOnce(grad_def));
+  }
+
+  const float* X = ws.GetBlob("X")->Get<TensorCPU>().data<float>();
+  const float* W = ws.GetBlob("W")->Get<TensorCPU>().data<float>();
+  const float* b = ws.GetBlob("b")->Get<TensorCPU>().data<float>();
+  const auto& ids = ws.GetBlob("sampled_ids")->Get<TensorCPU>();
+  ASSERT_EQ(ids.size(), kRows + kSampled);
+  const int* id = ids.data<int>();
+  const float* P = ws.GetBlob("softmax")->Get<TensorCPU>().data<float>();
+  const float* dX =
+      ws.GetBlob(meta.g_input_[0].dense_)->Get<TensorCPU>().data<float>();
+  const float* dW =
+      ws.GetBlob(meta.g_input_[1].values_)->Get<TensorCPU>().data<float>();
+  const float* db =
+      ws.GetBlob(meta.g_input_[2].values_)->Get<TensorCPU>().data<float>();
+
+  vector<double> expected_dW((kRows + kSampled) * kDim, 0);
+  vector<double> expected_db(kRows + kSampled, 0);
+  double loss = 0;
+  for (int i = 0; i < kRows; ++i) {
+    EXPECT_EQ(id[i], (i * 3) % 7);
+    // The true class, then the sampled ones.
+    vector<double> logits(kSampled + 1);
+    double max_logit = -1e30;
+    for (int j = 0; j <= kSampled; ++j) {
+      const int k = j == 0 ? id[i] : id[kRows + j - 1];
+      double logit = b[k] - std::log(kSampled * LogUniformProbability(k));
+      for (int d = 0; d < kDim; ++d) {
+        logit += X[i * kDim + d] * W[k * kDim + d];
+      }
+      logits[j] = j > 0 && k == id[i] ? -1e30 : logit;
+      max_logit = std::max(max_logit, logits[j]);
+    }
+    double sum = 0;
+    for (auto& logit : logits) {
+      logit = std::exp(logit - max_logit);
+      sum += logit;
+    }
+    vector<double> dlogits(kSampled + 1);
+    for (int j = 0; j <= kSampled; ++j) {
+      EXPECT_NEAR(P[i * (kSampled + 1) + j], logits[j] / sum, 1e-5);
+      dlogits[j] = 2.0 / kRows * (logits[j] / sum - (j == 0));
+    }
+    loss -= std::log(logits[0] / sum) / kRows;
+
+    for (int d = 0; d < kDim; ++d) {
+      double expected_dX = 0;
+      for (int j = 0; j <= kSampled; ++j) {
+        const int row = j == 0 ? i : kRows + j - 1;
+        const int k = id[row];
+        expected_dX += dlogits[j] * W[k * kDim + d];
+        expected_dW[row * kDim + d] += dlogits[j] * X[i * kDim + d];
+      }
+      EXPECT_NEAR(dX[i * kDim + d], expected_dX, 1e-5);
+    }
+    for (int j = 0; j <= kSampled; ++j) {
+      expected_db[j == 0 ? i : kRows + j - 1] += dlogits[j];
+    }
+  }
+  EXPECT_NEAR(
+      ws.GetBlob("loss")->Get<TensorCPU>().data<float>()[0], loss, 1e-5);
+  for (int i = 0; i < expected_dW.size(); ++i) {
+    EXPECT_NEAR(dW[i], expected_dW[i], 1e-5);
+  }
+  for (int i = 0; i < expected_db.size(); ++i) {
+    EXPECT_NEAR(db[i], expected_db[i], 1e-5);
+  }
+}
+
+TEST(SampledSoftmaxWithLossTest, LogUniformSampler) {
+  Workspace ws;
+  FillInputs(&ws);
+  const auto frequencies = SampleFrequencies(&ws, 200000, {});
+  for (int k = 0; k < kClasses; ++k) {
+    EXPECT_NEAR(frequencies[k], LogUniformProbability(k), 0.005);
+  }
+}
+
+TEST(SampledSoftmaxWithLossTest, UnigramSampler) {
+  Workspace ws;
+  FillInputs(&ws);
+  auto* counts = AddTensor(&ws, "counts", {kClasses});
+  double total = 0;
+  for (int k = 0; k < kClasses; ++k) {
+    counts->mutable_data<float>()[k] = (k % 4) * (k % 4);
+    total += k % 4;
+  }
+  const auto frequencies = SampleFrequencies(
+      &ws,
+      200000,
+      {MakeArgument<string>("sampler", "unigram"),
+       MakeArgument<float>("distortion", 0.5)});
+  for (int k = 0; k < kClasses; ++k) {
+    EXPECT_NEAR(frequencies[k], (k % 4) / total, 0.005);
+  }
+}
+
+} // namespace caffe2
@@ -21,9 +21,90 @@
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/operators/reducer_functors.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
+// Below this many elements per thread, splitting the segments of an op
+// between threads does not pay off.
+constexpr TIndex kSegmentMinWorkPerThread = 32768;
+
+// Runs fn(begin, end) on contiguous ranges of segments covering
+// [0, num_segments), in the workspace thread pool when num_threads > 1.
+// Segment i covers the rows [offsets[i], offsets[i + 1]) of blocks of
+// block_size elements, and the ranges are cut so that they hold about the
+// same number of rows. fn must only write to the rows and segments of its
+// range.
+template <typename F>
+void ForEachSegmentRange(
+    const vector<TIndex>& offsets,
+    TIndex block_size,
+    int num_threads,
+    Workspace* ws,
+    F fn) {
+  const TIndex num_segments = offsets.size() - 1;
+  const TIndex num_rows = offsets.back();
+  const TIndex num_chunks = std::min<TIndex>(
+      std::min<TIndex>(num_threads, num_segments),
+      num_rows * block_size / kSegmentMinWorkPerThread);
+  if (num_chunks <= 1) {
+    fn(0, num_segments);
+    return;
+  }
+  vector<TIndex> bounds(num_chunks + 1, num_segments);
+  bounds[0] = 0;
+  for (TIndex c = 1; c < num_chunks; ++c) {
+    bounds[c] = std::lower_bound(
+                    offsets.begin(),
+                    offsets.end() - 1,
+                    num_rows * c / num_chunks) -
+        offsets.begin();
+  }
+  ws->GetThreadPool()->runChunks(
+      [&](int /* unused */, size_t c) { fn(bounds[c], bounds[c + 1]); },
+      num_chunks);
+}
+
+// Returns the offsets of the segments of sorted segment ids with no gaps, as
+// taken by ForEachSegmentRange.
+template <typename SIndex>
+vector<TIndex> SortedSegmentOffsets(const SIndex* s_ids, TIndex N) {
+  vector<TIndex> offsets{0};
+  if (N == 0) {
+    return offsets;
+  }
+  CAFFE_ENFORCE_EQ(0, s_ids[0], "Indices must be sorted and not have gaps");
+  for (TIndex i = 1; i < N; ++i) {
+    if (s_ids[i] != s_ids[i - 1]) {
+      CAFFE_ENFORCE_EQ(
+          s_ids[i - 1] + 1,
+          s_ids[i],
+          "Indices must be sorted and not have gaps");
+      offsets.push_back(i);
+    }
+  }
+  offsets.push_back(N);
+  return offsets;
+}
+
+// Returns the offsets of the segments of the given lengths, as taken by
+// ForEachSegmentRange.
+template <typename TLengths>
+vector<TIndex> LengthsOffsets(const TLengths* lengths, TIndex numSegments) {
+  vector<TIndex> offsets(numSegments + 1, 0);
+  for (TIndex i = 0; i < numSegments; ++i) {
+    offsets[i + 1] = offsets[i] + lengths[i];
+  }
+  return offsets;
+}
+
+// Parses the num_threads argument of the segment ops.
+inline int SegmentNumThreads(const OperatorBase& op) {
+  const int num_threads = op.GetSingleArgument<int>("num_threads", 1);
+  CAFFE_ENFORCE_GE(num_threads, 1, "num_threads must be positive.");
+  return num_threads;
+}
+
 template <typename TData>
 class BaseInputAccessor {
  public:
@@ -609,7 +690,10 @@ template <
 class AbstractSortedSegmentOp : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(AbstractSortedSegmentOp);
+  AbstractSortedSegmentOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(SegmentNumThreads(*this)),
+        ws_(ws) {}
 
   bool RunOnDevice() override {
     if (SparseFused) {
@@ -691,37 +775,33 @@ class AbstractSortedSegmentOp : public Operator<Context> {
     TIndex out_block_size = output->size_from_dim(1);
 
     // Assume the segments are sorted and there are no gaps
-    CAFFE_ENFORCE_EQ(0, s_ids[0], "Indices must be sorted and not have gaps");
-    for (TIndex i = 0; i < N;) {
-      TIndex start = i;
-
-      Reducer r(ctx, out + out_block_size * s_ids[start], &context_);
-      for (; i < N && s_ids[start] == s_ids[i]; ++i) {
-        IndexType idx;
-        if (SparseFused) { // static if
-          CAFFE_ENFORCE(
-              0 <= idxs[i] && idxs[i] < M,
-              "Index out of bounds: ",
-              idxs[i],
-              ", range 0 to ",
-              M);
-          idx = idxs[i];
-        } else {
-          idx = i;
-        }
-        r.template process<FixedSize>(
-            ctx, inputAccessor_.getBlockPtr(in_block_size, idx), i, &context_);
-      }
-
-      r.template finish<FixedSize>(ctx, &context_);
-      // check correctness of the next segment
-      if (i < N) {
-        CAFFE_ENFORCE_EQ(
-            s_ids[start] + 1,
-            s_ids[i],
-            "Indices must be sorted and not have gaps");
-      }
-    }
+    const auto offsets = SortedSegmentOffsets(s_ids, N);
+    ForEachSegmentRange(
+        offsets, in_block_size, num_threads_, ws_, [&](TIndex b, TIndex e) {
+          for (TIndex segment = b; segment < e; ++segment) {
+            Reducer r(ctx, out + out_block_size * segment, &context_);
+            for (TIndex i = offsets[segment]; i < offsets[segment + 1]; ++i) {
+              IndexType idx;
+              if (SparseFused) { // static if
+                CAFFE_ENFORCE(
+                    0 <= idxs[i] && idxs[i] < M,
+                    "Index out of bounds: ",
+                    idxs[i],
+                    ", range 0 to ",
+                    M);
+                idx = idxs[i];
+              } else {
+                idx = i;
+              }
+              r.template process<FixedSize>(
+                  ctx,
+                  inputAccessor_.getBlockPtr(in_block_size, idx),
+                  i,
+                  &context_);
+            }
+            r.template finish<FixedSize>(ctx, &context_);
+          }
+        });
     return true;
   }
 
@@ -734,6 +814,8 @@ class AbstractSortedSegmentOp : public Operator<Context> {
 
  private:
   InputAccessor inputAccessor_;
+  int num_threads_;
+  Workspace* ws_;
 };
 
 // Gradient actually doesn't depend on whether sparse lookup is fused or not
@@ -741,7 +823,12 @@ template <typename T, typename SIndex, class Context, class ReducerGradient>
 class AbstractSortedSegmentGradientOp : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(AbstractSortedSegmentGradientOp);
+  AbstractSortedSegmentGradientOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(SegmentNumThreads(*this)),
+        ws_(ws) {}
 
   bool RunOnDevice() override {
     // If more complicated fixed size logic becomes necessary, it can be moved
@@ -791,33 +878,22 @@ class AbstractSortedSegmentGradientOp : public Operator<Context> {
     }
 
     // Assume the segments are sorted and there are no gaps
-    CAFFE_ENFORCE_EQ(0, s_ids[0], "Indices must be sorted and not have gaps");
+    const auto offsets = SortedSegmentOffsets(s_ids, N);
     // repeat the check from forward op
     CAFFE_ENFORCE_EQ(
         K - 1, s_ids[N - 1], "Indices must be sorted and not have gaps");
-    for (TIndex i = 0; i < N;) {
-      TIndex start = i;
-      TIndex end = start;
-
-      if (ReducerGradient::computeLength()) {
-        for (; end < N && s_ids[start] == s_ids[end]; ++end) {
-        }
-      }
-
-      ReducerGradient r(ctx, s_grads + s_block_size * s_ids[start], &context_);
-      for (; i < N && s_ids[start] == s_ids[i]; ++i) {
-        r.template fillGrad<FixedSize>(
-            ctx, out + d_block_size * i, i, &context_, end - start);
-      }
-
-      // check correctness of the next segment
-      if (i < N) {
-        CAFFE_ENFORCE_EQ(
-            s_ids[start] + 1,
-            s_ids[i],
-            "Indices must be sorted and not have gaps");
-      }
-    }
+    ForEachSegmentRange(
+        offsets, d_block_size, num_threads_, ws_, [&](TIndex b, TIndex e) {
+          for (TIndex segment = b; segment < e; ++segment) {
+            const TIndex start = offsets[segment];
+            const TIndex end = offsets[segment + 1];
+            ReducerGradient r(ctx, s_grads + s_block_size * segment, &context_);
+            for (TIndex i = start; i < end; ++i) {
+              r.template fillGrad<FixedSize>(
+                  ctx, out + d_block_size * i, i, &context_, end - start);
+            }
+          }
+        });
     return true;
   }
 
@@ -831,6 +907,10 @@ class AbstractSortedSegmentGradientOp : public Operator<Context> {
     SEGMENT_GRADS = ReducerGradient::originalInputs().size(),
     SEGMENT_IDS
   };
+
+ private:
+  int num_threads_;
+  Workspace* ws_;
 };
 
 // base implementation of sorted/unsorted sparse/non-sparse gradient computation
@@ -884,6 +964,9 @@ i.e. `SEGMENT_IDS[-1]+1`. Other dimensions are inherited from the input tensor.
 {op_doc}
   )DOC";
   static void PopulateSchema(OpSchema& schema) {
+    schema.Arg(
+        "num_threads",
+        "Number of threads to split the segments across (default 1)");
     schema.Input(0, "DATA", "Input tensor, slices of which are aggregated.");
     schema.Input(
         Reducer::kInputCount,
@@ -936,6 +1019,9 @@ i.e. `SEGMENT_IDS[-1]+1`. Other dimensions are inherited from the input tensor.
 {op_doc}
   )DOC";
   static void PopulateSchema(OpSchema& schema) {
+    schema.Arg(
+        "num_threads",
+        "Number of threads to split the segments across (default 1)");
     schema.Input(0, "DATA", "Input tensor, slices of which are aggregated.");
     schema.Input(
         Reducer::kInputCount,
@@ -1407,7 +1493,10 @@ template <
 class AbstractLengthsOp : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(AbstractLengthsOp);
+  AbstractLengthsOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(SegmentNumThreads(*this)),
+        ws_(ws) {}
 
   bool RunOnDevice() override {
     if (SparseFused) {
@@ -1478,41 +1567,51 @@ class AbstractLengthsOp : public Operator<Context> {
     TIndex out_block_size = output->size_from_dim(1);
     TData* out = output->template mutable_data<TData>();
 
-    TIndex dataIndex = 0;
-    for (TIndex rangeIndex = 0; rangeIndex < outputSize; ++rangeIndex) {
-      Reducer reducer(ctx, out + out_block_size * rangeIndex, &context_);
-      for (TIndex start = dataIndex; dataIndex < start + lengths[rangeIndex];
-           ++dataIndex) {
-        IndexType idx;
-        if (SparseFused) { // static if
-          idx = indices[dataIndex];
-          CAFFE_ENFORCE(
-              0 <= idx && idx < dataSize,
-              "Index ",
-              dataIndex,
-              " is out of bounds: ",
-              idx,
-              ", range 0 to ",
-              dataSize);
-        } else {
-          idx = dataIndex;
-          CAFFE_ENFORCE(
-              idx < dataSize,
-              "Range ",
-              rangeIndex,
-              " of length ",
-              lengths[rangeIndex],
-              " is out of bound ",
-              dataSize);
-        }
-
-        const TData* input = inputAccessor_.getBlockPtr(in_block_size, idx);
-        reducer.template process<FixedSize>(ctx, input, dataIndex, &context_);
-      }
-      reducer.template finish<FixedSize>(ctx, &context_);
-    }
+    const auto offsets = LengthsOffsets(lengths, outputSize);
     CAFFE_ENFORCE(
-        dataIndex == dataToReduceSize, dataIndex, " != ", dataToReduceSize);
+        offsets.back() == dataToReduceSize,
+        offsets.back(),
+        " != ",
+        dataToReduceSize);
+
+    ForEachSegmentRange(
+        offsets, in_block_size, num_threads_, ws_, [&](TIndex b, TIndex e) {
+          for (TIndex rangeIndex = b; rangeIndex < e; ++rangeIndex) {
+            Reducer reducer(ctx, out + out_block_size * rangeIndex, &context_);
+            for (TIndex dataIndex = offsets[rangeIndex];
+                 dataIndex < offsets[rangeIndex + 1];
+                 ++dataIndex) {
+              IndexType idx;
+              if (SparseFused) { // static if
+                idx = indices[dataIndex];
+                CAFFE_ENFORCE(
+                    0 <= idx && idx < dataSize,
+                    "Index ",
+                    dataIndex,
+                    " is out of bounds: ",
+                    idx,
+                    ", range 0 to ",
+                    dataSize);
+              } else {
+                idx = dataIndex;
+                CAFFE_ENFORCE(
+                    idx < dataSize,
+                    "Range ",
+                    rangeIndex,
+                    " of length ",
+                    lengths[rangeIndex],
+                    " is out of bound ",
+                    dataSize);
+              }
+
+              const TData* input =
+                  inputAccessor_.getBlockPtr(in_block_size, idx);
+              reducer.template process<FixedSize>(
+                  ctx, input, dataIndex, &context_);
+            }
+            reducer.template finish<FixedSize>(ctx, &context_);
+          }
+        });
 
     return true;
   }
@@ -1526,6 +1625,8 @@ class AbstractLengthsOp : public Operator<Context> {
 
  private:
   InputAccessor inputAccessor_;
+  int num_threads_;
+  Workspace* ws_;
 };
 
 /*
@@ -1545,7 +1646,10 @@ template <
 class AbstractLengthsGradientOp : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(AbstractLengthsGradientOp);
+  AbstractLengthsGradientOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(SegmentNumThreads(*this)),
+        ws_(ws) {}
 
   bool RunOnDevice() override {
     // If more complicated fixed size logic becomes necessary, it can be moved
@@ -1567,9 +1671,8 @@ class AbstractLengthsGradientOp : public Operator<Context> {
     CAFFE_ENFORCE(segmentGradsInput.ndim() > 0);
     CAFFE_ENFORCE(numSegments == segmentGradsInput.dim(0));
     const TLengths* lengths = lengthsInput.template data<TLengths>();
-    for (TIndex i = 0; i < numSegments; ++i) {
-      reducedDataSize += lengths[i];
-    }
+    const auto offsets = LengthsOffsets(lengths, numSegments);
+    reducedDataSize = offsets.back();
 
     typename ReducerGradient::Meta ctx(segmentGradsInput, 1);
     for (int i = 0; i < ReducerGradient::originalInputs().size(); ++i) {
@@ -1595,22 +1698,27 @@ class AbstractLengthsGradientOp : public Operator<Context> {
     TIndex segmentBlockSize = segmentGradsInput.size_from_dim(1);
     T* dataGrads = dataGradsOutput->template mutable_data<T>();
 
-    TIndex dataIndex = 0;
-    for (TIndex rangeIndex = 0; rangeIndex < numSegments; ++rangeIndex) {
-      ReducerGradient reducer(
-          ctx, segmentGrads + segmentBlockSize * rangeIndex, &context_);
-      for (TIndex start = dataIndex; dataIndex < start + lengths[rangeIndex];
-           ++dataIndex) {
-        reducer.template fillGrad<FixedSize>(
-            ctx,
-            dataGrads + dataGradsBlockSize * dataIndex,
-            dataIndex,
-            &context_,
-            lengths[rangeIndex]);
-      }
-    }
-    CAFFE_ENFORCE(
-        dataIndex == reducedDataSize, dataIndex, " != ", reducedDataSize);
+    ForEachSegmentRange(
+        offsets,
+        dataGradsBlockSize,
+        num_threads_,
+        ws_,
+        [&](TIndex b, TIndex e) {
+          for (TIndex rangeIndex = b; rangeIndex < e; ++rangeIndex) {
+            ReducerGradient reducer(
+                ctx, segmentGrads + segmentBlockSize * rangeIndex, &context_);
+            for (TIndex dataIndex = offsets[rangeIndex];
+                 dataIndex < offsets[rangeIndex + 1];
+                 ++dataIndex) {
+              reducer.template fillGrad<FixedSize>(
+                  ctx,
+                  dataGrads + dataGradsBlockSize * dataIndex,
+                  dataIndex,
+                  &context_,
+                  lengths[rangeIndex]);
+            }
+          }
+        });
     return true;
   }
 
@@ -1625,6 +1733,10 @@ class AbstractLengthsGradientOp : public Operator<Context> {
     LENGTHS,
     INDICES
   };
+
+ private:
+  int num_threads_;
+  Workspace* ws_;
 };
 
 // Version of gradient that requires the main input and thus needs to receive
@@ -1639,7 +1751,12 @@ template <
 class AbstractLengthsWithMainInputGradientOp : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(AbstractLengthsWithMainInputGradientOp);
+  AbstractLengthsWithMainInputGradientOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(SegmentNumThreads(*this)),
+        ws_(ws) {}
 
   bool RunOnDevice() override {
     if (SparseFused) {
@@ -1705,28 +1822,41 @@ class AbstractLengthsWithMainInputGradientOp : public Operator<Context> {
 
     const T* data = dataInput.template data<T>();
 
-    TIndex dataIndex = 0;
-    for (TIndex rangeIndex = 0; rangeIndex < numSegments; ++rangeIndex) {
-      ReducerGradient reducer(
-          ctx, segmentGrads + segmentBlockSize * rangeIndex, &context_);
-      for (TIndex start = dataIndex; dataIndex < start + lengths[rangeIndex];
-           ++dataIndex) {
-        IndexType data_pos;
-        // No range checking, should've been verified in forward pass
-        if (SparseFused) { // static if
-          data_pos = indices[dataIndex];
-        } else {
-          data_pos = dataIndex;
-        }
-        reducer.template fillGradWithMainInput<FixedSize>(
-            ctx,
-            data + dataGradsBlockSize * data_pos,
-            dataGrads + dataGradsBlockSize * dataIndex,
-            dataIndex,
-            &context_,
-            lengths[rangeIndex]);
-      }
-    }
+    const auto offsets = LengthsOffsets(lengths, numSegments);
+    CAFFE_ENFORCE(
+        offsets.back() == dataToReduceSize,
+        offsets.back(),
+        " != ",
+        dataToReduceSize);
+    ForEachSegmentRange(
+        offsets,
+        dataGradsBlockSize,
+        num_threads_,
+        ws_,
+        [&](TIndex b, TIndex e) {
+          for (TIndex rangeIndex = b; rangeIndex < e; ++rangeIndex) {
+            ReducerGradient reducer(
+                ctx, segmentGrads + segmentBlockSize * rangeIndex, &context_);
+            for (TIndex dataIndex = offsets[rangeIndex];
+                 dataIndex < offsets[rangeIndex + 1];
+                 ++dataIndex) {
+              IndexType data_pos;
+              // No range checking, should've been verified in forward pass
+              if (SparseFused) { // static if
+                data_pos = indices[dataIndex];
+              } else {
+                data_pos = dataIndex;
+              }
+              reducer.template fillGradWithMainInput<FixedSize>(
+                  ctx,
+                  data + dataGradsBlockSize * data_pos,
+                  dataGrads + dataGradsBlockSize * dataIndex,
+                  dataIndex,
+                  &context_,
+                  lengths[rangeIndex]);
+            }
+          }
+        });
     return true;
   }
 
@@ -1743,6 +1873,10 @@ class AbstractLengthsWithMainInputGradientOp : public Operator<Context> {
     DATA_INPUT,
     INDICES,
   };
+
+ private:
+  int num_threads_;
+  Workspace* ws_;
 };
 
 // Version of gradient that requires the main input as well as the output of the
@@ -1752,7 +1886,12 @@ class AbstractLengthsWithMainInputAndForwardOutputGradientOp
     : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(AbstractLengthsWithMainInputAndForwardOutputGradientOp);
+  AbstractLengthsWithMainInputAndForwardOutputGradientOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(SegmentNumThreads(*this)),
+        ws_(ws) {}
 
   bool RunOnDevice() override {
     // If more complicated fixed size logic becomes necessary, it can be moved
@@ -1803,23 +1942,36 @@ class AbstractLengthsWithMainInputAndForwardOutputGradientOp
 
     const T* data = dataInput.template data<T>();
 
-    TIndex dataIndex = 0;
-    for (TIndex rangeIndex = 0; rangeIndex < numSegments; ++rangeIndex) {
-      ReducerGradient reducer(
-          ctx, segmentGrads + segmentBlockSize * rangeIndex, &context_);
-      for (TIndex start = dataIndex; dataIndex < start + lengths[rangeIndex];
-           ++dataIndex) {
-        // No range checking, should've been verified in forward pass
-        reducer.template fillGradWithMainInputAndForwardOutput<FixedSize>(
-            ctx,
-            data + dataGradsBlockSize * dataIndex,
-            dataGrads + dataGradsBlockSize * dataIndex,
-            forwardOutput + segmentBlockSize * rangeIndex,
-            dataIndex,
-            &context_,
-            lengths[rangeIndex]);
-      }
-    }
+    const auto offsets = LengthsOffsets(lengths, numSegments);
+    CAFFE_ENFORCE(
+        offsets.back() == dataToReduceSize,
+        offsets.back(),
+        " != ",
+        dataToReduceSize);
+    ForEachSegmentRange(
+        offsets,
+        dataGradsBlockSize,
+        num_threads_,
+        ws_,
+        [&](TIndex b, TIndex e) {
+          for (TIndex rangeIndex = b; rangeIndex < e; ++rangeIndex) {
+            ReducerGradient reducer(
+                ctx, segmentGrads + segmentBlockSize * rangeIndex, &context_);
+            for (TIndex dataIndex = offsets[rangeIndex];
+                 dataIndex < offsets[rangeIndex + 1];
+                 ++dataIndex) {
+              // No range checking, should've been verified in forward pass
+              reducer.template fillGradWithMainInputAndForwardOutput<FixedSize>(
+                  ctx,
+                  data + dataGradsBlockSize * dataIndex,
+                  dataGrads + dataGradsBlockSize * dataIndex,
+                  forwardOutput + segmentBlockSize * rangeIndex,
+                  dataIndex,
+                  &context_,
+                  lengths[rangeIndex]);
+            }
+          }
+        });
     return true;
   }
 
@@ -1836,6 +1988,10 @@ class AbstractLengthsWithMainInputAndForwardOutputGradientOp
     LENGTHS,
     DATA_INPUT,
   };
+
+ private:
+  int num_threads_;
+  Workspace* ws_;
 };
 
 // base implementation of sparse/non-sparse gradient computation
@@ -1926,6 +2082,9 @@ i.e. `len(LENGTHS)`. Other dimensions are inherited from the input tensor.
 {op_doc}
   )DOC";
   static void PopulateSchema(OpSchema& schema) {
+    schema.Arg(
+        "num_threads",
+        "Number of threads to split the segments across (default 1)");
     schema.Input(0, "DATA", "Input tensor, slices of which are aggregated.");
     schema.Input(
         Reducer::kInputCount,
@@ -2005,6 +2164,9 @@ i.e. `len(LENGTHS)`. Other dimensions are inherited from the input tensor.
 {op_doc}
   )DOC";
   static void PopulateSchema(OpSchema& schema) {
+    schema.Arg(
+        "num_threads",
+        "Number of threads to split the segments across (default 1)");
     schema.Input(0, "DATA", "Input tensor, slices of which are aggregated.");
     schema.Input(
         Reducer::kInputCount,
@@ -2020,6 +2182,28 @@ i.e. `len(LENGTHS)`. Other dimensions are inherited from the input tensor.
         "OUTPUT",
         "Aggregated output tensor. Has the first dimension of K "
         "(the number of segments).");
+    schema.Arg(
+        "num_threads",
+        "(int, default 1) CPU only. If greater than 1, the segments are split "
+        "into up to num_threads chunks with about the same number of INDICES "
+        "each, which are reduced in parallel on the workspace thread pool.");
+    schema.CostInferenceFunction(
+        [](const OperatorDef& /* unused */, const vector<TensorShape>& in) {
+          struct OpSchema::Cost c;
+          const auto& data = in[0];
+          const auto& indices = in[Reducer::kInputCount];
+          const auto& lengths = in[Reducer::kInputCount + 1];
+          // Only the gathered slices of DATA are read, and weighting a slice
+          // costs one more operation per value.
+          const uint64_t gathered =
+              nElemFromDim(indices) * nElemFromDim(data, 1);
+          c.flops = gathered * Reducer::kInputCount;
+          c.bytes_read = gathered * ItemSize(data) + nBytes(indices) +
+              nBytes(lengths) + (Reducer::kInputCount > 1 ? nBytes(in[1]) : 0);
+          c.bytes_written =
+              nElemFromDim(lengths) * nElemFromDim(data, 1) * ItemSize(data);
+          return c;
+        });
     ReducerDef::PopulateSchema(schema);
   }
   using Reducer = typename ReducerDef::template Reducer<T, Context>;
@@ -14,10 +14,12 @@
  * limitations under the License.
  */
 
+#include <cub/device/device_radix_sort.cuh>
 #include <cub/device/device_reduce.cuh>
 #include <cub/device/device_scan.cuh>
 #include "caffe2/core/context_gpu.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/utils/conversions.h"
 #include "caffe2/utils/math.h"
 
 #include <cub/block/block_reduce.cuh>
@@ -440,8 +442,9 @@ __global__ void length_weighted_sum_with_main_input_gradient_kernel(
 }
 
 template <typename T, typename IndexType, bool ExactBlock = false>
-__global__ void sparse_length_sum_kernel(
+__global__ void sparse_length_weighted_sum_kernel(
     const T* __restrict__ in,
+    const T* __restrict__ in_weights,
     T* __restrict__ out,
     const int* __restrict__ prefix_sum_length_data,
     const IndexType* __restrict__ indices,
@@ -464,7 +467,7 @@ __global__ void sparse_length_sum_kernel(
 
     in += threadIdx.x;
     for (int line = start + threadIdx.y; line < end; line += blockDim.y) {
-      sum += in[indices[line] * post];
+      sum += in_weights[line] * in[indices[line] * post];
     }
 
     reduceVals[threadIdx.y * blockDim.x + threadIdx.x] = sum;
@@ -482,64 +485,244 @@ __global__ void sparse_length_sum_kernel(
     for (int i = threadIdx.x; i < post; i += blockDim.x) {
       T sum = (T)0;
       for (int line = start; line < end; ++line) {
-        sum += in[indices[line] * post + i];
+        sum += in_weights[line] * in[indices[line] * post + i];
       }
       out[group * post + i] = sum;
     }
   }
 }
 
-template <typename T, typename IndexType, bool ExactBlock = false>
-__global__ void sparse_length_weighted_sum_kernel(
-    const T* __restrict__ in,
-    const T* __restrict__ in_weights,
-    T* __restrict__ out,
+#if CUDA_VERSION >= 9000
+#define SLS_SHFL_DOWN(value, delta) __shfl_down_sync(0xffffffff, value, delta)
+#else
+#define SLS_SHFL_DOWN(value, delta) __shfl_down(value, delta)
+#endif
+
+constexpr int kSLSWarpSize = 32;
+// Segments up to this long on average get a warp each, longer ones a block.
+constexpr int kSLSWarpPerSegmentMaxAvgLength = 32;
+constexpr int kSLSWarpsPerBlock = 4;
+constexpr int kSLSWarpsPerSegmentBlock = 8;
+
+// Widest load of a row: float4 for float tables and half2 for fp16 ones.
+template <typename InType>
+struct SLSRowVec;
+template <>
+struct SLSRowVec<float> {
+  static constexpr int kSize = 4;
+};
+template <>
+struct SLSRowVec<float16> {
+  static constexpr int kSize = 2;
+};
+
+// Adds the VecSize values of a row at p, aligned to VecSize values, to acc.
+template <typename InType, int VecSize>
+struct SLSRowLoad;
+template <>
+struct SLSRowLoad<float, 4> {
+  static __device__ void add(const float* p, float* acc) {
+    const float4 v = *reinterpret_cast<const float4*>(p);
+    acc[0] += v.x;
+    acc[1] += v.y;
+    acc[2] += v.z;
+    acc[3] += v.w;
+  }
+};
+template <>
+struct SLSRowLoad<float, 1> {
+  static __device__ void add(const float* p, float* acc) {
+    acc[0] += *p;
+  }
+};
+template <>
+struct SLSRowLoad<float16, 2> {
+  static __device__ void add(const float16* p, float* acc) {
+    const float2 v = __half22float2(*reinterpret_cast<const half2*>(p));
+    acc[0] += v.x;
+    acc[1] += v.y;
+  }
+};
+template <>
+struct SLSRowLoad<float16, 1> {
+  static __device__ void add(const float16* p, float* acc) {
+    acc[0] += convert::To<float16, float>(*p);
+  }
+};
+
+// Sums the rows in[indices[line]] of every group of lines, the lines of group
+// g being prefix_sum_length_data[g - 1] to prefix_sum_length_data[g], into
+// fp32. Every warp splits into rows of lanes that read a whole table row
+// with vector loads each, so that a warp reads several rows of a narrow
+// table at once and the rows are reduced with warp shuffles.
+//
+// With a warp per group, every warp of the block sums its own group, which
+// keeps all the threads busy on short groups. With a block per group, the
+// warps split the lines of the group and are reduced through shared memory,
+// for long groups.
+template <
+    typename InType,
+    typename IndexType,
+    int VecSize,
+    bool BlockPerGroup>
+__global__ void sparse_length_sum_vec_kernel(
+    const InType* __restrict__ in,
+    float* __restrict__ out,
     const int* __restrict__ prefix_sum_length_data,
     const IndexType* __restrict__ indices,
-    int N,
     int post,
     int len_length,
     int len_indices) {
-  // len_length blocks
-  int group = blockIdx.x;
-
-  int start = group == 0 ? 0 : prefix_sum_length_data[group - 1];
-  int end = prefix_sum_length_data[group];
+  const int group =
+      BlockPerGroup ? blockIdx.x : blockIdx.x * blockDim.y + threadIdx.y;
+  if (group >= len_length) {
+    return;
+  }
+  const int start = group == 0 ? 0 : prefix_sum_length_data[group - 1];
+  const int end = prefix_sum_length_data[group];
   CUDA_KERNEL_ASSERT(start <= len_indices);
   CUDA_KERNEL_ASSERT(end <= len_indices);
 
-  extern __shared__ T reduceVals[];
-
-  if (ExactBlock) {
-    T sum = (T)0;
-
-    in += threadIdx.x;
-    for (int line = start + threadIdx.y; line < end; line += blockDim.y) {
-      sum += in_weights[line] * in[indices[line] * post];
+  const int vecs = post / VecSize;
+  const int cols = min(vecs, kSLSWarpSize);
+  // Table rows read at once by a warp, a power of two for the reduction.
+  int rows = 1;
+  while (rows * 2 * cols <= kSLSWarpSize) {
+    rows *= 2;
+  }
+  const int row = threadIdx.x / cols;
+  const int col = threadIdx.x % cols;
+  const int first = start + row + (BlockPerGroup ? threadIdx.y * rows : 0);
+  const int stride = BlockPerGroup ? rows * blockDim.y : rows;
+
+  __shared__ float partial[BlockPerGroup ? kSLSWarpsPerSegmentBlock : 1]
+                          [kSLSWarpSize * VecSize];
+
+  // The loop bounds are the same for all the threads, for the shuffles and
+  // the barriers.
+  for (int v0 = 0; v0 < vecs; v0 += cols) {
+    const int v = v0 + col;
+    float acc[VecSize];
+    for (int k = 0; k < VecSize; ++k) {
+      acc[k] = 0;
     }
-
-    reduceVals[threadIdx.y * blockDim.x + threadIdx.x] = sum;
-    __syncthreads();
-
-    if (threadIdx.y == 0) {
-      sum = (T)0;
-      for (int i = 0; i < blockDim.y; ++i) {
-        sum += reduceVals[i * blockDim.x + threadIdx.x];
+    if (row < rows && v < vecs) {
+      for (int line = first; line < end; line += stride) {
+        SLSRowLoad<InType, VecSize>::add(
+            in + static_cast<int64_t>(indices[line]) * post + v * VecSize,
+            acc);
+      }
+    }
+    for (int offset = rows / 2; offset > 0; offset /= 2) {
+      for (int k = 0; k < VecSize; ++k) {
+        acc[k] += SLS_SHFL_DOWN(acc[k], offset * cols);
       }
+    }
 
-      out[group * post + threadIdx.x] = sum;
+    if (BlockPerGroup) {
+      if (row == 0) {
+        for (int k = 0; k < VecSize; ++k) {
+          partial[threadIdx.y][col * VecSize + k] = acc[k];
+        }
+      }
+      __syncthreads();
+      if (threadIdx.y == 0 && row == 0) {
+        for (int w = 1; w < blockDim.y; ++w) {
+          for (int k = 0; k < VecSize; ++k) {
+            acc[k] += partial[w][col * VecSize + k];
+          }
+        }
+      }
+      __syncthreads();
     }
-  } else {
-    for (int i = threadIdx.x; i < post; i += blockDim.x) {
-      T sum = (T)0;
-      for (int line = start; line < end; ++line) {
-        sum += in_weights[line] * in[indices[line] * post + i];
+
+    if ((!BlockPerGroup || threadIdx.y == 0) && row == 0 && v < vecs) {
+      for (int k = 0; k < VecSize; ++k) {
+        out[static_cast<int64_t>(group) * post + v * VecSize + k] = acc[k];
       }
-      out[group * post + i] = sum;
     }
   }
 }
 
+template <typename InType, typename IndexType, int VecSize>
+void sparse_length_sum_vec(
+    const InType* in,
+    float* out,
+    const int* prefix_sum_length_data,
+    const IndexType* indices,
+    int post,
+    int len_length,
+    int len_indices,
+    CUDAContext* context) {
+  if (len_indices <= kSLSWarpPerSegmentMaxAvgLength * len_length) {
+    const dim3 block(kSLSWarpSize, kSLSWarpsPerBlock);
+    sparse_length_sum_vec_kernel<InType, IndexType, VecSize, false>
+        <<<(len_length + kSLSWarpsPerBlock - 1) / kSLSWarpsPerBlock,
+           block,
+           0,
+           context->cuda_stream()>>>(
+            in,
+            out,
+            prefix_sum_length_data,
+            indices,
+            post,
+            len_length,
+            len_indices);
+  } else {
+    const dim3 block(kSLSWarpSize, kSLSWarpsPerSegmentBlock);
+    sparse_length_sum_vec_kernel<InType, IndexType, VecSize, true>
+        <<<len_length, block, 0, context->cuda_stream()>>>(
+            in,
+            out,
+            prefix_sum_length_data,
+            indices,
+            post,
+            len_length,
+            len_indices);
+  }
+}
+
+// Sums the rows of the segments of a SparseLengthsSum into out, picking a
+// warp or a block per segment from the average segment length, and the
+// widest loads that the row size and the alignment of the table allow.
+template <typename InType, typename IndexType>
+void sparse_length_sum(
+    const InType* in,
+    float* out,
+    const int* prefix_sum_length_data,
+    const IndexType* indices,
+    int post,
+    int len_length,
+    int len_indices,
+    CUDAContext* context) {
+  if (len_length == 0) {
+    return;
+  }
+  constexpr int kVec = SLSRowVec<InType>::kSize;
+  if (post % kVec == 0 &&
+      reinterpret_cast<uintptr_t>(in) % (kVec * sizeof(InType)) == 0) {
+    sparse_length_sum_vec<InType, IndexType, kVec>(
+        in,
+        out,
+        prefix_sum_length_data,
+        indices,
+        post,
+        len_length,
+        len_indices,
+        context);
+  } else {
+    sparse_length_sum_vec<InType, IndexType, 1>(
+        in,
+        out,
+        prefix_sum_length_data,
+        indices,
+        post,
+        len_length,
+        len_indices,
+        context);
+  }
+}
+
 } // namespace
 
 template <typename T, class Context = CUDAContext, bool SparseFused = true>
@@ -597,53 +780,50 @@ class CUDASparseLengthsSumOp : public Operator<CUDAContext> {
         &inclusive_scan_length_buffer_,
         &context_);
 
-    const T* in_data = dataInput.template data<T>();
-    T* out_data = output->template mutable_data<T>();
     auto* prefix_sum_length_data =
         inclusive_scan_length_buffer_.template data<int>();
     int N = dataSize;
     int post = dataInput.size_from_dim(1);
 
-    auto maxThreads =
-        GetDeviceProperty(CaffeCudaGetDevice()).maxThreadsPerBlock;
     if (SparseFused) {
-      if (post <= maxThreads) {
-        int multiple = std::min(maxThreads / post, 16);
-        dim3 block(post, multiple);
-        size_t smem = sizeof(T) * post * multiple;
-
-        sparse_length_sum_kernel<T, IndexType, true>
-            <<<len_length, block, smem, context_.cuda_stream()>>>(
-                in_data,
-                out_data,
-                prefix_sum_length_data,
-                indices,
-                N,
-                post,
-                len_length,
-                dataToReduceSize);
+      // fp16 tables are summed in fp32, into a float output.
+      float* out_data = output->template mutable_data<float>();
+      if (dataInput.template IsType<float16>()) {
+        sparse_length_sum(
+            dataInput.template data<float16>(),
+            out_data,
+            prefix_sum_length_data,
+            indices,
+            post,
+            len_length,
+            dataToReduceSize,
+            &context_);
       } else {
-        sparse_length_sum_kernel<T, IndexType, false>
-            <<<len_length, maxThreads, 0, context_.cuda_stream()>>>(
-                in_data,
-                out_data,
-                prefix_sum_length_data,
-                indices,
-                N,
-                post,
-                len_length,
-                dataToReduceSize);
+        sparse_length_sum(
+            dataInput.template data<float>(),
+            out_data,
+            prefix_sum_length_data,
+            indices,
+            post,
+            len_length,
+            dataToReduceSize,
+            &context_);
       }
+      return true;
+    }
+
+    const T* in_data = dataInput.template data<T>();
+    T* out_data = output->template mutable_data<T>();
+    auto maxThreads =
+        GetDeviceProperty(CaffeCudaGetDevice()).maxThreadsPerBlock;
+    if (post <= maxThreads) {
+      length_sum_kernel<T, true>
+          <<<len_length, post, 0, context_.cuda_stream()>>>(
+              in_data, out_data, prefix_sum_length_data, N, post, len_length);
     } else {
-      if (post <= maxThreads) {
-        length_sum_kernel<T, true>
-            <<<len_length, post, 0, context_.cuda_stream()>>>(
-                in_data, out_data, prefix_sum_length_data, N, post, len_length);
-      } else {
-        length_sum_kernel<T, true>
-            <<<len_length, maxThreads, 0, context_.cuda_stream()>>>(
-                in_data, out_data, prefix_sum_length_data, N, post, len_length);
-      }
+      length_sum_kernel<T, true>
+          <<<len_length, maxThreads, 0, context_.cuda_stream()>>>(
+              in_data, out_data, prefix_sum_length_data, N, post, len_length);
     }
     return true;
   }
@@ -1228,4 +1408,247 @@ REGISTER_CUDA_OPERATOR(
 REGISTER_CUDA_OPERATOR(
     LengthsIndicesInGradientSumGradient,
     CUDASparseLengthsSumGradientWithIndicesOp<float, CUDAContext>);
+
+namespace {
+
+// Segment of every position of INDICES: the first segment whose inclusive
+// prefix sum of the lengths is past the position.
+__global__ void lengths_to_segment_ids_kernel(
+    int n,
+    int len_length,
+    const int* __restrict__ prefix_sum_length_data,
+    int* __restrict__ segment_ids) {
+  CUDA_1D_KERNEL_LOOP(i, n) {
+    int lo = 0;
+    int hi = len_length - 1;
+    while (lo < hi) {
+      const int mid = (lo + hi) / 2;
+      if (prefix_sum_length_data[mid] > i) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+    segment_ids[i] = lo;
+  }
+}
+
+__global__ void iota_kernel(int n, int* __restrict__ out) {
+  CUDA_1D_KERNEL_LOOP(i, n) {
+    out[i] = i;
+  }
+}
+
+template <typename IndexType>
+__global__ void run_heads_kernel(
+    int n,
+    const IndexType* __restrict__ sorted,
+    int* __restrict__ heads) {
+  CUDA_1D_KERNEL_LOOP(i, n) {
+    heads[i] = i == 0 || sorted[i] != sorted[i - 1];
+  }
+}
+
+// run_ids is the inclusive sum of the run heads. Writes the index and the
+// end of every run, and the row of GRAD to sum at every sorted position.
+template <typename IndexType>
+__global__ void run_ends_kernel(
+    int n,
+    const IndexType* __restrict__ sorted,
+    const int* __restrict__ heads,
+    const int* __restrict__ run_ids,
+    const int* __restrict__ segment_ids,
+    const int* __restrict__ perm,
+    IndexType* __restrict__ unique,
+    int* __restrict__ run_ends,
+    int* __restrict__ grad_rows) {
+  CUDA_1D_KERNEL_LOOP(i, n) {
+    const int run = run_ids[i] - 1;
+    if (heads[i]) {
+      unique[run] = sorted[i];
+    }
+    if (i == n - 1 || heads[i + 1]) {
+      run_ends[run] = i + 1;
+    }
+    grad_rows[i] = segment_ids[perm[i]];
+  }
+}
+
+} // namespace
+
+// Sorts INDICES along with their positions, so that the positions of every
+// distinct index form a run, and sums the GRAD rows of every run with the
+// same kernel as SparseLengthsSum, the runs taking the place of segments.
+class CUDASparseLengthsSumSortedGradientOp final
+    : public Operator<CUDAContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CUDAContext);
+  CUDASparseLengthsSumSortedGradientOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<CUDAContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    const auto& grad = Input(GRAD);
+    const auto& lengths = Input(LENGTHS);
+    const auto& indices = Input(INDICES);
+    CAFFE_ENFORCE_EQ(lengths.ndim(), 1, "LENGTHS must be a vector");
+    CAFFE_ENFORCE_EQ(indices.ndim(), 1, "INDICES must be a vector");
+    CAFFE_ENFORCE_GE(grad.ndim(), 1);
+    CAFFE_ENFORCE_EQ(
+        grad.dim(0), lengths.dim(0), "GRAD must have one row per segment");
+    auto* unique = Output(UNIQUE_INDICES);
+    auto* rows = Output(GRAD_ROWS);
+    auto shape = grad.dims();
+    const int n = indices.size();
+    const int len_length = lengths.dim(0);
+    const int post = grad.size_from_dim(1);
+    if (n == 0) {
+      unique->Resize(0);
+      unique->template mutable_data<IndexType>();
+      shape[0] = 0;
+      rows->Resize(shape);
+      rows->template mutable_data<float>();
+      return true;
+    }
+    CAFFE_ENFORCE_GT(len_length, 0, "The lengths do not match INDICES");
+
+    inclusive_scan_length_buffer_.ResizeLike(lengths);
+    inclusive_scan_wrapper(
+        lengths.template data<int>(),
+        len_length,
+        &inclusive_scan_buffer_,
+        &inclusive_scan_length_buffer_,
+        &context_);
+    const int* prefix_sum_length_data =
+        inclusive_scan_length_buffer_.template data<int>();
+    segment_ids_.Resize(n);
+    lengths_to_segment_ids_kernel<<<
+        CAFFE_GET_BLOCKS(n),
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context_.cuda_stream()>>>(
+        n,
+        len_length,
+        prefix_sum_length_data,
+        segment_ids_.template mutable_data<int>());
+
+    positions_.Resize(n);
+    iota_kernel<<<
+        CAFFE_GET_BLOCKS(n),
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context_.cuda_stream()>>>(n, positions_.template mutable_data<int>());
+    sorted_.Resize(n);
+    perm_.Resize(n);
+    size_t sort_bytes = 0;
+    cub::DeviceRadixSort::SortPairs(
+        nullptr,
+        sort_bytes,
+        indices.template data<IndexType>(),
+        sorted_.template mutable_data<IndexType>(),
+        positions_.template data<int>(),
+        perm_.template mutable_data<int>(),
+        n,
+        0,
+        sizeof(IndexType) * 8,
+        context_.cuda_stream());
+    sort_buffer_.Resize(sort_bytes);
+    cub::DeviceRadixSort::SortPairs(
+        static_cast<void*>(sort_buffer_.template mutable_data<char>()),
+        sort_bytes,
+        indices.template data<IndexType>(),
+        sorted_.template mutable_data<IndexType>(),
+        positions_.template data<int>(),
+        perm_.template mutable_data<int>(),
+        n,
+        0,
+        sizeof(IndexType) * 8,
+        context_.cuda_stream());
+
+    heads_.Resize(n);
+    run_heads_kernel<IndexType><<<
+        CAFFE_GET_BLOCKS(n),
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context_.cuda_stream()>>>(
+        n,
+        sorted_.template data<IndexType>(),
+        heads_.template mutable_data<int>());
+    run_ids_.Resize(n);
+    inclusive_scan_wrapper(
+        heads_.template data<int>(),
+        n,
+        &run_scan_buffer_,
+        &run_ids_,
+        &context_);
+
+    // The number of runs sizes the outputs, so it is needed on the host.
+    int num_unique = 0;
+    int num_indices = 0;
+    context_.CopyBytes<CUDAContext, CPUContext>(
+        sizeof(int), run_ids_.template data<int>() + n - 1, &num_unique);
+    context_.CopyBytes<CUDAContext, CPUContext>(
+        sizeof(int), prefix_sum_length_data + len_length - 1, &num_indices);
+    context_.FinishDeviceComputation();
+    CAFFE_ENFORCE_EQ(num_indices, n, "The lengths do not match INDICES");
+
+    unique->Resize(num_unique);
+    shape[0] = num_unique;
+    rows->Resize(shape);
+    run_ends_.Resize(num_unique);
+    grad_rows_.Resize(n);
+    run_ends_kernel<IndexType><<<
+        CAFFE_GET_BLOCKS(n),
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context_.cuda_stream()>>>(
+        n,
+        sorted_.template data<IndexType>(),
+        heads_.template data<int>(),
+        run_ids_.template data<int>(),
+        segment_ids_.template data<int>(),
+        perm_.template data<int>(),
+        unique->template mutable_data<IndexType>(),
+        run_ends_.template mutable_data<int>(),
+        grad_rows_.template mutable_data<int>());
+    sparse_length_sum(
+        grad.template data<float>(),
+        rows->template mutable_data<float>(),
+        run_ends_.template data<int>(),
+        grad_rows_.template data<int>(),
+        post,
+        num_unique,
+        n,
+        &context_);
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(GRAD, LENGTHS, INDICES);
+  OUTPUT_TAGS(UNIQUE_INDICES, GRAD_ROWS);
+
+  Tensor<CUDAContext> inclusive_scan_buffer_;
+  Tensor<CUDAContext> inclusive_scan_length_buffer_;
+  Tensor<CUDAContext> segment_ids_;
+  Tensor<CUDAContext> positions_;
+  Tensor<CUDAContext> sorted_;
+  Tensor<CUDAContext> perm_;
+  Tensor<CUDAContext> sort_buffer_;
+  Tensor<CUDAContext> heads_;
+  Tensor<CUDAContext> run_ids_;
+  Tensor<CUDAContext> run_scan_buffer_;
+  Tensor<CUDAContext> run_ends_;
+  Tensor<CUDAContext> grad_rows_;
+};
+
+REGISTER_CUDA_OPERATOR(
+    SparseLengthsSumSortedGradient,
+    CUDASparseLengthsSumSortedGradientOp);
 } // namespace caffe2
@@ -0,0 +1,186 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <map>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+constexpr int kSegments = 300;
+constexpr int kBlockSize = 64;
+
+// Fills the inputs of the segment ops: DATA, LENGTHS and SEGMENT_IDS close to
+// them, with segments of uneven and sometimes zero lengths.
+void FillInputs(Workspace* ws) {
+  auto* lengths = ws->CreateBlob("lengths")->GetMutable<TensorCPU>();
+  lengths->Resize(kSegments);
+  int* l = lengths->mutable_data<int>();
+  int rows = 0;
+  for (int i = 0; i < kSegments; ++i) {
+    l[i] = (i * 37) % 29;
+    rows += l[i];
+  }
+  auto* ids = ws->CreateBlob("segment_ids")->GetMutable<TensorCPU>();
+  ids->Resize(rows);
+  int* s = ids->mutable_data<int>();
+  for (int i = 0, row = 0; i < kSegments; ++i) {
+    // Sorted segment ids can not have gaps, so empty segments borrow a row.
+    for (int j = 0; j < std::max(l[i], 1) && row < rows; ++j) {
+      s[row++] = i;
+    }
+  }
+  auto* data = ws->CreateBlob("data")->GetMutable<TensorCPU>();
+  data->Resize(rows, kBlockSize);
+  float* d = data->mutable_data<float>();
+  for (int i = 0; i < data->size(); ++i) {
+    d[i] = (i * 7919) % 1013 - 500;
+  }
+}
+
+// Runs op and its gradient with the given number of threads and returns the
+// output followed by the data gradient.
+vector<vector<float>>
+RunWithGradient(const string& type, const string& segments, int num_threads) {
+  Workspace ws;
+  FillInputs(&ws);
+  const auto def = CreateOperatorDef(
+      type,
+      "",
+      {"data", segments},
+      {"output"},
+      {MakeArgument("num_threads", num_threads)});
+  EXPECT_TRUE(ws.RunOperatorOnce(def));
+  const auto& output = ws.GetBlob("output")->Get<TensorCPU>();
+  auto* grad = ws.CreateBlob("output_grad")->GetMutable<TensorCPU>();
+  grad->ResizeLike(output);
+  float* g = grad->mutable_data<float>();
+  for (int i = 0; i < grad->size(); ++i) {
+    g[i] = i % 17;
+  }
+  vector<GradientWrapper> g_output(1);
+  g_output[0].dense_ = "output_grad";
+  for (const auto& grad_def : GetGradientForOp(def, g_output).ops_) {
+    EXPECT_TRUE(ws.RunOperatorOnce(grad_def));
+  }
+  const auto& data_grad = ws.GetBlob("data_grad")->Get<TensorCPU>();
+  return {
+      vector<float>(output.data<float>(), output.data<float>() + output.size()),
+      vector<float>(
+          data_grad.data<float>(),
+          data_grad.data<float>() + data_grad.size())};
+}
+
+void CheckThreadsMatch(const string& type, const string& segments) {
+  const auto expected = RunWithGradient(type, segments, 1);
+  const auto actual = RunWithGradient(type, segments, 4);
+  EXPECT_EQ(expected[0], actual[0]) << type;
+  EXPECT_EQ(expected[1], actual[1]) << type;
+}
+
+} // namespace
+
+TEST(SegmentReductionOpTest, LengthsMax) {
+  Workspace ws;
+  FillInputs(&ws);
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("LengthsMax", "", {"data", "lengths"}, {"output"})));
+  const auto& data = ws.GetBlob("data")->Get<TensorCPU>();
+  const auto& output = ws.GetBlob("output")->Get<TensorCPU>();
+  const int* l = ws.GetBlob("lengths")->Get<TensorCPU>().data<int>();
+  ASSERT_EQ(output.dims(), vector<TIndex>({kSegments, kBlockSize}));
+  for (int i = 0, row = 0; i < kSegments; row += l[i++]) {
+    for (int j = 0; j < kBlockSize; ++j) {
+      float expected = 0;
+      for (int r = row; r < row + l[i]; ++r) {
+        const float x = data.data<float>()[r * kBlockSize + j];
+        expected = r == row ? x : std::max(expected, x);
+      }
+      ASSERT_EQ(expected, output.data<float>()[i * kBlockSize + j]);
+    }
+  }
+}
+
+TEST(SegmentReductionOpTest, SplitsLengthsBetweenThreads) {
+  CheckThreadsMatch("LengthsSum", "lengths");
+  CheckThreadsMatch("LengthsMean", "lengths");
+  CheckThreadsMatch("LengthsMax", "lengths");
+}
+
+TEST(SegmentReductionOpTest, SparseLengthsSumSortedGradient) {
+  Workspace ws;
+  FillInputs(&ws);
+  const int* l = ws.GetBlob("lengths")->Get<TensorCPU>().data<int>();
+  const auto& grad = ws.GetBlob("data")->Get<TensorCPU>();
+  // The gradient of the segments is the first kSegments rows of data.
+  auto* segment_grad = ws.CreateBlob("segment_grad")->GetMutable<TensorCPU>();
+  segment_grad->Resize(kSegments, kBlockSize);
+  std::copy(
+      grad.data<float>(),
+      grad.data<float>() + segment_grad->size(),
+      segment_grad->mutable_data<float>());
+  int num_indices = 0;
+  for (int i = 0; i < kSegments; ++i) {
+    num_indices += l[i];
+  }
+  auto* indices = ws.CreateBlob("indices")->GetMutable<TensorCPU>();
+  indices->Resize(num_indices);
+  for (int i = 0; i < num_indices; ++i) {
+    indices->mutable_data<int64_t>()[i] = (i * 13) % 101;
+  }
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "SparseLengthsSumSortedGradient",
+      "",
+      {"segment_grad", "lengths", "indices"},
+      {"unique", "grad_rows"})));
+
+  std::map<int64_t, vector<float>> expected;
+  const float* g = segment_grad->data<float>();
+  for (int i = 0, pos = 0; i < kSegments; ++i) {
+    for (int j = 0; j < l[i]; ++j, ++pos) {
+      auto& row = expected[indices->data<int64_t>()[pos]];
+      row.resize(kBlockSize);
+      for (int k = 0; k < kBlockSize; ++k) {
+        row[k] += g[i * kBlockSize + k];
+      }
+    }
+  }
+  const auto& unique = ws.GetBlob("unique")->Get<TensorCPU>();
+  const auto& grad_rows = ws.GetBlob("grad_rows")->Get<TensorCPU>();
+  ASSERT_EQ(unique.size(), expected.size());
+  ASSERT_EQ(grad_rows.dims(), vector<TIndex>({unique.size(), kBlockSize}));
+  int r = 0;
+  for (const auto& entry : expected) {
+    EXPECT_EQ(unique.data<int64_t>()[r], entry.first);
+    for (int k = 0; k < kBlockSize; ++k) {
+      EXPECT_EQ(grad_rows.data<float>()[r * kBlockSize + k], entry.second[k]);
+    }
+    ++r;
+  }
+}
+
+TEST(SegmentReductionOpTest, SplitsSortedSegmentsBetweenThreads) {
+  CheckThreadsMatch("SortedSegmentSum", "segment_ids");
+  CheckThreadsMatch("SortedSegmentMean", "segment_ids");
+}
+
+} // namespace caffe2
@@ -15,16 +15,18 @@
  */
 
 #include "caffe2/operators/elementwise_op.h"
+#include "caffe2/perfkernels/transcendental.h"
 #include "caffe2/utils/math.h"
 
 namespace caffe2 {
 
 struct SigmoidCPUFunctor {
-  template <typename T>
-  inline void
-  operator()(const int n, const T* x, T* y, CPUContext* /*device_context*/) {
-    ConstEigenVectorArrayMap<T> xM(x, n);
-    EigenVectorArrayMap<T>(y, n) = 1. / (1. + (-xM).exp());
+  inline void operator()(
+      const int n,
+      const float* x,
+      float* y,
+      CPUContext* /*device_context*/) {
+    vector_sigmoid(n, x, y);
   }
 };
 
@@ -57,6 +59,7 @@ OPERATOR_SCHEMA(Sigmoid)
   .NumOutputs(1)
   .AllowInplace({{0, 0}})
   .IdenticalTypeAndShape()
+  .CostInferenceFunction(PointwiseCostInference<1>)
   .SetDoc(R"DOC(
 Sigmoid takes one input data (Tensor<T>) and produces one output data
 (Tensor<T>) where the sigmoid function, y = 1 / (1 + exp(-x)), is applied to the
@@ -52,6 +52,11 @@ Example:
     .Input(2, "ends", "1D tensor: end-indices for each dimension of data.")
     .Arg("starts", "List of starting indices")
     .Arg("ends", "List of ending indices")
+    .Arg(
+        "zero_copy",
+        "(bool, default false) On CPU, if the slice is a contiguous range of "
+        "the input, make the output a view of the input instead of a copy. "
+        "Writes to the output then change the input.")
     .TensorInferenceFunction([](const OperatorDef& def,
                                 const vector<TensorShape>& in) {
       if (in.size() > 1) {
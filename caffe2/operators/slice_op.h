@@ -32,7 +32,8 @@ bool SliceImpl(
     const Tensor<Context>& ends,
     Context* context,
     Tensor<Context>* gdata = nullptr,
-    const Tensor<Context>* go = nullptr) {
+    const Tensor<Context>* go = nullptr,
+    bool zero_copy = false) {
   bool backward = output == nullptr;
 
   auto* starts_data = starts.template data<SIndex>();
@@ -95,7 +96,10 @@ bool SliceImpl(
     }
   }
   if (dim == -1) {
-    if (!backward) {
+    if (!backward && zero_copy) {
+      output->ResizeLike(data);
+      output->ShareData(data);
+    } else if (!backward) {
       output->CopyFrom(data, context);
     } else {
       gdata->CopyFrom(*go, context);
@@ -114,6 +118,11 @@ bool SliceImpl(
       std::multiplies<SIndex>());
   if (!backward) {
     output->Resize(dst_sizes);
+    if (zero_copy && num_blocks == 1) {
+      // A single block of the input is a contiguous range of it.
+      output->ShareDataSlice(data, unit * starts_idx[dim]);
+      return true;
+    }
   } else {
     gdata->ResizeLike(data);
   }
@@ -217,6 +226,7 @@ class SliceOp : public Operator<Context> {
       : Operator<Context>(operator_def, ws),
         starts_(OperatorBase::GetRepeatedArgument<SIndex>("starts")),
         ends_(OperatorBase::GetRepeatedArgument<SIndex>("ends")),
+        zero_copy_(OperatorBase::GetSingleArgument<bool>("zero_copy", false)),
         statically_inited_(false) {}
 
   bool RunOnDevice() override {
@@ -248,7 +258,14 @@ class SliceOp : public Operator<Context> {
     }
 
     return SliceImpl<SIndex, Context>(
-        output, data, starts_host_, ends_host_, &context_);
+        output,
+        data,
+        starts_host_,
+        ends_host_,
+        &context_,
+        nullptr,
+        nullptr,
+        zero_copy_);
   }
 
   DISABLE_COPY_AND_ASSIGN(SliceOp);
@@ -256,6 +273,7 @@ class SliceOp : public Operator<Context> {
  private:
   std::vector<SIndex> starts_;
   std::vector<SIndex> ends_;
+  bool zero_copy_;
   bool statically_inited_;
   TensorCPU starts_host_;
   TensorCPU ends_host_;
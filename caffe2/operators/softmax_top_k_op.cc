@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/operators/softmax_top_k_op.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+#include "caffe2/perfkernels/transcendental.h"
+#include "caffe2/perfkernels/vector_ops.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Number of logits exponentiated at a time, small enough for the chunk and
+// its exponentials to stay in L1 while the heap is updated.
+constexpr int kSoftmaxTopKChunk = 1024;
+
+template <typename T>
+struct ValueCmp {
+  bool operator()(
+      const std::pair<T, TIndex>& lhs,
+      const std::pair<T, TIndex>& rhs) {
+    return (
+        lhs.first > rhs.first ||
+        (lhs.first == rhs.first && lhs.second < rhs.second));
+  }
+};
+
+} // namespace
+
+template <>
+bool SoftmaxTopKOp<float, CPUContext>::RunOnDevice() {
+  const auto& X = Input(0);
+  auto* values = Output(0);
+  auto* indices = Output(1);
+  CAFFE_ENFORCE_GE(X.ndim(), 1);
+  const int D = X.dim32(X.ndim() - 1);
+  CAFFE_ENFORCE(D >= k_, "k argment should not be greater than last dim");
+  const TIndex N = X.size_to_dim(X.ndim() - 1);
+
+  auto out_dims = X.dims();
+  out_dims.back() = k_;
+  values->Resize(out_dims);
+  indices->Resize(out_dims);
+  float* values_data = values->mutable_data<float>();
+  TIndex* indices_data = indices->mutable_data<TIndex>();
+  buffer_.resize(std::min(D, kSoftmaxTopKChunk));
+
+  for (TIndex i = 0; i < N; ++i) {
+    const float* row = X.data<float>() + i * D;
+    // Min-heap of the k_ largest (logit, index) pairs seen so far. Softmax is
+    // monotonic, so the largest logits are the largest probabilities.
+    std::priority_queue<
+        std::pair<float, TIndex>,
+        std::vector<std::pair<float, TIndex>>,
+        ValueCmp<float>>
+        PQ;
+    // Running max and sum of exp(x - max) over the chunks seen so far, the
+    // sum being rescaled whenever the max grows.
+    float row_max = -std::numeric_limits<float>::infinity();
+    float sum = 0;
+    for (int begin = 0; begin < D; begin += kSoftmaxTopKChunk) {
+      const int n = std::min(D - begin, kSoftmaxTopKChunk);
+      const float* x = row + begin;
+      const float chunk_max = *std::max_element(x, x + n);
+      if (chunk_max > row_max) {
+        sum *= std::exp(row_max - chunk_max);
+        row_max = chunk_max;
+      }
+      for (int j = 0; j < n; ++j) {
+        buffer_[j] = x[j] - row_max;
+      }
+      vector_exp(n, buffer_.data(), buffer_.data());
+      sum += vector_sum(n, buffer_.data());
+
+      for (int j = 0; j < n; ++j) {
+        if (PQ.size() < k_ || x[j] > PQ.top().first) {
+          PQ.push(std::make_pair(x[j], begin + j));
+          if (PQ.size() > k_) {
+            PQ.pop();
+          }
+        }
+      }
+    }
+
+    float* row_values = values_data + i * k_;
+    TIndex* row_indices = indices_data + i * k_;
+    for (int j = k_ - 1; j >= 0; --j) {
+      const auto& top = PQ.top();
+      row_values[j] = std::exp(top.first - row_max) / sum;
+      row_indices[j] = top.second;
+      PQ.pop();
+    }
+  }
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(SoftmaxTopK, SoftmaxTopKOp<float, CPUContext>);
+
+OPERATOR_SCHEMA(SoftmaxTopK)
+    .NumInputs(1)
+    .NumOutputs(2)
+    .TensorInferenceFunction([](const OperatorDef& def,
+                                const vector<TensorShape>& in) {
+      vector<TensorShape> out = {in[0], in[0]};
+      ArgumentHelper helper(def);
+      auto k = helper.GetSingleArgument("k", -1);
+      auto dims_size = in[0].dims_size();
+      out[0].set_dims(dims_size - 1, k);
+      out[1].set_dims(dims_size - 1, k);
+      out[1].set_data_type(TensorProto_DataType_INT64);
+      return out;
+    })
+    .SetDoc(R"DOC(
+Computes the K largest softmax probabilities along the last dimension. Given
+an input tensor of shape [a_1, a_2, ..., a_n, r] and integer argument k, the
+outputs are the same as those of a Softmax over the last dimension followed by
+TopK, but the logits are read once and the probabilities of the r classes are
+never stored, which matters for output layers with a large vocabulary.
+
+Given two equivalent values, the element with the lower index appears first.
+    )DOC")
+    .Input(0, "X", "Tensor of logits of shape [a_1, a_2, ..., a_n, r]")
+    .Output(
+        0,
+        "Values",
+        "Tensor of shape [a_1, a_2, ..., a_n, k] containing the top K "
+        "probabilities, in decreasing order")
+    .Output(
+        1,
+        "Indices",
+        "Tensor of shape [a_1, a_2, ..., a_n, k] containing the corresponding "
+        "indices along the last dimension of X")
+    .Arg("k", "Number of top elements to retrieve");
+
+SHOULD_NOT_DO_GRADIENT(SoftmaxTopK);
+
+} // namespace caffe2
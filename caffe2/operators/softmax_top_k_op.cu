@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <limits>
+
+#include <cub/block/block_reduce.cuh>
+
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/operators/softmax_top_k_op.h"
+#include "caffe2/operators/top_k_heap_selection.cuh"
+
+namespace caffe2 {
+
+namespace {
+
+// Turns the top k logits of every row, sorted in decreasing order, into
+// softmax probabilities. The first of them is the max of the row.
+__global__ void SoftmaxTopKNormalizeKernel(
+    const int N,
+    const int D,
+    const int k,
+    const float* X,
+    float* values) {
+  typedef cub::BlockReduce<float, CAFFE_CUDA_NUM_THREADS> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage temp_storage;
+  __shared__ float row_sum;
+
+  for (int i = blockIdx.x; i < N; i += gridDim.x) {
+    const float row_max = values[i * k];
+    float sum = 0;
+    for (int j = threadIdx.x; j < D; j += blockDim.x) {
+      sum += expf(X[i * D + j] - row_max);
+    }
+    float total = BlockReduce(temp_storage).Sum(sum);
+    if (threadIdx.x == 0) {
+      row_sum = total;
+    }
+    __syncthreads();
+    for (int j = threadIdx.x; j < k; j += blockDim.x) {
+      values[i * k + j] = expf(values[i * k + j] - row_max) / row_sum;
+    }
+    __syncthreads();
+  }
+}
+
+} // namespace
+
+template <>
+bool SoftmaxTopKOp<float, CUDAContext>::RunOnDevice() {
+  const auto& X = Input(0);
+  auto* values = Output(0);
+  auto* indices = Output(1);
+  CAFFE_ENFORCE_GE(X.ndim(), 1);
+  const int D = X.dim32(X.ndim() - 1);
+  CAFFE_ENFORCE(D >= k_, "k argment should not be greater than last dim");
+  CAFFE_ENFORCE_LE(k_, 512, "SoftmaxTopK on GPU supports k up to 512");
+  const int N = X.size_to_dim(X.ndim() - 1);
+
+  auto out_dims = X.dims();
+  out_dims.back() = k_;
+  values->Resize(out_dims);
+  indices->Resize(out_dims);
+  if (N == 0) {
+    values->mutable_data<float>();
+    indices->mutable_data<TIndex>();
+    return true;
+  }
+
+  // Softmax is monotonic, so the top k logits are selected first, with the
+  // same per-warp heaps as TopK.
+  constexpr int kBlockSize = 256;
+  const int numWarps = kBlockSize / kWarpSize;
+#define RUN_HEAP(HEAP_SIZE)                                                  \
+  do {                                                                       \
+    int smem = numWarps * HEAP_SIZE * (sizeof(float) + sizeof(TIndex));      \
+    selectRowsViaHeap<float, TIndex, TIndex, kBlockSize, HEAP_SIZE, true>    \
+        <<<N, kBlockSize, smem, context_.cuda_stream()>>>(                   \
+            X.data<float>(),                                                 \
+            values->mutable_data<float>(),                                   \
+            indices->mutable_data<TIndex>(),                                 \
+            -std::numeric_limits<float>::infinity(),                         \
+            -std::numeric_limits<TIndex>::max(),                             \
+            N,                                                               \
+            D,                                                               \
+            k_);                                                             \
+  } while (false)
+
+  if (k_ <= 32) {
+    RUN_HEAP(32);
+  } else if (k_ <= 128) {
+    RUN_HEAP(128);
+  } else {
+    RUN_HEAP(512);
+  }
+#undef RUN_HEAP
+
+  SoftmaxTopKNormalizeKernel<<<
+      std::min(N, CAFFE_MAXIMUM_NUM_BLOCKS),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context_.cuda_stream()>>>(
+      N, D, k_, X.data<float>(), values->mutable_data<float>());
+  return true;
+}
+
+REGISTER_CUDA_OPERATOR(SoftmaxTopK, SoftmaxTopKOp<float, CUDAContext>);
+
+} // namespace caffe2
@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_OPERATORS_SOFTMAX_TOP_K_OP_H_
+#define CAFFE2_OPERATORS_SOFTMAX_TOP_K_OP_H_
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// Computes the k largest softmax probabilities of every row of the input,
+// along its last dimension, without materializing the probabilities of the
+// whole row. Equivalent to Softmax followed by TopK.
+template <typename T, class Context>
+class SoftmaxTopKOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+
+  SoftmaxTopKOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws), OP_SINGLE_ARG(int, "k", k_, -1) {
+    CAFFE_ENFORCE(k_ >= 1, "k argument must be >= 1");
+  }
+
+  bool RunOnDevice() override;
+
+ protected:
+  int k_;
+  // exp(x - max) of the current chunk of a row, on CPU.
+  vector<T> buffer_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_SOFTMAX_TOP_K_OP_H_
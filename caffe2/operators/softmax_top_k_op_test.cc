@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Checks SoftmaxTopK against Softmax followed by TopK.
+void CheckSoftmaxTopK(int N, int D, int k) {
+  Workspace ws;
+  auto* X = ws.CreateBlob("X")->GetMutable<TensorCPU>();
+  X->Resize(N, D);
+  for (int i = 0; i < X->size(); ++i) {
+    // Ties and a large dynamic range across the chunks of a row.
+    X->mutable_data<float>()[i] = (i * 37 % 101) * 0.25f - (i % 3) * 4;
+  }
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "SoftmaxTopK",
+      "",
+      {"X"},
+      {"values", "indices"},
+      {MakeArgument("k", k)})));
+  ASSERT_TRUE(
+      ws.RunOperatorOnce(CreateOperatorDef("Softmax", "", {"X"}, {"P"})));
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "TopK",
+      "",
+      {"P"},
+      {"ref_values", "ref_indices"},
+      {MakeArgument("k", k)})));
+
+  const auto& values = ws.GetBlob("values")->Get<TensorCPU>();
+  const auto& indices = ws.GetBlob("indices")->Get<TensorCPU>();
+  const auto& ref_values = ws.GetBlob("ref_values")->Get<TensorCPU>();
+  const auto& ref_indices = ws.GetBlob("ref_indices")->Get<TensorCPU>();
+  EXPECT_EQ(values.dims(), vector<TIndex>({N, k}));
+  EXPECT_EQ(indices.dims(), vector<TIndex>({N, k}));
+  for (int i = 0; i < N * k; ++i) {
+    EXPECT_NEAR(values.data<float>()[i], ref_values.data<float>()[i], 1e-6)
+        << i;
+    EXPECT_EQ(indices.data<TIndex>()[i], ref_indices.data<TIndex>()[i]) << i;
+  }
+}
+
+} // namespace
+
+TEST(SoftmaxTopKOpTest, MatchesSoftmaxAndTopK) {
+  CheckSoftmaxTopK(3, 10, 1);
+  CheckSoftmaxTopK(3, 10, 10);
+  CheckSoftmaxTopK(2, 5000, 7);
+}
+
+} // namespace caffe2
@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/sort_op.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace caffe2 {
+
+namespace {
+
+// Sets perm to the stable sorting permutation of data[0, n).
+template <typename T>
+void SortPermutation(const T* data, TIndex n, bool descending, TIndex* perm) {
+  std::iota(perm, perm + n, 0);
+  if (descending) {
+    std::stable_sort(perm, perm + n, [data](TIndex a, TIndex b) {
+      return data[a] > data[b];
+    });
+  } else {
+    std::stable_sort(perm, perm + n, [data](TIndex a, TIndex b) {
+      return data[a] < data[b];
+    });
+  }
+}
+
+} // namespace
+
+template <>
+template <typename T>
+bool SortOp<CPUContext>::DoRunWithType() {
+  const auto& input = Input(0);
+  TensorCPU* sorted;
+  TensorCPU* indices;
+  GetOutputs(&sorted, &indices);
+  if (input.size() == 0) {
+    if (sorted) {
+      sorted->template mutable_data<T>();
+    }
+    if (indices) {
+      indices->template mutable_data<TIndex>();
+    }
+    return true;
+  }
+  const TIndex row_size = input.dim(input.ndim() - 1);
+  const TIndex num_rows = input.size() / row_size;
+  const T* in = input.template data<T>();
+  T* out = sorted ? sorted->template mutable_data<T>() : nullptr;
+  vector<TIndex> perm(row_size);
+  for (TIndex r = 0; r < num_rows; ++r) {
+    const T* row = in + r * row_size;
+    SortPermutation(row, row_size, descending_, perm.data());
+    if (out) {
+      for (TIndex j = 0; j < row_size; ++j) {
+        out[r * row_size + j] = row[perm[j]];
+      }
+    }
+    if (indices) {
+      std::copy(
+          perm.begin(),
+          perm.end(),
+          indices->template mutable_data<TIndex>() + r * row_size);
+    }
+  }
+  return true;
+}
+
+template <>
+template <typename T>
+bool SortByKeyOp<CPUContext>::DoRunWithType() {
+  const auto& keys = Input(0);
+  CAFFE_ENFORCE_EQ(keys.ndim(), 1, "KEYS must be a vector");
+  const TIndex n = keys.size();
+  vector<TIndex> perm(n);
+  SortPermutation(keys.template data<T>(), n, descending_, perm.data());
+
+  auto* sorted_keys = Output(0);
+  sorted_keys->ResizeLike(keys);
+  const T* k = keys.template data<T>();
+  T* sk = sorted_keys->template mutable_data<T>();
+  for (TIndex i = 0; i < n; ++i) {
+    sk[i] = k[perm[i]];
+  }
+  for (int v = 1; v < InputSize(); ++v) {
+    const auto& values = Input(v);
+    CAFFE_ENFORCE_GE(values.ndim(), 1);
+    CAFFE_ENFORCE_EQ(
+        values.dim(0), n, "VALUES must have one row per key, input ", v);
+    CAFFE_ENFORCE(
+        values.meta().copy() == nullptr,
+        "VALUES must be of a fundamental type, input ",
+        v);
+    auto* sorted_values = Output(v);
+    CAFFE_ENFORCE_NE(
+        sorted_values, &values, "SortByKey can't run in place, input ", v);
+    sorted_values->ResizeLike(values);
+    const size_t row_bytes = values.size_from_dim(1) * values.itemsize();
+    const char* src = static_cast<const char*>(values.raw_data());
+    char* dst = static_cast<char*>(
+        sorted_values->raw_mutable_data(values.meta()));
+    for (TIndex i = 0; i < n; ++i) {
+      memcpy(dst + i * row_bytes, src + perm[i] * row_bytes, row_bytes);
+    }
+  }
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(Sort, SortOp<CPUContext>);
+REGISTER_CPU_OPERATOR(ArgSort, SortOp<CPUContext>);
+REGISTER_CPU_OPERATOR(SortByKey, SortByKeyOp<CPUContext>);
+
+OPERATOR_SCHEMA(Sort)
+    .NumInputs(1)
+    .NumOutputs(1, 2)
+    .SetDoc(R"DOC(
+Sorts every row of the input along its last axis, e.g. every row of a
+matrix, and optionally returns the position in its row of every sorted
+value. The sort is stable, so equal values keep their order, on CPU as well
+as on GPU, where the rows are sorted with cub radix sort: a single row with
+DeviceRadixSort and several rows at once with DeviceSegmentedRadixSort.
+)DOC")
+    .Arg("descending", "(bool, default false) Sort in decreasing order")
+    .Input(0, "X", "float, int32 or int64 tensor of at least one dimension")
+    .Output(0, "SORTED", "The rows of X, sorted")
+    .Output(1, "INDICES", "(Optional) int64 position of every sorted value")
+    .TensorInferenceFunction([](const OperatorDef& def,
+                                const vector<TensorShape>& in) {
+      vector<TensorShape> out(def.output_size(), in[0]);
+      if (out.size() > 1) {
+        out[1].set_data_type(TensorProto::INT64);
+      }
+      return out;
+    });
+
+OPERATOR_SCHEMA(ArgSort)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Returns the positions that sort every row of the input along its last axis,
+as the INDICES of Sort, without the sorted values.
+)DOC")
+    .Arg("descending", "(bool, default false) Sort in decreasing order")
+    .Input(0, "X", "float, int32 or int64 tensor of at least one dimension")
+    .Output(0, "INDICES", "int64 position in its row of every sorted value")
+    .TensorInferenceFunction([](const OperatorDef& /* unused */,
+                                const vector<TensorShape>& in) {
+      vector<TensorShape> out(1, in[0]);
+      out[0].set_data_type(TensorProto::INT64);
+      return out;
+    });
+
+OPERATOR_SCHEMA(SortByKey)
+    .NumInputs(1, INT_MAX)
+    .NumOutputs(1, INT_MAX)
+    .SameNumberOfOutput()
+    .SetDoc(R"DOC(
+Sorts the vector KEYS and moves the rows of every other input, which must
+have one row per key, along with their key, e.g. to group the rows of a
+sparse gradient by index. The sort is stable, so the rows of equal keys keep
+their order.
+)DOC")
+    .Arg("descending", "(bool, default false) Sort in decreasing order")
+    .Input(0, "KEYS", "float, int32 or int64 vector")
+    .Input(1, "VALUES", "Any number of tensors with one row per key")
+    .Output(0, "SORTED_KEYS", "KEYS, sorted")
+    .Output(1, "SORTED_VALUES", "The rows of every VALUES, in key order")
+    .IdenticalTypeAndShape();
+
+SHOULD_NOT_DO_GRADIENT(Sort);
+SHOULD_NOT_DO_GRADIENT(ArgSort);
+SHOULD_NOT_DO_GRADIENT(SortByKey);
+
+} // namespace caffe2
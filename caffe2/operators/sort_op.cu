@@ -0,0 +1,341 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cub/device/device_radix_sort.cuh>
+#include <cub/device/device_segmented_radix_sort.cuh>
+
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/operators/sort_op.h"
+
+namespace caffe2 {
+
+namespace {
+
+__global__ void RowPositionsKernel(TIndex n, TIndex row_size, TIndex* out) {
+  CUDA_1D_KERNEL_LOOP(i, n) {
+    out[i] = i % row_size;
+  }
+}
+
+__global__ void RowOffsetsKernel(int num_rows, int row_size, int* offsets) {
+  CUDA_1D_KERNEL_LOOP(i, num_rows + 1) {
+    offsets[i] = i * row_size;
+  }
+}
+
+__global__ void GatherRowsKernel(
+    TIndex n,
+    TIndex row_bytes,
+    const TIndex* perm,
+    const char* src,
+    char* dst) {
+  for (TIndex i = blockIdx.x; i < n; i += gridDim.x) {
+    const char* from = src + perm[i] * row_bytes;
+    char* to = dst + i * row_bytes;
+    for (TIndex j = threadIdx.x; j < row_bytes; j += blockDim.x) {
+      to[j] = from[j];
+    }
+  }
+}
+
+// Sorts the keys, and the values with them unless values_out is null, of
+// num_segments consecutive segments delimited by offsets, or of the whole
+// input if there is a single segment. Like cub, returns the size of the
+// temporary storage in temp_bytes, without sorting, if temp is null.
+template <typename T>
+void RadixSort(
+    void* temp,
+    size_t& temp_bytes,
+    const T* keys_in,
+    T* keys_out,
+    const TIndex* values_in,
+    TIndex* values_out,
+    int n,
+    int num_segments,
+    const int* offsets,
+    bool descending,
+    cudaStream_t stream) {
+  const int end_bit = sizeof(T) * 8;
+  if (num_segments == 1) {
+    if (values_out == nullptr) {
+      if (descending) {
+        cub::DeviceRadixSort::SortKeysDescending(
+            temp, temp_bytes, keys_in, keys_out, n, 0, end_bit, stream);
+      } else {
+        cub::DeviceRadixSort::SortKeys(
+            temp, temp_bytes, keys_in, keys_out, n, 0, end_bit, stream);
+      }
+    } else if (descending) {
+      cub::DeviceRadixSort::SortPairsDescending(
+          temp,
+          temp_bytes,
+          keys_in,
+          keys_out,
+          values_in,
+          values_out,
+          n,
+          0,
+          end_bit,
+          stream);
+    } else {
+      cub::DeviceRadixSort::SortPairs(
+          temp,
+          temp_bytes,
+          keys_in,
+          keys_out,
+          values_in,
+          values_out,
+          n,
+          0,
+          end_bit,
+          stream);
+    }
+    return;
+  }
+  if (values_out == nullptr) {
+    if (descending) {
+      cub::DeviceSegmentedRadixSort::SortKeysDescending(
+          temp,
+          temp_bytes,
+          keys_in,
+          keys_out,
+          n,
+          num_segments,
+          offsets,
+          offsets + 1,
+          0,
+          end_bit,
+          stream);
+    } else {
+      cub::DeviceSegmentedRadixSort::SortKeys(
+          temp,
+          temp_bytes,
+          keys_in,
+          keys_out,
+          n,
+          num_segments,
+          offsets,
+          offsets + 1,
+          0,
+          end_bit,
+          stream);
+    }
+  } else if (descending) {
+    cub::DeviceSegmentedRadixSort::SortPairsDescending(
+        temp,
+        temp_bytes,
+        keys_in,
+        keys_out,
+        values_in,
+        values_out,
+        n,
+        num_segments,
+        offsets,
+        offsets + 1,
+        0,
+        end_bit,
+        stream);
+  } else {
+    cub::DeviceSegmentedRadixSort::SortPairs(
+        temp,
+        temp_bytes,
+        keys_in,
+        keys_out,
+        values_in,
+        values_out,
+        n,
+        num_segments,
+        offsets,
+        offsets + 1,
+        0,
+        end_bit,
+        stream);
+  }
+}
+
+// Runs RadixSort with its temporary storage in buffer, which comes from the
+// caching allocator like any tensor.
+template <typename T>
+void RadixSort(
+    const T* keys_in,
+    T* keys_out,
+    const TIndex* values_in,
+    TIndex* values_out,
+    int n,
+    int num_segments,
+    const int* offsets,
+    bool descending,
+    Tensor<CUDAContext>* buffer,
+    CUDAContext* context) {
+  size_t temp_bytes = 0;
+  RadixSort<T>(
+      nullptr,
+      temp_bytes,
+      keys_in,
+      keys_out,
+      values_in,
+      values_out,
+      n,
+      num_segments,
+      offsets,
+      descending,
+      context->cuda_stream());
+  buffer->Resize(temp_bytes);
+  RadixSort<T>(
+      static_cast<void*>(buffer->mutable_data<char>()),
+      temp_bytes,
+      keys_in,
+      keys_out,
+      values_in,
+      values_out,
+      n,
+      num_segments,
+      offsets,
+      descending,
+      context->cuda_stream());
+}
+
+} // namespace
+
+template <>
+template <typename T>
+bool SortOp<CUDAContext>::DoRunWithType() {
+  const auto& input = Input(0);
+  TensorCUDA* sorted;
+  TensorCUDA* indices;
+  GetOutputs(&sorted, &indices);
+  const TIndex n = input.size();
+  CAFFE_ENFORCE_LT(n, std::numeric_limits<int>::max());
+  T* keys_out = sorted ? sorted->template mutable_data<T>() : nullptr;
+  TIndex* positions =
+      indices ? indices->template mutable_data<TIndex>() : nullptr;
+  if (n == 0) {
+    return true;
+  }
+  const int row_size = input.dim32(input.ndim() - 1);
+  const int num_rows = n / row_size;
+  if (keys_out == nullptr) {
+    keys_buffer_.ResizeLike(input);
+    keys_out = keys_buffer_.template mutable_data<T>();
+  }
+  const TIndex* positions_in = nullptr;
+  if (positions) {
+    values_buffer_.ResizeLike(input);
+    positions_in = values_buffer_.template mutable_data<TIndex>();
+    RowPositionsKernel<<<
+        CAFFE_GET_BLOCKS(n),
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context_.cuda_stream()>>>(
+        n, row_size, values_buffer_.template mutable_data<TIndex>());
+  }
+  const int* offsets = nullptr;
+  if (num_rows > 1) {
+    offsets_buffer_.Resize(num_rows + 1);
+    RowOffsetsKernel<<<
+        CAFFE_GET_BLOCKS(num_rows + 1),
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context_.cuda_stream()>>>(
+        num_rows, row_size, offsets_buffer_.template mutable_data<int>());
+    offsets = offsets_buffer_.template data<int>();
+  }
+  RadixSort<T>(
+      input.template data<T>(),
+      keys_out,
+      positions_in,
+      positions,
+      n,
+      num_rows,
+      offsets,
+      descending_,
+      &sort_buffer_,
+      &context_);
+  return true;
+}
+
+template <>
+template <typename T>
+bool SortByKeyOp<CUDAContext>::DoRunWithType() {
+  const auto& keys = Input(0);
+  CAFFE_ENFORCE_EQ(keys.ndim(), 1, "KEYS must be a vector");
+  const TIndex n = keys.size();
+  CAFFE_ENFORCE_LT(n, std::numeric_limits<int>::max());
+  auto* sorted_keys = Output(0);
+  sorted_keys->ResizeLike(keys);
+  T* sk = sorted_keys->template mutable_data<T>();
+
+  TIndex* perm = nullptr;
+  if (n > 0) {
+    values_buffer_.Resize(n);
+    perm_buffer_.Resize(n);
+    perm = perm_buffer_.template mutable_data<TIndex>();
+    RowPositionsKernel<<<
+        CAFFE_GET_BLOCKS(n),
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context_.cuda_stream()>>>(
+        n, n, values_buffer_.template mutable_data<TIndex>());
+    RadixSort<T>(
+        keys.template data<T>(),
+        sk,
+        values_buffer_.template data<TIndex>(),
+        perm,
+        n,
+        1,
+        nullptr,
+        descending_,
+        &sort_buffer_,
+        &context_);
+  }
+
+  for (int v = 1; v < InputSize(); ++v) {
+    const auto& values = Input(v);
+    CAFFE_ENFORCE_GE(values.ndim(), 1);
+    CAFFE_ENFORCE_EQ(
+        values.dim(0), n, "VALUES must have one row per key, input ", v);
+    CAFFE_ENFORCE(
+        values.meta().copy() == nullptr,
+        "VALUES must be of a fundamental type, input ",
+        v);
+    auto* sorted_values = Output(v);
+    CAFFE_ENFORCE_NE(
+        sorted_values, &values, "SortByKey can't run in place, input ", v);
+    sorted_values->ResizeLike(values);
+    char* dst =
+        static_cast<char*>(sorted_values->raw_mutable_data(values.meta()));
+    const TIndex row_bytes = values.size_from_dim(1) * values.itemsize();
+    if (n > 0 && row_bytes > 0) {
+      GatherRowsKernel<<<
+          std::min(n, static_cast<TIndex>(CAFFE_MAXIMUM_NUM_BLOCKS)),
+          CAFFE_CUDA_NUM_THREADS,
+          0,
+          context_.cuda_stream()>>>(
+          n,
+          row_bytes,
+          perm,
+          static_cast<const char*>(values.raw_data()),
+          dst);
+    }
+  }
+  return true;
+}
+
+REGISTER_CUDA_OPERATOR(Sort, SortOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(ArgSort, SortOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(SortByKey, SortByKeyOp<CUDAContext>);
+
+} // namespace caffe2
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_SORT_OP_H_
+#define CAFFE2_OPERATORS_SORT_OP_H_
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+// Sorts every row of the input, along its last axis, and returns the sorted
+// rows and/or the int64 positions of the sorted values in their row. Both
+// implementations are stable, so that the positions match on CPU and GPU.
+// Registered as Sort, with outputs (SORTED, [INDICES]), and as ArgSort, with
+// the single output INDICES.
+template <class Context>
+class SortOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+
+  SortOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        OP_SINGLE_ARG(bool, "descending", descending_, false),
+        indices_only_(operator_def.type() == "ArgSort") {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<float, int32_t, int64_t>>::call(
+        this, Input(0));
+  }
+
+  template <typename T>
+  bool DoRunWithType();
+
+ private:
+  // Returns the outputs for the sorted values and the positions, either of
+  // which may be null, with their size set.
+  void GetOutputs(Tensor<Context>** sorted, Tensor<Context>** indices) {
+    const auto& input = Input(0);
+    CAFFE_ENFORCE_GE(input.ndim(), 1, "The input can't be a scalar");
+    *sorted = indices_only_ ? nullptr : Output(0);
+    *indices = indices_only_ ? Output(0)
+                             : OutputSize() > 1 ? Output(1) : nullptr;
+    if (*sorted) {
+      (*sorted)->ResizeLike(input);
+    }
+    if (*indices) {
+      (*indices)->ResizeLike(input);
+    }
+  }
+
+  bool descending_;
+  const bool indices_only_;
+  // Scratch space of the GPU sort.
+  Tensor<Context> keys_buffer_;
+  Tensor<Context> values_buffer_;
+  Tensor<Context> offsets_buffer_;
+  Tensor<Context> sort_buffer_;
+};
+
+// Sorts the 1-D KEYS and applies the same permutation to the rows of every
+// VALUES input, e.g. to group the rows of a sparse gradient by id.
+template <class Context>
+class SortByKeyOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+
+  SortByKeyOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        OP_SINGLE_ARG(bool, "descending", descending_, false) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<float, int32_t, int64_t>>::call(
+        this, Input(0));
+  }
+
+  template <typename T>
+  bool DoRunWithType();
+
+ private:
+  bool descending_;
+  // Scratch space of the GPU sort.
+  Tensor<Context> values_buffer_;
+  Tensor<Context> perm_buffer_;
+  Tensor<Context> sort_buffer_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_SORT_OP_H_
@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+template <typename T>
+void SetTensor(
+    Workspace* ws,
+    const string& name,
+    const vector<TIndex>& dims,
+    const vector<T>& values) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  std::copy(values.begin(), values.end(), tensor->mutable_data<T>());
+}
+
+template <typename T>
+vector<T> GetTensor(Workspace* ws, const string& name) {
+  const auto& tensor = ws->GetBlob(name)->Get<TensorCPU>();
+  return vector<T>(tensor.data<T>(), tensor.data<T>() + tensor.size());
+}
+
+} // namespace
+
+TEST(SortOpTest, SortsEveryRowStably) {
+  Workspace ws;
+  SetTensor<float>(&ws, "x", {2, 4}, {3, 1, 2, 1, 0, -1, 5, 0});
+  ASSERT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("Sort", "", {"x"}, {"sorted", "indices"})));
+  EXPECT_EQ(
+      GetTensor<float>(&ws, "sorted"),
+      vector<float>({1, 1, 2, 3, -1, 0, 0, 5}));
+  EXPECT_EQ(
+      GetTensor<TIndex>(&ws, "indices"),
+      vector<TIndex>({1, 3, 2, 0, 1, 0, 3, 2}));
+
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "ArgSort",
+      "",
+      {"x"},
+      {"arg"},
+      {MakeArgument<bool>("descending", true)})));
+  EXPECT_EQ(
+      GetTensor<TIndex>(&ws, "arg"), vector<TIndex>({0, 2, 1, 3, 2, 0, 3, 1}));
+}
+
+TEST(SortOpTest, SortByKeyMovesRows) {
+  Workspace ws;
+  SetTensor<int64_t>(&ws, "keys", {4}, {7, 2, 7, 1});
+  SetTensor<float>(&ws, "rows", {4, 2}, {0, 1, 2, 3, 4, 5, 6, 7});
+  SetTensor<int>(&ws, "ids", {4}, {10, 11, 12, 13});
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "SortByKey",
+      "",
+      {"keys", "rows", "ids"},
+      {"sorted_keys", "sorted_rows", "sorted_ids"})));
+  EXPECT_EQ(
+      GetTensor<int64_t>(&ws, "sorted_keys"), vector<int64_t>({1, 2, 7, 7}));
+  EXPECT_EQ(
+      GetTensor<float>(&ws, "sorted_rows"),
+      vector<float>({6, 7, 2, 3, 0, 1, 4, 5}));
+  EXPECT_EQ(GetTensor<int>(&ws, "sorted_ids"), vector<int>({13, 11, 10, 12}));
+}
+
+} // namespace caffe2
@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/operators/sparse_feature_preprocess_op.h"
+
+namespace caffe2 {
+namespace {
+
+REGISTER_CPU_OPERATOR(SparseFeaturePreprocess, SparseFeaturePreprocessOp);
+
+OPERATOR_SCHEMA(SparseFeaturePreprocess)
+    .NumInputs(2)
+    .NumOutputs(2, INT_MAX)
+    .SetDoc(R"DOC(
+Preprocesses the id lists of many sparse features in one pass. The features
+of each example are given as ranges into VALUES, like for GatherRanges, and
+the features are gathered into groups, each producing one id list in the
+(LENGTHS, VALUES) format. For each group and example this:
+
+1. gathers the ids of the ranges of the group's features,
+2. hashes them like IndexHash, if the group has a positive modulo,
+3. sorts and deduplicates them like MergeIdLists, if the group has more than
+   one feature,
+4. keeps the first max_length of them, if max_length is positive.
+
+This replaces chains of GatherRanges, IndexHash, MergeIdLists and truncation
+operators, which materialize intermediate tensors for every feature. With
+num_threads > 1 the groups are processed in parallel on the workspace thread
+pool.
+
+Example:
+  VALUES = [1, 2, 3, 4, 5, 6, 7]
+  RANGES = [[[0, 2], [2, 1], [3, 0]],
+            [[3, 1], [4, 2], [6, 1]]]
+  features = [2, 0, 1]
+  group_sizes = [1, 2]
+  max_lengths = [0, 2]
+  LENGTHS_0 = [0, 1]
+  VALUES_0 = [7]
+  LENGTHS_1 = [2, 2]
+  VALUES_1 = [1, 2, 4, 5]
+)DOC")
+    .Input(0, "VALUES", "1-D int32/int64 tensor of the ids of all features.")
+    .Input(
+        1,
+        "RANGES",
+        "int32/int64 tensor of dims (N, F, 2): for each of N examples and F "
+        "features, the (start, length) of the feature's ids in VALUES.")
+    .Output(0, "LENGTHS_0", "int32 ids count per example of the first group.")
+    .Output(1, "VALUES_0", "Ids of the first group, and so on for others.")
+    .Arg(
+        "features",
+        "Indices into the F features of RANGES, listed group after group.")
+    .Arg(
+        "group_sizes",
+        "Number of features in each group, by default one group per feature.")
+    .Arg("max_lengths", "Maximum ids per example of each group, 0 for none.")
+    .Arg("modulos", "IndexHash modulo of each group, 0 not to hash.")
+    .Arg("seeds", "IndexHash seed of each group.")
+    .Arg("num_threads", "(int, default 1) Processes groups in parallel if > 1.")
+    .TensorInferenceFunction([](const OperatorDef& def,
+                                const vector<TensorShape>& in) {
+      vector<TensorShape> out(def.output_size());
+      for (int i = 0; i < out.size(); i += 2) {
+        out[i].add_dims(in[1].dims(0));
+        out[i].set_data_type(TensorProto::INT32);
+        out[i + 1].set_data_type(in[0].data_type());
+        out[i + 1].set_unknown_shape(true);
+      }
+      return out;
+    });
+
+NO_GRADIENT(SparseFeaturePreprocess);
+
+} // namespace
+} // namespace caffe2
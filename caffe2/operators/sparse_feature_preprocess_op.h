@@ -0,0 +1,205 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_OPERATORS_SPARSE_FEATURE_PREPROCESS_OP_H_
+#define CAFFE2_OPERATORS_SPARSE_FEATURE_PREPROCESS_OP_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/index_hash.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
+namespace caffe2 {
+
+// Turns the raw id lists of many features, given as ranges into a single
+// VALUES tensor, into one (LENGTHS, VALUES) id list per output, doing what
+// GatherRanges, IndexHash, MergeIdLists and a truncation would do in one pass
+// without the intermediate tensors. Outputs are processed in parallel.
+class SparseFeaturePreprocessOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  SparseFeaturePreprocessOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        features_(OperatorBase::GetRepeatedArgument<int>("features")),
+        group_sizes_(OperatorBase::GetRepeatedArgument<int>("group_sizes")),
+        max_lengths_(OperatorBase::GetRepeatedArgument<int>("max_lengths")),
+        seeds_(OperatorBase::GetRepeatedArgument<int64_t>("seeds")),
+        modulos_(OperatorBase::GetRepeatedArgument<int64_t>("modulos")),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GT(features_.size(), 0, "features should be non-empty");
+    if (group_sizes_.empty()) {
+      group_sizes_.assign(features_.size(), 1);
+    }
+    const int num_groups = group_sizes_.size();
+    CAFFE_ENFORCE_EQ(
+        OutputSize(), 2 * num_groups, "Expected LENGTHS, VALUES per group");
+    int num_features = 0;
+    group_starts_.push_back(0);
+    for (auto size : group_sizes_) {
+      CAFFE_ENFORCE_GT(size, 0, "Each group should have a feature");
+      num_features += size;
+      group_starts_.push_back(num_features);
+    }
+    CAFFE_ENFORCE_EQ(
+        num_features, features_.size(), "group_sizes should sum to features");
+    if (max_lengths_.empty()) {
+      max_lengths_.assign(num_groups, 0);
+    }
+    CAFFE_ENFORCE_EQ(max_lengths_.size(), num_groups);
+    for (auto* args : {&seeds_, &modulos_}) {
+      if (args->empty()) {
+        args->assign(num_groups, 0);
+      }
+      CAFFE_ENFORCE_EQ(args->size(), num_groups);
+    }
+    for (int g = 0; g < num_groups; ++g) {
+      CAFFE_ENFORCE_GE(max_lengths_[g], 0, "max_lengths must be >= 0");
+      CAFFE_ENFORCE_GE(modulos_[g], 0, "modulos must be >= 0");
+    }
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(VALUES));
+  }
+
+  template <typename T>
+  bool DoRunWithType() {
+    return DispatchHelper<TensorTypes2<int32_t, int64_t>, T>::call(
+        this, Input(RANGES));
+  }
+
+  template <typename T, typename Index>
+  bool DoRunWithType2() {
+    const auto& values = Input(VALUES);
+    const auto& ranges = Input(RANGES);
+    CAFFE_ENFORCE_EQ(values.ndim(), 1, "VALUES should be 1-D");
+    CAFFE_ENFORCE_EQ(ranges.ndim(), 3, "RANGES should be 3-D");
+    CAFFE_ENFORCE_EQ(ranges.dim(2), 2, "RANGES should be (start, length)");
+    const TIndex batch_size = ranges.dim(0);
+    const TIndex num_ranges = ranges.dim(1);
+    const T* values_data = values.template data<T>();
+    const Index* ranges_data = ranges.template data<Index>();
+
+    // Validates the ranges and bounds the output sizes before anything is
+    // allocated, so the parallel part only writes.
+    std::vector<TIndex> feature_totals(num_ranges, 0);
+    for (TIndex i = 0; i < batch_size * num_ranges; ++i) {
+      const Index start = ranges_data[2 * i];
+      const Index length = ranges_data[2 * i + 1];
+      CAFFE_ENFORCE(
+          start >= 0 && length >= 0 && start + length <= values.size(),
+          "Range out of the bounds of VALUES");
+      feature_totals[i % num_ranges] += length;
+    }
+    const int num_groups = group_sizes_.size();
+    std::vector<TIndex> sizes(num_groups, 0);
+    for (int g = 0; g < num_groups; ++g) {
+      for (int f = group_starts_[g]; f < group_starts_[g + 1]; ++f) {
+        CAFFE_ENFORCE(
+            features_[f] >= 0 && features_[f] < num_ranges,
+            "Feature ",
+            features_[f],
+            " is not in RANGES");
+        sizes[g] += feature_totals[features_[f]];
+      }
+      if (group_sizes_[g] == 1 && max_lengths_[g] > 0) {
+        sizes[g] = std::min<TIndex>(sizes[g], batch_size * max_lengths_[g]);
+      }
+      Output(2 * g)->Resize(batch_size);
+      Output(2 * g)->template mutable_data<int32_t>();
+      Output(2 * g + 1)->Resize(sizes[g]);
+      Output(2 * g + 1)->template mutable_data<T>();
+    }
+
+    auto process = [&](int g) {
+      int32_t* out_lengths = Output(2 * g)->template mutable_data<int32_t>();
+      T* out_values = Output(2 * g + 1)->template mutable_data<T>();
+      const int begin = group_starts_[g];
+      const int end = group_starts_[g + 1];
+      // Merged groups are sorted and deduplicated like MergeIdLists does.
+      const bool merge = end - begin > 1;
+      const TIndex max_length = max_lengths_[g];
+      const int64_t modulo = modulos_[g];
+      const int64_t seed = seeds_[g];
+      TIndex pos = 0;
+      for (TIndex i = 0; i < batch_size; ++i) {
+        const TIndex example_begin = pos;
+        for (int f = begin; f < end; ++f) {
+          const Index* range =
+              ranges_data + 2 * (i * num_ranges + features_[f]);
+          TIndex length = range[1];
+          if (!merge && max_length > 0) {
+            length = std::min(length, max_length);
+          }
+          const T* ids = values_data + range[0];
+          if (modulo > 0) {
+            index_hash(length, ids, seed, modulo, out_values + pos);
+          } else {
+            std::copy(ids, ids + length, out_values + pos);
+          }
+          pos += length;
+        }
+        if (merge) {
+          std::sort(out_values + example_begin, out_values + pos);
+          pos = std::unique(out_values + example_begin, out_values + pos) -
+              out_values;
+          if (max_length > 0) {
+            pos = std::min(pos, example_begin + max_length);
+          }
+        }
+        out_lengths[i] = pos - example_begin;
+      }
+      sizes[g] = pos;
+    };
+
+    if (num_threads_ == 1 || num_groups == 1) {
+      for (int g = 0; g < num_groups; ++g) {
+        process(g);
+      }
+    } else {
+      ws_->GetThreadPool()->runChunks(
+          [&](int /* unused */, size_t g) { process(g); }, num_groups);
+    }
+    for (int g = 0; g < num_groups; ++g) {
+      Output(2 * g + 1)->Resize(sizes[g]);
+    }
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(VALUES, RANGES);
+
+  std::vector<int> features_;
+  std::vector<int> group_sizes_;
+  // Index in features_ of the first feature of each group, and the total.
+  std::vector<int> group_starts_;
+  std::vector<int> max_lengths_;
+  std::vector<int64_t> seeds_;
+  std::vector<int64_t> modulos_;
+  const int num_threads_;
+  Workspace* ws_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_SPARSE_FEATURE_PREPROCESS_OP_H_
@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+template <typename T>
+vector<T> GetValues(const Workspace& ws, const string& name) {
+  const auto& tensor = ws.GetBlob(name)->Get<TensorCPU>();
+  return vector<T>(tensor.data<T>(), tensor.data<T>() + tensor.size());
+}
+
+} // namespace
+
+TEST(SparseFeaturePreprocessTest, GathersMergesAndTruncates) {
+  Workspace ws;
+  AddTensor<int64_t>(&ws, "values", {7}, {1, 2, 3, 4, 5, 6, 7});
+  AddTensor<int32_t>(
+      &ws, "ranges", {2, 3, 2}, {0, 2, 2, 1, 3, 0, 3, 1, 4, 2, 6, 1});
+  auto def = CreateOperatorDef(
+      "SparseFeaturePreprocess",
+      "",
+      {"values", "ranges"},
+      {"lengths0", "values0", "lengths1", "values1"},
+      {MakeArgument<vector<int>>("features", {2, 0, 1}),
+       MakeArgument<vector<int>>("group_sizes", {1, 2}),
+       MakeArgument<vector<int>>("max_lengths", {0, 2})});
+  ASSERT_TRUE(CreateOperator(def, &ws)->Run());
+  EXPECT_EQ(GetValues<int32_t>(ws, "lengths0"), (vector<int32_t>{0, 1}));
+  EXPECT_EQ(GetValues<int64_t>(ws, "values0"), (vector<int64_t>{7}));
+  EXPECT_EQ(GetValues<int32_t>(ws, "lengths1"), (vector<int32_t>{2, 2}));
+  EXPECT_EQ(GetValues<int64_t>(ws, "values1"), (vector<int64_t>{1, 2, 4, 5}));
+}
+
+TEST(SparseFeaturePreprocessTest, MatchesOperatorChain) {
+  const int N = 20;
+  const int F = 6;
+  vector<int32_t> ranges;
+  vector<int32_t> values;
+  for (int i = 0; i < N; ++i) {
+    for (int f = 0; f < F; ++f) {
+      const int length = (i * 3 + f * 5) % 7;
+      ranges.push_back(values.size());
+      ranges.push_back(length);
+      for (int j = 0; j < length; ++j) {
+        values.push_back((i * 31 + f * 17 + j * 13) % 50);
+      }
+    }
+  }
+  Workspace ws;
+  AddTensor<int32_t>(&ws, "values", {TIndex(values.size())}, values);
+  AddTensor<int32_t>(&ws, "ranges", {N, F, 2}, ranges);
+
+  // Features 3 and 1 are merged after hashing, feature 5 is hashed with
+  // another seed.
+  vector<OperatorDef> chain;
+  for (int f : {1, 3, 5}) {
+    // Every feature on its own, with a ranges tensor of a single column.
+    const string name = "feature" + caffe2::to_string(f);
+    vector<int32_t> feature_ranges;
+    for (int i = 0; i < N; ++i) {
+      feature_ranges.push_back(ranges[2 * (i * F + f)]);
+      feature_ranges.push_back(ranges[2 * (i * F + f) + 1]);
+    }
+    AddTensor<int32_t>(&ws, name + "_ranges", {N, 1, 2}, feature_ranges);
+    chain.push_back(CreateOperatorDef(
+        "GatherRanges",
+        "",
+        {"values", name + "_ranges"},
+        {name + "_values", name + "_lengths"}));
+    chain.push_back(CreateOperatorDef(
+        "IndexHash",
+        "",
+        {name + "_values"},
+        {name + "_hashed"},
+        {MakeArgument<int64_t>("seed", f == 5 ? 2 : 1),
+         MakeArgument<int64_t>("modulo", 1000)}));
+  }
+  chain.push_back(CreateOperatorDef(
+      "MergeIdLists",
+      "",
+      {"feature3_lengths", "feature3_hashed", "feature1_lengths",
+       "feature1_hashed"},
+      {"merged_lengths", "merged_values"}));
+  for (const auto& def : chain) {
+    ASSERT_TRUE(ws.RunOperatorOnce(def));
+  }
+
+  for (int num_threads : {1, 4}) {
+    auto def = CreateOperatorDef(
+        "SparseFeaturePreprocess",
+        "",
+        {"values", "ranges"},
+        {"lengths0", "values0", "lengths1", "values1"},
+        {MakeArgument<vector<int>>("features", {3, 1, 5}),
+         MakeArgument<vector<int>>("group_sizes", {2, 1}),
+         MakeArgument<vector<int64_t>>("modulos", {1000, 1000}),
+         MakeArgument<vector<int64_t>>("seeds", {1, 2}),
+         MakeArgument<int>("num_threads", num_threads)});
+    ASSERT_TRUE(ws.RunOperatorOnce(def));
+    EXPECT_EQ(
+        GetValues<int32_t>(ws, "lengths1"),
+        GetValues<int32_t>(ws, "feature5_lengths"));
+    EXPECT_EQ(
+        GetValues<int32_t>(ws, "values1"),
+        GetValues<int32_t>(ws, "feature5_hashed"));
+    EXPECT_EQ(
+        GetValues<int32_t>(ws, "lengths0"),
+        GetValues<int32_t>(ws, "merged_lengths"));
+    EXPECT_EQ(
+        GetValues<int32_t>(ws, "values0"),
+        GetValues<int32_t>(ws, "merged_values"));
+  }
+}
+
+} // namespace caffe2
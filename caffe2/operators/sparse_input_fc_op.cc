@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/operators/sparse_input_fc_op.h"
+
+namespace caffe2 {
+
+void SplitSparseRows(
+    const int* lengths,
+    TIndex rows,
+    TIndex nnz,
+    TIndex num_chunks,
+    std::vector<TIndex>* row_starts,
+    std::vector<TIndex>* nnz_starts) {
+  row_starts->assign(num_chunks + 1, rows);
+  nnz_starts->assign(num_chunks + 1, nnz);
+  (*row_starts)[0] = 0;
+  (*nnz_starts)[0] = 0;
+  TIndex chunk = 1;
+  TIndex total = 0;
+  for (TIndex i = 0; i < rows; ++i) {
+    if (chunk < num_chunks && total >= chunk * nnz / num_chunks) {
+      (*row_starts)[chunk] = i;
+      (*nnz_starts)[chunk] = total;
+      ++chunk;
+    }
+    CAFFE_ENFORCE_GE(lengths[i], 0, "LENGTHS must be non-negative");
+    total += lengths[i];
+  }
+  CAFFE_ENFORCE_EQ(
+      total,
+      nnz,
+      "The sum of LENGTHS must be the size of INDICES, but it appears not.");
+}
+
+REGISTER_CPU_OPERATOR(SparseInputFC, SparseInputFCOp<CPUContext>);
+REGISTER_CPU_OPERATOR(
+    SparseInputFCGradient,
+    SparseInputFCGradientOp<CPUContext>);
+
+OPERATOR_SCHEMA(SparseInputFC)
+    .NumInputs(5)
+    .NumOutputs(1)
+    .TensorInferenceFunction([](const OperatorDef& /* unused */,
+                                const vector<TensorShape>& in) {
+      vector<TensorShape> out(1);
+      out[0] = CreateTensorShape(
+          vector<TIndex>{in[0].dims(0), in[3].dims(1)}, in[3].data_type());
+      return out;
+    })
+    .CostInferenceFunction([](const OperatorDef& /* unused */,
+                              const vector<TensorShape>& in) {
+      struct OpSchema::Cost c;
+      const uint64_t M = in[0].dims(0);
+      const uint64_t nnz = nElemFromDim(in[1]);
+      const uint64_t N = in[3].dims(1);
+      c.flops = (2 * nnz + M) * N;
+      c.bytes_read = nBytes(in[0]) + nBytes(in[1]) + nBytes(in[2]) +
+          nnz * N * sizeof(float) + nBytes(in[4]);
+      c.bytes_written = M * N * sizeof(float);
+      return c;
+    })
+    .SetDoc(R"DOC(
+Fully connected layer on a sparse input. The M x K input matrix X is given in
+CSR format by LENGTHS, INDICES and VALUES: row i of X holds LENGTHS[i]
+nonzeros, whose column indices and values are the next LENGTHS[i] entries of
+INDICES and VALUES. The output is
+
+  Y = X * W + b
+
+computed by accumulating VALUES[j] * W[INDICES[j]] for every nonzero, so that
+X never has to be densified, e.g. with SparseToDenseMask, and the cost only
+depends on the number of nonzeros. This is SparseLengthsWeightedSum followed
+by the bias.
+
+Unlike FC, W is K x N, one row per input feature, so that every nonzero reads
+a contiguous row of W. Its gradient is sparse, and is returned as a sparse
+update of the rows INDICES of W, which can be applied by the sparse
+optimizers.
+)DOC")
+    .Arg(
+        "num_threads",
+        "Number of threads the rows of X are split over, so that every thread "
+        "gets about the same number of nonzeros. Defaults to 1.")
+    .Input(0, "LENGTHS", "Vector of size M, the number of nonzeros per row")
+    .Input(
+        1,
+        "INDICES",
+        "int32 or int64 vector of the column indices of the nonzeros, in "
+        "[0, K)")
+    .Input(2, "VALUES", "Vector of the values of the nonzeros")
+    .Input(3, "W", "K x N weight matrix")
+    .Input(4, "b", "Bias vector of size N")
+    .Output(0, "Y", "M x N output matrix");
+
+OPERATOR_SCHEMA(SparseInputFCGradient)
+    .NumInputs(5)
+    .NumOutputs(2, 3)
+    .Arg("num_threads", "Same as in SparseInputFC.")
+    .Input(0, "LENGTHS", "LENGTHS of SparseInputFC")
+    .Input(1, "INDICES", "INDICES of SparseInputFC")
+    .Input(2, "VALUES", "VALUES of SparseInputFC")
+    .Input(3, "W", "W of SparseInputFC")
+    .Input(4, "dY", "Gradient of the output Y")
+    .Output(
+        0,
+        "dW_values",
+        "nnz x N values of the sparse gradient of W, whose indices are "
+        "INDICES")
+    .Output(1, "db", "Gradient of b")
+    .Output(2, "dVALUES", "Optional gradient of VALUES");
+
+namespace {
+
+class GetSparseInputFCGradient : public GradientMakerBase {
+  using GradientMakerBase::GradientMakerBase;
+  vector<OperatorDef> GetGradientDefs() override {
+    SetSparse(3, I(1), GI_V(3));
+    return SingleGradientDef(
+        "SparseInputFCGradient",
+        "",
+        vector<string>{I(0), I(1), I(2), I(3), GO(0)},
+        vector<string>{GI_V(3), GI(4), GI(2)});
+  }
+};
+
+} // namespace
+
+REGISTER_GRADIENT(SparseInputFC, GetSparseInputFCGradient);
+
+} // namespace caffe2
@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_OPERATORS_SPARSE_INPUT_FC_OP_H_
+#define CAFFE2_OPERATORS_SPARSE_INPUT_FC_OP_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/embedding_lookup.h"
+#include "caffe2/utils/math.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
+namespace caffe2 {
+
+// Splits the rows of a CSR matrix given by lengths into num_chunks contiguous
+// ranges holding about the same number of nonzeros. Returns the first row and
+// the first nonzero of every range, followed by the end of the matrix.
+// Enforces that the lengths are non-negative and sum to nnz.
+void SplitSparseRows(
+    const int* lengths,
+    TIndex rows,
+    TIndex nnz,
+    TIndex num_chunks,
+    std::vector<TIndex>* row_starts,
+    std::vector<TIndex>* nnz_starts);
+
+// Fully connected layer whose input X is a sparse matrix in CSR format, given
+// as (LENGTHS, INDICES, VALUES). Computes Y = X * W + b by gathering and
+// accumulating the rows of W picked by INDICES, so that X is never densified.
+// W is K x N, i.e. transposed with respect to the weights of FC, so that
+// every nonzero of X reads a contiguous row of W.
+template <class Context>
+class SparseInputFCOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  SparseInputFCOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    const auto& lengths = Input(LENGTHS);
+    const auto& indices = Input(INDICES);
+    const auto& values = Input(VALUES);
+    const auto& W = Input(WEIGHT);
+    const auto& b = Input(BIAS);
+    auto* Y = Output(0);
+
+    CAFFE_ENFORCE_EQ(1, lengths.ndim(), "LENGTHS must be a vector");
+    CAFFE_ENFORCE_EQ(1, indices.ndim(), "INDICES must be a vector");
+    CAFFE_ENFORCE_EQ(
+        indices.size(),
+        values.size(),
+        "VALUES must have the same size as INDICES");
+    CAFFE_ENFORCE_EQ(2, W.ndim(), "W must be a matrix");
+    const TIndex M = lengths.dim(0);
+    const TIndex K = W.dim(0);
+    const TIndex N = W.dim(1);
+    const TIndex nnz = indices.size();
+    CAFFE_ENFORCE_EQ(N, b.size(), "b must have the size of the columns of W");
+
+    Y->Resize(M, N);
+    const int* lengths_data = lengths.template data<int>();
+    const IndexType* indices_data = indices.template data<IndexType>();
+    const float* values_data = values.template data<float>();
+    const float* W_data = W.template data<float>();
+    const float* b_data = b.template data<float>();
+    float* Y_data = Y->template mutable_data<float>();
+
+    // Computes the rows [row_begin, row_end) of Y, whose nonzeros are
+    // [nnz_begin, nnz_end).
+    auto compute = [&](TIndex row_begin,
+                       TIndex row_end,
+                       TIndex nnz_begin,
+                       TIndex nnz_end) {
+      EmbeddingLookup(
+          N,
+          row_end - row_begin,
+          nnz_end - nnz_begin,
+          K,
+          W_data,
+          indices_data + nnz_begin,
+          lengths_data + row_begin,
+          values_data + nnz_begin,
+          nullptr,
+          false,
+          Y_data + row_begin * N);
+      for (TIndex i = row_begin; i < row_end; ++i) {
+        math::Add<float, Context>(
+            N, Y_data + i * N, b_data, Y_data + i * N, &context_);
+      }
+    };
+
+    const TIndex num_chunks = std::min<TIndex>(
+        std::min<TIndex>(num_threads_, M), nnz / kMinNonzerosPerChunk);
+    if (num_chunks <= 1) {
+      compute(0, M, 0, nnz);
+      return true;
+    }
+    std::vector<TIndex> row_starts;
+    std::vector<TIndex> nnz_starts;
+    SplitSparseRows(lengths_data, M, nnz, num_chunks, &row_starts, &nnz_starts);
+    ws_->GetThreadPool()->runChunks(
+        [&](int /* unused */, size_t c) {
+          compute(
+              row_starts[c],
+              row_starts[c + 1],
+              nnz_starts[c],
+              nnz_starts[c + 1]);
+        },
+        num_chunks);
+    return true;
+  }
+
+ protected:
+  // Fewer nonzeros than this per thread are not worth the dispatch overhead.
+  static constexpr TIndex kMinNonzerosPerChunk = 512;
+
+  const int num_threads_;
+  Workspace* ws_;
+
+  INPUT_TAGS(LENGTHS, INDICES, VALUES, WEIGHT, BIAS);
+};
+
+// Computes the gradients of SparseInputFC. The gradient of W is sparse: its
+// rows INDICES are VALUES[j] * dY[i] for the row i of X holding the j-th
+// nonzero, and are returned as the values of a sparse update, one row per
+// nonzero of X, to be applied with the indices INDICES.
+template <class Context>
+class SparseInputFCGradientOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  SparseInputFCGradientOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    const auto& lengths = Input(LENGTHS);
+    const auto& indices = Input(INDICES);
+    const auto& values = Input(VALUES);
+    const auto& W = Input(WEIGHT);
+    const auto& dY = Input(OUTPUT_GRAD);
+    auto* dW_values = Output(WEIGHT_GRAD_VALUES);
+    auto* db = Output(BIAS_GRAD);
+
+    const TIndex M = lengths.dim(0);
+    const TIndex K = W.dim(0);
+    const TIndex N = W.dim(1);
+    const TIndex nnz = indices.size();
+    CAFFE_ENFORCE_EQ(2, dY.ndim());
+    CAFFE_ENFORCE_EQ(M, dY.dim(0));
+    CAFFE_ENFORCE_EQ(N, dY.dim(1));
+    CAFFE_ENFORCE_EQ(nnz, values.size());
+
+    dW_values->Resize(nnz, N);
+    db->Resize(N);
+    const int* lengths_data = lengths.template data<int>();
+    const IndexType* indices_data = indices.template data<IndexType>();
+    const float* values_data = values.template data<float>();
+    const float* W_data = W.template data<float>();
+    const float* dY_data = dY.template data<float>();
+    float* dW_data = dW_values->template mutable_data<float>();
+    float* dvalues_data = nullptr;
+    if (OutputSize() > VALUES_GRAD) {
+      auto* dvalues = Output(VALUES_GRAD);
+      dvalues->ResizeLike(values);
+      dvalues_data = dvalues->template mutable_data<float>();
+    }
+
+    // The bias gradient sums dY over its rows.
+    float* db_data = db->template mutable_data<float>();
+    math::Set<float, Context>(N, 0, db_data, &context_);
+    for (TIndex i = 0; i < M; ++i) {
+      math::Add<float, Context>(
+          N, db_data, dY_data + i * N, db_data, &context_);
+    }
+
+    auto compute = [&](TIndex row_begin,
+                       TIndex row_end,
+                       TIndex nnz_begin,
+                       TIndex /* nnz_end */) {
+      TIndex j = nnz_begin;
+      for (TIndex i = row_begin; i < row_end; ++i) {
+        const float* dy = dY_data + i * N;
+        for (int l = 0; l < lengths_data[i]; ++l, ++j) {
+          math::Scale<float, Context>(
+              N, values_data[j], dy, dW_data + j * N, &context_);
+          if (dvalues_data) {
+            const IndexType idx = indices_data[j];
+            CAFFE_ENFORCE(
+                0 <= idx && idx < K,
+                "Index ",
+                j,
+                " is out of bounds: ",
+                idx,
+                ", range 0 to ",
+                K);
+            math::Dot<float, Context>(
+                N, dy, W_data + idx * N, dvalues_data + j, &context_);
+          }
+        }
+      }
+    };
+
+    const TIndex num_chunks = std::max<TIndex>(
+        1,
+        std::min<TIndex>(
+            std::min<TIndex>(num_threads_, M), nnz / kMinNonzerosPerChunk));
+    // Unlike EmbeddingLookup in the forward pass, compute does not check
+    // LENGTHS, SplitSparseRows does.
+    std::vector<TIndex> row_starts;
+    std::vector<TIndex> nnz_starts;
+    SplitSparseRows(lengths_data, M, nnz, num_chunks, &row_starts, &nnz_starts);
+    if (num_chunks == 1) {
+      compute(0, M, 0, nnz);
+      return true;
+    }
+    ws_->GetThreadPool()->runChunks(
+        [&](int /* unused */, size_t c) {
+          compute(
+              row_starts[c],
+              row_starts[c + 1],
+              nnz_starts[c],
+              nnz_starts[c + 1]);
+        },
+        num_chunks);
+    return true;
+  }
+
+ protected:
+  static constexpr TIndex kMinNonzerosPerChunk = 512;
+
+  const int num_threads_;
+  Workspace* ws_;
+
+  INPUT_TAGS(LENGTHS, INDICES, VALUES, WEIGHT, OUTPUT_GRAD);
+  OUTPUT_TAGS(WEIGHT_GRAD_VALUES, BIAS_GRAD, VALUES_GRAD);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_SPARSE_INPUT_FC_OP_H_
@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+constexpr int kRows = 2000;
+constexpr int kFeatures = 50;
+constexpr int kOutputs = 16;
+
+// Fills a sparse kRows x kFeatures input, W, b and the output gradient, and
+// returns the dense version of the input.
+vector<float> FillInputs(Workspace* ws) {
+  auto* lengths = ws->CreateBlob("lengths")->GetMutable<TensorCPU>();
+  lengths->Resize(kRows);
+  int nnz = 0;
+  for (int i = 0; i < kRows; ++i) {
+    lengths->mutable_data<int>()[i] = (i * 7) % 11;
+    nnz += (i * 7) % 11;
+  }
+  auto* indices = ws->CreateBlob("indices")->GetMutable<TensorCPU>();
+  auto* values = ws->CreateBlob("values")->GetMutable<TensorCPU>();
+  indices->Resize(nnz);
+  values->Resize(nnz);
+  vector<float> dense(kRows * kFeatures, 0);
+  for (int i = 0, j = 0; i < kRows; ++i) {
+    for (int l = 0; l < lengths->data<int>()[i]; ++l, ++j) {
+      // Repeated indices within a row add up.
+      const int idx = (i * 13 + l * 5) % kFeatures;
+      indices->mutable_data<int64_t>()[j] = idx;
+      values->mutable_data<float>()[j] = (j % 9) - 4;
+      dense[i * kFeatures + idx] += (j % 9) - 4;
+    }
+  }
+  auto* W = ws->CreateBlob("W")->GetMutable<TensorCPU>();
+  W->Resize(kFeatures, kOutputs);
+  for (int i = 0; i < W->size(); ++i) {
+    W->mutable_data<float>()[i] = (i % 7) - 3;
+  }
+  auto* b = ws->CreateBlob("b")->GetMutable<TensorCPU>();
+  b->Resize(kOutputs);
+  for (int i = 0; i < kOutputs; ++i) {
+    b->mutable_data<float>()[i] = i;
+  }
+  auto* dY = ws->CreateBlob("Y_grad")->GetMutable<TensorCPU>();
+  dY->Resize(kRows, kOutputs);
+  for (int i = 0; i < dY->size(); ++i) {
+    dY->mutable_data<float>()[i] = (i % 5) - 2;
+  }
+  return dense;
+}
+
+void CheckSparseInputFC(int num_threads) {
+  Workspace ws;
+  const auto dense = FillInputs(&ws);
+  const auto def = CreateOperatorDef(
+      "SparseInputFC",
+      "",
+      {"lengths", "indices", "values", "W", "b"},
+      {"Y"},
+      {MakeArgument("num_threads", num_threads)});
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+  vector<GradientWrapper> g_output(1);
+  g_output[0].dense_ = "Y_grad";
+  const auto meta = GetGradientForOp(def, g_output);
+  EXPECT_EQ(meta.g_input_[3].indices_, "indices");
+  for (const auto& grad_def : meta.ops_) {
+    ASSERT_TRUE(ws.RunOperatorOnce(grad_def));
+  }
+
+  const float* W = ws.GetBlob("W")->Get<TensorCPU>().data<float>();
+  const float* dY = ws.GetBlob("Y_grad")->Get<TensorCPU>().data<float>();
+  const auto& Y = ws.GetBlob("Y")->Get<TensorCPU>();
+  ASSERT_EQ(Y.dims(), vector<TIndex>({kRows, kOutputs}));
+  for (int i = 0; i < kRows; ++i) {
+    for (int n = 0; n < kOutputs; ++n) {
+      float expected = n;
+      for (int k = 0; k < kFeatures; ++k) {
+        expected += dense[i * kFeatures + k] * W[k * kOutputs + n];
+      }
+      EXPECT_EQ(expected, Y.data<float>()[i * kOutputs + n]) << i << " " << n;
+    }
+  }
+
+  const auto& db = ws.GetBlob(meta.g_input_[4].dense_)->Get<TensorCPU>();
+  for (int n = 0; n < kOutputs; ++n) {
+    float expected = 0;
+    for (int i = 0; i < kRows; ++i) {
+      expected += dY[i * kOutputs + n];
+    }
+    EXPECT_EQ(expected, db.data<float>()[n]);
+  }
+
+  const int* lengths = ws.GetBlob("lengths")->Get<TensorCPU>().data<int>();
+  const auto& indices = ws.GetBlob("indices")->Get<TensorCPU>();
+  const float* values = ws.GetBlob("values")->Get<TensorCPU>().data<float>();
+  const auto& dW = ws.GetBlob(meta.g_input_[3].values_)->Get<TensorCPU>();
+  const auto& dvalues =
+      ws.GetBlob(meta.g_input_[2].dense_)->Get<TensorCPU>();
+  ASSERT_EQ(dW.dims(), vector<TIndex>({indices.size(), kOutputs}));
+  for (int i = 0, j = 0; i < kRows; ++i) {
+    for (int l = 0; l < lengths[i]; ++l, ++j) {
+      const int64_t idx = indices.data<int64_t>()[j];
+      float expected_dvalue = 0;
+      for (int n = 0; n < kOutputs; ++n) {
+        EXPECT_EQ(
+            values[j] * dY[i * kOutputs + n],
+            dW.data<float>()[j * kOutputs + n]);
+        expected_dvalue += dY[i * kOutputs + n] * W[idx * kOutputs + n];
+      }
+      EXPECT_EQ(expected_dvalue, dvalues.data<float>()[j]);
+    }
+  }
+}
+
+} // namespace
+
+TEST(SparseInputFCTest, MatchesDenseFC) {
+  CheckSparseInputFC(1);
+}
+
+TEST(SparseInputFCTest, SplitsRowsBetweenThreads) {
+  CheckSparseInputFC(4);
+}
+
+TEST(SparseInputFCTest, RejectsWrongLengths) {
+  Workspace ws;
+  FillInputs(&ws);
+  ws.GetBlob("lengths")->GetMutable<TensorCPU>()->mutable_data<int>()[0] += 1;
+  EXPECT_THROW(
+      ws.RunOperatorOnce(CreateOperatorDef(
+          "SparseInputFCGradient",
+          "",
+          {"lengths", "indices", "values", "W", "Y_grad"},
+          {"W_grad_values", "b_grad"})),
+      EnforceNotMet);
+}
+
+} // namespace caffe2
@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+namespace {
+
+class SparseLengthsSumSortedGradientOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  SparseLengthsSumSortedGradientOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    const auto& grad = Input(GRAD);
+    const auto& lengths = Input(LENGTHS);
+    const auto& indices = Input(INDICES);
+    CAFFE_ENFORCE_EQ(lengths.ndim(), 1, "LENGTHS must be a vector");
+    CAFFE_ENFORCE_EQ(indices.ndim(), 1, "INDICES must be a vector");
+    CAFFE_ENFORCE_GE(grad.ndim(), 1);
+    CAFFE_ENFORCE_EQ(
+        grad.dim(0), lengths.dim(0), "GRAD must have one row per segment");
+
+    // (index, segment) of every position, so that sorting keeps the
+    // positions of an index in order.
+    const TIndex n = indices.size();
+    const IndexType* idx = indices.template data<IndexType>();
+    const int* len = lengths.data<int>();
+    std::vector<std::pair<IndexType, int>> order;
+    order.reserve(n);
+    for (int s = 0; s < lengths.dim(0); ++s) {
+      for (int j = 0; j < len[s]; ++j) {
+        CAFFE_ENFORCE_LT(order.size(), n, "The lengths do not match INDICES");
+        order.emplace_back(idx[order.size()], s);
+      }
+    }
+    CAFFE_ENFORCE_EQ(order.size(), n, "The lengths do not match INDICES");
+    std::sort(order.begin(), order.end());
+
+    TIndex num_unique = 0;
+    for (TIndex i = 0; i < n; ++i) {
+      num_unique += i == 0 || order[i].first != order[i - 1].first;
+    }
+    auto* unique = Output(UNIQUE_INDICES);
+    auto* rows = Output(GRAD_ROWS);
+    unique->Resize(num_unique);
+    auto shape = grad.dims();
+    shape[0] = num_unique;
+    rows->Resize(shape);
+    const TIndex block_size = grad.size_from_dim(1);
+    const float* g = grad.data<float>();
+    IndexType* u = unique->template mutable_data<IndexType>();
+    float* out = rows->mutable_data<float>();
+    std::fill(out, out + rows->size(), 0.0f);
+    TIndex k = -1;
+    for (TIndex i = 0; i < n; ++i) {
+      if (i == 0 || order[i].first != order[i - 1].first) {
+        u[++k] = order[i].first;
+      }
+      const float* src = g + order[i].second * block_size;
+      float* dst = out + k * block_size;
+      for (TIndex j = 0; j < block_size; ++j) {
+        dst[j] += src[j];
+      }
+    }
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(GRAD, LENGTHS, INDICES);
+  OUTPUT_TAGS(UNIQUE_INDICES, GRAD_ROWS);
+};
+
+REGISTER_CPU_OPERATOR(
+    SparseLengthsSumSortedGradient,
+    SparseLengthsSumSortedGradientOp);
+
+OPERATOR_SCHEMA(SparseLengthsSumSortedGradient)
+    .NumInputs(3)
+    .NumOutputs(2)
+    .SetDoc(R"DOC(
+Computes the gradient of SparseLengthsSum with respect to the rows of DATA
+that it read, as one summed row per distinct index instead of one row per
+index. UNIQUE_INDICES holds the distinct INDICES in increasing order, and the
+row of GRAD_ROWS for an index is the sum of the rows of GRAD of all the
+segments that read it, as many times as they read it. This is what
+SparseLengthsSumGradient followed by UniqueAndSum computes, up to the order of
+the indices, so a sparse optimizer can apply it with one update per row.
+
+On GPU, the indices are sorted and the rows of every run of equal indices
+are summed by a warp, without atomics, so the result is deterministic.
+)DOC")
+    .Input(0, "GRAD", "Gradient of the output of SparseLengthsSum")
+    .Input(1, "LENGTHS", "The LENGTHS of SparseLengthsSum")
+    .Input(2, "INDICES", "The int32 or int64 INDICES of SparseLengthsSum")
+    .Output(0, "UNIQUE_INDICES", "The distinct indices, in increasing order")
+    .Output(1, "GRAD_ROWS", "The gradient of the row of every index");
+
+SHOULD_NOT_DO_GRADIENT(SparseLengthsSumSortedGradient);
+
+} // namespace
+} // namespace caffe2
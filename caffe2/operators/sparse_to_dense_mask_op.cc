@@ -84,6 +84,10 @@ of size `len(lengths) X len(mask)`
     .Arg(
         "return_presence_mask",
         "bool whether to return presence mask, false by default")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the rows of a batch "
+        "are split over. Defaults to 1.")
     .Input(0, "indices", "1-D int32/int64 tensor of concatenated ids of data")
     .Input(1, "values", "Data tensor, first dimension has to match `indices`")
     .Input(
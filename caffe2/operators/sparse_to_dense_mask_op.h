@@ -18,12 +18,13 @@
 #define CAFFE2_OPERATORS_SPARSE_TO_DENSE_MASK_OP_H_
 
 #include <algorithm>
-#include <unordered_map>
+#include <atomic>
 #include <vector>
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/run_chunks.h"
 
 namespace caffe2 {
 
@@ -40,12 +41,26 @@ class SparseToDenseMaskBase : public Operator<Context> {
     CAFFE_ENFORCE(!mask.empty(), "mask can't be empty");
     auto biggest = *std::max_element(mask.begin(), mask.end());
     dense_.assign(std::min(kMaxDenseSize, biggest + 1), -1);
+    const auto num_sparse =
+        std::count_if(mask.begin(), mask.end(), [this](int64_t id) {
+          return id >= kMaxDenseSize;
+        });
+    if (num_sparse > 0) {
+      sparseShift_ = 63;
+      while ((uint64_t(1) << (64 - sparseShift_)) < 2 * num_sparse) {
+        sparseShift_--;
+      }
+      sparseIds_.assign(uint64_t(1) << (64 - sparseShift_), -1);
+      sparseIdx_.assign(sparseIds_.size(), -1);
+    }
     for (int i = 0; i < mask.size(); i++) {
       int64_t id = mask[i];
       CAFFE_ENFORCE_GE(id, 0, "Only positive IDs are allowed.");
       if (id >= kMaxDenseSize) {
-        CAFFE_ENFORCE(sparse_.count(id) == 0, "Duplicated id: ", id);
-        sparse_[id] = i;
+        size_t slot = sparseSlot(id);
+        CAFFE_ENFORCE(sparseIds_[slot] != id, "Duplicated id: ", id);
+        sparseIds_[slot] = id;
+        sparseIdx_[slot] = i;
       } else {
         CAFFE_ENFORCE(dense_[id] == -1, "Duplicated id: ", id);
         dense_[id] = i;
@@ -56,18 +71,29 @@ class SparseToDenseMaskBase : public Operator<Context> {
  protected:
   const int64_t kMaxDenseSize = 1024 * 128;
 
-  std::unordered_map<int64_t, int> sparse_;
+  // The ids of at least kMaxDenseSize are in an open addressing table of
+  // 2^(64 - sparseShift_) slots, at least twice as many as the ids, probed
+  // linearly from the top bits of a multiplicative hash of the id. Empty
+  // slots have the id -1.
+  std::vector<int64_t> sparseIds_;
+  std::vector<int> sparseIdx_;
+  int sparseShift_ = 64;
   std::vector<int> dense_;
   int featuresCount_;
 
+  // The slot of id, or the empty slot where it would be.
+  inline size_t sparseSlot(int64_t id) const {
+    const size_t mask = sparseIds_.size() - 1;
+    size_t slot = (uint64_t(id) * 0x9E3779B97F4A7C15ULL) >> sparseShift_;
+    while (sparseIds_[slot] != id && sparseIds_[slot] != -1) {
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
   inline int getFeatureIdx(int64_t id) const {
     if (id >= kMaxDenseSize) {
-      const auto& iter = sparse_.find(id);
-      if (iter == sparse_.end()) {
-        return -1;
-      } else {
-        return iter->second;
-      }
+      return sparseIds_.empty() ? -1 : sparseIdx_[sparseSlot(id)];
     } else {
       return (id >= dense_.size()) ? -1 : dense_[id];
     }
@@ -79,12 +105,16 @@ class SparseToDenseMaskOp : public SparseToDenseMaskBase<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   SparseToDenseMaskOp(const OperatorDef& operator_def, Workspace* ws)
-      : SparseToDenseMaskBase<Context>(operator_def, ws) {
+      : SparseToDenseMaskBase<Context>(operator_def, ws),
+        num_threads_(
+            OperatorBase::template GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
     returnPresenceMask_ = OperatorBase::template GetSingleArgument<bool>(
         "return_presence_mask", false);
     maxSkippedSparseIndices_ =
         OperatorBase::template GetSingleArgument<int32_t>(
             "max_skipped_indices", kMaxSkippedSparseIndices);
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
   }
 
   bool RunOnDevice() override {
@@ -143,50 +173,75 @@ class SparseToDenseMaskOp : public SparseToDenseMaskBase<Context> {
         shape.end(), default_value.dims().begin(), default_value.dims().end());
     output->Resize(shape);
 
-    // init
+    // The offset of the indices of every row, so that the rows can be
+    // split over threads.
+    vector<int64_t> offsets(rows + 1, 0);
+    for (int r = 0; r < rows; r++) {
+      CAFFE_ENFORCE_GE(lengths_vec[r], 0);
+      offsets[r + 1] = offsets[r] + lengths_vec[r];
+    }
+    CAFFE_ENFORCE_LE(offsets[rows], sparse_indices_length);
+
     // TODO: consider unrolling CopyItems to make elemental types copy faster
     char* output_data =
         static_cast<char*>(output->raw_mutable_data(sparse_values.meta()));
-    for (int i = 0; i < cols * rows; i++) {
-      context_.template CopyItems<Context, Context>(
-          default_value.meta(),
-          block_size,
-          default_val,
-          output_data + i * block_nbytes);
-    }
     bool* presence_mask_data = nullptr;
     if (returnPresenceMask_) {
       presence_mask_data = presence_mask->template mutable_data<bool>();
-      math::Set<bool, Context>(
-          rows * cols, false, presence_mask_data, &context_);
     }
 
-    int64_t offset = 0;
-    for (int r = 0; r < rows; r++) {
-      for (int c = 0; c < lengths_vec[r]; c++) {
-        const auto sparse_index = sparse_indices_vec[offset + c];
-        if (sparse_index < 0 ||
-            sparse_index >= std::numeric_limits<TInd>::max()) {
-          LOG(WARNING) << "Skipping invalid sparse index: " << sparse_index;
-          CAFFE_ENFORCE_LT(
-              ++skippedSparseIndices_,
-              maxSkippedSparseIndices_,
-              "Too many sparse indices skipped");
-          continue;
-        }
-        int idx = this->getFeatureIdx(sparse_index);
-        if (idx != -1) {
-          context_.template CopyItems<Context, Context>(
-              sparse_values.meta(),
-              block_size,
-              sparse_values_vec + (offset + c) * block_nbytes,
-              output_data + (r * cols + idx) * block_nbytes);
+    std::atomic<uint32_t> skipped(0);
+    RunChunks(
+        ws_,
+        num_threads_,
+        rows,
+        cols * block_size,
+        [&](int, TIndex row_begin, TIndex row_end) {
+          // init
+          for (TIndex i = row_begin * cols; i < row_end * cols; i++) {
+            context_.template CopyItems<Context, Context>(
+                default_value.meta(),
+                block_size,
+                default_val,
+                output_data + i * block_nbytes);
+          }
           if (returnPresenceMask_) {
-            presence_mask_data[r * cols + idx] = true;
+            std::fill(
+                presence_mask_data + row_begin * cols,
+                presence_mask_data + row_end * cols,
+                false);
           }
-        }
-      }
-      offset += lengths_vec[r];
+
+          for (TIndex r = row_begin; r < row_end; r++) {
+            for (int64_t i = offsets[r]; i < offsets[r + 1]; i++) {
+              const auto sparse_index = sparse_indices_vec[i];
+              if (sparse_index < 0 ||
+                  sparse_index >= std::numeric_limits<TInd>::max()) {
+                LOG(WARNING) << "Skipping invalid sparse index: "
+                             << sparse_index;
+                skipped++;
+                continue;
+              }
+              int idx = this->getFeatureIdx(sparse_index);
+              if (idx != -1) {
+                context_.template CopyItems<Context, Context>(
+                    sparse_values.meta(),
+                    block_size,
+                    sparse_values_vec + i * block_nbytes,
+                    output_data + (r * cols + idx) * block_nbytes);
+                if (returnPresenceMask_) {
+                  presence_mask_data[r * cols + idx] = true;
+                }
+              }
+            }
+          }
+        });
+    if (skipped > 0) {
+      skippedSparseIndices_ += skipped;
+      CAFFE_ENFORCE_LT(
+          skippedSparseIndices_,
+          maxSkippedSparseIndices_,
+          "Too many sparse indices skipped");
     }
 
     return true;
@@ -195,6 +250,9 @@ class SparseToDenseMaskOp : public SparseToDenseMaskBase<Context> {
  private:
   static const uint32_t kMaxSkippedSparseIndices = 5;
 
+  int num_threads_;
+  Workspace* ws_;
+
   bool returnPresenceMask_;
   uint32_t maxSkippedSparseIndices_ = 0;
   uint32_t skippedSparseIndices_ = 0;
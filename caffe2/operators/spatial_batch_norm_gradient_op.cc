@@ -57,57 +57,119 @@ bool SpatialBNGradientOp<CPUContext>::RunOnDevice() {
   // dScale = np.sum((X - mean) / inv_std * dy, axis=0)
   // dX = (1. / N) * scale * inv_var * (N * dY - np.sum(dY, axis=0) - (X - mean)
   //   * inv_var * inv_var * np.sum(dY * (X - mean), axis=0))
+  //
+  // Once the two sums are known, dX is an affine function of dY and X per
+  // channel, dX = dY_coeff * dY + X_coeff * X + bias_coeff, which is computed
+  // in a single pass.
 
   EigenVectorArrayMap<float> dBias_arr(dBias->mutable_data<float>(), C);
   EigenVectorArrayMap<float> dScale_arr(dScale->mutable_data<float>(), C);
-
-  dBias_arr.setZero();
-  dScale_arr.setZero();
-
-  const auto scaleInvVarNHW = scale_arr * inv_var_arr / (N * sample_size);
+  const float* Xdata = X.data<float>();
+  const float* dYdata = dY.data<float>();
+  float* dXdata = dX->mutable_data<float>();
+  const TIndex NHW = static_cast<TIndex>(N) * sample_size;
+
+  Eigen::Array<float, Eigen::Dynamic, 1> dY_coeff(C);
+  Eigen::Array<float, Eigen::Dynamic, 1> X_coeff(C);
+  Eigen::Array<float, Eigen::Dynamic, 1> bias_coeff(C);
+  auto compute_coeffs = [&](int c_begin, int c_end) {
+    for (int c = c_begin; c < c_end; ++c) {
+      dY_coeff(c) = scale_arr(c) * inv_var_arr(c);
+      X_coeff(c) =
+          -dY_coeff(c) * inv_var_arr(c) * dScale_arr(c) / NHW;
+      bias_coeff(c) =
+          -dY_coeff(c) * dBias_arr(c) / NHW - X_coeff(c) * mean_arr(c);
+    }
+  };
 
   switch (order_) {
     case StorageOrder::NCHW: {
-      ConstEigenArrayMap<float> X_arr(X.data<float>(), sample_size, N * C);
-      ConstEigenArrayMap<float> dY_arr(dY.data<float>(), sample_size, N * C);
-      EigenArrayMap<float> dX_arr(
-          dX->mutable_data<float>(), sample_size, N * C);
-      dX_arr.setZero();
-
-      for (int nc = 0; nc < N * C; ++nc) {
-        int c = nc % C;
-        dBias_arr(c) += dY_arr.col(nc).sum();
-        dScale_arr(c) +=
-            ((X_arr.col(nc) - mean_arr(c)) * inv_var_arr(c) * dY_arr.col(nc))
-                .sum();
-      }
-      for (int nc = 0; nc < N * C; ++nc) {
-        int c = nc % C;
-        dX_arr.col(nc) += scaleInvVarNHW(c) *
-            (dY_arr.col(nc) * N * sample_size - dBias_arr(c) -
-             (X_arr.col(nc) - mean_arr[c]) * dScale_arr(c) * inv_var_arr(c));
-      }
+      // Every chunk owns some channels, so it can finish their sums and go
+      // on with their part of dX.
+      RunChunks(
+          ws_,
+          num_threads_,
+          C,
+          NHW,
+          [&](int /* unused */, TIndex begin, TIndex end) {
+            for (TIndex c = begin; c < end; ++c) {
+              float dbias = 0;
+              float dscale = 0;
+              for (int n = 0; n < N; ++n) {
+                const TIndex offset = (n * C + c) * sample_size;
+                ConstEigenVectorArrayMap<float> X_plane(
+                    Xdata + offset, sample_size);
+                ConstEigenVectorArrayMap<float> dY_plane(
+                    dYdata + offset, sample_size);
+                dbias += dY_plane.sum();
+                dscale += ((X_plane - mean_arr(c)) * dY_plane).sum();
+              }
+              dBias_arr(c) = dbias;
+              dScale_arr(c) = dscale * inv_var_arr(c);
+            }
+            compute_coeffs(begin, end);
+            for (TIndex c = begin; c < end; ++c) {
+              for (int n = 0; n < N; ++n) {
+                const TIndex offset = (n * C + c) * sample_size;
+                EigenVectorArrayMap<float>(dXdata + offset, sample_size) =
+                    ConstEigenVectorArrayMap<float>(
+                        dYdata + offset, sample_size) *
+                        dY_coeff(c) +
+                    ConstEigenVectorArrayMap<float>(
+                        Xdata + offset, sample_size) *
+                        X_coeff(c) +
+                    bias_coeff(c);
+              }
+            }
+          });
       break;
     }
     case StorageOrder::NHWC: {
-      ConstEigenArrayMap<float> X_arr(X.data<float>(), C, N * sample_size);
-      ConstEigenArrayMap<float> dY_arr(dY.data<float>(), C, N * sample_size);
-      EigenArrayMap<float> dX_arr(
-          dX->mutable_data<float>(), C, N * sample_size);
-      dX_arr.setZero();
-
-      const auto dYRowSum = dY_arr.rowwise().sum();
-      const auto XMinusMean = X_arr.colwise() - mean_arr;
-      const auto dYMulXMinusMeanRowSum = (dY_arr * XMinusMean).rowwise().sum();
-      const auto invVarSqr = inv_var_arr * inv_var_arr;
-      for (int nhw = 0; nhw < N * sample_size; ++nhw) {
-        dBias_arr += dY_arr.col(nhw);
-        dScale_arr +=
-            (X_arr.col(nhw) - mean_arr) * inv_var_arr * dY_arr.col(nhw);
-        dX_arr.col(nhw) += scaleInvVarNHW *
-            (dY_arr.col(nhw) * N * sample_size - dYRowSum -
-             XMinusMean.col(nhw) * invVarSqr * dYMulXMinusMeanRowSum);
-      }
+      // The chunks sum over their own rows first, then the partial sums are
+      // added up, and dX is computed over the same rows.
+      const int max_chunks = std::min<TIndex>(num_threads_, NHW);
+      Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> chunk_dbias(
+          C, max_chunks);
+      Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> chunk_dscale(
+          C, max_chunks);
+      chunk_dbias.setZero();
+      chunk_dscale.setZero();
+      RunChunks(
+          ws_,
+          max_chunks,
+          NHW,
+          C,
+          [&](int chunk, TIndex begin, TIndex end) {
+            ConstEigenArrayMap<float> X_rows(
+                Xdata + begin * C, C, end - begin);
+            ConstEigenArrayMap<float> dY_rows(
+                dYdata + begin * C, C, end - begin);
+            auto dbias = chunk_dbias.col(chunk);
+            auto dscale = chunk_dscale.col(chunk);
+            for (TIndex i = 0; i < end - begin; ++i) {
+              dbias += dY_rows.col(i);
+              dscale += (X_rows.col(i) - mean_arr) * dY_rows.col(i);
+            }
+          });
+      dBias_arr = chunk_dbias.rowwise().sum();
+      dScale_arr = chunk_dscale.rowwise().sum() * inv_var_arr;
+      compute_coeffs(0, C);
+      RunChunks(
+          ws_,
+          num_threads_,
+          NHW,
+          C,
+          [&](int /* unused */, TIndex begin, TIndex end) {
+            EigenArrayMap<float>(dXdata + begin * C, C, end - begin) =
+                ((ConstEigenArrayMap<float>(dYdata + begin * C, C, end - begin)
+                      .colwise() *
+                  dY_coeff) +
+                 (ConstEigenArrayMap<float>(Xdata + begin * C, C, end - begin)
+                      .colwise() *
+                  X_coeff))
+                    .colwise() +
+                bias_coeff;
+          });
       break;
     }
     default:
@@ -18,6 +18,107 @@
 
 namespace caffe2 {
 
+template <>
+void SpatialBNOp<CPUContext>::ComputeMoments(
+    const int N,
+    const int C,
+    const int sample_size,
+    const float* X,
+    float* mean,
+    float* var) {
+  // The moments of the parts of the input are merged with the pairwise
+  // update of Chan et al.: for counts na and nb, and delta = mean_b - mean_a,
+  //   mean = mean_a + delta * nb / (na + nb)
+  //   m2 = m2_a + m2_b + delta^2 * na * nb / (na + nb)
+  // where m2 is the sum of the squared deviations from the mean.
+  switch (order_) {
+    case StorageOrder::NCHW: {
+      // Every chunk owns some channels, and merges the moments of their
+      // N contiguous planes, each computed in two passes while it is in
+      // cache.
+      RunChunks(
+          ws_,
+          num_threads_,
+          C,
+          N * sample_size,
+          [&](int /* unused */, TIndex begin, TIndex end) {
+            for (TIndex c = begin; c < end; ++c) {
+              double count = 0;
+              float channel_mean = 0;
+              float channel_m2 = 0;
+              for (int n = 0; n < N; ++n) {
+                ConstEigenVectorArrayMap<float> plane(
+                    X + (n * C + c) * sample_size, sample_size);
+                const float plane_mean = plane.sum() / sample_size;
+                const float plane_m2 = (plane - plane_mean).square().sum();
+                const float delta = plane_mean - channel_mean;
+                const double total = count + sample_size;
+                channel_mean += delta * (sample_size / total);
+                channel_m2 +=
+                    plane_m2 + delta * delta * (count * sample_size / total);
+                count = total;
+              }
+              mean[c] = channel_mean;
+              var[c] = channel_m2 / count;
+            }
+          });
+      break;
+    }
+    case StorageOrder::NHWC: {
+      // Every chunk runs Welford's algorithm over some rows of C channels,
+      // a whole row at a time, and the chunks are merged at the end.
+      const TIndex num_rows = static_cast<TIndex>(N) * sample_size;
+      const int max_chunks = std::min<TIndex>(num_threads_, num_rows);
+      Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> chunk_mean(
+          C, max_chunks);
+      Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> chunk_m2(
+          C, max_chunks);
+      vector<TIndex> chunk_count(max_chunks, 0);
+      chunk_mean.setZero();
+      chunk_m2.setZero();
+      RunChunks(
+          ws_,
+          max_chunks,
+          num_rows,
+          C,
+          [&](int chunk, TIndex begin, TIndex end) {
+            auto running_mean = chunk_mean.col(chunk);
+            auto running_m2 = chunk_m2.col(chunk);
+            Eigen::Array<float, Eigen::Dynamic, 1> delta(C);
+            for (TIndex i = begin; i < end; ++i) {
+              ConstEigenVectorArrayMap<float> row(X + i * C, C);
+              delta = row - running_mean;
+              running_mean += delta / static_cast<float>(i - begin + 1);
+              running_m2 += delta * (row - running_mean);
+            }
+            chunk_count[chunk] = end - begin;
+          });
+      EigenVectorArrayMap<float> mean_arr(mean, C);
+      EigenVectorArrayMap<float> m2_arr(var, C);
+      Eigen::Array<float, Eigen::Dynamic, 1> delta(C);
+      mean_arr.setZero();
+      m2_arr.setZero();
+      double count = 0;
+      for (int chunk = 0; chunk < max_chunks; ++chunk) {
+        if (chunk_count[chunk] == 0) {
+          continue;
+        }
+        const double total = count + chunk_count[chunk];
+        delta = chunk_mean.col(chunk) - mean_arr;
+        mean_arr += delta * static_cast<float>(chunk_count[chunk] / total);
+        m2_arr += chunk_m2.col(chunk) +
+            delta.square() *
+                static_cast<float>(count * chunk_count[chunk] / total);
+        count = total;
+      }
+      m2_arr /= static_cast<float>(count);
+      break;
+    }
+    default:
+      CAFFE_THROW("Unknown storage order: ", order_);
+  }
+}
+
 template <>
 bool SpatialBNOp<CPUContext>::RunOnDevice() {
   const auto& X = Input(INPUT);
@@ -47,6 +148,8 @@ bool SpatialBNOp<CPUContext>::RunOnDevice() {
 
   auto* Y = Output(OUTPUT);
   Y->ResizeLike(X);
+  const float* Xdata = X.data<float>();
+  float* Ydata = Y->mutable_data<float>();
 
   if (!is_test_) {
     // training mode
@@ -61,37 +164,7 @@ bool SpatialBNOp<CPUContext>::RunOnDevice() {
         Output(SAVED_MEAN)->mutable_data<float>(), C);
     EigenVectorArrayMap<float> var(
         Output(SAVED_INV_VAR)->mutable_data<float>(), C);
-
-    mean.setZero();
-    var.setZero();
-    switch (order_) {
-      case StorageOrder::NCHW: {
-        ConstEigenArrayMap<float> X_arr(X.data<float>(), sample_size, N * C);
-        for (int nc = 0; nc < N * C; ++nc) {
-          mean(nc % C) += X_arr.col(nc).sum();
-        }
-        mean /= N * sample_size;
-        for (int nc = 0; nc < N * C; ++nc) {
-          var(nc % C) += (X_arr.col(nc) - mean(nc % C)).matrix().squaredNorm();
-        }
-        var /= N * sample_size;
-        break;
-      }
-      case StorageOrder::NHWC: {
-        ConstEigenArrayMap<float> X_arr(X.data<float>(), C, N * sample_size);
-        for (int i = 0; i < N * sample_size; ++i) {
-          mean += X_arr.col(i);
-        }
-        mean /= N * sample_size;
-        for (int i = 0; i < N * sample_size; ++i) {
-          var += (X_arr.col(i) - mean) * (X_arr.col(i) - mean);
-        }
-        var /= N * sample_size;
-        break;
-      }
-      default:
-        CAFFE_THROW("Unknown storage order: ", order_);
-    }
+    ComputeMoments(N, C, sample_size, Xdata, mean.data(), var.data());
 
     // Compute the running mean and running inv variance.
     auto* running_mean = Output(RUNNING_MEAN);
@@ -144,20 +217,37 @@ bool SpatialBNOp<CPUContext>::RunOnDevice() {
       bias_arr - mean_arr * inv_std * scale_arr;
   switch (order_) {
     case StorageOrder::NHWC: {
-      EigenArrayMap<float>(Y->mutable_data<float>(), C, N * sample_size) =
-          (ConstEigenArrayMap<float>(X.data<float>(), C, N * sample_size)
-               .colwise() *
-           new_scale)
-              .colwise() +
-          new_bias;
+      RunChunks(
+          ws_,
+          num_threads_,
+          N * sample_size,
+          C,
+          [&](int /* unused */, TIndex begin, TIndex end) {
+            EigenArrayMap<float>(Ydata + begin * C, C, end - begin) =
+                (ConstEigenArrayMap<float>(Xdata + begin * C, C, end - begin)
+                     .colwise() *
+                 new_scale)
+                    .colwise() +
+                new_bias;
+          });
       break;
     }
     case StorageOrder::NCHW: {
-      EigenArrayMap<float> Y_arr(Y->mutable_data<float>(), sample_size, N * C);
-      ConstEigenArrayMap<float> X_arr(X.data<float>(), sample_size, N * C);
-      for (int nc = 0; nc < N * C; ++nc) {
-        Y_arr.col(nc) = X_arr.col(nc) * new_scale(nc % C) + new_bias(nc % C);
-      }
+      RunChunks(
+          ws_,
+          num_threads_,
+          N * C,
+          sample_size,
+          [&](int /* unused */, TIndex begin, TIndex end) {
+            for (TIndex nc = begin; nc < end; ++nc) {
+              EigenVectorArrayMap<float>(
+                  Ydata + nc * sample_size, sample_size) =
+                  ConstEigenVectorArrayMap<float>(
+                      Xdata + nc * sample_size, sample_size) *
+                      new_scale(nc % C) +
+                  new_bias(nc % C);
+            }
+          });
       break;
     }
     default:
@@ -213,6 +303,10 @@ Output case #2: Y (test mode)
         "If set to nonzero, run spatial batch normalization in test mode.")
     .Arg("epsilon", "The epsilon value to use to avoid division by zero.")
     .Arg("order", "A StorageOrder string.")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool to spread the "
+        "statistics and the normalization over, default 1.")
     .Arg(
         "momentum",
         "Factor used in computing the running mean and variance."
@@ -20,6 +20,7 @@
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/run_chunks.h"
 
 namespace caffe2 {
 
@@ -33,10 +34,13 @@ class SpatialBNOp : public Operator<Context> {
         epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5)),
         momentum_(OperatorBase::GetSingleArgument<float>("momentum", 0.9)),
         order_(StringToStorageOrder(
-            OperatorBase::GetSingleArgument<string>("order", "NCHW"))) {
+            OperatorBase::GetSingleArgument<string>("order", "NCHW"))),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
     // TODO(jiayq): update the input and output size checks.
     CAFFE_ENFORCE(
         (is_test_ && OutputSize() == 1) || (!is_test_ && OutputSize() == 5));
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
     CAFFE_ENFORCE_GT(epsilon_, 0);
     CAFFE_ENFORCE_GE(momentum_, 0);
     CAFFE_ENFORCE_LE(momentum_, 1);
@@ -52,6 +56,19 @@ class SpatialBNOp : public Operator<Context> {
   double epsilon_;
   double momentum_;
   StorageOrder order_;
+  const int num_threads_;
+  Workspace* ws_;
+
+  // Per-channel mean and biased variance of X, an N x C x sample_size
+  // tensor in order_.
+  void ComputeMoments(
+      const int N,
+      const int C,
+      const int sample_size,
+      const float* X,
+      float* mean,
+      float* var);
+
   INPUT_TAGS(INPUT, SCALE, BIAS, EST_MEAN, EST_VAR);
   OUTPUT_TAGS(OUTPUT, RUNNING_MEAN, RUNNING_VAR, SAVED_MEAN, SAVED_INV_VAR);
 };
@@ -65,9 +82,12 @@ class SpatialBNGradientOp : public Operator<Context> {
         is_test_(OperatorBase::GetSingleArgument<int>(OpSchema::Arg_IsTest, 0)),
         epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5)),
         order_(StringToStorageOrder(
-            OperatorBase::GetSingleArgument<string>("order", "NCHW"))) {
+            OperatorBase::GetSingleArgument<string>("order", "NCHW"))),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
     CAFFE_ENFORCE(InputSize() == 5);
     CAFFE_ENFORCE(OutputSize() == 3);
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
   }
   ~SpatialBNGradientOp() {}
 
@@ -79,6 +99,8 @@ class SpatialBNGradientOp : public Operator<Context> {
   bool is_test_;
   double epsilon_;
   StorageOrder order_;
+  const int num_threads_;
+  Workspace* ws_;
 
   INPUT_TAGS(INPUT, SCALE, OUTPUT_GRAD, SAVED_MEAN, SAVED_INV_VAR);
   OUTPUT_TAGS(INPUT_GRAD, SCALE_GRAD, BIAS_GRAD);
@@ -15,10 +15,12 @@
  */
 
 #include <chrono>
+#include <unordered_set>
 #include <vector>
 #include "caffe2/core/operator.h"
 #include "caffe2/core/stats.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/core/workspace.h"
 
 namespace caffe2 {
 
@@ -198,6 +200,68 @@ struct CpuUtilizationReportOp : public Operator<CPUContext> {
   } stat_;
 };
 
+class WorkspaceMemoryExportOp : public Operator<CPUContext> {
+ public:
+  WorkspaceMemoryExportOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator(operator_def, ws),
+        prefix_(GetSingleArgument<std::string>("prefix", "workspace_memory")),
+        top_k_(GetSingleArgument<int>("top_k", 0)),
+        every_n_(GetSingleArgument<int>("every_n", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(top_k_, 0);
+    CAFFE_ENFORCE_GE(every_n_, 1);
+  }
+
+  bool RunOnDevice() override {
+    if (runs_++ % every_n_ != 0) {
+      return true;
+    }
+    auto registry = InputSize() > 0
+        ? OperatorBase::Input<std::unique_ptr<StatRegistry>>(0).get()
+        : &StatRegistry::get();
+    const auto report = ws_->MemoryReport();
+    ExportedStatList data;
+    auto add = [&](const std::string& key, size_t value) {
+      data.push_back({prefix_ + "/" + key,
+                      static_cast<int64_t>(value),
+                      std::chrono::high_resolution_clock::now()});
+    };
+    for (const auto& device : report.devices) {
+      const auto& totals = device.second;
+      add(device.first + "/used_bytes", totals.used_bytes);
+      add(device.first + "/capacity_bytes", totals.capacity_bytes);
+      add(device.first + "/exclusive_bytes", totals.exclusive_bytes);
+      add(device.first + "/num_blobs", totals.num_blobs);
+    }
+    // The largest blobs; those exported before but no longer among them are
+    // set to zero.
+    std::unordered_set<std::string> exported;
+    for (int i = 0; i < top_k_ && i < report.blobs.size(); ++i) {
+      const auto& blob = report.blobs[i];
+      add("blob/" + blob.name + "/used_bytes", blob.used_bytes);
+      add("blob/" + blob.name + "/capacity_bytes", blob.capacity_bytes);
+      exported.insert(blob.name);
+    }
+    for (const auto& name : exported_blobs_) {
+      if (!exported.count(name)) {
+        add("blob/" + name + "/used_bytes", 0);
+        add("blob/" + name + "/capacity_bytes", 0);
+      }
+    }
+    exported_blobs_ = std::move(exported);
+    registry->update(data);
+    return true;
+  }
+
+ private:
+  std::string prefix_;
+  int top_k_;
+  int every_n_;
+  Workspace* ws_;
+  int64_t runs_{0};
+  std::unordered_set<std::string> exported_blobs_;
+};
+
 REGISTER_CPU_OPERATOR(StatRegistryCreate, StatRegistryCreateOp);
 REGISTER_CPU_OPERATOR(StatRegistryUpdate, StatRegistryUpdateOp);
 REGISTER_CPU_OPERATOR(StatRegistryExport, StatRegistryExportOp);
@@ -206,6 +270,7 @@ REGISTER_CPU_OPERATOR(TimerBegin, TimerBeginOp);
 REGISTER_CPU_OPERATOR(TimerEnd, TimerEndOp);
 REGISTER_CPU_OPERATOR(TimerGetAndEnd, TimerGetAndEndOp);
 REGISTER_CPU_OPERATOR(CpuUtilizationReport, CpuUtilizationReportOp);
+REGISTER_CPU_OPERATOR(WorkspaceMemoryExport, WorkspaceMemoryExportOp);
 
 OPERATOR_SCHEMA(StatRegistryCreate)
     .NumInputs(0)
@@ -281,6 +346,28 @@ OPERATOR_SCHEMA(CpuUtilizationReport)
         "Delta in max CPU utilization observed, in percentage as a float value")
     .Arg("stats_name", "String name of the stat entry holding CPU utilization");
 
+OPERATOR_SCHEMA(WorkspaceMemoryExport)
+    .NumInputs(0, 1)
+    .NumOutputs(0)
+    .SetDoc(R"DOC(
+Sets counters of the given StatRegistry, or of the global StatRegistry, to the
+memory held by the blobs of the workspace the operator runs in. For every
+device ("cpu", "cuda:<gpu id>") it sets <prefix>/<device>/used_bytes,
+capacity_bytes, exclusive_bytes (the capacity of the blobs that do not share
+their memory) and num_blobs. For the top_k blobs of largest capacity it sets
+<prefix>/blob/<name>/used_bytes and capacity_bytes, so that tensors reserved
+far above their use stand out. Running it in a periodically run net tracks the
+memory of a long-running service.
+)DOC")
+    .Arg("prefix", "(default \"workspace_memory\") Prefix of the counters.")
+    .Arg("top_k", "(default 0) Number of blobs to export counters of.")
+    .Arg("every_n", "(default 1) Export on one run out of every_n.")
+    .Input(
+        0,
+        "handle",
+        "If provided, update the given StatRegistry. "
+        "Otherwise, update the global singleton.");
+
 CAFFE_KNOWN_TYPE(TimerInstance*);
 CAFFE_KNOWN_TYPE(std::unique_ptr<caffe2::StatRegistry>);
 } // namespace caffe2
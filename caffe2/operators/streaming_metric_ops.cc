@@ -0,0 +1,365 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/streaming_metric_ops.h"
+
+#include "caffe2/utils/run_chunks.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Sets the state to zero the first time, or when its shape changes, as
+// Accumulate does.
+float* InitializeState(const vector<TIndex>& dims, TensorCPU* state) {
+  if (state->dims() != dims) {
+    state->Resize(dims);
+    std::fill(
+        state->mutable_data<float>(),
+        state->mutable_data<float>() + state->size(),
+        0.f);
+  }
+  return state->mutable_data<float>();
+}
+
+} // namespace
+
+bool ScoreHistogramOp::RunOnDevice() {
+  const auto& X = Input(PREDICTION);
+  const auto& label = Input(LABEL);
+  CAFFE_ENFORCE_EQ(X.ndim(), 2);
+  CAFFE_ENFORCE(
+      label.dims() == X.dims(), "Labels must have the shape of predictions");
+  const int N = X.dim32(0);
+  const int D = X.dim32(1);
+  const int B = num_buckets_;
+  float* hist = InitializeState({D, 2, B}, Output(0));
+
+  const float* Xdata = X.data<float>();
+  const int* labelData = label.data<int>();
+  const float scale = B / (max_score_ - min_score_);
+  // Scores out of range, and NaN, go to the end buckets.
+  auto offset = [&](int i, int d) {
+    const float b = std::max(0.f, (Xdata[i * D + d] - min_score_) * scale);
+    return (d * 2 + (labelData[i * D + d] != 0)) * B +
+        static_cast<int>(std::min<float>(b, B - 1));
+  };
+  const int num_chunks = NumChunks(num_threads_, N, D);
+  if (D >= num_chunks) {
+    // Every chunk owns the histograms of its classes.
+    RunChunks(ws_, num_chunks, D, [&](int, TIndex begin, TIndex end) {
+      for (int i = 0; i < N; ++i) {
+        for (int d = begin; d < end; ++d) {
+          hist[offset(i, d)] += 1;
+        }
+      }
+    });
+    return true;
+  }
+  // Few classes: the chunks count rows in histograms of their own.
+  const TIndex hist_size = static_cast<TIndex>(D) * 2 * B;
+  vector<float> partial(hist_size * num_chunks, 0);
+  RunChunks(ws_, num_chunks, N, [&](int chunk, TIndex begin, TIndex end) {
+    float* chunk_hist = partial.data() + chunk * hist_size;
+    for (int i = begin; i < end; ++i) {
+      for (int d = 0; d < D; ++d) {
+        chunk_hist[offset(i, d)] += 1;
+      }
+    }
+  });
+  for (int chunk = 0; chunk < num_chunks; ++chunk) {
+    math::Add<float, CPUContext>(
+        hist_size, hist, partial.data() + chunk * hist_size, hist, &context_);
+  }
+  return true;
+}
+
+bool HistogramAPOp::RunOnDevice() {
+  const auto& H = Input(0);
+  CAFFE_ENFORCE_EQ(H.ndim(), 3);
+  CAFFE_ENFORCE_EQ(H.dim32(1), 2);
+  const int D = H.dim32(0);
+  const int B = H.dim32(2);
+  auto* AP = Output(0);
+  AP->Resize(D);
+  float* APdata = AP->mutable_data<float>();
+  float* AUCdata = nullptr;
+  if (OutputSize() > 1) {
+    Output(1)->Resize(D);
+    AUCdata = Output(1)->mutable_data<float>();
+  }
+
+  for (int d = 0; d < D; ++d) {
+    const float* negatives = H.data<float>() + d * 2 * B;
+    const float* positives = negatives + B;
+    // The scores of a bucket are tied: its positives all get the precision
+    // at the end of the bucket, and count half against its negatives.
+    double tp = 0;
+    double fp = 0;
+    double precision_sum = 0;
+    double auc_sum = 0;
+    for (int b = B - 1; b >= 0; --b) {
+      const double p = positives[b];
+      const double n = negatives[b];
+      if (p == 0 && n == 0) {
+        continue;
+      }
+      auc_sum += n * (tp + 0.5 * p);
+      tp += p;
+      fp += n;
+      precision_sum += p * tp / (tp + fp);
+    }
+    APdata[d] = tp > 0 ? precision_sum / tp : 0;
+    if (AUCdata) {
+      AUCdata[d] = tp > 0 && fp > 0 ? auc_sum / (tp * fp) : 0;
+    }
+  }
+  return true;
+}
+
+QuantileSketchLayout::QuantileSketchLayout(const OperatorBase& op) {
+  const float relative_accuracy =
+      op.GetSingleArgument<float>("relative_accuracy", 0.01);
+  min_magnitude_ = op.GetSingleArgument<float>("min_magnitude", 1e-9);
+  const float max_magnitude =
+      op.GetSingleArgument<float>("max_magnitude", 1e9);
+  CAFFE_ENFORCE(
+      relative_accuracy > 0 && relative_accuracy < 1,
+      "relative_accuracy must be in (0, 1)");
+  CAFFE_ENFORCE_GT(min_magnitude_, 0);
+  CAFFE_ENFORCE_LT(min_magnitude_, max_magnitude);
+  gamma_ = (1 + relative_accuracy) / (1 - relative_accuracy);
+  inv_log_gamma_ = 1 / std::log(gamma_);
+  num_buckets_ =
+      std::ceil(std::log(max_magnitude / min_magnitude_) * inv_log_gamma_) +
+      1;
+}
+
+bool QuantileSketchOp::RunOnDevice() {
+  const auto& X = Input(0);
+  const TIndex N = X.size();
+  const int size = layout_.size();
+  float* sketch = InitializeState({size}, Output(0));
+  const float* Xdata = X.data<float>();
+
+  // The counts of a batch are exact; only the state is float.
+  const int num_chunks = NumChunks(num_threads_, N, 1);
+  vector<int64_t> counts(size * num_chunks, 0);
+  vector<double> sums(2 * num_chunks, 0);
+  RunChunks(ws_, num_chunks, N, [&](int chunk, TIndex begin, TIndex end) {
+    int64_t* chunk_counts = counts.data() + chunk * size;
+    double sum = 0;
+    double sum_squares = 0;
+    for (TIndex i = begin; i < end; ++i) {
+      const float x = Xdata[i];
+      ++chunk_counts[layout_.Offset(x)];
+      sum += x;
+      sum_squares += static_cast<double>(x) * x;
+    }
+    sums[2 * chunk] = sum;
+    sums[2 * chunk + 1] = sum_squares;
+  });
+  for (int chunk = 1; chunk < num_chunks; ++chunk) {
+    for (int k = 0; k < size; ++k) {
+      counts[k] += counts[chunk * size + k];
+    }
+    sums[0] += sums[2 * chunk];
+    sums[1] += sums[2 * chunk + 1];
+  }
+  sketch[QuantileSketchLayout::COUNT] += N;
+  sketch[QuantileSketchLayout::SUM] += sums[0];
+  sketch[QuantileSketchLayout::SUM_SQUARES] += sums[1];
+  for (int k = QuantileSketchLayout::ZERO; k < size; ++k) {
+    sketch[k] += counts[k];
+  }
+  return true;
+}
+
+bool SummarizeSketchOp::RunOnDevice() {
+  const auto& S = Input(0);
+  CAFFE_ENFORCE_EQ(
+      S.size(),
+      layout_.size(),
+      "The sketch was made with other arguments than these.");
+  const float* sketch = S.data<float>();
+  const double count = sketch[QuantileSketchLayout::COUNT];
+  CAFFE_ENFORCE_GT(count, 0, "The sketch is empty.");
+
+  // Value of the first bucket, in increasing order of values, up to which
+  // there are more than rank values.
+  const int num_ordered = 2 * layout_.num_buckets() + 1;
+  auto find = [&](double rank) {
+    double seen = 0;
+    int offset = QuantileSketchLayout::ZERO;
+    for (int k = 0; k < num_ordered; ++k) {
+      offset = layout_.OrderedOffset(k);
+      seen += sketch[offset];
+      if (seen > rank) {
+        break;
+      }
+    }
+    return layout_.Value(offset);
+  };
+
+  auto* Y = Output(0);
+  Y->Resize(NUM_STATS);
+  float* Ydata = Y->mutable_data<float>();
+  const double sum = sketch[QuantileSketchLayout::SUM];
+  const double variance = count > 1
+      ? (sketch[QuantileSketchLayout::SUM_SQUARES] - sum * sum / count) /
+          (count - 1)
+      : 0;
+  Ydata[MIN_IDX] = find(0);
+  Ydata[MAX_IDX] = find(count - 1);
+  Ydata[MEAN_IDX] = sum / count;
+  Ydata[STD_IDX] = std::sqrt(std::max(variance, 0.));
+  if (OutputSize() > 1) {
+    auto* Q = Output(1);
+    Q->Resize(quantiles_.size());
+    float* Qdata = Q->mutable_data<float>();
+    for (int i = 0; i < quantiles_.size(); ++i) {
+      Qdata[i] = find(std::floor(quantiles_[i] * (count - 1)));
+    }
+  }
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(ScoreHistogram, ScoreHistogramOp);
+REGISTER_CPU_OPERATOR(HistogramAP, HistogramAPOp);
+REGISTER_CPU_OPERATOR(QuantileSketch, QuantileSketchOp);
+REGISTER_CPU_OPERATOR(SummarizeSketch, SummarizeSketchOp);
+
+OPERATOR_SCHEMA(ScoreHistogram)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Accumulates prediction scores into per-class histograms of the scores of the
+positive and of the negative examples, from which HistogramAP computes the
+average precision and the AUC. Unlike APMeter, the memory does not depend on
+the number of examples, and histograms of different threads or nodes are
+merged by summing them, e.g. with Sum or Allreduce.
+
+The output is set to zero when it does not have the shape (num_classes, 2,
+num_buckets), and accumulated into otherwise. Scores are bucketed uniformly
+in [min_score, max_score]; scores out of the range go to the end buckets.
+)DOC")
+    .Arg("num_buckets", "(int, default 1000) Buckets per histogram.")
+    .Arg("min_score", "(float, default 0) Lower end of the scores.")
+    .Arg("max_score", "(float, default 1) Upper end of the scores.")
+    .Arg(
+        "num_threads",
+        "(int, default 1) Number of threads of the workspace pool to split "
+        "the classes, or the examples if there are few classes, over.")
+    .Input(
+        0,
+        "predictions",
+        "2-D tensor (Tensor<float>) of size (num_samples x num_classes) "
+        "containing prediction scores")
+    .Input(
+        1,
+        "labels",
+        "2-D tensor (Tensor<int>) of size (num_samples x num_classes) "
+        "containing 1 for the positive and 0 for the negative examples")
+    .Output(
+        0,
+        "histogram",
+        "3-D tensor (Tensor<float>) of size (num_classes x 2 x num_buckets) "
+        "with the counts of the negatives, then of the positives, of every "
+        "class");
+
+OPERATOR_SCHEMA(HistogramAP)
+    .NumInputs(1)
+    .NumOutputs(1, 2)
+    .SetDoc(R"DOC(
+Computes the average precision, and optionally the area under the ROC curve,
+of every class from the histograms of ScoreHistogram. The scores of a bucket
+are treated as tied, so the results are those of the exact computation on the
+scores rounded to the buckets.
+)DOC")
+    .Input(0, "histogram", "Histograms accumulated by ScoreHistogram.")
+    .Output(
+        0,
+        "AP",
+        "1-D tensor (Tensor<float>) of size num_classes containing the "
+        "average precision of each class, 0 for a class without positives")
+    .Output(
+        1,
+        "AUC",
+        "1-D tensor (Tensor<float>) of size num_classes containing the area "
+        "under the ROC curve of each class, 0 for a class without positives "
+        "or negatives");
+
+OPERATOR_SCHEMA(QuantileSketch)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Accumulates the values of a tensor into a sketch of their distribution, from
+which SummarizeSketch computes the statistics of Summarize and quantiles. The
+sketch holds the count, sum and sum of squares of the values and counts them
+in logarithmic buckets, so that every quantile is within relative_accuracy of
+the value of that rank. Its size only depends on the arguments, and sketches
+made with the same arguments are merged by summing them, e.g. with Sum or
+Allreduce.
+
+The output is set to zero when it does not have the size of the sketch, and
+accumulated into otherwise.
+)DOC")
+    .Arg(
+        "relative_accuracy",
+        "(float, default 0.01) Relative error of the quantiles.")
+    .Arg(
+        "min_magnitude",
+        "(float, default 1e-9) Values of smaller magnitude count as zero.")
+    .Arg(
+        "max_magnitude",
+        "(float, default 1e9) Values of larger magnitude count as this one.")
+    .Arg(
+        "num_threads",
+        "(int, default 1) Number of threads of the workspace pool to split "
+        "the values over.")
+    .Input(0, "data", "The input data as Tensor<float>.")
+    .Output(0, "sketch", "1-D tensor (Tensor<float>) holding the sketch.");
+
+OPERATOR_SCHEMA(SummarizeSketch)
+    .NumInputs(1)
+    .NumOutputs(1, 2)
+    .SetDoc(R"DOC(
+Computes min, max, mean and standard deviation, as Summarize does, and the
+given quantiles of the values accumulated by QuantileSketch, which must have
+been run with the same relative_accuracy, min_magnitude and max_magnitude.
+Min, max and the quantiles are within relative_accuracy of the exact ones.
+)DOC")
+    .Arg("relative_accuracy", "As passed to QuantileSketch.")
+    .Arg("min_magnitude", "As passed to QuantileSketch.")
+    .Arg("max_magnitude", "As passed to QuantileSketch.")
+    .Arg("quantiles", "(list of float) Quantiles to compute, in [0, 1].")
+    .Input(0, "sketch", "Sketch accumulated by QuantileSketch.")
+    .Output(
+        0,
+        "output",
+        "1-D tensor (Tensor<float>) of size 4 containing min, max, mean and "
+        "standard deviation")
+    .Output(
+        1,
+        "quantiles",
+        "1-D tensor (Tensor<float>) containing the values of the quantiles");
+
+SHOULD_NOT_DO_GRADIENT(ScoreHistogram);
+SHOULD_NOT_DO_GRADIENT(HistogramAP);
+SHOULD_NOT_DO_GRADIENT(QuantileSketch);
+SHOULD_NOT_DO_GRADIENT(SummarizeSketch);
+
+} // namespace caffe2
@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_STREAMING_METRIC_OPS_H_
+#define CAFFE2_OPERATORS_STREAMING_METRIC_OPS_H_
+
+#include <cmath>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// The streaming metric operators keep their state in a float tensor that
+// only ever grows by addition, so the states of several threads or nodes
+// merge by summing them, e.g. with Sum or the Allreduce operators, and the
+// memory does not depend on the number of examples seen.
+
+// Accumulates the scores of every class into a histogram of positives and a
+// histogram of negatives, of shape (num_classes, 2, num_buckets), from which
+// HistogramAP computes the average precision and the AUC.
+class ScoreHistogramOp final : public Operator<CPUContext> {
+ public:
+  ScoreHistogramOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        num_buckets_(OperatorBase::GetSingleArgument<int>("num_buckets", 1000)),
+        min_score_(OperatorBase::GetSingleArgument<float>("min_score", 0)),
+        max_score_(OperatorBase::GetSingleArgument<float>("max_score", 1)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GT(num_buckets_, 0);
+    CAFFE_ENFORCE_LT(min_score_, max_score_);
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+
+  bool RunOnDevice() override;
+
+ protected:
+  int num_buckets_;
+  float min_score_;
+  float max_score_;
+  int num_threads_;
+  Workspace* ws_;
+
+  INPUT_TAGS(PREDICTION, LABEL);
+};
+
+class HistogramAPOp final : public Operator<CPUContext> {
+ public:
+  HistogramAPOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+
+  bool RunOnDevice() override;
+};
+
+// Layout of the state of QuantileSketch: the count, the sum and the sum of
+// squares of the values, the number of values of magnitude below
+// min_magnitude, then the buckets of the negative and of the positive
+// values. Bucket i holds the magnitudes in
+// (min_magnitude * gamma^(i - 1), min_magnitude * gamma^i], with
+// gamma = (1 + relative_accuracy) / (1 - relative_accuracy), so that its
+// representative value is within relative_accuracy of all of them.
+// Magnitudes above max_magnitude go to the last bucket.
+class QuantileSketchLayout {
+ public:
+  enum { COUNT = 0, SUM, SUM_SQUARES, ZERO, HEADER_SIZE };
+
+  explicit QuantileSketchLayout(const OperatorBase& op);
+
+  int size() const {
+    return HEADER_SIZE + 2 * num_buckets_;
+  }
+
+  int num_buckets() const {
+    return num_buckets_;
+  }
+
+  // Offset of the bucket of x in the state.
+  int Offset(float x) const {
+    const float magnitude = std::abs(x);
+    if (!(magnitude >= min_magnitude_)) {
+      return ZERO;
+    }
+    const int bucket = std::min<int>(
+        num_buckets_ - 1,
+        std::ceil(std::log(magnitude / min_magnitude_) * inv_log_gamma_));
+    return HEADER_SIZE + (x < 0 ? 0 : num_buckets_) + bucket;
+  }
+
+  // Offset of the k-th bucket in increasing order of values, out of
+  // 2 * num_buckets + 1.
+  int OrderedOffset(int k) const {
+    if (k < num_buckets_) {
+      return HEADER_SIZE + num_buckets_ - 1 - k;
+    }
+    return k == num_buckets_ ? ZERO : HEADER_SIZE + k - 1;
+  }
+
+  // The value that represents the bucket at offset.
+  float Value(int offset) const {
+    if (offset == ZERO) {
+      return 0;
+    }
+    const int bucket = (offset - HEADER_SIZE) % num_buckets_;
+    const float value = 2 * min_magnitude_ * std::pow(gamma_, bucket) /
+        (gamma_ + 1);
+    return offset < HEADER_SIZE + num_buckets_ ? -value : value;
+  }
+
+ private:
+  float min_magnitude_;
+  float gamma_;
+  float inv_log_gamma_;
+  int num_buckets_;
+};
+
+// Accumulates the values of a tensor into a sketch of their distribution,
+// from which SummarizeSketch computes summary statistics and quantiles.
+class QuantileSketchOp final : public Operator<CPUContext> {
+ public:
+  QuantileSketchOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        layout_(*this),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+
+  bool RunOnDevice() override;
+
+ protected:
+  QuantileSketchLayout layout_;
+  int num_threads_;
+  Workspace* ws_;
+};
+
+class SummarizeSketchOp final : public Operator<CPUContext> {
+ public:
+  SummarizeSketchOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        layout_(*this),
+        quantiles_(OperatorBase::GetRepeatedArgument<float>("quantiles")) {
+    for (const auto q : quantiles_) {
+      CAFFE_ENFORCE(q >= 0 && q <= 1, "Quantiles must be in [0, 1]");
+    }
+  }
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+
+  bool RunOnDevice() override;
+
+  static constexpr int MIN_IDX = 0;
+  static constexpr int MAX_IDX = 1;
+  static constexpr int MEAN_IDX = 2;
+  static constexpr int STD_IDX = 3;
+
+  static constexpr int NUM_STATS = 4;
+
+ protected:
+  QuantileSketchLayout layout_;
+  vector<float> quantiles_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_STREAMING_METRIC_OPS_H_
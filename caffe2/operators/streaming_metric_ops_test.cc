@@ -0,0 +1,194 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+template <typename T>
+void SetTensor(
+    Workspace* ws,
+    const string& name,
+    const vector<TIndex>& dims,
+    const vector<T>& values) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  std::copy(values.begin(), values.end(), tensor->mutable_data<T>());
+}
+
+vector<float> GetTensor(Workspace* ws, const string& name) {
+  const auto& tensor = ws->GetBlob(name)->Get<TensorCPU>();
+  return vector<float>(
+      tensor.data<float>(), tensor.data<float>() + tensor.size());
+}
+
+void RunOp(
+    Workspace* ws,
+    const string& type,
+    const vector<string>& inputs,
+    const vector<string>& outputs,
+    const vector<Argument>& args = {}) {
+  ASSERT_TRUE(
+      ws->RunOperatorOnce(CreateOperatorDef(type, "", inputs, outputs, args)));
+}
+
+} // namespace
+
+TEST(StreamingMetricOpsTest, HistogramAPMatchesAPMeter) {
+  Workspace ws;
+  const int N = 300;
+  const int D = 2;
+  const int kBuckets = 1000;
+  // Distinct scores in the middle of distinct buckets.
+  vector<float> scores(N * D);
+  vector<int> labels(N * D);
+  for (int i = 0; i < N * D; ++i) {
+    scores[i] = ((i * 337) % kBuckets + 0.5f) / kBuckets;
+    labels[i] = (i * 7) % 5 < 2;
+  }
+  SetTensor<float>(&ws, "scores", {N, D}, scores);
+  SetTensor<int>(&ws, "labels", {N, D}, labels);
+  RunOp(
+      &ws,
+      "APMeter",
+      {"scores", "labels"},
+      {"exact_ap"},
+      {MakeArgument<int>("buffer_size", N)});
+  // Accumulated in two batches.
+  SetTensor<float>(
+      &ws, "first", {N / 3, D}, {scores.begin(), scores.begin() + N / 3 * D});
+  SetTensor<int>(
+      &ws,
+      "first_labels",
+      {N / 3, D},
+      {labels.begin(), labels.begin() + N / 3 * D});
+  SetTensor<float>(
+      &ws, "rest", {N - N / 3, D}, {scores.begin() + N / 3 * D, scores.end()});
+  SetTensor<int>(
+      &ws,
+      "rest_labels",
+      {N - N / 3, D},
+      {labels.begin() + N / 3 * D, labels.end()});
+  RunOp(&ws, "ScoreHistogram", {"first", "first_labels"}, {"hist"});
+  RunOp(&ws, "ScoreHistogram", {"rest", "rest_labels"}, {"hist"});
+  RunOp(&ws, "HistogramAP", {"hist"}, {"ap", "auc"});
+
+  const auto exact_ap = GetTensor(&ws, "exact_ap");
+  const auto ap = GetTensor(&ws, "ap");
+  const auto auc = GetTensor(&ws, "auc");
+  for (int d = 0; d < D; ++d) {
+    EXPECT_NEAR(ap[d], exact_ap[d], 1e-5);
+    int pairs = 0;
+    int ordered = 0;
+    for (int i = 0; i < N; ++i) {
+      for (int j = 0; j < N; ++j) {
+        if (labels[i * D + d] && !labels[j * D + d]) {
+          ++pairs;
+          ordered += scores[i * D + d] > scores[j * D + d];
+        }
+      }
+    }
+    EXPECT_NEAR(auc[d], static_cast<float>(ordered) / pairs, 1e-5);
+  }
+}
+
+TEST(StreamingMetricOpsTest, ScoreHistogramThreads) {
+  // Many rows of one class split over the rows, and many classes split over
+  // the classes.
+  const vector<std::pair<int, int>> shapes = {{50000, 1}, {2000, 40}};
+  for (const auto& shape : shapes) {
+    const int N = shape.first;
+    const int D = shape.second;
+    vector<float> scores(N * D);
+    vector<int> labels(N * D);
+    for (int i = 0; i < N * D; ++i) {
+      scores[i] = (i * 7919 % 1013) / 1000.f - 0.005f;
+      labels[i] = i % 3 == 0;
+    }
+    Workspace ws;
+    SetTensor<float>(&ws, "scores", {N, D}, scores);
+    SetTensor<int>(&ws, "labels", {N, D}, labels);
+    RunOp(&ws, "ScoreHistogram", {"scores", "labels"}, {"serial"});
+    RunOp(
+        &ws,
+        "ScoreHistogram",
+        {"scores", "labels"},
+        {"parallel"},
+        {MakeArgument<int>("num_threads", 4)});
+    const auto serial = GetTensor(&ws, "serial");
+    EXPECT_EQ(GetTensor(&ws, "parallel"), serial);
+    float total = 0;
+    for (const auto count : serial) {
+      total += count;
+    }
+    EXPECT_EQ(total, N * D);
+  }
+}
+
+TEST(StreamingMetricOpsTest, QuantileSketch) {
+  const int N = 100000;
+  vector<float> values(N);
+  for (int i = 0; i < N; ++i) {
+    // -20000 to 79999, in a scrambled order.
+    values[i] = (i * 7919 % N) - 20000;
+  }
+  Workspace ws;
+  SetTensor<float>(&ws, "all", {N}, values);
+  SetTensor<float>(
+      &ws, "first", {N / 4}, {values.begin(), values.begin() + N / 4});
+  SetTensor<float>(
+      &ws, "rest", {N - N / 4}, {values.begin() + N / 4, values.end()});
+  RunOp(
+      &ws,
+      "QuantileSketch",
+      {"all"},
+      {"sketch"},
+      {MakeArgument<int>("num_threads", 4)});
+  // Sketches merge by summing them.
+  RunOp(&ws, "QuantileSketch", {"first"}, {"first_sketch"});
+  RunOp(&ws, "QuantileSketch", {"rest"}, {"rest_sketch"});
+  const auto sketch = GetTensor(&ws, "sketch");
+  const auto first = GetTensor(&ws, "first_sketch");
+  const auto rest = GetTensor(&ws, "rest_sketch");
+  ASSERT_EQ(first.size(), sketch.size());
+  for (int k = 0; k < sketch.size(); ++k) {
+    EXPECT_NEAR(first[k] + rest[k], sketch[k], 1e-6 * std::abs(sketch[k]));
+  }
+
+  RunOp(
+      &ws,
+      "SummarizeSketch",
+      {"sketch"},
+      {"summary", "quantiles"},
+      {MakeArgument<vector<float>>("quantiles", {0, 0.1, 0.5, 0.99, 1})});
+  const auto summary = GetTensor(&ws, "summary");
+  EXPECT_NEAR(summary[0], -20000, 200);
+  EXPECT_NEAR(summary[1], 79999, 800);
+  EXPECT_NEAR(summary[2], 29999.5, 1);
+  EXPECT_NEAR(summary[3], 28867.7, 1);
+  const auto quantiles = GetTensor(&ws, "quantiles");
+  const vector<float> expected = {-20000, -10001, 29999, 78999, 79999};
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(quantiles[i], expected[i], 0.01 * std::abs(expected[i]));
+  }
+}
+
+} // namespace caffe2
@@ -15,6 +15,9 @@
  */
 
 #include "caffe2/operators/string_ops.h"
+
+#include <cstring>
+
 #include "caffe2/core/operator.h"
 
 namespace caffe2 {
@@ -61,14 +64,39 @@ bool StringJoinOp<CPUContext>::DoRunWithType() {
   return true;
 }
 
+template <>
+bool StringJoinOp<CPUContext>::RunWithPackedStrings() {
+  const auto& input = OperatorBase::Input<PackedStrings>(0);
+  auto* output = OperatorBase::Output<PackedStrings>(0);
+  CAFFE_ENFORCE(&input != output, "PackedStrings cannot be joined in-place");
+  CAFFE_ENFORCE_GT(input.size(), 0);
+  CAFFE_ENFORCE_LE(input.ndim(), 2, "Only 1-D and 2-D tensors are supported");
+
+  const TIndex rows = input.dim(0);
+  const TIndex cols = (input.ndim() == 2) ? input.dim(1) : 1;
+  const TIndex outer = this->axis_ == 0 ? rows : cols;
+  const TIndex inner = this->axis_ == 0 ? cols : rows;
+  output->Reset(
+      vector<TIndex>{outer}, input.nbytes() + input.size() * delimiter_.size());
+  for (TIndex i = 0; i < outer; ++i) {
+    for (TIndex j = 0; j < inner; ++j) {
+      const TIndex index = this->axis_ == 0 ? i * cols + j : j * cols + i;
+      output->Append(input.data(index), input.length(index));
+      output->Append(delimiter_.data(), delimiter_.size());
+    }
+    output->EndElement();
+  }
+  return true;
+}
+
 namespace {
 
 struct StartsWith {
   explicit StartsWith(OperatorBase& op)
       : prefix_(op.GetSingleArgument<std::string>("prefix", "")) {}
-  bool operator()(const std::string& str) {
-    return std::mismatch(prefix_.begin(), prefix_.end(), str.begin()).first ==
-        prefix_.end();
+  bool operator()(const char* data, size_t length) {
+    return length >= prefix_.size() &&
+        std::memcmp(data, prefix_.data(), prefix_.size()) == 0;
   }
 
  private:
@@ -78,9 +106,11 @@ struct StartsWith {
 struct EndsWith {
   explicit EndsWith(OperatorBase& op)
       : suffix_(op.GetSingleArgument<std::string>("suffix", "")) {}
-  bool operator()(const std::string& str) {
-    return std::mismatch(suffix_.rbegin(), suffix_.rend(), str.rbegin())
-               .first == suffix_.rend();
+  bool operator()(const char* data, size_t length) {
+    return length >= suffix_.size() &&
+        std::memcmp(
+            data + length - suffix_.size(), suffix_.data(), suffix_.size()) ==
+        0;
   }
 
  private:
@@ -89,9 +119,11 @@ struct EndsWith {
 
 struct Prefix {
   explicit Prefix(OperatorBase& op)
-      : length_(op.GetSingleArgument<int>("length", 3)) {}
-  std::string operator()(const std::string& str) {
-    return std::string(str.begin(), std::min(str.end(), str.begin() + length_));
+      : length_(op.GetSingleArgument<int>("length", 3)) {
+    CAFFE_ENFORCE_GE(length_, 0);
+  }
+  std::pair<size_t, size_t> Slice(size_t length) {
+    return {0, std::min<size_t>(length, length_)};
   }
 
  private:
@@ -100,31 +132,49 @@ struct Prefix {
 
 struct Suffix {
   explicit Suffix(OperatorBase& op)
-      : length_(op.GetSingleArgument<int>("length", 3)) {}
-  std::string operator()(const std::string& str) {
-    return std::string(std::max(str.begin(), str.end() - length_), str.end());
+      : length_(op.GetSingleArgument<int>("length", 3)) {
+    CAFFE_ENFORCE_GE(length_, 0);
+  }
+  std::pair<size_t, size_t> Slice(size_t length) {
+    const size_t kept = std::min<size_t>(length, length_);
+    return {length - kept, kept};
   }
 
  private:
   int length_;
 };
 
-template <typename ScalarFunctor, typename TypeMap = FixedType<std::string>>
-using StringElementwiseOp = UnaryElementwiseWithArgsOp<
-    TensorTypes<std::string>,
-    CPUContext,
-    ForEach<ScalarFunctor>,
-    TypeMap>;
-
-REGISTER_CPU_OPERATOR(StringPrefix, StringElementwiseOp<Prefix>);
-REGISTER_CPU_OPERATOR(StringSuffix, StringElementwiseOp<Suffix>);
-REGISTER_CPU_OPERATOR(
-    StringStartsWith,
-    StringElementwiseOp<StartsWith, FixedType<bool>>);
-REGISTER_CPU_OPERATOR(
-    StringEndsWith,
-    StringElementwiseOp<EndsWith, FixedType<bool>>);
+class PackStringsOp final : public Operator<CPUContext> {
+ public:
+  PackStringsOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    OperatorBase::Output<PackedStrings>(0)->CopyFrom(Input(0));
+    return true;
+  }
+};
+
+class UnpackStringsOp final : public Operator<CPUContext> {
+ public:
+  UnpackStringsOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    OperatorBase::Input<PackedStrings>(0).CopyTo(Output(0));
+    return true;
+  }
+};
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(StringPrefix, StringSliceOp<Prefix>);
+REGISTER_CPU_OPERATOR(StringSuffix, StringSliceOp<Suffix>);
+REGISTER_CPU_OPERATOR(StringStartsWith, StringPredicateOp<StartsWith>);
+REGISTER_CPU_OPERATOR(StringEndsWith, StringPredicateOp<EndsWith>);
 REGISTER_CPU_OPERATOR(StringJoin, StringJoinOp<CPUContext>);
+REGISTER_CPU_OPERATOR(PackStrings, PackStringsOp);
+REGISTER_CPU_OPERATOR(UnpackStrings, UnpackStringsOp);
 
 OPERATOR_SCHEMA(StringPrefix)
     .NumInputs(1)
@@ -136,11 +186,12 @@ NOTE: Prefix is computed on number of bytes, which may lead to wrong behavior
 and potentially invalid strings for variable-length encodings such as utf-8.
 )DOC")
     .Arg("length", "Maximum size of the prefix, in bytes.")
-    .Input(0, "strings", "Tensor of std::string.")
+    .Input(0, "strings", "Tensor of std::string, or PackedStrings.")
     .Output(
         0,
         "prefixes",
-        "Tensor of std::string containing prefixes for each input.");
+        "Tensor of std::string containing prefixes for each input, or "
+        "PackedStrings for PackedStrings.");
 
 OPERATOR_SCHEMA(StringSuffix)
     .NumInputs(1)
@@ -151,11 +202,12 @@ Input strings that are shorter than suffix length will be returned unchanged.
 NOTE: Prefix is computed on number of bytes, which may lead to wrong behavior
 and potentially invalid strings for variable-length encodings such as utf-8.
 )DOC")
-    .Input(0, "strings", "Tensor of std::string.")
+    .Input(0, "strings", "Tensor of std::string, or PackedStrings.")
     .Output(
         0,
         "suffixes",
-        "Tensor of std::string containing suffixes for each output.")
+        "Tensor of std::string containing suffixes for each output, or "
+        "PackedStrings for PackedStrings.")
     .Arg("length", "Maximum size of the suffix, in bytes.");
 
 OPERATOR_SCHEMA(StringStartsWith)
@@ -166,7 +218,7 @@ Performs the starts-with check on each string in the input tensor.
 Returns tensor of boolean of the same dimension of input.
 )DOC")
     .Arg("prefix", "The prefix to check input strings against.")
-    .Input(0, "strings", "Tensor of std::string.")
+    .Input(0, "strings", "Tensor of std::string, or PackedStrings.")
     .Output(0, "bools", "Tensor of bools of same shape as input.");
 
 OPERATOR_SCHEMA(StringEndsWith)
@@ -177,7 +229,7 @@ Performs the ends-with check on each string in the input tensor.
 Returns tensor of boolean of the same dimension of input.
 )DOC")
     .Arg("suffix", "The suffix to check input strings against.")
-    .Input(0, "strings", "Tensor of std::string.")
+    .Input(0, "strings", "Tensor of std::string, or PackedStrings.")
     .Output(0, "bools", "Tensor of bools of same shape as input.");
 
 OPERATOR_SCHEMA(StringJoin)
@@ -188,7 +240,7 @@ Takes a 1-D or a 2-D tensor as input and joins elements in each row with the
 provided delimiter. Output is a 1-D tensor of size equal to the first dimension
 of the input. Each element in the output tensor is a string of concatenated
 elements corresponding to each row in the input tensor. For 1-D input, each
-element is treated as a row.
+element is treated as a row. PackedStrings are joined into PackedStrings.
 )DOC")
     .Arg("delimiter", "Delimiter for join (Default: \",\").")
     .Arg("axis", "Axis for the join (either 0 or 1)")
@@ -199,10 +251,32 @@ element is treated as a row.
         "1-D tensor of strings created by joining row elements from the "
         "input tensor.");
 
+OPERATOR_SCHEMA(PackStrings)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Packs a tensor of std::string into PackedStrings, which hold the bytes of all
+the strings in one buffer. The string operators, IndexGet on a string index
+and serialization take PackedStrings without an allocation per element.
+)DOC")
+    .Input(0, "strings", "Tensor of std::string.")
+    .Output(0, "packed", "PackedStrings of the same shape.");
+
+OPERATOR_SCHEMA(UnpackStrings)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Unpacks PackedStrings into a tensor of std::string of the same shape.
+)DOC")
+    .Input(0, "packed", "PackedStrings.")
+    .Output(0, "strings", "Tensor of std::string.");
+
 SHOULD_NOT_DO_GRADIENT(StringPrefix);
 SHOULD_NOT_DO_GRADIENT(StringSuffix);
 SHOULD_NOT_DO_GRADIENT(StringStartsWith);
 SHOULD_NOT_DO_GRADIENT(StringEndsWith);
 SHOULD_NOT_DO_GRADIENT(StringJoin);
-}
+SHOULD_NOT_DO_GRADIENT(PackStrings);
+SHOULD_NOT_DO_GRADIENT(UnpackStrings);
+
 } // namespace caffe2
@@ -18,6 +18,7 @@
 #define CAFFE2_OPERATORS_STRING_OPS_H_
 
 #include "caffe2/core/operator.h"
+#include "caffe2/core/packed_strings.h"
 #include "caffe2/operators/elementwise_op.h"
 
 namespace caffe2 {
@@ -43,12 +44,82 @@ struct ForEach {
   Functor functor;
 };
 
-template <typename ScalarFunctor, typename TypeMap = FixedType<std::string>>
-using StringElementwiseOp = UnaryElementwiseWithArgsOp<
-    TensorTypes<std::string>,
-    CPUContext,
-    ForEach<ScalarFunctor>,
-    TypeMap>;
+/**
+ * StringSliceOp keeps the range of bytes of every string given by
+ * Functor::Slice(length), which returns its begin and length. A tensor of
+ * std::string gives a tensor of std::string, and PackedStrings give
+ * PackedStrings, built without an allocation per element.
+ */
+template <typename Functor>
+class StringSliceOp final : public Operator<CPUContext> {
+ public:
+  StringSliceOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws), functor_(*this) {}
+
+  bool RunOnDevice() override {
+    if (OperatorBase::InputIsType<PackedStrings>(0)) {
+      const auto& input = OperatorBase::Input<PackedStrings>(0);
+      auto* output = OperatorBase::Output<PackedStrings>(0);
+      CAFFE_ENFORCE(
+          &input != output, "PackedStrings cannot be sliced in-place");
+      output->Reset(input.dims(), input.nbytes());
+      for (TIndex i = 0; i < input.size(); ++i) {
+        const auto range = functor_.Slice(input.length(i));
+        output->Add(input.data(i) + range.first, range.second);
+      }
+      return true;
+    }
+    const auto& input = Input(0);
+    auto* output = Output(0);
+    output->ResizeLike(input);
+    const auto* in = input.data<std::string>();
+    auto* out = output->mutable_data<std::string>();
+    for (TIndex i = 0; i < input.size(); ++i) {
+      const auto range = functor_.Slice(in[i].size());
+      out[i] = in[i].substr(range.first, range.second);
+    }
+    return true;
+  }
+
+ private:
+  Functor functor_;
+};
+
+/**
+ * StringPredicateOp evaluates Functor(data, length) on every string of a
+ * tensor of std::string or of PackedStrings, giving a tensor of bool of the
+ * same shape.
+ */
+template <typename Functor>
+class StringPredicateOp final : public Operator<CPUContext> {
+ public:
+  StringPredicateOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws), functor_(*this) {}
+
+  bool RunOnDevice() override {
+    auto* output = Output(0);
+    if (OperatorBase::InputIsType<PackedStrings>(0)) {
+      const auto& input = OperatorBase::Input<PackedStrings>(0);
+      output->Resize(input.dims());
+      auto* out = output->mutable_data<bool>();
+      for (TIndex i = 0; i < input.size(); ++i) {
+        out[i] = functor_(input.data(i), input.length(i));
+      }
+      return true;
+    }
+    const auto& input = Input(0);
+    output->ResizeLike(input);
+    const auto* in = input.data<std::string>();
+    auto* out = output->mutable_data<bool>();
+    for (TIndex i = 0; i < input.size(); ++i) {
+      out[i] = functor_(in[i].data(), in[i].size());
+    }
+    return true;
+  }
+
+ private:
+  Functor functor_;
+};
 
 template <class Context>
 class StringJoinOp final : public Operator<Context> {
@@ -64,6 +135,9 @@ class StringJoinOp final : public Operator<Context> {
   }
 
   bool RunOnDevice() override {
+    if (OperatorBase::InputIsType<PackedStrings>(0)) {
+      return RunWithPackedStrings();
+    }
     return DispatchHelper<TensorTypes<
         float,
         double,
@@ -80,6 +154,9 @@ class StringJoinOp final : public Operator<Context> {
   template <typename T>
   bool DoRunWithType();
 
+  // Joins PackedStrings into PackedStrings.
+  bool RunWithPackedStrings();
+
  protected:
   std::string delimiter_;
   int axis_;
@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "caffe2/operators/string_ops.h"
+#include "caffe2/utils/proto_utils.h"
 
 namespace caffe2 {
 
@@ -153,4 +154,50 @@ TEST_F(StringJoinOpTest, testLong2DJoin) {
   EXPECT_EQ(outputData[0], "100,200,");
   EXPECT_EQ(outputData[1], "1000,2000,");
 }
+
+TEST(StringOpsTest, PackedStrings) {
+  Workspace ws;
+  auto* tensor = ws.CreateBlob("X")->GetMutable<TensorCPU>();
+  tensor->Resize(2, 2);
+  auto* data = tensor->mutable_data<std::string>();
+  data[0] = "apple";
+  data[1] = "ap";
+  data[2] = "";
+  data[3] = "grape";
+  EXPECT_TRUE(
+      ws.RunOperatorOnce(CreateOperatorDef("PackStrings", "", {"X"}, {"P"})));
+  ASSERT_TRUE(ws.GetBlob("P")->IsType<PackedStrings>());
+
+  Argument length;
+  length.set_name("length");
+  length.set_i(3);
+  EXPECT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("StringSuffix", "", {"P"}, {"S"}, {length})));
+  const auto& suffixes = ws.GetBlob("S")->Get<PackedStrings>();
+  EXPECT_EQ(suffixes.dims(), vector<TIndex>({2, 2}));
+  EXPECT_EQ(suffixes.str(0), "ple");
+  EXPECT_EQ(suffixes.str(1), "ap");
+  EXPECT_EQ(suffixes.str(2), "");
+  EXPECT_EQ(suffixes.str(3), "ape");
+
+  Argument prefix;
+  prefix.set_name("prefix");
+  prefix.set_s("ap");
+  EXPECT_TRUE(ws.RunOperatorOnce(
+      CreateOperatorDef("StringStartsWith", "", {"P"}, {"B"}, {prefix})));
+  const auto* bools = ws.GetBlob("B")->Get<TensorCPU>().data<bool>();
+  EXPECT_TRUE(bools[0]);
+  EXPECT_TRUE(bools[1]);
+  EXPECT_FALSE(bools[2]);
+  EXPECT_FALSE(bools[3]);
+
+  EXPECT_TRUE(
+      ws.RunOperatorOnce(CreateOperatorDef("StringJoin", "", {"P"}, {"J"})));
+  EXPECT_TRUE(
+      ws.RunOperatorOnce(CreateOperatorDef("UnpackStrings", "", {"J"}, {"U"})));
+  const auto& joined = ws.GetBlob("U")->Get<TensorCPU>();
+  EXPECT_EQ(joined.size(), 2);
+  EXPECT_EQ(joined.data<std::string>()[0], "apple,ap,");
+  EXPECT_EQ(joined.data<std::string>()[1], ",grape,");
+}
 }
@@ -17,19 +17,21 @@
 #include <cmath>
 
 #include "caffe2/operators/elementwise_op.h"
+#include "caffe2/perfkernels/transcendental.h"
 #include "caffe2/utils/math.h"
 
 namespace caffe2 {
 
 struct TanhCPUFunctor {
-  template <typename T>
-  inline void
-  operator()(const int n, const T* x, T* y, CPUContext* /*device_context*/) {
+  inline void operator()(
+      const int n,
+      const float* x,
+      float* y,
+      CPUContext* /*device_context*/) {
 #ifdef CAFFE2_USE_ACCELERATE
     vvtanhf(y, x, &n);
 #else
-    ConstEigenVectorArrayMap<T> x_arr(x, n);
-    EigenVectorMap<T>(y, n) = 1 - 2 * ((x_arr * 2).exp() + 1).inverse();
+    vector_tanh(n, x, y);
 #endif
   }
 };
@@ -62,6 +64,7 @@ OPERATOR_SCHEMA(Tanh)
   .NumOutputs(1)
   .AllowInplace({{0, 0}})
   .IdenticalTypeAndShape()
+  .CostInferenceFunction(PointwiseCostInference<1>)
   .SetDoc(R"DOC(
 Calculates the hyperbolic tangent of the given input tensor element-wise. This
 operation can be done in an in-place fashion too, by providing the same input
@@ -35,6 +35,12 @@ corresponding index in the TensorProtos objects in the DB.
   .Arg("batch_size", "(int, default 0) the number of samples in a batch. The "
        "default value of 0 means that the operator will attempt to insert the "
        "entire data in a single output blob.")
+  .Arg("prefetch_depth", "(int, default 1) the number of batches that are "
+       "prefetched ahead of the one being returned.")
+  .Arg("num_prefetch_threads", "(int, default 1) the number of threads that "
+       "read and decode batches concurrently, at most prefetch_depth. With more "
+       "than one thread, records are no longer grouped into batches in DB "
+       "order.")
   .Input(0, "data", "A pre-initialized DB reader. Typically, this is obtained "
          "by calling CreateDB operator with a db_name and a db_type. The "
          "resulting output blob is a DB Reader tensor")
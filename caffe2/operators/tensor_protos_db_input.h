@@ -29,22 +29,23 @@ template <class Context>
 class TensorProtosDBInput final : public PrefetchOperator<Context> {
  public:
   using OperatorBase::OutputSize;
-  using PrefetchOperator<Context>::prefetch_thread_;
   explicit TensorProtosDBInput(const OperatorDef& operator_def, Workspace* ws);
   ~TensorProtosDBInput() {
     PrefetchOperator<Context>::Finalize();
   }
 
-  bool Prefetch() override;
-  bool CopyPrefetched() override;
+  bool SupportsPrefetchBuffers() const override {
+    return true;
+  }
+  bool PrefetchBuffer(int buffer) override;
+  bool CopyPrefetchedBuffer(int buffer) override;
 
  private:
-  // Prefetch will always just happen on the CPU side.
-  vector<Blob> prefetched_blobs_;
+  // Prefetch will always just happen on the CPU side, into one set of blobs
+  // per prefetch buffer.
+  vector<vector<Blob>> prefetched_blobs_;
   int batch_size_;
   bool shape_inferred_ = false;
-  string key_;
-  string value_;
 };
 
 template <class Context>
@@ -52,59 +53,76 @@ TensorProtosDBInput<Context>::TensorProtosDBInput(
     const OperatorDef& operator_def,
     Workspace* ws)
     : PrefetchOperator<Context>(operator_def, ws),
-      prefetched_blobs_(operator_def.output_size()),
+      prefetched_blobs_(this->prefetch_depth_),
       batch_size_(
-          OperatorBase::template GetSingleArgument<int>("batch_size", 0)) {}
+          OperatorBase::template GetSingleArgument<int>("batch_size", 0)) {
+  for (auto& blobs : prefetched_blobs_) {
+    blobs = vector<Blob>(operator_def.output_size());
+  }
+}
 
 template <class Context>
-bool TensorProtosDBInput<Context>::Prefetch() {
+bool TensorProtosDBInput<Context>::PrefetchBuffer(int buffer) {
   const db::DBReader& reader = OperatorBase::Input<db::DBReader>(0);
   TensorDeserializer<CPUContext> deserializer;
+  auto& prefetched_blobs = prefetched_blobs_[buffer];
+  string key;
+  string value;
   if (batch_size_ == 0) {
     // We do not need to construct a batch. As a result, we will simply
     // deserialize everything into the target prefetched blob.
-    reader.Read(&key_, &value_);
-    TensorProtos protos;
-    CAFFE_ENFORCE(protos.ParseFromString(value_));
-    CAFFE_ENFORCE(protos.protos_size() == OutputSize());
-    for (int i = 0; i < protos.protos_size(); ++i) {
-      if (protos.protos(i).has_device_detail()) {
-        protos.mutable_protos(i)->clear_device_detail();
-      }
-      deserializer.Deserialize(
-          protos.protos(i),
-          prefetched_blobs_[i].template GetMutable<TensorCPU>());
+    CAFFE_DURATION(this->stats_, prefetch_read_ns) {
+      reader.Read(&key, &value);
     }
-  } else {
-    vector<TensorCPU> temp_tensors(OutputSize());
-    for (int item_id = 0; item_id < batch_size_; ++item_id) {
-      reader.Read(&key_, &value_);
+    CAFFE_DURATION(this->stats_, prefetch_decode_ns) {
       TensorProtos protos;
-      CAFFE_ENFORCE(protos.ParseFromString(value_));
+      CAFFE_ENFORCE(protos.ParseFromString(value));
       CAFFE_ENFORCE(protos.protos_size() == OutputSize());
-      if (!shape_inferred_) {
-        // First, set the shape of all the blobs.
-        for (int i = 0; i < protos.protos_size(); ++i) {
-          vector<int> dims(
-              protos.protos(i).dims().begin(), protos.protos(i).dims().end());
-          dims.insert(dims.begin(), batch_size_);
-          prefetched_blobs_[i].template GetMutable<TensorCPU>()->Resize(dims);
-        }
-      }
       for (int i = 0; i < protos.protos_size(); ++i) {
-        TensorCPU* dst = prefetched_blobs_[i].template GetMutable<TensorCPU>();
-        TensorCPU& src = temp_tensors[i];
         if (protos.protos(i).has_device_detail()) {
           protos.mutable_protos(i)->clear_device_detail();
         }
-        deserializer.Deserialize(protos.protos(i), &src);
-        DCHECK_EQ(src.size() * batch_size_, dst->size());
-        this->context_.template CopyItems<CPUContext, CPUContext>(
-            src.meta(),
-            src.size(),
-            src.raw_data(),
-            static_cast<char*>(dst->raw_mutable_data(src.meta())) +
-                src.nbytes() * item_id);
+        deserializer.Deserialize(
+            protos.protos(i),
+            prefetched_blobs[i].template GetMutable<TensorCPU>());
+      }
+    }
+  } else {
+    vector<TensorCPU> temp_tensors(OutputSize());
+    for (int item_id = 0; item_id < batch_size_; ++item_id) {
+      CAFFE_DURATION(this->stats_, prefetch_read_ns) {
+        reader.Read(&key, &value);
+      }
+      CAFFE_DURATION(this->stats_, prefetch_decode_ns) {
+        TensorProtos protos;
+        CAFFE_ENFORCE(protos.ParseFromString(value));
+        CAFFE_ENFORCE(protos.protos_size() == OutputSize());
+        if (!shape_inferred_) {
+          // First, set the shape of all the blobs.
+          for (int i = 0; i < protos.protos_size(); ++i) {
+            vector<int> dims(
+                protos.protos(i).dims().begin(),
+                protos.protos(i).dims().end());
+            dims.insert(dims.begin(), batch_size_);
+            prefetched_blobs[i].template GetMutable<TensorCPU>()->Resize(
+                dims);
+          }
+        }
+        for (int i = 0; i < protos.protos_size(); ++i) {
+          TensorCPU* dst = prefetched_blobs[i].template GetMutable<TensorCPU>();
+          TensorCPU& src = temp_tensors[i];
+          if (protos.protos(i).has_device_detail()) {
+            protos.mutable_protos(i)->clear_device_detail();
+          }
+          deserializer.Deserialize(protos.protos(i), &src);
+          DCHECK_EQ(src.size() * batch_size_, dst->size());
+          this->context_.template CopyItems<CPUContext, CPUContext>(
+              src.meta(),
+              src.size(),
+              src.raw_data(),
+              static_cast<char*>(dst->raw_mutable_data(src.meta())) +
+                  src.nbytes() * item_id);
+        }
       }
     }
   }
@@ -112,10 +130,11 @@ bool TensorProtosDBInput<Context>::Prefetch() {
 }
 
 template <class Context>
-bool TensorProtosDBInput<Context>::CopyPrefetched() {
+bool TensorProtosDBInput<Context>::CopyPrefetchedBuffer(int buffer) {
   for (int i = 0; i < OutputSize(); ++i) {
     OperatorBase::Output<Tensor<Context>>(i)->CopyFrom(
-        prefetched_blobs_[i].template Get<TensorCPU>(), &this->context_);
+        prefetched_blobs_[buffer][i].template Get<TensorCPU>(),
+        &this->context_);
   }
   return true;
 }
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
@@ -28,9 +30,14 @@ struct TextFileReaderInstance {
       char escape,
       const std::string& filename,
       int numPasses,
-      const std::vector<int>& types)
-      : fileReader(filename),
+      const std::vector<int>& types,
+      int threads = 1)
+      : fileReader(filename, threads > 1 ? kBlockSize : kBufferSize),
         tokenizer(Tokenizer(delims, escape), &fileReader, numPasses),
+        rowReader(&fileReader, delims.front(), escape, numPasses),
+        delimiters(delims),
+        escapeChar(escape),
+        numThreads(threads),
         fieldTypes(types) {
     for (const auto dt : fieldTypes) {
       fieldMetas.push_back(
@@ -39,8 +46,17 @@ struct TextFileReaderInstance {
     }
   }
 
+  // Read size of the single-threaded tokenizer and of the row chunker
+  static constexpr size_t kBufferSize = 65536;
+  static constexpr size_t kBlockSize = 1 << 22;
+
   FileReader fileReader;
+  // Only one of them reads from fileReader, depending on numThreads.
   BufferedTokenizer tokenizer;
+  BufferedRowReader rowReader;
+  std::vector<char> delimiters;
+  char escapeChar;
+  int numThreads;
   std::vector<int> fieldTypes;
   std::vector<TypeMeta> fieldMetas;
   std::vector<size_t> fieldByteSizes;
@@ -51,26 +67,37 @@ struct TextFileReaderInstance {
   std::mutex globalMutex_;
 };
 
+constexpr size_t TextFileReaderInstance::kBufferSize;
+constexpr size_t TextFileReaderInstance::kBlockSize;
+
 class CreateTextFileReaderOp : public Operator<CPUContext> {
  public:
   CreateTextFileReaderOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<CPUContext>(operator_def, ws),
         filename_(GetSingleArgument<string>("filename", "")),
         numPasses_(GetSingleArgument<int>("num_passes", 1)),
+        numThreads_(GetSingleArgument<int>("num_threads", 1)),
         fieldTypes_(GetRepeatedArgument<int>("field_types")) {
     CAFFE_ENFORCE(fieldTypes_.size() > 0, "field_types arg must be non-empty");
+    CAFFE_ENFORCE_GE(numThreads_, 1, "num_threads must be positive");
   }
 
   bool RunOnDevice() override {
     *OperatorBase::Output<std::unique_ptr<TextFileReaderInstance>>(0) =
         std::unique_ptr<TextFileReaderInstance>(new TextFileReaderInstance(
-            {'\n', '\t'}, '\0', filename_, numPasses_, fieldTypes_));
+            {'\n', '\t'},
+            '\0',
+            filename_,
+            numPasses_,
+            fieldTypes_,
+            numThreads_));
     return true;
   }
 
  private:
   std::string filename_;
   int numPasses_;
+  int numThreads_;
   std::vector<int> fieldTypes_;
 };
 
@@ -84,15 +111,10 @@ inline void convert(
       static_cast<std::string*>(dst)->assign(src_start, src_end);
     } break;
     case TensorProto_DataType_FLOAT: {
-      // TODO(azzolini): avoid copy, use faster convertion
-      std::string str_copy(src_start, src_end);
-      const char* src_copy = str_copy.c_str();
-      char* src_copy_end;
-      float val = strtof(src_copy, &src_copy_end);
-      if (src_copy == src_copy_end) {
-        throw std::runtime_error("Invalid float: " + str_copy);
+      if (!ParseFloat(src_start, src_end, static_cast<float*>(dst))) {
+        throw std::runtime_error(
+            "Invalid float: " + std::string(src_start, src_end));
       }
-      *static_cast<float*>(dst) = val;
     } break;
     default:
       throw std::runtime_error("Unsupported type.");
@@ -103,7 +125,8 @@ class TextFileReaderReadOp : public Operator<CPUContext> {
  public:
   TextFileReaderReadOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<CPUContext>(operator_def, ws),
-        batchSize_(GetSingleArgument<int>("batch_size", 1)) {}
+        batchSize_(GetSingleArgument<int>("batch_size", 1)),
+        ws_(ws) {}
 
   bool RunOnDevice() override {
     const int numFields = OutputSize();
@@ -127,6 +150,10 @@ class TextFileReaderReadOp : public Operator<CPUContext> {
       datas[i] = (char*)Output(i)->raw_mutable_data(instance->fieldMetas[i]);
     }
 
+    if (instance->numThreads > 1) {
+      return ReadChunk(instance, datas);
+    }
+
     int rowsRead = 0;
     {
       // TODO(azzolini): support multi-threaded reading
@@ -171,7 +198,89 @@ class TextFileReaderReadOp : public Operator<CPUContext> {
   }
 
  private:
+  // Cuts the batch out of the file under the lock and parses it outside of
+  // it, with the rows split over the workspace's thread pool.
+  bool ReadChunk(
+      TextFileReaderInstance* instance,
+      const std::vector<char*>& datas) {
+    const int numFields = datas.size();
+    size_t rowsBefore;
+    {
+      std::lock_guard<std::mutex> guard(instance->globalMutex_);
+      instance->rowReader.next(batchSize_, chunk_, rowEnds_);
+      rowsBefore = instance->rowsRead;
+      instance->rowsRead += rowEnds_.size();
+    }
+    const size_t rowsRead = rowEnds_.size();
+
+    // Split the rows into chunks of about the same number of bytes.
+    const size_t numBytes = rowsRead ? rowEnds_.back() : 0;
+    const size_t numChunks = std::max<size_t>(
+        1,
+        std::min<size_t>(
+            instance->numThreads,
+            std::min(rowsRead, numBytes / kMinBytesPerChunk)));
+    std::vector<size_t> chunkRows(numChunks + 1, rowsRead);
+    chunkRows[0] = 0;
+    for (size_t c = 1; c < numChunks; ++c) {
+      // the rows ending before the boundary go to the previous chunks
+      chunkRows[c] = std::upper_bound(
+                         rowEnds_.begin(),
+                         rowEnds_.end(),
+                         numBytes * c / numChunks) -
+          rowEnds_.begin();
+    }
+
+    auto parse = [&](int /* unused */, size_t c) {
+      const size_t firstRow = chunkRows[c];
+      const size_t lastRow = chunkRows[c + 1];
+      if (firstRow == lastRow) {
+        return;
+      }
+      char* start = &chunk_[firstRow == 0 ? 0 : rowEnds_[firstRow - 1]];
+      char* end = &chunk_[0] + rowEnds_[lastRow - 1];
+      Tokenizer tokenizer(instance->delimiters, instance->escapeChar);
+      TokenizedString tokenized;
+      tokenizer.next(start, end, tokenized);
+      const auto& tokens = tokenized.tokens();
+      for (size_t i = 0; i < tokens.size(); ++i) {
+        const size_t row = firstRow + i / numFields;
+        const int field = i % numFields;
+        CAFFE_ENFORCE(
+            row < lastRow && (field == 0) == (tokens[i].startDelimId == 0),
+            "Invalid number of columns at row ",
+            rowsBefore + row + 1);
+        convert(
+            (TensorProto_DataType)instance->fieldTypes[field],
+            tokens[i].start,
+            tokens[i].end,
+            datas[field] + row * instance->fieldByteSizes[field]);
+      }
+      CAFFE_ENFORCE(
+          tokens.size() == (lastRow - firstRow) * numFields,
+          "Invalid number of columns at row ",
+          rowsBefore + lastRow);
+    };
+    if (numChunks > 1) {
+      ws_->GetThreadPool()->runChunks(parse, numChunks);
+    } else {
+      parse(0, 0);
+    }
+
+    for (int i = 0; i < numFields; ++i) {
+      Output(i)->Shrink(rowsRead);
+    }
+    return true;
+  }
+
+  // Fewer bytes than this per thread are not worth the dispatch overhead.
+  static constexpr size_t kMinBytesPerChunk = 65536;
+
   TIndex batchSize_;
+  Workspace* ws_;
+  // Text of the rows of the batch being read and the end of each row in it
+  std::string chunk_;
+  std::vector<size_t> rowEnds_;
 };
 
 CAFFE_KNOWN_TYPE(std::unique_ptr<TextFileReaderInstance>);
@@ -185,6 +294,11 @@ OPERATOR_SCHEMA(CreateTextFileReader)
     .SetDoc("Create a text file reader. Fields are delimited by <TAB>.")
     .Arg("filename", "Path to the file.")
     .Arg("num_passes", "Number of passes over the file.")
+    .Arg(
+        "num_threads",
+        "Number of threads parsing each batch. With more than one, the file "
+        "is read in large blocks and the rows of a batch are parsed in "
+        "parallel on the workspace's thread pool. Defaults to 1.")
     .Arg(
         "field_types",
         "List with type of each field. Type enum is found at core.DataType.")
@@ -17,6 +17,7 @@
 #include "caffe2/operators/text_file_reader_utils.h"
 
 #include <fcntl.h>
+#include <cstdlib>
 #include <cstring>
 #include <sstream>
 
@@ -93,6 +94,127 @@ void Tokenizer::next(char* start, char* end, TokenizedString& tokenized) {
   }
 }
 
+size_t BufferedRowReader::next(
+    size_t maxRows,
+    std::string& chunk,
+    std::vector<size_t>& rowEnds) {
+  rowEnds.clear();
+  // end of the last complete row found
+  size_t end = start_;
+  while (rowEnds.size() < maxRows) {
+    const void* found = nullptr;
+    if (scanned_ < buffer_.size()) {
+      found = std::memchr(
+          buffer_.data() + scanned_, rowDelim_, buffer_.size() - scanned_);
+    }
+    if (found) {
+      const size_t delimPos = static_cast<const char*>(found) - buffer_.data();
+      scanned_ = delimPos + 1;
+      if (!isEscaped(delimPos)) {
+        end = delimPos + 1;
+        rowEnds.push_back(end - start_);
+      }
+      continue;
+    }
+    // Drop the rows handed out before reading more.
+    if (start_ > 0) {
+      buffer_.erase(0, start_);
+      scanned_ -= start_;
+      end -= start_;
+      start_ = 0;
+    }
+    if (!fill(end)) {
+      break;
+    }
+  }
+  chunk.assign(buffer_, start_, end - start_);
+  start_ = end;
+  return rowEnds.size();
+}
+
+bool BufferedRowReader::fill(size_t end) {
+  while (pass_ < numPasses_) {
+    CharRange range;
+    (*provider_)(range);
+    if (range.start != nullptr) {
+      buffer_.append(range.start, range.end);
+      return true;
+    }
+    buffer_.resize(end);
+    scanned_ = end;
+    ++pass_;
+    if (pass_ < numPasses_) {
+      provider_->reset();
+    }
+  }
+  return false;
+}
+
+bool BufferedRowReader::isEscaped(size_t delimPos) const {
+  // An escape character escapes the next one, so only an odd run of them
+  // escapes the delimiter.
+  size_t numEscapes = 0;
+  while (delimPos > numEscapes &&
+         buffer_[delimPos - numEscapes - 1] == escape_) {
+    ++numEscapes;
+  }
+  return numEscapes % 2 == 1;
+}
+
+bool ParseFloat(const char* start, const char* end, float* value) {
+  // Powers of ten exactly representable as floats
+  static const float kPow10[] = {
+      1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+  const char* ch = start;
+  bool negative = false;
+  if (ch < end && (*ch == '-' || *ch == '+')) {
+    negative = *ch == '-';
+    ++ch;
+  }
+  // The mantissa is exact as long as it fits in the 24 bits of a float.
+  uint32_t mantissa = 0;
+  int exponent = 0;
+  int numDigits = 0;
+  bool exact = true;
+  for (; ch < end && *ch >= '0' && *ch <= '9'; ++ch, ++numDigits) {
+    mantissa = mantissa * 10 + (*ch - '0');
+    exact = exact && mantissa < (1 << 24);
+  }
+  if (ch < end && *ch == '.') {
+    for (++ch; ch < end && *ch >= '0' && *ch <= '9'; ++ch, ++numDigits) {
+      mantissa = mantissa * 10 + (*ch - '0');
+      exact = exact && mantissa < (1 << 24);
+      --exponent;
+    }
+  }
+  if (exact && numDigits > 0 && ch == end && exponent >= -10) {
+    // A single correctly rounded operation on exact operands.
+    float result = static_cast<float>(mantissa) / kPow10[-exponent];
+    *value = negative ? -result : result;
+    return true;
+  }
+
+  // Exponents, long numbers, inf and nan. strtof needs a terminated string.
+  char buffer[64];
+  std::string copy;
+  const size_t size = end - start;
+  const char* str = buffer;
+  if (size < sizeof(buffer)) {
+    std::memcpy(buffer, start, size);
+    buffer[size] = '\0';
+  } else {
+    copy.assign(start, end);
+    str = copy.c_str();
+  }
+  char* strEnd;
+  float result = strtof(str, &strEnd);
+  if (strEnd == str) {
+    return false;
+  }
+  *value = result;
+  return true;
+}
+
 FileReader::FileReader(const std::string& path, size_t bufferSize)
     : bufferSize_(bufferSize), buffer_(new char[bufferSize]) {
   fd_ = open(path.c_str(), O_RDONLY, 0777);
@@ -120,6 +120,53 @@ class BufferedTokenizer {
   int pass_{0};
 };
 
+// Cuts the text given by a StringProvider into chunks of complete rows, so
+// that the rows of a chunk can be tokenized independently of the others, e.g.
+// on several threads. A row delimiter preceded by an escape character does
+// not end a row. Like BufferedTokenizer, an unterminated last row of a pass is
+// dropped.
+class BufferedRowReader {
+ public:
+  BufferedRowReader(
+      StringProvider* p,
+      char rowDelim,
+      char escape,
+      int numPasses = 1)
+      : provider_(p),
+        rowDelim_(rowDelim),
+        escape_(escape),
+        numPasses_(numPasses) {}
+
+  // Moves up to maxRows complete rows into chunk and the offset just past
+  // each of them into rowEnds. Returns the number of rows, 0 once all the
+  // passes are done.
+  size_t next(size_t maxRows, std::string& chunk, std::vector<size_t>& rowEnds);
+
+ private:
+  // Appends the next range of the provider to buffer_, moving on to the next
+  // pass at the end of one and dropping what follows end. Returns false once
+  // all the passes are done.
+  bool fill(size_t end);
+  bool isEscaped(size_t delimPos) const;
+
+  StringProvider* provider_;
+  const char rowDelim_;
+  const char escape_;
+  int numPasses_;
+  int pass_{0};
+  std::string buffer_;
+  // beginning of the first row of buffer_ not handed out yet
+  size_t start_{0};
+  // everything before it has been searched for row delimiters
+  size_t scanned_{0};
+};
+
+// Parses the float at the beginning of [start, end) like strtof. Plain decimal
+// numbers with few enough digits are converted directly, which gives the same
+// result; anything else goes through strtof. Returns false if [start, end)
+// does not start with a float.
+bool ParseFloat(const char* start, const char* end, float* value);
+
 class FileReader : public StringProvider {
  public:
   explicit FileReader(const std::string& path, size_t bufferSize = 65536);
@@ -135,4 +135,105 @@ TEST(TextFileReaderUtilsTest, TokenizeTest) {
   std::remove(tmpname);
 }
 
+TEST(TextFileReaderUtilsTest, BufferedRowReaderTest) {
+  std::string ch = "a\tb\nc\\\nd\te\n\n\\\\\tf\nunterminated";
+  struct ChunkProvider : public StringProvider {
+    ChunkProvider(const std::string& str, size_t size)
+        : ch(str), chunkSize(size) {}
+    std::string ch;
+    size_t chunkSize;
+    size_t charIdx{0};
+    void operator()(CharRange& range) {
+      if (charIdx >= ch.size()) {
+        range.start = nullptr;
+        range.end = nullptr;
+      } else {
+        size_t endIdx = std::min(charIdx + chunkSize, ch.size());
+        range.start = &ch.front() + charIdx;
+        range.end = &ch.front() + endIdx;
+        charIdx = endIdx;
+      }
+    };
+    void reset() {
+      charIdx = 0;
+    }
+  };
+
+  // The escaped newline stays in its row and the last row is dropped.
+  std::vector<std::string> expected = {
+      "a\tb\n", "c\\\nd\te\n", "\n", "\\\\\tf\n"};
+  for (size_t chunkSize = 1; chunkSize <= ch.size(); ++chunkSize) {
+    for (int numPasses = 1; numPasses <= 2; ++numPasses) {
+      for (size_t maxRows = 1; maxRows <= 5; ++maxRows) {
+        ChunkProvider provider(ch, chunkSize);
+        BufferedRowReader reader(&provider, '\n', '\\', numPasses);
+        std::string chunk;
+        std::vector<size_t> rowEnds;
+        std::vector<std::string> rows;
+        while (reader.next(maxRows, chunk, rowEnds) > 0) {
+          EXPECT_GE(maxRows, rowEnds.size());
+          EXPECT_EQ(chunk.size(), rowEnds.back());
+          size_t start = 0;
+          for (const auto end : rowEnds) {
+            rows.push_back(chunk.substr(start, end - start));
+            start = end;
+          }
+        }
+        EXPECT_EQ(expected.size() * numPasses, rows.size());
+        for (int i = 0; i < rows.size(); ++i) {
+          EXPECT_EQ(expected.at(i % expected.size()), rows.at(i));
+        }
+      }
+    }
+  }
+}
+
+TEST(TextFileReaderUtilsTest, ParseFloatTest) {
+  std::vector<std::string> numbers = {"0",
+                                      "-0",
+                                      "1",
+                                      "+2.5",
+                                      "0.456",
+                                      "-24342.64",
+                                      "0.10101",
+                                      "16777215",
+                                      "16777216",
+                                      "16777217",
+                                      "3.14159265358979",
+                                      "1e10",
+                                      "-1.5E-7",
+                                      "123456.789",
+                                      ".5",
+                                      "7.",
+                                      "1e-45",
+                                      "3.4e38",
+                                      "0.0000000001",
+                                      "0.1234567891",
+                                      "inf",
+                                      "-inf"};
+  for (const auto& number : numbers) {
+    float value = 0;
+    EXPECT_TRUE(ParseFloat(&number.front(), &number.back() + 1, &value))
+        << number;
+    EXPECT_EQ(strtof(number.c_str(), nullptr), value) << number;
+  }
+
+  // Like strtof, trailing characters are ignored.
+  std::string trailing = "1.5abc";
+  float value = 0;
+  EXPECT_TRUE(ParseFloat(&trailing.front(), &trailing.back() + 1, &value));
+  EXPECT_EQ(1.5f, value);
+
+  for (const std::string invalid : {"", "-", ".", "abc"}) {
+    EXPECT_FALSE(
+        ParseFloat(invalid.data(), invalid.data() + invalid.size(), &value))
+        << invalid;
+  }
+
+  // Not terminated, the number must stop at the end of the range.
+  std::string longer = "12345";
+  EXPECT_TRUE(ParseFloat(&longer.front(), &longer.front() + 3, &value));
+  EXPECT_EQ(123.f, value);
+}
+
 } // namespace caffe2
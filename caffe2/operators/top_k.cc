@@ -16,6 +16,10 @@
 
 #include "caffe2/operators/top_k.h"
 
+#include <algorithm>
+#include <queue>
+#include <type_traits>
+
 #include "caffe2/proto/caffe2.pb.h"
 
 namespace caffe2 {
@@ -33,6 +37,75 @@ struct ValueCmp {
   }
 };
 
+// Below this many elements per thread, splitting the work does not pay off.
+constexpr TIndex kTopKMinWorkPerThread = 16384;
+
+// Up to this k, the k largest values are kept in a heap while scanning.
+// Above it, updating the heap costs more than an nth_element pass over a
+// copy of the input.
+constexpr int kTopKMaxHeapSize = 64;
+
+// Replaces top with the k largest (value, index) pairs of candidates, sorted
+// by decreasing value and then increasing index.
+template <typename T>
+void SelectTopK(
+    vector<std::pair<T, TIndex>>& candidates,
+    int k,
+    vector<std::pair<T, TIndex>>* top) {
+  ValueCmp<T> cmp;
+  if (k < candidates.size()) {
+    std::nth_element(
+        candidates.begin(), candidates.begin() + k - 1, candidates.end(), cmp);
+    candidates.resize(k);
+  }
+  std::sort(candidates.begin(), candidates.end(), cmp);
+  top->swap(candidates);
+}
+
+// Replaces top with the min(k, n) largest values of data[0, n), with their
+// indices plus index_offset, sorted as above.
+template <typename T>
+void SelectTopK(
+    const T* data,
+    TIndex n,
+    TIndex index_offset,
+    int k,
+    vector<std::pair<T, TIndex>>* top) {
+  top->clear();
+  if (k > kTopKMaxHeapSize) {
+    vector<std::pair<T, TIndex>> candidates(n);
+    for (TIndex j = 0; j < n; ++j) {
+      candidates[j] = std::make_pair(data[j], j + index_offset);
+    }
+    SelectTopK(candidates, k, top);
+    return;
+  }
+  // Build a min-heap, the heap element is pair of (value, idx)
+  // the top of the heap is the smallest value
+  std::priority_queue<
+      std::pair<T, TIndex>,
+      std::vector<std::pair<T, TIndex>>,
+      ValueCmp<T>>
+      PQ;
+
+  // Maintain the size of heap to be less or equal to k, so the
+  // heap will hold the k largest values
+  for (TIndex j = 0; j < n; ++j) {
+    const auto value = data[j];
+    if (PQ.size() < k || value > PQ.top().first) {
+      PQ.push(std::make_pair(value, j + index_offset));
+    }
+    if (PQ.size() > k) {
+      PQ.pop();
+    }
+  }
+  top->resize(PQ.size());
+  for (auto j = top->size(); j > 0; --j) {
+    (*top)[j - 1] = PQ.top();
+    PQ.pop();
+  }
+}
+
 // Define these two names to allow lookup into the 2d tensors like
 // mytensor(i, j)
 template <typename T>
@@ -58,67 +131,77 @@ bool TopKOp<T, Context>::RunOnDevice() {
   // [5] -> [5]
   CAFFE_ENFORCE(
       in_dims.back() >= k_, "k argment should not be greater than last dim");
-  vector<TIndex> linear_shape = {size_to_dim_(in_dims.size() - 1, in_dims),
-                                 in_dims[in_dims.size() - 1]};
-  auto input_map = ConstEigenMatrixMapRowMajor<T>(
-      static_cast<const T*>(input.raw_data()),
-      linear_shape[0],
-      linear_shape[1]);
+  const TIndex rows = size_to_dim_(in_dims.size() - 1, in_dims);
+  const TIndex cols = in_dims.back();
+  const T* input_data = input.template data<T>();
 
   // Resize output tensors to be the same shape as the linearized input except
   // for the last dimension, which will be of size k. E.x. for an input tensor
   // of shape [3, 4, 5] and k=2, both of these will be shape [3, 4, 2]
-  vector<TIndex> output_linear_shape = {linear_shape[0], k_};
+  vector<TIndex> output_linear_shape = {rows, k_};
   values->Resize(output_linear_shape);
   indices->Resize(output_linear_shape);
   if (flatten_indices) {
-    flatten_indices->Resize(linear_shape[0] * k_);
+    flatten_indices->Resize(rows * k_);
   }
-
-  // Use Eigen maps to allow indexing into the 2d tensors like values_map(i,j)
-  auto values_map = EigenMatrixMapRowMajor<T>(
-      values->template mutable_data<T>(), linear_shape[0], k_);
-  auto indices_map = EigenMatrixMapRowMajor<TIndex>(
-      indices->template mutable_data<TIndex>(), linear_shape[0], k_);
-  auto* flatten_indices_data = flatten_indices
+  T* values_data = values->template mutable_data<T>();
+  TIndex* indices_data = indices->template mutable_data<TIndex>();
+  TIndex* flatten_indices_data = flatten_indices
       ? flatten_indices->template mutable_data<TIndex>()
       : nullptr;
 
-  TIndex flatten_offset = 0;
-  // Sort preserving indices
-  for (TIndex i = 0; i < linear_shape[0]; ++i) {
-    // Build a min-heap, the heap element is pair of (value, idx)
-    // the top of the heap is the smallest value
-    std::priority_queue<
-        std::pair<T, TIndex>,
-        std::vector<std::pair<T, TIndex>>,
-        ValueCmp<T>>
-        PQ;
-
-    // Maintain the size of heap to be less or equal to k_, so the
-    // heap will hold the k_ largest values
-    for (TIndex j = 0; j < linear_shape[1]; ++j) {
-      const auto value = input_map(i, j);
-      if (PQ.size() < k_ || value > PQ.top().first) {
-        PQ.push(std::make_pair(value, j));
-      }
-      if (PQ.size() > k_) {
-        PQ.pop();
-      }
-    }
-    for (TIndex j = 0; j < k_; ++j) {
-      auto& pqElem = PQ.top();
-      values_map(i, k_ - j - 1) = pqElem.first;
-      indices_map(i, k_ - j - 1) = pqElem.second;
+  auto write_row = [&](TIndex i, const vector<std::pair<T, TIndex>>& top) {
+    for (int j = 0; j < k_; ++j) {
+      values_data[i * k_ + j] = top[j].first;
+      indices_data[i * k_ + j] = top[j].second;
       if (flatten_indices_data) {
-        flatten_indices_data[k_ - j - 1] = pqElem.second + flatten_offset;
+        flatten_indices_data[i * k_ + j] = top[j].second + i * cols;
       }
-      PQ.pop();
     }
-    if (flatten_indices_data) {
-      flatten_indices_data += k_;
+  };
+
+  const int num_threads = std::is_same<Context, CPUContext>::value
+      ? std::min<TIndex>(num_threads_, rows * cols / kTopKMinWorkPerThread)
+      : 1;
+  if (num_threads <= 1) {
+    vector<std::pair<T, TIndex>> top;
+    for (TIndex i = 0; i < rows; ++i) {
+      SelectTopK(input_data + i * cols, cols, 0, k_, &top);
+      write_row(i, top);
+    }
+  } else if (rows >= num_threads) {
+    // Enough rows to give every thread a contiguous range of them.
+    ws_->GetThreadPool()->runChunks(
+        [&](int /* unused */, size_t c) {
+          vector<std::pair<T, TIndex>> top;
+          const TIndex end = (c + 1) * rows / num_threads;
+          for (TIndex i = c * rows / num_threads; i < end; ++i) {
+            SelectTopK(input_data + i * cols, cols, 0, k_, &top);
+            write_row(i, top);
+          }
+        },
+        num_threads);
+  } else {
+    // Few long rows: every thread selects the top k of a slice of the row,
+    // and the candidates of the slices are merged.
+    vector<vector<std::pair<T, TIndex>>> slice_tops(num_threads);
+    vector<std::pair<T, TIndex>> candidates, top;
+    for (TIndex i = 0; i < rows; ++i) {
+      const T* row = input_data + i * cols;
+      ws_->GetThreadPool()->runChunks(
+          [&](int /* unused */, size_t c) {
+            const TIndex begin = c * cols / num_threads;
+            const TIndex end = (c + 1) * cols / num_threads;
+            SelectTopK(row + begin, end - begin, begin, k_, &slice_tops[c]);
+          },
+          num_threads);
+      candidates.clear();
+      for (const auto& slice_top : slice_tops) {
+        candidates.insert(candidates.end(), slice_top.begin(), slice_top.end());
+      }
+      SelectTopK(candidates, k_, &top);
+      write_row(i, top);
     }
-    flatten_offset += linear_shape[1];
   }
 
   // Reshape output tensors to [a_1, a_2, ..., a_n, k]
@@ -227,7 +310,12 @@ first.
         "Flatten indices",
         "Tensor of shape [a_1 * a_2 * ... * a_n * k] containing the indices "
         "into the flatten input")
-    .Arg("k", "Number of top elements to retrieve");
+    .Arg("k", "Number of top elements to retrieve")
+    .Arg(
+        "num_threads",
+        "(int, default 1) number of threads of the workspace pool to use on "
+        "CPU. Rows are split between threads, or a single long row is split "
+        "into slices whose top elements are then merged.");
 
 OPERATOR_SCHEMA(TopKGradient).NumInputs(3).NumOutputs(1);
 
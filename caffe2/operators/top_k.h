@@ -20,6 +20,7 @@
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
@@ -29,14 +30,20 @@ class TopKOp : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
 
   TopKOp(const OperatorDef& operator_def, Workspace* ws)
-      : Operator<Context>(operator_def, ws), OP_SINGLE_ARG(int, "k", k_, -1) {
+      : Operator<Context>(operator_def, ws),
+        OP_SINGLE_ARG(int, "k", k_, -1),
+        OP_SINGLE_ARG(int, "num_threads", num_threads_, 1),
+        ws_(ws) {
     CAFFE_ENFORCE(k_ >= 1, "k argument must be >= 1");
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
   }
 
   bool RunOnDevice() override;
 
  private:
   int k_;
+  int num_threads_;
+  Workspace* ws_;
 };
 
 template <typename T, class Context>
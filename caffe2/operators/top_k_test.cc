@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Runs TopK on a [rows, cols] input with many ties and checks its outputs
+// against a full sort of every row.
+void CheckTopK(int rows, int cols, int k, int num_threads) {
+  Workspace ws;
+  auto* X = ws.CreateBlob("X")->GetMutable<TensorCPU>();
+  X->Resize(rows, cols);
+  float* x = X->mutable_data<float>();
+  for (int i = 0; i < X->size(); ++i) {
+    x[i] = (i * 7919) % 1009;
+  }
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "TopK",
+      "",
+      {"X"},
+      {"values", "indices", "flatten_indices"},
+      {MakeArgument("k", k), MakeArgument("num_threads", num_threads)})));
+  const auto& values = ws.GetBlob("values")->Get<TensorCPU>();
+  const auto& indices = ws.GetBlob("indices")->Get<TensorCPU>();
+  const auto& flatten = ws.GetBlob("flatten_indices")->Get<TensorCPU>();
+  ASSERT_EQ(values.dims(), vector<TIndex>({rows, k}));
+  ASSERT_EQ(flatten.size(), rows * k);
+
+  vector<int> order(cols);
+  for (int i = 0; i < rows; ++i) {
+    const float* row = x + i * cols;
+    for (int j = 0; j < cols; ++j) {
+      order[j] = j;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return row[a] > row[b];
+    });
+    for (int j = 0; j < k; ++j) {
+      ASSERT_EQ(indices.data<TIndex>()[i * k + j], order[j]) << i << " " << j;
+      ASSERT_EQ(values.data<float>()[i * k + j], row[order[j]]);
+      ASSERT_EQ(flatten.data<TIndex>()[i * k + j], i * cols + order[j]);
+    }
+  }
+}
+
+} // namespace
+
+TEST(TopKOpTest, SmallAndLargeK) {
+  CheckTopK(5, 100, 3, 1);
+  CheckTopK(5, 1000, 500, 1);
+  CheckTopK(3, 1000, 1000, 1);
+}
+
+TEST(TopKOpTest, SplitsRowsBetweenThreads) {
+  CheckTopK(64, 2000, 10, 4);
+  CheckTopK(64, 2000, 200, 4);
+}
+
+TEST(TopKOpTest, SplitsLongRowsBetweenThreads) {
+  CheckTopK(1, 200000, 10, 4);
+  CheckTopK(2, 100000, 500, 3);
+}
+
+} // namespace caffe2
@@ -15,6 +15,13 @@
  */
 
 #include "caffe2/operators/transpose_op.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "caffe2/perfkernels/transpose.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
 #ifdef CAFFE2_USE_HPTT
 
 #include <hptt.h>
@@ -62,7 +69,175 @@ bool tryRunWithHPTT(const std::vector<int>& axes, const TensorCPU& input, Tensor
 
 namespace caffe2 {
 
+namespace {
+
+// Edge of the square tiles, in matrix elements.
+constexpr int kTransposeTile = 32;
+// Inputs smaller than this many values are not worth spreading over threads.
+constexpr TIndex kMinParallelTransposeSize = 1 << 16;
+
+// Transposes rows [i0, i1) of the M x N matrix x into columns [i0, i1) of y.
+template <typename T>
+void TransposeRows(
+    int i0,
+    int i1,
+    int M,
+    int N,
+    int block,
+    const T* x,
+    T* y) {
+  if (block == 1 && sizeof(T) == sizeof(float)) {
+    transpose_2d(
+        i1 - i0,
+        N,
+        reinterpret_cast<const float*>(x) + i0 * N,
+        N,
+        reinterpret_cast<float*>(y) + i0,
+        M);
+    return;
+  }
+  for (int j0 = 0; j0 < N; j0 += kTransposeTile) {
+    const int j1 = std::min(N, j0 + kTransposeTile);
+    for (int i = i0; i < i1; ++i) {
+      if (block == 1) {
+        for (int j = j0; j < j1; ++j) {
+          y[j * M + i] = x[i * N + j];
+        }
+      } else {
+        for (int j = j0; j < j1; ++j) {
+          memcpy(
+              y + (TIndex(j) * M + i) * block,
+              x + (TIndex(i) * N + j) * block,
+              block * sizeof(T));
+        }
+      }
+    }
+  }
+}
+
+// Merges the axes that stay next to each other in the output and drops axes
+// of size 1. Returns true if what is left is a batched 2-D transpose, that is
+// the permutation (1, 0), (0, 2, 1), (1, 0, 2) or (0, 2, 1, 3) of the merged
+// input dims [batch,] M, N[, block].
+bool GetBatched2DTranspose(
+    const vector<TIndex>& dims,
+    const vector<int>& axes,
+    int* batch,
+    int* M,
+    int* N,
+    int* block) {
+  // Ranks of the axes of size > 1 in input order, listed in output order.
+  vector<int> rank(dims.size(), -1);
+  int num_kept = 0;
+  for (int i = 0; i < dims.size(); ++i) {
+    if (dims[i] != 1) {
+      rank[i] = num_kept++;
+    }
+  }
+  vector<int> out_ranks;
+  for (int axis : axes) {
+    if (rank[axis] >= 0) {
+      out_ranks.push_back(rank[axis]);
+    }
+  }
+  vector<TIndex> kept_dims;
+  for (auto d : dims) {
+    if (d != 1) {
+      kept_dims.push_back(d);
+    }
+  }
+  // Groups of consecutive ranks, in output order, as [first rank, size).
+  vector<std::pair<int, TIndex>> groups;
+  for (int i = 0; i < out_ranks.size(); ++i) {
+    if (i > 0 && out_ranks[i] == out_ranks[i - 1] + 1) {
+      groups.back().second *= kept_dims[out_ranks[i]];
+    } else {
+      groups.emplace_back(out_ranks[i], kept_dims[out_ranks[i]]);
+    }
+  }
+  if (groups.size() < 2 || groups.size() > 4) {
+    return false;
+  }
+  // The position of each group in input order.
+  vector<int> perm(groups.size());
+  vector<TIndex> sizes(groups.size());
+  for (int i = 0; i < groups.size(); ++i) {
+    int pos = 0;
+    for (const auto& g : groups) {
+      pos += g.first < groups[i].first;
+    }
+    perm[i] = pos;
+    sizes[pos] = groups[i].second;
+  }
+  const vector<vector<int>> kPatterns = {
+      {1, 0}, {0, 2, 1}, {1, 0, 2}, {0, 2, 1, 3}};
+  if (std::find(kPatterns.begin(), kPatterns.end(), perm) == kPatterns.end()) {
+    return false;
+  }
+  const bool has_batch = perm.front() == 0;
+  const bool has_block = perm.back() == int(perm.size()) - 1;
+  int k = 0;
+  const TIndex b = has_batch ? sizes[k++] : 1;
+  const TIndex m = sizes[k++];
+  const TIndex n = sizes[k++];
+  const TIndex blk = has_block ? sizes[k++] : 1;
+  const TIndex kMax = std::numeric_limits<int>::max();
+  if (b * m * n * blk > kMax) {
+    return false;
+  }
+  *batch = b;
+  *M = m;
+  *N = n;
+  *block = blk;
+  return true;
+}
+
+} // namespace
 
+template <typename T>
+void TransposeBatched2D(
+    int batch,
+    int M,
+    int N,
+    int block,
+    const T* x,
+    T* y,
+    int num_threads,
+    ThreadPool* pool) {
+  const int tiles_per_matrix = (M + kTransposeTile - 1) / kTransposeTile;
+  const TIndex num_tiles = TIndex(batch) * tiles_per_matrix;
+  auto run_tiles = [&](TIndex begin, TIndex end) {
+    for (TIndex t = begin; t < end; ++t) {
+      const TIndex b = t / tiles_per_matrix;
+      const int i0 = (t % tiles_per_matrix) * kTransposeTile;
+      const int i1 = std::min(M, i0 + kTransposeTile);
+      const TIndex offset = b * M * N * block;
+      TransposeRows(i0, i1, M, N, block, x + offset, y + offset);
+    }
+  };
+  const TIndex size = TIndex(batch) * M * N * block;
+  const TIndex num_chunks = (pool && size >= kMinParallelTransposeSize)
+      ? std::min<TIndex>(num_threads, num_tiles)
+      : 1;
+  if (num_chunks <= 1) {
+    run_tiles(0, num_tiles);
+    return;
+  }
+  pool->runChunks(
+      [&](int /* unused */, size_t c) {
+        run_tiles(c * num_tiles / num_chunks, (c + 1) * num_tiles / num_chunks);
+      },
+      num_chunks);
+}
+
+template void TransposeBatched2D<float>(
+    int, int, int, int, const float*, float*, int, ThreadPool*);
+template void TransposeBatched2D<double>(
+    int, int, int, int, const double*, double*, int, ThreadPool*);
+template void TransposeBatched2D<int>(
+    int, int, int, int, const int*, int*, int, ThreadPool*);
+template void TransposeBatched2D<long>(
+    int, int, int, int, const long*, long*, int, ThreadPool*);
 
 #define COMPILE_TIME_MAX_TRANSPOSE_DIMS 10
 
@@ -78,6 +253,20 @@ bool TransposeOp<CPUContext>::DoRunWithType() {
   }
 #endif
 
+  int batch, M, N, block;
+  if (GetBatched2DTranspose(input.dims(), axes_, &batch, &M, &N, &block)) {
+    TransposeBatched2D<T>(
+        batch,
+        M,
+        N,
+        block,
+        input.template data<T>(),
+        output->template mutable_data<T>(),
+        num_threads_,
+        num_threads_ > 1 ? ws_->GetThreadPool() : nullptr);
+    return true;
+  }
+
   int from_inds[COMPILE_TIME_MAX_TRANSPOSE_DIMS] = {0};
   size_t count = input.size();
   int num_axes = axes_.size();
@@ -209,6 +398,10 @@ will be (2, 1, 3).
         "axes",
         "A list of integers. By default, reverse the dimensions, "
         "otherwise permute the axes according to the values given.")
+    .Arg(
+        "num_threads",
+        "(int, default 1) number of threads of the workspace pool to spread "
+        "large transposes over.")
     .Input(0, "data", "An input tensor.")
     .Output(0, "transposed", "Transposed output.");
 
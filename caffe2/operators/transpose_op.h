@@ -24,6 +24,23 @@
 
 namespace caffe2 {
 
+class ThreadPool;
+
+// Transposes a batch of M x N matrices x into the N x M matrices y, where each
+// matrix element is a block of `block` contiguous values. Works on square
+// tiles, which are spread over up to num_threads threads of pool for large
+// inputs. Defined for float, double, int and long.
+template <typename T>
+void TransposeBatched2D(
+    int batch,
+    int M,
+    int N,
+    int block,
+    const T* x,
+    T* y,
+    int num_threads,
+    ThreadPool* pool);
+
 template <class Context>
 class TransposeOp final : public Operator<Context> {
  public:
@@ -31,7 +48,10 @@ class TransposeOp final : public Operator<Context> {
   USE_DISPATCH_HELPER;
   TransposeOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        axes_(OperatorBase::GetRepeatedArgument<int>("axes")) {
+        axes_(OperatorBase::GetRepeatedArgument<int>("axes")),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
     // We will check the legality of axes_: it should be from 0 to axes_.size().
     std::vector<int> axes_sorted(axes_);
     std::sort(axes_sorted.begin(), axes_sorted.end());
@@ -71,6 +91,9 @@ class TransposeOp final : public Operator<Context> {
 
   std::vector<int> axes_;
   std::vector<TIndex> new_dims_;
+  // Only used by the CPU implementation.
+  const int num_threads_;
+  Workspace* ws_;
   // buffer_ is used in TransposeOp<CUDAContext> so we can obtain a consistent
   // buffer on the GPU. It is not used in the CPUContext implementation.
   Tensor<Context> buffer_;
@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/transpose_op.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Fills X with 0, 1, 2, ... and runs the given operator on it.
+template <typename T>
+const TensorCPU& RunOnIota(
+    Workspace* ws,
+    const string& type,
+    const vector<TIndex>& dims,
+    const vector<Argument>& args) {
+  auto* X = ws->CreateBlob("X")->GetMutable<TensorCPU>();
+  X->Resize(dims);
+  for (int i = 0; i < X->size(); ++i) {
+    X->template mutable_data<T>()[i] = i;
+  }
+  OperatorDef def = CreateOperatorDef(type, "", {"X"}, {"Y"}, args);
+  auto op = CreateOperator(def, ws);
+  EXPECT_TRUE(op->Run());
+  return ws->GetBlob("Y")->Get<TensorCPU>();
+}
+
+// Checks Y against a direct evaluation of Y[i] = X[axes(i)] for X = iota.
+template <typename T>
+void CheckTranspose(
+    const vector<TIndex>& dims,
+    const vector<int>& axes,
+    int num_threads) {
+  Workspace ws;
+  const auto& Y = RunOnIota<T>(
+      &ws,
+      "Transpose",
+      dims,
+      {MakeArgument("axes", axes),
+       MakeArgument<int>("num_threads", num_threads)});
+  const int ndim = dims.size();
+  vector<TIndex> x_strides(ndim, 1);
+  for (int i = ndim - 2; i >= 0; --i) {
+    x_strides[i] = x_strides[i + 1] * dims[i + 1];
+  }
+  ASSERT_EQ(Y.ndim(), ndim);
+  vector<TIndex> index(ndim, 0);
+  for (int i = 0; i < Y.size(); ++i) {
+    TIndex x_index = 0;
+    for (int d = 0; d < ndim; ++d) {
+      x_index += index[d] * x_strides[axes[d]];
+    }
+    ASSERT_EQ(Y.template data<T>()[i], T(x_index)) << i;
+    for (int d = ndim - 1; d >= 0 && ++index[d] == Y.dim(d); --d) {
+      index[d] = 0;
+    }
+  }
+}
+
+} // namespace
+
+TEST(TransposeOpTest, BatchedTwoDimensional) {
+  for (int num_threads : {1, 4}) {
+    CheckTranspose<float>({67, 45}, {1, 0}, num_threads);
+    CheckTranspose<float>({3, 40, 129}, {0, 2, 1}, num_threads);
+    // NCHW to NHWC and back, as the order switch ops do.
+    CheckTranspose<float>({2, 37, 24, 19}, {0, 2, 3, 1}, num_threads);
+    CheckTranspose<float>({2, 24, 19, 37}, {0, 3, 1, 2}, num_threads);
+    // Attention heads: the innermost dim moves as a block.
+    CheckTranspose<float>({2, 33, 4, 8}, {0, 2, 1, 3}, num_threads);
+    CheckTranspose<double>({3, 40, 129}, {0, 2, 1}, num_threads);
+    CheckTranspose<int>({40, 1, 129}, {2, 1, 0}, num_threads);
+    CheckTranspose<long>({5, 6, 7}, {1, 0, 2}, num_threads);
+  }
+  // Large enough to be split over the threads.
+  CheckTranspose<float>({8, 96, 300}, {0, 2, 1}, 4);
+}
+
+TEST(TransposeOpTest, GeneralPermutations) {
+  CheckTranspose<float>({3, 4, 5}, {2, 1, 0}, 1);
+  CheckTranspose<float>({2, 3, 4, 5}, {3, 1, 2, 0}, 1);
+  CheckTranspose<int>({2, 3, 4, 5, 6}, {4, 0, 3, 1, 2}, 1);
+}
+
+TEST(TransposeOpTest, OrderSwitch) {
+  const vector<TIndex> nchw = {3, 20, 17, 9};
+  Workspace ws;
+  const auto& nhwc = RunOnIota<float>(
+      &ws, "NCHW2NHWC", nchw, {MakeArgument<int>("num_threads", 2)});
+  TensorCPU Y(nhwc);
+  OperatorDef def = CreateOperatorDef("NHWC2NCHW", "", {"Y"}, {"Z"});
+  ASSERT_TRUE(CreateOperator(def, &ws)->Run());
+  const auto& Z = ws.GetBlob("Z")->Get<TensorCPU>();
+  EXPECT_EQ(Y.dims(), vector<TIndex>({3, 17, 9, 20}));
+  EXPECT_EQ(Y.data<float>()[1], 17 * 9);
+  EXPECT_EQ(Z.dims(), nchw);
+  for (int i = 0; i < Z.size(); ++i) {
+    ASSERT_EQ(Z.data<float>()[i], i);
+  }
+}
+
+} // namespace caffe2
@@ -21,14 +21,21 @@
 #include <mkl.h>
 #endif // CAFFE2_USE_MKL
 
-#include "Eigen/Core"
-#include "Eigen/Dense"
+#include <algorithm>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/utils/math.h"
 
 namespace caffe2 {
 
+// Computes Y = X * W + b where the weight W of the fully connected layer is
+// given by its TT-cores. The cores are applied one at a time, from the last
+// to the first, to a chunk of the batch whose intermediate results fit in
+// two buffers of kBufferSize elements. The intermediate of a chunk is laid
+// out so that every step is a set of GEMMs with no transpose in between:
+// before core i it is [o_{i+1}..o_{d-1}][b][i_0..i_i][r_{i+1}], and the
+// first core writes every row of Y directly.
 template <typename T, class Context, class Engine = DefaultEngine>
 class TTLinearOp final : public Operator<Context> {
  public:
@@ -37,8 +44,7 @@ class TTLinearOp final : public Operator<Context> {
       : Operator<Context>(operator_def, ws),
         inp_sizes_(OperatorBase::GetRepeatedArgument<int>("inp_sizes")),
         out_sizes_(OperatorBase::GetRepeatedArgument<int>("out_sizes")),
-        tt_ranks_(OperatorBase::GetRepeatedArgument<int>("tt_ranks")),
-        Y_temp_(unique_ptr<Blob>(new Blob())) {}
+        tt_ranks_(OperatorBase::GetRepeatedArgument<int>("tt_ranks")) {}
   ~TTLinearOp() {}
 
   bool RunOnDevice() override {
@@ -55,99 +61,138 @@ class TTLinearOp final : public Operator<Context> {
         inp_sizes_.size(),
         ", out_sizes has size: ",
         out_sizes_.size());
+    CAFFE_ENFORCE(
+        tt_ranks_.size() == inp_sizes_.size() + 1,
+        "tt_ranks has size: ",
+        tt_ranks_.size(),
+        ", inp_sizes has size: ",
+        inp_sizes_.size());
+    CAFFE_ENFORCE(
+        tt_ranks_.front() == 1 && tt_ranks_.back() == 1,
+        "The first and last TT-ranks must be 1.");
     CAFFE_ENFORCE(
         cores.ndim() == 1, "Number of dimensions in cores: ", cores.ndim());
     // batch size
-    const int batch_size = X.ndim() > 1 ? X.dim32(0) : 1;
+    const int batch_size = X.dim32(0);
 
     // dimension d of tensors
     const int d = inp_sizes_.size();
+    CAFFE_ENFORCE_GT(d, 0);
 
-    // Keep track of index of current core in multiplication
-    int cores_idx = 0;
-
-    // Temporary buffer to facilitate multiplication of TT-cores with input
-    auto Y_buf = Y_temp_->GetMutable<Tensor<Context>>();
-    Y_buf->ResizeLike(X);
-    Y_buf->CopyFrom(X);
-
-    // The overall forward pass involves multiplication with each core, where
-    // each core has sizes dictated by inp_sizes_ and out_sizes_. Each core thus
-    // has size inp_sizes_[i] * tt_ranks_[i] * tt_ranks_[i + 1] * out_sizes_[i].
-    for (int i = (d - 1); i >= 0; --i) {
-      int curr_rows = inp_sizes_[i] * tt_ranks_[i + 1];
-      int curr_cols = tt_ranks_[i] * out_sizes_[i];
-
-      // TODO Replace by Reshape(), once wrappers are written
-      Y_buf->Resize(Y_buf->size() / curr_rows, curr_rows);
-      Y->Resize(Y_buf->size() / curr_rows, curr_cols);
-
-      // Defensive checks
-      CAFFE_ENFORCE(Y_buf->size() % curr_rows == 0, Y_buf->size(), curr_rows);
-      CAFFE_ENFORCE(
-          cores_idx + curr_rows * curr_cols <= cores.size(),
-          cores_idx + curr_rows * curr_cols,
-          cores.size());
-
-      // Multiply ith core with the intermediate output
-      math::Gemm<float, Context, Engine>(
-          CblasNoTrans,
-          CblasNoTrans,
-          Y_buf->size() / curr_rows,
-          curr_cols,
-          curr_rows,
-          1,
-          Y_buf->template data<float>(),
-          cores.template data<float>() + cores_idx,
-          0,
-          Y->template mutable_data<float>(),
-          &context_);
+    int inp_size = 1;
+    int out_size = 1;
+    for (int i = 0; i < d; ++i) {
+      inp_size *= inp_sizes_[i];
+      out_size *= out_sizes_[i];
+    }
+    CAFFE_ENFORCE(
+        X.size_from_dim(1) == inp_size,
+        "Input dimension of X: ",
+        X.size_from_dim(1),
+        ", product of inp_sizes: ",
+        inp_size);
+
+    // The cores are stored from the last to the first, and the ith core is a
+    // (inp_sizes_[i] * tt_ranks_[i + 1]) x (tt_ranks_[i] * out_sizes_[i])
+    // matrix. It is repacked as out_sizes_[i] matrices of
+    // (inp_sizes_[i] * tt_ranks_[i + 1]) x tt_ranks_[i], one per output
+    // index, so that each writes its own plane of the next intermediate.
+    vector<int> cores_offsets(d);
+    int cores_size = 0;
+    for (int i = d - 1; i >= 0; --i) {
+      cores_offsets[i] = cores_size;
+      cores_size +=
+          inp_sizes_[i] * tt_ranks_[i + 1] * tt_ranks_[i] * out_sizes_[i];
+    }
+    CAFFE_ENFORCE(
+        cores_size <= cores.size(), "cores must have ", cores_size, " values");
+    packed_cores_.Resize(cores_size);
+    const T* cores_data = cores.template data<T>();
+    T* packed_data = packed_cores_.template mutable_data<T>();
+    for (int i = 0; i < d; ++i) {
+      const int rows = inp_sizes_[i] * tt_ranks_[i + 1];
+      const int rank = tt_ranks_[i];
+      const int outs = out_sizes_[i];
+      const T* core = cores_data + cores_offsets[i];
+      T* packed = packed_data + cores_offsets[i];
+      for (int o = 0; o < outs; ++o) {
+        for (int k = 0; k < rows; ++k) {
+          for (int r = 0; r < rank; ++r) {
+            packed[(o * rows + k) * rank + r] = core[(k * rank + r) * outs + o];
+          }
+        }
+      }
+    }
 
-      CAFFE_ENFORCE(Y->size() % out_sizes_[i] == 0, Y->size(), out_sizes_[i]);
-
-      // TODO Add GPU support by writing a generic wrapper.
-      auto Y_mat = EigenMatrixMap<float>(
-          Y->template mutable_data<float>(),
-          Y->size() / out_sizes_[i],
-          out_sizes_[i]);
-      Y_mat = ConstEigenMatrixMap<float>(
-                  Y->template data<float>(),
-                  out_sizes_[i],
-                  Y->size() / out_sizes_[i])
-                  .transpose()
-                  .eval();
-
-      // Resize operation
-      Y_buf->Resize(Y->dim32(0), Y->dim32(1));
-      context_.template Copy<float, CPUContext, CPUContext>(
-          Y->size(),
-          Y->template data<float>(),
-          Y_buf->template mutable_data<float>());
-
-      cores_idx += curr_rows * curr_cols;
+    // The largest intermediate of a single row of X decides how many rows
+    // are carried through the cores together.
+    int max_row_size = inp_size;
+    for (int i = d - 1, outer = 1, inner = inp_size; i > 0; --i) {
+      inner /= inp_sizes_[i];
+      outer *= out_sizes_[i];
+      max_row_size = std::max(max_row_size, outer * inner * tt_ranks_[i]);
+    }
+    const int chunk =
+        std::max(1, std::min(batch_size, kBufferSize / max_row_size));
+    for (auto& buffer : buffers_) {
+      buffer.Resize(chunk * max_row_size);
     }
 
-    // TODO Add GPU support by writing a generic wrapper.
-    auto Y_mat = EigenMatrixMap<float>(
-        Y->template mutable_data<float>(), batch_size, Y->size() / batch_size);
-    Y_mat = ConstEigenMatrixMap<float>(
-                Y->template data<float>(), Y->size() / batch_size, batch_size)
-                .transpose()
-                .eval();
-    // TODO Replace by Reshape(), once wrappers are written
-    Y->Resize(batch_size, Y->size() / batch_size);
-
-    // Check that output size of Y is the element-wise product of out_sizes
-    int prod_out_sizes = 1;
-    for (int i = 0; i < out_sizes_.size(); i++) {
-      prod_out_sizes *= out_sizes_[i];
+    Y->Resize(batch_size, out_size);
+    const T* X_data = X.template data<T>();
+    T* Y_data = Y->template mutable_data<T>();
+    for (int begin = 0; begin < batch_size; begin += chunk) {
+      const int rows = std::min(chunk, batch_size - begin);
+      const T* src = X_data + begin * inp_size;
+      int src_size = rows * inp_size;
+      for (int i = d - 1; i > 0; --i) {
+        const int K = inp_sizes_[i] * tt_ranks_[i + 1];
+        const int M = src_size / K;
+        const int N = tt_ranks_[i];
+        const T* packed = packed_data + cores_offsets[i];
+        T* dst = buffers_[i % 2].template mutable_data<T>();
+        for (int o = 0; o < out_sizes_[i]; ++o) {
+          math::GemmEx<T, Context, Engine>(
+              CblasNoTrans,
+              CblasNoTrans,
+              M,
+              N,
+              K,
+              1,
+              src,
+              K,
+              packed + o * K * N,
+              N,
+              0,
+              dst + o * M * N,
+              N,
+              &context_);
+        }
+        src = dst;
+        src_size = out_sizes_[i] * M * N;
+      }
+      // The first core, a tt_ranks_[0] = 1 wide matrix per output index,
+      // reads the (o_1..o_{d-1}) x (i_0, r_1) slice of every row and writes
+      // its o_0 x (o_1..o_{d-1}) block of Y.
+      const int K = inp_sizes_[0] * tt_ranks_[1];
+      for (int n = 0; n < rows; ++n) {
+        math::GemmEx<T, Context, Engine>(
+            CblasNoTrans,
+            CblasTrans,
+            out_sizes_[0],
+            out_size / out_sizes_[0],
+            K,
+            1,
+            packed_data + cores_offsets[0],
+            K,
+            src + n * K,
+            rows * K,
+            0,
+            Y_data + (begin + n) * out_size,
+            out_size / out_sizes_[0],
+            &context_);
+      }
     }
-    CAFFE_ENFORCE(
-        Y->dim32(1) == prod_out_sizes,
-        "Output dimension of Y: ",
-        Y->dim32(1),
-        ", product of out_sizes: ",
-        prod_out_sizes);
 
     // Add bias term
     if (bias_multiplier_.size() != batch_size) {
@@ -175,11 +220,15 @@ class TTLinearOp final : public Operator<Context> {
   }
 
  protected:
+  // Elements of each of the two buffers holding the intermediate results.
+  static constexpr int kBufferSize = 1 << 17;
+
   Tensor<Context> bias_multiplier_;
   std::vector<int> inp_sizes_;
   std::vector<int> out_sizes_;
   std::vector<int> tt_ranks_;
-  std::unique_ptr<Blob> Y_temp_;
+  Tensor<Context> packed_cores_;
+  Tensor<Context> buffers_[2];
 };
 
 // TODO: Complete after verifying utility of TT-layer's forward pass.
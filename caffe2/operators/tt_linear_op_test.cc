@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <random>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+vector<float> RandomValues(int size, std::mt19937* gen) {
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  vector<float> values(size);
+  for (auto& v : values) {
+    v = dist(*gen);
+  }
+  return values;
+}
+
+void SetTensor(
+    Workspace* ws,
+    const string& name,
+    const vector<TIndex>& dims,
+    const vector<float>& values) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  std::copy(values.begin(), values.end(), tensor->mutable_data<float>());
+}
+
+// Expands the cores, stored from the last to the first, into the dense
+// inp_size x out_size weight, one entry at a time.
+vector<float> DenseWeight(
+    const vector<int>& inp_sizes,
+    const vector<int>& out_sizes,
+    const vector<int>& tt_ranks,
+    const vector<float>& cores) {
+  const int d = inp_sizes.size();
+  vector<int> offsets(d);
+  int offset = 0;
+  int inp_size = 1;
+  int out_size = 1;
+  for (int i = d - 1; i >= 0; --i) {
+    offsets[i] = offset;
+    offset += inp_sizes[i] * tt_ranks[i + 1] * tt_ranks[i] * out_sizes[i];
+    inp_size *= inp_sizes[i];
+    out_size *= out_sizes[i];
+  }
+  vector<float> weight(inp_size * out_size);
+  for (int in = 0; in < inp_size; ++in) {
+    for (int out = 0; out < out_size; ++out) {
+      vector<float> chain(1, 1.f);
+      for (int i = 0, in_rest = in, out_rest = out, in_div = inp_size,
+               out_div = out_size;
+           i < d;
+           ++i) {
+        in_div /= inp_sizes[i];
+        out_div /= out_sizes[i];
+        const int x = in_rest / in_div;
+        const int o = out_rest / out_div;
+        in_rest %= in_div;
+        out_rest %= out_div;
+        vector<float> next(tt_ranks[i + 1], 0.f);
+        for (int s = 0; s < tt_ranks[i + 1]; ++s) {
+          for (int r = 0; r < tt_ranks[i]; ++r) {
+            next[s] += chain[r] *
+                cores[offsets[i] +
+                      ((x * tt_ranks[i + 1] + s) * tt_ranks[i] + r) *
+                          out_sizes[i] +
+                      o];
+          }
+        }
+        chain = next;
+      }
+      weight[in * out_size + out] = chain[0];
+    }
+  }
+  return weight;
+}
+
+void ExpectMatchesDense(
+    int batch_size,
+    const vector<int>& inp_sizes,
+    const vector<int>& out_sizes,
+    const vector<int>& tt_ranks) {
+  std::mt19937 gen(1701);
+  int inp_size = 1;
+  int out_size = 1;
+  int cores_size = 0;
+  for (int i = 0; i < inp_sizes.size(); ++i) {
+    inp_size *= inp_sizes[i];
+    out_size *= out_sizes[i];
+    cores_size += inp_sizes[i] * tt_ranks[i + 1] * tt_ranks[i] * out_sizes[i];
+  }
+  const auto X = RandomValues(batch_size * inp_size, &gen);
+  const auto b = RandomValues(out_size, &gen);
+  const auto cores = RandomValues(cores_size, &gen);
+
+  Workspace ws;
+  SetTensor(&ws, "X", {batch_size, inp_size}, X);
+  SetTensor(&ws, "b", {out_size}, b);
+  SetTensor(&ws, "cores", {cores_size}, cores);
+  ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+      "TT",
+      "",
+      {"X", "b", "cores"},
+      {"Y"},
+      {MakeArgument<vector<int>>("inp_sizes", inp_sizes),
+       MakeArgument<vector<int>>("out_sizes", out_sizes),
+       MakeArgument<vector<int>>("tt_ranks", tt_ranks)})));
+  const auto& Y = ws.GetBlob("Y")->Get<TensorCPU>();
+  ASSERT_EQ(Y.dims(), vector<TIndex>({batch_size, out_size}));
+
+  const auto weight = DenseWeight(inp_sizes, out_sizes, tt_ranks, cores);
+  for (int n = 0; n < batch_size; ++n) {
+    for (int out = 0; out < out_size; ++out) {
+      float expected = b[out];
+      for (int in = 0; in < inp_size; ++in) {
+        expected += X[n * inp_size + in] * weight[in * out_size + out];
+      }
+      EXPECT_NEAR(Y.data<float>()[n * out_size + out], expected, 1e-4)
+          << "row " << n << ", column " << out;
+    }
+  }
+}
+
+} // namespace
+
+TEST(TTLinearOpTest, MatchesDenseWeight) {
+  ExpectMatchesDense(3, {2, 3, 2}, {3, 2, 4}, {1, 2, 3, 1});
+}
+
+TEST(TTLinearOpTest, SingleCore) {
+  ExpectMatchesDense(2, {5}, {3}, {1, 1});
+}
+
+TEST(TTLinearOpTest, SplitsLargeBatches) {
+  // The batch does not fit in the intermediate buffers at once.
+  ExpectMatchesDense(3000, {4, 4}, {4, 4}, {1, 4, 1});
+}
+
+} // namespace caffe2
@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/unique_and_sum_op.h"
+
+namespace caffe2 {
+namespace {
+REGISTER_CPU_OPERATOR(UniqueAndSum, UniqueAndSumOp<CPUContext>);
+
+OPERATOR_SCHEMA(UniqueAndSum)
+    .NumInputs(2)
+    .NumOutputs(2, 3)
+    .SetDoc(R"DOC(
+Deduplicates a sparse gradient (INDICES, VALUES), where VALUES has one row per
+index and the same index can appear many times, into (UNIQUE, SUMS): UNIQUE
+holds every distinct index once, in the order of its first occurrence, and
+the row of SUMS for an index is the sum of all VALUES rows with that index.
+This is what Unique followed by UnsortedSegmentSum computes, done with a single
+hash lookup per index.
+
+Applying a sparse optimizer to the deduplicated gradient touches every
+embedding row once instead of once per occurrence, and the result is
+deterministic since the rows are always summed in input order.
+)DOC")
+    .Input(0, "INDICES", "int32 or int64 vector of row indices")
+    .Input(1, "VALUES", "float tensor with one row per element of INDICES")
+    .Output(0, "UNIQUE", "the distinct INDICES in order of first occurrence")
+    .Output(
+        1,
+        "SUMS",
+        "tensor with one row per element of UNIQUE, the sum of the VALUES rows "
+        "of that index")
+    .Output(
+        2,
+        "REMAPPING",
+        "optional, the position in UNIQUE of every element of INDICES, as "
+        "returned by Unique");
+
+SHOULD_NOT_DO_GRADIENT(UniqueAndSum);
+} // namespace
+} // namespace caffe2
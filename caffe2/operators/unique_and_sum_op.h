@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_UNIQUE_AND_SUM_OP_H_
+#define CAFFE2_OPERATORS_UNIQUE_AND_SUM_OP_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// Deduplicates the indices of a sparse gradient and sums the value rows of
+// repeated indices, hashing the indices once instead of running Unique and
+// then UnsortedSegmentSum. The unique indices are emitted in the order of
+// their first occurrence and the rows are summed in input order, so the result
+// does not depend on the hash table layout.
+template <class Context>
+class UniqueAndSumOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(UniqueAndSumOp);
+  USE_DISPATCH_HELPER;
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename SIndex>
+  bool DoRunWithType() {
+    const auto& indices = Input(INDICES);
+    const auto& values = Input(VALUES);
+    CAFFE_ENFORCE_EQ(indices.ndim(), 1, "INDICES must be a vector");
+    CAFFE_ENFORCE_GE(values.ndim(), 1, "VALUES can't be a scalar");
+    CAFFE_ENFORCE_EQ(
+        indices.dim(0), values.dim(0), "VALUES must have one row per index");
+
+    const TIndex n = indices.size();
+    const TIndex block_size = values.size_from_dim(1);
+    const auto* indices_data = indices.template data<SIndex>();
+    const auto* values_data = values.template data<float>();
+
+    // Positions are handed out in the order of first occurrence.
+    positions_.resize(n);
+    std::unordered_map<SIndex, TIndex> dict;
+    dict.reserve(n);
+    TIndex num_unique = 0;
+    for (TIndex i = 0; i < n; ++i) {
+      auto it = dict.insert({indices_data[i], num_unique});
+      if (it.second) {
+        ++num_unique;
+      }
+      positions_[i] = it.first->second;
+    }
+
+    auto* unique = Output(UNIQUE);
+    unique->Resize(num_unique);
+    auto* unique_data = unique->template mutable_data<SIndex>();
+    auto shape = values.dims();
+    shape[0] = num_unique;
+    auto* sums = Output(SUMS);
+    sums->Resize(shape);
+    auto* sums_data = sums->template mutable_data<float>();
+
+    TIndex next_unique = 0;
+    for (TIndex i = 0; i < n; ++i) {
+      const TIndex pos = positions_[i];
+      auto* out = sums_data + pos * block_size;
+      const auto* in = values_data + i * block_size;
+      if (pos == next_unique) {
+        unique_data[pos] = indices_data[i];
+        context_.template Copy<float, Context, Context>(block_size, in, out);
+        ++next_unique;
+      } else {
+        math::Add<float, Context>(block_size, out, in, out, &context_);
+      }
+    }
+
+    if (OutputSize() > REMAPPING) {
+      auto* remapping = Output(REMAPPING);
+      remapping->Resize(n);
+      auto* remapping_data = remapping->template mutable_data<SIndex>();
+      for (TIndex i = 0; i < n; ++i) {
+        remapping_data[i] = positions_[i];
+      }
+    }
+    return true;
+  }
+
+ private:
+  std::vector<TIndex> positions_;
+
+  INPUT_TAGS(INDICES, VALUES);
+  OUTPUT_TAGS(UNIQUE, SUMS, REMAPPING);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_UNIQUE_AND_SUM_OP_H_
@@ -566,7 +566,11 @@ Example:
         1,
         "LENGTHS",
         "1-D tensor of size N with lengths over gathered data"
-        " for each row in a batch. sum(LENGTHS) == OUTPUT.size()");
+        " for each row in a batch. sum(LENGTHS) == OUTPUT.size()")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace thread pool the examples are "
+        "split over. Defaults to 1.");
 
 OPERATOR_SCHEMA(LengthsGather)
     .NumInputs(3)
@@ -20,11 +20,8 @@
 // and std::isinf are declared constexpr there and the nvidia
 // compiler throws an error because of it
 
-#include <thrust/device_vector.h>
-#include <thrust/sequence.h>
-#include <thrust/sort.h>
-#include <thrust/system/cuda/execution_policy.h>
-#include <thrust/unique.h>
+#include <cub/device/device_radix_sort.cuh>
+#include <cub/device/device_scan.cuh>
 #include "caffe2/core/context_gpu.h"
 #include "utility_ops.h"
 
@@ -395,25 +392,44 @@ void ScatterAssignOp<CUDAContext>::DoScatterAssign(
 
 REGISTER_CUDA_OPERATOR(ScatterAssign, ScatterAssignOp<CUDAContext>);
 
-#if THRUST_VERSION >= 100800
-__global__ void remap_kernel(
-    thrust::device_ptr<int> second_order,
-    thrust::device_ptr<int> order,
-    int* output,
-    int N,
-    int K) {
-  int i = blockDim.x * blockIdx.x + threadIdx.x;
-  if (i >= K)
-    return;
-  int idx = second_order[i];
-  output[order[idx]] = i;
-  // Maybe cuda 1D kernel?
-  for (idx++; idx < N && (i == K - 1 || idx != second_order[i + 1]); idx++) {
-    output[order[idx]] = i;
+namespace {
+
+__global__ void UniqueIotaKernel(int n, int* out) {
+  CUDA_1D_KERNEL_LOOP(i, n) {
+    out[i] = i;
+  }
+}
+
+// Sets heads[i] to whether sorted[i] starts a run of equal values.
+template <typename T>
+__global__ void UniqueHeadsKernel(int n, const T* sorted, int* heads) {
+  CUDA_1D_KERNEL_LOOP(i, n) {
+    heads[i] = i == 0 || sorted[i] != sorted[i - 1];
+  }
+}
+
+// runs[i] is the number of runs up to and including position i.
+template <typename T>
+__global__ void UniqueScatterKernel(
+    int n,
+    const T* sorted,
+    const int* order,
+    const int* runs,
+    T* unique,
+    int* remapping) {
+  CUDA_1D_KERNEL_LOOP(i, n) {
+    const int run = runs[i] - 1;
+    if (i == 0 || sorted[i] != sorted[i - 1]) {
+      unique[run] = sorted[i];
+    }
+    if (remapping) {
+      remapping[order[i]] = run;
+    }
   }
-  return;
 }
 
+} // namespace
+
 template <>
 template <typename T>
 void UniqueOp<CUDAContext>::DoRun() {
@@ -429,71 +445,89 @@ void UniqueOp<CUDAContext>::DoRun() {
     remappingTensor->ResizeLike(inputTensor);
     remapping = remappingTensor->template mutable_data<int>();
   }
+  if (N == 0) {
+    uniqueTensor->Resize(0);
+    uniqueTensor->template mutable_data<T>();
+    return;
+  }
 
+  // Sorts the input along with the position of every value, e.g.
+  //    input  = 1,3,5,1,5,7,9
+  //    sorted = 1,1,3,5,5,7,9
+  //    order  = 0,3,1,2,4,5,6
+  // then numbers the runs of equal values:
+  //    runs   = 1,1,2,3,3,4,5
+  // The last run number is the number of unique values, and input[order[i]]
+  // is remapped to runs[i] - 1.
   const T* input = inputTensor.template data<T>();
-  thrust_unique_buffer_.Resize(N);
-  auto* buffer = thrust_unique_buffer_.template mutable_data<T>();
-  context_.template CopyItems<CUDAContext, CUDAContext>(
-      inputTensor.meta(), N, input, buffer);
-
-  // Create two vectors of {0, 1, ..., N-1} on CUDA device
-  thrust::device_vector<int> order1(N), order2(N);
-  thrust::sequence(
-      thrust::cuda::par.on(context_.cuda_stream()),
-      order1.begin(),
-      order1.end());
-  thrust::sequence(
-      thrust::cuda::par.on(context_.cuda_stream()),
-      order2.begin(),
-      order2.end());
-
-  // Sort the input along with order vector. So now we know where each element
-  // is permutated to. For example:
-  //    input1 = 1,3,5,1,5,7,9
-  //    order1 = 0,1,2,3,4,5,6
-  // Now we have:
-  //    output = 1,1,3,5,5,7,9
-  //    order1 = 0,3,1,2,4,5,6
-  thrust::sort_by_key(
-      thrust::cuda::par.on(context_.cuda_stream()),
-      buffer,
-      buffer + N,
-      order1.begin());
-
-  // Use consequent unique op to get another order_buffer
-  //    input2 = 1,1,3,5,5,7,9
-  //    order2 = 0,1,2,3,4,5,6
-  // Now we have:
-  //    output = 1,3,5,7,9
-  //    order2 = 0,2,3,5,6
-  auto new_last = thrust::unique_by_key(
-      thrust::cuda::par.on(context_.cuda_stream()),
-      buffer,
-      buffer + N,
-      order2.begin());
-  int K = new_last.first - buffer;
+  sorted_buffer_.Resize(N);
+  T* sorted = sorted_buffer_.template mutable_data<T>();
+  order_buffer_.Resize(2 * N);
+  int* iota = order_buffer_.template mutable_data<int>();
+  int* order = iota + N;
+  run_buffer_.Resize(2 * N);
+  int* heads = run_buffer_.template mutable_data<int>();
+  int* runs = heads + N;
+  UniqueIotaKernel<<<
+      CAFFE_GET_BLOCKS(N),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context_.cuda_stream()>>>(N, iota);
+
+  size_t sort_bytes = 0;
+  cub::DeviceRadixSort::SortPairs(
+      nullptr,
+      sort_bytes,
+      input,
+      sorted,
+      iota,
+      order,
+      N,
+      0,
+      sizeof(T) * 8,
+      context_.cuda_stream());
+  size_t scan_bytes = 0;
+  cub::DeviceScan::InclusiveSum(
+      nullptr, scan_bytes, heads, runs, N, context_.cuda_stream());
+  scratch_buffer_.Resize(std::max(sort_bytes, scan_bytes));
+  void* scratch = static_cast<void*>(scratch_buffer_.mutable_data<char>());
+  cub::DeviceRadixSort::SortPairs(
+      scratch,
+      sort_bytes,
+      input,
+      sorted,
+      iota,
+      order,
+      N,
+      0,
+      sizeof(T) * 8,
+      context_.cuda_stream());
+  UniqueHeadsKernel<T><<<
+      CAFFE_GET_BLOCKS(N),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context_.cuda_stream()>>>(N, sorted, heads);
+  cub::DeviceScan::InclusiveSum(
+      scratch, scan_bytes, heads, runs, N, context_.cuda_stream());
+
+  int K = 0;
+  context_.CopyBytes<CUDAContext, CPUContext>(sizeof(int), runs + N - 1, &K);
+  context_.FinishDeviceComputation();
 
   uniqueTensor->Resize(K);
-  T* unique = uniqueTensor->template mutable_data<T>();
-  context_.template CopyItems<CUDAContext, CUDAContext>(
-      thrust_unique_buffer_.meta(), K, buffer, unique);
-
-  // Compute the remapping. For example, for the number 1, if we look at
-  // order2[0] and order2[1], we know that input2[0:2) are all 1. They are all
-  // remapped to 0 in final input. And from order1, we know where they come
-  // from. The rest is easy.
-  if (remapping != nullptr) {
-    // record remap
-    remap_kernel<<<
-        CAFFE_GET_BLOCKS(K),
-        CAFFE_CUDA_NUM_THREADS,
-        0,
-        context_.cuda_stream()>>>(
-        order2.data(), order1.data(), remapping, N, K);
-  }
+  UniqueScatterKernel<T><<<
+      CAFFE_GET_BLOCKS(N),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context_.cuda_stream()>>>(
+      N,
+      sorted,
+      order,
+      runs,
+      uniqueTensor->template mutable_data<T>(),
+      remapping);
 }
 REGISTER_CUDA_OPERATOR(Unique, UniqueOp<CUDAContext>);
-#endif // THRUST_VERSION >= 100800
 
 REGISTER_CUDA_OPERATOR(Size, SizeOp<CUDAContext>);
 
@@ -25,7 +25,10 @@
 #include "caffe2/core/operator.h"
 #include "caffe2/core/types.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/run_chunks.h"
 
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <utility>
 
@@ -1148,7 +1151,12 @@ template <class Context>
 class GatherRangesOp : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(GatherRangesOp);
+  GatherRangesOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
 
   bool RunOnDevice() override {
     return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
@@ -1185,34 +1193,81 @@ class GatherRangesOp : public Operator<Context> {
     size_t outputSize = accumulate(rangesData, 0, ranges.size());
     outputData->Resize(outputSize);
 
-    auto outputRawData =
-        static_cast<char*>(outputData->raw_mutable_data(data.meta()));
-    VLOG(1) << "Copying data";
-    size_t outputOffsetBytes = 0;
-    auto itemsize = data.meta().itemsize();
+    // Checks all the ranges first, so that the copies cannot fail.
     for (int i = 0; i < ranges.size(); i += 2) {
       auto rangeStart = rangesData[i];
       auto rangeLength = rangesData[i + 1];
-      if (!rangeLength) {
-        continue;
-      }
-      auto rangeSizeBytes = rangeLength * itemsize;
-      CAFFE_ENFORCE(outputOffsetBytes < outputSize * itemsize);
-      CAFFE_ENFORCE(rangeStart + rangeLength <= data.size());
-      context_.template CopyItems<Context, Context>(
-          data.meta(),
-          rangeLength,
-          rawData + rangeStart * itemsize,
-          outputRawData + outputOffsetBytes);
-      outputOffsetBytes += rangeSizeBytes;
+      CAFFE_ENFORCE(
+          rangeLength == 0 ||
+              (0 <= rangeStart && 0 < rangeLength &&
+               rangeStart + rangeLength <= data.size()),
+          "Range is out of DATA bounds, start=",
+          rangeStart,
+          " length=",
+          rangeLength);
     }
-    CAFFE_ENFORCE(outputOffsetBytes == outputSize * itemsize);
+
+    const auto& meta = data.meta();
+    auto outputRawData = static_cast<char*>(outputData->raw_mutable_data(meta));
+    VLOG(1) << "Copying data";
+    auto itemsize = meta.itemsize();
+    // Gathers the examples [begin, end), with a single copy for every span of
+    // ranges that follow each other in DATA, while prefetching the range
+    // kPrefetchDistance ranges ahead.
+    constexpr size_t kPrefetchDistance = 8;
+    auto gather = [&](size_t begin, size_t end) {
+      size_t outputOffset = 0;
+      for (size_t i = 0; i < begin; ++i) {
+        outputOffset += outputLengthsPtr[i];
+      }
+      const size_t rangesEnd = end * blockSize;
+      for (size_t k = begin * blockSize; k < rangesEnd; k += 2) {
+        auto rangeStart = rangesData[k];
+        auto spanLength = rangesData[k + 1];
+        while (k + 2 < rangesEnd &&
+               (rangesData[k + 3] == 0 ||
+                rangesData[k + 2] == rangeStart + spanLength)) {
+          spanLength += rangesData[k + 3];
+          k += 2;
+        }
+#ifdef __GNUC__
+        if (k + 2 * kPrefetchDistance < rangesEnd) {
+          __builtin_prefetch(
+              rawData + rangesData[k + 2 * kPrefetchDistance] * itemsize,
+              0,
+              1);
+        }
+#endif // __GNUC__
+        if (spanLength == 0) {
+          continue;
+        }
+        const char* src = rawData + rangeStart * itemsize;
+        char* dst = outputRawData + outputOffset * itemsize;
+        if (meta.copy()) {
+          meta.copy()(src, dst, spanLength);
+        } else {
+          memcpy(dst, src, spanLength * itemsize);
+        }
+        outputOffset += spanLength;
+      }
+    };
+    RunChunks(
+        ws_,
+        num_threads_,
+        batchSize,
+        outputSize / std::max<TIndex>(batchSize, 1),
+        [&](int /* unused */, TIndex begin, TIndex end) {
+          gather(begin, end);
+        });
     return true;
   }
 
   INPUT_TAGS(DATA, RANGES, LENGTHS);
 
  private:
+  int num_threads_;
+  Workspace* ws_;
+
   template <typename Index>
   size_t accumulate(Index* ranges, size_t start, size_t end) {
     size_t result = 0;
@@ -1321,9 +1376,11 @@ class UniqueOp : public Operator<Context> {
 
  private:
   vector<int> order_;
-  Tensor<Context> thrust_unique_buffer_;
-  Tensor<Context> cuda_order_buffer_;
-  Tensor<Context> second_order_buffer_;
+  // Scratch space of the GPU implementation.
+  Tensor<Context> sorted_buffer_;
+  Tensor<Context> order_buffer_;
+  Tensor<Context> run_buffer_;
+  Tensor<Context> scratch_buffer_;
 
   template <typename T>
   void DoRun();
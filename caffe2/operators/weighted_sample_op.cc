@@ -33,8 +33,11 @@ bool WeightedSampleOp<float, CPUContext>::RunOnDevice() {
       output_values = out_value->template mutable_data<float>();
     }
 
+    // One uniform number per row, all drawn at once.
+    uniform_.resize(batch_size);
+    math::RandUniform<float, CPUContext>(
+        batch_size, 0.0f, 1.0f, uniform_.data(), &context_);
     for (int i = 0; i < batch_size; i++) {
-      float r;
       int offset = i * weights_dim;
 
       cum_mass_[0] = mat_weights[offset];
@@ -42,8 +45,7 @@ bool WeightedSampleOp<float, CPUContext>::RunOnDevice() {
         cum_mass_[j] = cum_mass_[j - 1] + mat_weights[offset + j];
       }
 
-      math::RandUniform<float, CPUContext>(
-          1, 0.0f, cum_mass_[cum_mass_.size() - 1], &r, &context_);
+      const float r = uniform_[i] * cum_mass_[cum_mass_.size() - 1];
       // Makes the element in cum_mass_ slightly bigger
       // to compensate inaccuracy introduced due to rounding,
       cum_mass_[cum_mass_.size() - 1] += 0.01f;
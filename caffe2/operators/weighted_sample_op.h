@@ -22,6 +22,7 @@ class WeightedSampleOp final : public Operator<Context> {
 
  private:
   vector<float> cum_mass_;
+  vector<float> uniform_;
   Tensor<Context> unif_samples_;
 };
 
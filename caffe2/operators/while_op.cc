@@ -31,6 +31,9 @@ bool WhileOp<CPUContext>::RunOnDevice() {
       "Invalid condition tensor in While operator: single value expected");
 
   while (true) {
+    if (IsCancelled()) {
+      return false;
+    }
     if (cond_net_ && !cond_net_->Run()) {
       return false;
     }
@@ -55,7 +58,8 @@ OPERATOR_SCHEMA(While)
 condition value. Accepts 'loop_net' (required) and 'cond_net' (optional) arguments for
 loop's body and condition subnets respectively. If condition subnet is specified,
 it is executed before the first and after each iteration. Subnets are executed in
-the same workspace as 'While'.
+the same workspace as 'While'. A cancelled run of the net of 'While' stops the
+loop, and fails the operator, before the next iteration.
     )DOC")
     .Arg("loop_net", "Net executed on each iteration")
     .Arg("cond_net", "Net to (re)compute condition value")
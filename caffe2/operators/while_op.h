@@ -35,6 +35,8 @@ class WhileOp final : public Operator<Context> {
         this->template GetSingleArgument<NetDef>("loop_net", NetDef());
     loop_net_ = CreateNet(loop_net_def_, ws);
     CAFFE_ENFORCE(loop_net_, "Failed to initialize loop subnet");
+    // The subnets stop along with the net of the operator.
+    loop_net_->SetParentOperator(this);
 
     cond_net_ = nullptr;
     bool has_cond_net =
@@ -44,6 +46,7 @@ class WhileOp final : public Operator<Context> {
           this->template GetSingleArgument<NetDef>("cond_net", NetDef());
       cond_net_ = CreateNet(cond_net_def_, ws);
       CAFFE_ENFORCE(cond_net_, "Failed to initialize condition subnet");
+      cond_net_->SetParentOperator(this);
     }
   }
 
@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/adagrad.h"
+
+#include <cmath>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void adagrad_update__base(
+    int N,
+    const float* w,
+    const float* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    float epsilon,
+    float decay,
+    float lr) {
+  for (auto i = 0; i < N; ++i) {
+    float gi = g[i];
+    float hi = nh[i] = decay * h[i] + gi * gi;
+    nw[i] = w[i] + lr * gi / (std::sqrt(hi) + epsilon);
+  }
+}
+
+void adagrad_update(
+    int N,
+    const float* w,
+    const float* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    float epsilon,
+    float decay,
+    float lr) {
+  AVX512_DO(adagrad_update, N, w, g, h, nw, nh, epsilon, decay, lr);
+  AVX2_FMA_DO(adagrad_update, N, w, g, h, nw, nh, epsilon, decay, lr);
+  BASE_DO(adagrad_update, N, w, g, h, nw, nh, epsilon, decay, lr);
+}
+
+void rowwise_adagrad_update__base(
+    int N,
+    const float* w,
+    const float* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    float epsilon,
+    float lr) {
+  float hs = 0.;
+  for (auto j = 0; j < N; ++j) {
+    float gj = g[j];
+    hs += gj * gj;
+  }
+  float hi = nh[0] = h[0] + hs / N;
+  float step = lr / (std::sqrt(hi) + epsilon);
+  for (auto j = 0; j < N; ++j) {
+    nw[j] = w[j] + g[j] * step;
+  }
+}
+
+void rowwise_adagrad_update(
+    int N,
+    const float* w,
+    const float* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    float epsilon,
+    float lr) {
+  AVX512_DO(rowwise_adagrad_update, N, w, g, h, nw, nh, epsilon, lr);
+  AVX2_FMA_DO(rowwise_adagrad_update, N, w, g, h, nw, nh, epsilon, lr);
+  BASE_DO(rowwise_adagrad_update, N, w, g, h, nw, nh, epsilon, lr);
+}
+
+} // namespace caffe2
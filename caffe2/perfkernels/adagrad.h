@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+namespace caffe2 {
+
+// Dense AdaGrad update of N elements:
+//   nh = decay * h + g * g
+//   nw = w + lr * g / (sqrt(nh) + epsilon)
+// nw may alias w and nh may alias h, which is how the sparse operators update
+// their rows in place.
+void adagrad_update(
+    int N,
+    const float* w,
+    const float* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    float epsilon,
+    float decay,
+    float lr);
+
+// Row-wise AdaGrad update of a single row of N elements that shares the one
+// moment *h:
+//   *nh = *h + mean(g * g)
+//   nw = w + lr * g / (sqrt(*nh) + epsilon)
+// Aliasing is allowed as in adagrad_update.
+void rowwise_adagrad_update(
+    int N,
+    const float* w,
+    const float* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    float epsilon,
+    float lr);
+
+} // namespace caffe2
@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+void adagrad_update__avx2_fma(
+    int N,
+    const float* w,
+    const float* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    float epsilon,
+    float decay,
+    float lr) {
+  const __m256 vdecay = _mm256_set1_ps(decay);
+  const __m256 vepsilon = _mm256_set1_ps(epsilon);
+  const __m256 vlr = _mm256_set1_ps(lr);
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    __m256 gi = _mm256_loadu_ps(g + i);
+    __m256 hi = _mm256_fmadd_ps(
+        vdecay, _mm256_loadu_ps(h + i), _mm256_mul_ps(gi, gi));
+    _mm256_storeu_ps(nh + i, hi);
+    __m256 step =
+        _mm256_div_ps(gi, _mm256_add_ps(_mm256_sqrt_ps(hi), vepsilon));
+    _mm256_storeu_ps(
+        nw + i, _mm256_fmadd_ps(vlr, step, _mm256_loadu_ps(w + i)));
+  }
+  for (; i < N; ++i) {
+    float gi = g[i];
+    float hi = nh[i] = decay * h[i] + gi * gi;
+    nw[i] = w[i] + lr * gi / (std::sqrt(hi) + epsilon);
+  }
+}
+
+void rowwise_adagrad_update__avx2_fma(
+    int N,
+    const float* w,
+    const float* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    float epsilon,
+    float lr) {
+  __m256 vhs = _mm256_setzero_ps();
+  auto j = 0;
+  for (; j + 8 <= N; j += 8) {
+    __m256 gj = _mm256_loadu_ps(g + j);
+    vhs = _mm256_fmadd_ps(gj, gj, vhs);
+  }
+  // Horizontal sum of the 8 partial sums.
+  __m128 vsum = _mm_add_ps(
+      _mm256_castps256_ps128(vhs), _mm256_extractf128_ps(vhs, 1));
+  vsum = _mm_add_ps(vsum, _mm_movehl_ps(vsum, vsum));
+  vsum = _mm_add_ss(vsum, _mm_shuffle_ps(vsum, vsum, 1));
+  float hs = _mm_cvtss_f32(vsum);
+  for (; j < N; ++j) {
+    float gj = g[j];
+    hs += gj * gj;
+  }
+  float hi = nh[0] = h[0] + hs / N;
+  float step = lr / (std::sqrt(hi) + epsilon);
+
+  const __m256 vstep = _mm256_set1_ps(step);
+  j = 0;
+  for (; j + 8 <= N; j += 8) {
+    _mm256_storeu_ps(
+        nw + j,
+        _mm256_fmadd_ps(
+            _mm256_loadu_ps(g + j), vstep, _mm256_loadu_ps(w + j)));
+  }
+  for (; j < N; ++j) {
+    nw[j] = w[j] + g[j] * step;
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+void adagrad_update__avx512(
+    int N,
+    const float* w,
+    const float* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    float epsilon,
+    float decay,
+    float lr) {
+  const __m512 vdecay = _mm512_set1_ps(decay);
+  const __m512 vepsilon = _mm512_set1_ps(epsilon);
+  const __m512 vlr = _mm512_set1_ps(lr);
+  for (auto i = 0; i < N; i += 16) {
+    // The last iteration handles the remaining elements with a partial mask.
+    const __mmask16 mask =
+        N - i >= 16 ? __mmask16(0xffff) : __mmask16((1 << (N - i)) - 1);
+    __m512 gi = _mm512_maskz_loadu_ps(mask, g + i);
+    __m512 hi = _mm512_fmadd_ps(
+        vdecay, _mm512_maskz_loadu_ps(mask, h + i), _mm512_mul_ps(gi, gi));
+    _mm512_mask_storeu_ps(nh + i, mask, hi);
+    __m512 step =
+        _mm512_div_ps(gi, _mm512_add_ps(_mm512_sqrt_ps(hi), vepsilon));
+    _mm512_mask_storeu_ps(
+        nw + i,
+        mask,
+        _mm512_fmadd_ps(vlr, step, _mm512_maskz_loadu_ps(mask, w + i)));
+  }
+}
+
+void rowwise_adagrad_update__avx512(
+    int N,
+    const float* w,
+    const float* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    float epsilon,
+    float lr) {
+  __m512 vhs = _mm512_setzero_ps();
+  for (auto j = 0; j < N; j += 16) {
+    const __mmask16 mask =
+        N - j >= 16 ? __mmask16(0xffff) : __mmask16((1 << (N - j)) - 1);
+    __m512 gj = _mm512_maskz_loadu_ps(mask, g + j);
+    vhs = _mm512_fmadd_ps(gj, gj, vhs);
+  }
+  float hi = nh[0] = h[0] + _mm512_reduce_add_ps(vhs) / N;
+  float step = lr / (std::sqrt(hi) + epsilon);
+
+  const __m512 vstep = _mm512_set1_ps(step);
+  for (auto j = 0; j < N; j += 16) {
+    const __mmask16 mask =
+        N - j >= 16 ? __mmask16(0xffff) : __mmask16((1 << (N - j)) - 1);
+    _mm512_mask_storeu_ps(
+        nw + j,
+        mask,
+        _mm512_fmadd_ps(
+            _mm512_maskz_loadu_ps(mask, g + j),
+            vstep,
+            _mm512_maskz_loadu_ps(mask, w + j)));
+  }
+}
+
+} // namespace caffe2
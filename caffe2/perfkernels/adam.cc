@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/adam.h"
+
+#include <cmath>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void adam_compute__base(
+    int N,
+    const float* w,
+    const float* g,
+    const float* m,
+    const float* v,
+    float* nw,
+    float* nm,
+    float* nv,
+    float beta1,
+    float beta2,
+    float eps_hat,
+    float correction,
+    float lr) {
+  for (auto i = 0; i < N; ++i) {
+    float gi = g[i];
+    float mi = nm[i] = m[i] * beta1 + gi * (1 - beta1);
+    float vi = nv[i] = v[i] * beta2 + gi * gi * (1 - beta2);
+    float ng = lr * correction * mi / (std::sqrt(vi) + eps_hat);
+    nw[i] = w[i] + ng;
+  }
+}
+
+void adam_compute(
+    int N,
+    const float* w,
+    const float* g,
+    const float* m,
+    const float* v,
+    float* nw,
+    float* nm,
+    float* nv,
+    float beta1,
+    float beta2,
+    float eps_hat,
+    float correction,
+    float lr) {
+  AVX512_DO(
+      adam_compute,
+      N,
+      w,
+      g,
+      m,
+      v,
+      nw,
+      nm,
+      nv,
+      beta1,
+      beta2,
+      eps_hat,
+      correction,
+      lr);
+  AVX2_FMA_DO(
+      adam_compute,
+      N,
+      w,
+      g,
+      m,
+      v,
+      nw,
+      nm,
+      nv,
+      beta1,
+      beta2,
+      eps_hat,
+      correction,
+      lr);
+  BASE_DO(
+      adam_compute,
+      N,
+      w,
+      g,
+      m,
+      v,
+      nw,
+      nm,
+      nv,
+      beta1,
+      beta2,
+      eps_hat,
+      correction,
+      lr);
+}
+
+} // namespace caffe2
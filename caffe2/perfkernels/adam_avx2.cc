@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+void adam_compute__avx2_fma(
+    int N,
+    const float* w,
+    const float* g,
+    const float* m,
+    const float* v,
+    float* nw,
+    float* nm,
+    float* nv,
+    float beta1,
+    float beta2,
+    float eps_hat,
+    float correction,
+    float lr) {
+  const __m256 vbeta1 = _mm256_set1_ps(beta1);
+  const __m256 vbeta1c = _mm256_set1_ps(1 - beta1);
+  const __m256 vbeta2 = _mm256_set1_ps(beta2);
+  const __m256 vbeta2c = _mm256_set1_ps(1 - beta2);
+  const __m256 veps = _mm256_set1_ps(eps_hat);
+  const __m256 vscale = _mm256_set1_ps(lr * correction);
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    __m256 gi = _mm256_loadu_ps(g + i);
+    __m256 mi = _mm256_fmadd_ps(
+        _mm256_loadu_ps(m + i), vbeta1, _mm256_mul_ps(gi, vbeta1c));
+    __m256 vi = _mm256_fmadd_ps(
+        _mm256_loadu_ps(v + i),
+        vbeta2,
+        _mm256_mul_ps(_mm256_mul_ps(gi, gi), vbeta2c));
+    _mm256_storeu_ps(nm + i, mi);
+    _mm256_storeu_ps(nv + i, vi);
+    __m256 ng =
+        _mm256_div_ps(mi, _mm256_add_ps(_mm256_sqrt_ps(vi), veps));
+    _mm256_storeu_ps(
+        nw + i, _mm256_fmadd_ps(vscale, ng, _mm256_loadu_ps(w + i)));
+  }
+  for (; i < N; ++i) {
+    float gi = g[i];
+    float mi = nm[i] = m[i] * beta1 + gi * (1 - beta1);
+    float vi = nv[i] = v[i] * beta2 + gi * gi * (1 - beta2);
+    float ng = lr * correction * mi / (std::sqrt(vi) + eps_hat);
+    nw[i] = w[i] + ng;
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+void adam_compute__avx512(
+    int N,
+    const float* w,
+    const float* g,
+    const float* m,
+    const float* v,
+    float* nw,
+    float* nm,
+    float* nv,
+    float beta1,
+    float beta2,
+    float eps_hat,
+    float correction,
+    float lr) {
+  const __m512 vbeta1 = _mm512_set1_ps(beta1);
+  const __m512 vbeta1c = _mm512_set1_ps(1 - beta1);
+  const __m512 vbeta2 = _mm512_set1_ps(beta2);
+  const __m512 vbeta2c = _mm512_set1_ps(1 - beta2);
+  const __m512 veps = _mm512_set1_ps(eps_hat);
+  const __m512 vscale = _mm512_set1_ps(lr * correction);
+  for (auto i = 0; i < N; i += 16) {
+    // The last iteration handles the remaining elements with a partial mask.
+    const __mmask16 mask =
+        N - i >= 16 ? __mmask16(0xffff) : __mmask16((1 << (N - i)) - 1);
+    __m512 gi = _mm512_maskz_loadu_ps(mask, g + i);
+    __m512 mi = _mm512_fmadd_ps(
+        _mm512_maskz_loadu_ps(mask, m + i),
+        vbeta1,
+        _mm512_mul_ps(gi, vbeta1c));
+    __m512 vi = _mm512_fmadd_ps(
+        _mm512_maskz_loadu_ps(mask, v + i),
+        vbeta2,
+        _mm512_mul_ps(_mm512_mul_ps(gi, gi), vbeta2c));
+    _mm512_mask_storeu_ps(nm + i, mask, mi);
+    _mm512_mask_storeu_ps(nv + i, mask, vi);
+    __m512 ng =
+        _mm512_div_ps(mi, _mm512_add_ps(_mm512_sqrt_ps(vi), veps));
+    _mm512_mask_storeu_ps(
+        nw + i,
+        mask,
+        _mm512_fmadd_ps(vscale, ng, _mm512_maskz_loadu_ps(mask, w + i)));
+  }
+}
+
+} // namespace caffe2
@@ -23,6 +23,11 @@ implement a functionality called void foo(int a, float b).
 In foo.h, do:
    void foo(int a, float b);
 
+In foo_avx512.cc, do:
+   void foo__avx512(int a, float b) {
+     [actual avx512 implementation]
+   }
+
 In foo_avx2.cc, do:
    void foo__avx2(int a, float b) {
      [actual avx2 implementation]
@@ -41,6 +46,7 @@ In foo.cc, do:
    void foo(int a, float b) {
      // You should always order things by their preference, faster
      // implementations earlier in the function.
+     AVX512_DO(foo, a, b);
      AVX2_DO(foo, a, b);
      AVX_DO(foo, a, b);
      BASE_DO(foo, a, b);
@@ -51,11 +57,12 @@ In foo.cc, do:
 // and run time architecture support.
 //
 // During build time:
-//    The build system should provide flags CAFFE2_PERF_WITH_AVX2 and
-//    CAFFE2_PERF_WITH_AVX that corresponds to the __AVX__ and __AVX2__ flags
-//    the compiler provides. Note that we do not use the compiler flags but
-//    rely on the build system flags, because the common files (like foo.cc
-//    above) will always be built without __AVX__ and __AVX2__.
+//    The build system should provide flags CAFFE2_PERF_WITH_AVX512,
+//    CAFFE2_PERF_WITH_AVX2 and CAFFE2_PERF_WITH_AVX that corresponds to the
+//    __AVX512F__, __AVX2__ and __AVX__ flags the compiler provides. Note that
+//    we do not use the compiler flags but rely on the build system flags,
+//    because the common files (like foo.cc above) will always be built without
+//    __AVX__, __AVX2__ and __AVX512F__.
 // During run time:
 //    we use cpuid to identify cpu support and run the proper functions.
 
@@ -66,6 +73,19 @@ In foo.cc, do:
 
 #define BASE_DO(funcname, ...) return funcname##__base(__VA_ARGS__);
 
+// The AVX-512 kernels use the F, BW and VL subsets, which every AVX-512 capable
+// Xeon (Skylake and later) provides.
+#ifdef CAFFE2_PERF_WITH_AVX512
+#define AVX512_DO(funcname, ...)                       \
+  decltype(funcname##__base) funcname##__avx512;       \
+  if (GetCpuId().avx512f() && GetCpuId().avx512bw() && \
+      GetCpuId().avx512vl()) {                         \
+    return funcname##__avx512(__VA_ARGS__);            \
+  }
+#else // CAFFE2_PERF_WITH_AVX512
+#define AVX512_DO(funcname, ...)
+#endif // CAFFE2_PERF_WITH_AVX512
+
 #ifdef CAFFE2_PERF_WITH_AVX2
 #define AVX2_DO(funcname, ...)                 \
   decltype(funcname##__base) funcname##__avx2; \
@@ -97,3 +117,14 @@ In foo.cc, do:
 #define AVX_DO(funcname, ...)
 #define AVX_F16C_DO(funcname, ...)
 #endif // CAFFE2_PERF_WITH_AVX
+
+// NEON is chosen at build time rather than through cpuid: every ARMv8 core
+// has it, and ARMv7 builds only enable it when targeting cores that do. Note
+// that GCC defines __ARM_NEON but not __ARM_NEON__ on AArch64.
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define NEON_DO(funcname, ...)                 \
+  decltype(funcname##__base) funcname##__neon; \
+  return funcname##__neon(__VA_ARGS__);
+#else // defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define NEON_DO(funcname, ...)
+#endif // defined(__ARM_NEON__) || defined(__ARM_NEON)
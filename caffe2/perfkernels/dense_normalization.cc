@@ -0,0 +1,181 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/dense_normalization.h"
+
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void box_cox__base(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    float* y) {
+  for (int i = 0; i < N; ++i) {
+    for (int j = 0; j < D; ++j) {
+      y[i * ld + j] = BoxCox(x[i * ld + j], lambda1[j], lambda2[j]);
+    }
+  }
+}
+
+void piecewise_linear__base(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    int P,
+    int params_ld,
+    const float* bounds,
+    const float* slopes,
+    const float* intercepts,
+    float* y) {
+  for (int i = 0; i < N; ++i) {
+    for (int j = 0; j < D; ++j) {
+      y[i * ld + j] = PiecewiseLinear(
+          x[i * ld + j],
+          P,
+          params_ld,
+          bounds + j,
+          slopes + j,
+          intercepts + j);
+    }
+  }
+}
+
+void box_cox_piecewise_linear__base(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    int P,
+    int params_ld,
+    const float* bounds,
+    const float* slopes,
+    const float* intercepts,
+    float* y) {
+  for (int i = 0; i < N; ++i) {
+    for (int j = 0; j < D; ++j) {
+      y[i * ld + j] = PiecewiseLinear(
+          BoxCox(x[i * ld + j], lambda1[j], lambda2[j]),
+          P,
+          params_ld,
+          bounds + j,
+          slopes + j,
+          intercepts + j);
+    }
+  }
+}
+
+void box_cox(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    float* y) {
+  AVX2_FMA_DO(box_cox, N, D, ld, x, lambda1, lambda2, y);
+  BASE_DO(box_cox, N, D, ld, x, lambda1, lambda2, y);
+}
+
+void piecewise_linear(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    int P,
+    int params_ld,
+    const float* bounds,
+    const float* slopes,
+    const float* intercepts,
+    float* y) {
+  AVX2_FMA_DO(
+      piecewise_linear,
+      N,
+      D,
+      ld,
+      x,
+      P,
+      params_ld,
+      bounds,
+      slopes,
+      intercepts,
+      y);
+  BASE_DO(
+      piecewise_linear,
+      N,
+      D,
+      ld,
+      x,
+      P,
+      params_ld,
+      bounds,
+      slopes,
+      intercepts,
+      y);
+}
+
+void box_cox_piecewise_linear(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    int P,
+    int params_ld,
+    const float* bounds,
+    const float* slopes,
+    const float* intercepts,
+    float* y) {
+  AVX2_FMA_DO(
+      box_cox_piecewise_linear,
+      N,
+      D,
+      ld,
+      x,
+      lambda1,
+      lambda2,
+      P,
+      params_ld,
+      bounds,
+      slopes,
+      intercepts,
+      y);
+  BASE_DO(
+      box_cox_piecewise_linear,
+      N,
+      D,
+      ld,
+      x,
+      lambda1,
+      lambda2,
+      P,
+      params_ld,
+      bounds,
+      slopes,
+      intercepts,
+      y);
+}
+
+} // namespace caffe2
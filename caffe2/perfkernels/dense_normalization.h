@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace caffe2 {
+
+// Kernels of the BatchBoxCox and PiecewiseLinearTransform operators over a
+// block of N rows and D columns of a row-major matrix with ld floats per
+// row, column j having its own parameters. On hosts with AVX2 and FMA they
+// process 8 columns of a row at a time, with the exp and log of
+// transcendental.h. y may alias x.
+
+// The Box-Cox transform of BatchBoxCox:
+//   log(max(x + lambda2, 1e-6)), if lambda1 == 0
+//   (max(x + lambda2, 1e-6)^lambda1 - 1) / lambda1, otherwise
+inline float BoxCox(float x, float lambda1, float lambda2) {
+  const float v = std::max(x + lambda2, 1e-6f);
+  return lambda1 == 0 ? std::log(v) : (std::pow(v, lambda1) - 1) / lambda1;
+}
+
+// The piecewise linear function of PiecewiseLinearTransform with P pieces,
+// whose bounds are bounds[k * stride], k <= P, and slopes and intercepts
+// slopes[k * stride] and intercepts[k * stride], k < P. x is capped to the
+// first and the last bound.
+inline float PiecewiseLinear(
+    float x,
+    int P,
+    int stride,
+    const float* bounds,
+    const float* slopes,
+    const float* intercepts) {
+  x = std::min(std::max(x, bounds[0]), bounds[P * stride]);
+  int k = 0;
+  if (x >= bounds[P * stride]) {
+    k = P - 1;
+  } else {
+    // The number of inner bounds below x, by binary search.
+    int count = P - 1;
+    int first = 1;
+    while (count > 0) {
+      const int half = count / 2;
+      if (bounds[(first + half) * stride] < x) {
+        first += half + 1;
+        count -= half + 1;
+      } else {
+        count = half;
+      }
+    }
+    k = first - 1;
+  }
+  return slopes[k * stride] * x + intercepts[k * stride];
+}
+
+// y[i * ld + j] = BoxCox(x[i * ld + j], lambda1[j], lambda2[j]).
+void box_cox(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    float* y);
+
+// y[i * ld + j] = PiecewiseLinear(x[i * ld + j], P, params_ld, bounds + j,
+// slopes + j, intercepts + j), i.e. the parameters of the columns are
+// interleaved, with params_ld floats per bound or piece.
+void piecewise_linear(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    int P,
+    int params_ld,
+    const float* bounds,
+    const float* slopes,
+    const float* intercepts,
+    float* y);
+
+// The piecewise linear transform of the Box-Cox transform, in one pass.
+void box_cox_piecewise_linear(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    int P,
+    int params_ld,
+    const float* bounds,
+    const float* slopes,
+    const float* intercepts,
+    float* y);
+
+} // namespace caffe2
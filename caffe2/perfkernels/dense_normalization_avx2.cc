@@ -0,0 +1,239 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/dense_normalization.h"
+#include "caffe2/perfkernels/transcendental_avx2.h"
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+namespace {
+
+// Loads 8 floats, or with kTail only the lanes of mask, the others being 0,
+// so that the last columns of a row go through the same code as the others.
+template <bool kTail>
+inline __m256 Load(const float* p, __m256i mask) {
+  return kTail ? _mm256_maskload_ps(p, mask) : _mm256_loadu_ps(p);
+}
+
+template <bool kTail>
+inline void Store(float* p, __m256i mask, __m256 v) {
+  if (kTail) {
+    _mm256_maskstore_ps(p, mask, v);
+  } else {
+    _mm256_storeu_ps(p, v);
+  }
+}
+
+// pow(v, lambda1) is exp(lambda1 * log(v)), so the relative error grows with
+// |lambda1 * log(v)|, to about 1e-6 for results in [1e-10, 1e10].
+template <bool kTail>
+inline __m256 BoxCox256(
+    __m256 x,
+    const float* lambda1,
+    const float* lambda2,
+    __m256i mask) {
+  const __m256 l1 = Load<kTail>(lambda1, mask);
+  const __m256 l2 = Load<kTail>(lambda2, mask);
+  const __m256 v =
+      _mm256_max_ps(_mm256_add_ps(x, l2), _mm256_set1_ps(1e-6f));
+  const __m256 log_v = log256(v);
+  const __m256 pow_v = _mm256_div_ps(
+      _mm256_sub_ps(exp256(_mm256_mul_ps(l1, log_v)), _mm256_set1_ps(1.0f)),
+      l1);
+  return _mm256_blendv_ps(
+      pow_v, log_v, _mm256_cmp_ps(l1, _mm256_setzero_ps(), _CMP_EQ_OQ));
+}
+
+// Finds the piece of every lane by counting the inner bounds below x: with
+// a compare per bound for few pieces, and otherwise by a binary search that
+// gathers one bound per lane and step.
+template <bool kTail>
+inline __m256 PiecewiseLinear256(
+    __m256 x,
+    int P,
+    int params_ld,
+    const float* bounds,
+    const float* slopes,
+    const float* intercepts,
+    __m256i mask) {
+  constexpr int kMaxLinearSearch = 16;
+  const __m256 lower = Load<kTail>(bounds, mask);
+  const __m256 upper = Load<kTail>(bounds + P * params_ld, mask);
+  const __m256 xc = _mm256_min_ps(_mm256_max_ps(x, lower), upper);
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256 gather_mask = _mm256_castsi256_ps(mask);
+  __m256i piece = _mm256_setzero_si256();
+  if (P <= kMaxLinearSearch) {
+    for (int k = 1; k < P; ++k) {
+      const __m256 below = _mm256_cmp_ps(
+          Load<kTail>(bounds + k * params_ld, mask), xc, _CMP_LT_OQ);
+      piece = _mm256_sub_epi32(piece, _mm256_castps_si256(below));
+    }
+  } else {
+    int step = 1;
+    while (step * 2 <= P - 1) {
+      step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+      const __m256i candidate =
+          _mm256_add_epi32(piece, _mm256_set1_epi32(step));
+      const __m256 valid = _mm256_and_ps(
+          gather_mask,
+          _mm256_castsi256_ps(
+              _mm256_cmpgt_epi32(_mm256_set1_epi32(P), candidate)));
+      const __m256 bound = _mm256_mask_i32gather_ps(
+          _mm256_setzero_ps(),
+          bounds,
+          _mm256_add_epi32(
+              _mm256_mullo_epi32(candidate, _mm256_set1_epi32(params_ld)),
+              lanes),
+          valid,
+          4);
+      const __m256 below =
+          _mm256_and_ps(valid, _mm256_cmp_ps(bound, xc, _CMP_LT_OQ));
+      piece = _mm256_castps_si256(_mm256_blendv_ps(
+          _mm256_castsi256_ps(piece), _mm256_castsi256_ps(candidate), below));
+    }
+  }
+  // Capped at the last bound, x is in the last piece even if inner bounds
+  // are equal to the last one.
+  piece = _mm256_castps_si256(_mm256_blendv_ps(
+      _mm256_castsi256_ps(piece),
+      _mm256_castsi256_ps(_mm256_set1_epi32(P - 1)),
+      _mm256_cmp_ps(x, upper, _CMP_GE_OQ)));
+  const __m256i offsets = _mm256_add_epi32(
+      _mm256_mullo_epi32(piece, _mm256_set1_epi32(params_ld)), lanes);
+  const __m256 slope = _mm256_mask_i32gather_ps(
+      _mm256_setzero_ps(), slopes, offsets, gather_mask, 4);
+  const __m256 intercept = _mm256_mask_i32gather_ps(
+      _mm256_setzero_ps(), intercepts, offsets, gather_mask, 4);
+  return _mm256_fmadd_ps(slope, xc, intercept);
+}
+
+// Calls f(x, j, mask) for every 8 columns j of every row and stores the
+// result.
+template <typename F>
+inline void ForEachVector(int N, int D, int ld, const float* x, float* y, F f) {
+  const __m256i all = _mm256_set1_epi32(-1);
+  const __m256i tail_mask = _mm256_cmpgt_epi32(
+      _mm256_set1_epi32(D % 8), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  const int D8 = D / 8 * 8;
+  for (int i = 0; i < N; ++i) {
+    const float* xi = x + i * ld;
+    float* yi = y + i * ld;
+    for (int j = 0; j < D8; j += 8) {
+      Store<false>(yi + j, all, f.template run<false>(
+          Load<false>(xi + j, all), j, all));
+    }
+    if (D8 < D) {
+      Store<true>(yi + D8, tail_mask, f.template run<true>(
+          Load<true>(xi + D8, tail_mask), D8, tail_mask));
+    }
+  }
+}
+
+struct BoxCoxFunctor {
+  template <bool kTail>
+  __m256 run(__m256 x, int j, __m256i mask) const {
+    return BoxCox256<kTail>(x, lambda1 + j, lambda2 + j, mask);
+  }
+  const float* lambda1;
+  const float* lambda2;
+};
+
+struct PiecewiseLinearFunctor {
+  template <bool kTail>
+  __m256 run(__m256 x, int j, __m256i mask) const {
+    return PiecewiseLinear256<kTail>(
+        x, P, params_ld, bounds + j, slopes + j, intercepts + j, mask);
+  }
+  int P;
+  int params_ld;
+  const float* bounds;
+  const float* slopes;
+  const float* intercepts;
+};
+
+struct BoxCoxPiecewiseLinearFunctor {
+  template <bool kTail>
+  __m256 run(__m256 x, int j, __m256i mask) const {
+    return piecewise_linear.run<kTail>(
+        box_cox.run<kTail>(x, j, mask), j, mask);
+  }
+  BoxCoxFunctor box_cox;
+  PiecewiseLinearFunctor piecewise_linear;
+};
+
+} // namespace
+
+void box_cox__avx2_fma(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    float* y) {
+  ForEachVector(N, D, ld, x, y, BoxCoxFunctor{lambda1, lambda2});
+}
+
+void piecewise_linear__avx2_fma(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    int P,
+    int params_ld,
+    const float* bounds,
+    const float* slopes,
+    const float* intercepts,
+    float* y) {
+  ForEachVector(
+      N,
+      D,
+      ld,
+      x,
+      y,
+      PiecewiseLinearFunctor{P, params_ld, bounds, slopes, intercepts});
+}
+
+void box_cox_piecewise_linear__avx2_fma(
+    int N,
+    int D,
+    int ld,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    int P,
+    int params_ld,
+    const float* bounds,
+    const float* slopes,
+    const float* intercepts,
+    float* y) {
+  ForEachVector(
+      N,
+      D,
+      ld,
+      x,
+      y,
+      BoxCoxPiecewiseLinearFunctor{
+          {lambda1, lambda2},
+          {P, params_ld, bounds, slopes, intercepts}});
+}
+
+} // namespace caffe2
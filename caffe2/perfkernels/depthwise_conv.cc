@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/depthwise_conv.h"
+
+#include <algorithm>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+// Accumulates every tap of the filter into the output row in turn, over the
+// range of output columns that tap reads inside of the input.
+void depthwise_conv_3x3_plane__base(
+    int H,
+    int W,
+    int out_h,
+    int out_w,
+    int stride,
+    int pad_t,
+    int pad_l,
+    const float* X,
+    const float* filter,
+    float bias,
+    float* Y) {
+  int begin[3], end[3];
+  for (int kw = 0; kw < 3; ++kw) {
+    const int first = pad_l - kw;
+    const int last = W - 1 + pad_l - kw;
+    begin[kw] = first <= 0 ? 0 : (first + stride - 1) / stride;
+    end[kw] = last < 0 ? 0 : std::min(out_w, last / stride + 1);
+  }
+  for (int oh = 0; oh < out_h; ++oh) {
+    float* y = Y + oh * out_w;
+    std::fill(y, y + out_w, bias);
+    for (int kh = 0; kh < 3; ++kh) {
+      const int ih = oh * stride - pad_t + kh;
+      if (ih < 0 || ih >= H) {
+        continue;
+      }
+      for (int kw = 0; kw < 3; ++kw) {
+        const float w = filter[kh * 3 + kw];
+        const float* x = X + ih * W - pad_l + kw;
+        for (int ow = begin[kw]; ow < end[kw]; ++ow) {
+          y[ow] += w * x[ow * stride];
+        }
+      }
+    }
+  }
+}
+
+void depthwise_conv_3x3_plane(
+    int H,
+    int W,
+    int out_h,
+    int out_w,
+    int stride,
+    int pad_t,
+    int pad_l,
+    const float* X,
+    const float* filter,
+    float bias,
+    float* Y) {
+  NEON_DO(
+      depthwise_conv_3x3_plane,
+      H,
+      W,
+      out_h,
+      out_w,
+      stride,
+      pad_t,
+      pad_l,
+      X,
+      filter,
+      bias,
+      Y);
+  AVX2_FMA_DO(
+      depthwise_conv_3x3_plane,
+      H,
+      W,
+      out_h,
+      out_w,
+      stride,
+      pad_t,
+      pad_l,
+      X,
+      filter,
+      bias,
+      Y);
+  BASE_DO(
+      depthwise_conv_3x3_plane,
+      H,
+      W,
+      out_h,
+      out_w,
+      stride,
+      pad_t,
+      pad_l,
+      X,
+      filter,
+      bias,
+      Y);
+}
+
+} // namespace caffe2
@@ -0,0 +1,40 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+namespace caffe2 {
+
+// One output channel of a 3x3 depthwise convolution without dilation, in
+// NCHW order:
+//   Y[oh][ow] = bias + sum_{kh,kw} filter[kh * 3 + kw] *
+//       X[oh * stride - pad_t + kh][ow * stride - pad_l + kw]
+// where X is an H x W plane, zero outside of it, and Y is out_h x out_w.
+// stride must be 1 or 2.
+void depthwise_conv_3x3_plane(
+    int H,
+    int W,
+    int out_h,
+    int out_w,
+    int stride,
+    int pad_t,
+    int pad_l,
+    const float* X,
+    const float* filter,
+    float bias,
+    float* Y);
+
+} // namespace caffe2
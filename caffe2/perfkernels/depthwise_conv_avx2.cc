@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/depthwise_conv.h"
+
+#include <immintrin.h>
+#include <vector>
+
+namespace caffe2 {
+
+namespace {
+
+// Output pixel whose window starts at input column iw, for the borders.
+// Rows outside of the input point at zeros.
+inline float pixel(
+    const float* const* rows,
+    const float* filter,
+    int W,
+    int iw,
+    float bias) {
+  float sum = bias;
+  for (int kh = 0; kh < 3; ++kh) {
+    for (int kw = 0; kw < 3; ++kw) {
+      const int col = iw + kw;
+      if (col >= 0 && col < W) {
+        sum += filter[kh * 3 + kw] * rows[kh][col];
+      }
+    }
+  }
+  return sum;
+}
+
+// The elements 0, 2, ..., 14 and 1, 3, ..., 15 of x[0..15].
+inline __m256 load_evens(const float* x) {
+  const __m256 s =
+      _mm256_shuffle_ps(_mm256_loadu_ps(x), _mm256_loadu_ps(x + 8), 0x88);
+  return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(s), 0xD8));
+}
+
+inline __m256 load_odds(const float* x) {
+  const __m256 s =
+      _mm256_shuffle_ps(_mm256_loadu_ps(x), _mm256_loadu_ps(x + 8), 0xDD);
+  return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(s), 0xD8));
+}
+
+} // namespace
+
+// Eight output columns at a time, with the nine products accumulated in a
+// register; the columns whose window crosses the border are done one by one.
+void depthwise_conv_3x3_plane__avx2_fma(
+    int H,
+    int W,
+    int out_h,
+    int out_w,
+    int stride,
+    int pad_t,
+    int pad_l,
+    const float* X,
+    const float* filter,
+    float bias,
+    float* Y) {
+  const std::vector<float> zeros(W, 0.f);
+  __m256 w[9];
+  for (int k = 0; k < 9; ++k) {
+    w[k] = _mm256_set1_ps(filter[k]);
+  }
+  for (int oh = 0; oh < out_h; ++oh) {
+    const float* rows[3];
+    for (int kh = 0; kh < 3; ++kh) {
+      const int ih = oh * stride - pad_t + kh;
+      rows[kh] = ih < 0 || ih >= H ? zeros.data() : X + ih * W;
+    }
+    float* y = Y + oh * out_w;
+    int ow = 0;
+    for (; ow < out_w && ow * stride < pad_l; ++ow) {
+      y[ow] = pixel(rows, filter, W, ow * stride - pad_l, bias);
+    }
+    if (stride == 1) {
+      // The last load of a step reads up to column iw + 9.
+      for (; ow + 8 <= out_w && ow - pad_l + 9 < W; ow += 8) {
+        const int iw = ow - pad_l;
+        __m256 acc = _mm256_set1_ps(bias);
+        for (int kh = 0; kh < 3; ++kh) {
+          for (int kw = 0; kw < 3; ++kw) {
+            acc = _mm256_fmadd_ps(
+                w[kh * 3 + kw], _mm256_loadu_ps(rows[kh] + iw + kw), acc);
+          }
+        }
+        _mm256_storeu_ps(y + ow, acc);
+      }
+    } else {
+      // The last load of a step reads up to column iw + 17.
+      for (; ow + 8 <= out_w && ow * 2 - pad_l + 17 < W; ow += 8) {
+        const int iw = ow * 2 - pad_l;
+        __m256 acc = _mm256_set1_ps(bias);
+        for (int kh = 0; kh < 3; ++kh) {
+          const float* x = rows[kh] + iw;
+          acc = _mm256_fmadd_ps(w[kh * 3], load_evens(x), acc);
+          acc = _mm256_fmadd_ps(w[kh * 3 + 1], load_odds(x), acc);
+          acc = _mm256_fmadd_ps(w[kh * 3 + 2], load_evens(x + 2), acc);
+        }
+        _mm256_storeu_ps(y + ow, acc);
+      }
+    }
+    for (; ow < out_w; ++ow) {
+      y[ow] = pixel(rows, filter, W, ow * stride - pad_l, bias);
+    }
+  }
+}
+
+} // namespace caffe2
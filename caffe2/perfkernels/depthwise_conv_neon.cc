@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Built on every platform like the other common perfkernel sources, but only
+// has contents where NEON is available, see NEON_DO in common.h.
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#include "caffe2/perfkernels/depthwise_conv.h"
+
+#include <arm_neon.h>
+#include <vector>
+
+namespace caffe2 {
+
+namespace {
+
+// Output pixel whose window starts at input column iw, for the borders.
+// Rows outside of the input point at zeros.
+inline float pixel(
+    const float* const* rows,
+    const float* filter,
+    int W,
+    int iw,
+    float bias) {
+  float sum = bias;
+  for (int kh = 0; kh < 3; ++kh) {
+    for (int kw = 0; kw < 3; ++kw) {
+      const int col = iw + kw;
+      if (col >= 0 && col < W) {
+        sum += filter[kh * 3 + kw] * rows[kh][col];
+      }
+    }
+  }
+  return sum;
+}
+
+} // namespace
+
+// Four output columns at a time, with the nine products accumulated in a
+// register; stride 2 deinterleaves the input with vld2q. The columns whose
+// window crosses the border are done one by one.
+void depthwise_conv_3x3_plane__neon(
+    int H,
+    int W,
+    int out_h,
+    int out_w,
+    int stride,
+    int pad_t,
+    int pad_l,
+    const float* X,
+    const float* filter,
+    float bias,
+    float* Y) {
+  const std::vector<float> zeros(W, 0.f);
+  float32x4_t w[9];
+  for (int k = 0; k < 9; ++k) {
+    w[k] = vdupq_n_f32(filter[k]);
+  }
+  for (int oh = 0; oh < out_h; ++oh) {
+    const float* rows[3];
+    for (int kh = 0; kh < 3; ++kh) {
+      const int ih = oh * stride - pad_t + kh;
+      rows[kh] = ih < 0 || ih >= H ? zeros.data() : X + ih * W;
+    }
+    float* y = Y + oh * out_w;
+    int ow = 0;
+    for (; ow < out_w && ow * stride < pad_l; ++ow) {
+      y[ow] = pixel(rows, filter, W, ow * stride - pad_l, bias);
+    }
+    if (stride == 1) {
+      // The last load of a step reads up to column iw + 5.
+      for (; ow + 4 <= out_w && ow - pad_l + 5 < W; ow += 4) {
+        const int iw = ow - pad_l;
+        float32x4_t acc = vdupq_n_f32(bias);
+        for (int kh = 0; kh < 3; ++kh) {
+          for (int kw = 0; kw < 3; ++kw) {
+            acc = vmlaq_f32(acc, w[kh * 3 + kw], vld1q_f32(rows[kh] + iw + kw));
+          }
+        }
+        vst1q_f32(y + ow, acc);
+      }
+    } else {
+      // The last load of a step reads up to column iw + 9.
+      for (; ow + 4 <= out_w && ow * 2 - pad_l + 9 < W; ow += 4) {
+        const int iw = ow * 2 - pad_l;
+        float32x4_t acc = vdupq_n_f32(bias);
+        for (int kh = 0; kh < 3; ++kh) {
+          const float32x4x2_t x = vld2q_f32(rows[kh] + iw);
+          const float32x4x2_t x2 = vld2q_f32(rows[kh] + iw + 2);
+          acc = vmlaq_f32(acc, w[kh * 3], x.val[0]);
+          acc = vmlaq_f32(acc, w[kh * 3 + 1], x.val[1]);
+          acc = vmlaq_f32(acc, w[kh * 3 + 2], x2.val[0]);
+        }
+        vst1q_f32(y + ow, acc);
+      }
+    }
+    for (; ow < out_w; ++ow) {
+      y[ow] = pixel(rows, filter, W, ow * stride - pad_l, bias);
+    }
+  }
+}
+
+} // namespace caffe2
+
+#endif // defined(__ARM_NEON__) || defined(__ARM_NEON)
@@ -22,6 +22,12 @@
 #include "caffe2/utils/cpuid.h"
 #include "caffe2/utils/math.h"
 
+CAFFE2_DEFINE_int(
+    caffe2_embedding_lookup_prefetch_distance,
+    16,
+    "Number of indices ahead of the current one whose rows EmbeddingLookup "
+    "prefetches into the cache. 0 disables the prefetching.");
+
 namespace caffe2 {
 
 // Base implementation does runtime dispatch for each segment of reduction
@@ -37,7 +43,8 @@ static void EmbeddingLookupGenericSlow(
     const float* weights, // optional, can be null for sum reducer
     const float* scale_bias, // optional scale & bias params for uint8 input
     bool normalize_by_lengths,
-    OutType* out) {
+    OutType* out,
+    const int prefetch_distance) {
   TIndex current = 0;
   for (int m = 0; m < output_size; ++m) {
     memset(out, 0, sizeof(OutType) * block_size);
@@ -55,8 +62,9 @@ static void EmbeddingLookupGenericSlow(
           data_size);
       CAFFE_ENFORCE_LT(idx, data_size);
 #ifdef __GNUC__
-      if (current + 1 < index_size) {
-        __builtin_prefetch(input + block_size * indices[current + 1], 0, 1);
+      if (prefetch_distance > 0 && current + prefetch_distance < index_size) {
+        __builtin_prefetch(
+            input + block_size * indices[current + prefetch_distance], 0, 1);
       }
 #endif // __GNUC__
 
@@ -105,7 +113,8 @@ static void EmbeddingLookupGenericSlow(
       const float* weights,                                        \
       const float* scale_bias,                                     \
       bool normalize_by_lengths,                                   \
-      OutType* out) {                                              \
+      OutType* out,                                                \
+      const int prefetch_distance) {                               \
     EmbeddingLookupGenericSlow<IndexType, InType, OutType>(        \
         block_size,                                                \
         output_size,                                               \
@@ -117,7 +126,8 @@ static void EmbeddingLookupGenericSlow(
         weights,                                                   \
         scale_bias,                                                \
         normalize_by_lengths,                                      \
-        out);                                                      \
+        out,                                                       \
+        prefetch_distance);                                        \
   }                                                                \
   template <>                                                      \
   void EmbeddingLookup(                                            \
@@ -132,6 +142,23 @@ static void EmbeddingLookupGenericSlow(
       const float* scale_bias,                                     \
       bool normalize_by_lengths,                                   \
       OutType* out) {                                              \
+    const int prefetch_distance =                                  \
+        FLAGS_caffe2_embedding_lookup_prefetch_distance;           \
+    CAFFE_ENFORCE_GE(prefetch_distance, 0);                        \
+    AVX512_DO(                                                     \
+        EmbeddingLookup_##IndexType##_##InType##_##OutType,        \
+        block_size,                                                \
+        output_size,                                               \
+        index_size,                                                \
+        data_size,                                                 \
+        input,                                                     \
+        indices,                                                   \
+        lengths,                                                   \
+        weights,                                                   \
+        scale_bias,                                                \
+        normalize_by_lengths,                                      \
+        out,                                                       \
+        prefetch_distance);                                        \
     AVX2_FMA_DO(                                                   \
         EmbeddingLookup_##IndexType##_##InType##_##OutType,        \
         block_size,                                                \
@@ -144,7 +171,8 @@ static void EmbeddingLookupGenericSlow(
         weights,                                                   \
         scale_bias,                                                \
         normalize_by_lengths,                                      \
-        out);                                                      \
+        out,                                                       \
+        prefetch_distance);                                        \
     BASE_DO(                                                       \
         EmbeddingLookup_##IndexType##_##InType##_##OutType,        \
         block_size,                                                \
@@ -157,7 +185,8 @@ static void EmbeddingLookupGenericSlow(
         weights,                                                   \
         scale_bias,                                                \
         normalize_by_lengths,                                      \
-        out);                                                      \
+        out,                                                       \
+        prefetch_distance);                                        \
   }
 
 EMBEDDING_SPECIALIZATION(int32_t, float, float);
@@ -166,6 +195,8 @@ EMBEDDING_SPECIALIZATION(int32_t, float16, float);
 EMBEDDING_SPECIALIZATION(int64_t, float16, float);
 EMBEDDING_SPECIALIZATION(int32_t, uint8_t, float);
 EMBEDDING_SPECIALIZATION(int64_t, uint8_t, float);
+EMBEDDING_SPECIALIZATION(int32_t, bfloat16, float);
+EMBEDDING_SPECIALIZATION(int64_t, bfloat16, float);
 
 #undef EMBEDDING_SPECIALIZATION
 
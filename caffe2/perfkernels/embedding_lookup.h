@@ -17,6 +17,9 @@
 #pragma once
 
 #include "caffe2/core/common.h"
+#include "caffe2/core/flags.h"
+
+CAFFE2_DECLARE_int(caffe2_embedding_lookup_prefetch_distance);
 
 namespace caffe2 {
 
@@ -45,6 +48,9 @@ namespace caffe2 {
  *     for (k = 0..block_size-1)
  *       out[i*block_size + k] /= lengths[i]
  *
+ * While reducing the row of indices[pos] the kernels prefetch the row of
+ * indices[pos + caffe2_embedding_lookup_prefetch_distance], which hides the
+ * DRAM latency of random accesses into tables much larger than the cache.
  */
 template <typename IndexType, typename InType, typename OutType>
 void EmbeddingLookup(
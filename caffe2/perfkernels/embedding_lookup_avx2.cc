@@ -27,6 +27,10 @@
 
 namespace caffe2 {
 
+inline __m256 cvtbf16_ps(__m128i x) {
+  return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(x), 16));
+}
+
 void EmbeddingLookup_int32_t_float_float__avx2_fma(
     const TIndex block_size,
     const TIndex output_size,
@@ -38,8 +42,9 @@ void EmbeddingLookup_int32_t_float_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
-    float* out) {
-  const int32_t prefdist_T0 = 16;
+    float* out,
+    const int prefetch_distance) {
+  const int32_t prefdist_T0 = prefetch_distance;
   CAFFE_ENFORCE(scale_bias == nullptr, "scale_bias must be nullptr");
   if (block_size == 128) {
     // unrolling 16 times
@@ -112,7 +117,7 @@ void EmbeddingLookup_int32_t_float_float__avx2_fma(
         vop120 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (120)), vop120);
         // skip unecassery prefetch of (&ip_next_T0[120])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -129,7 +134,7 @@ void EmbeddingLookup_int32_t_float_float__avx2_fma(
         _mm256_storeu_ps(&op[104], vop104);
         _mm256_storeu_ps(&op[112], vop112);
         _mm256_storeu_ps(&op[120], vop120);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -196,7 +201,7 @@ void EmbeddingLookup_int32_t_float_float__avx2_fma(
         vop56 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (56)), vop56);
         // skip unecassery prefetch of (&ip_next_T0[56])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -205,7 +210,7 @@ void EmbeddingLookup_int32_t_float_float__avx2_fma(
         _mm256_storeu_ps(&op[40], vop40);
         _mm256_storeu_ps(&op[48], vop48);
         _mm256_storeu_ps(&op[56], vop56);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -252,12 +257,12 @@ void EmbeddingLookup_int32_t_float_float__avx2_fma(
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
         // skip unecassery prefetch of (&ip_next_T0[24])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
         _mm256_storeu_ps(&op[24], vop24);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -294,10 +299,10 @@ void EmbeddingLookup_int32_t_float_float__avx2_fma(
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
         // skip unecassery prefetch of (&ip_next_T0[8])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -371,8 +376,9 @@ void EmbeddingLookup_int64_t_float_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
-    float* out) {
-  const int64_t prefdist_T0 = 16;
+    float* out,
+    const int prefetch_distance) {
+  const int64_t prefdist_T0 = prefetch_distance;
   CAFFE_ENFORCE(scale_bias == nullptr, "scale_bias must be nullptr");
   if (block_size == 128) {
     // unrolling 16 times
@@ -445,7 +451,7 @@ void EmbeddingLookup_int64_t_float_float__avx2_fma(
         vop120 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (120)), vop120);
         // skip unecassery prefetch of (&ip_next_T0[120])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -462,7 +468,7 @@ void EmbeddingLookup_int64_t_float_float__avx2_fma(
         _mm256_storeu_ps(&op[104], vop104);
         _mm256_storeu_ps(&op[112], vop112);
         _mm256_storeu_ps(&op[120], vop120);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -529,7 +535,7 @@ void EmbeddingLookup_int64_t_float_float__avx2_fma(
         vop56 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (56)), vop56);
         // skip unecassery prefetch of (&ip_next_T0[56])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -538,7 +544,7 @@ void EmbeddingLookup_int64_t_float_float__avx2_fma(
         _mm256_storeu_ps(&op[40], vop40);
         _mm256_storeu_ps(&op[48], vop48);
         _mm256_storeu_ps(&op[56], vop56);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -585,12 +591,12 @@ void EmbeddingLookup_int64_t_float_float__avx2_fma(
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
         // skip unecassery prefetch of (&ip_next_T0[24])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
         _mm256_storeu_ps(&op[24], vop24);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -627,10 +633,10 @@ void EmbeddingLookup_int64_t_float_float__avx2_fma(
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
         // skip unecassery prefetch of (&ip_next_T0[8])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -704,8 +710,9 @@ void EmbeddingLookup_int32_t_float16_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
-    float* out) {
-  const int32_t prefdist_T0 = 16;
+    float* out,
+    const int prefetch_distance) {
+  const int32_t prefdist_T0 = prefetch_distance;
   CAFFE_ENFORCE(scale_bias == nullptr, "scale_bias must be nullptr");
   if (block_size == 128) {
     // unrolling 16 times
@@ -842,7 +849,7 @@ void EmbeddingLookup_int32_t_float16_float__avx2_fma(
             vop120);
         // skip unecassery prefetch of (&ip_next_T0[120])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -859,7 +866,7 @@ void EmbeddingLookup_int32_t_float16_float__avx2_fma(
         _mm256_storeu_ps(&op[104], vop104);
         _mm256_storeu_ps(&op[112], vop112);
         _mm256_storeu_ps(&op[120], vop120);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -958,7 +965,7 @@ void EmbeddingLookup_int32_t_float16_float__avx2_fma(
             vop56);
         // skip unecassery prefetch of (&ip_next_T0[56])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -967,7 +974,7 @@ void EmbeddingLookup_int32_t_float16_float__avx2_fma(
         _mm256_storeu_ps(&op[40], vop40);
         _mm256_storeu_ps(&op[48], vop48);
         _mm256_storeu_ps(&op[56], vop56);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -1030,12 +1037,12 @@ void EmbeddingLookup_int32_t_float16_float__avx2_fma(
             vop24);
         // skip unecassery prefetch of (&ip_next_T0[24])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
         _mm256_storeu_ps(&op[24], vop24);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -1080,10 +1087,10 @@ void EmbeddingLookup_int32_t_float16_float__avx2_fma(
             vop8);
         // skip unecassery prefetch of (&ip_next_T0[8])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -1163,8 +1170,9 @@ void EmbeddingLookup_int64_t_float16_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
-    float* out) {
-  const int64_t prefdist_T0 = 16;
+    float* out,
+    const int prefetch_distance) {
+  const int64_t prefdist_T0 = prefetch_distance;
   CAFFE_ENFORCE(scale_bias == nullptr, "scale_bias must be nullptr");
   if (block_size == 128) {
     // unrolling 16 times
@@ -1301,7 +1309,7 @@ void EmbeddingLookup_int64_t_float16_float__avx2_fma(
             vop120);
         // skip unecassery prefetch of (&ip_next_T0[120])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -1318,7 +1326,7 @@ void EmbeddingLookup_int64_t_float16_float__avx2_fma(
         _mm256_storeu_ps(&op[104], vop104);
         _mm256_storeu_ps(&op[112], vop112);
         _mm256_storeu_ps(&op[120], vop120);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -1417,7 +1425,7 @@ void EmbeddingLookup_int64_t_float16_float__avx2_fma(
             vop56);
         // skip unecassery prefetch of (&ip_next_T0[56])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -1426,7 +1434,7 @@ void EmbeddingLookup_int64_t_float16_float__avx2_fma(
         _mm256_storeu_ps(&op[40], vop40);
         _mm256_storeu_ps(&op[48], vop48);
         _mm256_storeu_ps(&op[56], vop56);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -1489,12 +1497,12 @@ void EmbeddingLookup_int64_t_float16_float__avx2_fma(
             vop24);
         // skip unecassery prefetch of (&ip_next_T0[24])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
         _mm256_storeu_ps(&op[24], vop24);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -1539,10 +1547,10 @@ void EmbeddingLookup_int64_t_float16_float__avx2_fma(
             vop8);
         // skip unecassery prefetch of (&ip_next_T0[8])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -1622,8 +1630,9 @@ void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
-    float* out) {
-  const int32_t prefdist_T0 = 16;
+    float* out,
+    const int prefetch_distance) {
+  const int32_t prefdist_T0 = prefetch_distance;
   CAFFE_ENFORCE(scale_bias != nullptr, "scale_bias must not be nullptr");
   if (block_size == 128) {
     // unrolling 16 times
@@ -1764,7 +1773,7 @@ void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
             _mm256_add_ps(vop120, vbio));
         // skip unecassery prefetch of (&ip_next_T0[120])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -1781,7 +1790,7 @@ void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         _mm256_storeu_ps(&op[104], vop104);
         _mm256_storeu_ps(&op[112], vop112);
         _mm256_storeu_ps(&op[120], vop120);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -1884,7 +1893,7 @@ void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
             _mm256_add_ps(vop56, vbio));
         // skip unecassery prefetch of (&ip_next_T0[56])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -1893,7 +1902,7 @@ void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         _mm256_storeu_ps(&op[40], vop40);
         _mm256_storeu_ps(&op[48], vop48);
         _mm256_storeu_ps(&op[56], vop56);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -1960,12 +1969,12 @@ void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
             _mm256_add_ps(vop24, vbio));
         // skip unecassery prefetch of (&ip_next_T0[24])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
         _mm256_storeu_ps(&op[24], vop24);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -2014,10 +2023,10 @@ void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
             _mm256_add_ps(vop8, vbio));
         // skip unecassery prefetch of (&ip_next_T0[8])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -2099,8 +2108,9 @@ void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
-    float* out) {
-  const int64_t prefdist_T0 = 16;
+    float* out,
+    const int prefetch_distance) {
+  const int64_t prefdist_T0 = prefetch_distance;
   CAFFE_ENFORCE(scale_bias != nullptr, "scale_bias must not be nullptr");
   if (block_size == 128) {
     // unrolling 16 times
@@ -2241,7 +2251,7 @@ void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
             _mm256_add_ps(vop120, vbio));
         // skip unecassery prefetch of (&ip_next_T0[120])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -2258,7 +2268,7 @@ void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         _mm256_storeu_ps(&op[104], vop104);
         _mm256_storeu_ps(&op[112], vop112);
         _mm256_storeu_ps(&op[120], vop120);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -2361,7 +2371,7 @@ void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
             _mm256_add_ps(vop56, vbio));
         // skip unecassery prefetch of (&ip_next_T0[56])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
@@ -2370,7 +2380,7 @@ void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         _mm256_storeu_ps(&op[40], vop40);
         _mm256_storeu_ps(&op[48], vop48);
         _mm256_storeu_ps(&op[56], vop56);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -2437,12 +2447,12 @@ void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
             _mm256_add_ps(vop24, vbio));
         // skip unecassery prefetch of (&ip_next_T0[24])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
         _mm256_storeu_ps(&op[16], vop16);
         _mm256_storeu_ps(&op[24], vop24);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -2491,10 +2501,10 @@ void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
             _mm256_add_ps(vop8, vbio));
         // skip unecassery prefetch of (&ip_next_T0[8])
       }
-      if (normalize_by_lengths == false) {
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
         _mm256_storeu_ps(&op[0], vop0);
         _mm256_storeu_ps(&op[8], vop8);
-      } else if (lengths[rangeIndex]) {
+      } else {
         __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
         _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
         _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
@@ -2565,4 +2575,923 @@ void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
   }
 }
 
+void EmbeddingLookup_int32_t_bfloat16_float__avx2_fma(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const bfloat16* input,
+    const int32_t* indices,
+    const int* lengths,
+    const float* weights,
+    const float* scale_bias,
+    bool normalize_by_lengths,
+    float* out,
+    const int prefetch_distance) {
+  const int32_t prefdist_T0 = prefetch_distance;
+  CAFFE_ENFORCE(scale_bias == nullptr, "scale_bias must be nullptr");
+  if (block_size == 128) {
+    // unrolling 16 times
+    int32_t dataInd = 0;
+    for (int32_t rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+      float* op = &out[rangeIndex * block_size];
+      __m256 vop0 = _mm256_setzero_ps();
+      __m256 vop8 = _mm256_setzero_ps();
+      __m256 vop16 = _mm256_setzero_ps();
+      __m256 vop24 = _mm256_setzero_ps();
+      __m256 vop32 = _mm256_setzero_ps();
+      __m256 vop40 = _mm256_setzero_ps();
+      __m256 vop48 = _mm256_setzero_ps();
+      __m256 vop56 = _mm256_setzero_ps();
+      __m256 vop64 = _mm256_setzero_ps();
+      __m256 vop72 = _mm256_setzero_ps();
+      __m256 vop80 = _mm256_setzero_ps();
+      __m256 vop88 = _mm256_setzero_ps();
+      __m256 vop96 = _mm256_setzero_ps();
+      __m256 vop104 = _mm256_setzero_ps();
+      __m256 vop112 = _mm256_setzero_ps();
+      __m256 vop120 = _mm256_setzero_ps();
+      for (int32_t start = dataInd; dataInd < start + lengths[rangeIndex];
+           ++dataInd) {
+        const int32_t idx = indices[dataInd];
+        float wgt = 1.f;
+        if (weights) {
+          wgt = weights[dataInd];
+        }
+        __m256 vwgt = _mm256_set1_ps(wgt);
+        const bfloat16* ip = &input[idx * block_size];
+        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+            ? (dataInd + prefdist_T0)
+            : dataInd;
+        const int32_t idx_pref_T0 = indices[next_T0];
+        CAFFE_ENFORCE(
+            idx >= 0 && idx_pref_T0 >= 0 && idx < data_size &&
+            idx_pref_T0 < data_size);
+        const bfloat16* ip_next_T0 = &input[idx_pref_T0 * block_size];
+        vop0 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
+            vop0);
+        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        vop8 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
+            vop8);
+        // skip unecassery prefetch of (&ip_next_T0[8])
+        vop16 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
+            vop16);
+        // skip unecassery prefetch of (&ip_next_T0[16])
+        vop24 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
+            vop24);
+        // skip unecassery prefetch of (&ip_next_T0[24])
+        vop32 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
+            vop32);
+        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+        vop40 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
+            vop40);
+        // skip unecassery prefetch of (&ip_next_T0[40])
+        vop48 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
+            vop48);
+        // skip unecassery prefetch of (&ip_next_T0[48])
+        vop56 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
+            vop56);
+        // skip unecassery prefetch of (&ip_next_T0[56])
+        vop64 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (64)))),
+            vop64);
+        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+        vop72 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (72)))),
+            vop72);
+        // skip unecassery prefetch of (&ip_next_T0[72])
+        vop80 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (80)))),
+            vop80);
+        // skip unecassery prefetch of (&ip_next_T0[80])
+        vop88 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (88)))),
+            vop88);
+        // skip unecassery prefetch of (&ip_next_T0[88])
+        vop96 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (96)))),
+            vop96);
+        _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
+        vop104 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (104)))),
+            vop104);
+        // skip unecassery prefetch of (&ip_next_T0[104])
+        vop112 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (112)))),
+            vop112);
+        // skip unecassery prefetch of (&ip_next_T0[112])
+        vop120 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (120)))),
+            vop120);
+        // skip unecassery prefetch of (&ip_next_T0[120])
+      }
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
+        _mm256_storeu_ps(&op[0], vop0);
+        _mm256_storeu_ps(&op[8], vop8);
+        _mm256_storeu_ps(&op[16], vop16);
+        _mm256_storeu_ps(&op[24], vop24);
+        _mm256_storeu_ps(&op[32], vop32);
+        _mm256_storeu_ps(&op[40], vop40);
+        _mm256_storeu_ps(&op[48], vop48);
+        _mm256_storeu_ps(&op[56], vop56);
+        _mm256_storeu_ps(&op[64], vop64);
+        _mm256_storeu_ps(&op[72], vop72);
+        _mm256_storeu_ps(&op[80], vop80);
+        _mm256_storeu_ps(&op[88], vop88);
+        _mm256_storeu_ps(&op[96], vop96);
+        _mm256_storeu_ps(&op[104], vop104);
+        _mm256_storeu_ps(&op[112], vop112);
+        _mm256_storeu_ps(&op[120], vop120);
+      } else {
+        __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
+        _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
+        _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
+        _mm256_storeu_ps(&op[16], _mm256_mul_ps(vop16, vlen_inv));
+        _mm256_storeu_ps(&op[24], _mm256_mul_ps(vop24, vlen_inv));
+        _mm256_storeu_ps(&op[32], _mm256_mul_ps(vop32, vlen_inv));
+        _mm256_storeu_ps(&op[40], _mm256_mul_ps(vop40, vlen_inv));
+        _mm256_storeu_ps(&op[48], _mm256_mul_ps(vop48, vlen_inv));
+        _mm256_storeu_ps(&op[56], _mm256_mul_ps(vop56, vlen_inv));
+        _mm256_storeu_ps(&op[64], _mm256_mul_ps(vop64, vlen_inv));
+        _mm256_storeu_ps(&op[72], _mm256_mul_ps(vop72, vlen_inv));
+        _mm256_storeu_ps(&op[80], _mm256_mul_ps(vop80, vlen_inv));
+        _mm256_storeu_ps(&op[88], _mm256_mul_ps(vop88, vlen_inv));
+        _mm256_storeu_ps(&op[96], _mm256_mul_ps(vop96, vlen_inv));
+        _mm256_storeu_ps(&op[104], _mm256_mul_ps(vop104, vlen_inv));
+        _mm256_storeu_ps(&op[112], _mm256_mul_ps(vop112, vlen_inv));
+        _mm256_storeu_ps(&op[120], _mm256_mul_ps(vop120, vlen_inv));
+      }
+    }
+  } else if (block_size == 64) {
+    // unrolling 8 times
+    int32_t dataInd = 0;
+    for (int32_t rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+      float* op = &out[rangeIndex * block_size];
+      __m256 vop0 = _mm256_setzero_ps();
+      __m256 vop8 = _mm256_setzero_ps();
+      __m256 vop16 = _mm256_setzero_ps();
+      __m256 vop24 = _mm256_setzero_ps();
+      __m256 vop32 = _mm256_setzero_ps();
+      __m256 vop40 = _mm256_setzero_ps();
+      __m256 vop48 = _mm256_setzero_ps();
+      __m256 vop56 = _mm256_setzero_ps();
+      for (int32_t start = dataInd; dataInd < start + lengths[rangeIndex];
+           ++dataInd) {
+        const int32_t idx = indices[dataInd];
+        float wgt = 1.f;
+        if (weights) {
+          wgt = weights[dataInd];
+        }
+        __m256 vwgt = _mm256_set1_ps(wgt);
+        const bfloat16* ip = &input[idx * block_size];
+        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+            ? (dataInd + prefdist_T0)
+            : dataInd;
+        const int32_t idx_pref_T0 = indices[next_T0];
+        CAFFE_ENFORCE(
+            idx >= 0 && idx_pref_T0 >= 0 && idx < data_size &&
+            idx_pref_T0 < data_size);
+        const bfloat16* ip_next_T0 = &input[idx_pref_T0 * block_size];
+        vop0 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
+            vop0);
+        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        vop8 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
+            vop8);
+        // skip unecassery prefetch of (&ip_next_T0[8])
+        vop16 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
+            vop16);
+        // skip unecassery prefetch of (&ip_next_T0[16])
+        vop24 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
+            vop24);
+        // skip unecassery prefetch of (&ip_next_T0[24])
+        vop32 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
+            vop32);
+        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+        vop40 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
+            vop40);
+        // skip unecassery prefetch of (&ip_next_T0[40])
+        vop48 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
+            vop48);
+        // skip unecassery prefetch of (&ip_next_T0[48])
+        vop56 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
+            vop56);
+        // skip unecassery prefetch of (&ip_next_T0[56])
+      }
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
+        _mm256_storeu_ps(&op[0], vop0);
+        _mm256_storeu_ps(&op[8], vop8);
+        _mm256_storeu_ps(&op[16], vop16);
+        _mm256_storeu_ps(&op[24], vop24);
+        _mm256_storeu_ps(&op[32], vop32);
+        _mm256_storeu_ps(&op[40], vop40);
+        _mm256_storeu_ps(&op[48], vop48);
+        _mm256_storeu_ps(&op[56], vop56);
+      } else {
+        __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
+        _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
+        _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
+        _mm256_storeu_ps(&op[16], _mm256_mul_ps(vop16, vlen_inv));
+        _mm256_storeu_ps(&op[24], _mm256_mul_ps(vop24, vlen_inv));
+        _mm256_storeu_ps(&op[32], _mm256_mul_ps(vop32, vlen_inv));
+        _mm256_storeu_ps(&op[40], _mm256_mul_ps(vop40, vlen_inv));
+        _mm256_storeu_ps(&op[48], _mm256_mul_ps(vop48, vlen_inv));
+        _mm256_storeu_ps(&op[56], _mm256_mul_ps(vop56, vlen_inv));
+      }
+    }
+  } else if (block_size == 32) {
+    // unrolling 4 times
+    int32_t dataInd = 0;
+    for (int32_t rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+      float* op = &out[rangeIndex * block_size];
+      __m256 vop0 = _mm256_setzero_ps();
+      __m256 vop8 = _mm256_setzero_ps();
+      __m256 vop16 = _mm256_setzero_ps();
+      __m256 vop24 = _mm256_setzero_ps();
+      for (int32_t start = dataInd; dataInd < start + lengths[rangeIndex];
+           ++dataInd) {
+        const int32_t idx = indices[dataInd];
+        float wgt = 1.f;
+        if (weights) {
+          wgt = weights[dataInd];
+        }
+        __m256 vwgt = _mm256_set1_ps(wgt);
+        const bfloat16* ip = &input[idx * block_size];
+        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+            ? (dataInd + prefdist_T0)
+            : dataInd;
+        const int32_t idx_pref_T0 = indices[next_T0];
+        CAFFE_ENFORCE(
+            idx >= 0 && idx_pref_T0 >= 0 && idx < data_size &&
+            idx_pref_T0 < data_size);
+        const bfloat16* ip_next_T0 = &input[idx_pref_T0 * block_size];
+        vop0 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
+            vop0);
+        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        vop8 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
+            vop8);
+        // skip unecassery prefetch of (&ip_next_T0[8])
+        vop16 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
+            vop16);
+        // skip unecassery prefetch of (&ip_next_T0[16])
+        vop24 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
+            vop24);
+        // skip unecassery prefetch of (&ip_next_T0[24])
+      }
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
+        _mm256_storeu_ps(&op[0], vop0);
+        _mm256_storeu_ps(&op[8], vop8);
+        _mm256_storeu_ps(&op[16], vop16);
+        _mm256_storeu_ps(&op[24], vop24);
+      } else {
+        __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
+        _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
+        _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
+        _mm256_storeu_ps(&op[16], _mm256_mul_ps(vop16, vlen_inv));
+        _mm256_storeu_ps(&op[24], _mm256_mul_ps(vop24, vlen_inv));
+      }
+    }
+  } else if (block_size == 16) {
+    // unrolling 2 times
+    int32_t dataInd = 0;
+    for (int32_t rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+      float* op = &out[rangeIndex * block_size];
+      __m256 vop0 = _mm256_setzero_ps();
+      __m256 vop8 = _mm256_setzero_ps();
+      for (int32_t start = dataInd; dataInd < start + lengths[rangeIndex];
+           ++dataInd) {
+        const int32_t idx = indices[dataInd];
+        float wgt = 1.f;
+        if (weights) {
+          wgt = weights[dataInd];
+        }
+        __m256 vwgt = _mm256_set1_ps(wgt);
+        const bfloat16* ip = &input[idx * block_size];
+        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+            ? (dataInd + prefdist_T0)
+            : dataInd;
+        const int32_t idx_pref_T0 = indices[next_T0];
+        CAFFE_ENFORCE(
+            idx >= 0 && idx_pref_T0 >= 0 && idx < data_size &&
+            idx_pref_T0 < data_size);
+        const bfloat16* ip_next_T0 = &input[idx_pref_T0 * block_size];
+        vop0 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
+            vop0);
+        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        vop8 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
+            vop8);
+        // skip unecassery prefetch of (&ip_next_T0[8])
+      }
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
+        _mm256_storeu_ps(&op[0], vop0);
+        _mm256_storeu_ps(&op[8], vop8);
+      } else {
+        __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
+        _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
+        _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
+      }
+    }
+  } else {
+    // generic code
+    int32_t dataInd = 0;
+    for (int32_t rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+      float* op = &out[rangeIndex * block_size];
+      TIndex j = 0;
+      for (; j + 8 <= block_size; j += 8) {
+        _mm256_storeu_ps(op + j, _mm256_setzero_ps());
+      }
+      for (; j < block_size; j++) {
+        op[j] = 0.0f;
+      }
+      for (int32_t start = dataInd; dataInd < start + lengths[rangeIndex];
+           ++dataInd) {
+        const int32_t idx = indices[dataInd];
+        float wgt = 1.f;
+        if (weights) {
+          wgt = weights[dataInd];
+        }
+        __m256 vwgt = _mm256_set1_ps(wgt);
+        const bfloat16* ip = &input[idx * block_size];
+        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+            ? (dataInd + prefdist_T0)
+            : dataInd;
+        const int32_t idx_pref_T0 = indices[next_T0];
+        CAFFE_ENFORCE(
+            idx >= 0 && idx_pref_T0 >= 0 && idx < data_size &&
+            idx_pref_T0 < data_size);
+        const bfloat16* ip_next_T0 = &input[idx_pref_T0 * block_size];
+        j = 0;
+        for (; j + 8 <= block_size; j += 8) {
+          _mm256_storeu_ps(
+              &op[j],
+              _mm256_fmadd_ps(
+                  vwgt,
+                  cvtbf16_ps(_mm_loadu_si128(
+                      reinterpret_cast<const __m128i*>(&ip[j]))),
+                  _mm256_loadu_ps(&op[j])));
+          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
+        }
+        bfloat16 vtmp1[8] CAFFE2_ALIGNED(64);
+        for (; j < block_size; j++) {
+          vtmp1[0] = ip[j];
+          __m256 vtmp2 = cvtbf16_ps(*((__m128i*)vtmp1));
+          op[j] += wgt * ((float*)(&vtmp2))[0];
+        }
+      }
+      if (normalize_by_lengths && lengths[rangeIndex]) {
+        float len_inv = 1.0f / lengths[rangeIndex];
+        __m256 vlen_inv = _mm256_set1_ps(len_inv);
+        j = 0;
+        for (; j + 8 <= block_size; j += 8) {
+          _mm256_storeu_ps(
+              &op[j], _mm256_mul_ps(_mm256_loadu_ps(&op[j]), vlen_inv));
+        }
+        for (; j < block_size; j++) {
+          op[j] = len_inv * op[j];
+        }
+      }
+    }
+  }
+}
+
+void EmbeddingLookup_int64_t_bfloat16_float__avx2_fma(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const bfloat16* input,
+    const int64_t* indices,
+    const int* lengths,
+    const float* weights,
+    const float* scale_bias,
+    bool normalize_by_lengths,
+    float* out,
+    const int prefetch_distance) {
+  const int64_t prefdist_T0 = prefetch_distance;
+  CAFFE_ENFORCE(scale_bias == nullptr, "scale_bias must be nullptr");
+  if (block_size == 128) {
+    // unrolling 16 times
+    int64_t dataInd = 0;
+    for (int64_t rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+      float* op = &out[rangeIndex * block_size];
+      __m256 vop0 = _mm256_setzero_ps();
+      __m256 vop8 = _mm256_setzero_ps();
+      __m256 vop16 = _mm256_setzero_ps();
+      __m256 vop24 = _mm256_setzero_ps();
+      __m256 vop32 = _mm256_setzero_ps();
+      __m256 vop40 = _mm256_setzero_ps();
+      __m256 vop48 = _mm256_setzero_ps();
+      __m256 vop56 = _mm256_setzero_ps();
+      __m256 vop64 = _mm256_setzero_ps();
+      __m256 vop72 = _mm256_setzero_ps();
+      __m256 vop80 = _mm256_setzero_ps();
+      __m256 vop88 = _mm256_setzero_ps();
+      __m256 vop96 = _mm256_setzero_ps();
+      __m256 vop104 = _mm256_setzero_ps();
+      __m256 vop112 = _mm256_setzero_ps();
+      __m256 vop120 = _mm256_setzero_ps();
+      for (int64_t start = dataInd; dataInd < start + lengths[rangeIndex];
+           ++dataInd) {
+        const int64_t idx = indices[dataInd];
+        float wgt = 1.f;
+        if (weights) {
+          wgt = weights[dataInd];
+        }
+        __m256 vwgt = _mm256_set1_ps(wgt);
+        const bfloat16* ip = &input[idx * block_size];
+        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+            ? (dataInd + prefdist_T0)
+            : dataInd;
+        const int64_t idx_pref_T0 = indices[next_T0];
+        CAFFE_ENFORCE(
+            idx >= 0 && idx_pref_T0 >= 0 && idx < data_size &&
+            idx_pref_T0 < data_size);
+        const bfloat16* ip_next_T0 = &input[idx_pref_T0 * block_size];
+        vop0 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
+            vop0);
+        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        vop8 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
+            vop8);
+        // skip unecassery prefetch of (&ip_next_T0[8])
+        vop16 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
+            vop16);
+        // skip unecassery prefetch of (&ip_next_T0[16])
+        vop24 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
+            vop24);
+        // skip unecassery prefetch of (&ip_next_T0[24])
+        vop32 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
+            vop32);
+        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+        vop40 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
+            vop40);
+        // skip unecassery prefetch of (&ip_next_T0[40])
+        vop48 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
+            vop48);
+        // skip unecassery prefetch of (&ip_next_T0[48])
+        vop56 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
+            vop56);
+        // skip unecassery prefetch of (&ip_next_T0[56])
+        vop64 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (64)))),
+            vop64);
+        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+        vop72 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (72)))),
+            vop72);
+        // skip unecassery prefetch of (&ip_next_T0[72])
+        vop80 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (80)))),
+            vop80);
+        // skip unecassery prefetch of (&ip_next_T0[80])
+        vop88 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (88)))),
+            vop88);
+        // skip unecassery prefetch of (&ip_next_T0[88])
+        vop96 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (96)))),
+            vop96);
+        _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
+        vop104 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (104)))),
+            vop104);
+        // skip unecassery prefetch of (&ip_next_T0[104])
+        vop112 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (112)))),
+            vop112);
+        // skip unecassery prefetch of (&ip_next_T0[112])
+        vop120 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (120)))),
+            vop120);
+        // skip unecassery prefetch of (&ip_next_T0[120])
+      }
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
+        _mm256_storeu_ps(&op[0], vop0);
+        _mm256_storeu_ps(&op[8], vop8);
+        _mm256_storeu_ps(&op[16], vop16);
+        _mm256_storeu_ps(&op[24], vop24);
+        _mm256_storeu_ps(&op[32], vop32);
+        _mm256_storeu_ps(&op[40], vop40);
+        _mm256_storeu_ps(&op[48], vop48);
+        _mm256_storeu_ps(&op[56], vop56);
+        _mm256_storeu_ps(&op[64], vop64);
+        _mm256_storeu_ps(&op[72], vop72);
+        _mm256_storeu_ps(&op[80], vop80);
+        _mm256_storeu_ps(&op[88], vop88);
+        _mm256_storeu_ps(&op[96], vop96);
+        _mm256_storeu_ps(&op[104], vop104);
+        _mm256_storeu_ps(&op[112], vop112);
+        _mm256_storeu_ps(&op[120], vop120);
+      } else {
+        __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
+        _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
+        _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
+        _mm256_storeu_ps(&op[16], _mm256_mul_ps(vop16, vlen_inv));
+        _mm256_storeu_ps(&op[24], _mm256_mul_ps(vop24, vlen_inv));
+        _mm256_storeu_ps(&op[32], _mm256_mul_ps(vop32, vlen_inv));
+        _mm256_storeu_ps(&op[40], _mm256_mul_ps(vop40, vlen_inv));
+        _mm256_storeu_ps(&op[48], _mm256_mul_ps(vop48, vlen_inv));
+        _mm256_storeu_ps(&op[56], _mm256_mul_ps(vop56, vlen_inv));
+        _mm256_storeu_ps(&op[64], _mm256_mul_ps(vop64, vlen_inv));
+        _mm256_storeu_ps(&op[72], _mm256_mul_ps(vop72, vlen_inv));
+        _mm256_storeu_ps(&op[80], _mm256_mul_ps(vop80, vlen_inv));
+        _mm256_storeu_ps(&op[88], _mm256_mul_ps(vop88, vlen_inv));
+        _mm256_storeu_ps(&op[96], _mm256_mul_ps(vop96, vlen_inv));
+        _mm256_storeu_ps(&op[104], _mm256_mul_ps(vop104, vlen_inv));
+        _mm256_storeu_ps(&op[112], _mm256_mul_ps(vop112, vlen_inv));
+        _mm256_storeu_ps(&op[120], _mm256_mul_ps(vop120, vlen_inv));
+      }
+    }
+  } else if (block_size == 64) {
+    // unrolling 8 times
+    int64_t dataInd = 0;
+    for (int64_t rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+      float* op = &out[rangeIndex * block_size];
+      __m256 vop0 = _mm256_setzero_ps();
+      __m256 vop8 = _mm256_setzero_ps();
+      __m256 vop16 = _mm256_setzero_ps();
+      __m256 vop24 = _mm256_setzero_ps();
+      __m256 vop32 = _mm256_setzero_ps();
+      __m256 vop40 = _mm256_setzero_ps();
+      __m256 vop48 = _mm256_setzero_ps();
+      __m256 vop56 = _mm256_setzero_ps();
+      for (int64_t start = dataInd; dataInd < start + lengths[rangeIndex];
+           ++dataInd) {
+        const int64_t idx = indices[dataInd];
+        float wgt = 1.f;
+        if (weights) {
+          wgt = weights[dataInd];
+        }
+        __m256 vwgt = _mm256_set1_ps(wgt);
+        const bfloat16* ip = &input[idx * block_size];
+        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+            ? (dataInd + prefdist_T0)
+            : dataInd;
+        const int64_t idx_pref_T0 = indices[next_T0];
+        CAFFE_ENFORCE(
+            idx >= 0 && idx_pref_T0 >= 0 && idx < data_size &&
+            idx_pref_T0 < data_size);
+        const bfloat16* ip_next_T0 = &input[idx_pref_T0 * block_size];
+        vop0 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
+            vop0);
+        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        vop8 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
+            vop8);
+        // skip unecassery prefetch of (&ip_next_T0[8])
+        vop16 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
+            vop16);
+        // skip unecassery prefetch of (&ip_next_T0[16])
+        vop24 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
+            vop24);
+        // skip unecassery prefetch of (&ip_next_T0[24])
+        vop32 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
+            vop32);
+        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+        vop40 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
+            vop40);
+        // skip unecassery prefetch of (&ip_next_T0[40])
+        vop48 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
+            vop48);
+        // skip unecassery prefetch of (&ip_next_T0[48])
+        vop56 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
+            vop56);
+        // skip unecassery prefetch of (&ip_next_T0[56])
+      }
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
+        _mm256_storeu_ps(&op[0], vop0);
+        _mm256_storeu_ps(&op[8], vop8);
+        _mm256_storeu_ps(&op[16], vop16);
+        _mm256_storeu_ps(&op[24], vop24);
+        _mm256_storeu_ps(&op[32], vop32);
+        _mm256_storeu_ps(&op[40], vop40);
+        _mm256_storeu_ps(&op[48], vop48);
+        _mm256_storeu_ps(&op[56], vop56);
+      } else {
+        __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
+        _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
+        _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
+        _mm256_storeu_ps(&op[16], _mm256_mul_ps(vop16, vlen_inv));
+        _mm256_storeu_ps(&op[24], _mm256_mul_ps(vop24, vlen_inv));
+        _mm256_storeu_ps(&op[32], _mm256_mul_ps(vop32, vlen_inv));
+        _mm256_storeu_ps(&op[40], _mm256_mul_ps(vop40, vlen_inv));
+        _mm256_storeu_ps(&op[48], _mm256_mul_ps(vop48, vlen_inv));
+        _mm256_storeu_ps(&op[56], _mm256_mul_ps(vop56, vlen_inv));
+      }
+    }
+  } else if (block_size == 32) {
+    // unrolling 4 times
+    int64_t dataInd = 0;
+    for (int64_t rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+      float* op = &out[rangeIndex * block_size];
+      __m256 vop0 = _mm256_setzero_ps();
+      __m256 vop8 = _mm256_setzero_ps();
+      __m256 vop16 = _mm256_setzero_ps();
+      __m256 vop24 = _mm256_setzero_ps();
+      for (int64_t start = dataInd; dataInd < start + lengths[rangeIndex];
+           ++dataInd) {
+        const int64_t idx = indices[dataInd];
+        float wgt = 1.f;
+        if (weights) {
+          wgt = weights[dataInd];
+        }
+        __m256 vwgt = _mm256_set1_ps(wgt);
+        const bfloat16* ip = &input[idx * block_size];
+        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+            ? (dataInd + prefdist_T0)
+            : dataInd;
+        const int64_t idx_pref_T0 = indices[next_T0];
+        CAFFE_ENFORCE(
+            idx >= 0 && idx_pref_T0 >= 0 && idx < data_size &&
+            idx_pref_T0 < data_size);
+        const bfloat16* ip_next_T0 = &input[idx_pref_T0 * block_size];
+        vop0 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
+            vop0);
+        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        vop8 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
+            vop8);
+        // skip unecassery prefetch of (&ip_next_T0[8])
+        vop16 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
+            vop16);
+        // skip unecassery prefetch of (&ip_next_T0[16])
+        vop24 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
+            vop24);
+        // skip unecassery prefetch of (&ip_next_T0[24])
+      }
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
+        _mm256_storeu_ps(&op[0], vop0);
+        _mm256_storeu_ps(&op[8], vop8);
+        _mm256_storeu_ps(&op[16], vop16);
+        _mm256_storeu_ps(&op[24], vop24);
+      } else {
+        __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
+        _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
+        _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
+        _mm256_storeu_ps(&op[16], _mm256_mul_ps(vop16, vlen_inv));
+        _mm256_storeu_ps(&op[24], _mm256_mul_ps(vop24, vlen_inv));
+      }
+    }
+  } else if (block_size == 16) {
+    // unrolling 2 times
+    int64_t dataInd = 0;
+    for (int64_t rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+      float* op = &out[rangeIndex * block_size];
+      __m256 vop0 = _mm256_setzero_ps();
+      __m256 vop8 = _mm256_setzero_ps();
+      for (int64_t start = dataInd; dataInd < start + lengths[rangeIndex];
+           ++dataInd) {
+        const int64_t idx = indices[dataInd];
+        float wgt = 1.f;
+        if (weights) {
+          wgt = weights[dataInd];
+        }
+        __m256 vwgt = _mm256_set1_ps(wgt);
+        const bfloat16* ip = &input[idx * block_size];
+        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+            ? (dataInd + prefdist_T0)
+            : dataInd;
+        const int64_t idx_pref_T0 = indices[next_T0];
+        CAFFE_ENFORCE(
+            idx >= 0 && idx_pref_T0 >= 0 && idx < data_size &&
+            idx_pref_T0 < data_size);
+        const bfloat16* ip_next_T0 = &input[idx_pref_T0 * block_size];
+        vop0 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
+            vop0);
+        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        vop8 = _mm256_fmadd_ps(
+            vwgt,
+            cvtbf16_ps(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
+            vop8);
+        // skip unecassery prefetch of (&ip_next_T0[8])
+      }
+      if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {
+        _mm256_storeu_ps(&op[0], vop0);
+        _mm256_storeu_ps(&op[8], vop8);
+      } else {
+        __m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);
+        _mm256_storeu_ps(&op[0], _mm256_mul_ps(vop0, vlen_inv));
+        _mm256_storeu_ps(&op[8], _mm256_mul_ps(vop8, vlen_inv));
+      }
+    }
+  } else {
+    // generic code
+    int64_t dataInd = 0;
+    for (int64_t rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+      float* op = &out[rangeIndex * block_size];
+      TIndex j = 0;
+      for (; j + 8 <= block_size; j += 8) {
+        _mm256_storeu_ps(op + j, _mm256_setzero_ps());
+      }
+      for (; j < block_size; j++) {
+        op[j] = 0.0f;
+      }
+      for (int64_t start = dataInd; dataInd < start + lengths[rangeIndex];
+           ++dataInd) {
+        const int64_t idx = indices[dataInd];
+        float wgt = 1.f;
+        if (weights) {
+          wgt = weights[dataInd];
+        }
+        __m256 vwgt = _mm256_set1_ps(wgt);
+        const bfloat16* ip = &input[idx * block_size];
+        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+            ? (dataInd + prefdist_T0)
+            : dataInd;
+        const int64_t idx_pref_T0 = indices[next_T0];
+        CAFFE_ENFORCE(
+            idx >= 0 && idx_pref_T0 >= 0 && idx < data_size &&
+            idx_pref_T0 < data_size);
+        const bfloat16* ip_next_T0 = &input[idx_pref_T0 * block_size];
+        j = 0;
+        for (; j + 8 <= block_size; j += 8) {
+          _mm256_storeu_ps(
+              &op[j],
+              _mm256_fmadd_ps(
+                  vwgt,
+                  cvtbf16_ps(_mm_loadu_si128(
+                      reinterpret_cast<const __m128i*>(&ip[j]))),
+                  _mm256_loadu_ps(&op[j])));
+          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
+        }
+        bfloat16 vtmp1[8] CAFFE2_ALIGNED(64);
+        for (; j < block_size; j++) {
+          vtmp1[0] = ip[j];
+          __m256 vtmp2 = cvtbf16_ps(*((__m128i*)vtmp1));
+          op[j] += wgt * ((float*)(&vtmp2))[0];
+        }
+      }
+      if (normalize_by_lengths && lengths[rangeIndex]) {
+        float len_inv = 1.0f / lengths[rangeIndex];
+        __m256 vlen_inv = _mm256_set1_ps(len_inv);
+        j = 0;
+        for (; j + 8 <= block_size; j += 8) {
+          _mm256_storeu_ps(
+              &op[j], _mm256_mul_ps(_mm256_loadu_ps(&op[j]), vlen_inv));
+        }
+        for (; j < block_size; j++) {
+          op[j] = len_inv * op[j];
+        }
+      }
+    }
+  }
+}
 } // namespace caffe2
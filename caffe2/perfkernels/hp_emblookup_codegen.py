@@ -21,13 +21,61 @@ import argparse
 import sys
 
 
+# Per instruction set names of the vector type and intrinsics. "width" is the
+# number of floats held by one vector register.
+isas = {
+    "AVX2": {
+        "suffix": "avx2_fma",
+        "width": 8,
+        "vec": "__m256",
+        "prefix": "_mm256",
+        "load_float16": "_mm256_cvtph_ps(_mm_loadu_si128("
+                        "reinterpret_cast<const __m128i*>(%s)))",
+        "load_uint8_t": "_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32("
+                        "_mm_loadu_si128(reinterpret_cast<const __m128i*>(%s))))",
+        "load_bfloat16": "cvtbf16_ps(_mm_loadu_si128("
+                         "reinterpret_cast<const __m128i*>(%s)))",
+        # A bfloat16 is the upper half of a float.
+        "helpers": ["inline __m256 cvtbf16_ps(__m128i x) {",
+                    "return _mm256_castsi256_ps("
+                    "_mm256_slli_epi32(_mm256_cvtepu16_epi32(x), 16));",
+                    "}"],
+    },
+    "AVX512": {
+        "suffix": "avx512",
+        "width": 16,
+        "vec": "__m512",
+        "prefix": "_mm512",
+        "load_float16": "_mm512_cvtph_ps(_mm256_loadu_si256("
+                        "reinterpret_cast<const __m256i*>(%s)))",
+        "load_uint8_t": "_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32("
+                        "_mm_loadu_si128(reinterpret_cast<const __m128i*>(%s))))",
+        "load_bfloat16": "cvtbf16_ps(_mm256_loadu_si256("
+                         "reinterpret_cast<const __m256i*>(%s)))",
+        # Masked loads used for the leftover of the generic code.
+        "maskz_load_float": "_mm512_maskz_loadu_ps(mask, %s)",
+        "maskz_load_float16": "_mm512_cvtph_ps(_mm256_maskz_loadu_epi16("
+                              "mask, reinterpret_cast<const __m256i*>(%s)))",
+        "maskz_load_uint8_t": "_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32("
+                              "_mm_maskz_loadu_epi8("
+                              "mask, reinterpret_cast<const __m128i*>(%s))))",
+        "maskz_load_bfloat16": "cvtbf16_ps(_mm256_maskz_loadu_epi16("
+                               "mask, reinterpret_cast<const __m256i*>(%s)))",
+        "helpers": ["inline __m512 cvtbf16_ps(__m256i x) {",
+                    "return _mm512_castsi512_ps("
+                    "_mm512_slli_epi32(_mm512_cvtepu16_epi32(x), 16));",
+                    "}"],
+    },
+}
+
+
 def unroll(uf, IndexType, InType, OutType, use_weights, isa):
 
     def sizeof(InType):
         size = 0
         if InType == "float":
             size = 4
-        elif InType == "float16":
+        elif InType in ["float16", "bfloat16"]:
             size = 2
         elif InType == "uint8_t":
             size = 1
@@ -36,23 +84,28 @@ def unroll(uf, IndexType, InType, OutType, use_weights, isa):
 
         return size
 
+    isa_info = isas[isa]
+    width = isa_info["width"]
+    vec = isa_info["vec"]
+    mm = isa_info["prefix"]
+
     def compute(regid, InType, use_weights, isa, prefetch):
         code = []
 
         if InType == "float":
-            code.append("vop%d = _mm256_fmadd_ps(vwgt,  \
-                  _mm256_loadu_ps(ip + (%d)), vop%d);" % (regid, regid, regid))
-
-        elif InType == "float16":
-            code.append("vop%d = _mm256_fmadd_ps(vwgt,  \
-                   _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (%d)))), \
-                   vop%d);"
-                        % (regid, regid, regid))
+            code.append("vop%d = %s_fmadd_ps(vwgt, %s_loadu_ps(ip + (%d)), vop%d);"
+                        % (regid, mm, mm, regid, regid))
+
+        elif InType in ["float16", "bfloat16"]:
+            code.append("vop%d = %s_fmadd_ps(vwgt, %s, vop%d);"
+                        % (regid, mm,
+                           isa_info["load_" + InType] % ("ip + (%d)" % regid),
+                           regid))
         elif InType == "uint8_t":
-            code.append("vop%d = _mm256_fmadd_ps(vwgt,  \
-                   _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (%d))))), \
-                   _mm256_add_ps(vop%d, vbio));"
-                        % (regid, regid, regid))
+            code.append("vop%d = %s_fmadd_ps(vwgt, %s, %s_add_ps(vop%d, vbio));"
+                        % (regid, mm,
+                           isa_info["load_uint8_t"] % ("ip + (%d)" % regid),
+                           mm, regid))
         else:
             assert False
 
@@ -71,8 +124,8 @@ def unroll(uf, IndexType, InType, OutType, use_weights, isa):
                 " rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {")
     code.append(OutType + " *op = &out[rangeIndex * block_size];")
     for i in range(0, uf):
-        j = 8 * i
-        code.append("__m256 vop" + str(j) + " = _mm256_setzero_ps();")
+        j = width * i
+        code.append(vec + " vop" + str(j) + " = " + mm + "_setzero_ps();")
 
     # inner loop
     code.append("for (" + IndexType +
@@ -87,13 +140,13 @@ def unroll(uf, IndexType, InType, OutType, use_weights, isa):
         code.append("}")
         code.append("bio = wgt * scale_bias[2 * indices[dataInd] + 1];");
         code.append("wgt = wgt * scale_bias[2 * indices[dataInd]];");
-        code.append("__m256 vbio = _mm256_set1_ps(bio);")
+        code.append(vec + " vbio = " + mm + "_set1_ps(bio);")
     else:
         code.append(OutType + " wgt = 1.f;")
         code.append("if (weights) {")
         code.append("wgt = weights[dataInd];")
         code.append("}")
-    code.append("__m256 vwgt = _mm256_set1_ps(wgt);")
+    code.append(vec + " vwgt = " + mm + "_set1_ps(wgt);")
 
     code.append("const  " + InType + " *ip = &input[idx * block_size];")
     code.append("const  " + IndexType +
@@ -105,26 +158,27 @@ def unroll(uf, IndexType, InType, OutType, use_weights, isa):
                 " *ip_next_T0 = &input[idx_pref_T0 * block_size];")
 
     for i in range(0, uf):
-        j = 8 * i
+        j = width * i
         cachelinesize = 64
         byteoffset = sizeof(InType) * j
         prefetch = ((byteoffset % cachelinesize) == 0)
         code.extend(compute(j, InType, use_weights, isa, prefetch))
     code.append("}")
 
-    code.append("if (normalize_by_lengths == false) {")
+    # Empty segments are written out as zeros in both modes.
+    code.append("if (normalize_by_lengths == false || lengths[rangeIndex] == 0) {")
     for i in range(0, uf):
-        j = 8 * i
+        j = width * i
         code.append(
-            "_mm256_storeu_ps(&op[" + str(j) + "], vop" + str(j) + ");")
-    code.append("} else if (lengths[rangeIndex]) {")
+            mm + "_storeu_ps(&op[" + str(j) + "], vop" + str(j) + ");")
+    code.append("} else {")
     # inv of length
     code.append(
-        "__m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);")
+        vec + " vlen_inv = " + mm + "_set1_ps(1.0f / lengths[rangeIndex]);")
     for i in range(0, uf):
-        j = 8 * i
+        j = width * i
         code.append(
-            "_mm256_storeu_ps(&op[" + str(j) + "], _mm256_mul_ps(" + "vop" + str(j) + ", vlen_inv));")
+            mm + "_storeu_ps(&op[" + str(j) + "], " + mm + "_mul_ps(" + "vop" + str(j) + ", vlen_inv));")
     code.append("}")
 
     code.append("}")
@@ -133,23 +187,27 @@ def unroll(uf, IndexType, InType, OutType, use_weights, isa):
 
 def generic(IndexType, InType, OutType, use_weights, isa):
 
+    isa_info = isas[isa]
+    width = isa_info["width"]
+    vec = isa_info["vec"]
+    mm = isa_info["prefix"]
+    # AVX-512 handles the leftover of each row with masked loads and stores
+    # instead of a scalar loop.
+    masked_tail = "maskz_load_float" in isa_info
+
     def compute(InType, use_weights, isa):
         code = []
         if InType == "float":
-            code.append("_mm256_storeu_ps(&op[j], \
-                                 _mm256_fmadd_ps(vwgt,_mm256_loadu_ps(&ip[j]), _mm256_loadu_ps(&op[j])) \
-                                   );")
-        elif InType == "float16":
-            code.append("_mm256_storeu_ps(&op[j], \
-                   _mm256_fmadd_ps(vwgt, \
-                     _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&ip[j]))), _mm256_loadu_ps(&op[j])) \
-                                   );")
+            code.append(mm + "_storeu_ps(&op[j], " + mm + "_fmadd_ps(vwgt, " +
+                        mm + "_loadu_ps(&ip[j]), " + mm + "_loadu_ps(&op[j])));")
+        elif InType in ["float16", "bfloat16"]:
+            code.append(mm + "_storeu_ps(&op[j], " + mm + "_fmadd_ps(vwgt, " +
+                        isa_info["load_" + InType] % "&ip[j]" + ", " +
+                        mm + "_loadu_ps(&op[j])));")
         elif InType == "uint8_t":
-            code.append("_mm256_storeu_ps(&op[j], \
-                   _mm256_fmadd_ps(vwgt, \
-                     _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&ip[j])))), \
-                     _mm256_add_ps(_mm256_loadu_ps(&op[j]), vbio) ) \
-                                   );")
+            code.append(mm + "_storeu_ps(&op[j], " + mm + "_fmadd_ps(vwgt, " +
+                        isa_info["load_uint8_t"] % "&ip[j]" + ", " +
+                        mm + "_add_ps(" + mm + "_loadu_ps(&op[j]), vbio)));")
         else:
             assert False
 
@@ -158,6 +216,21 @@ def generic(IndexType, InType, OutType, use_weights, isa):
 
         return code
 
+    def compute_masked(InType, use_weights, isa):
+        code = []
+        acc = mm + "_maskz_loadu_ps(mask, &op[j])"
+        if InType == "uint8_t":
+            acc = mm + "_add_ps(" + acc + ", vbio)"
+        code.append(mm + "_mask_storeu_ps(&op[j], mask, " + mm +
+                    "_fmadd_ps(vwgt, " +
+                    isa_info["maskz_load_" + InType] % "&ip[j]" + ", " +
+                    acc + "));")
+        return code
+
+    def tail_mask():
+        return ("const __mmask16 mask = "
+                "static_cast<__mmask16>((1 << (block_size - j)) - 1);")
+
     code = []
     code.append(IndexType + " dataInd = 0;")
     code.append("for (" + IndexType +
@@ -166,12 +239,18 @@ def generic(IndexType, InType, OutType, use_weights, isa):
 
     # initialize to 0
     code.append("TIndex j = 0;")
-    code.append("for(; j + 8 <= block_size; j += 8) {")
-    code.append("_mm256_storeu_ps(op + j, _mm256_setzero_ps());")
-    code.append("}")
-    code.append("for(; j < block_size; j++) {")
-    code.append("op[j] = 0.0f;")
+    code.append("for(; j + %d <= block_size; j += %d) {" % (width, width))
+    code.append(mm + "_storeu_ps(op + j, " + mm + "_setzero_ps());")
     code.append("}")
+    if masked_tail:
+        code.append("if (j < block_size) {")
+        code.append(tail_mask())
+        code.append(mm + "_mask_storeu_ps(op + j, mask, " + mm + "_setzero_ps());")
+        code.append("}")
+    else:
+        code.append("for(; j < block_size; j++) {")
+        code.append("op[j] = 0.0f;")
+        code.append("}")
 
     # inner loop
     code.append("for (" + IndexType +
@@ -187,13 +266,13 @@ def generic(IndexType, InType, OutType, use_weights, isa):
         code.append("assert (scale_bias);")
         code.append("bio = wgt * scale_bias[2 * indices[dataInd] + 1];");
         code.append("wgt = wgt * scale_bias[2 * indices[dataInd]];");
-        code.append("__m256 vbio = _mm256_set1_ps(bio);")
+        code.append(vec + " vbio = " + mm + "_set1_ps(bio);")
     else:
         code.append(OutType + " wgt = 1.f;")
         code.append("if (weights) {")
         code.append("wgt = weights[dataInd];")
         code.append("}")
-    code.append("__m256 vwgt = _mm256_set1_ps(wgt);")
+    code.append(vec + " vwgt = " + mm + "_set1_ps(wgt);")
 
     code.append("const  " + InType + " *ip = &input[idx * block_size];")
     code.append("const  " + IndexType +
@@ -206,40 +285,57 @@ def generic(IndexType, InType, OutType, use_weights, isa):
 
     # compute and store main loop
     code.append("j = 0;")
-    code.append("for(; j + 8 <= block_size; j += 8) {")
+    code.append("for(; j + %d <= block_size; j += %d) {" % (width, width))
     code.extend(compute(InType, use_weights, isa))
     code.append("}")
     # leftover
-    if InType == "float16":
-        #code.append("float16 vtmp1[8] __attribute__((aligned(64)));")
-        code.append("float16 vtmp1[8] CAFFE2_ALIGNED(64);")
-    code.append("for(; j < block_size; j++) {")
-    if InType == "float":
-        code.append("op[j] += wgt * ip[j];")
-    elif InType == "float16":
-        code.append("vtmp1[0] = ip[j];")
-        code.append("__m256 vtmp2 = _mm256_cvtph_ps(*((__m128i*)vtmp1));")
-        code.append("op[j] += wgt * ((float*)(&vtmp2))[0];")
-    elif InType == "uint8_t":
-        code.append("op[j] += wgt * ((float)ip[j]) + bio;")
+    if masked_tail:
+        code.append("if (j < block_size) {")
+        code.append(tail_mask())
+        code.extend(compute_masked(InType, use_weights, isa))
+        code.append("}")
     else:
-        assert False
+        if InType in ["float16", "bfloat16"]:
+            #code.append("float16 vtmp1[8] __attribute__((aligned(64)));")
+            code.append(InType + " vtmp1[8] CAFFE2_ALIGNED(64);")
+        code.append("for(; j < block_size; j++) {")
+        if InType == "float":
+            code.append("op[j] += wgt * ip[j];")
+        elif InType == "float16":
+            code.append("vtmp1[0] = ip[j];")
+            code.append("__m256 vtmp2 = _mm256_cvtph_ps(*((__m128i*)vtmp1));")
+            code.append("op[j] += wgt * ((float*)(&vtmp2))[0];")
+        elif InType == "bfloat16":
+            code.append("vtmp1[0] = ip[j];")
+            code.append("__m256 vtmp2 = cvtbf16_ps(*((__m128i*)vtmp1));")
+            code.append("op[j] += wgt * ((float*)(&vtmp2))[0];")
+        elif InType == "uint8_t":
+            code.append("op[j] += wgt * ((float)ip[j]) + bio;")
+        else:
+            assert False
 
-    code.append("}")
+        code.append("}")
 
     code.append("}")
 
     code.append("if (normalize_by_lengths && lengths[rangeIndex]) {")
     code.append("float len_inv = 1.0f / lengths[rangeIndex];")
-    code.append("__m256 vlen_inv = _mm256_set1_ps(len_inv);")
+    code.append(vec + " vlen_inv = " + mm + "_set1_ps(len_inv);")
     code.append("j = 0;")
-    code.append("for(; j + 8 <= block_size; j += 8) {")
+    code.append("for(; j + %d <= block_size; j += %d) {" % (width, width))
     code.append(
-        "_mm256_storeu_ps(&op[j], _mm256_mul_ps(_mm256_loadu_ps(&op[j]), vlen_inv));")
-    code.append("}")
-    code.append("for(; j < block_size; j++) {")
-    code.append("op[j] = len_inv * op[j];")
+        mm + "_storeu_ps(&op[j], " + mm + "_mul_ps(" + mm + "_loadu_ps(&op[j]), vlen_inv));")
     code.append("}")
+    if masked_tail:
+        code.append("if (j < block_size) {")
+        code.append(tail_mask())
+        code.append(mm + "_mask_storeu_ps(&op[j], mask, " + mm + "_mul_ps(" +
+                    mm + "_maskz_loadu_ps(mask, &op[j]), vlen_inv));")
+        code.append("}")
+    else:
+        code.append("for(; j < block_size; j++) {")
+        code.append("op[j] = len_inv * op[j];")
+        code.append("}")
 
     code.append("}")
 
@@ -251,8 +347,11 @@ def generic(IndexType, InType, OutType, use_weights, isa):
 # start main code
 parser = argparse.ArgumentParser()
 parser.add_argument('-f', nargs=1, help="file name")
+parser.add_argument('--isa', default="AVX2", choices=sorted(isas.keys()),
+                    help="instruction set to generate the kernels for")
 opts = parser.parse_args()
-filename = "embedding_lookup_avx2.cc"
+isa = opts.isa
+filename = "embedding_lookup_" + isa.lower() + ".cc"
 if opts.f:
     filename = (opts.f)[0]
 fout = open(filename, 'w')
@@ -263,6 +362,8 @@ options = [["int32_t", "float",   "float"],
            ["int64_t", "float16", "float"],
            ["int32_t", "uint8_t",  "float"],
            ["int64_t", "uint8_t",  "float"],
+           ["int32_t", "bfloat16", "float"],
+           ["int64_t", "bfloat16", "float"],
           ]
 
 code = []
@@ -280,11 +381,13 @@ code.append("#include <immintrin.h>")
 code.append("\n")
 
 code.append("namespace caffe2 {\n")
+code.extend(isas[isa]["helpers"])
+code.append("\n")
 for o in options:
     [IndexType, InType, OutType] = o
 
     fn = "void EmbeddingLookup_" + IndexType + \
-        "_" + InType + "_" + OutType + "__avx2_fma"
+        "_" + InType + "_" + OutType + "__" + isas[isa]["suffix"]
     code.append(fn + "(")
     code.append("const TIndex block_size,")
     code.append("const TIndex output_size,")
@@ -296,27 +399,33 @@ for o in options:
     code.append("const float* weights,")
     code.append("const float* scale_bias,")
     code.append("bool normalize_by_lengths,")
-    code.append(OutType + "* out)")
+    code.append(OutType + "* out,")
+    code.append("const int prefetch_distance)")
 
     code.append("{")
-    code.append("const " + IndexType + " prefdist_T0 = 16;")
+    code.append("const " + IndexType + " prefdist_T0 = prefetch_distance;")
     #code.append("printf(\"calling " + fn + "\\n\");");
     if InType != "uint8_t":
         code.append("CAFFE_ENFORCE(scale_bias == nullptr, \"scale_bias must be nullptr\");");
     else:
         code.append("CAFFE_ENFORCE(scale_bias != nullptr, \"scale_bias must not be nullptr\");");
 
-    code.append("if (block_size == 128) {")
-    code.extend(unroll(16, IndexType, InType, OutType, True, "AVX2"))
-    code.append("} else if (block_size == 64) {")
-    code.extend(unroll(8, IndexType, InType, OutType, True, "AVX2"))
-    code.append("} else if (block_size == 32) {")
-    code.extend(unroll(4, IndexType, InType, OutType, True, "AVX2"))
-    code.append("} else if (block_size == 16) {")
-    code.extend(unroll(2, IndexType, InType, OutType, True, "AVX2"))
+    # Unroll the common block sizes so that a whole row sits in registers.
+    width = isas[isa]["width"]
+    first = True
+    for block_size in [128, 64, 32, 16]:
+        if block_size % width != 0:
+            continue
+        if first:
+            code.append("if (block_size == %d) {" % block_size)
+            first = False
+        else:
+            code.append("} else if (block_size == %d) {" % block_size)
+        code.extend(unroll(block_size // width, IndexType, InType, OutType,
+                           True, isa))
     code.append("} else {")
     code.append("// generic code")
-    code.extend(generic(IndexType, InType, OutType, True, "AVX2"))
+    code.extend(generic(IndexType, InType, OutType, True, isa))
     code.append("}")
 
 
@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/perfkernels/index_hash.h"
+
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void index_hash_int32__base(
+    int N,
+    const int32_t* ids,
+    int64_t seed,
+    int64_t modulo,
+    int32_t* out) {
+  for (int i = 0; i < N; ++i) {
+    out[i] = IndexHash(ids[i], seed, modulo);
+  }
+}
+
+void index_hash_int64__base(
+    int N,
+    const int64_t* ids,
+    int64_t seed,
+    int64_t modulo,
+    int64_t* out) {
+  for (int i = 0; i < N; ++i) {
+    out[i] = IndexHash(ids[i], seed, modulo);
+  }
+}
+
+void index_hash_int32(
+    int N,
+    const int32_t* ids,
+    int64_t seed,
+    int64_t modulo,
+    int32_t* out) {
+  AVX2_DO(index_hash_int32, N, ids, seed, modulo, out);
+  BASE_DO(index_hash_int32, N, ids, seed, modulo, out);
+}
+
+void index_hash_int64(
+    int N,
+    const int64_t* ids,
+    int64_t seed,
+    int64_t modulo,
+    int64_t* out) {
+  AVX2_DO(index_hash_int64, N, ids, seed, modulo, out);
+  BASE_DO(index_hash_int64, N, ids, seed, modulo, out);
+}
+
+} // namespace caffe2
@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+
+namespace caffe2 {
+
+// The hash of the IndexHash operator: a multiplicative hash of the bytes of
+// id, starting from seed, brought into [0, modulo).
+template <typename T>
+inline T IndexHash(T id, int64_t seed, int64_t modulo) {
+  int8_t* bytes = (int8_t*)&id;
+  T hashed = seed * 0xDEADBEEF;
+  for (int i = 0; i < sizeof(T) / sizeof(int8_t); i++) {
+    hashed = hashed * 65537 + bytes[i];
+  }
+  hashed = (modulo + hashed % modulo) % modulo;
+  return hashed;
+}
+
+// out[i] = IndexHash(ids[i], seed, modulo) for N ids, hashing several ids per
+// SIMD register on hosts with AVX2. The final modulo is a mask when modulo is
+// a power of two, and a scalar division otherwise. out may alias ids.
+void index_hash_int32(
+    int N,
+    const int32_t* ids,
+    int64_t seed,
+    int64_t modulo,
+    int32_t* out);
+void index_hash_int64(
+    int N,
+    const int64_t* ids,
+    int64_t seed,
+    int64_t modulo,
+    int64_t* out);
+
+inline void index_hash(
+    int N,
+    const int32_t* ids,
+    int64_t seed,
+    int64_t modulo,
+    int32_t* out) {
+  index_hash_int32(N, ids, seed, modulo, out);
+}
+
+inline void index_hash(
+    int N,
+    const int64_t* ids,
+    int64_t seed,
+    int64_t modulo,
+    int64_t* out) {
+  index_hash_int64(N, ids, seed, modulo, out);
+}
+
+} // namespace caffe2
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <immintrin.h>
+
+#include <cstdint>
+
+namespace caffe2 {
+
+namespace {
+
+// Brings the raw hashes into [0, modulo) like IndexHash does.
+template <typename T>
+void ReduceModulo(int N, int64_t modulo, T* out) {
+  if ((modulo & (modulo - 1)) == 0) {
+    // (modulo + h % modulo) % modulo keeps the low bits of h.
+    const T mask = modulo - 1;
+    for (int i = 0; i < N; ++i) {
+      out[i] &= mask;
+    }
+  } else {
+    for (int i = 0; i < N; ++i) {
+      out[i] = (modulo + out[i] % modulo) % modulo;
+    }
+  }
+}
+
+} // namespace
+
+// The hash runs over the bytes of each id, low byte first: h = h * 65537 +
+// byte, where the multiplication is h + (h << 16) and the sign extension of
+// the byte is (byte ^ 0x80) - 0x80, so that all lanes hash in lockstep.
+void index_hash_int32__avx2(
+    int N,
+    const int32_t* ids,
+    int64_t seed,
+    int64_t modulo,
+    int32_t* out) {
+  const int32_t start = seed * 0xDEADBEEF;
+  const __m256i vstart = _mm256_set1_epi32(start);
+  const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+  const __m256i sign = _mm256_set1_epi32(0x80);
+  int i = 0;
+  for (; i + 8 <= N; i += 8) {
+    __m256i id = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i));
+    __m256i h = vstart;
+    for (int b = 0; b < 4; ++b) {
+      const __m256i byte = _mm256_sub_epi32(
+          _mm256_xor_si256(_mm256_and_si256(id, byte_mask), sign), sign);
+      h = _mm256_add_epi32(_mm256_add_epi32(h, _mm256_slli_epi32(h, 16)), byte);
+      id = _mm256_srli_epi32(id, 8);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), h);
+  }
+  for (; i < N; ++i) {
+    const int8_t* bytes = reinterpret_cast<const int8_t*>(ids + i);
+    int32_t h = start;
+    for (int b = 0; b < 4; ++b) {
+      h = h * 65537 + bytes[b];
+    }
+    out[i] = h;
+  }
+  ReduceModulo(N, modulo, out);
+}
+
+void index_hash_int64__avx2(
+    int N,
+    const int64_t* ids,
+    int64_t seed,
+    int64_t modulo,
+    int64_t* out) {
+  const int64_t start = seed * 0xDEADBEEF;
+  const __m256i vstart = _mm256_set1_epi64x(start);
+  const __m256i byte_mask = _mm256_set1_epi64x(0xFF);
+  const __m256i sign = _mm256_set1_epi64x(0x80);
+  int i = 0;
+  for (; i + 4 <= N; i += 4) {
+    __m256i id = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i));
+    __m256i h = vstart;
+    for (int b = 0; b < 8; ++b) {
+      const __m256i byte = _mm256_sub_epi64(
+          _mm256_xor_si256(_mm256_and_si256(id, byte_mask), sign), sign);
+      h = _mm256_add_epi64(_mm256_add_epi64(h, _mm256_slli_epi64(h, 16)), byte);
+      id = _mm256_srli_epi64(id, 8);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), h);
+  }
+  for (; i < N; ++i) {
+    const int8_t* bytes = reinterpret_cast<const int8_t*>(ids + i);
+    int64_t h = start;
+    for (int b = 0; b < 8; ++b) {
+      h = h * 65537 + bytes[b];
+    }
+    out[i] = h;
+  }
+  ReduceModulo(N, modulo, out);
+}
+
+} // namespace caffe2
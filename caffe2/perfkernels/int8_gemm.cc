@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/int8_gemm.h"
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void int8_gemm_nt__base(
+    int M,
+    int N,
+    int K,
+    const std::uint8_t* A,
+    const std::int8_t* B,
+    std::int32_t* C,
+    int ldc) {
+  for (int m = 0; m < M; ++m) {
+    const std::uint8_t* a = A + m * K;
+    for (int n = 0; n < N; ++n) {
+      const std::int8_t* b = B + n * K;
+      std::int32_t sum = 0;
+      for (int k = 0; k < K; ++k) {
+        sum += static_cast<std::int32_t>(a[k]) * b[k];
+      }
+      C[m * ldc + n] = sum;
+    }
+  }
+}
+
+void int8_gemm_nt(
+    int M,
+    int N,
+    int K,
+    const std::uint8_t* A,
+    const std::int8_t* B,
+    std::int32_t* C,
+    int ldc) {
+  NEON_DO(int8_gemm_nt, M, N, K, A, B, C, ldc);
+  AVX2_DO(int8_gemm_nt, M, N, K, A, B, C, ldc);
+  BASE_DO(int8_gemm_nt, M, N, K, A, B, C, ldc);
+}
+
+} // namespace caffe2
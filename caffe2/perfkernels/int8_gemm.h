@@ -0,0 +1,38 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace caffe2 {
+
+// Integer GEMM with the second operand transposed, as used by the int8
+// inference engine:
+//   C[m * ldc + n] = sum_k A[m * K + k] * B[n * K + k]
+// A holds uint8 activations and B int8 weights, both row major. The products
+// are accumulated exactly in int32, so K may be up to 2^31 / (255 * 128).
+// ldc, which is at least N, lets callers compute a block of columns of C.
+void int8_gemm_nt(
+    int M,
+    int N,
+    int K,
+    const std::uint8_t* A,
+    const std::int8_t* B,
+    std::int32_t* C,
+    int ldc);
+
+} // namespace caffe2
@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/int8_gemm.h"
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+namespace {
+
+// Both operands are widened to int16 before _mm256_madd_epi16, which keeps
+// the pairwise sums exact. _mm256_maddubs_epi16 would save the widening of A
+// but saturates its int16 pairs for large weights.
+inline __m256i load_a(const std::uint8_t* a) {
+  return _mm256_cvtepu8_epi16(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(a)));
+}
+
+inline __m256i load_b(const std::int8_t* b) {
+  return _mm256_cvtepi8_epi16(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+}
+
+inline std::int32_t reduce_add(__m256i v) {
+  __m128i s = _mm_add_epi32(
+      _mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(s);
+}
+
+} // namespace
+
+void int8_gemm_nt__avx2(
+    int M,
+    int N,
+    int K,
+    const std::uint8_t* A,
+    const std::int8_t* B,
+    std::int32_t* C,
+    int ldc) {
+  const int K16 = K / 16 * 16;
+  for (int m = 0; m < M; ++m) {
+    const std::uint8_t* a = A + m * K;
+    std::int32_t* c = C + m * ldc;
+    int n = 0;
+    // Four columns of B at a time so that each widened row chunk of A is
+    // reused four times.
+    for (; n + 4 <= N; n += 4) {
+      const std::int8_t* b0 = B + n * K;
+      const std::int8_t* b1 = b0 + K;
+      const std::int8_t* b2 = b1 + K;
+      const std::int8_t* b3 = b2 + K;
+      __m256i acc0 = _mm256_setzero_si256();
+      __m256i acc1 = _mm256_setzero_si256();
+      __m256i acc2 = _mm256_setzero_si256();
+      __m256i acc3 = _mm256_setzero_si256();
+      for (int k = 0; k < K16; k += 16) {
+        const __m256i va = load_a(a + k);
+        acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(va, load_b(b0 + k)));
+        acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(va, load_b(b1 + k)));
+        acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(va, load_b(b2 + k)));
+        acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(va, load_b(b3 + k)));
+      }
+      std::int32_t s0 = reduce_add(acc0);
+      std::int32_t s1 = reduce_add(acc1);
+      std::int32_t s2 = reduce_add(acc2);
+      std::int32_t s3 = reduce_add(acc3);
+      for (int k = K16; k < K; ++k) {
+        const std::int32_t ak = a[k];
+        s0 += ak * b0[k];
+        s1 += ak * b1[k];
+        s2 += ak * b2[k];
+        s3 += ak * b3[k];
+      }
+      c[n] = s0;
+      c[n + 1] = s1;
+      c[n + 2] = s2;
+      c[n + 3] = s3;
+    }
+    for (; n < N; ++n) {
+      const std::int8_t* b = B + n * K;
+      __m256i acc = _mm256_setzero_si256();
+      for (int k = 0; k < K16; k += 16) {
+        acc = _mm256_add_epi32(
+            acc, _mm256_madd_epi16(load_a(a + k), load_b(b + k)));
+      }
+      std::int32_t s = reduce_add(acc);
+      for (int k = K16; k < K; ++k) {
+        s += static_cast<std::int32_t>(a[k]) * b[k];
+      }
+      c[n] = s;
+    }
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Built on every platform like the other common perfkernel sources, but only
+// has contents where NEON is available, see NEON_DO in common.h.
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#include "caffe2/perfkernels/int8_gemm.h"
+
+#include <arm_neon.h>
+#include <vector>
+
+namespace caffe2 {
+
+namespace {
+
+inline std::int32_t reduce_add(int32x4_t v) {
+#ifdef __aarch64__
+  return vaddvq_s32(v);
+#else
+  const int32x2_t s = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+  return vget_lane_s32(vpadd_s32(s, s), 0);
+#endif
+}
+
+#ifdef __ARM_FEATURE_DOTPROD
+
+// The ARMv8.2 dot product instructions multiply int8 by int8, so the uint8
+// activations are moved into int8 by flipping their top bit, which subtracts
+// 128. The 128 * sum(b) this takes off every dot product is added back with
+// the sums of the rows of B over the vectorized part of K.
+constexpr int kStep = 16;
+typedef int8x16_t AChunk;
+
+inline AChunk load_a(const std::uint8_t* a) {
+  return vreinterpretq_s8_u8(veorq_u8(vld1q_u8(a), vdupq_n_u8(0x80)));
+}
+
+inline int32x4_t madd(int32x4_t acc, AChunk va, const std::int8_t* b) {
+  return vdotq_s32(acc, va, vld1q_s8(b));
+}
+
+#else // __ARM_FEATURE_DOTPROD
+
+// Both operands are widened to int16, whose products fit vmlal_s16 exactly.
+constexpr int kStep = 8;
+typedef int16x8_t AChunk;
+
+inline AChunk load_a(const std::uint8_t* a) {
+  return vreinterpretq_s16_u16(vmovl_u8(vld1_u8(a)));
+}
+
+inline int32x4_t madd(int32x4_t acc, AChunk va, const std::int8_t* b) {
+  const int16x8_t vb = vmovl_s8(vld1_s8(b));
+  acc = vmlal_s16(acc, vget_low_s16(va), vget_low_s16(vb));
+  return vmlal_s16(acc, vget_high_s16(va), vget_high_s16(vb));
+}
+
+#endif // __ARM_FEATURE_DOTPROD
+
+} // namespace
+
+void int8_gemm_nt__neon(
+    int M,
+    int N,
+    int K,
+    const std::uint8_t* A,
+    const std::int8_t* B,
+    std::int32_t* C,
+    int ldc) {
+  const int K_vec = K / kStep * kStep;
+  // What the activation offset of load_a() takes off each column of C.
+  std::vector<std::int32_t> offsets(N, 0);
+#ifdef __ARM_FEATURE_DOTPROD
+  for (int n = 0; n < N; ++n) {
+    const std::int8_t* b = B + n * K;
+    std::int32_t sum = 0;
+    for (int k = 0; k < K_vec; ++k) {
+      sum += b[k];
+    }
+    offsets[n] = 128 * sum;
+  }
+#endif // __ARM_FEATURE_DOTPROD
+  for (int m = 0; m < M; ++m) {
+    const std::uint8_t* a = A + m * K;
+    std::int32_t* c = C + m * ldc;
+    int n = 0;
+    // Four rows of B at a time so that each chunk of A is loaded once for
+    // four dot products.
+    for (; n + 4 <= N; n += 4) {
+      const std::int8_t* b0 = B + n * K;
+      const std::int8_t* b1 = b0 + K;
+      const std::int8_t* b2 = b1 + K;
+      const std::int8_t* b3 = b2 + K;
+      int32x4_t acc0 = vdupq_n_s32(0);
+      int32x4_t acc1 = vdupq_n_s32(0);
+      int32x4_t acc2 = vdupq_n_s32(0);
+      int32x4_t acc3 = vdupq_n_s32(0);
+      for (int k = 0; k < K_vec; k += kStep) {
+        const AChunk va = load_a(a + k);
+        acc0 = madd(acc0, va, b0 + k);
+        acc1 = madd(acc1, va, b1 + k);
+        acc2 = madd(acc2, va, b2 + k);
+        acc3 = madd(acc3, va, b3 + k);
+      }
+      std::int32_t s0 = reduce_add(acc0) + offsets[n];
+      std::int32_t s1 = reduce_add(acc1) + offsets[n + 1];
+      std::int32_t s2 = reduce_add(acc2) + offsets[n + 2];
+      std::int32_t s3 = reduce_add(acc3) + offsets[n + 3];
+      for (int k = K_vec; k < K; ++k) {
+        const std::int32_t ak = a[k];
+        s0 += ak * b0[k];
+        s1 += ak * b1[k];
+        s2 += ak * b2[k];
+        s3 += ak * b3[k];
+      }
+      c[n] = s0;
+      c[n + 1] = s1;
+      c[n + 2] = s2;
+      c[n + 3] = s3;
+    }
+    for (; n < N; ++n) {
+      const std::int8_t* b = B + n * K;
+      int32x4_t acc = vdupq_n_s32(0);
+      for (int k = 0; k < K_vec; k += kStep) {
+        acc = madd(acc, load_a(a + k), b + k);
+      }
+      std::int32_t s = reduce_add(acc) + offsets[n];
+      for (int k = K_vec; k < K; ++k) {
+        s += static_cast<std::int32_t>(a[k]) * b[k];
+      }
+      c[n] = s;
+    }
+  }
+}
+
+} // namespace caffe2
+
+#endif // defined(__ARM_NEON__) || defined(__ARM_NEON)
@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/packed_gemm.h"
+
+#include <algorithm>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void packed_gemm_pack(int N, int K, const float* W, float* packed) {
+  constexpr int NR = kPackedGemmPanelWidth;
+  for (int n0 = 0; n0 < N; n0 += NR) {
+    const int width = std::min(NR, N - n0);
+    float* panel = packed + n0 * K;
+    for (int k = 0; k < K; ++k) {
+      for (int j = 0; j < NR; ++j) {
+        panel[k * NR + j] = j < width ? W[(n0 + j) * K + k] : 0.0f;
+      }
+    }
+  }
+}
+
+void packed_gemm__base(
+    int M,
+    int N,
+    int K,
+    const float* X,
+    const float* packed,
+    const float* bias,
+    float* Y) {
+  constexpr int NR = kPackedGemmPanelWidth;
+  float acc[NR];
+  for (int n0 = 0; n0 < N; n0 += NR) {
+    const int width = std::min(NR, N - n0);
+    const float* panel = packed + n0 * K;
+    for (int m = 0; m < M; ++m) {
+      const float* x = X + m * K;
+      std::fill(acc, acc + NR, 0.0f);
+      for (int k = 0; k < K; ++k) {
+        const float xk = x[k];
+        for (int j = 0; j < NR; ++j) {
+          acc[j] += xk * panel[k * NR + j];
+        }
+      }
+      for (int j = 0; j < width; ++j) {
+        Y[m * N + n0 + j] = acc[j] + (bias ? bias[n0 + j] : 0.0f);
+      }
+    }
+  }
+}
+
+void packed_gemm(
+    int M,
+    int N,
+    int K,
+    const float* X,
+    const float* packed,
+    const float* bias,
+    float* Y) {
+  AVX2_FMA_DO(packed_gemm, M, N, K, X, packed, bias, Y);
+  BASE_DO(packed_gemm, M, N, K, X, packed, bias, Y);
+}
+
+} // namespace caffe2
@@ -0,0 +1,47 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+namespace caffe2 {
+
+// Single precision GEMM against a weight matrix packed ahead of time, for the
+// Y = X * W^T + b of FC. W is [N, K] row major and is packed into panels of
+// kPackedGemmPanelWidth columns of W^T: for every k, the panel holds the
+// values of kPackedGemmPanelWidth consecutive rows of W, zero padded at the
+// end. The kernels then stream each panel with contiguous loads and never
+// repack W, which is what dominates a BLAS sgemm at batch sizes of 1 to 32.
+constexpr int kPackedGemmPanelWidth = 16;
+
+// The number of floats the packed form of an [N, K] matrix takes.
+inline int packed_gemm_packed_size(int N, int K) {
+  return (N + kPackedGemmPanelWidth - 1) / kPackedGemmPanelWidth *
+      kPackedGemmPanelWidth * K;
+}
+
+void packed_gemm_pack(int N, int K, const float* W, float* packed);
+
+// Y[m * N + n] = sum_k X[m * K + k] * W[n * K + k] + (bias ? bias[n] : 0)
+void packed_gemm(
+    int M,
+    int N,
+    int K,
+    const float* X,
+    const float* packed,
+    const float* bias,
+    float* Y);
+
+} // namespace caffe2
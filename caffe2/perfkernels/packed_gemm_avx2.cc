@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/packed_gemm.h"
+
+#include <algorithm>
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+namespace {
+
+// Computes MR rows of Y against one panel. The MR x 16 block of Y lives in
+// 2 * MR ymm registers for the whole K loop; MR = 4 leaves room for the two
+// panel loads and the broadcast of X.
+template <int MR>
+inline void packed_gemm_block(
+    int K,
+    const float* X,
+    int N,
+    const float* panel,
+    const float* bias,
+    int width,
+    float* Y) {
+  static_assert(kPackedGemmPanelWidth == 16, "The kernel assumes 2 ymm wide");
+  __m256 acc[MR][2];
+  for (int i = 0; i < MR; ++i) {
+    acc[i][0] = _mm256_setzero_ps();
+    acc[i][1] = _mm256_setzero_ps();
+  }
+  for (int k = 0; k < K; ++k) {
+    const __m256 w0 = _mm256_loadu_ps(panel + k * 16);
+    const __m256 w1 = _mm256_loadu_ps(panel + k * 16 + 8);
+    for (int i = 0; i < MR; ++i) {
+      const __m256 x = _mm256_broadcast_ss(X + i * K + k);
+      acc[i][0] = _mm256_fmadd_ps(x, w0, acc[i][0]);
+      acc[i][1] = _mm256_fmadd_ps(x, w1, acc[i][1]);
+    }
+  }
+  float out[16];
+  for (int i = 0; i < MR; ++i) {
+    if (bias) {
+      acc[i][0] = _mm256_add_ps(acc[i][0], _mm256_loadu_ps(bias));
+      acc[i][1] = _mm256_add_ps(acc[i][1], _mm256_loadu_ps(bias + 8));
+    }
+    if (width == 16) {
+      _mm256_storeu_ps(Y + i * N, acc[i][0]);
+      _mm256_storeu_ps(Y + i * N + 8, acc[i][1]);
+    } else {
+      _mm256_storeu_ps(out, acc[i][0]);
+      _mm256_storeu_ps(out + 8, acc[i][1]);
+      std::copy(out, out + width, Y + i * N);
+    }
+  }
+}
+
+} // namespace
+
+void packed_gemm__avx2_fma(
+    int M,
+    int N,
+    int K,
+    const float* X,
+    const float* packed,
+    const float* bias,
+    float* Y) {
+  constexpr int NR = kPackedGemmPanelWidth;
+  float bias_tail[NR];
+  for (int n0 = 0; n0 < N; n0 += NR) {
+    const int width = std::min(NR, N - n0);
+    const float* panel = packed + n0 * K;
+    // The vector loads of the bias must not run past its end.
+    const float* panel_bias = bias ? bias + n0 : nullptr;
+    if (bias && width < NR) {
+      std::fill(bias_tail, bias_tail + NR, 0.0f);
+      std::copy(bias + n0, bias + N, bias_tail);
+      panel_bias = bias_tail;
+    }
+    int m = 0;
+    for (; m + 4 <= M; m += 4) {
+      packed_gemm_block<4>(
+          K, X + m * K, N, panel, panel_bias, width, Y + m * N + n0);
+    }
+    for (; m < M; ++m) {
+      packed_gemm_block<1>(
+          K, X + m * K, N, panel, panel_bias, width, Y + m * N + n0);
+    }
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/perfkernels/transcendental.h"
+
+#include <cmath>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void vector_exp__base(int N, const float* x, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = std::exp(x[i]);
+  }
+}
+
+void vector_log__base(int N, const float* x, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = std::log(x[i]);
+  }
+}
+
+void vector_tanh__base(int N, const float* x, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = std::tanh(x[i]);
+  }
+}
+
+void vector_sigmoid__base(int N, const float* x, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = 1.0f / (1.0f + std::exp(-x[i]));
+  }
+}
+
+void vector_exp(int N, const float* x, float* y) {
+  AVX512_DO(vector_exp, N, x, y);
+  AVX2_FMA_DO(vector_exp, N, x, y);
+  BASE_DO(vector_exp, N, x, y);
+}
+
+void vector_log(int N, const float* x, float* y) {
+  AVX512_DO(vector_log, N, x, y);
+  AVX2_FMA_DO(vector_log, N, x, y);
+  BASE_DO(vector_log, N, x, y);
+}
+
+void vector_tanh(int N, const float* x, float* y) {
+  AVX512_DO(vector_tanh, N, x, y);
+  AVX2_FMA_DO(vector_tanh, N, x, y);
+  BASE_DO(vector_tanh, N, x, y);
+}
+
+void vector_sigmoid(int N, const float* x, float* y) {
+  AVX512_DO(vector_sigmoid, N, x, y);
+  AVX2_FMA_DO(vector_sigmoid, N, x, y);
+  BASE_DO(vector_sigmoid, N, x, y);
+}
+
+} // namespace caffe2
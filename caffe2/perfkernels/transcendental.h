@@ -0,0 +1,42 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+namespace caffe2 {
+
+// Elementwise transcendental functions over N floats. y may alias x.
+//
+// The AVX2 and AVX-512 kernels use the Cephes polynomial approximations. The
+// error bounds below are the largest errors over all float inputs, measured
+// against a double precision reference. The base kernels call the std::
+// functions. NaN inputs give NaN outputs in all kernels.
+
+// y = exp(x), within 1.02 ULP. Underflows to 0 for x < -87.33 (denormal
+// results are flushed) and overflows to inf for x > 88.37.
+void vector_exp(int N, const float* x, float* y);
+
+// y = log(x), within 0.83 ULP. Returns -inf for 0 and NaN for x < 0.
+// Denormal x is treated as the smallest normal float.
+void vector_log(int N, const float* x, float* y);
+
+// y = tanh(x), within 1.34 ULP.
+void vector_tanh(int N, const float* x, float* y);
+
+// y = 1 / (1 + exp(-x)), within 2.49 ULP where the result is a normal float.
+void vector_sigmoid(int N, const float* x, float* y);
+
+} // namespace caffe2
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/transcendental_avx2.h"
+
+#include <immintrin.h>
+
+#include <cstring>
+
+namespace caffe2 {
+
+namespace {
+
+// Cephes tanhf: an odd polynomial for |x| < 0.625, and
+// 1 - 2 / (exp(2|x|) + 1) with the sign of x otherwise.
+inline __m256 tanh256(__m256 x) {
+  const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  __m256 ax = _mm256_andnot_ps(sign_mask, x);
+  __m256 z = _mm256_mul_ps(x, x);
+  __m256 p = _mm256_set1_ps(-5.70498872745e-3f);
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(2.06390887954e-2f));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-5.37397155531e-2f));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.33314422036e-1f));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-3.33332819422e-1f));
+  __m256 small_y = _mm256_fmadd_ps(_mm256_mul_ps(p, z), x, x);
+  __m256 d = _mm256_add_ps(exp256(_mm256_add_ps(ax, ax)), one);
+  __m256 large_y = _mm256_sub_ps(one, _mm256_div_ps(_mm256_set1_ps(2.0f), d));
+  large_y = _mm256_or_ps(large_y, _mm256_and_ps(x, sign_mask));
+  return _mm256_blendv_ps(
+      large_y,
+      small_y,
+      _mm256_cmp_ps(ax, _mm256_set1_ps(0.625f), _CMP_LT_OQ));
+}
+
+inline __m256 sigmoid256(__m256 x) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  return _mm256_div_ps(
+      one,
+      _mm256_add_ps(
+          one, exp256(_mm256_xor_ps(x, _mm256_set1_ps(-0.0f)))));
+}
+
+// Runs f over N floats. The tail is padded to a full vector so that every
+// element goes through the same code.
+template <typename F>
+inline void apply256(int N, const float* x, float* y, F f) {
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(y + i, f(_mm256_loadu_ps(x + i)));
+  }
+  if (i < N) {
+    float buf[8] = {0};
+    std::memcpy(buf, x + i, (N - i) * sizeof(float));
+    _mm256_storeu_ps(buf, f(_mm256_loadu_ps(buf)));
+    std::memcpy(y + i, buf, (N - i) * sizeof(float));
+  }
+}
+
+} // namespace
+
+void vector_exp__avx2_fma(int N, const float* x, float* y) {
+  apply256(N, x, y, exp256);
+}
+
+void vector_log__avx2_fma(int N, const float* x, float* y) {
+  apply256(N, x, y, log256);
+}
+
+void vector_tanh__avx2_fma(int N, const float* x, float* y) {
+  apply256(N, x, y, tanh256);
+}
+
+void vector_sigmoid__avx2_fma(int N, const float* x, float* y) {
+  apply256(N, x, y, sigmoid256);
+}
+
+} // namespace caffe2
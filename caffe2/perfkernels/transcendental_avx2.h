@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The AVX2 exp and log of transcendental_avx2.cc, for the other AVX2 kernels.
+// Only to be included by files compiled with AVX2 and FMA.
+
+#pragma once
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+// Cephes expf: exp(x) = 2^n * exp(r) with n = round(x / ln2) and r = x - n ln2
+// in [-ln2 / 2, ln2 / 2], where exp(r) is a degree 7 polynomial. ln2 is split
+// in two so that r is computed without cancellation.
+inline __m256 exp256(__m256 x) {
+  const __m256 hi = _mm256_set1_ps(88.3762626647949f);
+  const __m256 lo = _mm256_set1_ps(-87.3365447504019f);
+  __m256 xc = _mm256_max_ps(_mm256_min_ps(x, hi), lo);
+  __m256 n = _mm256_round_ps(
+      _mm256_mul_ps(xc, _mm256_set1_ps(1.44269504088896341f)),
+      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  // Keeps 2^n a normal float at the top of the range.
+  n = _mm256_min_ps(n, _mm256_set1_ps(127.0f));
+  __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), xc);
+  r = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), r);
+  __m256 p = _mm256_set1_ps(1.9875691500e-4f);
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507e-3f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+  p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), r);
+  p = _mm256_add_ps(p, _mm256_set1_ps(1.0f));
+  __m256i e = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+  __m256 y = _mm256_mul_ps(p, _mm256_castsi256_ps(e));
+  y = _mm256_blendv_ps(
+      y,
+      _mm256_set1_ps(__builtin_inff()),
+      _mm256_cmp_ps(x, hi, _CMP_GT_OQ));
+  y = _mm256_blendv_ps(
+      y, _mm256_setzero_ps(), _mm256_cmp_ps(x, lo, _CMP_LT_OQ));
+  return _mm256_blendv_ps(y, x, _mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+}
+
+// Cephes logf: x = m * 2^e with m in [sqrt(1/2), sqrt(2)), and
+// log(x) = e ln2 + log1p(m - 1), where log1p is a degree 9 polynomial.
+inline __m256 log256(__m256 x) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  __m256 xc = _mm256_max_ps(x, _mm256_set1_ps(1.17549435e-38f));
+  __m256i bits = _mm256_castps_si256(xc);
+  __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(
+      _mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+  // m in [0.5, 1).
+  __m256 m = _mm256_castsi256_ps(_mm256_or_si256(
+      _mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)),
+      _mm256_set1_epi32(0x3F000000)));
+  __m256 small =
+      _mm256_cmp_ps(m, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+  e = _mm256_sub_ps(e, _mm256_and_ps(one, small));
+  __m256 f = _mm256_add_ps(
+      _mm256_sub_ps(m, one), _mm256_and_ps(m, small));
+  __m256 z = _mm256_mul_ps(f, f);
+  __m256 p = _mm256_set1_ps(7.0376836292e-2f);
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(-1.1514610310e-1f));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.1676998740e-1f));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(-1.2420140846e-1f));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.4249322787e-1f));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(-1.6668057665e-1f));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(2.0000714765e-1f));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(-2.4999993993e-1f));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(3.3333331174e-1f));
+  p = _mm256_mul_ps(_mm256_mul_ps(p, f), z);
+  p = _mm256_fmadd_ps(e, _mm256_set1_ps(-2.12194440e-4f), p);
+  p = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), p);
+  __m256 y = _mm256_add_ps(f, p);
+  y = _mm256_fmadd_ps(e, _mm256_set1_ps(0.693359375f), y);
+  y = _mm256_blendv_ps(
+      y,
+      _mm256_set1_ps(__builtin_inff()),
+      _mm256_cmp_ps(x, _mm256_set1_ps(__builtin_inff()), _CMP_EQ_OQ));
+  y = _mm256_blendv_ps(
+      y,
+      _mm256_set1_ps(-__builtin_inff()),
+      _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_EQ_OQ));
+  // x < 0 and NaN.
+  return _mm256_blendv_ps(
+      y,
+      _mm256_set1_ps(__builtin_nanf("")),
+      _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_NGE_UQ));
+}
+
+} // namespace caffe2
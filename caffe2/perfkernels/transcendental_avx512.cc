@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+namespace {
+
+// Same approximations as in transcendental_avx2.cc, with the special cases
+// handled through mask registers.
+
+inline __m512 exp512(__m512 x) {
+  const __m512 hi = _mm512_set1_ps(88.3762626647949f);
+  const __m512 lo = _mm512_set1_ps(-87.3365447504019f);
+  __m512 xc = _mm512_max_ps(_mm512_min_ps(x, hi), lo);
+  __m512 n = _mm512_roundscale_ps(
+      _mm512_mul_ps(xc, _mm512_set1_ps(1.44269504088896341f)),
+      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  n = _mm512_min_ps(n, _mm512_set1_ps(127.0f));
+  __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693359375f), xc);
+  r = _mm512_fnmadd_ps(n, _mm512_set1_ps(-2.12194440e-4f), r);
+  __m512 p = _mm512_set1_ps(1.9875691500e-4f);
+  p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.3981999507e-3f));
+  p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(8.3334519073e-3f));
+  p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(4.1665795894e-2f));
+  p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.6666665459e-1f));
+  p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(5.0000001201e-1f));
+  p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), r);
+  p = _mm512_add_ps(p, _mm512_set1_ps(1.0f));
+  __m512i e = _mm512_slli_epi32(
+      _mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23);
+  __m512 y = _mm512_mul_ps(p, _mm512_castsi512_ps(e));
+  y = _mm512_mask_mov_ps(
+      y,
+      _mm512_cmp_ps_mask(x, hi, _CMP_GT_OQ),
+      _mm512_set1_ps(__builtin_inff()));
+  y = _mm512_mask_mov_ps(
+      y, _mm512_cmp_ps_mask(x, lo, _CMP_LT_OQ), _mm512_setzero_ps());
+  return _mm512_mask_mov_ps(y, _mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q), x);
+}
+
+inline __m512 log512(__m512 x) {
+  const __m512 one = _mm512_set1_ps(1.0f);
+  __m512 xc = _mm512_max_ps(x, _mm512_set1_ps(1.17549435e-38f));
+  __m512i bits = _mm512_castps_si512(xc);
+  __m512 e = _mm512_cvtepi32_ps(_mm512_sub_epi32(
+      _mm512_srli_epi32(bits, 23), _mm512_set1_epi32(126)));
+  __m512 m = _mm512_castsi512_ps(_mm512_or_si512(
+      _mm512_and_si512(bits, _mm512_set1_epi32(0x007FFFFF)),
+      _mm512_set1_epi32(0x3F000000)));
+  __mmask16 small = _mm512_cmp_ps_mask(
+      m, _mm512_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+  e = _mm512_mask_sub_ps(e, small, e, one);
+  __m512 f = _mm512_mask_add_ps(_mm512_sub_ps(m, one), small,
+                                _mm512_sub_ps(m, one), m);
+  __m512 z = _mm512_mul_ps(f, f);
+  __m512 p = _mm512_set1_ps(7.0376836292e-2f);
+  p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(-1.1514610310e-1f));
+  p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(1.1676998740e-1f));
+  p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(-1.2420140846e-1f));
+  p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(1.4249322787e-1f));
+  p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(-1.6668057665e-1f));
+  p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(2.0000714765e-1f));
+  p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(-2.4999993993e-1f));
+  p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(3.3333331174e-1f));
+  p = _mm512_mul_ps(_mm512_mul_ps(p, f), z);
+  p = _mm512_fmadd_ps(e, _mm512_set1_ps(-2.12194440e-4f), p);
+  p = _mm512_fnmadd_ps(z, _mm512_set1_ps(0.5f), p);
+  __m512 y = _mm512_add_ps(f, p);
+  y = _mm512_fmadd_ps(e, _mm512_set1_ps(0.693359375f), y);
+  y = _mm512_mask_mov_ps(
+      y,
+      _mm512_cmp_ps_mask(x, _mm512_set1_ps(__builtin_inff()), _CMP_EQ_OQ),
+      _mm512_set1_ps(__builtin_inff()));
+  y = _mm512_mask_mov_ps(
+      y,
+      _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_EQ_OQ),
+      _mm512_set1_ps(-__builtin_inff()));
+  return _mm512_mask_mov_ps(
+      y,
+      _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_NGE_UQ),
+      _mm512_set1_ps(__builtin_nanf("")));
+}
+
+inline __m512 tanh512(__m512 x) {
+  const __m512 one = _mm512_set1_ps(1.0f);
+  __m512 ax = _mm512_abs_ps(x);
+  __m512 z = _mm512_mul_ps(x, x);
+  __m512 p = _mm512_set1_ps(-5.70498872745e-3f);
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(2.06390887954e-2f));
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(-5.37397155531e-2f));
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(1.33314422036e-1f));
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(-3.33332819422e-1f));
+  __m512 small_y = _mm512_fmadd_ps(_mm512_mul_ps(p, z), x, x);
+  __m512 d = _mm512_add_ps(exp512(_mm512_add_ps(ax, ax)), one);
+  __m512 large_y = _mm512_sub_ps(one, _mm512_div_ps(_mm512_set1_ps(2.0f), d));
+  // Copies the sign of x.
+  large_y = _mm512_castsi512_ps(_mm512_or_si512(
+      _mm512_castps_si512(large_y),
+      _mm512_and_si512(
+          _mm512_castps_si512(x), _mm512_set1_epi32(0x80000000))));
+  return _mm512_mask_mov_ps(
+      large_y,
+      _mm512_cmp_ps_mask(ax, _mm512_set1_ps(0.625f), _CMP_LT_OQ),
+      small_y);
+}
+
+inline __m512 sigmoid512(__m512 x) {
+  const __m512 one = _mm512_set1_ps(1.0f);
+  return _mm512_div_ps(
+      one,
+      _mm512_add_ps(
+          one,
+          exp512(_mm512_castsi512_ps(_mm512_xor_si512(
+              _mm512_castps_si512(x), _mm512_set1_epi32(0x80000000))))));
+}
+
+// Runs f over N floats, with the tail handled by a masked load and store.
+template <typename F>
+inline void apply512(int N, const float* x, float* y, F f) {
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_ps(y + i, f(_mm512_loadu_ps(x + i)));
+  }
+  if (i < N) {
+    __mmask16 mask = (1 << (N - i)) - 1;
+    _mm512_mask_storeu_ps(
+        y + i, mask, f(_mm512_maskz_loadu_ps(mask, x + i)));
+  }
+}
+
+} // namespace
+
+void vector_exp__avx512(int N, const float* x, float* y) {
+  apply512(N, x, y, exp512);
+}
+
+void vector_log__avx512(int N, const float* x, float* y) {
+  apply512(N, x, y, log512);
+}
+
+void vector_tanh__avx512(int N, const float* x, float* y) {
+  apply512(N, x, y, tanh512);
+}
+
+void vector_sigmoid__avx512(int N, const float* x, float* y) {
+  apply512(N, x, y, sigmoid512);
+}
+
+} // namespace caffe2
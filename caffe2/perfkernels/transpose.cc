@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/perfkernels/transpose.h"
+
+#include <algorithm>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void transpose_2d__base(
+    int M,
+    int N,
+    const float* x,
+    int ldx,
+    float* y,
+    int ldy) {
+  // Square tiles keep both the rows read and the rows written in cache.
+  constexpr int kTile = 32;
+  for (auto i0 = 0; i0 < M; i0 += kTile) {
+    const auto i1 = std::min(M, i0 + kTile);
+    for (auto j0 = 0; j0 < N; j0 += kTile) {
+      const auto j1 = std::min(N, j0 + kTile);
+      for (auto i = i0; i < i1; ++i) {
+        for (auto j = j0; j < j1; ++j) {
+          y[j * ldy + i] = x[i * ldx + j];
+        }
+      }
+    }
+  }
+}
+
+void transpose_2d(int M, int N, const float* x, int ldx, float* y, int ldy) {
+  AVX_DO(transpose_2d, M, N, x, ldx, y, ldy);
+  BASE_DO(transpose_2d, M, N, x, ldx, y, ldy);
+}
+
+} // namespace caffe2
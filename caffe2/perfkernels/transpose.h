@@ -0,0 +1,27 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+namespace caffe2 {
+
+// Transposes the M x N row-major matrix x, whose rows are ldx floats apart,
+// into the N x M matrix y, whose rows are ldy floats apart. The values are
+// only moved, so any 4 byte type can go through here.
+void transpose_2d(int M, int N, const float* x, int ldx, float* y, int ldy);
+
+} // namespace caffe2
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+namespace caffe2 {
+
+namespace {
+
+// Transposes the 8 x 8 block at x into y in registers.
+inline void transpose_8x8(const float* x, int ldx, float* y, int ldy) {
+  __m256 r0 = _mm256_loadu_ps(x + 0 * ldx);
+  __m256 r1 = _mm256_loadu_ps(x + 1 * ldx);
+  __m256 r2 = _mm256_loadu_ps(x + 2 * ldx);
+  __m256 r3 = _mm256_loadu_ps(x + 3 * ldx);
+  __m256 r4 = _mm256_loadu_ps(x + 4 * ldx);
+  __m256 r5 = _mm256_loadu_ps(x + 5 * ldx);
+  __m256 r6 = _mm256_loadu_ps(x + 6 * ldx);
+  __m256 r7 = _mm256_loadu_ps(x + 7 * ldx);
+  __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+  __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+  __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+  __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+  __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+  __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+  __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+  __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+  r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  r4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+  r5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+  r6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+  r7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+  _mm256_storeu_ps(y + 0 * ldy, _mm256_permute2f128_ps(r0, r4, 0x20));
+  _mm256_storeu_ps(y + 1 * ldy, _mm256_permute2f128_ps(r1, r5, 0x20));
+  _mm256_storeu_ps(y + 2 * ldy, _mm256_permute2f128_ps(r2, r6, 0x20));
+  _mm256_storeu_ps(y + 3 * ldy, _mm256_permute2f128_ps(r3, r7, 0x20));
+  _mm256_storeu_ps(y + 4 * ldy, _mm256_permute2f128_ps(r0, r4, 0x31));
+  _mm256_storeu_ps(y + 5 * ldy, _mm256_permute2f128_ps(r1, r5, 0x31));
+  _mm256_storeu_ps(y + 6 * ldy, _mm256_permute2f128_ps(r2, r6, 0x31));
+  _mm256_storeu_ps(y + 7 * ldy, _mm256_permute2f128_ps(r3, r7, 0x31));
+}
+
+} // namespace
+
+void transpose_2d__avx(
+    int M,
+    int N,
+    const float* x,
+    int ldx,
+    float* y,
+    int ldy) {
+  // 32 x 32 tiles of 8 x 8 register blocks. The edges that do not fill a
+  // register block are copied one value at a time.
+  constexpr int kTile = 32;
+  for (auto i0 = 0; i0 < M; i0 += kTile) {
+    const auto i1 = std::min(M, i0 + kTile);
+    for (auto j0 = 0; j0 < N; j0 += kTile) {
+      const auto j1 = std::min(N, j0 + kTile);
+      auto i = i0;
+      for (; i + 8 <= i1; i += 8) {
+        auto j = j0;
+        for (; j + 8 <= j1; j += 8) {
+          transpose_8x8(x + i * ldx + j, ldx, y + j * ldy + i, ldy);
+        }
+        for (; j < j1; ++j) {
+          for (auto k = i; k < i + 8; ++k) {
+            y[j * ldy + k] = x[k * ldx + j];
+          }
+        }
+      }
+      for (; i < i1; ++i) {
+        for (auto j = j0; j < j1; ++j) {
+          y[j * ldy + i] = x[i * ldx + j];
+        }
+      }
+    }
+  }
+}
+
+} // namespace caffe2
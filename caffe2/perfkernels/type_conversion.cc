@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/perfkernels/type_conversion.h"
+
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/conversions.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void float_to_float16__base(int N, const float* x, float16* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = convert::To<float, float16>(x[i]);
+  }
+}
+
+void float16_to_float__base(int N, const float16* x, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = convert::To<float16, float>(x[i]);
+  }
+}
+
+void float_to_bfloat16__base(int N, const float* x, bfloat16* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = convert::To<float, bfloat16>(x[i]);
+  }
+}
+
+void bfloat16_to_float__base(int N, const bfloat16* x, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = convert::To<bfloat16, float>(x[i]);
+  }
+}
+
+void int32_to_float__base(int N, const int32_t* x, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = static_cast<float>(x[i]);
+  }
+}
+
+void float_to_int32__base(int N, const float* x, int32_t* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = static_cast<int32_t>(x[i]);
+  }
+}
+
+void float_to_float16(int N, const float* x, float16* y) {
+  AVX512_DO(float_to_float16, N, x, y);
+  AVX_F16C_DO(float_to_float16, N, x, y);
+  BASE_DO(float_to_float16, N, x, y);
+}
+
+void float16_to_float(int N, const float16* x, float* y) {
+  AVX512_DO(float16_to_float, N, x, y);
+  AVX_F16C_DO(float16_to_float, N, x, y);
+  BASE_DO(float16_to_float, N, x, y);
+}
+
+void float_to_bfloat16(int N, const float* x, bfloat16* y) {
+  AVX512_DO(float_to_bfloat16, N, x, y);
+  AVX2_DO(float_to_bfloat16, N, x, y);
+  BASE_DO(float_to_bfloat16, N, x, y);
+}
+
+void bfloat16_to_float(int N, const bfloat16* x, float* y) {
+  AVX512_DO(bfloat16_to_float, N, x, y);
+  AVX2_DO(bfloat16_to_float, N, x, y);
+  BASE_DO(bfloat16_to_float, N, x, y);
+}
+
+void int32_to_float(int N, const int32_t* x, float* y) {
+  AVX512_DO(int32_to_float, N, x, y);
+  AVX_DO(int32_to_float, N, x, y);
+  BASE_DO(int32_to_float, N, x, y);
+}
+
+void float_to_int32(int N, const float* x, int32_t* y) {
+  AVX512_DO(float_to_int32, N, x, y);
+  AVX_DO(float_to_int32, N, x, y);
+  BASE_DO(float_to_int32, N, x, y);
+}
+
+} // namespace caffe2
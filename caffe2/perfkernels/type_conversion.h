@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+// Elementwise conversions between float and the narrower types, shared by
+// Cast, FloatToHalf / HalfToFloat, the fp16 gradient compression and the
+// bfloat16 SparseAdagrad. They are picked by cpuid at run time. All of them
+// give the same results as the scalar conversions, except for the payload of
+// NaNs.
+
+// Round to nearest even, like convert::To<float, float16>.
+void float_to_float16(int N, const float* x, float16* y);
+void float16_to_float(int N, const float16* x, float* y);
+
+// Round to nearest even, like convert::To<float, bfloat16>.
+void float_to_bfloat16(int N, const float* x, bfloat16* y);
+void bfloat16_to_float(int N, const bfloat16* x, float* y);
+
+void int32_to_float(int N, const int32_t* x, float* y);
+// Rounds towards zero, like static_cast.
+void float_to_int32(int N, const float* x, int32_t* y);
+
+} // namespace caffe2
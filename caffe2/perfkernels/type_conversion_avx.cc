@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <immintrin.h>
+
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/cvtsh_ss_bugfix.h"
+
+namespace caffe2 {
+
+void float_to_float16__avx_f16c(int N, const float* x, float16* y) {
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(y + i),
+        _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT));
+  }
+  for (; i < N; ++i) {
+    y[i].x = _cvtss_sh(x[i], _MM_FROUND_TO_NEAREST_INT);
+  }
+}
+
+void float16_to_float__avx_f16c(int N, const float16* x, float* y) {
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(
+        y + i,
+        _mm256_cvtph_ps(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i))));
+  }
+  for (; i < N; ++i) {
+    y[i] = _cvtsh_ss(x[i].x);
+  }
+}
+
+void int32_to_float__avx(int N, const int32_t* x, float* y) {
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(
+        y + i,
+        _mm256_cvtepi32_ps(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i))));
+  }
+  for (; i < N; ++i) {
+    y[i] = static_cast<float>(x[i]);
+  }
+}
+
+void float_to_int32__avx(int N, const float* x, int32_t* y) {
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(y + i),
+        _mm256_cvttps_epi32(_mm256_loadu_ps(x + i)));
+  }
+  for (; i < N; ++i) {
+    y[i] = static_cast<int32_t>(x[i]);
+  }
+}
+
+} // namespace caffe2
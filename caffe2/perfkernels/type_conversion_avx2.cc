@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <immintrin.h>
+
+#include "caffe2/core/types.h"
+#include "caffe2/utils/conversions.h"
+
+namespace caffe2 {
+
+void float_to_bfloat16__avx2(int N, const float* x, bfloat16* y) {
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i round = _mm256_set1_epi32(0x7fff);
+  const __m256i quiet = _mm256_set1_epi32(0x40);
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    const __m256 v = _mm256_loadu_ps(x + i);
+    const __m256i bits = _mm256_castps_si256(v);
+    const __m256i high = _mm256_srli_epi32(bits, 16);
+    // Round to nearest even.
+    const __m256i rounded = _mm256_srli_epi32(
+        _mm256_add_epi32(
+            bits, _mm256_add_epi32(round, _mm256_and_si256(high, one))),
+        16);
+    const __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    const __m256i result = _mm256_blendv_epi8(
+        rounded, _mm256_or_si256(high, quiet), nan);
+    // The pack works within 128 bit lanes, gather the results afterwards.
+    const __m256i packed = _mm256_permute4x64_epi64(
+        _mm256_packus_epi32(result, result), 0xd8);
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(y + i), _mm256_castsi256_si128(packed));
+  }
+  for (; i < N; ++i) {
+    y[i] = convert::To<float, bfloat16>(x[i]);
+  }
+}
+
+void bfloat16_to_float__avx2(int N, const bfloat16* x, float* y) {
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    const __m256i bits = _mm256_slli_epi32(
+        _mm256_cvtepu16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i))),
+        16);
+    _mm256_storeu_ps(y + i, _mm256_castsi256_ps(bits));
+  }
+  for (; i < N; ++i) {
+    y[i] = convert::To<bfloat16, float>(x[i]);
+  }
+}
+
+} // namespace caffe2
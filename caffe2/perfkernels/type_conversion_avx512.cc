@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <immintrin.h>
+
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+// The tails are handled with masked loads and stores.
+
+namespace {
+
+inline __mmask16 tail_mask(int n) {
+  return static_cast<__mmask16>((1 << n) - 1);
+}
+
+inline __m512i to_bfloat16(__m512 v) {
+  const __m512i bits = _mm512_castps_si512(v);
+  const __m512i high = _mm512_srli_epi32(bits, 16);
+  // Round to nearest even, and keep NaNs quiet.
+  const __m512i rounded = _mm512_srli_epi32(
+      _mm512_add_epi32(
+          bits,
+          _mm512_add_epi32(
+              _mm512_set1_epi32(0x7fff),
+              _mm512_and_si512(high, _mm512_set1_epi32(1)))),
+      16);
+  return _mm512_mask_mov_epi32(
+      rounded,
+      _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q),
+      _mm512_or_si512(high, _mm512_set1_epi32(0x40)));
+}
+
+} // namespace
+
+void float_to_float16__avx512(int N, const float* x, float16* y) {
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(y + i),
+        _mm512_cvtps_ph(_mm512_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT));
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    _mm256_mask_storeu_epi16(
+        y + i,
+        m,
+        _mm512_cvtps_ph(
+            _mm512_maskz_loadu_ps(m, x + i), _MM_FROUND_TO_NEAREST_INT));
+  }
+}
+
+void float16_to_float__avx512(int N, const float16* x, float* y) {
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_ps(
+        y + i,
+        _mm512_cvtph_ps(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i))));
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    _mm512_mask_storeu_ps(
+        y + i, m, _mm512_cvtph_ps(_mm256_maskz_loadu_epi16(m, x + i)));
+  }
+}
+
+void float_to_bfloat16__avx512(int N, const float* x, bfloat16* y) {
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(y + i),
+        _mm512_cvtepi32_epi16(to_bfloat16(_mm512_loadu_ps(x + i))));
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    _mm512_mask_cvtepi32_storeu_epi16(
+        y + i, m, to_bfloat16(_mm512_maskz_loadu_ps(m, x + i)));
+  }
+}
+
+void bfloat16_to_float__avx512(int N, const bfloat16* x, float* y) {
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    const __m512i bits = _mm512_slli_epi32(
+        _mm512_cvtepu16_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i))),
+        16);
+    _mm512_storeu_ps(y + i, _mm512_castsi512_ps(bits));
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    const __m512i bits = _mm512_slli_epi32(
+        _mm512_cvtepu16_epi32(_mm256_maskz_loadu_epi16(m, x + i)), 16);
+    _mm512_mask_storeu_ps(y + i, m, _mm512_castsi512_ps(bits));
+  }
+}
+
+void int32_to_float__avx512(int N, const int32_t* x, float* y) {
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_ps(y + i, _mm512_cvtepi32_ps(_mm512_loadu_si512(x + i)));
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    _mm512_mask_storeu_ps(
+        y + i, m, _mm512_cvtepi32_ps(_mm512_maskz_loadu_epi32(m, x + i)));
+  }
+}
+
+void float_to_int32__avx512(int N, const float* x, int32_t* y) {
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_si512(y + i, _mm512_cvttps_epi32(_mm512_loadu_ps(x + i)));
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    _mm512_mask_storeu_epi32(
+        y + i, m, _mm512_cvttps_epi32(_mm512_maskz_loadu_ps(m, x + i)));
+  }
+}
+
+} // namespace caffe2
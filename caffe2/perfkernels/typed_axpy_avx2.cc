@@ -17,6 +17,7 @@
 #include "caffe2/core/types.h"
 #include "caffe2/perfkernels/cvtsh_ss_bugfix.h"
 #include "caffe2/perfkernels/typed_axpy.h"
+#include "caffe2/utils/conversions.h"
 #include "caffe2/utils/math.h"
 
 #include <emmintrin.h>
@@ -95,4 +96,26 @@ void TypedAxpy_uint8_float__avx2_fma(
   }
 }
 
+void TypedAxpy_bfloat16_float__avx2_fma(
+    int N,
+    const float a,
+    const bfloat16* x,
+    float* y) {
+  const __m256 mma = _mm256_set1_ps(a);
+  int current = 0;
+  for (; current + 8 <= N; current += 8) {
+    // A bfloat16 is the upper half of the float.
+    __m256 mmx_fp32 = _mm256_castsi256_ps(_mm256_slli_epi32(
+        _mm256_cvtepu16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + current))),
+        16));
+    __m256 mmy = _mm256_loadu_ps(y + current);
+    mmy = _mm256_fmadd_ps(mmx_fp32, mma, mmy);
+    _mm256_storeu_ps(y + current, mmy);
+  }
+  for (; current < N; ++current) {
+    y[current] += convert::To<bfloat16, float>(x[current]) * a;
+  }
+}
+
 } // namespace caffe2
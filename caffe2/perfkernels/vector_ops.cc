@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/perfkernels/vector_ops.h"
+
+#include <algorithm>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void vector_axpy__base(int N, float alpha, const float* x, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] += alpha * x[i];
+  }
+}
+
+void vector_scale__base(int N, float alpha, const float* x, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = alpha * x[i];
+  }
+}
+
+float vector_dot__base(int N, const float* a, const float* b) {
+  float sum = 0;
+  for (auto i = 0; i < N; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+void vector_add__base(int N, const float* a, const float* b, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = a[i] + b[i];
+  }
+}
+
+void vector_mul__base(int N, const float* a, const float* b, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = a[i] * b[i];
+  }
+}
+
+void vector_max__base(int N, const float* x, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = std::max(x[i], y[i]);
+  }
+}
+
+float vector_sum__base(int N, const float* x) {
+  float sum = 0;
+  for (auto i = 0; i < N; ++i) {
+    sum += x[i];
+  }
+  return sum;
+}
+
+void rowwise_max__base(int N, int D, const float* x, float* y) {
+  for (auto i = 0; i < N; ++i) {
+    y[i] = *std::max_element(x + i * D, x + (i + 1) * D);
+  }
+}
+
+void vector_axpy(int N, float alpha, const float* x, float* y) {
+  AVX512_DO(vector_axpy, N, alpha, x, y);
+  AVX2_FMA_DO(vector_axpy, N, alpha, x, y);
+  BASE_DO(vector_axpy, N, alpha, x, y);
+}
+
+void vector_scale(int N, float alpha, const float* x, float* y) {
+  AVX512_DO(vector_scale, N, alpha, x, y);
+  AVX2_FMA_DO(vector_scale, N, alpha, x, y);
+  BASE_DO(vector_scale, N, alpha, x, y);
+}
+
+float vector_dot(int N, const float* a, const float* b) {
+  AVX512_DO(vector_dot, N, a, b);
+  AVX2_FMA_DO(vector_dot, N, a, b);
+  BASE_DO(vector_dot, N, a, b);
+}
+
+void vector_add(int N, const float* a, const float* b, float* y) {
+  AVX512_DO(vector_add, N, a, b, y);
+  AVX2_FMA_DO(vector_add, N, a, b, y);
+  BASE_DO(vector_add, N, a, b, y);
+}
+
+void vector_mul(int N, const float* a, const float* b, float* y) {
+  AVX512_DO(vector_mul, N, a, b, y);
+  AVX2_FMA_DO(vector_mul, N, a, b, y);
+  BASE_DO(vector_mul, N, a, b, y);
+}
+
+void vector_max(int N, const float* x, float* y) {
+  AVX512_DO(vector_max, N, x, y);
+  AVX2_FMA_DO(vector_max, N, x, y);
+  BASE_DO(vector_max, N, x, y);
+}
+
+float vector_sum(int N, const float* x) {
+  AVX512_DO(vector_sum, N, x);
+  AVX2_FMA_DO(vector_sum, N, x);
+  BASE_DO(vector_sum, N, x);
+}
+
+void rowwise_max(int N, int D, const float* x, float* y) {
+  AVX512_DO(rowwise_max, N, D, x, y);
+  AVX2_FMA_DO(rowwise_max, N, D, x, y);
+  BASE_DO(rowwise_max, N, D, x, y);
+}
+
+} // namespace caffe2
@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+namespace caffe2 {
+
+// Level 1 vector primitives behind the float CPU versions of math::Axpy,
+// math::Scale, math::Dot, math::Add, math::Mul, math::Sum and
+// math::RowwiseMax, and of the max segment reducers. They are picked by cpuid at run time, so that one binary
+// runs AVX-512 code on hosts that have it and AVX2 code on the others.
+// Outputs may alias inputs. The reductions add in a different order than a
+// sequential loop, so their results may differ in the last bits.
+
+// y += alpha * x
+void vector_axpy(int N, float alpha, const float* x, float* y);
+
+// y = alpha * x
+void vector_scale(int N, float alpha, const float* x, float* y);
+
+// Returns sum(a * b).
+float vector_dot(int N, const float* a, const float* b);
+
+// y = a + b
+void vector_add(int N, const float* a, const float* b, float* y);
+
+// y = a * b
+void vector_mul(int N, const float* a, const float* b, float* y);
+
+// y = max(x, y), elementwise
+void vector_max(int N, const float* x, float* y);
+
+// Returns sum(x).
+float vector_sum(int N, const float* x);
+
+// y[i] = max(x[i * D], ..., x[i * D + D - 1]) for the N rows of x.
+void rowwise_max(int N, int D, const float* x, float* y);
+
+} // namespace caffe2
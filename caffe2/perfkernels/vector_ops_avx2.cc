@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+namespace caffe2 {
+
+namespace {
+
+inline float hsum256(__m256 v) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+inline float hmax256(__m256 v) {
+  __m128 s = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_max_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+} // namespace
+
+void vector_axpy__avx2_fma(int N, float alpha, const float* x, float* y) {
+  const __m256 valpha = _mm256_set1_ps(alpha);
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(
+        y + i,
+        _mm256_fmadd_ps(
+            valpha, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+  }
+  for (; i < N; ++i) {
+    y[i] += alpha * x[i];
+  }
+}
+
+void vector_scale__avx2_fma(int N, float alpha, const float* x, float* y) {
+  const __m256 valpha = _mm256_set1_ps(alpha);
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(y + i, _mm256_mul_ps(valpha, _mm256_loadu_ps(x + i)));
+  }
+  for (; i < N; ++i) {
+    y[i] = alpha * x[i];
+  }
+}
+
+float vector_dot__avx2_fma(int N, const float* a, const float* b) {
+  // Two accumulators hide the latency of the fma.
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    acc0 = _mm256_fmadd_ps(
+        _mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    acc1 = _mm256_fmadd_ps(
+        _mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+  }
+  for (; i + 8 <= N; i += 8) {
+    acc0 = _mm256_fmadd_ps(
+        _mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+  }
+  float sum = hsum256(_mm256_add_ps(acc0, acc1));
+  for (; i < N; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+void vector_add__avx2_fma(int N, const float* a, const float* b, float* y) {
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(
+        y + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  }
+  for (; i < N; ++i) {
+    y[i] = a[i] + b[i];
+  }
+}
+
+void vector_mul__avx2_fma(int N, const float* a, const float* b, float* y) {
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(
+        y + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  }
+  for (; i < N; ++i) {
+    y[i] = a[i] * b[i];
+  }
+}
+
+void vector_max__avx2_fma(int N, const float* x, float* y) {
+  auto i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(
+        y + i, _mm256_max_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+  }
+  for (; i < N; ++i) {
+    y[i] = std::max(x[i], y[i]);
+  }
+}
+
+float vector_sum__avx2_fma(int N, const float* x) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(x + i));
+    acc1 = _mm256_add_ps(acc1, _mm256_loadu_ps(x + i + 8));
+  }
+  for (; i + 8 <= N; i += 8) {
+    acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(x + i));
+  }
+  float sum = hsum256(_mm256_add_ps(acc0, acc1));
+  for (; i < N; ++i) {
+    sum += x[i];
+  }
+  return sum;
+}
+
+void rowwise_max__avx2_fma(int N, int D, const float* x, float* y) {
+  for (auto n = 0; n < N; ++n) {
+    const float* row = x + n * D;
+    if (D < 8) {
+      y[n] = *std::max_element(row, row + D);
+      continue;
+    }
+    __m256 vmax = _mm256_loadu_ps(row);
+    auto i = 8;
+    for (; i + 8 <= D; i += 8) {
+      vmax = _mm256_max_ps(vmax, _mm256_loadu_ps(row + i));
+    }
+    float m = hmax256(vmax);
+    for (; i < D; ++i) {
+      m = std::max(m, row[i]);
+    }
+    y[n] = m;
+  }
+}
+
+} // namespace caffe2
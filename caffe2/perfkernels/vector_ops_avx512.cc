@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <immintrin.h>
+
+#include <limits>
+
+namespace caffe2 {
+
+// The tails are handled with masked loads and stores.
+
+namespace {
+
+inline __mmask16 tail_mask(int n) {
+  return static_cast<__mmask16>((1 << n) - 1);
+}
+
+} // namespace
+
+void vector_axpy__avx512(int N, float alpha, const float* x, float* y) {
+  const __m512 valpha = _mm512_set1_ps(alpha);
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_ps(
+        y + i,
+        _mm512_fmadd_ps(
+            valpha, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    _mm512_mask_storeu_ps(
+        y + i,
+        m,
+        _mm512_fmadd_ps(
+            valpha,
+            _mm512_maskz_loadu_ps(m, x + i),
+            _mm512_maskz_loadu_ps(m, y + i)));
+  }
+}
+
+void vector_scale__avx512(int N, float alpha, const float* x, float* y) {
+  const __m512 valpha = _mm512_set1_ps(alpha);
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_ps(y + i, _mm512_mul_ps(valpha, _mm512_loadu_ps(x + i)));
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    _mm512_mask_storeu_ps(
+        y + i, m, _mm512_mul_ps(valpha, _mm512_maskz_loadu_ps(m, x + i)));
+  }
+}
+
+float vector_dot__avx512(int N, const float* a, const float* b) {
+  __m512 acc0 = _mm512_setzero_ps();
+  __m512 acc1 = _mm512_setzero_ps();
+  auto i = 0;
+  for (; i + 32 <= N; i += 32) {
+    acc0 = _mm512_fmadd_ps(
+        _mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    acc1 = _mm512_fmadd_ps(
+        _mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+  }
+  for (; i + 16 <= N; i += 16) {
+    acc0 = _mm512_fmadd_ps(
+        _mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    acc1 = _mm512_fmadd_ps(
+        _mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), acc1);
+  }
+  return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+void vector_add__avx512(int N, const float* a, const float* b, float* y) {
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_ps(
+        y + i, _mm512_add_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    _mm512_mask_storeu_ps(
+        y + i,
+        m,
+        _mm512_add_ps(
+            _mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i)));
+  }
+}
+
+void vector_mul__avx512(int N, const float* a, const float* b, float* y) {
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_ps(
+        y + i, _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    _mm512_mask_storeu_ps(
+        y + i,
+        m,
+        _mm512_mul_ps(
+            _mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i)));
+  }
+}
+
+void vector_max__avx512(int N, const float* x, float* y) {
+  auto i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_ps(
+        y + i, _mm512_max_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+  }
+  if (i < N) {
+    const __mmask16 m = tail_mask(N - i);
+    _mm512_mask_storeu_ps(
+        y + i,
+        m,
+        _mm512_max_ps(
+            _mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i)));
+  }
+}
+
+float vector_sum__avx512(int N, const float* x) {
+  __m512 acc0 = _mm512_setzero_ps();
+  __m512 acc1 = _mm512_setzero_ps();
+  auto i = 0;
+  for (; i + 32 <= N; i += 32) {
+    acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(x + i));
+    acc1 = _mm512_add_ps(acc1, _mm512_loadu_ps(x + i + 16));
+  }
+  for (; i + 16 <= N; i += 16) {
+    acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(x + i));
+  }
+  if (i < N) {
+    acc1 = _mm512_add_ps(acc1, _mm512_maskz_loadu_ps(tail_mask(N - i), x + i));
+  }
+  return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+void rowwise_max__avx512(int N, int D, const float* x, float* y) {
+  const __m512 lowest = _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+  for (auto n = 0; n < N; ++n) {
+    const float* row = x + n * D;
+    __m512 vmax = lowest;
+    auto i = 0;
+    for (; i + 16 <= D; i += 16) {
+      vmax = _mm512_max_ps(vmax, _mm512_loadu_ps(row + i));
+    }
+    if (i < D) {
+      vmax = _mm512_max_ps(
+          vmax, _mm512_mask_loadu_ps(lowest, tail_mask(D - i), row + i));
+    }
+    y[n] = _mm512_reduce_max_ps(vmax);
+  }
+}
+
+} // namespace caffe2
@@ -24,6 +24,7 @@ import os
 import logging
 from caffe2.python import core, context
 from caffe2.python.net_builder import ops
+from caffe2.python.optimizer import get_dirty_rows_blob_name
 from caffe2.python.task import Node, Task, TaskGroup, TaskOutput, WorkspaceType
 
 logger = logging.getLogger(__name__)
@@ -129,6 +130,11 @@ def get_ckpt_filename(node_name, epoch):
     return node_name + '.' + str(epoch)
 
 
+def get_delta_blob_names(param):
+    """Returns the names of the row ids and rows saved in a delta of param."""
+    return str(param) + '__delta_ids', str(param) + '__delta_rows'
+
+
 class CheckpointManager(object):
     """
     Controls saving and loading of workspaces on every epoch boundary of a job.
@@ -260,6 +266,77 @@ class CheckpointManager(object):
                 db_type=self._db_type, absolute_path=True)
         return task
 
+    def _delta_db_name(self, epoch, path_prefix=None):
+        return self._db_name(epoch, path_prefix) + '.delta'
+
+    def _dirty_params(self):
+        """
+        Returns the blobs whose changed rows are tracked, see
+        Optimizer.track_dirty_rows.
+        """
+        blob_names = set(self.blob_list())
+        return [
+            name for name in self.blob_list()
+            if get_dirty_rows_blob_name(name) in blob_names]
+
+    def save_delta(self, epoch):
+        """
+        Build a Task that only saves the rows that changed since the previous
+        `save_delta`, for the blobs whose rows are tracked by their optimizer
+        (see Optimizer.track_dirty_rows). The changed rows are first copied
+        out of the parameters by GatherDirtyRows, which is the only step that
+        reads them, so that the training does not need to pause while the
+        copies are written.
+
+        The deltas of successive epochs are layered on top of a checkpoint
+        saved with `save`, see `load_with_deltas`.
+        """
+        logger.info('Saving delta to %s' % self._delta_db_name(epoch))
+        delta_blobs = []
+        with Task() as task:
+            for param in self._dirty_params():
+                row_ids, rows = get_delta_blob_names(param)
+                dirty = get_dirty_rows_blob_name(param)
+                ops.GatherDirtyRows([param, dirty], [row_ids, rows, dirty])
+                delta_blobs += [row_ids, rows]
+            if delta_blobs:
+                ops.Save(
+                    delta_blobs, [], db=self._delta_db_name(epoch),
+                    db_type=self._db_type, absolute_path=True)
+        return task
+
+    def load_with_deltas(
+        self, epoch, delta_epochs, path_prefix=None, path_type=None
+    ):
+        """
+        Build a Task that loads the checkpoint of the given epoch, saved with
+        `save`, and then merges the deltas saved by `save_delta` for each of
+        delta_epochs, in order.
+        """
+        db_type = path_type or self._db_type
+        with Task() as task:
+            ops.Load(
+                [],
+                self.blob_list(),
+                db=self._db_name(epoch, path_prefix),
+                db_type=db_type,
+                absolute_path=True)
+            params = self._dirty_params()
+            for delta_epoch in (delta_epochs if params else []):
+                delta_db_name = self._delta_db_name(delta_epoch, path_prefix)
+                logger.info('Merging delta from %s' % delta_db_name)
+                ops.Load(
+                    [],
+                    [name for param in params
+                     for name in get_delta_blob_names(param)],
+                    db=delta_db_name,
+                    db_type=db_type,
+                    absolute_path=True)
+                for param in params:
+                    row_ids, rows = get_delta_blob_names(param)
+                    ops.ScatterAssign([param, row_ids, rows], [param])
+        return task
+
 
 class MultiNodeCheckpointManager(object):
     """
@@ -589,7 +589,9 @@ def AddParameterUpdate(model):
         model.net.WeightedSum([param, ONE, param_grad, LR], param)
 
 
-def Benchmark(model_gen, arg):
+def PrepareModel(model_gen, arg):
+    """Builds the model to benchmark, with its data and labels filled by the
+    parameter initialization net, according to the benchmark arguments."""
     model, input_size = model_gen(arg.order, arg.cudnn_ws)
     model.Proto().type = arg.net_type
     model.Proto().num_workers = arg.num_workers
@@ -638,6 +640,11 @@ def Benchmark(model_gen, arg):
     if arg.engine:
         for op in model.net.Proto().op:
             op.engine = arg.engine
+    return model
+
+
+def Benchmark(model_gen, arg):
+    model = PrepareModel(model_gen, arg)
 
     if arg.dump_model:
         # Writes out the pbtxt for benchmarks on e.g. Android
@@ -1081,7 +1081,8 @@ class GradientRegistry(object):
         return gradient_ops, g_input
 
     @classmethod
-    def GetBackwardPass(cls, operators, ys, ys_generate_gradient=False):
+    def GetBackwardPass(
+            cls, operators, ys, ys_generate_gradient=False, use_cc=False):
         """Gets the backward pass for the list of operators.
 
         Args:
@@ -1092,14 +1093,70 @@ class GradientRegistry(object):
                 dictionary, for any dictionary entries that are not None, we'll
                 take the corresponding blobs as their gradients; for all those
                 that are None, we will auto-fill them with 1.
+            use_cc: if True, builds the backward pass in C++ when the gradients
+                of all the operators are registered there. Defaults to the
+                python IR.
         Returns:
             gradient_ops: a list of gradient operators to run.
             all_input_to_grads: a map from input to their corresponding
                 gradients.
         """
+        if use_cc and cls._HasAllGradientsInCC(operators):
+            return cls._GetBackwardPassCC(operators, ys)
         ir = IR(operators)
         return ir.GetBackwardPass(ys)
 
+    @classmethod
+    def _HasAllGradientsInCC(cls, operators):
+        # Gradients registered in python only are created by the python IR.
+        # Operators without any gradient are left to fail the same way in
+        # either builder, if their gradient is needed.
+        return all(
+            C.has_gradient(op_type) or op_type not in cls.gradient_registry_
+            for op_type in set(op.type for op in operators))
+
+    @classmethod
+    def _GetBackwardPassCC(cls, operators, ys):
+        """Same as IR(operators).GetBackwardPass(ys), built in C++ without
+        calling back into python for every operator."""
+        if isinstance(ys, list):
+            ys = dict((y, None) for y in ys)
+        elif not isinstance(ys, dict):
+            raise TypeError("ys should either be a list or a dict.")
+
+        def from_untyped(grad):
+            w = C.GradientWrapper()
+            if isinstance(grad, GradientSlice):
+                w.indices = str(grad.indices)
+                w.values = str(grad.values)
+            elif grad is not None:
+                w.dense = str(grad)
+            return w
+
+        net = caffe2_pb2.NetDef()
+        net.op.extend(operators)
+        device_option = scope.CurrentDeviceScope()
+        grad_defs_str, input_to_grad = C.get_backward_pass(
+            net.SerializeToString(),
+            [(str(y), from_untyped(g)) for y, g in viewitems(ys)],
+            None if device_option is None
+            else device_option.SerializeToString())
+        gradient_ops = []
+        for grad_def_str in grad_defs_str:
+            grad_def = caffe2_pb2.OperatorDef()
+            grad_def.ParseFromString(grad_def_str)
+            gradient_ops.append(grad_def)
+        all_input_to_grad_out = {}
+        for key, grad_wrapper in viewitems(input_to_grad):
+            if grad_wrapper.is_sparse():
+                grad_out = GradientSlice(
+                    BlobReference(grad_wrapper.indices),
+                    BlobReference(grad_wrapper.values))
+            else:
+                grad_out = BlobReference(grad_wrapper.dense)
+            all_input_to_grad_out[BlobReference(key)] = grad_out
+        return gradient_ops, all_input_to_grad_out
+
 
 GradientRegistry.RegisterGradient('Do')(gen_do_gradient)
 GradientRegistry.RegisterGradient('If')(gen_if_gradient)
@@ -1806,7 +1863,7 @@ class Net(object):
 
         self._recreate_lookup_tables = False
 
-    def AddGradientOperators(self, ys, skip=0):
+    def AddGradientOperators(self, ys, skip=0, use_cc=False):
         """Add the gradient for operators in the net.
 
         Inputs:
@@ -1819,6 +1876,8 @@ class Net(object):
           skip: skips the first n operators. This is provided mainly because a
               lot of nets may use the first few operators for data generation
               like stuff which really do not need to have gradients.
+          use_cc: builds the backward pass in C++ when possible, see
+              GradientRegistry.GetBackwardPass.
 
         Outputs:
           returns a map from the blob name in the input network to a blob
@@ -1830,7 +1889,7 @@ class Net(object):
         """
 
         grad_ops, input_to_grad = GradientRegistry.GetBackwardPass(
-            self._net.op[skip:], ys)
+            self._net.op[skip:], ys, use_cc=use_cc)
         # Check if in immediate mode: the grad_ops are actually being produced
         # by C++ and bypasses the CreateOperator() call, so in immediate mode
         # we will have to explicitly run them.
@@ -1965,6 +2024,12 @@ class Net(object):
 
     def DeduplicateGradientSlices(self, g, aggregator='sum'):
         assert isinstance(g, GradientSlice)
+        device = scope.CurrentDeviceScope()
+        if aggregator.lower() == 'sum' and (
+                device is None or device.device_type == caffe2_pb2.CPU):
+            # Single pass dedup and sum, only implemented on CPU.
+            unique, new_g = self.UniqueAndSum([g.indices, g.values], 2)
+            return GradientSlice(indices=unique, values=new_g)
         unique, remapping = self.Unique([g.indices], 2, engine='SparseHash')
         if aggregator.lower() == 'sum':
             new_g = self.UnsortedSegmentSum([g.values, remapping], 1)
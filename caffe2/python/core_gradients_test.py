@@ -554,6 +554,25 @@ class TestGradientCalculation(test_util.TestCase):
                        'hidden3': 'hidden3_grad', 'hidden': 'hidden_grad',
                        'in': 'in_grad'})
 
+    def testNativeBackwardPassMatchesIR(self):
+        net = core.Net("native_backward_pass")
+        fc = net.FC(["x", "w", "b"], "fc")
+        relu = net.Relu(fc, "relu")
+        emb1 = net.Gather(["table", "indices1"], "emb1")
+        emb2 = net.Gather(["table", "indices2"], "emb2")
+        total = net.Sum([relu, fc, emb1, emb2], "total")
+        stopped = net.StopGradient(total, "stopped")
+        loss = net.AveragedLoss(net.Add([total, stopped], "sum"), "loss")
+        operators = list(net.Proto().op)
+        self.assertTrue(GradientRegistry._HasAllGradientsInCC(operators))
+        for ys in [[loss], {loss: "loss_grad"}]:
+            with core.DeviceScope(core.DeviceOption(caffe2_pb2.CPU)):
+                expected = core.IR(operators).GetBackwardPass(ys)
+                actual = GradientRegistry.GetBackwardPass(
+                    operators, ys, use_cc=True)
+            self.assertEqual(actual[0], expected[0])
+            self.assertEqual(actual[1], expected[1])
+
     def test_zero_gradient(self):
         net = core.Net("zero_grad_test")
 
@@ -68,6 +68,8 @@ def Parallelize(
     cpu_device=False,
     num_threads_per_device=4,
     shared_model=False,
+    allreduce_bucket_size=0,
+    hierarchical_allreduce=False,
 ):
     '''
     Function to create a model that can run on many GPUs or CPUs.
@@ -101,7 +103,8 @@ def Parallelize(
       devices:          List of GPU ids, such as [0, 1, 2, 3],
       rendezvous:       used for rendezvous in distributed computation, if None
                         then only one node is used. To create rendezvous,
-                        use <TBD>.
+                        use <TBD>, or ElasticRendezvous for a job whose
+                        machines can change.
       net_type:         Network type
       optimize_gradient_memory: whether to apply 'memonger' to share blobs
       shared_model      (only for CPU) use same parameters on each device
@@ -113,6 +116,19 @@ def Parallelize(
       blobs_to_keep :   A list of blob names to keep and don't free during
                         dynamic memory optimization (for example loss blob).
       cpu_device        Use CPU instead of GPU.
+      allreduce_bucket_size:
+                        (only for distributed Gloo training) pack the dense
+                        gradients, in the order backward produces them, into
+                        buckets of about this many bytes that are allreduced
+                        with one AllreduceBucket op each. The net schedules
+                        these ahead of the remaining backward ops. 0 means one
+                        allreduce per gradient.
+      hierarchical_allreduce:
+                        (only for distributed Gloo training on GPUs) allreduce
+                        each gradient that is not bucketed with a single
+                        HierarchicalAllreduce op: an NCCL reduce-scatter over
+                        the local GPUs, a Gloo allreduce of every GPU's shard
+                        across the machines and an NCCL allgather.
     '''
     assert scope.CurrentDeviceScope() is None \
         or scope.CurrentDeviceScope().device_type == caffe2_pb2.CPU, \
@@ -269,6 +285,8 @@ def Parallelize(
             rendezvous,
             use_nccl,
             max_concurrent_distributed_ops,
+            bucket_size=allreduce_bucket_size,
+            hierarchical=hierarchical_allreduce,
         )
     else:
         log.info("NOTE: Param builder function did not create any parameters.")
@@ -320,7 +338,8 @@ def Parallelize(
         model_helper_obj.param_init_net,
         rendezvous,
         sync_names,
-        max_concurrent_distributed_ops=1
+        max_concurrent_distributed_ops=1,
+        pipelined=True,
     )
 
     # Handle any operations that need to be done after parameter sync
@@ -368,6 +387,7 @@ def Parallelize_GPU_BMUF(
     warmup_iterations=None,
     max_concurrent_distributed_ops=4,
     add_blobs_to_sync=None,
+    allreduce_bucket_size=0,
 ):
     '''
     Function to create model that run on many GPUs and creates a net for
@@ -377,6 +397,10 @@ def Parallelize_GPU_BMUF(
     in : Scalable Training of Deep Learning Machines by Incremental Block
     Training with Intra-block Parallel Optimization and Blockwise Model-Update
     Filtering (ICASSP 2016).
+
+    allreduce_bucket_size: (only for distributed Gloo training) allreduce the
+    params for the global model update in buckets of about this many bytes,
+    see Parallelize. 0 means one allreduce per param.
     '''
     assert isinstance(model_helper_obj, model_helper.ModelHelper)
 
@@ -511,7 +535,8 @@ def Parallelize_GPU_BMUF(
         model_helper_obj._global_model_param_updates_net,
         rendezvous,
         use_nccl,
-        max_concurrent_distributed_ops
+        max_concurrent_distributed_ops,
+        bucket_size=allreduce_bucket_size,
     )
 
     # (Step-3) Update momentum params :
@@ -523,45 +548,22 @@ def Parallelize_GPU_BMUF(
     # param_v_prev = param_v
     # else:
     # param = param + param_v
+    # All the params are updated by a single BMUFUpdate op.
+    bmuf_blobs = []
     for param_name in model_parameter_names:
         param = model_helper_obj._device_grouped_blobs[param_name][master_gpu]
-        with core.DeviceScope(master_gpu_opt):
-            # TODO(ataei) : Stop building the graph here to get model average ?
-            model_helper_obj._global_model_param_updates_net.Scale(
-                param, param, scale=1.0 / num_workers
-            )
-            model_helper_obj._global_model_param_updates_net.Sub(
-                [param, _g(param)], param
-            )
-            model_helper_obj._global_model_param_updates_net.Scale(
-                param, param, scale=block_learning_rate
-            )
-            model_helper_obj._global_model_param_updates_net.Scale(
-                _v(param), _v(param), scale=block_momentum
-            )
-            model_helper_obj._global_model_param_updates_net.Add(
-                [_v(param), param], _v(param)
-            )
-            model_helper_obj._global_model_param_updates_net.Add(
-                [_g(param), _v(param)], _g(param)
-            )
-            if nesterov:
-                model_helper_obj._global_model_param_updates_net.Sub(
-                    [_v(param), _v_prev(param)], _v_prev(param)
-                )
-                model_helper_obj._global_model_param_updates_net.Scale(
-                    _v_prev(param), _v_prev(param), scale=block_momentum
-                )
-                model_helper_obj._global_model_param_updates_net.Sub(
-                    [_g(param), _v_prev(param)], _g(param)
-                )
-                model_helper_obj._global_model_param_updates_net.Copy(
-                    _v(param), _v_prev(param)
-                )
-            model_helper_obj._global_model_param_updates_net.Copy(
-                _g(param), param
-            )
-
+        bmuf_blobs.extend([param, _g(param), _v(param)])
+        if nesterov:
+            bmuf_blobs.append(_v_prev(param))
+    with core.DeviceScope(master_gpu_opt):
+        model_helper_obj._global_model_param_updates_net.BMUFUpdate(
+            bmuf_blobs,
+            bmuf_blobs,
+            num_workers=num_workers,
+            block_learning_rate=block_learning_rate,
+            block_momentum=block_momentum,
+            nesterov=int(nesterov),
+        )
 
     _SyncAllParams(
         devices,
@@ -659,6 +661,186 @@ def Synchronize(model, timeout_sec=_DEFAULT_TIMEOUT_SEC):
     workspace.RunNetOnce(barrier_net)
 
 
+def ElasticRendezvous(
+    kv_handler,
+    min_shards,
+    max_shards=None,
+    last_generation=-1,
+    prefix="elastic",
+    engine='GLOO',
+    reference_num_shards=None,
+    settle_sec=5,
+    timeout_sec=_DEFAULT_TIMEOUT_SEC,
+    **kwargs
+):
+    '''
+    Forms a generation of an elastic job, in which machines can leave or join
+    between generations, and returns the rendezvous to Parallelize the model
+    of this generation with.
+      kv_handler:       store handler blob. The store must support add, such
+                        as the Redis store.
+      min_shards:       number of shards to wait for
+      max_shards:       maximum number of shards, no limit if None
+      last_generation:  rendezvous['generation'] of the generation this
+                        shard last trained in, -1 for a new shard
+      prefix:           prefix of the keys of the job in the store
+      reference_num_shards:
+                        number of shards the learning rate was tuned for.
+                        rendezvous['lr_scale'] is num_shards divided by it,
+                        to scale the base learning rate with.
+      kwargs:           other rendezvous entries, such as transport
+
+    When a collective op fails (see their status_blob), or when
+    ElasticMembershipChanged returns True, call it again with the last
+    generation, Parallelize a new model with the new rendezvous and call
+    ResumeElastic instead of RunInitNet.
+    '''
+    net = core.Net("elastic_rendezvous_net")
+    last_generation_blob = net.ConstantFill(
+        [],
+        prefix + "_last_generation",
+        shape=[1],
+        value=last_generation,
+        dtype=core.DataType.INT64,
+    )
+    generation, num_shards, shard_id, generation_kv_handler = \
+        net.ElasticRendezvous(
+            [kv_handler, last_generation_blob],
+            [
+                prefix + "_generation",
+                prefix + "_num_shards",
+                prefix + "_shard_id",
+                prefix + "_kv_handler",
+            ],
+            prefix=prefix,
+            min_size=min_shards,
+            max_size=max_shards or 0,
+            settle_ms=int(settle_sec * 1000),
+            timeout_ms=int(timeout_sec * 1000),
+        )
+    workspace.RunNetOnce(net)
+
+    num_shards = int(workspace.FetchBlob(num_shards)[0])
+    if reference_num_shards is None:
+        reference_num_shards = num_shards
+    rendezvous = dict(
+        kv_handler=str(generation_kv_handler),
+        shard_id=int(workspace.FetchBlob(shard_id)[0]),
+        num_shards=num_shards,
+        engine=engine,
+        generation=int(workspace.FetchBlob(generation)[0]),
+        last_generation=last_generation,
+        lr_scale=float(num_shards) / reference_num_shards,
+        elastic_kv_handler=kv_handler,
+        elastic_prefix=prefix,
+    )
+    rendezvous.update(kwargs)
+    log.info("Elastic rendezvous: generation {} with {} shards".format(
+        rendezvous['generation'], num_shards))
+    return rendezvous
+
+
+def ElasticMembershipChanged(model):
+    '''
+    Returns whether machines asked to join the elastic job since the
+    generation of the model was formed. Check it at the same iterations on
+    all the shards; a shard that sees the change later than the others fails
+    its next collective op and rejoins from there.
+    '''
+    rendezvous = model._rendezvous
+    current = rendezvous['elastic_prefix'] + "_current_generation"
+    workspace.RunOperatorOnce(
+        core.CreateOperator(
+            "StoreAdd",
+            [rendezvous['elastic_kv_handler']],
+            [current],
+            blob_name=rendezvous['elastic_prefix'] + "/generation",
+            add_value=0,
+        )
+    )
+    return workspace.FetchBlob(current)[0] > rendezvous['generation']
+
+
+def ResumeElastic(model):
+    '''
+    Use instead of RunInitNet for a model parallelized with the rendezvous
+    of a later generation of an elastic job. Shards that trained in an
+    earlier generation keep their parameters, optimizer state and iteration
+    counter in the workspace, and only run the ops of the param init net
+    that create the common worlds or that depend on them, such as the
+    initial parameter sync. All shards then train from the state of shard 0,
+    which ElasticRendezvous gives to a shard with the most recent one.
+    '''
+    rendezvous = model._rendezvous
+    has_state = rendezvous.get('last_generation', -1) >= 0
+    for init_net in model._data_parallel_model_init_nets:
+        if has_state:
+            init_net = _StripStatefulInitializers(init_net)
+        workspace.RunNetOnce(init_net)
+
+    if rendezvous['num_shards'] > 1:
+        # The iteration counters live on the CPU, outside of the synced blobs
+        resume_net = core.Net("elastic_resume_net")
+        comm_world = _CreateOrCloneCommonWorld(
+            resume_net,
+            "elastic_resume_cw",
+            rendezvous=rendezvous,
+            status_blob="elastic_resume_cw_status",
+        )
+        for blob in sorted(_GetIterationBlobs(model)):
+            resume_net.Broadcast(
+                inputs=[comm_world, blob],
+                outputs=[blob],
+                engine=rendezvous['engine'],
+                status_blob="elastic_resume_{}_status".format(blob),
+            )
+        workspace.RunNetOnce(resume_net)
+
+    for net_iters in model._data_parallel_model_nets:
+        if isinstance(net_iters, tuple):
+            workspace.CreateNet(net_iters[0], overwrite=True)
+        else:
+            workspace.CreateNet(net_iters, overwrite=True)
+
+
+def _StripStatefulInitializers(init_net):
+    '''
+    Returns a copy of init_net without the ops whose outputs all exist in
+    the workspace, unless they are collective ops or read a blob written by
+    an op that is kept.
+    '''
+    collective_ops = {
+        "CreateCommonWorld",
+        "CloneCommonWorld",
+        "Broadcast",
+        "Allreduce",
+        "Barrier",
+    }
+    stripped = core.Net(init_net.Proto().name + "_elastic")
+    proto = stripped.Proto()
+    proto.CopyFrom(init_net.Proto())
+    proto.name = stripped.Name()
+    del proto.op[:]
+    written = set()
+    for op in init_net.Proto().op:
+        if (op.type in collective_ops or
+                any(i in written for i in op.input) or
+                not all(workspace.HasBlob(o) for o in op.output)):
+            proto.op.extend([op])
+            written.update(op.output)
+    return stripped
+
+
+def _GetIterationBlobs(model):
+    # Iteration counters that do not have a device namescope
+    iteration_blobs = set()
+    for op in model.net.Proto().op:
+        if op.type == 'Iter' or op.type == 'AtomicIter':
+            if not op.output[0].startswith("{}_".format(model._device_prefix)):
+                iteration_blobs.add(op.output[0])
+    return iteration_blobs
+
+
 def ConvertNetForDevice(net, device=None):
     '''
     Converts all blobs in the net to have namescope gpu_X, and correct
@@ -762,13 +944,7 @@ def GetCheckpointParams(model):
 
     # Add iteration blobs that do not have namescope separately, since
     # it is important to checkpoint iteration counter
-    iteration_blobs = set()
-    for op in model.net.Proto().op:
-        if op.type == 'Iter' or op.type == 'AtomicIter':
-            if not op.output[0].startswith("{}_".format(model._device_prefix)):
-                iteration_blobs.add(op.output[0])
-
-    return first_gpu_blobs.union(iteration_blobs)
+    return first_gpu_blobs.union(_GetIterationBlobs(model))
 
 
 def FinalizeAfterCheckpoint(model, blobs=None):
@@ -949,10 +1125,20 @@ def _SyncAllParams(
     net,
     rendezvous,
     unique_param_names,
-    max_concurrent_distributed_ops=4
+    max_concurrent_distributed_ops=4,
+    pipelined=False,
 ):
     if rendezvous is None or rendezvous['num_shards'] <= 1:
         _SyncAllParamsSingleHost(devices, model, net, unique_param_names)
+    elif pipelined and rendezvous['engine'] == 'GLOO':
+        _SyncAllParamsPipelined(
+            devices,
+            model,
+            init_net,
+            net,
+            rendezvous,
+            unique_param_names,
+        )
     else:
         _SyncAllParamsDistributed(
             devices,
@@ -1074,13 +1260,72 @@ def _SyncAllParamsDistributed(
             _Broadcast(devices, model, net, param_name)
 
 
+def _SyncAllParamsPipelined(
+    devices,
+    model,
+    init_net,
+    net,
+    rendezvous,
+    unique_param_names,
+):
+    '''
+    Broadcasts all the parameters of the master device in a single chunked,
+    pipelined broadcast, which keeps all the links busy, rather than one
+    synchronous broadcast per parameter. GPU parameters are staged through
+    the CPU, and then copied to the other local devices.
+    '''
+    assert rendezvous['num_shards'] > 1
+
+    cpu_device_opt = core.DeviceOption(caffe2_pb2.CPU)
+    master_dev = devices[0]
+
+    cpu_params = []
+    gpu_params = []
+    for param_name in sorted(unique_param_names):
+        master_param = model._device_grouped_blobs[param_name][master_dev]
+        if _IsGPUBlob(model, param_name):
+            device_opt = core.DeviceOption(model._device_type, master_dev)
+            with core.DeviceScope(device_opt):
+                param_cpu = net.CopyGPUToCPU(
+                    master_param,
+                    str(master_param) + "_broadcast_cpu"
+                )
+            cpu_params.append(param_cpu)
+            gpu_params.append((master_param, param_cpu, device_opt))
+        else:
+            cpu_params.append(master_param)
+    if not cpu_params:
+        return
+
+    comm_world = _CreateOrCloneCommonWorld(
+        init_net,
+        "pipelined_broadcast_cw",
+        rendezvous=rendezvous,
+        status_blob="create_pipelined_broadcast_cw_status",
+    )
+    with core.DeviceScope(cpu_device_opt):
+        net.PipelinedBroadcast(
+            [comm_world] + cpu_params,
+            cpu_params,
+            engine=rendezvous['engine'],
+            status_blob="pipelined_broadcast_status",
+        )
+    for master_param, param_cpu, device_opt in gpu_params:
+        with core.DeviceScope(device_opt):
+            net.CopyCPUToGPU(param_cpu, master_param)
+
+    for param_name in unique_param_names:
+        _Broadcast(devices, model, net, param_name)
+
+
 def _SyncAllParamsSingleHost(devices, model, net, unique_param_names):
     for param in unique_param_names:
         _Broadcast(devices, model, net, param)
 
 
 def _AllReduceBlobs(blob_names, devices, model, net, rendezvous, use_nccl,
-                    max_concurrent_distributed_ops):
+                    max_concurrent_distributed_ops, bucket_size=0,
+                    hierarchical=False):
     if rendezvous is None or rendezvous['num_shards'] <= 1:
         _AllReduceBlobsSingleHost(
             blob_names,
@@ -1097,6 +1342,8 @@ def _AllReduceBlobs(blob_names, devices, model, net, rendezvous, use_nccl,
             net,
             rendezvous,
             max_concurrent_distributed_ops,
+            bucket_size=bucket_size,
+            hierarchical=hierarchical,
         )
 
 
@@ -1200,6 +1447,8 @@ def _AllReduceBlobsDistributed(
     net,
     rendezvous,
     max_concurrent_distributed_ops,
+    bucket_size=0,
+    hierarchical=False,
 ):
     num_workers = model.net.Proto().num_workers
     assert num_workers > 1, "Please specify more than 1 worker"
@@ -1218,7 +1467,59 @@ def _AllReduceBlobsDistributed(
 
     nccl_control_blob = None
 
+    if bucket_size > 0 and all_reduce_engine != 'GLOO':
+        log.warning("Gradient buckets are only supported with Gloo")
+        bucket_size = 0
+    if hierarchical and (all_reduce_engine != 'GLOO' or
+                         model._device_type != caffe2_pb2.CUDA):
+        log.warning("Hierarchical allreduce needs Gloo and GPUs")
+        hierarchical = False
+    if bucket_size > 0:
+        (shapes, types) = workspace.InferShapesAndTypes(
+            [model.param_init_net], {})
+    bucket = []
+    bucket_bytes = 0
+    bucket_type = None
+
+    def allreduce_bucket():
+        # Replica by replica, the layout AllreduceBucket expects
+        blobs = [
+            model._device_grouped_blobs[b][d]
+            for d in devices for b in bucket
+        ]
+        name = "bucket_{}".format(bucket[0])
+        with core.DeviceScope(reducing_device_opt):
+            comm_world, control_input = \
+                context.get_control_and_context(blobs[0])
+            net.AllreduceBucket(
+                inputs=[comm_world] + blobs,
+                outputs=blobs,
+                name=name,
+                engine=all_reduce_engine,
+                control_input=control_input,
+                status_blob="allreduce_{}_status".format(name),
+                num_replicas=len(devices),
+                gpu_direct=(rendezvous.get("transport", None) == "ibverbs"),
+            )
+        del bucket[:]
+
     for blob_name in blob_names:
+        if bucket_size > 0:
+            nbytes, dtype = _GetBlobSizeInBytes(model, blob_name, shapes, types)
+            if nbytes is not None:
+                # Gradients are bucketed in the order backward produces them,
+                # so that a bucket is ready as soon as its last gradient is.
+                if bucket and dtype != bucket_type:
+                    allreduce_bucket()
+                if not bucket:
+                    bucket_bytes = 0
+                    bucket_type = dtype
+                bucket.append(blob_name)
+                bucket_bytes += nbytes
+                if bucket_bytes >= bucket_size:
+                    allreduce_bucket()
+                continue
+
         master_blob = model._device_grouped_blobs[blob_name][devices[0]]
         blobs_group = list(viewvalues(model._device_grouped_blobs[blob_name]))
 
@@ -1228,11 +1529,11 @@ def _AllReduceBlobsDistributed(
         # so we need a temporary blob
         reduced_blob = str(master_blob) + "_red"
 
-        def allreduce(blobs, **kwargs):
+        def allreduce(blobs, op_type="Allreduce", **kwargs):
             with core.DeviceScope(reducing_device_opt):
                 comm_world, control_input = \
                     context.get_control_and_context(blobs[0])
-                net.Allreduce(
+                getattr(net, op_type)(
                     inputs=[comm_world] + blobs,
                     outputs=blobs,
                     name=blob_name,
@@ -1248,6 +1549,8 @@ def _AllReduceBlobsDistributed(
             # Try to use GPUDirect if transport == ibverbs.
             allreduce(
                 blobs_group,
+                op_type=(
+                    "HierarchicalAllreduce" if hierarchical else "Allreduce"),
                 gpu_direct=(rendezvous.get("transport", None) == "ibverbs"),
             )
         else:
@@ -1273,6 +1576,16 @@ def _AllReduceBlobsDistributed(
             # Step 3: broadcast locally
             _Broadcast(devices, model, net, blob_name)
 
+    if bucket:
+        allreduce_bucket()
+    if bucket_size > 0:
+        # Let the DAG start the collectives as soon as their gradients are
+        # ready, ahead of the backward ops that are already queued.
+        arg = net.Proto().arg.add()
+        arg.name = "priority_op_types"
+        arg.strings.extend(
+            [b"AllreduceBucket", b"Allreduce", b"HierarchicalAllreduce"])
+
 
 def _AllReduceBlobsSingleHost(blob_names, devices, model, net, use_nccl):
     """Performs NCCL AllReduce to distribute blobs to all the GPUs."""
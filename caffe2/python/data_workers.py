@@ -441,6 +441,9 @@ class GlobalCoordinator(GlobalWorkerCoordinator):
     def reset_data_input(self, namescope, name, net, batch_size):
         log.info("Reset data input {}, batch size {}: ".format(name, batch_size))
         for c in self._coordinators:
+            # Native data workers have no batch feeder and don't rebatch.
+            if not isinstance(c._state, BatchFeeder):
+                continue
             if c._worker_name == name and c._state._namescope == namescope:
                 c._state._batch_size = batch_size
                 c._state._create_caffe2_ops(net)
@@ -323,6 +323,10 @@ def Train(args):
     else:
         rendezvous = None
 
+    # Scales the loss so that small float16 gradients do not flush to zero.
+    loss_scaler = (optimizer.DynamicLossScaler()
+                   if args.dynamic_loss_scale else None)
+
     # Model building functions
     def create_resnet50_model_ops(model, loss_scale):
         initializer = (pFP16Initializer if args.dtype == 'float16'
@@ -348,12 +352,17 @@ def Train(args):
         softmax, loss = model.SoftmaxWithLoss([pred, 'label'],
                                               ['softmax', 'loss'])
         loss = model.Scale(loss, scale=loss_scale)
+        if loss_scaler:
+            loss = loss_scaler.scale_loss(model, loss)
         brew.accuracy(model, [softmax, "label"], "accuracy")
         return [loss]
 
     def add_optimizer(model):
         stepsz = int(30 * args.epoch_size / total_batch_size / num_shards)
 
+        if loss_scaler:
+            loss_scaler.unscale_gradients(model)
+
         if args.float16_compute:
             # TODO: merge with multi-prceision optimizer
             opt = optimizer.build_fp16_sgd(
@@ -585,6 +594,9 @@ def main():
                         help="Use float 16 compute, if available")
     parser.add_argument('--enable-tensor-core', action='store_true',
                         help='Enable Tensor Core math for Conv and FC ops')
+    parser.add_argument('--dynamic_loss_scale', action='store_true',
+                        help='Scale the loss dynamically, for float16 '
+                        'training')
     parser.add_argument("--distributed_transport", type=str, default="tcp",
                         help="Transport to use for distributed run [tcp|ibverbs]")
     parser.add_argument("--distributed_interfaces", type=str, default="",
@@ -0,0 +1,78 @@
+# Copyright (c) 2016-present, Facebook, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##############################################################################
+
+## @package int8_calibration
+# Module caffe2.python.int8_calibration
+"""
+Calibration for the INT8 engine of Conv and FC on CPU.
+
+Typical use, with `net` an fp32 inference net whose inputs are fed:
+
+    ranges = int8_calibration.collect_activation_ranges(net, num_iter=10,
+                                                        feed_fn=feed_batch)
+    int8_calibration.set_activation_ranges(net, ranges)
+    core.SetGlobalEnginePref({caffe2_pb2.CPU: ['INT8']})
+    workspace.CreateNet(net, overwrite=True)
+
+Operators without calibrated ranges quantize with the range of their input at
+each run instead.
+"""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import workspace
+
+INT8_OP_TYPES = ('Conv', 'Conv2D', 'FC', 'Int8Quantize')
+
+
+def collect_activation_ranges(net, num_iter=1, feed_fn=None):
+    """Runs `net` num_iter times and returns the {blob: (min, max)} range of
+    the float inputs of its operators. feed_fn, if given, is called with the
+    iteration number before each run to feed the next batch."""
+    workspace.CreateNet(net, overwrite=True)
+    observer = net.AddObserver("ActivationRangeObserver")
+    try:
+        for i in range(num_iter):
+            if feed_fn is not None:
+                feed_fn(i)
+            workspace.RunNet(net)
+        return observer.activation_ranges()
+    finally:
+        net.RemoveObserver(observer)
+
+
+def set_activation_ranges(net, ranges):
+    """Sets the in_min and in_max arguments of the operators of the INT8
+    engine from the ranges of their first input. Returns the number of
+    operators that were calibrated."""
+    calibrated = 0
+    for op in net.Proto().op:
+        if op.type not in INT8_OP_TYPES or op.input[0] not in ranges:
+            continue
+        min_value, max_value = ranges[op.input[0]]
+        args = [a for a in op.arg if a.name not in ('in_min', 'in_max')]
+        del op.arg[:]
+        op.arg.extend(args)
+        min_arg = op.arg.add()
+        min_arg.name = 'in_min'
+        min_arg.f = min_value
+        max_arg = op.arg.add()
+        max_arg.name = 'in_max'
+        max_arg.f = max_value
+        calibrated += 1
+    return calibrated
@@ -164,3 +164,63 @@ class TestQuantize8bits(hu.HypothesisTestCase):
         ground_truth_gathered = workspace.FetchBlob('Gathered_0')
         np.testing.assert_array_almost_equal(Gathered_1,
                                              ground_truth_gathered, decimal=5)
+
+    def test_quantize_4bits_op(self):
+        input_data = np.random.randn(5, 6).astype(np.float32)
+        workspace.FeedBlob('input_data', input_data)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'FloatToRowwiseQuantized4Bits',
+            ['input_data'],
+            ['quantized_input', 'scale_bias']))
+        quantized = workspace.FetchBlob('quantized_input')
+        self.assertEqual(quantized.shape, (5, 3))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'Rowwise4BitQuantizedToFloat',
+            ['quantized_input', 'scale_bias'],
+            ['dequantized_input']))
+        result = workspace.FetchBlob('dequantized_input')
+        half_step = (input_data.max(axis=1) - input_data.min(axis=1)) / 30.
+        self.assertTrue(np.all(
+            np.abs(result - input_data) <= half_step[:, None] + 1e-5))
+
+    def test_sparse_lengths_sum_4bits(self):
+        data = np.random.randn(10, 8).astype(np.float32)
+        indices = np.random.randint(0, 10, size=12).astype(np.int64)
+        lengths = np.array([3, 0, 5, 4], dtype=np.int32)
+        weights = np.random.rand(12).astype(np.float32)
+        workspace.FeedBlob('data', data)
+        workspace.FeedBlob('indices', indices)
+        workspace.FeedBlob('lengths', lengths)
+        workspace.FeedBlob('weights', weights)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'FloatToRowwiseQuantized4Bits', ['data'], ['q', 'scale_bias']))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'Rowwise4BitQuantizedToFloat', ['q', 'scale_bias'], ['dq']))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'SparseLengthsSum4BitsRowwise',
+            ['q', 'indices', 'lengths', 'scale_bias'], ['sum']))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'SparseLengthsWeightedSum4BitsRowwise',
+            ['q', 'weights', 'indices', 'lengths', 'scale_bias'],
+            ['weighted_sum']))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'SparseLengthsMean4BitsRowwise',
+            ['q', 'indices', 'lengths', 'scale_bias'], ['mean']))
+
+        dq = workspace.FetchBlob('dq')
+        segments = np.split(np.arange(12), np.cumsum(lengths)[:-1])
+        expected_sum = np.array(
+            [dq[indices[s]].sum(axis=0) for s in segments])
+        expected_weighted_sum = np.array(
+            [(dq[indices[s]] * weights[s, None]).sum(axis=0)
+             for s in segments])
+        expected_mean = np.array(
+            [dq[indices[s]].mean(axis=0) if len(s) else np.zeros(8)
+             for s in segments])
+        np.testing.assert_array_almost_equal(
+            workspace.FetchBlob('sum'), expected_sum, decimal=4)
+        np.testing.assert_array_almost_equal(
+            workspace.FetchBlob('weighted_sum'), expected_weighted_sum,
+            decimal=4)
+        np.testing.assert_array_almost_equal(
+            workspace.FetchBlob('mean'), expected_mean, decimal=4)
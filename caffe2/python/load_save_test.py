@@ -27,7 +27,7 @@ import tempfile
 import unittest
 
 from caffe2.proto import caffe2_pb2
-from caffe2.python import core, test_util, workspace
+from caffe2.python import core, test_util, utils, workspace
 
 if workspace.has_gpu_support:
     DEVICES = [caffe2_pb2.CPU, caffe2_pb2.CUDA]
@@ -163,6 +163,24 @@ class TestLoadSave(TestLoadSaveBase):
     def testLoadSave(self):
         self.load_save()
 
+    def testSerializeLargeTensorAsBytes(self):
+        dtypes = [np.float16, np.float32, np.float64, np.bool, np.int8,
+                  np.int16, np.int32, np.int64, np.uint8, np.uint16]
+        for T in dtypes:
+            arr = np.random.permutation(5000).reshape(50, 100).astype(T)
+            workspace.FeedBlob("large", arr)
+            serialized = workspace.SerializeBlob("large")
+            proto = caffe2_pb2.BlobProto()
+            proto.ParseFromString(serialized)
+            self.assertTrue(proto.tensor.HasField('byte_order'))
+            self.assertEqual(len(proto.tensor.byte_data), arr.nbytes)
+            np.testing.assert_array_equal(
+                utils.Caffe2TensorToNumpyArray(proto.tensor), arr)
+            workspace.DeserializeBlob("copy", serialized)
+            fetched = workspace.FetchBlob("copy")
+            self.assertEqual(fetched.dtype, arr.dtype)
+            np.testing.assert_array_equal(fetched, arr)
+
     def testRepeatedArgs(self):
         dtypes = [np.float16, np.float32, np.float64, np.bool, np.int8,
                   np.int16, np.int32, np.int64, np.uint8, np.uint16]
@@ -355,6 +373,61 @@ class TestLoadSave(TestLoadSaveBase):
                 raise
 
 
+class TestLoadSaveMmap(test_util.TestCase):
+
+    def testLoadSaveMmap(self):
+        workspace.ResetWorkspace()
+        dtypes = [np.float16, np.float32, np.float64, np.bool, np.int8,
+                  np.int16, np.int32, np.int64, np.uint8, np.uint16]
+        arrays = [np.random.permutation(6).reshape(2, 3).astype(T)
+                  for T in dtypes]
+        for i, arr in enumerate(arrays):
+            self.assertTrue(workspace.FeedBlob(str(i), arr))
+        blobs = [str(i) for i in range(len(arrays))]
+
+        tmp_folder = tempfile.mkdtemp()
+        try:
+            db = os.path.join(tmp_folder, "model.mmap")
+            self.assertTrue(workspace.RunOperatorOnce(core.CreateOperator(
+                "Save", blobs, [], absolute_path=1, db=db, db_type="mmap")))
+            self.assertTrue(workspace.RunOperatorOnce(core.CreateOperator(
+                "DBExists", [], ["exists"], absolute_path=1, db_name=db,
+                db_type="mmap")))
+            self.assertTrue(workspace.FetchBlob("exists"))
+
+            for load_all in [0, 1]:
+                workspace.ResetWorkspace()
+                self.assertTrue(workspace.RunOperatorOnce(core.CreateOperator(
+                    "Load", [], [] if load_all else blobs, absolute_path=1,
+                    db=db, db_type="mmap", load_all=load_all)))
+                for i, arr in enumerate(arrays):
+                    fetched = workspace.FetchBlob(str(i))
+                    self.assertEqual(fetched.dtype, arr.dtype)
+                    np.testing.assert_array_equal(fetched, arr)
+
+            # Loading a subset with a prefix.
+            workspace.ResetWorkspace()
+            self.assertTrue(workspace.RunOperatorOnce(core.CreateOperator(
+                "Load", [], ["p_1"], absolute_path=1, db=db, db_type="mmap",
+                add_prefix="p_")))
+            np.testing.assert_array_equal(workspace.FetchBlob("p_1"), arrays[1])
+            self.assertFalse(workspace.HasBlob("p_0"))
+        finally:
+            shutil.rmtree(tmp_folder)
+
+    def testSaveMmapRejectsStrings(self):
+        workspace.ResetWorkspace()
+        workspace.FeedBlob("s", np.array([b"a", b"b"], dtype=np.object))
+        tmp_folder = tempfile.mkdtemp()
+        try:
+            with self.assertRaises(RuntimeError):
+                workspace.RunOperatorOnce(core.CreateOperator(
+                    "Save", ["s"], [], absolute_path=1,
+                    db=os.path.join(tmp_folder, "model.mmap"),
+                    db_type="mmap"))
+        finally:
+            shutil.rmtree(tmp_folder)
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -190,6 +190,7 @@ def estimate_memory_usage(protos, shapes, types, devicescope):
         caffe2_pb2.TensorProto.DOUBLE: 8,
         caffe2_pb2.TensorProto.FLOAT: 4,
         caffe2_pb2.TensorProto.FLOAT16: 2,
+        caffe2_pb2.TensorProto.BFLOAT16: 2,
         caffe2_pb2.TensorProto.INT32: 4,
         caffe2_pb2.TensorProto.INT8: 1,
         caffe2_pb2.TensorProto.UINT8: 1,
@@ -511,6 +512,20 @@ def compute_ranges(linearized_ops, blob_sizes=None):
             assert not blob_sizes or blob_size is not None
             blobs[blob] = blobs[blob]._replace(size=blob_size)
 
+    # With zero_copy, the outputs may be views of the first input, which has
+    # to outlive them.
+    for op in reversed(linearized_ops):
+        if not op.input or not any(
+                a.name == 'zero_copy' and a.i for a in op.arg):
+            continue
+        source = blobs[op.input[0]]
+        for blob in op.output:
+            used = blobs[blob].used
+            used = len(linearized_ops) if used is None else used
+            if source.used is None or source.used < used:
+                source = source._replace(used=used)
+        blobs[op.input[0]] = source
+
     return blobs
 
 
@@ -1003,3 +1018,209 @@ def collect_blob_sizes(net):
             blobs[blob] = blob_nbytes(blob)
 
     return blobs
+
+
+RecomputeStatistics = collections.namedtuple(
+    'RecomputeStatistics',
+    ['baseline_nbytes', 'optimized_nbytes', 'forward_flops',
+     'recompute_flops', 'recomputed_ops'])
+
+# Operators whose outputs would differ, or which would update state, if run a
+# second time.
+_NON_RECOMPUTABLE_OPS = set([
+    'Dropout', 'SpatialBN', 'Iter', 'AtomicIter', 'UniformFill',
+    'UniformIntFill', 'GaussianFill', 'XavierFill', 'MSRAFill',
+])
+
+
+def _is_backward_op(op):
+    return op.is_gradient_op or any(
+        str(b).endswith('_grad') for b in op.output)
+
+
+def _has_subnets(op):
+    return any(arg.HasField('n') or len(arg.nets) > 0 for arg in op.arg)
+
+
+def _operator_flops(op):
+    try:
+        flops, _, _ = C.get_operator_cost(
+            op.SerializeToString(), [str(b) for b in op.input])
+        return flops
+    except Exception:
+        return 0
+
+
+def recompute_activations(netproto, num_segments=None, blob_sizes=None,
+                          dont_recompute_blobs=None):
+    '''
+    Trades compute for memory in a training net: instead of keeping every
+    activation alive from the forward pass until its gradient operator reads
+    it, split the forward pass into segments, keep only the activations that
+    cross segment boundaries (the checkpoints) and run each segment again
+    right before the backward pass first needs one of its activations. With
+    the default of sqrt(N) segments for N forward operators this keeps about
+    2 * sqrt(N) activations alive instead of N, for the cost of running the
+    forward pass roughly twice.
+
+    Apply to a net after AddGradientOperators(); the result can be further
+    optimized with share_grad_blobs(). Recomputed activations are named
+    <blob>_recompute, and both they and the activations they replace are
+    released with Free ops after their last use, so this only saves memory
+    with a caching allocator (see release_blobs_when_used()).
+
+    A segment is run again only if none of its operators is random or
+    stateful (Dropout, SpatialBN, fills, ...), has subnets, or writes a blob
+    that is also written elsewhere in the forward pass (in-place operators);
+    otherwise its activations are all kept.
+
+    @num_segments:          number of segments, default sqrt(N)
+    @blob_sizes:            optional map from blob name to its size in bytes,
+                            as returned by collect_blob_sizes(); by default
+                            the sizes of the blobs in the workspace are used
+    @dont_recompute_blobs:  blobs to always keep, such as the loss
+
+    Returns (new protobuffer, RecomputeStatistics). The FLOP counts come from
+    the cost inference of the operator schemas and need the inputs of the
+    operators in the workspace; they are 0 when that is not available.
+    '''
+    dont_recompute_blobs = set(dont_recompute_blobs or [])
+    ops = list(netproto.op)
+    num_forward = next(
+        (i for i, op in enumerate(ops) if _is_backward_op(op)), len(ops))
+    forward_ops = ops[:num_forward]
+    backward_ops = ops[num_forward:]
+    recompute_flops = 0
+    forward_flops = sum(_operator_flops(op) for op in forward_ops)
+
+    if num_forward == 0 or any(_has_subnets(op) for op in ops):
+        log.warning("Not recomputing activations: no forward pass or "
+                    "operators with subnets")
+        return copy.deepcopy(netproto), RecomputeStatistics(
+            0, 0, forward_flops, 0, 0)
+
+    if num_segments is None:
+        num_segments = int(round(num_forward ** 0.5))
+    num_segments = max(1, min(num_segments, num_forward))
+    segment_size = (num_forward + num_segments - 1) // num_segments
+    segment_of_op = [i // segment_size for i in range(num_forward)]
+
+    write_count = collections.defaultdict(int)
+    for op in forward_ops:
+        for b in op.output:
+            write_count[b] += 1
+    external = set(netproto.external_input) | set(netproto.external_output)
+
+    def op_recomputable(op):
+        return op.type not in _NON_RECOMPUTABLE_OPS and all(
+            write_count[b] == 1 and b not in external for b in op.output)
+
+    recomputable = [True] * (segment_of_op[-1] + 1)
+    producer = {}
+    for i, op in enumerate(forward_ops):
+        if not op_recomputable(op):
+            recomputable[segment_of_op[i]] = False
+        for b in op.output:
+            producer[b] = i
+
+    # Activations read by a later segment or by nobody in the backward pass
+    # stay as they are.
+    read_by_backward = set(b for op in backward_ops for b in op.input)
+    checkpoints = set(dont_recompute_blobs)
+    last_forward_use = {}
+    for i, op in enumerate(forward_ops):
+        for b in op.input:
+            if b in producer and segment_of_op[producer[b]] != segment_of_op[i]:
+                checkpoints.add(b)
+            last_forward_use[b] = i
+    dropped = set(
+        b for b, i in viewitems(producer)
+        if recomputable[segment_of_op[i]] and b in read_by_backward and
+        b not in checkpoints and b not in external)
+
+    def recompute_name(b):
+        return b + '_recompute'
+
+    # Operators of each segment to run again, only those that the dropped
+    # activations depend on.
+    segment_ops = collections.defaultdict(list)
+    needed = set(dropped)
+    for i in reversed(range(num_forward)):
+        op = forward_ops[i]
+        if any(b in needed for b in op.output):
+            segment_ops[segment_of_op[i]].insert(0, op)
+            for b in op.input:
+                if b in producer and \
+                        segment_of_op[producer[b]] == segment_of_op[i]:
+                    needed.add(b)
+
+    new_ops = []
+    frees_after = collections.defaultdict(list)
+    for b in dropped:
+        frees_after[last_forward_use.get(b, producer[b])].append(b)
+    for i, op in enumerate(forward_ops):
+        new_ops.append(op)
+        for b in sorted(frees_after[i]):
+            new_ops.append(core.CreateOperator("Free", [b], [b]))
+
+    recomputed = set()
+    recomputed_ops = 0
+    to_release = set()
+    for op in backward_ops:
+        for b in op.input:
+            if b not in dropped:
+                continue
+            segment = segment_of_op[producer[b]]
+            if segment in recomputed:
+                continue
+            recomputed.add(segment)
+            for forward_op in segment_ops[segment]:
+                recompute_op = copy.deepcopy(forward_op)
+                for j, inp in enumerate(recompute_op.input):
+                    if inp in needed:
+                        recompute_op.input[j] = recompute_name(inp)
+                for j, outp in enumerate(recompute_op.output):
+                    recompute_op.output[j] = recompute_name(outp)
+                    to_release.add(recompute_op.output[j])
+                new_ops.append(recompute_op)
+                recompute_flops += _operator_flops(forward_op)
+                recomputed_ops += 1
+        op = copy.deepcopy(op)
+        for j, inp in enumerate(op.input):
+            if inp in dropped:
+                op.input[j] = recompute_name(inp)
+        new_ops.append(op)
+
+    # Release the recomputed activations after their last use.
+    for j in reversed(range(len(new_ops))):
+        op = new_ops[j]
+        for b in list(op.input) + list(op.output):
+            if b in to_release:
+                to_release.remove(b)
+                new_ops.insert(j + 1, core.CreateOperator("Free", [b], [b]))
+
+    result = copy.deepcopy(netproto)
+    del result.op[:]
+    result.op.extend(new_ops)
+
+    if blob_sizes is None:
+        blob_sizes = {b: blob_nbytes(b) for b in producer}
+    activations = set(producer) & read_by_backward
+    baseline_nbytes = sum(blob_sizes.get(b, 0) for b in activations)
+    largest_segment = max(
+        [sum(blob_sizes.get(b, 0) for b in needed
+             if segment_of_op[producer[b]] == s) for s in recomputed] + [0])
+    optimized_nbytes = sum(
+        blob_sizes.get(b, 0) for b in activations - dropped) + largest_segment
+    stats = RecomputeStatistics(
+        baseline_nbytes=baseline_nbytes,
+        optimized_nbytes=optimized_nbytes,
+        forward_flops=forward_flops,
+        recompute_flops=recompute_flops,
+        recomputed_ops=recomputed_ops)
+    log.info(
+        "Recomputing {} of {} forward ops in {} segments: activations "
+        "{} -> {} bytes, {} extra FLOPs over {}".format(
+            recomputed_ops, num_forward, len(recomputed), baseline_nbytes,
+            optimized_nbytes, recompute_flops, forward_flops))
+    return result, stats
@@ -238,6 +238,48 @@ class MemongerTest(hu.HypothesisTestCase):
         np.testing.assert_almost_equal(loss, optimized_loss)
         np.testing.assert_almost_equal(grad, optimized_grad)
 
+    @given(input_dim=st.integers(min_value=1, max_value=4),
+           output_dim=st.integers(min_value=1, max_value=4),
+           batch_size=st.integers(min_value=1, max_value=4))
+    def test_recompute_activations(self, input_dim, output_dim, batch_size):
+        m = model_helper.ModelHelper()
+        blob = brew.fc(m, "data", "fc0", dim_in=input_dim, dim_out=output_dim)
+        for i in range(1, 8):
+            blob = brew.relu(m, blob, "relu{}".format(i))
+            blob = brew.fc(
+                m, blob, "fc{}".format(i), dim_in=output_dim,
+                dim_out=output_dim)
+        m.net.Softmax(blob, "pred") \
+            .LabelCrossEntropy(["label"], ["xent"]) \
+            .AveragedLoss([], "loss")
+        input_to_grad = m.AddGradientOperators(["loss"])
+
+        data = np.random.randn(batch_size, input_dim).astype(np.float32)
+        label = np.random.randint(
+            low=0, high=output_dim, size=(batch_size,)).astype(np.int32)
+        workspace.RunNetOnce(m.param_init_net)
+        workspace.FeedBlob("data", data)
+        workspace.FeedBlob("label", label)
+        workspace.RunNetOnce(m.net)
+        loss = workspace.FetchBlob("loss")
+        grad = workspace.FetchBlob(str(input_to_grad["fc0_w"]))
+
+        optim_proto, stats = memonger.recompute_activations(
+            m.net.Proto(), dont_recompute_blobs=set(["loss"]))
+        recomputed = [
+            op for op in optim_proto.op
+            if any(b.endswith("_recompute") for b in op.output)]
+        self.assertGreater(len(recomputed), 0)
+        self.assertEqual(stats.recomputed_ops, len(recomputed))
+        self.assertLess(stats.optimized_nbytes, stats.baseline_nbytes)
+        self.assertTrue(any(op.type == "Free" for op in optim_proto.op))
+
+        workspace.FeedBlob(str(input_to_grad["fc0_w"]), np.array([0.0]))
+        workspace.RunNetOnce(optim_proto)
+        np.testing.assert_almost_equal(loss, workspace.FetchBlob("loss"))
+        np.testing.assert_almost_equal(
+            grad, workspace.FetchBlob(str(input_to_grad["fc0_w"])))
+
     @unittest.skipIf(not workspace.has_gpu_support, "No gpu support.")
     def test_memonger_mix_cpu_gpu(self):
         '''
@@ -19,8 +19,29 @@ from __future__ import print_function
 from __future__ import unicode_literals
 
 import copy
+from collections import defaultdict
 from caffe2.proto import caffe2_pb2
-from caffe2.python import core
+from caffe2.python import core, utils
+
+# Operators with a native MKL implementation, whose outputs stay in the
+# layout MKL chose for them. The MKL fallback operators are left out: they
+# convert to and from CPU tensors anyway.
+MKL_OPERATORS = set([
+    "AveragePool",
+    "Conv",
+    "ConvFusion",
+    "FC",
+    "LRN",
+    "MaxPool",
+    "Relu",
+    "SpatialBN",
+    "Sum",
+])
+
+# fusion_type of ConvFusion.
+CONV_FUSION_RELU = 1
+CONV_FUSION_SUM = 2
+CONV_FUSION_SUM_RELU = 3
 
 
 def rewrite_init_net_simple(net):
@@ -67,3 +88,169 @@ def rewrite_model_helper_simple(model):
     rewrite_init_net_simple(model.param_init_net.Proto())
     rewrite_run_net_simple(model.net.Proto())
     return model
+
+
+def _get_arg(op, name, default=None):
+    for arg in op.arg:
+        if arg.name == name:
+            return arg
+    return default
+
+
+def _runs_on_mkl(op, mkl_operators):
+    if op.type not in mkl_operators:
+        return False
+    order = _get_arg(op, "order")
+    if order is not None and order.s not in (b"NCHW", "NCHW"):
+        return False
+    return not any(arg.name.startswith("dilation") for arg in op.arg)
+
+
+def fuse_conv_relu_sum(net):
+    """Replaces NCHW Conv operators followed by Relu, by Sum, or by Sum and
+    then Relu with a single ConvFusion operator. The intermediate blobs have
+    to be read by the fused operators only."""
+    external_outputs = set(net.external_output)
+    ops = list(net.op)
+    # Readers of the value written by operator i into a blob, by (i, blob).
+    readers = defaultdict(list)
+    last_writer = {}
+    for i, op in enumerate(ops):
+        for b in op.input:
+            readers[(last_writer.get(b), b)].append(i)
+        for b in op.output:
+            last_writer[b] = i
+
+    def only_reader(writer, blob):
+        if blob in external_outputs or len(readers[(writer, blob)]) != 1:
+            return None
+        return readers[(writer, blob)][0]
+
+    def written_between(blobs, begin, end):
+        return any(
+            b in blobs for op in ops[begin + 1:end] for b in op.output)
+
+    removed = set()
+    for i, op in enumerate(ops):
+        if i in removed or not _runs_on_mkl(op, ["Conv"]) or \
+                len(op.output) != 1:
+            continue
+        fused = [i]
+        inputs = list(op.input)
+        fusion_type = None
+        output = op.output[0]
+        j = only_reader(i, output)
+        if j is not None and ops[j].type == "Sum" and len(ops[j].input) == 2 \
+                and len(inputs) == 3:
+            other = [b for b in ops[j].input if b != output]
+            if len(other) == 1 and other[0] not in ops[j].output:
+                fused.append(j)
+                inputs.append(other[0])
+                fusion_type = CONV_FUSION_SUM
+                output = ops[j].output[0]
+                j = only_reader(j, output)
+        if j is not None and ops[j].type == "Relu" and ops[j].input[0] == output:
+            fused.append(j)
+            fusion_type = CONV_FUSION_SUM_RELU \
+                if fusion_type == CONV_FUSION_SUM else CONV_FUSION_RELU
+            output = ops[j].output[0]
+        if fusion_type is None or \
+                written_between(set(inputs), fused[0], fused[-1]) or \
+                output in inputs:
+            continue
+        fused_op = copy.deepcopy(op)
+        fused_op.type = "ConvFusion"
+        del fused_op.input[:]
+        fused_op.input.extend(inputs)
+        del fused_op.output[:]
+        fused_op.output.extend([output])
+        fused_op.arg.extend([
+            utils.MakeArgument("fusion_type", fusion_type)])
+        # The fused operator runs where the last one of the group did.
+        ops[fused[-1]] = fused_op
+        removed.update(fused[:-1])
+    del net.op[:]
+    net.op.extend([op for i, op in enumerate(ops) if i not in removed])
+
+
+def rewrite_run_net(net, mkl_inputs=(), mkl_operators=MKL_OPERATORS):
+    """Runs the maximal runs of operators with a native MKL implementation
+    on MKL, and the others on CPU. Blobs keep the MKL layout from one MKL
+    operator to the next, and are only copied between MKL and CPU where an
+    operator on one device reads a blob last written on the other one.
+
+    mkl_inputs: external inputs that already are MKL blobs, for example the
+    parameters filled by an init net rewritten with rewrite_init_net_simple.
+    External outputs are CPU tensors after the net ran."""
+    def tmp_name(name, device):
+        if device == caffe2_pb2.MKLDNN:
+            return "{}__MKL__".format(name)
+        return "{}__CPU__".format(name)
+
+    def copy_op(src, dst, device):
+        op = core.CreateOperator(
+            "CopyCPUToMKL" if device == caffe2_pb2.MKLDNN else
+            "CopyMKLToCPU", src, dst)
+        op.device_option.device_type = caffe2_pb2.MKLDNN
+        return op
+
+    fuse_conv_relu_sum(net)
+    external_outputs = set(net.external_output)
+    # For each blob, the names its current value is available under, by
+    # device.
+    location = {}
+    for b in net.external_input:
+        device = caffe2_pb2.MKLDNN if b in mkl_inputs else caffe2_pb2.CPU
+        location[b] = {device: b}
+
+    ops = []
+    for op in net.op:
+        device = caffe2_pb2.MKLDNN if _runs_on_mkl(op, mkl_operators) \
+            else caffe2_pb2.CPU
+        renamed = {}
+        for i, b in enumerate(op.input):
+            names = location.setdefault(b, {caffe2_pb2.CPU: b})
+            if device not in names:
+                (src_device, src), = names.items()
+                names[device] = tmp_name(b, device)
+                ops.append(copy_op(
+                    src, names[device],
+                    caffe2_pb2.MKLDNN if src_device == caffe2_pb2.CPU
+                    else caffe2_pb2.CPU))
+            renamed[b] = names[device]
+            op.input[i] = names[device]
+        for i, b in enumerate(op.output):
+            if b in renamed:
+                # In-place, the output stays where the input is.
+                name = renamed[b]
+            elif device == caffe2_pb2.MKLDNN and b in external_outputs:
+                name = tmp_name(b, device)
+            else:
+                name = b
+            op.output[i] = name
+            location[b] = {device: name}
+        op.device_option.device_type = device
+        ops.append(op)
+
+    for b in net.external_output:
+        names = location.get(b, {caffe2_pb2.CPU: b})
+        if names.get(caffe2_pb2.CPU) == b:
+            continue
+        if caffe2_pb2.CPU in names:
+            ops.append(core.CreateOperator("Copy", names[caffe2_pb2.CPU], b))
+        else:
+            ops.append(copy_op(
+                names[caffe2_pb2.MKLDNN], b, caffe2_pb2.CPU))
+    del net.op[:]
+    net.op.extend(ops)
+
+
+def rewrite_model_helper(model):
+    """Like rewrite_model_helper_simple, for nets mixing operators with and
+    without an MKL implementation."""
+    model = copy.deepcopy(model)
+    init_net = model.param_init_net.Proto()
+    rewrite_init_net_simple(init_net)
+    mkl_inputs = set(b for op in init_net.op for b in op.output)
+    rewrite_run_net(model.net.Proto(), mkl_inputs=mkl_inputs)
+    return model
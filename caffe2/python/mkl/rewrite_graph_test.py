@@ -101,6 +101,18 @@ def complex_resnet():
     return model, (1, 1, 224, 224)
 
 
+def conv_sum_relu():
+    model = ModelHelper(name="r", arg_scope={"order": "NCHW", "is_test": True})
+    brew.conv(model, "data", "conv1", 3, 8, kernel=3, pad=1)
+    brew.relu(model, "conv1", "conv1")
+    brew.conv(model, "conv1", "conv2", 8, 8, kernel=3, pad=1)
+    brew.sum(model, ["conv2", "conv1"], "sum")
+    brew.relu(model, "sum", "sum")
+    model.net.Softmax("sum", "softmax")
+    brew.fc(model, "softmax", "fc", 8 * 16 * 16, 10)
+    return model, (2, 3, 16, 16)
+
+
 @unittest.skipIf(not workspace.C.has_mkldnn,
                  "Skipping as we do not have mkldnn.")
 class MKLRewriteTest(hu.HypothesisTestCase):
@@ -136,6 +148,38 @@ class MKLRewriteTest(hu.HypothesisTestCase):
         np.testing.assert_allclose(run(cpu_model), run(mkl_model),
                                    atol=1e-4, rtol=1e-4)
 
+    @given(gen=st.sampled_from([simple_mlp, simple_cnn, simple_resnet,
+                                conv_sum_relu]))
+    def test_mkl_rewrite(self, gen):
+        cpu_model, shape = gen()
+        cpu_model = deterministic_io(cpu_model)
+        mkl_model = rewrite_graph.rewrite_model_helper(cpu_model)
+        X = np.random.randn(*shape).astype(np.float32)
+
+        def run(model):
+            self.ws.run(model.InitProto())
+            self.ws.create_blob(model.Proto().external_input[0]).feed(X)
+            self.ws.run(model.Proto())
+            return self.ws.blobs[model.Proto().external_output[0]].fetch()
+
+        np.testing.assert_allclose(run(cpu_model), run(mkl_model),
+                                   atol=1e-4, rtol=1e-4)
+
+    def test_mkl_rewrite_fuses_and_copies_at_edges(self):
+        cpu_model, _ = conv_sum_relu()
+        cpu_model = deterministic_io(cpu_model)
+        mkl_model = rewrite_graph.rewrite_model_helper(cpu_model)
+        ops = mkl_model.Proto().op
+        self.assertEqual(
+            [op.type for op in ops],
+            ["CopyCPUToMKL", "ConvFusion", "ConvFusion", "CopyMKLToCPU",
+             "Softmax", "CopyCPUToMKL", "FC", "CopyMKLToCPU"])
+        fusion_types = [
+            [arg.i for arg in op.arg if arg.name == "fusion_type"][0]
+            for op in ops if op.type == "ConvFusion"]
+        self.assertEqual(fusion_types, [rewrite_graph.CONV_FUSION_RELU,
+                                        rewrite_graph.CONV_FUSION_SUM_RELU])
+
 
 if __name__ == "__main__":
     import unittest
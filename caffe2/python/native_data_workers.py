@@ -0,0 +1,161 @@
+# Copyright (c) 2016-present, Facebook, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##############################################################################
+
+## @package native_data_workers
+# Module caffe2.python.native_data_workers
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+
+'''
+This module provides data input workers that run in C++, for inputs whose
+fetching is too hot for the Python threads of data_workers. The workers run
+either a C++ fetcher registered with REGISTER_DATA_FETCHER, or a fetch net,
+on threads of their own, and write the batches directly into a Caffe2 queue.
+Neither Python nor the GIL is involved per batch.
+
+Basic usage is as follows:
+   coordinator = native_data_workers.init_native_data_input_workers(
+      net,
+      ["data", "label"],
+      fetch_net=my_fetch_net,
+      num_worker_threads=8,
+      input_source_name="train",
+   )
+   ...
+   coordinator.start()
+
+The fetch net is run by each worker in a workspace of its own, which sees the
+blobs of the current workspace, e.g. a shared reader. Its external outputs,
+or the blobs given by 'fetch_outputs', make a batch, in the order of
+input_blob_names. If 'fetch_stop_blob' is given, the fetch net sets it to true
+once it ran out of data.
+
+The coordinator is the global coordinator of data_workers, so that the same
+start() and stop() handle both kinds of workers. The batches are taken as is,
+without rebatching, and are dequeued as CPU tensors.
+'''
+
+import logging
+
+from caffe2.python import core, workspace
+from caffe2.python.data_workers import global_coordinator
+from caffe2.python.parallel_workers import WorkerCoordinator
+
+log = logging.getLogger("native_data_workers")
+log.setLevel(logging.INFO)
+
+
+def init_native_data_input_workers(
+    net,
+    input_blob_names,
+    fetch_net=None,
+    fetcher=None,
+    num_worker_threads=2,
+    input_source_name="train",
+    max_buffered_batches=800,
+    init_fun=None,
+    timeout=600,
+    **fetcher_args
+):
+    assert (fetch_net is None) != (fetcher is None), \
+        "Exactly one of fetch_net and fetcher must be given."
+    queue = core.ScopedBlobReference(
+        "native_data_workers_queue_" + input_source_name)
+    workers = core.ScopedBlobReference(
+        "native_data_workers_" + input_source_name)
+    workspace.RunOperatorOnce(core.CreateOperator(
+        "CreateBlobsQueue", [], [queue],
+        num_blobs=len(input_blob_names),
+        capacity=max_buffered_batches,
+    ))
+    if fetch_net is not None:
+        fetcher_args["fetch_net"] = (
+            fetch_net.Proto() if isinstance(fetch_net, core.Net)
+            else fetch_net)
+    else:
+        fetcher_args["fetcher"] = fetcher
+    workspace.RunOperatorOnce(core.CreateOperator(
+        "CreateDataWorkers", [queue], [workers],
+        num_workers=num_worker_threads,
+        **fetcher_args
+    ))
+    net.DequeueBlobs(queue, input_blob_names, timeout_secs=float(timeout))
+
+    coordinator = NativeWorkerCoordinator(input_source_name, workers, init_fun)
+    global_coordinator.add(coordinator)
+    return global_coordinator
+
+
+class NativeWorkerCoordinator(WorkerCoordinator):
+    '''
+    Starts and stops data workers that run in C++, see CreateDataWorkers.
+    '''
+    def __init__(self, worker_name, workers, init_fun=None):
+        WorkerCoordinator.__init__(self, worker_name, init_fun)
+        self._workers_blob = workers
+        self._stopped = False
+
+    def is_active(self):
+        # The workers stop by themselves when they run out of data or fail.
+        return self._active and (
+            not self._started or self.stats()["num_active"] > 0)
+
+    def stats(self):
+        '''
+        Returns, per worker, the number of batches it wrote and the seconds it
+        spent fetching and waiting for the queue, and the number of workers
+        still running.
+        '''
+        stats_blob = str(self._workers_blob) + "_stats"
+        num_active_blob = str(self._workers_blob) + "_num_active"
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "DataWorkersStats", [self._workers_blob],
+            [stats_blob, num_active_blob],
+        ))
+        stats = workspace.FetchBlob(stats_blob)
+        return {
+            "batches": stats[:, 0].tolist(),
+            "fetch_secs": (stats[:, 1] / 1e6).tolist(),
+            "enqueue_secs": (stats[:, 2] / 1e6).tolist(),
+            "num_active": int(workspace.FetchBlob(num_active_blob)),
+        }
+
+    def _start(self):
+        if self._started or self._stopped:
+            return
+        self._active = True
+        self._started = True
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "StartDataWorkers", [self._workers_blob], []))
+
+    def _stop(self, reason=None):
+        self._active = False
+        if reason is not None:
+            log.error("Data input failed due to an error: {}".format(reason))
+        if self._started and not self._stopped:
+            # Also waits for the worker threads to exit.
+            workspace.RunOperatorOnce(core.CreateOperator(
+                "StopDataWorkers", [self._workers_blob], []))
+            self._stopped = True
+            stats = self.stats()
+            log.info("Native data workers {} wrote {} batches".format(
+                self._worker_name, sum(stats["batches"])))
+        self._started = False
+
+    def _wait_finish(self, cleanup=None):
+        return True
@@ -0,0 +1,68 @@
+# Copyright (c) 2016-present, Facebook, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##############################################################################
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+import numpy as np
+import unittest
+
+from caffe2.python import core, workspace, model_helper
+from caffe2.python import timeout_guard
+import caffe2.python.native_data_workers as native_data_workers
+
+
+class NativeDataWorkersTest(unittest.TestCase):
+
+    def testFetchNet(self):
+        workspace.ResetWorkspace()
+
+        fetch_net = core.Net("fetch")
+        fetch_net.ConstantFill([], "fetched_data", shape=[4, 3], value=1.0)
+        fetch_net.ConstantFill(
+            [], "fetched_label", shape=[4], value=2, dtype=core.DataType.INT32)
+        fetch_net.AddExternalOutput("fetched_data", "fetched_label")
+
+        model = model_helper.ModelHelper(name="test")
+        coordinator = native_data_workers.init_native_data_input_workers(
+            model,
+            ["data", "label"],
+            fetch_net=fetch_net,
+            num_worker_threads=3,
+            input_source_name="native_unittest",
+        )
+        coordinator.start()
+
+        workspace.CreateNet(model.net)
+        for _i in range(100):
+            with timeout_guard.CompleteInTimeOrDie(5):
+                workspace.RunNet(model.net.Proto().name)
+            np.testing.assert_array_equal(
+                workspace.FetchBlob("data"), np.ones((4, 3)))
+            np.testing.assert_array_equal(
+                workspace.FetchBlob("label"), [2, 2, 2, 2])
+
+        native_coordinator = [
+            c for c in coordinator._coordinators
+            if c._worker_name == "native_unittest"
+        ][0]
+        self.assertTrue(native_coordinator.is_active())
+        stats = native_coordinator.stats()
+        self.assertEqual(len(stats["batches"]), 3)
+        self.assertGreaterEqual(sum(stats["batches"]), 100)
+        self.assertTrue(coordinator.stop())
+        self.assertFalse(native_coordinator.is_active())
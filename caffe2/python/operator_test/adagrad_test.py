@@ -297,3 +297,109 @@ class TestAdagrad(hu.HypothesisTestCase):
             gc, op,
             [param, momentum, indices, grad, lr],
             ref_row_wise_sparse)
+
+    @given(inputs=hu.tensors(n=2),
+           lr=st.floats(min_value=0.01, max_value=0.99,
+                        allow_nan=False, allow_infinity=False),
+           epsilon=st.floats(min_value=0.01, max_value=0.99,
+                             allow_nan=False, allow_infinity=False),
+           data_strategy=st.data(),
+           **hu.gcs_cpu_only)
+    def test_sparse_adagrad_fused_with_sparse_lengths_sum_gradient(
+            self, inputs, lr, epsilon, data_strategy, gc, dc):
+        param, momentum = inputs
+        momentum = np.abs(momentum)
+        lr = np.array([lr], dtype=np.float32)
+
+        lengths = data_strategy.draw(
+            hu.tensor1d(max_len=5,
+                        elements=st.integers(min_value=0, max_value=3),
+                        dtype=np.int32))
+        indices = data_strategy.draw(
+            hu.tensor1d(min_len=int(np.sum(lengths)),
+                        max_len=int(np.sum(lengths)),
+                        elements=st.sampled_from(np.arange(param.shape[0])),
+                        dtype=np.int64))
+        # The pooled gradient has one row of the shape of a param row per
+        # segment.
+        grad = data_strategy.draw(
+            hu.arrays((lengths.size,) + param.shape[1:], dtype=np.float32))
+
+        op = core.CreateOperator(
+            "SparseAdagradFusedWithSparseLengthsSumGradient",
+            ["param", "momentum", "indices", "grad", "lr", "lengths"],
+            ["param", "momentum"],
+            epsilon=epsilon,
+            device_option=gc)
+
+        def ref_fused(param, momentum, indices, grad, lr, lengths):
+            # Same as SparseLengthsSumGradient followed by SparseAdagrad,
+            # with repeated indices updated one after the other.
+            param_out = np.copy(param)
+            momentum_out = np.copy(momentum)
+            segment_ids = np.repeat(np.arange(lengths.size), lengths)
+            for i, index in enumerate(indices):
+                param_out[index], momentum_out[index] = self.ref_adagrad(
+                    param_out[index],
+                    momentum_out[index],
+                    grad[segment_ids[i]],
+                    lr,
+                    epsilon)
+            return (param_out, momentum_out)
+
+        self.assertReferenceChecks(
+            gc, op,
+            [param, momentum, indices, grad, lr, lengths],
+            ref_fused)
+
+    @given(rowwise=st.booleans(),
+           stochastic_rounding=st.booleans(),
+           lr=st.floats(min_value=0.01, max_value=0.99,
+                        allow_nan=False, allow_infinity=False),
+           **hu.gcs_cpu_only)
+    def test_sparse_adagrad_8bits_rowwise(self, rowwise, stochastic_rounding,
+                                          lr, gc, dc):
+        epsilon = 1e-5
+        param = np.random.randn(6, 8).astype(np.float32)
+        workspace.FeedBlob("param_float", param)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "FloatToRowwiseQuantized8Bits",
+            ["param_float"], ["param", "scale_bias"]))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "Rowwise8BitQuantizedToFloat",
+            ["param", "scale_bias"], ["param_dequantized"]))
+        param_dq = workspace.FetchBlob("param_dequantized")
+        moment_shape = (6,) if rowwise else (6, 8)
+        moment = np.random.rand(*moment_shape).astype(np.float32)
+        indices = np.array([4, 1], dtype=np.int64)
+        grad = np.random.randn(2, 8).astype(np.float32)
+        workspace.FeedBlob("moment", moment)
+        workspace.FeedBlob("indices", indices)
+        workspace.FeedBlob("grad", grad)
+        workspace.FeedBlob("lr", np.array([lr], dtype=np.float32))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "SparseAdagrad8BitsRowwise",
+            ["param", "scale_bias", "moment", "indices", "grad", "lr"],
+            ["param", "scale_bias", "moment"],
+            epsilon=epsilon,
+            stochastic_rounding=stochastic_rounding,
+            device_option=gc))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "Rowwise8BitQuantizedToFloat",
+            ["param", "scale_bias"], ["param_out"]))
+        param_out = workspace.FetchBlob("param_out")
+        moment_out = workspace.FetchBlob("moment")
+
+        ref = self.ref_row_wise_adagrad if rowwise else self.ref_adagrad
+        expected_param = np.copy(param_dq)
+        expected_moment = np.copy(moment)
+        for i, index in enumerate(indices):
+            expected_param[index], expected_moment[index] = ref(
+                param_dq[index], moment[index], grad[i], lr, epsilon)
+        np.testing.assert_allclose(moment_out, expected_moment, rtol=1e-5)
+        # Requantization moves each value by at most one step, or half a step
+        # when rounding to nearest.
+        step = (expected_param.max(axis=1) - expected_param.min(axis=1)) / 255.
+        tolerance = step if stochastic_rounding else step / 2
+        self.assertTrue(np.all(
+            np.abs(param_out - expected_param) <= tolerance[:, None] + 1e-5))
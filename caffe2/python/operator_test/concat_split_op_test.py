@@ -141,6 +141,49 @@ class TestConcatSplitOps(hu.HypothesisTestCase):
         self.assertDeviceChecks(dc, op, input_tensors, outputs_with_grad)
         self.assertGradientChecks(gc, op, input_tensors, 0, outputs_with_grad)
 
+    @given(tensor_splits=_tensor_splits(),
+           zero_copy=st.booleans(),
+           **hu.gcs_cpu_only)
+    def test_split_zero_copy_multi_threaded(
+            self, tensor_splits, zero_copy, gc, dc):
+        axis, split_info, splits = tensor_splits
+        op = core.CreateOperator(
+            "Split",
+            ['input'],
+            ['X_{}'.format(i) for i in range(len(split_info))],
+            axis=axis,
+            split=split_info,
+            zero_copy=zero_copy,
+            num_threads=4,
+        )
+        self.assertReferenceChecks(
+            gc, op, [np.concatenate(splits, axis=axis)],
+            lambda input: splits)
+
+    def test_concat_multi_threaded(self):
+        # Large enough for several threads and non-temporal stores.
+        splits = [np.random.rand(512, 100 + i).astype(np.float32)
+                  for i in range(200)]
+        for axis in [0, 1]:
+            if axis == 0:
+                inputs = [a.T[:, :100] for a in splits]
+                inputs = [np.ascontiguousarray(a) for a in inputs]
+            else:
+                inputs = splits
+            op = core.CreateOperator(
+                "Concat",
+                ['X_{}'.format(i) for i in range(len(inputs))],
+                ['concat_result', 'split_info'],
+                axis=axis,
+                num_threads=4,
+            )
+            self.assertReferenceChecks(
+                hu.cpu_do, op, inputs, lambda *inputs: (
+                    np.concatenate(inputs, axis=axis),
+                    np.array([a.shape[axis] for a in inputs])
+                )
+            )
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -61,7 +61,7 @@ class TestConvolution(hu.HypothesisTestCase):
            batch_size=st.integers(1, 3),
            order=st.sampled_from(["NCHW", "NHWC"]),
            engine=st.sampled_from(["", "EIGEN"]),
-           shared_buffer=st.booleans(),
+           shared_buffer=st.sampled_from([0, 1, 2]),
            use_bias=st.booleans(),
            **hu.gcs)
     def test_convolution_separate_stride_pad_gradients(self, op_type,
@@ -514,6 +514,49 @@ class TestConvolution(hu.HypothesisTestCase):
                 1763719461732352.0,
                 rtol=1e-5)
 
+    @given(engine=st.sampled_from(["WINOGRAD", "DIRECT"]),
+           order=st.sampled_from(["NCHW", "NHWC"]),
+           size=st.integers(1, 10),
+           input_channels=st.integers(1, 8),
+           output_channels=st.integers(1, 8),
+           batch_size=st.integers(1, 3),
+           use_bias=st.booleans(),
+           **hu.gcs_cpu_only)
+    def test_cpu_engines_match_default(self, engine, order, size,
+                                       input_channels, output_channels,
+                                       batch_size, use_bias, gc, dc):
+        kernel = 3 if engine == "WINOGRAD" else 1
+        X = np.random.rand(
+            batch_size, size, size, input_channels).astype(np.float32) - 0.5
+        w = np.random.rand(
+            output_channels, kernel, kernel, input_channels).astype(
+                np.float32) - 0.5
+        b = np.random.rand(output_channels).astype(np.float32) - 0.5
+        if order == "NCHW":
+            X = X.transpose((0, 3, 1, 2))
+            w = w.transpose((0, 3, 1, 2))
+        inputs = ["X", "w", "b"] if use_bias else ["X", "w"]
+
+        outputs = {}
+        for e in ["", engine]:
+            op = core.CreateOperator(
+                "Conv",
+                inputs,
+                ["Y"],
+                kernel=kernel,
+                pad=kernel // 2,
+                order=order,
+                engine=e,
+                device_option=gc,
+            )
+            self.ws.create_blob("X").feed(X, device_option=gc)
+            self.ws.create_blob("w").feed(w, device_option=gc)
+            self.ws.create_blob("b").feed(b, device_option=gc)
+            self.ws.run(op)
+            outputs[e] = self.ws.blobs["Y"].fetch()
+        np.testing.assert_allclose(
+            outputs[""], outputs[engine], atol=1e-4, rtol=1e-4)
+
     def test_use_cudnn_engine_interactions(self):
         """Make sure the use_cudnn and engine kwargs work as expected."""
         for model_default in [None, True, False]:
@@ -125,11 +125,12 @@ class TestConvolution(hu.HypothesisTestCase):
            engine=st.sampled_from(["", "CUDNN", "MKLDNN"]),
            use_bias=st.booleans(),
            deformable_group=st.integers(1, 3),
+           tile_size=st.sampled_from([0, 1, 7]),
            **hu.gcs_gpu_only)
     def test_null_offset_convolution(self, stride, pad, kernel, dilation, size,
                                      input_channels, output_channels, batch_size,
                                      order, engine, use_bias, deformable_group,
-                                     gc, dc):
+                                     tile_size, gc, dc):
         dkernel = dilation * (kernel - 1) + 1
 
         if gc.device_type == caffe2_pb2.CUDA and engine == 'CUDNN':
@@ -149,6 +150,7 @@ class TestConvolution(hu.HypothesisTestCase):
             order=order,
             engine=engine,
             deformable_group=deformable_group,
+            tile_size=tile_size,
         )
         offset_dims = _conv_2d_offsets_dims(batch_size, size, kernel, pad, pad,
                                             dilation, stride, stride,
@@ -19,7 +19,7 @@ from __future__ import print_function
 from __future__ import unicode_literals
 
 from caffe2.proto import caffe2_pb2
-from caffe2.python import core
+from caffe2.python import core, workspace
 from hypothesis import assume, given, settings
 import caffe2.python.hypothesis_test_util as hu
 import hypothesis.strategies as st
@@ -93,6 +93,30 @@ class TestFcOperator(hu.HypothesisTestCase):
         self.assertGradientChecks(gc, op, [X, W, b], 2, [0],
                                   threshold=threshold, stepsize=stepsize)
 
+    @given(m=st.integers(1, 33),
+           k=st.integers(1, 40),
+           n=st.integers(1, 40),
+           **hu.gcs_cpu_only)
+    def test_prepacked_fc(self, m, k, n, gc, dc):
+        net = core.Net("prepacked_fc")
+        net.FC(["X", "W", "b"], "Y", engine="PREPACK")
+        b = np.random.rand(n).astype(np.float32) - 0.5
+        workspace.FeedBlob("b", b)
+        workspace.FeedBlob("W", np.random.rand(n, k).astype(np.float32))
+        workspace.CreateNet(net, overwrite=True)
+        # Every run after the first reuses the packed weights unless W has
+        # been written to, as it is here by FeedBlob.
+        for _ in range(3):
+            X = np.random.rand(m, k).astype(np.float32) - 0.5
+            W = np.random.rand(n, k).astype(np.float32) - 0.5
+            workspace.FeedBlob("X", X)
+            workspace.FeedBlob("W", W)
+            for _ in range(2):
+                workspace.RunNet(net)
+                np.testing.assert_allclose(
+                    workspace.FetchBlob("Y"), X.dot(W.T) + b,
+                    rtol=1e-4, atol=1e-4)
+
 
 if __name__ == "__main__":
     import unittest
@@ -0,0 +1,139 @@
+# Copyright (c) 2016-present, Facebook, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##############################################################################
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core
+from hypothesis import given
+import caffe2.python.hypothesis_test_util as hu
+import hypothesis.strategies as st
+import numpy as np
+
+
+def sigmoid(x):
+    return 1. / (1. + np.exp(-x))
+
+
+def fused_lstm_reference(drop_states, forget_bias):
+    def reference(input, hidden_init, cell_init, i2h_w, i2h_b, gates_w,
+                  gates_b, seq_lengths):
+        D = hidden_init.shape[2]
+        h = hidden_init[0]
+        c = cell_init[0]
+        hidden_all = []
+        for t in range(input.shape[0]):
+            gates = (input[t].dot(i2h_w.T) + i2h_b +
+                     h.dot(gates_w.T) + gates_b)
+            i = sigmoid(gates[:, :D])
+            f = sigmoid(gates[:, D:2 * D] + forget_bias)
+            o = sigmoid(gates[:, 2 * D:3 * D])
+            g = np.tanh(gates[:, 3 * D:])
+            c_t = f * c + i * g
+            h_t = o * np.tanh(c_t)
+            valid = (t < seq_lengths).reshape(-1, 1)
+            carry = 0 if drop_states else 1
+            h = np.where(valid, h_t, carry * h)
+            c = np.where(valid, c_t, carry * c)
+            hidden_all.append(h)
+        return [np.array(hidden_all), h[np.newaxis], c[np.newaxis]]
+    return reference
+
+
+def fused_gru_reference(drop_states):
+    def reference(input, hidden_init, i2h_w, i2h_b, gates_w, gates_b,
+                  output_w, output_b, seq_lengths):
+        D = hidden_init.shape[2]
+        h = hidden_init[0]
+        hidden_all = []
+        for t in range(input.shape[0]):
+            x = input[t].dot(i2h_w.T) + i2h_b
+            gates = x[:, :2 * D] + h.dot(gates_w.T) + gates_b
+            r = sigmoid(gates[:, :D])
+            u = sigmoid(gates[:, D:])
+            o = np.tanh(
+                x[:, 2 * D:] + (r * h).dot(output_w.T) + output_b)
+            h_t = h * u + o * (1 - u)
+            valid = (t < seq_lengths).reshape(-1, 1)
+            h = np.where(valid, h_t, h if not drop_states else 0)
+            hidden_all.append(h)
+        return [np.array(hidden_all), h[np.newaxis]]
+    return reference
+
+
+class TestFusedRNNOps(hu.HypothesisTestCase):
+
+    @given(T=st.integers(1, 8), N=st.integers(1, 4), I=st.integers(1, 8),
+           D=st.integers(1, 8), drop_states=st.booleans(),
+           forget_bias=st.floats(0, 1), **hu.gcs_cpu_only)
+    def test_fused_lstm(self, T, N, I, D, drop_states, forget_bias, gc, dc):
+        def rand(*shape):
+            return np.random.randn(*shape).astype(np.float32)
+
+        inputs = [
+            rand(T, N, I), rand(1, N, D), rand(1, N, D),
+            rand(4 * D, I), rand(4 * D), rand(4 * D, D), rand(4 * D),
+            np.random.randint(0, T + 1, size=N).astype(np.int32),
+        ]
+        op = core.CreateOperator(
+            'FusedLSTM',
+            ['input', 'hidden_init', 'cell_init', 'i2h_w', 'i2h_b',
+             'gates_w', 'gates_b', 'seq_lengths'],
+            ['hidden_all', 'hidden_last', 'cell_last'],
+            drop_states=drop_states,
+            forget_bias=forget_bias,
+        )
+        self.assertReferenceChecks(
+            device_option=gc,
+            op=op,
+            inputs=inputs,
+            reference=fused_lstm_reference(drop_states, forget_bias),
+            threshold=1e-4,
+        )
+
+    @given(T=st.integers(1, 8), N=st.integers(1, 4), I=st.integers(1, 8),
+           D=st.integers(1, 8), drop_states=st.booleans(),
+           **hu.gcs_cpu_only)
+    def test_fused_gru(self, T, N, I, D, drop_states, gc, dc):
+        def rand(*shape):
+            return np.random.randn(*shape).astype(np.float32)
+
+        inputs = [
+            rand(T, N, I), rand(1, N, D),
+            rand(3 * D, I), rand(3 * D), rand(2 * D, D), rand(2 * D),
+            rand(D, D), rand(D),
+            np.random.randint(0, T + 1, size=N).astype(np.int32),
+        ]
+        op = core.CreateOperator(
+            'FusedGRU',
+            ['input', 'hidden_init', 'i2h_w', 'i2h_b', 'gates_w', 'gates_b',
+             'output_w', 'output_b', 'seq_lengths'],
+            ['hidden_all', 'hidden_last'],
+            drop_states=drop_states,
+        )
+        self.assertReferenceChecks(
+            device_option=gc,
+            op=op,
+            inputs=inputs,
+            reference=fused_gru_reference(drop_states),
+            threshold=1e-4,
+        )
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
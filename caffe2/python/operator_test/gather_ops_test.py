@@ -19,7 +19,7 @@ from __future__ import print_function
 from __future__ import unicode_literals
 import numpy as np
 
-from caffe2.python import core
+from caffe2.python import core, workspace
 from hypothesis import given
 import caffe2.python.hypothesis_test_util as hu
 import hypothesis.strategies as st
@@ -86,6 +86,33 @@ class TestBatchGatherOps(hu.HypothesisTestCase):
         self.assertReferenceChecks(gc, op, [data, ind], ref_batch_gather)
         self.assertGradientChecks(gc, op, [data, ind], 0, [0])
 
+    @given(index_num=st.integers(1, 3000),
+           block_size=st.integers(1, 40),
+           seed=st.integers(0, 1000),
+           **hu.gcs)
+    def test_batch_gather_spans(self, index_num, block_size, seed, gc, dc):
+        # Runs of consecutive indices, which are copied at once on CPU, and
+        # rows of all alignments for the vectorized copies on GPU.
+        np.random.seed(seed)
+        data = np.random.random((3, 500, block_size)).astype(np.float32)
+        starts = np.random.randint(500, size=(index_num, ))
+        ind = np.minimum(
+            starts + np.arange(index_num) % 7, 499).astype(np.int64)
+        op = core.CreateOperator(
+            'BatchGather', ['data', 'ind'], ['output'], num_threads=4)
+
+        def ref_batch_gather(data, ind):
+            return [data[:, ind]]
+
+        self.assertReferenceChecks(gc, op, [data, ind], ref_batch_gather)
+
+    def test_batch_gather_out_of_bounds(self):
+        workspace.FeedBlob('data', np.zeros((2, 3, 4), dtype=np.float32))
+        workspace.FeedBlob('ind', np.array([0, 3], dtype=np.int32))
+        op = core.CreateOperator('BatchGather', ['data', 'ind'], ['output'])
+        with self.assertRaises(RuntimeError):
+            workspace.RunOperatorOnce(op)
+
 
 if __name__ == "__main__":
     import unittest
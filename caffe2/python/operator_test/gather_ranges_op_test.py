@@ -18,7 +18,7 @@ from __future__ import division
 from __future__ import print_function
 from __future__ import unicode_literals
 
-from caffe2.python import core
+from caffe2.python import core, workspace
 from hypothesis import given
 from hypothesis import strategies as st
 
@@ -144,6 +144,54 @@ class TestGatherRanges(hu.HypothesisTestCase):
             reference=gather_ranges_to_dense
         )
 
+    @given(batch_size=st.integers(1, 2000),
+           num_ranges=st.integers(1, 5),
+           seed=st.integers(0, 1000))
+    def test_gather_ranges_on_threads(self, batch_size, num_ranges, seed):
+        # Most ranges follow each other in DATA, for the copies of spans of
+        # ranges, and some are empty.
+        np.random.seed(seed)
+        lengths = np.random.randint(0, 20, size=(batch_size, num_ranges))
+        lengths[np.random.random(lengths.shape) < 0.2] = 0
+        starts = np.cumsum(lengths).reshape(lengths.shape) - lengths
+        jumps = np.random.random(lengths.shape) < 0.1
+        starts[jumps] = np.random.randint(0, 100, size=np.sum(jumps))
+        ranges = np.stack([starts, lengths], axis=2).astype(np.int64)
+        data = np.random.random(
+            (np.sum(lengths) + 100, )).astype(np.float32)
+        output, output_lengths = gather_ranges(data, ranges)
+
+        op = core.CreateOperator(
+            "GatherRanges", ["data", "ranges"], ["output", "lengths"],
+            num_threads=4)
+        workspace.FeedBlob("data", data)
+        workspace.FeedBlob("ranges", ranges)
+        workspace.RunOperatorOnce(op)
+        np.testing.assert_array_equal(workspace.FetchBlob("output"), output)
+        np.testing.assert_array_equal(
+            workspace.FetchBlob("lengths"), output_lengths)
+
+        dense_lengths = np.full(num_ranges, 20)
+        dense_ranges = ranges.copy()
+        dense_ranges[:, :, 1] = np.where(ranges[:, :, 1] > 0, 20, 0)
+        dense_data = np.random.random(
+            (np.max(dense_ranges[:, :, 0]) + 20, )).astype(np.float32)
+        op = core.CreateOperator(
+            "GatherRangesToDense",
+            ["data", "ranges"],
+            ["X_{}".format(i) for i in range(num_ranges)],
+            lengths=dense_lengths,
+            num_threads=4)
+        workspace.FeedBlob("data", dense_data)
+        workspace.FeedBlob("ranges", dense_ranges)
+        workspace.RunOperatorOnce(op)
+        expected = gather_ranges_to_dense(
+            dense_data, dense_ranges, dense_lengths)
+        for i in range(num_ranges):
+            np.testing.assert_array_equal(
+                workspace.FetchBlob("X_{}".format(i)), expected[i])
+
+
 if __name__ == "__main__":
     import unittest
     unittest.main()
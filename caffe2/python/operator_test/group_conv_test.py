@@ -81,6 +81,55 @@ class TestGroupConvolution(hu.HypothesisTestCase):
         for i in range(len(inputs)):
             self.assertGradientChecks(gc, op, inputs, i, [0])
 
+    @given(stride=st.integers(1, 2),
+           pad=st.integers(0, 2),
+           kernel=st.sampled_from([3, 5]),
+           size=st.integers(5, 20),
+           channels=st.integers(2, 8),
+           multiplier=st.integers(1, 2),
+           batch_size=st.integers(1, 3),
+           use_bias=st.booleans(),
+           **hu.gcs)
+    @settings(max_examples=10, timeout=100)
+    def test_depthwise_convolution(
+            self, stride, pad, kernel, size, channels, multiplier,
+            batch_size, use_bias, gc, dc):
+        op = core.CreateOperator(
+            "Conv",
+            ["X", "w", "b"] if use_bias else ["X", "w"],
+            ["Y"],
+            stride=stride,
+            kernel=kernel,
+            pad=pad,
+            group=channels,
+        )
+        X = np.random.rand(
+            batch_size, channels, size, size).astype(np.float32) - 0.5
+        w = np.random.rand(
+            channels * multiplier, 1, kernel, kernel).astype(np.float32) - 0.5
+        b = np.random.rand(channels * multiplier).astype(np.float32) - 0.5
+        inputs = [X, w, b] if use_bias else [X, w]
+
+        def ref(X, w, b=None):
+            Xp = np.pad(X, ((0, 0), (0, 0), (pad, pad), (pad, pad)), "constant")
+            out_size = (size + 2 * pad - kernel) // stride + 1
+            Y = np.zeros(
+                (batch_size, channels * multiplier, out_size, out_size),
+                dtype=np.float32)
+            for m in range(channels * multiplier):
+                for kh in range(kernel):
+                    for kw in range(kernel):
+                        window = Xp[:, m // multiplier,
+                                    kh:kh + stride * out_size:stride,
+                                    kw:kw + stride * out_size:stride]
+                        Y[:, m] += w[m, 0, kh, kw] * window
+                if b is not None:
+                    Y[:, m] += b[m]
+            return Y,
+
+        self.assertReferenceChecks(gc, op, inputs, ref)
+        self.assertDeviceChecks(dc, op, inputs, [0])
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -139,6 +139,33 @@ class TestHsm(hu.HypothesisTestCase):
                     self.assertAlmostEqual(
                         scores[i][j], p_scores[i][j], delta=0.001)
 
+    def test_hsm_search_num_threads(self):
+        samples = 37
+        dim_in = 5
+        X = np.random.rand(samples, dim_in).astype(np.float32) - 0.5
+        w = np.random.rand(hierarchy_proto.size, dim_in) \
+            .astype(np.float32) - 0.5
+        b = np.random.rand(hierarchy_proto.size).astype(np.float32) - 0.5
+
+        workspace.GlobalInit(['caffe2'])
+        workspace.FeedBlob("data", X)
+        workspace.FeedBlob("weights", w)
+        workspace.FeedBlob("bias", b)
+        outputs = []
+        for num_threads in [1, 4]:
+            op = core.CreateOperator(
+                'HSoftmaxSearch',
+                ['data', 'weights', 'bias'],
+                ['names', 'scores'],
+                'HSoftmaxSearch',
+                arg=args_search,
+                num_threads=num_threads)
+            workspace.RunOperatorOnce(op)
+            outputs.append((workspace.FetchBlob('names'),
+                            workspace.FetchBlob('scores')))
+        np.testing.assert_array_equal(outputs[0][0], outputs[1][0])
+        np.testing.assert_array_equal(outputs[0][1], outputs[1][1])
+
     def test_hsm_run_once(self):
         workspace.GlobalInit(['caffe2'])
         workspace.FeedBlob("data",
@@ -0,0 +1,152 @@
+# Copyright (c) 2016-present, Facebook, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##############################################################################
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core, int8_calibration, model_helper, workspace
+import caffe2.python.hypothesis_test_util as hu
+
+from hypothesis import given
+import hypothesis.strategies as st
+import numpy as np
+import unittest
+
+
+def _assert_close_to_fp32(output, reference):
+    # Both operands are rounded to 8 bits, which loses about 1% of the
+    # largest output.
+    np.testing.assert_allclose(
+        output, reference, atol=0.03 * np.abs(reference).max() + 1e-4)
+
+
+class TestInt8Ops(hu.HypothesisTestCase):
+    @given(n=st.integers(1, 40), calibrated=st.booleans(), **hu.gcs_cpu_only)
+    def test_quantize_dequantize(self, n, calibrated, gc, dc):
+        X = (np.random.rand(n) * 4 - 1).astype(np.float32)
+        kwargs = dict(in_min=-1., in_max=3.) if calibrated else {}
+        workspace.FeedBlob("X", X)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "Int8Quantize", ["X"], ["Q", "scale", "zero_point"], **kwargs))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "Int8Dequantize", ["Q", "scale", "zero_point"], ["Y"]))
+        Q = workspace.FetchBlob("Q")
+        scale = workspace.FetchBlob("scale")[0]
+        self.assertEqual(Q.dtype, np.uint8)
+        np.testing.assert_allclose(
+            workspace.FetchBlob("Y"), X, atol=scale / 2 + 1e-6)
+
+    @given(M=st.integers(1, 8),
+           K=st.integers(1, 70),
+           N=st.integers(1, 9),
+           **hu.gcs_cpu_only)
+    def test_fc(self, M, K, N, gc, dc):
+        X = np.random.randn(M, K).astype(np.float32)
+        W = np.random.randn(N, K).astype(np.float32)
+        b = np.random.randn(N).astype(np.float32)
+        for name, value in zip(["X", "W", "b"], [X, W, b]):
+            workspace.FeedBlob(name, value)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "FC", ["X", "W", "b"], ["Y"], engine="INT8"))
+        _assert_close_to_fp32(workspace.FetchBlob("Y"), X.dot(W.T) + b)
+
+    @given(M=st.sampled_from([1, 64]), **hu.gcs_cpu_only)
+    def test_fc_num_threads(self, M, gc, dc):
+        # Large enough to be split between the threads, over the rows of W
+        # for a single example and over the rows of X otherwise.
+        X = np.random.randn(M, 256).astype(np.float32)
+        W = np.random.randn(512, 256).astype(np.float32)
+        b = np.random.randn(512).astype(np.float32)
+        for name, value in zip(["X", "W", "b"], [X, W, b]):
+            workspace.FeedBlob(name, value)
+        outputs = []
+        for num_threads in [1, 4]:
+            workspace.RunOperatorOnce(core.CreateOperator(
+                "FC", ["X", "W", "b"], ["Y"], engine="INT8",
+                num_threads=num_threads))
+            outputs.append(workspace.FetchBlob("Y"))
+        # The integer products are exact, however they are split.
+        np.testing.assert_array_equal(outputs[0], outputs[1])
+        _assert_close_to_fp32(outputs[1], X.dot(W.T) + b)
+
+    @given(stride=st.integers(1, 2),
+           pad=st.integers(0, 1),
+           kernel=st.integers(1, 3),
+           size=st.integers(3, 7),
+           input_channels=st.integers(1, 5),
+           output_channels=st.integers(1, 5),
+           order=st.sampled_from(["NCHW", "NHWC"]),
+           use_bias=st.booleans(),
+           **hu.gcs_cpu_only)
+    def test_conv(self, stride, pad, kernel, size, input_channels,
+                  output_channels, order, use_bias, gc, dc):
+        X = np.random.randn(
+            2, size, size, input_channels).astype(np.float32)
+        w = np.random.randn(
+            output_channels, kernel, kernel, input_channels).astype(np.float32)
+        b = np.random.randn(output_channels).astype(np.float32)
+        if order == "NCHW":
+            X = X.transpose((0, 3, 1, 2))
+            w = w.transpose((0, 3, 1, 2))
+        inputs = ["X", "w", "b"] if use_bias else ["X", "w"]
+        for name, value in zip(inputs, [X, w, b]):
+            workspace.FeedBlob(name, value)
+        outputs = {}
+        for engine in ["", "INT8"]:
+            workspace.RunOperatorOnce(core.CreateOperator(
+                "Conv", inputs, ["Y"], stride=stride, kernel=kernel, pad=pad,
+                order=order, engine=engine))
+            outputs[engine] = workspace.FetchBlob("Y")
+        _assert_close_to_fp32(outputs["INT8"], outputs[""])
+
+    def test_calibration(self):
+        workspace.ResetWorkspace()
+        model = model_helper.ModelHelper(name="int8_calibration")
+        model.net.FC(["X", "W1", "b1"], "hidden")
+        model.net.Relu("hidden", "hidden_relu")
+        model.net.FC(["hidden_relu", "W2", "b2"], "Y")
+        workspace.FeedBlob("W1", np.random.randn(6, 4).astype(np.float32))
+        workspace.FeedBlob("b1", np.random.randn(6).astype(np.float32))
+        workspace.FeedBlob("W2", np.random.randn(3, 6).astype(np.float32))
+        workspace.FeedBlob("b2", np.random.randn(3).astype(np.float32))
+        batches = [np.random.randn(5, 4).astype(np.float32) for _ in range(3)]
+
+        def feed(i):
+            workspace.FeedBlob("X", batches[i])
+
+        ranges = int8_calibration.collect_activation_ranges(
+            model.net, num_iter=3, feed_fn=feed)
+        all_inputs = np.concatenate(batches)
+        self.assertAlmostEqual(ranges["X"][0], all_inputs.min(), places=5)
+        self.assertAlmostEqual(ranges["X"][1], all_inputs.max(), places=5)
+        self.assertLess(ranges["hidden"][0], 0)
+        self.assertGreaterEqual(ranges["hidden_relu"][0], 0)
+        self.assertEqual(
+            int8_calibration.set_activation_ranges(model.net, ranges), 2)
+        self.assertEqual(model.net.NumObservers(), 0)
+
+        fp32_output = workspace.FetchBlob("Y")
+        for op in model.net.Proto().op:
+            if op.type == "FC":
+                op.engine = "INT8"
+        workspace.CreateNet(model.net, overwrite=True)
+        workspace.RunNet(model.net)
+        _assert_close_to_fp32(workspace.FetchBlob("Y"), fp32_output)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,89 @@
+# Copyright (c) 2016-present, Facebook, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##############################################################################
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core
+import caffe2.python.hypothesis_test_util as hu
+
+from hypothesis import given
+import hypothesis.strategies as st
+import numpy as np
+import unittest
+
+
+
+
+class TestLossScale(hu.HypothesisTestCase):
+    @given(n=st.integers(1, 8), overflow=st.booleans(), **hu.gcs)
+    def test_check_finite_and_unscale(self, n, overflow, gc, dc):
+        loss_scale = np.array(256., dtype=np.float32)
+        grad1 = np.random.rand(n).astype(np.float32)
+        grad2 = np.random.rand(n, 2).astype(np.float32)
+        if overflow:
+            grad2[0, 1] = np.inf
+
+        def unscale(loss_scale, grad1, grad2):
+            if overflow:
+                return [np.zeros_like(grad1), np.zeros_like(grad2),
+                        np.array([1.], dtype=np.float32)]
+            return [grad1 / loss_scale, grad2 / loss_scale,
+                    np.array([0.], dtype=np.float32)]
+
+        op = core.CreateOperator(
+            "CheckFiniteAndUnscale",
+            ["loss_scale", "grad1", "grad2"],
+            ["grad1", "grad2", "found_inf"],
+        )
+        self.assertReferenceChecks(
+            device_option=gc,
+            op=op,
+            inputs=[loss_scale, grad1, grad2],
+            reference=unscale
+        )
+
+    @given(good_steps=st.integers(0, 3), found_inf=st.booleans(), **hu.gcs)
+    def test_update_loss_scale(self, good_steps, found_inf, gc, dc):
+        loss_scale = np.array([8.], dtype=np.float32)
+        steps = np.array([good_steps], dtype=np.int32)
+        found = np.array([float(found_inf)], dtype=np.float32)
+        interval = 3
+
+        def update(loss_scale, steps, found):
+            if found[0]:
+                return [loss_scale * 0.5, np.zeros_like(steps)]
+            if steps[0] + 1 >= interval:
+                return [loss_scale * 2, np.zeros_like(steps)]
+            return [loss_scale, steps + 1]
+
+        op = core.CreateOperator(
+            "UpdateLossScale",
+            ["loss_scale", "good_steps", "found_inf"],
+            ["loss_scale", "good_steps"],
+            growth_interval=interval,
+        )
+        self.assertReferenceChecks(
+            device_option=gc,
+            op=op,
+            inputs=[loss_scale, steps, found],
+            reference=update
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -17,7 +17,7 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 from __future__ import unicode_literals
-from caffe2.python import core
+from caffe2.python import core, workspace
 from caffe2.proto import caffe2_pb2
 from hypothesis import given
 import caffe2.python.hypothesis_test_util as hu
@@ -70,6 +70,32 @@ class TestOneHotOps(hu.HypothesisTestCase):
         op = core.CreateOperator('BatchOneHot', ["X", "LENS", "VALS"], ["Y"])
         self.assertReferenceChecks(gc, op, [x, lens, vals], ref)
 
+    @given(n=st.integers(1, 3000), seed=st.integers(0, 1000))
+    def test_batch_one_hot_on_threads(self, n, seed):
+        # Columns with dense and with sparse values, repeated values, and
+        # values that are not in the dictionary.
+        np.random.seed(seed)
+        vals = [
+            np.random.randint(-5, 5, size=8),
+            np.random.randint(-2 ** 40, 2 ** 40, size=100),
+            np.array([3, 7, 3]),
+        ]
+        x = np.stack([
+            np.random.choice(np.append(v, [11, -11]), size=n) for v in vals
+        ], axis=1).astype(np.int64)
+        lens = np.array([len(v) for v in vals], dtype=np.int32)
+        vals = np.concatenate(vals).astype(np.int64)
+        expected = (x[:, np.repeat(np.arange(len(lens)), lens)] ==
+                    vals[np.newaxis, :]).astype(np.int64)
+
+        op = core.CreateOperator(
+            'BatchOneHot', ["X", "LENS", "VALS"], ["Y"], num_threads=4)
+        workspace.FeedBlob("X", x)
+        workspace.FeedBlob("LENS", lens)
+        workspace.FeedBlob("VALS", vals)
+        workspace.RunOperatorOnce(op)
+        np.testing.assert_array_equal(workspace.FetchBlob("Y"), expected)
+
     @given(
         x=hu.tensor(
             min_dim=2, max_dim=2, dtype=np.float32,
@@ -191,6 +191,32 @@ class TestPartitionOps(TestCase):
                     expected, workspace.FetchBlob(name)
                 )
 
+    def testMultiThreaded(self):
+        # Large enough to be cut into several chunks, the result has to be
+        # the same as the single threaded one.
+        size = 50000
+        parts = 64
+        ids = np.random.randint(-10 ** 6, 10 ** 6, size).astype(np.int64)
+        weights = rand_array(size, 3)
+        lengths = np.full(size // 10, 10, dtype=np.int32)
+        workspace.FeedBlob('ids', ids)
+        workspace.FeedBlob('weights', weights)
+        workspace.FeedBlob('lengths', lengths)
+        for op_type, ins in [('Partition', ['ids', 'weights']),
+                             ('LengthsPartition',
+                              ['lengths', 'ids', 'weights'])]:
+            results = []
+            for num_threads in [1, 4]:
+                outs = [
+                    '{}_{}_p{}_t{}'.format(op_type, name, i, num_threads)
+                    for i in range(parts) for name in ins
+                ]
+                workspace.RunOperatorOnce(core.CreateOperator(
+                    op_type, ins, outs, num_threads=num_threads))
+                results.append([workspace.FetchBlob(o) for o in outs])
+            for single, multi in zip(*results):
+                np.testing.assert_array_equal(single, multi)
+
 if __name__ == "__main__":
     import unittest
     unittest.main()
@@ -46,6 +46,27 @@ class RecurrentNetworkTest(hu.HypothesisTestCase):
         self.simple_rnn(T, n, d, model, step, input_t, output_t, output_t_prev,
                         input_blob, initial_input_blob)
 
+    @given(T=st.integers(1, 8),
+           n=st.integers(1, 5),
+           d=st.integers(1, 5),
+           checkpoint_interval=st.integers(2, 4))
+    def test_sum_mul_checkpoint(self, T, n, d, checkpoint_interval):
+        model = ModelHelper(name='external')
+
+        input_blob, initial_input_blob = model.net.AddExternalInputs(
+            'input', 'initial_input')
+
+        step = ModelHelper(name='step', param_model=model)
+        input_t, output_t_prev = step.net.AddExternalInput(
+            'input_t', 'output_t_prev')
+        output_t_internal = step.net.Sum([input_t, output_t_prev])
+        output_t = step.net.Mul([input_t, output_t_internal])
+        step.net.AddExternalOutput(output_t)
+
+        self.simple_rnn(T, n, d, model, step, input_t, output_t, output_t_prev,
+                        input_blob, initial_input_blob,
+                        checkpoint_interval=checkpoint_interval)
+
     @given(T=st.integers(1, 4),
            n=st.integers(1, 5),
            d=st.integers(1, 5))
@@ -117,7 +138,7 @@ class RecurrentNetworkTest(hu.HypothesisTestCase):
             )
 
     def simple_rnn(self, T, n, d, model, step, input_t, output_t, output_t_prev,
-                   input_blob, initial_input_blob):
+                   input_blob, initial_input_blob, checkpoint_interval=None):
 
         input = np.random.randn(T, n, d).astype(np.float32)
         initial_input = np.random.randn(1, n, d).astype(np.float32)
@@ -129,6 +150,7 @@ class RecurrentNetworkTest(hu.HypothesisTestCase):
             initial_cell_inputs=[(output_t_prev, initial_input_blob)],
             links={output_t_prev: output_t},
             scope="test_rnn_sum_mull",
+            checkpoint_interval=checkpoint_interval,
         )
         workspace.blobs[input_blob] = input
         workspace.blobs[initial_input_blob] = initial_input
@@ -117,6 +117,54 @@ class TestResize(hu.HypothesisTestCase):
         self.assertDeviceChecks(dc, op, [dY, X], [0])
         self.assertReferenceChecks(gc, op, [dY, X], ref)
 
+    @given(height_scale=st.floats(0.25, 4.0) | st.just(2.0),
+           width_scale=st.floats(0.25, 4.0) | st.just(2.0),
+           height=st.integers(4, 32),
+           width=st.integers(4, 32),
+           num_channels=st.integers(1, 4),
+           batch_size=st.integers(1, 4),
+           seed=st.integers(0, 65535),
+           **hu.gcs)
+    def test_bilinear(self, height_scale, width_scale, height, width,
+                      num_channels, batch_size, seed, gc, dc):
+
+        np.random.seed(seed)
+        op = core.CreateOperator(
+            "ResizeBilinear",
+            ["X"],
+            ["Y"],
+            width_scale=width_scale,
+            height_scale=height_scale,
+        )
+
+        X = np.random.rand(
+            batch_size, num_channels, height, width).astype(np.float32)
+
+        def taps(input_size, output_size, scale):
+            src = np.maximum(
+                (np.arange(output_size) + 0.5) / np.float32(scale) - 0.5, 0)
+            lo = np.minimum(src.astype(np.int32), input_size - 1)
+            hi = np.minimum(lo + 1, input_size - 1)
+            weight = np.where(lo == hi, 0, src - lo).astype(np.float32)
+            return lo, hi, weight
+
+        def ref(X):
+            output_height = np.int32(height * height_scale)
+            output_width = np.int32(width * width_scale)
+            y_lo, y_hi, ly = taps(height, output_height, height_scale)
+            x_lo, x_hi, lx = taps(width, output_width, width_scale)
+            ly = ly[:, np.newaxis]
+            top = X[:, :, y_lo, :]
+            bottom = X[:, :, y_hi, :]
+            top = top[..., x_lo] * (1 - lx) + top[..., x_hi] * lx
+            bottom = bottom[..., x_lo] * (1 - lx) + bottom[..., x_hi] * lx
+            return (top * (1 - ly) + bottom * ly).astype(np.float32),
+
+        self.assertReferenceChecks(gc, op, [X], ref)
+        self.assertDeviceChecks(dc, op, [X], [0])
+        self.assertGradientChecks(
+            gc, op, [X], 0, [0], stepsize=0.01, threshold=1e-2)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -18,7 +18,7 @@ from __future__ import division
 from __future__ import print_function
 from __future__ import unicode_literals
 
-from caffe2.python import core
+from caffe2.python import core, workspace
 from hypothesis import given
 import caffe2.python.hypothesis_test_util as hu
 import hypothesis.strategies as st
@@ -118,6 +118,50 @@ class TestFcOperator(hu.HypothesisTestCase):
         self.assertGradientChecks(
             gc, op, [indices, values, default, lengths], 1, [0])
 
+    @given(n=st.integers(1, 2000), return_presence_mask=st.booleans())
+    def test_sparse_to_dense_mask_on_threads(self, n, return_presence_mask):
+        # Ids below and above the range of the direct table.
+        mask = np.array([7, 0, 3, 2 ** 40, 2 ** 17 + 1, 2 ** 33, 5])
+        np.random.shuffle(mask)
+        lengths = np.random.randint(0, 10, size=n).astype(np.int32)
+        N = sum(lengths)
+        indices = np.random.choice(
+            np.append(mask, [1, 2 ** 35, 2 ** 17]), size=N).astype(np.int64)
+        values = np.random.rand(N, 3).astype(np.float32)
+        default = np.random.rand(3).astype(np.float32)
+
+        expected = np.tile(default, (n, len(mask), 1))
+        expected_presence_mask = np.zeros((n, len(mask)), dtype=bool)
+        column = {id: i for i, id in enumerate(mask)}
+        offset = 0
+        for r, length in enumerate(lengths):
+            for i in range(offset, offset + length):
+                if indices[i] in column:
+                    expected[r, column[indices[i]]] = values[i]
+                    expected_presence_mask[r, column[indices[i]]] = True
+            offset += length
+
+        outputs = ['output']
+        if return_presence_mask:
+            outputs.append('presence_mask')
+        op = core.CreateOperator(
+            'SparseToDenseMask',
+            ['indices', 'values', 'default', 'lengths'],
+            outputs,
+            mask=mask,
+            return_presence_mask=return_presence_mask,
+            num_threads=4,
+        )
+        workspace.FeedBlob('indices', indices)
+        workspace.FeedBlob('values', values)
+        workspace.FeedBlob('default', default)
+        workspace.FeedBlob('lengths', lengths)
+        workspace.RunOperatorOnce(op)
+        np.testing.assert_array_equal(workspace.FetchBlob('output'), expected)
+        if return_presence_mask:
+            np.testing.assert_array_equal(
+                workspace.FetchBlob('presence_mask'), expected_presence_mask)
+
 
 if __name__ == "__main__":
     import unittest
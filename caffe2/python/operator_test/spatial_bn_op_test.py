@@ -262,5 +262,46 @@ class TestSpatialBN(hu.HypothesisTestCase):
             self.assertGradientChecks(gc, op, [X, scale, bias, mean, var],
                                       input_to_check, [0], stepsize=0.01)
 
+    @given(order=st.sampled_from(["NCHW", "NHWC"]),
+           seed=st.integers(0, 65535))
+    def test_spatialbn_num_threads(self, order, seed):
+        np.random.seed(seed)
+        input_channels = 8
+        scale = np.random.rand(input_channels).astype(np.float32) + 0.5
+        bias = np.random.rand(input_channels).astype(np.float32) - 0.5
+        X = np.random.rand(
+            16, input_channels, 24, 24).astype(np.float32) - 0.5
+        dY = np.random.rand(*X.shape).astype(np.float32) - 0.5
+        if order == "NHWC":
+            X = X.swapaxes(1, 2).swapaxes(2, 3)
+            dY = dY.swapaxes(1, 2).swapaxes(2, 3)
+        workspace.FeedBlob("X", X)
+        workspace.FeedBlob("scale", scale)
+        workspace.FeedBlob("bias", bias)
+        workspace.FeedBlob("dY", dY)
+        outputs = []
+        for num_threads in [1, 4]:
+            workspace.FeedBlob("mean", np.zeros(input_channels, np.float32))
+            workspace.FeedBlob("var", np.ones(input_channels, np.float32))
+            workspace.RunOperatorOnce(core.CreateOperator(
+                "SpatialBN",
+                ["X", "scale", "bias", "mean", "var"],
+                ["Y", "mean", "var", "saved_mean", "saved_var"],
+                order=order,
+                is_test=False,
+                num_threads=num_threads,
+            ))
+            workspace.RunOperatorOnce(core.CreateOperator(
+                "SpatialBNGradient",
+                ["X", "scale", "dY", "saved_mean", "saved_var"],
+                ["dX", "dscale", "dbias"],
+                order=order,
+                num_threads=num_threads,
+            ))
+            outputs.append([workspace.FetchBlob(name) for name in [
+                "Y", "mean", "var", "dX", "dscale", "dbias"]])
+        for single, multi in zip(*outputs):
+            np.testing.assert_allclose(single, multi, rtol=1e-4, atol=1e-4)
+
 if __name__ == "__main__":
     unittest.main()
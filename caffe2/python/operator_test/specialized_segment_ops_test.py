@@ -139,6 +139,80 @@ class TestSpecializedSegmentOps(hu.HypothesisTestCase):
         np.testing.assert_allclose(self.ws.blobs[("out")].fetch(),
                                    sparse_lengths_weightedsum_ref(Tbl, Weights, Indices, Lengths), rtol=1e-3, atol=atol)
 
+    @given(batchsize=st.integers(100, 300),
+           num_threads=st.integers(2, 8),
+           blocksize=st.sampled_from([8, 17, 64]),
+           op_type=st.sampled_from(["SparseLengthsSum",
+                                    "SparseLengthsWeightedSum",
+                                    "SparseLengthsMean"]),
+           **hu.gcs_cpu_only)
+    def test_sparse_lengths_reduction_multithreaded_cpu(
+            self, batchsize, num_threads, blocksize, op_type, gc, dc):
+
+        print("<test_sparse_lengths_reduction_multithreaded_cpu>")
+
+        tblsize = 300
+        Tbl = np.random.rand(tblsize, blocksize).astype(np.float32)
+        # some empty segments to exercise the chunk boundaries
+        Lengths = np.random.randint(0, 30, size=batchsize).astype(np.int32)
+        Indices = np.random.randint(
+            0, tblsize, size=sum(Lengths)).astype(np.int64)
+        Weights = np.random.rand(sum(Lengths)).astype(np.float32)
+
+        if op_type == "SparseLengthsWeightedSum":
+            inputs = ["Tbl", "Weights", "Indices", "Lengths"]
+        else:
+            inputs = ["Tbl", "Indices", "Lengths"]
+        self.ws.create_blob("Tbl").feed(Tbl)
+        self.ws.create_blob("Weights").feed(Weights)
+        self.ws.create_blob("Indices").feed(Indices)
+        self.ws.create_blob("Lengths").feed(Lengths)
+        self.ws.run(core.CreateOperator(op_type, inputs, "out_serial"))
+        self.ws.run(core.CreateOperator(
+            op_type, inputs, "out_parallel", num_threads=num_threads))
+
+        np.testing.assert_allclose(self.ws.blobs[("out_parallel")].fetch(),
+                                   self.ws.blobs[("out_serial")].fetch(),
+                                   rtol=1e-5, atol=1e-5)
+
+    @given(batchsize=st.integers(1, 50),
+           blocksizes=st.lists(st.sampled_from([1, 8, 17, 32, 64]),
+                               min_size=1, max_size=5),
+           num_threads=st.integers(1, 4),
+           **hu.gcs_cpu_only)
+    def test_multi_table_sparse_lengths_sum_cpu(
+            self, batchsize, blocksizes, num_threads, gc, dc):
+
+        print("<test_multi_table_sparse_lengths_sum_cpu>")
+
+        tblsize = 300
+        inputs = []
+        for t, blocksize in enumerate(blocksizes):
+            Tbl = np.random.rand(tblsize, blocksize).astype(np.float32)
+            if t % 2 == 1:
+                Tbl = Tbl.astype(np.float16)
+            Lengths = np.random.randint(0, 30, size=batchsize).astype(np.int32)
+            Indices = np.random.randint(
+                0, tblsize, size=sum(Lengths)).astype(
+                    np.int32 if t % 3 == 0 else np.int64)
+            names = ["Tbl_%d" % t, "Indices_%d" % t, "Lengths_%d" % t]
+            for name, value in zip(names, [Tbl, Indices, Lengths]):
+                self.ws.create_blob(name).feed(value)
+            self.ws.run(core.CreateOperator(
+                "SparseLengthsSum", names, "out_%d" % t))
+            inputs += names
+
+        self.ws.run(core.CreateOperator(
+            "MultiTableSparseLengthsSum", inputs, "out",
+            num_threads=num_threads))
+
+        expected = np.concatenate(
+            [self.ws.blobs["out_%d" % t].fetch()
+             for t in range(len(blocksizes))], axis=1)
+        np.testing.assert_allclose(self.ws.blobs["out"].fetch(), expected,
+                                   rtol=1e-5, atol=1e-5)
+
+
 
     @given(batchsize=st.integers(1, 20),
            blocksize=st.sampled_from([8, 16, 17, 26, 32, 64, 85, 96, 128, 148, 163]),
@@ -64,3 +64,18 @@ class TestCounterOps(TestCase):
         self.assertEqual(len(t3), len(k3))
         for key in keys:
             self.assertIn(key, k3)
+
+    def test_workspace_memory_export(self):
+        workspace.FeedBlob('x', np.zeros((10, 4), dtype=np.float32))
+        workspace.FeedBlob('y', np.zeros(3, dtype=np.int64))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'StatRegistryCreate', [], ['reg']))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'WorkspaceMemoryExport', ['reg'], [], prefix='mem', top_k=1))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'StatRegistryExport', ['reg'], ['k', 'v', 't']))
+        stats = dict(zip(workspace.FetchBlob('k'), workspace.FetchBlob('v')))
+        self.assertEqual(stats[b'mem/blob/x/used_bytes'], 160)
+        self.assertNotIn(b'mem/blob/y/used_bytes', stats)
+        self.assertEqual(stats[b'mem/cpu/num_blobs'], 3)
+        self.assertGreaterEqual(stats[b'mem/cpu/used_bytes'], 184)
@@ -0,0 +1,64 @@
+# Copyright (c) 2016-present, Facebook, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##############################################################################
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+from caffe2.python import core
+from hypothesis import given
+import caffe2.python.hypothesis_test_util as hu
+import hypothesis.strategies as st
+import numpy as np
+
+import unittest
+
+
+class TestUniqueAndSumOp(hu.HypothesisTestCase):
+    @given(
+        n=st.integers(0, 100),
+        num_rows=st.integers(1, 20),
+        block_size=st.integers(1, 10),
+        dtype=st.sampled_from([np.int32, np.int64]),
+        **hu.gcs_cpu_only
+    )
+    def test_unique_and_sum(self, n, num_rows, block_size, dtype, gc, dc):
+        indices = np.random.randint(0, num_rows, size=n).astype(dtype)
+        values = np.random.rand(n, block_size).astype(np.float32)
+
+        op = core.CreateOperator(
+            "UniqueAndSum",
+            ["indices", "values"],
+            ["unique", "sums", "remapping"],
+        )
+
+        def ref(indices, values):
+            unique = []
+            remapping = []
+            for index in indices:
+                if index not in unique:
+                    unique.append(index)
+                remapping.append(unique.index(index))
+            sums = np.zeros((len(unique), block_size), dtype=np.float32)
+            for i, pos in enumerate(remapping):
+                sums[pos] += values[i]
+            return (np.array(unique, dtype=dtype), sums,
+                    np.array(remapping, dtype=dtype))
+
+        self.assertReferenceChecks(gc, op, [indices, values], ref)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -32,17 +32,24 @@ from caffe2.proto import caffe2_pb2
 
 _OPTIMIZER_ITERATION_NAME = "optimizer_iteration"
 _LEARNING_RATE_INJECTION = "lr_injection"
+_DIRTY_ROWS_SUFFIX = "_dirty_rows"
 
 AuxOptimizerParams = namedtuple("AuxOptimizerParams", ["local", "shared"])
 _optimizer_instance_count = defaultdict(int)
 
 
+def get_dirty_rows_blob_name(param):
+    """Returns the name of the blob marking the changed rows of param."""
+    return str(param) + _DIRTY_ROWS_SUFFIX
+
+
 class Optimizer(object):
     def __init__(self):
         self._aux_params = AuxOptimizerParams(local=[], shared=[])
         self._instance_num = _optimizer_instance_count[self.__class__.__name__]
         _optimizer_instance_count[self.__class__.__name__] += 1
         self._lr_multiplier = None
+        self._track_dirty_rows = False
 
     '''
     Adds optimization operators to the net for given parameter and its gradient
@@ -63,6 +70,9 @@ class Optimizer(object):
                 param_id=None, param=param, grad=grad)
 
         self._run(net, param_init_net, param)
+        if self._track_dirty_rows and \
+                isinstance(param.grad, core.GradientSlice):
+            self._mark_dirty_rows(net, param_init_net, param)
 
     def _run(self, net, param_init_net, param_info):
         raise Exception("Not Implemented")
@@ -146,6 +156,27 @@ class Optimizer(object):
     def add_lr_multiplier(self, lr_multiplier):
         self._lr_multiplier = lr_multiplier
 
+    def track_dirty_rows(self):
+        """
+        Makes the sparse updates of this optimizer mark the rows they touch,
+        in a boolean blob named by get_dirty_rows_blob_name(param). The
+        checkpoint managers use it to save only the changed rows of large
+        embeddings. Only supported for parameters on CPU.
+        """
+        self._track_dirty_rows = True
+
+    def _mark_dirty_rows(self, net, param_init_net, param_info):
+        current_scope = scope.CurrentDeviceScope()
+        assert current_scope is None or \
+            current_scope.device_type == caffe2_pb2.CPU, \
+            "Dirty rows can only be tracked for parameters on CPU"
+        dirty = get_dirty_rows_blob_name(param_info.blob)
+        if not param_init_net.BlobIsDefined(dirty):
+            param_init_net.ConstantFill(
+                [], dirty, shape=[0], value=False, dtype=core.DataType.BOOL)
+        net.MarkDirtyRows(
+            [dirty, param_info.grad.indices, param_info.blob], dirty)
+
     @staticmethod
     def dedup(net, sparse_dedup_aggregator, grad):
         assert (isinstance(grad, core.GradientSlice))
@@ -411,6 +442,80 @@ class FP16SgdOptimizer(SgdOptimizer):
                 weight_decay=self.weight_decay)
 
 
+class DynamicLossScaler(object):
+    """Dynamic loss scaling for training with float16 activations and
+    gradients.
+
+    The loss is multiplied by a loss scale before the backward pass so that
+    small gradients do not flush to zero in float16. Before the optimizer
+    runs, the gradients are divided by the scale again. If any of them
+    overflowed, they are all zeroed and the scale is reduced. After
+    growth_interval iterations without overflow the scale is increased.
+
+    Call scale_loss() on the loss and unscale_gradients() between
+    AddGradientOperators() and building the optimizer, once per device when
+    using data_parallel_model. The scale lives on the device of the
+    gradients, so no host synchronization is needed.
+    """
+
+    def __init__(self, init_scale=2.0 ** 15, growth_factor=2.0,
+                 backoff_factor=0.5, growth_interval=2000,
+                 min_loss_scale=1.0, max_loss_scale=2.0 ** 24):
+        self.init_scale = init_scale
+        self.update_kwargs = dict(
+            growth_factor=growth_factor,
+            backoff_factor=backoff_factor,
+            growth_interval=growth_interval,
+            min_loss_scale=min_loss_scale,
+            max_loss_scale=max_loss_scale)
+        # Per name scope, i.e. per device with data_parallel_model.
+        self._loss_scales = {}
+        self._good_steps = {}
+
+    def loss_scale(self):
+        return self._loss_scales[scope.CurrentNameScope()]
+
+    def scale_loss(self, model, loss):
+        name_scope = scope.CurrentNameScope()
+        assert name_scope not in self._loss_scales, \
+            "Loss already scaled in name scope " + name_scope
+        loss_scale = model.param_init_net.ConstantFill(
+            [], "loss_scale", shape=[], value=self.init_scale)
+        good_steps = model.param_init_net.ConstantFill(
+            [], "loss_scale_good_steps", shape=[1], value=0,
+            dtype=core.DataType.INT32)
+        self._loss_scales[name_scope] = loss_scale
+        self._good_steps[name_scope] = good_steps
+        scale = model.net.StopGradient(loss_scale, str(loss_scale) + "_sg")
+        return model.net.Mul([loss, scale], str(loss) + "_scaled")
+
+    def unscale_gradients(self, model, params=None):
+        """Unscales the dense gradients of params, by default of all the
+        parameters of the model in the current name scope, and updates the
+        loss scale. Returns the blob that is 1 when the iteration overflowed.
+        """
+        name_scope = scope.CurrentNameScope()
+        if params is None:
+            params = [p for p in model.GetParams(name_scope)
+                      if p in model.param_to_grad]
+        grads = []
+        for param in params:
+            grad = model.param_to_grad[param]
+            assert not isinstance(grad, core.GradientSlice), \
+                "Loss scaling does not support sparse gradients"
+            grads.append(grad)
+        loss_scale = self.loss_scale()
+        good_steps = self._good_steps[name_scope]
+        outputs = model.net.CheckFiniteAndUnscale(
+            [loss_scale] + grads, grads + ["loss_scale_found_inf"])
+        found_inf = outputs[-1]
+        model.net.UpdateLossScale(
+            [loss_scale, good_steps, found_inf],
+            [loss_scale, good_steps],
+            **self.update_kwargs)
+        return found_inf
+
+
 class WeightDecayBuilder(Optimizer):
     def __init__(self, weight_decay):
         self.weight_decay = weight_decay
@@ -20,12 +20,18 @@
 #include <pybind11/stl.h>
 
 #include "caffe2/core/asan.h"
+#include "caffe2/core/backward_pass.h"
 #include "caffe2/core/db.h"
+#include "caffe2/core/memory_profiler.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/predictor.h"
 #include "caffe2/core/transform.h"
 #include "caffe2/mkl/mkl_utils.h"
+#include "caffe2/observers/activation_range_observer.h"
+#include "caffe2/observers/cpu_time_observer.h"
+#include "caffe2/observers/latency_histogram_observer.h"
 #include "caffe2/observers/time_observer.h"
+#include "caffe2/observers/tracing_observer.h"
 #include "caffe2/utils/cpuid.h"
 #include "caffe2/utils/string_utils.h"
 #include "google/protobuf/io/coded_stream.h"
@@ -114,6 +120,55 @@ const TypeMeta& NumpyTypeToCaffe(int numpy_type) {
   return it == caffe_type_map.end() ? unknown_type : it->second;
 }
 
+void KeepTensorStorageAlive(PyArrayObject* array, std::shared_ptr<void> data) {
+  auto* holder = new std::shared_ptr<void>(std::move(data));
+  PyObject* capsule = PyCapsule_New(holder, nullptr, [](PyObject* o) {
+    delete static_cast<std::shared_ptr<void>*>(
+        PyCapsule_GetPointer(o, nullptr));
+  });
+  if (!capsule) {
+    delete holder;
+    throw py::error_already_set();
+  }
+  // Steals the reference to the capsule.
+  if (PyArray_SetBaseObject(array, capsule) != 0) {
+    throw py::error_already_set();
+  }
+}
+
+bool CanFeedZeroCopy(PyArrayObject* array) {
+  const int flags = NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED |
+      NPY_ARRAY_WRITEABLE;
+  if (!PyArray_CHKFLAGS(array, flags)) {
+    return false;
+  }
+  const auto& meta = NumpyTypeToCaffe(PyArray_TYPE(array));
+  return meta.id() != 0 && !meta.ctor() && meta.itemsize() ==
+      static_cast<size_t>(PyArray_ITEMSIZE(array));
+}
+
+void FeedTensorZeroCopy(PyArrayObject* array, TensorCPU* tensor) {
+  CAFFE_ENFORCE(CanFeedZeroCopy(array), "The array can't be fed zero-copy.");
+  std::vector<TIndex> dims;
+  const int ndim = PyArray_NDIM(array);
+  for (int i = 0; i < ndim; ++i) {
+    dims.push_back(PyArray_DIMS(array)[i]);
+  }
+  tensor->Resize(dims);
+  Py_INCREF(array);
+  tensor->ShareExternalPointer(
+      PyArray_DATA(array),
+      NumpyTypeToCaffe(PyArray_TYPE(array)),
+      PyArray_NBYTES(array),
+      [array](void*) {
+        // The tensor may outlive the interpreter, e.g. in a global workspace.
+        if (Py_IsInitialized()) {
+          py::gil_scoped_acquire g;
+          Py_DECREF(array);
+        }
+      });
+}
+
 template <typename Registry>
 std::function<const char*(const string&)> DefinitionGetter(
     const Registry* registry) {
@@ -386,11 +441,44 @@ void addObjectMethods(py::module& m) {
                 cast_ob, "Observer does not implement this function.");
             return cast_ob->average_time();
           })
-      .def("average_time_children", [](ObserverBase<NetBase>* ob) {
-        auto* cast_ob = dynamic_cast_if_rtti<TimeObserver<NetBase>*>(ob);
+      .def(
+          "average_time_children",
+          [](ObserverBase<NetBase>* ob) {
+            auto* cast_ob = dynamic_cast_if_rtti<TimeObserver<NetBase>*>(ob);
+            CAFFE_ENFORCE(
+                cast_ob, "Observer does not implement this function.");
+            return cast_ob->average_time_children();
+          })
+      .def("activation_ranges", [](ObserverBase<NetBase>* ob) {
+        auto* cast_ob = dynamic_cast_if_rtti<ActivationRangeObserver*>(ob);
         CAFFE_ENFORCE(cast_ob, "Observer does not implement this function.");
-        return cast_ob->average_time_children();
-      });
+        return cast_ob->ranges();
+      })
+      .def(
+          "latency_percentile",
+          [](ObserverBase<NetBase>* ob, const std::string& op_type, double p) {
+            auto* cast_ob =
+                dynamic_cast_if_rtti<LatencyHistogramObserver*>(ob);
+            CAFFE_ENFORCE(
+                cast_ob, "Observer does not implement this function.");
+            return cast_ob->percentile(op_type, p);
+          })
+      .def(
+          "trace_json",
+          [](ObserverBase<NetBase>* ob) {
+            auto* cast_ob = dynamic_cast_if_rtti<TracingObserver*>(ob);
+            CAFFE_ENFORCE(
+                cast_ob, "Observer does not implement this function.");
+            return cast_ob->TraceJson();
+          })
+      .def(
+          "dump_trace",
+          [](ObserverBase<NetBase>* ob, const std::string& path) {
+            auto* cast_ob = dynamic_cast_if_rtti<TracingObserver*>(ob);
+            CAFFE_ENFORCE(
+                cast_ob, "Observer does not implement this function.");
+            cast_ob->DumpTrace(path);
+          });
 
   py::class_<Blob>(m, "Blob")
       .def(
@@ -532,7 +620,11 @@ void addObjectMethods(py::module& m) {
             caffe2::NetDef proto;
             CAFFE_ENFORCE(
                 ParseProtobufFromLargeString(def.cast<std::string>(), &proto));
-            NetBase* net = self->CreateNet(proto, overwrite);
+            NetBase* net;
+            {
+              py::gil_scoped_release g;
+              net = self->CreateNet(proto, overwrite);
+            }
             CAFFE_ENFORCE(net);
             return py::cast(net);
           },
@@ -618,6 +710,33 @@ void addObjectMethods(py::module& m) {
       },
       pybind11::return_value_policy::copy);
 
+  m.def("has_gradient", [](const std::string& op_type) {
+    return caffe2::GradientRegistry()->Has(op_type);
+  });
+
+  m.def(
+      "get_backward_pass",
+      [](py::bytes net_def,
+         std::vector<std::pair<std::string, GradientWrapper>> ys,
+         py::object device_option) {
+        NetDef net;
+        CAFFE_ENFORCE(
+            ParseProtobufFromLargeString(net_def.cast<std::string>(), &net));
+        std::unique_ptr<DeviceOption> option;
+        if (!device_option.is_none()) {
+          option.reset(new DeviceOption());
+          CAFFE_ENFORCE(ParseProtobufFromLargeString(
+              device_option.cast<std::string>(), option.get()));
+        }
+        const auto backward_pass = GetBackwardPass(net, ys, option.get());
+        std::vector<py::bytes> grad_ops;
+        for (const auto& op : backward_pass.gradient_ops) {
+          grad_ops.push_back(op.SerializeAsString());
+        }
+        return std::make_pair(grad_ops, backward_pass.input_to_grad);
+      },
+      pybind11::return_value_policy::copy);
+
   // DB
   py::class_<db::Transaction>(m, "Transaction")
       .def("put", &db::Transaction::Put)
@@ -714,7 +833,10 @@ void addObjectMethods(py::module& m) {
               tensors.push_back(&(tensors_data[i]));
             }
             std::vector<TensorCPU*> out;
-            instance.run(tensors, &out);
+            {
+              py::gil_scoped_release g;
+              instance.run(tensors, &out);
+            }
             std::vector<py::object> pyout;
             for (auto t : out) {
               pyout.push_back(
@@ -741,7 +863,10 @@ void addObjectMethods(py::module& m) {
               tensors.insert(std::make_pair(name, &tensors_data[name]));
             }
             std::vector<TensorCPU*> out;
-            instance.run_map(tensors, &out);
+            {
+              py::gil_scoped_release g;
+              instance.run_map(tensors, &out);
+            }
             std::vector<py::object> pyout;
             for (auto t : out) {
               pyout.push_back(
@@ -892,6 +1017,34 @@ void addGlobalMethods(py::module& m) {
     CAFFE_ENFORCE(gWorkspace);
     return gWorkspace->HasBlob(name);
   });
+  m.def("memory_report", []() {
+    CAFFE_ENFORCE(gWorkspace);
+    const auto report = gWorkspace->MemoryReport();
+    py::list blobs;
+    for (const auto& info : report.blobs) {
+      py::dict blob;
+      blob["name"] = info.name;
+      blob["type"] = info.type;
+      blob["device"] = info.device;
+      blob["used_bytes"] = info.used_bytes;
+      blob["capacity_bytes"] = info.capacity_bytes;
+      blob["shares_data"] = info.shares_data;
+      blobs.append(blob);
+    }
+    py::dict devices;
+    for (const auto& device : report.devices) {
+      py::dict totals;
+      totals["used_bytes"] = device.second.used_bytes;
+      totals["capacity_bytes"] = device.second.capacity_bytes;
+      totals["exclusive_bytes"] = device.second.exclusive_bytes;
+      totals["num_blobs"] = device.second.num_blobs;
+      devices[py::str(device.first)] = totals;
+    }
+    py::dict result;
+    result["blobs"] = blobs;
+    result["devices"] = devices;
+    return result;
+  });
   m.def(
       "create_net",
       [](py::bytes net_def, bool overwrite) {
@@ -901,8 +1054,15 @@ void addGlobalMethods(py::module& m) {
             ParseProtobufFromLargeString(net_def.cast<std::string>(), &proto),
             "Can't parse net proto: ",
             net_def.cast<std::string>());
+        bool created;
+        {
+          // Operators that need Python, e.g. PythonOp, acquire the GIL
+          // themselves.
+          py::gil_scoped_release g;
+          created = gWorkspace->CreateNet(proto, overwrite) != nullptr;
+        }
         CAFFE_ENFORCE(
-            gWorkspace->CreateNet(proto, overwrite),
+            created,
             "Error creating net with proto: ",
             net_def.cast<std::string>());
         return true;
@@ -948,6 +1108,20 @@ void addGlobalMethods(py::module& m) {
         REGISTER_PYTHON_EXPOSED_OBSERVER(TimeObserver);
 
 #undef REGISTER_PYTHON_EXPOSED_OBSERVER
+        if (observer_type == "ActivationRangeObserver") {
+          observer = net->AttachObserver(
+              make_unique<ActivationRangeObserver>(net));
+        }
+        if (observer_type == "CpuTimeObserver") {
+          observer = net->AttachObserver(make_unique<CpuTimeObserver>(net));
+        }
+        if (observer_type == "LatencyHistogramObserver") {
+          observer = net->AttachObserver(
+              make_unique<LatencyHistogramObserver>(net));
+        }
+        if (observer_type == "TracingObserver") {
+          observer = net->AttachObserver(make_unique<TracingObserver>(net));
+        }
         CAFFE_ENFORCE(observer != nullptr);
         return py::cast(observer);
       });
@@ -1017,7 +1191,7 @@ void addGlobalMethods(py::module& m) {
           shapes.emplace_back(GetTensorShapeOfBlob(blob));
         }
         const auto c = schema->InferCost(def, shapes);
-        return std::make_tuple(c.flops, c.bytes_moved);
+        return std::make_tuple(c.flops, c.bytes_read, c.bytes_written);
       });
   m.def("run_net_once", [](const py::bytes& net_def) {
     CAFFE_ENFORCE(gWorkspace);
@@ -1037,6 +1211,13 @@ void addGlobalMethods(py::module& m) {
     CAFFE_ENFORCE(gWorkspace->RunPlan(def));
     return true;
   });
+  m.def("memory_profile_report", [](int max_rows) {
+    return MemoryProfiler::Get().ReportString(max_rows);
+  });
+  m.def("memory_profile_timeline", []() {
+    return MemoryProfiler::Get().TimelineCSV();
+  });
+  m.def("reset_memory_profile", []() { MemoryProfiler::Get().Reset(); });
   m.def(
       "apply_transform",
       [](const string& transform_key, const py::bytes& net_def) {
@@ -1166,12 +1347,30 @@ void addGlobalMethods(py::module& m) {
     CAFFE_ENFORCE(gWorkspace->CreateBlob(name));
     return true;
   });
-  m.def("fetch_blob", [](const std::string& name) -> py::object {
-    return python_detail::fetchBlob(gWorkspace, name);
-  });
+  m.def(
+      "fetch_blob",
+      [](const std::string& name, bool zero_copy) -> py::object {
+        if (zero_copy) {
+          CAFFE_ENFORCE(gWorkspace->HasBlob(name), "Can't find blob: ", name);
+          const auto& blob = *gWorkspace->GetBlob(name);
+          if (blob.IsType<TensorCPU>()) {
+            // Falls back to a copy for types numpy can't view, e.g. strings.
+            return TensorFetcher<CPUContext>()
+                .FetchTensor(blob.Get<TensorCPU>(), false)
+                .obj;
+          }
+        }
+        return python_detail::fetchBlob(gWorkspace, name);
+      },
+      "",
+      py::arg("name"),
+      py::arg("zero_copy") = false);
   m.def(
       "feed_blob",
-      [](const std::string& name, py::object arg, py::object device_option) {
+      [](const std::string& name,
+         py::object arg,
+         py::object device_option,
+         bool zero_copy) {
         DeviceOption option;
         if (!device_option.is(py::none())) {
           // If we have a device option passed in, read it.
@@ -1181,6 +1380,11 @@ void addGlobalMethods(py::module& m) {
         auto* blob = gWorkspace->CreateBlob(name);
         if (PyArray_Check(arg.ptr())) { // numpy array
           PyArrayObject* array = reinterpret_cast<PyArrayObject*>(arg.ptr());
+          if (zero_copy && option.device_type() == CPU &&
+              CanFeedZeroCopy(array)) {
+            FeedTensorZeroCopy(array, blob->GetMutable<TensorCPU>());
+            return true;
+          }
           auto feeder = CreateFeeder(option.device_type());
           CAFFE_ENFORCE(feeder, "Unknown device type encountered in FeedBlob.");
           feeder->Feed(option, array, blob);
@@ -1198,19 +1402,27 @@ void addGlobalMethods(py::module& m) {
       "",
       py::arg("name"),
       py::arg("arg"),
-      py::arg("device_option") = py::none());
+      py::arg("device_option") = py::none(),
+      py::arg("zero_copy") = false);
   m.def("serialize_blob", [](const std::string& name) {
     CAFFE_ENFORCE(gWorkspace);
     auto* blob = gWorkspace->GetBlob(name);
     CAFFE_ENFORCE(blob);
-    return py::bytes(blob->Serialize(name));
+    std::string serialized;
+    {
+      py::gil_scoped_release g;
+      serialized = blob->Serialize(name);
+    }
+    return py::bytes(serialized);
   });
   m.def(
       "deserialize_blob",
       [](const std::string& name, const py::bytes& serialized) {
         CAFFE_ENFORCE(gWorkspace);
         auto* blob = gWorkspace->CreateBlob(name);
-        blob->Deserialize(serialized.cast<std::string>());
+        auto str = serialized.cast<std::string>();
+        py::gil_scoped_release g;
+        blob->Deserialize(str);
       });
 
   // we support 2 possible signatures of python op: (inputs, outputs) or
@@ -94,6 +94,21 @@ static_assert(
 int CaffeToNumpyType(const TypeMeta& meta);
 const TypeMeta& NumpyTypeToCaffe(int numpy_type);
 
+// Makes the numpy array own a reference to the storage of the tensor, so that
+// a view of the tensor stays valid after the tensor is resized or freed.
+void KeepTensorStorageAlive(PyArrayObject* array, std::shared_ptr<void> data);
+
+// Whether FeedTensorZeroCopy can alias the memory of the array: it has to be
+// writeable, aligned, C contiguous and of a fundamental type.
+bool CanFeedZeroCopy(PyArrayObject* array);
+
+// Makes the tensor alias the memory of the array instead of copying it. The
+// tensor holds a reference to the array until it frees or reallocates its
+// storage, e.g. when it is resized to a larger size or another type, after
+// which the tensor and the array no longer share memory. Until then, writes
+// to either are seen by the other.
+void FeedTensorZeroCopy(PyArrayObject* array, TensorCPU* tensor);
+
 template <class Context>
 class TensorFetcher : public BlobFetcherBase {
  public:
@@ -130,6 +145,11 @@ class TensorFetcher : public BlobFetcherBase {
       outPtr = const_cast<Tensor<Context>&>(tensor).raw_mutable_data();
       result.obj = py::reinterpret_steal<py::object>(PyArray_SimpleNewFromData(
           tensor.ndim(), npy_dims.data(), numpy_type, outPtr));
+      // The view keeps the storage it points to alive. It stops following
+      // the tensor when the tensor reallocates.
+      KeepTensorStorageAlive(
+          reinterpret_cast<PyArrayObject*>(result.obj.ptr()),
+          tensor.shared_data());
     }
 
     if (numpy_type == NPY_OBJECT) {
@@ -150,6 +170,9 @@ class TensorFetcher : public BlobFetcherBase {
     }
 
     if (result.copied) {
+      // The array is referenced by result, so other Python threads can run
+      // during the copy.
+      py::gil_scoped_release g;
       Context context;
       context.template CopyBytes<Context, CPUContext>(
           tensor.nbytes(), tensor.raw_data(), outPtr);
@@ -223,11 +246,17 @@ class TensorFeeder : public BlobFeederBase {
             "support unicode yet. Please ensure that you are passing in bytes "
             "instead of unicode strings.");
         break;
-      default:
+      default: {
+        // The array is referenced until the guard runs, so other Python
+        // threads can run during the copy.
+        py::gil_scoped_release g;
         context.template CopyBytes<CPUContext, Context>(
             tensor->size() * meta.itemsize(),
             static_cast<void*>(PyArray_DATA(array)),
             tensor->raw_mutable_data(meta));
+        context.FinishDeviceComputation();
+        return;
+      }
     }
     context.FinishDeviceComputation();
   }
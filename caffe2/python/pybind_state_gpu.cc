@@ -59,6 +59,25 @@ void addCUDAGlobalMethods(py::module& m) {
       obj["minor"] = py::cast(prop.minor);
       return obj;
   });
+  m.def("get_cuda_memory_pool_stats", []() {
+    std::vector<std::map<std::string, size_t>> result;
+    for (const auto& stats : GetCudaMemoryPoolStats()) {
+      std::map<std::string, size_t> obj;
+      obj["reserved_bytes"] = stats.reserved_bytes;
+      obj["allocated_bytes"] = stats.allocated_bytes;
+      obj["requested_bytes"] = stats.requested_bytes;
+      obj["cached_bytes"] = stats.cached_bytes;
+      obj["peak_reserved_bytes"] = stats.peak_reserved_bytes;
+      obj["peak_allocated_bytes"] = stats.peak_allocated_bytes;
+      obj["num_allocs"] = stats.num_allocs;
+      obj["num_cache_hits"] = stats.num_cache_hits;
+      obj["num_cross_stream_reuses"] = stats.num_cross_stream_reuses;
+      obj["num_releases"] = stats.num_releases;
+      result.push_back(std::move(obj));
+    }
+    return result;
+  });
+  m.def("release_cached_cuda_memory", &ReleaseCachedCudaMemory);
 };
 
 PYBIND11_MODULE(caffe2_pybind11_state_gpu, m) {
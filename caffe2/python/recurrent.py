@@ -28,6 +28,7 @@ def recurrent_net(
         net, cell_net, inputs, initial_cell_inputs,
         links, timestep=None, scope=None, outputs_with_grads=(0,),
         recompute_blobs_on_backward=None, forward_only=False,
+        checkpoint_interval=None, batch_sizes=None,
 ):
     '''
     net: the main net operator should be added to
@@ -61,6 +62,21 @@ def recurrent_net(
                  stored for each forward timestep.
 
     forward_only: if True, only forward steps are executed
+
+    checkpoint_interval: if set to k > 1, only every k-th timestep keeps its
+                 forward activations for the backward pass. The others are
+                 recomputed segment by segment on backward, so about
+                 T / k + k step workspaces are alive instead of T, at the
+                 cost of running the step net once more for most timesteps.
+                 k close to sqrt(T) gives the lowest memory use.
+
+    batch_sizes: optional int32 CPU blob of length T with the number of
+                 sequences that are still running at each timestep, e.g.
+                 the batch_sizes output of DequeueBucketingQueue. The batch
+                 has to be sorted by decreasing length, and the cell net
+                 then only runs on the rows of the running sequences. The
+                 states of a finished sequence keep their last value, so the
+                 outputs at padded timesteps have to be masked in the loss.
     '''
     assert len(inputs) == 1, "Only one input blob is supported so far"
 
@@ -281,7 +297,14 @@ def recurrent_net(
         }
         if len(backward_cell_net.Proto().op) != 0:
             backward_args['backward_step_net'] = backward_cell_net.Proto()
+        if checkpoint_interval is not None:
+            backward_args['checkpoint_interval'] = checkpoint_interval
 
+    op_args = dict(backward_args)
+    if batch_sizes is not None:
+        # Also an input, so that the op runs after the batch sizes are set
+        all_inputs = all_inputs + [batch_sizes]
+        op_args['batch_sizes'] = str(batch_sizes)
 
     results = net.RecurrentNetwork(
         all_inputs,
@@ -299,7 +322,7 @@ def recurrent_net(
         enable_rnn_executor=1,
         step_net=cell_net.Proto(),
         timestep="timestep" if timestep is None else str(timestep),
-        **backward_args
+        **op_args
     )
 
     # Restore net type since 'rnn' is not recognized outside RNNs
@@ -310,7 +333,8 @@ def recurrent_net(
     return results[:-1]
 
 
-def set_rnn_executor_config(rnn_op, num_threads=None, max_cuda_streams=None):
+def set_rnn_executor_config(rnn_op, num_threads=None, max_cuda_streams=None,
+                            max_parallel_timesteps=None):
     from caffe2.proto import caffe2_pb2
     assert rnn_op.type in {'RecurrentNetwork', 'RecurrentNetworkGradient'}
 
@@ -324,6 +348,8 @@ def set_rnn_executor_config(rnn_op, num_threads=None, max_cuda_streams=None):
         add_arg('num_threads', num_threads)
     if max_cuda_streams is not None:
         add_arg('max_cuda_streams', max_cuda_streams)
+    if max_parallel_timesteps is not None:
+        add_arg('max_parallel_timesteps', max_parallel_timesteps)
 
 
 def retrieve_step_blobs(net, prefix='rnn'):
@@ -0,0 +1,451 @@
+# Copyright (c) 2016-present, Facebook, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##############################################################################
+
+## @package regression_benchmark
+# Module caffe2.python.regression_benchmark
+"""
+Tracks the speed of a fixed set of convnet and LSTM benchmarks over builds.
+
+`run` builds every registered benchmark, a model of convnet_benchmarks or an
+LSTM like the one of lstm_benchmark with a fixed shape, for every engine
+(default, NNPACK, MKLDNN, CUDNN) and device it is built for, and times it
+with the net_regression_benchmark binary. The binary runs with the same
+number of threads for OpenMP, MKL and the net executors, and optionally
+pinned to a list of CPUs, so that runs on the same machine are comparable.
+The per-iteration times are written as JSON, along with the settings and a
+fingerprint of the machine and the build:
+
+  python -m caffe2.python.regression_benchmark run \\
+    --binary build/bin/net_regression_benchmark \\
+    --threads 4 --cpu_list 0-3 --output new.json
+
+`compare` then reports, for every benchmark in both results, the change of
+the median time and whether it is significant by a two-sided Mann-Whitney U
+test, which unlike a t-test does not assume the times are normally
+distributed. It exits with 1 if any benchmark became significantly slower
+by more than --threshold:
+
+  python -m caffe2.python.regression_benchmark compare \\
+    --baseline old.json --current new.json
+
+Results are only comparable with the same settings on the same hardware;
+compare warns when they differ.
+"""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+import argparse
+import collections
+import json
+import math
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+from caffe2.proto import caffe2_pb2
+from caffe2.python import core, model_helper, rnn_cell, workspace
+from caffe2.python import convnet_benchmarks as cb
+
+
+# name is model/pass/engine/device, e.g. AlexNet/train/NNPACK/cpu. build
+# returns the model, whose param_init_net also fills the inputs. requires is
+# the registry key of the main operator with the engine.
+BenchmarkSpec = collections.namedtuple(
+    'BenchmarkSpec', ['name', 'build', 'engine', 'gpu', 'requires'])
+
+# Models of convnet_benchmarks and their batch sizes.
+CONVNETS = [
+    ('MLP', cb.MLP, 64),
+    ('AlexNet', cb.AlexNet, 64),
+    ('OverFeat', cb.OverFeat, 64),
+    ('Inception', cb.Inception, 32),
+    ('VGGA', cb.VGGA, 32),
+]
+
+# Engines and whether they run on the GPU.
+ENGINES = [
+    ('', False),
+    ('NNPACK', False),
+    ('MKLDNN', False),
+    ('', True),
+    ('CUDNN', True),
+]
+
+# Sequence length, batch size, input and hidden dimension of the LSTM.
+LSTM_SHAPE = (20, 64, 40, 512)
+
+
+def _ConvnetModel(model_gen, batch_size, forward_only, engine, gpu):
+    flags = ['--batch_size', str(batch_size), '--model', model_gen.__name__]
+    if forward_only:
+        flags.append('--forward_only')
+    if not gpu:
+        flags.append('--cpu')
+    if engine:
+        flags.extend(['--engine', engine])
+    return cb.PrepareModel(
+        model_gen, cb.GetArgumentParser().parse_args(flags))
+
+
+def _LSTMModel(forward_only, engine, gpu):
+    T, batch_size, dim_in, dim_out = LSTM_SHAPE
+    device = core.DeviceOption(caffe2_pb2.CUDA if gpu else caffe2_pb2.CPU, 0)
+    with core.DeviceScope(device):
+        model = model_helper.ModelHelper(name="LSTM_regression")
+        init_net = model.param_init_net
+        input_blob = init_net.GaussianFill(
+            [], "input_data", shape=[T, batch_size, dim_in])
+        labels = init_net.UniformIntFill(
+            [], "label", shape=[T], min=0, max=batch_size * dim_out - 1)
+        init_blobs = [
+            init_net.ConstantFill([], name, shape=[1, batch_size, dim_out])
+            for name in ["hidden_init", "cell_init"]
+        ]
+        if engine == 'CUDNN':
+            output, _, _ = rnn_cell.cudnn_LSTM(
+                model=model,
+                input_blob=input_blob,
+                initial_states=init_blobs,
+                dim_in=dim_in,
+                dim_out=dim_out,
+                scope="cudnnlstm",
+                num_layers=1,
+            )
+        else:
+            seq_lengths = init_net.ConstantFill(
+                [], "seq_lengths", shape=[batch_size], value=T,
+                dtype=core.DataType.INT32)
+            output, _, _, _ = rnn_cell.LSTM(
+                model=model,
+                input_blob=input_blob,
+                seq_lengths=seq_lengths,
+                initial_states=init_blobs,
+                dim_in=dim_in,
+                dim_out=[dim_out],
+                scope="lstm1",
+                forward_only=forward_only,
+                drop_states=True,
+                return_last_layer_only=True,
+            )
+        weights = model.net.UniformFill(labels, "weights")
+        _, loss = model.net.SoftmaxWithLoss(
+            [model.Flatten(output), labels, weights], ['softmax', 'loss'])
+        if not forward_only:
+            model.AddGradientOperators([loss])
+    return model
+
+
+def _Registry():
+    specs = []
+    for model_name, model_gen, batch_size in CONVNETS:
+        for engine, gpu in ENGINES:
+            if model_name == 'MLP' and engine:
+                continue
+            for forward_only in [True, False]:
+                specs.append(BenchmarkSpec(
+                    '/'.join([
+                        model_name,
+                        'forward' if forward_only else 'train',
+                        engine or 'default',
+                        'gpu' if gpu else 'cpu',
+                    ]),
+                    lambda m=model_gen, b=batch_size, f=forward_only,
+                    e=engine, g=gpu: _ConvnetModel(m, b, f, e, g),
+                    engine,
+                    gpu,
+                    'Conv_ENGINE_' + engine if engine else 'Conv',
+                ))
+    for engine, gpu in [('', False), ('', True), ('CUDNN', True)]:
+        for forward_only in [True, False]:
+            specs.append(BenchmarkSpec(
+                '/'.join([
+                    'LSTM',
+                    'forward' if forward_only else 'train',
+                    engine or 'default',
+                    'gpu' if gpu else 'cpu',
+                ]),
+                lambda f=forward_only, e=engine, g=gpu: _LSTMModel(f, e, g),
+                engine,
+                gpu,
+                'Recurrent' if engine else 'RecurrentNetwork',
+            ))
+    return specs
+
+
+BENCHMARKS = _Registry()
+
+
+def Unavailable(spec):
+    """Returns why the benchmark cannot run in this build, or None."""
+    if spec.gpu and workspace.NumCudaDevices() == 0:
+        return 'no GPU'
+    if spec.requires not in workspace.RegisteredOperators():
+        return spec.requires + ' is not built'
+    return None
+
+
+def Fingerprint(binary_fingerprint):
+    """Adds the GPUs to the fingerprint reported by the binary."""
+    fingerprint = dict(binary_fingerprint)
+    fingerprint['gpus'] = [
+        workspace.GetDeviceProperties(i)['name']
+        for i in range(workspace.NumCudaDevices())
+    ]
+    if fingerprint['gpus']:
+        fingerprint['cuda_version'] = workspace.GetCUDAVersion()
+        fingerprint['cudnn_version'] = workspace.GetCuDNNVersion()
+    return fingerprint
+
+
+def RunBenchmarks(args):
+    settings = {
+        'threads': args.threads,
+        'cpu_list': args.cpu_list,
+        'warmup': args.warmup,
+        'iter': args.iter,
+    }
+    results = {'settings': settings, 'benchmarks': {}, 'skipped': {}}
+    env = dict(os.environ)
+    env['OMP_NUM_THREADS'] = str(args.threads)
+    env['MKL_NUM_THREADS'] = str(args.threads)
+    tmp_dir = tempfile.mkdtemp()
+    try:
+        for spec in BENCHMARKS:
+            if not re.search(args.filter, spec.name):
+                continue
+            reason = Unavailable(spec)
+            if reason:
+                print('{}: skipped, {}'.format(spec.name, reason))
+                results['skipped'][spec.name] = reason
+                continue
+            model = spec.build()
+            init_file = os.path.join(tmp_dir, 'init_net.pb')
+            net_file = os.path.join(tmp_dir, 'net.pb')
+            json_file = os.path.join(tmp_dir, 'result.json')
+            with open(init_file, 'wb') as f:
+                f.write(model.param_init_net.Proto().SerializeToString())
+            with open(net_file, 'wb') as f:
+                f.write(model.net.Proto().SerializeToString())
+            command = [
+                args.binary,
+                '--init_net', init_file,
+                '--net', net_file,
+                '--name', spec.name,
+                '--warmup', str(args.warmup),
+                '--iter', str(args.iter),
+                '--num_workers', str(args.threads),
+                '--json_output', json_file,
+            ]
+            if args.cpu_list:
+                command.extend(['--cpu_list', args.cpu_list])
+            subprocess.check_call(command, env=env)
+            with open(json_file) as f:
+                result = json.load(f)
+            results['fingerprint'] = Fingerprint(result.pop('fingerprint'))
+            samples = result['samples_ms']
+            print('{}: median {:.3f} ms'.format(spec.name, Median(samples)))
+            results['benchmarks'][spec.name] = result
+    finally:
+        shutil.rmtree(tmp_dir)
+    return results
+
+
+def Median(samples):
+    s = sorted(samples)
+    n = len(s)
+    return (s[(n - 1) // 2] + s[n // 2]) / 2.0
+
+
+def MannWhitneyU(a, b):
+    """Two-sided p-value of the Mann-Whitney U test that samples a and b come
+    from the same distribution, by the normal approximation with tie and
+    continuity correction, which is accurate from about 10 samples each."""
+    n1 = len(a)
+    n2 = len(b)
+    n = n1 + n2
+    values = sorted([(x, 0) for x in a] + [(x, 1) for x in b])
+    # Ties get the mean of the ranks they span.
+    rank_sum_a = 0.0
+    tie_term = 0.0
+    i = 0
+    while i < n:
+        j = i
+        while j + 1 < n and values[j + 1][0] == values[i][0]:
+            j += 1
+        rank = (i + j) / 2.0 + 1
+        rank_sum_a += rank * sum(1 for k in range(i, j + 1)
+                                 if values[k][1] == 0)
+        ties = j - i + 1
+        tie_term += ties ** 3 - ties
+        i = j + 1
+    u = rank_sum_a - n1 * (n1 + 1) / 2.0
+    mean = n1 * n2 / 2.0
+    variance = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = max(abs(u - mean) - 0.5, 0) / math.sqrt(variance)
+    return math.erfc(z / math.sqrt(2))
+
+
+Comparison = collections.namedtuple(
+    'Comparison',
+    ['name', 'baseline_ms', 'current_ms', 'change', 'p_value', 'status'])
+
+
+def Compare(baseline, current, alpha=0.01, threshold=0.05):
+    """Compares the benchmarks of two results of RunBenchmarks. A benchmark
+    is a regression or an improvement if the p-value is below alpha and its
+    median time changed by more than threshold, relatively. Returns the
+    comparisons and warnings about differences of settings and hardware."""
+    warnings = []
+    for key in sorted(set(baseline['settings']) | set(current['settings'])):
+        if baseline['settings'].get(key) != current['settings'].get(key):
+            warnings.append('setting {} differs: {} vs {}'.format(
+                key, baseline['settings'].get(key),
+                current['settings'].get(key)))
+    base_fp = baseline.get('fingerprint', {})
+    cur_fp = current.get('fingerprint', {})
+    for key in ['cpu_model', 'hardware_concurrency', 'gpus']:
+        if base_fp.get(key) != cur_fp.get(key):
+            warnings.append('{} differs: {} vs {}'.format(
+                key, base_fp.get(key), cur_fp.get(key)))
+
+    comparisons = []
+    for name in sorted(baseline['benchmarks']):
+        if name not in current['benchmarks']:
+            warnings.append('{} is missing from the current results'.format(
+                name))
+            continue
+        a = baseline['benchmarks'][name]['samples_ms']
+        b = current['benchmarks'][name]['samples_ms']
+        base_ms = Median(a)
+        cur_ms = Median(b)
+        change = cur_ms / base_ms - 1 if base_ms > 0 else 0.0
+        p_value = MannWhitneyU(a, b)
+        status = 'unchanged'
+        if p_value < alpha and change > threshold:
+            status = 'regression'
+        elif p_value < alpha and change < -threshold:
+            status = 'improvement'
+        comparisons.append(
+            Comparison(name, base_ms, cur_ms, change, p_value, status))
+    return comparisons, warnings
+
+
+def GetArgumentParser():
+    parser = argparse.ArgumentParser(
+        description="Caffe2 regression benchmark.")
+    subparsers = parser.add_subparsers(dest='command')
+    run = subparsers.add_parser(
+        'run', help="Run the registered benchmarks.")
+    run.add_argument(
+        "--binary",
+        type=str,
+        required=True,
+        help="Path of the net_regression_benchmark binary."
+    )
+    run.add_argument(
+        "--output",
+        type=str,
+        required=True,
+        help="The JSON file the results are written to."
+    )
+    run.add_argument(
+        "--filter",
+        type=str,
+        default="",
+        help="Only run the benchmarks whose name matches this regex."
+    )
+    run.add_argument(
+        "--threads",
+        type=int,
+        default=1,
+        help="Threads of OpenMP, MKL and the net executors."
+    )
+    run.add_argument(
+        "--cpu_list",
+        type=str,
+        default="",
+        help="CPUs to pin the benchmarks to, e.g. 0-3,8."
+    )
+    run.add_argument(
+        "--warmup",
+        type=int,
+        default=10,
+        help="Number of warm-up iterations of every benchmark."
+    )
+    run.add_argument(
+        "--iter",
+        type=int,
+        default=30,
+        help="Number of timed iterations of every benchmark."
+    )
+    compare = subparsers.add_parser(
+        'compare', help="Compare results against a baseline.")
+    compare.add_argument("--baseline", type=str, required=True)
+    compare.add_argument("--current", type=str, required=True)
+    compare.add_argument(
+        "--alpha",
+        type=float,
+        default=0.01,
+        help="Significance level of the Mann-Whitney U test."
+    )
+    compare.add_argument(
+        "--threshold",
+        type=float,
+        default=0.05,
+        help="Relative change of the median below which a significant "
+             "change is ignored."
+    )
+    return parser
+
+
+def main(argv):
+    args, extra_args = GetArgumentParser().parse_known_args(argv)
+    if args.command == 'run':
+        workspace.GlobalInit(['caffe2', '--caffe2_log_level=0'] + extra_args)
+        results = RunBenchmarks(args)
+        with open(args.output, 'w') as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+        return 0
+    if args.command == 'compare':
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        with open(args.current) as f:
+            current = json.load(f)
+        comparisons, warnings = Compare(
+            baseline, current, args.alpha, args.threshold)
+        for warning in warnings:
+            print('WARNING: ' + warning)
+        print('{:<32} {:>12} {:>12} {:>8} {:>8}  {}'.format(
+            'benchmark', 'baseline ms', 'current ms', 'change', 'p', ''))
+        for c in comparisons:
+            print('{:<32} {:>12.3f} {:>12.3f} {:>+7.1f}% {:>8.4f}  {}'.format(
+                c.name, c.baseline_ms, c.current_ms, 100 * c.change,
+                c.p_value, c.status))
+        regressed = any(c.status == 'regression' for c in comparisons)
+        return 1 if regressed else 0
+    GetArgumentParser().print_help()
+    return 2
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
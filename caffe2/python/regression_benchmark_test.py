@@ -0,0 +1,79 @@
+# Copyright (c) 2016-present, Facebook, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##############################################################################
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+import unittest
+from caffe2.python import regression_benchmark as rb
+from caffe2.python import test_util, workspace
+
+
+def _Results(samples, threads=1):
+    return {
+        'settings': {'threads': threads},
+        'fingerprint': {'cpu_model': 'cpu'},
+        'benchmarks': {
+            name: {'samples_ms': values} for name, values in samples.items()
+        },
+    }
+
+
+class TestRegressionBenchmark(test_util.TestCase):
+    def testMannWhitneyU(self):
+        same = [1.0, 2.0, 3.0, 4.0, 5.0] * 4
+        self.assertAlmostEqual(rb.MannWhitneyU(same, same), 1.0)
+        self.assertAlmostEqual(rb.MannWhitneyU([1.0] * 20, [1.0] * 20), 1.0)
+        slower = [x + 10 for x in same]
+        self.assertLess(rb.MannWhitneyU(same, slower), 1e-6)
+        self.assertAlmostEqual(
+            rb.MannWhitneyU(same, slower), rb.MannWhitneyU(slower, same))
+
+    def testCompare(self):
+        base = [10.0 + 0.01 * i for i in range(20)]
+        baseline = _Results({'a': base, 'b': base, 'c': base, 'd': base})
+        current = _Results({
+            'a': [x * 1.5 for x in base],
+            'b': [x * 0.5 for x in base],
+            'c': [x * 1.01 for x in base],
+        }, threads=2)
+        comparisons, warnings = rb.Compare(baseline, current)
+        self.assertEqual(
+            [(c.name, c.status) for c in comparisons],
+            [('a', 'regression'), ('b', 'improvement'), ('c', 'unchanged')])
+        self.assertAlmostEqual(comparisons[0].change, 0.5)
+        # The threads differ, and d is missing.
+        self.assertEqual(len(warnings), 2)
+
+    def testRegistry(self):
+        names = [spec.name for spec in rb.BENCHMARKS]
+        self.assertEqual(len(names), len(set(names)))
+        self.assertIn('AlexNet/train/default/cpu', names)
+        self.assertIn('LSTM/forward/default/cpu', names)
+
+    def testBuildCpuModels(self):
+        for name in ['MLP/forward/default/cpu', 'LSTM/train/default/cpu']:
+            spec = [s for s in rb.BENCHMARKS if s.name == name][0]
+            self.assertIsNone(rb.Unavailable(spec))
+            model = spec.build()
+            workspace.RunNetOnce(model.param_init_net)
+            workspace.CreateNet(model.net)
+            workspace.RunNet(model.net.Proto().name)
+
+
+if __name__ == '__main__':
+    unittest.main()
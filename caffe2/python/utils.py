@@ -41,8 +41,30 @@ def CaffeBlobToNumpyArray(blob):
                 .reshape(blob.shape.dim))
 
 
+_BYTES_DATA_TYPES = {
+    caffe2_pb2.TensorProto.FLOAT: np.float32,
+    caffe2_pb2.TensorProto.INT32: np.int32,
+    caffe2_pb2.TensorProto.BOOL: np.bool_,
+    caffe2_pb2.TensorProto.UINT8: np.uint8,
+    caffe2_pb2.TensorProto.INT8: np.int8,
+    caffe2_pb2.TensorProto.UINT16: np.uint16,
+    caffe2_pb2.TensorProto.INT16: np.int16,
+    caffe2_pb2.TensorProto.INT64: np.int64,
+    caffe2_pb2.TensorProto.FLOAT16: np.float16,
+    caffe2_pb2.TensorProto.DOUBLE: np.float64,
+}
+
+
 def Caffe2TensorToNumpyArray(tensor):
-    if tensor.data_type == caffe2_pb2.TensorProto.FLOAT:
+    if tensor.HasField('byte_order'):
+        # Raw element bytes, as written for large tensors.
+        byte_order = (
+            '<' if tensor.byte_order == caffe2_pb2.TensorProto.LITTLE else '>')
+        dtype = np.dtype(
+            _BYTES_DATA_TYPES[tensor.data_type]).newbyteorder(byte_order)
+        return np.frombuffer(
+            tensor.byte_data, dtype=dtype).reshape(tensor.dims)
+    elif tensor.data_type == caffe2_pb2.TensorProto.FLOAT:
         return np.asarray(
             tensor.float_data, dtype=np.float32).reshape(tensor.dims)
     elif tensor.data_type == caffe2_pb2.TensorProto.DOUBLE:
@@ -44,6 +44,7 @@ CurrentWorkspace = C.current_workspace
 DeserializeBlob = C.deserialize_blob
 GlobalInit = C.global_init
 HasBlob = C.has_blob
+MemoryReport = C.memory_report
 RegisteredOperators = C.registered_operators
 SerializeBlob = C.serialize_blob
 SwitchWorkspace = C.switch_workspace
@@ -67,6 +68,23 @@ if has_gpu_support:
         return np.asarray(C.get_cuda_peer_access_pattern())
 
     GetDeviceProperties = C.get_device_properties
+
+    def GetCudaMemoryPoolStats():
+        """Statistics of the stream memory pool, one dict per device.
+
+        Besides the raw byte counts, each dict has a "fragmentation" entry:
+        the share of the reserved memory that is not holding requested
+        bytes, either because it is cached or lost to block rounding.
+        """
+        stats = C.get_cuda_memory_pool_stats()
+        for device_stats in stats:
+            reserved = device_stats['reserved_bytes']
+            device_stats['fragmentation'] = (
+                1.0 - float(device_stats['requested_bytes']) / reserved
+                if reserved else 0.0)
+        return stats
+
+    ReleaseCachedCudaMemory = C.release_cached_cuda_memory
 else:
     NumCudaDevices = lambda: 0 # noqa
     SetDefaultGPUID = lambda x: None # noqa
@@ -75,6 +93,8 @@ else:
     GetCuDNNVersion = lambda: 0 # noqa
     GetCudaPeerAccessPattern = lambda: np.array([]) # noqa
     GetDeviceProperties = lambda x: None # noqa
+    GetCudaMemoryPoolStats = lambda: [] # noqa
+    ReleaseCachedCudaMemory = lambda: None # noqa
 
 
 def _GetFreeFlaskPort():
@@ -288,7 +308,7 @@ def GetNetName(net):
     raise Exception("Not a Net object: {}".format(str(net)))
 
 
-def FeedBlob(name, arr, device_option=None):
+def FeedBlob(name, arr, device_option=None, zero_copy=False):
     """Feeds a blob into the workspace.
 
     Inputs:
@@ -296,6 +316,11 @@ def FeedBlob(name, arr, device_option=None):
       arr: either a TensorProto object or a numpy array object to be fed into
           the workspace.
       device_option (optional): the device option to feed the data with.
+      zero_copy (optional): if True, a CPU tensor is fed that aliases the
+          memory of arr instead of copying it, when arr is writeable, aligned,
+          C contiguous and not of object type; otherwise arr is copied. The
+          tensor keeps arr alive and shares its memory until the tensor is
+          resized beyond the size of arr or to another type.
     Returns:
       True or False, stating whether the feed is successful.
     """
@@ -319,9 +344,10 @@ def FeedBlob(name, arr, device_option=None):
 
     name = StringifyBlobName(name)
     if device_option is not None:
-        return C.feed_blob(name, arr, StringifyProto(device_option))
+        return C.feed_blob(
+            name, arr, StringifyProto(device_option), zero_copy=zero_copy)
     else:
-        return C.feed_blob(name, arr)
+        return C.feed_blob(name, arr, zero_copy=zero_copy)
 
 
 def FetchBlobs(names):
@@ -335,15 +361,21 @@ def FetchBlobs(names):
     return [FetchBlob(name) for name in names]
 
 
-def FetchBlob(name):
+def FetchBlob(name, zero_copy=False):
     """Fetches a blob from the workspace.
 
     Inputs:
       name: the name of the blob - a string or a BlobReference
+      zero_copy (optional): if True, a CPU tensor is returned as a numpy view
+          of its memory rather than a copy. The view sees in-place updates of
+          the tensor, and keeps the memory alive after the blob is reset.
+          Once the tensor reallocates, e.g. when it grows or changes type,
+          the view keeps pointing at the old memory and no longer follows
+          the blob. Tensors of strings and non-CPU tensors are still copied.
     Returns:
       Fetched blob (numpy array or string) if successful
     """
-    return C.fetch_blob(StringifyBlobName(name))
+    return C.fetch_blob(StringifyBlobName(name), zero_copy=zero_copy)
 
 
 def ApplyTransform(transform_key, net):
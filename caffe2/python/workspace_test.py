@@ -44,6 +44,16 @@ class TestWorkspace(unittest.TestCase):
             workspace.ResetWorkspace("/tmp/caffe-workspace-test"), True)
         self.assertEqual(workspace.RootFolder(), "/tmp/caffe-workspace-test")
 
+    def testMemoryReport(self):
+        workspace.FeedBlob("x", np.zeros((10, 4), dtype=np.float32))
+        workspace.FeedBlob("y", np.zeros(3, dtype=np.int64))
+        report = workspace.MemoryReport()
+        self.assertEqual([blob["name"] for blob in report["blobs"]], ["x", "y"])
+        self.assertEqual(report["blobs"][0]["used_bytes"], 160)
+        self.assertEqual(report["blobs"][0]["device"], "cpu")
+        self.assertEqual(report["devices"]["cpu"]["num_blobs"], 2)
+        self.assertEqual(report["devices"]["cpu"]["used_bytes"], 184)
+
     def testWorkspaceHasBlobWithNonexistingName(self):
         self.assertEqual(workspace.HasBlob("non-existing"), False)
 
@@ -74,8 +84,12 @@ class TestWorkspace(unittest.TestCase):
         W = np.zeros((1, 1, 3, 3))
         workspace.FeedBlob("X", X)
         workspace.FeedBlob("W", W)
-        flops, _ = workspace.GetOperatorCost(op.SerializeToString(), ["X", "W"])
-        self.assertEqual(flops, 648)
+        flops, bytes_read, bytes_written = workspace.GetOperatorCost(
+            op.SerializeToString(), ["X", "W"])
+        # 8x8 outputs, each the dot product of a 1x3x3 filter.
+        self.assertEqual(flops, 8 * 8 * 2 * 9)
+        self.assertEqual(bytes_read, (X.size + W.size) * X.itemsize)
+        self.assertEqual(bytes_written, 8 * 8 * 4)
 
     def testRunNetOnce(self):
         self.assertEqual(
@@ -240,6 +254,28 @@ class TestWorkspace(unittest.TestCase):
         s2 = workspace.FetchBlob('my_plain_string')
         self.assertEqual(s, s2)
 
+    def testFeedFetchBlobZeroCopy(self):
+        arr = np.arange(6, dtype=np.float32).reshape(2, 3)
+        workspace.FeedBlob('zero_copy', arr, zero_copy=True)
+        view = workspace.FetchBlob('zero_copy', zero_copy=True)
+        np.testing.assert_array_equal(view, arr)
+        # The fed tensor, the array and the view share memory.
+        arr[0, 0] = 42
+        self.assertEqual(view[0, 0], 42)
+        self.assertEqual(workspace.FetchBlob('zero_copy')[0, 0], 42)
+        # The view keeps the memory alive once the blob is reset.
+        del arr
+        workspace.ResetWorkspace()
+        self.assertEqual(view[0, 0], 42)
+
+    def testFeedBlobZeroCopyFallsBackToCopy(self):
+        arr = np.arange(6, dtype=np.float32).reshape(2, 3).T
+        workspace.FeedBlob('not_contiguous', arr, zero_copy=True)
+        arr[0, 0] = 42
+        np.testing.assert_array_equal(
+            workspace.FetchBlob('not_contiguous'),
+            np.arange(6, dtype=np.float32).reshape(2, 3).T)
+
     def testFetchBlobs(self):
         s1 = b"test1"
         s2 = b"test2"
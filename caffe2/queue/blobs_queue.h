@@ -35,6 +35,12 @@ namespace caffe2 {
 
 // Containing blobs are owned by the workspace.
 // On read, we swap out the underlying data for the blob passed in for blobs
+// in the queue, and on write we swap the data of the blobs passed in into the
+// queue. Neither direction copies or allocates anything: the buffers that a
+// reader hands back go into the slot it read from, and the next writer of
+// that slot gets them back in exchange for its own. Once every slot has been
+// used, producers that keep refilling their blobs with tensors of the same
+// shape and type keep reusing the same buffers.
 
 class BlobsQueue : public std::enable_shared_from_this<BlobsQueue> {
  public:
@@ -46,31 +52,26 @@ class BlobsQueue : public std::enable_shared_from_this<BlobsQueue> {
       bool enforceUniqueName,
       const std::vector<std::string>& fieldNames = {});
 
-  ~BlobsQueue() {
+  virtual ~BlobsQueue() {
     close();
   }
 
-  bool blockingRead(
+  virtual bool blockingRead(
       const std::vector<Blob*>& inputs,
       float timeout_secs = 0.0f);
-  bool tryWrite(const std::vector<Blob*>& inputs);
-  bool blockingWrite(const std::vector<Blob*>& inputs);
-  void close();
+  virtual bool tryWrite(const std::vector<Blob*>& inputs);
+  virtual bool blockingWrite(const std::vector<Blob*>& inputs);
+  virtual void close();
   size_t getNumBlobs() const {
     return numBlobs_;
   }
 
- private:
-  bool canWrite();
-  void doWrite(const std::vector<Blob*>& inputs);
-
+ protected:
   std::atomic<bool> closing_{false};
 
   size_t numBlobs_;
   std::mutex mutex_; // protects all variables in the class.
   std::condition_variable cv_;
-  int64_t reader_{0};
-  int64_t writer_{0};
   std::vector<std::vector<Blob*>> queue_;
   const std::string name_;
 
@@ -80,5 +81,12 @@ class BlobsQueue : public std::enable_shared_from_this<BlobsQueue> {
     CAFFE_EXPORTED_STAT(queue_dequeued_records);
     CAFFE_DETAILED_EXPORTED_STAT(queue_dequeued_bytes);
   } stats_;
+
+ private:
+  bool canWrite();
+  void doWrite(const std::vector<Blob*>& inputs);
+
+  int64_t reader_{0};
+  int64_t writer_{0};
 };
 } // namespace caffe2
@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/queue/blobs_queue.h"
+#include "caffe2/queue/lock_free_blobs_queue.h"
+
+namespace caffe2 {
+namespace {
+
+template <typename Queue>
+class BlobsQueueTest : public ::testing::Test {
+ protected:
+  std::shared_ptr<BlobsQueue> createQueue(size_t capacity) {
+    return std::make_shared<Queue>(
+        &ws_, "queue_" + caffe2::to_string(numQueues_++), capacity, 1, true);
+  }
+
+  Workspace ws_;
+  int numQueues_ = 0;
+};
+
+typedef ::testing::Types<BlobsQueue, LockFreeBlobsQueue> QueueTypes;
+TYPED_TEST_CASE(BlobsQueueTest, QueueTypes);
+
+void setValue(Blob* blob, int value) {
+  auto* tensor = blob->GetMutable<TensorCPU>();
+  tensor->Resize(1);
+  tensor->template mutable_data<int>()[0] = value;
+}
+
+int getValue(const Blob& blob) {
+  return blob.Get<TensorCPU>().template data<int>()[0];
+}
+
+TYPED_TEST(BlobsQueueTest, ProducersAndConsumers) {
+  const int kNumProducers = 4;
+  const int kNumConsumers = 3;
+  const int kRecordsPerProducer = 1000;
+  auto queue = this->createQueue(8);
+
+  std::vector<std::vector<int>> consumed(kNumConsumers);
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < kNumConsumers; ++i) {
+    consumers.emplace_back([&queue, &consumed, i]() {
+      Blob blob;
+      while (queue->blockingRead({&blob})) {
+        consumed[i].push_back(getValue(blob));
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kNumProducers; ++i) {
+    producers.emplace_back([&queue, i]() {
+      Blob blob;
+      for (int j = 0; j < kRecordsPerProducer; ++j) {
+        setValue(&blob, i * kRecordsPerProducer + j);
+        EXPECT_TRUE(queue->blockingWrite({&blob}));
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  queue->close();
+  for (auto& consumer : consumers) {
+    consumer.join();
+  }
+
+  std::vector<int> values;
+  for (const auto& part : consumed) {
+    values.insert(values.end(), part.begin(), part.end());
+  }
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(values.size(), kNumProducers * kRecordsPerProducer);
+  for (int i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(values[i], i);
+  }
+}
+
+TYPED_TEST(BlobsQueueTest, CloseKeepsRecords) {
+  auto queue = this->createQueue(2);
+  Blob blob;
+  setValue(&blob, 1);
+  EXPECT_TRUE(queue->tryWrite({&blob}));
+  setValue(&blob, 2);
+  EXPECT_TRUE(queue->tryWrite({&blob}));
+  setValue(&blob, 3);
+  EXPECT_FALSE(queue->tryWrite({&blob}));
+
+  queue->close();
+  EXPECT_TRUE(queue->blockingRead({&blob}));
+  EXPECT_EQ(getValue(blob), 1);
+  EXPECT_TRUE(queue->blockingRead({&blob}));
+  EXPECT_EQ(getValue(blob), 2);
+  EXPECT_FALSE(queue->blockingRead({&blob}));
+}
+
+TYPED_TEST(BlobsQueueTest, CloseWakesUpBlockedThreads) {
+  auto empty = this->createQueue(1);
+  std::thread reader([&empty]() {
+    Blob blob;
+    EXPECT_FALSE(empty->blockingRead({&blob}));
+  });
+  auto full = this->createQueue(1);
+  Blob blob;
+  setValue(&blob, 1);
+  EXPECT_TRUE(full->tryWrite({&blob}));
+  std::thread writer([&full]() {
+    Blob blob;
+    setValue(&blob, 2);
+    EXPECT_FALSE(full->blockingWrite({&blob}));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  empty->close();
+  full->close();
+  reader.join();
+  writer.join();
+}
+
+TYPED_TEST(BlobsQueueTest, ReadTimeout) {
+  auto queue = this->createQueue(1);
+  Blob blob;
+  EXPECT_FALSE(queue->blockingRead({&blob}, 0.01));
+  setValue(&blob, 7);
+  EXPECT_TRUE(queue->tryWrite({&blob}));
+  Blob out;
+  EXPECT_TRUE(queue->blockingRead({&out}, 0.01));
+  EXPECT_EQ(getValue(out), 7);
+}
+
+TYPED_TEST(BlobsQueueTest, SwapsBuffersWithoutCopies) {
+  auto queue = this->createQueue(1);
+  Blob produced;
+  setValue(&produced, 1);
+  const void* producedData = produced.Get<TensorCPU>().raw_data();
+  EXPECT_TRUE(queue->blockingWrite({&produced}));
+
+  Blob consumed;
+  setValue(&consumed, 2);
+  const void* drainedData = consumed.Get<TensorCPU>().raw_data();
+  EXPECT_TRUE(queue->blockingRead({&consumed}));
+  // The reader gets the writer's buffer itself.
+  EXPECT_EQ(consumed.Get<TensorCPU>().raw_data(), producedData);
+
+  // The buffer the reader drained goes back to the next writer of the slot,
+  // and refilling it with the same shape does not allocate.
+  setValue(&produced, 3);
+  EXPECT_TRUE(queue->blockingWrite({&produced}));
+  EXPECT_EQ(produced.Get<TensorCPU>().raw_data(), drainedData);
+  setValue(&produced, 4);
+  EXPECT_EQ(produced.Get<TensorCPU>().raw_data(), drainedData);
+}
+
+} // namespace
+} // namespace caffe2
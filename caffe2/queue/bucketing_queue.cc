@@ -0,0 +1,255 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bucketing_queue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace caffe2 {
+
+BucketingQueue::BucketingQueue(
+    std::vector<int> boundaries,
+    size_t capacity,
+    std::vector<bool> isSequence)
+    : boundaries_(std::move(boundaries)),
+      capacity_(capacity),
+      isSequence_(std::move(isSequence)),
+      available_(boundaries_.size(), 0) {
+  CAFFE_ENFORCE(!boundaries_.empty(), "At least one boundary is needed");
+  CAFFE_ENFORCE(
+      std::is_sorted(boundaries_.begin(), boundaries_.end()),
+      "Bucket boundaries must be increasing");
+  CAFFE_ENFORCE_GT(boundaries_.front(), 0);
+  for (size_t b = 0; b < boundaries_.size(); ++b) {
+    buckets_.emplace_back(
+        new RebatchingQueue(capacity_, isSequence_.size() + 1));
+  }
+}
+
+BucketingQueue::~BucketingQueue() {
+  close();
+}
+
+int BucketingQueue::bucketFor(int length) const {
+  auto it = std::lower_bound(boundaries_.begin(), boundaries_.end(), length);
+  CAFFE_ENFORCE(
+      it != boundaries_.end(),
+      "Sequence of length ",
+      length,
+      " is longer than the last bucket boundary ",
+      boundaries_.back());
+  return it - boundaries_.begin();
+}
+
+bool BucketingQueue::enqueueMany(
+    CPUContext& context,
+    const TensorCPU& lengths,
+    const std::vector<const TensorCPU*>& inputs) {
+  CAFFE_ENFORCE_EQ(inputs.size(), isSequence_.size());
+  CAFFE_ENFORCE_EQ(lengths.ndim(), 1);
+  const auto numElements = lengths.dim(0);
+  const int* lengthsData = lengths.data<int>();
+  for (size_t j = 0; j < inputs.size(); ++j) {
+    const auto& input = *inputs[j];
+    CAFFE_ENFORCE_GE(input.ndim(), isSequence_[j] ? 2 : 1);
+    CAFFE_ENFORCE_EQ(input.dim(0), numElements);
+    CAFFE_ENFORCE(
+        !isSequence_[j] || !input.meta().ctor(),
+        "Sequences are zero padded, which needs a fundamental type");
+  }
+
+  for (TIndex i = 0; i < numElements; ++i) {
+    const int length = lengthsData[i];
+    CAFFE_ENFORCE_GE(length, 0);
+    const int bucket = bucketFor(length);
+    const int paddedLength = boundaries_[bucket];
+
+    std::vector<TensorCPU> element(inputs.size() + 1);
+    element[0].Resize(std::vector<TIndex>());
+    element[0].mutable_data<int>()[0] = length;
+    for (size_t j = 0; j < inputs.size(); ++j) {
+      const auto& input = *inputs[j];
+      const auto& meta = input.meta();
+      auto& tensor = element[j + 1];
+      auto dims = input.dims();
+      dims.erase(dims.begin());
+      TIndex numItems = input.size_from_dim(1);
+      if (isSequence_[j]) {
+        CAFFE_ENFORCE_LE(length, input.dim(1), "Sequence longer than input");
+        dims[0] = paddedLength;
+        numItems = length * input.size_from_dim(2);
+      }
+      tensor.Resize(dims);
+      auto* dst = static_cast<char*>(tensor.raw_mutable_data(meta));
+      context.CopyItems<CPUContext, CPUContext>(
+          meta,
+          numItems,
+          static_cast<const char*>(input.raw_data()) +
+              i * input.size_from_dim(1) * meta.itemsize(),
+          dst);
+      std::memset(
+          dst + numItems * meta.itemsize(),
+          0,
+          tensor.nbytes() - numItems * meta.itemsize());
+    }
+
+    std::vector<const TensorCPU*> elementPtrs;
+    for (const auto& tensor : element) {
+      elementPtrs.push_back(&tensor);
+    }
+    if (!buckets_[bucket]->enqueueOne(context, elementPtrs)) {
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++available_[bucket];
+    }
+    cvReady_.notify_all();
+  }
+  return true;
+}
+
+bool BucketingQueue::dequeue(
+    CPUContext& context,
+    size_t numElements,
+    bool timeMajor,
+    TensorCPU* lengths,
+    TensorCPU* batchSizes,
+    const std::vector<TensorCPU*>& outputs) {
+  CAFFE_ENFORCE_EQ(outputs.size(), isSequence_.size());
+  // A full bucket must be enough for a batch, or enqueues into it could wait
+  // forever for a dequeue that waits for another bucket.
+  CAFFE_ENFORCE_LE(numElements, capacity_);
+
+  int bucket = -1;
+  size_t count = 0;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto pick = [&]() {
+      // The fullest bucket first.
+      const size_t minCount = isClosed_ ? 1 : numElements;
+      bucket = -1;
+      for (size_t b = 0; b < available_.size(); ++b) {
+        if (available_[b] >= minCount &&
+            (bucket < 0 || available_[b] > available_[bucket])) {
+          bucket = b;
+        }
+      }
+      return bucket >= 0 || isClosed_;
+    };
+    cvReady_.wait(lock, pick);
+    if (bucket < 0) {
+      return false;
+    }
+    count = std::min(numElements, available_[bucket]);
+    available_[bucket] -= count;
+  }
+
+  std::vector<TensorCPU> batch(isSequence_.size() + 1);
+  std::vector<TensorCPU*> batchPtrs;
+  for (auto& tensor : batch) {
+    batchPtrs.push_back(&tensor);
+  }
+  CAFFE_ENFORCE(buckets_[bucket]->dequeue(context, count, batchPtrs));
+  CAFFE_ENFORCE_EQ(batch[0].size(), count);
+
+  // Stable, so that equally long sequences keep their order.
+  const int* batchLengths = batch[0].data<int>();
+  std::vector<int> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return batchLengths[a] > batchLengths[b];
+  });
+  const int maxLength = batchLengths[order[0]];
+
+  lengths->Resize(count);
+  int* lengthsData = lengths->mutable_data<int>();
+  batchSizes->Resize(maxLength);
+  int* batchSizesData = batchSizes->mutable_data<int>();
+  std::fill(batchSizesData, batchSizesData + maxLength, 0);
+  for (size_t i = 0; i < count; ++i) {
+    lengthsData[i] = batchLengths[order[i]];
+    for (int t = 0; t < lengthsData[i]; ++t) {
+      ++batchSizesData[t];
+    }
+  }
+
+  for (size_t j = 0; j < outputs.size(); ++j) {
+    const auto& input = batch[j + 1];
+    const auto& meta = input.meta();
+    const char* src = static_cast<const char*>(input.raw_data());
+    const size_t elementBytes = input.size_from_dim(1) * meta.itemsize();
+    auto dims = input.dims();
+    if (!isSequence_[j]) {
+      outputs[j]->Resize(dims);
+      char* dst = static_cast<char*>(outputs[j]->raw_mutable_data(meta));
+      for (size_t i = 0; i < count; ++i) {
+        context.CopyItems<CPUContext, CPUContext>(
+            meta,
+            input.size_from_dim(1),
+            src + order[i] * elementBytes,
+            dst + i * elementBytes);
+      }
+      continue;
+    }
+
+    const TIndex stepItems = input.size_from_dim(2);
+    const size_t stepBytes = stepItems * meta.itemsize();
+    dims[1] = maxLength;
+    if (timeMajor) {
+      std::swap(dims[0], dims[1]);
+    }
+    outputs[j]->Resize(dims);
+    char* dst = static_cast<char*>(outputs[j]->raw_mutable_data(meta));
+    for (size_t i = 0; i < count; ++i) {
+      const char* element = src + order[i] * elementBytes;
+      if (!timeMajor) {
+        context.CopyItems<CPUContext, CPUContext>(
+            meta,
+            maxLength * stepItems,
+            element,
+            dst + i * maxLength * stepBytes);
+        continue;
+      }
+      for (int t = 0; t < maxLength; ++t) {
+        context.CopyItems<CPUContext, CPUContext>(
+            meta,
+            stepItems,
+            element + t * stepBytes,
+            dst + (t * count + i) * stepBytes);
+      }
+    }
+  }
+  return true;
+}
+
+size_t BucketingQueue::numBlobs() const {
+  return isSequence_.size();
+}
+
+void BucketingQueue::close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isClosed_ = true;
+  }
+  for (auto& bucket : buckets_) {
+    bucket->close();
+  }
+  cvReady_.notify_all();
+}
+} // caffe2
@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "caffe2/queue/rebatching_queue.h"
+
+namespace caffe2 {
+
+// Batches variable length sequences by length, so that padding them to the
+// longest sequence of their batch wastes little.
+//
+// Every bucket covers a range of lengths, (boundaries[b - 1], boundaries[b]],
+// and is a RebatchingQueue of its own whose elements are padded to the upper
+// boundary. A dequeue takes all its elements from one bucket, trims the
+// padding to the longest sequence taken, and sorts them by decreasing length,
+// so that the sequences still running at any timestep are a prefix of the
+// batch: the packed sequence layout RecurrentNetwork's batch_sizes argument
+// relies on.
+class BucketingQueue {
+ public:
+  // isSequence tells which of the blobs are sequences, with the timesteps as
+  // their second dimension when enqueued as a batch, the others are copied
+  // as they are. capacity is per bucket.
+  BucketingQueue(
+      std::vector<int> boundaries,
+      size_t capacity,
+      std::vector<bool> isSequence);
+
+  ~BucketingQueue();
+
+  // Splits a batch of padded sequences, such as the output of PackSegments,
+  // into its elements. lengths holds the length of each sequence, which
+  // must not exceed the last boundary.
+  bool enqueueMany(
+      CPUContext& context,
+      const TensorCPU& lengths,
+      const std::vector<const TensorCPU*>& inputs);
+
+  // Waits for a bucket to hold numElements elements and dequeues them, fewer
+  // once the queue is closed. Besides the blobs, outputs the length of every
+  // sequence and the number of sequences longer than every timestep t, the
+  // batch size at t. With timeMajor, sequences are output as
+  // [timesteps, batch, ...] instead of [batch, timesteps, ...].
+  bool dequeue(
+      CPUContext& context,
+      size_t numElements,
+      bool timeMajor,
+      TensorCPU* lengths,
+      TensorCPU* batchSizes,
+      const std::vector<TensorCPU*>& outputs);
+
+  size_t numBlobs() const;
+
+  void close();
+
+ private:
+  int bucketFor(int length) const;
+
+  const std::vector<int> boundaries_;
+  const size_t capacity_;
+  const std::vector<bool> isSequence_;
+  // Elements hold the length of the sequence, then the blobs.
+  std::vector<std::unique_ptr<RebatchingQueue>> buckets_;
+
+  std::mutex mutex_;
+  std::condition_variable cvReady_;
+  bool isClosed_{false};
+  // Elements of every bucket not yet claimed by a dequeue.
+  std::vector<size_t> available_;
+};
+} // caffe2
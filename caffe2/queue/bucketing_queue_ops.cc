@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bucketing_queue_ops.h"
+
+namespace caffe2 {
+
+CAFFE_KNOWN_TYPE(BucketingQueuePtr);
+
+namespace {
+
+REGISTER_CPU_OPERATOR(CreateBucketingQueue, CreateBucketingQueueOp);
+REGISTER_CPU_OPERATOR(EnqueueBucketingQueue, EnqueueBucketingQueueOp);
+REGISTER_CPU_OPERATOR(DequeueBucketingQueue, DequeueBucketingQueueOp);
+REGISTER_CPU_OPERATOR(CloseBucketingQueue, CloseBucketingQueueOp);
+
+NO_GRADIENT(CreateBucketingQueue);
+NO_GRADIENT(EnqueueBucketingQueue);
+NO_GRADIENT(DequeueBucketingQueue);
+NO_GRADIENT(CloseBucketingQueue);
+
+OPERATOR_SCHEMA(CreateBucketingQueue)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+      Creates a queue that batches sequences of similar lengths together.
+      Every bucket holds the sequences whose length is in
+      (boundaries[b - 1], boundaries[b]], padded to boundaries[b].
+)DOC")
+    .Output(0, "queue", "object representing the queue")
+    .Arg("boundaries", "Increasing upper bounds of the lengths of the buckets")
+    .Arg("num_blobs", "Number of tensors per element, lengths excluded")
+    .Arg(
+        "sequence_blobs",
+        "Indices of the tensors that are sequences, all of them by default")
+    .Arg(
+        "capacity",
+        "Maximal number of elements every bucket can hold at any given point, "
+        "at least num_elements of the dequeues");
+
+OPERATOR_SCHEMA(CloseBucketingQueue)
+    .NumInputs(1)
+    .NumOutputs(0)
+    .SetDoc(R"DOC(
+      Closes the Queue.
+)DOC")
+    .Input(0, "queue", "object representing the queue");
+
+OPERATOR_SCHEMA(EnqueueBucketingQueue)
+    .NumInputs(3, INT_MAX)
+    .NumOutputs(0)
+    .SetDoc(R"DOC(
+      Enqueues a batch of sequences into the queue, one element per sequence.
+      The sequence tensors are padded batches, such as the output of
+      PackSegments, of shape [batch_size, max_length, ...]; the other tensors
+      are of shape [batch_size, ...].
+      If the Queue is closed this operation will fail.
+)DOC")
+    .Input(0, "queue", "object representing the queue")
+    .Input(1, "lengths", "Length of every sequence of the batch, int32")
+    .Input(2, "tensor", "First tensor to enqueue");
+
+OPERATOR_SCHEMA(DequeueBucketingQueue)
+    .NumInputs(1)
+    .NumOutputs(3, INT_MAX)
+    .SetDoc(R"DOC(
+      Dequeues a batch of sequences from one bucket of the queue, sorted by
+      decreasing length and padded to the longest of them.
+      If the Queue is closed this might return less elements than asked.
+)DOC")
+    .Input(0, "queue", "object representing the queue")
+    .Output(0, "lengths", "Length of every sequence, decreasing, int32")
+    .Output(
+        1,
+        "batch_sizes",
+        "Number of sequences still running at every timestep, int32, as "
+        "expected by the batch_sizes argument of RecurrentNetwork")
+    .Output(2, "tensor", "First tensor dequeued")
+    .Arg(
+        "num_elements",
+        "Number of elements to dequeue. By default we dequeue one element.")
+    .Arg(
+        "time_major",
+        "Output sequences as [max_length, batch_size, ...] rather than "
+        "[batch_size, max_length, ...]");
+}
+}
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "bucketing_queue.h"
+
+namespace caffe2 {
+
+using BucketingQueuePtr = std::unique_ptr<BucketingQueue>;
+
+class CreateBucketingQueueOp : public Operator<CPUContext> {
+ public:
+  CreateBucketingQueueOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    const int numBlobs = OperatorBase::GetSingleArgument<int>("num_blobs", 1);
+    std::vector<bool> isSequence(numBlobs, true);
+    if (OperatorBase::HasArgument("sequence_blobs")) {
+      std::fill(isSequence.begin(), isSequence.end(), false);
+      for (int idx :
+           OperatorBase::GetRepeatedArgument<int>("sequence_blobs")) {
+        CAFFE_ENFORCE(idx >= 0 && idx < numBlobs, "Invalid blob index ", idx);
+        isSequence[idx] = true;
+      }
+    }
+    *OperatorBase::Output<BucketingQueuePtr>(0) =
+        BucketingQueuePtr(new BucketingQueue(
+            OperatorBase::GetRepeatedArgument<int>("boundaries"),
+            OperatorBase::GetSingleArgument<int>("capacity", 1),
+            std::move(isSequence)));
+    return true;
+  }
+};
+
+class EnqueueBucketingQueueOp : public Operator<CPUContext> {
+ public:
+  EnqueueBucketingQueueOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    auto& queue = Inputs()[0]->template Get<BucketingQueuePtr>();
+    CAFFE_ENFORCE(queue);
+    CAFFE_ENFORCE_EQ(InputSize(), queue->numBlobs() + 2);
+    std::vector<const TensorCPU*> inputTensors;
+    inputTensors.reserve(InputSize() - 2);
+    for (int i = 2; i < InputSize(); ++i) {
+      inputTensors.push_back(&Input(i));
+    }
+    return queue->enqueueMany(context_, Input(1), inputTensors);
+  }
+};
+
+class DequeueBucketingQueueOp : public Operator<CPUContext> {
+ public:
+  DequeueBucketingQueueOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator(operator_def, ws),
+        numElements_(OperatorBase::GetSingleArgument<int>("num_elements", 1)),
+        timeMajor_(OperatorBase::GetSingleArgument<bool>("time_major", false)) {
+  }
+
+  bool RunOnDevice() override {
+    auto& queue = Inputs()[0]->template Get<BucketingQueuePtr>();
+    CAFFE_ENFORCE(queue);
+    CAFFE_ENFORCE_EQ(OutputSize(), queue->numBlobs() + 2);
+
+    std::vector<TensorCPU*> outputTensors;
+    outputTensors.reserve(OutputSize() - 2);
+    for (int i = 2; i < OutputSize(); ++i) {
+      outputTensors.push_back(Output(i));
+    }
+    return queue->dequeue(
+        context_,
+        numElements_,
+        timeMajor_,
+        Output(0),
+        Output(1),
+        outputTensors);
+  }
+
+ private:
+  const int numElements_;
+  const bool timeMajor_;
+};
+
+class CloseBucketingQueueOp : public Operator<CPUContext> {
+ public:
+  CloseBucketingQueueOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    CAFFE_ENFORCE_EQ(InputSize(), 1);
+    auto& queue = Inputs()[0]->template Get<BucketingQueuePtr>();
+    CAFFE_ENFORCE(queue);
+    queue->close();
+    return true;
+  }
+};
+} // caffe2
@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/tensor.h"
+#include "caffe2/queue/bucketing_queue.h"
+
+namespace caffe2 {
+namespace {
+
+// Element i of the sequence at row r holds 100 * r + i, the label is r.
+void makeBatch(
+    const std::vector<int>& lengths,
+    int maxLength,
+    TensorCPU* lengthsTensor,
+    TensorCPU* sequences,
+    TensorCPU* labels) {
+  const int numRows = lengths.size();
+  lengthsTensor->Resize(numRows);
+  sequences->Resize(numRows, maxLength, 2);
+  labels->Resize(numRows);
+  for (int r = 0; r < numRows; ++r) {
+    lengthsTensor->mutable_data<int>()[r] = lengths[r];
+    labels->mutable_data<int>()[r] = r;
+    for (int i = 0; i < maxLength * 2; ++i) {
+      sequences->mutable_data<float>()[r * maxLength * 2 + i] =
+          i < lengths[r] * 2 ? 100 * r + i : -1;
+    }
+  }
+}
+
+TEST(BucketingQueueTest, BatchesSimilarLengths) {
+  CPUContext context;
+  BucketingQueue queue({2, 4, 8}, 8, {true, false});
+  TensorCPU lengths, sequences, labels;
+  makeBatch({1, 3, 4, 2, 7, 3}, 8, &lengths, &sequences, &labels);
+  ASSERT_TRUE(queue.enqueueMany(context, lengths, {&sequences, &labels}));
+
+  // Only the second bucket holds 3 sequences.
+  TensorCPU batchLengths, batchSizes, batchSequences, batchLabels;
+  ASSERT_TRUE(queue.dequeue(
+      context,
+      3,
+      true /* timeMajor */,
+      &batchLengths,
+      &batchSizes,
+      {&batchSequences, &batchLabels}));
+  EXPECT_EQ(batchLabels.dims(), std::vector<TIndex>({3}));
+  EXPECT_EQ(
+      std::vector<int>(batchLabels.data<int>(), batchLabels.data<int>() + 3),
+      std::vector<int>({2, 1, 5}));
+  EXPECT_EQ(
+      std::vector<int>(batchLengths.data<int>(), batchLengths.data<int>() + 3),
+      std::vector<int>({4, 3, 3}));
+  EXPECT_EQ(
+      std::vector<int>(batchSizes.data<int>(), batchSizes.data<int>() + 4),
+      std::vector<int>({3, 3, 3, 1}));
+  ASSERT_EQ(batchSequences.dims(), std::vector<TIndex>({4, 3, 2}));
+  for (int t = 0; t < 4; ++t) {
+    for (int i = 0; i < 3; ++i) {
+      const int row = batchLabels.data<int>()[i];
+      const float* step = batchSequences.data<float>() + (t * 3 + i) * 2;
+      const bool padding = t >= batchLengths.data<int>()[i];
+      EXPECT_EQ(step[0], padding ? 0 : 100 * row + 2 * t);
+      EXPECT_EQ(step[1], padding ? 0 : 100 * row + 2 * t + 1);
+    }
+  }
+
+  // Once closed, the remaining buckets are flushed, the fullest first.
+  queue.close();
+  ASSERT_TRUE(queue.dequeue(
+      context,
+      3,
+      false,
+      &batchLengths,
+      &batchSizes,
+      {&batchSequences, &batchLabels}));
+  EXPECT_EQ(batchSequences.dims(), std::vector<TIndex>({2, 2, 2}));
+  EXPECT_EQ(batchLengths.data<int>()[0], 2);
+  EXPECT_EQ(batchLengths.data<int>()[1], 1);
+  EXPECT_EQ(batchSequences.data<float>()[0], 300);
+  EXPECT_EQ(batchSequences.data<float>()[4], 0);
+  ASSERT_TRUE(queue.dequeue(
+      context,
+      3,
+      false,
+      &batchLengths,
+      &batchSizes,
+      {&batchSequences, &batchLabels}));
+  EXPECT_EQ(batchSequences.dims(), std::vector<TIndex>({1, 7, 2}));
+  EXPECT_FALSE(queue.dequeue(
+      context,
+      3,
+      false,
+      &batchLengths,
+      &batchSizes,
+      {&batchSequences, &batchLabels}));
+}
+
+TEST(BucketingQueueTest, RejectsTooLongSequences) {
+  CPUContext context;
+  BucketingQueue queue({2}, 4, {true});
+  TensorCPU lengths, sequences, labels;
+  makeBatch({3}, 3, &lengths, &sequences, &labels);
+  EXPECT_THROW(
+      queue.enqueueMany(context, lengths, {&sequences}), EnforceNotMet);
+}
+
+} // namespace
+} // namespace caffe2
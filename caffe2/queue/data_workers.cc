@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/queue/data_workers.h"
+
+#include <chrono>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/tensor.h"
+
+namespace caffe2 {
+
+CAFFE_DEFINE_REGISTRY(
+    DataFetcherRegistry,
+    DataFetcherBase,
+    int,
+    const ArgumentHelper&);
+
+NetDataFetcher::NetDataFetcher(
+    const NetDef& net_def,
+    const std::vector<std::string>& outputs,
+    const std::string& stop_blob,
+    const Workspace* parent)
+    : ws_(parent) {
+  net_ = ws_.CreateNet(net_def);
+  CAFFE_ENFORCE(net_, "Cannot create the fetch net ", net_def.name());
+  for (const auto& name : outputs) {
+    blobs_.push_back(ws_.CreateBlob(name));
+  }
+  if (!stop_blob.empty()) {
+    stop_blob_ = ws_.CreateBlob(stop_blob);
+  }
+}
+
+bool NetDataFetcher::Fetch(const std::vector<Blob*>& outputs) {
+  CAFFE_ENFORCE_EQ(outputs.size(), blobs_.size());
+  CAFFE_ENFORCE(net_->Run(), "Fetch net ", net_->Name(), " failed.");
+  if (stop_blob_ && stop_blob_->IsType<TensorCPU>()) {
+    const auto& stop = stop_blob_->Get<TensorCPU>();
+    if (stop.size() > 0 && stop.data<bool>()[0]) {
+      return false;
+    }
+  }
+  // The net gets the buffers of the previous batch back.
+  for (int i = 0; i < outputs.size(); ++i) {
+    outputs[i]->swap(*blobs_[i]);
+  }
+  return true;
+}
+
+DataWorkers::DataWorkers(
+    std::shared_ptr<BlobsQueue> queue,
+    int num_workers,
+    const FetcherFactory& factory)
+    : queue_(std::move(queue)), states_(num_workers) {
+  CAFFE_ENFORCE(queue_);
+  CAFFE_ENFORCE_GE(num_workers, 1, "num_workers must be positive.");
+  for (int i = 0; i < num_workers; ++i) {
+    fetchers_.push_back(factory(i));
+    CAFFE_ENFORCE(fetchers_.back(), "No fetcher for data worker ", i);
+  }
+}
+
+DataWorkers::~DataWorkers() {
+  Stop();
+}
+
+void DataWorkers::Start() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  CAFFE_ENFORCE(!started_, "Data workers can only be started once.");
+  started_ = true;
+  num_active_ = fetchers_.size();
+  for (int i = 0; i < fetchers_.size(); ++i) {
+    threads_.emplace_back([this, i]() { Run(i); });
+  }
+}
+
+void DataWorkers::Stop() {
+  stop_ = true;
+  queue_->close();
+  Wait();
+}
+
+void DataWorkers::Wait() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto& thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+std::vector<DataWorkers::WorkerStats> DataWorkers::Stats() const {
+  std::vector<WorkerStats> stats;
+  for (const auto& state : states_) {
+    stats.push_back(
+        {state.batches, state.fetch_usecs, state.enqueue_usecs});
+  }
+  return stats;
+}
+
+void DataWorkers::Run(int worker_id) {
+  using Clock = std::chrono::steady_clock;
+  auto usecs = [](Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from)
+        .count();
+  };
+  auto& state = states_[worker_id];
+  // Owned by the worker, the queue swaps its buffers with them.
+  std::vector<Blob> blobs(queue_->getNumBlobs());
+  std::vector<Blob*> outputs;
+  for (auto& blob : blobs) {
+    outputs.push_back(&blob);
+  }
+  try {
+    while (!stop_) {
+      const auto start = Clock::now();
+      if (!fetchers_[worker_id]->Fetch(outputs)) {
+        break;
+      }
+      const auto fetched = Clock::now();
+      if (!queue_->blockingWrite(outputs)) {
+        // Closed.
+        break;
+      }
+      state.fetch_usecs += usecs(start, fetched);
+      state.enqueue_usecs += usecs(fetched, Clock::now());
+      ++state.batches;
+    }
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Data worker " << worker_id << " failed: " << e.what();
+    failed_ = true;
+    stop_ = true;
+  }
+  if (--num_active_ == 0 || failed_) {
+    queue_->close();
+  }
+}
+
+} // namespace caffe2
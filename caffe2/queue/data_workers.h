@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/blob.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/registry.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/queue/blobs_queue.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+// Produces the batches of a data worker. Every worker has a fetcher of its
+// own, so fetchers don't need to be thread-safe.
+class DataFetcherBase {
+ public:
+  virtual ~DataFetcherBase() {}
+
+  // Fills outputs, one blob per blob of the queue, with the next batch.
+  // Returns false once there is no more data.
+  virtual bool Fetch(const std::vector<Blob*>& outputs) = 0;
+};
+
+// C++ fetchers are registered by name, and are created with the id of their
+// worker and the arguments of the CreateDataWorkers operator.
+CAFFE_DECLARE_REGISTRY(
+    DataFetcherRegistry,
+    DataFetcherBase,
+    int,
+    const ArgumentHelper&);
+#define REGISTER_DATA_FETCHER(name, ...) \
+  CAFFE_REGISTER_CLASS(DataFetcherRegistry, name, __VA_ARGS__)
+
+// Runs a net in a workspace of its own, which sees the blobs of the parent
+// workspace, e.g. a shared reader, and hands out the given outputs of the net.
+// If stop_blob is given, it is a bool tensor set by the net once there is no
+// more data, as for execution steps.
+class NetDataFetcher final : public DataFetcherBase {
+ public:
+  NetDataFetcher(
+      const NetDef& net_def,
+      const std::vector<std::string>& outputs,
+      const std::string& stop_blob,
+      const Workspace* parent);
+
+  bool Fetch(const std::vector<Blob*>& outputs) override;
+
+ private:
+  Workspace ws_;
+  NetBase* net_;
+  std::vector<Blob*> blobs_;
+  Blob* stop_blob_{nullptr};
+};
+
+// Runs a fetcher per worker thread and writes the fetched batches into a
+// queue. The buffers of a batch are swapped into the queue, not copied.
+//
+// Workers run from Start() until Stop(), until they run out of data, or until
+// one of them fails. Stop() closes the queue so that blocked workers wake up,
+// as do the last worker that exits and a failing worker, so that readers of
+// the queue get the remaining batches and then see it closed. Since the queue
+// can't be reopened, workers can't be restarted.
+class DataWorkers {
+ public:
+  using FetcherFactory =
+      std::function<std::unique_ptr<DataFetcherBase>(int worker_id)>;
+
+  struct WorkerStats {
+    int64_t batches;
+    int64_t fetch_usecs;
+    int64_t enqueue_usecs;
+  };
+
+  DataWorkers(
+      std::shared_ptr<BlobsQueue> queue,
+      int num_workers,
+      const FetcherFactory& factory);
+  ~DataWorkers();
+
+  void Start();
+  void Stop();
+  // Blocks until all workers exited.
+  void Wait();
+
+  bool IsActive() const {
+    return num_active_ > 0;
+  }
+  int num_active() const {
+    return num_active_;
+  }
+  int num_workers() const {
+    return fetchers_.size();
+  }
+  // Whether a fetcher threw.
+  bool failed() const {
+    return failed_;
+  }
+  // Per worker, since Start().
+  std::vector<WorkerStats> Stats() const;
+
+ private:
+  struct WorkerState {
+    std::atomic<int64_t> batches{0};
+    std::atomic<int64_t> fetch_usecs{0};
+    std::atomic<int64_t> enqueue_usecs{0};
+  };
+
+  void Run(int worker_id);
+
+  std::shared_ptr<BlobsQueue> queue_;
+  std::vector<std::unique_ptr<DataFetcherBase>> fetchers_;
+  std::vector<WorkerState> states_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_; // protects threads_ and started_.
+  bool started_{false};
+  std::atomic<bool> stop_{false};
+  std::atomic<bool> failed_{false};
+  std::atomic<int> num_active_{0};
+};
+
+} // namespace caffe2
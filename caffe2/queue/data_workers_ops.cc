@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/queue/data_workers.h"
+
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+using DataWorkersPtr = std::shared_ptr<DataWorkers>;
+CAFFE_KNOWN_TYPE(DataWorkersPtr);
+
+namespace {
+
+class CreateDataWorkersOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  CreateDataWorkersOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        ws_(ws),
+        num_workers_(GetSingleArgument<int>("num_workers", 2)),
+        fetcher_(GetSingleArgument<std::string>("fetcher", "")),
+        fetch_outputs_(GetRepeatedArgument<std::string>("fetch_outputs")),
+        fetch_stop_blob_(
+            GetSingleArgument<std::string>("fetch_stop_blob", "")) {
+    CAFFE_ENFORCE(
+        fetcher_.empty() != !HasArgument("fetch_net"),
+        "Exactly one of fetcher and fetch_net must be given.");
+  }
+
+  bool RunOnDevice() override {
+    const auto& queue =
+        OperatorBase::Input<std::shared_ptr<BlobsQueue>>(0);
+    DataWorkers::FetcherFactory factory;
+    if (fetcher_.empty()) {
+      const auto net_def = GetSingleArgument<NetDef>("fetch_net", NetDef());
+      std::vector<std::string> outputs(fetch_outputs_);
+      if (outputs.empty()) {
+        outputs.assign(
+            net_def.external_output().begin(), net_def.external_output().end());
+      }
+      CAFFE_ENFORCE_EQ(
+          outputs.size(),
+          queue->getNumBlobs(),
+          "The fetch net needs an output per blob of the queue.");
+      const Workspace* ws = ws_;
+      const std::string stop_blob = fetch_stop_blob_;
+      factory = [net_def, outputs, stop_blob, ws](int /* unused */) {
+        return std::unique_ptr<DataFetcherBase>(
+            new NetDataFetcher(net_def, outputs, stop_blob, ws));
+      };
+    } else {
+      CAFFE_ENFORCE(
+          DataFetcherRegistry()->Has(fetcher_),
+          "Unknown data fetcher: ",
+          fetcher_);
+      const ArgumentHelper args(debug_def());
+      const std::string fetcher = fetcher_;
+      factory = [fetcher, args](int worker_id) {
+        return DataFetcherRegistry()->Create(fetcher, worker_id, args);
+      };
+    }
+    *OperatorBase::Output<DataWorkersPtr>(0) =
+        std::make_shared<DataWorkers>(queue, num_workers_, factory);
+    return true;
+  }
+
+ private:
+  Workspace* ws_;
+  int num_workers_;
+  std::string fetcher_;
+  std::vector<std::string> fetch_outputs_;
+  std::string fetch_stop_blob_;
+};
+
+class StartDataWorkersOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  StartDataWorkersOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    OperatorBase::Input<DataWorkersPtr>(0)->Start();
+    return true;
+  }
+};
+
+class StopDataWorkersOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  StopDataWorkersOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    OperatorBase::Input<DataWorkersPtr>(0)->Stop();
+    return true;
+  }
+};
+
+class DataWorkersStatsOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  DataWorkersStatsOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    const auto& workers = OperatorBase::Input<DataWorkersPtr>(0);
+    const auto stats = workers->Stats();
+    auto* output = Output(0);
+    output->Resize(stats.size(), 3);
+    auto* data = output->mutable_data<int64_t>();
+    for (const auto& s : stats) {
+      *data++ = s.batches;
+      *data++ = s.fetch_usecs;
+      *data++ = s.enqueue_usecs;
+    }
+    if (OutputSize() > 1) {
+      auto* active = Output(1);
+      active->Resize();
+      *active->mutable_data<int>() = workers->num_active();
+    }
+    return true;
+  }
+};
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(CreateDataWorkers, CreateDataWorkersOp);
+REGISTER_CPU_OPERATOR(StartDataWorkers, StartDataWorkersOp);
+REGISTER_CPU_OPERATOR(StopDataWorkers, StopDataWorkersOp);
+REGISTER_CPU_OPERATOR(DataWorkersStats, DataWorkersStatsOp);
+
+OPERATOR_SCHEMA(CreateDataWorkers)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Creates data workers that fetch batches on threads of their own and write them
+into a BlobsQueue, without going through Python. Each worker either runs a C++
+fetcher registered with REGISTER_DATA_FETCHER, which gets the arguments of this
+operator, or a fetch net in a workspace of its own that sees the blobs of the
+current workspace. The workers are run by StartDataWorkers until they run out
+of data or StopDataWorkers is run, after which the queue is closed.
+)DOC")
+    .Arg("num_workers", "(int, default 2) Number of worker threads.")
+    .Arg("fetcher", "(string) Name of a registered C++ fetcher.")
+    .Arg("fetch_net", "(NetDef) Net run by each worker to fetch a batch.")
+    .Arg(
+        "fetch_outputs",
+        "(strings) Blobs of the fetch net that make a batch, one per blob of "
+        "the queue. Defaults to the external outputs of the fetch net.")
+    .Arg(
+        "fetch_stop_blob",
+        "(string) Bool blob set by the fetch net once it ran out of data.")
+    .Input(0, "queue", "The queue the batches are written into.")
+    .Output(0, "workers", "The data workers.");
+
+OPERATOR_SCHEMA(StartDataWorkers)
+    .NumInputs(1)
+    .NumOutputs(0)
+    .SetDoc("Starts the threads of data workers, which can be done only once.")
+    .Input(0, "workers", "The data workers.");
+
+OPERATOR_SCHEMA(StopDataWorkers)
+    .NumInputs(1)
+    .NumOutputs(0)
+    .SetDoc(R"DOC(
+Stops data workers and waits for their threads to exit. The queue is closed, so
+that blocked workers wake up and readers get the batches left in it.
+)DOC")
+    .Input(0, "workers", "The data workers.");
+
+OPERATOR_SCHEMA(DataWorkersStats)
+    .NumInputs(1)
+    .NumOutputs(1, 2)
+    .SetDoc(R"DOC(
+Returns, for each data worker, the number of batches it wrote, and the time in
+microseconds it spent fetching them and writing them into the queue, the
+latter being the time it waited for readers.
+)DOC")
+    .Input(0, "workers", "The data workers.")
+    .Output(0, "stats", "int64 tensor of shape (num_workers, 3).")
+    .Output(1, "num_active", "Number of workers still running.");
+
+SHOULD_NOT_DO_GRADIENT(CreateDataWorkers);
+SHOULD_NOT_DO_GRADIENT(StartDataWorkers);
+SHOULD_NOT_DO_GRADIENT(StopDataWorkers);
+SHOULD_NOT_DO_GRADIENT(DataWorkersStats);
+
+} // namespace caffe2
@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/queue/blobs_queue.h"
+#include "caffe2/queue/data_workers.h"
+
+namespace caffe2 {
+namespace {
+
+// Produces num_batches batches holding worker_id * 1000 + i.
+class CountingFetcher final : public DataFetcherBase {
+ public:
+  CountingFetcher(int worker_id, const ArgumentHelper& args)
+      : worker_id_(worker_id),
+        num_batches_(args.GetSingleArgument<int>("num_batches", 10)) {}
+
+  bool Fetch(const std::vector<Blob*>& outputs) override {
+    if (next_ == num_batches_) {
+      return false;
+    }
+    auto* tensor = outputs[0]->GetMutable<TensorCPU>();
+    tensor->Resize(1);
+    tensor->mutable_data<int>()[0] = worker_id_ * 1000 + next_++;
+    return true;
+  }
+
+ private:
+  int worker_id_;
+  int num_batches_;
+  int next_{0};
+};
+
+REGISTER_DATA_FETCHER(DataWorkersTestCounting, CountingFetcher);
+
+// Sets its output to the number of times it ran.
+class DataWorkersTestCountOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  DataWorkersTestCountOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    Output(0)->Resize(1);
+    Output(0)->mutable_data<int>()[0] = count_++;
+    return true;
+  }
+
+ private:
+  int count_{0};
+};
+
+REGISTER_CPU_OPERATOR(DataWorkersTestCount, DataWorkersTestCountOp);
+OPERATOR_SCHEMA(DataWorkersTestCount).NumInputs(0).NumOutputs(1);
+
+std::vector<int> readAll(BlobsQueue* queue) {
+  std::vector<int> values;
+  Blob blob;
+  while (queue->blockingRead({&blob})) {
+    values.push_back(blob.Get<TensorCPU>().data<int>()[0]);
+  }
+  return values;
+}
+
+std::unique_ptr<DataWorkers> createCountingWorkers(
+    std::shared_ptr<BlobsQueue> queue,
+    int num_workers,
+    int num_batches) {
+  OperatorDef def;
+  auto* arg = def.add_arg();
+  arg->set_name("num_batches");
+  arg->set_i(num_batches);
+  const ArgumentHelper args(def);
+  return caffe2::make_unique<DataWorkers>(
+      queue, num_workers, [args](int worker_id) {
+        return DataFetcherRegistry()->Create(
+            "DataWorkersTestCounting", worker_id, args);
+      });
+}
+
+} // namespace
+
+TEST(DataWorkersTest, WorkersRunUntilOutOfData) {
+  Workspace ws;
+  auto queue = std::make_shared<BlobsQueue>(&ws, "queue", 4, 1, true);
+  auto workers = createCountingWorkers(queue, 3, 100);
+  workers->Start();
+  // The last worker to run out of data closes the queue.
+  const auto values = readAll(queue.get());
+  workers->Wait();
+  EXPECT_FALSE(workers->IsActive());
+  EXPECT_FALSE(workers->failed());
+  ASSERT_EQ(values.size(), 300);
+  const std::set<int> unique(values.begin(), values.end());
+  EXPECT_EQ(unique.size(), 300);
+  const auto stats = workers->Stats();
+  ASSERT_EQ(stats.size(), 3);
+  for (const auto& s : stats) {
+    EXPECT_EQ(s.batches, 100);
+  }
+}
+
+TEST(DataWorkersTest, StopWakesUpBlockedWorkers) {
+  Workspace ws;
+  auto queue = std::make_shared<BlobsQueue>(&ws, "queue", 2, 1, true);
+  auto workers = createCountingWorkers(queue, 2, 1000000);
+  workers->Start();
+  Blob blob;
+  ASSERT_TRUE(queue->blockingRead({&blob}));
+  workers->Stop();
+  EXPECT_FALSE(workers->IsActive());
+  EXPECT_ANY_THROW(workers->Start());
+}
+
+TEST(DataWorkersTest, Operators) {
+  Workspace ws;
+  OperatorDef def;
+  def.set_type("CreateBlobsQueue");
+  def.add_output("queue");
+  auto* arg = def.add_arg();
+  arg->set_name("capacity");
+  arg->set_i(4);
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+
+  NetDef fetch_net;
+  fetch_net.set_name("fetch");
+  auto* op = fetch_net.add_op();
+  op->set_type("DataWorkersTestCount");
+  op->add_output("batch");
+  fetch_net.add_external_output("batch");
+
+  def.Clear();
+  def.set_type("CreateDataWorkers");
+  def.add_input("queue");
+  def.add_output("workers");
+  arg = def.add_arg();
+  arg->set_name("num_workers");
+  arg->set_i(2);
+  arg = def.add_arg();
+  arg->set_name("fetch_net");
+  *arg->mutable_n() = fetch_net;
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+
+  def.Clear();
+  def.set_type("StartDataWorkers");
+  def.add_input("workers");
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+
+  auto queue = ws.GetBlob("queue")->Get<std::shared_ptr<BlobsQueue>>();
+  // Each worker runs a net of its own, counting its batches.
+  Blob blob;
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(queue->blockingRead({&blob}));
+    EXPECT_LT(blob.Get<TensorCPU>().data<int>()[0], 10);
+  }
+
+  def.set_type("StopDataWorkers");
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+
+  def.set_type("DataWorkersStats");
+  def.add_output("stats");
+  def.add_output("num_active");
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+  const auto& stats = ws.GetBlob("stats")->Get<TensorCPU>();
+  ASSERT_EQ(stats.dims(), std::vector<TIndex>({2, 3}));
+  EXPECT_GE(stats.data<int64_t>()[0] + stats.data<int64_t>()[3], 10);
+  EXPECT_EQ(ws.GetBlob("num_active")->Get<TensorCPU>().data<int>()[0], 0);
+}
+
+} // namespace caffe2
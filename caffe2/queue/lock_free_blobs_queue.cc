@@ -0,0 +1,226 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/queue/lock_free_blobs_queue.h"
+
+#include <chrono>
+#include <mutex>
+
+#include "caffe2/core/blob_stats.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/stats.h"
+
+namespace caffe2 {
+
+// Constants for user tracepoints, see blobs_queue.cc
+static constexpr int SDT_NONBLOCKING_OP = 0;
+static constexpr int SDT_BLOCKING_OP = 1;
+static constexpr uint64_t SDT_TIMEOUT = (uint64_t)-1;
+static constexpr uint64_t SDT_ABORT = (uint64_t)-2;
+static constexpr uint64_t SDT_CANCEL = (uint64_t)-3;
+
+LockFreeBlobsQueue::LockFreeBlobsQueue(
+    Workspace* ws,
+    const std::string& queueName,
+    size_t capacity,
+    size_t numBlobs,
+    bool enforceUniqueName,
+    const std::vector<std::string>& fieldNames)
+    : BlobsQueue(
+          ws,
+          queueName,
+          capacity,
+          numBlobs,
+          enforceUniqueName,
+          fieldNames),
+      capacity_(capacity),
+      slots_(new Slot[capacity]) {
+  CAFFE_ENFORCE_GT(capacity, 0, "Lock-free queue needs a positive capacity.");
+  for (int64_t i = 0; i < capacity_; ++i) {
+    slots_[i].sequence.store(2 * i, std::memory_order_relaxed);
+  }
+}
+
+bool LockFreeBlobsQueue::tryClaimRead(int64_t* pos) {
+  int64_t readPos = readPos_.load(std::memory_order_relaxed);
+  while (true) {
+    const int64_t sequence =
+        slots_[readPos % capacity_].sequence.load(std::memory_order_acquire);
+    const int64_t diff = sequence - (2 * readPos + 1);
+    if (diff == 0) {
+      if (readPos_.compare_exchange_weak(
+              readPos, readPos + 1, std::memory_order_relaxed)) {
+        *pos = readPos;
+        return true;
+      }
+    } else if (diff < 0) {
+      // The writer of this slot has not published it yet.
+      return false;
+    } else {
+      readPos = readPos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool LockFreeBlobsQueue::tryClaimWrite(int64_t* pos) {
+  int64_t writePos = writePos_.load(std::memory_order_relaxed);
+  while (true) {
+    const int64_t sequence =
+        slots_[writePos % capacity_].sequence.load(std::memory_order_acquire);
+    const int64_t diff = sequence - 2 * writePos;
+    if (diff == 0) {
+      if (writePos_.compare_exchange_weak(
+              writePos, writePos + 1, std::memory_order_relaxed)) {
+        *pos = writePos;
+        return true;
+      }
+    } else if (diff < 0) {
+      // The reader of this slot has not released it yet.
+      return false;
+    } else {
+      writePos = writePos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void LockFreeBlobsQueue::doRead(const std::vector<Blob*>& inputs, int64_t pos) {
+  auto& result = queue_[pos % capacity_];
+  CAFFE_ENFORCE(inputs.size() >= result.size());
+  for (auto i = 0; i < result.size(); ++i) {
+    auto bytes = BlobStat::sizeBytes(*result[i]);
+    CAFFE_EVENT(stats_, queue_dequeued_bytes, bytes, i);
+    using std::swap;
+    swap(*(inputs[i]), *(result[i]));
+  }
+  CAFFE_SDT(
+      queue_read_end,
+      name_.c_str(),
+      (void*)this,
+      writePos_.load(std::memory_order_relaxed) - pos - 1);
+  CAFFE_EVENT(stats_, queue_dequeued_records);
+  slots_[pos % capacity_].sequence.store(
+      2 * (pos + capacity_), std::memory_order_release);
+  notifyWaiters();
+}
+
+void LockFreeBlobsQueue::doWrite(
+    const std::vector<Blob*>& inputs,
+    int64_t pos) {
+  auto& result = queue_[pos % capacity_];
+  CAFFE_ENFORCE(inputs.size() >= result.size());
+  for (auto i = 0; i < result.size(); ++i) {
+    using std::swap;
+    swap(*(inputs[i]), *(result[i]));
+  }
+  CAFFE_SDT(
+      queue_write_end,
+      name_.c_str(),
+      (void*)this,
+      readPos_.load(std::memory_order_relaxed) + capacity_ - pos - 1);
+  slots_[pos % capacity_].sequence.store(
+      2 * pos + 1, std::memory_order_release);
+  notifyWaiters();
+}
+
+void LockFreeBlobsQueue::notifyWaiters() {
+  // Pairs with the increment of numWaiters_ in the blocking calls: either the
+  // sleeping thread sees the slot we just published when it checks the queue
+  // again under mutex_, or we see it waiting here.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (numWaiters_.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> g(mutex_);
+    cv_.notify_all();
+  }
+}
+
+bool LockFreeBlobsQueue::blockingRead(
+    const std::vector<Blob*>& inputs,
+    float timeout_secs) {
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_read_start, name, (void*)this, SDT_BLOCKING_OP);
+  CAFFE_EVENT(stats_, queue_balance, -1);
+  int64_t pos = 0;
+  bool claimed = tryClaimRead(&pos);
+  if (!claimed) {
+    std::unique_lock<std::mutex> g(mutex_);
+    ++numWaiters_;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto ready = [this, &pos, &claimed]() {
+      claimed = tryClaimRead(&pos);
+      return claimed || closing_;
+    };
+    if (timeout_secs > 0) {
+      std::chrono::milliseconds timeout_ms(int(timeout_secs * 1000));
+      cv_.wait_for(g, timeout_ms, ready);
+    } else {
+      cv_.wait(g, ready);
+    }
+    --numWaiters_;
+    if (!claimed) {
+      if (timeout_secs > 0 && !closing_) {
+        LOG(ERROR) << "DequeueBlobs timed out in " << timeout_secs << " secs";
+        CAFFE_SDT(queue_read_end, name, (void*)this, SDT_TIMEOUT);
+      } else {
+        CAFFE_SDT(queue_read_end, name, (void*)this, SDT_CANCEL);
+      }
+      return false;
+    }
+  }
+  doRead(inputs, pos);
+  return true;
+}
+
+bool LockFreeBlobsQueue::tryWrite(const std::vector<Blob*>& inputs) {
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_write_start, name, (void*)this, SDT_NONBLOCKING_OP);
+  int64_t pos = 0;
+  if (!tryClaimWrite(&pos)) {
+    CAFFE_SDT(queue_write_end, name, (void*)this, SDT_ABORT);
+    return false;
+  }
+  CAFFE_EVENT(stats_, queue_balance, 1);
+  doWrite(inputs, pos);
+  return true;
+}
+
+bool LockFreeBlobsQueue::blockingWrite(const std::vector<Blob*>& inputs) {
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_write_start, name, (void*)this, SDT_BLOCKING_OP);
+  CAFFE_EVENT(stats_, queue_balance, 1);
+  int64_t pos = 0;
+  bool claimed = tryClaimWrite(&pos);
+  if (!claimed) {
+    std::unique_lock<std::mutex> g(mutex_);
+    ++numWaiters_;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cv_.wait(g, [this, &pos, &claimed]() {
+      claimed = tryClaimWrite(&pos);
+      return claimed || closing_;
+    });
+    --numWaiters_;
+    if (!claimed) {
+      CAFFE_SDT(queue_write_end, name, (void*)this, SDT_ABORT);
+      return false;
+    }
+  }
+  doWrite(inputs, pos);
+  return true;
+}
+
+} // namespace caffe2
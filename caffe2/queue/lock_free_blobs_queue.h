@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "caffe2/queue/blobs_queue.h"
+
+namespace caffe2 {
+
+// A BlobsQueue whose reads and writes do not take a lock when the queue
+// neither is empty nor full.
+//
+// It is a bounded multi-producer multi-consumer ring buffer where every slot
+// carries a sequence number. A writer claims the slot at the write position
+// with a compare-and-swap once the slot's sequence number says the slot is
+// free, swaps the blobs in and then publishes the slot by bumping its
+// sequence number; readers do the same from the read position. Claimed slots
+// are owned by a single thread, so the blob swaps themselves run without any
+// synchronization. Only threads that find the queue empty or full fall back
+// to sleeping on the condition variable of BlobsQueue, and they are woken up
+// only if some thread is actually sleeping. Blocking, timeout and close()
+// semantics and the exported stats are the same as for BlobsQueue.
+class LockFreeBlobsQueue : public BlobsQueue {
+ public:
+  LockFreeBlobsQueue(
+      Workspace* ws,
+      const std::string& queueName,
+      size_t capacity,
+      size_t numBlobs,
+      bool enforceUniqueName,
+      const std::vector<std::string>& fieldNames = {});
+
+  bool blockingRead(const std::vector<Blob*>& inputs, float timeout_secs = 0.0f)
+      override;
+  bool tryWrite(const std::vector<Blob*>& inputs) override;
+  bool blockingWrite(const std::vector<Blob*>& inputs) override;
+
+ private:
+  // The slot at position pos (modulo the capacity) is free for the writer of
+  // pos when its sequence number is 2 * pos, and holds a record for the
+  // reader of pos when it is 2 * pos + 1. Doubling the positions keeps the
+  // two states apart even for a capacity of one.
+  //
+  // Padded to a cache line so that neighbouring slots do not share one.
+  struct Slot {
+    std::atomic<int64_t> sequence;
+    char padding[64 - sizeof(std::atomic<int64_t>)];
+  };
+
+  // Claim the slot at the read or write position, return false if the queue
+  // is empty or full respectively.
+  bool tryClaimRead(int64_t* pos);
+  bool tryClaimWrite(int64_t* pos);
+  void doRead(const std::vector<Blob*>& inputs, int64_t pos);
+  void doWrite(const std::vector<Blob*>& inputs, int64_t pos);
+  // Wakes up the threads sleeping in blockingRead() or blockingWrite().
+  void notifyWaiters();
+
+  const int64_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  char padding0_[64];
+  std::atomic<int64_t> readPos_{0};
+  char padding1_[64 - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> writePos_{0};
+  char padding2_[64 - sizeof(std::atomic<int64_t>)];
+  // Number of threads sleeping on cv_.
+  std::atomic<int> numWaiters_{0};
+};
+
+} // namespace caffe2
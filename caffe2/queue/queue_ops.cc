@@ -32,7 +32,20 @@ REGISTER_CPU_OPERATOR(
     WeightedSampleDequeueBlobs,
     WeightedSampleDequeueBlobsOp<CPUContext>);
 
-OPERATOR_SCHEMA(CreateBlobsQueue).NumInputs(0).NumOutputs(1);
+OPERATOR_SCHEMA(CreateBlobsQueue)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .Arg("capacity", "(int, default 1) Maximal number of records in the queue")
+    .Arg("num_blobs", "(int, default 1) Number of blobs in every record")
+    .Arg(
+        "enforce_unique_name",
+        "(bool, default false) Fail if the internal blobs of the queue "
+        "already exist in the workspace")
+    .Arg("field_names", "(list of strings) Names of the blobs, for the stats")
+    .Arg(
+        "lock_free",
+        "(bool, default false) Use a lock-free ring buffer, which scales "
+        "better when many threads enqueue and dequeue at the same time");
 OPERATOR_SCHEMA(EnqueueBlobs)
     .NumInputsOutputs([](int inputs, int outputs) {
       return inputs >= 2 && outputs >= 1 && inputs == outputs + 1;
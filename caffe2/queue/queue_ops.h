@@ -19,6 +19,7 @@
 #include <memory>
 #include "blobs_queue.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/queue/lock_free_blobs_queue.h"
 
 namespace caffe2 {
 
@@ -42,12 +43,19 @@ class CreateBlobsQueueOp final : public Operator<Context> {
             "enforce_unique_name", false);
     const auto fieldNames =
         OperatorBase::template GetRepeatedArgument<std::string>("field_names");
+    const auto lockFree =
+        OperatorBase::template GetSingleArgument<bool>("lock_free", false);
     CAFFE_ENFORCE_EQ(this->OutputSize(), 1);
     auto queuePtr = Operator<Context>::Outputs()[0]
                         ->template GetMutable<std::shared_ptr<BlobsQueue>>();
     CAFFE_ENFORCE(queuePtr);
-    *queuePtr = std::make_shared<BlobsQueue>(
-        ws_, name, capacity, numBlobs, enforceUniqueName, fieldNames);
+    if (lockFree) {
+      *queuePtr = std::make_shared<LockFreeBlobsQueue>(
+          ws_, name, capacity, numBlobs, enforceUniqueName, fieldNames);
+    } else {
+      *queuePtr = std::make_shared<BlobsQueue>(
+          ws_, name, capacity, numBlobs, enforceUniqueName, fieldNames);
+    }
     return true;
   }
 
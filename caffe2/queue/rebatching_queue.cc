@@ -15,17 +15,59 @@
  */
 
 #include "rebatching_queue.h"
-#include "caffe2/utils/smart_tensor_printer.h"
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
 
 namespace caffe2 {
 
 namespace {
 
+// Fewer bytes than this per thread are not worth the dispatch overhead.
+constexpr size_t kMinBytesPerChunk = 64 * 1024;
+
+// Runs fn(begin, end) over [0, costs.size()), split into at most numThreads
+// contiguous chunks of roughly the same total cost, on the workspace thread
+// pool if there is more than one chunk.
+void runBalanced(
+    ThreadPool* threadPool,
+    int numThreads,
+    const std::vector<size_t>& costs,
+    const std::function<void(size_t, size_t)>& fn) {
+  const size_t totalCost =
+      std::accumulate(costs.begin(), costs.end(), size_t(0));
+  const size_t numChunks = threadPool
+      ? std::min<size_t>(
+            std::min<size_t>(numThreads, costs.size()),
+            totalCost / kMinBytesPerChunk)
+      : 1;
+  if (numChunks <= 1) {
+    fn(0, costs.size());
+    return;
+  }
+  std::vector<size_t> starts(numChunks + 1, costs.size());
+  starts[0] = 0;
+  size_t chunk = 1;
+  size_t cost = 0;
+  for (size_t i = 0; i < costs.size() && chunk < numChunks; ++i) {
+    if (cost >= chunk * totalCost / numChunks) {
+      starts[chunk++] = i;
+    }
+    cost += costs[i];
+  }
+  threadPool->runChunks(
+      [&](int /* unused */, size_t c) { fn(starts[c], starts[c + 1]); },
+      numChunks);
+}
+
 // This concat function will always create a new first dimension to concat
 void concat(
     CPUContext& context,
     const std::vector<std::vector<TensorCPU>>& inputs,
-    const std::vector<TensorCPU*>& outputs) {
+    const std::vector<TensorCPU*>& outputs,
+    ThreadPool* threadPool,
+    int numThreads) {
   CAFFE_ENFORCE(!inputs.empty());
 
   const auto& inputZero = inputs[0];
@@ -36,18 +78,10 @@ void concat(
   std::vector<std::vector<TIndex>> outputDims(numTensors);
 
   for (int i = 0; i < numTensors; ++i) {
-    SmartTensorPrinter::PrintTensor(inputZero.at(i));
     outputDims[i] = inputZero.at(i).dims();
     outputDims[i].insert(outputDims[i].begin(), numRows);
   }
 
-  // Resize to the final output size
-  std::vector<void*> destinations(numTensors);
-  for (int i = 0; i < numTensors; ++i) {
-    outputs[i]->Resize(outputDims[i]);
-    destinations[i] = outputs[i]->raw_mutable_data(inputZero[i].meta());
-  }
-
   for (int i = 0; i < numRows; ++i) {
     CAFFE_ENFORCE_EQ(inputs[i].size(), numTensors);
 
@@ -60,55 +94,90 @@ void concat(
       for (int k = 0; k < input.ndim(); ++k) {
         CAFFE_ENFORCE_EQ(input.dims()[k], inputZero[j].dims()[k]);
       }
-
-      // Skip empty tensors
-      if (input.size() == 0) {
-        continue;
-      }
-
-      context.CopyItems<CPUContext, CPUContext>(
-          input.meta(),
-          input.size(),
-          input.raw_data() /* src */,
-          destinations[j] /* dst */
-          );
-
-      destinations[j] =
-          (char*)destinations[j] + input.size() * input.itemsize();
     }
   }
+
+  // Resize to the final output size
+  std::vector<void*> destinations(numTensors);
+  std::vector<size_t> columnBytes(numTensors);
+  for (int i = 0; i < numTensors; ++i) {
+    outputs[i]->Resize(outputDims[i]);
+    destinations[i] = outputs[i]->raw_mutable_data(inputZero[i].meta());
+    columnBytes[i] = outputs[i]->nbytes();
+  }
+
+  // Every output tensor is filled independently of the others, so the
+  // columns are spread over the threads.
+  runBalanced(
+      threadPool, numThreads, columnBytes, [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; ++j) {
+          auto* dst = static_cast<char*>(destinations[j]);
+          for (int i = 0; i < numRows; ++i) {
+            const auto& input = inputs[i][j];
+
+            // Skip empty tensors
+            if (input.size() == 0) {
+              continue;
+            }
+
+            context.CopyItems<CPUContext, CPUContext>(
+                input.meta(),
+                input.size(),
+                input.raw_data() /* src */,
+                dst /* dst */
+                );
+
+            dst += input.size() * input.itemsize();
+          }
+        }
+      });
 }
 
 std::vector<std::vector<TensorCPU>> split(
     CPUContext& context,
-    const std::vector<const TensorCPU*>& inputs) {
+    const std::vector<const TensorCPU*>& inputs,
+    ThreadPool* threadPool,
+    int numThreads) {
   CAFFE_ENFORCE(!inputs.empty());
 
   const auto outputSize = inputs[0]->dims().at(0);
   std::vector<std::vector<TensorCPU>> outputs(outputSize);
 
+  size_t rowBytes = 0;
   for (const auto* inputPtr : inputs) {
     CAFFE_ENFORCE(inputPtr);
-
-    const auto& input = *inputPtr;
-    const auto innerSize = input.size_from_dim(1);
-    const auto itemSize = input.meta().itemsize();
-
-    auto outputDims = input.dims();
-    CAFFE_ENFORCE(!outputDims.empty());
-    outputDims.erase(outputDims.begin());
-    CAFFE_ENFORCE_EQ(input.dims().at(0), outputSize);
-
-    for (int i = 0; i < outputSize; ++i) {
-      outputs[i].push_back(TensorCPU(outputDims));
-      context.CopyItems<CPUContext, CPUContext>(
-          input.meta(),
-          innerSize,
-          (char*)input.raw_data() + i * innerSize * itemSize /* src */,
-          outputs[i].back().raw_mutable_data(input.meta()) /* dst */);
-    }
+    CAFFE_ENFORCE(!inputPtr->dims().empty());
+    CAFFE_ENFORCE_EQ(inputPtr->dims().at(0), outputSize);
+    rowBytes += inputPtr->size_from_dim(1) * inputPtr->meta().itemsize();
   }
 
+  // Every row is split off independently of the others, so the rows are
+  // spread over the threads.
+  runBalanced(
+      threadPool,
+      numThreads,
+      std::vector<size_t>(outputSize, rowBytes),
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          outputs[i].reserve(inputs.size());
+          for (const auto* inputPtr : inputs) {
+            const auto& input = *inputPtr;
+            const auto innerSize = input.size_from_dim(1);
+            const auto itemSize = input.meta().itemsize();
+
+            auto outputDims = input.dims();
+            outputDims.erase(outputDims.begin());
+
+            outputs[i].push_back(TensorCPU(outputDims));
+            context.CopyItems<CPUContext, CPUContext>(
+                input.meta(),
+                innerSize,
+                (char*)input.raw_data() + i * innerSize * itemSize /* src */,
+                outputs[i].back().raw_mutable_data(input.meta()) /* dst */);
+          }
+        }
+      });
+
   return outputs;
 }
 } // anonymous namespace
@@ -127,7 +196,9 @@ bool RebatchingQueue::canRead() const {
 bool RebatchingQueue::dequeue(
     CPUContext& context,
     size_t numElements,
-    const std::vector<TensorCPU*>& outputs) {
+    const std::vector<TensorCPU*>& outputs,
+    ThreadPool* threadPool,
+    int numThreads) {
   std::vector<std::vector<TensorCPU>> results;
   results.reserve(numElements);
 
@@ -162,7 +233,7 @@ bool RebatchingQueue::dequeue(
     return false;
   }
 
-  concat(context, results, outputs);
+  concat(context, results, outputs, threadPool, numThreads);
 
   return true;
 }
@@ -187,11 +258,13 @@ bool RebatchingQueue::enqueueOne(
 
 bool RebatchingQueue::enqueueMany(
     CPUContext& context,
-    const std::vector<const TensorCPU*>& inputs) {
+    const std::vector<const TensorCPU*>& inputs,
+    ThreadPool* threadPool,
+    int numThreads) {
   CAFFE_ENFORCE_EQ(numBlobs_, inputs.size());
 
   std::vector<std::vector<TensorCPU>> splittedInputs;
-  splittedInputs = split(context, inputs);
+  splittedInputs = split(context, inputs, threadPool, numThreads);
   return enqueue(std::move(splittedInputs));
 }
 
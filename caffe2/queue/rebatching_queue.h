@@ -26,6 +26,7 @@
 #include "caffe2/core/operator.h"
 #include "caffe2/core/stats.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
@@ -43,14 +44,21 @@ class RebatchingQueue {
       CPUContext& context,
       const std::vector<const TensorCPU*>& inputs);
 
+  // Splitting a batch into elements and concatenating elements into a batch
+  // run outside of the queue lock. Given a thread pool, they spread the
+  // copies over up to numThreads of its threads.
   bool enqueueMany(
       CPUContext& context,
-      const std::vector<const TensorCPU*>& inputs);
+      const std::vector<const TensorCPU*>& inputs,
+      ThreadPool* threadPool = nullptr,
+      int numThreads = 1);
 
   bool dequeue(
       CPUContext& context,
       size_t numElements,
-      const std::vector<TensorCPU*>& outputs);
+      const std::vector<TensorCPU*>& outputs,
+      ThreadPool* threadPool = nullptr,
+      int numThreads = 1);
 
   size_t capacity() const;
 
@@ -68,7 +68,11 @@ OPERATOR_SCHEMA(EnqueueRebatchingQueue)
     .Arg(
         "enqueue_batch",
         "Are we enqueuing a batch or just a single element. \
-        By default we enqueue single element.");
+        By default we enqueue single element.")
+    .Arg(
+        "num_threads",
+        "Number of workspace thread pool threads used to split a batch into "
+        "elements. Only used with enqueue_batch. Defaults to 1.");
 
 OPERATOR_SCHEMA(DequeueRebatchingQueue)
     .NumInputs(1)
@@ -84,6 +88,10 @@ OPERATOR_SCHEMA(DequeueRebatchingQueue)
     .Input(1, "tensor", "First tensor to enqueue")
     .Arg(
         "num_elements",
-        "Number of elements to dequeue. By default we dequeue one element.");
+        "Number of elements to dequeue. By default we dequeue one element.")
+    .Arg(
+        "num_threads",
+        "Number of workspace thread pool threads used to concatenate the "
+        "elements, one output tensor per thread at most. Defaults to 1.");
 }
 }
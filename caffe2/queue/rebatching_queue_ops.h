@@ -41,7 +41,11 @@ class EnqueueRebatchingQueueOp : public Operator<CPUContext> {
   EnqueueRebatchingQueueOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator(operator_def, ws),
         enqueueBatch_(
-            OperatorBase::GetSingleArgument<bool>("enqueue_batch", false)) {}
+            OperatorBase::GetSingleArgument<bool>("enqueue_batch", false)),
+        numThreads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(numThreads_, 1, "num_threads must be positive.");
+  }
   bool RunOnDevice() override {
     auto& queue = Inputs()[0]->template Get<RebatchingQueuePtr>();
     CHECK(queue);
@@ -52,19 +56,31 @@ class EnqueueRebatchingQueueOp : public Operator<CPUContext> {
       inputTensors.push_back(&Input(i));
     }
 
-    return enqueueBatch_ ? queue->enqueueMany(context_, inputTensors)
-                         : queue->enqueueOne(context_, inputTensors);
+    if (!enqueueBatch_) {
+      return queue->enqueueOne(context_, inputTensors);
+    }
+    return queue->enqueueMany(
+        context_,
+        inputTensors,
+        numThreads_ > 1 ? ws_->GetThreadPool() : nullptr,
+        numThreads_);
   }
 
  private:
   const bool enqueueBatch_;
+  const int numThreads_;
+  Workspace* ws_;
 };
 
 class DequeueRebatchingQueueOp : public Operator<CPUContext> {
  public:
   DequeueRebatchingQueueOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator(operator_def, ws),
-        numElements_(OperatorBase::GetSingleArgument<int>("num_elements", 1)) {}
+        numElements_(OperatorBase::GetSingleArgument<int>("num_elements", 1)),
+        numThreads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(numThreads_, 1, "num_threads must be positive.");
+  }
 
   bool RunOnDevice() override {
     auto& queue = Inputs()[0]->template Get<RebatchingQueuePtr>();
@@ -76,11 +92,18 @@ class DequeueRebatchingQueueOp : public Operator<CPUContext> {
       outputTensors.push_back(Output(i));
     }
 
-    return queue->dequeue(context_, numElements_, outputTensors);
+    return queue->dequeue(
+        context_,
+        numElements_,
+        outputTensors,
+        numThreads_ > 1 ? ws_->GetThreadPool() : nullptr,
+        numThreads_);
   }
 
  private:
   int numElements_;
+  const int numThreads_;
+  Workspace* ws_;
 };
 
 class CloseRebatchingQueueOp : public Operator<CPUContext> {
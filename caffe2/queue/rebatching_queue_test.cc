@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/queue/rebatching_queue.h"
+
+namespace caffe2 {
+namespace {
+
+// Two components large enough for the copies to be spread over threads: a
+// float matrix and an int vector.
+std::vector<TensorCPU> makeBatch(int numRows, int offset) {
+  std::vector<TensorCPU> batch(2);
+  batch[0].Resize(numRows, 4096);
+  batch[1].Resize(numRows);
+  auto* floats = batch[0].mutable_data<float>();
+  for (int i = 0; i < batch[0].size(); ++i) {
+    floats[i] = offset + i;
+  }
+  auto* ints = batch[1].mutable_data<int>();
+  for (int i = 0; i < numRows; ++i) {
+    ints[i] = offset + i;
+  }
+  return batch;
+}
+
+void rebatch(
+    ThreadPool* threadPool,
+    int numThreads,
+    std::vector<TensorCPU>* outputs) {
+  CPUContext context;
+  RebatchingQueue queue(64, 2);
+  for (int offset = 0; offset < 48; offset += 16) {
+    auto batch = makeBatch(16, offset);
+    ASSERT_TRUE(queue.enqueueMany(
+        context, {&batch[0], &batch[1]}, threadPool, numThreads));
+  }
+  outputs->resize(2);
+  ASSERT_TRUE(queue.dequeue(
+      context, 40, {&(*outputs)[0], &(*outputs)[1]}, threadPool, numThreads));
+}
+
+TEST(RebatchingQueueTest, ParallelMatchesSerial) {
+  Workspace ws;
+  std::vector<TensorCPU> expected;
+  rebatch(nullptr, 1, &expected);
+  EXPECT_EQ(expected[0].dims(), std::vector<TIndex>({40, 4096}));
+  EXPECT_EQ(expected[1].dims(), std::vector<TIndex>({40}));
+  for (int i = 0; i < 40; ++i) {
+    EXPECT_EQ(expected[1].data<int>()[i], i);
+  }
+
+  for (int numThreads : {2, 3, 8}) {
+    std::vector<TensorCPU> outputs;
+    rebatch(ws.GetThreadPool(), numThreads, &outputs);
+    for (int j = 0; j < 2; ++j) {
+      ASSERT_EQ(outputs[j].dims(), expected[j].dims());
+      EXPECT_EQ(
+          memcmp(
+              outputs[j].raw_data(),
+              expected[j].raw_data(),
+              expected[j].nbytes()),
+          0);
+    }
+  }
+}
+
+TEST(RebatchingQueueTest, ParallelRejectsMismatchedShapes) {
+  Workspace ws;
+  CPUContext context;
+  RebatchingQueue queue(4, 1);
+  TensorCPU a(std::vector<TIndex>{8});
+  TensorCPU b(std::vector<TIndex>{9});
+  a.mutable_data<float>();
+  b.mutable_data<float>();
+  ASSERT_TRUE(queue.enqueueOne(context, {&a}));
+  ASSERT_TRUE(queue.enqueueOne(context, {&b}));
+  TensorCPU output;
+  EXPECT_THROW(
+      queue.dequeue(context, 2, {&output}, ws.GetThreadPool(), 4),
+      EnforceNotMet);
+}
+
+} // namespace
+} // namespace caffe2
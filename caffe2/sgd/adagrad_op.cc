@@ -58,6 +58,10 @@ Given inputs (param, moment, indices, grad, lr), runs the dense AdaGrad
 update on (param, grad, moment[indices], lr), and returns (new_param,
 new_moment) as in the dense case.
 
+param may be bfloat16, which halves the memory of large embedding tables. The
+update is then computed in float, with the float moment, and rounded to
+nearest even when stored back.
+
 )DOC")
     .Input(0, "param", "Parameters to be updated")
     .Input(1, "moment", "Moment history")
@@ -66,7 +70,8 @@ new_moment) as in the dense case.
     .Input(4, "lr", "learning rate")
     .Output(0, "output_param", "Updated parameters")
     .Output(1, "output_moment_1", "Updated moment")
-    .Arg("epsilon", "Default 1e-5");
+    .Arg("epsilon", "Default 1e-5")
+    .Arg("lock_moments", "Default 0. Locks each row update; see sgd/hogwild.h.");
 
 REGISTER_CPU_OPERATOR(
     RowWiseSparseAdagrad,
@@ -93,9 +98,77 @@ also be a 1D tensor indexing into the rows of param.
     .Input(4, "lr", "learning rate")
     .Output(0, "output_param", "Updated parameters")
     .Output(1, "output_moment_1", "Updated moment")
-    .Arg("epsilon", "Default 1e-5");
+    .Arg("epsilon", "Default 1e-5")
+    .Arg("lock_moments", "Default 0. Locks each row update; see sgd/hogwild.h.");
+
+REGISTER_CPU_OPERATOR(
+    SparseAdagrad8BitsRowwise,
+    SparseAdagrad8BitsRowwiseOp<CPUContext>);
+OPERATOR_SCHEMA(SparseAdagrad8BitsRowwise)
+    .NumInputs(6)
+    .NumOutputs(3)
+    .EnforceOneToOneInplace()
+    .SetDoc(R"DOC(
+
+Given inputs (param, scale_bias, moment, indices, grad, lr), runs the sparse
+Adagrad update on an embedding table quantized with
+FloatToRowwiseQuantized8Bits, updating (param, scale_bias, moment) in place.
+Every row in indices is dequantized, updated in fp32 and quantized again with
+its new min and max, so the table keeps the layout read by
+SparseLengthsSum8BitsRowwise. moment holds either one value per row of param,
+as in RowWiseSparseAdagrad, or one per value, as in SparseAdagrad.
+
+By default the values are rounded stochastically when they are requantized.
+Rounding to nearest would drop every update smaller than half a quantization
+step, which is most of them late in training.
+
+)DOC")
+    .Input(0, "param", "uint8 parameters to be updated")
+    .Input(1, "scale_bias", "Scale and bias of each row of param")
+    .Input(2, "moment", "Moment history")
+    .Input(3, "indices", "Sparse indices")
+    .Input(4, "grad", "Gradient computed")
+    .Input(5, "lr", "learning rate")
+    .Output(0, "output_param", "Updated parameters")
+    .Output(1, "output_scale_bias", "Updated scale and bias")
+    .Output(2, "output_moment_1", "Updated moment")
+    .Arg("epsilon", "Default 1e-5")
+    .Arg(
+        "stochastic_rounding",
+        "Default 1. Requantize with stochastic instead of nearest rounding.");
+
+REGISTER_CPU_OPERATOR(
+    SparseAdagradFusedWithSparseLengthsSumGradient,
+    SparseAdagradFusedWithSparseLengthsSumGradientOp<float, CPUContext>);
+OPERATOR_SCHEMA(SparseAdagradFusedWithSparseLengthsSumGradient)
+    .NumInputs(6)
+    .NumOutputs(2)
+    .EnforceOneToOneInplace()
+    .SetDoc(R"DOC(
+
+Fused SparseLengthsSumGradient and SparseAdagrad. Given inputs (param, moment,
+indices, grad, lr, lengths), where grad is the gradient of the output of
+SparseLengthsSum(param, indices, lengths), runs the sparse AdaGrad update of
+every row param[indices[i]] with the gradient row of the segment that indices[i]
+belongs to, and returns (new_param, new_moment) as in SparseAdagrad. This is
+the same as running SparseAdagrad on the output of SparseLengthsSumGradient,
+without materializing the per-index gradient.
+
+)DOC")
+    .Input(0, "param", "Parameters to be updated")
+    .Input(1, "moment", "Moment history")
+    .Input(2, "indices", "Sparse indices")
+    .Input(3, "grad", "Gradient of the pooled output, one row per segment")
+    .Input(4, "lr", "learning rate")
+    .Input(5, "lengths", "Segment lengths, summing to the size of indices")
+    .Output(0, "output_param", "Updated parameters")
+    .Output(1, "output_moment_1", "Updated moment")
+    .Arg("epsilon", "Default 1e-5")
+    .Arg("lock_moments", "Default 0. Locks each row update; see sgd/hogwild.h.");
 
 SHOULD_NOT_DO_GRADIENT(Adagrad);
 SHOULD_NOT_DO_GRADIENT(SparseAdagrad);
 SHOULD_NOT_DO_GRADIENT(RowWiseSparseAdagrad);
+SHOULD_NOT_DO_GRADIENT(SparseAdagrad8BitsRowwise);
+SHOULD_NOT_DO_GRADIENT(SparseAdagradFusedWithSparseLengthsSumGradient);
 }
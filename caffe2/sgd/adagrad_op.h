@@ -17,6 +17,10 @@
 #pragma once
 
 #include "caffe2/core/operator.h"
+#include "caffe2/operators/lengths_reducer_rowwise_8bit_ops.h"
+#include "caffe2/perfkernels/adagrad.h"
+#include "caffe2/perfkernels/type_conversion.h"
+#include "caffe2/sgd/hogwild.h"
 
 namespace caffe2 {
 
@@ -32,11 +36,7 @@ void adagrad_update(
     float decay,
     const float* lr,
     Context* /*context*/) {
-  for (auto i = 0; i < N; ++i) {
-    float gi = g[i];
-    float hi = nh[i] = decay * h[i] + gi * gi;
-    nw[i] = w[i] + lr[0] * gi / (std::sqrt(hi) + epsilon);
-  }
+  return adagrad_update(N, w, g, h, nw, nh, epsilon, decay, lr[0]);
 }
 
 template <typename T, class Context>
@@ -80,7 +80,8 @@ class SparseAdagradOp final : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   SparseAdagradOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)) {}
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)),
+        hogwild_(*this) {}
 
   bool RunOnDevice() override {
     // Enforce shapes
@@ -96,6 +97,9 @@ class SparseAdagradOp final : public Operator<Context> {
 
   template <typename SIndex>
   bool DoRunWithType() {
+    if (Input(PARAM).template IsType<bfloat16>()) {
+      return DoRunWithBFloat16Param<SIndex>();
+    }
     const auto* lr = Input(LR).template data<T>();
     const auto* indices = Input(INDICES).template data<SIndex>();
     const auto* gradIn = Input(GRAD).template data<T>();
@@ -112,6 +116,8 @@ class SparseAdagradOp final : public Operator<Context> {
     auto block_size = Input(GRAD).size() / n;
     for (auto i = 0; i < n; ++i) {
       auto idx = indices[i];
+      HogwildRowLockGuard guard(
+          paramOut + idx * block_size, hogwild_.LockRows());
       if (block_size == 1) {
         float gi = gradIn[i];
         float hi = momentOut[idx] = momentIn[idx] + gi * gi;
@@ -156,8 +162,50 @@ class SparseAdagradOp final : public Operator<Context> {
     return true;
   }
 
+  // bfloat16 parameters: every row is widened to float, updated with the
+  // float moment and gradient, and rounded back.
+  template <typename SIndex>
+  bool DoRunWithBFloat16Param() {
+    const auto* lr = Input(LR).template data<T>();
+    const auto* indices = Input(INDICES).template data<SIndex>();
+    const auto* gradIn = Input(GRAD).template data<T>();
+    const auto* paramIn = Input(PARAM).template data<bfloat16>();
+    const auto* momentIn = Input(MOMENT_1).template data<T>();
+    auto* paramOut = Output(OUTPUT_PARAM)->template mutable_data<bfloat16>();
+    auto* momentOut = Output(OUTPUT_MOMENT_1)->template mutable_data<T>();
+
+    auto n = Input(INDICES).size();
+    if (n == 0) {
+      return true;
+    }
+
+    auto block_size = Input(GRAD).size() / n;
+    row_.resize(block_size);
+    for (auto i = 0; i < n; ++i) {
+      auto idx = indices[i];
+      auto offsetIdx = idx * block_size;
+      HogwildRowLockGuard guard(paramOut + offsetIdx, hogwild_.LockRows());
+      bfloat16_to_float(block_size, paramIn + offsetIdx, row_.data());
+      adagrad_update(
+          block_size,
+          row_.data(),
+          gradIn + i * block_size,
+          momentIn + offsetIdx,
+          row_.data(),
+          momentOut + offsetIdx,
+          epsilon_,
+          1.0f,
+          lr,
+          &context_);
+      float_to_bfloat16(block_size, row_.data(), paramOut + offsetIdx);
+    }
+    return true;
+  }
+
  protected:
   T epsilon_;
+  HogwildParams hogwild_;
+  std::vector<float> row_;
   INPUT_TAGS(PARAM, MOMENT_1, INDICES, GRAD, LR);
   OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1);
 };
@@ -168,7 +216,8 @@ class RowWiseSparseAdagradOp final : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   RowWiseSparseAdagradOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)) {}
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)),
+        hogwild_(*this) {}
 
   bool RunOnDevice() override {
     // Enforce shapes
@@ -201,6 +250,8 @@ class RowWiseSparseAdagradOp final : public Operator<Context> {
 
     for (auto i = 0; i < n; ++i) {
       auto idx = indices[i];
+      HogwildRowLockGuard guard(
+          paramOut + idx * block_size, hogwild_.LockRows());
       if (block_size == 1) {
         float gi = gradIn[i];
         float hi = momentOut[idx] = momentIn[idx] + gi * gi;
@@ -230,21 +281,15 @@ class RowWiseSparseAdagradOp final : public Operator<Context> {
             i);
 #endif
 
-        const float* w = paramIn + offsetIdx;
-        const float* g = gradIn + offsetI;
-        const float* h = momentIn + idx;
-        float* nw = paramOut + offsetIdx;
-        float* nh = momentOut + idx;
-        float hs = 0.;
-        for (auto j = 0; j < block_size; ++j) {
-          float gj = g[j];
-          hs += gj * gj;
-        }
-        float hi = nh[0] = h[0] + hs / block_size;
-        float step = lr[0] / (std::sqrt(hi) + epsilon_);
-        for (auto j = 0; j < block_size; ++j) {
-          nw[j] = w[j] + g[j] * step;
-        }
+        rowwise_adagrad_update(
+            block_size,
+            paramIn + offsetIdx,
+            gradIn + offsetI,
+            momentIn + idx,
+            paramOut + offsetIdx,
+            momentOut + idx,
+            epsilon_,
+            lr[0]);
       }
     }
     return true;
@@ -252,7 +297,198 @@ class RowWiseSparseAdagradOp final : public Operator<Context> {
 
  protected:
   T epsilon_;
+  HogwildParams hogwild_;
   INPUT_TAGS(PARAM, MOMENT_1, INDICES, GRAD, LR);
   OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1);
 };
+
+// SparseLengthsSumGradient followed by SparseAdagrad in one pass: GRAD is the
+// gradient of the pooled SparseLengthsSum output, one row per segment, and
+// every row of PARAM referenced by a segment is updated with that segment's
+// gradient row directly, instead of first materializing the per-index gradient
+// tensor that SparseLengthsSumGradient would produce.
+template <typename T, class Context>
+class SparseAdagradFusedWithSparseLengthsSumGradientOp final
+    : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  SparseAdagradFusedWithSparseLengthsSumGradientOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)),
+        hogwild_(*this) {}
+
+  bool RunOnDevice() override {
+    // Enforce shapes
+    CAFFE_ENFORCE_EQ(Input(PARAM).size(), Input(MOMENT_1).size());
+    CAFFE_ENFORCE_EQ(Input(LR).size(), 1);
+    CAFFE_ENFORCE_EQ(Input(INDICES).ndim(), 1, "INDICES must be a vector");
+    CAFFE_ENFORCE_EQ(Input(LENGTHS).ndim(), 1, "LENGTHS must be a vector");
+    CAFFE_ENFORCE_GE(Input(GRAD).ndim(), 1);
+    CAFFE_ENFORCE_EQ(
+        Input(GRAD).dim(0),
+        Input(LENGTHS).dim(0),
+        "GRAD must have one row per segment");
+    CAFFE_ENFORCE_EQ(
+        Input(PARAM).size_from_dim(1), Input(GRAD).size_from_dim(1));
+
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename SIndex>
+  bool DoRunWithType() {
+    const auto* lr = Input(LR).template data<T>();
+    const auto* indices = Input(INDICES).template data<SIndex>();
+    const auto* lengths = Input(LENGTHS).template data<int>();
+    const auto* gradIn = Input(GRAD).template data<T>();
+    const auto* paramIn = Input(PARAM).template data<T>();
+    const auto* momentIn = Input(MOMENT_1).template data<T>();
+    auto* paramOut = Output(OUTPUT_PARAM)->template mutable_data<T>();
+    auto* momentOut = Output(OUTPUT_MOMENT_1)->template mutable_data<T>();
+
+    const auto n = Input(INDICES).size();
+    const auto num_segments = Input(LENGTHS).size();
+    const auto num_rows = Input(PARAM).dim(0);
+    const auto block_size = Input(PARAM).size_from_dim(1);
+
+    TIndex pos = 0;
+    for (auto m = 0; m < num_segments; ++m) {
+      const auto* g = gradIn + m * block_size;
+      CAFFE_ENFORCE_GE(lengths[m], 0, "Negative length for segment ", m);
+      CAFFE_ENFORCE_LE(
+          pos + lengths[m], n, "The sum of LENGTHS exceeds INDICES size");
+      for (auto end = pos + lengths[m]; pos < end; ++pos) {
+        const auto idx = indices[pos];
+        CAFFE_ENFORCE(
+            0 <= idx && idx < num_rows,
+            this->debug_def().input(PARAM),
+            ", out of bound,  idx:",
+            idx,
+            " for input i:",
+            pos);
+        const auto offsetIdx = idx * block_size;
+        HogwildRowLockGuard guard(paramOut + offsetIdx, hogwild_.LockRows());
+        adagrad_update(
+            block_size,
+            paramIn + offsetIdx,
+            g,
+            momentIn + offsetIdx,
+            paramOut + offsetIdx,
+            momentOut + offsetIdx,
+            epsilon_,
+            1.0f,
+            lr,
+            &context_);
+      }
+    }
+    CAFFE_ENFORCE_EQ(pos, n, "The sum of LENGTHS must be the INDICES size");
+    return true;
+  }
+
+ protected:
+  T epsilon_;
+  HogwildParams hogwild_;
+  INPUT_TAGS(PARAM, MOMENT_1, INDICES, GRAD, LR, LENGTHS);
+  OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1);
+};
+
+// SparseAdagrad on an embedding table stored with 8 bits per value in the
+// layout of FloatToRowwiseQuantized8Bits, so that the table used for training
+// can be read directly by SparseLengthsSum8BitsRowwise. Each updated row is
+// dequantized, updated in fp32 and requantized with its new range. The moment
+// is either one float per row, as in RowWiseSparseAdagrad, or one per value.
+template <class Context>
+class SparseAdagrad8BitsRowwiseOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  SparseAdagrad8BitsRowwiseOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)),
+        stochastic_rounding_(OperatorBase::GetSingleArgument<bool>(
+            "stochastic_rounding",
+            true)) {}
+
+  bool RunOnDevice() override {
+    CAFFE_ENFORCE_EQ(Input(LR).size(), 1);
+    CAFFE_ENFORCE_EQ(Input(SCALE_BIAS).ndim(), 2);
+    CAFFE_ENFORCE_EQ(Input(SCALE_BIAS).dim(0), Input(PARAM).dim(0));
+    CAFFE_ENFORCE_EQ(Input(SCALE_BIAS).dim(1), 2);
+    CAFFE_ENFORCE(
+        Input(MOMENT_1).size() == Input(PARAM).dim(0) ||
+            Input(MOMENT_1).size() == Input(PARAM).size(),
+        "moment must have one value per row or one per value of param");
+    CAFFE_ENFORCE_EQ(
+        Input(PARAM).size_from_dim(1),
+        Input(GRAD).size_from_dim(Input(INDICES).ndim()));
+
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename SIndex>
+  bool DoRunWithType() {
+    const float lr = Input(LR).template data<float>()[0];
+    const auto* indices = Input(INDICES).template data<SIndex>();
+    const auto* gradIn = Input(GRAD).template data<float>();
+    const auto* momentIn = Input(MOMENT_1).template data<float>();
+    auto* paramOut = Output(OUTPUT_PARAM)->template mutable_data<uint8_t>();
+    auto* scaleBiasOut =
+        Output(OUTPUT_SCALE_BIAS)->template mutable_data<float>();
+    auto* momentOut = Output(OUTPUT_MOMENT_1)->template mutable_data<float>();
+
+    const auto n = Input(INDICES).size();
+    const auto num_rows = Input(PARAM).dim(0);
+    const auto block_size = Input(PARAM).size_from_dim(1);
+    const bool rowwise = Input(MOMENT_1).size() == num_rows;
+    auto* rng = stochastic_rounding_ ? &context_.RandGenerator() : nullptr;
+    row_.resize(block_size);
+    for (auto i = 0; i < n; ++i) {
+      const auto idx = indices[i];
+      CAFFE_ENFORCE(
+          0 <= idx && idx < num_rows,
+          this->debug_def().input(PARAM),
+          ", out of bound,  idx:",
+          idx,
+          " for input i:",
+          i);
+      uint8_t* param = paramOut + idx * block_size;
+      float* scale_bias = scaleBiasOut + 2 * idx;
+      DequantizeRowwise(param, block_size, scale_bias, row_.data());
+      if (rowwise) {
+        rowwise_adagrad_update(
+            block_size,
+            row_.data(),
+            gradIn + i * block_size,
+            momentIn + idx,
+            row_.data(),
+            momentOut + idx,
+            epsilon_,
+            lr);
+      } else {
+        adagrad_update(
+            block_size,
+            row_.data(),
+            gradIn + i * block_size,
+            momentIn + idx * block_size,
+            row_.data(),
+            momentOut + idx * block_size,
+            epsilon_,
+            1.0f,
+            lr);
+      }
+      QuantizeRowwise<Rowwise8BitLevels>(
+          row_.data(), block_size, param, scale_bias, rng);
+    }
+    return true;
+  }
+
+ protected:
+  float epsilon_;
+  bool stochastic_rounding_;
+  vector<float> row_;
+  INPUT_TAGS(PARAM, SCALE_BIAS, MOMENT_1, INDICES, GRAD, LR);
+  OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_SCALE_BIAS, OUTPUT_MOMENT_1);
+};
 }
@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/utils/conversions.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+// A bfloat16 param gets the float update of the float param, rounded.
+TEST(SparseAdagradTest, BFloat16Param) {
+  const int kRows = 6;
+  const int kBlockSize = 19;
+  const vector<int64_t> indices = {4, 1, 5};
+  Workspace ws;
+  auto* param = AddTensor(&ws, "param", {kRows, kBlockSize});
+  auto* param_bf16 = AddTensor(&ws, "param_bf16", {kRows, kBlockSize});
+  for (int i = 0; i < param->size(); ++i) {
+    // Exactly representable in bfloat16, so both start from the same values.
+    const float value = convert::To<bfloat16, float>(
+        convert::To<float, bfloat16>(0.1f * (i % 23) - 1.0f));
+    param->mutable_data<float>()[i] = value;
+    param_bf16->mutable_data<bfloat16>()[i] =
+        convert::To<float, bfloat16>(value);
+  }
+  for (const char* name : {"moment", "moment_bf16"}) {
+    auto* moment = AddTensor(&ws, name, {kRows, kBlockSize});
+    for (int i = 0; i < moment->size(); ++i) {
+      moment->mutable_data<float>()[i] = 0.5f + 0.01f * i;
+    }
+  }
+  auto* ind = AddTensor(&ws, "indices", {3});
+  std::copy(indices.begin(), indices.end(), ind->mutable_data<int64_t>());
+  auto* grad = AddTensor(&ws, "grad", {3, kBlockSize});
+  for (int i = 0; i < grad->size(); ++i) {
+    grad->mutable_data<float>()[i] = 0.05f * (i % 7) - 0.15f;
+  }
+  AddTensor(&ws, "lr", {1})->mutable_data<float>()[0] = -0.1f;
+
+  for (const char* suffix : {"", "_bf16"}) {
+    const string param = string("param") + suffix;
+    const string moment = string("moment") + suffix;
+    ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+        "SparseAdagrad",
+        "",
+        {param, moment, "indices", "grad", "lr"},
+        {param, moment})));
+  }
+  const auto& expected = ws.GetBlob("param")->Get<TensorCPU>();
+  const auto& result = ws.GetBlob("param_bf16")->Get<TensorCPU>();
+  ASSERT_TRUE(result.IsType<bfloat16>());
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(
+        result.data<bfloat16>()[i].x,
+        (convert::To<float, bfloat16>(expected.data<float>()[i]).x));
+  }
+  const auto& moment = ws.GetBlob("moment")->Get<TensorCPU>();
+  const auto& moment_bf16 = ws.GetBlob("moment_bf16")->Get<TensorCPU>();
+  for (int i = 0; i < moment.size(); ++i) {
+    EXPECT_EQ(moment_bf16.data<float>()[i], moment.data<float>()[i]);
+  }
+}
+
+} // namespace caffe2
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/adam.h"
 
 namespace caffe2 {
 
@@ -59,13 +60,8 @@ void adam_compute(
     float correction,
     const float* lr,
     Context* /*context*/) {
-  for (auto i = 0; i < N; ++i) {
-    float gi = g[i];
-    float mi = nm[i] = m[i] * beta1 + gi * (1 - beta1);
-    float vi = nv[i] = v[i] * beta2 + gi * gi * (1 - beta2);
-    float ng = lr[0] * correction * mi / (std::sqrt(vi) + eps_hat);
-    nw[i] = w[i] + ng;
-  }
+  return adam_compute(
+      N, w, g, m, v, nw, nm, nv, beta1, beta2, eps_hat, correction, lr[0]);
 }
 
 template <typename T, class Context>
@@ -121,6 +121,7 @@ void SparseFtrlOp<T>::DoRun() {
     SIndex idx = idxs[i];
     DCHECK(0 <= idx && idx < N) << "Index out of bounds: " << idx
                                 << ", range 0 to " << N;
+    HogwildRowLockGuard guard(w + block_size * idx, hogwild_.LockRows());
     if (block_size == 1) {
       ftrl_compute(
           w[idx],
@@ -156,7 +157,8 @@ REGISTER_CPU_OPERATOR(SparseFtrl, SparseFtrlOp<float>);
 OPERATOR_SCHEMA(SparseFtrl)
     .NumInputs(4, 5)
     .NumOutputs(2)
-    .EnforceInplace({{0, 0}, {1, 1}});
+    .EnforceInplace({{0, 0}, {1, 1}})
+    .Arg("lock_moments", "Default 0. Locks each row update; see sgd/hogwild.h.");
 SHOULD_NOT_DO_GRADIENT(SparseFtrl);
 }
 
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+// Hogwild mode of the sparse optimizers (SparseAdagrad, RowWiseSparseAdagrad,
+// SparseAdagradFusedWithSparseLengthsSumGradient, SparseMomentumSGDUpdate and
+// SparseFtrl).
+//
+// These ops may run concurrently with other ops updating the same param and
+// moment blobs, typically the optimizer ops of several trainer nets running in
+// their own threads, without a lock or mutex blob around them. The blobs have
+// to be created with their final shape and type before the concurrent runs
+// start; the ops only write rows in place and never reallocate them.
+//
+// Memory ordering: without locks every element is read and written with plain
+// 4 byte aligned loads and stores, so a reader never sees a torn float but can
+// see a row that is half updated by another thread, and two threads updating
+// the same row at the same time can lose one of the updates. As in the Hogwild
+// paper this is benign for sparse embeddings where concurrent updates of one
+// row are rare. Updates become visible to other threads at the latest when the
+// writing net finishes, since the executors synchronize on completion.
+//
+// With the "lock_moments" argument set, the update of each row runs under one
+// of a fixed set of striped spinlocks, chosen from the address of the param
+// row, so concurrent updates of the same row and its moment accumulators are
+// serialized and none of them is lost: the lock is acquired with acquire and
+// released with release ordering, so each update sees the moment written by
+// the previous one. Rows that collide on a stripe only cost extra contention.
+// Readers that do not take the locks, such as the forward lookups, can still
+// see a row in the middle of an update.
+class HogwildRowLocks {
+ public:
+  // Number of spinlocks in the process wide table, a power of two.
+  static constexpr std::size_t kNumStripes = 4096;
+
+  static void Lock(const void* row) {
+    auto& flag = Stripe(row);
+    while (flag.exchange(true, std::memory_order_acquire)) {
+      while (flag.load(std::memory_order_relaxed)) {
+      }
+    }
+  }
+
+  static void Unlock(const void* row) {
+    Stripe(row).store(false, std::memory_order_release);
+  }
+
+ private:
+  struct alignas(64) PaddedFlag {
+    std::atomic<bool> flag{false};
+  };
+
+  static std::atomic<bool>& Stripe(const void* row) {
+    // Drop the bits within a cache line so that neighbouring small rows still
+    // spread over different stripes after the mixing.
+    auto key = reinterpret_cast<std::uintptr_t>(row) >> 6;
+    key ^= key >> 12;
+    return stripes_[key & (kNumStripes - 1)].flag;
+  }
+
+  static PaddedFlag stripes_[kNumStripes];
+};
+
+// Scoped lock on the stripe of a row, which is a no-op unless enabled.
+class HogwildRowLockGuard {
+ public:
+  HogwildRowLockGuard(const void* row, bool enabled)
+      : row_(enabled ? row : nullptr) {
+    if (row_) {
+      HogwildRowLocks::Lock(row_);
+    }
+  }
+  ~HogwildRowLockGuard() {
+    if (row_) {
+      HogwildRowLocks::Unlock(row_);
+    }
+  }
+
+ private:
+  const void* row_;
+
+  DISABLE_COPY_AND_ASSIGN(HogwildRowLockGuard);
+};
+
+// Reads the hogwild arguments of a sparse optimizer op.
+struct HogwildParams {
+  explicit HogwildParams(const OperatorBase& op)
+      : lock_moments(op.GetSingleArgument<bool>("lock_moments", false)) {}
+
+  // True if the row updates have to be serialized with HogwildRowLocks.
+  bool LockRows() const {
+    return lock_moments;
+  }
+
+  bool lock_moments;
+};
+
+} // namespace caffe2
@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/sgd/hogwild.h"
+
+namespace caffe2 {
+
+namespace {
+
+constexpr int kNumThreads = 4;
+
+// Runs the op created from def concurrently from kNumThreads threads, every
+// thread with its own op instance running iters times.
+void RunConcurrently(Workspace* ws, const OperatorDef& def, int iters) {
+  vector<unique_ptr<OperatorBase>> ops;
+  for (int i = 0; i < kNumThreads; ++i) {
+    ops.push_back(CreateOperator(def, ws));
+  }
+  vector<std::thread> threads;
+  for (auto& op : ops) {
+    auto* op_ptr = op.get();
+    threads.emplace_back([op_ptr, iters]() {
+      for (int i = 0; i < iters; ++i) {
+        EXPECT_TRUE(op_ptr->Run());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace
+
+TEST(HogwildTest, RowLocksAreExclusive) {
+  // Every thread increments the counters of all rows under the row locks, so
+  // no increment can get lost.
+  constexpr int kIters = 1000;
+  vector<int> counters(64, 0);
+  vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&counters]() {
+      for (int i = 0; i < kIters; ++i) {
+        for (auto& counter : counters) {
+          HogwildRowLockGuard guard(&counter, true);
+          ++counter;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto counter : counters) {
+    EXPECT_EQ(counter, kNumThreads * kIters);
+  }
+}
+
+TEST(HogwildTest, SparseAdagradWithLockedMoments) {
+  // All threads update the same rows with a gradient of one, so with the
+  // moments locked every moment ends up being incremented exactly once per
+  // update, whatever the interleaving.
+  constexpr int kRows = 16;
+  constexpr int kBlockSize = 8;
+  constexpr int kIters = 200;
+  Workspace ws;
+  FillTensor(&ws, "param", {kRows, kBlockSize}, 0.0f);
+  FillTensor(&ws, "moment", {kRows, kBlockSize}, 0.0f);
+  FillTensor(&ws, "grad", {2 * kRows, kBlockSize}, 1.0f);
+  FillTensor(&ws, "lr", {1}, 0.1f);
+  auto* indices = ws.CreateBlob("indices")->GetMutable<TensorCPU>();
+  indices->Resize(2 * kRows);
+  for (int i = 0; i < 2 * kRows; ++i) {
+    // Every row appears twice.
+    indices->mutable_data<int64_t>()[i] = i % kRows;
+  }
+
+  OperatorDef def;
+  def.set_type("SparseAdagrad");
+  for (const auto& name : {"param", "moment", "indices", "grad", "lr"}) {
+    def.add_input(name);
+  }
+  def.add_output("param");
+  def.add_output("moment");
+  auto* arg = def.add_arg();
+  arg->set_name("lock_moments");
+  arg->set_i(1);
+  RunConcurrently(&ws, def, kIters);
+
+  const auto& moment = ws.GetBlob("moment")->Get<TensorCPU>();
+  for (TIndex i = 0; i < moment.size(); ++i) {
+    EXPECT_EQ(moment.data<float>()[i], 2 * kNumThreads * kIters);
+  }
+  // Every update adds lr * g / (sqrt(h) + epsilon) > 0 to the params.
+  const auto& param = ws.GetBlob("param")->Get<TensorCPU>();
+  for (TIndex i = 0; i < param.size(); ++i) {
+    EXPECT_GT(param.data<float>()[i], 0);
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/sgd/loss_scale_op.h"
+
+namespace caffe2 {
+
+template <>
+void CheckFiniteAndUnscaleOp<CPUContext>::ProcessGradient(
+    int i,
+    bool unscale) {
+  const auto& grad = Input(i + 1);
+  if (grad.IsType<float>()) {
+    ProcessGradientWithType<float>(i, unscale);
+  } else {
+    CAFFE_THROW("Unsupported gradient type: ", grad.meta().name());
+  }
+}
+
+REGISTER_CPU_OPERATOR(
+    CheckFiniteAndUnscale,
+    CheckFiniteAndUnscaleOp<CPUContext>);
+OPERATOR_SCHEMA(CheckFiniteAndUnscale)
+    .NumInputs(2, INT_MAX)
+    .NumOutputs(2, INT_MAX)
+    .SameNumberOfOutput()
+    .EnforceInplace([](int in, int out) { return in == out + 1; })
+    .SetDoc(R"DOC(
+Prepares gradients computed from a loss multiplied by `loss_scale` for the
+weight update. If all the gradients are finite, they are divided by
+`loss_scale` in place. Otherwise they are all set to zero and `found_inf` is
+set to 1, so that an overflow in the scaled backward pass never reaches the
+weights. On GPU the gradients may also be float16, each keeps its type.
+)DOC")
+    .Input(0, "loss_scale", "The loss scale, a float tensor of size 1.")
+    .Input(1, "grad_1", "The first gradient, more may follow.")
+    .Output(0, "grad_1", "The first unscaled gradient, in place.")
+    .Output(
+        1,
+        "found_inf",
+        "The last output, 1 if any gradient had an inf or NaN, else 0.");
+SHOULD_NOT_DO_GRADIENT(CheckFiniteAndUnscale);
+
+REGISTER_CPU_OPERATOR(UpdateLossScale, UpdateLossScaleOp<CPUContext>);
+OPERATOR_SCHEMA(UpdateLossScale)
+    .NumInputs(3)
+    .NumOutputs(2)
+    .EnforceInplace({{0, 0}, {1, 1}})
+    .SetDoc(R"DOC(
+Dynamic loss scaling for mixed precision training. Given the `found_inf`
+output of CheckFiniteAndUnscale, the loss scale is multiplied by
+`backoff_factor` after an overflow. It is multiplied by `growth_factor` after
+`growth_interval` iterations in a row without overflow. The scale stays within
+[min_loss_scale, max_loss_scale].
+)DOC")
+    .Arg("growth_factor", "Factor to grow the scale by, default 2.")
+    .Arg("backoff_factor", "Factor to shrink the scale by, default 0.5.")
+    .Arg(
+        "growth_interval",
+        "Iterations without overflow before growing, default 2000.")
+    .Arg("min_loss_scale", "Lower bound of the scale, default 1.")
+    .Arg("max_loss_scale", "Upper bound of the scale, default 2^24.")
+    .Input(0, "loss_scale", "The loss scale, a float tensor of size 1.")
+    .Input(1, "good_steps", "Iterations since the last change, int of size 1.")
+    .Input(2, "found_inf", "1 if this iteration overflowed, else 0.")
+    .Output(0, "loss_scale", "The updated loss scale, in place.")
+    .Output(1, "good_steps", "The updated step count, in place.");
+SHOULD_NOT_DO_GRADIENT(UpdateLossScale);
+
+} // namespace caffe2
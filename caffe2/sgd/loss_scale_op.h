@@ -0,0 +1,181 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// Sets found_inf[0] to 1 if any of the N gradients is inf or NaN. found_inf
+// is not reset, so that it accumulates over several calls.
+template <typename T, class Context>
+void loss_scale_find_inf(const int N, const T* g, float* found_inf, Context*) {
+  for (auto i = 0; i < N; ++i) {
+    if (!std::isfinite(g[i])) {
+      found_inf[0] = 1;
+      return;
+    }
+  }
+}
+
+// Divides the gradients by the loss scale, or zeroes them if an inf or NaN
+// was found so that the overflowed values never reach the weights.
+template <typename T, class Context>
+void loss_scale_unscale(
+    const int N,
+    const T* g,
+    const float* loss_scale,
+    const float* found_inf,
+    T* ng,
+    Context*) {
+  const float scale = 1 / loss_scale[0];
+  for (auto i = 0; i < N; ++i) {
+    ng[i] = found_inf[0] ? 0 : g[i] * scale;
+  }
+}
+
+template <class Context>
+void loss_scale_update(
+    const float* found_inf,
+    const float growth_factor,
+    const float backoff_factor,
+    const int growth_interval,
+    const float min_loss_scale,
+    const float max_loss_scale,
+    float* loss_scale,
+    int* good_steps,
+    Context*) {
+  if (found_inf[0]) {
+    loss_scale[0] = std::max(loss_scale[0] * backoff_factor, min_loss_scale);
+    good_steps[0] = 0;
+  } else if (++good_steps[0] >= growth_interval) {
+    loss_scale[0] = std::min(loss_scale[0] * growth_factor, max_loss_scale);
+    good_steps[0] = 0;
+  }
+}
+
+template <class Context>
+class CheckFiniteAndUnscaleOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(CheckFiniteAndUnscaleOp);
+
+  bool RunOnDevice() override {
+    const int num_grads = InputSize() - 1;
+    CAFFE_ENFORCE_EQ(Input(LOSS_SCALE).size(), 1);
+    auto* found_inf = Output(num_grads);
+    found_inf->Resize(1);
+    math::Set<float, Context>(
+        1, 0, found_inf->template mutable_data<float>(), &context_);
+    // All gradients are checked before any is unscaled, since an overflow in
+    // one of them zeroes all of them.
+    for (int i = 0; i < num_grads; ++i) {
+      ProcessGradient(i, false);
+    }
+    for (int i = 0; i < num_grads; ++i) {
+      ProcessGradient(i, true);
+    }
+    return true;
+  }
+
+ private:
+  // Defined per context, dispatches on the type of the i-th gradient, which
+  // may differ between gradients.
+  void ProcessGradient(int i, bool unscale);
+
+  template <typename T>
+  void ProcessGradientWithType(int i, bool unscale) {
+    const auto& grad = Input(i + 1);
+    auto* found_inf = Output(OutputSize() - 1);
+    if (!unscale) {
+      loss_scale_find_inf<T, Context>(
+          grad.size(),
+          grad.template data<T>(),
+          found_inf->template mutable_data<float>(),
+          &context_);
+      return;
+    }
+    auto* output = Output(i);
+    output->ResizeLike(grad);
+    loss_scale_unscale<T, Context>(
+        grad.size(),
+        grad.template data<T>(),
+        Input(LOSS_SCALE).template data<float>(),
+        found_inf->template data<float>(),
+        output->template mutable_data<T>(),
+        &context_);
+  }
+
+ protected:
+  INPUT_TAGS(LOSS_SCALE);
+};
+
+template <class Context>
+class UpdateLossScaleOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  UpdateLossScaleOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        growth_factor_(
+            OperatorBase::GetSingleArgument<float>("growth_factor", 2.0)),
+        backoff_factor_(
+            OperatorBase::GetSingleArgument<float>("backoff_factor", 0.5)),
+        growth_interval_(
+            OperatorBase::GetSingleArgument<int>("growth_interval", 2000)),
+        min_loss_scale_(
+            OperatorBase::GetSingleArgument<float>("min_loss_scale", 1.0)),
+        max_loss_scale_(OperatorBase::GetSingleArgument<float>(
+            "max_loss_scale",
+            16777216.0)) {
+    CAFFE_ENFORCE_GT(growth_factor_, 1);
+    CAFFE_ENFORCE_GT(backoff_factor_, 0);
+    CAFFE_ENFORCE_LT(backoff_factor_, 1);
+    CAFFE_ENFORCE_GE(growth_interval_, 1);
+  }
+
+  bool RunOnDevice() override {
+    CAFFE_ENFORCE_EQ(Input(LOSS_SCALE).size(), 1);
+    CAFFE_ENFORCE_EQ(Input(GOOD_STEPS).size(), 1);
+    CAFFE_ENFORCE_EQ(Input(FOUND_INF).size(), 1);
+    loss_scale_update<Context>(
+        Input(FOUND_INF).template data<float>(),
+        growth_factor_,
+        backoff_factor_,
+        growth_interval_,
+        min_loss_scale_,
+        max_loss_scale_,
+        Output(OUTPUT_LOSS_SCALE)->template mutable_data<float>(),
+        Output(OUTPUT_GOOD_STEPS)->template mutable_data<int>(),
+        &context_);
+    return true;
+  }
+
+ protected:
+  float growth_factor_;
+  float backoff_factor_;
+  int growth_interval_;
+  float min_loss_scale_;
+  float max_loss_scale_;
+  INPUT_TAGS(LOSS_SCALE, GOOD_STEPS, FOUND_INF);
+  OUTPUT_TAGS(OUTPUT_LOSS_SCALE, OUTPUT_GOOD_STEPS);
+};
+
+} // namespace caffe2
@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/common_gpu.h"
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/sgd/loss_scale_op.h"
+
+namespace caffe2 {
+
+namespace {
+
+inline __device__ float ToFloat(float x) {
+  return x;
+}
+
+inline __device__ float ToFloat(half x) {
+  return __half2float(x);
+}
+
+template <typename T>
+inline __device__ T FromFloat(float x);
+
+template <>
+inline __device__ float FromFloat<float>(float x) {
+  return x;
+}
+
+template <>
+inline __device__ half FromFloat<half>(float x) {
+  return __float2half(x);
+}
+
+template <typename T>
+__global__ void FindInfKernel(const int N, const T* g, float* found_inf) {
+  CUDA_1D_KERNEL_LOOP(i, N) {
+    if (!isfinite(ToFloat(g[i]))) {
+      found_inf[0] = 1;
+    }
+  }
+}
+
+template <typename T>
+__global__ void UnscaleKernel(
+    const int N,
+    const T* g,
+    const float* loss_scale,
+    const float* found_inf,
+    T* ng) {
+  const float scale = 1 / loss_scale[0];
+  const bool skip = found_inf[0];
+  CUDA_1D_KERNEL_LOOP(i, N) {
+    ng[i] = FromFloat<T>(skip ? 0 : ToFloat(g[i]) * scale);
+  }
+}
+
+__global__ void UpdateLossScaleKernel(
+    const float* found_inf,
+    const float growth_factor,
+    const float backoff_factor,
+    const int growth_interval,
+    const float min_loss_scale,
+    const float max_loss_scale,
+    float* loss_scale,
+    int* good_steps) {
+  if (found_inf[0]) {
+    loss_scale[0] = fmaxf(loss_scale[0] * backoff_factor, min_loss_scale);
+    good_steps[0] = 0;
+  } else if (++good_steps[0] >= growth_interval) {
+    loss_scale[0] = fminf(loss_scale[0] * growth_factor, max_loss_scale);
+    good_steps[0] = 0;
+  }
+}
+
+} // namespace
+
+template <>
+void loss_scale_find_inf<float, CUDAContext>(
+    const int N,
+    const float* g,
+    float* found_inf,
+    CUDAContext* context) {
+  FindInfKernel<<<
+      CAFFE_GET_BLOCKS(N),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(N, g, found_inf);
+}
+
+template <>
+void loss_scale_find_inf<float16, CUDAContext>(
+    const int N,
+    const float16* g,
+    float* found_inf,
+    CUDAContext* context) {
+  FindInfKernel<<<
+      CAFFE_GET_BLOCKS(N),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(
+      N, reinterpret_cast<const half*>(g), found_inf);
+}
+
+template <>
+void loss_scale_unscale<float, CUDAContext>(
+    const int N,
+    const float* g,
+    const float* loss_scale,
+    const float* found_inf,
+    float* ng,
+    CUDAContext* context) {
+  UnscaleKernel<<<
+      CAFFE_GET_BLOCKS(N),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(N, g, loss_scale, found_inf, ng);
+}
+
+template <>
+void loss_scale_unscale<float16, CUDAContext>(
+    const int N,
+    const float16* g,
+    const float* loss_scale,
+    const float* found_inf,
+    float16* ng,
+    CUDAContext* context) {
+  UnscaleKernel<<<
+      CAFFE_GET_BLOCKS(N),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(
+      N,
+      reinterpret_cast<const half*>(g),
+      loss_scale,
+      found_inf,
+      reinterpret_cast<half*>(ng));
+}
+
+template <>
+void loss_scale_update<CUDAContext>(
+    const float* found_inf,
+    const float growth_factor,
+    const float backoff_factor,
+    const int growth_interval,
+    const float min_loss_scale,
+    const float max_loss_scale,
+    float* loss_scale,
+    int* good_steps,
+    CUDAContext* context) {
+  UpdateLossScaleKernel<<<1, 1, 0, context->cuda_stream()>>>(
+      found_inf,
+      growth_factor,
+      backoff_factor,
+      growth_interval,
+      min_loss_scale,
+      max_loss_scale,
+      loss_scale,
+      good_steps);
+}
+
+template <>
+void CheckFiniteAndUnscaleOp<CUDAContext>::ProcessGradient(
+    int i,
+    bool unscale) {
+  const auto& grad = Input(i + 1);
+  if (grad.IsType<float>()) {
+    ProcessGradientWithType<float>(i, unscale);
+  } else if (grad.IsType<float16>()) {
+    ProcessGradientWithType<float16>(i, unscale);
+  } else {
+    CAFFE_THROW("Unsupported gradient type: ", grad.meta().name());
+  }
+}
+
+REGISTER_CUDA_OPERATOR(
+    CheckFiniteAndUnscale,
+    CheckFiniteAndUnscaleOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(UpdateLossScale, UpdateLossScaleOp<CUDAContext>);
+
+} // namespace caffe2
@@ -126,6 +126,7 @@ same blobs).
     .Output(1, "output_moment", "Updated momentum.")
     .Output(2, "output_param", "Updated parameter")
     .Arg("momentum", "Momentum hyperparameter.")
-    .Arg("nesterov", "(boolean) Whether to use Nesterov Accelerated Gradient.");
+    .Arg("nesterov", "(boolean) Whether to use Nesterov Accelerated Gradient.")
+    .Arg("lock_moments", "Default 0. Locks each row update; see sgd/hogwild.h.");
 SHOULD_NOT_DO_GRADIENT(SparseMomentumSGDUpdate);
 }
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "caffe2/core/operator.h"
+#include "caffe2/sgd/hogwild.h"
 
 namespace caffe2 {
 
@@ -136,7 +137,8 @@ class SparseMomentumSGDUpdateOp final : public Operator<Context> {
   SparseMomentumSGDUpdateOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
         momentum_(OperatorBase::GetSingleArgument<T>("momentum", 0.0)),
-        nesterov_(OperatorBase::GetSingleArgument<int>("nesterov", 0)) {}
+        nesterov_(OperatorBase::GetSingleArgument<int>("nesterov", 0)),
+        hogwild_(*this) {}
 
   bool RunOnDevice() override {
     // Resize [potentially] out-of-place blobs
@@ -175,6 +177,7 @@ class SparseMomentumSGDUpdateOp final : public Operator<Context> {
       CAFFE_ENFORCE(offsetIdx + block_size <= Input(PARAM).size());
       CAFFE_ENFORCE(offsetI + block_size <= Input(GRAD).size());
 
+      HogwildRowLockGuard guard(paramOut + offsetIdx, hogwild_.LockRows());
       momentum_sgd_update<Context>(
           block_size,
           gradIn + offsetI,
@@ -193,6 +196,7 @@ class SparseMomentumSGDUpdateOp final : public Operator<Context> {
  protected:
   T momentum_;
   bool nesterov_;
+  HogwildParams hogwild_;
   INPUT_TAGS(GRAD, MOMENTUM, LR, PARAM, INDICES);
   OUTPUT_TAGS(OUTPUT_GRAD, OUTPUT_MOMENTUM, OUTPUT_PARAM);
 };
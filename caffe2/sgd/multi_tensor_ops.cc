@@ -0,0 +1,360 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/sgd/multi_tensor_ops.h"
+
+#include <algorithm>
+
+#include "caffe2/perfkernels/adagrad.h"
+#include "caffe2/perfkernels/adam.h"
+#include "caffe2/sgd/momentum_sgd_op.h"
+#include "caffe2/utils/math.h"
+#include "caffe2/utils/run_chunks.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Fewer elements than this per thread are not worth the dispatch overhead.
+constexpr TIndex kMinTensorElementsPerChunk = 1 << 15;
+
+// Cuts the concatenation of tensors of the given sizes into up to max_chunks
+// chunks of about the same number of elements, and calls
+// fn(tensor, begin, end) for the part [begin, end) of each tensor in each
+// chunk. The chunks run on the workspace thread pool when there is more than
+// one.
+void RunOnTensorChunks(
+    Workspace* ws,
+    int max_chunks,
+    const vector<TIndex>& sizes,
+    const std::function<void(int, TIndex, TIndex)>& fn) {
+  vector<TIndex> offsets(sizes.size() + 1, 0);
+  for (int i = 0; i < sizes.size(); ++i) {
+    offsets[i + 1] = offsets[i] + sizes[i];
+  }
+  const TIndex total = offsets.back();
+  RunChunks(
+      ws,
+      NumChunks(max_chunks, total, 1, kMinTensorElementsPerChunk),
+      total,
+      [&](int /* unused */, TIndex chunk_begin, TIndex chunk_end) {
+        // The last tensor that starts at or before chunk_begin.
+        int i = std::upper_bound(offsets.begin(), offsets.end(), chunk_begin) -
+            offsets.begin() - 1;
+        for (; i < sizes.size() && offsets[i] < chunk_end; ++i) {
+          const TIndex begin = std::max(chunk_begin, offsets[i]) - offsets[i];
+          const TIndex end = std::min(chunk_end, offsets[i + 1]) - offsets[i];
+          if (begin < end) {
+            fn(i, begin, end);
+          }
+        }
+      });
+}
+
+} // namespace
+
+template <>
+bool MultiTensorMomentumSGDUpdateOp<CPUContext>::RunOnTensors() {
+  const int num_tensors = NumTensors();
+  vector<TIndex> sizes(num_tensors);
+  vector<float*> grads(num_tensors);
+  vector<float*> moments(num_tensors);
+  vector<float*> params(num_tensors);
+  for (int i = 0; i < num_tensors; ++i) {
+    sizes[i] = Input(GradInput(i)).size();
+    grads[i] = Output(kOutputsPerTensor * i)->mutable_data<float>();
+    moments[i] = Output(kOutputsPerTensor * i + 1)->mutable_data<float>();
+    params[i] = Output(kOutputsPerTensor * i + 2)->mutable_data<float>();
+  }
+  const float* lr = Input(LR).data<float>();
+  RunOnTensorChunks(
+      ws_, num_threads_, sizes, [&](int i, TIndex begin, TIndex end) {
+        momentum_sgd_update<CPUContext>(
+            end - begin,
+            grads[i] + begin,
+            moments[i] + begin,
+            grads[i] + begin,
+            moments[i] + begin,
+            lr,
+            momentum_,
+            nesterov_,
+            params[i] + begin,
+            &context_);
+      });
+  return true;
+}
+
+template <>
+bool MultiTensorAdagradOp<CPUContext>::RunOnTensors() {
+  const int num_tensors = NumTensors();
+  vector<TIndex> sizes(num_tensors);
+  vector<const float*> grads(num_tensors);
+  vector<float*> params(num_tensors);
+  vector<float*> moments(num_tensors);
+  for (int i = 0; i < num_tensors; ++i) {
+    sizes[i] = Input(GradInput(i)).size();
+    grads[i] = Input(GradInput(i)).data<float>();
+    params[i] = Output(kOutputsPerTensor * i)->mutable_data<float>();
+    moments[i] = Output(kOutputsPerTensor * i + 1)->mutable_data<float>();
+  }
+  const float lr = Input(LR).data<float>()[0];
+  RunOnTensorChunks(
+      ws_, num_threads_, sizes, [&](int i, TIndex begin, TIndex end) {
+        adagrad_update(
+            end - begin,
+            params[i] + begin,
+            grads[i] + begin,
+            moments[i] + begin,
+            params[i] + begin,
+            moments[i] + begin,
+            epsilon_,
+            decay_,
+            lr);
+      });
+  return true;
+}
+
+template <>
+bool MultiTensorAdamOp<CPUContext>::RunOnTensors() {
+  const int num_tensors = NumTensors();
+  vector<TIndex> sizes(num_tensors);
+  vector<const float*> grads(num_tensors);
+  vector<float*> params(num_tensors);
+  vector<float*> moments_1(num_tensors);
+  vector<float*> moments_2(num_tensors);
+  for (int i = 0; i < num_tensors; ++i) {
+    sizes[i] = Input(GradInput(i)).size();
+    grads[i] = Input(GradInput(i)).data<float>();
+    params[i] = Output(kOutputsPerTensor * i)->mutable_data<float>();
+    moments_1[i] = Output(kOutputsPerTensor * i + 1)->mutable_data<float>();
+    moments_2[i] = Output(kOutputsPerTensor * i + 2)->mutable_data<float>();
+  }
+  const float lr = Input(LR).data<float>()[0];
+  RunOnTensorChunks(
+      ws_, num_threads_, sizes, [&](int i, TIndex begin, TIndex end) {
+        adam_compute(
+            end - begin,
+            params[i] + begin,
+            grads[i] + begin,
+            moments_1[i] + begin,
+            moments_2[i] + begin,
+            params[i] + begin,
+            moments_1[i] + begin,
+            moments_2[i] + begin,
+            beta1_,
+            beta2_,
+            epsilon_,
+            correction_,
+            lr);
+      });
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(
+    MultiTensorMomentumSGDUpdate,
+    MultiTensorMomentumSGDUpdateOp<CPUContext>);
+OPERATOR_SCHEMA(MultiTensorMomentumSGDUpdate)
+    .NumInputsOutputs([](int in, int out) {
+      return in >= 1 && (in - 1) % 3 == 0 && out == in - 1;
+    })
+    .EnforceInplace([](int in, int out) { return in == out + 1; })
+    .SetDoc(R"DOC(
+
+Performs the MomentumSGDUpdate of a list of parameters at once. Given inputs
+(lr, grad_0, moment_0, param_0, grad_1, moment_1, param_1, ...) and arguments
+(momentum, nesterov), updates every (grad_i, moment_i, param_i) in place
+exactly as MomentumSGDUpdate does, reading the learning rate once.
+
+Output is (grad_0, moment_0, param_0, grad_1, ...), which must be in-place
+with the corresponding inputs.
+
+The elements of all the parameters are split evenly over up to num_threads
+threads of the workspace thread pool, so that many small parameters are
+updated with a single op.
+
+)DOC")
+    .Arg("momentum", "Momentum hyperparameter.")
+    .Arg("nesterov", "(boolean) Whether to use Nesterov Accelerated Gradient.")
+    .Arg("num_threads", "Number of threads to update with on CPU, default 1.")
+    .Input(0, "lr", "Learning rate.")
+    .Input(1, "grad_0", "Gradient of the first parameter, and so on.")
+    .Input(2, "moment_0", "Momentum of the first parameter, and so on.")
+    .Input(3, "param_0", "The first parameter, and so on.")
+    .Output(0, "output_grad_0", "Adjusted gradient, and so on.")
+    .Output(1, "output_moment_0", "Updated momentum, and so on.")
+    .Output(2, "output_param_0", "Updated parameter, and so on.");
+SHOULD_NOT_DO_GRADIENT(MultiTensorMomentumSGDUpdate);
+
+REGISTER_CPU_OPERATOR(MultiTensorAdagrad, MultiTensorAdagradOp<CPUContext>);
+OPERATOR_SCHEMA(MultiTensorAdagrad)
+    .NumInputsOutputs([](int in, int out) {
+      return in >= 1 && (in - 1) % 3 == 0 && out == (in - 1) / 3 * 2;
+    })
+    .EnforceInplace([](int in, int out) {
+      return in >= 1 && (in - 1) % 3 < 2 &&
+          out == (in - 1) / 3 * 2 + (in - 1) % 3;
+    })
+    .SetDoc(R"DOC(
+
+Performs the Adagrad update of a list of parameters at once. Given inputs
+(lr, param_0, moment_0, grad_0, param_1, moment_1, grad_1, ...), updates
+every (param_i, moment_i) in place exactly as Adagrad does, reading the
+learning rate once.
+
+Output is (param_0, moment_0, param_1, moment_1, ...), which must be in-place
+with the corresponding inputs.
+
+The elements of all the parameters are split evenly over up to num_threads
+threads of the workspace thread pool, so that many small parameters are
+updated with a single op.
+
+)DOC")
+    .Arg("epsilon", "Default 1e-5")
+    .Arg("decay", "Default 1. If it is in (0, 1), the gradient square sum "
+         "is decayed by this factor.")
+    .Arg("num_threads", "Number of threads to update with on CPU, default 1.")
+    .Input(0, "lr", "Learning rate.")
+    .Input(1, "param_0", "The first parameter, and so on.")
+    .Input(2, "moment_0", "Moment of the first parameter, and so on.")
+    .Input(3, "grad_0", "Gradient of the first parameter, and so on.")
+    .Output(0, "output_param_0", "Updated parameter, and so on.")
+    .Output(1, "output_moment_0", "Updated moment, and so on.");
+SHOULD_NOT_DO_GRADIENT(MultiTensorAdagrad);
+
+REGISTER_CPU_OPERATOR(MultiTensorAdam, MultiTensorAdamOp<CPUContext>);
+OPERATOR_SCHEMA(MultiTensorAdam)
+    .NumInputsOutputs([](int in, int out) {
+      return in >= 2 && (in - 2) % 4 == 0 && out == (in - 2) / 4 * 3;
+    })
+    .EnforceInplace([](int in, int out) {
+      return in >= 2 && (in - 2) % 4 < 3 &&
+          out == (in - 2) / 4 * 3 + (in - 2) % 4;
+    })
+    .SetDoc(R"DOC(
+
+Performs the Adam update of a list of parameters at once. Given inputs
+(lr, iter, param_0, moment_1_0, moment_2_0, grad_0, param_1, ...), updates
+every (param_i, moment_1_i, moment_2_i) in place exactly as Adam does,
+reading the learning rate and computing the bias correction once.
+
+Output is (param_0, moment_1_0, moment_2_0, param_1, ...), which must be
+in-place with the corresponding inputs.
+
+The elements of all the parameters are split evenly over up to num_threads
+threads of the workspace thread pool, so that many small parameters are
+updated with a single op.
+
+)DOC")
+    .Arg("beta1", "Default 0.9")
+    .Arg("beta2", "Default 0.999")
+    .Arg("epsilon", "Default 1e-5")
+    .Arg("num_threads", "Number of threads to update with on CPU, default 1.")
+    .Input(0, "lr", "Learning rate.")
+    .Input(1, "iter", "Iteration number.")
+    .Input(2, "param_0", "The first parameter, and so on.")
+    .Input(3, "moment_1_0", "First moment history of the first parameter.")
+    .Input(4, "moment_2_0", "Second moment history of the first parameter.")
+    .Input(5, "grad_0", "Gradient of the first parameter, and so on.")
+    .Output(0, "output_param_0", "Updated parameter, and so on.")
+    .Output(1, "output_moment_1_0", "Updated first moment, and so on.")
+    .Output(2, "output_moment_2_0", "Updated second moment, and so on.");
+SHOULD_NOT_DO_GRADIENT(MultiTensorAdam);
+
+template <>
+bool BMUFUpdateOp<CPUContext>::RunOnTensors() {
+  const int num_tensors = NumTensors();
+  const int n = TensorsPerParam();
+  vector<TIndex> sizes(num_tensors);
+  vector<float*> params(num_tensors);
+  vector<float*> global_params(num_tensors);
+  vector<float*> momenta(num_tensors);
+  vector<float*> prev_momenta(num_tensors, nullptr);
+  for (int i = 0; i < num_tensors; ++i) {
+    sizes[i] = Input(n * i).size();
+    params[i] = Output(n * i)->mutable_data<float>();
+    global_params[i] = Output(n * i + 1)->mutable_data<float>();
+    momenta[i] = Output(n * i + 2)->mutable_data<float>();
+    if (nesterov_) {
+      prev_momenta[i] = Output(n * i + 3)->mutable_data<float>();
+    }
+  }
+  const float scale = 1.0f / num_workers_;
+  RunOnTensorChunks(
+      ws_, num_threads_, sizes, [&](int i, TIndex begin, TIndex end) {
+        EigenVectorArrayMap<float> param(params[i] + begin, end - begin);
+        EigenVectorArrayMap<float> global_param(
+            global_params[i] + begin, end - begin);
+        EigenVectorArrayMap<float> momentum(momenta[i] + begin, end - begin);
+        momentum = block_momentum_ * momentum +
+            block_learning_rate_ * (param * scale - global_param);
+        global_param += momentum;
+        if (nesterov_) {
+          EigenVectorArrayMap<float> prev_momentum(
+              prev_momenta[i] + begin, end - begin);
+          global_param -= block_momentum_ * (momentum - prev_momentum);
+          prev_momentum = momentum;
+        }
+        param = global_param;
+      });
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(BMUFUpdate, BMUFUpdateOp<CPUContext>);
+OPERATOR_SCHEMA(BMUFUpdate)
+    .NumInputsOutputs([](int in, int out) {
+      return in == out && (in % 3 == 0 || in % 4 == 0);
+    })
+    .EnforceInplace([](int in, int out) { return in == out; })
+    .SetDoc(R"DOC(
+
+Performs the global model update of blockwise model update filtering (BMUF,
+"Scalable Training of Deep Learning Machines by Incremental Block Training
+with Intra-block Parallel Optimization and Blockwise Model-Update Filtering",
+ICASSP 2016) of a list of parameters. Given inputs (param_0, global_param_0,
+momentum_0, param_1, ...), where param_i is the sum of the local models of
+num_workers workers, computes for every parameter
+
+  momentum = block_momentum * momentum +
+      block_learning_rate * (param / num_workers - global_param)
+  global_param = global_param + momentum
+  param = global_param
+
+With nesterov, every parameter also has a prev_momentum input after its
+momentum, and the global update becomes
+
+  global_param = global_param + momentum -
+      block_momentum * (momentum - prev_momentum)
+  prev_momentum = momentum
+
+The outputs must be in-place with the corresponding inputs. The elements of
+all the parameters are split evenly over up to num_threads threads of the
+workspace thread pool.
+
+)DOC")
+    .Arg("num_workers", "Number of local models summed in param, default 1.")
+    .Arg("block_learning_rate", "Block learning rate, default 1.")
+    .Arg("block_momentum", "Block momentum, default 0.")
+    .Arg("nesterov", "(boolean) Whether to use Nesterov block momentum.")
+    .Arg("num_threads", "Number of threads to update with on CPU, default 1.")
+    .Input(0, "param_0", "Sum of the local models of the first parameter.")
+    .Input(1, "global_param_0", "Global model of the first parameter.")
+    .Input(2, "momentum_0", "Block momentum of the first parameter.")
+    .Output(0, "output_param_0", "Updated parameter, and so on.")
+    .Output(1, "output_global_param_0", "Updated global model, and so on.")
+    .Output(2, "output_momentum_0", "Updated block momentum, and so on.");
+SHOULD_NOT_DO_GRADIENT(BMUFUpdate);
+
+} // namespace caffe2
@@ -0,0 +1,265 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+// Dense optimizer updates of a whole list of parameters in a single op.
+//
+// A net with hundreds of parameters otherwise runs one optimizer op per
+// parameter every iteration, most of them on small tensors, so the per-op
+// overhead dominates. These ops take the learning rate (and iteration) once,
+// followed by the tensors of every parameter, and update all of them in
+// place: on CPU the elements of all the tensors are spread over the
+// workspace thread pool, on CUDA a single kernel launch covers a batch of
+// tensors.
+//
+// The update of each parameter is the same as the one of the corresponding
+// single-tensor op.
+
+template <class Context>
+class MultiTensorMomentumSGDUpdateOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MultiTensorMomentumSGDUpdateOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        momentum_(OperatorBase::GetSingleArgument<float>("momentum", 0.0)),
+        nesterov_(OperatorBase::GetSingleArgument<int>("nesterov", 0)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+
+  bool RunOnDevice() override {
+    CAFFE_ENFORCE_EQ(Input(LR).size(), 1);
+    for (int i = 0; i < NumTensors(); ++i) {
+      CAFFE_ENFORCE_EQ(Input(GradInput(i)).size(), Input(ParamInput(i)).size());
+      CAFFE_ENFORCE_EQ(
+          Input(GradInput(i)).size(), Input(MomentInput(i)).size());
+    }
+    return RunOnTensors();
+  }
+
+  // Inputs: lr, then grad, moment, param for every parameter.
+  // Outputs: grad, moment, param for every parameter, in place.
+  static constexpr int kInputsPerTensor = 3;
+  static constexpr int kOutputsPerTensor = 3;
+
+ protected:
+  bool RunOnTensors();
+
+  int NumTensors() {
+    return OutputSize() / kOutputsPerTensor;
+  }
+  static int GradInput(int i) {
+    return 1 + kInputsPerTensor * i;
+  }
+  static int MomentInput(int i) {
+    return 2 + kInputsPerTensor * i;
+  }
+  static int ParamInput(int i) {
+    return 3 + kInputsPerTensor * i;
+  }
+
+  float momentum_;
+  bool nesterov_;
+  const int num_threads_;
+  Workspace* ws_;
+  INPUT_TAGS(LR);
+};
+
+template <class Context>
+class MultiTensorAdagradOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MultiTensorAdagradOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)),
+        decay_(OperatorBase::GetSingleArgument<float>("decay", 1.0f)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+
+  bool RunOnDevice() override {
+    CAFFE_ENFORCE_EQ(Input(LR).size(), 1);
+    for (int i = 0; i < NumTensors(); ++i) {
+      CAFFE_ENFORCE_EQ(Input(GradInput(i)).size(), Input(ParamInput(i)).size());
+      CAFFE_ENFORCE_EQ(
+          Input(GradInput(i)).size(), Input(MomentInput(i)).size());
+    }
+    return RunOnTensors();
+  }
+
+  // Inputs: lr, then param, moment, grad for every parameter.
+  // Outputs: param, moment for every parameter, in place.
+  static constexpr int kInputsPerTensor = 3;
+  static constexpr int kOutputsPerTensor = 2;
+
+ protected:
+  bool RunOnTensors();
+
+  int NumTensors() {
+    return OutputSize() / kOutputsPerTensor;
+  }
+  static int ParamInput(int i) {
+    return 1 + kInputsPerTensor * i;
+  }
+  static int MomentInput(int i) {
+    return 2 + kInputsPerTensor * i;
+  }
+  static int GradInput(int i) {
+    return 3 + kInputsPerTensor * i;
+  }
+
+  float epsilon_;
+  float decay_;
+  const int num_threads_;
+  Workspace* ws_;
+  INPUT_TAGS(LR);
+};
+
+template <class Context>
+class MultiTensorAdamOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MultiTensorAdamOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        beta1_(OperatorBase::GetSingleArgument<float>("beta1", 0.9f)),
+        beta2_(OperatorBase::GetSingleArgument<float>("beta2", 0.999f)),
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+  }
+
+  bool RunOnDevice() override {
+    // Iter live on the CPU
+    CAFFE_ENFORCE(OperatorBase::InputIsType<TensorCPU>(ITER));
+    CAFFE_ENFORCE_EQ(Input(LR).size(), 1);
+    for (int i = 0; i < NumTensors(); ++i) {
+      CAFFE_ENFORCE_EQ(Input(GradInput(i)).size(), Input(ParamInput(i)).size());
+      CAFFE_ENFORCE_EQ(
+          Input(GradInput(i)).size(), Input(Moment1Input(i)).size());
+      CAFFE_ENFORCE_EQ(
+          Input(GradInput(i)).size(), Input(Moment2Input(i)).size());
+    }
+    const auto iter =
+        OperatorBase::Input<TensorCPU>(ITER).template data<int64_t>()[0];
+    const auto t = iter + 1;
+    correction_ =
+        std::sqrt(1.f - std::pow(beta2_, t)) / (1.f - std::pow(beta1_, t));
+    return RunOnTensors();
+  }
+
+  // Inputs: lr, iter, then param, moment_1, moment_2, grad for every
+  // parameter.
+  // Outputs: param, moment_1, moment_2 for every parameter, in place.
+  static constexpr int kInputsPerTensor = 4;
+  static constexpr int kOutputsPerTensor = 3;
+
+ protected:
+  bool RunOnTensors();
+
+  int NumTensors() {
+    return OutputSize() / kOutputsPerTensor;
+  }
+  static int ParamInput(int i) {
+    return 2 + kInputsPerTensor * i;
+  }
+  static int Moment1Input(int i) {
+    return 3 + kInputsPerTensor * i;
+  }
+  static int Moment2Input(int i) {
+    return 4 + kInputsPerTensor * i;
+  }
+  static int GradInput(int i) {
+    return 5 + kInputsPerTensor * i;
+  }
+
+  float beta1_;
+  float beta2_;
+  float epsilon_;
+  // Bias correction of the current iteration.
+  float correction_;
+  const int num_threads_;
+  Workspace* ws_;
+  INPUT_TAGS(LR, ITER);
+};
+
+// The global model update of blockwise model update filtering (BMUF) of all
+// the parameters, once the local models were summed over all the workers.
+// It replaces a chain of Scale, Sub, Add and Copy ops per parameter.
+template <class Context>
+class BMUFUpdateOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  BMUFUpdateOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        num_workers_(OperatorBase::GetSingleArgument<int>("num_workers", 1)),
+        block_learning_rate_(OperatorBase::GetSingleArgument<float>(
+            "block_learning_rate",
+            1.0f)),
+        block_momentum_(
+            OperatorBase::GetSingleArgument<float>("block_momentum", 0.0f)),
+        nesterov_(OperatorBase::GetSingleArgument<int>("nesterov", 0)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        ws_(ws) {
+    CAFFE_ENFORCE_GE(num_workers_, 1, "num_workers must be positive.");
+    CAFFE_ENFORCE_GE(num_threads_, 1, "num_threads must be positive.");
+    CAFFE_ENFORCE_EQ(
+        InputSize() % TensorsPerParam(),
+        0,
+        "Expected ",
+        TensorsPerParam(),
+        " inputs per parameter.");
+  }
+
+  bool RunOnDevice() override {
+    for (int i = 0; i < NumTensors(); ++i) {
+      for (int j = 1; j < TensorsPerParam(); ++j) {
+        CAFFE_ENFORCE_EQ(
+            Input(TensorsPerParam() * i).size(),
+            Input(TensorsPerParam() * i + j).size());
+      }
+    }
+    return RunOnTensors();
+  }
+
+ protected:
+  bool RunOnTensors();
+
+  // Inputs and outputs: param, global_param, momentum and, with nesterov,
+  // prev_momentum for every parameter, in place.
+  int TensorsPerParam() const {
+    return nesterov_ ? 4 : 3;
+  }
+  int NumTensors() {
+    return InputSize() / TensorsPerParam();
+  }
+
+  const int num_workers_;
+  const float block_learning_rate_;
+  const float block_momentum_;
+  const bool nesterov_;
+  const int num_threads_;
+  Workspace* ws_;
+};
+
+} // namespace caffe2
@@ -0,0 +1,272 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <array>
+
+#include "caffe2/core/common_gpu.h"
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/sgd/multi_tensor_ops.h"
+
+namespace caffe2 {
+
+namespace {
+
+// The tensors of a launch are passed by value as kernel arguments, which are
+// limited to 4KB, so a launch covers at most this many parameters.
+constexpr int kMaxTensorsPerLaunch = 32;
+// Elements of a tensor that a block updates.
+constexpr int kElementsPerBlock = 4 * CAFFE_CUDA_NUM_THREADS;
+
+// kDepth pointers for each of the tensors of a launch, such as the param,
+// moment and grad of every parameter. The blocks of tensor i are
+// [block_offsets[i], block_offsets[i + 1]).
+template <int kDepth>
+struct TensorListMetadata {
+  float* ptrs[kDepth][kMaxTensorsPerLaunch];
+  int sizes[kMaxTensorsPerLaunch];
+  int block_offsets[kMaxTensorsPerLaunch + 1];
+};
+
+template <int kDepth, typename Functor>
+__global__ void MultiTensorApplyKernel(
+    const TensorListMetadata<kDepth> meta,
+    const Functor functor) {
+  // The number of tensors is small, and every thread of a block looks up the
+  // same one.
+  int tensor = 0;
+  while (blockIdx.x >= meta.block_offsets[tensor + 1]) {
+    ++tensor;
+  }
+  float* ptrs[kDepth];
+  for (int d = 0; d < kDepth; ++d) {
+    ptrs[d] = meta.ptrs[d][tensor];
+  }
+  const int begin =
+      (blockIdx.x - meta.block_offsets[tensor]) * kElementsPerBlock;
+  const int end = min(begin + kElementsPerBlock, meta.sizes[tensor]);
+  for (int i = begin + threadIdx.x; i < end; i += blockDim.x) {
+    functor(ptrs, i);
+  }
+}
+
+// Applies functor(ptrs, i) to every element i of every tensor, where ptrs
+// are the kDepth pointers of the tensor, with one launch per batch of up to
+// kMaxTensorsPerLaunch tensors.
+template <int kDepth, typename Functor>
+void MultiTensorApply(
+    const vector<int>& sizes,
+    const vector<std::array<float*, kDepth>>& ptrs,
+    const Functor& functor,
+    CUDAContext* context) {
+  TensorListMetadata<kDepth> meta;
+  int num_tensors = 0;
+  meta.block_offsets[0] = 0;
+  for (int i = 0; i < sizes.size(); ++i) {
+    if (sizes[i] == 0) {
+      continue;
+    }
+    for (int d = 0; d < kDepth; ++d) {
+      meta.ptrs[d][num_tensors] = ptrs[i][d];
+    }
+    meta.sizes[num_tensors] = sizes[i];
+    meta.block_offsets[num_tensors + 1] = meta.block_offsets[num_tensors] +
+        (sizes[i] + kElementsPerBlock - 1) / kElementsPerBlock;
+    ++num_tensors;
+    if (num_tensors == kMaxTensorsPerLaunch) {
+      MultiTensorApplyKernel<kDepth, Functor><<<
+          meta.block_offsets[num_tensors],
+          CAFFE_CUDA_NUM_THREADS,
+          0,
+          context->cuda_stream()>>>(meta, functor);
+      num_tensors = 0;
+    }
+  }
+  if (num_tensors > 0) {
+    MultiTensorApplyKernel<kDepth, Functor><<<
+        meta.block_offsets[num_tensors],
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context->cuda_stream()>>>(meta, functor);
+  }
+}
+
+// ptrs: grad, moment, param.
+struct MomentumSGDFunctor {
+  const float* lr;
+  float momentum;
+  bool nesterov;
+
+  __device__ void operator()(float* const* ptrs, int i) const {
+    const float LR = *lr;
+    const float gi = ptrs[0][i];
+    const float mi = ptrs[1][i];
+    if (!nesterov) {
+      const float adjusted_gradient = LR * gi + momentum * mi;
+      ptrs[0][i] = adjusted_gradient;
+      ptrs[1][i] = adjusted_gradient;
+      ptrs[2][i] -= adjusted_gradient;
+    } else {
+      const float mi_new = momentum * mi + LR * gi;
+      const float adjusted_gradient = (1 + momentum) * mi_new - momentum * mi;
+      ptrs[0][i] = adjusted_gradient;
+      ptrs[1][i] = mi_new;
+      ptrs[2][i] -= adjusted_gradient;
+    }
+  }
+};
+
+// ptrs: param, moment, grad.
+struct AdagradFunctor {
+  const float* lr;
+  float epsilon;
+  float decay;
+
+  __device__ void operator()(float* const* ptrs, int i) const {
+    const float gi = ptrs[2][i];
+    const float hi = ptrs[1][i] = decay * ptrs[1][i] + gi * gi;
+    ptrs[0][i] += *lr * gi / (sqrtf(hi) + epsilon);
+  }
+};
+
+// ptrs: param, moment_1, moment_2, grad.
+struct AdamFunctor {
+  const float* lr;
+  float beta1;
+  float beta2;
+  float eps_hat;
+  float correction;
+
+  __device__ void operator()(float* const* ptrs, int i) const {
+    const float gi = ptrs[3][i];
+    const float mi = ptrs[1][i] = ptrs[1][i] * beta1 + gi * (1 - beta1);
+    const float vi = ptrs[2][i] = ptrs[2][i] * beta2 + gi * gi * (1 - beta2);
+    ptrs[0][i] += *lr * correction * mi / (sqrtf(vi) + eps_hat);
+  }
+};
+
+// ptrs: param, global_param, momentum, prev_momentum.
+struct BMUFFunctor {
+  float scale;
+  float block_learning_rate;
+  float block_momentum;
+  bool nesterov;
+
+  __device__ void operator()(float* const* ptrs, int i) const {
+    const float vi = ptrs[2][i] = block_momentum * ptrs[2][i] +
+        block_learning_rate * (ptrs[0][i] * scale - ptrs[1][i]);
+    float gi = ptrs[1][i] + vi;
+    if (nesterov) {
+      gi -= block_momentum * (vi - ptrs[3][i]);
+      ptrs[3][i] = vi;
+    }
+    ptrs[1][i] = gi;
+    ptrs[0][i] = gi;
+  }
+};
+
+} // namespace
+
+template <>
+bool MultiTensorMomentumSGDUpdateOp<CUDAContext>::RunOnTensors() {
+  vector<int> sizes(NumTensors());
+  vector<std::array<float*, 3>> ptrs(NumTensors());
+  for (int i = 0; i < NumTensors(); ++i) {
+    sizes[i] = Input(GradInput(i)).size();
+    for (int d = 0; d < kOutputsPerTensor; ++d) {
+      ptrs[i][d] = Output(kOutputsPerTensor * i + d)->mutable_data<float>();
+    }
+  }
+  MultiTensorApply<3>(
+      sizes,
+      ptrs,
+      MomentumSGDFunctor{Input(LR).data<float>(), momentum_, nesterov_},
+      &context_);
+  return true;
+}
+
+template <>
+bool MultiTensorAdagradOp<CUDAContext>::RunOnTensors() {
+  vector<int> sizes(NumTensors());
+  vector<std::array<float*, 3>> ptrs(NumTensors());
+  for (int i = 0; i < NumTensors(); ++i) {
+    sizes[i] = Input(GradInput(i)).size();
+    ptrs[i][0] = Output(kOutputsPerTensor * i)->mutable_data<float>();
+    ptrs[i][1] = Output(kOutputsPerTensor * i + 1)->mutable_data<float>();
+    // The gradient is only read.
+    ptrs[i][2] = const_cast<float*>(Input(GradInput(i)).data<float>());
+  }
+  MultiTensorApply<3>(
+      sizes,
+      ptrs,
+      AdagradFunctor{Input(LR).data<float>(), epsilon_, decay_},
+      &context_);
+  return true;
+}
+
+template <>
+bool MultiTensorAdamOp<CUDAContext>::RunOnTensors() {
+  vector<int> sizes(NumTensors());
+  vector<std::array<float*, 4>> ptrs(NumTensors());
+  for (int i = 0; i < NumTensors(); ++i) {
+    sizes[i] = Input(GradInput(i)).size();
+    for (int d = 0; d < kOutputsPerTensor; ++d) {
+      ptrs[i][d] = Output(kOutputsPerTensor * i + d)->mutable_data<float>();
+    }
+    // The gradient is only read.
+    ptrs[i][3] = const_cast<float*>(Input(GradInput(i)).data<float>());
+  }
+  MultiTensorApply<4>(
+      sizes,
+      ptrs,
+      AdamFunctor{
+          Input(LR).data<float>(), beta1_, beta2_, epsilon_, correction_},
+      &context_);
+  return true;
+}
+
+template <>
+bool BMUFUpdateOp<CUDAContext>::RunOnTensors() {
+  const int n = TensorsPerParam();
+  vector<int> sizes(NumTensors());
+  vector<std::array<float*, 4>> ptrs(NumTensors());
+  for (int i = 0; i < NumTensors(); ++i) {
+    sizes[i] = Input(n * i).size();
+    for (int d = 0; d < n; ++d) {
+      ptrs[i][d] = Output(n * i + d)->mutable_data<float>();
+    }
+    if (!nesterov_) {
+      ptrs[i][3] = nullptr;
+    }
+  }
+  MultiTensorApply<4>(
+      sizes,
+      ptrs,
+      BMUFFunctor{1.0f / num_workers_,
+                  block_learning_rate_,
+                  block_momentum_,
+                  nesterov_},
+      &context_);
+  return true;
+}
+
+REGISTER_CUDA_OPERATOR(
+    MultiTensorMomentumSGDUpdate,
+    MultiTensorMomentumSGDUpdateOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(MultiTensorAdagrad, MultiTensorAdagradOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(MultiTensorAdam, MultiTensorAdamOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(BMUFUpdate, BMUFUpdateOp<CUDAContext>);
+
+} // namespace caffe2
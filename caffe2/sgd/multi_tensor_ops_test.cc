@@ -0,0 +1,254 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Sizes of the parameters, including an empty one and one large enough to
+// be split over several threads.
+const vector<TIndex> kSizes = {7, 0, 100000, 1, 33};
+
+void FillInput(
+    Workspace* ws,
+    const string& name,
+    const string& suffix,
+    TIndex size,
+    float offset) {
+  FillTensorWith(ws, name + suffix, {size}, [&](TIndex i) {
+    return offset + 0.01f * ((i * 7 + name.size()) % 41) - 0.2f;
+  });
+}
+
+void ExpectTensorsEqual(Workspace* ws, const string& a, const string& b) {
+  const auto& A = ws->GetBlob(a)->Get<TensorCPU>();
+  const auto& B = ws->GetBlob(b)->Get<TensorCPU>();
+  ASSERT_EQ(A.size(), B.size());
+  for (TIndex i = 0; i < A.size(); ++i) {
+    EXPECT_FLOAT_EQ(A.data<float>()[i], B.data<float>()[i]) << a << " " << i;
+  }
+}
+
+// Fills state_name + suffix of every parameter twice, "_single" and
+// "_multi", so that the single-tensor and multi-tensor ops start from the
+// same values.
+void FillState(Workspace* ws, const vector<string>& state_names) {
+  for (int i = 0; i < kSizes.size(); ++i) {
+    for (int s = 0; s < state_names.size(); ++s) {
+      for (const char* suffix : {"_single", "_multi"}) {
+        FillInput(
+            ws,
+            state_names[s] + std::to_string(i),
+            suffix,
+            kSizes[i],
+            0.3f * s + (state_names[s] == "moment" ? 1.0f : 0.0f));
+      }
+    }
+  }
+  FillInput(ws, "lr", "", 1, -0.1f);
+  auto* iter = ws->CreateBlob("iter")->GetMutable<TensorCPU>();
+  iter->Resize(1);
+  iter->mutable_data<int64_t>()[0] = 5;
+}
+
+// Runs op_type on every parameter, then multi_op_type on all of them, and
+// compares the results. The inputs of the ops are the shared inputs, then
+// state_names for each parameter; the outputs are the first num_outputs of
+// state_names.
+void CompareWithSingleTensorOp(
+    const string& op_type,
+    const string& multi_op_type,
+    const vector<string>& shared_inputs,
+    const vector<string>& state_names,
+    int num_outputs,
+    const vector<Argument>& args) {
+  for (int num_threads : {1, 4}) {
+    Workspace ws;
+    FillState(&ws, state_names);
+    vector<string> multi_inputs(shared_inputs);
+    vector<string> multi_outputs;
+    for (int i = 0; i < kSizes.size(); ++i) {
+      vector<string> inputs;
+      vector<string> outputs;
+      for (int s = 0; s < state_names.size(); ++s) {
+        const string name = state_names[s] + std::to_string(i);
+        inputs.push_back(name + "_single");
+        multi_inputs.push_back(name + "_multi");
+        if (s < num_outputs) {
+          outputs.push_back(name + "_single");
+          multi_outputs.push_back(name + "_multi");
+        }
+      }
+      // The single-tensor ops take the learning rate and iteration last.
+      inputs.insert(inputs.end(), shared_inputs.begin(), shared_inputs.end());
+      ASSERT_TRUE(ws.RunOperatorOnce(
+          CreateOperatorDef(op_type, "", inputs, outputs, args)));
+    }
+    auto multi_args = args;
+    multi_args.push_back(MakeArgument<int>("num_threads", num_threads));
+    ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+        multi_op_type, "", multi_inputs, multi_outputs, multi_args)));
+    for (int i = 0; i < kSizes.size(); ++i) {
+      for (int s = 0; s < num_outputs; ++s) {
+        const string name = state_names[s] + std::to_string(i);
+        ExpectTensorsEqual(&ws, name + "_multi", name + "_single");
+      }
+    }
+  }
+}
+
+} // namespace
+
+TEST(MultiTensorOpsTest, MomentumSGDUpdate) {
+  for (int nesterov : {0, 1}) {
+    // MomentumSGDUpdate takes the learning rate between the moment and the
+    // param, so it does not fit CompareWithSingleTensorOp.
+    Workspace ws;
+    FillState(&ws, {"grad", "moment", "param"});
+    vector<string> multi_inputs = {"lr"};
+    vector<string> multi_outputs;
+    const vector<Argument> args = {
+        MakeArgument<float>("momentum", 0.9f),
+        MakeArgument<int>("nesterov", nesterov)};
+    for (int i = 0; i < kSizes.size(); ++i) {
+      const string n = std::to_string(i);
+      ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+          "MomentumSGDUpdate",
+          "",
+          {"grad" + n + "_single",
+           "moment" + n + "_single",
+           "lr",
+           "param" + n + "_single"},
+          {"grad" + n + "_single",
+           "moment" + n + "_single",
+           "param" + n + "_single"},
+          args)));
+      for (const char* state : {"grad", "moment", "param"}) {
+        multi_inputs.push_back(state + n + "_multi");
+        multi_outputs.push_back(state + n + "_multi");
+      }
+    }
+    auto multi_args = args;
+    multi_args.push_back(MakeArgument<int>("num_threads", 4));
+    ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+        "MultiTensorMomentumSGDUpdate",
+        "",
+        multi_inputs,
+        multi_outputs,
+        multi_args)));
+    for (int i = 0; i < kSizes.size(); ++i) {
+      for (const char* state : {"grad", "moment", "param"}) {
+        const string name = state + std::to_string(i);
+        ExpectTensorsEqual(&ws, name + "_multi", name + "_single");
+      }
+    }
+  }
+}
+
+TEST(MultiTensorOpsTest, Adagrad) {
+  CompareWithSingleTensorOp(
+      "Adagrad",
+      "MultiTensorAdagrad",
+      {"lr"},
+      {"param", "moment", "grad"},
+      2,
+      {MakeArgument<float>("epsilon", 1e-4f),
+       MakeArgument<float>("decay", 0.95f)});
+}
+
+TEST(MultiTensorOpsTest, Adam) {
+  CompareWithSingleTensorOp(
+      "Adam",
+      "MultiTensorAdam",
+      {"lr", "iter"},
+      {"param", "moment_1", "moment_2", "grad"},
+      3,
+      {MakeArgument<float>("beta1", 0.8f),
+       MakeArgument<float>("beta2", 0.99f)});
+}
+
+TEST(MultiTensorOpsTest, BMUFUpdate) {
+  const int kNumWorkers = 3;
+  const float kBlockLearningRate = 0.9f;
+  const float kBlockMomentum = 0.5f;
+  for (int nesterov : {0, 1}) {
+    vector<string> state_names = {"param", "global_param", "momentum"};
+    if (nesterov) {
+      state_names.push_back("prev_momentum");
+    }
+    Workspace ws;
+    FillState(&ws, state_names);
+    vector<string> inputs;
+    for (int i = 0; i < kSizes.size(); ++i) {
+      for (const auto& state : state_names) {
+        inputs.push_back(state + std::to_string(i) + "_multi");
+      }
+    }
+    ASSERT_TRUE(ws.RunOperatorOnce(CreateOperatorDef(
+        "BMUFUpdate",
+        "",
+        inputs,
+        inputs,
+        {MakeArgument<int>("num_workers", kNumWorkers),
+         MakeArgument<float>("block_learning_rate", kBlockLearningRate),
+         MakeArgument<float>("block_momentum", kBlockMomentum),
+         MakeArgument<int>("nesterov", nesterov),
+         MakeArgument<int>("num_threads", 4)})));
+
+    auto data = [&](const string& state, int i, const string& suffix) {
+      return ws.GetBlob(state + std::to_string(i) + suffix)
+          ->Get<TensorCPU>()
+          .data<float>();
+    };
+    for (int i = 0; i < kSizes.size(); ++i) {
+      for (TIndex j = 0; j < kSizes[i]; ++j) {
+        const float param = data("param", i, "_single")[j];
+        float global_param = data("global_param", i, "_single")[j];
+        const float momentum = kBlockMomentum *
+                data("momentum", i, "_single")[j] +
+            kBlockLearningRate * (param / kNumWorkers - global_param);
+        global_param += momentum;
+        if (nesterov) {
+          global_param -= kBlockMomentum *
+              (momentum - data("prev_momentum", i, "_single")[j]);
+          EXPECT_NEAR(data("prev_momentum", i, "_multi")[j], momentum, 1e-6);
+        }
+        EXPECT_NEAR(data("momentum", i, "_multi")[j], momentum, 1e-6);
+        EXPECT_NEAR(data("global_param", i, "_multi")[j], global_param, 1e-6);
+        EXPECT_NEAR(data("param", i, "_multi")[j], global_param, 1e-6);
+      }
+    }
+  }
+}
+
+TEST(MultiTensorOpsTest, RequiresInPlace) {
+  Workspace ws;
+  FillState(&ws, {"param", "moment", "grad"});
+  EXPECT_THROW(
+      ws.RunOperatorOnce(CreateOperatorDef(
+          "MultiTensorAdagrad",
+          "",
+          {"lr", "param0_multi", "moment0_multi", "grad0_multi"},
+          {"param0_out", "moment0_multi"})),
+      EnforceNotMet);
+}
+
+} // namespace caffe2
@@ -45,11 +45,24 @@ class YellowFinOp final : public Operator<Context> {
 
  protected:
   // GetLrMu and MomentumSgdUpdate have different implementations for GPU and
-  // CPU. All other methods are generic.
+  // CPU. All other methods are generic, except that the GPU fuses AfterApply
+  // with MomentumSgdUpdate and only needs two kernel launches.
   void GetLrMu();
   void MomentumSgdUpdate();
 
   void AfterApply() {
+// Temporary vectors of the parameter size
+
+#define CAFFE2_YF_INIT_VECTOR(NAME) \
+  NAME##_tensor_.Resize(D_);        \
+  NAME##_ = NAME##_tensor_.template mutable_data<T>();
+
+    CAFFE2_YF_INIT_VECTOR(aux_vector)
+    CAFFE2_YF_INIT_VECTOR(g_deb)
+    CAFFE2_YF_INIT_VECTOR(g2_deb)
+    CAFFE2_YF_INIT_VECTOR(g_deb2)
+#undef CAFFE2_YF_INIT_VECTOR
+
     // g
     MovingAverage(D_, grad_, g_avg_, g_avg_out_, g_deb_);
     // g2
@@ -195,16 +208,6 @@ class YellowFinOp final : public Operator<Context> {
     g_norm2_max_avg_out_ = ++out_memory_it;
     distance_avg_out_ = ++out_memory_it;
 
-#define CAFFE2_YF_INIT_VECTOR(NAME) \
-  NAME##_tensor_.Resize(D_);        \
-  NAME##_ = NAME##_tensor_.template mutable_data<T>();
-
-    CAFFE2_YF_INIT_VECTOR(aux_vector)
-    CAFFE2_YF_INIT_VECTOR(g_deb)
-    CAFFE2_YF_INIT_VECTOR(g2_deb)
-    CAFFE2_YF_INIT_VECTOR(g_deb2)
-#undef CAFFE2_YF_INIT_VECTOR
-
 #define CAFFE2_YF_INIT_SCALAR(NAME) \
   NAME##_tensor_.Resize(1);         \
   NAME##_ = NAME##_tensor_.template mutable_data<T>();
@@ -17,41 +17,41 @@
 // YellowFin: An automatic tuner for momentum SGD
 // (https://arxiv.org/abs/1706.03471)
 
+#include <cub/block/block_reduce.cuh>
+
 #include "caffe2/core/common_gpu.h"
 #include "caffe2/core/context_gpu.h"
 #include "caffe2/sgd/yellowfin_op.h"
 
 namespace caffe2 {
 
-__global__ void GetLrMuKernel(
-    const float* g_norm2_max_deb,
-    const float* g_norm2_min_deb,
-    const float* distance_deb,
-    const float* variance,
-    float* mu,
-    float* lr) {
-  const float curv_ratio = sqrtf(*g_norm2_max_deb / *g_norm2_min_deb);
-  const float mu_limit = (curv_ratio - 1.0f) / (curv_ratio + 1.0f);
-  const float pre_p = *distance_deb * *g_norm2_min_deb;
-  const float p = (pre_p * pre_p) / (2.0f * *variance);
-  const float w3 = (-sqrtf(p * p + 4.0f / 27.0f * p * p * p) - p) / 2.0f;
-  const float w3_sign = w3 > 0.0f ? 1.0f : -1.0f;
-  const float w = w3_sign * powf(fabsf(w3), 1.0f / 3.0f);
-  const float y = w - p / 3.0f / w;
-  const float root = y + 1.0f;
-  *mu = fmaxf(root * root, mu_limit * mu_limit);
-  *lr = powf(1.0f - sqrtf(*mu), 2) / *g_norm2_min_deb;
+// On GPU the whole update takes two launches: MomentumSgdUpdate also updates
+// the moving averages of the gradient and reduces the squared norms needed
+// by the tuner, one partial sum per block, and AfterApply finishes the
+// reductions and computes all the scalars in a single block.
+
+namespace {
+
+inline int NumStatisticsBlocks(const int N) {
+  return std::max(CAFFE_GET_BLOCKS(N), 1);
 }
 
-template <>
-void YellowFinOp<float, CUDAContext>::GetLrMu() {
-  // Finding root of cubic formula for YF's Single Step
-  GetLrMuKernel<<<1, 1, 0, context_.cuda_stream()>>>(
-      g_norm2_max_deb_, g_norm2_min_deb_, distance_deb_, variance_, mu_, lr_);
-  MovingAverage(1, mu_, mu_avg_, mu_avg_out_, mu_deb_);
-  MovingAverage(1, lr_, lr_avg_, lr_avg_out_, lr_deb_);
+// Returns the debiased moving average and stores the new one in avg_out.
+__device__ float MovingAverageScalar(
+    const float elt,
+    const float avg,
+    float* avg_out,
+    const float beta,
+    const float debias_factor) {
+  const float new_avg = beta * avg + (1.0f - beta) * elt;
+  *avg_out = new_avg;
+  return debias_factor * new_avg;
 }
 
+} // namespace
+
+// partial_sums[b] and partial_sums[gridDim.x + b] are the sums of the squared
+// gradient and of the squared debiased gradient average over block b.
 __global__ void MomentumSgdKernel(
     const int N,
     const float* mu_ptr,
@@ -59,29 +59,54 @@ __global__ void MomentumSgdKernel(
     const float* param,
     const float* grad,
     const float* moment,
+    const float* g_avg,
+    const float* g2_avg,
     float* param_out,
     float* moment_out,
-    bool nesterov) {
+    float* g_avg_out,
+    float* g2_avg_out,
+    const float beta,
+    const float debias_factor,
+    const bool nesterov,
+    float* partial_sums) {
+  typedef cub::BlockReduce<float, CAFFE_CUDA_NUM_THREADS> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage temp_storage;
   const float mu = *mu_ptr;
   const float lr = *lr_ptr;
-  if (!nesterov) {
-    CUDA_1D_KERNEL_LOOP(i, N) {
-      moment_out[i] = mu * moment[i] * lr * grad[i];
-      param_out[i] = param[i] - moment_out[i];
-    }
-  } else {
-    CUDA_1D_KERNEL_LOOP(i, N) {
-      const float moment_i = moment[i];
-      moment_out[i] = mu * moment_i + lr * grad[i];
-      param_out[i] = param[i] - (1 + mu) * moment_out[i] + mu * moment_i;
+  float g_norm2 = 0.0f;
+  float g_deb_norm2 = 0.0f;
+  CUDA_1D_KERNEL_LOOP(i, N) {
+    const float grad_i = grad[i];
+    const float moment_i = moment[i];
+    const float moment_out_i = mu * moment_i + lr * grad_i;
+    moment_out[i] = moment_out_i;
+    if (!nesterov) {
+      param_out[i] = param[i] - moment_out_i;
+    } else {
+      param_out[i] = param[i] - (1 + mu) * moment_out_i + mu * moment_i;
     }
+    const float g_avg_i = beta * g_avg[i] + (1.0f - beta) * grad_i;
+    g_avg_out[i] = g_avg_i;
+    g2_avg_out[i] = beta * g2_avg[i] + (1.0f - beta) * grad_i * grad_i;
+    const float g_deb_i = debias_factor * g_avg_i;
+    g_norm2 += grad_i * grad_i;
+    g_deb_norm2 += g_deb_i * g_deb_i;
+  }
+  g_norm2 = BlockReduce(temp_storage).Sum(g_norm2);
+  __syncthreads();
+  g_deb_norm2 = BlockReduce(temp_storage).Sum(g_deb_norm2);
+  if (threadIdx.x == 0) {
+    partial_sums[blockIdx.x] = g_norm2;
+    partial_sums[gridDim.x + blockIdx.x] = g_deb_norm2;
   }
 }
 
 template <>
 void YellowFinOp<float, CUDAContext>::MomentumSgdUpdate() {
+  const int num_blocks = NumStatisticsBlocks(D_);
+  scratch_tensor_.Resize(2 * num_blocks);
   MomentumSgdKernel<<<
-      CAFFE_GET_BLOCKS(D_),
+      num_blocks,
       CAFFE_CUDA_NUM_THREADS,
       0,
       context_.cuda_stream()>>>(
@@ -91,9 +116,143 @@ void YellowFinOp<float, CUDAContext>::MomentumSgdUpdate() {
       param_,
       grad_,
       moment_,
+      g_avg_,
+      g2_avg_,
       param_out_,
       moment_out_,
-      nesterov_);
+      g_avg_out_,
+      g2_avg_out_,
+      beta_,
+      debias_factor_,
+      nesterov_,
+      scratch_tensor_.mutable_data<float>());
+}
+
+// Mirrors the generic AfterApply and GetLrMu on the sums computed by
+// MomentumSgdKernel.
+__global__ void AfterApplyKernel(
+    const int num_blocks,
+    const float* partial_sums,
+    const int curv_win_width,
+    const int curv_win_cell,
+    const int valid_end,
+    const bool get_lr_mu,
+    const float beta,
+    const float debias_factor,
+    const float epsilon,
+    const float* curv_win,
+    const float* scalars_memory,
+    const float* lr_avg,
+    const float* mu_avg,
+    float* curv_win_out,
+    float* scalars_memory_out,
+    float* lr_avg_out,
+    float* mu_avg_out) {
+  typedef cub::BlockReduce<float, CAFFE_CUDA_NUM_THREADS> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage temp_storage;
+  float g_norm2 = 0.0f;
+  float g_deb_norm2 = 0.0f;
+  for (int i = threadIdx.x; i < num_blocks; i += blockDim.x) {
+    g_norm2 += partial_sums[i];
+    g_deb_norm2 += partial_sums[num_blocks + i];
+  }
+  g_norm2 = BlockReduce(temp_storage).Sum(g_norm2);
+  __syncthreads();
+  g_deb_norm2 = BlockReduce(temp_storage).Sum(g_deb_norm2);
+  for (int i = threadIdx.x; i < curv_win_width; i += blockDim.x) {
+    curv_win_out[i] = curv_win[i];
+  }
+  __syncthreads();
+  if (threadIdx.x != 0) {
+    return;
+  }
+  // The layout of scalars_memory is the one set up in RunOnDevice.
+  const float g_norm_avg = scalars_memory[0];
+  const float g_norm2_avg = scalars_memory[1];
+  const float g_norm2_min_avg = scalars_memory[2];
+  const float g_norm2_max_avg = scalars_memory[3];
+  const float distance_avg = scalars_memory[4];
+  float* g_norm_avg_out = scalars_memory_out;
+  float* g_norm2_avg_out = scalars_memory_out + 1;
+  float* g_norm2_min_avg_out = scalars_memory_out + 2;
+  float* g_norm2_max_avg_out = scalars_memory_out + 3;
+  float* distance_avg_out = scalars_memory_out + 4;
+
+  g_norm2 = fmaxf(epsilon, g_norm2);
+  const float g_norm2_deb = MovingAverageScalar(
+      g_norm2, g_norm2_avg, g_norm2_avg_out, beta, debias_factor);
+  const float g_norm = sqrtf(g_norm2);
+  MovingAverageScalar(
+      g_norm, g_norm_avg, g_norm_avg_out, beta, debias_factor);
+  // Curvature range
+  curv_win_out[curv_win_cell] = logf(g_norm2);
+  float g_norm2_min = curv_win_out[0];
+  float g_norm2_max = curv_win_out[0];
+  for (int i = 1; i < valid_end; ++i) {
+    g_norm2_min = fminf(g_norm2_min, curv_win_out[i]);
+    g_norm2_max = fmaxf(g_norm2_max, curv_win_out[i]);
+  }
+  const float g_norm2_min_deb = fmaxf(
+      epsilon,
+      expf(MovingAverageScalar(
+          g_norm2_min,
+          g_norm2_min_avg,
+          g_norm2_min_avg_out,
+          beta,
+          debias_factor)));
+  const float g_norm2_max_deb = fmaxf(
+      epsilon,
+      expf(MovingAverageScalar(
+          g_norm2_max,
+          g_norm2_max_avg,
+          g_norm2_max_avg_out,
+          beta,
+          debias_factor)));
+  // Gradient variance
+  const float variance = fmaxf(epsilon, g_norm2_deb - g_deb_norm2);
+  // Distance to opt
+  const float distance = *g_norm_avg_out / *g_norm2_avg_out;
+  const float distance_deb = MovingAverageScalar(
+      distance, distance_avg, distance_avg_out, beta, debias_factor);
+  if (!get_lr_mu) {
+    return;
+  }
+  // Finding root of cubic formula for YF's Single Step
+  const float curv_ratio = sqrtf(g_norm2_max_deb / g_norm2_min_deb);
+  const float mu_limit = (curv_ratio - 1.0f) / (curv_ratio + 1.0f);
+  const float pre_p = distance_deb * g_norm2_min_deb;
+  const float p = (pre_p * pre_p) / (2.0f * variance);
+  const float w3 = (-sqrtf(p * p + 4.0f / 27.0f * p * p * p) - p) / 2.0f;
+  const float w3_sign = w3 > 0.0f ? 1.0f : -1.0f;
+  const float w = w3_sign * powf(fabsf(w3), 1.0f / 3.0f);
+  const float y = w - p / 3.0f / w;
+  const float root = y + 1.0f;
+  const float mu = fmaxf(root * root, mu_limit * mu_limit);
+  const float lr = powf(1.0f - sqrtf(mu), 2) / g_norm2_min_deb;
+  MovingAverageScalar(mu, *mu_avg, mu_avg_out, beta, debias_factor);
+  MovingAverageScalar(lr, *lr_avg, lr_avg_out, beta, debias_factor);
+}
+
+template <>
+void YellowFinOp<float, CUDAContext>::AfterApply() {
+  AfterApplyKernel<<<1, CAFFE_CUDA_NUM_THREADS, 0, context_.cuda_stream()>>>(
+      NumStatisticsBlocks(D_),
+      scratch_tensor_.data<float>(),
+      curv_win_width_,
+      (iter_ - 1) % curv_win_width_,
+      std::min(curv_win_width_, iter_),
+      iter_ > 1,
+      beta_,
+      debias_factor_,
+      epsilon_,
+      curv_win_,
+      scalars_memory_,
+      lr_avg_,
+      mu_avg_,
+      curv_win_out_,
+      scalars_memory_out_,
+      lr_avg_out_,
+      mu_avg_out_);
 }
 
 REGISTER_CUDA_OPERATOR(YellowFin, YellowFinOp<float, CUDAContext>);
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/transforms/constant_folding_transform.h"
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace caffe2 {
+
+namespace {
+
+// Operators whose outputs only depend on their inputs and arguments.
+const std::set<string>& FoldableOps() {
+  static const std::set<string> ops = {
+      "Abs", "Add", "BatchMatMul", "Cast", "Clip", "Concat", "Copy", "Div",
+      "Exp", "ExpandDims", "FC", "Flatten", "FlattenToVec", "FusedElementwise",
+      "Gather", "Log", "MatMul", "Mul", "Negative", "Pow", "Relu", "Reshape",
+      "Scale", "Sigmoid", "Slice", "Softmax", "Split", "Sqr", "Sqrt", "Squeeze",
+      "Sub", "Sum", "Tanh", "Tile", "Transpose"};
+  return ops;
+}
+} // namespace
+
+NetDef FoldConstants(const NetDef& net, Workspace* ws) {
+  // A blob can only hold a folded value if nothing else writes to it.
+  std::unordered_map<string, int> num_writes;
+  for (const auto& op : net.op()) {
+    for (const auto& output : op.output()) {
+      ++num_writes[output];
+    }
+  }
+
+  std::unordered_set<string> folded_inputs;
+  std::vector<string> folded_outputs;
+  NetDef remaining(net);
+  remaining.clear_op();
+  for (const auto& op : net.op()) {
+    bool foldable = FoldableOps().count(op.type()) && op.input_size() > 0 &&
+        op.output_size() > 0 && op.device_option().device_type() == CPU;
+    for (int i = 0; foldable && i < op.input_size(); ++i) {
+      foldable = ws->HasBlob(op.input(i)) && !num_writes.count(op.input(i));
+    }
+    for (int i = 0; foldable && i < op.output_size(); ++i) {
+      foldable = !ws->HasBlob(op.output(i)) && num_writes[op.output(i)] == 1;
+    }
+    if (foldable) {
+      try {
+        foldable = ws->RunOperatorOnce(op);
+      } catch (const EnforceNotMet& e) {
+        VLOG(1) << "Could not fold " << op.type() << ": " << e.msg();
+        foldable = false;
+      }
+    }
+    if (foldable) {
+      VLOG(1) << "Folded operator " << ProtoDebugString(op);
+      for (const auto& input : op.input()) {
+        folded_inputs.insert(input);
+      }
+      for (const auto& output : op.output()) {
+        num_writes.erase(output);
+        folded_outputs.push_back(output);
+      }
+      continue;
+    }
+    remaining.add_op()->CopyFrom(op);
+  }
+  remaining = EliminateDeadOperators(remaining);
+
+  // Drop the constants that were only there for the folded operators, and the
+  // external inputs nothing reads anymore.
+  std::unordered_set<string> used(
+      remaining.external_output().begin(), remaining.external_output().end());
+  for (const auto& op : remaining.op()) {
+    used.insert(op.input().begin(), op.input().end());
+  }
+  for (const auto& name : folded_inputs) {
+    if (!used.count(name)) {
+      ws->RemoveBlob(name);
+    }
+  }
+  for (const auto& name : folded_outputs) {
+    if (!used.count(name)) {
+      ws->RemoveBlob(name);
+    }
+  }
+  remaining.clear_external_input();
+  for (const auto& name : net.external_input()) {
+    if (used.count(name) || !folded_inputs.count(name)) {
+      remaining.add_external_input(name);
+    }
+  }
+  for (const auto& name : folded_outputs) {
+    if (used.count(name)) {
+      remaining.add_external_input(name);
+    }
+  }
+  return remaining;
+}
+
+NetDef EliminateDeadOperators(const NetDef& net) {
+  std::unordered_set<string> live(
+      net.external_output().begin(), net.external_output().end());
+  std::vector<bool> keep(net.op_size(), false);
+  for (int i = net.op_size() - 1; i >= 0; --i) {
+    const auto& op = net.op(i);
+    bool is_live = op.output_size() == 0;
+    for (const auto& output : op.output()) {
+      is_live = is_live || live.count(output);
+    }
+    if (!is_live) {
+      continue;
+    }
+    keep[i] = true;
+    // Outputs stay live, as earlier writers may be read before this one
+    // runs, e.g. by the next run of the net.
+    live.insert(op.input().begin(), op.input().end());
+  }
+  NetDef result(net);
+  result.clear_op();
+  for (int i = 0; i < net.op_size(); ++i) {
+    if (keep[i]) {
+      result.add_op()->CopyFrom(net.op(i));
+    } else {
+      VLOG(1) << "Removed dead operator " << ProtoDebugString(net.op(i));
+    }
+  }
+  return result;
+}
+
+} // namespace caffe2
@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+/**
+ * Constant Folding
+ *
+ * Unlike the pattern based Transforms, folding needs the values of the
+ * parameters, so it runs on a workspace in which the init net has already
+ * been run. Every blob of that workspace counts as a constant. Operators of
+ * `net` that only read constants, and that are known to be free of side
+ * effects (Transpose, Reshape, Mul, Cast, ...), are run once into the
+ * workspace and removed from the returned net, whose external inputs then
+ * list their outputs instead. Operators that no longer contribute to the
+ * external outputs are removed as well, see EliminateDeadOperators, and so
+ * are the blobs of the workspace that only the removed operators read.
+ *
+ * Typical use at load time:
+ *
+ *   Workspace ws;
+ *   ws.RunNetOnce(init_net);
+ *   Predictor predictor(NetDef(), FoldConstants(run_net, &ws), &ws);
+ */
+NetDef FoldConstants(const NetDef& net, Workspace* ws);
+
+/**
+ * Dead Operator Elimination
+ *
+ * Removes the operators none of whose outputs are read, directly or through
+ * other operators, to compute the external outputs of `net`. Operators
+ * without outputs are kept, as they run for their side effects.
+ */
+NetDef EliminateDeadOperators(const NetDef& net);
+
+} // namespace caffe2
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/transforms/constant_folding_transform.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+void AddRandomTensor(Workspace* ws, const string& name, int rows, int cols) {
+  CPUContext context;
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(rows, cols);
+  math::RandUniform<float, CPUContext>(
+      tensor->size(), -2, 2, tensor->mutable_data<float>(), &context);
+}
+
+// W is stored transposed, and scaled at every run.
+NetDef CreatePredictNet() {
+  NetDef netdef;
+  OperatorDef* op;
+  netdef.add_external_input("data");
+  netdef.add_external_input("W");
+  netdef.add_external_input("b");
+  netdef.add_external_output("y");
+  AddOp(&netdef, "Transpose", {"W"}, {"W_t"});
+  op = AddOp(&netdef, "Scale", {"W_t"}, {"W_scaled"});
+  AddArgument<float>("scale", 0.5, op);
+  AddOp(&netdef, "Relu", {"data"}, {"unused"});
+  AddOp(&netdef, "FC", {"data", "W_scaled", "b"}, {"y"});
+  return netdef;
+}
+
+void InitParameters(Workspace* ws) {
+  AddRandomTensor(ws, "W", 8, 16);
+  auto* b = ws->CreateBlob("b")->GetMutable<TensorCPU>();
+  b->Resize(16);
+  math::Set<float, CPUContext>(16, 1, b->mutable_data<float>(), nullptr);
+}
+} // namespace
+
+TEST(ConstantFoldingTest, FoldsParameterOps) {
+  Workspace ws;
+  InitParameters(&ws);
+  AddRandomTensor(&ws, "data", 4, 8);
+  const NetDef netdef = CreatePredictNet();
+  // Reference run of the unfolded net, on a copy of the blobs.
+  Workspace reference_ws;
+  for (const auto& name : {"W", "b", "data"}) {
+    reference_ws.CreateBlob(name)->GetMutable<TensorCPU>()->CopyFrom(
+        ws.GetBlob(name)->Get<TensorCPU>());
+  }
+  ASSERT_TRUE(reference_ws.RunNetOnce(netdef));
+  // The data is fed later, at load time only the parameters are there.
+  ws.RemoveBlob("data");
+
+  const NetDef folded = FoldConstants(netdef, &ws);
+  ASSERT_EQ(folded.op_size(), 1);
+  EXPECT_EQ(folded.op(0).type(), "FC");
+  ASSERT_EQ(folded.external_input_size(), 3);
+  EXPECT_EQ(folded.external_input(0), "data");
+  EXPECT_EQ(folded.external_input(1), "b");
+  EXPECT_EQ(folded.external_input(2), "W_scaled");
+  // The original weights and the intermediate result are not needed anymore.
+  EXPECT_FALSE(ws.HasBlob("W"));
+  EXPECT_FALSE(ws.HasBlob("W_t"));
+  EXPECT_TRUE(ws.HasBlob("W_scaled"));
+
+  ws.CreateBlob("data")->GetMutable<TensorCPU>()->CopyFrom(
+      reference_ws.GetBlob("data")->Get<TensorCPU>());
+  ASSERT_TRUE(ws.RunNetOnce(folded));
+  EXPECT_FALSE(ws.HasBlob("unused"));
+  const auto& y = ws.GetBlob("y")->Get<TensorCPU>();
+  const auto& expected = reference_ws.GetBlob("y")->Get<TensorCPU>();
+  ASSERT_EQ(y.dims(), expected.dims());
+  for (int i = 0; i < y.size(); ++i) {
+    EXPECT_FLOAT_EQ(y.data<float>()[i], expected.data<float>()[i]);
+  }
+}
+
+TEST(ConstantFoldingTest, EliminatesDeadOperators) {
+  NetDef netdef;
+  netdef.add_external_input("X");
+  netdef.add_external_output("Z");
+  AddOp(&netdef, "Relu", {"X"}, {"Y"});
+  AddOp(&netdef, "Relu", {"Y"}, {"dead"});
+  AddOp(&netdef, "Relu", {"dead"}, {"dead2"});
+  AddOp(&netdef, "Relu", {"Y"}, {"Z"});
+  AddOp(&netdef, "Print", {"X"}, {});
+  const NetDef result = EliminateDeadOperators(netdef);
+  ASSERT_EQ(result.op_size(), 3);
+  EXPECT_EQ(result.op(0).output(0), "Y");
+  EXPECT_EQ(result.op(1).output(0), "Z");
+  EXPECT_EQ(result.op(2).type(), "Print");
+}
+
+} // namespace caffe2
@@ -18,6 +18,70 @@
 
 namespace caffe2 {
 
+namespace {
+
+// The (h, w) value of a 2D convolution argument given as "name",
+// "name_h" and "name_w", or the plural repeated form "names". Returns an
+// empty vector if the operator is not 2D.
+std::vector<int> GetConvArg(
+    const ArgumentHelper& helper,
+    const std::string& name,
+    int default_value) {
+  if (helper.HasArgument(name + "s")) {
+    return helper.GetRepeatedArgument<int>(name + "s");
+  }
+  if (helper.HasArgument(name)) {
+    const int value = helper.GetSingleArgument<int>(name, default_value);
+    return {value, value};
+  }
+  if (helper.HasArgument(name + "_h") && helper.HasArgument(name + "_w")) {
+    return {helper.GetSingleArgument<int>(name + "_h", default_value),
+            helper.GetSingleArgument<int>(name + "_w", default_value)};
+  }
+  return {default_value, default_value};
+}
+
+bool HasPadding(const ArgumentHelper& helper) {
+  for (const auto& pad : helper.GetRepeatedArgument<int>("pads")) {
+    if (pad) {
+      return true;
+    }
+  }
+  for (const char* name : {"pad", "pad_t", "pad_l", "pad_b", "pad_r"}) {
+    if (helper.GetSingleArgument<int>(name, 0)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+std::string ConvToBestEngineTransform::ChooseEngine(const OperatorDef& op) {
+  if (!op.engine().empty()) {
+    return "";
+  }
+  ArgumentHelper helper(op);
+  const auto kernel = GetConvArg(helper, "kernel", 0);
+  const auto stride = GetConvArg(helper, "stride", 1);
+  const auto dilation = GetConvArg(helper, "dilation", 1);
+  const int group = helper.GetSingleArgument<int>("group", 1);
+  const bool nchw = helper.GetSingleArgument<string>("order", "NCHW") == "NCHW";
+  if (kernel.size() != 2 || stride != std::vector<int>{1, 1} ||
+      dilation != std::vector<int>{1, 1}) {
+    return "";
+  }
+  if (kernel == std::vector<int>{3, 3} && group == 1 && nchw) {
+    return "WINOGRAD";
+  }
+  if (kernel == std::vector<int>{1, 1} && !HasPadding(helper) &&
+      (group == 1 || nchw)) {
+    return "DIRECT";
+  }
+  return "";
+}
+
 REGISTER_TRANSFORM(ConvToNNPack, ConvToNNPackTransform);
+REGISTER_TRANSFORM(ConvToBestEngine, ConvToBestEngineTransform);
 
 } // namespace caffe2
@@ -23,19 +23,41 @@
 
 namespace caffe2 {
 
-class ConvToNNPackTransform : public SingleOpTransform {
+// Sets the engine of the CPU Conv operators to the one ChooseEngine returns
+// for them, leaving those it returns an empty string for untouched.
+class ConvEngineTransform : public SingleOpTransform {
  protected:
+  virtual std::string ChooseEngine(const OperatorDef& op) = 0;
+
   // Specify what the op needs to be to match the pattern.
   bool MatchOperator(const OperatorDef& op) override {
-    return (
-        op.type() == "Conv" && op.device_option().device_type() == CPU &&
-        op.engine() != "NNPACK");
+    if (op.type() != "Conv" || op.device_option().device_type() != CPU) {
+      return false;
+    }
+    const auto engine = ChooseEngine(op);
+    return !engine.empty() && op.engine() != engine;
   }
 
   // Specify how the operator should be replaced.
   void ReplaceOperator(OperatorDef* op) override {
-    op->set_engine("NNPACK");
+    op->set_engine(ChooseEngine(*op));
+  }
+};
+
+class ConvToNNPackTransform : public ConvEngineTransform {
+ protected:
+  std::string ChooseEngine(const OperatorDef& /*op*/) override {
+    return "NNPACK";
   }
 };
 
+// Picks the fastest built-in CPU engine for the configuration of each Conv
+// that does not have an engine yet: WINOGRAD for 3x3 stride 1 NCHW
+// convolutions and DIRECT for 1x1 stride 1 ones without padding. The choice
+// only depends on the arguments, as the input shapes are not known here.
+class ConvToBestEngineTransform : public ConvEngineTransform {
+ protected:
+  std::string ChooseEngine(const OperatorDef& op) override;
+};
+
 } // namespace caffe2
@@ -54,6 +54,34 @@ TEST(ConvToNNPackTest, TestSimple) {
   EXPECT_EQ(t->PatternMatch(Graph(netdef)).size(), 2); // should get 2 matches
 }
 
+TEST(ConvToBestEngineTest, TestSimple) {
+  NetDef netdef;
+  OperatorDef* op;
+  op = AddOp(&netdef, "Conv", {"in"}, {"out"});
+  op->add_arg()->CopyFrom(MakeArgument("kernel", 3));
+  op = AddOp(&netdef, "Conv", {"out"}, {"out"});
+  op->add_arg()->CopyFrom(MakeArgument("kernel", 1));
+  op = AddOp(&netdef, "Conv", {"out"}, {"out"});
+  op->add_arg()->CopyFrom(MakeArgument("kernel", 3));
+  op->add_arg()->CopyFrom(MakeArgument("stride", 2)); // no faster engine
+  op = AddOp(&netdef, "Conv", {"out"}, {"out"});
+  op->add_arg()->CopyFrom(MakeArgument("kernel", 3));
+  op->add_arg()->CopyFrom(MakeArgument<string>("order", "NHWC"));
+  op = AddOp(&netdef, "Conv", {"out"}, {"out"});
+  op->add_arg()->CopyFrom(MakeArgument("kernel", 1));
+  op->set_engine("NNPACK"); // an explicit engine is kept
+
+  auto t = TransformRegistry()->Create("ConvToBestEngine");
+  NetDef transformed_netdef = t->ApplyTo(netdef);
+  std::vector<string> engines;
+  for (auto& op : transformed_netdef.op()) {
+    engines.push_back(op.engine());
+  }
+  EXPECT_EQ(
+      engines,
+      std::vector<string>({"WINOGRAD", "DIRECT", "", "", "NNPACK"}));
+}
+
 } // namespace
 
 } // namespace Caffe2
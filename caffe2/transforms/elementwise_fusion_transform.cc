@@ -0,0 +1,166 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/transforms/elementwise_fusion_transform.h"
+
+#include <limits>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+using transform::Graph;
+using transform::Node;
+
+bool ElementwiseFusionTransform::PatternRule(
+    const Graph& g,
+    const std::vector<int>& subgraph,
+    int idx) {
+  const OperatorDef& op = g.node(idx).op;
+  if (op.device_option().device_type() != CPU || !op.engine().empty() ||
+      op.output_size() != 1) {
+    return false;
+  }
+  if (binary_ops_.count(op.type())) {
+    if (op.input_size() != 2 ||
+        ArgumentHelper(op).GetSingleArgument<int>("broadcast", 0)) {
+      return false;
+    }
+  } else if (!float_only_unary_ops_.count(op.type()) || op.input_size() != 1) {
+    return false;
+  }
+  if (subgraph.size() == 0) {
+    return true;
+  }
+
+  // Extend the chain only with the sole reader of its last output.
+  const Node& last = g.node(subgraph.back());
+  const string& last_output = last.op.output(0);
+  return last.children.size() == 1 && last.children.count(idx) &&
+      !g.external_output().count(last_output) &&
+      (op.input(0) == last_output ||
+       (op.input_size() == 2 && op.input(1) == last_output));
+}
+
+bool ElementwiseFusionTransform::ValidatorRule(
+    const Graph& g,
+    const std::vector<int>& subgraph) {
+  if (subgraph.size() < 2) {
+    return false;
+  }
+  for (int idx : subgraph) {
+    if (float_only_unary_ops_.count(g.node(idx).op.type())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ElementwiseFusionTransform::ReplaceRule(
+    const std::vector<int>& subgraph,
+    Graph* g_ptr) {
+  CHECK(g_ptr);
+  auto& g = *g_ptr;
+
+  // An input of an operator in the chain is either the output of the previous
+  // operator, or an input of the fused operator.
+  auto is_chained = [&](int i, const string& blob) {
+    return i > 0 && blob == g.node(subgraph[i - 1]).op.output(0);
+  };
+  OperatorDef fused_op;
+  fused_op.set_type("FusedElementwise");
+  fused_op.mutable_device_option()->CopyFrom(
+      g.node(subgraph[0]).op.device_option());
+  std::map<string, int> input_registers;
+  for (int i = 0; i < subgraph.size(); i++) {
+    for (const auto& blob : g.node(subgraph[i]).op.input()) {
+      if (!is_chained(i, blob) && !input_registers.count(blob)) {
+        input_registers[blob] = fused_op.input_size();
+        fused_op.add_input(blob);
+      }
+    }
+  }
+  fused_op.add_output(g.node(subgraph.back()).op.output(0));
+
+  std::vector<string> ops;
+  std::vector<int> operands;
+  std::vector<float> params;
+  for (int i = 0; i < subgraph.size(); i++) {
+    const OperatorDef& op = g.node(subgraph[i]).op;
+    ops.push_back(op.type());
+    for (int j = 0; j < 2; j++) {
+      if (j >= op.input_size()) {
+        operands.push_back(-1);
+      } else if (is_chained(i, op.input(j))) {
+        operands.push_back(fused_op.input_size() + i - 1);
+      } else {
+        operands.push_back(input_registers.at(op.input(j)));
+      }
+    }
+    ArgumentHelper helper(op);
+    if (op.type() == "Clip") {
+      params.push_back(helper.GetSingleArgument<float>(
+          "min", std::numeric_limits<float>::lowest()));
+      params.push_back(helper.GetSingleArgument<float>(
+          "max", std::numeric_limits<float>::max()));
+    } else if (op.type() == "Scale") {
+      params.push_back(helper.GetSingleArgument<float>("scale", 1.0));
+      params.push_back(0);
+    } else {
+      params.push_back(0);
+      params.push_back(0);
+    }
+  }
+  AddArgument("ops", ops, &fused_op);
+  AddArgument("operands", operands, &fused_op);
+  AddArgument("params", params, &fused_op);
+
+  // The fused operator inherits the parents of the whole chain and the
+  // children of its last operator.
+  const std::set<int> chain(subgraph.begin(), subgraph.end());
+  std::map<int, std::vector<string>> parents;
+  for (int x : subgraph) {
+    for (const auto& edge : g.node(x).parents) {
+      if (chain.count(edge.first)) {
+        continue;
+      }
+      auto& blobs = parents[edge.first];
+      for (const auto& blob : edge.second) {
+        if (std::find(blobs.begin(), blobs.end(), blob) == blobs.end()) {
+          blobs.push_back(blob);
+        }
+      }
+    }
+  }
+  const auto children = g.node(subgraph.back()).children;
+  g.DeactivateSubgraph(subgraph);
+
+  const int new_idx = g.size();
+  g.push_node(Node(fused_op, true, parents, children));
+  for (const auto& edge : parents) {
+    g.node(edge.first).children[new_idx] = edge.second;
+  }
+  for (const auto& edge : children) {
+    g.node(edge.first).parents[new_idx] = edge.second;
+  }
+  return true;
+}
+
+REGISTER_TRANSFORM(ElementwiseFusion, ElementwiseFusionTransform);
+
+} // namespace caffe2
@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/transform.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+/**
+ * Elementwise Fusion
+ *
+ * This transform looks for chains of elementwise operators (Add, Sub, Mul,
+ * Div without broadcasting, Sigmoid, Tanh, Relu, Clip and Scale), where each
+ * operator reads the output of the previous one and nothing else does, and
+ * replaces every chain with a single FusedElementwise operator. That operator
+ * makes one pass over memory for the whole chain instead of one per operator.
+ *
+ * Only CPU operators with the default engine are fused. Since the NetDef does
+ * not carry data types, a chain is only fused if it contains at least one of
+ * the float-only operators (Sigmoid, Tanh, Relu, Clip, Scale), which implies
+ * that the whole chain computes on floats.
+ */
+class ElementwiseFusionTransform : public Transform {
+ protected:
+  bool PatternRule(
+      const transform::Graph& g,
+      const std::vector<int>& subgraph,
+      int idx) override;
+  bool ValidatorRule(
+      const transform::Graph& g,
+      const std::vector<int>& subgraph) override;
+  bool ReplaceRule(const std::vector<int>& subgraph, transform::Graph* g_ptr)
+      override;
+
+ private:
+  std::set<string> binary_ops_ = {"Add", "Sub", "Mul", "Div"};
+  std::set<string> float_only_unary_ops_ = {"Sigmoid",
+                                            "Tanh",
+                                            "Relu",
+                                            "Clip",
+                                            "Scale"};
+};
+
+} // namespace caffe2
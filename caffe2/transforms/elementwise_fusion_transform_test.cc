@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/transforms/elementwise_fusion_transform.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+using transform::Graph;
+
+void AddRandomTensor(Workspace* ws, const string& name, int size) {
+  CPUContext context;
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(size);
+  math::RandUniform<float, CPUContext>(
+      size, -2, 2, tensor->mutable_data<float>(), &context);
+}
+
+NetDef CreateElementwiseChain() {
+  NetDef netdef;
+  OperatorDef* op;
+  AddOp(&netdef, "Mul", {"X", "Y"}, {"A"});
+  AddOp(&netdef, "Sigmoid", {"A"}, {"A"});
+  op = AddOp(&netdef, "Scale", {"A"}, {"B"});
+  AddArgument<float>("scale", 2, op);
+  op = AddOp(&netdef, "Clip", {"B"}, {"C"});
+  AddArgument<float>("min", 0.5, op);
+  AddArgument<float>("max", 1.5, op);
+  AddOp(&netdef, "Sub", {"X", "C"}, {"D"});
+  AddOp(&netdef, "Tanh", {"D"}, {"out"});
+  return netdef;
+}
+
+TEST(ElementwiseFusionTest, TestChain) {
+  NetDef netdef = CreateElementwiseChain();
+  auto t = TransformRegistry()->Create("ElementwiseFusion");
+  EXPECT_EQ(t->PatternMatch(Graph(netdef)).size(), 1);
+
+  NetDef transformed_netdef = t->ApplyTo(netdef);
+  ASSERT_EQ(transformed_netdef.op_size(), 1);
+  const auto& op = transformed_netdef.op(0);
+  EXPECT_EQ(op.type(), "FusedElementwise");
+  ASSERT_EQ(op.input_size(), 2);
+  EXPECT_EQ(op.input(0), "X");
+  EXPECT_EQ(op.input(1), "Y");
+  EXPECT_EQ(op.output(0), "out");
+  ArgumentHelper helper(op);
+  EXPECT_EQ(helper.GetRepeatedArgument<string>("ops").size(), 6);
+  // Sub reads the input X and the output of Clip, in register 2 + 3.
+  const auto operands = helper.GetRepeatedArgument<int>("operands");
+  EXPECT_EQ(operands[8], 0);
+  EXPECT_EQ(operands[9], 5);
+
+  Workspace ws;
+  AddRandomTensor(&ws, "X", 1000);
+  AddRandomTensor(&ws, "Y", 1000);
+  ASSERT_TRUE(ws.RunNetOnce(netdef));
+  TensorCPU expected(ws.GetBlob("out")->Get<TensorCPU>());
+  ws.GetBlob("out")->Reset();
+  ASSERT_TRUE(ws.RunNetOnce(transformed_netdef));
+  const auto& out = ws.GetBlob("out")->Get<TensorCPU>();
+  ASSERT_EQ(out.size(), expected.size());
+  for (int i = 0; i < out.size(); ++i) {
+    EXPECT_NEAR(out.data<float>()[i], expected.data<float>()[i], 1e-5);
+  }
+}
+
+TEST(ElementwiseFusionTest, TestPartialMatch) {
+  auto t = TransformRegistry()->Create("ElementwiseFusion");
+
+  // Without a float-only operator the chain may compute on integers.
+  NetDef netdef;
+  AddOp(&netdef, "Add", {"X", "Y"}, {"A"});
+  AddOp(&netdef, "Mul", {"A", "Y"}, {"B"});
+  EXPECT_EQ(t->PatternMatch(Graph(netdef)).size(), 0);
+
+  // A is read twice, so it has to be materialized and only the operators
+  // after it are fused.
+  NetDef netdef2;
+  AddOp(&netdef2, "Add", {"X", "Y"}, {"A"});
+  AddOp(&netdef2, "Sigmoid", {"A"}, {"B"});
+  AddOp(&netdef2, "Mul", {"A", "B"}, {"C"});
+  const auto matches = t->PatternMatch(Graph(netdef2));
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_EQ(matches[0], (std::vector<int>{1, 2}));
+
+  // Broadcasting operators are left alone.
+  NetDef netdef3;
+  auto* op = AddOp(&netdef3, "Add", {"X", "Y"}, {"A"});
+  AddArgument<int>("broadcast", 1, op);
+  AddOp(&netdef3, "Sigmoid", {"A"}, {"B"});
+  EXPECT_EQ(t->PatternMatch(Graph(netdef3)).size(), 0);
+}
+
+} // namespace
+
+} // namespace caffe2
@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/transforms/inplace_transform.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include "caffe2/core/operator_schema.h"
+
+namespace caffe2 {
+
+NetDef ReuseDeadInputsInplace(const NetDef& net) {
+  for (const auto& op : net.op()) {
+    for (const auto& arg : op.arg()) {
+      if (arg.has_n() || arg.nets_size() > 0) {
+        VLOG(1) << "Not running operators in-place, " << op.type()
+                << " has subnets";
+        return net;
+      }
+    }
+  }
+
+  // Blobs that must keep their names and contents across the whole net.
+  std::unordered_set<string> pinned(
+      net.external_input().begin(), net.external_input().end());
+  pinned.insert(net.external_output().begin(), net.external_output().end());
+  std::unordered_map<string, int> num_writes;
+  std::unordered_map<string, int> last_read;
+  std::unordered_set<string> written;
+  for (int i = 0; i < net.op_size(); ++i) {
+    const auto& op = net.op(i);
+    for (const auto& input : op.input()) {
+      last_read[input] = i;
+      if (!written.count(input)) {
+        pinned.insert(input);
+      }
+    }
+    for (const auto& output : op.output()) {
+      ++num_writes[output];
+      written.insert(output);
+    }
+    if (op.type() == "Alias") {
+      pinned.insert(op.input().begin(), op.input().end());
+      pinned.insert(op.output().begin(), op.output().end());
+    }
+  }
+  for (const auto& it : num_writes) {
+    if (it.second > 1) {
+      pinned.insert(it.first);
+    }
+  }
+
+  NetDef result(net);
+  std::unordered_map<string, string> renamed;
+  for (int i = 0; i < result.op_size(); ++i) {
+    auto* op = result.mutable_op(i);
+    for (int j = 0; j < op->input_size(); ++j) {
+      auto it = renamed.find(op->input(j));
+      if (it != renamed.end()) {
+        op->set_input(j, it->second);
+      }
+    }
+    const OpSchema* schema = OpSchemaRegistry::Schema(op->type());
+    if (!schema) {
+      continue;
+    }
+    std::unordered_set<string> reused;
+    for (int out = 0; out < op->output_size(); ++out) {
+      const string output = op->output(out);
+      if (pinned.count(output)) {
+        continue;
+      }
+      for (int in = 0; in < op->input_size(); ++in) {
+        // Inputs are checked under their original names, which is what
+        // pinned and last_read refer to.
+        const string& original = net.op(i).input(in);
+        if (!schema->inplace_allowed(in, out) || pinned.count(original) ||
+            last_read[original] != i || reused.count(op->input(in))) {
+          continue;
+        }
+        bool read_twice = false;
+        for (int other = 0; other < op->input_size(); ++other) {
+          read_twice |= other != in && op->input(other) == op->input(in);
+        }
+        if (read_twice) {
+          continue;
+        }
+        VLOG(1) << "Running " << op->type() << " in-place, " << output
+                << " reuses " << op->input(in);
+        reused.insert(op->input(in));
+        renamed[output] = op->input(in);
+        op->set_output(out, op->input(in));
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+} // namespace caffe2
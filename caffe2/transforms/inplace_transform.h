@@ -0,0 +1,42 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+/**
+ * In-place Transform
+ *
+ * Rewrites an output of an operator to the name of one of its inputs when
+ * the schema allows the pair to be in-place (Relu, Sigmoid, the elementwise
+ * arithmetic, Dropout, SpatialBN, ...) and no later operator of `net` reads
+ * that input, so the operator overwrites a blob that is dead anyway instead
+ * of allocating a new one. Later readers of the output are renamed to match.
+ *
+ * Blobs that outlive a run of the net are never reused or renamed: the
+ * external inputs and outputs, blobs written by more than one operator, blobs
+ * read before they are written, and blobs used by Alias. Nets whose
+ * operators have subnets are returned unchanged, as the reads inside the
+ * subnets are not visible here.
+ */
+NetDef ReuseDeadInputsInplace(const NetDef& net);
+
+} // namespace caffe2
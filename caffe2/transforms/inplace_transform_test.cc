@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/transforms/inplace_transform.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+NetDef CreateNetDef() {
+  NetDef netdef;
+  netdef.add_external_input("X");
+  netdef.add_external_output("Z");
+  AddOp(&netdef, "Relu", {"X"}, {"A"});
+  AddOp(&netdef, "Sigmoid", {"A"}, {"B"});
+  AddOp(&netdef, "Relu", {"B"}, {"C"});
+  AddOp(&netdef, "Sum", {"C", "B"}, {"D"});
+  AddOp(&netdef, "Relu", {"D"}, {"Z"});
+  return netdef;
+}
+
+void RunWithInput(const NetDef& netdef, const TensorCPU& input, Workspace* ws) {
+  ws->CreateBlob("X")->GetMutable<TensorCPU>()->CopyFrom(input);
+  ASSERT_TRUE(ws->RunNetOnce(netdef));
+}
+} // namespace
+
+TEST(InplaceTransformTest, ReusesDeadInputs) {
+  const NetDef netdef = CreateNetDef();
+  const NetDef result = ReuseDeadInputsInplace(netdef);
+  ASSERT_EQ(result.op_size(), 5);
+  // The external input must survive the run.
+  EXPECT_EQ(result.op(0).output(0), "A");
+  EXPECT_EQ(result.op(1).input(0), "A");
+  EXPECT_EQ(result.op(1).output(0), "A");
+  // The Relu output can not go to "A", which the Sum still reads.
+  EXPECT_EQ(result.op(2).input(0), "A");
+  EXPECT_EQ(result.op(2).output(0), "C");
+  EXPECT_EQ(result.op(3).input(0), "C");
+  EXPECT_EQ(result.op(3).input(1), "A");
+  EXPECT_EQ(result.op(3).output(0), "C");
+  EXPECT_EQ(result.op(4).input(0), "C");
+  EXPECT_EQ(result.op(4).output(0), "Z");
+
+  TensorCPU input(vector<TIndex>{4, 8});
+  CPUContext context;
+  math::RandUniform<float, CPUContext>(
+      input.size(), -2, 2, input.mutable_data<float>(), &context);
+  Workspace reference_ws;
+  RunWithInput(netdef, input, &reference_ws);
+  Workspace ws;
+  RunWithInput(result, input, &ws);
+  EXPECT_FALSE(ws.HasBlob("B"));
+  EXPECT_FALSE(ws.HasBlob("D"));
+  const auto& z = ws.GetBlob("Z")->Get<TensorCPU>();
+  const auto& expected = reference_ws.GetBlob("Z")->Get<TensorCPU>();
+  ASSERT_EQ(z.dims(), expected.dims());
+  for (int i = 0; i < z.size(); ++i) {
+    EXPECT_FLOAT_EQ(z.data<float>()[i], expected.data<float>()[i]);
+  }
+}
+
+TEST(InplaceTransformTest, KeepsBlobsLiveAcrossRuns) {
+  NetDef netdef;
+  netdef.add_external_input("X");
+  // "state" is read before it is written, i.e. it carries over between runs.
+  AddOp(&netdef, "Sum", {"X", "state"}, {"Y"});
+  AddOp(&netdef, "Relu", {"Y"}, {"state"});
+  AddOp(&netdef, "Alias", {"state"}, {"alias"});
+  const NetDef result = ReuseDeadInputsInplace(netdef);
+  EXPECT_EQ(result.op(0).output(0), "Y");
+  EXPECT_EQ(result.op(1).output(0), "state");
+}
+
+} // namespace caffe2
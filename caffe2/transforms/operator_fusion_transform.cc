@@ -0,0 +1,181 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/transforms/operator_fusion_transform.h"
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+using transform::Graph;
+using transform::Node;
+
+namespace {
+
+bool IsDefaultCPUOp(const OperatorDef& op) {
+  return op.device_option().device_type() == CPU && op.engine().empty();
+}
+
+bool IsConv(const OperatorDef& op) {
+  return op.type() == "Conv" || op.type() == "Conv1D" ||
+      op.type() == "Conv2D" || op.type() == "Conv3D";
+}
+
+string GetOrder(const OperatorDef& op) {
+  return ArgumentHelper(op).GetSingleArgument<string>("order", "NCHW");
+}
+
+// Checks that the node at idx reads the single output of the node at
+// last_idx, and that nothing else reads it or feeds into the node at idx.
+bool IsSoleConsumer(const Graph& g, int last_idx, int idx) {
+  const Node& last = g.node(last_idx);
+  const Node& node = g.node(idx);
+  return last.op.output_size() == 1 && last.children.size() == 1 &&
+      last.children.count(idx) && node.parents.size() == 1 &&
+      node.op.input_size() > 0 && node.op.input(0) == last.op.output(0) &&
+      !g.external_output().count(last.op.output(0));
+}
+
+} // namespace
+
+bool OperatorFusionTransform::PatternRule(
+    const Graph& g,
+    const std::vector<int>& subgraph,
+    int idx) {
+  const OperatorDef& op = g.node(idx).op;
+  if (!IsDefaultCPUOp(op)) {
+    return false;
+  }
+  if (subgraph.size() == 0) {
+    if (op.output_size() != 1 ||
+        ArgumentHelper(op).GetSingleArgument<bool>("fused_relu", false)) {
+      return false;
+    }
+    return (IsConv(op) && op.input_size() >= 2 && op.input_size() <= 3) ||
+        (op.type() == "FC" && op.input_size() == 3);
+  }
+
+  const Node& head = g.node(subgraph.front());
+  const OperatorDef& last_op = g.node(subgraph.back()).op;
+  if (!IsSoleConsumer(g, subgraph.back(), idx) || last_op.type() == "Relu") {
+    return false;
+  }
+  if (op.type() == "Relu") {
+    return op.input_size() == 1 && op.output_size() == 1;
+  }
+  if (op.type() == "SpatialBN") {
+    if (subgraph.size() != 1 || !IsConv(head.op) || op.input_size() != 5 ||
+        op.output_size() != 1 ||
+        !ArgumentHelper(op).GetSingleArgument<int>(OpSchema::Arg_IsTest, 0) ||
+        GetOrder(op) != GetOrder(head.op)) {
+      return false;
+    }
+    // The folded parameters are computed from the filter and bias of the
+    // Conv, which therefore must not be produced inside the net.
+    for (const auto& edge : head.parents) {
+      for (const auto& blob : edge.second) {
+        if (blob != head.op.input(0)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+// Fusing anything into the leading Conv or FC is worth it.
+bool OperatorFusionTransform::ValidatorRule(
+    const Graph& g,
+    const std::vector<int>& subgraph) {
+  return subgraph.size() >= 2;
+}
+
+bool OperatorFusionTransform::ReplaceRule(
+    const std::vector<int>& subgraph,
+    Graph* g_ptr) {
+  CHECK(g_ptr);
+  auto& g = *g_ptr;
+
+  const int head_idx = subgraph.front();
+  const int tail_idx = subgraph.back();
+  OperatorDef fused_op = g.node(head_idx).op;
+  fused_op.set_output(0, g.node(tail_idx).op.output(0));
+
+  OperatorDef fold_op;
+  std::vector<string> folded_blobs;
+  for (int i = 1; i < subgraph.size(); i++) {
+    const OperatorDef& op = g.node(subgraph[i]).op;
+    if (op.type() == "Relu") {
+      AddArgument<int>("fused_relu", 1, &fused_op);
+      continue;
+    }
+    CAFFE_ENFORCE_EQ(op.type(), "SpatialBN");
+    const string prefix =
+        "transform/" + op.output(0) + "_" + caffe2::to_string(head_idx);
+    folded_blobs = {prefix + "_folded_filter", prefix + "_folded_bias"};
+    fold_op.set_type("FoldSpatialBN");
+    fold_op.mutable_device_option()->CopyFrom(fused_op.device_option());
+    // filter, [bias], scale, bn_bias, mean, var
+    for (int j = 1; j < fused_op.input_size(); j++) {
+      fold_op.add_input(fused_op.input(j));
+    }
+    for (int j = 1; j < op.input_size(); j++) {
+      fold_op.add_input(op.input(j));
+    }
+    for (const auto& blob : folded_blobs) {
+      fold_op.add_output(blob);
+    }
+    for (const auto& arg : op.arg()) {
+      if (arg.name() == "epsilon") {
+        fold_op.add_arg()->CopyFrom(arg);
+      }
+    }
+    fused_op.set_input(1, folded_blobs[0]);
+    if (fused_op.input_size() == 3) {
+      fused_op.set_input(2, folded_blobs[1]);
+    } else {
+      fused_op.add_input(folded_blobs[1]);
+    }
+  }
+  g.node(head_idx).op = fused_op;
+
+  // The fused operator takes over the readers of the last operator of the
+  // sequence, which is removed along with the ones in between.
+  const auto tail_children = g.node(tail_idx).children;
+  g.DeactivateSubgraph(std::vector<int>(subgraph.begin() + 1, subgraph.end()));
+  for (const auto& edge : tail_children) {
+    g.node(head_idx).children[edge.first] = edge.second;
+    g.node(edge.first).parents[head_idx] = edge.second;
+  }
+
+  if (!folded_blobs.empty()) {
+    const int fold_idx = g.size();
+    g.push_node(Node(
+        fold_op,
+        true,
+        std::map<int, std::vector<string>>(),
+        std::map<int, std::vector<string>>{{head_idx, folded_blobs}}));
+    g.node(head_idx).parents[fold_idx] = folded_blobs;
+  }
+  return true;
+}
+
+REGISTER_TRANSFORM(OperatorFusion, OperatorFusionTransform);
+
+} // namespace caffe2
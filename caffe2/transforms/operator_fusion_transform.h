@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/transform.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+/**
+ * Operator Fusion
+ *
+ * This transform fuses the common inference-time sequences
+ *    Conv -> SpatialBN -> Relu, Conv -> SpatialBN, Conv -> Relu and FC -> Relu
+ * into a single Conv or FC, so that the intermediate outputs are never
+ * materialized.
+ *
+ * A SpatialBN that runs in test mode is folded into the filter and bias of the
+ * Conv by a FoldSpatialBN operator inserted in front of it, and a trailing
+ * Relu is applied by the Conv or FC itself through its fused_relu argument.
+ *
+ * Only CPU operators with the default engine are fused, and only when every
+ * intermediate output is read by the next operator of the sequence alone.
+ */
+class OperatorFusionTransform : public Transform {
+ protected:
+  bool PatternRule(
+      const transform::Graph& g,
+      const std::vector<int>& subgraph,
+      int idx) override;
+  bool ValidatorRule(
+      const transform::Graph& g,
+      const std::vector<int>& subgraph) override;
+  bool ReplaceRule(const std::vector<int>& subgraph, transform::Graph* g_ptr)
+      override;
+};
+
+} // namespace caffe2
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <google/protobuf/text_format.h>
+#include <gtest/gtest.h>
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/transforms/operator_fusion_transform.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+using transform::Graph;
+
+void AddRandomTensor(
+    Workspace* ws,
+    const string& name,
+    const vector<TIndex>& dims,
+    float min,
+    float max) {
+  CPUContext context;
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  math::RandUniform<float, CPUContext>(
+      tensor->size(), min, max, tensor->mutable_data<float>(), &context);
+}
+
+NetDef CreateConvBNReluFCReluNet() {
+  NetDef netdef;
+  OperatorDef* op;
+  op = AddOp(&netdef, "Conv", {"X", "W", "b"}, {"conv"});
+  AddArgument<int>("kernel", 3, op);
+  AddArgument<int>("pad", 1, op);
+  op = AddOp(
+      &netdef, "SpatialBN", {"conv", "scale", "bias", "mean", "var"}, {"bn"});
+  AddArgument<int>(OpSchema::Arg_IsTest, 1, op);
+  AddArgument<float>("epsilon", 1e-3, op);
+  op = AddOp(&netdef, "Relu", {"bn"}, {"bn"});
+  op = AddOp(&netdef, "FC", {"bn", "W_fc", "b_fc"}, {"fc"});
+  op = AddOp(&netdef, "Relu", {"fc"}, {"out"});
+  netdef.add_external_output("out");
+  return netdef;
+}
+
+TEST(OperatorFusionTest, TestPatterns) {
+  NetDef netdef = CreateConvBNReluFCReluNet();
+  auto t = TransformRegistry()->Create("OperatorFusion");
+  EXPECT_EQ(t->PatternMatch(Graph(netdef)).size(), 2);
+
+  NetDef transformed_netdef = t->ApplyTo(netdef);
+  ASSERT_EQ(transformed_netdef.op_size(), 3);
+  const auto& fold = transformed_netdef.op(0);
+  const auto& conv = transformed_netdef.op(1);
+  const auto& fc = transformed_netdef.op(2);
+  EXPECT_EQ(fold.type(), "FoldSpatialBN");
+  EXPECT_EQ(fold.input_size(), 6);
+  EXPECT_EQ(ArgumentHelper(fold).GetSingleArgument<float>("epsilon", 0), 1e-3f);
+  EXPECT_EQ(conv.type(), "Conv");
+  EXPECT_EQ(conv.input(1), fold.output(0));
+  EXPECT_EQ(conv.input(2), fold.output(1));
+  EXPECT_EQ(conv.output(0), "bn");
+  EXPECT_TRUE(ArgumentHelper(conv).GetSingleArgument<bool>("fused_relu", 0));
+  EXPECT_EQ(fc.type(), "FC");
+  EXPECT_EQ(fc.output(0), "out");
+  EXPECT_TRUE(ArgumentHelper(fc).GetSingleArgument<bool>("fused_relu", 0));
+}
+
+TEST(OperatorFusionTest, TestSharedIntermediate) {
+  NetDef netdef;
+  AddOp(&netdef, "Conv", {"X", "W"}, {"conv"});
+  AddOp(&netdef, "Relu", {"conv"}, {"relu"});
+  // The Conv output is also needed here, so it must stay materialized.
+  AddOp(&netdef, "Sum", {"conv", "relu"}, {"out"});
+  auto t = TransformRegistry()->Create("OperatorFusion");
+  EXPECT_EQ(t->PatternMatch(Graph(netdef)).size(), 0);
+
+  // Neither training-mode SpatialBN nor non-CPU operators are fused.
+  NetDef netdef2;
+  AddOp(&netdef2, "Conv", {"X", "W"}, {"conv"});
+  auto* op = AddOp(
+      &netdef2, "SpatialBN", {"conv", "scale", "bias", "mean", "var"}, {"bn"});
+  AddOp(&netdef2, "FC", {"bn", "W_fc", "b_fc"}, {"fc"})
+      ->mutable_device_option()
+      ->set_device_type(CUDA);
+  AddOp(&netdef2, "Relu", {"fc"}, {"out"});
+  EXPECT_EQ(t->PatternMatch(Graph(netdef2)).size(), 0);
+  AddArgument<int>(OpSchema::Arg_IsTest, 1, op);
+  EXPECT_EQ(t->PatternMatch(Graph(netdef2)).size(), 1);
+}
+
+TEST(OperatorFusionTest, TestNumerics) {
+  Workspace ws;
+  AddRandomTensor(&ws, "X", {2, 3, 6, 6}, -1, 1);
+  AddRandomTensor(&ws, "W", {4, 3, 3, 3}, -1, 1);
+  AddRandomTensor(&ws, "b", {4}, -1, 1);
+  AddRandomTensor(&ws, "scale", {4}, 0.5, 1.5);
+  AddRandomTensor(&ws, "bias", {4}, -1, 1);
+  AddRandomTensor(&ws, "mean", {4}, -1, 1);
+  AddRandomTensor(&ws, "var", {4}, 0.5, 1.5);
+  AddRandomTensor(&ws, "W_fc", {5, 4 * 6 * 6}, -1, 1);
+  AddRandomTensor(&ws, "b_fc", {5}, -1, 1);
+
+  NetDef netdef = CreateConvBNReluFCReluNet();
+  ASSERT_TRUE(ws.RunNetOnce(netdef));
+  TensorCPU expected(ws.GetBlob("out")->Get<TensorCPU>());
+
+  NetDef transformed_netdef = ApplyTransform("OperatorFusion", netdef);
+  ws.GetBlob("out")->Reset();
+  ASSERT_TRUE(ws.RunNetOnce(transformed_netdef));
+  const auto& out = ws.GetBlob("out")->Get<TensorCPU>();
+  ASSERT_EQ(out.dims(), expected.dims());
+  for (int i = 0; i < out.size(); ++i) {
+    EXPECT_NEAR(out.data<float>()[i], expected.data<float>()[i], 1e-3);
+  }
+}
+
+} // namespace
+
+} // namespace caffe2
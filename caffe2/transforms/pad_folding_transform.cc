@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/transforms/pad_folding_transform.h"
+
+#include <algorithm>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/proto/caffe2_legacy.pb.h"
+
+namespace caffe2 {
+
+using transform::Graph;
+using transform::Node;
+
+namespace {
+
+const char* const kPadArgs[] = {"pads", "pad", "pad_t", "pad_l", "pad_b",
+                                "pad_r"};
+
+// Reads the explicit 2D pads of a ConvPoolOpBase operator, as
+// {top, left, bottom, right}, the way ConvPoolOpBase does. Returns false for
+// legacy padding or pads of another dimensionality.
+bool GetPads2D(const OperatorDef& op, std::vector<int>* pads) {
+  ArgumentHelper args(op);
+  if (args.GetSingleArgument<int>("legacy_pad", LegacyPadding::NOTSET) !=
+      LegacyPadding::NOTSET) {
+    return false;
+  }
+  *pads = args.GetRepeatedArgument<int>("pads");
+  if (args.HasArgument("pad")) {
+    pads->assign(4, args.GetSingleArgument<int>("pad", 0));
+  } else if (
+      args.HasArgument("pad_t") && args.HasArgument("pad_l") &&
+      args.HasArgument("pad_b") && args.HasArgument("pad_r")) {
+    *pads = {args.GetSingleArgument<int>("pad_t", 0),
+             args.GetSingleArgument<int>("pad_l", 0),
+             args.GetSingleArgument<int>("pad_b", 0),
+             args.GetSingleArgument<int>("pad_r", 0)};
+  }
+  if (pads->empty()) {
+    pads->assign(4, 0);
+  }
+  return pads->size() == 4;
+}
+
+bool IsZeroPadImage(const OperatorDef& op) {
+  ArgumentHelper args(op);
+  std::vector<int> pads;
+  return op.type() == "PadImage" && op.input_size() == 1 &&
+      op.output_size() == 1 && op.input(0) != op.output(0) &&
+      args.GetSingleArgument<string>("mode", "constant") == "constant" &&
+      args.GetSingleArgument<float>("value", 0) == 0 && GetPads2D(op, &pads);
+}
+
+bool Is2DConv(const OperatorDef& op) {
+  ArgumentHelper args(op);
+  std::vector<int> pads;
+  return (op.type() == "Conv" || op.type() == "Conv2D") &&
+      op.input_size() >= 2 && !args.HasArgument("kernels") &&
+      !args.HasArgument("global_pooling") && GetPads2D(op, &pads);
+}
+
+string GetOrder(const OperatorDef& op) {
+  return ArgumentHelper(op).GetSingleArgument<string>("order", "NCHW");
+}
+
+} // namespace
+
+bool PadFoldingTransform::PatternRule(
+    const Graph& g,
+    const std::vector<int>& subgraph,
+    int idx) {
+  const OperatorDef& op = g.node(idx).op;
+  if (subgraph.size() == 0) {
+    return IsZeroPadImage(op);
+  }
+  if (subgraph.size() != 1 || !Is2DConv(op)) {
+    return false;
+  }
+  const Node& pad = g.node(subgraph[0]);
+  const string& padded = pad.op.output(0);
+  if (pad.children.size() != 1 || !pad.children.count(idx) ||
+      op.input(0) != padded || g.external_output().count(padded) ||
+      GetOrder(op) != GetOrder(pad.op) ||
+      op.device_option().SerializeAsString() !=
+          pad.op.device_option().SerializeAsString()) {
+    return false;
+  }
+  for (int i = 1; i < op.input_size(); i++) {
+    if (op.input(i) == padded) {
+      return false;
+    }
+  }
+  // The Conv reads the unpadded blob instead, which must still hold the
+  // same value when it runs.
+  for (int i = subgraph[0] + 1; i <= idx; i++) {
+    for (const auto& output : g.node(i).op.output()) {
+      if (output == pad.op.input(0)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool PadFoldingTransform::ValidatorRule(
+    const Graph& g,
+    const std::vector<int>& subgraph) {
+  return subgraph.size() == 2;
+}
+
+bool PadFoldingTransform::ReplaceRule(
+    const std::vector<int>& subgraph,
+    Graph* g_ptr) {
+  CHECK(g_ptr);
+  auto& g = *g_ptr;
+
+  const int pad_idx = subgraph[0];
+  const int conv_idx = subgraph[1];
+  const OperatorDef pad_op = g.node(pad_idx).op;
+  OperatorDef conv_op = g.node(conv_idx).op;
+
+  std::vector<int> pads, conv_pads;
+  CAFFE_ENFORCE(GetPads2D(pad_op, &pads));
+  CAFFE_ENFORCE(GetPads2D(conv_op, &conv_pads));
+  for (int i = 0; i < 4; i++) {
+    pads[i] += conv_pads[i];
+  }
+  google::protobuf::RepeatedPtrField<Argument> args;
+  for (const auto& arg : conv_op.arg()) {
+    if (std::find(std::begin(kPadArgs), std::end(kPadArgs), arg.name()) ==
+        std::end(kPadArgs)) {
+      args.Add()->CopyFrom(arg);
+    }
+  }
+  conv_op.mutable_arg()->Swap(&args);
+  conv_op.add_arg()->CopyFrom(MakeArgument("pads", pads));
+  conv_op.set_input(0, pad_op.input(0));
+  g.node(conv_idx).op = conv_op;
+
+  // The Conv takes over the writers of the unpadded blob.
+  const auto pad_parents = g.node(pad_idx).parents;
+  g.DeactivateSubgraph({pad_idx});
+  for (const auto& edge : pad_parents) {
+    auto& blobs = g.node(conv_idx).parents[edge.first];
+    for (const auto& blob : edge.second) {
+      if (std::find(blobs.begin(), blobs.end(), blob) == blobs.end()) {
+        blobs.push_back(blob);
+      }
+    }
+    g.node(edge.first).children[conv_idx] = blobs;
+  }
+  return true;
+}
+
+REGISTER_TRANSFORM(PadFolding, PadFoldingTransform);
+
+} // namespace caffe2
@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/transform.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+/**
+ * Pad Folding
+ *
+ * This transform removes a PadImage that zero-pads the input of a 2D Conv,
+ * adding its pads to the pads of the Conv instead, so that the padded copy
+ * of the input is never materialized: the Conv treats the pixels outside of
+ * its input as zeros anyway.
+ *
+ * Only constant zero padding is folded, into a Conv of the same device,
+ * order and input that uses explicit pads, and only when the Conv alone
+ * reads the padded blob and nothing overwrites the unpadded one in between.
+ */
+class PadFoldingTransform : public Transform {
+ protected:
+  bool PatternRule(
+      const transform::Graph& g,
+      const std::vector<int>& subgraph,
+      int idx) override;
+  bool ValidatorRule(
+      const transform::Graph& g,
+      const std::vector<int>& subgraph) override;
+  bool ReplaceRule(const std::vector<int>& subgraph, transform::Graph* g_ptr)
+      override;
+};
+
+} // namespace caffe2
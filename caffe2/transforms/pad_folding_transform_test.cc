@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/transforms/pad_folding_transform.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+using transform::Graph;
+
+void AddRandomTensor(
+    Workspace* ws,
+    const string& name,
+    const vector<TIndex>& dims,
+    float min,
+    float max) {
+  CPUContext context;
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  math::RandUniform<float, CPUContext>(
+      tensor->size(), min, max, tensor->mutable_data<float>(), &context);
+}
+
+NetDef CreatePadConvNet() {
+  NetDef netdef;
+  OperatorDef* op;
+  op = AddOp(&netdef, "PadImage", {"X"}, {"padded"});
+  AddArgument<int>("pad_t", 2, op);
+  AddArgument<int>("pad_l", 0, op);
+  AddArgument<int>("pad_b", 1, op);
+  AddArgument<int>("pad_r", 3, op);
+  op = AddOp(&netdef, "Conv", {"padded", "W", "b"}, {"out"});
+  AddArgument<int>("kernel", 3, op);
+  AddArgument<int>("pad", 1, op);
+  netdef.add_external_output("out");
+  return netdef;
+}
+
+} // namespace
+
+TEST(PadFoldingTest, TestPatterns) {
+  NetDef netdef = CreatePadConvNet();
+  auto t = TransformRegistry()->Create("PadFolding");
+  EXPECT_EQ(t->PatternMatch(Graph(netdef)).size(), 1);
+
+  NetDef transformed_netdef = t->ApplyTo(netdef);
+  ASSERT_EQ(transformed_netdef.op_size(), 1);
+  const auto& conv = transformed_netdef.op(0);
+  EXPECT_EQ(conv.type(), "Conv");
+  EXPECT_EQ(conv.input(0), "X");
+  ArgumentHelper args(conv);
+  EXPECT_FALSE(args.HasArgument("pad"));
+  EXPECT_EQ(args.GetSingleArgument<int>("kernel", 0), 3);
+  EXPECT_EQ(args.GetRepeatedArgument<int>("pads"), vector<int>({3, 1, 2, 4}));
+}
+
+TEST(PadFoldingTest, TestUnfoldable) {
+  auto t = TransformRegistry()->Create("PadFolding");
+
+  // Reflect padding is not what the Conv pads with.
+  NetDef netdef = CreatePadConvNet();
+  AddArgument<string>("mode", "reflect", netdef.mutable_op(0));
+  EXPECT_EQ(t->PatternMatch(Graph(netdef)).size(), 0);
+
+  // The padded blob is needed elsewhere.
+  netdef = CreatePadConvNet();
+  AddOp(&netdef, "Relu", {"padded"}, {"relu"});
+  EXPECT_EQ(t->PatternMatch(Graph(netdef)).size(), 0);
+
+  // The unpadded blob is overwritten before the Conv runs.
+  netdef = CreatePadConvNet();
+  const OperatorDef conv = netdef.op(1);
+  netdef.mutable_op()->RemoveLast();
+  AddOp(&netdef, "Relu", {"X"}, {"X"});
+  netdef.add_op()->CopyFrom(conv);
+  EXPECT_EQ(t->PatternMatch(Graph(netdef)).size(), 0);
+}
+
+TEST(PadFoldingTest, TestNumerics) {
+  Workspace ws;
+  AddRandomTensor(&ws, "X", {2, 3, 6, 5}, -1, 1);
+  AddRandomTensor(&ws, "W", {4, 3, 3, 3}, -1, 1);
+  AddRandomTensor(&ws, "b", {4}, -1, 1);
+
+  NetDef netdef = CreatePadConvNet();
+  ASSERT_TRUE(ws.RunNetOnce(netdef));
+  TensorCPU expected(ws.GetBlob("out")->Get<TensorCPU>());
+
+  auto t = TransformRegistry()->Create("PadFolding");
+  ASSERT_TRUE(ws.RunNetOnce(t->ApplyTo(netdef)));
+  const auto& actual = ws.GetBlob("out")->Get<TensorCPU>();
+  ASSERT_EQ(actual.dims(), expected.dims());
+  for (int i = 0; i < actual.size(); ++i) {
+    EXPECT_NEAR(actual.data<float>()[i], expected.data<float>()[i], 1e-4);
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,37 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/transforms/shared_col_buffer_transform.h"
+
+#include "caffe2/operators/conv_op_shared.h"
+
+namespace caffe2 {
+
+bool SharedColBufferTransform::MatchOperator(const OperatorDef& op) {
+  return conv_ops_.count(op.type()) &&
+      op.device_option().device_type() == CPU &&
+      ArgumentHelper(op).GetSingleArgument<int>("shared_buffer", 0) !=
+      kThreadLocalColBuffer;
+}
+
+void SharedColBufferTransform::ReplaceOperator(OperatorDef* op) {
+  AddArgument<int>("shared_buffer", kThreadLocalColBuffer, op);
+}
+
+REGISTER_TRANSFORM(SharedColBuffer, SharedColBufferTransform);
+
+} // namespace caffe2
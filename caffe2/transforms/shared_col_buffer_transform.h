@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/transforms/single_op_transform.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+/**
+ * Shared Col Buffer
+ *
+ * Makes every CPU convolution and transposed convolution of the net use the
+ * col buffer of the thread it runs on (shared_buffer = 2) instead of keeping
+ * a buffer of its own alive. Each worker thread then holds one buffer, sized
+ * to the largest requirement among the operators it ran, which saves the sum
+ * of the per-operator buffers in deep nets. Operators running concurrently on
+ * different DAGNet workers use different buffers, so they never wait on each
+ * other like with the workspace buffer (shared_buffer = 1).
+ */
+class SharedColBufferTransform : public SingleOpTransform {
+ protected:
+  bool MatchOperator(const OperatorDef& op) override;
+  void ReplaceOperator(OperatorDef* op) override;
+
+ private:
+  std::set<string> conv_ops_ = {"Conv",
+                                "Conv1D",
+                                "Conv2D",
+                                "Conv3D",
+                                "ConvGradient",
+                                "Conv1DGradient",
+                                "Conv2DGradient",
+                                "Conv3DGradient",
+                                "ConvTranspose",
+                                "ConvTransposeGradient",
+                                "DeformConv",
+                                "DeformConvGradient"};
+};
+
+} // namespace caffe2
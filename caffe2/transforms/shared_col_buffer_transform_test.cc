@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/transforms/shared_col_buffer_transform.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+TEST(SharedColBufferTest, TestSimple) {
+  NetDef netdef;
+  OperatorDef* op;
+  op = AddOp(&netdef, "Conv", {"in"}, {"out"});
+  op = AddOp(&netdef, "Relu", {"out"}, {"out"});
+  op = AddOp(&netdef, "ConvTranspose", {"out"}, {"out"});
+  op = AddOp(&netdef, "Conv", {"out"}, {"out"}); // if not CPU, won't transform
+  op->mutable_device_option()->set_device_type(CUDA);
+
+  auto t = TransformRegistry()->Create("SharedColBuffer");
+  NetDef transformed_netdef = t->ApplyTo(netdef);
+  std::vector<int> shared_buffer;
+  for (auto& op : transformed_netdef.op()) {
+    shared_buffer.push_back(
+        ArgumentHelper(op).GetSingleArgument<int>("shared_buffer", 0));
+  }
+  EXPECT_EQ(shared_buffer, std::vector<int>({2, 0, 2, 0}));
+}
+
+// Two convolutions of different sizes give the same results with the
+// per-thread buffer as with their own buffers.
+TEST(SharedColBufferTest, TestRun) {
+  NetDef netdef;
+  OperatorDef* op;
+  op = AddOp(&netdef, "Conv", {"X", "W1", "b1"}, {"Y1"});
+  op->add_arg()->CopyFrom(MakeArgument("kernel", 3));
+  op->add_arg()->CopyFrom(MakeArgument("pad", 1));
+  op = AddOp(&netdef, "Conv", {"Y1", "W2", "b2"}, {"Y2"});
+  op->add_arg()->CopyFrom(MakeArgument("kernel", 2));
+
+  auto fill = [](Workspace* ws, const string& name, vector<TIndex> dims) {
+    CPUContext context;
+    auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+    tensor->Resize(dims);
+    math::RandUniform<float, CPUContext>(
+        tensor->size(), -1, 1, tensor->mutable_data<float>(), &context);
+  };
+  Workspace ws;
+  fill(&ws, "X", {2, 3, 8, 8});
+  fill(&ws, "W1", {4, 3, 3, 3});
+  fill(&ws, "b1", {4});
+  fill(&ws, "W2", {5, 4, 2, 2});
+  fill(&ws, "b2", {5});
+
+  ASSERT_TRUE(ws.RunNetOnce(netdef));
+  TensorCPU expected(ws.GetBlob("Y2")->Get<TensorCPU>());
+
+  auto t = TransformRegistry()->Create("SharedColBuffer");
+  ASSERT_TRUE(ws.RunNetOnce(t->ApplyTo(netdef)));
+  const auto& actual = ws.GetBlob("Y2")->Get<TensorCPU>();
+  ASSERT_EQ(actual.dims(), expected.dims());
+  for (int i = 0; i < actual.size(); ++i) {
+    EXPECT_EQ(actual.data<float>()[i], expected.data<float>()[i]);
+  }
+}
+
+} // namespace
+
+} // namespace caffe2
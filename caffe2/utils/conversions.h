@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <cstring>
+
 #include <caffe2/core/types.h>
 
 #ifdef __CUDA_ARCH__
@@ -223,6 +225,28 @@ CONVERSIONS_DECL float To(const float in) {
   return in;
 }
 
+// bfloat16 rounds to nearest even, and keeps NaNs quiet.
+template <>
+CONVERSIONS_DECL bfloat16 To(const float in) {
+  uint32_t bits;
+  memcpy(&bits, &in, sizeof(bits));
+  bfloat16 ret;
+  if ((bits & 0x7fffffff) > 0x7f800000) {
+    ret.x = static_cast<uint16_t>((bits >> 16) | 0x40);
+  } else {
+    ret.x = static_cast<uint16_t>((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+  }
+  return ret;
+}
+
+template <>
+CONVERSIONS_DECL float To(const bfloat16 in) {
+  const uint32_t bits = static_cast<uint32_t>(in.x) << 16;
+  float ret;
+  memcpy(&ret, &bits, sizeof(bits));
+  return ret;
+}
+
 template <typename OUT, typename IN>
 CONVERSIONS_DECL OUT Get(IN x) {
   return static_cast<OUT>(x);
@@ -0,0 +1,274 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_UTILS_FLAT_HASH_MAP_H_
+#define CAFFE2_UTILS_FLAT_HASH_MAP_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace caffe2 {
+
+// An open-addressing hash map from integer keys, with linear probing over a
+// flat array of (key, value) pairs. Compared to std::unordered_map it does a
+// single allocation per rehash instead of one per entry, and lookups touch
+// one or two cache lines. It implements the subset of the std::unordered_map
+// interface used by the map blobs; iterators are invalidated by any insert
+// or erase.
+template <typename K, typename V>
+class FlatHashMap {
+  static_assert(std::is_integral<K>::value, "FlatHashMap needs integer keys");
+
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<K, V>;
+
+  template <bool Const>
+  class Iterator {
+   public:
+    using value_type = FlatHashMap::value_type;
+    using MapPtr = typename std::
+        conditional<Const, const FlatHashMap*, FlatHashMap*>::type;
+    using reference =
+        typename std::conditional<Const, const value_type&, value_type&>::type;
+    using pointer =
+        typename std::conditional<Const, const value_type*, value_type*>::type;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    Iterator(MapPtr map, size_t slot) : map_(map), slot_(slot) {
+      skipEmpty();
+    }
+    // Allows converting an iterator into a const_iterator.
+    operator Iterator<true>() const {
+      return Iterator<true>(map_, slot_);
+    }
+
+    reference operator*() const {
+      return map_->slots_[slot_];
+    }
+    pointer operator->() const {
+      return &map_->slots_[slot_];
+    }
+    Iterator& operator++() {
+      ++slot_;
+      skipEmpty();
+      return *this;
+    }
+    bool operator==(const Iterator& other) const {
+      return slot_ == other.slot_;
+    }
+    bool operator!=(const Iterator& other) const {
+      return slot_ != other.slot_;
+    }
+
+   private:
+    void skipEmpty() {
+      while (slot_ < map_->used_.size() && !map_->used_[slot_]) {
+        ++slot_;
+      }
+    }
+
+    MapPtr map_;
+    size_t slot_;
+  };
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  FlatHashMap() {}
+
+  size_t size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  iterator begin() {
+    return iterator(this, 0);
+  }
+  iterator end() {
+    return iterator(this, used_.size());
+  }
+  const_iterator begin() const {
+    return const_iterator(this, 0);
+  }
+  const_iterator end() const {
+    return const_iterator(this, used_.size());
+  }
+
+  void clear() {
+    slots_.clear();
+    used_.clear();
+    size_ = 0;
+  }
+
+  // Makes room for n entries without further rehashing.
+  void reserve(size_t n) {
+    size_t capacity = 16;
+    while (capacity * kMaxLoadNum < n * kMaxLoadDen) {
+      capacity *= 2;
+    }
+    if (capacity > used_.size()) {
+      rehash(capacity);
+    }
+  }
+
+  iterator find(const K& key) {
+    return iterator(this, findSlot(key));
+  }
+  const_iterator find(const K& key) const {
+    return const_iterator(this, findSlot(key));
+  }
+  size_t count(const K& key) const {
+    return findSlot(key) != used_.size();
+  }
+
+  // Inserts (key, value) unless the key is already present, like
+  // std::unordered_map::emplace.
+  std::pair<iterator, bool> emplace(const K& key, const V& value) {
+    reserve(size_ + 1);
+    const size_t mask = used_.size() - 1;
+    size_t slot = hash(key) & mask;
+    while (used_[slot]) {
+      if (slots_[slot].first == key) {
+        return std::make_pair(iterator(this, slot), false);
+      }
+      slot = (slot + 1) & mask;
+    }
+    slots_[slot] = value_type(key, value);
+    used_[slot] = 1;
+    ++size_;
+    return std::make_pair(iterator(this, slot), true);
+  }
+
+  V& operator[](const K& key) {
+    return emplace(key, V()).first->second;
+  }
+
+  // Removes the key, shifting back the entries that follow it in its probe
+  // sequence so that no tombstones are needed.
+  size_t erase(const K& key) {
+    size_t hole = findSlot(key);
+    if (hole == used_.size()) {
+      return 0;
+    }
+    const size_t mask = used_.size() - 1;
+    for (size_t slot = (hole + 1) & mask; used_[slot];
+         slot = (slot + 1) & mask) {
+      const size_t home = hash(slots_[slot].first) & mask;
+      // The entry can fill the hole unless its home is cyclically in
+      // (hole, slot].
+      const bool stays = hole <= slot ? (hole < home && home <= slot)
+                                      : (hole < home || home <= slot);
+      if (!stays) {
+        slots_[hole] = slots_[slot];
+        hole = slot;
+      }
+    }
+    used_[hole] = 0;
+    --size_;
+    return 1;
+  }
+
+  // Looks up n keys, writing the value of each one, or default_value if it
+  // is missing. The slots of the keys are prefetched a few keys ahead.
+  void lookup(const K* keys, size_t n, V* values, const V& default_value)
+      const {
+    if (used_.empty()) {
+      std::fill(values, values + n, default_value);
+      return;
+    }
+    const size_t mask = used_.size() - 1;
+    for (size_t i = 0; i < n; ++i) {
+#ifdef __GNUC__
+      if (i + kPrefetchDistance < n) {
+        const size_t ahead = hash(keys[i + kPrefetchDistance]) & mask;
+        __builtin_prefetch(&used_[ahead]);
+        __builtin_prefetch(&slots_[ahead]);
+      }
+#endif
+      const size_t slot = findSlot(keys[i]);
+      values[i] = slot != used_.size() ? slots_[slot].second : default_value;
+    }
+  }
+
+ private:
+  // The table is grown before it gets more than 3/4 full, which keeps the
+  // probe sequences of missing keys short.
+  static constexpr size_t kMaxLoadNum = 3;
+  static constexpr size_t kMaxLoadDen = 4;
+  static constexpr size_t kPrefetchDistance = 8;
+
+  // The finalizer of MurmurHash3, since std::hash is usually the identity on
+  // integers and sequential keys would then fill contiguous runs of slots.
+  static size_t hash(const K& key) {
+    uint64_t h = static_cast<uint64_t>(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // Returns the slot of the key, or used_.size() if it is absent.
+  size_t findSlot(const K& key) const {
+    if (used_.empty()) {
+      return 0;
+    }
+    const size_t mask = used_.size() - 1;
+    for (size_t slot = hash(key) & mask; used_[slot];
+         slot = (slot + 1) & mask) {
+      if (slots_[slot].first == key) {
+        return slot;
+      }
+    }
+    return used_.size();
+  }
+
+  void rehash(size_t capacity) {
+    std::vector<value_type> slots(capacity);
+    std::vector<uint8_t> used(capacity, 0);
+    slots.swap(slots_);
+    used.swap(used_);
+    const size_t mask = capacity - 1;
+    for (size_t i = 0; i < used.size(); ++i) {
+      if (used[i]) {
+        size_t slot = hash(slots[i].first) & mask;
+        while (used_[slot]) {
+          slot = (slot + 1) & mask;
+        }
+        slots_[slot] = slots[i];
+        used_[slot] = 1;
+      }
+    }
+  }
+
+  std::vector<value_type> slots_;
+  std::vector<uint8_t> used_;
+  size_t size_{0};
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_UTILS_FLAT_HASH_MAP_H_
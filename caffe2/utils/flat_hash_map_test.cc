@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <random>
+#include <unordered_map>
+
+#include <gtest/gtest.h>
+#include "caffe2/utils/flat_hash_map.h"
+
+namespace caffe2 {
+
+TEST(FlatHashMapTest, MatchesUnorderedMap) {
+  FlatHashMap<int64_t, int> map;
+  std::unordered_map<int64_t, int> ref;
+  std::mt19937 gen(42);
+  // A small key range, so that inserts, hits and erases all happen often.
+  std::uniform_int_distribution<int64_t> key_dist(-500, 500);
+  std::uniform_int_distribution<int> op_dist(0, 2);
+  for (int i = 0; i < 100000; ++i) {
+    const auto key = key_dist(gen);
+    switch (op_dist(gen)) {
+      case 0:
+        EXPECT_EQ(map.emplace(key, i).second, ref.emplace(key, i).second);
+        break;
+      case 1:
+        EXPECT_EQ(map.erase(key), ref.erase(key));
+        break;
+      default:
+        EXPECT_EQ(map.count(key), ref.count(key));
+        if (ref.count(key)) {
+          EXPECT_EQ(map.find(key)->second, ref[key]);
+        }
+    }
+    ASSERT_EQ(map.size(), ref.size());
+  }
+  size_t visited = 0;
+  for (const auto& entry : map) {
+    EXPECT_EQ(entry.second, ref.at(entry.first));
+    ++visited;
+  }
+  EXPECT_EQ(visited, ref.size());
+}
+
+TEST(FlatHashMapTest, LookupAndReserve) {
+  FlatHashMap<int32_t, int64_t> map;
+  map.reserve(1000);
+  for (int32_t i = 0; i < 1000; ++i) {
+    map[i * 3] = i;
+  }
+  EXPECT_EQ(map.size(), 1000);
+  std::vector<int32_t> keys = {0, 1, 2997, 3000, -3};
+  std::vector<int64_t> values(keys.size());
+  map.lookup(keys.data(), keys.size(), values.data(), -1);
+  EXPECT_EQ(values, std::vector<int64_t>({0, -1, 999, -1, -1}));
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.begin() == map.end());
+  map.lookup(keys.data(), keys.size(), values.data(), 7);
+  EXPECT_EQ(values, std::vector<int64_t>(keys.size(), 7));
+}
+
+} // namespace caffe2
@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/utils/gradient_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/perfkernels/type_conversion.h"
+#include "caffe2/perfkernels/typed_axpy.h"
+#include "caffe2/utils/conversions.h"
+
+namespace caffe2 {
+namespace compression {
+
+void FloatToHalf(int N, const float* X, float16* Y) {
+  float_to_float16(N, X, Y);
+}
+
+void HalfToFloat(int N, const float16* X, float* Y) {
+  float16_to_float(N, X, Y);
+}
+
+void HalfAccumulate(int N, const float16* X, float* Y) {
+  TypedAxpy<float16, float>(N, 1.0f, X, Y);
+}
+
+size_t TopKMessageBytes(int k, bool half_values) {
+  const size_t value_bytes = half_values ? sizeof(float16) : sizeof(float);
+  return k * (sizeof(int32_t) + value_bytes);
+}
+
+void EncodeTopK(
+    int N,
+    int k,
+    bool half_values,
+    const float* X,
+    float* residual,
+    char* message) {
+  CAFFE_ENFORCE_LE(k, N);
+  for (int i = 0; i < N; ++i) {
+    residual[i] += X[i];
+  }
+  std::vector<int32_t> order(N);
+  std::iota(order.begin(), order.end(), 0);
+  std::nth_element(
+      order.begin(),
+      order.begin() + k,
+      order.end(),
+      [residual](int32_t a, int32_t b) {
+        return std::abs(residual[a]) > std::abs(residual[b]);
+      });
+  // Sorted indices keep the scatter on the receiving side cache friendly.
+  std::sort(order.begin(), order.begin() + k);
+
+  auto* indices = reinterpret_cast<int32_t*>(message);
+  std::memcpy(indices, order.data(), k * sizeof(int32_t));
+  char* values = message + k * sizeof(int32_t);
+  for (int i = 0; i < k; ++i) {
+    const auto idx = order[i];
+    float sent = residual[idx];
+    if (half_values) {
+      const auto h = convert::To<float, float16>(sent);
+      std::memcpy(values + i * sizeof(float16), &h, sizeof(float16));
+      sent = convert::To<float16, float>(h);
+    } else {
+      std::memcpy(values + i * sizeof(float), &sent, sizeof(float));
+    }
+    residual[idx] -= sent;
+  }
+}
+
+void DecodeTopKAccumulate(
+    int N,
+    int k,
+    bool half_values,
+    const char* message,
+    float* Y) {
+  const char* values = message + k * sizeof(int32_t);
+  for (int i = 0; i < k; ++i) {
+    int32_t idx;
+    std::memcpy(&idx, message + i * sizeof(int32_t), sizeof(int32_t));
+    CAFFE_ENFORCE(idx >= 0 && idx < N, "Bad index in top-k message: ", idx);
+    if (half_values) {
+      float16 h;
+      std::memcpy(&h, values + i * sizeof(float16), sizeof(float16));
+      Y[idx] += convert::To<float16, float>(h);
+    } else {
+      float v;
+      std::memcpy(&v, values + i * sizeof(float), sizeof(float));
+      Y[idx] += v;
+    }
+  }
+}
+
+} // namespace compression
+} // namespace caffe2
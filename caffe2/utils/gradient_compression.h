@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_UTILS_GRADIENT_COMPRESSION_H_
+#define CAFFE2_UTILS_GRADIENT_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+namespace compression {
+
+// Helpers shared by the compressed allreduce operators. Gradients are always
+// accumulated in fp32; only what goes over the wire is compressed.
+
+void FloatToHalf(int N, const float* X, float16* Y);
+void HalfToFloat(int N, const float16* X, float* Y);
+// Y += X, with the sum computed in fp32.
+void HalfAccumulate(int N, const float16* X, float* Y);
+
+// Top-k sparsification with error feedback. A message holds k int32 indices
+// followed by k values, stored as fp16 if half_values is set and as fp32
+// otherwise.
+size_t TopKMessageBytes(int k, bool half_values);
+
+// Adds X to the residual, then moves the k entries of the residual with the
+// largest magnitude into the message. What is not sent, including the fp16
+// rounding error of the sent values, stays in the residual for later steps.
+void EncodeTopK(
+    int N,
+    int k,
+    bool half_values,
+    const float* X,
+    float* residual,
+    char* message);
+
+// Adds the entries of a message produced by EncodeTopK to Y.
+void DecodeTopKAccumulate(
+    int N,
+    int k,
+    bool half_values,
+    const char* message,
+    float* Y);
+
+} // namespace compression
+} // namespace caffe2
+
+#endif // CAFFE2_UTILS_GRADIENT_COMPRESSION_H_
@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "caffe2/utils/gradient_compression.h"
+
+namespace caffe2 {
+namespace compression {
+
+TEST(GradientCompressionTest, HalfRoundTrip) {
+  const std::vector<float> X = {0.0f, 1.0f, -2.5f, 1024.0f, 0.1f};
+  std::vector<float16> H(X.size());
+  std::vector<float> Y(X.size());
+  FloatToHalf(X.size(), X.data(), H.data());
+  HalfToFloat(X.size(), H.data(), Y.data());
+  for (int i = 0; i < X.size(); ++i) {
+    EXPECT_NEAR(X[i], Y[i], 1e-3 * std::abs(X[i]));
+  }
+  std::vector<float> acc(X.size(), 1.0f);
+  HalfAccumulate(X.size(), H.data(), acc.data());
+  for (int i = 0; i < X.size(); ++i) {
+    EXPECT_FLOAT_EQ(acc[i], Y[i] + 1.0f);
+  }
+}
+
+TEST(GradientCompressionTest, TopKErrorFeedback) {
+  for (const bool half_values : {false, true}) {
+    const int N = 6;
+    const int k = 2;
+    const std::vector<float> X = {0.5f, -3.0f, 0.25f, 2.0f, -0.125f, 1.0f};
+    std::vector<float> residual(N, 0.0f);
+    residual[4] = -4.0f;
+    std::vector<char> message(TopKMessageBytes(k, half_values));
+    EncodeTopK(N, k, half_values, X.data(), residual.data(), message.data());
+
+    // The largest magnitudes of X + residual are at indices 1 and 4.
+    std::vector<float> Y(N, 0.0f);
+    DecodeTopKAccumulate(N, k, half_values, message.data(), Y.data());
+    EXPECT_FLOAT_EQ(Y[1], -3.0f);
+    EXPECT_FLOAT_EQ(Y[4], -4.125f);
+    // Sent and kept values always add up to what was accumulated.
+    for (int i = 0; i < N; ++i) {
+      const float expected = X[i] + (i == 4 ? -4.0f : 0.0f);
+      EXPECT_FLOAT_EQ(Y[i] + residual[i], expected);
+    }
+    EXPECT_FLOAT_EQ(residual[1], 0.0f);
+    EXPECT_FLOAT_EQ(residual[3], 2.0f);
+
+    // The residual is sent on the next step.
+    const std::vector<float> zeros(N, 0.0f);
+    std::fill(Y.begin(), Y.end(), 0.0f);
+    EncodeTopK(
+        N, k, half_values, zeros.data(), residual.data(), message.data());
+    DecodeTopKAccumulate(N, k, half_values, message.data(), Y.data());
+    EXPECT_FLOAT_EQ(Y[3], 2.0f);
+    EXPECT_FLOAT_EQ(Y[5], 1.0f);
+  }
+}
+
+TEST(GradientCompressionTest, TopKRejectsBadIndex) {
+  const std::vector<float> X = {1.0f, 2.0f};
+  std::vector<float> residual(2, 0.0f);
+  std::vector<char> message(TopKMessageBytes(1, false));
+  EncodeTopK(2, 1, false, X.data(), residual.data(), message.data());
+  std::vector<float> Y(1, 0.0f);
+  EXPECT_ANY_THROW(
+      DecodeTopKAccumulate(1, 1, false, message.data(), Y.data()));
+}
+
+} // namespace compression
+} // namespace caffe2
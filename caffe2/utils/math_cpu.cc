@@ -32,10 +32,13 @@
 #include <chrono>
 #include <random>
 #include <unordered_set>
+#include <vector>
 
 #include "caffe2/utils/math.h"
 #include "caffe2/utils/cpu_neon.h"
 #include "caffe2/core/context.h"
+#include "caffe2/perfkernels/transcendental.h"
+#include "caffe2/perfkernels/vector_ops.h"
 #include "Eigen/Core"
 #include "Eigen/Dense"
 
@@ -232,48 +235,6 @@ void Gemv<float, CPUContext>(
   }
 }
 
-#define CAFFE2_SPECIALIZED_SCALE(T)                                            \
-  template <>                                                                  \
-  void Scale<T, CPUContext>(                                                   \
-      const int n, const float alpha, const T* x, T* y, CPUContext* context) { \
-    EigenVectorMap<T>(y, n) = ConstEigenVectorMap<T>(x, n) * alpha;            \
-  }                                                                            \
-  template <>                                                                  \
-  void Scale<T, CPUContext>(                                                   \
-      const int n,                                                             \
-      const float* alpha,                                                      \
-      const T* x,                                                              \
-      T* y,                                                                    \
-      CPUContext* context) {                                                   \
-    EigenVectorMap<T>(y, n) = ConstEigenVectorMap<T>(x, n) * (*alpha);         \
-  }
-CAFFE2_SPECIALIZED_SCALE(float)
-#undef CAFFE2_SPECIALIZED_SCALE
-
-#define CAFFE2_SPECIALIZED_DOT(T)                                              \
-template<>                                                                     \
-void Dot<T, CPUContext>(                                                       \
-    const int N, const T* a, const T* b, T* y,                                 \
-    CPUContext* context) {                                                     \
-  *y = ConstEigenVectorMap<T>(a, N).dot(ConstEigenVectorMap<T>(b, N));         \
-}
-CAFFE2_SPECIALIZED_DOT(float)
-#undef CAFFE2_SPECIALIZED_DOT
-
-#define CAFFE2_SPECIALIZED_AXPY(T)                                          \
-  template <>                                                               \
-  void Axpy<T, CPUContext>(                                                 \
-      const int N, const T alpha, const T* x, T* Y, CPUContext* context) {  \
-    EigenVectorMap<T>(Y, N) += ConstEigenVectorMap<T>(x, N) * alpha;        \
-  }                                                                         \
-  template <>                                                               \
-  void Axpy<T, CPUContext>(                                                 \
-      const int N, const T* alpha, const T* x, T* Y, CPUContext* context) { \
-    EigenVectorMap<T>(Y, N) += ConstEigenVectorMap<T>(x, N) * (*alpha);     \
-  }
-CAFFE2_SPECIALIZED_AXPY(float)
-#undef CAFFE2_SPECIALIZED_AXPY
-
 #define CAFFE2_SPECIALIZED_AXPBY(T)                                            \
 template <>                                                                    \
 void Axpby<T, CPUContext>(const int N, const T alpha, const T* x,              \
@@ -341,47 +302,6 @@ void Gemv<float, CPUContext>(
   cblas_sgemv(CblasRowMajor, TransA, M, N, alpha, A, N, x, 1, beta, y, 1);
 }
 
-#define CAFFE2_SPECIALIZED_SCALE(T, prefix)                             \
-  template <>                                                           \
-  void Scale<T, CPUContext>(                                            \
-      const int n, const float alpha, const T* x, T* y, CPUContext*) {  \
-    if (y != x)                                                         \
-      cblas_##prefix##copy(n, x, 1, y, 1);                              \
-    cblas_##prefix##scal(n, static_cast<float>(alpha), y, 1);           \
-  }                                                                     \
-  template <>                                                           \
-  void Scale<T, CPUContext>(                                            \
-      const int n, const float* alpha, const T* x, T* y, CPUContext*) { \
-    if (y != x)                                                         \
-      cblas_##prefix##copy(n, x, 1, y, 1);                              \
-    cblas_##prefix##scal(n, static_cast<float>(*alpha), y, 1);          \
-  }
-CAFFE2_SPECIALIZED_SCALE(float, s)
-#undef CAFFE2_SPECIALIZED_SCALE
-
-#define CAFFE2_SPECIALIZED_DOT(T, prefix)                       \
-  template <>                                                   \
-  void Dot<T, CPUContext>(                                      \
-      const int N, const T* a, const T* b, T* y, CPUContext*) { \
-    *y = cblas_##prefix##dot(N, a, 1, b, 1);                    \
-  }
-CAFFE2_SPECIALIZED_DOT(float, s)
-#undef CAFFE2_SPECIALIZED_DOT
-
-#define CAFFE2_SPECIALIZED_AXPY(T, prefix)                          \
-  template <>                                                       \
-  void Axpy<T, CPUContext>(                                         \
-      const int N, const T alpha, const T* x, T* y, CPUContext*) {  \
-    cblas_##prefix##axpy(N, alpha, x, 1, y, 1);                     \
-  }                                                                 \
-  template <>                                                       \
-  void Axpy<T, CPUContext>(                                         \
-      const int N, const T* alpha, const T* x, T* y, CPUContext*) { \
-    cblas_##prefix##axpy(N, *alpha, x, 1, y, 1);                    \
-  }
-CAFFE2_SPECIALIZED_AXPY(float, s)
-#undef CAFFE2_SPECIALIZED_AXPY
-
 // cblas_[sd]axpby is not a standard blas function, and if MKL is not present,
 // we will need to implement it.
 #ifdef CAFFE2_USE_MKL
@@ -415,6 +335,79 @@ CAFFE2_SPECIALIZED_AXPBY(float, s)
 
 #endif  // CAFFE2_USE_EIGEN_FOR_BLAS
 
+// The float level 1 functions are not taken from the BLAS picked at compile
+// time but from the perfkernels, which pick the best instruction set at run
+// time.
+template <>
+void Scale<float, CPUContext>(
+    const int n,
+    const float alpha,
+    const float* x,
+    float* y,
+    CPUContext* /*context*/) {
+  vector_scale(n, alpha, x, y);
+}
+
+template <>
+void Scale<float, CPUContext>(
+    const int n,
+    const float* alpha,
+    const float* x,
+    float* y,
+    CPUContext* /*context*/) {
+  vector_scale(n, *alpha, x, y);
+}
+
+template <>
+void Dot<float, CPUContext>(
+    const int N,
+    const float* a,
+    const float* b,
+    float* y,
+    CPUContext* /*context*/) {
+  *y = vector_dot(N, a, b);
+}
+
+template <>
+void Axpy<float, CPUContext>(
+    const int N,
+    const float alpha,
+    const float* x,
+    float* y,
+    CPUContext* /*context*/) {
+  vector_axpy(N, alpha, x, y);
+}
+
+template <>
+void Axpy<float, CPUContext>(
+    const int N,
+    const float* alpha,
+    const float* x,
+    float* y,
+    CPUContext* /*context*/) {
+  vector_axpy(N, *alpha, x, y);
+}
+
+template <>
+void Add<float, CPUContext>(
+    const int N,
+    const float* a,
+    const float* b,
+    float* y,
+    CPUContext* /*context*/) {
+  vector_add(N, a, b, y);
+}
+
+template <>
+void Mul<float, CPUContext>(
+    const int N,
+    const float* a,
+    const float* b,
+    float* y,
+    CPUContext* /*context*/) {
+  vector_mul(N, a, b, y);
+}
+
 template <>
 void GemmBatched<float, CPUContext>(
     const CBLAS_TRANSPOSE TransA,
@@ -434,10 +427,42 @@ void GemmBatched<float, CPUContext>(
     CPUContext* context,
     Tensor<CPUContext>*, /* scratch */
     TensorProto::DataType /* math_type */) {
-
   auto a_offset = A_size / A_batches;
   auto b_offset = B_size / B_batches;
   auto y_offset = M * N;
+#if defined(CAFFE2_USE_MKL) && INTEL_MKL_VERSION >= 110300
+  // A single group of A_batches problems of the same shape, which MKL
+  // schedules together instead of paying the call overhead per matrix.
+  std::vector<const float*> a_array(A_batches);
+  std::vector<const float*> b_array(A_batches);
+  std::vector<float*> c_array(A_batches);
+  for (int i = 0; i < A_batches; ++i) {
+    a_array[i] = A + a_offset * i;
+    b_array[i] = B + b_offset * i;
+    c_array[i] = C + y_offset * i;
+  }
+  const MKL_INT m = M, n = N, k = K, group_size = A_batches;
+  const MKL_INT lda = (TransA == CblasNoTrans) ? K : M;
+  const MKL_INT ldb = (TransB == CblasNoTrans) ? N : K;
+  const MKL_INT ldc = N;
+  cblas_sgemm_batch(
+      CblasRowMajor,
+      &TransA,
+      &TransB,
+      &m,
+      &n,
+      &k,
+      &alpha,
+      a_array.data(),
+      &lda,
+      b_array.data(),
+      &ldb,
+      &beta,
+      c_array.data(),
+      &ldc,
+      1,
+      &group_size);
+#else
   // loop over matrices in the batch
   for (int i = 0; i < A_batches; ++i) {
     math::Gemm<float, CPUContext>(
@@ -446,13 +471,14 @@ void GemmBatched<float, CPUContext>(
         M,
         N,
         K,
-        1,
+        alpha,
         A + a_offset * i,
         B + b_offset * i,
-        0,
+        beta,
         C + y_offset * i,
         context);
   }
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -521,11 +547,9 @@ DELEGATE_POWX_FUNCTION(double, vdPowx)
       const int N, const T* a, const T* b, T* y, CPUContext*) {    \
     OriginalFunc(N, a, b, y);                                      \
   }
-DELEGATE_SIMPLE_BINARY_FUNCTION(float,  Add, vsAdd)
 DELEGATE_SIMPLE_BINARY_FUNCTION(double, Add, vdAdd)
 DELEGATE_SIMPLE_BINARY_FUNCTION(float,  Sub, vsSub)
 DELEGATE_SIMPLE_BINARY_FUNCTION(double, Sub, vdSub)
-DELEGATE_SIMPLE_BINARY_FUNCTION(float,  Mul, vsMul)
 DELEGATE_SIMPLE_BINARY_FUNCTION(double, Mul, vdMul)
 DELEGATE_SIMPLE_BINARY_FUNCTION(float,  Div, vsDiv)
 DELEGATE_SIMPLE_BINARY_FUNCTION(double, Div, vdDiv)
@@ -538,8 +562,6 @@ DELEGATE_SIMPLE_BINARY_FUNCTION(double, Div, vdDiv)
   void Funcname<T, CPUContext>(const int N, const T* x, T* y, CPUContext*) { \
     EigenVectorMap<T>(y, N) = ConstEigenVectorMap<T>(x, N).array().expr();   \
   }
-DELEGATE_SIMPLE_UNARY_FUNCTION(float, Exp, exp)
-DELEGATE_SIMPLE_UNARY_FUNCTION(float, Log, log)
 DELEGATE_SIMPLE_UNARY_FUNCTION(float, Cos, cos)
 DELEGATE_SIMPLE_UNARY_FUNCTION(float, Sin, sin)
 DELEGATE_SIMPLE_UNARY_FUNCTION(float, Abs, abs)
@@ -548,6 +570,26 @@ DELEGATE_SIMPLE_UNARY_FUNCTION(float, InvSqrt, rsqrt)
 DELEGATE_SIMPLE_UNARY_FUNCTION(float, Sqr, square)
 #undef DELEGATE_SIMPLE_UNARY_FUNCTION
 
+// Exp and Log go through the perfkernels, which vectorize them whatever the
+// compiler does with the Eigen expressions.
+template <>
+void Exp<float, CPUContext>(
+    const int N,
+    const float* x,
+    float* y,
+    CPUContext* /*context*/) {
+  vector_exp(N, x, y);
+}
+
+template <>
+void Log<float, CPUContext>(
+    const int N,
+    const float* x,
+    float* y,
+    CPUContext* /*context*/) {
+  vector_log(N, x, y);
+}
+
 #define DELEGATE_SINCOS_FUNCTION(T)                                        \
   template <>                                                              \
   void SinCos<T, CPUContext>(                                              \
@@ -580,26 +622,20 @@ void Funcname<T, CPUContext>(                                                  \
       ConstEigenVectorMap<T>(b, N).array();                                    \
 }
 
-#ifdef CAFFE2_USE_MKL
-
-#define DEFINE_SIMPLE_BINARY_FUNCTION(Funcname, expr)                          \
-EIGEN_SIMPLE_BINARY_FUNCTION(int32_t, Funcname, expr)                          \
-EIGEN_SIMPLE_BINARY_FUNCTION(int64_t, Funcname, expr)
-
-#else
-
 #define DEFINE_SIMPLE_BINARY_FUNCTION(Funcname, expr)                          \
-EIGEN_SIMPLE_BINARY_FUNCTION(float, Funcname, expr)                            \
 EIGEN_SIMPLE_BINARY_FUNCTION(int32_t, Funcname, expr)                          \
 EIGEN_SIMPLE_BINARY_FUNCTION(int64_t, Funcname, expr)
 
-#endif
-
 DEFINE_SIMPLE_BINARY_FUNCTION(Add, +)
 DEFINE_SIMPLE_BINARY_FUNCTION(Sub, -)
 DEFINE_SIMPLE_BINARY_FUNCTION(Mul, *)
 DEFINE_SIMPLE_BINARY_FUNCTION(Div, /)
 
+#ifndef CAFFE2_USE_MKL
+EIGEN_SIMPLE_BINARY_FUNCTION(float, Sub, -)
+EIGEN_SIMPLE_BINARY_FUNCTION(float, Div, /)
+#endif
+
 #undef EIGEN_SIMPLE_BINARY_FUNCTION
 #undef DEFINE_FLOAT_BINARY_FUNCTION
 
@@ -639,15 +675,15 @@ CAFFE2_SPECIALIZED_REDUCEMAX(int64_t)
 
 #undef CAFFE2_SPECIALIZED_REDUCEMAX
 
-#define CAFFE2_SPECIALIZED_ROWWISEMAX(T)                         \
-  template <>                                                    \
-  void RowwiseMax<T, CPUContext>(                                \
-      const int N, const int D, const T* x, T* y, CPUContext*) { \
-    EigenVectorMap<T>(y, N) =                                    \
-        ConstEigenMatrixMap<T>(x, D, N).colwise().maxCoeff();    \
-  }
-CAFFE2_SPECIALIZED_ROWWISEMAX(float)
-#undef CAFFE2_SPECIALIZED_ROWWISEMAX
+template <>
+void RowwiseMax<float, CPUContext>(
+    const int N,
+    const int D,
+    const float* x,
+    float* y,
+    CPUContext* /*context*/) {
+  rowwise_max(N, D, x, y);
+}
 
 #define CAFFE2_SPECIALIZED_COLWISEMAX(T)                         \
   template <>                                                    \
@@ -809,10 +845,7 @@ template <>
 void RandUniform<float, CPUContext>(
     const int n, const float a, const float b, float* r,
     CPUContext* context) {
-  std::uniform_real_distribution<float> distribution(a, b);
-  for (int i = 0; i < n; ++i) {
-    r[i] = distribution(context->RandGenerator());
-  }
+  context->PhiloxRandGenerator().Uniform(n, a, b, r);
 }
 
 template <>
@@ -861,10 +894,7 @@ template <>
 void RandGaussian<float, CPUContext>(
     const int n, const float mean, const float std, float* r,
     CPUContext* context) {
-  std::normal_distribution<float> distribution(mean, std);
-  for (int i = 0; i < n; ++i) {
-    r[i] = distribution(context->RandGenerator());
-  }
+  context->PhiloxRandGenerator().Gaussian(n, mean, std, r);
 }
 
 #define CAFFE2_SPECIALIZED_SUM(T)            \
@@ -878,12 +908,21 @@ void RandGaussian<float, CPUContext>(
     *y = ConstEigenVectorMap<T>(x, N).sum(); \
   }
 
-CAFFE2_SPECIALIZED_SUM(float);
 CAFFE2_SPECIALIZED_SUM(int32_t);
 CAFFE2_SPECIALIZED_SUM(int64_t);
 
 #undef CAFFE2_SPECIALIZED_SUM
 
+template <>
+void Sum<float, CPUContext>(
+    const int N,
+    const float* x,
+    float* y,
+    CPUContext* /* unused */,
+    Tensor<CPUContext>* /* unused */) {
+  *y = vector_sum(N, x);
+}
+
 template <>
 void SumSqr<float, CPUContext>(
     const int N,
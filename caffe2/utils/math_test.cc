@@ -14,10 +14,14 @@
  * limitations under the License.
  */
 
+#include <cmath>
+#include <limits>
+
 #include <gtest/gtest.h>
 #include "caffe2/core/blob.h"
 #include "caffe2/core/context.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/perfkernels/transcendental.h"
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/utils/conversions.h"
 #include "caffe2/utils/math.h"
@@ -214,4 +218,98 @@ TEST(MathTest, FloatToHalfConversion) {
   CHECK_EQ(c, converted_c);
 }
 
+// Checks the vectorized kernels against the std:: functions, with N not a
+// multiple of the vector width so that the tail is exercised too.
+TEST(MathTest, TranscendentalFunctions) {
+  DeviceOption option;
+  CPUContext cpu_context(option);
+  const int N = 1003;
+  std::vector<float> x(N), y(N);
+  for (int i = 0; i < N; ++i) {
+    x[i] = -40.0f + 80.0f * i / N;
+  }
+  const auto near = [](float a, double b) {
+    return std::fabs(a - b) <= 4 * std::numeric_limits<float>::epsilon() *
+        std::fabs(b);
+  };
+
+  math::Exp<float, CPUContext>(N, x.data(), y.data(), &cpu_context);
+  for (int i = 0; i < N; ++i) {
+    EXPECT_TRUE(near(y[i], std::exp(double(x[i])))) << x[i];
+  }
+  vector_tanh(N, x.data(), y.data());
+  for (int i = 0; i < N; ++i) {
+    EXPECT_TRUE(near(y[i], std::tanh(double(x[i])))) << x[i];
+  }
+  vector_sigmoid(N, x.data(), y.data());
+  for (int i = 0; i < N; ++i) {
+    EXPECT_TRUE(near(y[i], 1 / (1 + std::exp(-double(x[i]))))) << x[i];
+  }
+  for (int i = 0; i < N; ++i) {
+    x[i] = std::ldexp(1.0f + float(i) / N, i % 200 - 100);
+  }
+  math::Log<float, CPUContext>(N, x.data(), y.data(), &cpu_context);
+  for (int i = 0; i < N; ++i) {
+    EXPECT_TRUE(near(y[i], std::log(double(x[i])))) << x[i];
+  }
+
+  const float special[] = {0.0f, -1.0f, std::numeric_limits<float>::infinity()};
+  math::Log<float, CPUContext>(3, special, y.data(), &cpu_context);
+  EXPECT_EQ(y[0], -std::numeric_limits<float>::infinity());
+  EXPECT_TRUE(std::isnan(y[1]));
+  EXPECT_EQ(y[2], std::numeric_limits<float>::infinity());
+}
+
+// Level 1 functions with sizes around the vector widths, compared against
+// sequential loops.
+TEST(MathTest, VectorFunctions) {
+  DeviceOption option;
+  CPUContext cpu_context(option);
+  for (const int N : {1, 7, 8, 15, 16, 17, 33, 100}) {
+    std::vector<float> a(N), b(N), y(N);
+    for (int i = 0; i < N; ++i) {
+      a[i] = 0.5f * (i % 7) - 1.0f;
+      b[i] = 0.25f * (i % 5) + 1.0f;
+    }
+    float dot = 0, sum = 0;
+    for (int i = 0; i < N; ++i) {
+      dot += a[i] * b[i];
+      sum += a[i];
+    }
+    float result;
+    math::Dot<float, CPUContext>(N, a.data(), b.data(), &result, &cpu_context);
+    EXPECT_FLOAT_EQ(result, dot) << N;
+    math::Sum<float, CPUContext>(N, a.data(), &result, &cpu_context);
+    EXPECT_FLOAT_EQ(result, sum) << N;
+
+    math::Add<float, CPUContext>(N, a.data(), b.data(), y.data(), &cpu_context);
+    for (int i = 0; i < N; ++i) {
+      EXPECT_EQ(y[i], a[i] + b[i]);
+    }
+    math::Mul<float, CPUContext>(N, a.data(), b.data(), y.data(), &cpu_context);
+    for (int i = 0; i < N; ++i) {
+      EXPECT_EQ(y[i], a[i] * b[i]);
+    }
+    math::Scale<float, CPUContext>(N, 3.0f, a.data(), y.data(), &cpu_context);
+    for (int i = 0; i < N; ++i) {
+      EXPECT_EQ(y[i], 3.0f * a[i]);
+    }
+    math::Axpy<float, CPUContext>(N, 2.0f, b.data(), y.data(), &cpu_context);
+    for (int i = 0; i < N; ++i) {
+      EXPECT_FLOAT_EQ(y[i], 3.0f * a[i] + 2.0f * b[i]);
+    }
+
+    // One row per length up to N, with the maximum at a different position.
+    std::vector<float> x(N * N, -5.0f), rowmax(N);
+    for (int i = 0; i < N; ++i) {
+      x[i * N + i] = i;
+    }
+    math::RowwiseMax<float, CPUContext>(
+        N, N, x.data(), rowmax.data(), &cpu_context);
+    for (int i = 0; i < N; ++i) {
+      EXPECT_EQ(rowmax[i], i);
+    }
+  }
+}
+
 } // namespace caffe2
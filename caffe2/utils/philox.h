@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_UTILS_PHILOX_H_
+#define CAFFE2_UTILS_PHILOX_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace caffe2 {
+
+/**
+ * Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2,
+ * 3", SC 2011), a counter-based random number generator: the random numbers
+ * of a stream are a function of the seed and of their position in it only.
+ * Any part of a stream can be computed independently of the others, so the
+ * result of filling a tensor does not depend on how the work is split, and
+ * the blocks are computed several at a time in plain loops the compiler
+ * vectorizes, unlike the sequential state of std::mt19937.
+ *
+ * The generator keeps the position of the next number, and each call
+ * consumes the numbers it uses. It is what the CPU fillers, Dropout and
+ * WeightedSample draw from, see CPUContext::PhiloxGenerator.
+ */
+class PhiloxGenerator {
+ public:
+  explicit PhiloxGenerator(uint64_t seed, uint64_t offset = 0)
+      : seed_(seed), offset_(offset) {}
+
+  // One Philox4x32-10 block: 4 random numbers for a counter and a key.
+  static inline void
+  Block(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]) {
+    uint32_t c[4][1] = {{counter[0]}, {counter[1]}, {counter[2]}, {counter[3]}};
+    Rounds<1>(c, key[0], key[1]);
+    for (int i = 0; i < 4; ++i) {
+      out[i] = c[i][0];
+    }
+  }
+
+  // The next n 32-bit random numbers.
+  void Generate(size_t n, uint32_t* r) {
+    Fill(offset_, n, r);
+    offset_ += n;
+  }
+
+  // The next n floats, uniform in [a, b).
+  void Uniform(size_t n, float a, float b, float* r) {
+    Convert(n, r, [a, b](uint32_t x) { return a + ToUnit(x) * (b - a); });
+  }
+
+  // The next n floats from the normal distribution, with the Box-Muller
+  // transform. Uses two 32-bit numbers per pair of results.
+  void Gaussian(size_t n, float mean, float stddev, float* r) {
+    uint32_t buffer[kChunk];
+    for (size_t i = 0; i < n; i += kChunk / 2) {
+      const size_t pairs = (std::min<size_t>(n - i, kChunk / 2) + 1) / 2;
+      Generate(pairs * 2, buffer);
+      for (size_t j = 0; j < pairs; ++j) {
+        // (0, 1], for the log.
+        const float u1 = 1.0f - ToUnit(buffer[2 * j]);
+        const float u2 = ToUnit(buffer[2 * j + 1]);
+        const float radius = std::sqrt(-2.0f * std::log(u1));
+        const float theta = 6.2831853071795864f * u2;
+        r[i + 2 * j] = mean + stddev * radius * std::cos(theta);
+        if (i + 2 * j + 1 < n) {
+          r[i + 2 * j + 1] = mean + stddev * radius * std::sin(theta);
+        }
+      }
+    }
+  }
+
+  // The next n booleans, each true with probability p.
+  void Bernoulli(size_t n, float p, bool* r) {
+    Convert(n, r, [p](uint32_t x) { return ToUnit(x) < p; });
+  }
+
+  uint64_t seed() const {
+    return seed_;
+  }
+
+  // Position of the next random number in the stream.
+  uint64_t offset() const {
+    return offset_;
+  }
+
+  void Skip(uint64_t n) {
+    offset_ += n;
+  }
+
+ private:
+  enum : size_t {
+    // Blocks computed together, one per vector lane.
+    kLanes = 8,
+    // Numbers generated at a time before converting them.
+    kChunk = 256,
+  };
+
+  // [0, 1) with the 24 bits a float holds.
+  static inline float ToUnit(uint32_t x) {
+    return (x >> 8) * (1.0f / (1u << 24));
+  }
+
+  template <typename T, typename F>
+  void Convert(size_t n, T* r, F f) {
+    uint32_t buffer[kChunk];
+    for (size_t i = 0; i < n; i += kChunk) {
+      const size_t count = std::min<size_t>(n - i, kChunk);
+      Generate(count, buffer);
+      for (size_t j = 0; j < count; ++j) {
+        r[i + j] = f(buffer[j]);
+      }
+    }
+  }
+
+  template <size_t N>
+  static inline void Rounds(uint32_t c[4][N], uint32_t k0, uint32_t k1) {
+    for (int round = 0; round < 10; ++round) {
+      for (size_t l = 0; l < N; ++l) {
+        const uint64_t p0 = uint64_t(0xD2511F53) * c[0][l];
+        const uint64_t p1 = uint64_t(0xCD9E8D57) * c[2][l];
+        const uint32_t c1 = c[1][l];
+        const uint32_t c3 = c[3][l];
+        c[0][l] = uint32_t(p1 >> 32) ^ c1 ^ k0;
+        c[1][l] = uint32_t(p1);
+        c[2][l] = uint32_t(p0 >> 32) ^ c3 ^ k1;
+        c[3][l] = uint32_t(p0);
+      }
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+    }
+  }
+
+  // Numbers [offset, offset + n) of the stream. Number i is word i % 4 of
+  // the block with counter i / 4.
+  void Fill(uint64_t offset, size_t n, uint32_t* r) const {
+    const uint32_t k0 = uint32_t(seed_);
+    const uint32_t k1 = uint32_t(seed_ >> 32);
+    uint64_t block = offset / 4;
+    size_t skip = offset % 4;
+    size_t done = 0;
+    uint32_t c[4][kLanes];
+    while (done < n) {
+      for (size_t l = 0; l < kLanes; ++l) {
+        c[0][l] = uint32_t(block + l);
+        c[1][l] = uint32_t((block + l) >> 32);
+        c[2][l] = 0;
+        c[3][l] = 0;
+      }
+      Rounds<kLanes>(c, k0, k1);
+      for (size_t l = 0; l < kLanes && done < n; ++l) {
+        for (size_t w = skip; w < 4 && done < n; ++w) {
+          r[done++] = c[w][l];
+        }
+        skip = 0;
+      }
+      block += kLanes;
+    }
+  }
+
+  uint64_t seed_;
+  uint64_t offset_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_UTILS_PHILOX_H_
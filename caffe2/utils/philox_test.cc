@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/utils/philox.h"
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace caffe2 {
+
+TEST(PhiloxTest, KnownAnswers) {
+  // From the known answer tests of the Random123 library.
+  const uint32_t counters[][4] = {
+      {0, 0, 0, 0},
+      {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+      {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+  const uint32_t keys[][2] = {
+      {0, 0}, {0xffffffff, 0xffffffff}, {0xa4093822, 0x299f31d0}};
+  const uint32_t expected[][4] = {
+      {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+      {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+      {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+  for (int i = 0; i < 3; ++i) {
+    uint32_t out[4];
+    PhiloxGenerator::Block(counters[i], keys[i], out);
+    for (int j = 0; j < 4; ++j) {
+      EXPECT_EQ(out[j], expected[i][j]) << i << " " << j;
+    }
+  }
+}
+
+TEST(PhiloxTest, IndependentOfSplit) {
+  PhiloxGenerator whole(1701);
+  std::vector<uint32_t> expected(1000);
+  whole.Generate(expected.size(), expected.data());
+  EXPECT_EQ(whole.offset(), expected.size());
+  // Stream position i is word i % 4 of block i / 4.
+  const uint32_t counter[4] = {1, 0, 0, 0};
+  const uint32_t key[2] = {1701, 0};
+  uint32_t block[4];
+  PhiloxGenerator::Block(counter, key, block);
+  EXPECT_EQ(expected[6], block[2]);
+
+  PhiloxGenerator pieces(1701);
+  std::vector<uint32_t> r(expected.size());
+  size_t done = 0;
+  for (size_t n : {3, 1, 30, 7, 500}) {
+    pieces.Generate(n, r.data() + done);
+    done += n;
+  }
+  // Another generator can take over at any position.
+  PhiloxGenerator rest(1701, done);
+  rest.Generate(r.size() - done, r.data() + done);
+  EXPECT_EQ(r, expected);
+}
+
+TEST(PhiloxTest, Distributions) {
+  PhiloxGenerator gen(42);
+  const int n = 100001;
+  std::vector<float> r(n);
+  gen.Uniform(n, -1, 3, r.data());
+  double sum = 0;
+  for (float v : r) {
+    EXPECT_GE(v, -1);
+    EXPECT_LT(v, 3);
+    sum += v;
+  }
+  EXPECT_NEAR(sum / n, 1, 0.02);
+
+  gen.Gaussian(n, 2, 0.5, r.data());
+  double sum_sq = 0;
+  sum = 0;
+  for (float v : r) {
+    sum += v;
+    sum_sq += (v - 2) * (v - 2);
+  }
+  EXPECT_NEAR(sum / n, 2, 0.01);
+  EXPECT_NEAR(sum_sq / n, 0.25, 0.01);
+
+  std::vector<char> mask(n);
+  gen.Bernoulli(n, 0.3, reinterpret_cast<bool*>(mask.data()));
+  int kept = 0;
+  for (char m : mask) {
+    kept += m;
+  }
+  EXPECT_NEAR(double(kept) / n, 0.3, 0.01);
+}
+
+} // namespace caffe2
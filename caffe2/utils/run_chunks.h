@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_UTILS_RUN_CHUNKS_H_
+#define CAFFE2_UTILS_RUN_CHUNKS_H_
+
+#include <algorithm>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
+namespace caffe2 {
+
+// Elements a chunk needs to have to be worth a thread of the workspace pool.
+constexpr TIndex kMinElementsPerChunk = 1 << 14;
+
+// Number of chunks to split size units, of unit_size elements each, into:
+// at most max_chunks and size, and few enough that every chunk has at least
+// min_elements elements. Always at least 1.
+inline int NumChunks(
+    int max_chunks,
+    TIndex size,
+    TIndex unit_size,
+    TIndex min_elements = kMinElementsPerChunk) {
+  return std::max<TIndex>(
+      1,
+      std::min<TIndex>(
+          std::min<TIndex>(max_chunks, size),
+          size * unit_size / min_elements));
+}
+
+// Splits [0, size) into num_chunks contiguous ranges of about the same
+// length and calls fn(chunk, begin, end) for each of them, on the workspace
+// thread pool when there is more than one.
+template <typename F>
+void RunChunks(Workspace* ws, int num_chunks, TIndex size, const F& fn) {
+  if (num_chunks <= 1) {
+    fn(0, 0, size);
+    return;
+  }
+  ws->GetThreadPool()->runChunks(
+      [&](int /* unused */, size_t chunk) {
+        fn(chunk,
+           size * chunk / num_chunks,
+           size * (chunk + 1) / num_chunks);
+      },
+      num_chunks);
+}
+
+// Same as RunChunks(ws, NumChunks(max_chunks, size, unit_size), size, fn).
+template <typename F>
+void RunChunks(
+    Workspace* ws,
+    int max_chunks,
+    TIndex size,
+    TIndex unit_size,
+    const F& fn) {
+  RunChunks(ws, NumChunks(max_chunks, size, unit_size), size, fn);
+}
+
+// Splits an N x D matrix into at most max_chunks blocks, fewer when a block
+// would be too small to be worth a thread, and calls fn(row_begin, row_end,
+// column_begin, column_end) for each of them, on the workspace thread pool
+// when there is more than one. The blocks are ranges of columns, split at
+// cache lines of floats, so that every thread only touches per-column
+// parameters of its own columns, unless there are too few columns.
+template <typename F>
+void RunColumnChunks(
+    Workspace* ws,
+    int max_chunks,
+    TIndex N,
+    TIndex D,
+    const F& fn) {
+  constexpr TIndex kColumnsPerBlock = 16;
+  const int num_chunks = NumChunks(max_chunks, N * D, 1);
+  const TIndex column_blocks = (D + kColumnsPerBlock - 1) / kColumnsPerBlock;
+  if (column_blocks >= num_chunks) {
+    RunChunks(
+        ws, num_chunks, column_blocks, [&](int, TIndex begin, TIndex end) {
+          fn(0,
+             N,
+             std::min(D, begin * kColumnsPerBlock),
+             std::min(D, end * kColumnsPerBlock));
+        });
+  } else {
+    RunChunks(ws, num_chunks, N, [&](int, TIndex begin, TIndex end) {
+      fn(begin, end, 0, D);
+    });
+  }
+}
+
+} // namespace caffe2
+
+#endif // CAFFE2_UTILS_RUN_CHUNKS_H_
@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mutex>
+#include <vector>
+
+#include "caffe2/utils/run_chunks.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+TEST(RunChunksTest, NumChunks) {
+  EXPECT_EQ(NumChunks(4, 0, 1), 1);
+  EXPECT_EQ(NumChunks(4, 100, 1), 1);
+  EXPECT_EQ(NumChunks(4, 100, kMinElementsPerChunk), 4);
+  EXPECT_EQ(NumChunks(4, 3, kMinElementsPerChunk), 3);
+  EXPECT_EQ(NumChunks(4, 2 * kMinElementsPerChunk, 1), 2);
+  EXPECT_EQ(NumChunks(4, 100, 10, 500), 2);
+}
+
+TEST(RunChunksTest, CoversRangeOnce) {
+  Workspace ws;
+  for (int num_chunks : {1, 2, 3, 7}) {
+    const TIndex size = 100;
+    std::vector<int> visits(size, 0);
+    std::vector<int> chunks(num_chunks, 0);
+    RunChunks(&ws, num_chunks, size, [&](int chunk, TIndex begin, TIndex end) {
+      ++chunks[chunk];
+      for (TIndex i = begin; i < end; ++i) {
+        ++visits[i];
+      }
+    });
+    EXPECT_EQ(chunks, std::vector<int>(num_chunks, 1));
+    EXPECT_EQ(visits, std::vector<int>(size, 1));
+  }
+}
+
+TEST(RunChunksTest, ColumnChunksCoverMatrixOnce) {
+  Workspace ws;
+  // Enough column blocks for the 4 chunks, and too few of them.
+  for (TIndex D : {TIndex(2000), TIndex(20)}) {
+    const TIndex N = 4 * kMinElementsPerChunk / D + 1;
+    std::vector<int> visits(N * D, 0);
+    std::mutex mutex;
+    RunColumnChunks(
+        &ws,
+        4,
+        N,
+        D,
+        [&](TIndex r_begin, TIndex r_end, TIndex c_begin, TIndex c_end) {
+          std::lock_guard<std::mutex> guard(mutex);
+          for (TIndex i = r_begin; i < r_end; ++i) {
+            for (TIndex j = c_begin; j < c_end; ++j) {
+              ++visits[i * D + j];
+            }
+          }
+        });
+    EXPECT_EQ(visits, std::vector<int>(N * D, 1));
+  }
+}
+
+} // namespace caffe2
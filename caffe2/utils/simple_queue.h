@@ -19,7 +19,7 @@
 
 #include <condition_variable>  // NOLINT
 #include <mutex>  // NOLINT
-#include <queue>
+#include <deque>
 
 #include "caffe2/core/logging.h"
 
@@ -48,7 +48,7 @@ class SimpleQueue {
     while (queue_.size() == 0 && !no_more_jobs_) cv_.wait(mutex_lock);
     if (queue_.size() == 0 && no_more_jobs_) return false;
     *value = queue_.front();
-    queue_.pop();
+    queue_.pop_front();
     return true;
   }
 
@@ -62,7 +62,18 @@ class SimpleQueue {
     {
       std::lock_guard<std::mutex> mutex_lock(mutex_);
       CAFFE_ENFORCE(!no_more_jobs_, "Cannot push to a closed queue.");
-      queue_.push(value);
+      queue_.push_back(value);
+    }
+    cv_.notify_one();
+  }
+
+  // PushFront pushes a value to the queue so that it is the next one to be
+  // popped, ahead of the values that are already waiting.
+  void PushFront(const T& value) {
+    {
+      std::lock_guard<std::mutex> mutex_lock(mutex_);
+      CAFFE_ENFORCE(!no_more_jobs_, "Cannot push to a closed queue.");
+      queue_.push_front(value);
     }
     cv_.notify_one();
   }
@@ -84,7 +95,7 @@ class SimpleQueue {
  private:
   std::mutex mutex_;
   std::condition_variable cv_;
-  std::queue<T> queue_;
+  std::deque<T> queue_;
   bool no_more_jobs_;
   // We do not allow copy constructors.
   SimpleQueue(const SimpleQueue& /*src*/) {}
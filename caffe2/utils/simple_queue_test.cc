@@ -75,6 +75,20 @@ TEST(SimpleQueueTest, DoubleProducerDoubleConsumer) {
   consumer1.join();
 }
 
+TEST(SimpleQueueTest, PushFrontIsPoppedFirst) {
+  SimpleQueue<int> queue;
+  queue.Push(0);
+  queue.Push(1);
+  queue.PushFront(2);
+  int value;
+  for (const int expected : {2, 0, 1}) {
+    ASSERT_TRUE(queue.Pop(&value));
+    EXPECT_EQ(value, expected);
+  }
+  queue.NoMoreJobs();
+  EXPECT_FALSE(queue.Pop(&value));
+}
+
 TEST(SimpleQueueDeathTest, CannotAddAfterQueueFinished) {
   gQueue.reset(new SimpleQueue<int>());
   gQueue->Push(0);
@@ -17,26 +17,52 @@
 #ifndef CAFFE2_UTILS_THREAD_POOL_H_
 #define CAFFE2_UTILS_THREAD_POOL_H_
 
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
 #include <queue>
 #include <thread>
 #include <utility>
+#include <vector>
+
+#include "caffe2/core/numa.h"
 
 class TaskThreadPool{
+ public:
+    using clock = std::chrono::steady_clock;
+
  private:
     struct task_element_t {
         bool run_with_id;
-        const std::function< void() > no_id;
-        const std::function< void(std::size_t) > with_id;
+        std::function< void() > no_id;
+        std::function< void(std::size_t) > with_id;
+        int priority = 0;
+        clock::time_point deadline = clock::time_point::max();
+        std::size_t seq = 0;
 
         explicit task_element_t(const std::function< void() >& f) :
             run_with_id(false), no_id(f), with_id(nullptr) { }
         explicit task_element_t(const std::function< void(std::size_t) >& f) :
             run_with_id(true), no_id(nullptr), with_id(f) { }
     };
-    std::queue<task_element_t> tasks_;
+    // Tasks of higher priority run first, then those of earlier deadline,
+    // then in submission order. The comparison tells whether a runs after b.
+    struct task_order_t {
+        bool operator()(
+            const task_element_t& a, const task_element_t& b) const {
+            if (a.priority != b.priority) {
+                return a.priority < b.priority;
+            }
+            if (a.deadline != b.deadline) {
+                return a.deadline > b.deadline;
+            }
+            return a.seq > b.seq;
+        }
+    };
+    std::priority_queue<
+        task_element_t, std::vector<task_element_t>, task_order_t> tasks_;
+    std::size_t next_seq_ = 0;
     std::vector<std::thread> threads_;
     std::mutex mutex_;
     std::condition_variable condition_;
@@ -45,12 +71,15 @@ class TaskThreadPool{
     bool complete_;
     std::size_t available_;
     std::size_t total_;
+    int numa_node_id_;
 
  public:
-    /// @brief Constructor.
-    explicit TaskThreadPool(std::size_t pool_size)
+    /// @brief Constructor. If numa_node_id is not negative, the pool
+    /// threads are bound to that NUMA node.
+    explicit TaskThreadPool(std::size_t pool_size, int numa_node_id = -1)
         :  threads_(pool_size), running_(true), complete_(true),
-           available_(pool_size), total_(pool_size) {
+           available_(pool_size), total_(pool_size),
+           numa_node_id_(numa_node_id) {
         for ( std::size_t i = 0; i < pool_size; ++i ) {
             threads_[i] = std::thread(
                 std::bind(&TaskThreadPool::main_loop, this, i));
@@ -78,25 +107,50 @@ class TaskThreadPool{
     /// @brief Add task to the thread pool if a thread is currently available.
     template <typename Task>
     void runTask(Task task) {
-        std::unique_lock<std::mutex> lock(mutex_);
+        runTaskWithPriority(task, 0);
+    }
 
-        // Set task and signal condition variable so that a worker thread will
-        // wake up and use the task.
-        tasks_.push(task_element_t(static_cast<std::function< void() >>(task)));
-        complete_ = false;
-        condition_.notify_one();
+    /// @brief Add a task that runs before the queued tasks of lower
+    /// priority and, at equal priority, before those of later deadline.
+    /// Tasks added by runTask() have priority 0 and no deadline. A running
+    /// task is never preempted, and lower-priority tasks run whenever no
+    /// higher-priority task is queued.
+    template <typename Task>
+    void runTaskWithPriority(
+        Task task,
+        int priority,
+        clock::time_point deadline = clock::time_point::max()) {
+        task_element_t element(static_cast<std::function< void() >>(task));
+        element.priority = priority;
+        element.deadline = deadline;
+        push(std::move(element));
     }
 
     template <typename Task>
     void runTaskWithID(Task task) {
-      std::unique_lock<std::mutex> lock(mutex_);
-
-      // Set task and signal condition variable so that a worker thread will
-      // wake up and use the task.
-      tasks_.push(task_element_t(static_cast<std::function< void(std::size_t) >>(
-                                   task)));
-      complete_ = false;
-      condition_.notify_one();
+      push(task_element_t(
+          static_cast<std::function< void(std::size_t) >>(task)));
+    }
+
+    /// @brief Whether the calling thread is one of the threads of this pool.
+    bool inThreadPool() const {
+        return current_thread().pool == this;
+    }
+
+    /// @brief Runs the next queued task on the calling thread, which must be
+    /// a thread of this pool, if there is one, and returns whether it did.
+    /// A pool thread that waits for tasks it queued itself calls this rather
+    /// than blocking, since the other pool threads may all be waiting too.
+    bool runOneTask() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (tasks_.empty() || !running_) {
+            return false;
+        }
+        auto task = tasks_.top();
+        tasks_.pop();
+        lock.unlock();
+        run(task, current_thread().index);
+        return true;
     }
 
     /// @brief Wait for queue to be empty
@@ -107,8 +161,50 @@ class TaskThreadPool{
     }
 
  private:
+    void push(task_element_t element) {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        // Set task and signal condition variable so that a worker thread will
+        // wake up and use the task.
+        element.seq = next_seq_++;
+        tasks_.push(std::move(element));
+        complete_ = false;
+        condition_.notify_one();
+    }
+
+    struct current_thread_t {
+        TaskThreadPool* pool;
+        std::size_t index;
+    };
+
+    // The pool the calling thread belongs to, if any, and its index there.
+    static current_thread_t& current_thread() {
+#ifdef __APPLE__
+        // Older iOS toolchains do not support thread_local.
+        static __thread current_thread_t current = {nullptr, 0};
+#else
+        static thread_local current_thread_t current = {nullptr, 0};
+#endif
+        return current;
+    }
+
+    static void run(const task_element_t& task, std::size_t index) {
+        try {
+          if (task.run_with_id) {
+              task.with_id(index);
+          } else {
+              task.no_id();
+          }
+        }
+        // Suppress all exceptions.
+        catch ( const std::exception& ) {}
+    }
+
     /// @brief Entry point for pool threads.
     void main_loop(std::size_t index) {
+        caffe2::NUMABind(numa_node_id_);
+        current_thread().pool = this;
+        current_thread().index = index;
         while (running_) {
             // Wait on condition variable while the task is empty and
             // the pool is still running.
@@ -125,7 +221,7 @@ class TaskThreadPool{
             // useful in the event that the function contains
             // shared_ptr arguments bound via bind.
             {
-                auto tasks = tasks_.front();
+                auto tasks = tasks_.top();
                 tasks_.pop();
                 // Decrement count, indicating thread is no longer available.
                 --available_;
@@ -133,15 +229,7 @@ class TaskThreadPool{
                 lock.unlock();
 
                 // Run the task.
-                try {
-                  if (tasks.run_with_id) {
-                      tasks.with_id(index);
-                  } else {
-                      tasks.no_id();
-                  }
-                }
-                // Suppress all exceptions.
-                catch ( const std::exception& ) {}
+                run(tasks, index);
 
                 // Update status of empty, maybe
                 // Need to recover the lock first
@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include "caffe2/utils/thread_pool.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+TEST(TaskThreadPoolTest, RunsTasksByPriorityAndDeadline) {
+  TaskThreadPool pool(1);
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  // Keeps the only thread busy while the other tasks are queued.
+  pool.runTask([released]() { released.wait(); });
+
+  std::mutex mutex;
+  std::vector<int> order;
+  auto record = [&](int id) {
+    return [&mutex, &order, id]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(id);
+    };
+  };
+  const auto now = TaskThreadPool::clock::now();
+  pool.runTask(record(0));
+  pool.runTaskWithPriority(record(1), 1, now + std::chrono::seconds(2));
+  pool.runTaskWithPriority(record(2), 1, now + std::chrono::seconds(1));
+  pool.runTaskWithPriority(record(3), -1);
+  pool.runTaskWithPriority(record(4), 1, now + std::chrono::seconds(1));
+  pool.runTask(record(5));
+  release.set_value();
+  pool.waitWorkComplete();
+
+  EXPECT_EQ(order, std::vector<int>({2, 4, 1, 0, 5, 3}));
+}
+
+} // namespace caffe2
@@ -18,6 +18,12 @@
 #include "WorkersPool.h"
 #include "caffe2/core/logging.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <string>
+
 #if CAFFE2_ANDROID
 #include <cpu-features.h>
 #endif
@@ -25,16 +31,69 @@
 CAFFE2_DEFINE_bool(caffe2_threadpool_force_inline, false,
                    "Force to always run jobs on the calling thread");
 
+CAFFE2_DEFINE_int(
+    caffe2_threadpool_chunks_per_thread,
+    1,
+    "Number of chunks per thread the range of a job is cut into. Threads "
+    "claim chunks as they finish, so that faster cores do more of the work.");
+
+CAFFE2_DEFINE_int(
+    caffe2_threadpool_spin_nops,
+    caffe2::kMaxBusyWaitNOPs,
+    "Number of no-ops idle threads busy-wait for before they sleep");
+
+CAFFE2_DEFINE_bool(
+    caffe2_threadpool_big_cores_only,
+    false,
+    "On CPUs whose cores differ in maximum frequency, such as big.LITTLE, "
+    "use only the fastest cores and pin the workers to them");
+
 // Whether or not threadpool caps apply to Android
 CAFFE2_DEFINE_int(caffe2_threadpool_android_cap, true, "");
 
 // Whether or not threadpool caps apply to iOS
 CAFFE2_DEFINE_int(caffe2_threadpool_ios_cap, false, "");
 
-#if CAFFE2_THREADPOOL_MOBILE
-
 namespace caffe2 {
 
+namespace {
+
+// The settings of the innermost ThreadPool::ScopedRunOptions of the thread.
+// Older iOS toolchains do not support thread_local, __thread is enough for
+// plain ints.
+#ifdef __APPLE__
+#define CAFFE2_THREADPOOL_TLS __thread
+#else
+#define CAFFE2_THREADPOOL_TLS thread_local
+#endif
+CAFFE2_THREADPOOL_TLS int gChunksPerThread = -1;
+CAFFE2_THREADPOOL_TLS int gSpinNOPs = -1;
+
+} // namespace
+
+ThreadPool::ScopedRunOptions::ScopedRunOptions(const RunOptions& options) {
+  previous_.chunksPerThread = gChunksPerThread;
+  previous_.spinNOPs = gSpinNOPs;
+  if (options.chunksPerThread > 0) {
+    gChunksPerThread = options.chunksPerThread;
+  }
+  if (options.spinNOPs >= 0) {
+    gSpinNOPs = options.spinNOPs;
+  }
+}
+
+ThreadPool::ScopedRunOptions::~ScopedRunOptions() {
+  gChunksPerThread = previous_.chunksPerThread;
+  gSpinNOPs = previous_.spinNOPs;
+}
+
+ThreadPool::RunOptions ThreadPool::currentRunOptions() {
+  RunOptions options;
+  options.chunksPerThread = gChunksPerThread;
+  options.spinNOPs = gSpinNOPs;
+  return options;
+}
+
 // Default smallest amount of work that will be partitioned between
 // multiple threads; the runtime value is configurable
 #if CAFFE2_ANDROID
@@ -43,9 +102,54 @@ constexpr size_t kDefaultMinWorkSize = 8;
 constexpr size_t kDefaultMinWorkSize = 80;
 #endif
 
+namespace {
+
+// Returns the CPUs with the highest maximum frequency, or an empty vector if
+// all CPUs have the same one or it cannot be read.
+std::vector<int> getBigCores() {
+  std::vector<int> bigCores;
+#if defined(__linux__)
+  std::vector<long> maxFreqs;
+  for (int cpu = 0;; ++cpu) {
+    std::ifstream file(
+        "/sys/devices/system/cpu/cpu" + caffe2::to_string(cpu) +
+        "/cpufreq/cpuinfo_max_freq");
+    long freq = 0;
+    if (!(file >> freq)) {
+      break;
+    }
+    maxFreqs.push_back(freq);
+  }
+  if (maxFreqs.empty()) {
+    return bigCores;
+  }
+  const long maxFreq = *std::max_element(maxFreqs.begin(), maxFreqs.end());
+  for (int cpu = 0; cpu < maxFreqs.size(); ++cpu) {
+    if (maxFreqs[cpu] == maxFreq) {
+      bigCores.push_back(cpu);
+    }
+  }
+  if (bigCores.size() == maxFreqs.size()) {
+    bigCores.clear();
+  }
+#endif
+  return bigCores;
+}
+
+} // namespace
+
 std::unique_ptr<ThreadPool> ThreadPool::defaultThreadPool() {
   int numThreads = std::thread::hardware_concurrency();
 
+  if (FLAGS_caffe2_threadpool_big_cores_only) {
+    const auto bigCores = getBigCores();
+    if (!bigCores.empty()) {
+      LOG(INFO) << "Constructing thread pool with " << bigCores.size()
+                << " threads on the big cores";
+      return caffe2::make_unique<ThreadPool>(bigCores.size());
+    }
+  }
+
 #ifdef CAFFE2_ANDROID
   // std::thread::hardware_concurrency returns online cores
   // (sysconf(_SC_NPROCESSORS_ONLN)), but we want the total number of CPUs. In
@@ -62,8 +166,6 @@ std::unique_ptr<ThreadPool> ThreadPool::defaultThreadPool() {
   applyCap = caffe2::FLAGS_caffe2_threadpool_android_cap;
 #elif CAFFE2_IOS
   applyCap = caffe2::FLAGS_caffe2_threadpool_ios_cap;
-#else
-#error Undefined architecture
 #endif
 
   if (applyCap) {
@@ -112,8 +214,15 @@ std::unique_ptr<ThreadPool> ThreadPool::defaultThreadPool() {
 }
 
 ThreadPool::ThreadPool(int numThreads)
-    : minWorkSize_(kDefaultMinWorkSize), numThreads_(numThreads),
-      workersPool_(std::make_shared<WorkersPool>()) {}
+    : minWorkSize_(kDefaultMinWorkSize),
+      numThreads_(numThreads),
+      chunksPerThread_(std::max(FLAGS_caffe2_threadpool_chunks_per_thread, 1)),
+      workersPool_(std::make_shared<WorkersPool>()) {
+  workersPool_->SetMaxBusyWaitNOPs(FLAGS_caffe2_threadpool_spin_nops);
+  if (FLAGS_caffe2_threadpool_big_cores_only) {
+    workersPool_->SetWorkerAffinity(getBigCores());
+  }
+}
 
 ThreadPool::~ThreadPool() {}
 
@@ -130,6 +239,25 @@ void ThreadPool::setMinWorkSize(size_t size) {
   minWorkSize_ = size;
 }
 
+void ThreadPool::setChunksPerThread(size_t chunks) {
+  CAFFE_ENFORCE_GE(chunks, 1);
+  std::lock_guard<std::mutex> guard(executionMutex_);
+  chunksPerThread_ = chunks;
+}
+
+size_t ThreadPool::getChunksPerThread() const {
+  std::lock_guard<std::mutex> guard(executionMutex_);
+  return chunksPerThread_;
+}
+
+void ThreadPool::setSpinNOPs(int nops) {
+  workersPool_->SetMaxBusyWaitNOPs(nops);
+}
+
+int ThreadPool::getSpinNOPs() const {
+  return workersPool_->GetMaxBusyWaitNOPs();
+}
+
 void ThreadPool::run(const std::function<void(int, size_t)>& fn, size_t range) {
   std::lock_guard<std::mutex> guard(executionMutex_);
   // If there are no worker threads, or if the range is too small (too
@@ -145,45 +273,93 @@ void ThreadPool::run(const std::function<void(int, size_t)>& fn, size_t range) {
     }
     return;
   }
+  runOnWorkers(fn, range);
+}
+
+void ThreadPool::runChunks(
+    const std::function<void(int, size_t)>& fn,
+    size_t range) {
+  std::lock_guard<std::mutex> guard(executionMutex_);
+  if (range == 0) {
+    return;
+  }
+  if (FLAGS_caffe2_threadpool_force_inline || numThreads_ == 0) {
+    for (size_t i = 0; i < range; ++i) {
+      fn(0, i);
+    }
+    return;
+  }
+  // An exception escaping a worker thread would terminate the process, so
+  // they are caught per chunk and the first one is rethrown here.
+  std::vector<std::exception_ptr> errors(range);
+  runOnWorkers(
+      [&](int threadId, size_t i) {
+        try {
+          fn(threadId, i);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      },
+      range);
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
 
+// Requires executionMutex_ to be held.
+void ThreadPool::runOnWorkers(
+    const std::function<void(int, size_t)>& fn,
+    size_t range) {
+  // Each task claims chunks of grain_ units from the shared counter until
+  // the range is exhausted, so that a task that runs on a slow core or
+  // starts late does less of the work.
   struct FnTask : public Task {
     FnTask(){};
     virtual ~FnTask(){};
     const std::function<void(int, size_t)> *fn_;
     int idx_;
-    size_t start_;
-    size_t end_;
+    std::atomic<size_t>* next_;
+    size_t grain_;
+    size_t range_;
     virtual void Run() override {
-      for (auto i = start_; i < end_; ++i) {
-        (*fn_)(idx_, i);
+      while (true) {
+        const size_t start =
+            next_->fetch_add(grain_, std::memory_order_relaxed);
+        if (start >= range_) {
+          break;
+        }
+        const size_t end = std::min(range_, start + grain_);
+        for (auto i = start; i < end; ++i) {
+          (*fn_)(idx_, i);
+        }
       }
     }
   };
 
   CAFFE_ENFORCE_GE(numThreads_, 1);
-  const size_t unitsPerTask = (range + numThreads_ - 1) / numThreads_;
-  tasks_.resize(numThreads_);
-  for (size_t i = 0; i < numThreads_; ++i) {
+  const size_t chunksPerThread =
+      gChunksPerThread > 0 ? gChunksPerThread : chunksPerThread_;
+  const size_t numChunks = numThreads_ * chunksPerThread;
+  const size_t grain = std::max<size_t>((range + numChunks - 1) / numChunks, 1);
+  const size_t numTasks =
+      std::min<size_t>(numThreads_, (range + grain - 1) / grain);
+  CAFFE_ENFORCE_GE(numTasks, 1);
+  std::atomic<size_t> next(0);
+  tasks_.resize(numTasks);
+  for (size_t i = 0; i < numTasks; ++i) {
     if (!tasks_[i]) {
       tasks_[i].reset(new FnTask());
     }
     auto *task = (FnTask *)tasks_[i].get();
     task->fn_ = &fn;
     task->idx_ = i;
-    task->start_ = std::min<size_t>(range, i * unitsPerTask);
-    task->end_ = std::min<size_t>(range, (i + 1) * unitsPerTask);
-    if (task->start_ >= task->end_) {
-      tasks_.resize(i);
-      break;
-    }
-    CAFFE_ENFORCE_LE(task->start_, range);
-    CAFFE_ENFORCE_LE(task->end_, range);
+    task->next_ = &next;
+    task->grain_ = grain;
+    task->range_ = range;
   }
-  CAFFE_ENFORCE_LE(tasks_.size(), numThreads_);
-  CAFFE_ENFORCE_GE(tasks_.size(), 1);
-  workersPool_->Execute(tasks_);
+  workersPool_->Execute(tasks_, gSpinNOPs);
 }
 
 } // namespace caffe2
-
-#endif // CAFFE2_THREADPOOL_MOBILE
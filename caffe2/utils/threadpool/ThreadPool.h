@@ -23,9 +23,7 @@
 #error "mobile build state not defined"
 #endif
 
-// ThreadPool only used in mobile builds at the moment
-#if CAFFE2_THREADPOOL_MOBILE
-
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -57,17 +55,57 @@ class alignas(kCacheLineSize) ThreadPool {
   void setMinWorkSize(size_t size);
   size_t getMinWorkSize() const { return minWorkSize_; }
   void run(const std::function<void(int, size_t)>& fn, size_t range);
+  // Like run(), but always spreads the range over the pool threads, however
+  // small it is. Meant for callers that already split their work into a few
+  // coarse chunks, such as one per thread. An exception thrown by fn is
+  // rethrown on the calling thread once all chunks are done.
+  void runChunks(const std::function<void(int, size_t)>& fn, size_t range);
+
+  // Settings of the run() and runChunks() calls of a thread, which override
+  // the ones of the pool; -1 keeps the setting of the pool.
+  struct RunOptions {
+    int chunksPerThread = -1;
+    int spinNOPs = -1;
+  };
+  // Applies options to the run() and runChunks() calls the calling thread
+  // makes while the scope lives, on any pool, e.g. for the operators of a net
+  // with settings of its own. Scopes nest; the settings of an inner scope
+  // that are -1 are the ones of the outer scope.
+  class ScopedRunOptions {
+   public:
+    explicit ScopedRunOptions(const RunOptions& options);
+    ~ScopedRunOptions();
+
+   private:
+    RunOptions previous_;
+  };
+  // The options of the innermost scope of the calling thread.
+  static RunOptions currentRunOptions();
+
+  // Sets how many chunks per thread run() and runChunks() cut the range
+  // into. The threads claim chunks from a shared counter until none are
+  // left, so with more than one chunk per thread, the threads on fast cores
+  // (such as the big cores of a big.LITTLE CPU) take over the work of the
+  // slow ones instead of waiting for them.
+  void setChunksPerThread(size_t chunks);
+  size_t getChunksPerThread() const;
+  // Sets how many no-ops the workers and the calling thread busy-wait for
+  // before they sleep. Spinning longer lets back-to-back runs start sooner,
+  // at the cost of power.
+  void setSpinNOPs(int nops);
+  int getSpinNOPs() const;
 
 private:
+  void runOnWorkers(const std::function<void(int, size_t)>& fn, size_t range);
+
   mutable std::mutex executionMutex_;
   size_t minWorkSize_;
   size_t numThreads_;
+  size_t chunksPerThread_;
   std::shared_ptr<WorkersPool> workersPool_;
   std::vector<std::shared_ptr<Task>> tasks_;
 };
 
 } // namespace caffe2
 
-#endif // CAFFE2_THREADPOOL_MOBILE
-
 #endif // CAFFE2_UTILS_THREADPOOL_H_
@@ -19,6 +19,11 @@
 #include <atomic>
 #include <thread>
 #include <condition_variable>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 #if defined(_MSC_VER)
 #include <intrin.h>
@@ -125,7 +130,7 @@ inline int Do256NOPs() {
 // still the value of *var when this function returns, since *var is
 // not assumed to be guarded by any lock.
 //
-// First does some busy-waiting for a fixed number of no-op cycles,
+// First does some busy-waiting for max_busy_wait_nops no-op cycles,
 // then falls back to passive waiting for the given condvar, guarded
 // by the given mutex.
 //
@@ -142,7 +147,8 @@ template <typename T>
 T WaitForVariableChange(std::atomic<T>* var,
                         T initial_value,
                         std::condition_variable* cond,
-                        std::mutex* mutex) {
+                        std::mutex* mutex,
+                        int max_busy_wait_nops = kMaxBusyWaitNOPs) {
   // If we are on a platform that supports it, spin for some time.
   {
     int nops = 0;
@@ -153,7 +159,7 @@ T WaitForVariableChange(std::atomic<T>* var,
       return new_value;
     }
     // Then try busy-waiting.
-    while (nops < kMaxBusyWaitNOPs) {
+    while (nops < max_busy_wait_nops) {
       nops += Do256NOPs();
       new_value = var->load(std::memory_order_relaxed);
       if (new_value != initial_value) {
@@ -207,9 +213,10 @@ class BlockingCounter {
 
   // Waits for the N other threads (N having been set by Reset())
   // to hit the BlockingCounter.
-  void Wait() {
+  void Wait(int max_busy_wait_nops = kMaxBusyWaitNOPs) {
     while (size_t count_value = count_.load(std::memory_order_relaxed)) {
-      WaitForVariableChange(&count_, count_value, &cond_, &mutex_);
+      WaitForVariableChange(
+          &count_, count_value, &cond_, &mutex_, max_busy_wait_nops);
     }
   }
 
@@ -219,6 +226,24 @@ class BlockingCounter {
   std::atomic<std::size_t> count_{0};
 };
 
+// Pins the calling thread to the given CPUs. Does nothing if cpus is empty or
+// the platform does not support thread affinity.
+inline void SetCurrentThreadAffinity(const std::vector<int>& cpus) {
+#if defined(__linux__)
+  if (cpus.empty()) {
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    VLOG(1) << "Could not set the affinity of a worker thread";
+  }
+#endif
+}
+
 // A workload for a worker.
 struct Task {
   Task() {}
@@ -236,10 +261,15 @@ class alignas(kGEMMLOWPCacheLineSize) Worker {
     ExitAsSoonAsPossible // Should exit at earliest convenience.
   };
 
-  explicit Worker(BlockingCounter* counter_to_decrement_when_ready)
+  Worker(
+      BlockingCounter* counter_to_decrement_when_ready,
+      const std::atomic<int>* max_busy_wait_nops,
+      const std::vector<int>& cpus)
       : task_(nullptr),
         state_(State::ThreadStartup),
-        counter_to_decrement_when_ready_(counter_to_decrement_when_ready) {
+        counter_to_decrement_when_ready_(counter_to_decrement_when_ready),
+        max_busy_wait_nops_(max_busy_wait_nops),
+        cpus_(cpus) {
     thread_ = caffe2::make_unique<std::thread>([this]() { this->ThreadFunc(); });
   }
 
@@ -276,6 +306,7 @@ class alignas(kGEMMLOWPCacheLineSize) Worker {
 
   // Thread entry point.
   void ThreadFunc() {
+    SetCurrentThreadAffinity(cpus_);
     ChangeState(State::Ready);
 
     // Thread main loop
@@ -283,8 +314,14 @@ class alignas(kGEMMLOWPCacheLineSize) Worker {
       // Get a state to act on
       // In the 'Ready' state, we have nothing to do but to wait until
       // we switch to another state.
-      State state_to_act_upon =
-          WaitForVariableChange(&state_, State::Ready, &state_cond_, &state_mutex_);
+      State state_to_act_upon = WaitForVariableChange(
+          &state_,
+          State::Ready,
+          &state_cond_,
+          &state_mutex_,
+          busy_wait_nops_ >= 0
+              ? busy_wait_nops_
+              : max_busy_wait_nops_->load(std::memory_order_relaxed));
 
       // We now have a state to act on, so act.
       switch (state_to_act_upon) {
@@ -310,9 +347,13 @@ class alignas(kGEMMLOWPCacheLineSize) Worker {
 
   // Called by the master thead to give this worker work to do.
   // It is only legal to call this if the worker
-  void StartWork(Task* task) {
+  //
+  // Once done, the worker busy-waits for max_busy_wait_nops before it sleeps,
+  // or for the setting of the pool if it is negative.
+  void StartWork(Task* task, int max_busy_wait_nops = -1) {
     DCHECK(!task_);
     task_ = task;
+    busy_wait_nops_ = max_busy_wait_nops;
     DCHECK(state_.load(std::memory_order_acquire) == State::Ready);
     ChangeState(State::HasWork);
   }
@@ -335,13 +376,43 @@ class alignas(kGEMMLOWPCacheLineSize) Worker {
   // pointer to the master's thread BlockingCounter object, to notify the
   // master thread of when this worker switches to the 'Ready' state.
   BlockingCounter* const counter_to_decrement_when_ready_;
+
+  // How long to spin for new work before sleeping, owned by the pool.
+  const std::atomic<int>* const max_busy_wait_nops_;
+  // The same for the run of the current task, if not negative. Visibility of
+  // writes guarded by state_mutex_, as for task_.
+  int busy_wait_nops_ = -1;
+
+  // The CPUs the thread is pinned to, or empty if it is not pinned.
+  const std::vector<int> cpus_;
 };
 
 class WorkersPool {
  public:
   WorkersPool() {}
 
-  void Execute(const std::vector<std::shared_ptr<Task>>& tasks) {
+  // Sets how many no-ops idle workers and the master thread busy-wait for
+  // before they sleep. Takes effect from the next wait on.
+  void SetMaxBusyWaitNOPs(int nops) {
+    max_busy_wait_nops_.store(nops, std::memory_order_relaxed);
+  }
+
+  int GetMaxBusyWaitNOPs() const {
+    return max_busy_wait_nops_.load(std::memory_order_relaxed);
+  }
+
+  // Sets the CPUs that workers created from now on are pinned to. Must be
+  // called before the first Execute() to apply to all workers.
+  void SetWorkerAffinity(const std::vector<int>& cpus) {
+    cpus_ = cpus;
+  }
+
+  // Runs the tasks, one of them on the calling thread. The calling thread and
+  // the workers busy-wait for max_busy_wait_nops, if not negative, instead of
+  // the setting of the pool, until the next call.
+  void Execute(
+      const std::vector<std::shared_ptr<Task>>& tasks,
+      int max_busy_wait_nops = -1) {
     CAFFE_ENFORCE_GE(tasks.size(), 1);
     // One of the tasks will be run on the current thread.
     int workers_count = tasks.size() - 1;
@@ -349,13 +420,14 @@ class WorkersPool {
     DCHECK_LE(workers_count, workers_.size());
     counter_to_decrement_when_ready_.Reset(workers_count);
     for (auto task = 1; task < tasks.size(); ++task) {
-      workers_[task - 1]->StartWork(tasks[task].get());
+      workers_[task - 1]->StartWork(tasks[task].get(), max_busy_wait_nops);
     }
     // Execute the remaining workload immediately on the current thread.
     auto& task = tasks.front();
     task->Run();
     // Wait for the workers submitted above to finish.
-    counter_to_decrement_when_ready_.Wait();
+    counter_to_decrement_when_ready_.Wait(
+        max_busy_wait_nops >= 0 ? max_busy_wait_nops : GetMaxBusyWaitNOPs());
   }
 
  private:
@@ -368,12 +440,16 @@ class WorkersPool {
     }
     counter_to_decrement_when_ready_.Reset(workers_count - workers_.size());
     while (workers_.size() < workers_count) {
-      workers_.push_back(MakeAligned<Worker>::make(&counter_to_decrement_when_ready_));
+      workers_.push_back(MakeAligned<Worker>::make(
+          &counter_to_decrement_when_ready_, &max_busy_wait_nops_, cpus_));
     }
     counter_to_decrement_when_ready_.Wait();
   }
 
   DISABLE_COPY_AND_ASSIGN(WorkersPool);
+  // Declared before the workers, which refer to it until they exit.
+  std::atomic<int> max_busy_wait_nops_{kMaxBusyWaitNOPs};
+  std::vector<int> cpus_;
   std::vector<std::unique_ptr<Worker, AlignedDeleter<Worker>>> workers_;
   // The BlockingCounter used to wait for the workers.
   BlockingCounter counter_to_decrement_when_ready_;
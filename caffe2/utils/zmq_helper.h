@@ -19,6 +19,8 @@
 
 #include <zmq.h>
 
+#include <utility>
+
 #include "caffe2/core/logging.h"
 
 namespace caffe2 {
@@ -52,6 +54,25 @@ class ZmqMessage {
     CAFFE_ENFORCE_EQ(rc, 0);
   }
 
+  // A message over data that zmq does not copy. free_fn(data, hint) is
+  // called once zmq is done with it.
+  ZmqMessage(void* data, size_t size, zmq_free_fn* free_fn, void* hint) {
+    int rc = zmq_msg_init_data(&msg_, data, size, free_fn, hint);
+    CAFFE_ENFORCE_EQ(rc, 0);
+  }
+
+  // Takes over the data of str, so that sending it does not copy it.
+  explicit ZmqMessage(string&& str) {
+    auto* owned = new string(std::move(str));
+    int rc = zmq_msg_init_data(
+        &msg_,
+        &(*owned)[0],
+        owned->size(),
+        [](void* /* data */, void* hint) { delete static_cast<string*>(hint); },
+        owned);
+    CAFFE_ENFORCE_EQ(rc, 0);
+  }
+
   ~ZmqMessage() {
     int rc = zmq_msg_close(&msg_);
     CAFFE_ENFORCE_EQ(rc, 0);
@@ -99,6 +120,11 @@ class ZmqSocket {
     CAFFE_ENFORCE_EQ(rc, 0);
   }
 
+  void SetOption(int option, int value) {
+    int rc = zmq_setsockopt(ptr_, option, &value, sizeof(value));
+    CAFFE_ENFORCE_EQ(rc, 0);
+  }
+
   int Send(const string& msg, int flags) {
     int nbytes = zmq_send(ptr_, msg.c_str(), msg.size(), flags);
     if (nbytes) {
@@ -121,24 +147,50 @@ class ZmqSocket {
     return nbytes;
   }
 
+  // Sends the message without copying its data, after which the message
+  // is empty. Unlike the string version, returns -1 when the message could
+  // not be sent yet, so that empty messages can be told apart.
+  int Send(ZmqMessage* msg, int flags) {
+    int nbytes = zmq_msg_send(msg->msg(), ptr_, flags);
+    if (nbytes >= 0) {
+      return nbytes;
+    } else if (zmq_errno() == EAGAIN || zmq_errno() == EINTR) {
+      return -1;
+    } else {
+      LOG(FATAL) << "Cannot send zmq message. Error number: "
+                      << zmq_errno();
+      return -1;
+    }
+  }
+
+  int SendTillSuccess(ZmqMessage* msg, int flags) {
+    int nbytes = -1;
+    do {
+      nbytes = Send(msg, flags);
+    } while (nbytes < 0);
+    return nbytes;
+  }
+
+  // Returns the size of the received message, or -1 if none was received,
+  // e.g. because the receive timeout of the socket expired.
   int Recv(ZmqMessage* msg) {
     int nbytes = zmq_msg_recv(msg->msg(), ptr_, 0);
     if (nbytes >= 0) {
       return nbytes;
     } else if (zmq_errno() == EAGAIN || zmq_errno() == EINTR) {
-      return 0;
+      return -1;
     } else {
       LOG(FATAL) << "Cannot receive zmq message. Error number: "
                       << zmq_errno();
-      return 0;
+      return -1;
     }
   }
 
   int RecvTillSuccess(ZmqMessage* msg) {
-    int nbytes = 0;
+    int nbytes = -1;
     do {
       nbytes = Recv(msg);
-    } while (nbytes == 0);
+    } while (nbytes < 0);
     return nbytes;
   }
 
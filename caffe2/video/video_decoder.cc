@@ -18,6 +18,7 @@
 #include "caffe2/core/logging.h"
 
 #include <stdio.h>
+#include <algorithm>
 #include <mutex>
 #include <random>
 
@@ -52,131 +53,25 @@ void VideoDecoder::decodeLoop(
     bool decodeFromStart) {
   AVPixelFormat pixFormat = params.pixelFormat_;
 
-  AVFormatContext* inputContext = avformat_alloc_context();
-  AVStream* videoStream_ = nullptr;
-  AVCodecContext* videoCodecContext_ = nullptr;
+  StreamState state;
   AVFrame* videoStreamFrame_ = nullptr;
   AVPacket packet;
   av_init_packet(&packet); // init packet
-  SwsContext* scaleContext_ = nullptr;
   /* if a valid value is given for maxFrames, then decode only limited frames.
    * Else decode all the frames */
   bool mustDecodeAll = (maxFrames <= 0);
   try {
-    inputContext->pb = ioctx.get_avio();
-    inputContext->flags |= AVFMT_FLAG_CUSTOM_IO;
-    int ret = 0;
-
-    // Determining the input format:
-    int probeSz = 32 * 1024 + AVPROBE_PADDING_SIZE;
-    DecodedFrame::AvDataPtr probe((uint8_t*)av_malloc(probeSz));
-
-    memset(probe.get(), 0, probeSz);
-    int len = ioctx.read(probe.get(), probeSz - AVPROBE_PADDING_SIZE);
-    if (len < probeSz - AVPROBE_PADDING_SIZE) {
-      LOG(ERROR) << "Insufficient data to determine video format";
-      return;
-    }
-
-    // seek back to start of stream
-    ioctx.seek(0, SEEK_SET);
-
-    unique_ptr<AVProbeData> probeData(new AVProbeData());
-    probeData->buf = probe.get();
-    probeData->buf_size = len;
-    probeData->filename = "";
-    // Determine the input-format:
-    inputContext->iformat = av_probe_input_format(probeData.get(), 1);
-
-    ret = avformat_open_input(&inputContext, "", nullptr, nullptr);
-    if (ret < 0) {
-      LOG(ERROR) << "Unable to open stream " << ffmpegErrorStr(ret);
-      return;
-    }
-
-    ret = avformat_find_stream_info(inputContext, nullptr);
-    if (ret < 0) {
-      LOG(ERROR) << "Unable to find stream info in " << videoName << " "
-                 << ffmpegErrorStr(ret);
-      return;
-    }
-
-    // Decode the first video stream
-    int videoStreamIndex_ = params.streamIndex_;
-    if (videoStreamIndex_ == -1) {
-      for (int i = 0; i < inputContext->nb_streams; i++) {
-        auto stream = inputContext->streams[i];
-        if (stream->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-          videoStreamIndex_ = i;
-          videoStream_ = stream;
-          break;
-        }
-      }
-    }
-
-    if (videoStream_ == nullptr) {
-      LOG(ERROR) << "Unable to find video stream in " << videoName << " "
-                 << ffmpegErrorStr(ret);
-      return;
-    }
-
-    // Initialize codec
-    videoCodecContext_ = videoStream_->codec;
-
-    ret = avcodec_open2(
-        videoCodecContext_,
-        avcodec_find_decoder(videoCodecContext_->codec_id),
-        nullptr);
-    if (ret < 0) {
-      LOG(ERROR) << "Cannot open video codec : "
-                 << videoCodecContext_->codec->name;
+    if (!openStream(videoName, ioctx, params, &state)) {
+      closeStream(&state);
       return;
     }
-
-    // Calcuate if we need to rescale the frames
-    int outWidth = videoCodecContext_->width;
-    int outHeight = videoCodecContext_->height;
-
-    if (params.maxOutputDimension_ != -1) {
-      if (videoCodecContext_->width > videoCodecContext_->height) {
-        // dominant width
-        if (params.maxOutputDimension_ < videoCodecContext_->width) {
-          float ratio =
-              (float)params.maxOutputDimension_ / videoCodecContext_->width;
-          outWidth = params.maxOutputDimension_;
-          outHeight = (int)round(videoCodecContext_->height * ratio);
-        }
-      } else {
-        // dominant height
-        if (params.maxOutputDimension_ < videoCodecContext_->height) {
-          float ratio =
-              (float)params.maxOutputDimension_ / videoCodecContext_->height;
-          outWidth = (int)round(videoCodecContext_->width * ratio);
-          outHeight = params.maxOutputDimension_;
-        }
-      }
-    } else {
-      outWidth = params.outputWidth_ == -1 ? videoCodecContext_->width
-                                           : params.outputWidth_;
-      outHeight = params.outputHeight_ == -1 ? videoCodecContext_->height
-                                             : params.outputHeight_;
-    }
-
-    // Make sure that we have a valid format
-    CAFFE_ENFORCE_NE(videoCodecContext_->pix_fmt, AV_PIX_FMT_NONE);
-
-    // Create a scale context
-    scaleContext_ = sws_getContext(
-        videoCodecContext_->width,
-        videoCodecContext_->height,
-        videoCodecContext_->pix_fmt,
-        outWidth,
-        outHeight,
-        pixFormat,
-        SWS_FAST_BILINEAR,
-        nullptr,
-        nullptr,
-        nullptr);
+    AVFormatContext* inputContext = state.inputContext;
+    AVStream* videoStream_ = state.videoStream;
+    int videoStreamIndex_ = state.videoStreamIndex;
+    AVCodecContext* videoCodecContext_ = state.codecContext;
+    int outWidth = state.outWidth;
+    int outHeight = state.outHeight;
+    int ret = 0;
 
     // Getting video meta data
     VideoMeta videoMeta;
@@ -389,47 +284,14 @@ void VideoDecoder::decodeLoop(
               break;
             }
 
-            AVFrame* rgbFrame = av_frame_alloc();
-            if (!rgbFrame) {
-              LOG(ERROR) << "Error allocating AVframe";
-            }
-
-            try {
-              // Determine required buffer size and allocate buffer
-              int numBytes = avpicture_get_size(pixFormat, outWidth, outHeight);
-              DecodedFrame::AvDataPtr buffer(
-                  (uint8_t*)av_malloc(numBytes * sizeof(uint8_t)));
-
-              int size = avpicture_fill(
-                  (AVPicture*)rgbFrame,
-                  buffer.get(),
-                  pixFormat,
-                  outWidth,
-                  outHeight);
-
-              sws_scale(
-                  scaleContext_,
-                  videoStreamFrame_->data,
-                  videoStreamFrame_->linesize,
-                  0,
-                  videoCodecContext_->height,
-                  rgbFrame->data,
-                  rgbFrame->linesize);
-
-              unique_ptr<DecodedFrame> frame = make_unique<DecodedFrame>();
-              frame->width_ = outWidth;
-              frame->height_ = outHeight;
-              frame->data_ = move(buffer);
-              frame->size_ = size;
+            unique_ptr<DecodedFrame> frame =
+                convertFrame(state, params, videoStreamFrame_);
+            if (frame) {
               frame->index_ = frameIndex;
               frame->outputFrameIndex_ = outputFrameIndex;
               frame->timestamp_ = timestamp;
-              frame->keyFrame_ = videoStreamFrame_->key_frame;
               sampledFrames.push_back(move(frame));
               selectiveDecodedFrames++;
-              av_frame_free(&rgbFrame);
-            } catch (const std::exception&) {
-              av_frame_free(&rgbFrame);
             }
           }
           av_frame_unref(videoStreamFrame_);
@@ -444,22 +306,378 @@ void VideoDecoder::decodeLoop(
     } // of while loop
 
     // free all stuffs
-    sws_freeContext(scaleContext_);
     av_packet_unref(&packet);
     av_frame_free(&videoStreamFrame_);
-    avcodec_close(videoCodecContext_);
-    avformat_close_input(&inputContext);
-    avformat_free_context(inputContext);
+    closeStream(&state);
   } catch (const std::exception&) {
     // In case of decoding error
     // free all stuffs
-    sws_freeContext(scaleContext_);
     av_packet_unref(&packet);
     av_frame_free(&videoStreamFrame_);
-    avcodec_close(videoCodecContext_);
-    avformat_close_input(&inputContext);
-    avformat_free_context(inputContext);
+    closeStream(&state);
+  }
+}
+
+bool VideoDecoder::openStream(
+    const string& videoName,
+    VideoIOContext& ioctx,
+    const Params& params,
+    StreamState* state) {
+  state->inputContext = avformat_alloc_context();
+  AVFormatContext* inputContext = state->inputContext;
+  inputContext->pb = ioctx.get_avio();
+  inputContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+  int ret = 0;
+
+  // Determining the input format:
+  int probeSz = 32 * 1024 + AVPROBE_PADDING_SIZE;
+  DecodedFrame::AvDataPtr probe((uint8_t*)av_malloc(probeSz));
+
+  memset(probe.get(), 0, probeSz);
+  int len = ioctx.read(probe.get(), probeSz - AVPROBE_PADDING_SIZE);
+  if (len < probeSz - AVPROBE_PADDING_SIZE) {
+    LOG(ERROR) << "Insufficient data to determine video format";
+    return false;
+  }
+
+  // seek back to start of stream
+  ioctx.seek(0, SEEK_SET);
+
+  unique_ptr<AVProbeData> probeData(new AVProbeData());
+  probeData->buf = probe.get();
+  probeData->buf_size = len;
+  probeData->filename = "";
+  // Determine the input-format:
+  inputContext->iformat = av_probe_input_format(probeData.get(), 1);
+
+  // avformat_open_input frees the context on failure
+  ret = avformat_open_input(&state->inputContext, "", nullptr, nullptr);
+  inputContext = state->inputContext;
+  if (ret < 0) {
+    LOG(ERROR) << "Unable to open stream " << ffmpegErrorStr(ret);
+    return false;
+  }
+
+  ret = avformat_find_stream_info(inputContext, nullptr);
+  if (ret < 0) {
+    LOG(ERROR) << "Unable to find stream info in " << videoName << " "
+               << ffmpegErrorStr(ret);
+    return false;
   }
+
+  // Decode the first video stream
+  state->videoStreamIndex = params.streamIndex_;
+  if (state->videoStreamIndex == -1) {
+    for (int i = 0; i < inputContext->nb_streams; i++) {
+      auto stream = inputContext->streams[i];
+      if (stream->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
+        state->videoStreamIndex = i;
+        state->videoStream = stream;
+        break;
+      }
+    }
+  } else if (state->videoStreamIndex < inputContext->nb_streams) {
+    state->videoStream = inputContext->streams[state->videoStreamIndex];
+  }
+
+  if (state->videoStream == nullptr) {
+    LOG(ERROR) << "Unable to find video stream in " << videoName << " "
+               << ffmpegErrorStr(ret);
+    return false;
+  }
+
+  // Initialize codec
+  AVCodecContext* videoCodecContext_ = state->videoStream->codec;
+
+  ret = avcodec_open2(
+      videoCodecContext_,
+      avcodec_find_decoder(videoCodecContext_->codec_id),
+      nullptr);
+  if (ret < 0) {
+    LOG(ERROR) << "Cannot open video codec : "
+               << videoCodecContext_->codec->name;
+    return false;
+  }
+  state->codecContext = videoCodecContext_;
+
+  // Calcuate if we need to rescale the frames
+  int outWidth = videoCodecContext_->width;
+  int outHeight = videoCodecContext_->height;
+
+  if (params.maxOutputDimension_ != -1) {
+    if (videoCodecContext_->width > videoCodecContext_->height) {
+      // dominant width
+      if (params.maxOutputDimension_ < videoCodecContext_->width) {
+        float ratio =
+            (float)params.maxOutputDimension_ / videoCodecContext_->width;
+        outWidth = params.maxOutputDimension_;
+        outHeight = (int)round(videoCodecContext_->height * ratio);
+      }
+    } else {
+      // dominant height
+      if (params.maxOutputDimension_ < videoCodecContext_->height) {
+        float ratio =
+            (float)params.maxOutputDimension_ / videoCodecContext_->height;
+        outWidth = (int)round(videoCodecContext_->width * ratio);
+        outHeight = params.maxOutputDimension_;
+      }
+    }
+  } else {
+    outWidth = params.outputWidth_ == -1 ? videoCodecContext_->width
+                                         : params.outputWidth_;
+    outHeight = params.outputHeight_ == -1 ? videoCodecContext_->height
+                                           : params.outputHeight_;
+  }
+
+  // Make sure that we have a valid format
+  CAFFE_ENFORCE_NE(videoCodecContext_->pix_fmt, AV_PIX_FMT_NONE);
+
+  // Create a scale context
+  state->scaleContext = sws_getContext(
+      videoCodecContext_->width,
+      videoCodecContext_->height,
+      videoCodecContext_->pix_fmt,
+      outWidth,
+      outHeight,
+      params.pixelFormat_,
+      SWS_FAST_BILINEAR,
+      nullptr,
+      nullptr,
+      nullptr);
+  state->outWidth = outWidth;
+  state->outHeight = outHeight;
+  state->eof = false;
+  return true;
+}
+
+void VideoDecoder::closeStream(StreamState* state) {
+  sws_freeContext(state->scaleContext);
+  state->scaleContext = nullptr;
+  if (state->codecContext) {
+    avcodec_close(state->codecContext);
+    state->codecContext = nullptr;
+  }
+  avformat_close_input(&state->inputContext);
+  avformat_free_context(state->inputContext);
+  state->inputContext = nullptr;
+  state->videoStream = nullptr;
+}
+
+bool VideoDecoder::decodeNextFrame(StreamState* state, AVFrame* frame) {
+  AVPacket packet;
+  while (true) {
+    av_init_packet(&packet);
+    // An empty packet drains the frames buffered in the decoder after EOF
+    packet.data = nullptr;
+    packet.size = 0;
+    if (!state->eof) {
+      int ret = av_read_frame(state->inputContext, &packet);
+      if (ret == AVERROR(EAGAIN)) {
+        av_free_packet(&packet);
+        continue;
+      }
+      // Interpret any other error as EOF
+      if (ret < 0) {
+        state->eof = true;
+        av_free_packet(&packet);
+        packet.data = nullptr;
+        packet.size = 0;
+      } else if (packet.stream_index != state->videoStreamIndex) {
+        // Ignore packets from other streams
+        av_free_packet(&packet);
+        continue;
+      }
+    }
+
+    int gotPicture = 0;
+    int ret = avcodec_decode_video2(
+        state->codecContext, frame, &gotPicture, &packet);
+    av_free_packet(&packet);
+    if (ret < 0) {
+      LOG(ERROR) << "Error decoding video frame : " << ffmpegErrorStr(ret);
+    }
+    if (gotPicture) {
+      return true;
+    }
+    if (state->eof) {
+      return false;
+    }
+  }
+}
+
+unique_ptr<DecodedFrame> VideoDecoder::convertFrame(
+    const StreamState& state,
+    const Params& params,
+    AVFrame* videoStreamFrame) {
+  AVPixelFormat pixFormat = params.pixelFormat_;
+  AVFrame* rgbFrame = av_frame_alloc();
+  if (!rgbFrame) {
+    LOG(ERROR) << "Error allocating AVframe";
+    return nullptr;
+  }
+
+  unique_ptr<DecodedFrame> frame;
+  try {
+    // Determine required buffer size and allocate buffer
+    int numBytes =
+        avpicture_get_size(pixFormat, state.outWidth, state.outHeight);
+    DecodedFrame::AvDataPtr buffer(
+        (uint8_t*)av_malloc(numBytes * sizeof(uint8_t)));
+
+    int size = avpicture_fill(
+        (AVPicture*)rgbFrame,
+        buffer.get(),
+        pixFormat,
+        state.outWidth,
+        state.outHeight);
+
+    sws_scale(
+        state.scaleContext,
+        videoStreamFrame->data,
+        videoStreamFrame->linesize,
+        0,
+        state.codecContext->height,
+        rgbFrame->data,
+        rgbFrame->linesize);
+
+    frame = make_unique<DecodedFrame>();
+    frame->width_ = state.outWidth;
+    frame->height_ = state.outHeight;
+    frame->data_ = move(buffer);
+    frame->size_ = size;
+    frame->keyFrame_ = videoStreamFrame->key_frame;
+  } catch (const std::exception&) {
+    frame.reset();
+  }
+  av_frame_free(&rgbFrame);
+  return frame;
+}
+
+void VideoDecoder::decodeFramesLoop(
+    const string& videoName,
+    VideoIOContext& ioctx,
+    const Params& params,
+    const FrameSelector& selector,
+    DecodedFrameMap& frames) {
+  frames.clear();
+  StreamState state;
+  AVFrame* videoStreamFrame = nullptr;
+  try {
+    if (!openStream(videoName, ioctx, params, &state)) {
+      closeStream(&state);
+      return;
+    }
+    AVStream* stream = state.videoStream;
+
+    double fps = av_q2d(stream->avg_frame_rate);
+    if (fps <= 0) {
+      fps = av_q2d(stream->r_frame_rate);
+    }
+    const double timeBase = av_q2d(stream->time_base);
+    const int64_t startPts =
+        stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+
+    int numFrames = stream->nb_frames;
+    if (numFrames <= 0 && fps > 0) {
+      if (stream->duration > 0) {
+        numFrames = stream->duration * timeBase * fps;
+      } else if (state.inputContext->duration > 0) {
+        numFrames = state.inputContext->duration * fps / AV_TIME_BASE;
+      }
+    }
+
+    std::vector<int> wanted = selector(numFrames > 0 ? numFrames : 0);
+    std::sort(wanted.begin(), wanted.end());
+    wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
+    auto frameOfPts = [&](int64_t pts) {
+      return (int)round((pts - startPts) * timeBase * fps);
+    };
+    auto ptsOfFrame = [&](int frame) {
+      return startPts + (int64_t)round(frame / fps / timeBase);
+    };
+    // Without a frame rate there is no mapping from frame index to
+    // timestamp, and without an index there is nothing to seek to.
+    const bool canSeek = fps > 0 && stream->nb_index_entries > 0;
+
+    videoStreamFrame = av_frame_alloc();
+    // index of the next frame the decoder will output
+    int nextFrame = 0;
+    for (const int target : wanted) {
+      if (target < nextFrame) {
+        continue;
+      }
+      if (canSeek) {
+        int entry = av_index_search_timestamp(
+            stream, ptsOfFrame(target), AVSEEK_FLAG_BACKWARD);
+        if (entry >= 0) {
+          const int64_t keyPts = stream->index_entries[entry].timestamp;
+          // Only seek when it skips frames we would otherwise decode.
+          if (frameOfPts(keyPts) > nextFrame &&
+              av_seek_frame(
+                  state.inputContext,
+                  state.videoStreamIndex,
+                  keyPts,
+                  AVSEEK_FLAG_BACKWARD) >= 0) {
+            avcodec_flush_buffers(state.codecContext);
+            state.eof = false;
+          }
+        }
+      }
+
+      bool found = false;
+      while (!found && decodeNextFrame(&state, videoStreamFrame)) {
+        const int64_t pts =
+            av_frame_get_best_effort_timestamp(videoStreamFrame);
+        const int frameIndex = fps > 0 ? frameOfPts(pts) : nextFrame;
+        nextFrame = frameIndex + 1;
+        // A frame past the target means the timestamps are off the nominal
+        // frame rate; take the closest frame we have instead.
+        if (frameIndex >= target) {
+          unique_ptr<DecodedFrame> frame =
+              convertFrame(state, params, videoStreamFrame);
+          if (frame) {
+            frame->index_ = target;
+            frame->outputFrameIndex_ = frames.size();
+            frame->timestamp_ = pts * timeBase;
+            frames[target] = std::move(frame);
+          }
+          found = true;
+        }
+        av_frame_unref(videoStreamFrame);
+      }
+      if (!found) {
+        // End of the video, the remaining frames do not exist.
+        break;
+      }
+    }
+
+    av_frame_free(&videoStreamFrame);
+    closeStream(&state);
+  } catch (const std::exception&) {
+    // In case of decoding error
+    av_frame_free(&videoStreamFrame);
+    closeStream(&state);
+  }
+}
+
+void VideoDecoder::decodeFramesFromMemory(
+    const char* buffer,
+    const int size,
+    const Params& params,
+    const FrameSelector& selector,
+    DecodedFrameMap& frames) {
+  VideoIOContext ioctx(buffer, size);
+  decodeFramesLoop(string("Memory Buffer"), ioctx, params, selector, frames);
+}
+
+void VideoDecoder::decodeFramesFromFile(
+    const string& filename,
+    const Params& params,
+    const FrameSelector& selector,
+    DecodedFrameMap& frames) {
+  VideoIOContext ioctx(filename);
+  decodeFramesLoop(filename, ioctx, params, selector, frames);
 }
 
 void VideoDecoder::decodeMemory(
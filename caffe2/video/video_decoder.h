@@ -18,6 +18,8 @@
 #define CAFFE2_VIDEO_VIDEO_DECODER_H_
 
 #include <stdio.h>
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -26,6 +28,7 @@
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavformat/avio.h>
+#include <libswscale/swscale.h>
 }
 
 namespace caffe2 {
@@ -361,10 +364,40 @@ struct VideoMeta {
         pixFormat(AVPixelFormat::AV_PIX_FMT_RGB24) {}
 };
 
+// Picks the indices of the frames to decode given the estimated number of
+// frames in the video, 0 if the container does not tell.
+using FrameSelector = std::function<std::vector<int>(int numFrames)>;
+
+// Decoded frames keyed by their index in the video stream
+using DecodedFrameMap = std::map<int, std::unique_ptr<DecodedFrame>>;
+
 class VideoDecoder {
  public:
   VideoDecoder();
 
+  /**
+   * Decodes only the selected frames of a video, opening the decoder once.
+   * The frames are decoded in ascending order in a single pass, and when the
+   * key frame preceding the next selected frame lies ahead of the current
+   * decoding position the decoder seeks to it through the stream's key frame
+   * index instead of decoding the frames in between. Frame indices are
+   * derived from the frame timestamps and the average frame rate. A frame
+   * selected several times, e.g. by overlapping clips, is decoded and
+   * returned once. Frames past the end of the video are missing from frames.
+   */
+  void decodeFramesFromFile(
+      const std::string& filename,
+      const Params& params,
+      const FrameSelector& selector,
+      DecodedFrameMap& frames);
+
+  void decodeFramesFromMemory(
+      const char* buffer,
+      const int size,
+      const Params& params,
+      const FrameSelector& selector,
+      DecodedFrameMap& frames);
+
   void decodeFile(
       const std::string filename,
       const Params& params,
@@ -396,6 +429,38 @@ class VideoDecoder {
       bool decodeFromStart = true /* decode from start or randomly seek into
                                      intermediate frame ? */
       );
+
+  // Opened input, video stream, codec and scaler of one video
+  struct StreamState {
+    AVFormatContext* inputContext = nullptr;
+    AVStream* videoStream = nullptr;
+    int videoStreamIndex = -1;
+    AVCodecContext* codecContext = nullptr;
+    SwsContext* scaleContext = nullptr;
+    int outWidth = 0;
+    int outHeight = 0;
+    bool eof = false;
+  };
+
+  bool openStream(
+      const std::string& videoName,
+      VideoIOContext& ioctx,
+      const Params& params,
+      StreamState* state);
+  void closeStream(StreamState* state);
+  // Decodes the next picture of the stream, returns false at the end of it.
+  bool decodeNextFrame(StreamState* state, AVFrame* frame);
+  std::unique_ptr<DecodedFrame> convertFrame(
+      const StreamState& state,
+      const Params& params,
+      AVFrame* frame);
+
+  void decodeFramesLoop(
+      const std::string& videoName,
+      VideoIOContext& ioctx,
+      const Params& params,
+      const FrameSelector& selector,
+      DecodedFrameMap& frames);
 };
 }
 
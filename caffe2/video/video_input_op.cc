@@ -28,7 +28,8 @@ OPERATOR_SCHEMA(VideoInput)
                                     TensorShape>& /* unused */ /*in*/) {
       vector<TensorShape> out(2);
       ArgumentHelper helper(def);
-      int batch_size = helper.GetSingleArgument<int>("batch_size", 0);
+      int batch_size = helper.GetSingleArgument<int>("batch_size", 0) *
+          helper.GetSingleArgument<int>("clips_per_video", 1);
       int crop = helper.GetSingleArgument<int>("crop", -1);
       int length = helper.GetSingleArgument<int>("length", -1);
       int multiple_label = helper.GetSingleArgument<int>("multiple_label", 0);
@@ -44,7 +45,11 @@ OPERATOR_SCHEMA(VideoInput)
             vector<int>{batch_size, num_of_labels}, TensorProto::INT32);
       }
       return out;
-    });
+    })
+    .Arg("clips_per_video", "Number of clips to decode from every video, "
+         "each placed as its own example in the batch with the video's "
+         "label. The clips start at random frames with temporal_jitter and "
+         "are spread evenly over the video otherwise. Defaults to 1");
 
 NO_GRADIENT(VideoInput);
 
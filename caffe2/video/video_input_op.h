@@ -37,7 +37,6 @@ class VideoInputOp final : public PrefetchOperator<Context> {
  public:
   using OperatorBase::OutputSize;
   using PrefetchOperator<Context>::context_;
-  using PrefetchOperator<Context>::prefetch_thread_;
   explicit VideoInputOp(const OperatorDef& operator_def, Workspace* ws);
   ~VideoInputOp() {
     PrefetchOperator<Context>::Finalize();
@@ -53,6 +52,12 @@ class VideoInputOp final : public PrefetchOperator<Context> {
       float*& buffer,
       int* label_data,
       std::mt19937* randgen);
+  bool GetClipsAndLabelFromDBValue(
+      const std::string& value,
+      std::vector<float*>& buffers,
+      int* label_data,
+      std::mt19937* randgen);
+  void AssignLabel(const TensorProto& label_proto, int* label_data);
 
   void DecodeAndTransform(
       const std::string value,
@@ -79,6 +84,7 @@ class VideoInputOp final : public PrefetchOperator<Context> {
   int scale_w_;
   int length_;
   int sampling_rate_;
+  int clips_per_video_;
   bool mirror_;
   bool temporal_jitter_;
   bool use_image_;
@@ -109,6 +115,8 @@ VideoInputOp<Context>::VideoInputOp(
       length_(OperatorBase::template GetSingleArgument<int>("length", 0)),
       sampling_rate_(
           OperatorBase::template GetSingleArgument<int>("sampling_rate", 1)),
+      clips_per_video_(
+          OperatorBase::template GetSingleArgument<int>("clips_per_video", 1)),
       mirror_(OperatorBase::template GetSingleArgument<int>("mirror", 0)),
       temporal_jitter_(
           OperatorBase::template GetSingleArgument<int>("temporal_jitter", 1)),
@@ -133,6 +141,11 @@ VideoInputOp<Context>::VideoInputOp(
   CAFFE_ENFORCE_GE(scale_w_, 0, "Must provide the cropping value.");
   CAFFE_ENFORCE_GT(length_, 0, "Must provide the clip length value.");
   CAFFE_ENFORCE_GT(crop_, 0, "Must provide the cropping value.");
+  CAFFE_ENFORCE_GT(
+      clips_per_video_, 0, "Must decode at least one clip per video.");
+  CAFFE_ENFORCE(
+      clips_per_video_ == 1 || !use_image_,
+      "Several clips per video are not supported for image sequence input");
   CAFFE_ENFORCE_GE(
       scale_h_,
       crop_,
@@ -165,12 +178,15 @@ VideoInputOp<Context>::VideoInputOp(
   LOG(INFO) << "    Using " << (is_test_ ? "center" : "random") << " crop";
   LOG(INFO) << "    Using a clip of " << length_ << " frames;";
   LOG(INFO) << "    Using a sampling rate of 1:" << sampling_rate_;
+  if (clips_per_video_ > 1) {
+    LOG(INFO) << "    Using " << clips_per_video_ << " clips per video;";
+  }
   LOG(INFO) << "    Subtract mean " << mean_ << " and divide by std " << std_
             << ".";
   vector<TIndex> data_shape(5);
   vector<TIndex> label_shape(2);
 
-  data_shape[0] = batch_size_;
+  data_shape[0] = batch_size_ * clips_per_video_;
   // Assume color videos, will convert to 3 channels, even with black & with
   // input videos
   data_shape[1] = 3;
@@ -182,11 +198,12 @@ VideoInputOp<Context>::VideoInputOp(
   // If multiple label is used, outout label is a binary vector of length
   // number of labels-dim in indicating which labels present
   if (multiple_label_) {
-    label_shape[0] = batch_size_;
+    label_shape[0] = batch_size_ * clips_per_video_;
     label_shape[1] = num_of_labels_;
     prefetched_label_.Resize(label_shape);
   } else {
-    prefetched_label_.Resize(vector<TIndex>(1, batch_size_));
+    prefetched_label_.Resize(
+        vector<TIndex>(1, batch_size_ * clips_per_video_));
   }
 }
 
@@ -207,17 +224,7 @@ bool VideoInputOp<Context>::GetClipAndLabelFromDBValue(
     start_frm = start_frm_proto.int32_data(0);
   }
 
-  // assign labels
-  if (!multiple_label_) {
-    label_data[0] = label_proto.int32_data(0);
-  } else {
-    // For multiple label case, output label is a binary vector
-    // where presented concepts are makred 1
-    memset(label_data, 0, sizeof(int) * num_of_labels_);
-    for (int i = 0; i < label_proto.int32_data_size(); i++) {
-      label_data[label_proto.int32_data(i)] = 1;
-    }
-  }
+  AssignLabel(label_proto, label_data);
 
   if (use_local_file_) {
     CAFFE_ENFORCE_EQ(
@@ -299,6 +306,87 @@ bool VideoInputOp<Context>::GetClipAndLabelFromDBValue(
   return true;
 }
 
+template <class Context>
+void VideoInputOp<Context>::AssignLabel(
+    const TensorProto& label_proto,
+    int* label_data) {
+  if (!multiple_label_) {
+    label_data[0] = label_proto.int32_data(0);
+  } else {
+    // For multiple label case, output label is a binary vector
+    // where presented concepts are makred 1
+    memset(label_data, 0, sizeof(int) * num_of_labels_);
+    for (int i = 0; i < label_proto.int32_data_size(); i++) {
+      label_data[label_proto.int32_data(i)] = 1;
+    }
+  }
+}
+
+// Decodes all the clips of a video in one pass, see DecodeClipsFromVideo.
+// label_data receives the label once per clip.
+template <class Context>
+bool VideoInputOp<Context>::GetClipsAndLabelFromDBValue(
+    const string& value,
+    std::vector<float*>& buffers,
+    int* label_data,
+    std::mt19937* randgen) {
+  TensorProtos protos;
+  CAFFE_ENFORCE(protos.ParseFromString(value));
+  const TensorProto& video_proto = protos.protos(0);
+  const TensorProto& label_proto = protos.protos(1);
+
+  const int label_size = multiple_label_ ? num_of_labels_ : 1;
+  for (int i = 0; i < clips_per_video_; i++) {
+    AssignLabel(label_proto, label_data + i * label_size);
+  }
+
+  std::mt19937* clip_randgen = temporal_jitter_ ? randgen : nullptr;
+  if (video_proto.data_type() == TensorProto::STRING) {
+    const string& encoded_video_str = video_proto.string_data(0);
+    if (use_local_file_) {
+      // encoded string contains an absolute path to a local file
+      DecodeClipsFromVideo(
+          nullptr,
+          0,
+          encoded_video_str,
+          clips_per_video_,
+          length_,
+          scale_h_,
+          scale_w_,
+          sampling_rate_,
+          buffers,
+          clip_randgen);
+    } else {
+      DecodeClipsFromVideo(
+          encoded_video_str.data(),
+          encoded_video_str.size(),
+          "",
+          clips_per_video_,
+          length_,
+          scale_h_,
+          scale_w_,
+          sampling_rate_,
+          buffers,
+          clip_randgen);
+    }
+  } else if (video_proto.data_type() == TensorProto::BYTE) {
+    DecodeClipsFromVideo(
+        video_proto.byte_data().data(),
+        video_proto.byte_data().size(),
+        "",
+        clips_per_video_,
+        length_,
+        scale_h_,
+        scale_w_,
+        sampling_rate_,
+        buffers,
+        clip_randgen);
+  } else {
+    LOG(FATAL) << "Unknown video data type.";
+  }
+  return true;
+}
+
 template <class Context>
 void VideoInputOp<Context>::DecodeAndTransform(
     const std::string value,
@@ -310,28 +398,35 @@ void VideoInputOp<Context>::DecodeAndTransform(
     const float std,
     std::mt19937* randgen,
     std::bernoulli_distribution* mirror_this_clip) {
-  float* buffer = nullptr;
+  std::vector<float*> buffers(1, nullptr);
 
   // Decode the video from memory or read from a local file
-  CHECK(GetClipAndLabelFromDBValue(value, buffer, label_data, randgen));
-
-  if (buffer) {
-    ClipTransform(
-        buffer,
-        3,
-        length_,
-        scale_h_,
-        scale_w_,
-        crop_size,
-        mirror,
-        mean,
-        std,
-        clip_data,
-        randgen,
-        mirror_this_clip,
-        is_test_);
+  if (clips_per_video_ > 1) {
+    CHECK(GetClipsAndLabelFromDBValue(value, buffers, label_data, randgen));
+  } else {
+    CHECK(GetClipAndLabelFromDBValue(value, buffers[0], label_data, randgen));
+  }
 
-    delete[] buffer;
+  const int clip_size = crop_size * crop_size * length_ * 3;
+  for (int i = 0; i < buffers.size(); i++) {
+    if (buffers[i]) {
+      ClipTransform(
+          buffers[i],
+          3,
+          length_,
+          scale_h_,
+          scale_w_,
+          crop_size,
+          mirror,
+          mean,
+          std,
+          clip_data + i * clip_size,
+          randgen,
+          mirror_this_clip,
+          is_test_);
+
+      delete[] buffers[i];
+    }
   }
 }
 
@@ -360,15 +455,17 @@ bool VideoInputOp<Context>::Prefetch() {
 
     // get the label data pointer for the item_id -th example
     int* label_data = prefetched_label_.mutable_data<int>() +
-        (multiple_label_ ? num_of_labels_ : 1) * item_id;
+        (multiple_label_ ? num_of_labels_ : 1) * item_id * clips_per_video_;
 
     // get the clip data pointer for the item_id -th example
     float* clip_data = prefetched_clip_.mutable_data<float>() +
-        crop_ * crop_ * length_ * channels * item_id;
+        crop_ * crop_ * length_ * channels * item_id * clips_per_video_;
 
     std::string key, value;
     // read data
-    reader_->Read(&key, &value);
+    CAFFE_DURATION(this->stats_, prefetch_read_ns) {
+      reader_->Read(&key, &value);
+    }
 
     thread_pool_->runTask(std::bind(
         &VideoInputOp<Context>::DecodeAndTransform,
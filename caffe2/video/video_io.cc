@@ -15,6 +15,7 @@
  */
 
 #include "caffe2/video/video_io.h"
+#include <algorithm>
 #include <random>
 #include <string>
 #include "caffe2/core/logging.h"
@@ -389,62 +390,147 @@ bool ReadClipFromVideo(
   return read_status;
 }
 
-bool DecodeClipFromVideoFile(
-    std::string filename,
+namespace {
+
+// Copies the frames of the clip starting at start_frm into a newly allocated
+// CHW float buffer. Returns false if some of the frames were not decoded.
+bool ClipFramesToBuffer(
+    const DecodedFrameMap& frames,
     const int start_frm,
     const int length,
-    const int height,
-    const int width,
     const int sampling_rate,
     float*& buffer) {
-  Params params;
-  std::vector<std::unique_ptr<DecodedFrame>> sampledFrames;
-  VideoDecoder decoder;
-
-  params.outputHeight_ = height ? height : -1;
-  params.outputWidth_ = width ? width : -1;
-  params.maximumOutputFrames_ = MAX_DECODING_FRAMES;
-
-  // decode all frames with defaul sampling rate
-  decoder.decodeFile(filename, params, sampledFrames);
-
   buffer = nullptr;
-  int offset = 0;
-  int channel_size = 0;
-  int image_size = 0;
-  int data_size = 0;
-
   int end_frm = start_frm + length * sampling_rate;
   for (int i = start_frm; i < end_frm; i += sampling_rate) {
-    if (i == start_frm) {
-      image_size = sampledFrames[i]->height_ * sampledFrames[i]->width_;
-      channel_size = image_size * length;
-      data_size = channel_size * 3;
-      buffer = new float[data_size];
+    if (frames.find(i) == frames.end()) {
+      return false;
     }
+  }
 
+  const DecodedFrame& first = *frames.at(start_frm);
+  int image_size = first.height_ * first.width_;
+  int channel_size = image_size * length;
+  buffer = new float[channel_size * 3];
+  int offset = 0;
+  for (int i = start_frm; i < end_frm; i += sampling_rate) {
+    const DecodedFrame& frame = *frames.at(i);
     for (int c = 0; c < 3; c++) {
       ImageDataToBuffer(
-          (unsigned char*)sampledFrames[i]->data_.get(),
-          sampledFrames[i]->height_,
-          sampledFrames[i]->width_,
+          (unsigned char*)frame.data_.get(),
+          frame.height_,
+          frame.width_,
           buffer + c * channel_size + offset,
           c);
     }
     offset += image_size;
   }
   CAFFE_ENFORCE(offset == channel_size, "Wrong offset size");
+  return true;
+}
 
-  // free the sampledFrames
-  for (int i = 0; i < sampledFrames.size(); i++) {
-    DecodedFrame* p = sampledFrames[i].release();
-    delete p;
+// Frame indices of the clips starting at start_frms
+std::vector<int> ClipFrameIndices(
+    const std::vector<int>& start_frms,
+    const int length,
+    const int sampling_rate) {
+  std::vector<int> indices;
+  for (const int start_frm : start_frms) {
+    for (int i = 0; i < length; i++) {
+      indices.push_back(start_frm + i * sampling_rate);
+    }
   }
-  sampledFrames.clear();
+  return indices;
+}
+
+} // namespace
 
+bool DecodeClipFromVideoFile(
+    std::string filename,
+    const int start_frm,
+    const int length,
+    const int height,
+    const int width,
+    const int sampling_rate,
+    float*& buffer) {
+  Params params;
+  DecodedFrameMap frames;
+  VideoDecoder decoder;
+
+  params.outputHeight_ = height ? height : -1;
+  params.outputWidth_ = width ? width : -1;
+
+  // only decode the frames of the clip
+  decoder.decodeFramesFromFile(
+      filename,
+      params,
+      [&](int /* numFrames */) {
+        return ClipFrameIndices({start_frm}, length, sampling_rate);
+      },
+      frames);
+
+  CAFFE_ENFORCE(
+      ClipFramesToBuffer(frames, start_frm, length, sampling_rate, buffer),
+      "Could not decode the frames of the clip from ",
+      filename);
   return true;
 }
 
+bool DecodeClipsFromVideo(
+    const char* video_buffer,
+    const int size,
+    const std::string& filename,
+    const int num_clips,
+    const int length,
+    const int height,
+    const int width,
+    const int sampling_rate,
+    std::vector<float*>& buffers,
+    std::mt19937* randgen) {
+  Params params;
+  DecodedFrameMap frames;
+  VideoDecoder decoder;
+
+  params.outputHeight_ = height ? height : -1;
+  params.outputWidth_ = width ? width : -1;
+
+  const int clip_span = (length - 1) * sampling_rate + 1;
+  std::vector<int> start_frms(num_clips, 0);
+  FrameSelector selector = [&](int num_frames) {
+    int last_start = std::max(num_frames - clip_span, 0);
+    for (int i = 0; i < num_clips; i++) {
+      if (randgen) {
+        start_frms[i] =
+            std::uniform_int_distribution<>(0, last_start)(*randgen);
+      } else if (num_clips > 1) {
+        start_frms[i] = (int64_t)last_start * i / (num_clips - 1);
+      }
+    }
+    return ClipFrameIndices(start_frms, length, sampling_rate);
+  };
+
+  if (video_buffer) {
+    decoder.decodeFramesFromMemory(
+        video_buffer, size, params, selector, frames);
+  } else {
+    decoder.decodeFramesFromFile(filename, params, selector, frames);
+  }
+
+  buffers.assign(num_clips, nullptr);
+  bool success = true;
+  for (int i = 0; i < num_clips; i++) {
+    if (!ClipFramesToBuffer(
+            frames, start_frms[i], length, sampling_rate, buffers[i])) {
+      success = false;
+    }
+  }
+  if (!success) {
+    LOG(ERROR)
+        << "The video seems faulty and we could not decode suffient samples";
+  }
+  return success;
+}
+
 bool DecodeClipFromMemoryBuffer(
     const char* video_buffer,
     const int size,
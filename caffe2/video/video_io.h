@@ -19,6 +19,7 @@
 
 #include <opencv2/opencv.hpp>
 #include <random>
+#include <vector>
 #include "caffe/proto/caffe.pb.h"
 
 #include <iostream>
@@ -101,6 +102,23 @@ bool DecodeClipFromVideoFile(
     const int sampling_rate,
     float*& buffer);
 
+// Decodes num_clips clips of the same video in one pass, from video_buffer
+// if it is not null and from filename otherwise. The clips start at random
+// frames if randgen is given and are spread evenly over the video otherwise.
+// buffers receives one newly allocated CHW float buffer per clip, or nullptr
+// for the clips that could not be decoded, in which case it returns false.
+bool DecodeClipsFromVideo(
+    const char* video_buffer,
+    const int size,
+    const std::string& filename,
+    const int num_clips,
+    const int length,
+    const int height,
+    const int width,
+    const int sampling_rate,
+    std::vector<float*>& buffers,
+    std::mt19937* randgen);
+
 bool DecodeClipFromMemoryBuffer(
     const char* video_buffer,
     const int size,
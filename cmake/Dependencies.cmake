@@ -141,6 +141,24 @@ if(BUILD_TEST)
   set(BUILD_SHARED_LIBS ${TEMP_BUILD_SHARED_LIBS})
 endif()
 
+# ---[ NUMA
+if(USE_NUMA)
+  if(NOT CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    message(WARNING "NUMA is currently only supported under Linux.")
+    set(USE_NUMA OFF)
+  else()
+    find_package(Numa)
+    if(NUMA_FOUND)
+      caffe2_include_directories(${Numa_INCLUDE_DIR})
+      list(APPEND Caffe2_DEPENDENCY_LIBS ${Numa_LIBRARIES})
+      set(CAFFE2_USE_NUMA 1)
+    else()
+      message(WARNING "Not compiling with NUMA. Suppress this warning with -DUSE_NUMA=OFF")
+      set(USE_NUMA OFF)
+    endif()
+  endif()
+endif()
+
 # ---[ LMDB
 if(USE_LMDB)
   find_package(LMDB)
@@ -181,6 +199,18 @@ if(USE_ROCKSDB)
   endif()
 endif()
 
+# ---[ zlib
+if(USE_ZLIB)
+  find_package(ZLIB)
+  if(ZLIB_FOUND)
+    caffe2_include_directories(${ZLIB_INCLUDE_DIRS})
+    list(APPEND Caffe2_DEPENDENCY_LIBS ${ZLIB_LIBRARIES})
+  else()
+    message(WARNING "Not compiling with zlib. Suppress this warning with -DUSE_ZLIB=OFF")
+    set(USE_ZLIB OFF)
+  endif()
+endif()
+
 # ---[ ZMQ
 if(USE_ZMQ)
   find_package(ZMQ)
@@ -67,6 +67,26 @@ if (CAFFE2_COMPILER_SUPPORTS_AVX2_EXTENSIONS)
   endif()
 endif()
 
+# ---[ Check if the compiler has avx512 support. The perfkernels use the
+# avx512f, avx512bw and avx512vl subsets.
+
+if (NOT MSVC)
+  set(CMAKE_REQUIRED_FLAGS "-mavx512f -mavx512bw -mavx512vl")
+  CHECK_CXX_SOURCE_COMPILES(
+      "#include <immintrin.h>
+       int main() {
+         short c[16] = {0};
+         __m512 a = _mm512_set1_ps(1.f);
+         __m256i b = _mm256_maskz_loadu_epi16(1, c);
+         a = _mm512_fmadd_ps(a, _mm512_cvtph_ps(b), a);
+         return 0;
+       }" CAFFE2_COMPILER_SUPPORTS_AVX512_EXTENSIONS)
+  if (CAFFE2_COMPILER_SUPPORTS_AVX512_EXTENSIONS AND CAFFE2_PERF_WITH_AVX2)
+    message(STATUS "Current compiler supports avx512 extention. Will build avx512 perfkernels.")
+    set(CAFFE2_PERF_WITH_AVX512 1)
+  endif()
+endif()
+
 # ---[ If we are using msvc, set no warning flags
 # Note(jiayq): if you are going to add a warning flag, check if this is
 # totally necessary, and only add when you see fit. If it is needed due to
@@ -55,6 +55,7 @@ function (caffe2_print_configuration_summary)
     message(STATUS "    NERVANA_GPU version : ${NERVANA_GPU_VERSION}")
   endif()
   message(STATUS "  USE_NNPACK            : ${USE_NNPACK}")
+  message(STATUS "  USE_NUMA              : ${USE_NUMA}")
   message(STATUS "  USE_OBSERVERS         : ${USE_OBSERVERS}")
   message(STATUS "  USE_OPENCV            : ${USE_OPENCV}")
   if(${USE_OPENCV})
@@ -64,5 +65,6 @@ function (caffe2_print_configuration_summary)
   message(STATUS "  USE_REDIS             : ${USE_REDIS}")
   message(STATUS "  USE_ROCKSDB           : ${USE_ROCKSDB}")
   message(STATUS "  USE_THREADS           : ${USE_THREADS}")
+  message(STATUS "  USE_ZLIB              : ${USE_ZLIB}")
   message(STATUS "  USE_ZMQ               : ${USE_ZMQ}")
 endfunction()
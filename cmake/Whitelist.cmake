@@ -5,6 +5,24 @@ endif()
 
 set (__caffe2_whitelist_included TRUE)
 
+# ---[ Operator whitelist
+# Turned into defines in macros.h, which make the registration macros drop
+# every operator that is not listed. See CAFFE2_USE_OPERATOR_WHITELIST in
+# caffe2/core/operator_schema.h.
+set(CAFFE2_OPERATOR_WHITELIST_DEFINES "")
+if (CAFFE2_OPERATOR_WHITELIST)
+  set(CAFFE2_USE_OPERATOR_WHITELIST ON)
+  file(STRINGS "${CAFFE2_OPERATOR_WHITELIST}" operator_whitelist_content)
+  foreach(item ${operator_whitelist_content})
+    string(STRIP "${item}" item)
+    if (item AND NOT item MATCHES "^#")
+      set(CAFFE2_OPERATOR_WHITELIST_DEFINES
+          "${CAFFE2_OPERATOR_WHITELIST_DEFINES}#define CAFFE2_OPERATOR_WHITELISTED_${item} 1\n")
+    endif()
+  endforeach()
+  message(STATUS "Only registering the operators listed in ${CAFFE2_OPERATOR_WHITELIST}")
+endif()
+
 set(CAFFE2_WHITELISTED_FILES)
 if (NOT CAFFE2_WHITELIST)
   return()